@@ -38,6 +38,8 @@ DEFINE_string(assignment_problem_output_file, "",
 DEFINE_bool(assignment_reverse_arcs, false,
             "Ignored if --assignment_static_graph=true. Use StarGraph "
             "if true, ForwardStarGraph if false.");
+DEFINE_int32(assignment_num_threads, 1,
+             "Number of threads used to compute the assignment.");
 DEFINE_bool(assignment_static_graph, true,
             "Use the ForwardStarStaticGraph representation, "
             "otherwise ForwardStarGraph or StarGraph according "
@@ -150,6 +152,7 @@ int SolveDimacsAssignment(int argc, char* argv[]) {
     hungarian_cost = BuildAndSolveHungarianInstance(*assignment);
     hungarian_solved = true;
   }
+  assignment->SetNumThreads(FLAGS_assignment_num_threads);
   WallTimer timer;
   timer.Start();
   bool success = assignment->ComputeAssignment();
@@ -128,9 +128,10 @@ void Jobshop(const JobShopData& data) {
 
   // ----- Search monitors and decision builder -----
 
-  // This decision builder will rank all tasks on all machines.
-  DecisionBuilder* const sequence_phase =
-      solver.MakePhase(all_sequences, Solver::SEQUENCE_DEFAULT);
+  // This decision builder will rank all tasks on all machines. It favors
+  // the machines on which ranking decisions failed the most.
+  DecisionBuilder* const sequence_phase = solver.MakePhase(
+      all_sequences, Solver::CHOOSE_MIN_WEIGHTED_SLACK_RANK_FORWARD);
 
   // After the ranking of tasks, the schedule is still loose and any
   // task can be postponed at will. But, because the problem is now a PERT
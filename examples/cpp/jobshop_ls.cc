@@ -57,6 +57,12 @@ DEFINE_string(
     "list of \"<machine index> <duration>\"\n"
     "note: jobs with one task are not supported");
 DEFINE_int32(time_limit_in_ms, 60000, "Time limit in ms, 0 means no limit.");
+DEFINE_bool(use_critical_path_swap, true,
+            "Use the critical path swap operator, which evaluates moves on "
+            "the disjunctive graph before propagating them.");
+DEFINE_bool(use_makespan_filter, true,
+            "Filter non-improving neighbors on the disjunctive graph before "
+            "propagating them.");
 DEFINE_int32(shuffle_length, 4, "Length of sub-sequences to shuffle LS.");
 DEFINE_int32(sub_sequence_length, 4,
              "Length of sub-sequences to relax in LNS.");
@@ -163,6 +169,11 @@ void JobshopLs(const JobShopData& data) {
 
   LOG(INFO) << "Looking for the first solution and improving with local search";
   std::vector<LocalSearchOperator*> operators;
+  if (FLAGS_use_critical_path_swap) {
+    LOG(INFO) << "  - use critical path swap operator";
+    operators.push_back(
+        solver.RevAlloc(new CriticalPathSwap(all_sequences, data)));
+  }
   LOG(INFO) << "  - use swap operator";
   LocalSearchOperator* const swap_operator =
       solver.RevAlloc(new SwapIntervals(all_sequences));
@@ -189,8 +200,15 @@ void JobshopLs(const JobShopData& data) {
   DecisionBuilder* const ls_db = solver.MakeSolveOnce(
       solver.Compose(random_sequence_phase, obj_phase), ls_limit);
 
+  std::vector<LocalSearchFilter*> filters;
+  if (FLAGS_use_makespan_filter) {
+    LOG(INFO) << "  - use makespan filter";
+    filters.push_back(
+        solver.RevAlloc(new MakespanFilter(all_sequences, data)));
+  }
+
   LocalSearchPhaseParameters* const parameters =
-      solver.MakeLocalSearchPhaseParameters(concat, ls_db);
+      solver.MakeLocalSearchPhaseParameters(concat, ls_db, nullptr, filters);
   DecisionBuilder* const final_db = solver.MakeLocalSearchPhase(
       all_sequences, first_solution_phase, parameters);
 
@@ -35,8 +35,10 @@
 #ifndef OR_TOOLS_EXAMPLES_JOBSHOP_LS_H_
 #define OR_TOOLS_EXAMPLES_JOBSHOP_LS_H_
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <vector>
 
 #include "base/integral_types.h"
 #include "base/logging.h"
@@ -45,8 +47,11 @@
 #include "base/file.h"
 #include "base/filelinereader.h"
 #include "base/split.h"
+#include "base/hash.h"
+#include "base/map_util.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
+#include "cpp/jobshop.h"
 
 namespace operations_research {
 // ----- Exchange 2 intervals on a sequence variable -----
@@ -246,5 +251,372 @@ class SequenceLns : public SequenceVarLocalSearchOperator {
   ACMRandom random_;
   const int max_length_;
 };
+
+// ----- Longest paths in the disjunctive graph -----
+
+// Given the ranking of the tasks on each machine, computes the heads (earliest
+// start times) and tails (longest paths from the end of a task to the end of
+// the schedule) of all tasks, without any propagation. Tasks are numbered job
+// after job, and on each machine a task is identified by its index in the
+// sequence variable of the machine, which contains the tasks of the machine
+// in the same order (see JobshopLs()).
+class JobShopGraph {
+ public:
+  explicit JobShopGraph(const JobShopData& data)
+      : machine_tasks_(data.machine_count()),
+        machine_sequences_(data.machine_count()),
+        makespan_(0) {
+    for (int job_id = 0; job_id < data.job_count(); ++job_id) {
+      const std::vector<JobShopData::Task>& tasks = data.TasksOfJob(job_id);
+      for (int task_index = 0; task_index < tasks.size(); ++task_index) {
+        const int task = duration_.size();
+        duration_.push_back(tasks[task_index].duration);
+        machine_.push_back(tasks[task_index].machine_id);
+        job_predecessor_.push_back(task_index > 0 ? task - 1 : -1);
+        job_successor_.push_back(task_index + 1 < tasks.size() ? task + 1 : -1);
+        machine_tasks_[tasks[task_index].machine_id].push_back(task);
+      }
+    }
+    const int num_tasks = duration_.size();
+    machine_predecessor_.assign(num_tasks, -1);
+    machine_successor_.assign(num_tasks, -1);
+    rank_.assign(num_tasks, -1);
+    head_.assign(num_tasks, 0);
+    tail_.assign(num_tasks, 0);
+  }
+
+  // A maximal sequence of consecutive tasks of a critical path on the same
+  // machine, given by the ranks of its first and last tasks on the machine.
+  struct Block {
+    int machine;
+    int first;
+    int last;
+  };
+
+  int num_tasks() const { return duration_.size(); }
+  int machine_count() const { return machine_tasks_.size(); }
+  int64 makespan() const { return makespan_; }
+
+  // Sets the ranking of the tasks on the given machine; sequence contains the
+  // indices of all the tasks of the machine in the sequence variable.
+  void SetSequence(int machine, const std::vector<int>& sequence) {
+    const std::vector<int>& tasks = machine_tasks_[machine];
+    DCHECK_EQ(tasks.size(), sequence.size());
+    machine_sequences_[machine].resize(sequence.size());
+    int previous = -1;
+    for (int i = 0; i < sequence.size(); ++i) {
+      const int task = tasks[sequence[i]];
+      machine_sequences_[machine][i] = task;
+      rank_[task] = i;
+      machine_predecessor_[task] = previous;
+      if (previous != -1) {
+        machine_successor_[previous] = task;
+      }
+      previous = task;
+    }
+    if (previous != -1) {
+      machine_successor_[previous] = -1;
+    }
+  }
+
+  // Computes heads, tails and the makespan in O(number of tasks). Returns
+  // false if the rankings contain a cycle.
+  bool Update() {
+    const int num_tasks = duration_.size();
+    order_.clear();
+    in_degree_.resize(num_tasks);
+    for (int task = 0; task < num_tasks; ++task) {
+      in_degree_[task] = (job_predecessor_[task] != -1) +
+                         (machine_predecessor_[task] != -1);
+      if (in_degree_[task] == 0) {
+        order_.push_back(task);
+      }
+    }
+    makespan_ = 0;
+    for (int i = 0; i < order_.size(); ++i) {
+      const int task = order_[i];
+      head_[task] = std::max(EndOf(job_predecessor_[task]),
+                             EndOf(machine_predecessor_[task]));
+      makespan_ = std::max(makespan_, head_[task] + duration_[task]);
+      const int successors[2] = {job_successor_[task],
+                                 machine_successor_[task]};
+      for (const int successor : successors) {
+        if (successor != -1 && --in_degree_[successor] == 0) {
+          order_.push_back(successor);
+        }
+      }
+    }
+    if (order_.size() < num_tasks) {
+      return false;
+    }
+    for (int i = num_tasks - 1; i >= 0; --i) {
+      const int task = order_[i];
+      tail_[task] = std::max(TailOf(job_successor_[task]),
+                             TailOf(machine_successor_[task]));
+    }
+    return true;
+  }
+
+  // Fills blocks with the blocks of one critical path, in path order. Must be
+  // called after a successful Update().
+  void CriticalBlocks(std::vector<Block>* blocks) const {
+    blocks->clear();
+    int task = -1;
+    for (int t = 0; t < num_tasks(); ++t) {
+      if (head_[t] == 0 && IsCritical(t)) {
+        task = t;
+        break;
+      }
+    }
+    while (task != -1) {
+      const int start = task;
+      // Follows the machine arcs of the path as long as possible.
+      while (machine_successor_[task] != -1 &&
+             IsCriticalArc(task, machine_successor_[task])) {
+        task = machine_successor_[task];
+      }
+      if (task != start) {
+        const Block block = {machine_[task], rank_[start], rank_[task]};
+        blocks->push_back(block);
+      }
+      const int next = job_successor_[task];
+      task = next != -1 && IsCriticalArc(task, next) ? next : -1;
+    }
+  }
+
+  // Returns a lower bound of the makespan after swapping the task of rank
+  // 'rank' on 'machine' with the next one, computed in O(1) from the current
+  // heads and tails (Taillard's estimate); the bound is exact when no other
+  // head or tail changes.
+  int64 SwapEstimate(int machine, int rank) const {
+    const int u = machine_sequences_[machine][rank];
+    const int v = machine_successor_[u];
+    DCHECK_NE(-1, v);
+    const int64 head_v =
+        std::max(EndOf(job_predecessor_[v]), EndOf(machine_predecessor_[u]));
+    const int64 head_u =
+        std::max(EndOf(job_predecessor_[u]), head_v + duration_[v]);
+    const int64 tail_u =
+        std::max(TailOf(job_successor_[u]), TailOf(machine_successor_[v]));
+    const int64 tail_v =
+        std::max(TailOf(job_successor_[v]), tail_u + duration_[u]);
+    return std::max(head_v + duration_[v] + tail_v,
+                    head_u + duration_[u] + tail_u);
+  }
+
+ private:
+  int64 EndOf(int task) const {
+    return task == -1 ? 0 : head_[task] + duration_[task];
+  }
+  int64 TailOf(int task) const {
+    return task == -1 ? 0 : tail_[task] + duration_[task];
+  }
+  bool IsCritical(int task) const {
+    return head_[task] + duration_[task] + tail_[task] == makespan_;
+  }
+  bool IsCriticalArc(int from, int to) const {
+    return IsCritical(to) && EndOf(from) == head_[to];
+  }
+
+  std::vector<int64> duration_;
+  std::vector<int> machine_;
+  std::vector<int> job_predecessor_;
+  std::vector<int> job_successor_;
+  // Tasks of each machine, by index in the sequence variable and by rank.
+  std::vector<std::vector<int> > machine_tasks_;
+  std::vector<std::vector<int> > machine_sequences_;
+  std::vector<int> machine_predecessor_;
+  std::vector<int> machine_successor_;
+  std::vector<int> rank_;
+  std::vector<int64> head_;
+  std::vector<int64> tail_;
+  int64 makespan_;
+  // Scratch data for Update().
+  std::vector<int> order_;
+  std::vector<int> in_degree_;
+};
+
+// ----- Swap adjacent tasks of critical blocks (N5 neighborhood) -----
+
+// Swaps the first two and last two tasks of the blocks of a critical path
+// (the first two tasks of the first block and the last two of the last block
+// are not swapped, as this cannot improve the makespan). Moves are evaluated
+// with JobShopGraph::SwapEstimate(); moves which cannot improve the makespan
+// are not proposed and the others are proposed from the most promising one,
+// so that few of them need to be checked by propagation.
+class CriticalPathSwap : public SequenceVarLocalSearchOperator {
+ public:
+  CriticalPathSwap(const std::vector<SequenceVar*>& vars,
+                   const JobShopData& data)
+      : SequenceVarLocalSearchOperator(vars), graph_(data), current_move_(0) {}
+
+  virtual ~CriticalPathSwap() {}
+
+  virtual bool MakeNextNeighbor(Assignment* delta, Assignment* deltadelta) {
+    CHECK_NOTNULL(delta);
+    while (current_move_ < moves_.size()) {
+      RevertChanges(true);
+      const Move& move = moves_[current_move_++];
+      std::vector<int> sequence = Sequence(move.machine);
+      std::swap(sequence[move.rank], sequence[move.rank + 1]);
+      SetForwardSequence(move.machine, sequence);
+      if (ApplyChanges(delta, deltadelta)) {
+        VLOG(1) << "Delta = " << delta->DebugString();
+        return true;
+      }
+    }
+    VLOG(1) << "finished neighborhood";
+    return false;
+  }
+
+ protected:
+  virtual void OnStart() {
+    moves_.clear();
+    current_move_ = 0;
+    for (int i = 0; i < Size(); ++i) {
+      if (Sequence(i).size() != Var(i)->size()) {
+        return;
+      }
+      graph_.SetSequence(i, Sequence(i));
+    }
+    if (!graph_.Update()) {
+      return;
+    }
+    graph_.CriticalBlocks(&blocks_);
+    const int num_blocks = blocks_.size();
+    for (int b = 0; b < num_blocks; ++b) {
+      const int first = blocks_[b].first;
+      const int last = blocks_[b].last;
+      const int machine = blocks_[b].machine;
+      if (b > 0) {
+        AddMove(machine, first);
+      }
+      if (b < num_blocks - 1 && (b == 0 || last - 1 != first)) {
+        AddMove(machine, last - 1);
+      }
+    }
+    std::sort(moves_.begin(), moves_.end(), [](const Move& a, const Move& b) {
+      return a.estimate < b.estimate;
+    });
+  }
+
+ private:
+  struct Move {
+    int machine;
+    int rank;
+    int64 estimate;
+  };
+
+  void AddMove(int machine, int rank) {
+    const int64 estimate = graph_.SwapEstimate(machine, rank);
+    if (estimate < graph_.makespan()) {
+      Move move = {machine, rank, estimate};
+      moves_.push_back(move);
+    }
+  }
+
+  JobShopGraph graph_;
+  std::vector<JobShopGraph::Block> blocks_;
+  std::vector<Move> moves_;
+  int current_move_;
+};
+
+// ----- Makespan filter -----
+
+// Rejects the neighbors which do not improve the makespan of the current
+// solution, by computing the longest paths of the new rankings in
+// O(number of tasks) before any propagation. Neighbors which do not rank all
+// the tasks of the machines they change (LNS fragments) are accepted.
+class MakespanFilter : public LocalSearchFilter {
+ public:
+  MakespanFilter(const std::vector<SequenceVar*>& vars,
+                 const JobShopData& data)
+      : graph_(data),
+        sequences_(vars.size()),
+        current_makespan_(kint64max),
+        synced_(false) {
+    for (int i = 0; i < vars.size(); ++i) {
+      var_to_machine_[vars[i]] = i;
+    }
+  }
+
+  virtual ~MakespanFilter() {}
+
+  virtual bool Accept(const Assignment* delta, const Assignment* deltadelta) {
+    const Assignment::SequenceContainer& container =
+        delta->SequenceVarContainer();
+    if (!synced_ || container.Empty()) {
+      return true;
+    }
+    changed_.clear();
+    for (int i = 0; i < container.Size(); ++i) {
+      const SequenceVarElement& element = container.Element(i);
+      const int machine = FindOrDie(var_to_machine_, element.Var());
+      if (!FullSequence(element, &candidate_sequence_)) {
+        RestoreChangedSequences();
+        return true;
+      }
+      graph_.SetSequence(machine, candidate_sequence_);
+      changed_.push_back(machine);
+    }
+    // A cycle means that propagation would fail.
+    const bool accept =
+        graph_.Update() && graph_.makespan() < current_makespan_;
+    RestoreChangedSequences();
+    return accept;
+  }
+
+  virtual void Synchronize(const Assignment* assignment,
+                           const Assignment* delta) {
+    const Assignment::SequenceContainer& container =
+        assignment->SequenceVarContainer();
+    synced_ = container.Size() == sequences_.size();
+    for (int i = 0; synced_ && i < container.Size(); ++i) {
+      const SequenceVarElement& element = container.Element(i);
+      const int machine = FindOrDie(var_to_machine_, element.Var());
+      synced_ = FullSequence(element, &sequences_[machine]);
+      graph_.SetSequence(machine, sequences_[machine]);
+    }
+    synced_ = synced_ && graph_.Update();
+    current_makespan_ = synced_ ? graph_.makespan() : kint64max;
+  }
+
+  virtual std::string DebugString() const { return "MakespanFilter"; }
+
+ private:
+  // Returns the ranking of all the tasks of a machine held by element, if
+  // element ranks all of them.
+  static bool FullSequence(const SequenceVarElement& element,
+                           std::vector<int>* sequence) {
+    const std::vector<int>& forward = element.ForwardSequence();
+    const std::vector<int>& backward = element.BackwardSequence();
+    const int size = element.Var()->size();
+    if (forward.size() == size) {
+      *sequence = forward;
+      return true;
+    }
+    if (forward.size() + backward.size() != size) {
+      return false;
+    }
+    *sequence = forward;
+    sequence->insert(sequence->end(), backward.rbegin(), backward.rend());
+    return true;
+  }
+
+  void RestoreChangedSequences() {
+    for (const int machine : changed_) {
+      graph_.SetSequence(machine, sequences_[machine]);
+    }
+  }
+
+  JobShopGraph graph_;
+  hash_map<const SequenceVar*, int> var_to_machine_;
+  // Rankings of the current solution.
+  std::vector<std::vector<int> > sequences_;
+  int64 current_makespan_;
+  bool synced_;
+  std::vector<int> changed_;
+  std::vector<int> candidate_sequence_;
+};
 }  // namespace operations_research
 #endif  // OR_TOOLS_EXAMPLES_JOBSHOP_LS_H_
@@ -14,9 +14,22 @@
 
 // Driver for reading and solving files in the MPS format and in
 // the linear_solver2.proto format.
+//
+// It can also be used as a benchmark harness: each file of --input is solved
+// with each of the GlopParameters presets of --mps_presets, and the number of
+// iterations, the solving time, the time of each simplex phase and the
+// deterministic time are reported for each run. With
+// --mps_deterministic_time_tolerance, it also checks that the deterministic
+// time stays calibrated with the wall time, and fails otherwise.
+//
+// Example:
+//   mps_driver --input=afiro.mps,scagr25.mps --mps_presets=primal,dual
+//    --mps_terse_result --mps_verbose_result=false
+//    --mps_deterministic_time_tolerance=10
 
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 #include "base/commandlineflags.h"
 #include "base/commandlineflags.h"
@@ -26,6 +39,7 @@
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/text_format.h"
+#include "base/split.h"
 #include "base/strutil.h"
 #include "glop/lp_solver.h"
 #include "glop/parameters.pb.h"
@@ -42,12 +56,22 @@ DEFINE_bool(mps_terse_result, false,
 DEFINE_bool(mps_verbose_result, true, "Displays the result in verbose form.");
 DEFINE_bool(mps_display_full_path, true,
             "Displays the full path of the input file in the result line.");
-DEFINE_string(input, "", "File pattern for problems to be optimized.");
+DEFINE_string(input, "",
+              "Comma-separated list of the problems to be optimized.");
 DEFINE_string(params_file, "", "Path to a GlopParameters file in text format.");
 DEFINE_string(params, "",
               "GlopParameters in text format. If --params_file was "
               "also specified, the --params will be merged onto "
               "them (i.e. in case of conflicts, --params wins)");
+DEFINE_string(mps_presets, "default",
+              "Comma-separated list of the GlopParameters presets with which "
+              "each problem is solved, on top of --params_file and --params. "
+              "Presets: default, primal, dual, no_preprocessing, no_scaling.");
+DEFINE_double(mps_deterministic_time_tolerance, 0.0,
+              "If positive, checks that the solving time of each run, in "
+              "seconds, is within this factor of its deterministic time, and "
+              "exits with a failure otherwise. The runs that take less than "
+              "0.1s are not checked.");
 
 using operations_research::FullProtocolMessageAsString;
 using operations_research::ReadFileToProto;
@@ -66,6 +90,41 @@ using google::protobuf::Reflection;
 using google::protobuf::TextFormat;
 using operations_research::HasSuffixString;
 using operations_research::ScopedWallTime;
+using operations_research::strings::SkipEmpty;
+using operations_research::strings::Split;
+
+namespace {
+// The GlopParameters presets of --mps_presets, in text format.
+struct GlopParametersPreset {
+  const char* name;
+  const char* parameters;
+};
+
+const GlopParametersPreset kGlopParametersPresets[] = {
+    {"default", ""},
+    {"primal", "use_dual_simplex: false"},
+    {"dual", "use_dual_simplex: true"},
+    {"no_preprocessing", "use_preprocessing: false"},
+    {"no_scaling", "use_scaling: false"},
+};
+
+// Below this solving time, the ratio with the deterministic time is dominated
+// by the noise and is not checked.
+const double kMinTimeForDeterministicTimeCheck = 0.1;
+
+// Merges the preset with the given name onto parameters.
+void MergeGlopParametersPreset(const std::string& name,
+                               GlopParameters* parameters) {
+  for (const GlopParametersPreset& preset : kGlopParametersPresets) {
+    if (name == preset.name) {
+      CHECK(TextFormat::MergeFromString(preset.parameters, parameters))
+          << preset.parameters;
+      return;
+    }
+  }
+  LOG(FATAL) << "Unknown GlopParameters preset: " << name;
+}
+}  // namespace
 
 
 // Parse glop parameters from the flags --params_file and --params.
@@ -92,10 +151,12 @@ int main(int argc, char* argv[]) {
   ReadGlopParameters(&parameters);
 
 
+  const std::vector<std::string> presets =
+      Split(FLAGS_mps_presets, ",", SkipEmpty());
+  int num_calibration_failures = 0;
   LinearProgram linear_program;
-  std::vector<std::string> file_list;
-  // Replace this with your favorite match function.
-    file_list.push_back(FLAGS_input);
+  const std::vector<std::string> file_list =
+      Split(FLAGS_input, ",", SkipEmpty());
   for (int i = 0; i < file_list.size(); ++i) {
     const std::string& file_name = file_list[i];
     MPSReader mps_reader;
@@ -115,49 +176,70 @@ int main(int argc, char* argv[]) {
       printf("%s", linear_program.Dump().c_str());
     }
 
-    // Create the solver with the correct parameters.
-    LPSolver solver;
-    solver.SetParameters(parameters);
-    ProblemStatus solve_status = ProblemStatus::INIT;
-
-
-    const char* status_string;
-    double objective_value;
-    double solving_time_in_sec = 0;
-    if (FLAGS_mps_solve) {
-      ScopedWallTime timer(&solving_time_in_sec);
-      solve_status = solver.Solve(linear_program);
-      status_string = GetProblemStatusString(solve_status).c_str();
-      objective_value = ToDouble(solver.GetObjectiveValue());
-    }
-
-    if (FLAGS_mps_terse_result) {
-      if (FLAGS_mps_display_full_path) {
-        printf("%s,", file_name.c_str());
-      }
-      printf("%s,", mps_reader.GetProblemName().c_str());
+    for (const std::string& preset : presets) {
+      // Create the solver with the correct parameters.
+      GlopParameters preset_parameters = parameters;
+      MergeGlopParametersPreset(preset, &preset_parameters);
+      LPSolver solver;
+      solver.SetParameters(preset_parameters);
+      ProblemStatus solve_status = ProblemStatus::INIT;
+
+      const char* status_string;
+      double objective_value;
+      double solving_time_in_sec = 0;
       if (FLAGS_mps_solve) {
-        printf("%15.15e,%s,%-6.4g,", objective_value, status_string,
-               solving_time_in_sec);
+        ScopedWallTime timer(&solving_time_in_sec);
+        solve_status = solver.Solve(linear_program);
+        status_string = GetProblemStatusString(solve_status).c_str();
+        objective_value = ToDouble(solver.GetObjectiveValue());
+      }
+      const double deterministic_time = solver.DeterministicTime();
+
+      if (FLAGS_mps_terse_result) {
+        if (FLAGS_mps_display_full_path) {
+          printf("%s,", file_name.c_str());
+        }
+        printf("%s,%s,", mps_reader.GetProblemName().c_str(), preset.c_str());
+        if (FLAGS_mps_solve) {
+          printf("%15.15e,%s,%-6.4g,%d,%-6.4g,", objective_value,
+                 status_string, solving_time_in_sec,
+                 solver.GetNumberOfSimplexIterations(), deterministic_time);
+        }
+        printf("%s,%s\n", linear_program.GetProblemStats().c_str(),
+               linear_program.GetNonZeroStats().c_str());
       }
-      printf("%s,%s\n", linear_program.GetProblemStats().c_str(),
-             linear_program.GetNonZeroStats().c_str());
-    }
 
-    if (FLAGS_mps_verbose_result) {
-      if (FLAGS_mps_display_full_path) {
-        printf("%-45s: %s\n", "File path", file_name.c_str());
+      if (FLAGS_mps_verbose_result) {
+        if (FLAGS_mps_display_full_path) {
+          printf("%-45s: %s\n", "File path", file_name.c_str());
+        }
+        printf("%-45s: %s\n", "Problem name",
+               mps_reader.GetProblemName().c_str());
+        printf("%-45s: %s\n", "Parameters preset", preset.c_str());
+        if (FLAGS_mps_solve) {
+          printf("%-45s: %15.15e\n", "Objective value", objective_value);
+          printf("%-45s: %s\n", "Problem status", status_string);
+          printf("%-45s: %-6.4g\n", "Solving time", solving_time_in_sec);
+          printf("%-45s: %-6.4g\n", "Deterministic time", deterministic_time);
+          printf("%s", solver.GetPrettySolverStats().c_str());
+        }
+        printf("%s%s", linear_program.GetPrettyProblemStats().c_str(),
+               linear_program.GetPrettyNonZeroStats().c_str());
       }
-      printf("%-45s: %s\n", "Problem name",
-             mps_reader.GetProblemName().c_str());
-      if (FLAGS_mps_solve) {
-        printf("%-45s: %15.15e\n", "Objective value", objective_value);
-        printf("%-45s: %s\n", "Problem status", status_string);
-        printf("%-45s: %-6.4g\n", "Solving time", solving_time_in_sec);
+
+      if (FLAGS_mps_solve && FLAGS_mps_deterministic_time_tolerance > 0.0 &&
+          solving_time_in_sec >= kMinTimeForDeterministicTimeCheck) {
+        const double tolerance = FLAGS_mps_deterministic_time_tolerance;
+        if (solving_time_in_sec > tolerance * deterministic_time ||
+            deterministic_time > tolerance * solving_time_in_sec) {
+          LOG(ERROR) << file_name << " (" << preset
+                     << "): the solving time " << solving_time_in_sec
+                     << "s is not within a factor " << tolerance
+                     << " of the deterministic time " << deterministic_time;
+          ++num_calibration_failures;
+        }
       }
-      printf("%s%s", linear_program.GetPrettyProblemStats().c_str(),
-             linear_program.GetPrettyNonZeroStats().c_str());
     }
   }
-  return EXIT_SUCCESS;
+  return num_calibration_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
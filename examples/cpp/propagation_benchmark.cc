@@ -0,0 +1,500 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Micro-benchmarks of the propagation of the constraint solver.
+// Each benchmark exercises one hot primitive of the solver on a small
+// synthetic model, or on a model read from data/, with a deterministic search:
+// - intvar_small_domain, intvar_large_domain: bound and value removals on
+//   DomainIntVar, with a bitset of 64 bits or a larger one, undone by
+//   backtracking.
+// - sum: enumeration of the solutions of a SumConstraint.
+// - bounds_all_different: enumeration of the solutions of a
+//   BoundsAllDifferent.
+// - table: enumeration of the solutions of two overlapping
+//   CompactPositiveTableConstraint.
+// - element: enumeration of the solutions of a sum of element expressions.
+// - path_cumul: enumeration of the paths with time windows of a PathCumul.
+// - disjunctive: minimization of the makespan of a random jobshop.
+// - disjunctive_jobshop: the same on --propagation_benchmark_jobshop_file.
+// - cumulative: minimization of the makespan of a random cumulative
+//   scheduling problem.
+// - queens, queens_profiled: enumeration of all the solutions of the n-queens
+//   problem without and with a propagation monitor (the demon profiler)
+//   installed on the solver, to measure the cost of the instrumentation.
+//
+// For each benchmark, the fastest of --propagation_benchmark_runs runs is
+// reported, with its number of propagations (the number of demon runs, or the
+// number of domain modifications for the intvar benchmarks), the time per
+// propagation, and the number and size of the memory allocations done during
+// the search, which are counted by replacing the global operator new of this
+// binary. Only the search is measured, not the creation of the model.
+//
+// Example:
+//   propagation_benchmark --propagation_benchmark_filter=table,cumulative
+//    --propagation_benchmark_runs=5
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "base/commandlineflags.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/random.h"
+#include "base/split.h"
+#include "base/timer.h"
+#include "constraint_solver/constraint_solver.h"
+#include "util/tuple_set.h"
+#include "cpp/jobshop.h"
+
+DEFINE_string(propagation_benchmark_filter, "",
+              "Comma-separated list of the benchmarks to run. All the "
+              "benchmarks are run if empty.");
+DEFINE_int32(propagation_benchmark_size, 11, "Size of the n-queens problem.");
+DEFINE_int32(propagation_benchmark_runs, 3,
+             "Number of runs per benchmark; the fastest one is reported.");
+DEFINE_int64(propagation_benchmark_failures, 5000,
+             "Limit on the number of failures of the optimization benchmarks.");
+DEFINE_string(propagation_benchmark_jobshop_file, "data/jobshop/ft10",
+              "Jobshop instance used by the disjunctive_jobshop benchmark, in "
+              "the jssp or taillard format.");
+
+namespace {
+// Number and total size of the allocations done while
+// allocation_counting_enabled is true. The solver is single-threaded, so there
+// is no need to synchronize them.
+bool allocation_counting_enabled = false;
+int64 num_allocations = 0;
+int64 allocated_bytes = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+  if (allocation_counting_enabled) {
+    ++num_allocations;
+    allocated_bytes += size;
+  }
+  void* const ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == NULL) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+namespace operations_research {
+
+struct PropagationBenchmarkResult {
+  double time_ns;
+  int64 propagations;
+  int64 allocations;
+  int64 allocated_bytes;
+  int64 solutions;
+  int64 branches;
+};
+
+int64 DemonRuns(Solver* const s) {
+  return s->demon_runs(Solver::VAR_PRIORITY) +
+         s->demon_runs(Solver::NORMAL_PRIORITY) +
+         s->demon_runs(Solver::DELAYED_PRIORITY);
+}
+
+// Runs the search, enumerating all its solutions, and measures it.
+PropagationBenchmarkResult RunSearch(
+    Solver* const s, DecisionBuilder* const db,
+    const std::vector<SearchMonitor*>& monitors) {
+  PropagationBenchmarkResult result;
+  result.solutions = 0;
+  const int64 initial_demon_runs = DemonRuns(s);
+  num_allocations = 0;
+  allocated_bytes = 0;
+  WallTimer timer;
+  timer.Start();
+  allocation_counting_enabled = true;
+  s->NewSearch(db, monitors);
+  while (s->NextSolution()) {
+    ++result.solutions;
+  }
+  s->EndSearch();
+  allocation_counting_enabled = false;
+  timer.Stop();
+  result.time_ns = timer.Get() * 1e9;
+  result.propagations = DemonRuns(s) - initial_demon_runs;
+  result.allocations = num_allocations;
+  result.allocated_bytes = allocated_bytes;
+  result.branches = s->branches();
+  return result;
+}
+
+// ----- DomainIntVar -----
+
+// Applies rounds of bound and value removals on the variables, each round
+// being undone by backtracking.
+class DomainModifications : public DecisionBuilder {
+ public:
+  DomainModifications(const std::vector<IntVar*>& vars, int num_rounds,
+                      int64* num_modifications)
+      : vars_(vars),
+        num_rounds_(num_rounds),
+        num_modifications_(num_modifications) {}
+  virtual ~DomainModifications() {}
+
+  virtual Decision* Next(Solver* const s) {
+    for (int round = 0; round < num_rounds_; ++round) {
+      s->PushState();
+      for (IntVar* const var : vars_) {
+        const int64 middle = (var->Min() + var->Max()) / 2;
+        var->RemoveValue(middle);
+        var->RemoveInterval(middle + 2, middle + 4);
+        var->SetMin(var->Min() + 1);
+        var->SetMax(var->Max() - 1);
+        var->RemoveValue(var->Min() + 1);
+        var->RemoveValue(var->Max() - 1);
+        var->SetRange(var->Min() + 2, var->Max() - 2);
+      }
+      *num_modifications_ += 7 * vars_.size();
+      s->PopState();
+    }
+    return NULL;
+  }
+
+ private:
+  const std::vector<IntVar*> vars_;
+  const int num_rounds_;
+  int64* const num_modifications_;
+};
+
+PropagationBenchmarkResult DomainModificationBenchmark(int64 domain_size) {
+  Solver s("intvar");
+  std::vector<IntVar*> vars;
+  s.MakeIntVarArray(100, 0, domain_size - 1, "x", &vars);
+  int64 num_modifications = 0;
+  PropagationBenchmarkResult result =
+      RunSearch(&s, s.RevAlloc(new DomainModifications(vars, 10000,
+                                                       &num_modifications)),
+                std::vector<SearchMonitor*>());
+  result.propagations = num_modifications;
+  return result;
+}
+
+PropagationBenchmarkResult SmallDomainBenchmark() {
+  return DomainModificationBenchmark(64);
+}
+
+PropagationBenchmarkResult LargeDomainBenchmark() {
+  return DomainModificationBenchmark(10000);
+}
+
+// ----- Constraints -----
+
+PropagationBenchmarkResult SumBenchmark() {
+  Solver s("sum");
+  std::vector<IntVar*> vars;
+  s.MakeIntVarArray(6, 0, 9, "x", &vars);
+  s.AddConstraint(s.MakeSumEquality(vars, 27));
+  return RunSearch(&s, s.MakePhase(vars, Solver::CHOOSE_FIRST_UNBOUND,
+                                   Solver::ASSIGN_MIN_VALUE),
+                   std::vector<SearchMonitor*>());
+}
+
+PropagationBenchmarkResult BoundsAllDifferentBenchmark() {
+  Solver s("bounds_all_different");
+  std::vector<IntVar*> vars;
+  s.MakeIntVarArray(9, 0, 8, "x", &vars);
+  s.AddConstraint(s.MakeAllDifferent(vars, /*stronger_propagation=*/true));
+  s.AddConstraint(s.MakeLess(vars[0], vars[8]));
+  return RunSearch(&s, s.MakePhase(vars, Solver::CHOOSE_MIN_SIZE_LOWEST_MIN,
+                                   Solver::ASSIGN_MIN_VALUE),
+                   std::vector<SearchMonitor*>());
+}
+
+PropagationBenchmarkResult TableBenchmark() {
+  Solver s("table");
+  ACMRandom random(1);
+  const int kArity = 4;
+  const int kDomainSize = 10;
+  std::vector<IntVar*> vars;
+  s.MakeIntVarArray(6, 0, kDomainSize - 1, "x", &vars);
+  for (int offset = 0; offset <= 2; offset += 2) {
+    IntTupleSet tuples(kArity);
+    for (int i = 0; i < 2000; ++i) {
+      tuples.Insert4(random.Uniform(kDomainSize), random.Uniform(kDomainSize),
+                     random.Uniform(kDomainSize), random.Uniform(kDomainSize));
+    }
+    const std::vector<IntVar*> scope(vars.begin() + offset,
+                                     vars.begin() + offset + kArity);
+    s.AddConstraint(s.MakeAllowedAssignments(scope, tuples));
+  }
+  return RunSearch(&s, s.MakePhase(vars, Solver::CHOOSE_FIRST_UNBOUND,
+                                   Solver::ASSIGN_MIN_VALUE),
+                   std::vector<SearchMonitor*>());
+}
+
+PropagationBenchmarkResult ElementBenchmark() {
+  Solver s("element");
+  ACMRandom random(2);
+  const int kNumIndices = 5;
+  const int kNumValues = 20;
+  std::vector<IntVar*> indices;
+  s.MakeIntVarArray(kNumIndices, 0, kNumValues - 1, "i", &indices);
+  std::vector<IntVar*> elements;
+  for (int i = 0; i < kNumIndices; ++i) {
+    std::vector<int64> values(kNumValues);
+    for (int j = 0; j < kNumValues; ++j) {
+      values[j] = random.Uniform(100);
+    }
+    elements.push_back(s.MakeElement(values, indices[i])->Var());
+  }
+  s.AddConstraint(s.MakeSumEquality(elements, 250));
+  return RunSearch(&s, s.MakePhase(indices, Solver::CHOOSE_FIRST_UNBOUND,
+                                   Solver::ASSIGN_MIN_VALUE),
+                   std::vector<SearchMonitor*>());
+}
+
+// A single path from node 0 to node kNumNodes through all the other nodes,
+// with random transit times and time windows.
+PropagationBenchmarkResult PathCumulBenchmark() {
+  Solver s("path_cumul");
+  ACMRandom random(3);
+  const int kNumNodes = 9;
+  std::vector<IntVar*> nexts;
+  s.MakeIntVarArray(kNumNodes, 1, kNumNodes, "next", &nexts);
+  std::vector<IntVar*> active(kNumNodes, s.MakeIntConst(1));
+  std::vector<IntVar*> transits;
+  for (int i = 0; i < kNumNodes; ++i) {
+    transits.push_back(s.MakeIntConst(1 + random.Uniform(10)));
+  }
+  std::vector<IntVar*> cumuls;
+  for (int i = 0; i <= kNumNodes; ++i) {
+    const int64 start = random.Uniform(40);
+    cumuls.push_back(s.MakeIntVar(start, start + 35 + random.Uniform(35)));
+  }
+  s.AddConstraint(s.MakeAllDifferent(nexts));
+  s.AddConstraint(s.MakePathCumul(nexts, active, cumuls, transits));
+  return RunSearch(&s, s.MakePhase(nexts, Solver::CHOOSE_FIRST_UNBOUND,
+                                   Solver::ASSIGN_MIN_VALUE),
+                   std::vector<SearchMonitor*>());
+}
+
+// ----- Scheduling -----
+
+// Minimizes the makespan of the jobshop given by the tasks of each job,
+// ranking the tasks on each machine, within --propagation_benchmark_failures
+// failures.
+PropagationBenchmarkResult JobshopBenchmark(
+    int num_machines,
+    const std::vector<std::vector<JobShopData::Task> >& jobs) {
+  Solver s("jobshop");
+  int64 horizon = 0;
+  for (const std::vector<JobShopData::Task>& tasks : jobs) {
+    for (const JobShopData::Task& task : tasks) horizon += task.duration;
+  }
+  std::vector<std::vector<IntervalVar*> > machines_to_tasks(num_machines);
+  std::vector<IntVar*> job_ends;
+  for (const std::vector<JobShopData::Task>& tasks : jobs) {
+    IntervalVar* previous = NULL;
+    for (const JobShopData::Task& task : tasks) {
+      IntervalVar* const interval = s.MakeFixedDurationIntervalVar(
+          0, horizon, task.duration, false, "task");
+      machines_to_tasks[task.machine_id].push_back(interval);
+      if (previous != NULL) {
+        s.AddConstraint(s.MakeIntervalVarRelation(
+            interval, Solver::STARTS_AFTER_END, previous));
+      }
+      previous = interval;
+    }
+    job_ends.push_back(previous->EndExpr()->Var());
+  }
+  std::vector<SequenceVar*> sequences;
+  for (int machine_id = 0; machine_id < num_machines; ++machine_id) {
+    DisjunctiveConstraint* const ct = s.MakeDisjunctiveConstraint(
+        machines_to_tasks[machine_id], "machine");
+    s.AddConstraint(ct);
+    sequences.push_back(ct->MakeSequenceVar());
+  }
+  IntVar* const makespan = s.MakeMax(job_ends)->Var();
+  DecisionBuilder* const db = s.Compose(
+      s.MakePhase(sequences, Solver::CHOOSE_MIN_WEIGHTED_SLACK_RANK_FORWARD),
+      s.MakePhase(makespan, Solver::CHOOSE_FIRST_UNBOUND,
+                  Solver::ASSIGN_MIN_VALUE));
+  std::vector<SearchMonitor*> monitors;
+  monitors.push_back(s.MakeMinimize(makespan, 1));
+  monitors.push_back(s.MakeFailuresLimit(FLAGS_propagation_benchmark_failures));
+  return RunSearch(&s, db, monitors);
+}
+
+// A random jobshop in which each job visits all the machines once.
+PropagationBenchmarkResult DisjunctiveBenchmark() {
+  ACMRandom random(4);
+  const int kNumJobs = 10;
+  const int kNumMachines = 8;
+  std::vector<std::vector<JobShopData::Task> > jobs(kNumJobs);
+  for (int job_id = 0; job_id < kNumJobs; ++job_id) {
+    std::vector<int> machines(kNumMachines);
+    for (int m = 0; m < kNumMachines; ++m) machines[m] = m;
+    for (int m = kNumMachines - 1; m > 0; --m) {
+      std::swap(machines[m], machines[random.Uniform(m + 1)]);
+    }
+    for (int m = 0; m < kNumMachines; ++m) {
+      jobs[job_id].push_back(
+          JobShopData::Task(job_id, machines[m], 1 + random.Uniform(50)));
+    }
+  }
+  return JobshopBenchmark(kNumMachines, jobs);
+}
+
+PropagationBenchmarkResult DisjunctiveJobshopBenchmark() {
+  JobShopData data;
+  data.Load(FLAGS_propagation_benchmark_jobshop_file);
+  if (data.job_count() == 0) {
+    LOG(WARNING) << "Could not read "
+                 << FLAGS_propagation_benchmark_jobshop_file;
+    PropagationBenchmarkResult result;
+    result.time_ns = 0.0;
+    result.propagations = 0;
+    return result;
+  }
+  std::vector<std::vector<JobShopData::Task> > jobs;
+  for (int job_id = 0; job_id < data.job_count(); ++job_id) {
+    jobs.push_back(data.TasksOfJob(job_id));
+  }
+  return JobshopBenchmark(data.machine_count(), jobs);
+}
+
+PropagationBenchmarkResult CumulativeBenchmark() {
+  Solver s("cumulative");
+  ACMRandom random(5);
+  const int kNumTasks = 30;
+  const int kCapacity = 10;
+  const int kHorizon = 1000;
+  std::vector<IntervalVar*> intervals;
+  std::vector<int64> demands;
+  std::vector<IntVar*> ends;
+  for (int i = 0; i < kNumTasks; ++i) {
+    intervals.push_back(s.MakeFixedDurationIntervalVar(
+        0, kHorizon, 1 + random.Uniform(20), false, "task"));
+    demands.push_back(1 + random.Uniform(kCapacity / 2));
+    ends.push_back(intervals.back()->EndExpr()->Var());
+  }
+  s.AddConstraint(s.MakeCumulative(intervals, demands, kCapacity, "resource"));
+  IntVar* const makespan = s.MakeMax(ends)->Var();
+  std::vector<SearchMonitor*> monitors;
+  monitors.push_back(s.MakeMinimize(makespan, 1));
+  monitors.push_back(s.MakeFailuresLimit(FLAGS_propagation_benchmark_failures));
+  return RunSearch(&s, s.MakePhase(intervals, Solver::INTERVAL_DEFAULT),
+                   monitors);
+}
+
+// ----- Instrumentation -----
+
+// Enumerates all the solutions of the n-queens problem of the given size.
+PropagationBenchmarkResult SolveQueens(int size, bool instrumented) {
+  SolverParameters parameters;
+  if (instrumented) {
+    parameters.profile_level = SolverParameters::NORMAL_PROFILING;
+  }
+  Solver s("queens", parameters);
+  std::vector<IntVar*> queens;
+  s.MakeIntVarArray(size, 0, size - 1, "queen", &queens);
+  std::vector<IntVar*> diagonal1(size);
+  std::vector<IntVar*> diagonal2(size);
+  for (int i = 0; i < size; ++i) {
+    diagonal1[i] = s.MakeSum(queens[i], i)->Var();
+    diagonal2[i] = s.MakeSum(queens[i], -i)->Var();
+  }
+  s.AddConstraint(s.MakeAllDifferent(queens));
+  s.AddConstraint(s.MakeAllDifferent(diagonal1));
+  s.AddConstraint(s.MakeAllDifferent(diagonal2));
+  DecisionBuilder* const db = s.MakePhase(queens, Solver::CHOOSE_FIRST_UNBOUND,
+                                          Solver::ASSIGN_MIN_VALUE);
+  return RunSearch(&s, db, std::vector<SearchMonitor*>());
+}
+
+PropagationBenchmarkResult QueensBenchmark() {
+  return SolveQueens(FLAGS_propagation_benchmark_size, false);
+}
+
+PropagationBenchmarkResult ProfiledQueensBenchmark() {
+  return SolveQueens(FLAGS_propagation_benchmark_size, true);
+}
+
+struct PropagationBenchmark {
+  const char* name;
+  PropagationBenchmarkResult (*run)();
+};
+
+const PropagationBenchmark kBenchmarks[] = {
+    {"intvar_small_domain", SmallDomainBenchmark},
+    {"intvar_large_domain", LargeDomainBenchmark},
+    {"sum", SumBenchmark},
+    {"bounds_all_different", BoundsAllDifferentBenchmark},
+    {"table", TableBenchmark},
+    {"element", ElementBenchmark},
+    {"path_cumul", PathCumulBenchmark},
+    {"disjunctive", DisjunctiveBenchmark},
+    {"disjunctive_jobshop", DisjunctiveJobshopBenchmark},
+    {"cumulative", CumulativeBenchmark},
+    {"queens", QueensBenchmark},
+    {"queens_profiled", ProfiledQueensBenchmark},
+};
+
+void RunBenchmarks() {
+  const std::vector<std::string> filter =
+      strings::Split(FLAGS_propagation_benchmark_filter, ",",
+                     strings::SkipEmpty());
+  printf("benchmark,time_ms,propagations,ns_per_propagation,allocations,"
+         "allocated_bytes,solutions,branches\n");
+  double queens_time_ns[2] = {0.0, 0.0};
+  for (const PropagationBenchmark& benchmark : kBenchmarks) {
+    if (!filter.empty() &&
+        std::find(filter.begin(), filter.end(), benchmark.name) ==
+            filter.end()) {
+      continue;
+    }
+    PropagationBenchmarkResult best;
+    for (int run = 0; run < FLAGS_propagation_benchmark_runs; ++run) {
+      const PropagationBenchmarkResult result = benchmark.run();
+      if (run == 0 || result.time_ns < best.time_ns) {
+        best = result;
+      }
+    }
+    if (best.propagations == 0) continue;
+    printf("%s,%.3f,%lld,%.1f,%lld,%lld,%lld,%lld\n", benchmark.name,
+           best.time_ns * 1e-6, best.propagations,
+           best.time_ns / best.propagations, best.allocations,
+           best.allocated_bytes, best.solutions, best.branches);
+    if (std::string(benchmark.name) == "queens") {
+      queens_time_ns[0] = best.time_ns;
+    } else if (std::string(benchmark.name) == "queens_profiled") {
+      queens_time_ns[1] = best.time_ns;
+    }
+  }
+  if (queens_time_ns[0] > 0 && queens_time_ns[1] > 0) {
+    LOG(INFO) << "Instrumentation overhead: "
+              << StringPrintf("%.1f%%", 100.0 *
+                                            (queens_time_ns[1] -
+                                             queens_time_ns[0]) /
+                                            queens_time_ns[0]);
+  }
+}
+
+}  // namespace operations_research
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags( &argc, &argv, true);
+  operations_research::RunBenchmarks();
+  return 0;
+}
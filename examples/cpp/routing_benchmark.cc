@@ -0,0 +1,481 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Benchmark of the routing library on Vehicle Routing Problems with Time
+// Windows, with or without pickup and delivery pairs.
+// Each instance of the suite is solved with every combination of first
+// solution strategy, metaheuristic and random seed given by the flags, using
+// the same time limit. For each run the following is reported:
+// - the cost of the best solution found and the number of unperformed nodes,
+// - the cost-over-time curve (time in ms and cost of each solution found),
+// - the number of neighbors explored, filtered and accepted by local search,
+// - the number of branches and failures of the search.
+// Results are output in CSV or JSON so that they can be compared from one
+// version of the library to the next.
+//
+// Instances are read in the format of the Solomon benchmark (data/cvrptw) or
+// in the format defined by Li & Lim (data/pdptw), the format being detected
+// from the header of the file.
+//
+// Example:
+//   routing_benchmark
+//    --routing_benchmark_instances=data/cvrptw/R110_1.TXT,data/pdptw/LR1101.txt
+//    --routing_benchmark_first_solutions=PathCheapestArc,Savings
+//    --routing_benchmark_metaheuristics=GreedyDescent,GuidedLocalSearch
+//    --routing_benchmark_time_limit_ms=10000
+//    --routing_benchmark_format=csv
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/commandlineflags.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/strtoint.h"
+#include "base/file.h"
+#include "base/split.h"
+#include "constraint_solver/routing.h"
+
+DEFINE_string(routing_benchmark_instances, "",
+              "Comma-separated list of instance files to solve.");
+DEFINE_string(routing_benchmark_first_solutions, "PathCheapestArc",
+              "Comma-separated list of first solution strategies (cf. "
+              "RoutingModel::RoutingStrategyName()).");
+DEFINE_string(routing_benchmark_metaheuristics, "GreedyDescent",
+              "Comma-separated list of metaheuristics (cf. "
+              "RoutingModel::RoutingMetaheuristicName()).");
+DEFINE_string(routing_benchmark_seeds, "0",
+              "Comma-separated list of random seeds of the solver.");
+DEFINE_int64(routing_benchmark_time_limit_ms, 10000,
+             "Time limit in ms of each run.");
+DEFINE_string(routing_benchmark_format, "csv",
+              "Format of the results: 'csv' or 'json'.");
+DEFINE_string(routing_benchmark_output, "",
+              "File to which results are written; standard output if empty.");
+
+namespace operations_research {
+
+// Scaling factor used to scale up distances, allowing a bit more precision
+// from Euclidean distances.
+const int64 kScalingFactor = 1000;
+// Penalty of unperformed nodes.
+const int64 kPenalty = 10000000;
+
+// Data of a benchmark instance. Node 0 is the depot.
+struct RoutingInstance {
+  std::string name;
+  int num_vehicles;
+  int64 capacity;
+  std::vector<std::pair<int, int> > coords;
+  std::vector<int64> demands;
+  std::vector<int64> open_times;
+  std::vector<int64> close_times;
+  std::vector<int64> service_times;
+  // Pickup and delivery pairs; empty for instances without pairs.
+  RoutingModel::NodePairs pairs;
+};
+
+// Result of the resolution of an instance.
+struct RoutingBenchmarkResult {
+  std::string instance;
+  std::string first_solution;
+  std::string metaheuristic;
+  int seed;
+  bool solved;
+  int64 cost;
+  int unperformed;
+  int64 time_ms;
+  int64 neighbors;
+  int64 filtered_neighbors;
+  int64 accepted_neighbors;
+  int64 branches;
+  int64 failures;
+  // (time in ms, cost) of each solution found.
+  std::vector<std::pair<int64, int64> > cost_curve;
+};
+
+// Returns the scaled Euclidean distance between two nodes.
+int64 Travel(const RoutingInstance* const instance,
+             RoutingModel::NodeIndex from, RoutingModel::NodeIndex to) {
+  const int xd = instance->coords[from.value()].first -
+                 instance->coords[to.value()].first;
+  const int yd = instance->coords[from.value()].second -
+                 instance->coords[to.value()].second;
+  return static_cast<int64>(kScalingFactor * sqrt(1.0L * xd * xd + yd * yd));
+}
+
+// Returns the scaled service time at 'from' plus the distance to 'to'.
+int64 TravelPlusServiceTime(const RoutingInstance* const instance,
+                            RoutingModel::NodeIndex from,
+                            RoutingModel::NodeIndex to) {
+  return kScalingFactor * instance->service_times[from.value()] +
+         Travel(instance, from, to);
+}
+
+int64 Demand(const RoutingInstance* const instance,
+             RoutingModel::NodeIndex from, RoutingModel::NodeIndex to) {
+  return instance->demands[from.value()];
+}
+
+namespace {
+// Parses a whitespace-separated list of integers. Returns true iff the input
+// std::string was entirely valid and parsed.
+bool SafeParseInt64Array(const std::string& str,
+                         std::vector<int64>* parsed_int) {
+  static const char kWhiteSpaces[] = " \t\n\v\f\r";
+  std::vector<std::string> items = strings::Split(
+      str, strings::delimiter::AnyOf(kWhiteSpaces), strings::SkipEmpty());
+  parsed_int->assign(items.size(), 0);
+  for (int i = 0; i < items.size(); ++i) {
+    const char* item = items[i].c_str();
+    char* endptr = NULL;
+    (*parsed_int)[i] = strto64(item, &endptr, 10);
+    // The whole item should have been consumed.
+    if (*endptr != '\0') return false;
+  }
+  return true;
+}
+
+// Adds a node to 'instance'.
+void AddNode(int x, int y, int64 demand, int64 open_time, int64 close_time,
+             int64 service_time, RoutingInstance* instance) {
+  instance->coords.push_back(std::make_pair(x, y));
+  instance->demands.push_back(demand);
+  instance->open_times.push_back(open_time);
+  instance->close_times.push_back(close_time);
+  instance->service_times.push_back(service_time);
+}
+
+// Reads an instance in the Solomon format: a name, a vehicle section with the
+// number of vehicles and their capacity, then a line per customer with its id,
+// coordinates, demand, time window and service time.
+bool LoadSolomonInstance(const std::vector<std::string>& lines,
+                         RoutingInstance* instance) {
+  std::vector<int64> parsed_int;
+  bool vehicles_read = false;
+  for (int line_index = 1; line_index < lines.size(); ++line_index) {
+    if (!SafeParseInt64Array(lines[line_index], &parsed_int) ||
+        parsed_int.empty()) {
+      continue;
+    }
+    if (!vehicles_read) {
+      if (parsed_int.size() != 2) return false;
+      instance->num_vehicles = parsed_int[0];
+      instance->capacity = parsed_int[1];
+      vehicles_read = true;
+    } else {
+      if (parsed_int.size() != 7 || parsed_int[0] != instance->coords.size()) {
+        LOG(WARNING) << "Malformed line #" << line_index << ": "
+                     << lines[line_index];
+        return false;
+      }
+      AddNode(parsed_int[1], parsed_int[2], parsed_int[3], parsed_int[4],
+              parsed_int[5], parsed_int[6], instance);
+    }
+  }
+  return !instance->coords.empty();
+}
+
+// Reads an instance in the format defined by Li & Lim: a header with the
+// number of vehicles, their capacity and speed, then a line per node with its
+// id, coordinates, demand, time window, service time and the ids of its
+// pickup and delivery siblings.
+bool LoadLiLimInstance(const std::vector<std::string>& lines,
+                       RoutingInstance* instance) {
+  std::vector<int64> parsed_int;
+  CHECK(SafeParseInt64Array(lines[0], &parsed_int));
+  instance->num_vehicles = parsed_int[0];
+  instance->capacity = parsed_int[1];
+  for (int line_index = 1; line_index < lines.size(); ++line_index) {
+    if (!SafeParseInt64Array(lines[line_index], &parsed_int) ||
+        parsed_int.size() != 9 || parsed_int[0] != instance->coords.size()) {
+      LOG(WARNING) << "Malformed line #" << line_index << ": "
+                   << lines[line_index];
+      return false;
+    }
+    const int64 delivery = parsed_int[8];
+    AddNode(parsed_int[1], parsed_int[2],
+            delivery == 0 ? -parsed_int[3] : parsed_int[3], parsed_int[4],
+            parsed_int[5], parsed_int[6], instance);
+    if (parsed_int[7] == 0 && delivery != 0) {
+      instance->pairs.push_back(std::make_pair(instance->coords.size() - 1,
+                                               delivery));
+    }
+  }
+  return !instance->coords.empty();
+}
+}  // namespace
+
+bool LoadInstance(const std::string& file_name, RoutingInstance* instance) {
+  std::string contents;
+  if (!file::GetContents(file_name, &contents, file::Defaults()).ok()) {
+    LOG(WARNING) << "Cannot read " << file_name;
+    return false;
+  }
+  const std::vector<std::string> lines =
+      strings::Split(contents, "\n", strings::SkipEmpty());
+  if (lines.empty()) {
+    LOG(WARNING) << "Empty file: " << file_name;
+    return false;
+  }
+  instance->name = file_name;
+  // Li & Lim instances start with three integers, Solomon instances with the
+  // name of the instance.
+  std::vector<int64> header;
+  if (SafeParseInt64Array(lines[0], &header) && header.size() == 3) {
+    return LoadLiLimInstance(lines, instance);
+  }
+  return LoadSolomonInstance(lines, instance);
+}
+
+// Records the time and the cost of each solution found.
+class CostCurveMonitor : public SearchMonitor {
+ public:
+  CostCurveMonitor(const RoutingModel& routing, int64 start_time_ms,
+                   std::vector<std::pair<int64, int64> >* curve)
+      : SearchMonitor(routing.solver()),
+        routing_(routing),
+        start_time_ms_(start_time_ms),
+        curve_(curve) {}
+  virtual ~CostCurveMonitor() {}
+  virtual bool AtSolution() {
+    curve_->push_back(
+        std::make_pair(solver()->wall_time() - start_time_ms_,
+                       routing_.CostVar()->Value()));
+    return false;
+  }
+
+ private:
+  const RoutingModel& routing_;
+  const int64 start_time_ms_;
+  std::vector<std::pair<int64, int64> >* const curve_;
+};
+
+// Builds the model of 'instance' and solves it using the given strategies.
+void SolveInstance(const RoutingInstance& instance,
+                   RoutingModel::RoutingStrategy first_solution,
+                   RoutingModel::RoutingMetaheuristic metaheuristic,
+                   RoutingBenchmarkResult* result) {
+  const int num_nodes = instance.coords.size();
+  RoutingModel routing(num_nodes, instance.num_vehicles);
+  routing.SetDepot(RoutingModel::NodeIndex(0));
+  routing.SetArcCostEvaluatorOfAllVehicles(
+      NewPermanentCallback(&Travel, &instance));
+  routing.AddDimension(NewPermanentCallback(&Demand, &instance), 0,
+                       instance.capacity, /*fix_start_cumul_to_zero=*/true,
+                       "demand");
+  int64 horizon = 0;
+  for (const int64 close_time : instance.close_times) {
+    horizon = std::max(horizon, close_time);
+  }
+  routing.AddDimension(
+      NewPermanentCallback(&TravelPlusServiceTime, &instance),
+      kScalingFactor * horizon, kScalingFactor * horizon,
+      /*fix_start_cumul_to_zero=*/true, "time");
+  const RoutingDimension& time_dimension = routing.GetDimensionOrDie("time");
+  Solver* const solver = routing.solver();
+  for (const std::pair<int, int> pair : instance.pairs) {
+    const RoutingModel::NodeIndex pickup(pair.first);
+    const RoutingModel::NodeIndex delivery(pair.second);
+    const int64 pickup_index = routing.NodeToIndex(pickup);
+    const int64 delivery_index = routing.NodeToIndex(delivery);
+    solver->AddConstraint(solver->MakeEquality(
+        routing.VehicleVar(pickup_index), routing.VehicleVar(delivery_index)));
+    solver->AddConstraint(
+        solver->MakeLessOrEqual(time_dimension.CumulVar(pickup_index),
+                                time_dimension.CumulVar(delivery_index)));
+    routing.AddPickupAndDelivery(pickup, delivery);
+  }
+  for (RoutingModel::NodeIndex node(0); node < num_nodes; ++node) {
+    const int64 index = routing.NodeToIndex(node);
+    IntVar* const cumul = time_dimension.CumulVar(index);
+    cumul->SetMin(kScalingFactor * instance.open_times[node.value()]);
+    cumul->SetMax(kScalingFactor * instance.close_times[node.value()]);
+    if (node != 0) {
+      std::vector<RoutingModel::NodeIndex> orders(1, node);
+      routing.AddDisjunction(orders, kPenalty);
+    }
+  }
+  routing.set_first_solution_strategy(first_solution);
+  routing.set_metaheuristic(metaheuristic);
+  routing.UpdateTimeLimit(FLAGS_routing_benchmark_time_limit_ms);
+  solver->ReSeed(result->seed);
+  const int64 start_time_ms = solver->wall_time();
+  routing.AddSearchMonitor(solver->RevAlloc(
+      new CostCurveMonitor(routing, start_time_ms, &result->cost_curve)));
+
+  const Assignment* const solution = routing.Solve();
+  result->time_ms = solver->wall_time() - start_time_ms;
+  result->solved = solution != nullptr;
+  result->cost = result->solved ? solution->ObjectiveValue() : -1;
+  result->unperformed = 0;
+  if (result->solved) {
+    for (int index = 0; index < routing.Size(); ++index) {
+      if (solution->Value(routing.NextVar(index)) == index) {
+        ++result->unperformed;
+      }
+    }
+  }
+  result->neighbors = solver->neighbors();
+  result->filtered_neighbors = solver->filtered_neighbors();
+  result->accepted_neighbors = solver->accepted_neighbors();
+  result->branches = solver->branches();
+  result->failures = solver->failures();
+}
+
+std::string ResultsToCsv(const std::vector<RoutingBenchmarkResult>& results) {
+  std::string output =
+      "instance,first_solution,metaheuristic,seed,time_limit_ms,solved,cost,"
+      "unperformed,time_ms,neighbors,filtered_neighbors,accepted_neighbors,"
+      "branches,failures,cost_curve\n";
+  for (const RoutingBenchmarkResult& result : results) {
+    StringAppendF(&output,
+                  "%s,%s,%s,%d,%lld,%d,%lld,%d,%lld,%lld,%lld,%lld,%lld,%lld,",
+                  result.instance.c_str(), result.first_solution.c_str(),
+                  result.metaheuristic.c_str(), result.seed,
+                  FLAGS_routing_benchmark_time_limit_ms, result.solved,
+                  result.cost, result.unperformed, result.time_ms,
+                  result.neighbors, result.filtered_neighbors,
+                  result.accepted_neighbors, result.branches, result.failures);
+    // The curve is a space-separated list of time:cost points.
+    for (int i = 0; i < result.cost_curve.size(); ++i) {
+      StringAppendF(&output, "%s%lld:%lld", i == 0 ? "" : " ",
+                    result.cost_curve[i].first, result.cost_curve[i].second);
+    }
+    output += "\n";
+  }
+  return output;
+}
+
+std::string ResultsToJson(const std::vector<RoutingBenchmarkResult>& results) {
+  std::string output = "[\n";
+  for (int r = 0; r < results.size(); ++r) {
+    const RoutingBenchmarkResult& result = results[r];
+    StringAppendF(
+        &output,
+        "  {\"instance\": \"%s\", \"first_solution\": \"%s\", "
+        "\"metaheuristic\": \"%s\", \"seed\": %d, \"time_limit_ms\": %lld, "
+        "\"solved\": %s, \"cost\": %lld, \"unperformed\": %d, "
+        "\"time_ms\": %lld, \"neighbors\": %lld, "
+        "\"filtered_neighbors\": %lld, \"accepted_neighbors\": %lld, "
+        "\"branches\": %lld, \"failures\": %lld, \"cost_curve\": [",
+        result.instance.c_str(), result.first_solution.c_str(),
+        result.metaheuristic.c_str(), result.seed,
+        FLAGS_routing_benchmark_time_limit_ms,
+        result.solved ? "true" : "false", result.cost, result.unperformed,
+        result.time_ms, result.neighbors, result.filtered_neighbors,
+        result.accepted_neighbors, result.branches, result.failures);
+    for (int i = 0; i < result.cost_curve.size(); ++i) {
+      StringAppendF(&output, "%s[%lld, %lld]", i == 0 ? "" : ", ",
+                    result.cost_curve[i].first, result.cost_curve[i].second);
+    }
+    StringAppendF(&output, "]}%s\n", r + 1 < results.size() ? "," : "");
+  }
+  output += "]\n";
+  return output;
+}
+
+// Runs the benchmark suite defined by the flags; returns false if the flags
+// are invalid.
+bool RunBenchmark() {
+  const std::vector<std::string> instance_files = strings::Split(
+      FLAGS_routing_benchmark_instances, ",", strings::SkipEmpty());
+  const std::vector<std::string> first_solutions = strings::Split(
+      FLAGS_routing_benchmark_first_solutions, ",", strings::SkipEmpty());
+  const std::vector<std::string> metaheuristics = strings::Split(
+      FLAGS_routing_benchmark_metaheuristics, ",", strings::SkipEmpty());
+  std::vector<int> seeds;
+  for (const std::string& seed :
+       strings::Split(FLAGS_routing_benchmark_seeds, ",",
+                      strings::SkipEmpty())) {
+    seeds.push_back(atoi32(seed));
+  }
+  if (instance_files.empty()) {
+    LOG(WARNING) << "No instance given.";
+    return false;
+  }
+  for (const std::string& first_solution : first_solutions) {
+    RoutingModel::RoutingStrategy strategy;
+    if (!RoutingModel::ParseRoutingStrategy(first_solution, &strategy)) {
+      LOG(WARNING) << "Unknown first solution strategy: " << first_solution;
+      return false;
+    }
+  }
+  for (const std::string& metaheuristic : metaheuristics) {
+    RoutingModel::RoutingMetaheuristic parsed_metaheuristic;
+    if (!RoutingModel::ParseRoutingMetaheuristic(metaheuristic,
+                                                 &parsed_metaheuristic)) {
+      LOG(WARNING) << "Unknown metaheuristic: " << metaheuristic;
+      return false;
+    }
+  }
+  if (FLAGS_routing_benchmark_format != "csv" &&
+      FLAGS_routing_benchmark_format != "json") {
+    LOG(WARNING) << "Unknown format: " << FLAGS_routing_benchmark_format;
+    return false;
+  }
+
+  std::vector<RoutingBenchmarkResult> results;
+  for (const std::string& instance_file : instance_files) {
+    RoutingInstance instance;
+    if (!LoadInstance(instance_file, &instance)) {
+      LOG(WARNING) << "Skipping " << instance_file;
+      continue;
+    }
+    for (const std::string& first_solution : first_solutions) {
+      for (const std::string& metaheuristic : metaheuristics) {
+        for (const int seed : seeds) {
+          RoutingModel::RoutingStrategy strategy;
+          RoutingModel::ParseRoutingStrategy(first_solution, &strategy);
+          RoutingModel::RoutingMetaheuristic parsed_metaheuristic;
+          RoutingModel::ParseRoutingMetaheuristic(metaheuristic,
+                                                  &parsed_metaheuristic);
+          RoutingBenchmarkResult result;
+          result.instance = instance.name;
+          result.first_solution = first_solution;
+          result.metaheuristic = metaheuristic;
+          result.seed = seed;
+          SolveInstance(instance, strategy, parsed_metaheuristic, &result);
+          LOG(INFO) << instance.name << " " << first_solution << " "
+                    << metaheuristic << " seed " << seed << ": cost "
+                    << result.cost << " in " << result.time_ms << "ms";
+          results.push_back(result);
+        }
+      }
+    }
+  }
+  const std::string output = FLAGS_routing_benchmark_format == "json"
+                                 ? ResultsToJson(results)
+                                 : ResultsToCsv(results);
+  if (FLAGS_routing_benchmark_output.empty()) {
+    printf("%s", output.c_str());
+  } else {
+    CHECK(file::SetContents(FLAGS_routing_benchmark_output, output,
+                            file::Defaults()).ok());
+  }
+  return true;
+}
+
+}  // namespace operations_research
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags( &argc, &argv, true);
+  if (!operations_research::RunBenchmark()) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,275 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Batch benchmark runner for the SAT solver, in the spirit of the SAT
+// competitions. Every instance is solved once for each combination of
+// parameter preset and number of search workers, with the same time limit.
+// One CSV line is printed per run, followed by a summary per configuration
+// with the number of solved instances and the PAR-2 score: the average over
+// all instances of the solve time, where unsolved instances count for twice
+// the time limit.
+//
+// Example:
+//   sat_benchmark --sat_benchmark_instance_list=instances.txt
+//                 --sat_benchmark_presets=default,vmtf
+//                 --sat_benchmark_num_workers=1,4
+//                 --sat_benchmark_time_limit=60
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/commandlineflags.h"
+#include "base/commandlineflags.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/sysinfo.h"
+#include "base/timer.h"
+#include "base/file.h"
+#include "google/protobuf/text_format.h"
+#include "base/split.h"
+#include "base/strutil.h"
+#include "cpp/opb_reader.h"
+#include "cpp/sat_cnf_reader.h"
+#include "sat/boolean_problem.h"
+#include "sat/optimization.h"
+#include "sat/sat_portfolio.h"
+#include "sat/sat_solver.h"
+
+DEFINE_string(sat_benchmark_instances, "",
+              "Comma-separated list of instances to run. Supported formats "
+              "are .cnf, .wcnf, .opb and the LinearBooleanProblem proto.");
+DEFINE_string(sat_benchmark_instance_list, "",
+              "File listing one instance per line, typically the output of "
+              "'ls dir/*.cnf'. Empty lines and lines starting with '#' are "
+              "ignored. Added to --sat_benchmark_instances.");
+DEFINE_string(sat_benchmark_presets, "default",
+              "Comma-separated list of parameter presets to run. Possible "
+              "values are default, vmtf, vmtf_switch, rephasing, luby and "
+              "no_minimization.");
+DEFINE_string(sat_benchmark_num_workers, "1",
+              "Comma-separated list of num_search_workers values to run each "
+              "preset with.");
+DEFINE_double(sat_benchmark_time_limit, 60.0,
+              "Time limit in seconds of each run. Unsolved instances count "
+              "for twice this value in the PAR-2 score.");
+DEFINE_string(sat_benchmark_params, "",
+              "SatParameters in text format merged on top of every preset.");
+
+namespace operations_research {
+namespace sat {
+namespace {
+
+using operations_research::strings::Split;
+using operations_research::strings::SkipEmpty;
+
+// Returns the text format SatParameters of the given preset, or false if the
+// preset is unknown.
+bool GetPresetParameters(const std::string& preset, std::string* text) {
+  if (preset == "default") {
+    *text = "";
+  } else if (preset == "vmtf") {
+    *text = "variable_ordering_algorithm: VMTF";
+  } else if (preset == "vmtf_switch") {
+    *text = "variable_ordering_switch_period: 10000";
+  } else if (preset == "rephasing") {
+    *text = "local_search_rephasing_period_in_conflicts: 10000";
+  } else if (preset == "luby") {
+    *text = "restart_algorithm: LUBY_RESTART";
+  } else if (preset == "no_minimization") {
+    *text = "minimization_algorithm: NONE";
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void LoadInstance(const std::string& filename, LinearBooleanProblem* problem) {
+  if (HasSuffixString(filename, ".opb") ||
+      HasSuffixString(filename, ".opb.bz2")) {
+    OpbReader reader;
+    if (!reader.Load(filename, problem)) {
+      LOG(FATAL) << "Cannot load file '" << filename << "'.";
+    }
+  } else if (HasSuffixString(filename, ".cnf") ||
+             HasSuffixString(filename, ".cnf.gz") ||
+             HasSuffixString(filename, ".wcnf") ||
+             HasSuffixString(filename, ".wcnf.gz")) {
+    SatCnfReader reader;
+    reader.InterpretCnfAsMaxSat(HasSuffixString(filename, ".wcnf") ||
+                                HasSuffixString(filename, ".wcnf.gz"));
+    if (!reader.Load(filename, problem)) {
+      LOG(FATAL) << "Cannot load file '" << filename << "'.";
+    }
+  } else {
+    file::ReadFileToProtoOrDie(filename, problem);
+  }
+}
+
+std::vector<std::string> GetInstances() {
+  std::vector<std::string> instances =
+      Split(FLAGS_sat_benchmark_instances, ",", SkipEmpty());
+  if (!FLAGS_sat_benchmark_instance_list.empty()) {
+    std::string contents;
+    CHECK(file::GetContents(FLAGS_sat_benchmark_instance_list, &contents,
+                            file::Defaults()).ok())
+        << "Cannot read " << FLAGS_sat_benchmark_instance_list;
+    for (const std::string& line : Split(contents, "\r\n", SkipEmpty())) {
+      if (line[0] == '#') continue;
+      instances.push_back(line);
+    }
+  }
+  return instances;
+}
+
+struct RunResult {
+  SatSolver::Status status;
+  double time;
+  int64 conflicts;
+  int64 propagations;
+  int64 memory;
+};
+
+// Solves the given problem with the given parameters. A problem with an
+// objective is solved to optimality with the core-based algorithm, always
+// with a single worker; a decision problem uses a portfolio if
+// num_search_workers() > 1, in which case the statistics are the ones of the
+// winning worker.
+RunResult SolveInstance(const LinearBooleanProblem& problem,
+                        const SatParameters& parameters) {
+  RunResult run;
+  WallTimer timer;
+  timer.Start();
+  std::unique_ptr<SatSolver> solver(new SatSolver());
+  solver->SetParameters(parameters);
+  if (problem.objective().literals_size() > 0) {
+    std::vector<bool> solution;
+    run.status = LoadBooleanProblem(problem, solver.get())
+                     ? SolveWithCardinalityEncodingAndCore(
+                           DEFAULT_LOG, problem, solver.get(), &solution)
+                     : SatSolver::MODEL_UNSAT;
+  } else if (parameters.num_search_workers() > 1) {
+    SatPortfolioSolver portfolio(parameters);
+    bool loaded = true;
+    for (int i = 0; i < portfolio.NumWorkers(); ++i) {
+      loaded &= LoadBooleanProblem(problem, portfolio.MutableWorker(i));
+    }
+    if (loaded) {
+      run.status = portfolio.Solve();
+      solver = portfolio.ReleaseWinner();
+    } else {
+      run.status = SatSolver::MODEL_UNSAT;
+    }
+  } else {
+    run.status = LoadBooleanProblem(problem, solver.get())
+                     ? solver->Solve()
+                     : SatSolver::MODEL_UNSAT;
+  }
+  run.time = timer.Get();
+  run.conflicts = solver->num_failures();
+  run.propagations = solver->num_propagations();
+
+  // Sampled while the solver is still alive, this is a good approximation of
+  // the peak memory usage of the run.
+  run.memory = GetProcessMemoryUsage();
+  return run;
+}
+
+bool IsSolved(SatSolver::Status status) {
+  return status == SatSolver::MODEL_SAT || status == SatSolver::MODEL_UNSAT;
+}
+
+int Run() {
+  const std::vector<std::string> instances = GetInstances();
+  if (instances.empty()) {
+    LOG(FATAL) << "Please supply instances with --sat_benchmark_instances= or "
+               << "--sat_benchmark_instance_list=";
+  }
+  const std::vector<std::string> presets =
+      Split(FLAGS_sat_benchmark_presets, ",", SkipEmpty());
+  std::vector<int> num_workers;
+  for (const std::string& value :
+       Split(FLAGS_sat_benchmark_num_workers, ",", SkipEmpty())) {
+    num_workers.push_back(std::max(1, atoi(value.c_str())));
+  }
+  const double time_limit = FLAGS_sat_benchmark_time_limit;
+
+  // The configurations, in the order of the summary.
+  std::vector<std::string> config_names;
+  std::vector<SatParameters> config_parameters;
+  for (const std::string& preset : presets) {
+    std::string text;
+    if (!GetPresetParameters(preset, &text)) {
+      LOG(FATAL) << "Unknown preset '" << preset << "'.";
+    }
+    for (const int workers : num_workers) {
+      SatParameters parameters;
+      CHECK(google::protobuf::TextFormat::MergeFromString(text, &parameters));
+      CHECK(google::protobuf::TextFormat::MergeFromString(
+          FLAGS_sat_benchmark_params, &parameters))
+          << FLAGS_sat_benchmark_params;
+      parameters.set_num_search_workers(workers);
+      parameters.set_max_time_in_seconds(time_limit);
+      config_names.push_back(StringPrintf("%s,%d", preset.c_str(), workers));
+      config_parameters.push_back(parameters);
+    }
+  }
+
+  const int num_configs = config_names.size();
+  std::vector<int> num_solved(num_configs, 0);
+  std::vector<double> par2(num_configs, 0.0);
+  printf("instance,preset,workers,status,time,conflicts,conflicts_per_s,"
+         "propagations_per_s,memory_mb\n");
+  for (const std::string& instance : instances) {
+    // Each instance is loaded once and then solved from scratch by every
+    // configuration.
+    LinearBooleanProblem problem;
+    LoadInstance(instance, &problem);
+    for (int c = 0; c < num_configs; ++c) {
+      const RunResult run = SolveInstance(problem, config_parameters[c]);
+      const bool solved = IsSolved(run.status) && run.time <= time_limit;
+      if (solved) ++num_solved[c];
+      par2[c] += solved ? run.time : 2.0 * time_limit;
+      const double seconds = std::max(run.time, 1e-6);
+      printf("%s,%s,%s,%.3f,%lld,%.0f,%.0f,%.1f\n", instance.c_str(),
+             config_names[c].c_str(), SatStatusString(run.status).c_str(),
+             run.time, run.conflicts, run.conflicts / seconds,
+             run.propagations / seconds, run.memory / 1048576.0);
+      fflush(stdout);
+    }
+  }
+
+  printf("\npreset,workers,solved,instances,par2\n");
+  for (int c = 0; c < num_configs; ++c) {
+    printf("%s,%d,%d,%.3f\n", config_names[c].c_str(), num_solved[c],
+           static_cast<int>(instances.size()), par2[c] / instances.size());
+  }
+  return EXIT_SUCCESS;
+}
+
+}  // namespace
+}  // namespace sat
+}  // namespace operations_research
+
+static const char kUsage[] =
+    "Usage: see flags.\n"
+    "This program runs the SAT solver on a set of instances with several "
+    "parameter presets and reports competition-style PAR-2 scores.";
+
+int main(int argc, char** argv) {
+  google::SetUsageMessage(kUsage);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  return operations_research::sat::Run();
+}
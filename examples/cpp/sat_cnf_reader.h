@@ -14,6 +14,15 @@
 #ifndef OR_TOOLS_SAT_SAT_CNF_READER_H_
 #define OR_TOOLS_SAT_SAT_CNF_READER_H_
 
+#if defined(__GNUC__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define HAVE_MMAP
+#endif
+
+#include <cstring>
 #include <map>
 #include <string>
 #include <vector>
@@ -23,6 +32,7 @@
 #include "base/logging.h"
 #include "base/strtoint.h"
 #include "base/split.h"
+#include "base/strutil.h"
 #include "sat/boolean_problem.pb.h"
 #include "util/filelineiter.h"
 
@@ -60,13 +70,23 @@ class SatCnfReader {
     num_slack_variables_ = 0;
     num_slack_binary_clauses_ = 0;
 
-    int num_lines = 0;
-    for (const std::string& line : FileLines(filename)) {
-      ++num_lines;
-      ProcessNewLine(line, problem);
+    // Uncompressed files are parsed directly from memory, which is a lot
+    // faster than going through FileLines() on large files.
+    bool loaded = false;
+#ifdef HAVE_MMAP
+    if (!HasSuffixString(filename, ".gz")) {
+      loaded = LoadMappedFile(filename, problem);
     }
-    if (num_lines == 0) {
-      LOG(FATAL) << "File '" << filename << "' is empty or can't be read.";
+#endif
+    if (!loaded) {
+      int num_lines = 0;
+      for (const std::string& line : FileLines(filename)) {
+        ++num_lines;
+        ProcessNewLine(line, problem);
+      }
+      if (num_lines == 0) {
+        LOG(FATAL) << "File '" << filename << "' is empty or can't be read.";
+      }
     }
     problem->set_original_num_variables(num_variables_);
     problem->set_num_variables(num_variables_ + num_slack_variables_);
@@ -134,83 +154,169 @@ class SatCnfReader {
     } else {
       // In the cnf file format, the last words should always be 0.
       DCHECK_EQ("0", words_.back());
-      const int size = words_.size() - 1;
-      const int reserved_size =
-          (!is_wcnf_ && interpret_cnf_as_max_sat_) ? size + 1 : size;
-
-      LinearBooleanConstraint* constraint = problem->add_constraints();
-      constraint->mutable_literals()->Reserve(reserved_size);
-      constraint->mutable_coefficients()->Reserve(reserved_size);
-      constraint->set_lower_bound(1);
-
-      int64 weight =
-          (!is_wcnf_ && interpret_cnf_as_max_sat_) ? 1 : hard_weight_;
-      for (int i = 0; i < size; ++i) {
-        const int64 signed_value = StringPieceAtoi(words_[i]);
-        if (i == 0 && is_wcnf_) {
-          // Mathematically, a soft clause of weight 0 can be removed.
-          if (signed_value == 0) {
-            ++num_skipped_soft_clauses_;
-            problem->mutable_constraints()->RemoveLast();
-            break;
-          }
-          weight = signed_value;
-        } else {
-          DCHECK_NE(signed_value, 0);
-          constraint->add_literals(signed_value);
-          constraint->add_coefficients(1);
-        }
+      values_.clear();
+      for (int i = 0; i + 1 < words_.size(); ++i) {
+        values_.push_back(StringPieceAtoi(words_[i]));
       }
-      if (weight != hard_weight_) {
-        if (constraint->literals_size() == 1) {
-          // The max-sat formulation of an optimization sat problem with a
-          // linear objective introduces many singleton soft clauses. Because we
-          // natively work with a linear objective, we can just put the cost on
-          // the unique variable of such clause and remove the clause.
-          ++num_singleton_soft_clauses_;
-          const int literal = -constraint->literals(0);
-          if (literal > 0) {
-            positive_literal_to_weight_[literal] += weight;
-          } else {
-            positive_literal_to_weight_[-literal] -= weight;
-            objective_offset_ += weight;
-          }
+      ProcessClause(values_, problem);
+    }
+  }
+
+#ifdef HAVE_MMAP
+  // Maps the given file in memory and parses it without splitting it into
+  // lines. Returns false if the file couldn't be mapped, in which case nothing
+  // was loaded. Note that contrary to ProcessNewLine(), a clause can span many
+  // lines here.
+  bool LoadMappedFile(const std::string& filename,
+                      LinearBooleanProblem* problem) {
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    struct stat sbuf;
+    if (fstat(fd, &sbuf) == -1) {
+      close(fd);
+      return false;
+    }
+    if (sbuf.st_size == 0) {
+      LOG(FATAL) << "File '" << filename << "' is empty or can't be read.";
+    }
+    void* const data =
+        mmap(nullptr, sbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    madvise(data, sbuf.st_size, MADV_SEQUENTIAL);
+    ParseBuffer(static_cast<const char*>(data), sbuf.st_size, problem);
+    munmap(data, sbuf.st_size);
+    return true;
+  }
+#endif  // HAVE_MMAP
+
+  void ParseBuffer(const char* data, int64 size,
+                   LinearBooleanProblem* problem) {
+    const char* current = data;
+    const char* const end = data + size;
+    values_.clear();
+    while (current < end) {
+      const char c = *current;
+      if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        ++current;
+        continue;
+      }
+
+      // The comments, the header and the end marker take a full line.
+      if (c == 'c' || c == 'p' || c == '%') {
+        const char* eol = static_cast<const char*>(
+            memchr(current, '\n', end - current));
+        if (eol == nullptr) eol = end;
+        if (c == 'p') ProcessNewLine(std::string(current, eol), problem);
+        if (c == '%') break;
+        current = eol;
+        continue;
+      }
+
+      // Parses an integer.
+      const bool is_negative = (c == '-');
+      if (is_negative) ++current;
+      if (current == end || *current < '0' || *current > '9') {
+        LOG(FATAL) << "Unexpected character in the cnf file: '" << c << "'";
+      }
+      int64 value = 0;
+      while (current < end && *current >= '0' && *current <= '9') {
+        value = 10 * value + (*current - '0');
+        ++current;
+      }
+      if (is_negative) value = -value;
+
+      // A zero ends the current clause, except if it is the weight of a wcnf
+      // soft clause.
+      if (value == 0 && !(is_wcnf_ && values_.empty())) {
+        ProcessClause(values_, problem);
+        values_.clear();
+      } else {
+        values_.push_back(value);
+      }
+    }
+  }
+
+  // Processes one clause given by its literals, without the final 0. For the
+  // wcnf format, the first value is the weight of the clause.
+  void ProcessClause(const std::vector<int64>& values,
+                     LinearBooleanProblem* problem) {
+    const int size = values.size();
+    const int reserved_size =
+        (!is_wcnf_ && interpret_cnf_as_max_sat_) ? size + 1 : size;
+
+    LinearBooleanConstraint* constraint = problem->add_constraints();
+    constraint->mutable_literals()->Reserve(reserved_size);
+    constraint->mutable_coefficients()->Reserve(reserved_size);
+    constraint->set_lower_bound(1);
+
+    int64 weight =
+        (!is_wcnf_ && interpret_cnf_as_max_sat_) ? 1 : hard_weight_;
+    for (int i = 0; i < size; ++i) {
+      const int64 signed_value = values[i];
+      if (i == 0 && is_wcnf_) {
+        // Mathematically, a soft clause of weight 0 can be removed.
+        if (signed_value == 0) {
+          ++num_skipped_soft_clauses_;
           problem->mutable_constraints()->RemoveLast();
+          break;
+        }
+        weight = signed_value;
+      } else {
+        DCHECK_NE(signed_value, 0);
+        constraint->add_literals(signed_value);
+        constraint->add_coefficients(1);
+      }
+    }
+    if (weight != hard_weight_) {
+      if (constraint->literals_size() == 1) {
+        // The max-sat formulation of an optimization sat problem with a
+        // linear objective introduces many singleton soft clauses. Because we
+        // natively work with a linear objective, we can just put the cost on
+        // the unique variable of such clause and remove the clause.
+        ++num_singleton_soft_clauses_;
+        const int literal = -constraint->literals(0);
+        if (literal > 0) {
+          positive_literal_to_weight_[literal] += weight;
         } else {
-          // The +1 is because a positive literal is the same as the 1-based
-          // variable index.
-          const int slack_literal = num_variables_ + num_slack_variables_ + 1;
-          ++num_slack_variables_;
-          constraint->add_literals(slack_literal);
-          constraint->add_coefficients(1);
-          DCHECK_EQ(constraint->literals_size(), reserved_size);
-
-          if (slack_literal > 0) {
-            positive_literal_to_weight_[slack_literal] += weight;
-          } else {
-            positive_literal_to_weight_[-slack_literal] -= weight;
-            objective_offset_ += weight;
-          }
+          positive_literal_to_weight_[-literal] -= weight;
+          objective_offset_ += weight;
+        }
+        problem->mutable_constraints()->RemoveLast();
+      } else {
+        // The +1 is because a positive literal is the same as the 1-based
+        // variable index.
+        const int slack_literal = num_variables_ + num_slack_variables_ + 1;
+        ++num_slack_variables_;
+        constraint->add_literals(slack_literal);
+        constraint->add_coefficients(1);
+        DCHECK_EQ(constraint->literals_size(), reserved_size);
 
-          if (FLAGS_wcnf_use_strong_slack) {
-            // Add the binary implications slack_literal true => all the other
-            // clause literals are false.
-            for (int i = 0; i + 1 < constraint->literals_size(); ++i) {
-              LinearBooleanConstraint* bc = problem->add_constraints();
-              bc->set_lower_bound(1);
-              bc->add_literals(-slack_literal);
-              bc->add_literals(-constraint->literals(i));
-              bc->add_coefficients(1);
-              bc->add_coefficients(1);
-              ++num_slack_binary_clauses_;
-            }
+        if (slack_literal > 0) {
+          positive_literal_to_weight_[slack_literal] += weight;
+        } else {
+          positive_literal_to_weight_[-slack_literal] -= weight;
+          objective_offset_ += weight;
+        }
+
+        if (FLAGS_wcnf_use_strong_slack) {
+          // Add the binary implications slack_literal true => all the other
+          // clause literals are false.
+          for (int i = 0; i + 1 < constraint->literals_size(); ++i) {
+            LinearBooleanConstraint* bc = problem->add_constraints();
+            bc->set_lower_bound(1);
+            bc->add_literals(-slack_literal);
+            bc->add_literals(-constraint->literals(i));
+            bc->add_coefficients(1);
+            bc->add_coefficients(1);
+            ++num_slack_binary_clauses_;
           }
         }
-      } else {
-        // If wcnf is true, we currently reserve one more literals than needed
-        // for the hard clauses.
-        DCHECK_EQ(constraint->literals_size(), is_wcnf_ ? size - 1 : size);
       }
+    } else {
+      // If wcnf is true, we currently reserve one more literals than needed
+      // for the hard clauses.
+      DCHECK_EQ(constraint->literals_size(), is_wcnf_ ? size - 1 : size);
     }
   }
 
@@ -219,8 +325,9 @@ class SatCnfReader {
   int num_clauses_;
   int num_variables_;
 
-  // Temporary storage for ProcessNewLine().
+  // Temporary storage for ProcessNewLine() and ParseBuffer().
   std::vector<StringPiece> words_;
+  std::vector<int64> values_;
 
   // We stores the objective in a map because we want the variables to appear
   // only once in the LinearObjective proto.
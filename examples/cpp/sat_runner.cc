@@ -30,7 +30,9 @@
 #include "cpp/sat_cnf_reader.h"
 #include "base/random.h"
 #include "sat/boolean_problem.h"
+#include "sat/drat_writer.h"
 #include "sat/optimization.h"
+#include "sat/sat_portfolio.h"
 #include "sat/sat_solver.h"
 #include "sat/simplification.h"
 #include "util/time_limit.h"
@@ -105,6 +107,14 @@ DEFINE_bool(presolve, false,
 DEFINE_bool(probing, false, "If true, presolve the problem using probing.");
 
 
+DEFINE_string(drat_output, "",
+              "If non-empty, write a DRAT proof of the problem unsatisfiability "
+              "to this file. This only works for pure SAT problems solved "
+              "without presolve, probing or symmetries.");
+
+DEFINE_bool(drat_binary, false,
+            "If true, use the binary DRAT format for --drat_output.");
+
 DEFINE_bool(refine_core, false,
             "If true, turn on the unsat_proof parameters and if the problem is "
             "UNSAT, refine as much as possible its UNSAT core in order to get "
@@ -188,6 +198,21 @@ int Run() {
   std::unique_ptr<SatSolver> solver(new SatSolver());
   solver->SetParameters(parameters);
 
+  // The proof must see all the clauses, so we need to register it before the
+  // problem is loaded.
+  std::unique_ptr<File> drat_file;
+  std::unique_ptr<DratWriter> drat_writer;
+  if (!FLAGS_drat_output.empty()) {
+    CHECK(!FLAGS_presolve && !FLAGS_probing && !FLAGS_use_symmetry &&
+          !parameters.use_symmetry_detection() && !FLAGS_fu_malik &&
+          !FLAGS_linear_scan && !FLAGS_wpm1 && !FLAGS_qmaxsat &&
+          !FLAGS_core_enc)
+        << "--drat_output only works for the decision version of a problem.";
+    drat_file.reset(File::OpenOrDie(FLAGS_drat_output, "w"));
+    drat_writer.reset(new DratWriter(FLAGS_drat_binary, drat_file.get()));
+    solver->SetDratWriter(drat_writer.get());
+  }
+
   // Read the problem.
   LinearBooleanProblem problem;
   LoadBooleanProblem(FLAGS_input, &problem);
@@ -337,7 +362,27 @@ int Run() {
       return EXIT_SUCCESS;
     }
 
-    result = solver->Solve();
+    if (parameters.num_search_workers() > 1 && !parameters.unsat_proof() &&
+        !FLAGS_use_symmetry && FLAGS_drat_output.empty()) {
+      // Solve with a portfolio of workers, each with its own copy of the
+      // problem. The winner then replaces the solver for the code below.
+      SatPortfolioSolver portfolio(parameters);
+      for (int i = 0; i < portfolio.NumWorkers(); ++i) {
+        SatSolver* worker = portfolio.MutableWorker(i);
+        if (!LoadBooleanProblem(problem, worker) ||
+            !AddObjectiveConstraint(
+                problem, !FLAGS_lower_bound.empty(),
+                Coefficient(atoi64(FLAGS_lower_bound)),
+                !FLAGS_upper_bound.empty(),
+                Coefficient(atoi64(FLAGS_upper_bound)), worker)) {
+          LOG(INFO) << "UNSAT when loading the problem in worker " << i << ".";
+        }
+      }
+      result = portfolio.Solve();
+      solver = portfolio.ReleaseWinner();
+    } else {
+      result = solver->Solve();
+    }
     if (result == SatSolver::MODEL_SAT) {
       ExtractAssignment(problem, *solver, &solution);
       CHECK(IsAssignmentValid(problem, solution));
@@ -429,6 +474,13 @@ int Run() {
     printf("c objective: na\n");
   }
 
+  // Write the end of the proof.
+  if (drat_writer != nullptr) {
+    solver->SetDratWriter(nullptr);
+    drat_writer.reset();
+    CHECK(drat_file->Close());
+  }
+
   // Print final statistics.
   printf("c status: %s\n", SatStatusString(result).c_str());
   printf("c conflicts: %lld\n", solver->num_failures());
@@ -311,6 +311,8 @@ CPBINARIES = \
 	$(BIN_DIR)/network_routing$E \
 	$(BIN_DIR)/nqueens$E \
 	$(BIN_DIR)/pdptw$E \
+	$(BIN_DIR)/propagation_benchmark$E \
+	$(BIN_DIR)/routing_benchmark$E \
 	$(BIN_DIR)/dimacs_assignment$E \
 	$(BIN_DIR)/sports_scheduling$E \
 	$(BIN_DIR)/tsp$E
@@ -382,6 +384,7 @@ clean_cc:
 	-$(DEL) $(BIN_DIR)$Sfz2$E
 	-$(DEL) $(BIN_DIR)$Sparser_main$E
 	-$(DEL) $(BIN_DIR)$Ssat_runner$E
+	-$(DEL) $(BIN_DIR)$Ssat_benchmark$E
 	-$(DEL) $(CPBINARIES)
 	-$(DEL) $(LPBINARIES)
 	-$(DEL) $(GEN_DIR)$Sconstraint_solver$S*.pb.*
@@ -392,6 +395,7 @@ clean_cc:
 	-$(DEL) $(GEN_DIR)$Sold_flatzinc$Sparser*
 	-$(DEL) $(GEN_DIR)$Sflatzinc$Sflatzinc.tab.*
 	-$(DEL) $(GEN_DIR)$Sflatzinc$Sflatzinc.yy.*
+	-$(DEL) $(GEN_DIR)$Sflatzinc$S*.pb.*
 	-$(DEL) $(GEN_DIR)$Ssat$S*.pb.*
 	-$(DEL) $(BIN_DIR)$S*.exp
 	-$(DEL) $(BIN_DIR)$S*.lib
@@ -457,6 +461,7 @@ CONSTRAINT_SOLVER_LIB_OBJS = \
 	$(OBJ_DIR)/constraint_solver/model_cache.$O\
 	$(OBJ_DIR)/constraint_solver/nogoods.$O\
 	$(OBJ_DIR)/constraint_solver/pack.$O\
+	$(OBJ_DIR)/constraint_solver/parallel_search.$O\
 	$(OBJ_DIR)/constraint_solver/range_cst.$O\
 	$(OBJ_DIR)/constraint_solver/resource.$O\
 	$(OBJ_DIR)/constraint_solver/sat_constraint.$O\
@@ -574,6 +579,9 @@ $(OBJ_DIR)/constraint_solver/nogoods.$O:$(SRC_DIR)/constraint_solver/nogoods.cc
 $(OBJ_DIR)/constraint_solver/pack.$O:$(SRC_DIR)/constraint_solver/pack.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/pack.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Spack.$O
 
+$(OBJ_DIR)/constraint_solver/parallel_search.$O:$(SRC_DIR)/constraint_solver/parallel_search.cc
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/parallel_search.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Sparallel_search.$O
+
 $(OBJ_DIR)/constraint_solver/range_cst.$O:$(SRC_DIR)/constraint_solver/range_cst.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/range_cst.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Srange_cst.$O
 
@@ -644,8 +652,10 @@ LINEAR_SOLVER_LIB_OBJS = \
 	$(OBJ_DIR)/linear_solver/gurobi_interface.$O \
 	$(OBJ_DIR)/linear_solver/linear_solver.$O \
 	$(OBJ_DIR)/linear_solver/linear_solver2.pb.$O \
+	$(OBJ_DIR)/linear_solver/model_cache.$O \
 	$(OBJ_DIR)/linear_solver/model_exporter.$O \
 	$(OBJ_DIR)/linear_solver/scip_interface.$O \
+	$(OBJ_DIR)/linear_solver/solve_service.$O \
 	$(OBJ_DIR)/linear_solver/sulum_interface.$O
 
 
@@ -681,12 +691,18 @@ $(GEN_DIR)/linear_solver/linear_solver2.pb.cc:$(SRC_DIR)/linear_solver/linear_so
 
 $(GEN_DIR)/linear_solver/linear_solver2.pb.h:$(GEN_DIR)/linear_solver/linear_solver2.pb.cc
 
+$(OBJ_DIR)/linear_solver/model_cache.$O:$(SRC_DIR)/linear_solver/model_cache.cc $(GEN_DIR)/linear_solver/linear_solver2.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Slinear_solver$Smodel_cache.cc $(OBJ_OUT)$(OBJ_DIR)$Slinear_solver$Smodel_cache.$O
+
 $(OBJ_DIR)/linear_solver/model_exporter.$O:$(SRC_DIR)/linear_solver/model_exporter.cc $(GEN_DIR)/linear_solver/linear_solver2.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Slinear_solver$Smodel_exporter.cc $(OBJ_OUT)$(OBJ_DIR)$Slinear_solver$Smodel_exporter.$O
 
 $(OBJ_DIR)/linear_solver/scip_interface.$O:$(SRC_DIR)/linear_solver/scip_interface.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Slinear_solver$Sscip_interface.cc $(OBJ_OUT)$(OBJ_DIR)$Slinear_solver$Sscip_interface.$O
 
+$(OBJ_DIR)/linear_solver/solve_service.$O:$(SRC_DIR)/linear_solver/solve_service.cc $(GEN_DIR)/linear_solver/linear_solver2.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Slinear_solver$Ssolve_service.cc $(OBJ_OUT)$(OBJ_DIR)$Slinear_solver$Ssolve_service.$O
+
 $(OBJ_DIR)/linear_solver/sulum_interface.$O:$(SRC_DIR)/linear_solver/sulum_interface.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Slinear_solver$Ssulum_interface.cc $(OBJ_OUT)$(OBJ_DIR)$Slinear_solver$Ssulum_interface.$O
 
@@ -705,6 +721,7 @@ UTIL_LIB_OBJS=\
 	$(OBJ_DIR)/util/cached_log.$O \
 	$(OBJ_DIR)/util/fp_utils.$O \
 	$(OBJ_DIR)/util/graph_export.$O \
+	$(OBJ_DIR)/util/metrics.$O \
 	$(OBJ_DIR)/util/piecewise_linear_function.$O \
 	$(OBJ_DIR)/util/proto_tools.$O \
 	$(OBJ_DIR)/util/rational_approximation.$O \
@@ -724,6 +741,9 @@ $(OBJ_DIR)/util/fp_utils.$O:$(SRC_DIR)/util/fp_utils.cc
 $(OBJ_DIR)/util/graph_export.$O:$(SRC_DIR)/util/graph_export.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/util/graph_export.cc $(OBJ_OUT)$(OBJ_DIR)$Sutil$Sgraph_export.$O
 
+$(OBJ_DIR)/util/metrics.$O:$(SRC_DIR)/util/metrics.cc
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/util/metrics.cc $(OBJ_OUT)$(OBJ_DIR)$Sutil$Smetrics.$O
+
 $(OBJ_DIR)/util/piecewise_linear_function.$O:$(SRC_DIR)/util/piecewise_linear_function.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/util/piecewise_linear_function.cc $(OBJ_OUT)$(OBJ_DIR)$Sutil$Spiecewise_linear_function.$O
 
@@ -759,7 +779,8 @@ GRAPH_LIB_OBJS=\
 	$(OBJ_DIR)/graph/connectivity.$O \
 	$(OBJ_DIR)/graph/flow_problem.pb.$O \
 	$(OBJ_DIR)/graph/max_flow.$O \
-	$(OBJ_DIR)/graph/min_cost_flow.$O
+	$(OBJ_DIR)/graph/min_cost_flow.$O \
+	$(OBJ_DIR)/graph/network_simplex.$O
 
 $(OBJ_DIR)/graph/linear_assignment.$O:$(SRC_DIR)/graph/linear_assignment.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/linear_assignment.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Slinear_assignment.$O
@@ -789,6 +810,9 @@ $(OBJ_DIR)/graph/max_flow.$O:$(SRC_DIR)/graph/max_flow.cc $(SRC_DIR)/util/stats.
 $(OBJ_DIR)/graph/min_cost_flow.$O:$(SRC_DIR)/graph/min_cost_flow.cc $(GEN_DIR)/graph/flow_problem.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/min_cost_flow.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Smin_cost_flow.$O
 
+$(OBJ_DIR)/graph/network_simplex.$O:$(SRC_DIR)/graph/network_simplex.cc $(GEN_DIR)/graph/flow_problem.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/network_simplex.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Snetwork_simplex.$O
+
 $(LIB_DIR)/$(LIBPREFIX)graph.$(DYNAMIC_LIB_SUFFIX): $(GRAPH_LIB_OBJS)
 	$(DYNAMIC_LINK_CMD) $(DYNAMIC_LINK_PREFIX)$(LIB_DIR)$S$(LIBPREFIX)graph.$(DYNAMIC_LIB_SUFFIX) $(GRAPH_LIB_OBJS)
 
@@ -957,6 +981,7 @@ LP_DATA_OBJS= \
   $(OBJ_DIR)/lp_data/lp_data.$O \
   $(OBJ_DIR)/lp_data/lp_decomposer.$O \
   $(OBJ_DIR)/lp_data/lp_print_utils.$O \
+  $(OBJ_DIR)/lp_data/lp_snapshot.$O \
   $(OBJ_DIR)/lp_data/lp_types.$O \
   $(OBJ_DIR)/lp_data/lp_utils.$O \
   $(OBJ_DIR)/lp_data/matrix_scaler.$O \
@@ -974,6 +999,9 @@ $(OBJ_DIR)/lp_data/lp_decomposer.$O:$(SRC_DIR)/lp_data/lp_decomposer.cc
 $(OBJ_DIR)/lp_data/lp_print_utils.$O:$(SRC_DIR)/lp_data/lp_print_utils.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Slp_data$Slp_print_utils.cc $(OBJ_OUT)$(OBJ_DIR)$Slp_data$Slp_print_utils.$O
 
+$(OBJ_DIR)/lp_data/lp_snapshot.$O:$(SRC_DIR)/lp_data/lp_snapshot.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Slp_data$Slp_snapshot.cc $(OBJ_OUT)$(OBJ_DIR)$Slp_data$Slp_snapshot.$O
+
 $(OBJ_DIR)/lp_data/lp_types.$O:$(SRC_DIR)/lp_data/lp_types.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Slp_data$Slp_types.cc $(OBJ_OUT)$(OBJ_DIR)$Slp_data$Slp_types.$O
 
@@ -1003,9 +1031,13 @@ $(OBJ_DIR)/lp_data/sparse_column.$O:$(SRC_DIR)/lp_data/sparse_column.cc
 
 GLOP_LIB_OBJS= $(LP_DATA_OBJS) \
   $(OBJ_DIR)/glop/basis_representation.$O \
+  $(OBJ_DIR)/glop/crossover.$O \
   $(OBJ_DIR)/glop/dual_edge_norms.$O \
   $(OBJ_DIR)/glop/entering_variable.$O \
+  $(OBJ_DIR)/glop/first_order.$O \
   $(OBJ_DIR)/glop/initial_basis.$O \
+  $(OBJ_DIR)/glop/interior_point.$O \
+  $(OBJ_DIR)/glop/lp_reoptimizer.$O \
   $(OBJ_DIR)/glop/lp_solver.$O \
   $(OBJ_DIR)/glop/lu_factorization.$O \
   $(OBJ_DIR)/glop/markowitz.$O \
@@ -1015,6 +1047,7 @@ GLOP_LIB_OBJS= $(LP_DATA_OBJS) \
   $(OBJ_DIR)/glop/proto_utils.$O \
   $(OBJ_DIR)/glop/reduced_costs.$O \
   $(OBJ_DIR)/glop/revised_simplex.$O \
+  $(OBJ_DIR)/glop/sparse_cholesky.$O \
   $(OBJ_DIR)/glop/status.$O \
   $(OBJ_DIR)/glop/update_row.$O \
   $(OBJ_DIR)/glop/variables_info.$O \
@@ -1031,15 +1064,27 @@ $(OBJ_DIR)/glop/parameters.pb.$O:$(GEN_DIR)/glop/parameters.pb.cc
 $(OBJ_DIR)/glop/basis_representation.$O:$(SRC_DIR)/glop/basis_representation.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sbasis_representation.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sbasis_representation.$O
 
+$(OBJ_DIR)/glop/crossover.$O:$(SRC_DIR)/glop/crossover.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Scrossover.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Scrossover.$O
+
 $(OBJ_DIR)/glop/dual_edge_norms.$O:$(SRC_DIR)/glop/dual_edge_norms.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sdual_edge_norms.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sdual_edge_norms.$O
 
 $(OBJ_DIR)/glop/entering_variable.$O:$(SRC_DIR)/glop/entering_variable.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sentering_variable.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sentering_variable.$O
 
+$(OBJ_DIR)/glop/first_order.$O:$(SRC_DIR)/glop/first_order.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sfirst_order.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sfirst_order.$O
+
 $(OBJ_DIR)/glop/initial_basis.$O:$(SRC_DIR)/glop/initial_basis.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sinitial_basis.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sinitial_basis.$O
 
+$(OBJ_DIR)/glop/interior_point.$O:$(SRC_DIR)/glop/interior_point.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sinterior_point.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sinterior_point.$O
+
+$(OBJ_DIR)/glop/lp_reoptimizer.$O:$(SRC_DIR)/glop/lp_reoptimizer.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Slp_reoptimizer.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Slp_reoptimizer.$O
+
 $(OBJ_DIR)/glop/lp_solver.$O:$(SRC_DIR)/glop/lp_solver.cc  $(GEN_DIR)/linear_solver/linear_solver2.pb.h
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Slp_solver.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Slp_solver.$O
 
@@ -1070,6 +1115,9 @@ $(OBJ_DIR)/glop/reduced_costs.$O:$(SRC_DIR)/glop/reduced_costs.cc
 $(OBJ_DIR)/glop/revised_simplex.$O:$(SRC_DIR)/glop/revised_simplex.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Srevised_simplex.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Srevised_simplex.$O
 
+$(OBJ_DIR)/glop/sparse_cholesky.$O:$(SRC_DIR)/glop/sparse_cholesky.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Ssparse_cholesky.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Ssparse_cholesky.$O
+
 $(OBJ_DIR)/glop/status.$O:$(SRC_DIR)/glop/status.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sstatus.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sstatus.$O
 
@@ -1196,46 +1244,52 @@ endif
 FLATZINC_LIB_OBJS=\
 	$(OBJ_DIR)/flatzinc/constraints.$O\
 	$(OBJ_DIR)/flatzinc/flatzinc_constraints.$O\
+	$(OBJ_DIR)/flatzinc/lexer.$O\
 	$(OBJ_DIR)/flatzinc/model.$O\
+	$(OBJ_DIR)/flatzinc/parallel_parameters.pb.$O\
 	$(OBJ_DIR)/flatzinc/parallel_support.$O\
 	$(OBJ_DIR)/flatzinc/parser.$O\
 	$(OBJ_DIR)/flatzinc/parser.tab.$O\
-	$(OBJ_DIR)/flatzinc/parser.yy.$O\
 	$(OBJ_DIR)/flatzinc/presolve.$O\
 	$(OBJ_DIR)/flatzinc/sat_constraint.$O\
 	$(OBJ_DIR)/flatzinc/search.$O\
 	$(OBJ_DIR)/flatzinc/sequential_support.$O\
 	$(OBJ_DIR)/flatzinc/solver.$O
 
-$(GEN_DIR)/flatzinc/parser.yy.cc: $(SRC_DIR)/flatzinc/parser.lex $(FLEX)
-	$(FLEX) -o$(GEN_DIR)/flatzinc/parser.yy.cc $(SRC_DIR)/flatzinc/parser.lex
-
 $(GEN_DIR)/flatzinc/parser.tab.cc: $(SRC_DIR)/flatzinc/parser.yy $(BISON)
 	$(BISON) -t -o $(GEN_DIR)/flatzinc/parser.tab.cc -d $<
 
 $(GEN_DIR)/flatzinc/parser.tab.hh: $(GEN_DIR)/flatzinc/parser.tab.cc
 
+$(GEN_DIR)/flatzinc/parallel_parameters.pb.cc: $(SRC_DIR)/flatzinc/parallel_parameters.proto
+	$(PROTOBUF_DIR)/bin/protoc --proto_path=$(INC_DIR) --cpp_out=$(GEN_DIR) $(SRC_DIR)/flatzinc/parallel_parameters.proto
+
+$(GEN_DIR)/flatzinc/parallel_parameters.pb.h: $(GEN_DIR)/flatzinc/parallel_parameters.pb.cc
+
+$(OBJ_DIR)/flatzinc/parallel_parameters.pb.$O: $(GEN_DIR)/flatzinc/parallel_parameters.pb.cc $(GEN_DIR)/flatzinc/parallel_parameters.pb.h
+	$(CCC) $(CFLAGS) -c $(GEN_DIR)/flatzinc/parallel_parameters.pb.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sparallel_parameters.pb.$O
+
 $(OBJ_DIR)/flatzinc/constraints.$O:$(SRC_DIR)/flatzinc/constraints.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Sconstraints.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sconstraints.$O
 
 $(OBJ_DIR)/flatzinc/flatzinc_constraints.$O:$(SRC_DIR)/flatzinc/flatzinc_constraints.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Sflatzinc_constraints.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sflatzinc_constraints.$O
 
+$(OBJ_DIR)/flatzinc/lexer.$O:$(SRC_DIR)/flatzinc/lexer.cc $(SRC_DIR)/flatzinc/lexer.h $(GEN_DIR)/flatzinc/parser.tab.hh
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Slexer.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Slexer.$O
+
 $(OBJ_DIR)/flatzinc/model.$O:$(SRC_DIR)/flatzinc/model.cc $(SRC_DIR)/flatzinc/model.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Smodel.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Smodel.$O
 
 $(OBJ_DIR)/flatzinc/parallel_support.$O:$(SRC_DIR)/flatzinc/parallel_support.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Sparallel_support.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sparallel_support.$O
 
-$(OBJ_DIR)/flatzinc/parser.$O:$(SRC_DIR)/flatzinc/parser.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/parser.h $(GEN_DIR)/flatzinc/parser.tab.hh
+$(OBJ_DIR)/flatzinc/parser.$O:$(SRC_DIR)/flatzinc/parser.cc $(SRC_DIR)/flatzinc/lexer.h $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/parser.h $(GEN_DIR)/flatzinc/parser.tab.hh
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Sparser.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sparser.$O
 
 $(OBJ_DIR)/flatzinc/parser.tab.$O:$(GEN_DIR)/flatzinc/parser.tab.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/parser.h $(GEN_DIR)/flatzinc/parser.tab.hh
 	$(CCC) $(CFLAGS) -c $(GEN_DIR)$Sflatzinc$Sparser.tab.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sparser.tab.$O
 
-$(OBJ_DIR)/flatzinc/parser.yy.$O:$(GEN_DIR)/flatzinc/parser.yy.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/parser.h $(GEN_DIR)/flatzinc/parser.tab.hh
-	$(CCC) $(CFLAGS) -c $(GEN_DIR)$Sflatzinc$Sparser.yy.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sparser.yy.$O
-
 $(OBJ_DIR)/flatzinc/presolve.$O:$(SRC_DIR)/flatzinc/presolve.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/presolve.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Spresolve.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Spresolve.$O
 
@@ -1254,7 +1308,7 @@ $(OBJ_DIR)/flatzinc/solver.$O:$(SRC_DIR)/flatzinc/solver.cc $(SRC_DIR)/flatzinc/
 $(LIB_DIR)/$(LIBPREFIX)fz.$(STATIC_LIB_SUFFIX): $(FLATZINC_LIB_OBJS)
 	$(STATIC_LINK_CMD) $(STATIC_LINK_PREFIX)$(LIB_DIR)$S$(LIBPREFIX)fz.$(STATIC_LIB_SUFFIX) $(FLATZINC_LIB_OBJS)
 
-$(OBJ_DIR)/flatzinc/fz.$O:$(SRC_DIR)/flatzinc/fz.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
+$(OBJ_DIR)/flatzinc/fz.$O:$(SRC_DIR)/flatzinc/fz.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h $(GEN_DIR)/flatzinc/parallel_parameters.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Sfz.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sfz.$O
 
 $(OBJ_DIR)/flatzinc/parser_main.$O:$(SRC_DIR)/flatzinc/parser_main.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
@@ -1268,6 +1322,25 @@ $(BIN_DIR)/fz$E: $(OBJ_DIR)/flatzinc/fz.$O $(STATIC_FLATZINC_DEPS)
 $(BIN_DIR)/parser_main$E: $(OBJ_DIR)/flatzinc/parser_main.$O $(STATIC_FLATZINC_DEPS)
 	$(CCC) $(CFLAGS) $(OBJ_DIR)$Sflatzinc$Sparser_main.$O $(STATIC_FZ) $(STATIC_FLATZINC_LNK) $(STATIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Sparser_main$E
 
+# Flatzinc benchmark: runs fz on all the .fzn files of FZ_BENCH_DIR, once
+# per number of workers in FZ_BENCH_WORKERS, and appends the statistics of
+# each run (status, objective, parse, presolve, build and search times, time
+# to the first and to the last solution) as csv lines to FZ_BENCH_OUTPUT.
+# For instance: make fz_bench FZ_BENCH_WORKERS="0 4" FZ_BENCH_TIME_LIMIT=60000
+
+FZ_BENCH_DIR = $(EX_DIR)/flatzinc
+FZ_BENCH_WORKERS = 0
+FZ_BENCH_TIME_LIMIT = 10000
+FZ_BENCH_OUTPUT = fz_bench.csv
+
+define FZ_BENCH_RUN
+	-$(BIN_DIR)$Sfz$E --workers=$1 --time_limit=$(FZ_BENCH_TIME_LIMIT) --csv_output=$(FZ_BENCH_OUTPUT) $2
+
+endef
+
+fz_bench: $(BIN_DIR)/fz$E
+	$(foreach workers,$(FZ_BENCH_WORKERS),$(foreach instance,$(wildcard $(FZ_BENCH_DIR)/*.fzn),$(call FZ_BENCH_RUN,$(workers),$(instance))))
+
 # Flow and linear assignment cpp
 
 $(OBJ_DIR)/linear_assignment_api.$O:$(EX_DIR)/cpp/linear_assignment_api.cc
@@ -1410,12 +1483,31 @@ $(OBJ_DIR)/nqueens2.$O: $(EX_DIR)/cpp/nqueens2.cc $(SRC_DIR)/constraint_solver/c
 $(BIN_DIR)/nqueens2$E: $(DYNAMIC_CP_DEPS) $(OBJ_DIR)/nqueens2.$O
 	$(CCC) $(CFLAGS) $(OBJ_DIR)/nqueens2.$O $(DYNAMIC_CP_LNK) $(DYNAMIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Snqueens2$E
 
+$(OBJ_DIR)/propagation_benchmark.$O: $(EX_DIR)/cpp/propagation_benchmark.cc $(SRC_DIR)/constraint_solver/constraint_solver.h $(EX_DIR)/cpp/jobshop.h
+	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp/propagation_benchmark.cc $(OBJ_OUT)$(OBJ_DIR)$Spropagation_benchmark.$O
+
+$(BIN_DIR)/propagation_benchmark$E: $(DYNAMIC_CP_DEPS) $(OBJ_DIR)/propagation_benchmark.$O
+	$(CCC) $(CFLAGS) $(OBJ_DIR)/propagation_benchmark.$O $(DYNAMIC_CP_LNK) $(DYNAMIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Spropagation_benchmark$E
+
 $(OBJ_DIR)/pdptw.$O: $(EX_DIR)/cpp/pdptw.cc $(SRC_DIR)/constraint_solver/constraint_solver.h $(SRC_DIR)/constraint_solver/routing.h
 	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp/pdptw.cc $(OBJ_OUT)$(OBJ_DIR)$Spdptw.$O
 
 $(BIN_DIR)/pdptw$E: $(DYNAMIC_ROUTING_DEPS) $(OBJ_DIR)/pdptw.$O
 	$(CCC) $(CFLAGS) $(OBJ_DIR)/pdptw.$O $(DYNAMIC_ROUTING_LNK) $(DYNAMIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Spdptw$E
 
+$(OBJ_DIR)/routing_benchmark.$O: $(EX_DIR)/cpp/routing_benchmark.cc $(SRC_DIR)/constraint_solver/constraint_solver.h $(SRC_DIR)/constraint_solver/routing.h
+	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp/routing_benchmark.cc $(OBJ_OUT)$(OBJ_DIR)$Srouting_benchmark.$O
+
+$(BIN_DIR)/routing_benchmark$E: $(DYNAMIC_ROUTING_DEPS) $(OBJ_DIR)/routing_benchmark.$O
+	$(CCC) $(CFLAGS) $(OBJ_DIR)/routing_benchmark.$O $(DYNAMIC_ROUTING_LNK) $(DYNAMIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Srouting_benchmark$E
+
+# Routing benchmark suite; results are written to routing_benchmark.csv.
+ROUTING_BENCHMARK_INSTANCES = \
+	$(OR_ROOT)data/cvrptw/C110_1.TXT,$(OR_ROOT)data/cvrptw/R110_1.TXT,$(OR_ROOT)data/cvrptw/RC110_1.TXT,$(OR_ROOT)data/pdptw/LC1101.txt,$(OR_ROOT)data/pdptw/LR1101.txt,$(OR_ROOT)data/pdptw/LRC1101.txt
+
+benchmark_routing: $(BIN_DIR)/routing_benchmark$E
+	$(BIN_DIR)$Srouting_benchmark$E --routing_benchmark_instances=$(ROUTING_BENCHMARK_INSTANCES) --routing_benchmark_first_solutions=PathCheapestArc,GlobalCheapestInsertion --routing_benchmark_metaheuristics=GreedyDescent,GuidedLocalSearch --routing_benchmark_time_limit_ms=60000 --routing_benchmark_output=routing_benchmark.csv
+
 $(OBJ_DIR)/sports_scheduling.$O:$(EX_DIR)/cpp/sports_scheduling.cc $(SRC_DIR)/constraint_solver/constraint_solver.h
 	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp/sports_scheduling.cc $(OBJ_OUT)$(OBJ_DIR)$Ssports_scheduling.$O
 
@@ -1526,17 +1618,19 @@ $(BIN_DIR)/integer_programming$E: $(DYNAMIC_LP_DEPS) $(OBJ_DIR)/integer_programm
 
 # Sat solver
 
-sat: bin/sat_runner$E
+sat: bin/sat_runner$E bin/sat_benchmark$E
 
 SAT_LIB_OBJS = \
 	$(OBJ_DIR)/sat/boolean_problem.$O\
 	$(OBJ_DIR)/sat/boolean_problem.pb.$O \
 	$(OBJ_DIR)/sat/clause.$O\
+	$(OBJ_DIR)/sat/drat_writer.$O\
 	$(OBJ_DIR)/sat/encoding.$O\
 	$(OBJ_DIR)/sat/lp_utils.$O\
 	$(OBJ_DIR)/sat/optimization.$O\
 	$(OBJ_DIR)/sat/pb_constraint.$O\
 	$(OBJ_DIR)/sat/sat_parameters.pb.$O\
+	$(OBJ_DIR)/sat/sat_portfolio.$O\
 	$(OBJ_DIR)/sat/sat_solver.$O\
 	$(OBJ_DIR)/sat/simplification.$O\
 	$(OBJ_DIR)/sat/symmetry.$O\
@@ -1544,9 +1638,15 @@ SAT_LIB_OBJS = \
 
 satlibs: $(DYNAMIC_SAT_DEPS) $(STATIC_SAT_DEPS)
 
-$(OBJ_DIR)/sat/sat_solver.$O: $(SRC_DIR)/sat/sat_solver.cc $(SRC_DIR)/sat/sat_solver.h $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/clause.h $(SRC_DIR)/sat/encoding.h $(SRC_DIR)/sat/unsat_proof.h $(GEN_DIR)/sat/sat_parameters.pb.h
+$(OBJ_DIR)/sat/sat_solver.$O: $(SRC_DIR)/sat/sat_solver.cc $(SRC_DIR)/sat/sat_solver.h $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/clause.h $(SRC_DIR)/sat/drat_writer.h $(SRC_DIR)/sat/encoding.h $(SRC_DIR)/sat/unsat_proof.h $(GEN_DIR)/sat/sat_parameters.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/sat_solver.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Ssat_solver.$O
 
+$(OBJ_DIR)/sat/drat_writer.$O: $(SRC_DIR)/sat/drat_writer.cc $(SRC_DIR)/sat/drat_writer.h $(SRC_DIR)/sat/sat_base.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/drat_writer.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Sdrat_writer.$O
+
+$(OBJ_DIR)/sat/sat_portfolio.$O: $(SRC_DIR)/sat/sat_portfolio.cc $(SRC_DIR)/sat/sat_portfolio.h $(SRC_DIR)/sat/sat_solver.h $(SRC_DIR)/sat/sat_base.h $(GEN_DIR)/sat/sat_parameters.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/sat_portfolio.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Ssat_portfolio.$O
+
 $(OBJ_DIR)/sat/lp_utils.$O: $(SRC_DIR)/sat/lp_utils.cc $(SRC_DIR)/sat/lp_utils.h $(SRC_DIR)/sat/sat_solver.h $(GEN_DIR)/sat/sat_parameters.pb.h $(GEN_DIR)/glop/parameters.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/lp_utils.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Slp_utils.$O
 
@@ -1604,6 +1704,12 @@ $(OBJ_DIR)/sat/sat_runner.$O:$(EX_DIR)/cpp/sat_runner.cc $(SRC_DIR)/sat/sat_solv
 $(BIN_DIR)/sat_runner$E: $(STATIC_SAT_DEPS) $(OBJ_DIR)/sat/sat_runner.$O
 	$(CCC) $(CFLAGS) $(FZ_STATIC) $(OBJ_DIR)$Ssat$Ssat_runner.$O $(STATIC_SAT_LNK) $(STATIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Ssat_runner$E
 
+$(OBJ_DIR)/sat/sat_benchmark.$O:$(EX_DIR)/cpp/sat_benchmark.cc $(SRC_DIR)/sat/sat_solver.h $(SRC_DIR)/sat/sat_portfolio.h $(SRC_DIR)/sat/optimization.h $(EX_DIR)/cpp/opb_reader.h $(EX_DIR)/cpp/sat_cnf_reader.h $(GEN_DIR)/sat/sat_parameters.pb.h  $(GEN_DIR)/sat/boolean_problem.pb.h  $(SRC_DIR)/sat/boolean_problem.h
+	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp$Ssat_benchmark.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Ssat_benchmark.$O
+
+$(BIN_DIR)/sat_benchmark$E: $(STATIC_SAT_DEPS) $(OBJ_DIR)/sat/sat_benchmark.$O
+	$(CCC) $(CFLAGS) $(FZ_STATIC) $(OBJ_DIR)$Ssat$Ssat_benchmark.$O $(STATIC_SAT_LNK) $(STATIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Ssat_benchmark$E
+
 # Bop solver
 BOP_LIB_OBJS = \
 	$(OBJ_DIR)/bop/bop_base.$O\
@@ -97,7 +97,8 @@ GraphSymmetryFinder::GraphSymmetryFinder(const Graph& graph, bool is_undirected)
       tmp_dynamic_permutation_(NumNodes()),
       tmp_node_mask_(NumNodes(), false),
       tmp_degree_(NumNodes(), 0),
-      tmp_nodes_with_degree_(NumNodes() + 1) {
+      tmp_nodes_with_degree_(NumNodes() + 1),
+      num_threads_(1) {
   // Set up an "unlimited" time limit by default.
   time_limit_.reset(new TimeLimit(std::numeric_limits<double>::infinity()));
   tmp_partition_.Reset(NumNodes());
@@ -167,19 +168,101 @@ bool GraphSymmetryFinder::IsGraphAutomorphism(
 namespace {
 // Specialized subroutine, to avoid code duplication: see its call site
 // and its self-explanatory code.
+// Returns the number of nodes scanned.
 template <class T>
-inline void IncrementCounterForNonSingletons(const T& nodes,
-                                             const DynamicPartition& partition,
-                                             std::vector<int>* node_count,
-                                             std::vector<int>* nodes_seen) {
+inline int IncrementCounterForNonSingletons(const T& nodes,
+                                            const DynamicPartition& partition,
+                                            std::vector<int>* node_count,
+                                            std::vector<int>* nodes_seen) {
+  int num_scanned = 0;
   for (const int node : nodes) {
+    ++num_scanned;
     if (partition.ElementsInSamePartAs(node).size() == 1) continue;
     const int count = ++(*node_count)[node];
     if (count == 1) nodes_seen->push_back(node);
   }
+  return num_scanned;
 }
 }  // namespace
 
+void GraphSymmetryFinder::set_num_threads(int num_threads) {
+  num_threads_ = std::max(1, num_threads);
+  thread_pool_.reset();
+  slice_degree_.clear();
+  slice_nodes_seen_.clear();
+  slice_num_scanned_arcs_.clear();
+  if (num_threads_ == 1) return;
+  thread_pool_.reset(new ThreadPool("GraphSymmetryFinder", num_threads_ - 1));
+  thread_pool_->StartWorkers();
+  slice_degree_.assign(num_threads_, std::vector<int>(NumNodes(), 0));
+  slice_nodes_seen_.resize(num_threads_);
+  slice_num_scanned_arcs_.assign(num_threads_, 0);
+}
+
+int64 GraphSymmetryFinder::CountDegreesFromPart(
+    const DynamicPartition::IterablePart& part, bool outgoing,
+    const DynamicPartition& partition, std::vector<int>* node_count,
+    std::vector<int>* nodes_seen) {
+  // Below this size, the synchronization costs more than it saves.
+  const int kMinPartSizeForParallelScan = 4096;
+  const int part_size = part.size();
+  if (num_threads_ == 1 || part_size < kMinPartSizeForParallelScan) {
+    int64 num_scanned_arcs = 0;
+    if (outgoing) {
+      for (const int node : part) {
+        num_scanned_arcs += IncrementCounterForNonSingletons(
+            graph_[node], partition, node_count, nodes_seen);
+      }
+    } else {
+      for (const int node : part) {
+        num_scanned_arcs += IncrementCounterForNonSingletons(
+            TailsOfIncomingArcsTo(node), partition, node_count, nodes_seen);
+      }
+    }
+    return num_scanned_arcs;
+  }
+
+  // Each slice only reads the graph and the partition, and writes to its own
+  // scratch vectors.
+  thread_pool_->ParallelFor(0, num_threads_, 1, [&](int begin, int end) {
+    for (int slice = begin; slice < end; ++slice) {
+      const auto slice_begin =
+          part.begin() + static_cast<int64>(part_size) * slice / num_threads_;
+      const auto slice_end = part.begin() + static_cast<int64>(part_size) *
+                                                (slice + 1) / num_threads_;
+      int64 num_scanned_arcs = 0;
+      for (auto it = slice_begin; it != slice_end; ++it) {
+        if (outgoing) {
+          num_scanned_arcs += IncrementCounterForNonSingletons(
+              graph_[*it], partition, &slice_degree_[slice],
+              &slice_nodes_seen_[slice]);
+        } else {
+          num_scanned_arcs += IncrementCounterForNonSingletons(
+              TailsOfIncomingArcsTo(*it), partition, &slice_degree_[slice],
+              &slice_nodes_seen_[slice]);
+        }
+      }
+      slice_num_scanned_arcs_[slice] = num_scanned_arcs;
+    }
+  });
+
+  // Merge the slices in order: a node is appended to "nodes_seen" when it's
+  // met in the first slice that contains it, which is exactly the order of
+  // the serial scan above.
+  int64 num_scanned_arcs = 0;
+  for (int slice = 0; slice < num_threads_; ++slice) {
+    std::vector<int>& slice_degree = slice_degree_[slice];
+    for (const int node : slice_nodes_seen_[slice]) {
+      if ((*node_count)[node] == 0) nodes_seen->push_back(node);
+      (*node_count)[node] += slice_degree[node];
+      slice_degree[node] = 0;  // To clean up after us.
+    }
+    slice_nodes_seen_[slice].clear();  // To clean up after us.
+    num_scanned_arcs += slice_num_scanned_arcs_[slice];
+  }
+  return num_scanned_arcs;
+}
+
 void GraphSymmetryFinder::RecursivelyRefinePartitionByAdjacency(
     int first_unrefined_part_index, DynamicPartition* partition) {
   // Rename, for readability of the code below.
@@ -200,25 +283,16 @@ void GraphSymmetryFinder::RecursivelyRefinePartitionByAdjacency(
   if (!reverse_adj_list_index_.empty()) {
     adjacency_directions.push_back(false);  // Also look at incoming arcs.
   }
+  int64 num_scanned_arcs = 0;
   for (int part_index = first_unrefined_part_index;
        part_index < partition->NumParts();  // Moving target!
        ++part_index) {
     for (const bool outgoing_adjacency : adjacency_directions) {
       // Count the aggregated degree of all nodes, only looking at arcs that
       // come from/to the current part.
-      if (outgoing_adjacency) {
-        for (const int node : partition->ElementsInPart(part_index)) {
-          IncrementCounterForNonSingletons(graph_[node], *partition,
-                                           &tmp_degree_,
-                                           &tmp_nodes_with_nonzero_degree);
-        }
-      } else {
-        for (const int node : partition->ElementsInPart(part_index)) {
-          IncrementCounterForNonSingletons(TailsOfIncomingArcsTo(node),
-                                           *partition, &tmp_degree_,
-                                           &tmp_nodes_with_nonzero_degree);
-        }
-      }
+      num_scanned_arcs += CountDegreesFromPart(
+          partition->ElementsInPart(part_index), outgoing_adjacency,
+          *partition, &tmp_degree_, &tmp_nodes_with_nonzero_degree);
       // Group the nodes by (nonzero) degree. Remember the maximum degree.
       int max_degree = 0;
       for (const int node : tmp_nodes_with_nonzero_degree) {
@@ -236,6 +310,7 @@ void GraphSymmetryFinder::RecursivelyRefinePartitionByAdjacency(
       }
     }
   }
+  time_limit_->AdvanceDeterministicTime(1e-8 * num_scanned_arcs);
 }
 
 void GraphSymmetryFinder::DistinguishNodeInPartition(
@@ -349,8 +424,19 @@ util::Status GraphSymmetryFinder::FindSymmetries(
     double time_limit_seconds, std::vector<int>* node_equivalence_classes_io,
     std::vector<std::unique_ptr<SparsePermutation>>* generators,
     std::vector<int>* factorized_automorphism_group_size) {
+  return FindSymmetries(time_limit_seconds,
+                        std::numeric_limits<double>::infinity(),
+                        node_equivalence_classes_io, generators,
+                        factorized_automorphism_group_size);
+}
+
+util::Status GraphSymmetryFinder::FindSymmetries(
+    double time_limit_seconds, double deterministic_time_limit,
+    std::vector<int>* node_equivalence_classes_io,
+    std::vector<std::unique_ptr<SparsePermutation>>* generators,
+    std::vector<int>* factorized_automorphism_group_size) {
   // Initialization.
-  time_limit_.reset(new TimeLimit(time_limit_seconds));
+  time_limit_.reset(new TimeLimit(time_limit_seconds, deterministic_time_limit));
   IF_STATS_ENABLED(stats_.initialization_time.StartTimer());
   generators->clear();
   factorized_automorphism_group_size->clear();
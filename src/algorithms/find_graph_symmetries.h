@@ -26,6 +26,7 @@
 #include "util/stats.h"
 #include "util/time_limit.h"
 #include "base/status.h"
+#include "base/threadpool.h"
 
 namespace operations_research {
 
@@ -48,6 +49,14 @@ class GraphSymmetryFinder {
   // TODO(user): support multi-arcs.
   GraphSymmetryFinder(const Graph& graph, bool is_undirected);
 
+  // Sets the number of threads used to compute the adjacency invariants of the
+  // large parts during the partition refinements (default: 1, i.e. no thread).
+  // The result, including the deterministic time, doesn't depend on it: each
+  // thread counts the degrees over a fixed slice of the part, and the slices
+  // are merged in order, which yields the exact serial node ordering.
+  // This uses O(num_threads * NumNodes()) extra memory.
+  void set_num_threads(int num_threads);
+
   // Whether the given permutation is an automorphism of the graph given at
   // construction. This costs O(sum(degree(x))) (the sum is over all nodes x
   // that are displaced by the permutation).
@@ -100,6 +109,16 @@ class GraphSymmetryFinder {
       std::vector<std::unique_ptr<SparsePermutation>>* generators,
       std::vector<int>* factorized_automorphism_group_size);
 
+  // Same as FindSymmetries() above, but the search also stops when its
+  // deterministic time reaches deterministic_time_limit. The deterministic time
+  // is proportional to the number of arcs scanned by the partition refinements,
+  // so, contrary to the wall time limit, the result is reproducible.
+  util::Status FindSymmetries(
+      double time_limit_seconds, double deterministic_time_limit,
+      std::vector<int>* node_equivalence_classes_io,
+      std::vector<std::unique_ptr<SparsePermutation>>* generators,
+      std::vector<int>* factorized_automorphism_group_size);
+
   // **** Methods below are public FOR TESTING ONLY. ****
 
   // Fully refine the partition of nodes, using the graph as symmetry breaker.
@@ -143,6 +162,27 @@ class GraphSymmetryFinder {
   BeginEndWrapper<std::vector<int>::const_iterator> TailsOfIncomingArcsTo(
       int node) const;
 
+  // Counts the aggregated degree of all nodes, only looking at the arcs that
+  // come from (or go to, if "outgoing" is false) the nodes of "part". The
+  // non-singleton nodes with a nonzero degree are appended to "nodes_seen" in
+  // the order of their first occurrence, and their degree is put in
+  // "node_count". Returns the number of arcs scanned. Large parts are split
+  // in fixed slices that are scanned in parallel, see set_num_threads().
+  int64 CountDegreesFromPart(const DynamicPartition::IterablePart& part,
+                             bool outgoing, const DynamicPartition& partition,
+                             std::vector<int>* node_count,
+                             std::vector<int>* nodes_seen);
+
+  // Parallel refinement. The pool is only created if num_threads > 1; each
+  // slice #i of a part uses the scratch vectors slice_degree_[i] (resting
+  // state: [0..N-1] = 0), slice_nodes_seen_[i] (empty) and
+  // slice_num_scanned_arcs_[i].
+  int num_threads_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::vector<std::vector<int>> slice_degree_;
+  std::vector<std::vector<int>> slice_nodes_seen_;
+  std::vector<int64> slice_num_scanned_arcs_;
+
   // Deadline management. Populated upon FindSymmetries().
   mutable std::unique_ptr<TimeLimit> time_limit_;
 
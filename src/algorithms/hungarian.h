@@ -20,7 +20,7 @@
 // See: //depot/google3/java/com/google/wireless/genie/frontend
 //       /mixer/matching/HungarianOptimizer.java
 
-// An O(n^4) implementation of the Kuhn-Munkres algorithm (aka the
+// An O(n^3) implementation of the Kuhn-Munkres algorithm (aka the
 // Hungarian algorithm) for solving the assignment problem.
 // The assignment problem takes a set of agents, a set of tasks and a
 // cost associated with assigning each agent to each task and produces
@@ -28,11 +28,13 @@
 // The code also enables to compute a maximum assignment by changing the
 // input matrix.
 //
-// This code is based on (read: translated from) the Java version
-// (read: translated from) the python version at
-//   http://www.clapper.org/software/python/munkres/
-// which in turn is based on
-//   http://www.public.iastate.edu/~ddoty/HungarianAlgorithm.html.
+// The agents are assigned one at a time, each along a shortest augmenting
+// path computed on the reduced costs, as in
+//   R. Jonker and A. Volgenant, "A shortest augmenting path algorithm for
+//   dense and sparse linear assignment problems", Computing 38 (4), 1987.
+// The costs are copied in a single row-major array, and the updates of the
+// slacks of the tasks, which take most of the time, are branch-free loops
+// over a row that the compiler can vectorize.
 
 #ifndef OR_TOOLS_ALGORITHMS_HUNGARIAN_H_
 #define OR_TOOLS_ALGORITHMS_HUNGARIAN_H_
@@ -40,6 +42,8 @@
 #include "base/hash.h"
 #include <vector>
 
+#include "base/integral_types.h"
+
 namespace operations_research {
 
 // See IMPORTANT NOTE at the top of the file.
@@ -52,6 +56,15 @@ void MaximizeLinearAssignment(const std::vector<std::vector<double> >& cost,
                               hash_map<int, int>* direct_assignment,
                               hash_map<int, int>* reverse_assignment);
 
+// Same as the two functions above, for int64 costs.
+void MinimizeLinearAssignment(const std::vector<std::vector<int64> >& cost,
+                              hash_map<int, int>* direct_assignment,
+                              hash_map<int, int>* reverse_assignment);
+
+void MaximizeLinearAssignment(const std::vector<std::vector<int64> >& cost,
+                              hash_map<int, int>* direct_assignment,
+                              hash_map<int, int>* reverse_assignment);
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_ALGORITHMS_HUNGARIAN_H_
@@ -15,8 +15,10 @@
 #include "algorithms/knapsack_solver.h"
 
 #include <algorithm>
+#include <limits>
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "base/stl_util.h"
@@ -30,6 +32,9 @@ const int kNoSelection = -1;
 const int kMasterPropagatorId = 0;
 const int kMaxNumberOfBruteForceItems = 30;
 const int kMaxNumberOf64Items = 64;
+// Below this capacity, the dynamic programming solver does not try the Pareto
+// lists: the capacity-indexed table is small and fast to fill anyway.
+const int64 kMinCapacityForParetoLists = 1 << 12;
 
 // Comparator used to sort item in decreasing efficiency order
 // (see KnapsackCapacityPropagator).
@@ -105,6 +110,16 @@ KnapsackSearchNode::KnapsackSearchNode(const KnapsackSearchNode* const parent,
       profit_upper_bound_(kint64max),
       next_item_id_(kNoSelection) {}
 
+void KnapsackSearchNode::Reset(const KnapsackSearchNode* const parent,
+                               const KnapsackAssignment& assignment) {
+  depth_ = (parent == NULL) ? 0 : parent->depth() + 1;
+  parent_ = parent;
+  assignment_ = assignment;
+  current_profit_ = 0;
+  profit_upper_bound_ = kint64max;
+  next_item_id_ = kNoSelection;
+}
+
 // ----- KnapsackSearchPath -----
 KnapsackSearchPath::KnapsackSearchPath(const KnapsackSearchNode& from,
                                        const KnapsackSearchNode& to)
@@ -336,11 +351,15 @@ KnapsackGenericSolver::KnapsackGenericSolver(const std::string& solver_name)
       propagators_(),
       master_propagator_id_(kMasterPropagatorId),
       search_nodes_(),
+      num_search_nodes_(0),
       state_(),
       best_solution_profit_(0),
       best_solution_() {}
 
-KnapsackGenericSolver::~KnapsackGenericSolver() { Clear(); }
+KnapsackGenericSolver::~KnapsackGenericSolver() {
+  Clear();
+  STLDeleteElements(&search_nodes_);
+}
 
 void KnapsackGenericSolver::Init(const std::vector<int64>& profits,
                                  const std::vector<std::vector<int64> >& weights,
@@ -390,20 +409,20 @@ void KnapsackGenericSolver::GetLowerAndUpperBoundWhenItem(int item_id,
 
 int64 KnapsackGenericSolver::Solve() {
   best_solution_profit_ = 0LL;
+  num_search_nodes_ = 0;
 
   SearchQueue search_queue;
   const KnapsackAssignment assignment(kNoSelection, true);
-  KnapsackSearchNode* root_node = new KnapsackSearchNode(NULL, assignment);
+  KnapsackSearchNode* root_node = NewSearchNode(NULL, assignment);
   root_node->set_current_profit(GetCurrentProfit());
   root_node->set_profit_upper_bound(GetAggregatedProfitUpperBound());
   root_node->set_next_item_id(GetNextItemId());
-  search_nodes_.push_back(root_node);
 
   if (MakeNewNode(*root_node, false)) {
-    search_queue.push(search_nodes_.back());
+    search_queue.push(search_nodes_[num_search_nodes_ - 1]);
   }
   if (MakeNewNode(*root_node, true)) {
-    search_queue.push(search_nodes_.back());
+    search_queue.push(search_nodes_[num_search_nodes_ - 1]);
   }
 
   KnapsackSearchNode* current_node = root_node;
@@ -421,10 +440,10 @@ int64 KnapsackGenericSolver::Solve() {
     }
 
     if (MakeNewNode(*node, false)) {
-      search_queue.push(search_nodes_.back());
+      search_queue.push(search_nodes_[num_search_nodes_ - 1]);
     }
     if (MakeNewNode(*node, true)) {
-      search_queue.push(search_nodes_.back());
+      search_queue.push(search_nodes_[num_search_nodes_ - 1]);
     }
   }
   return best_solution_profit_;
@@ -432,7 +451,20 @@ int64 KnapsackGenericSolver::Solve() {
 
 void KnapsackGenericSolver::Clear() {
   STLDeleteElements(&propagators_);
-  STLDeleteElements(&search_nodes_);
+  num_search_nodes_ = 0;
+}
+
+KnapsackSearchNode* KnapsackGenericSolver::NewSearchNode(
+    const KnapsackSearchNode* const parent,
+    const KnapsackAssignment& assignment) {
+  if (num_search_nodes_ < search_nodes_.size()) {
+    KnapsackSearchNode* const node = search_nodes_[num_search_nodes_++];
+    node->Reset(parent, assignment);
+    return node;
+  }
+  search_nodes_.push_back(new KnapsackSearchNode(parent, assignment));
+  ++num_search_nodes_;
+  return search_nodes_.back();
 }
 
 // Returns false when at least one propagator fails.
@@ -492,11 +524,10 @@ bool KnapsackGenericSolver::MakeNewNode(const KnapsackSearchNode& node,
   }
 
   // The node is relevant.
-  KnapsackSearchNode* relevant_node = new KnapsackSearchNode(&node, assignment);
+  KnapsackSearchNode* relevant_node = NewSearchNode(&node, assignment);
   relevant_node->set_current_profit(new_node.current_profit());
   relevant_node->set_profit_upper_bound(new_node.profit_upper_bound());
   relevant_node->set_next_item_id(new_node.next_item_id());
-  search_nodes_.push_back(relevant_node);
 
   return true;
 }
@@ -921,14 +952,39 @@ class KnapsackDynamicProgrammingSolver : public BaseKnapsackSolver {
   bool best_solution(int item_id) const { return best_solution_.at(item_id); }
 
  private:
+  // A non-dominated packing of the first items, in SolveWithParetoLists().
+  struct ParetoState {
+    int64 weight;
+    int64 profit;
+    // The index in pareto_states_ of the packing of the preceding items it
+    // extends, or -1 for the empty packing.
+    int parent;
+    // True if the packing contains its item, i.e. differs from its parent.
+    bool item_packed;
+  };
+
   int64 SolveSubProblem(int64 capacity, int num_items);
 
+  // Solves the problem with the Nemhauser-Ullmann algorithm: for each prefix
+  // of the items, computes the list of the packings that are not dominated
+  // (i.e. no other packing is lighter and at least as profitable), sorted by
+  // increasing weight. The size of these lists does not depend on the
+  // capacity, which makes them much smaller than the DP table when the
+  // capacity is large and the items are few.
+  // Gives up and returns false as soon as the lists hold more than
+  // max_num_states packings in total.
+  bool SolveWithParetoLists(int64 max_num_states);
+
   std::vector<int64> profits_;
   std::vector<int64> weights_;
   int64 capacity_;
+  // The buffers are kept across calls to Init() and Solve() to avoid
+  // reallocating them when many problems are solved in a row.
   std::vector<int64> computed_profits_;
   std::vector<int> selected_item_ids_;
+  std::vector<ParetoState> pareto_states_;
   std::vector<bool> best_solution_;
+  int64 best_profit_;
 };
 
 // ----- KnapsackDynamicProgrammingSolver -----
@@ -940,7 +996,9 @@ KnapsackDynamicProgrammingSolver::KnapsackDynamicProgrammingSolver(
       capacity_(0),
       computed_profits_(),
       selected_item_ids_(),
-      best_solution_() {}
+      pareto_states_(),
+      best_solution_(),
+      best_profit_(0) {}
 
 void KnapsackDynamicProgrammingSolver::Init(
     const std::vector<int64>& profits, const std::vector<std::vector<int64> >& weights,
@@ -976,17 +1034,104 @@ int64 KnapsackDynamicProgrammingSolver::SolveSubProblem(int64 capacity,
   return selected_item_ids_.at(capacity);
 }
 
+bool KnapsackDynamicProgrammingSolver::SolveWithParetoLists(
+    int64 max_num_states) {
+  const int num_items = profits_.size();
+  pareto_states_.clear();
+  // The list of the preceding items is [list_begin, list_end) in
+  // pareto_states_. It starts with the empty packing.
+  pareto_states_.push_back({0, 0, -1, false});
+  int list_begin = 0;
+  int list_end = 1;
+  for (int item_id = 0; item_id < num_items; ++item_id) {
+    const int64 item_weight = weights_[item_id];
+    const int64 item_profit = profits_[item_id];
+    // Merges the list with its copy where the item is packed, both sorted by
+    // increasing weight, keeping only the packings more profitable than all
+    // the lighter ones.
+    int without_item = list_begin;
+    int with_item = list_begin;
+    for (;;) {
+      const bool with_item_fits =
+          with_item < list_end &&
+          pareto_states_[with_item].weight + item_weight <= capacity_;
+      if (without_item == list_end && !with_item_fits) break;
+      ParetoState state;
+      if (!with_item_fits ||
+          (without_item < list_end &&
+           pareto_states_[without_item].weight <=
+               pareto_states_[with_item].weight + item_weight)) {
+        state = pareto_states_[without_item];
+        state.parent = without_item;
+        state.item_packed = false;
+        ++without_item;
+      } else {
+        state = pareto_states_[with_item];
+        state.weight += item_weight;
+        state.profit += item_profit;
+        state.parent = with_item;
+        state.item_packed = true;
+        ++with_item;
+      }
+      const int new_list_size = pareto_states_.size() - list_end;
+      if (new_list_size > 0) {
+        ParetoState* const last = &pareto_states_.back();
+        if (state.profit <= last->profit) continue;
+        // Same weight, more profit: the last packing is dominated.
+        if (state.weight == last->weight) {
+          *last = state;
+          continue;
+        }
+      }
+      if (pareto_states_.size() >= max_num_states) return false;
+      pareto_states_.push_back(state);
+    }
+    list_begin = list_end;
+    list_end = pareto_states_.size();
+  }
+
+  // The last packing of the list is the most profitable one.
+  best_solution_.assign(num_items, false);
+  int state_index = list_end - 1;
+  best_profit_ = pareto_states_[state_index].profit;
+  for (int item_id = num_items - 1; item_id >= 0; --item_id) {
+    const ParetoState& state = pareto_states_[state_index];
+    best_solution_[item_id] = state.item_packed;
+    state_index = state.parent;
+  }
+  DCHECK_EQ(0, state_index);
+  return true;
+}
+
 int64 KnapsackDynamicProgrammingSolver::Solve() {
+  // The Pareto lists are given as many states as the DP table has entries,
+  // so they never use more memory than the DP.
+  if (capacity_ >= kMinCapacityForParetoLists &&
+      SolveWithParetoLists(
+          std::min<int64>(capacity_ + 1, std::numeric_limits<int>::max()))) {
+    return best_profit_;
+  }
+
   const int64 capacity_plus_1 = capacity_ + 1;
-  selected_item_ids_.assign(capacity_plus_1, 0);
-  computed_profits_.assign(capacity_plus_1, 0LL);
+  selected_item_ids_.resize(capacity_plus_1);
+  computed_profits_.resize(capacity_plus_1);
 
   int64 remaining_capacity = capacity_;
   int num_items = profits_.size();
   best_solution_.assign(num_items, false);
 
-  while (remaining_capacity > 0 && num_items > 0) {
+  // Items of weight zero can still be packed when the remaining capacity is
+  // zero, hence the non-strict inequality. Such items leave the capacity
+  // unchanged, so the profit is read after the first sub-problem, before the
+  // next ones overwrite computed_profits_[capacity_].
+  best_profit_ = 0;
+  bool first_sub_problem = true;
+  while (remaining_capacity >= 0 && num_items > 0) {
     const int selected_item_id = SolveSubProblem(remaining_capacity, num_items);
+    if (first_sub_problem) {
+      best_profit_ = computed_profits_[capacity_];
+      first_sub_problem = false;
+    }
     remaining_capacity -= weights_[selected_item_id];
     num_items = selected_item_id;
     if (remaining_capacity >= 0) {
@@ -994,7 +1139,7 @@ int64 KnapsackDynamicProgrammingSolver::Solve() {
     }
   }
 
-  return computed_profits_[capacity_];
+  return best_profit_;
 }
 
 // ----- KnapsackMIPSolver -----
@@ -1079,7 +1224,9 @@ int64 KnapsackMIPSolver::Solve() {
 
 // ----- KnapsackSolver -----
 KnapsackSolver::KnapsackSolver(const std::string& solver_name)
-    : solver_(new KnapsackGenericSolver(solver_name)),
+    : solver_type_(KNAPSACK_MULTIDIMENSION_BRANCH_AND_BOUND_SOLVER),
+      solver_(new KnapsackGenericSolver(solver_name)),
+      batch_solvers_(),
       known_value_(),
       best_solution_(),
       mapping_reduced_item_id_(),
@@ -1089,7 +1236,9 @@ KnapsackSolver::KnapsackSolver(const std::string& solver_name)
 
 KnapsackSolver::KnapsackSolver(SolverType solver_type,
                                const std::string& solver_name)
-    : solver_(),
+    : solver_type_(solver_type),
+      solver_(),
+      batch_solvers_(),
       known_value_(),
       best_solution_(),
       mapping_reduced_item_id_(),
@@ -1250,6 +1399,55 @@ bool KnapsackSolver::BestSolutionContains(int item_id) const {
 
 std::string KnapsackSolver::GetName() const { return solver_->GetName(); }
 
+void KnapsackSolver::SolveBatch(
+    const std::vector<std::vector<int64> >& profits_batch,
+    const std::vector<std::vector<int64> >& weights,
+    const std::vector<int64>& capacities, int num_threads,
+    std::vector<int64>* best_profits,
+    std::vector<std::vector<bool> >* best_solutions) {
+  CHECK_LE(1, num_threads);
+  const int num_problems = profits_batch.size();
+  best_profits->resize(num_problems);
+  best_solutions->resize(num_problems);
+  num_threads = std::min(num_threads, num_problems);
+  while (static_cast<int>(batch_solvers_.size()) + 1 < num_threads) {
+    batch_solvers_.emplace_back(new KnapsackSolver(solver_type_, GetName()));
+  }
+  std::atomic<int> next_problem(0);
+  std::vector<std::thread> threads;
+  for (int thread = 1; thread < num_threads; ++thread) {
+    KnapsackSolver* const solver = batch_solvers_[thread - 1].get();
+    solver->set_use_reduction(use_reduction_);
+    threads.emplace_back(&KnapsackSolver::SolveBatchProblems, solver,
+                         &profits_batch, &weights, &capacities, &next_problem,
+                         best_profits, best_solutions);
+  }
+  SolveBatchProblems(&profits_batch, &weights, &capacities, &next_problem,
+                     best_profits, best_solutions);
+  for (std::thread& thread : threads) thread.join();
+}
+
+void KnapsackSolver::SolveBatchProblems(
+    const std::vector<std::vector<int64> >* profits_batch,
+    const std::vector<std::vector<int64> >* weights,
+    const std::vector<int64>* capacities, std::atomic<int>* next_problem,
+    std::vector<int64>* best_profits,
+    std::vector<std::vector<bool> >* best_solutions) {
+  const int num_problems = profits_batch->size();
+  for (;;) {
+    const int problem = (*next_problem)++;
+    if (problem >= num_problems) return;
+    const std::vector<int64>& profits = (*profits_batch)[problem];
+    Init(profits, *weights, *capacities);
+    (*best_profits)[problem] = Solve();
+    std::vector<bool>* const solution = &(*best_solutions)[problem];
+    solution->resize(profits.size());
+    for (int item_id = 0; item_id < profits.size(); ++item_id) {
+      (*solution)[item_id] = BestSolutionContains(item_id);
+    }
+  }
+}
+
 // ----- BaseKnapsackSolver -----
 void BaseKnapsackSolver::GetLowerAndUpperBoundWhenItem(int item_id,
                                                        bool is_item_in,
@@ -58,6 +58,7 @@
 #define OR_TOOLS_ALGORITHMS_KNAPSACK_SOLVER_H_
 
 #include <math.h>
+#include <atomic>
 #include "base/unique_ptr.h"
 #include <string>
 #include <vector>
@@ -82,8 +83,11 @@ namespace operations_research {
 //    solver uses a branch & bound algorithm. This solver is about 4 times
 //    faster than KNAPSACK_MULTIDIMENSION_SOLVER.
 //  - KNAPSACK_DYNAMIC_PROGRAMMING_SOLVER: Limited to one dimension, this solver
-//    is based on a dynamic programming algorithm. The time and space
-//    complexity is O(capacity * number_of_items).
+//    is based on a dynamic programming algorithm. The time complexity is
+//    O(capacity * number_of_items) and the space complexity O(capacity).
+//    When the capacity is large, it first tries the Nemhauser-Ullmann
+//    algorithm, whose complexity depends on the number of non-dominated
+//    packings instead of the capacity.
 //  - KNAPSACK_MULTIDIMENSION_BRANCH_AND_BOUND_SOLVER: This solver can deal
 //    with both large number of items and several dimensions. This solver is
 //    based on branch and bound.
@@ -137,6 +141,20 @@ class KnapsackSolver {
   bool BestSolutionContains(int item_id) const;
   std::string GetName() const;
 
+  // Solves one problem per profit vector of 'profits_batch', all with the
+  // same weights and capacities, as the pricing problems of a column
+  // generation. Fills (*best_profits)[i] with the optimal profit of problem i
+  // and (*best_solutions)[i][item_id] with BestSolutionContains(item_id).
+  // The problems are solved by num_threads solvers of the same type working
+  // in parallel. The solvers, and their buffers, are kept from one batch to
+  // the next. After the call, this solver holds an unspecified problem of the
+  // batch: Init() must be called again before Solve().
+  void SolveBatch(const std::vector<std::vector<int64> >& profits_batch,
+                  const std::vector<std::vector<int64> >& weights,
+                  const std::vector<int64>& capacities, int num_threads,
+                  std::vector<int64>* best_profits,
+                  std::vector<std::vector<bool> >* best_solutions);
+
   bool use_reduction() const { return use_reduction_; }
   void set_use_reduction(bool use_reduction) { use_reduction_ = use_reduction; }
 
@@ -147,7 +165,19 @@ class KnapsackSolver {
                           const std::vector<std::vector<int64> >& weights,
                           const std::vector<int64>& capacities);
 
+  // Solves the problems of the batch, taking the index of the next one to
+  // solve from 'next_problem', until there are none left.
+  void SolveBatchProblems(const std::vector<std::vector<int64> >* profits_batch,
+                          const std::vector<std::vector<int64> >* weights,
+                          const std::vector<int64>* capacities,
+                          std::atomic<int>* next_problem,
+                          std::vector<int64>* best_profits,
+                          std::vector<std::vector<bool> >* best_solutions);
+
+  const SolverType solver_type_;
   std::unique_ptr<BaseKnapsackSolver> solver_;
+  // The additional solvers used by SolveBatch() with several threads.
+  std::vector<std::unique_ptr<KnapsackSolver> > batch_solvers_;
   std::vector<bool> known_value_;
   std::vector<bool> best_solution_;
   std::vector<int> mapping_reduced_item_id_;
@@ -233,6 +263,12 @@ class KnapsackSearchNode {
  public:
   KnapsackSearchNode(const KnapsackSearchNode* const parent,
                      const KnapsackAssignment& assignment);
+
+  // Puts the node back in the state given by the constructor, so that it can
+  // be reused instead of allocating a new node.
+  void Reset(const KnapsackSearchNode* const parent,
+             const KnapsackAssignment& assignment);
+
   int depth() const { return depth_; }
   const KnapsackSearchNode* const parent() const { return parent_; }
   const KnapsackAssignment& assignment() const { return assignment_; }
@@ -250,7 +286,7 @@ class KnapsackSearchNode {
   // 'depth' field is used to navigate efficiently through the search tree
   // (see KnapsackSearchPath).
   int depth_;
-  const KnapsackSearchNode* const parent_;
+  const KnapsackSearchNode* parent_;
   KnapsackAssignment assignment_;
 
   // 'current_profit' and 'profit_upper_bound' fields are used to sort search
@@ -543,6 +579,11 @@ class KnapsackGenericSolver : public BaseKnapsackSolver {
   // means this node should be added to the search queue too.
   bool MakeNewNode(const KnapsackSearchNode& node, bool is_in);
 
+  // Returns a search node with the given parent and assignment, reusing one
+  // of the nodes of the previous searches when possible.
+  KnapsackSearchNode* NewSearchNode(const KnapsackSearchNode* const parent,
+                                    const KnapsackAssignment& assignment);
+
   // Gets the aggregated (min) profit upper bound among all propagators.
   int64 GetAggregatedProfitUpperBound() const;
   bool HasOnePropagator() const { return propagators_.size() == 1; }
@@ -555,7 +596,10 @@ class KnapsackGenericSolver : public BaseKnapsackSolver {
 
   std::vector<KnapsackPropagator*> propagators_;
   int master_propagator_id_;
+  // The search nodes. Only the first num_search_nodes_ ones are used by the
+  // current search: the others are kept from previous searches, to be reused.
   std::vector<KnapsackSearchNode*> search_nodes_;
+  int num_search_nodes_;
   KnapsackState state_;
   int64 best_solution_profit_;
   std::vector<bool> best_solution_;
@@ -0,0 +1,201 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef OR_TOOLS_BASE_ADJUSTABLE_K_ARY_HEAP_H_
+#define OR_TOOLS_BASE_ADJUSTABLE_K_ARY_HEAP_H_
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace operations_research {
+
+// An alternative to AdjustablePriorityQueue for elements identified by an
+// integer id in [0, n), e.g. variables or nodes. Like AdjustablePriorityQueue,
+// Top() is the element with the largest priority, and the priority of an
+// element can be changed while it is in the heap.
+//
+// The heap stores (priority, id) pairs contiguously in a kArity-ary heap,
+// and the position of each id in a separate array, instead of pointers to
+// elements that store their own heap index. Comparisons thus do not
+// dereference the elements, and with kArity = 4 the children of a node
+// share one cache line (for 8-byte priorities and 4-byte ids) while the
+// heap depth is halved. Replacing:
+//   AdjustablePriorityQueue<Element> pq;      // Element has a priority and id.
+//   pq.Add(&elements[id]);                    ->  heap.Add(id, priority);
+//   pq.NoteChangedPriority(&elements[id]);    ->  heap.ChangePriority(id, p);
+//   pq.Remove(&elements[id]);                 ->  heap.Remove(id);
+//   pq.Contains(&elements[id]);               ->  heap.Contains(id);
+//   pq.Top()->id;                             ->  heap.Top();
+// Index must be an integral type, and Less a strict weak ordering on Priority.
+template <typename Priority, typename Index = int, int kArity = 4,
+          typename Less = std::less<Priority> >
+class AdjustableKAryHeap {
+ public:
+  AdjustableKAryHeap() {}
+  explicit AdjustableKAryHeap(const Less& less) : less_(less) {}
+
+  // Reserves the memory for num_elements elements with ids in
+  // [0, num_elements). This is optional, the heap grows as needed.
+  void Reserve(Index num_elements) {
+    heap_.reserve(num_elements);
+    if (num_elements > positions_.size()) {
+      positions_.resize(num_elements, kNotInHeap);
+    }
+  }
+
+  // Adds the element id, which must not be in the heap, with the given
+  // priority.
+  void Add(Index id, Priority priority) {
+    DCHECK_GE(id, 0);
+    if (id >= positions_.size()) positions_.resize(id + 1, kNotInHeap);
+    DCHECK(!Contains(id));
+    const Element element(priority, id);
+    heap_.push_back(element);
+    SiftUp(heap_.size() - 1, element);
+  }
+
+  // Removes the element id, which must be in the heap.
+  void Remove(Index id) {
+    DCHECK(Contains(id));
+    const int i = positions_[id];
+    positions_[id] = kNotInHeap;
+    const Element last = heap_.back();
+    heap_.pop_back();
+    if (i == heap_.size()) return;
+    Place(i, last);
+  }
+
+  bool Contains(Index id) const {
+    return id >= 0 && id < positions_.size() && positions_[id] != kNotInHeap;
+  }
+
+  // Changes the priority of the element id, which must be in the heap.
+  void ChangePriority(Index id, Priority priority) {
+    DCHECK(Contains(id));
+    Place(positions_[id], Element(priority, id));
+  }
+
+  // Returns the priority of the element id, which must be in the heap.
+  Priority GetPriority(Index id) const {
+    DCHECK(Contains(id));
+    return heap_[positions_[id]].priority;
+  }
+
+  // Returns the id and the priority of the largest element. The heap must not
+  // be empty.
+  Index Top() const {
+    DCHECK(!IsEmpty());
+    return heap_[0].id;
+  }
+  Priority TopPriority() const {
+    DCHECK(!IsEmpty());
+    return heap_[0].priority;
+  }
+
+  void Pop() { Remove(Top()); }
+
+  int Size() const { return heap_.size(); }
+
+  bool IsEmpty() const { return heap_.empty(); }
+
+  // Removes all the elements, in O(Size()).
+  void Clear() {
+    for (const Element& element : heap_) positions_[element.id] = kNotInHeap;
+    heap_.clear();
+  }
+
+  // Returns the id of the element at position i in [0, Size()) of the heap,
+  // e.g. to pick a random element.
+  Index IdAt(int i) const { return heap_[i].id; }
+
+  void CheckValid() const {
+    for (int i = 0; i < heap_.size(); ++i) {
+      CHECK_EQ(i, positions_[heap_[i].id]);
+      if (i > 0) {
+        CHECK(!less_(heap_[Parent(i)].priority, heap_[i].priority));
+      }
+    }
+  }
+
+ private:
+  struct Element {
+    Element(Priority p, Index i) : priority(p), id(i) {}
+    Priority priority;
+    Index id;
+  };
+
+  enum { kNotInHeap = -1 };
+
+  static int Parent(int i) { return (i - 1) / kArity; }
+
+  // Puts element at position i, then restores the heap property.
+  void Place(int i, const Element& element) {
+    if (i > 0 && less_(heap_[Parent(i)].priority, element.priority)) {
+      SiftUp(i, element);
+    } else {
+      SiftDown(i, element);
+    }
+  }
+
+  // Both functions move the "hole" at position i until element can be put
+  // there, and only write element once, at its final position.
+  void SiftUp(int i, const Element& element) {
+    while (i > 0) {
+      const int parent = Parent(i);
+      if (!less_(heap_[parent].priority, element.priority)) break;
+      heap_[i] = heap_[parent];
+      positions_[heap_[i].id] = i;
+      i = parent;
+    }
+    heap_[i] = element;
+    positions_[element.id] = i;
+  }
+
+  void SiftDown(int i, const Element& element) {
+    const int size = heap_.size();
+    while (true) {
+      const int first_child = kArity * i + 1;
+      if (first_child >= size) break;
+      const int end_child = std::min(first_child + kArity, size);
+      int best_child = first_child;
+      for (int child = first_child + 1; child < end_child; ++child) {
+        if (less_(heap_[best_child].priority, heap_[child].priority)) {
+          best_child = child;
+        }
+      }
+      if (!less_(element.priority, heap_[best_child].priority)) break;
+      heap_[i] = heap_[best_child];
+      positions_[heap_[i].id] = i;
+      i = best_child;
+    }
+    heap_[i] = element;
+    positions_[element.id] = i;
+  }
+
+  Less less_;
+  std::vector<Element> heap_;
+  // Position of each id in heap_, or kNotInHeap.
+  std::vector<int> positions_;
+
+  DISALLOW_COPY_AND_ASSIGN(AdjustableKAryHeap);
+};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_BASE_ADJUSTABLE_K_ARY_HEAP_H_
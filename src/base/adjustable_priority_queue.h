@@ -23,6 +23,9 @@
 
 namespace operations_research {
 
+// Binary max-heap of pointers to elements of type T, which must provide
+// operator<, SetHeapIndex(int) and GetHeapIndex(). For elements identified by
+// integer ids, AdjustableKAryHeap in base/adjustable_k_ary_heap.h is faster.
 template <typename T>
 class AdjustablePriorityQueue {
  public:
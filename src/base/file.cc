@@ -18,6 +18,8 @@
 #define access _access
 #define F_OK 0
 #else
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -45,6 +47,22 @@ size_t File::Size() {
 
 bool File::Flush() { return fflush(f_) == 0; }
 
+bool File::Seek(int64 position) {
+#if defined(_MSC_VER)
+  return _fseeki64(f_, position, SEEK_SET) == 0;
+#else
+  return fseeko(f_, position, SEEK_SET) == 0;
+#endif
+}
+
+int64 File::Tell() {
+#if defined(_MSC_VER)
+  return _ftelli64(f_);
+#else
+  return ftello(f_);
+#endif
+}
+
 bool File::Close() {
   if (fclose(f_) == 0) {
     f_ = NULL;
@@ -129,13 +147,124 @@ bool File::Open() const { return f_ != NULL; }
 
 void File::Init() {}
 
+// ----- MappedFile -----
+
+MappedFile::MappedFile(const std::string& name)
+    : name_(name), data_(nullptr), size_(0), mapped_(false) {}
+
+MappedFile::~MappedFile() {
+#if !defined(_MSC_VER)
+  if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+}
+
+MappedFile* MappedFile::Open(const std::string& name, bool sequential_access) {
+  std::unique_ptr<MappedFile> mapped_file(new MappedFile(name));
+#if !defined(_MSC_VER)
+  const int fd = open(name.c_str(), O_RDONLY);
+  struct stat file_stat;
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+    if (fd >= 0) close(fd);
+    return nullptr;
+  }
+  const size_t size = file_stat.st_size;
+  // Empty files cannot be mapped, and special files (pipes, ...) must be read.
+  void* const data = size == 0 || !S_ISREG(file_stat.st_mode)
+                         ? MAP_FAILED
+                         : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data != MAP_FAILED) {
+    madvise(data, size, sequential_access ? MADV_SEQUENTIAL : MADV_RANDOM);
+    mapped_file->data_ = static_cast<const char*>(data);
+    mapped_file->size_ = size;
+    mapped_file->mapped_ = true;
+    return mapped_file.release();
+  }
+#endif
+  // Fall back to reading the whole file.
+  std::unique_ptr<File> file(File::Open(name, "rb"));
+  if (file == nullptr) return nullptr;
+  std::string content;
+  const int64 read = file->ReadToString(&content, kint64max);
+  file->Close();
+  if (read < 0) return nullptr;
+  mapped_file->buffer_.reset(new int64[content.size() / sizeof(int64) + 1]);
+  memcpy(mapped_file->buffer_.get(), content.data(), content.size());
+  mapped_file->data_ =
+      reinterpret_cast<const char*>(mapped_file->buffer_.get());
+  mapped_file->size_ = content.size();
+  return mapped_file.release();
+}
+
+// ----- BufferedFileWriter -----
+
+BufferedFileWriter::BufferedFileWriter(File* const file)
+    : BufferedFileWriter(file, kDefaultBufferSize) {}
+
+BufferedFileWriter::BufferedFileWriter(File* const file, size_t buffer_size)
+    : file_(file),
+      buffer_(new char[buffer_size]),
+      capacity_(buffer_size),
+      size_(0),
+      bytes_written_(0),
+      ok_(file != nullptr) {
+  CHECK_GT(buffer_size, 0);
+}
+
+BufferedFileWriter::~BufferedFileWriter() {
+  if (file_ != nullptr) Close();
+}
+
+bool BufferedFileWriter::Write(const void* const buff, size_t size) {
+  if (!ok_) return false;
+  bytes_written_ += size;
+  if (size_ + size <= capacity_) {
+    memcpy(buffer_.get() + size_, buff, size);
+    size_ += size;
+    return true;
+  }
+  if (!FlushBuffer()) return false;
+  if (size >= capacity_) {
+    // Large writes bypass the buffer.
+    ok_ = file_->Write(buff, size) == size;
+    return ok_;
+  }
+  memcpy(buffer_.get(), buff, size);
+  size_ = size;
+  return true;
+}
+
+bool BufferedFileWriter::FlushBuffer() {
+  if (size_ > 0) {
+    ok_ = ok_ && file_->Write(buffer_.get(), size_) == size_;
+    size_ = 0;
+  }
+  return ok_;
+}
+
+bool BufferedFileWriter::Flush() {
+  if (!FlushBuffer()) return false;
+  ok_ = file_->Flush();
+  return ok_;
+}
+
+bool BufferedFileWriter::Close() {
+  if (file_ == nullptr) return false;
+  FlushBuffer();
+  ok_ = file_->Close() && ok_;
+  delete file_;
+  file_ = nullptr;
+  return ok_;
+}
+
 namespace file {
 util::Status GetContents(const std::string& filename, std::string* output, int flags) {
   if (flags == Defaults()) {
-    File* file = File::Open(filename, "r");
+    std::unique_ptr<File> file(File::Open(filename, "r"));
     if (file != NULL) {
       const int64 size = file->Size();
-      if (file->ReadToString(output, size) == size) return util::Status::OK;
+      const bool read_ok = file->ReadToString(output, size) == size;
+      if (file->Close() && read_ok) return util::Status::OK;
     }
   }
   return util::Status(util::error::INVALID_ARGUMENT,
@@ -153,7 +282,13 @@ util::Status WriteString(File* file, const std::string& contents, int flags) {
 
 util::Status SetContents(const std::string& filename, const std::string& contents,
                          int flags) {
-  return WriteString(File::Open(filename, "w"), contents, flags);
+  std::unique_ptr<File> file(File::Open(filename, "w"));
+  util::Status status = WriteString(file.get(), contents, flags);
+  if (file != nullptr && !file->Close() && status.ok()) {
+    status = util::Status(util::error::INVALID_ARGUMENT,
+                          StrCat("Could not close '", filename, "'"));
+  }
+  return status;
 }
 
 bool ReadFileToString(const std::string& file_name, std::string* output) {
@@ -20,6 +20,8 @@
 
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/macros.h"
+#include "base/unique_ptr.h"
 #include "google/protobuf/descriptor.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/text_format.h"
@@ -89,6 +91,13 @@ class File {
   // Returns file size.
   size_t Size();
 
+  // Moves the read/write position to "position" bytes from the start of the
+  // file. Returns false on error.
+  bool Seek(int64 position);
+
+  // Returns the current read/write position, or -1 on error.
+  int64 Tell();
+
   // Inits internal data structures.
   static void Init();
 
@@ -110,6 +119,87 @@ class File {
   const std::string name_;
 };
 
+// Read-only view of the whole content of a file, meant for parsers that scan
+// large inputs. When the platform supports it, the file is memory-mapped (and,
+// for sequential access, the kernel is told to read ahead aggressively), so
+// that reading costs neither a copy nor a system call per chunk. Otherwise,
+// or if mapping fails, the file is read at once into a buffer. In both cases
+// data() is aligned on at least 8 bytes.
+class MappedFile {
+ public:
+  // Returns nullptr if the file cannot be opened or read. If
+  // sequential_access is true, the pages are expected to be read in order,
+  // once. The caller takes ownership.
+  static MappedFile* Open(const std::string& name, bool sequential_access);
+  static MappedFile* Open(const std::string& name) { return Open(name, true); }
+
+  ~MappedFile();
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& filename() const { return name_; }
+
+  // Returns true if the file is memory-mapped, false if it was read into a
+  // buffer.
+  bool is_mapped() const { return mapped_; }
+
+ private:
+  explicit MappedFile(const std::string& name);
+
+  const std::string name_;
+  const char* data_;
+  size_t size_;
+  bool mapped_;
+  // Without mmap(), the file is read in this buffer.
+  std::unique_ptr<int64[]> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+// Writer accumulating many small writes (e.g. the lines of an exported model
+// or profile) in a large buffer, and only passing them to the underlying File
+// when the buffer is full or when Flush() is called. Errors are sticky: once a
+// write failed, all the subsequent calls return false.
+class BufferedFileWriter {
+ public:
+  static const size_t kDefaultBufferSize = 1 << 20;
+
+  // Takes ownership of file, which must be open for writing, and closes it in
+  // Close() or in the destructor.
+  explicit BufferedFileWriter(File* const file);
+  BufferedFileWriter(File* const file, size_t buffer_size);
+
+  // Closes the file if Close() was not called.
+  ~BufferedFileWriter();
+
+  // Appends "size" bytes of buff, or a std::string, to the buffer.
+  bool Write(const void* const buff, size_t size);
+  bool WriteString(const std::string& data) {
+    return Write(data.data(), data.size());
+  }
+
+  // Writes the buffer content to the file and flushes the file.
+  bool Flush();
+
+  // Flushes and closes the file. The writer cannot be used afterwards.
+  bool Close();
+
+  // Returns the number of bytes accepted so far, flushed or not.
+  int64 bytes_written() const { return bytes_written_; }
+
+ private:
+  bool FlushBuffer();
+
+  File* file_;
+  std::unique_ptr<char[]> buffer_;
+  const size_t capacity_;
+  size_t size_;
+  int64 bytes_written_;
+  bool ok_;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferedFileWriter);
+};
+
 namespace file {
 inline int Defaults() { return 0xBABA; }
 
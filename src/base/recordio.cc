@@ -19,26 +19,178 @@
 
 namespace operations_research {
 const int RecordWriter::kMagicNumber = 0x3ed7230a;
+const int RecordWriter::kIndexMagicNumber = 0x3ed7230b;
+const int RecordWriter::kRecordsPerBlock = 64;
+
+namespace {
+// Size of the fixed part at the end of the index: the number of records,
+// records per block and blocks, and the closing magic number.
+const int64 kIndexTrailerSize = 3 * sizeof(uint64) + sizeof(int);
+// Maximum number of batches waiting for the background thread, to bound the
+// memory used when the records are produced faster than they are compressed.
+const int kMaxPendingBatches = 4;
+}  // namespace
 
 RecordWriter::RecordWriter(File* const file)
-    : file_(file), use_compression_(true) {}
+    : file_(file),
+      use_compression_(true),
+      compression_level_(Z_DEFAULT_COMPRESSION),
+      compress_in_background_(false),
+      write_index_(false),
+      closed_(false),
+      start_offset_(file->Tell()),
+      bytes_written_(0),
+      num_records_(0),
+      ok_(true),
+      stop_(false) {}
+
+// The file is not closed if Close() was not called, but all the records are
+// written.
+RecordWriter::~RecordWriter() { StopBackgroundWriter(); }
 
-bool RecordWriter::Close() { return file_->Close(); }
+bool RecordWriter::Close() {
+  StopBackgroundWriter();
+  closed_ = true;
+  if (write_index_ && ok_) ok_ = WriteIndex();
+  return file_->Close() && ok_;
+}
 
 void RecordWriter::set_use_compression(bool use_compression) {
   use_compression_ = use_compression;
 }
 
+void RecordWriter::set_compression_level(int level) {
+  CHECK(level == Z_DEFAULT_COMPRESSION || (level >= 1 && level <= 9));
+  compression_level_ = level;
+}
+
+void RecordWriter::set_compress_in_background(bool compress_in_background) {
+  CHECK_EQ(0, num_records_);
+  CHECK(thread_ == nullptr);
+  compress_in_background_ = compress_in_background;
+}
+
+void RecordWriter::set_write_index(bool write_index) {
+  if (write_index && start_offset_ < 0) {
+    LOG(WARNING) << "The position in " << file_->filename()
+                 << " is unknown, no index will be written.";
+    return;
+  }
+  write_index_ = write_index;
+}
+
+bool RecordWriter::WriteRecord(std::string* const record) {
+  DCHECK(!closed_);
+  if (!compress_in_background_) {
+    if (!WriteRecordToFile(*record)) ok_ = false;
+    return ok_;
+  }
+  if (thread_ == nullptr) {
+    thread_.reset(new std::thread(&RecordWriter::RunBackgroundWriter, this));
+  }
+  pending_.push_back(std::string());
+  pending_.back().swap(*record);
+  if (pending_.size() == kRecordsPerBlock) SubmitPendingBatch();
+  std::unique_lock<std::mutex> lock(mutex_);
+  return ok_;
+}
+
+void RecordWriter::StopBackgroundWriter() {
+  if (thread_ == nullptr) return;
+  SubmitPendingBatch();
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  condition_.notify_all();
+  thread_->join();
+  thread_.reset();
+}
+
+void RecordWriter::SubmitPendingBatch() {
+  if (pending_.empty()) return;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (batches_.size() >= kMaxPendingBatches) condition_.wait(lock);
+    batches_.push_back(Batch());
+    batches_.back().swap(pending_);
+  }
+  condition_.notify_all();
+}
+
+void RecordWriter::RunBackgroundWriter() {
+  for (;;) {
+    Batch batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (batches_.empty() && !stop_) condition_.wait(lock);
+      if (batches_.empty()) return;
+      batch.swap(batches_.front());
+      batches_.pop_front();
+    }
+    // Wakes up the producer waiting for some room in batches_.
+    condition_.notify_all();
+    bool ok = true;
+    for (const std::string& record : batch) {
+      ok = WriteRecordToFile(record) && ok;
+    }
+    if (!ok) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ok_ = false;
+    }
+  }
+}
+
+bool RecordWriter::WriteRecordToFile(const std::string& uncompressed) {
+  if (num_records_ % kRecordsPerBlock == 0) {
+    block_offsets_.push_back(start_offset_ + bytes_written_);
+  }
+  ++num_records_;
+  const uint64 uncompressed_size = uncompressed.size();
+  const std::string compressed_buffer =
+      use_compression_ ? Compress(uncompressed) : "";
+  const uint64 compressed_size = compressed_buffer.size();
+  const std::string& payload =
+      use_compression_ ? compressed_buffer : uncompressed;
+  bytes_written_ += sizeof(kMagicNumber) + sizeof(uncompressed_size) +
+                    sizeof(compressed_size) + payload.size();
+  return file_->Write(&kMagicNumber, sizeof(kMagicNumber)) ==
+             sizeof(kMagicNumber) &&
+         file_->Write(&uncompressed_size, sizeof(uncompressed_size)) ==
+             sizeof(uncompressed_size) &&
+         file_->Write(&compressed_size, sizeof(compressed_size)) ==
+             sizeof(compressed_size) &&
+         file_->Write(payload.data(), payload.size()) == payload.size();
+}
+
+bool RecordWriter::WriteIndex() {
+  const uint64 num_records = num_records_;
+  const uint64 records_per_block = kRecordsPerBlock;
+  const uint64 num_blocks = block_offsets_.size();
+  const size_t offsets_size = num_blocks * sizeof(uint64);
+  return file_->Write(&kIndexMagicNumber, sizeof(kIndexMagicNumber)) ==
+             sizeof(kIndexMagicNumber) &&
+         file_->Write(block_offsets_.data(), offsets_size) == offsets_size &&
+         file_->Write(&num_records, sizeof(num_records)) ==
+             sizeof(num_records) &&
+         file_->Write(&records_per_block, sizeof(records_per_block)) ==
+             sizeof(records_per_block) &&
+         file_->Write(&num_blocks, sizeof(num_blocks)) == sizeof(num_blocks) &&
+         file_->Write(&kIndexMagicNumber, sizeof(kIndexMagicNumber)) ==
+             sizeof(kIndexMagicNumber);
+}
+
 std::string RecordWriter::Compress(std::string const& s) const {
   const unsigned long source_size = s.size();  // NOLINT
   const char* source = s.c_str();
 
-  unsigned long dsize = source_size + (source_size * 0.1f) + 16;  // NOLINT
-  std::unique_ptr<char> destination(new char[dsize]);
-  // Use compress() from zlib.h.
+  unsigned long dsize = compressBound(source_size);  // NOLINT
+  std::unique_ptr<char[]> destination(new char[dsize]);
+  // Use compress2() from zlib.h.
   const int result =
-      compress(reinterpret_cast<unsigned char*>(destination.get()), &dsize,
-               reinterpret_cast<const unsigned char*>(source), source_size);
+      compress2(reinterpret_cast<unsigned char*>(destination.get()), &dsize,
+                reinterpret_cast<const unsigned char*>(source), source_size,
+                compression_level_);
 
   if (result != Z_OK) {
     LOG(FATAL) << "Compress error occured! Error code: " << result;
@@ -46,10 +198,111 @@ std::string RecordWriter::Compress(std::string const& s) const {
   return std::string(destination.get(), dsize);
 }
 
-RecordReader::RecordReader(File* const file) : file_(file) {}
+RecordReader::RecordReader(File* const file)
+    : file_(file),
+      index_loaded_(false),
+      num_records_(-1),
+      records_per_block_(0) {}
 
 bool RecordReader::Close() { return file_->Close(); }
 
+bool RecordReader::ReadHeader(uint64* const usize, uint64* const csize) {
+  int magic_number = 0;
+  if (file_->Read(&magic_number, sizeof(magic_number)) !=
+      sizeof(magic_number)) {
+    return false;
+  }
+  if (magic_number != RecordWriter::kMagicNumber) {
+    return false;
+  }
+  return file_->Read(usize, sizeof(*usize)) == sizeof(*usize) &&
+         file_->Read(csize, sizeof(*csize)) == sizeof(*csize);
+}
+
+bool RecordReader::ReadRecord(std::string* const record) {
+  uint64 usize = 0;
+  uint64 csize = 0;
+  if (!ReadHeader(&usize, &csize)) return false;
+  record->resize(usize);
+  if (csize != 0) {  // The data is compressed.
+    std::unique_ptr<char[]> compressed_buffer(new char[csize]);
+    if (file_->Read(compressed_buffer.get(), csize) != csize) {
+      return false;
+    }
+    if (usize > 0) {
+      Uncompress(compressed_buffer.get(), csize, &(*record)[0], usize);
+    }
+  } else if (usize > 0) {
+    if (file_->Read(&(*record)[0], usize) != usize) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool RecordReader::LoadIndex() {
+  if (index_loaded_) return num_records_ >= 0;
+  index_loaded_ = true;
+  const int64 file_size = file_->Size();
+  if (file_size < kIndexTrailerSize + sizeof(int)) return false;
+  uint64 num_records = 0;
+  uint64 records_per_block = 0;
+  uint64 num_blocks = 0;
+  int magic_number = 0;
+  if (!file_->Seek(file_size - kIndexTrailerSize) ||
+      file_->Read(&num_records, sizeof(num_records)) != sizeof(num_records) ||
+      file_->Read(&records_per_block, sizeof(records_per_block)) !=
+          sizeof(records_per_block) ||
+      file_->Read(&num_blocks, sizeof(num_blocks)) != sizeof(num_blocks) ||
+      file_->Read(&magic_number, sizeof(magic_number)) !=
+          sizeof(magic_number) ||
+      magic_number != RecordWriter::kIndexMagicNumber) {
+    return false;
+  }
+  const int64 index_start = file_size - kIndexTrailerSize -
+                            num_blocks * sizeof(uint64) - sizeof(int);
+  if (records_per_block == 0 || index_start < 0 ||
+      num_blocks !=
+          (num_records + records_per_block - 1) / records_per_block) {
+    return false;
+  }
+  std::vector<uint64> block_offsets(num_blocks);
+  const size_t offsets_size = num_blocks * sizeof(uint64);
+  if (!file_->Seek(index_start) ||
+      file_->Read(&magic_number, sizeof(magic_number)) !=
+          sizeof(magic_number) ||
+      magic_number != RecordWriter::kIndexMagicNumber ||
+      file_->Read(block_offsets.data(), offsets_size) != offsets_size) {
+    return false;
+  }
+  num_records_ = num_records;
+  records_per_block_ = records_per_block;
+  block_offsets_.swap(block_offsets);
+  return true;
+}
+
+int64 RecordReader::num_records() {
+  const int64 position = file_->Tell();
+  const bool has_index = LoadIndex();
+  file_->Seek(position);
+  return has_index ? num_records_ : -1;
+}
+
+bool RecordReader::SeekToRecord(int64 index) {
+  if (!LoadIndex() || index < 0 || index >= num_records_) return false;
+  if (!file_->Seek(block_offsets_[index / records_per_block_])) return false;
+  // Skips the records before index in its block.
+  for (int64 i = index % records_per_block_; i > 0; --i) {
+    uint64 usize = 0;
+    uint64 csize = 0;
+    if (!ReadHeader(&usize, &csize) ||
+        !file_->Seek(file_->Tell() + (csize != 0 ? csize : usize))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void RecordReader::Uncompress(const char* const source, uint64 source_size,
                               char* const output_buffer,
                               uint64 output_size) const {
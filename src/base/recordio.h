@@ -14,8 +14,16 @@
 #ifndef OR_TOOLS_BASE_RECORDIO_H_
 #define OR_TOOLS_BASE_RECORDIO_H_
 
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "base/file.h"
+#include "base/integral_types.h"
+#include "base/macros.h"
 #include "base/unique_ptr.h"
 
 // This file defines some IO interfaces to compatible with Google
@@ -29,55 +37,96 @@ namespace operations_research {
 //   data is not compressed.
 // - Payload, possibly compressed. See RecordWriter::Compress()
 //   and RecordReader::Uncompress
+//
+// If set_write_index(true) was called, Close() appends an index of the
+// records after the last one:
+// - IndexMagicNumber (32 bits).
+// - The file offset of the first record of each block of kRecordsPerBlock
+//   records (64 bits each).
+// - The number of records, kRecordsPerBlock and the number of blocks (64 bits
+//   each).
+// - IndexMagicNumber (32 bits).
+// Readers that do not know about the index stop at its first magic number, as
+// they would at the end of the file. RecordReader::SeekToRecord() uses it for
+// random access.
 class RecordWriter {
  public:
   // Magic number when writing and reading protocol buffers.
   static const int kMagicNumber;
+  // Magic number surrounding the index.
+  static const int kIndexMagicNumber;
+  // Number of records per block of the index, and per batch handed to the
+  // compression thread.
+  static const int kRecordsPerBlock;
 
   explicit RecordWriter(File* const file);
+  ~RecordWriter();
 
   template <class P>
   bool WriteProtocolMessage(const P& proto) {
     std::string uncompressed_buffer;
     proto.SerializeToString(&uncompressed_buffer);
-    const uint64 uncompressed_size = uncompressed_buffer.size();
-    const std::string compressed_buffer =
-        use_compression_ ? Compress(uncompressed_buffer) : "";
-    const uint64 compressed_size = compressed_buffer.size();
-    if (file_->Write(&kMagicNumber, sizeof(kMagicNumber)) !=
-        sizeof(kMagicNumber)) {
-      return false;
-    }
-    if (file_->Write(&uncompressed_size, sizeof(uncompressed_size)) !=
-        sizeof(uncompressed_size)) {
-      return false;
-    }
-    if (file_->Write(&compressed_size, sizeof(compressed_size)) !=
-        sizeof(compressed_size)) {
-      return false;
-    }
-    if (use_compression_) {
-      if (file_->Write(compressed_buffer.c_str(), compressed_size) !=
-          compressed_size) {
-        return false;
-      }
-    } else {
-      if (file_->Write(uncompressed_buffer.c_str(), uncompressed_size) !=
-          uncompressed_size) {
-        return false;
-      }
-    }
-    return true;
+    return WriteRecord(&uncompressed_buffer);
   }
-  // Closes the underlying file.
+
+  // Appends a serialized record. The content of record is consumed.
+  bool WriteRecord(std::string* const record);
+
+  // Writes the pending records and the index (if any), then closes the
+  // underlying file. Returns false if any write failed.
   bool Close();
 
   void set_use_compression(bool use_compression);
 
+  // Sets the zlib compression level, from 1 (fastest) to 9 (smallest). The
+  // default is the zlib default. All levels can be read by any reader.
+  void set_compression_level(int level);
+
+  // If true, the records are compressed and written by a background thread,
+  // in batches of kRecordsPerBlock records; WriteProtocolMessage() then only
+  // serializes the message. Write errors are reported by the later calls and
+  // by Close(). This must be set before the first record is written.
+  void set_compress_in_background(bool compress_in_background);
+
+  // If true, Close() writes an index enabling random access to the records.
+  void set_write_index(bool write_index);
+
  private:
+  typedef std::vector<std::string> Batch;
+
   std::string Compress(const std::string& input) const;
+  // Compresses (if needed) and writes one record, updating the index.
+  bool WriteRecordToFile(const std::string& uncompressed);
+  // Hands pending_ to the background thread.
+  void SubmitPendingBatch();
+  // Writes all the pending records and stops the background thread, if any.
+  void StopBackgroundWriter();
+  void RunBackgroundWriter();
+  bool WriteIndex();
+
   File* const file_;
   bool use_compression_;
+  int compression_level_;
+  bool compress_in_background_;
+  bool write_index_;
+  bool closed_;
+
+  // Written by the thread that writes to the file.
+  int64 start_offset_;
+  int64 bytes_written_;
+  int64 num_records_;
+  std::vector<uint64> block_offsets_;
+  bool ok_;
+
+  // Background compression.
+  Batch pending_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Batch> batches_;
+  bool stop_;
+  std::unique_ptr<std::thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordWriter);
 };
 
 // This class reads a protocol buffer from a file.
@@ -88,47 +137,41 @@ class RecordReader {
 
   template <class P>
   bool ReadProtocolMessage(P* const proto) {
-    uint64 usize = 0;
-    uint64 csize = 0;
-    int magic_number = 0;
-    if (file_->Read(&magic_number, sizeof(magic_number)) !=
-        sizeof(magic_number)) {
-      return false;
-    }
-    if (magic_number != RecordWriter::kMagicNumber) {
-      return false;
-    }
-    if (file_->Read(&usize, sizeof(usize)) != sizeof(usize)) {
-      return false;
-    }
-    if (file_->Read(&csize, sizeof(csize)) != sizeof(csize)) {
-      return false;
-    }
-    std::unique_ptr<char[]> buffer(new char[usize + 1]);
-    if (csize != 0) {  // The data is compressed.
-      std::unique_ptr<char[]> compressed_buffer(new char[csize + 1]);
-      if (file_->Read(compressed_buffer.get(), csize) != csize) {
-        return false;
-      }
-      compressed_buffer[csize] = '\0';
-      Uncompress(compressed_buffer.get(), usize, buffer.get(), usize);
-    } else {
-      if (file_->Read(buffer.get(), usize) != usize) {
-        return false;
-      }
-    }
-    proto->ParseFromArray(buffer.get(), usize);
+    std::string buffer;
+    if (!ReadRecord(&buffer)) return false;
+    proto->ParseFromArray(buffer.data(), buffer.size());
     return true;
   }
 
+  // Reads the next serialized record. Returns false at the end of the
+  // records.
+  bool ReadRecord(std::string* const record);
+
+  // Moves to the record of the given index (0 being the first record), so
+  // that it is the next one read. This needs the index written by
+  // RecordWriter::set_write_index(). Returns false if there is no index, or
+  // if index is out of range.
+  bool SeekToRecord(int64 index);
+
+  // Returns the number of records of the file if it has an index, -1
+  // otherwise.
+  int64 num_records();
+
   // Closes the underlying file.
   bool Close();
 
  private:
   void Uncompress(const char* const source, uint64 source_size,
                   char* const output_buffer, uint64 output_size) const;
+  bool ReadHeader(uint64* const usize, uint64* const csize);
+  // Loads the index on the first call, returns false if there is none.
+  bool LoadIndex();
 
   File* const file_;
+  bool index_loaded_;
+  int64 num_records_;
+  int64 records_per_block_;
+  std::vector<uint64> block_offsets_;
 };
 }  // namespace operations_research
 
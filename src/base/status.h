@@ -45,6 +45,7 @@ struct Status {
     return StrCat("ERROR #", error_code_, ": '", error_message_, "'");
   }
 
+  int error_code() const { return error_code_; }
   std::string error_message() const { return error_message_; }
 
   void IgnoreError() const {}
@@ -56,7 +57,7 @@ struct Status {
 
 }  // namespace util
 
-#define CHECK_OK(status) CHECK_EQ("", (status).ToString())
+#define CHECK_OK(status) CHECK((status).ok()) << (status).ToString()
 
 }  // namespace operations_research
 
@@ -13,18 +13,57 @@
 
 #include "base/threadpool.h"
 
+#include <algorithm>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "base/integral_types.h"
+
 namespace operations_research {
-void RunWorker(void* data) {
-  ThreadPool* const thread_pool = reinterpret_cast<ThreadPool*>(data);
-  Closure* work = thread_pool->GetNextTask();
-  while (work != NULL) {
-    work->Run();
-    work = thread_pool->GetNextTask();
+namespace {
+// The pool and index of the worker run by the current thread, if any.
+thread_local const ThreadPool* current_pool = NULL;
+thread_local int current_worker = -1;
+
+// Pins the calling thread to the index-th CPU (modulo their number) of the
+// ones it is allowed to run on.
+void PinCurrentThread(int index) {
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+  const int num_cpus = CPU_COUNT(&allowed);
+  if (num_cpus == 0) return;
+  int rank = index % num_cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &allowed) || rank-- > 0) continue;
+    cpu_set_t target;
+    CPU_ZERO(&target);
+    CPU_SET(cpu, &target);
+    pthread_setaffinity_np(pthread_self(), sizeof(target), &target);
+    return;
   }
+#endif
 }
+}  // namespace
 
 ThreadPool::ThreadPool(const std::string& prefix, int num_workers)
-    : num_workers_(num_workers), waiting_to_finish_(false), started_(false) {}
+    : num_workers_(num_workers),
+      queues_(),
+      num_queued_tasks_(0),
+      num_sleeping_workers_(0),
+      next_queue_(0),
+      waiting_to_finish_(false),
+      started_(false),
+      pin_workers_(false) {
+  // Tasks added to a pool without workers are queued, they can still be run
+  // by RunPendingTask().
+  for (int i = 0; i < std::max(1, num_workers_); ++i) {
+    queues_.emplace_back(new TaskQueue());
+  }
+}
 
 ThreadPool::~ThreadPool() {
   if (started_) {
@@ -41,33 +80,147 @@ ThreadPool::~ThreadPool() {
 void ThreadPool::StartWorkers() {
   started_ = true;
   for (int i = 0; i < num_workers_; ++i) {
-    all_workers_.push_back(std::thread(&RunWorker, this));
+    all_workers_.push_back(std::thread(&ThreadPool::RunWorker, this, i));
   }
 }
 
-Closure* ThreadPool::GetNextTask() {
-  std::unique_lock<std::mutex> lock(mutex_);
+void ThreadPool::RunWorker(int worker) {
+  if (pin_workers_) PinCurrentThread(worker);
+  current_pool = this;
+  current_worker = worker;
+  std::function<void()> task;
   for (;;) {
-    if (!tasks_.empty()) {
-      Closure* const task = tasks_.front();
-      tasks_.pop_front();
-      return task;
+    if (GetTask(worker, &task)) {
+      task();
+      continue;
     }
-    if (waiting_to_finish_) {
-      return NULL;
-    } else {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // A worker goes to sleep only after checking, while registered as
+    // sleeping, that no task is queued. Add() checks for sleeping workers
+    // after queueing its task, so one of them sees the other.
+    ++num_sleeping_workers_;
+    if (num_queued_tasks_ <= 0) {
+      if (waiting_to_finish_) {
+        --num_sleeping_workers_;
+        break;
+      }
       condition_.wait(lock);
     }
+    --num_sleeping_workers_;
+  }
+  current_pool = NULL;
+  current_worker = -1;
+}
+
+bool ThreadPool::GetTask(int worker, std::function<void()>* task) {
+  if (num_queued_tasks_ <= 0) return false;
+  const int num_queues = queues_.size();
+  if (worker >= 0) {
+    TaskQueue* const queue = queues_[worker].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      *task = std::move(queue->tasks.back());
+      queue->tasks.pop_back();
+      --num_queued_tasks_;
+      return true;
+    }
+  }
+  const int first = worker >= 0 ? worker + 1 : 0;
+  for (int i = 0; i < num_queues; ++i) {
+    TaskQueue* const queue = queues_[(first + i) % num_queues].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      *task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+      --num_queued_tasks_;
+      return true;
+    }
   }
-  return NULL;
+  return false;
+}
+
+bool ThreadPool::RunPendingTask() {
+  std::function<void()> task;
+  if (!GetTask(current_pool == this ? current_worker : -1, &task)) {
+    return false;
+  }
+  task();
+  return true;
 }
 
 void ThreadPool::Add(Closure* const closure) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  tasks_.push_back(closure);
-  if (started_) {
-    lock.unlock();
-    condition_.notify_all();
+  Add([closure]() { closure->Run(); });
+}
+
+void ThreadPool::Add(std::function<void()> task) {
+  const int queue_index = current_pool == this
+                              ? current_worker
+                              : next_queue_++ % queues_.size();
+  {
+    TaskQueue* const queue = queues_[queue_index].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->tasks.push_back(std::move(task));
+  }
+  ++num_queued_tasks_;
+  if (num_sleeping_workers_ > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    condition_.notify_one();
+  }
+}
+
+void ThreadPool::ParallelFor(int begin, int end, int grain,
+                             const std::function<void(int, int)>& function) {
+  if (begin >= end) return;
+  grain = std::max(1, grain);
+  const int64 num_chunks =
+      (static_cast<int64>(end) - begin + grain - 1) / grain;
+  std::atomic<int64> next_chunk(0);
+  const std::function<void()> run_chunks = [&]() {
+    for (;;) {
+      const int64 chunk = next_chunk++;
+      if (chunk >= num_chunks) return;
+      const int64 chunk_begin = begin + chunk * grain;
+      function(chunk_begin, std::min<int64>(end, chunk_begin + grain));
+    }
+  };
+  TaskGroup group(this);
+  const int num_helpers = std::min<int64>(num_workers_, num_chunks - 1);
+  for (int i = 0; i < num_helpers; ++i) {
+    group.Add(run_chunks);
+  }
+  run_chunks();
+  group.Wait();
+}
+
+TaskGroup::TaskGroup(ThreadPool* const pool)
+    : pool_(pool), num_pending_tasks_(0) {}
+
+TaskGroup::~TaskGroup() { Wait(); }
+
+void TaskGroup::Add(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++num_pending_tasks_;
   }
+  pool_->Add([this, task]() {
+    task();
+    // The counter is decremented under the lock, so that Wait() can't return
+    // and the group be destroyed before the notification is done.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--num_pending_tasks_ == 0) condition_.notify_all();
+  });
+}
+
+void TaskGroup::Wait() {
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (num_pending_tasks_ == 0) return;
+    }
+    if (!pool_->RunPendingTask()) break;
+  }
+  // No task is queued: the remaining tasks of the group are running.
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (num_pending_tasks_ > 0) condition_.wait(lock);
 }
 }  // namespace operations_research
@@ -11,15 +11,37 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+// A pool of worker threads running tasks.
+//
+// Each worker owns a deque of tasks: it runs the tasks it adds itself in LIFO
+// order, and when its deque is empty it steals the oldest task of another
+// worker. Tasks added from other threads are distributed in round-robin over
+// the workers. Threads waiting for tasks of the pool (TaskGroup::Wait(),
+// ParallelFor(), ...) run pending tasks instead of blocking, so a task can
+// itself wait for the tasks it created.
+//
+// Usage:
+//   ThreadPool pool("Name", num_threads);
+//   pool.StartWorkers();
+//   pool.Add(NewCallback(&Function, arg));
+//   std::future<int> result = pool.Schedule([]() { return 42; });
+//   pool.ParallelFor(0, n, 1024, [&](int begin, int end) { ... });
+//   // The destructor runs all the remaining tasks, then joins the workers.
+
 #ifndef OR_TOOLS_BASE_THREADPOOL_H_
 #define OR_TOOLS_BASE_THREADPOOL_H_
 
+#include <atomic>
 #include <condition_variable>  // NOLINT
-#include <list>
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
 #include <vector>
 #include <thread>  // NOLINT
+#include <type_traits>
 
 #include "base/callback.h"
 
@@ -29,18 +51,97 @@ class ThreadPool {
   explicit ThreadPool(const std::string& prefix, int num_threads);
   ~ThreadPool();
 
+  // Starts the workers. Tasks can be added before, they are then queued.
   void StartWorkers();
+
+  // If true, each worker is pinned to one CPU, worker i running on the i-th
+  // CPU (modulo their number) of the ones the process is allowed to use.
+  // The CPUs of a NUMA node are usually numbered consecutively, so the
+  // workers fill a node before using the next one, and the memory they
+  // allocate themselves is placed on their node by the first-touch policy of
+  // the kernel. Must be called before StartWorkers(). Only supported on
+  // Linux, this does nothing elsewhere.
+  void set_pin_workers(bool pin_workers) { pin_workers_ = pin_workers; }
+
+  // Adds a task to the pool. The pool takes ownership of the closure, which
+  // must be self-deleting as the ones returned by NewCallback().
   void Add(Closure* const closure);
-  Closure* GetNextTask();
+  void Add(std::function<void()> task);
+
+  // Adds a task to the pool and returns the future holding its result. Note
+  // that waiting for the future does not run pending tasks: it deadlocks if
+  // the workers are not started.
+  template <class Function>
+  std::future<typename std::result_of<Function()>::type> Schedule(
+      Function function) {
+    typedef typename std::result_of<Function()>::type Result;
+    std::shared_ptr<std::packaged_task<Result()> > task(
+        new std::packaged_task<Result()>(std::move(function)));
+    std::future<Result> result = task->get_future();
+    Add([task]() { (*task)(); });
+    return result;
+  }
+
+  // Calls function(chunk_begin, chunk_end) on consecutive chunks of
+  // [begin, end) of size 'grain' (the last one may be smaller), and returns
+  // when all the chunks are done. The chunks are run by the calling thread
+  // and by up to num_workers() workers.
+  void ParallelFor(int begin, int end, int grain,
+                   const std::function<void(int, int)>& function);
+
+  // Runs one pending task in the calling thread. Returns false if no task was
+  // pending.
+  bool RunPendingTask();
+
+  int num_workers() const { return num_workers_; }
 
  private:
+  // The tasks of a worker. The worker pushes and pops at the back, the
+  // others steal at the front.
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()> > tasks;
+  };
+
+  void RunWorker(int worker);
+  // Pops a task from the queue of 'worker', or steals one from another queue
+  // if it is empty. 'worker' is -1 for a thread which is not a worker.
+  bool GetTask(int worker, std::function<void()>* task);
+
   const int num_workers_;
-  std::list<Closure*> tasks_;
+  std::vector<std::unique_ptr<TaskQueue> > queues_;
+  // The number of tasks in all the queues, and the number of workers waiting
+  // on condition_ for a task to be added.
+  std::atomic<int> num_queued_tasks_;
+  std::atomic<int> num_sleeping_workers_;
+  // The queue receiving the next task added by a thread which is not a worker.
+  std::atomic<unsigned int> next_queue_;
   std::mutex mutex_;
   std::condition_variable condition_;
   bool waiting_to_finish_;
   bool started_;
+  bool pin_workers_;
   std::vector<std::thread> all_workers_;
 };
+
+// A set of tasks run by a ThreadPool, which can be waited for.
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool* const pool);
+  // Waits for the tasks of the group.
+  ~TaskGroup();
+
+  void Add(std::function<void()> task);
+
+  // Returns when all the tasks of the group are done, running pending tasks of
+  // the pool meanwhile.
+  void Wait();
+
+ private:
+  ThreadPool* const pool_;
+  int num_pending_tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
 }  // namespace operations_research
 #endif  // OR_TOOLS_BASE_THREADPOOL_H_
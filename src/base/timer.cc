@@ -13,8 +13,43 @@
 
 #include "base/timer.h"
 
+#include <mutex>  // NOLINT
+
 namespace operations_research {
 
+double CycleTimerBase::SecondsPerCycle() {
+#if defined(__x86_64__) || defined(__i386__)
+  static std::mutex mutex;
+  static int64 reference_cycles = 0;
+  static int64 reference_ns = 0;
+  static int64 last_calibration_ns = 0;
+  static double seconds_per_cycle = 0.0;
+  const int64 kRecalibrationPeriodNs = 1000000000;
+  const int64 kFirstCalibrationNs = 2000000;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (reference_ns == 0) {
+    reference_cycles = CycleClock::Now();
+    reference_ns = base::GetCurrentTimeNanos();
+    // Waits a little to get a first estimation of the frequency.
+    while (base::GetCurrentTimeNanos() - reference_ns < kFirstCalibrationNs) {
+    }
+  }
+  const int64 current_ns = base::GetCurrentTimeNanos();
+  if (seconds_per_cycle == 0.0 ||
+      current_ns - last_calibration_ns >= kRecalibrationPeriodNs) {
+    const int64 elapsed_cycles = CycleClock::Now() - reference_cycles;
+    if (elapsed_cycles > 0) {
+      seconds_per_cycle = 1e-9 * (current_ns - reference_ns) / elapsed_cycles;
+      last_calibration_ns = current_ns;
+    }
+  }
+  // The cycle counter can only stand still if it is broken.
+  return seconds_per_cycle > 0.0 ? seconds_per_cycle : 1e-9;
+#else
+  return 1e-9;
+#endif
+}
+
 ScopedWallTime::ScopedWallTime(double* aggregate_time)
     : aggregate_time_(aggregate_time), timer_() {
   DCHECK(aggregate_time != NULL);
@@ -13,6 +13,7 @@
 
 #include "bop/bop_base.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -265,6 +266,123 @@ bool StampedLearnedInfo::SatisfiesStampCondition(MutexConditionInfo* m) {
          m->learned_infos->LastStampReached();
 }
 
+//------------------------------------------------------------------------------
+// LearnedInfoExchange
+//------------------------------------------------------------------------------
+LearnedInfoExchange::LearnedInfoExchange(const LinearBooleanProblem& problem,
+                                         int num_solvers, int capacity)
+    : problem_(problem),
+      num_words_((problem.num_variables() + kBitsPerWord - 1) / kBitsPerWord),
+      clause_exchange_(num_solvers, capacity),
+      solution_slots_(new SolutionSlot[num_solvers]),
+      lower_bound_(kint64min),
+      search_done_(false),
+      last_published_costs_(num_solvers, kint64max),
+      solution_cursors_(num_solvers, std::vector<int64>(num_solvers, 0)) {
+  for (int i = 0; i < num_solvers; ++i) {
+    SolutionSlot& slot = solution_slots_[i];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.words.reset(new std::atomic<Word>[num_words_]);
+    for (int w = 0; w < num_words_; ++w) {
+      slot.words[w].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void LearnedInfoExchange::Publish(int solver_index,
+                                  const LearnedInfo& learned_info) {
+  std::vector<sat::Literal> clause(1);
+  for (const sat::Literal literal : learned_info.fixed_literals) {
+    clause[0] = literal;
+    clause_exchange_.Publish(solver_index, clause);
+  }
+  clause.resize(2);
+  for (const sat::BinaryClause& binary_clause : learned_info.binary_clauses) {
+    clause[0] = binary_clause.a;
+    clause[1] = binary_clause.b;
+    clause_exchange_.Publish(solver_index, clause);
+  }
+
+  int64 lower_bound = lower_bound_.load(std::memory_order_relaxed);
+  while (learned_info.lower_bound > lower_bound &&
+         !lower_bound_.compare_exchange_weak(lower_bound,
+                                             learned_info.lower_bound,
+                                             std::memory_order_relaxed)) {
+  }
+
+  const BopSolution& solution = learned_info.solution;
+  if (!solution.IsFeasible() ||
+      solution.GetCost() >= last_published_costs_[solver_index]) {
+    return;
+  }
+  last_published_costs_[solver_index] = solution.GetCost();
+
+  // This solver is the only writer of its slot, so there is no need to claim
+  // it as in sat::SharedClauseExchange::Publish().
+  SolutionSlot& slot = solution_slots_[solver_index];
+  const int64 sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  Word word = 0;
+  for (VariableIndex var(0); var < solution.Size(); ++var) {
+    const int bit = var.value() % kBitsPerWord;
+    if (solution.Value(var)) word |= Word(1) << bit;
+    if (bit == kBitsPerWord - 1 || var.value() + 1 == solution.Size()) {
+      slot.words[var.value() / kBitsPerWord].store(word,
+                                                   std::memory_order_relaxed);
+      word = 0;
+    }
+  }
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void LearnedInfoExchange::Fetch(int solver_index, LearnedInfo* learned_info) {
+  CHECK(nullptr != learned_info);
+  std::vector<std::vector<sat::Literal>> clauses;
+  clause_exchange_.Fetch(solver_index, &clauses);
+  for (const std::vector<sat::Literal>& clause : clauses) {
+    if (clause.size() == 1) {
+      learned_info->fixed_literals.push_back(clause[0]);
+    } else if (clause.size() == 2) {
+      learned_info->binary_clauses.push_back(
+          sat::BinaryClause(clause[0], clause[1]));
+    }
+  }
+
+  learned_info->lower_bound =
+      std::max(learned_info->lower_bound,
+               lower_bound_.load(std::memory_order_relaxed));
+
+  std::vector<int64>& cursors = solution_cursors_[solver_index];
+  std::vector<Word> words(num_words_);
+  BopSolution candidate(problem_, "SharedSolution");
+  for (int index = 0; index < cursors.size(); ++index) {
+    if (index == solver_index) continue;
+    const SolutionSlot& slot = solution_slots_[index];
+    const int64 sequence = slot.sequence.load(std::memory_order_acquire);
+    if ((sequence & 1) || sequence == cursors[index]) continue;
+    for (int w = 0; w < num_words_; ++w) {
+      words[w] = slot.words[w].load(std::memory_order_relaxed);
+    }
+
+    // Make sure the slot wasn't modified while we were reading it. If it was,
+    // the new solution will be read on the next call.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+    cursors[index] = sequence;
+
+    for (VariableIndex var(0); var < candidate.Size(); ++var) {
+      candidate.SetValue(var, (words[var.value() / kBitsPerWord] >>
+                               (var.value() % kBitsPerWord)) & 1);
+    }
+    if (candidate.IsFeasible() && (!learned_info->solution.IsFeasible() ||
+                                   candidate.GetCost() <
+                                       learned_info->solution.GetCost())) {
+      learned_info->solution = candidate;
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // BopOptimizerBase
 //------------------------------------------------------------------------------
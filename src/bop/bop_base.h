@@ -14,7 +14,10 @@
 #ifndef OR_TOOLS_BOP_BOP_BASE_H_
 #define OR_TOOLS_BOP_BOP_BASE_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/mutex.h"
@@ -24,6 +27,7 @@
 #include "sat/boolean_problem.pb.h"
 #include "sat/sat_base.h"
 #include "sat/clause.h"
+#include "sat/sat_portfolio.h"
 #include "util/stats.h"
 #include "util/time_limit.h"
 
@@ -297,6 +301,73 @@ class StampedLearnedInfo {
   mutable Mutex mutex_;
 };
 
+// Lock-free storage of LearnedInfo shared by all the solvers of a
+// multi-threaded BopSolver, used by the SYNCHRONIZE_ASYNCHRONOUSLY mode. Each
+// solver publishes what it learned after an optimizer run, and fetches what the
+// other solvers published since its last fetch. Neither operation ever waits
+// for another solver.
+//
+// The exchange is bounded and best effort, which is fine since all the
+// exchanged information can be learned again:
+//   - The fixed literals and the binary clauses are exchanged as unit and
+//     binary clauses through a sat::SharedClauseExchange, so they can be lost
+//     when a solver lags more than the buffer capacity behind the others.
+//   - Only the last solution published by each solver is kept, in a slot
+//     protected by a sequence number (a "seqlock").
+//   - The lower bound is the maximum of all the published lower bounds.
+class LearnedInfoExchange {
+ public:
+  // The capacity is the number of unit or binary clauses that can be stored.
+  LearnedInfoExchange(const LinearBooleanProblem& problem, int num_solvers,
+                      int capacity);
+
+  // Publishes the given learned_info to all the other solvers. Note that a
+  // solution is only published if it is feasible and better than the last one
+  // published by this solver. Only the thread running the given solver should
+  // call this.
+  void Publish(int solver_index, const LearnedInfo& learned_info);
+
+  // Fills learned_info with the information published by the other solvers
+  // since the last call with the same solver_index. The solution is the best
+  // of the new solutions, or is left unchanged if there is none. Only the
+  // thread running the given solver should call this.
+  void Fetch(int solver_index, LearnedInfo* learned_info);
+
+  // Marks the search as done, i.e. one of the solvers proved the optimality or
+  // the infeasibility of the problem, so all the solvers can stop.
+  void MarkSearchDone() { search_done_.store(true, std::memory_order_release); }
+  bool SearchDone() const {
+    return search_done_.load(std::memory_order_acquire);
+  }
+
+ private:
+  typedef uint64 Word;
+  static const int kBitsPerWord = 64;
+
+  // The last solution published by a solver, one bit per variable. The slot
+  // holds a complete solution when its sequence is even; It is odd while the
+  // solver writes a new solution.
+  struct SolutionSlot {
+    std::atomic<int64> sequence;
+    std::unique_ptr<std::atomic<Word>[]> words;
+  };
+
+  const LinearBooleanProblem& problem_;
+  const int num_words_;
+  sat::SharedClauseExchange clause_exchange_;
+  std::unique_ptr<SolutionSlot[]> solution_slots_;
+  std::atomic<int64> lower_bound_;
+  std::atomic<bool> search_done_;
+
+  // Only accessed by the thread of each solver: The cost of the last solution
+  // published by the solver, and for each other solver, the sequence of its
+  // last solution read by the solver.
+  std::vector<int64> last_published_costs_;
+  std::vector<std::vector<int64>> solution_cursors_;
+
+  DISALLOW_COPY_AND_ASSIGN(LearnedInfoExchange);
+};
+
 }  // namespace bop
 }  // namespace operations_research
 #endif  // OR_TOOLS_BOP_BOP_BASE_H_
@@ -32,7 +32,6 @@ using operations_research::glop::ColIndex;
 using operations_research::glop::DenseRow;
 using operations_research::glop::GlopParameters;
 using operations_research::glop::LinearProgram;
-using operations_research::glop::LPSolver;
 using operations_research::glop::RowIndex;
 using operations_research::LinearBooleanProblem;
 using operations_research::LinearBooleanConstraint;
@@ -433,6 +432,7 @@ LinearRelaxation::LinearRelaxation(const BopParameters& parameters,
       state_update_stamp_(ProblemState::kInitialStampValue),
       lp_model_loaded_(false),
       lp_model_(),
+      lp_model_needs_reload_(true),
       lp_solver_(),
       scaling_(1),
       offset_(0),
@@ -468,12 +468,13 @@ BopOptimizerBase::Status LinearRelaxation::SynchronizeIfNeeded(
     sat::ConvertBooleanProblemToLinearProgram(problem_state.original_problem(),
                                               &lp_model_);
     lp_model_loaded_ = true;
+    lp_model_needs_reload_ = true;
   }
   for (VariableIndex var(0); var < problem_state.is_fixed().size(); ++var) {
     if (problem_state.IsVariableFixed(var)) {
       const glop::Fractional value =
           problem_state.GetVariableFixedValue(var) ? 1.0 : 0.0;
-      lp_model_.SetVariableBounds(ColIndex(var.value()), value, value);
+      SetVariableBounds(ColIndex(var.value()), value, value);
     }
   }
 
@@ -497,6 +498,7 @@ BopOptimizerBase::Status LinearRelaxation::SynchronizeIfNeeded(
       lp_model_.SetCoefficient(constraint_index, col_a, coefficient_a);
       lp_model_.SetCoefficient(constraint_index, col_b, coefficient_b);
       lp_model_.SetConstraintBounds(constraint_index, rhs, glop::kInfinity);
+      lp_model_needs_reload_ = true;
     }
   }
 
@@ -528,7 +530,7 @@ BopOptimizerBase::Status LinearRelaxation::Optimize(
     return sync_status;
   }
 
-  const glop::ProblemStatus lp_status = Solve(false, time_limit);
+  const glop::ProblemStatus lp_status = Solve(time_limit);
   VLOG(1) << "                          LP: "
           << StringPrintf("%.6f", lp_solver_.GetObjectiveValue())
           << "   status: " << GetProblemStatusString(lp_status);
@@ -575,18 +577,21 @@ BopOptimizerBase::Status LinearRelaxation::Optimize(
   return BopOptimizerBase::LIMIT_REACHED;
 }
 
+void LinearRelaxation::SetVariableBounds(glop::ColIndex col,
+                                         glop::Fractional lower_bound,
+                                         glop::Fractional upper_bound) {
+  lp_model_.SetVariableBounds(col, lower_bound, upper_bound);
+  if (!lp_model_needs_reload_) {
+    lp_solver_.SetVariableBounds(col, lower_bound, upper_bound);
+  }
+}
+
 // TODO(user): It is possible to stop the search earlier using the glop
 //              parameter objective_lower_limit / objective_upper_limit. That
 //              can be used when a feasible solution is known, or when the false
 //              best bound is computed.
-glop::ProblemStatus LinearRelaxation::Solve(bool incremental_solve,
-                                            TimeLimit* time_limit) {
+glop::ProblemStatus LinearRelaxation::Solve(TimeLimit* time_limit) {
   GlopParameters glop_parameters;
-  if (incremental_solve) {
-    glop_parameters.set_use_dual_simplex(true);
-    glop_parameters.set_allow_simplex_algorithm_change(true);
-    glop_parameters.set_use_preprocessing(false);
-  }
   glop_parameters.set_max_time_in_seconds(
       std::min(time_limit->GetTimeLeft(),
           time_limit_ratio_ * time_limit->GetTimeLeft()));
@@ -594,8 +599,12 @@ glop::ProblemStatus LinearRelaxation::Solve(bool incremental_solve,
       std::min(time_limit->GetDeterministicTimeLeft(),
           time_limit_ratio_ * time_limit->GetDeterministicTimeLeft()));
   lp_solver_.SetParameters(glop_parameters);
+  if (lp_model_needs_reload_) {
+    lp_solver_.Load(lp_model_);
+    lp_model_needs_reload_ = false;
+  }
   const double initial_deterministic_time = lp_solver_.DeterministicTime();
-  const glop::ProblemStatus lp_status = lp_solver_.Solve(lp_model_);
+  const glop::ProblemStatus lp_status = lp_solver_.Solve();
   time_limit->AdvanceDeterministicTime(lp_solver_.DeterministicTime() -
                                        initial_deterministic_time);
   return lp_status;
@@ -640,8 +649,8 @@ double LinearRelaxation::ComputeLowerBoundUsingStrongBranching(
     double objective_false = best_lp_objective;
 
     // Set to true.
-    lp_model_.SetVariableBounds(col, 1.0, 1.0);
-    const glop::ProblemStatus status_true = Solve(true, time_limit);
+    SetVariableBounds(col, 1.0, 1.0);
+    const glop::ProblemStatus status_true = Solve(time_limit);
     // TODO(user): Deal with PRIMAL_INFEASIBLE, DUAL_INFEASIBLE and
     //              INFEASIBLE_OR_UNBOUNDED statuses. In all cases, if the
     //              original lp was feasible, this means that the variable can
@@ -651,8 +660,8 @@ double LinearRelaxation::ComputeLowerBoundUsingStrongBranching(
       objective_true = lp_solver_.GetObjectiveValue();
 
       // Set to false.
-      lp_model_.SetVariableBounds(col, 0.0, 0.0);
-      const glop::ProblemStatus status_false = Solve(true, time_limit);
+      SetVariableBounds(col, 0.0, 0.0);
+      const glop::ProblemStatus status_false = Solve(time_limit);
       if (status_false == glop::ProblemStatus::OPTIMAL ||
           status_false == glop::ProblemStatus::DUAL_FEASIBLE) {
         objective_false = lp_solver_.GetObjectiveValue();
@@ -668,18 +677,18 @@ double LinearRelaxation::ComputeLowerBoundUsingStrongBranching(
     if (CostIsWorseThanSolution(objective_true, tolerance)) {
       // Having variable col set to true can't possibly lead to and better
       // solution than the current one. Set the variable to false.
-      lp_model_.SetVariableBounds(col, 0.0, 0.0);
+      SetVariableBounds(col, 0.0, 0.0);
       learned_info->fixed_literals.push_back(
           sat::Literal(sat::VariableIndex(col.value()), false));
     } else if (CostIsWorseThanSolution(objective_false, tolerance)) {
       // Having variable col set to false can't possibly lead to and better
       // solution than the current one. Set the variable to true.
-      lp_model_.SetVariableBounds(col, 1.0, 1.0);
+      SetVariableBounds(col, 1.0, 1.0);
       learned_info->fixed_literals.push_back(
           sat::Literal(sat::VariableIndex(col.value()), true));
     } else {
       // Unset. This is safe to use 0.0 and 1.0 as the variable is not fixed.
-      lp_model_.SetVariableBounds(col, 0.0, 1.0);
+      SetVariableBounds(col, 0.0, 1.0);
     }
   }
   return best_lp_objective;
@@ -27,7 +27,7 @@
 #include "bop/bop_solution.h"
 #include "bop/bop_types.h"
 #include "bop/bop_util.h"
-#include "glop/lp_solver.h"
+#include "glop/lp_reoptimizer.h"
 #include "sat/boolean_problem.pb.h"
 #include "sat/sat_solver.h"
 #include "util/time_limit.h"
@@ -138,11 +138,16 @@ class LinearRelaxation : public BopOptimizerBase {
   BopOptimizerBase::Status SynchronizeIfNeeded(
       const ProblemState& problem_state);
 
+  // Changes the bounds of a variable in lp_model_ and in lp_solver_.
+  void SetVariableBounds(glop::ColIndex col, glop::Fractional lower_bound,
+                         glop::Fractional upper_bound);
+
   // Runs Glop to solve the current lp_model_.
   // Updates the time limit and returns the status of the solve.
-  // Note that when the solve is incremental, the preprocessor is deactivated,
-  // and the dual simplex is used.
-  glop::ProblemStatus Solve(bool incremental_solve, TimeLimit* time_limit);
+  // Note that lp_model_ is only loaded in lp_solver_ when its constraints
+  // changed. Otherwise only the bounds changed since the last solve, and the
+  // dual simplex restarts from the last basis.
+  glop::ProblemStatus Solve(TimeLimit* time_limit);
 
   // Computes and returns a better best bound using strong branching, i.e.
   // doing a what-if analysis on each variable v: compute the best bound when
@@ -161,7 +166,8 @@ class LinearRelaxation : public BopOptimizerBase {
   int64 state_update_stamp_;
   bool lp_model_loaded_;
   glop::LinearProgram lp_model_;
-  glop::LPSolver lp_solver_;
+  bool lp_model_needs_reload_;
+  glop::LPReoptimizer lp_solver_;
   double scaling_;
   double offset_;
   int num_fixed_variables_;
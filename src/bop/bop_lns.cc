@@ -13,17 +13,22 @@
 
 #include "bop/bop_lns.h"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/commandlineflags.h"
 #include "base/stringprintf.h"
 #include "google/protobuf/text_format.h"
 #include "base/stl_util.h"
+#include "base/threadpool.h"
 #include "glop/lp_solver.h"
 #include "lp_data/lp_print_utils.h"
 #include "sat/boolean_problem.h"
 #include "sat/lp_utils.h"
+#include "sat/sat_portfolio.h"
 #include "sat/sat_solver.h"
 #include "util/bitset.h"
 
@@ -223,40 +228,51 @@ BopOptimizerBase::Status SolveLNSProblem(
   sat::SatParameters sat_parameters;
   sat_parameters.set_max_number_of_conflicts(
       bop_parameters.max_number_of_conflicts_in_random_lns());
+  sat_parameters.set_num_search_workers(
+      bop_parameters.num_sat_workers_in_lns());
 
-  sat::SatSolver sat_solver;
   sat_parameters.set_max_time_in_seconds(time_limit->GetTimeLeft());
   sat_parameters.set_max_deterministic_time(
       time_limit->GetDeterministicTimeLeft());
-  sat_solver.SetParameters(sat_parameters);
+  sat::SatPortfolioSolver portfolio(sat_parameters);
 
-  // Starts by adding the unit clauses to fix the variables.
-  sat_solver.SetNumVariables(problem.num_variables());
-  for (sat::Literal literal : fixed_variables) {
-    CHECK(sat_solver.AddUnitClause(literal));
-  }
+  // Each worker gets its own copy of the problem. Since we fixed variables
+  // from a feasible assignment, the loading should always succeed.
+  bool objective_bound_is_unsat = false;
+  for (int i = 0; i < portfolio.NumWorkers(); ++i) {
+    sat::SatSolver* sat_solver = portfolio.MutableWorker(i);
+
+    // Starts by adding the unit clauses to fix the variables.
+    sat_solver->SetNumVariables(problem.num_variables());
+    for (sat::Literal literal : fixed_variables) {
+      CHECK(sat_solver->AddUnitClause(literal));
+    }
 
-  // Then load the rest of the problem. Since we fixed variables from a
-  // feasible assignment, this should always be true.
-  if (!LoadBooleanProblem(problem, &sat_solver)) {
-    return BopOptimizerBase::INFEASIBLE;
+    // Then load the rest of the problem.
+    if (!LoadBooleanProblem(problem, sat_solver)) {
+      return BopOptimizerBase::INFEASIBLE;
+    }
+    UseObjectiveForSatAssignmentPreference(problem, sat_solver);
+
+    // Add the objective constraint. Note that it is possible that the problem
+    // is detected to be unsat as soon as this constraint is added.
+    if (!AddObjectiveUpperBound(problem, sat::Coefficient(initial_cost) - 1,
+                                sat_solver)) {
+      objective_bound_is_unsat = true;
+      break;
+    }
   }
-  UseObjectiveForSatAssignmentPreference(problem, &sat_solver);
 
-  // Add the objective constraint and solve the problem. Note that it is
-  // possible that the problem is detected to be unsat as soon as this
-  // constraint is added.
   sat::SatSolver::Status sat_status = sat::SatSolver::MODEL_UNSAT;
-  if (AddObjectiveUpperBound(problem, sat::Coefficient(initial_cost) - 1,
-                             &sat_solver)) {
-    sat_status = sat_solver.Solve();
+  if (!objective_bound_is_unsat) {
+    sat_status = portfolio.Solve();
   }
   if (sat_status == sat::SatSolver::MODEL_SAT) {
-    SatAssignmentToBopSolution(sat_solver.Assignment(), solution);
+    SatAssignmentToBopSolution(portfolio.Winner().Assignment(), solution);
   }
-  *num_conflicts_used = sat_solver.num_failures();
+  *num_conflicts_used = portfolio.num_failures();
 
-  time_limit->AdvanceDeterministicTime(sat_solver.deterministic_time());
+  time_limit->AdvanceDeterministicTime(portfolio.deterministic_time());
   return sat_status == sat::SatSolver::MODEL_SAT
              ? BopOptimizerBase::SOLUTION_FOUND
              : BopOptimizerBase::LIMIT_REACHED;
@@ -302,6 +318,93 @@ BopOptimizerBase::Status SolveLNSProblemWithSatPropagator(
              ? BopOptimizerBase::SOLUTION_FOUND
              : BopOptimizerBase::LIMIT_REACHED;
 }
+
+// One of the LNS problems solved by SolveLNSProblemsInParallel().
+struct LNSTask {
+  LNSTask(const BopSolution& initial_solution, double time_left,
+          double deterministic_time_left)
+      : fixed_variables(nullptr),
+        solution(initial_solution),
+        time_limit(time_left, deterministic_time_left),
+        status(BopOptimizerBase::LIMIT_REACHED),
+        num_conflicts_used(0) {}
+
+  const std::vector<sat::Literal>* fixed_variables;
+  BopSolution solution;
+  TimeLimit time_limit;
+  BopOptimizerBase::Status status;
+  int num_conflicts_used;
+};
+
+// The data shared by all the tasks of SolveLNSProblemsInParallel().
+struct LNSTaskContext {
+  const LinearBooleanProblem* problem;
+  const BopSolution* initial_solution;
+  BopParameters parameters;
+};
+
+void RunLNSTask(const LNSTaskContext* context, LNSTask* task) {
+  task->status = SolveLNSProblem(
+      *context->problem, *context->initial_solution, context->parameters,
+      *task->fixed_variables, &task->solution, &task->time_limit,
+      &task->num_conflicts_used);
+}
+
+// Solves in parallel the LNS problems defined by each set of fixed variables.
+// Each problem is loaded in its own SatSolver and has its own copy of the
+// time limit. Returns SOLUTION_FOUND and the best found solution if at least
+// one problem has a solution. Since the problems are solved concurrently, only
+// the deterministic time of the longest one is counted.
+BopOptimizerBase::Status SolveLNSProblemsInParallel(
+    const LinearBooleanProblem& problem, const BopSolution& initial_solution,
+    const BopParameters& bop_parameters,
+    const std::vector<std::vector<sat::Literal>>& fixed_variables_per_problem,
+    BopSolution* solution, TimeLimit* time_limit) {
+  CHECK(solution != nullptr);
+  CHECK(time_limit != nullptr);
+  const int num_problems = fixed_variables_per_problem.size();
+
+  // The problems already use one thread each, so we don't run a portfolio of
+  // SAT workers on top of that.
+  LNSTaskContext context;
+  context.problem = &problem;
+  context.initial_solution = &initial_solution;
+  context.parameters = bop_parameters;
+  context.parameters.set_num_sat_workers_in_lns(1);
+
+  std::vector<std::unique_ptr<LNSTask>> tasks;
+  for (int i = 0; i < num_problems; ++i) {
+    tasks.emplace_back(new LNSTask(initial_solution, time_limit->GetTimeLeft(),
+                                   time_limit->GetDeterministicTimeLeft()));
+    tasks.back()->fixed_variables = &fixed_variables_per_problem[i];
+  }
+  {
+    // The calling thread solves one of the problems.
+    ThreadPool pool("ParallelLNS", num_problems - 1);
+    pool.StartWorkers();
+    pool.ParallelFor(0, num_problems, 1, [&](int begin, int end) {
+      for (int i = begin; i < end; ++i) RunLNSTask(&context, tasks[i].get());
+    });
+  }
+
+  // We scan the tasks in order so that the result doesn't depend on which
+  // problem finished first.
+  double deterministic_time = 0.0;
+  const LNSTask* best_task = nullptr;
+  for (const std::unique_ptr<LNSTask>& task : tasks) {
+    deterministic_time = std::max(
+        deterministic_time, task->time_limit.GetElapsedDeterministicTime());
+    if (task->status == BopOptimizerBase::SOLUTION_FOUND &&
+        (best_task == nullptr ||
+         task->solution.GetCost() < best_task->solution.GetCost())) {
+      best_task = task.get();
+    }
+  }
+  time_limit->AdvanceDeterministicTime(deterministic_time);
+  if (best_task == nullptr) return BopOptimizerBase::LIMIT_REACHED;
+  *solution = best_task->solution;
+  return BopOptimizerBase::SOLUTION_FOUND;
+}
 }  // anonymous namespace.
 
 //------------------------------------------------------------------------------
@@ -693,37 +796,50 @@ BopOptimizerBase::Status BopRandomConstraintLNSOptimizer::Optimize(
     ct_ids[ct_id] = ct_id;
   }
 
+  // Each try generates num_neighborhoods neighborhoods, which are solved in
+  // parallel when there are more than one.
+  const int num_neighborhoods =
+      std::max(1, parameters.num_lns_neighborhoods_in_parallel());
+  std::vector<std::vector<sat::Literal>> fixed_variables(num_neighborhoods);
   int num_tries = 0;
   while (!time_limit->LimitReached() &&
          num_tries < parameters.num_random_lns_tries()) {
-    std::random_shuffle(ct_ids.begin(), ct_ids.end(), random_);
     ++num_tries;
-
-    to_relax_.ClearAndResize(VariableIndex(initial_solution_->Size()));
-    for (int i = 0; i < ct_ids.size(); ++i) {
-      const LinearBooleanConstraint& constraint =
-          problem_->constraints(ct_ids[i]);
-      for (int j = 0; j < constraint.literals_size(); ++j) {
-        const VariableIndex var_id(constraint.literals(j) - 1);
-        to_relax_.Set(var_id);
+    for (int neighborhood = 0; neighborhood < num_neighborhoods;
+         ++neighborhood) {
+      std::random_shuffle(ct_ids.begin(), ct_ids.end(), random_);
+      to_relax_.ClearAndResize(VariableIndex(initial_solution_->Size()));
+      for (int i = 0; i < ct_ids.size(); ++i) {
+        const LinearBooleanConstraint& constraint =
+            problem_->constraints(ct_ids[i]);
+        for (int j = 0; j < constraint.literals_size(); ++j) {
+          const VariableIndex var_id(constraint.literals(j) - 1);
+          to_relax_.Set(var_id);
+        }
+
+        // TODO(user): Use the auto-adaptative code of the RandomLNS instead of
+        //              this hard-coded 10% logic.
+        const double kHardCodedTenPercent = 0.1;
+        if (to_relax_.PositionsSetAtLeastOnce().size() >
+            initial_solution_->Size() * kHardCodedTenPercent) {
+          break;
+        }
       }
 
-      // TODO(user): Use the auto-adaptative code of the RandomLNS instead of
-      //              this hard-coded 10% logic.
-      const double kHardCodedTenPercent = 0.1;
-      if (to_relax_.PositionsSetAtLeastOnce().size() >
-          initial_solution_->Size() * kHardCodedTenPercent) {
-        break;
-      }
+      ComputeVariablesToFixFromToRelax(*initial_solution_, objective_terms_,
+                                       to_relax_,
+                                       &fixed_variables[neighborhood]);
     }
 
-    std::vector<sat::Literal> fixed_variables;
-    ComputeVariablesToFixFromToRelax(*initial_solution_, objective_terms_,
-                                     to_relax_, &fixed_variables);
     int num_conflicts_used;
-    const BopOptimizerBase::Status status = SolveLNSProblem(
-        *problem_, *initial_solution_, parameters, fixed_variables,
-        &learned_info->solution, time_limit, &num_conflicts_used);
+    const BopOptimizerBase::Status status =
+        num_neighborhoods == 1
+            ? SolveLNSProblem(*problem_, *initial_solution_, parameters,
+                              fixed_variables[0], &learned_info->solution,
+                              time_limit, &num_conflicts_used)
+            : SolveLNSProblemsInParallel(*problem_, *initial_solution_,
+                                         parameters, fixed_variables,
+                                         &learned_info->solution, time_limit);
 
     if (status == BopOptimizerBase::SOLUTION_FOUND) {
       return BopOptimizerBase::SOLUTION_FOUND;
@@ -13,6 +13,9 @@
 
 #include "bop/bop_ls.h"
 
+#include <stdint.h>
+
+#include "base/random.h"
 #include "bop/bop_util.h"
 #include "sat/boolean_problem.h"
 
@@ -66,7 +69,8 @@ BopOptimizerBase::Status LocalSearchOptimizer::Optimize(
 
   double prev_deterministic_time = assignment_iterator_->deterministic_time();
   assignment_iterator_->UseTranspositionTable(
-      parameters.use_transposition_table_in_ls());
+      parameters.use_transposition_table_in_ls(),
+      parameters.log2_transposition_table_size_in_ls());
   int64 num_assignments_to_explore =
       parameters.max_number_of_explored_assignments_per_try_in_ls();
 
@@ -159,6 +163,59 @@ void BacktrackableIntegerSet<IntType>::BacktrackAll() {
 // TODO(user): move the code in a separate .h and -inl.h to avoid this.
 template class BacktrackableIntegerSet<ConstraintIndex>;
 
+//------------------------------------------------------------------------------
+// TranspositionTable
+//------------------------------------------------------------------------------
+
+void TranspositionTable::ClearAndResize(int log2_num_buckets) {
+  const int64 num_buckets = 1LL << log2_num_buckets;
+  bucket_mask_ = num_buckets - 1;
+  entries_.assign(num_buckets * kBucketSize + kBucketSize - 1, 0);
+
+  // Skip the first entries until the buckets are aligned on a cache line.
+  first_entry_ = 0;
+  while (reinterpret_cast<uintptr_t>(&entries_[first_entry_]) %
+             (kBucketSize * sizeof(uint64)) !=
+         0) {
+    ++first_entry_;
+  }
+  num_stored_ = 0;
+}
+
+void TranspositionTable::Clear() {
+  entries_.assign(entries_.size(), 0);
+  num_stored_ = 0;
+}
+
+bool TranspositionTable::Contains(uint64 hash) const {
+  hash = NonZero(hash);
+  const uint64* const bucket =
+      &entries_[first_entry_ + (hash & bucket_mask_) * kBucketSize];
+  for (int i = 0; i < kBucketSize; ++i) {
+    if (bucket[i] == hash) return true;
+    if (bucket[i] == 0) return false;
+  }
+  return false;
+}
+
+void TranspositionTable::Insert(uint64 hash) {
+  hash = NonZero(hash);
+  uint64* const bucket =
+      &entries_[first_entry_ + (hash & bucket_mask_) * kBucketSize];
+  for (int i = 0; i < kBucketSize; ++i) {
+    if (bucket[i] == hash) return;
+    if (bucket[i] == 0) {
+      bucket[i] = hash;
+      ++num_stored_;
+      return;
+    }
+  }
+
+  // The bucket is full, replace a "random" entry. The entries are filled in
+  // order, so there is still no empty entry before an occupied one.
+  bucket[hash >> 61] = hash;
+}
+
 //------------------------------------------------------------------------------
 // AssignmentAndConstraintFeasibilityMaintainer
 //------------------------------------------------------------------------------
@@ -166,7 +223,9 @@ template class BacktrackableIntegerSet<ConstraintIndex>;
 AssignmentAndConstraintFeasibilityMaintainer::
     AssignmentAndConstraintFeasibilityMaintainer(
         const LinearBooleanProblem& problem)
-    : by_variable_matrix_(problem.num_variables()),
+    : column_starts_(),
+      entry_constraints_(),
+      entry_weights_(),
       constraint_lower_bounds_(),
       constraint_upper_bounds_(),
       reference_solution_(problem, "ReferenceSolution"),
@@ -174,6 +233,17 @@ AssignmentAndConstraintFeasibilityMaintainer::
       is_assigned_(problem.num_variables(), false),
       constraint_values_(),
       literals_applied_stack_() {
+  // The entries are first collected by constraint, and then sorted by variable
+  // to build the compact matrix.
+  struct Entry {
+    Entry(VariableIndex v, ConstraintIndex c, int64 w)
+        : var(v), constraint(c), weight(w) {}
+    VariableIndex var;
+    ConstraintIndex constraint;
+    int64 weight;
+  };
+  std::vector<Entry> entries;
+
   // Add the objective constraint as the first constraint.
   ConstraintIndex num_constraints(0);
   const LinearObjective& objective = problem.objective();
@@ -184,8 +254,7 @@ AssignmentAndConstraintFeasibilityMaintainer::
 
     const VariableIndex var(objective.literals(i) - 1);
     const int64 weight = objective.coefficients(i);
-    by_variable_matrix_[var].push_back(
-        ConstraintEntry(num_constraints, weight));
+    entries.push_back(Entry(var, num_constraints, weight));
   }
   constraint_lower_bounds_.push_back(kint64min);
   constraint_values_.push_back(0);
@@ -205,8 +274,7 @@ AssignmentAndConstraintFeasibilityMaintainer::
     for (int i = 0; i < constraint.literals_size(); ++i) {
       const VariableIndex var(constraint.literals(i) - 1);
       const int64 weight = constraint.coefficients(i);
-      by_variable_matrix_[var].push_back(
-          ConstraintEntry(num_constraints, weight));
+      entries.push_back(Entry(var, num_constraints, weight));
     }
     constraint_lower_bounds_.push_back(
         constraint.has_lower_bound() ? constraint.lower_bound() : kint64min);
@@ -215,6 +283,26 @@ AssignmentAndConstraintFeasibilityMaintainer::
         constraint.has_upper_bound() ? constraint.upper_bound() : kint64max);
   }
 
+  // Build the matrix by variable with a counting sort. The entries of each
+  // variable stay sorted by constraint.
+  const VariableIndex num_variables(problem.num_variables());
+  column_starts_.assign(num_variables.value() + 1, EntryIndex(0));
+  for (const Entry& entry : entries) {
+    ++column_starts_[entry.var + 1];
+  }
+  for (VariableIndex var(0); var < num_variables; ++var) {
+    column_starts_[var + 1] += column_starts_[var];
+  }
+  entry_constraints_.resize(entries.size());
+  entry_weights_.resize(entries.size());
+  ITIVector<VariableIndex, EntryIndex> next_entries(column_starts_.begin(),
+                                                    column_starts_.end() - 1);
+  for (const Entry& entry : entries) {
+    const EntryIndex e = next_entries[entry.var]++;
+    entry_constraints_[e] = entry.constraint;
+    entry_weights_[e] = entry.weight;
+  }
+
   // Initialize infeasible_constraint_set_;
   infeasible_constraint_set_.ClearAndResize(
       ConstraintIndex(constraint_values_.size()));
@@ -241,8 +329,9 @@ void AssignmentAndConstraintFeasibilityMaintainer::SetReferenceSolution(
   constraint_values_.assign(NumConstraints(), 0);
   for (VariableIndex var(0); var < reference_solution_.Size(); ++var) {
     if (reference_solution_.Value(var)) {
-      for (const ConstraintEntry& entry : by_variable_matrix_[var]) {
-        constraint_values_[entry.constraint] += entry.weight;
+      const EntryIndex end = column_starts_[var + 1];
+      for (EntryIndex e = column_starts_[var]; e < end; ++e) {
+        constraint_values_[entry_constraints_[e]] += entry_weights_[e];
       }
     }
   }
@@ -279,13 +368,14 @@ void AssignmentAndConstraintFeasibilityMaintainer::Assign(
     is_assigned_[var] = true;
     if (reference_solution_.Value(var) != value) {
       assignment_.SetValue(var, value);
-      for (const ConstraintEntry& entry : by_variable_matrix_[var]) {
-        const bool was_feasible = ConstraintIsFeasible(entry.constraint);
-        constraint_values_[entry.constraint] +=
-            value ? entry.weight : -entry.weight;
-        if (ConstraintIsFeasible(entry.constraint) != was_feasible) {
-          infeasible_constraint_set_.ChangeState(entry.constraint,
-                                                 was_feasible);
+      const int64 sign = value ? 1 : -1;
+      const EntryIndex end = column_starts_[var + 1];
+      for (EntryIndex e = column_starts_[var]; e < end; ++e) {
+        const ConstraintIndex constraint = entry_constraints_[e];
+        const bool was_feasible = ConstraintIsFeasible(constraint);
+        constraint_values_[constraint] += sign * entry_weights_[e];
+        if (ConstraintIsFeasible(constraint) != was_feasible) {
+          infeasible_constraint_set_.ChangeState(constraint, was_feasible);
         }
       }
     }
@@ -307,9 +397,10 @@ void AssignmentAndConstraintFeasibilityMaintainer::BacktrackOneLevel() {
 
     if (assignment_.Value(var) != ref_value) {
       assignment_.SetValue(var, ref_value);
-      for (const ConstraintEntry& entry : by_variable_matrix_[var]) {
-        constraint_values_[entry.constraint] +=
-            ref_value ? entry.weight : -entry.weight;
+      const int64 sign = ref_value ? 1 : -1;
+      const EntryIndex end = column_starts_[var + 1];
+      for (EntryIndex e = column_starts_[var]; e < end; ++e) {
+        constraint_values_[entry_constraints_[e]] += sign * entry_weights_[e];
       }
     }
   }
@@ -601,6 +692,23 @@ LocalSearchAssignmentIterator::LocalSearchAssignmentIterator(
       num_nodes_(0),
       num_skipped_nodes_(0) {
   maintainer_.SetReferenceSolution(problem_state.solution());
+
+  // The keys are the same for all the iterators since the seed is fixed.
+  MTRandom random("LocalSearchAssignmentIterator");
+  const int num_literals = 2 * problem_state.original_problem().num_variables();
+  zobrist_keys_.resize(num_literals);
+  for (sat::LiteralIndex i(0); i < num_literals; ++i) {
+    zobrist_keys_[i] = (static_cast<uint64>(random.Next64()) << 32) ^
+                       static_cast<uint64>(random.Next64());
+  }
+}
+
+void LocalSearchAssignmentIterator::UseTranspositionTable(
+    bool v, int log2_num_buckets) {
+  use_transposition_table_ = v;
+  if (v && transposition_table_.NumBuckets() != 1LL << log2_num_buckets) {
+    transposition_table_.ClearAndResize(log2_num_buckets);
+  }
 }
 
 void LocalSearchAssignmentIterator::Synchronize(
@@ -611,7 +719,7 @@ void LocalSearchAssignmentIterator::Synchronize(
     initial_term_index_[node.constraint] = node.term_index;
   }
   search_nodes_.clear();
-  transposition_table_.clear();
+  transposition_table_.Clear();
   num_nodes_ = 0;
   num_skipped_nodes_ = 0;
 }
@@ -640,7 +748,7 @@ bool LocalSearchAssignmentIterator::NextAssignment() {
   if (search_nodes_.empty()) {
     VLOG(1) << std::string(25, ' ') + "LS finished."
             << " #explored:" << num_nodes_
-            << " #stored:" << transposition_table_.size()
+            << " #stored:" << transposition_table_.num_stored()
             << " #skipped:" << num_skipped_nodes_;
     return false;
   }
@@ -698,50 +806,16 @@ void LocalSearchAssignmentIterator::ApplyDecision(sat::Literal literal) {
   }
 }
 
-void LocalSearchAssignmentIterator::InitializeTranspostionTableKey(
-    std::array<int32, kStoredMaxDecisions>* a) {
-  int i = 0;
-  for (const SearchNode& n : search_nodes_) {
-    // Negated because we already fixed it to its opposite value!
-    (*a)[i] = -repairer_.Literal(n.constraint, n.term_index).SignedValue();
-    ++i;
-  }
-
-  // 'a' is not zero-initialized, so we need to complete it with zeros.
-  while (i < kStoredMaxDecisions) {
-    (*a)[i] = 0;
-    ++i;
-  }
-}
-
 bool LocalSearchAssignmentIterator::NewStateIsInTranspositionTable(
     sat::Literal l) {
-  if (search_nodes_.size() + 1 > kStoredMaxDecisions) return false;
-
-  // Fill the transposition table element, i.e the array 'a' of decisions.
-  std::array<int32, kStoredMaxDecisions> a;
-  InitializeTranspostionTableKey(&a);
-  a[search_nodes_.size()] = l.SignedValue();
-  std::sort(a.begin(), a.begin() + 1 + search_nodes_.size());
-
-  if (transposition_table_.find(a) == transposition_table_.end()) {
-    return false;
-  } else {
-    ++num_skipped_nodes_;
-    return true;
-  }
+  if (!transposition_table_.Contains(NewStateHash(l))) return false;
+  ++num_skipped_nodes_;
+  return true;
 }
 
 void LocalSearchAssignmentIterator::InsertInTranspositionTable() {
-  // If there is more decision that kStoredMaxDecisions, do nothing.
-  if (search_nodes_.size() > kStoredMaxDecisions) return;
-
-  // Fill the transposition table element, i.e the array 'a' of decisions.
-  std::array<int32, kStoredMaxDecisions> a;
-  InitializeTranspostionTableKey(&a);
-  std::sort(a.begin(), a.begin() + search_nodes_.size());
-
-  transposition_table_.insert(a);
+  if (search_nodes_.empty()) return;
+  transposition_table_.Insert(search_nodes_.back().hash);
 }
 
 bool LocalSearchAssignmentIterator::EnqueueNextRepairingTermIfAny(
@@ -754,10 +828,10 @@ bool LocalSearchAssignmentIterator::EnqueueNextRepairingTermIfAny(
     term_index = repairer_.NextRepairingTerm(
         ct_to_repair, initial_term_index_[ct_to_repair], term_index);
     if (term_index == OneFlipConstraintRepairer::kInvalidTerm) return false;
-    if (!use_transposition_table_ ||
-        !NewStateIsInTranspositionTable(
-            repairer_.Literal(ct_to_repair, term_index))) {
-      search_nodes_.push_back(SearchNode(ct_to_repair, term_index));
+    const sat::Literal literal = repairer_.Literal(ct_to_repair, term_index);
+    if (!use_transposition_table_ || !NewStateIsInTranspositionTable(literal)) {
+      search_nodes_.push_back(
+          SearchNode(ct_to_repair, term_index, NewStateHash(literal)));
       return true;
     }
     if (term_index == initial_term_index_[ct_to_repair]) return false;
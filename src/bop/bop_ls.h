@@ -27,11 +27,7 @@
 #ifndef OR_TOOLS_BOP_BOP_LS_H_
 #define OR_TOOLS_BOP_BOP_LS_H_
 
-#include <array>
-
-#include "base/hash.h"
-
-#include "base/hash.h"
+#include "base/integral_types.h"
 #include "bop/bop_base.h"
 #include "bop/bop_solution.h"
 #include "bop/bop_types.h"
@@ -137,6 +133,46 @@ class BacktrackableIntegerSet {
   std::vector<int> saved_stack_sizes_;
 };
 
+// A fixed-size and lossy set of 64 bits hashes, used as the transposition table
+// of the local search. The table is divided in buckets of one cache line, a
+// hash can only be stored in the bucket given by its low bits, and when this
+// bucket is full it replaces one of its entries chosen by its high bits. So an
+// inserted hash may be forgotten, but Contains() only returns true for the
+// inserted hashes (up to a collision of the full 64 bits).
+class TranspositionTable {
+ public:
+  TranspositionTable() : first_entry_(0), bucket_mask_(0), num_stored_(0) {}
+
+  // Allocates 2^log2_num_buckets empty buckets. Note that this run in
+  // O(table size).
+  void ClearAndResize(int log2_num_buckets);
+  void Clear();
+
+  // Returns the number of buckets of the table, 0 if it is not allocated.
+  int64 NumBuckets() const {
+    return entries_.empty() ? 0 : bucket_mask_ + 1;
+  }
+
+  bool Contains(uint64 hash) const;
+  void Insert(uint64 hash);
+
+  // Returns the number of occupied entries.
+  int64 num_stored() const { return num_stored_; }
+
+ private:
+  static const int kBucketSize = 8;  // 64 bytes.
+
+  // Because 0 marks the empty entries, it is never stored.
+  static uint64 NonZero(uint64 hash) { return hash == 0 ? 1 : hash; }
+
+  // The entries of bucket b start at first_entry_ + b * kBucketSize, which is
+  // aligned on a cache line.
+  std::vector<uint64> entries_;
+  int first_entry_;
+  uint64 bucket_mask_;
+  int64 num_stored_;
+};
+
 // This class is used to incrementally maintain an assignment and the
 // feasibility of the constraints of a given LinearBooleanProblem.
 //
@@ -241,25 +277,28 @@ class AssignmentAndConstraintFeasibilityMaintainer {
   }
 
   // Returns true if the given constraint is currently feasible.
+  // This is lb <= value <= ub tested with only one comparison: the differences
+  // are computed modulo 2^64, and value - lb is at most ub - lb if and only if
+  // value is in [lb, ub] (the bounds of a constraint are never crossed).
   bool ConstraintIsFeasible(ConstraintIndex constraint) const {
-    const int64 value = ConstraintValue(constraint);
-    return value >= ConstraintLowerBound(constraint) &&
-           value <= ConstraintUpperBound(constraint);
+    const uint64 lower_bound =
+        static_cast<uint64>(ConstraintLowerBound(constraint));
+    return static_cast<uint64>(ConstraintValue(constraint)) - lower_bound <=
+           static_cast<uint64>(ConstraintUpperBound(constraint)) - lower_bound;
   }
 
   std::string DebugString() const;
 
  private:
-  // Local structure to represent the sparse matrix by variable used for fast
-  // update of the contraint values.
-  struct ConstraintEntry {
-    ConstraintEntry(ConstraintIndex c, int64 w) : constraint(c), weight(w) {}
-    ConstraintIndex constraint;
-    int64 weight;
-  };
-
-  ITIVector<VariableIndex, ITIVector<EntryIndex, ConstraintEntry> >
-      by_variable_matrix_;
+  // The sparse matrix by variable used for fast update of the contraint values,
+  // in a compact column-major format: the entries of the variable var are the
+  // ones in [column_starts_[var], column_starts_[var + 1]). The constraints
+  // and the weights are stored in two flat arrays, so the update loops of
+  // Assign() and BacktrackOneLevel() scan contiguous memory, which matters
+  // when each variable appears in hundreds of constraints.
+  ITIVector<VariableIndex, EntryIndex> column_starts_;
+  ITIVector<EntryIndex, ConstraintIndex> entry_constraints_;
+  ITIVector<EntryIndex, int64> entry_weights_;
   ITIVector<ConstraintIndex, int64> constraint_lower_bounds_;
   ITIVector<ConstraintIndex, int64> constraint_upper_bounds_;
   BopSolution reference_solution_;
@@ -410,8 +449,9 @@ class LocalSearchAssignmentIterator {
   LocalSearchAssignmentIterator(const ProblemState& problem_state,
                                 int max_num_decisions);
 
-  // Sets whether or not a transposition table is used.
-  void UseTranspositionTable(bool v) { use_transposition_table_ = v; }
+  // Sets whether or not a transposition table is used, and its size (see
+  // TranspositionTable).
+  void UseTranspositionTable(bool v, int log2_num_buckets);
 
   // Synchronizes the iterator with the problem state, e.g. set fixed variables,
   // set the reference solution.
@@ -448,18 +488,19 @@ class LocalSearchAssignmentIterator {
   std::string DebugString() const;
 
  private:
-  // See transposition_table_ below.
-  static const size_t kStoredMaxDecisions = 4;
-
   // Internal structure used to represent a node of the search tree during local
-  // search.
+  // search. The hash is the Zobrist hash of the decisions from the root to this
+  // node included, see transposition_table_.
   struct SearchNode {
     SearchNode()
         : constraint(OneFlipConstraintRepairer::kInvalidConstraint),
-          term_index(OneFlipConstraintRepairer::kInvalidTerm) {}
-    SearchNode(ConstraintIndex c, TermIndex t) : constraint(c), term_index(t) {}
+          term_index(OneFlipConstraintRepairer::kInvalidTerm),
+          hash(0) {}
+    SearchNode(ConstraintIndex c, TermIndex t, uint64 h)
+        : constraint(c), term_index(t), hash(h) {}
     ConstraintIndex constraint;
     TermIndex term_index;
+    uint64 hash;
   };
 
   // Applies the decision. Automatically backtracks when SAT detects conflicts.
@@ -472,6 +513,13 @@ class LocalSearchAssignmentIterator {
   // Backtracks and moves to the next decision in the search tree.
   void Backtrack();
 
+  // Returns the hash of the current decisions (in search_nodes_) plus the new
+  // one given by l.
+  uint64 NewStateHash(sat::Literal l) const {
+    return (search_nodes_.empty() ? 0 : search_nodes_.back().hash) ^
+           zobrist_keys_[l.Index()];
+  }
+
   // Looks if the current decisions (in search_nodes_) plus the new one (given
   // by l) lead to a position already present in transposition_table_.
   bool NewStateIsInTranspositionTable(sat::Literal l);
@@ -479,11 +527,6 @@ class LocalSearchAssignmentIterator {
   // Inserts the current set of decisions in transposition_table_.
   void InsertInTranspositionTable();
 
-  // Initializes the given array with the current decisions in search_nodes_ and
-  // by filling the other positions with 0.
-  void InitializeTranspostionTableKey(
-      std::array<int32, kStoredMaxDecisions>* a);
-
   // Looks for the next repairing term in the given constraints while skipping
   // the position already present in transposition_table_. A given TermIndex of
   // -1 means that this is the first time we explore this constraint.
@@ -497,26 +540,19 @@ class LocalSearchAssignmentIterator {
   std::vector<SearchNode> search_nodes_;
   ITIVector<ConstraintIndex, TermIndex> initial_term_index_;
 
-  // For each set of explored decisions, we store it in this table so that we
-  // don't explore decisions (a, b) and later (b, a) for instance. The decisions
-  // are converted to int32, sorted and padded with 0 before beeing inserted
-  // here.
+  // For each set of explored decisions, we store its hash in this table so
+  // that we don't explore decisions (a, b) and later (b, a) for instance. The
+  // hash of a set of decisions is the xor of the random zobrist_keys_ of their
+  // literals, so it doesn't depend on their order and is updated in O(1) when
+  // a decision is added.
   //
   // TODO(user): We may still miss some equivalent states because it is possible
   // that completely differents decisions lead to exactly the same state.
   // However this is more time consuming to detect because we must apply the
   // last decision first before trying to compare the states.
-  //
-  // TODO(user): Currently, we only store kStoredMaxDecisions or less decisions.
-  // Ideally, this should be related to the maximum number of decision in the
-  // LS, but that requires templating the whole LS optimizer.
   bool use_transposition_table_;
-#if defined(_MSC_VER)
-  hash_set<std::array<int32, kStoredMaxDecisions>,
-           StdArrayHasher<int32, kStoredMaxDecisions>> transposition_table_;
-#else
-  hash_set<std::array<int32, kStoredMaxDecisions>> transposition_table_;
-#endif
+  ITIVector<sat::LiteralIndex, uint64> zobrist_keys_;
+  TranspositionTable transposition_table_;
 
   // The number of explored nodes.
   int64 num_nodes_;
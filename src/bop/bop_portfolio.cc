@@ -53,6 +53,7 @@ PortfolioOptimizer::PortfolioOptimizer(
       state_update_stamp_(ProblemState::kInitialStampValue),
       objective_terms_(),
       selector_(),
+      shared_statistics_(nullptr),
       optimizers_(),
       optimizer_initial_scores_(),
       sat_propagator_(problem_state.original_problem()),
@@ -64,6 +65,27 @@ PortfolioOptimizer::PortfolioOptimizer(
 
 PortfolioOptimizer::~PortfolioOptimizer() {}
 
+int PortfolioOptimizer::NumOptimizers(
+    const BopParameters& parameters,
+    const BopSolverOptimizerSet& optimizer_set) {
+  int num_optimizers = 0;
+  for (const BopOptimizerMethod& optimizer_method : optimizer_set.methods()) {
+    num_optimizers +=
+        optimizer_method.type() == BopOptimizerMethod::LOCAL_SEARCH
+            ? parameters.max_num_decisions()
+            : 1;
+  }
+  return num_optimizers;
+}
+
+void PortfolioOptimizer::SetSharedStatistics(
+    SharedItemStatistics* shared_statistics) {
+  CHECK(shared_statistics != nullptr);
+  CHECK_EQ(optimizers_.size(), shared_statistics->num_items());
+  shared_statistics_ = shared_statistics;
+  selector_->SetSharedStatistics(shared_statistics);
+}
+
 BopOptimizerBase::Status PortfolioOptimizer::SynchronizeIfNeeded(
     const ProblemState& problem_state) {
   if (state_update_stamp_ == problem_state.update_stamp()) {
@@ -119,9 +141,17 @@ BopOptimizerBase::Status PortfolioOptimizer::Optimize(
           << " - " << selected_optimizer->name()
           << ". Time limit: " << time_limit->GetTimeLeft() << " -- "
           << time_limit->GetDeterministicTimeLeft();
+  if (shared_statistics_ != nullptr) {
+    shared_statistics_->StartRun(selected_optimizer_id);
+  }
   const BopOptimizerBase::Status optimization_status =
       selected_optimizer->Optimize(parameters, problem_state, learned_info,
                                    time_limit);
+  if (shared_statistics_ != nullptr) {
+    shared_statistics_->EndRun(
+        selected_optimizer_id,
+        optimization_status == BopOptimizerBase::SOLUTION_FOUND);
+  }
 
   if (optimization_status == BopOptimizerBase::INFEASIBLE ||
       optimization_status == BopOptimizerBase::OPTIMAL_SOLUTION_FOUND) {
@@ -215,8 +245,7 @@ void PortfolioOptimizer::CreateOptimizers(
     sat_propagator_.AddSymmetries(&generators);
   }
 
-  const int max_num_optimizers =
-      optimizer_set.methods_size() + parameters.max_num_decisions() - 1;
+  const int max_num_optimizers = NumOptimizers(parameters, optimizer_set);
   optimizers_.reserve(max_num_optimizers);
   optimizer_initial_scores_.reserve(max_num_optimizers);
   for (const BopOptimizerMethod& optimizer_method : optimizer_set.methods()) {
@@ -226,13 +255,45 @@ void PortfolioOptimizer::CreateOptimizers(
                                              optimizer_initial_scores_));
 }
 
+//------------------------------------------------------------------------------
+// SharedItemStatistics
+//------------------------------------------------------------------------------
+
+SharedItemStatistics::SharedItemStatistics(int num_items)
+    : num_items_(num_items),
+      scores_(new std::atomic<double>[num_items]),
+      num_running_(new std::atomic<int>[num_items]) {
+  for (int item = 0; item < num_items_; ++item) {
+    scores_[item].store(0.0, std::memory_order_relaxed);
+    num_running_[item].store(0, std::memory_order_relaxed);
+  }
+}
+
+void SharedItemStatistics::EndRun(int item, bool success) {
+  num_running_[item].fetch_sub(1, std::memory_order_relaxed);
+  const double kErosion = AdaptativeItemSelector::kErosion;
+  double score = scores_[item].load(std::memory_order_relaxed);
+  while (!scores_[item].compare_exchange_weak(
+      score, (1 - kErosion) * score + (success ? kErosion : 0),
+      std::memory_order_relaxed)) {
+  }
+}
+
+double SharedItemStatistics::ScoreFactor(int item) const {
+  return (1.0 + scores_[item].load(std::memory_order_relaxed)) /
+         (1.0 + num_running_[item].load(std::memory_order_relaxed));
+}
+
 //------------------------------------------------------------------------------
 // AdaptativeItemSelector
 //------------------------------------------------------------------------------
 
 AdaptativeItemSelector::AdaptativeItemSelector(
     int random_seed, const std::vector<double>& initial_scores)
-    : random_(random_seed), selected_item_id_(kNoSelection), items_() {
+    : random_(random_seed),
+      selected_item_id_(kNoSelection),
+      items_(),
+      shared_statistics_(nullptr) {
   items_.reserve(initial_scores.size());
   for (const double score : initial_scores) {
     items_.push_back(Item(score));
@@ -259,11 +320,19 @@ void AdaptativeItemSelector::StartNewRoundOfSelections() {
 }
 
 bool AdaptativeItemSelector::SelectItem() {
-  // Compute the sum score of selectable items.
+  // Compute the selection score of each item, and the sum score of selectable
+  // items. Note that the shared statistics can change concurrently, so they
+  // are read only once.
   double score_sum = 0.0;
-  for (const Item& item : items_) {
+  selection_scores_.resize(items_.size());
+  for (int item_id = 0; item_id < items_.size(); ++item_id) {
+    const Item& item = items_[item_id];
+    selection_scores_[item_id] =
+        shared_statistics_ == nullptr
+            ? item.current_score
+            : item.current_score * shared_statistics_->ScoreFactor(item_id);
     if (item.can_be_selected) {
-      score_sum += item.current_score;
+      score_sum += selection_scores_[item_id];
     }
   }
 
@@ -274,7 +343,7 @@ bool AdaptativeItemSelector::SelectItem() {
   for (int item_id = 0; item_id < items_.size(); ++item_id) {
     const Item& item = items_[item_id];
     if (item.can_be_selected) {
-      selection_sum += item.current_score;
+      selection_sum += selection_scores_[item_id];
     }
     if (selection_sum > selected_score_sum) {
       selected_item_id_ = item_id;
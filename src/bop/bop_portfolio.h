@@ -14,6 +14,9 @@
 #ifndef OR_TOOLS_BOP_BOP_PORTFOLIO_H_
 #define OR_TOOLS_BOP_BOP_PORTFOLIO_H_
 
+#include <atomic>
+#include <memory>
+
 #include "bop/bop_base.h"
 #include "bop/bop_lns.h"
 #include "bop/bop_parameters.pb.h"
@@ -29,6 +32,7 @@ namespace operations_research {
 namespace bop {
 // Forward declaration.
 class AdaptativeItemSelector;
+class SharedItemStatistics;
 
 // This class implements a portfolio optimizer.
 // The portfolio currently includes all the following optimizers:
@@ -50,6 +54,16 @@ class PortfolioOptimizer : public BopOptimizerBase {
                               const std::string& name);
   virtual ~PortfolioOptimizer();
 
+  // Returns the number of optimizers created for the given set. Note that the
+  // LOCAL_SEARCH method creates one optimizer per number of decisions.
+  static int NumOptimizers(const BopParameters& parameters,
+                           const BopSolverOptimizerSet& optimizer_set);
+
+  // Makes the selection of the next optimizer to run depend on the given
+  // statistics, shared with the other solvers running the same optimizer set.
+  // They must be about NumOptimizers() items. Not owned.
+  void SetSharedStatistics(SharedItemStatistics* shared_statistics);
+
   virtual bool RunOncePerSolution() const { return false; }
   virtual bool NeedAFeasibleSolution() const { return false; }
   virtual Status Optimize(const BopParameters& parameters,
@@ -69,6 +83,7 @@ class PortfolioOptimizer : public BopOptimizerBase {
   int64 state_update_stamp_;
   BopConstraintTerms objective_terms_;
   std::unique_ptr<AdaptativeItemSelector> selector_;
+  SharedItemStatistics* shared_statistics_;
   std::vector<std::unique_ptr<BopOptimizerBase>> optimizers_;
   std::vector<double> optimizer_initial_scores_;
   SatPropagator sat_propagator_;
@@ -77,6 +92,38 @@ class PortfolioOptimizer : public BopOptimizerBase {
   double upper_bound_;
 };
 
+// Statistics on n items shared by several AdaptativeItemSelector running in
+// parallel, typically the selectors of the optimizers of several solvers
+// running the same optimizer set. All the methods are thread-safe and
+// lock-free.
+class SharedItemStatistics {
+ public:
+  explicit SharedItemStatistics(int num_items);
+
+  int num_items() const { return num_items_; }
+
+  // Must be called around each run of an item.
+  void StartRun(int item) {
+    num_running_[item].fetch_add(1, std::memory_order_relaxed);
+  }
+  void EndRun(int item, bool success);
+
+  // Returns the factor to apply to the local score of the item. It is greater
+  // when the item recently succeeded, whatever the selector that ran it, and
+  // smaller when the item is currently run by other selectors.
+  double ScoreFactor(int item) const;
+
+ private:
+  const int num_items_;
+
+  // The score of each item, eroded as AdaptativeItemSelector::current_score
+  // but on the runs of all the selectors. It is in [0, 1].
+  std::unique_ptr<std::atomic<double>[]> scores_;
+  std::unique_ptr<std::atomic<int>[]> num_running_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedItemStatistics);
+};
+
 // This class provides a way to iteratively select an item among n items in
 // an adaptative way.
 // TODO(user): Document and move to util?
@@ -101,6 +148,12 @@ class AdaptativeItemSelector {
 
   void MarkItemNonSelectable(int item);
 
+  // When set, the score of each item is multiplied by its ScoreFactor() on
+  // selection. Not owned.
+  void SetSharedStatistics(const SharedItemStatistics* shared_statistics) {
+    shared_statistics_ = shared_statistics;
+  }
+
  private:
   struct Item {
     explicit Item(double initial_score)
@@ -120,6 +173,10 @@ class AdaptativeItemSelector {
   MTRandom random_;
   int selected_item_id_;
   std::vector<Item> items_;
+  const SharedItemStatistics* shared_statistics_;
+
+  // The scores used by the last SelectItem(), kept to avoid reallocations.
+  std::vector<double> selection_scores_;
 };
 
 }  // namespace bop
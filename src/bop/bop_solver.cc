@@ -13,13 +13,17 @@
 
 #include "bop/bop_solver.h"
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/commandlineflags.h"
 #include "base/stringprintf.h"
 #include "google/protobuf/text_format.h"
 #include "base/threadpool.h"
+#include "base/timer.h"
 #include "base/stl_util.h"
 #include "bop/bop_fs.h"
 #include "bop/bop_lns.h"
@@ -33,6 +37,7 @@
 #include "sat/lp_utils.h"
 #include "sat/sat_solver.h"
 #include "util/bitset.h"
+#include "util/metrics.h"
 
 using operations_research::glop::ColIndex;
 using operations_research::glop::DenseRow;
@@ -76,18 +81,29 @@ class SolverSynchronizer {
  public:
   struct Info {
     Info(const BopParameters& params, const LinearBooleanProblem& problem)
-        : parameters(params), problem_state(problem), learned_infos() {
+        : parameters(params),
+          problem_state(problem),
+          learned_infos(),
+          optimizer_statistics(nullptr) {
       problem_state.SetParameters(params);
     }
 
     BopParameters parameters;
     ProblemState problem_state;
     StampedLearnedInfo learned_infos;
+
+    // The statistics shared with the other solvers running the same optimizer
+    // set, or nullptr if they are not shared. Not owned.
+    SharedItemStatistics* optimizer_statistics;
   };
 
+  // The exchange is only used, and must only be given, with the
+  // SYNCHRONIZE_ASYNCHRONOUSLY synchronization type. The shared time limit is
+  // the one of all the solvers.
   SolverSynchronizer(
       int solver_index, const LinearBooleanProblem& problem,
-      std::vector<std::unique_ptr<SolverSynchronizer::Info>>* all_infos);
+      std::vector<std::unique_ptr<SolverSynchronizer::Info>>* all_infos,
+      LearnedInfoExchange* exchange, SharedTimeLimit* shared_time_limit);
 
   // Adds the learned info at the given stamp to the solver.
   void AddLearnedInfo(SolverTimeStamp stamp, const LearnedInfo& learned_info);
@@ -104,12 +120,28 @@ class SolverSynchronizer {
   // Marks the solver as done, i.e. it reached its last stamp.
   void MarkLastStampReached();
 
+  // Tells the other solvers that the problem is solved, i.e. its optimality or
+  // its infeasibility was proved. Only the asynchronous solvers can use this to
+  // stop early, through the shared time limit, the other ones get the
+  // information on their next synchronization.
+  void MarkProblemSolved();
+
+  // Gives the shared time limit to the local time limit of the solver.
+  void UpdateLocalTimeLimit(TimeLimit* time_limit) {
+    shared_time_limit_->UpdateLocalLimit(time_limit);
+  }
+
   // Returns the mutable problem state of the solver.
   ProblemState* GetMutableProblemState() const;
 
   // Returns the parameters of the solver.
   const BopParameters& GetParameters() const;
 
+  // Returns the shared statistics of the optimizers of the solver, or nullptr.
+  SharedItemStatistics* GetOptimizerStatistics() const {
+    return (*all_infos_)[solver_index_]->optimizer_statistics;
+  }
+
   // Returns the index of the solver.
   int solver_index() const { return solver_index_; }
 
@@ -117,17 +149,23 @@ class SolverSynchronizer {
   int solver_index_;
   std::vector<std::unique_ptr<SolverSynchronizer::Info>>* all_infos_;
   std::vector<int> solvers_to_sync_;
+  LearnedInfoExchange* exchange_;
+  SharedTimeLimit* shared_time_limit_;
   LearnedInfo learned_info_;
 };
 
 SolverSynchronizer::SolverSynchronizer(
     int solver_index, const LinearBooleanProblem& problem,
-    std::vector<std::unique_ptr<SolverSynchronizer::Info>>* all_infos)
+    std::vector<std::unique_ptr<SolverSynchronizer::Info>>* all_infos,
+    LearnedInfoExchange* exchange, SharedTimeLimit* shared_time_limit)
     : solver_index_(solver_index),
       all_infos_(all_infos),
       solvers_to_sync_(),
+      exchange_(exchange),
+      shared_time_limit_(shared_time_limit),
       learned_info_(problem) {
   CHECK(nullptr != all_infos_);
+  CHECK(nullptr != shared_time_limit_);
   CHECK_LT(solver_index_, all_infos_->size());
 
   switch ((*all_infos_)[solver_index]->parameters.synchronization_type()) {
@@ -144,13 +182,21 @@ SolverSynchronizer::SolverSynchronizer(
         solvers_to_sync_.push_back(index);
       }
       break;
+    case BopParameters::SYNCHRONIZE_ASYNCHRONOUSLY:
+      // The synchronization goes through the exchange_.
+      break;
     default:
       LOG(FATAL) << "Unknown synchronization type.";
   }
+  CHECK_EQ(solvers_to_sync_.empty(), nullptr != exchange_);
 }
 
 void SolverSynchronizer::AddLearnedInfo(SolverTimeStamp stamp,
                                         const LearnedInfo& learned_info) {
+  if (nullptr != exchange_) {
+    exchange_->Publish(solver_index_, learned_info);
+    return;
+  }
   (*all_infos_)[solver_index_]->learned_infos.AddLearnedInfo(stamp,
                                                              learned_info);
 }
@@ -163,6 +209,14 @@ void SolverSynchronizer::SynchronizeSolverInfos(SolverTimeStamp stamp,
 
   *problem_changed = false;
   *stop_solver = false;
+  if (nullptr != exchange_) {
+    learned_info_.Clear();
+    exchange_->Fetch(solver_index_, &learned_info_);
+    *problem_changed = GetMutableProblemState()->MergeLearnedInfo(
+        learned_info_, BopOptimizerBase::CONTINUE);
+    *stop_solver = exchange_->SearchDone();
+    return;
+  }
   for (const int index : solvers_to_sync_) {
     learned_info_.Clear();
     if (!(*all_infos_)[index]->learned_infos.GetLearnedInfo(stamp,
@@ -181,6 +235,13 @@ void SolverSynchronizer::MarkLastStampReached() {
   (*all_infos_)[solver_index_]->learned_infos.MarkLastStampReached();
 }
 
+void SolverSynchronizer::MarkProblemSolved() {
+  if (nullptr != exchange_) {
+    exchange_->MarkSearchDone();
+    shared_time_limit_->Stop();
+  }
+}
+
 const BopParameters& SolverSynchronizer::GetParameters() const {
   return (*all_infos_)[solver_index_]->parameters;
 }
@@ -200,6 +261,7 @@ void RunOptimizer(const std::string& name, SolverSynchronizer* solver_sync) {
                        parameters.max_deterministic_time());
   VLOG(1) << "limit: " << parameters.max_time_in_seconds() << " -- "
           << parameters.max_deterministic_time();
+  solver_sync->UpdateLocalTimeLimit(&time_limit);
   const int solver_index = solver_sync->solver_index();
 
   CHECK_LT(0, parameters.solver_optimizer_sets_size());
@@ -211,6 +273,9 @@ void RunOptimizer(const std::string& name, SolverSynchronizer* solver_sync) {
           : parameters.solver_optimizer_sets(solver_index);
   PortfolioOptimizer optimizer(*problem_state, parameters,
                                solver_optimizer_sets, "Portfolio_" + name);
+  if (solver_sync->GetOptimizerStatistics() != nullptr) {
+    optimizer.SetSharedStatistics(solver_sync->GetOptimizerStatistics());
+  }
 
   LearnedInfo learned_info(problem_state->original_problem());
   SolverTimeStamp stamp(0);
@@ -221,10 +286,11 @@ void RunOptimizer(const std::string& name, SolverSynchronizer* solver_sync) {
     bool problem_changed = false;
     bool stop_solver = false;
     solver_sync->SynchronizeSolverInfos(stamp, &problem_changed, &stop_solver);
-    if (stop_solver || problem_state->IsOptimal() ||
-        problem_state->IsInfeasible()) {
+    if (problem_state->IsOptimal() || problem_state->IsInfeasible()) {
+      solver_sync->MarkProblemSolved();
       return;
     }
+    if (stop_solver) return;
 
     if (optimization_status == BopOptimizerBase::SOLUTION_FOUND) {
       CHECK(problem_state->solution().IsFeasible());
@@ -264,8 +330,17 @@ BopSolveStatus BopSolver::Solve() {
 
   UpdateParameters();
 
-  return parameters_.number_of_solvers() > 1 ? InternalMultithreadSolver()
-                                             : InternalMonothreadSolver();
+  WallTimer timer;
+  timer.Start();
+  const BopSolveStatus status = parameters_.number_of_solvers() > 1
+                                    ? InternalMultithreadSolver()
+                                    : InternalMonothreadSolver();
+  MetricsRegistry* const metrics = MetricsRegistry::Global();
+  if (metrics->enabled()) {
+    metrics->IncrementCounter("bop", "solves", 1);
+    metrics->AddToHistogram("bop", "solve_time_seconds", timer.Get());
+  }
+  return status;
 }
 
 BopSolveStatus BopSolver::InternalMonothreadSolver() {
@@ -321,24 +396,66 @@ BopSolveStatus BopSolver::InternalMultithreadSolver() {
         learned_info, BopOptimizerBase::CONTINUE);
   }
 
+  // The solvers that run the same optimizer set share the statistics used to
+  // select their optimizers. Note that this is done after
+  // UpdateParameters(), so there is at least one optimizer set.
+  std::vector<std::unique_ptr<SharedItemStatistics>> optimizer_statistics;
+  if (parameters_.share_optimizer_statistics()) {
+    const int num_sets = parameters_.solver_optimizer_sets_size();
+    for (int set = 0; set < num_sets; ++set) {
+      optimizer_statistics.emplace_back(
+          new SharedItemStatistics(PortfolioOptimizer::NumOptimizers(
+              parameters_, parameters_.solver_optimizer_sets(set))));
+    }
+    for (int index = 0; index < num_solvers; ++index) {
+      all_infos[index]->optimizer_statistics =
+          optimizer_statistics[std::min(index, num_sets - 1)].get();
+    }
+  }
+
+  // In the asynchronous mode, the solvers share a lock-free exchange. We size
+  // its buffer so that each solver can publish a reasonable number of fixed
+  // literals and binary clauses between two fetches of the slowest solver.
+  std::unique_ptr<LearnedInfoExchange> exchange;
+  const bool asynchronous = parameters_.synchronization_type() ==
+                            BopParameters::SYNCHRONIZE_ASYNCHRONOUSLY;
+  if (asynchronous) {
+    const int kSlotsPerSolver = 1 << 12;
+    exchange.reset(new LearnedInfoExchange(problem_, num_solvers,
+                                           num_solvers * kSlotsPerSolver));
+  }
+
+  // The solvers keep their own deterministic limit, for reproducibility, so
+  // only the elapsed time limit is shared.
+  TimeLimit global_time_limit(parameters_.max_time_in_seconds());
+  SharedTimeLimit shared_time_limit(&global_time_limit);
+
   // Build dedicated synchronizers to forbid unsafe access to the memory of the
   // other solvers.
   std::vector<SolverSynchronizer> synchronizers;
   for (int index = 0; index < num_solvers; ++index) {
-    synchronizers.push_back(SolverSynchronizer(index, problem_, &all_infos));
+    synchronizers.push_back(SolverSynchronizer(index, problem_, &all_infos,
+                                               exchange.get(),
+                                               &shared_time_limit));
   }
 
   if (num_solvers > 1) {
-    LOG(FATAL) << "Multi threading is not supported";
-    // ThreadPool thread_pool("ParallelSolve", num_solvers);
-    // thread_pool.StartWorkers();
-    // for (int index = 0; index < num_solvers; ++index) {
-    //   const std::string solver_name = StringPrintf("Solver_%d", index);
-    //   SolverSynchronizer* const solver_sync = &synchronizers[index];
-    //   thread_pool.Schedule([solver_name, solver_sync]() {
-    //     RunOptimizer(solver_name, solver_sync);
-    //   });
-    // }
+    // The StampedLearnedInfo can't wait for a stamp in this version, so only
+    // the modes in which no solver waits for another one can run in parallel.
+    if (!asynchronous && parameters_.synchronization_type() !=
+                             BopParameters::NO_SYNCHRONIZATION) {
+      LOG(FATAL) << "Multi threading is only supported with the "
+                 << "NO_SYNCHRONIZATION and SYNCHRONIZE_ASYNCHRONOUSLY "
+                 << "synchronization types.";
+    }
+    ThreadPool thread_pool("ParallelSolve", num_solvers);
+    thread_pool.set_pin_workers(parameters_.pin_solver_threads());
+    for (int index = 0; index < num_solvers; ++index) {
+      thread_pool.Add(NewCallback(&RunOptimizer,
+                                  StringPrintf("Solver_%d", index),
+                                  &synchronizers[index]));
+    }
+    thread_pool.StartWorkers();
   } else {
     // TODO(user): Consider having a dedicated method to solve with only one
     //              solver.
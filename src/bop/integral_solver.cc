@@ -14,9 +14,14 @@
 #include "bop/integral_solver.h"
 
 #include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <vector>
 
+#include "base/mutex.h"
 #include "base/threadpool.h"
+#include "base/timer.h"
 #include "bop/bop_solver.h"
 #include "lp_data/lp_decomposer.h"
 
@@ -175,6 +180,12 @@ class IntegralVariable {
   // solution and the boolean solution to the problem.
   int64 GetSolutionValue(const BopSolution& solution) const;
 
+  // Sets the boolean variables of the solution so that the integral variable
+  // takes the given value. Returns false when this is not possible, i.e. when
+  // the value is out of range, or when the variable was not built from its
+  // range but from existing boolean variables.
+  bool SetSolutionValue(int64 value, BopSolution* solution) const;
+
   std::string DebugString() const;
 
  private:
@@ -184,9 +195,11 @@ class IntegralVariable {
   std::vector<VariableIndex> bits_;
   std::vector<int64> weights_;
   int64 offset_;
+  bool built_from_range_;
 };
 
-IntegralVariable::IntegralVariable() : bits_(), weights_(), offset_(0) {}
+IntegralVariable::IntegralVariable()
+    : bits_(), weights_(), offset_(0), built_from_range_(false) {}
 
 void IntegralVariable::BuildFromRange(int start_var_index,
                                       Fractional lower_bound,
@@ -207,12 +220,14 @@ void IntegralVariable::BuildFromRange(int start_var_index,
     bits_.push_back(VariableIndex(start_var_index + i));
     weights_.push_back(1ULL << i);
   }
+  built_from_range_ = true;
 }
 
 void IntegralVariable::Clear() {
   bits_.clear();
   weights_.clear();
   offset_ = 0;
+  built_from_range_ = false;
 }
 
 void IntegralVariable::set_weight(VariableIndex var, int64 weight) {
@@ -228,6 +243,17 @@ int64 IntegralVariable::GetSolutionValue(const BopSolution& solution) const {
   return value;
 }
 
+bool IntegralVariable::SetSolutionValue(int64 value,
+                                        BopSolution* solution) const {
+  if (!built_from_range_) return false;
+  const int64 delta = value - offset_;
+  if (delta < 0 || (delta >> bits_.size()) != 0) return false;
+  for (int i = 0; i < bits_.size(); ++i) {
+    solution->SetValue(bits_[i], (delta >> i) & 1);
+  }
+  return true;
+}
+
 std::string IntegralVariable::DebugString() const {
   std::string str;
   CHECK_EQ(bits_.size(), weights_.size());
@@ -268,6 +294,13 @@ class IntegralProblemConverter {
   // and the boolean solution to the problem.
   int64 GetSolutionValue(ColIndex col, const BopSolution& solution) const;
 
+  // Converts the given values of the linear_problem variables into a solution
+  // of the boolean problem. Returns false when some value cannot be converted,
+  // i.e. when it is not integral or out of range, or when its variable is
+  // expressed using other variables of the problem.
+  bool ConvertSolution(const LinearProgram& linear_problem,
+                       const DenseRow& values, BopSolution* solution) const;
+
  private:
   // Returns true when the linear_problem_ can be converted into a boolean
   // problem. Note that floating weigths and continuous variables are not
@@ -397,6 +430,27 @@ int64 IntegralProblemConverter::GetSolutionValue(
                   : integral_variables_[-pos - 1].GetSolutionValue(solution);
 }
 
+bool IntegralProblemConverter::ConvertSolution(
+    const LinearProgram& linear_problem, const DenseRow& values,
+    BopSolution* solution) const {
+  CHECK(solution != nullptr);
+  CHECK_EQ(linear_problem.num_variables(), values.size());
+  for (ColIndex col(0); col < linear_problem.num_variables(); ++col) {
+    if (!IsIntegerWithinTolerance(values[col])) return false;
+    const int64 value = static_cast<int64>(round(values[col]));
+    const int pos = boolean_with_int_constraints_ ? col.value()
+                                                  : boolean_variables_[col];
+    if (pos >= 0) {
+      if (value != 0 && value != 1) return false;
+      solution->SetValue(VariableIndex(pos), value == 1);
+    } else if (!integral_variables_[-pos - 1].SetSolutionValue(value,
+                                                                solution)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool IntegralProblemConverter::CheckProblem(
     const LinearProgram& linear_problem) const {
   for (ColIndex col(0); col < linear_problem.num_variables(); ++col) {
@@ -819,9 +873,12 @@ bool CheckSolution(const LinearProgram& linear_problem,
   return true;
 }
 
-// Solves the given linear program and returns the solve status.
+// Solves the given linear program and returns the solve status. When
+// initial_solution is not empty, the search starts from it if it is a
+// feasible solution of the problem.
 BopSolveStatus InternalSolve(const LinearProgram& linear_problem,
                              const BopParameters& parameters,
+                             const DenseRow& initial_solution,
                              DenseRow* variable_values,
                              Fractional* objective_value,
                              Fractional* best_bound) {
@@ -842,7 +899,20 @@ BopSolveStatus InternalSolve(const LinearProgram& linear_problem,
 
   BopSolver bop_solver(boolean_problem);
   bop_solver.SetParameters(parameters);
-  const BopSolveStatus status = bop_solver.Solve();
+  bool use_initial_solution = false;
+  BopSolution first_solution(boolean_problem, "InitialSolution");
+  if (!initial_solution.empty()) {
+    use_initial_solution =
+        converter.ConvertSolution(linear_problem, initial_solution,
+                                  &first_solution) &&
+        first_solution.IsFeasible();
+    if (!use_initial_solution) {
+      VLOG(1) << "The initial solution is not feasible, ignoring it.";
+    }
+  }
+  const BopSolveStatus status = use_initial_solution
+                                    ? bop_solver.Solve(first_solution)
+                                    : bop_solver.Solve();
   if (status == BopSolveStatus::OPTIMAL_SOLUTION_FOUND ||
       status == BopSolveStatus::FEASIBLE_SOLUTION_FOUND) {
     // Compute objective value.
@@ -867,38 +937,85 @@ BopSolveStatus InternalSolve(const LinearProgram& linear_problem,
   return status;
 }
 
-void RunOneBop(const BopParameters& parameters, int problem_index,
-               LPDecomposer* decomposer, DenseRow* variable_values,
-               Fractional* objective_value, Fractional* best_bound,
-               BopSolveStatus* status) {
-  CHECK(decomposer != nullptr);
+// Distributes the wall time limit of a decomposed problem between its
+// sub-problems, in proportion of their number of variables. With num_threads
+// sub-problems solved concurrently, the total budget is num_threads times the
+// time limit, but no sub-problem can end after the time limit. The time not
+// used by a sub-problem is given back and shared by the ones starting later,
+// which is why the largest sub-problems should be started first.
+class DecompositionTimeBudget {
+ public:
+  DecompositionTimeBudget(double max_time_in_seconds, int num_threads,
+                          int total_num_variables)
+      : max_time_in_seconds_(max_time_in_seconds),
+        remaining_time_(max_time_in_seconds * num_threads),
+        remaining_num_variables_(total_num_variables) {
+    timer_.Start();
+  }
+
+  // Returns the time limit of a sub-problem starting now.
+  double Allocate(int num_variables) LOCKS_EXCLUDED(mutex_) {
+    MutexLock mutex_lock(&mutex_);
+    const double time_left =
+        std::max(0.0, max_time_in_seconds_ - timer_.Get());
+    if (max_time_in_seconds_ == std::numeric_limits<double>::infinity()) {
+      return time_left;
+    }
+    const double share =
+        remaining_time_ * num_variables /
+        std::max(1.0, static_cast<double>(remaining_num_variables_));
+    const double limit = std::min(share, time_left);
+    remaining_time_ = std::max(0.0, remaining_time_ - limit);
+    remaining_num_variables_ -= num_variables;
+    return limit;
+  }
+
+  // Gives back the part of an allocated time limit that was not used.
+  void Release(double allocated_time, double used_time) LOCKS_EXCLUDED(mutex_) {
+    if (max_time_in_seconds_ == std::numeric_limits<double>::infinity()) return;
+    MutexLock mutex_lock(&mutex_);
+    remaining_time_ += std::max(0.0, allocated_time - used_time);
+  }
+
+ private:
+  const double max_time_in_seconds_;
+  WallTimer timer_;
+  Mutex mutex_;
+  double remaining_time_ GUARDED_BY(mutex_);
+  int remaining_num_variables_ GUARDED_BY(mutex_);
+};
+
+// Solves the given sub-problem of a decomposition of a problem with
+// total_num_variables variables. The deterministic time limit is split in
+// proportion of the number of variables so that the result doesn't depend on
+// the thread scheduling, the wall time limit comes from the given budget.
+void RunOneBop(const BopParameters& parameters, const LinearProgram& problem,
+               int total_num_variables, DecompositionTimeBudget* budget,
+               DenseRow* variable_values, Fractional* objective_value,
+               Fractional* best_bound, BopSolveStatus* status) {
+  CHECK(budget != nullptr);
   CHECK(variable_values != nullptr);
   CHECK(objective_value != nullptr);
   CHECK(best_bound != nullptr);
   CHECK(status != nullptr);
 
-  LinearProgram problem;
-  decomposer->BuildProblem(problem_index, &problem);
-
   // TODO(user): Investigate a better approximation of the time needed to
   //              solve the problem than just the number of variables.
-  const double total_num_variables =
-      std::max(1.0, static_cast<double>(
-                   decomposer->original_problem().num_variables().value()));
-  const double time_per_variable =
-      parameters.max_time_in_seconds() / total_num_variables;
-  const double deterministic_time_per_variable =
-      parameters.max_deterministic_time() / total_num_variables;
   const int local_num_variables = std::max(1, problem.num_variables().value());
+  const double deterministic_time_per_variable =
+      parameters.max_deterministic_time() / std::max(1, total_num_variables);
+  const double time_limit = budget->Allocate(local_num_variables);
 
   BopParameters local_parameters = parameters;
-  local_parameters.set_max_time_in_seconds(time_per_variable *
-                                           local_num_variables);
+  local_parameters.set_max_time_in_seconds(time_limit);
   local_parameters.set_max_deterministic_time(deterministic_time_per_variable *
                                               local_num_variables);
 
-  *status = InternalSolve(problem, local_parameters, variable_values,
-                          objective_value, best_bound);
+  WallTimer timer;
+  timer.Start();
+  *status = InternalSolve(problem, local_parameters, DenseRow(),
+                          variable_values, objective_value, best_bound);
+  budget->Release(time_limit, timer.Get());
 }
 }  // anonymous namespace
 
@@ -906,6 +1023,11 @@ IntegralSolver::IntegralSolver()
     : parameters_(), variable_values_(), objective_value_(0.0) {}
 
 BopSolveStatus IntegralSolver::Solve(const LinearProgram& linear_problem) {
+  return SolveWithInitialSolution(linear_problem, DenseRow());
+}
+
+BopSolveStatus IntegralSolver::SolveWithInitialSolution(
+    const LinearProgram& linear_problem, const DenseRow& initial_solution) {
   // Some code path requires to copy the given linear_problem. When this happen,
   // we will simply change the target of this pointer.
   LinearProgram const* lp = &linear_problem;
@@ -924,10 +1046,43 @@ BopSolveStatus IntegralSolver::Solve(const LinearProgram& linear_problem) {
       std::vector<Fractional> best_bounds(num_sub_problems, Fractional(0.0));
       std::vector<BopSolveStatus> statuses(num_sub_problems,
                                       BopSolveStatus::INVALID_PROBLEM);
-        for (int i = 0; i < num_sub_problems; ++i) {
-          RunOneBop(parameters_, i, &decomposer, &(variable_values[i]),
-                    &(objective_values[i]), &(best_bounds[i]), &(statuses[i]));
+
+      // The sub-problems are solved by decreasing number of variables, so that
+      // the time left by the small ones that finish early can be given to the
+      // other small ones.
+      std::vector<LinearProgram> problems(num_sub_problems);
+      std::vector<int> order(num_sub_problems);
+      int total_num_variables = 0;
+      for (int i = 0; i < num_sub_problems; ++i) {
+        decomposer.BuildProblem(i, &problems[i]);
+        total_num_variables += std::max(1, problems[i].num_variables().value());
+        order[i] = i;
+      }
+      std::stable_sort(order.begin(), order.end(), [&problems](int a, int b) {
+        return problems[a].num_variables() > problems[b].num_variables();
+      });
+
+      const int num_threads = std::max(
+          1, std::min(num_sub_problems,
+                      parameters_.num_bop_solvers_used_by_decomposition()));
+      DecompositionTimeBudget budget(parameters_.max_time_in_seconds(),
+                                     num_threads, total_num_variables);
+      std::atomic<int> next(0);
+      const auto solve_next_problems = [&]() {
+        for (int k = next++; k < num_sub_problems; k = next++) {
+          const int i = order[k];
+          RunOneBop(parameters_, problems[i], total_num_variables, &budget,
+                    &(variable_values[i]), &(objective_values[i]),
+                    &(best_bounds[i]), &(statuses[i]));
         }
+      };
+      if (num_threads > 1) {
+        ThreadPool pool("DecomposedSolve", num_threads);
+        for (int t = 0; t < num_threads; ++t) pool.Add(solve_next_problems);
+        pool.StartWorkers();
+      } else {
+        solve_next_problems();
+      }
 
       // Aggregate results.
       status = BopSolveStatus::OPTIMAL_SOLUTION_FOUND;
@@ -949,12 +1104,13 @@ BopSolveStatus IntegralSolver::Solve(const LinearProgram& linear_problem) {
       variable_values_ = decomposer.AggregateAssignments(variable_values);
       CheckSolution(*lp, variable_values_);
     } else {
-      status = InternalSolve(*lp, parameters_, &variable_values_,
-                             &objective_value_, &best_bound_);
+      status = InternalSolve(*lp, parameters_, initial_solution,
+                             &variable_values_, &objective_value_,
+                             &best_bound_);
     }
   } else {
-    status = InternalSolve(*lp, parameters_, &variable_values_,
-                           &objective_value_, &best_bound_);
+    status = InternalSolve(*lp, parameters_, initial_solution,
+                           &variable_values_, &objective_value_, &best_bound_);
   }
 
   return status;
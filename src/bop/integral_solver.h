@@ -45,6 +45,14 @@ class IntegralSolver {
   BopSolveStatus Solve(const glop::LinearProgram& linear_problem)
       MUST_USE_RESULT;
 
+  // Same as Solve(), but starts the search from the given solution (one value
+  // per variable of the linear program). The solution is ignored when it is
+  // empty or not feasible, and when the problem is decomposed into
+  // independent sub-problems.
+  BopSolveStatus SolveWithInitialSolution(
+      const glop::LinearProgram& linear_problem,
+      const glop::DenseRow& initial_solution) MUST_USE_RESULT;
+
   // Returns the objective value of the solution with its offset.
   glop::Fractional objective_value() const { return objective_value_; }
 
@@ -11,7 +11,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstring>
 #include <list>
+#include <map>
+#include <memory>
 
 #include "base/integral_types.h"
 #include "base/logging.h"
@@ -19,6 +22,8 @@
 #include "base/int_type_indexed_vector.h"
 #include "base/int_type.h"
 #include "base/map_util.h"
+#include "base/mutex.h"
+#include "base/fingerprint2011.h"
 #include "base/stl_util.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
@@ -284,6 +289,143 @@ class MDD_Factory {
 
 };
 
+// Immutable, compact form of the MDD built from a tuple set: nodes are
+// numbered in breadth-first order from the root (node 0), and edges are
+// stored in flat arrays, sorted by start node. It only holds the structure
+// of the MDD; the reversible state lives in MyMDD. Compiled MDDs are shared
+// by all the constraints, in all the solvers, built on equal tuple sets.
+class CompiledMdd {
+ public:
+  explicit CompiledMdd(const IntTupleSet& tuples)
+      : tuples_(tuples),
+        values_(tuples.Arity()),
+        num_edges_by_value_(tuples.Arity()),
+        num_nodes_by_level_(tuples.Arity() + 1, 0) {
+    MDD_Factory mf;
+    MDD* mdd = mf.mddify(tuples);
+
+    // Creation of the conversion table.
+    for (int var = 0; var < mf.vm_.size(); var++) {
+      for (int val = 0; val < mf.vm_[var].size(); val++) {
+        values_[var].Add(mf.vm_[var][val]);
+      }
+      num_edges_by_value_[var].assign(mf.vm_[var].size(), 0);
+    }
+
+    // Index of each MDD node in node_variable_, by MDD id.
+    std::vector<int> node_index(mf.getNbInstance(), -1);
+    std::list<MDD*> tmp;
+    tmp.push_back(mdd);
+    node_index[mdd->getID()] = node_variable_.size();
+    node_variable_.push_back(mdd->getNumVar());
+    mdd->setVisited(true);
+
+    while (tmp.size() > 0) {
+      mdd = tmp.front();
+      tmp.pop_front();
+      // Count the number of nodes at each level.
+      num_nodes_by_level_[mdd->getNumVar()]++;
+      for (int value = 0; value < mdd->size(); value++) {
+        MDD* const child = (*mdd)[value];
+        if (child != nullptr) {
+          if (!child->isVisited()) {
+            node_index[child->getID()] = node_variable_.size();
+            node_variable_.push_back(child->getNumVar());
+            tmp.push_back(child);
+            child->setVisited(true);
+          }
+          edge_start_.push_back(node_index[mdd->getID()]);
+          edge_end_.push_back(node_index[child->getID()]);
+          edge_value_.push_back(value);
+          num_edges_by_value_[mdd->getNumVar()][value]++;
+        }
+      }
+    }
+
+    node_in_degree_.assign(node_variable_.size(), 0);
+    node_out_degree_.assign(node_variable_.size(), 0);
+    for (int edge = 0; edge < edge_start_.size(); ++edge) {
+      node_out_degree_[edge_start_[edge]]++;
+      node_in_degree_[edge_end_[edge]]++;
+    }
+
+    delete mdd;
+  }
+
+  // Returns the compiled MDD of 'tuples', compiling it only if no MDD built
+  // on an equal tuple set is still in use.
+  static std::shared_ptr<const CompiledMdd> Get(const IntTupleSet& tuples) {
+    const int64* const data = tuples.RawData();
+    const uint64 fprint = FingerprintCat2011(
+        Fingerprint2011(reinterpret_cast<const char*>(data),
+                        static_cast<size_t>(tuples.NumTuples()) *
+                            tuples.Arity() * sizeof(*data)),
+        tuples.Arity());
+    static Mutex registry_mutex;
+    static std::multimap<uint64, std::weak_ptr<const CompiledMdd>>* const
+        registry = new std::multimap<uint64, std::weak_ptr<const CompiledMdd>>;
+    MutexLock lock(&registry_mutex);
+    auto it = registry->lower_bound(fprint);
+    while (it != registry->end() && it->first == fprint) {
+      std::shared_ptr<const CompiledMdd> registered = it->second.lock();
+      if (registered == nullptr) {
+        it = registry->erase(it);
+      } else if (registered->CompiledFrom(tuples)) {
+        return registered;
+      } else {
+        ++it;
+      }
+    }
+    std::shared_ptr<const CompiledMdd> compiled(new CompiledMdd(tuples));
+    registry->insert(std::make_pair(fprint, compiled));
+    return compiled;
+  }
+
+  int Arity() const { return tuples_.Arity(); }
+  int NumNodes() const { return node_variable_.size(); }
+  int NumEdges() const { return edge_start_.size(); }
+  int NumNodesAtLevel(int level) const { return num_nodes_by_level_[level]; }
+
+  int NodeVariable(int node) const { return node_variable_[node]; }
+  int NodeInDegree(int node) const { return node_in_degree_[node]; }
+  int NodeOutDegree(int node) const { return node_out_degree_[node]; }
+
+  int EdgeStart(int edge) const { return edge_start_[edge]; }
+  int EdgeEnd(int edge) const { return edge_end_[edge]; }
+  int EdgeValue(int edge) const { return edge_value_[edge]; }
+
+  const VectorMap<int64>& Values(int var) const { return values_[var]; }
+  const std::vector<int>& NumEdgesByValue(int var) const {
+    return num_edges_by_value_[var];
+  }
+
+ private:
+  bool CompiledFrom(const IntTupleSet& tuples) const {
+    if (tuples.Arity() != tuples_.Arity() ||
+        tuples.NumTuples() != tuples_.NumTuples()) {
+      return false;
+    }
+    return tuples.RawData() == tuples_.RawData() ||
+           memcmp(tuples.RawData(), tuples_.RawData(),
+                  static_cast<size_t>(tuples.NumTuples()) * tuples.Arity() *
+                      sizeof(int64)) == 0;
+  }
+
+  // Shares the data of the source tuple set, to check equality.
+  const IntTupleSet tuples_;
+  std::vector<VectorMap<int64> > values_;
+  std::vector<std::vector<int> > num_edges_by_value_;
+  std::vector<int> num_nodes_by_level_;
+  std::vector<int> node_variable_;
+  std::vector<int> node_in_degree_;
+  std::vector<int> node_out_degree_;
+  std::vector<int> edge_start_;
+  std::vector<int> edge_end_;
+  std::vector<int> edge_value_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompiledMdd);
+};
+
 class Sparse_Set_Rev : public NumericalRev<int> {
  public:
   //size is the size of sparse
@@ -408,34 +550,6 @@ class Sparse_Set {
 };
 
 class MyMDD {
-  class Edge {
-   public:
-    Edge(int value, int start, int end, int id)
-        : value_(value), in_the_list_(0), id_(id), start_(start), end_(end) {}
-
-    void setInTheList(int state) { in_the_list_ = state; }
-    inline int getInTheList() { return in_the_list_; }
-
-    inline int getValue() { return value_; }
-
-    inline int getStart() { return start_; }
-
-    void setStart(int start) { start_ = start; }
-
-    inline int getEnd() { return end_; }
-
-    void setEnd(int end) { end_ = end; }
-
-   private:
-    int start_;
-    int end_;
-    //bool to know if a Edge is already in the delete liste
-    int in_the_list_;
-    int id_;
-
-    int value_;
-  };
-
   class Node {
    public:
     Node(int var, int* shared_in, int* shared_out, int nb_in, int nb_out,
@@ -483,116 +597,46 @@ class MyMDD {
 
  public:
 
-  MyMDD(const IntTupleSet& tuples, Solver* solver)
-      : vm_(),
-        number_of_edges_by_value(),
-        edges_(),
+  MyMDD(const std::shared_ptr<const CompiledMdd>& compiled, Solver* solver)
+      : compiled_(compiled),
         nodes_(),
         shared_in_(nullptr),
         shared_out_(nullptr),
         shared_nodes(),
-        number_of_edge(0),
         nodes_lvl(),
         sizeBeforeReset(),
         edges_lvl() {
-    //Construct the MDD
-    MDD_Factory mf;
-    MDD* mdd = mf.mddify(tuples);
+    const int number_of_edge = compiled_->NumEdges();
+    const int number_of_node = compiled_->NumNodes();
+    shared_in_ = new int[number_of_edge];
+    shared_out_ = new int[number_of_edge];
+    shared_nodes = new int[number_of_node + 1];
 
-    //
-    std::list<MDD*> tmp;
-    number_of_edge = 0;
-
-    //creation of the convertion table
-    for (int var = 0; var < mf.vm_.size(); var++) {
-      vm_.push_back(VectorMap<int64>());
-      number_of_edges_by_value.push_back(std::vector<int>());
-      for (int val = 0; val < mf.vm_[var].size(); val++) {
-        vm_[var].Add(mf.vm_[var][val]);
-        number_of_edges_by_value[var].push_back(0);
-
-      }
-
-    }
-
-    //will count how many arc are intering in a node
-    std::vector<int> nb_in(mf.getNbInstance(), 0);
-    //will count how many arc will get out from a node
-    std::vector<int> nb_out(mf.getNbInstance(), 0);
-
-    std::vector<int> num_var(mf.getNbInstance(), -1);
-
-    std::vector<int> indice;
-
-    std::vector<int> nb_nodes_lvl(tuples.Arity() + 1, 0);
-
-    tmp.push_back(mdd);
-
-    num_var[mdd->getID()] = indice.size();
-    indice.push_back(mdd->getNumVar());
-    mdd->setVisited(true);
-
-    while (tmp.size() > 0) {
-
-      mdd = tmp.front();
-      tmp.pop_front();
-      //count the number of node at each lvl
-      nb_nodes_lvl[mdd->getNumVar()]++;
-      for (int value = 0; value < mdd->size(); value++) {
-        if ((*mdd)[value] != nullptr) {
-
-          if (!(*mdd)[value]->isVisited()) {
-
-            num_var[(*mdd)[value]->getID()] = indice.size();
-            indice.push_back((*mdd)[value]->getNumVar());
-
-            tmp.push_back((*mdd)[value]);
-            (*mdd)[value]->setVisited(true);
-          }
-
-          edges_.push_back(
-              new Edge(value, num_var[mdd->getID()],
-                       num_var[(*mdd)[value]->getID()], number_of_edge++));
-
-          nb_in[num_var[(*mdd)[value]->getID()]]++;
-          nb_out[num_var[mdd->getID()]]++;
-
-          number_of_edges_by_value[mdd->getNumVar()][value]++;
-
-        }
-      }
-
-    }
-
-    shared_in_ = new int[edges_.size()];
-    shared_out_ = new int[edges_.size()];
-    shared_nodes = new int[indice.size() + 1];
-
-    for (int lvl = 0; lvl < tuples.Arity() + 1; ++lvl) {
-      nodes_lvl.push_back(new Sparse_Set_Rev(indice.size(), shared_nodes,
-                                             new int[nb_nodes_lvl[lvl]]));
+    for (int lvl = 0; lvl < compiled_->Arity() + 1; ++lvl) {
+      nodes_lvl.push_back(
+          new Sparse_Set_Rev(number_of_node, shared_nodes,
+                             new int[compiled_->NumNodesAtLevel(lvl)]));
 
       sizeBeforeReset.push_back(0);
 
       edges_lvl.push_back(new NumericalRev<int>(0));
     }
 
-    for (int n = 0; n < indice.size(); n++) {
-      nodes_.push_back(new Node(indice[n], shared_in_, shared_out_, nb_in[n],
-                                nb_out[n], number_of_edge));
+    for (int n = 0; n < number_of_node; n++) {
+      nodes_.push_back(new Node(compiled_->NodeVariable(n), shared_in_,
+                                shared_out_, compiled_->NodeInDegree(n),
+                                compiled_->NodeOutDegree(n), number_of_edge));
 
       //add the nodes to the correct set
-      nodes_lvl[indice[n]]->addMember(n, solver);
+      nodes_lvl[compiled_->NodeVariable(n)]->addMember(n, solver);
     }
 
-    for (int edge = 0; edge < edges_.size(); edge++) {
-      nodes_[edges_[edge]->getStart()]->InsertEdgeOut(edge, solver);
-      edges_lvl[nodes_[edges_[edge]->getStart()]->getVariable()]->Incr(solver);
-      nodes_[edges_[edge]->getEnd()]->InsertEdgeIn(edge, solver);
+    for (int edge = 0; edge < number_of_edge; edge++) {
+      nodes_[compiled_->EdgeStart(edge)]->InsertEdgeOut(edge, solver);
+      edges_lvl[nodes_[compiled_->EdgeStart(edge)]->getVariable()]->Incr(
+          solver);
+      nodes_[compiled_->EdgeEnd(edge)]->InsertEdgeIn(edge, solver);
     }
-
-    delete mdd;
-
   }
 
   ~MyMDD() {
@@ -600,11 +644,6 @@ class MyMDD {
     delete shared_out_;
     delete shared_nodes;
 
-    for (int i = 0; i < edges_.size(); ++i) {
-      if (edges_[i] != nullptr) {
-        delete edges_[i];
-      }
-    }
     for (int i = 0; i < nodes_.size(); ++i) {
       if (nodes_[i] != nullptr) {
         delete nodes_[i];
@@ -613,14 +652,16 @@ class MyMDD {
 
   }
 
-  inline int getIndexVal(int index, int64 val) { return vm_[index].Index(val); }
+  inline int getIndexVal(int index, int64 val) {
+    return compiled_->Values(index).Index(val);
+  }
 
   inline bool containValIndex(int index, int64 val) {
-    return vm_[index].Contains(val);
+    return compiled_->Values(index).Contains(val);
   }
 
   inline int64 getValForIndex(int index, int val) {
-    return vm_[index].Element(val);
+    return compiled_->Values(index).Element(val);
   }
 
   /**
@@ -634,7 +675,7 @@ class MyMDD {
   }
   void getRemovedEdgeUp(int edge, std::vector<int>& deleteList,
                         Solver* solver) {
-    const int e_start = edges_[edge]->getStart();
+    const int e_start = compiled_->EdgeStart(edge);
     if (!nodes_[e_start]->isVisited() &&
         nodes_[e_start]->getNumberOfEdgeOut() == 0) {
       nodes_[e_start]->setVisited(solver);
@@ -650,7 +691,7 @@ class MyMDD {
   void getRemovedEdgeDown(int edge, std::vector<int>& deleteList,
                           Solver* solver) {
 
-    const int e_end = edges_[edge]->getEnd();
+    const int e_end = compiled_->EdgeEnd(edge);
     if (!nodes_[e_end]->isVisited() &&
         nodes_[e_end]->getNumberOfEdgeIn() == 0) {
       nodes_[e_end]->setVisited(solver);
@@ -664,18 +705,18 @@ class MyMDD {
   }
 
   void removeEdge(int edge, Solver* solver) {
-    nodes_[edges_[edge]->getStart()]->removeEdgeOut(edge, solver);
-    nodes_[edges_[edge]->getEnd()]->removeEdgeIn(edge, solver);
+    nodes_[compiled_->EdgeStart(edge)]->removeEdgeOut(edge, solver);
+    nodes_[compiled_->EdgeEnd(edge)]->removeEdgeIn(edge, solver);
 
   }
   void removeEdgeUp(int edge, Solver* solver) {
-    nodes_[edges_[edge]->getStart()]->removeEdgeOut(edge, solver);
-    // nodes_[edges_[edge]->getEnd()]->removeEdgeIn(edge, solver);
+    nodes_[compiled_->EdgeStart(edge)]->removeEdgeOut(edge, solver);
+    // nodes_[compiled_->EdgeEnd(edge)]->removeEdgeIn(edge, solver);
 
   }
   void removeEdgeDown(int edge, Solver* solver) {
-    // nodes_[edges_[edge]->getStart()]->removeEdgeOut(edge, solver);
-    nodes_[edges_[edge]->getEnd()]->removeEdgeIn(edge, solver);
+    // nodes_[compiled_->EdgeStart(edge)]->removeEdgeOut(edge, solver);
+    nodes_[compiled_->EdgeEnd(edge)]->removeEdgeIn(edge, solver);
 
   }
 
@@ -689,7 +730,7 @@ class MyMDD {
 
   void resetDeleteEdgeUp(int edge, Solver* solver, int& cptUp) {
     removeEdgeUp(edge, solver);
-    const int e_start = edges_[edge]->getStart();
+    const int e_start = compiled_->EdgeStart(edge);
     if (nodes_[e_start]->getNumberOfEdgeOut() == 0) {
       cptUp += nodes_[e_start]->getNumberOfEdgeIn();
       nodes_lvl[nodes_[e_start]->getVariable()]->remove(e_start, solver);
@@ -698,7 +739,7 @@ class MyMDD {
 
   void resetDeleteEdgeDown(int edge, Solver* solver, int& cptDown) {
     removeEdgeDown(edge, solver);
-    const int e_end = edges_[edge]->getEnd();
+    const int e_end = compiled_->EdgeEnd(edge);
     if (nodes_[e_end]->getNumberOfEdgeIn() == 0) {
       cptDown += nodes_[e_end]->getNumberOfEdgeOut();
       nodes_lvl[nodes_[e_end]->getVariable()]->remove(e_end, solver);
@@ -710,7 +751,7 @@ class MyMDD {
     resetRestoreEdgeDown(edge, solver, cptDown);
   }
   void resetRestoreEdgeUp(int edge, Solver* solver, int& cptUp) {
-    const int e_start = edges_[edge]->getStart();
+    const int e_start = compiled_->EdgeStart(edge);
     if (!nodes_lvl[nodes_[e_start]->getVariable()]->isMember(e_start)) {
       //we clear the node to delete the deleted edges
       nodes_[e_start]->ClearEdgeOut(solver);
@@ -722,7 +763,7 @@ class MyMDD {
     nodes_[e_start]->RestoreEdgeOut(edge, solver);
   }
   void resetRestoreEdgeDown(int edge, Solver* solver, int& cptDown) {
-    const int e_end = edges_[edge]->getEnd();
+    const int e_end = compiled_->EdgeEnd(edge);
     if (!nodes_lvl[nodes_[e_end]->getVariable()]->isMember(e_end)) {
       nodes_[e_end]->ClearEdgeIn(solver);
 
@@ -789,22 +830,22 @@ class MyMDD {
   void getStillValidEdges(int edge, std::vector<int>& ListDown,
                           std::vector<int>& ListUp, Solver* solver) {
 
-    if (nodes_[edges_[edge]->getStart()]->getNumberOfEdgeIn() > 0) {
-      int i = nodes_[edges_[edge]->getStart()]->getNumberOfEdgeIn() - 1;
+    if (nodes_[compiled_->EdgeStart(edge)]->getNumberOfEdgeIn() > 0) {
+      int i = nodes_[compiled_->EdgeStart(edge)]->getNumberOfEdgeIn() - 1;
       while (i > -1) {
-        ListUp.push_back(nodes_[edges_[edge]->getStart()]->getEdgeIn(i--));
+        ListUp.push_back(nodes_[compiled_->EdgeStart(edge)]->getEdgeIn(i--));
       }
-      nodes_[edges_[edge]->getStart()]->ClearEdgeIn(solver);
-      nodes_[edges_[edge]->getStart()]->ClearEdgeOut(solver);
+      nodes_[compiled_->EdgeStart(edge)]->ClearEdgeIn(solver);
+      nodes_[compiled_->EdgeStart(edge)]->ClearEdgeOut(solver);
     }
 
-    if (nodes_[edges_[edge]->getEnd()]->getNumberOfEdgeOut() > 0) {
-      int i = nodes_[edges_[edge]->getEnd()]->getNumberOfEdgeOut() - 1;
+    if (nodes_[compiled_->EdgeEnd(edge)]->getNumberOfEdgeOut() > 0) {
+      int i = nodes_[compiled_->EdgeEnd(edge)]->getNumberOfEdgeOut() - 1;
       while (i > -1) {
-        ListDown.push_back(nodes_[edges_[edge]->getEnd()]->getEdgeOut(i--));
+        ListDown.push_back(nodes_[compiled_->EdgeEnd(edge)]->getEdgeOut(i--));
       }
-      nodes_[edges_[edge]->getEnd()]->ClearEdgeOut(solver);
-      nodes_[edges_[edge]->getEnd()]->ClearEdgeIn(solver);
+      nodes_[compiled_->EdgeEnd(edge)]->ClearEdgeOut(solver);
+      nodes_[compiled_->EdgeEnd(edge)]->ClearEdgeIn(solver);
     }
 
   }
@@ -812,13 +853,13 @@ class MyMDD {
   void getStillValidEdgesUp(int edge, std::vector<int>& ListUp,
                             Solver* solver) {
 
-    if (nodes_[edges_[edge]->getStart()]->getNumberOfEdgeIn() > 0) {
-      int i = nodes_[edges_[edge]->getStart()]->getNumberOfEdgeIn() - 1;
+    if (nodes_[compiled_->EdgeStart(edge)]->getNumberOfEdgeIn() > 0) {
+      int i = nodes_[compiled_->EdgeStart(edge)]->getNumberOfEdgeIn() - 1;
       while (i > -1) {
-        ListUp.push_back(nodes_[edges_[edge]->getStart()]->getEdgeIn(i--));
+        ListUp.push_back(nodes_[compiled_->EdgeStart(edge)]->getEdgeIn(i--));
       }
-      nodes_[edges_[edge]->getStart()]->ClearEdgeIn(solver);
-      nodes_[edges_[edge]->getStart()]->ClearEdgeOut(solver);
+      nodes_[compiled_->EdgeStart(edge)]->ClearEdgeIn(solver);
+      nodes_[compiled_->EdgeStart(edge)]->ClearEdgeOut(solver);
     }
 
   }
@@ -826,40 +867,41 @@ class MyMDD {
   void getStillValidEdgesDown(int edge, std::vector<int>& ListDown,
                               Solver* solver) {
 
-    if (nodes_[edges_[edge]->getEnd()]->getNumberOfEdgeOut() > 0) {
-      int i = nodes_[edges_[edge]->getEnd()]->getNumberOfEdgeOut() - 1;
+    if (nodes_[compiled_->EdgeEnd(edge)]->getNumberOfEdgeOut() > 0) {
+      int i = nodes_[compiled_->EdgeEnd(edge)]->getNumberOfEdgeOut() - 1;
       while (i > -1) {
-        ListDown.push_back(nodes_[edges_[edge]->getEnd()]->getEdgeOut(i--));
+        ListDown.push_back(nodes_[compiled_->EdgeEnd(edge)]->getEdgeOut(i--));
       }
-      nodes_[edges_[edge]->getEnd()]->ClearEdgeOut(solver);
-      nodes_[edges_[edge]->getEnd()]->ClearEdgeIn(solver);
+      nodes_[compiled_->EdgeEnd(edge)]->ClearEdgeOut(solver);
+      nodes_[compiled_->EdgeEnd(edge)]->ClearEdgeIn(solver);
     }
 
   }
 
   void restoreEdge(int edge, Solver* solver) {
-    nodes_[edges_[edge]->getEnd()]->RestoreEdgeIn(edge, solver);
-    nodes_[edges_[edge]->getStart()]->RestoreEdgeOut(edge, solver);
+    nodes_[compiled_->EdgeEnd(edge)]->RestoreEdgeIn(edge, solver);
+    nodes_[compiled_->EdgeStart(edge)]->RestoreEdgeOut(edge, solver);
   }
   void restoreEdgeUp(int edge, Solver* solver) {
-    nodes_[edges_[edge]->getEnd()]->RestoreEdgeIn(edge, solver);
+    nodes_[compiled_->EdgeEnd(edge)]->RestoreEdgeIn(edge, solver);
   }
 
   void restoreEdgeDown(int edge, Solver* solver) {
-    nodes_[edges_[edge]->getStart()]->RestoreEdgeOut(edge, solver);
-  }
-
-  void setInTheList(int index, int state) {
-    edges_[index]->setInTheList(state);
+    nodes_[compiled_->EdgeStart(edge)]->RestoreEdgeOut(edge, solver);
   }
-  int getInTheList(int index) { return edges_[index]->getInTheList(); }
 
   int getVarForEdge(int edge) {
-    return nodes_[edges_[edge]->getStart()]->getVariable();
+    return nodes_[compiled_->EdgeStart(edge)]->getVariable();
   }
-  int getValueForEdge(int edge) { return edges_[edge]->getValue(); }
+  int getValueForEdge(int edge) { return compiled_->EdgeValue(edge); }
 
-  int getNumberOfEdge() { return edges_.size(); }
+  int getNumberOfEdge() { return compiled_->NumEdges(); }
+
+  int getNumberOfValues(int var) { return compiled_->Values(var).size(); }
+
+  const std::vector<int>& getNumberOfEdgesByValue(int var) {
+    return compiled_->NumEdgesByValue(var);
+  }
 
   int getNumberOfNode() { return nodes_.size(); }
 
@@ -868,19 +910,14 @@ class MyMDD {
     edges_lvl[lvl]->SetValue(solver, newValue);
   }
 
-  std::vector<VectorMap<int64> > vm_;
-  std::vector<std::vector<int> > number_of_edges_by_value;
-
  private:
-  std::vector<Edge*> edges_;
+  const std::shared_ptr<const CompiledMdd> compiled_;
   std::vector<Node*> nodes_;
 
   int* shared_in_;
   int* shared_out_;
   int* shared_nodes;
 
-  int number_of_edge;
-
   std::vector<Sparse_Set_Rev*> nodes_lvl;
   std::vector<int> sizeBeforeReset;
 
@@ -891,7 +928,8 @@ class MddTableVar {
  public:
   MddTableVar(Solver* const solver, IntVar* var, int index,
               int number_of_different_value, int* shared_positions_edges,
-              int number_of_edges, std::vector<int>& number_of_edges_by_value,
+              int number_of_edges,
+              const std::vector<int>& number_of_edges_by_value,
               MyMDD& mdd)
       : solver_(solver),
         index_(index),
@@ -1087,7 +1125,7 @@ class Ac4MddTableConstraint : public Constraint {
         delta_of_value_indices_(0),
         num_variables_(tuples.Arity()),
         solver_(solver),
-        mdd_(tuples, solver_),
+        mdd_(CompiledMdd::Get(tuples), solver_),
         up(new std::vector<int>()),
         down(new std::vector<int>()),
         edges(new std::vector<int>()),
@@ -1097,9 +1135,10 @@ class Ac4MddTableConstraint : public Constraint {
     shared_positions_edges_ = new int[mdd_.getNumberOfEdge()];
     for (int var_index = 0; var_index < tuples.Arity(); var_index++) {
       vars_[var_index] = new MddTableVar(
-          solver, vars[var_index], var_index, mdd_.vm_[var_index].size(),
-          shared_positions_edges_, mdd_.getNumberOfEdge(),
-          mdd_.number_of_edges_by_value[var_index], mdd_);
+          solver, vars[var_index], var_index,
+          mdd_.getNumberOfValues(var_index), shared_positions_edges_,
+          mdd_.getNumberOfEdge(), mdd_.getNumberOfEdgesByValue(var_index),
+          mdd_);
 
     }
 
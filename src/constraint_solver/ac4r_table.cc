@@ -37,19 +37,22 @@ class IndexedTable {
    public:
     Column() : num_tuples_(0) {}
 
+    // The column index of the tuple set is shared by all the constraints
+    // built from copies of the same set, so it is only computed once.
     void Init(const IntTupleSet& table, int var_index) {
+      const IntTupleSet::ColumnIndex& column_index =
+          table.GetColumnIndex(var_index);
       num_tuples_ = table.NumTuples();
       column_of_value_indices_.resize(num_tuples_);
-      num_tuples_per_value_.resize(table.NumDifferentValuesInColumn(var_index),
-                                   0);
-      for (int tuple_index = 0; tuple_index < num_tuples_; tuple_index++) {
-        const int64 val = table.Value(tuple_index, var_index);
-        if (!value_map_.Contains(val)) {
-          value_map_.Add(val);
+      num_tuples_per_value_.resize(column_index.NumValues(), 0);
+      for (int index = 0; index < column_index.NumValues(); index++) {
+        value_map_.Add(column_index.values[index]);
+        const int start = column_index.starts[index];
+        const int end = column_index.starts[index + 1];
+        num_tuples_per_value_[index] = end - start;
+        for (int i = start; i < end; i++) {
+          column_of_value_indices_[column_index.tuple_indices[i]] = index;
         }
-        const int index = value_map_.Index(val);
-        column_of_value_indices_[tuple_index] = index;
-        num_tuples_per_value_[index]++;
       }
     }
 
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include "base/unique_ptr.h"
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/integral_types.h"
@@ -178,10 +179,8 @@ class RangeBipartiteMatching {
   // This method sorts the min_sorted_ and max_sorted_ arrays and fill
   // the bounds_ array (and set the active_size_ counter).
   void SortArray() {
-    std::sort(min_sorted_.get(), min_sorted_.get() + size_,
-              CompareIntervalMin());
-    std::sort(max_sorted_.get(), max_sorted_.get() + size_,
-              CompareIntervalMax());
+    IncrementalSort(min_sorted_.get(), CompareIntervalMin());
+    IncrementalSort(max_sorted_.get(), CompareIntervalMax());
 
     int64 min = min_sorted_[0]->min;
     int64 max = max_sorted_[0]->max + 1;
@@ -293,8 +292,29 @@ class RangeBipartiteMatching {
     return modified;
   }
 
-  // TODO(user) : use better sort, use bounding boxes of modifications to
-  //                 improve the sorting (only modified vars).
+  // The sorted arrays are kept between two propagations, and the bounds of
+  // only a few intervals change in between. They are thus sorted by
+  // insertion, which is linear on nearly sorted arrays. This falls back to
+  // std::sort when too many intervals move, e.g. on the first propagation.
+  template <class Compare>
+  void IncrementalSort(Interval** const array, Compare compare) {
+    const int64 max_moves = 4LL * size_;
+    int64 moves = 0;
+    for (int i = 1; i < size_; ++i) {
+      Interval* const current = array[i];
+      int j = i;
+      while (j > 0 && compare(current, array[j - 1])) {
+        array[j] = array[j - 1];
+        --j;
+      }
+      array[j] = current;
+      moves += i - j;
+      if (moves > max_moves) {
+        std::sort(array, array + size_, compare);
+        return;
+      }
+    }
+  }
 
   // This method is used by the STL sort.
   struct CompareIntervalMin {
@@ -425,6 +445,259 @@ class BoundsAllDifferent : public BaseAllDifferent {
   RangeBipartiteMatching matching_;
 };
 
+// ---------- Domain All Different ----------
+
+// Enforces domain consistency, following J-C. Regin, "A filtering algorithm
+// for constraints of difference in CSPs", AAAI 1994. A value can be removed
+// from a variable iff the corresponding edge of the variable-value graph
+// belongs to no maximum matching. Given one maximum matching, these edges
+// are the unmatched edges that link two different strongly connected
+// components of the residual graph, where the matched edges go from the
+// variables to the values, the other edges go from the values to the
+// variables, and a dummy node links the matched values to the free ones.
+//
+// The matching is not reversible: after a backtrack, the domains are larger
+// and the matching is still valid. It is repaired with augmenting paths
+// when some of its values are removed.
+class DomainAllDifferent : public BaseAllDifferent {
+ public:
+  DomainAllDifferent(Solver* const s, const std::vector<IntVar*>& vars,
+                     int64 min_value, int64 max_value)
+      : BaseAllDifferent(s, vars),
+        min_value_(min_value),
+        num_values_(max_value - min_value + 1),
+        iterators_(vars.size(), nullptr),
+        var_to_value_(vars.size(), -1),
+        value_to_var_(num_values_, -1),
+        value_stamps_(num_values_, 0),
+        value_parents_(num_values_, -1),
+        stamp_(0) {}
+
+  virtual ~DomainAllDifferent() {}
+
+  virtual void Post() {
+    Demon* const demon = MakeDelayedConstraintDemon0(
+        solver(), this, &DomainAllDifferent::Propagate, "Propagate");
+    for (int i = 0; i < size(); ++i) {
+      iterators_[i] = vars_[i]->MakeDomainIterator(true);
+      vars_[i]->WhenDomain(demon);
+    }
+  }
+
+  virtual void InitialPropagate() { Propagate(); }
+
+  void Propagate() {
+    CollectDomains();
+    for (int var = 0; var < size(); ++var) {
+      if (var_to_value_[var] == -1 && !Augment(var)) {
+        solver()->Fail();
+      }
+    }
+    BuildResidualGraph();
+    ComputeComponents();
+    const int num_vars = size();
+    for (int var = 0; var < num_vars; ++var) {
+      to_remove_.clear();
+      for (int i = var_starts_[var]; i < var_starts_[var + 1]; ++i) {
+        const int value = var_values_[i];
+        if (value != var_to_value_[var] &&
+            components_[var] != components_[num_vars + value]) {
+          to_remove_.push_back(min_value_ + value);
+        }
+      }
+      if (!to_remove_.empty()) {
+        vars_[var]->RemoveValues(to_remove_);
+      }
+    }
+  }
+
+  virtual std::string DebugString() const {
+    return DebugStringInternal("DomainAllDifferent");
+  }
+
+  virtual void Accept(ModelVisitor* const visitor) const {
+    visitor->BeginVisitConstraint(ModelVisitor::kAllDifferent, this);
+    visitor->VisitIntegerVariableArrayArgument(ModelVisitor::kVarsArgument,
+                                               vars_);
+    visitor->VisitIntegerArgument(ModelVisitor::kRangeArgument, 2);
+    visitor->EndVisitConstraint(ModelVisitor::kAllDifferent, this);
+  }
+
+ private:
+  // Fills var_starts_ and var_values_ with the current domains, and removes
+  // from the matching the values that are no longer in them.
+  void CollectDomains() {
+    var_starts_.resize(size() + 1);
+    var_values_.clear();
+    for (int var = 0; var < size(); ++var) {
+      var_starts_[var] = var_values_.size();
+      for (const int64 value : InitAndGetValues(iterators_[var])) {
+        var_values_.push_back(value - min_value_);
+      }
+      const int matched = var_to_value_[var];
+      if (matched != -1 && !vars_[var]->Contains(min_value_ + matched)) {
+        var_to_value_[var] = -1;
+        value_to_var_[matched] = -1;
+      }
+    }
+    var_starts_[size()] = var_values_.size();
+  }
+
+  // Looks for an augmenting path from the free variable 'start' with a
+  // breadth first search, and applies it. Returns false if there is none,
+  // i.e. if there is no matching that covers all the variables.
+  bool Augment(int start) {
+    ++stamp_;
+    queue_.clear();
+    queue_.push_back(start);
+    for (int head = 0; head < queue_.size(); ++head) {
+      const int var = queue_[head];
+      for (int i = var_starts_[var]; i < var_starts_[var + 1]; ++i) {
+        const int value = var_values_[i];
+        if (value_stamps_[value] == stamp_) continue;
+        value_stamps_[value] = stamp_;
+        value_parents_[value] = var;
+        if (value_to_var_[value] == -1) {
+          // Flips the matched and unmatched edges along the path.
+          for (int path_value = value; path_value != -1;) {
+            const int path_var = value_parents_[path_value];
+            const int previous_value = var_to_value_[path_var];
+            var_to_value_[path_var] = path_value;
+            value_to_var_[path_value] = path_var;
+            path_value = previous_value;
+          }
+          return true;
+        }
+        queue_.push_back(value_to_var_[value]);
+      }
+    }
+    return false;
+  }
+
+  // Builds the residual graph in successor_starts_ and successors_. Node i
+  // is variable i for i < size(), node size() + v is the value
+  // min_value_ + v, and the last node is the dummy node.
+  void BuildResidualGraph() {
+    const int num_vars = size();
+    const int dummy = num_vars + num_values_;
+    // Counts the successors of each node.
+    successor_starts_.assign(dummy + 2, 0);
+    for (int var = 0; var < num_vars; ++var) {
+      successor_starts_[var + 1] = 1;
+      for (int i = var_starts_[var]; i < var_starts_[var + 1]; ++i) {
+        const int value = var_values_[i];
+        if (value != var_to_value_[var]) {
+          successor_starts_[num_vars + value + 1]++;
+        }
+      }
+    }
+    for (int value = 0; value < num_values_; ++value) {
+      if (value_to_var_[value] != -1) {
+        successor_starts_[num_vars + value + 1]++;
+      } else {
+        successor_starts_[dummy + 1]++;
+      }
+    }
+    for (int node = 0; node <= dummy; ++node) {
+      successor_starts_[node + 1] += successor_starts_[node];
+    }
+    // Fills the successors, using insert_positions_ as a cursor per node.
+    successors_.resize(successor_starts_[dummy + 1]);
+    insert_positions_.assign(successor_starts_.begin(),
+                             successor_starts_.end() - 1);
+    for (int var = 0; var < num_vars; ++var) {
+      successors_[insert_positions_[var]++] = num_vars + var_to_value_[var];
+      for (int i = var_starts_[var]; i < var_starts_[var + 1]; ++i) {
+        const int value = var_values_[i];
+        if (value != var_to_value_[var]) {
+          successors_[insert_positions_[num_vars + value]++] = var;
+        }
+      }
+    }
+    for (int value = 0; value < num_values_; ++value) {
+      if (value_to_var_[value] != -1) {
+        successors_[insert_positions_[num_vars + value]++] = dummy;
+      } else {
+        successors_[insert_positions_[dummy]++] = num_vars + value;
+      }
+    }
+  }
+
+  // Computes the strongly connected components of the residual graph in
+  // components_, with an iterative version of Tarjan's algorithm.
+  void ComputeComponents() {
+    const int num_nodes = successor_starts_.size() - 1;
+    indices_.assign(num_nodes, -1);
+    low_links_.resize(num_nodes);
+    components_.assign(num_nodes, -1);
+    int next_index = 0;
+    int num_components = 0;
+    for (int root = 0; root < num_nodes; ++root) {
+      if (indices_[root] != -1) continue;
+      indices_[root] = low_links_[root] = next_index++;
+      tarjan_stack_.push_back(root);
+      dfs_stack_.push_back(std::make_pair(root, successor_starts_[root]));
+      while (!dfs_stack_.empty()) {
+        const int node = dfs_stack_.back().first;
+        const int edge = dfs_stack_.back().second;
+        if (edge < successor_starts_[node + 1]) {
+          dfs_stack_.back().second++;
+          const int next = successors_[edge];
+          if (indices_[next] == -1) {
+            indices_[next] = low_links_[next] = next_index++;
+            tarjan_stack_.push_back(next);
+            dfs_stack_.push_back(std::make_pair(next, successor_starts_[next]));
+          } else if (components_[next] == -1) {
+            // 'next' is on the Tarjan stack.
+            low_links_[node] = std::min(low_links_[node], indices_[next]);
+          }
+        } else {
+          dfs_stack_.pop_back();
+          if (low_links_[node] == indices_[node]) {
+            int member = -1;
+            do {
+              member = tarjan_stack_.back();
+              tarjan_stack_.pop_back();
+              components_[member] = num_components;
+            } while (member != node);
+            ++num_components;
+          }
+          if (!dfs_stack_.empty()) {
+            const int parent = dfs_stack_.back().first;
+            low_links_[parent] = std::min(low_links_[parent], low_links_[node]);
+          }
+        }
+      }
+    }
+  }
+
+  const int64 min_value_;
+  const int num_values_;
+  std::vector<IntVarIterator*> iterators_;
+  // The maximum matching, indexed by variable and by value - min_value_.
+  std::vector<int> var_to_value_;
+  std::vector<int> value_to_var_;
+  // The current domains: the values of variable i, minus min_value_, are in
+  // var_values_[var_starts_[i]..var_starts_[i + 1] - 1].
+  std::vector<int> var_starts_;
+  std::vector<int> var_values_;
+  // Breadth first search of Augment().
+  std::vector<int64> value_stamps_;
+  std::vector<int> value_parents_;
+  std::vector<int> queue_;
+  int64 stamp_;
+  // Residual graph and its strongly connected components.
+  std::vector<int> successor_starts_;
+  std::vector<int> successors_;
+  std::vector<int> insert_positions_;
+  std::vector<int> indices_;
+  std::vector<int> low_links_;
+  std::vector<int> components_;
+  std::vector<int> tarjan_stack_;
+  std::vector<std::pair<int, int> > dfs_stack_;
+  std::vector<int64> to_remove_;
+};
+
 class SortConstraint : public Constraint {
  public:
   SortConstraint(Solver* const solver, const std::vector<IntVar*>& original_vars,
@@ -683,6 +956,10 @@ class NullIntersectArrayExcept : public Constraint {
   const int64 escape_value_;
   const bool has_escape_value_;
 };
+
+// The DomainAllDifferent constraint is used when the union of the domains
+// has less values than this, or than four times the sum of the domain sizes.
+const uint64 kDomainAllDifferentMinRange = 1024;
 }  // namespace
 
 Constraint* Solver::MakeAllDifferent(const std::vector<IntVar*>& vars) {
@@ -709,6 +986,31 @@ Constraint* Solver::MakeAllDifferent(const std::vector<IntVar*>& vars,
   }
 }
 
+Constraint* Solver::MakeDomainAllDifferent(const std::vector<IntVar*>& vars) {
+  const int size = vars.size();
+  if (size < 3) {
+    return MakeAllDifferent(vars);
+  }
+  int64 min_value = kint64max;
+  int64 max_value = kint64min;
+  uint64 total_domain_size = 0;
+  for (IntVar* const var : vars) {
+    CHECK_EQ(this, var->solver());
+    min_value = std::min(min_value, var->Min());
+    max_value = std::max(max_value, var->Max());
+    total_domain_size += var->Size();
+  }
+  // The constraint uses a few arrays indexed by the values of the union of
+  // the domains.
+  const uint64 range =
+      static_cast<uint64>(max_value) - static_cast<uint64>(min_value);
+  if (range >=
+      std::max<uint64>(kDomainAllDifferentMinRange, 4 * total_domain_size)) {
+    return MakeAllDifferent(vars);
+  }
+  return RevAlloc(new DomainAllDifferent(this, vars, min_value, max_value));
+}
+
 Constraint* Solver::MakeSortingConstraint(const std::vector<IntVar*>& vars,
                                           const std::vector<IntVar*>& sorted) {
   CHECK_EQ(vars.size(), sorted.size());
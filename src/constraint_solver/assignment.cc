@@ -632,6 +632,57 @@ void Assignment::Save(AssignmentProto* const assignment_proto) const {
   }
 }
 
+bool Assignment::WriteValues(RecordWriter* const writer) const {
+  CHECK(writer != nullptr);
+  AssignmentValuesProto values;
+  bool all_bound = true;
+  for (const IntVarElement& element : int_var_container_.elements()) {
+    values.add_int_var_min(element.Min());
+    all_bound = all_bound && element.Bound();
+  }
+  if (!all_bound) {
+    for (const IntVarElement& element : int_var_container_.elements()) {
+      values.add_int_var_max(element.Max());
+    }
+  }
+  if (HasObjective()) {
+    values.set_objective_min(ObjectiveMin());
+    if (ObjectiveMin() != ObjectiveMax()) {
+      values.set_objective_max(ObjectiveMax());
+    }
+  }
+  return writer->WriteProtocolMessage(values);
+}
+
+bool Assignment::ReadValues(RecordReader* const reader) {
+  CHECK(reader != nullptr);
+  AssignmentValuesProto values;
+  if (!reader->ReadProtocolMessage(&values)) {
+    return false;
+  }
+  const int size = int_var_container_.Size();
+  if (values.int_var_min_size() != size ||
+      (values.int_var_max_size() != 0 && values.int_var_max_size() != size)) {
+    LOG(INFO) << "Record of " << values.int_var_min_size()
+              << " variables does not match assignment of " << size
+              << " variables";
+    return false;
+  }
+  const bool all_bound = values.int_var_max_size() == 0;
+  for (int i = 0; i < size; ++i) {
+    const int64 min = values.int_var_min(i);
+    int_var_container_.MutableElement(i)
+        ->SetRange(min, all_bound ? min : values.int_var_max(i));
+  }
+  if (HasObjective() && values.has_objective_min()) {
+    const int64 obj_min = values.objective_min();
+    SetObjectiveRange(obj_min, values.has_objective_max()
+                                   ? values.objective_max()
+                                   : obj_min);
+  }
+  return true;
+}
+
 template <class Container, class Element>
 void RealDebugString(const Container& container, std::string* const out) {
   for (const Element& element : container.elements()) {
@@ -1066,6 +1117,32 @@ class StoreAssignment : public DecisionBuilder {
  private:
   Assignment* const assignment_;
 };
+
+class SolutionRecorder : public SearchMonitor {
+ public:
+  SolutionRecorder(Solver* const solver, Assignment* const assignment,
+                   RecordWriter* const writer)
+      : SearchMonitor(solver), assignment_(assignment), writer_(writer) {
+    CHECK(assignment != nullptr);
+    CHECK(writer != nullptr);
+  }
+
+  virtual ~SolutionRecorder() {}
+
+  virtual bool AtSolution() {
+    assignment_->Store();
+    if (!assignment_->WriteValues(writer_)) {
+      LOG(WARNING) << "Failed to record solution";
+    }
+    return false;
+  }
+
+  virtual std::string DebugString() const { return "SolutionRecorder"; }
+
+ private:
+  Assignment* const assignment_;
+  RecordWriter* const writer_;
+};
 }  // namespace
 
 DecisionBuilder* Solver::MakeRestoreAssignment(Assignment* assignment) {
@@ -1076,6 +1153,11 @@ DecisionBuilder* Solver::MakeStoreAssignment(Assignment* assignment) {
   return RevAlloc(new StoreAssignment(assignment));
 }
 
+SearchMonitor* Solver::MakeSolutionRecorder(Assignment* const assignment,
+                                            RecordWriter* const writer) {
+  return RevAlloc(new SolutionRecorder(this, assignment, writer));
+}
+
 std::ostream& operator<<(std::ostream& out, const Assignment& assignment) {
   return out << assignment.DebugString();
 }
@@ -17,6 +17,7 @@
 
 #include "constraint_solver/constraint_solver.h"
 
+#include <algorithm>
 #include <csetjmp>
 #include <string>
 #include <iosfwd>
@@ -36,6 +37,7 @@
 #include "base/stl_util.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "constraint_solver/model.pb.h"
+#include "util/metrics.h"
 #include "util/tuple_set.h"
 
 DEFINE_bool(cp_trace_propagation, false,
@@ -72,6 +74,7 @@ SolverParameters::SolverParameters()
       array_split_size(kDefaultArraySplitSize),
       store_names(kDefaultNameStoring),
       profile_level(kDefaultProfileLevel),
+      profile_sampling_period(kDefaultProfileSamplingPeriod),
       trace_level(kDefaultTraceLevel),
       name_all_variables(kDefaultNameAllVariables) {}
 
@@ -128,76 +131,57 @@ std::string Action::DebugString() const { return "Action"; }
 // ------------------ Queue class ------------------
 
 namespace {
+// A FIFO queue of demons stored in a ring buffer. The buffer only grows, so
+// after the first propagations there is no allocation when enqueuing, and
+// the demons to run are contiguous in memory instead of being spread over
+// the cells of a linked list.
 class FifoPriorityQueue {
  public:
-  struct Cell {
-    explicit Cell(Demon* const d) : demon(d), next(nullptr) {}
-    Demon* demon;
-    Cell* next;
-  };
-
-  FifoPriorityQueue() : first_(nullptr), last_(nullptr), free_cells_(nullptr) {}
-
-  ~FifoPriorityQueue() {
-    while (first_ != nullptr) {
-      Cell* const tmp = first_;
-      first_ = tmp->next;
-      delete tmp;
-    }
-    while (free_cells_ != nullptr) {
-      Cell* const tmp = free_cells_;
-      free_cells_ = tmp->next;
-      delete tmp;
-    }
-  }
+  FifoPriorityQueue()
+      : buffer_(kInitialCapacity, nullptr), head_(0), size_(0) {}
 
   Demon* Next() {
-    if (first_ != nullptr) {
-      DCHECK(last_ != nullptr);
-      Cell* const tmp_cell = first_;
-      Demon* const demon = tmp_cell->demon;
-      first_ = tmp_cell->next;
-      if (first_ == nullptr) {
-        last_ = nullptr;
-      }
-      tmp_cell->next = free_cells_;
-      free_cells_ = tmp_cell;
-      return demon;
+    if (size_ == 0) {
+      return nullptr;
     }
-    return nullptr;
+    Demon* const demon = buffer_[head_];
+    head_ = (head_ + 1) & (buffer_.size() - 1);
+    --size_;
+    return demon;
   }
 
   void Enqueue(Demon* const d) {
-    Cell* cell = free_cells_;
-    if (cell != nullptr) {
-      cell->demon = d;
-      free_cells_ = cell->next;
-      cell->next = nullptr;
-    } else {
-      cell = new Cell(d);
-    }
-    if (last_ != nullptr) {
-      last_->next = cell;
-      last_ = cell;
-    } else {
-      first_ = cell;
-      last_ = cell;
+    if (size_ == static_cast<int>(buffer_.size())) {
+      Grow();
     }
+    buffer_[(head_ + size_) & (buffer_.size() - 1)] = d;
+    ++size_;
   }
 
   void AfterFailure() {
-    if (first_ != nullptr) {
-      last_->next = free_cells_;
-      free_cells_ = first_;
-      first_ = nullptr;
-      last_ = nullptr;
-    }
+    head_ = 0;
+    size_ = 0;
   }
 
  private:
-  Cell* first_;
-  Cell* last_;
-  Cell* free_cells_;
+  // Must be a power of two, the buffer size is then always a power of two and
+  // the indices can be wrapped with a mask.
+  static const int kInitialCapacity = 16;
+
+  // Doubles the size of the buffer, and moves the queued demons at its start.
+  void Grow() {
+    const int mask = buffer_.size() - 1;
+    std::vector<Demon*> new_buffer(2 * buffer_.size(), nullptr);
+    for (int i = 0; i < size_; ++i) {
+      new_buffer[i] = buffer_[(head_ + i) & mask];
+    }
+    buffer_.swap(new_buffer);
+    head_ = 0;
+  }
+
+  std::vector<Demon*> buffer_;
+  int head_;
+  int size_;
 };
 }  // namespace
 
@@ -448,6 +432,8 @@ struct StateMarker {
   int rev_object_array_memory_index_;
   int rev_memory_index_;
   int rev_memory_array_index_;
+  int rev_arena_block_index_;
+  int64 rev_arena_offset_;
   StateInfo info_;
 };
 
@@ -465,6 +451,10 @@ StateMarker::StateMarker(Solver::MarkerType t, const StateInfo& info)
       rev_double_memory_index_(0),
       rev_object_memory_index_(0),
       rev_object_array_memory_index_(0),
+      rev_memory_index_(0),
+      rev_memory_array_index_(0),
+      rev_arena_block_index_(0),
+      rev_arena_offset_(0),
       info_(info) {}
 
 // ---------- Trail and Reversibility ----------
@@ -479,7 +469,10 @@ struct addrval {
  public:
   addrval() : address_(nullptr) {}
   explicit addrval(T* adr) : address_(adr), old_value_(*adr) {}
+  addrval(T* adr, T old_value) : address_(adr), old_value_(old_value) {}
   void restore() const { (*address_) = old_value_; }
+  T* address() const { return address_; }
+  T old_value() const { return old_value_; }
 
  private:
   T* address_;
@@ -567,6 +560,120 @@ class ZlibTrailPacker : public TrailPacker<T> {
   DISALLOW_COPY_AND_ASSIGN(ZlibTrailPacker<T>);
 };
 
+// Encodes each entry of a block as the differences of its address and of its
+// value with the ones of the previous entry, as zigzag varints. Consecutive
+// trail entries usually point to nearby addresses (the same objects are
+// modified repeatedly), so this typically divides the memory used by the
+// trail by 2 to 4, at a fraction of the cost of zlib.
+template <class T>
+class DeltaVarintTrailPacker : public TrailPacker<T> {
+ public:
+  explicit DeltaVarintTrailPacker(int block_size)
+      : TrailPacker<T>(block_size),
+        block_size_(block_size),
+        tmp_block_(new char[block_size * 2 * kMaxVarintBytes]) {}
+
+  virtual ~DeltaVarintTrailPacker() {}
+
+  virtual void Pack(const addrval<T>* block, std::string* packed_block) {
+    DCHECK(block != nullptr);
+    DCHECK(packed_block != nullptr);
+    char* out = tmp_block_.get();
+    uint64 previous_address = 0;
+    uint64 previous_value = 0;
+    for (int i = 0; i < block_size_; ++i) {
+      const uint64 address = reinterpret_cast<uintptr_t>(block[i].address());
+      const uint64 value = ToBits(block[i].old_value());
+      out = EncodeVarint(ZigZag(address - previous_address), out);
+      out = EncodeVarint(ZigZag(value - previous_value), out);
+      previous_address = address;
+      previous_value = value;
+    }
+    packed_block->assign(tmp_block_.get(), out - tmp_block_.get());
+  }
+
+  virtual void Unpack(const std::string& packed_block, addrval<T>* block) {
+    DCHECK(block != nullptr);
+    const char* in = packed_block.data();
+    uint64 address = 0;
+    uint64 value = 0;
+    for (int i = 0; i < block_size_; ++i) {
+      uint64 delta = 0;
+      in = DecodeVarint(in, &delta);
+      address += UnZigZag(delta);
+      in = DecodeVarint(in, &delta);
+      value += UnZigZag(delta);
+      block[i] = addrval<T>(reinterpret_cast<T*>(address), FromBits(value));
+    }
+    DCHECK_EQ(packed_block.data() + packed_block.size(), in);
+  }
+
+ private:
+  static const int kMaxVarintBytes = 10;
+
+  // Sign-extends integral values so that small negative values and their
+  // differences stay small.
+  static uint64 ToBits(int value) { return static_cast<int64>(value); }
+  static uint64 ToBits(int64 value) { return value; }
+  static uint64 ToBits(uint64 value) { return value; }
+  static uint64 ToBits(void* value) {
+    return reinterpret_cast<uintptr_t>(value);
+  }
+  static uint64 ToBits(double value) {
+    uint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  static T FromBits(uint64 bits) {
+    return FromBits(bits, static_cast<T*>(nullptr));
+  }
+  static int FromBits(uint64 bits, int*) { return static_cast<int>(bits); }
+  static int64 FromBits(uint64 bits, int64*) { return bits; }
+  static uint64 FromBits(uint64 bits, uint64*) { return bits; }
+  static void* FromBits(uint64 bits, void**) {
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(bits));
+  }
+  static double FromBits(uint64 bits, double*) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  static uint64 ZigZag(uint64 delta) {
+    return (delta << 1) ^ static_cast<uint64>(static_cast<int64>(delta) >> 63);
+  }
+  static uint64 UnZigZag(uint64 zigzag) {
+    return (zigzag >> 1) ^ -(zigzag & 1);
+  }
+
+  static char* EncodeVarint(uint64 value, char* out) {
+    while (value >= 0x80) {
+      *out++ = static_cast<char>(value | 0x80);
+      value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+  }
+
+  static const char* DecodeVarint(const char* in, uint64* value) {
+    uint64 result = 0;
+    int shift = 0;
+    uint8 byte;
+    do {
+      byte = static_cast<uint8>(*in++);
+      result |= static_cast<uint64>(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    *value = result;
+    return in;
+  }
+
+  const int block_size_;
+  std::unique_ptr<char[]> tmp_block_;
+  DISALLOW_COPY_AND_ASSIGN(DeltaVarintTrailPacker<T>);
+};
+
 template <class T>
 class CompressedTrail {
  public:
@@ -589,6 +696,10 @@ class CompressedTrail {
         packer_.reset(new ZlibTrailPacker<T>(block_size));
         break;
       }
+      case SolverParameters::COMPRESS_WITH_DELTA_VARINT: {
+        packer_.reset(new DeltaVarintTrailPacker<T>(block_size));
+        break;
+      }
     }
 
     // We zero all memory used by addrval arrays.
@@ -644,6 +755,20 @@ class CompressedTrail {
   }
   int64 size() const { return size_; }
 
+  // Returns the number of bytes used by the trail, i.e. its two uncompressed
+  // blocks and all its compressed blocks, including the free ones.
+  int64 MemoryUsage() const {
+    int64 bytes = 2 * block_size_ * sizeof(addrval<T>);
+    for (const Block* block = blocks_; block != nullptr; block = block->next) {
+      bytes += sizeof(*block) + block->compressed.capacity();
+    }
+    for (const Block* block = free_blocks_; block != nullptr;
+         block = block->next) {
+      bytes += sizeof(*block) + block->compressed.capacity();
+    }
+    return bytes;
+  }
+
  private:
   struct Block {
     std::string compressed;
@@ -686,6 +811,77 @@ class CompressedTrail {
   int current_;
   int size_;
 };
+
+// ----- Reversible arena -----
+
+// A bump allocator for the reversible memory of a solver. The memory allocated
+// after a state marker is released all at once when backtracking to this
+// marker, by just moving back the top of the arena. The blocks are only
+// returned to the heap when the arena is destroyed, so once the search went
+// deep enough, allocating and backtracking never call the heap allocator
+// (which also avoids contention between solvers running in different
+// threads). As no destructor is called, only trivially destructible objects
+// can be allocated in the arena.
+class RevArena {
+ public:
+  RevArena() : current_block_(0), offset_(0), reserved_bytes_(0) {}
+  ~RevArena() {
+    for (const Block& block : blocks_) {
+      delete[] block.data;
+    }
+  }
+
+  void* Allocate(size_t size) {
+    // All the allocations are aligned for any scalar type.
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    while (current_block_ < blocks_.size() &&
+           offset_ + size > blocks_[current_block_].size) {
+      ++current_block_;
+      offset_ = 0;
+    }
+    if (current_block_ == blocks_.size()) {
+      const int64 block_size = std::max<int64>(kBlockSize, size);
+      blocks_.push_back(Block(new char[block_size], block_size));
+      reserved_bytes_ += block_size;
+      offset_ = 0;
+    }
+    void* const ptr = blocks_[current_block_].data + offset_;
+    offset_ += size;
+    return ptr;
+  }
+
+  // The current top of the arena.
+  int block_index() const { return current_block_; }
+  int64 offset() const { return offset_; }
+
+  // Releases all the memory allocated since the top of the arena was at the
+  // given position.
+  void BacktrackTo(int block_index, int64 offset) {
+    DCHECK_LE(block_index, current_block_);
+    current_block_ = block_index;
+    offset_ = offset;
+  }
+
+  // Returns the number of bytes allocated from the heap by the arena.
+  int64 reserved_bytes() const { return reserved_bytes_; }
+
+ private:
+  static const int64 kBlockSize = 64 * 1024;
+  static const size_t kAlignment = 16;
+
+  struct Block {
+    Block(char* d, int64 s) : data(d), size(s) {}
+    char* data;
+    int64 size;
+  };
+
+  std::vector<Block> blocks_;
+  int current_block_;
+  int64 offset_;
+  int64 reserved_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(RevArena);
+};
 }  // namespace
 
 // ----- Trail -----
@@ -712,6 +908,7 @@ struct Trail {
   std::vector<BaseObject**> rev_object_array_memory_;
   std::vector<void*> rev_memory_;
   std::vector<void**> rev_memory_array_;
+  RevArena rev_arena_;
 
   Trail(int block_size, SolverParameters::TrailCompression compression_level)
       : rev_ints_(block_size, compression_level),
@@ -824,6 +1021,34 @@ struct Trail {
       // delete [] version of the previous unsafe case.
     }
     rev_memory_array_.resize(target);
+
+    rev_arena_.BacktrackTo(m->rev_arena_block_index_, m->rev_arena_offset_);
+  }
+
+  // Returns the number of bytes used by the trails of saved values.
+  int64 SavedValuesMemoryUsage() const {
+    return rev_ints_.MemoryUsage() + rev_int64s_.MemoryUsage() +
+           rev_uint64s_.MemoryUsage() + rev_doubles_.MemoryUsage() +
+           rev_ptrs_.MemoryUsage() +
+           rev_boolvar_list_.capacity() * sizeof(rev_boolvar_list_[0]) +
+           rev_bools_.capacity() * sizeof(rev_bools_[0]) +
+           rev_bool_value_.capacity() / 8;
+  }
+
+  // Returns the number of objects and arrays owned by the trail, and the
+  // number of bytes used to keep track of them.
+  int64 NumRevAllocated() const {
+    return rev_int_memory_.size() + rev_int64_memory_.size() +
+           rev_double_memory_.size() + rev_object_memory_.size() +
+           rev_object_array_memory_.size() + rev_memory_.size() +
+           rev_memory_array_.size();
+  }
+  int64 RevAllocatedMemoryUsage() const {
+    return sizeof(void*) *
+           (rev_int_memory_.capacity() + rev_int64_memory_.capacity() +
+            rev_double_memory_.capacity() + rev_object_memory_.capacity() +
+            rev_object_array_memory_.capacity() + rev_memory_.capacity() +
+            rev_memory_array_.capacity());
   }
 };
 
@@ -918,6 +1143,11 @@ void** Solver::UnsafeRevAllocArrayAux(void** ptr) {
   return ptr;
 }
 
+void* Solver::UnsafeRevAllocFromArena(size_t size) {
+  check_alloc_state();
+  return trail_->rev_arena_.Allocate(size);
+}
+
 void InternalSaveBooleanVarValue(Solver* const solver, IntVar* const var) {
   solver->trail_->rev_boolvar_list_.push_back(var);
 }
@@ -939,7 +1169,11 @@ class Search {
         should_finish_(false),
         sentinel_pushed_(0),
         jmpbuf_filled_(false),
-        backtrack_at_the_end_of_the_search_(true) {}
+        backtrack_at_the_end_of_the_search_(true),
+        branches_at_start_(0),
+        failures_at_start_(0),
+        neighbors_at_start_(0),
+        wall_time_at_start_(0) {}
 
   // Constructor for a dummy search. The only difference between a dummy search
   // and a regular one is that the search depth and left search depth is
@@ -957,7 +1191,11 @@ class Search {
         should_finish_(false),
         sentinel_pushed_(0),
         jmpbuf_filled_(false),
-        backtrack_at_the_end_of_the_search_(true) {}
+        backtrack_at_the_end_of_the_search_(true),
+        branches_at_start_(0),
+        failures_at_start_(0),
+        neighbors_at_start_(0),
+        wall_time_at_start_(0) {}
 
   ~Search() { STLDeleteElements(&marker_stack_); }
 
@@ -1045,6 +1283,12 @@ class Search {
   int sentinel_pushed_;
   bool jmpbuf_filled_;
   bool backtrack_at_the_end_of_the_search_;
+  // Solver counters when the top level search was started, used to publish
+  // per-search metrics.
+  int64 branches_at_start_;
+  int64 failures_at_start_;
+  int64 neighbors_at_start_;
+  int64 wall_time_at_start_;
 };
 
 // Backtrack is implemented using 3 primitives:
@@ -1417,6 +1661,15 @@ void Solver::Init() {
   queue_.reset(new Queue(this));
   trail_.reset(
       new Trail(parameters_.trail_block_size, parameters_.compress_trail));
+  variable_cleaner_.reset(NewDomainIntVarCleaner());
+  timer_.reset(new ClockTimer);
+  balancing_decision_.reset(new BalancingDecision);
+  fail_decision_.reset(new FailDecision());
+  InitBuilders();
+  InitModel();
+}
+
+void Solver::InitModel() {
   state_ = OUTSIDE_SEARCH;
   branches_ = 0;
   fails_ = 0;
@@ -1424,20 +1677,17 @@ void Solver::Init() {
   neighbors_ = 0;
   filtered_neighbors_ = 0;
   accepted_neighbors_ = 0;
-  variable_cleaner_.reset(NewDomainIntVarCleaner());
-  timer_.reset(new ClockTimer);
   searches_.assign(1, new Search(this, 0));
   fail_hooks_ = nullptr;
   fail_stamp_ = GG_ULONGLONG(1);
-  balancing_decision_.reset(new BalancingDecision);
   fail_intercept_ = nullptr;
   true_constraint_ = nullptr;
   false_constraint_ = nullptr;
-  fail_decision_.reset(new FailDecision());
   constraint_index_ = 0;
   additional_constraint_index_ = 0;
   num_int_vars_ = 0;
   propagation_monitor_.reset(BuildTrace(this));
+  has_propagation_monitors_ = false;
   print_trace_ = nullptr;
   anonymous_variable_index_ = 0;
   should_fail_ = false;
@@ -1449,13 +1699,38 @@ void Solver::Init() {
   PushSentinel(SOLVER_CTOR_SENTINEL);
   InitCachedIntConstants();  // to be called after the SENTINEL is set.
   InitCachedConstraint();    // Cache the true constraint.
-  InitBuilders();
   timer_->Restart();
   model_cache_.reset(BuildModelCache(this));
   dependency_graph_.reset(BuildDependencyGraph(this));
   AddPropagationMonitor(reinterpret_cast<PropagationMonitor*>(demon_profiler_));
 }
 
+void Solver::Reset() {
+  // Solver::Reset() called with searches open.
+  CHECK_EQ(2, searches_.size());
+  BacktrackToSentinel(INITIAL_SEARCH_SENTINEL);
+
+  // Popping the ctor sentinel frees all the reversible objects of the model.
+  // The trail keeps its blocks for the next model.
+  StateInfo info;
+  Solver::MarkerType final_type = PopState(&info);
+  DCHECK_EQ(final_type, SENTINEL);
+  DCHECK_EQ(info.int_info, SOLVER_CTOR_SENTINEL);
+  STLDeleteElements(&searches_);
+
+  propagation_object_names_.clear();
+  cast_information_.clear();
+  cast_constraints_.clear();
+  constraints_list_.clear();
+  additional_constraints_list_.clear();
+  additional_constraints_parent_list_.clear();
+  if (demon_profiler_ != nullptr) {
+    reinterpret_cast<PropagationMonitor*>(demon_profiler_)->RestartSearch();
+  }
+  random_.Reset(ACMRandom::DeterministicSeed());
+  InitModel();
+}
+
 Solver::~Solver() {
   // solver destructor called with searches open.
   CHECK_EQ(2, searches_.size());
@@ -1479,6 +1754,7 @@ const int SolverParameters::kDefaultArraySplitSize = 16;
 const bool SolverParameters::kDefaultNameStoring = true;
 const SolverParameters::ProfileLevel SolverParameters::kDefaultProfileLevel =
     SolverParameters::NO_PROFILING;
+const int SolverParameters::kDefaultProfileSamplingPeriod = 64;
 const SolverParameters::TraceLevel SolverParameters::kDefaultTraceLevel =
     SolverParameters::NO_TRACE;
 const bool SolverParameters::kDefaultNameAllVariables = false;
@@ -1521,6 +1797,15 @@ int64 Solver::MemoryUsage() {
   return GetProcessMemoryUsage();
 }
 
+Solver::ReversibleMemoryUsage Solver::GetReversibleMemoryUsage() const {
+  ReversibleMemoryUsage usage;
+  usage.trail_bytes = trail_->SavedValuesMemoryUsage();
+  usage.num_rev_allocated = trail_->NumRevAllocated();
+  usage.rev_alloc_bytes = trail_->RevAllocatedMemoryUsage();
+  usage.arena_bytes = trail_->rev_arena_.reserved_bytes();
+  return usage;
+}
+
 
 int64 Solver::wall_time() const { return timer_->GetInMs(); }
 
@@ -1558,6 +1843,8 @@ void Solver::PushState(Solver::MarkerType t, const StateInfo& info) {
     m->rev_object_array_memory_index_ = trail_->rev_object_array_memory_.size();
     m->rev_memory_index_ = trail_->rev_memory_.size();
     m->rev_memory_array_index_ = trail_->rev_memory_array_.size();
+    m->rev_arena_block_index_ = trail_->rev_arena_.block_index();
+    m->rev_arena_offset_ = trail_->rev_arena_.offset();
   }
   searches_.back()->marker_stack_.push_back(m);
   queue_->increase_stamp();
@@ -1754,9 +2041,13 @@ void Solver::ProcessConstraints() {
   for (constraint_index_ = 0; constraint_index_ < constraints_size;
        ++constraint_index_) {
     Constraint* const constraint = constraints_list_[constraint_index_];
-    propagation_monitor_->BeginConstraintInitialPropagation(constraint);
-    constraint->PostAndPropagate();
-    propagation_monitor_->EndConstraintInitialPropagation(constraint);
+    if (has_propagation_monitors_) {
+      propagation_monitor_->BeginConstraintInitialPropagation(constraint);
+      constraint->PostAndPropagate();
+      propagation_monitor_->EndConstraintInitialPropagation(constraint);
+    } else {
+      constraint->PostAndPropagate();
+    }
   }
   CHECK_EQ(constraints_list_.size(), constraints_size);
 
@@ -1769,10 +2060,15 @@ void Solver::ProcessConstraints() {
     const int parent_index =
         additional_constraints_parent_list_[additional_constraint_index_];
     Constraint* const parent = constraints_list_[parent_index];
-    propagation_monitor_->BeginNestedConstraintInitialPropagation(parent,
+    if (has_propagation_monitors_) {
+      propagation_monitor_->BeginNestedConstraintInitialPropagation(parent,
+                                                                    nested);
+      nested->PostAndPropagate();
+      propagation_monitor_->EndNestedConstraintInitialPropagation(parent,
                                                                   nested);
-    nested->PostAndPropagate();
-    propagation_monitor_->EndNestedConstraintInitialPropagation(parent, nested);
+    } else {
+      nested->PostAndPropagate();
+    }
   }
 }
 
@@ -1902,6 +2198,10 @@ void Solver::NewSearch(DecisionBuilder* const db,
     // TODO(user): Check if these two lines are still necessary.
     BacktrackToSentinel(INITIAL_SEARCH_SENTINEL);
     state_ = OUTSIDE_SEARCH;
+    search->branches_at_start_ = branches_;
+    search->failures_at_start_ = fails_;
+    search->neighbors_at_start_ = neighbors_;
+    search->wall_time_at_start_ = wall_time();
   }
 
   // ----- manages all monitors -----
@@ -2305,6 +2605,18 @@ void Solver::EndSearch() {
       LOG(INFO) << "Exporting profile to " << FLAGS_cp_profile_file;
       ExportProfilingOverview(FLAGS_cp_profile_file);
     }
+    MetricsRegistry* const metrics = MetricsRegistry::Global();
+    if (metrics->enabled()) {
+      const double seconds = (wall_time() - search->wall_time_at_start_) / 1e3;
+      metrics->IncrementCounter("cp", "searches", 1);
+      metrics->AddToHistogram("cp", "search_time_seconds", seconds);
+      metrics->PublishThroughput(
+          "cp", "branches", branches_ - search->branches_at_start_, seconds);
+      metrics->PublishThroughput(
+          "cp", "failures", fails_ - search->failures_at_start_, seconds);
+      metrics->PublishThroughput(
+          "cp", "neighbors", neighbors_ - search->neighbors_at_start_, seconds);
+    }
   } else {  // We clean the nested Search.
     delete search;
     searches_.pop_back();
@@ -3187,6 +3499,9 @@ PropagationMonitor* BuildTrace(Solver* const s) { return new Trace(s); }
 void Solver::AddPropagationMonitor(PropagationMonitor* const monitor) {
   // TODO(user): Check solver state?
   reinterpret_cast<class Trace*>(propagation_monitor_.get())->Add(monitor);
+  if (monitor != nullptr) {
+    has_propagation_monitors_ = true;
+  }
 }
 
 PropagationMonitor* Solver::GetPropagationMonitor() const {
@@ -122,6 +122,7 @@ class DemonProfiler;
 class DependencyGraph;
 class Dimension;
 class DisjunctiveConstraint;
+class EliteSolutionPool;
 class ExpressionCache;
 class IntExpr;
 class IntTupleSet;
@@ -143,6 +144,8 @@ class Pack;
 class PropagationBaseObject;
 class PropagationMonitor;
 class Queue;
+class RecordReader;
+class RecordWriter;
 class RevBitMatrix;
 class RevBitSet;
 class Search;
@@ -167,10 +170,10 @@ class SimpleRevFIFO;
 struct SolverParameters {
  public:
   enum TrailCompression {
-    NO_COMPRESSION, COMPRESS_WITH_ZLIB
+    NO_COMPRESSION, COMPRESS_WITH_ZLIB, COMPRESS_WITH_DELTA_VARINT
   };
 
-  enum ProfileLevel { NO_PROFILING, NORMAL_PROFILING };
+  enum ProfileLevel { NO_PROFILING, NORMAL_PROFILING, SAMPLED_PROFILING };
 
   enum TraceLevel { NO_TRACE, NORMAL_TRACE };
 
@@ -179,6 +182,7 @@ struct SolverParameters {
   static const int kDefaultArraySplitSize;
   static const bool kDefaultNameStoring;
   static const ProfileLevel kDefaultProfileLevel;
+  static const int kDefaultProfileSamplingPeriod;
   static const TraceLevel kDefaultTraceLevel;
   static const bool kDefaultNameAllVariables;
 
@@ -186,7 +190,8 @@ struct SolverParameters {
 
   // This parameter indicates if the solver should compress the trail
   // during the search. No compression means that the solver will be faster,
-  // but will use more memory.
+  // but will use more memory. COMPRESS_WITH_DELTA_VARINT is much faster than
+  // COMPRESS_WITH_ZLIB, and usually compresses almost as well.
   TrailCompression compress_trail;
 
   // This parameter indicates the default size of a block of the trail.
@@ -206,6 +211,12 @@ struct SolverParameters {
   // summary, as well as the csv export.
   ProfileLevel profile_level;
 
+  // With SAMPLED_PROFILING, only one demon run out of
+  // 'profile_sampling_period' is timed, and the number of invocations and
+  // the runtime of each demon are extrapolated from the timed runs. The
+  // failures and the initial propagations are still recorded exactly.
+  int profile_sampling_period;
+
   // Support for full trace of propagation.
   TraceLevel trace_level;
 
@@ -234,17 +245,21 @@ struct DefaultPhaseParameters {
   enum LnsControl { NO_LNS = 0, MINIMIZE = 1, MAXIMIZE = 2 };
 
   static const int kDefaultNumberOfSplits;
+  static const int kDefaultInitializationWorkers;
   static const int kDefaultHeuristicPeriod;
   static const int kDefaultHeuristicNumFailuresLimit;
   static const int kDefaultSeed;
   static const double kDefaultRestartLogSize;
   static const bool kDefaultUseNoGoods;
+  static const int kDefaultMaxNoGoods;
   static const LnsControl kDefaultLnsControl;
 
   DefaultPhaseParameters()
       : var_selection_schema(CHOOSE_MAX_SUM_IMPACT),
         value_selection_schema(SELECT_MIN_IMPACT),
         initialization_splits(kDefaultNumberOfSplits),
+        initialization_workers(kDefaultInitializationWorkers),
+        impact_file(),
         run_all_heuristics(true),
         heuristic_period(kDefaultHeuristicPeriod),
         heuristic_num_failures_limit(kDefaultHeuristicNumFailuresLimit),
@@ -253,6 +268,7 @@ struct DefaultPhaseParameters {
         restart_log_size(kDefaultRestartLogSize),
         display_level(NORMAL),
         use_no_goods(kDefaultUseNoGoods),
+        max_no_goods(kDefaultMaxNoGoods),
         decision_builder(nullptr),
         lns(kDefaultLnsControl) {}
 
@@ -267,6 +283,21 @@ struct DefaultPhaseParameters {
   // per variable.
   int initialization_splits;
 
+  // Number of threads used to initialize the impacts. With more than one
+  // worker, the model is copied into one solver per worker, and each worker
+  // scans the domains of a share of the variables. The impacts are then
+  // slightly different from the sequential ones, as the values removed by
+  // one worker don't reduce the domains scanned by the other ones.
+  int initialization_workers;
+
+  // If not empty, the impacts are read from this file before the
+  // initialization, and only the variables whose impacts are not all found
+  // in the file are scanned. The impacts are written back to this file at
+  // the end of each search. Variables are identified by their index in the
+  // array given to MakeDefaultPhase(), so the file should only be reused
+  // on a similar model.
+  std::string impact_file;
+
   // The default phase will run heuristic periodically. This parameter
   // indicates if we should run all heuristics, or a randomly selected
   // one.
@@ -305,6 +336,10 @@ struct DefaultPhaseParameters {
   // Should we use Nogoods when restarting. The default is false.
   bool use_no_goods;
 
+  // Maximum number of nogoods kept by the nogood manager. When it is
+  // reached, the least active half of the nogoods is deleted.
+  int max_no_goods;
+
   // When defined, this override the default impact based decision builder.
   DecisionBuilder* decision_builder;
 
@@ -312,6 +347,32 @@ struct DefaultPhaseParameters {
   LnsControl lns;
 };
 
+// Index evaluators that can also evaluate many indices in one call.
+// Solver::IndexEvaluator1 and Solver::IndexEvaluator2 callbacks passed to
+// the solver can derive from these classes. The call sites that evaluate a
+// whole domain or a whole array (CheapestVarSelector, CheapestValueSelector,
+// function based elements and path cumul constraints) then make one virtual
+// call per batch instead of one per value, and evaluators backed by dense
+// arrays can implement RunBatch() with a tight, vectorizable loop.
+// RunBatch() must return the same values as Run().
+class BatchIndexEvaluator1 : public ResultCallback1<int64, int64> {
+ public:
+  virtual ~BatchIndexEvaluator1() {}
+  virtual bool IsRepeatable() const { return true; }
+  // Sets values[i] = Run(indices[i]) for i in [0, size).
+  virtual void RunBatch(const int64* const indices, int size,
+                        int64* const values) = 0;
+};
+
+class BatchIndexEvaluator2 : public ResultCallback2<int64, int64, int64> {
+ public:
+  virtual ~BatchIndexEvaluator2() {}
+  virtual bool IsRepeatable() const { return true; }
+  // Sets values[i] = Run(first, seconds[i]) for i in [0, size).
+  virtual void RunBatch(int64 first, const int64* const seconds, int size,
+                        int64* const values) = 0;
+};
+
 /////////////////////////////////////////////////////////////////////
 //
 // Solver Class
@@ -513,6 +574,11 @@ class Solver {
     SEQUENCE_SIMPLE,
     CHOOSE_MIN_SLACK_RANK_FORWARD,
     CHOOSE_RANDOM_RANK_FORWARD,
+    // Like CHOOSE_MIN_SLACK_RANK_FORWARD, but the slack of each sequence is
+    // divided by 1 + log(1 + f), where f is the number of times ranking an
+    // interval first on this sequence has failed during the search so far.
+    // This focuses the search on the resources responsible for failures.
+    CHOOSE_MIN_WEIGHTED_SLACK_RANK_FORWARD,
   };
 
   // This enum describes the straregy used to select the next interval variable
@@ -854,6 +920,16 @@ class Solver {
   Solver(const std::string& modelname, const SolverParameters& parameters);
   ~Solver();
 
+  // Removes the whole model (variables, constraints, decision builders and
+  // monitors) and resets the solver to the state of a newly created one,
+  // with the same name and parameters. Contrary to deleting the solver and
+  // creating a new one, this keeps the allocated trail blocks, the
+  // propagation queue and the registered builders, which makes it cheap to
+  // solve many small independent models with the same solver.
+  // All the objects created by the solver are invalidated. This must be
+  // called outside of any search.
+  void Reset();
+
   // Read-only Parameters.
   const SolverParameters& parameters() const { return parameters_; }
 
@@ -1061,6 +1137,21 @@ class Solver {
   // Loads the model into the solver, appends search monitors to monitors,
   // and returns true upon success.
   bool LoadModel(const CPModelProto& proto, std::vector<SearchMonitor*>* monitors);
+  // Same as above, and also appends to variable_groups the variables of each
+  // variable group of the proto, i.e. the variables exported by the
+  // decision builder given to ExportModel().
+  bool LoadModel(const CPModelProto& proto,
+                 std::vector<SearchMonitor*>* monitors,
+                 std::vector<std::vector<IntVar*> >* variable_groups);
+  // Copies the model of this solver (variables, expressions, intervals,
+  // sequences and constraints) into 'target', which should not contain any
+  // model yet. If 'target_monitors' is not nullptr, the copies of the
+  // objective and of the search limit found in 'monitors' are appended to it.
+  // The model goes through a CPModelProto that is never serialized, and its
+  // builders are looked up once per tag. Returns true upon success.
+  bool CopyModel(const std::vector<SearchMonitor*>& monitors,
+                 Solver* const target,
+                 std::vector<SearchMonitor*>* target_monitors) const;
   // Upgrades the model to the latest version.
   static bool UpgradeModel(CPModelProto* const proto);
 
@@ -1116,6 +1207,25 @@ class Solver {
   // Current memory usage in bytes
   static int64 MemoryUsage();
 
+  // Memory used by the reversibility mechanism of one solver. Contrary to
+  // MemoryUsage(), which is the usage of the whole process, this can be used
+  // to monitor or cap the memory of each solver when many of them run in the
+  // same process.
+  struct ReversibleMemoryUsage {
+    // Bytes used by the trails of the values saved by SaveValue() and the
+    // reversible classes (Rev<T>, RevArray<T>, ...).
+    int64 trail_bytes;
+    // Number of objects and arrays currently owned by the solver through
+    // RevAlloc() and RevAllocArray(), and bytes used to keep track of them.
+    // Note that the size of the objects themselves is not known.
+    int64 num_rev_allocated;
+    int64 rev_alloc_bytes;
+    // Bytes reserved by the arena that holds the internal reversible
+    // containers (e.g. the lists of demons of the variables).
+    int64 arena_bytes;
+  };
+  ReversibleMemoryUsage GetReversibleMemoryUsage() const;
+
 
   // wall_time() in ms since the creation of the solver.
   int64 wall_time() const;
@@ -1573,6 +1683,15 @@ class Solver {
   Constraint* MakeAllDifferent(const std::vector<IntVar*>& vars,
                                bool stronger_propagation);
 
+  // All variables are pairwise different. Contrary to MakeAllDifferent(),
+  // which only reasons on the bounds of the variables, this constraint
+  // removes all the values that cannot be part of a solution (domain
+  // consistency), using a maximum matching between variables and values.
+  // It is stronger but more costly, and is useful when the domains have
+  // holes. It falls back to MakeAllDifferent() if the union of the domains
+  // is too sparse.
+  Constraint* MakeDomainAllDifferent(const std::vector<IntVar*>& vars);
+
   // All variables are pairwise different, unless they are assigned to
   // the escape value.
   Constraint* MakeAllDifferentExcept(const std::vector<IntVar*>& vars,
@@ -2093,6 +2212,16 @@ class Solver {
   // be added later.
   SolutionCollector* MakeAllSolutionCollector();
 
+#if !defined(SWIG)
+  // Stores 'assignment' at each solution of the search and appends its values
+  // to 'writer' (cf. Assignment::WriteValues()), producing a log of the
+  // solutions which can be read back with Assignment::ReadValues(), for
+  // instance to warm start a later search. Neither 'assignment' nor 'writer'
+  // are owned by the monitor.
+  SearchMonitor* MakeSolutionRecorder(Assignment* const assignment,
+                                      RecordWriter* const writer);
+#endif  // #if !defined(SWIG)
+
   // ----- Objective -----
 
   // Creates a minimization objective.
@@ -2238,6 +2367,11 @@ class Solver {
   // portion of the search tree.
   NoGoodManager* MakeNoGoodManager();
 
+  // Same as above, but the manager keeps at most "max_no_goods" nogoods:
+  // when this limit is reached, the least active half of the nogoods (the
+  // ones that propagated the least recently and the least often) is deleted.
+  NoGoodManager* MakeNoGoodManager(int max_no_goods);
+
   // ----- Tree Monitor -----
   // Creates a tree monitor that outputs a detailed overview of the
   // decision phase in cpviz format. The XML data is written to files
@@ -2710,6 +2844,10 @@ class Solver {
 
   // Solution Pool.
   SolutionPool* MakeDefaultSolutionPool();
+  // Pool of at most max_size good solutions, pairwise at least min_distance
+  // apart (see EliteSolutionPool in constraint_solveri.h).
+  EliteSolutionPool* MakeEliteSolutionPool(int max_size, int64 min_distance,
+                                           bool maximize);
 
   // Local Search Phase Parameters
   LocalSearchPhaseParameters* MakeLocalSearchPhaseParameters(
@@ -2882,6 +3020,10 @@ class Solver {
   DependencyGraph* Graph() const;
   // Returns the propagation monitor.
   PropagationMonitor* GetPropagationMonitor() const;
+  // Returns whether a propagation monitor was added to the solver. When this
+  // is false, propagation events need not be sent to the propagation monitor,
+  // as it would not forward them to anyone.
+  bool HasPropagationMonitors() const { return has_propagation_monitors_; }
   // Adds the propagation monitor to the solver. This is called internally when
   // a propagation monitor is passed to the Solve() or NewSearch() method.
   void AddPropagationMonitor(PropagationMonitor* const monitor);
@@ -2944,6 +3086,9 @@ class Solver {
 
  private:
   void Init();  // Initialization. To be called by the constructors only.
+  // Initializes the state of the model and of the search. Called by Init()
+  // and Reset().
+  void InitModel();
   void PushState(MarkerType t, const StateInfo& info);
   MarkerType PopState(StateInfo* info);
   void PushSentinel(int magic_code);
@@ -2999,6 +3144,11 @@ class Solver {
     return reinterpret_cast<T**>(
         UnsafeRevAllocArrayAux(reinterpret_cast<void**>(ptr)));
   }
+  // Allocates size bytes in the reversible arena of the solver. The memory is
+  // released on backtrack, like the one given to UnsafeRevAlloc(), but no
+  // destructor is called, so it can only hold trivially destructible objects.
+  // This is faster than UnsafeRevAlloc() and doesn't use the heap allocator.
+  void* UnsafeRevAllocFromArena(size_t size);
 
   void InitCachedIntConstants();
   void InitCachedConstraint();
@@ -3083,6 +3233,7 @@ class Solver {
   std::unique_ptr<ModelCache> model_cache_;
   std::unique_ptr<DependencyGraph> dependency_graph_;
   std::unique_ptr<PropagationMonitor> propagation_monitor_;
+  bool has_propagation_monitors_;
   PropagationMonitor* print_trace_;
   int anonymous_variable_index_;
   bool should_fail_;
@@ -4207,6 +4358,7 @@ class NoGood {
   // TODO(user) : support interval variables and more types of constraints.
 
  private:
+  friend class WatchedNoGoodManager;
   std::vector<NoGoodTerm*> terms_;
 };
 
@@ -4871,6 +5023,18 @@ class Assignment : public PropagationBaseObject {
   bool Save(File* file) const;
 #endif  // #if !defined(SWIG)
   void Save(AssignmentProto* const proto) const;
+#if !defined(SWIG)
+  // Streaming of the integer variables and the objective of the assignment, in
+  // a compact format where variables are identified by their position in the
+  // assignment instead of their name. WriteValues() appends a record to
+  // 'writer'; ReadValues() reads the next record of 'reader', written from an
+  // assignment with the same integer variables in the same order. Both return
+  // false on failure; ReadValues() also returns false at the end of the file
+  // or if the number of variables does not match. Interval and sequence
+  // variables are not written.
+  bool WriteValues(RecordWriter* const writer) const;
+  bool ReadValues(RecordReader* const reader);
+#endif  // #if !defined(SWIG)
 
   void AddObjective(IntVar* const v);
   IntVar* Objective() const;
@@ -5100,6 +5264,7 @@ class Pack : public Constraint {
   void RemoveAllPossibleFromBin(int bin_index);
   void AssignAllPossibleToBin(int bin_index);
   void AssignFirstPossibleToBin(int bin_index);
+  void AppendUndecidedItems(int bin_index, std::vector<int>* items) const;
   void AssignAllRemainingItems();
   void UnassignAllRemainingItems();
   // Accepts the given visitor.
@@ -5107,12 +5272,16 @@ class Pack : public Constraint {
 
  private:
   bool IsInProcess() const;
+  void TouchBin(int bin_index);
   const std::vector<IntVar*> vars_;
   const int bins_;
   std::vector<Dimension*> dims_;
   std::unique_ptr<RevBitMatrix> unprocessed_;
   std::vector<std::vector<int> > forced_;
   std::vector<std::vector<int> > removed_;
+  // Bins (including bins_ for the unassigned status) with a non empty
+  // forced_ or removed_ vector.
+  std::vector<int> touched_bins_;
   std::vector<IntVarIterator*> holes_;
   uint64 stamp_;
   Demon* demon_;
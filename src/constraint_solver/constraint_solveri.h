@@ -55,6 +55,8 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <new>
+#include <type_traits>
 #include "base/hash.h"
 #include "base/unique_ptr.h"
 #include <string>
@@ -70,6 +72,7 @@
 #include "base/sparse_hash.h"
 #include "base/map_util.h"
 #include "base/hash.h"
+#include "base/mutex.h"
 #include "constraint_solver/constraint_solver.h"
 #include "util/bitset.h"
 #include "util/tuple_set.h"
@@ -148,13 +151,19 @@ enum VarTypes {
 template <class T>
 class SimpleRevFIFO {
  private:
+  // Chunks grow geometrically from FIRST_CHUNK_SIZE to CHUNK_SIZE elements, as
+  // most lists, like the demons of a variable, only ever hold a few elements.
   enum {
+    FIRST_CHUNK_SIZE = 2,
     CHUNK_SIZE = 16
   };  // TODO(user): could be an extra template param
+  // The data of the chunk is allocated right after it.
   struct Chunk {
-    T data_[CHUNK_SIZE];
+    Chunk(const Chunk* next, int size) : next_(next), size_(size) {}
+    T* data() { return reinterpret_cast<T*>(this + 1); }
+    const T* data() const { return reinterpret_cast<const T*>(this + 1); }
     const Chunk* const next_;
-    explicit Chunk(const Chunk* next) : next_(next) {}
+    const int size_;
   };
 
  public:
@@ -167,9 +176,9 @@ class SimpleRevFIFO {
     T operator*() const { return *value_; }
     void operator++() {
       ++value_;
-      if (value_ == chunk_->data_ + CHUNK_SIZE) {
+      if (value_ == chunk_->data() + chunk_->size_) {
         chunk_ = chunk_->next_;
-        value_ = chunk_ ? chunk_->data_ : nullptr;
+        value_ = chunk_ ? chunk_->data() : nullptr;
       }
     }
 
@@ -182,14 +191,24 @@ class SimpleRevFIFO {
 
   void Push(Solver* const s, T val) {
     if (pos_.Value() == 0) {
-      Chunk* const chunk = s->UnsafeRevAlloc(new Chunk(chunks_));
+      // The chunks are allocated in the reversible arena of the solver, which
+      // never calls their destructor.
+      static_assert(std::is_trivially_destructible<T>::value,
+                    "SimpleRevFIFO only supports trivially destructible types");
+      static_assert(alignof(T) <= alignof(Chunk),
+                    "SimpleRevFIFO does not support over-aligned types");
+      const int size = chunks_ == nullptr
+                           ? FIRST_CHUNK_SIZE
+                           : std::min(2 * chunks_->size_, int{CHUNK_SIZE});
+      Chunk* const chunk = new (s->UnsafeRevAllocFromArena(
+          sizeof(Chunk) + size * sizeof(T))) Chunk(chunks_, size);
       s->SaveAndSetValue(reinterpret_cast<void**>(&chunks_),
                          reinterpret_cast<void*>(chunk));
-      pos_.SetValue(s, CHUNK_SIZE - 1);
+      pos_.SetValue(s, size - 1);
     } else {
       pos_.Decr(s);
     }
-    chunks_->data_[pos_.Value()] = val;
+    chunks_->data()[pos_.Value()] = val;
   }
 
   // Pushes the var on top if is not a duplicate of the current top object.
@@ -201,21 +220,23 @@ class SimpleRevFIFO {
 
   // Returns the last item of the FIFO.
   const T* Last() const {
-    return chunks_ ? &chunks_->data_[pos_.Value()] : nullptr;
+    return chunks_ ? &chunks_->data()[pos_.Value()] : nullptr;
   }
 
-  T* MutableLast() { return chunks_ ? &chunks_->data_[pos_.Value()] : nullptr; }
+  T* MutableLast() {
+    return chunks_ ? &chunks_->data()[pos_.Value()] : nullptr;
+  }
 
   // Returns the last value in the FIFO.
   const T& LastValue() const {
     DCHECK(chunks_);
-    return chunks_->data_[pos_.Value()];
+    return chunks_->data()[pos_.Value()];
   }
 
   // Sets the last value in the FIFO.
   void SetLastValue(const T& v) {
     DCHECK(Last());
-    chunks_->data_[pos_.Value()] = v;
+    chunks_->data()[pos_.Value()] = v;
   }
 
  private:
@@ -1207,6 +1228,9 @@ class PathOperator : public IntVarLocalSearchOperator {
   // This is used to remove neighborhood symmetries on equivalent empty paths;
   // for instance if a node cannot be moved to an empty path, then all moves
   // moving the same node to equivalent empty paths will be skipped.
+  // Paths with equivalent starts must also be interchangeable when not empty:
+  // moves which only exchange the whole contents of such paths, or move the
+  // whole content of one to the other if it is empty, are skipped.
   // 'start_empty_path_class' can be nullptr in which case no symmetries will be
   // removed.
   // Ownership of 'start_empty_path_class' is not taken by this class and
@@ -1292,6 +1316,12 @@ class PathOperator : public IntVarLocalSearchOperator {
   bool MakeActive(int64 node, int64 destination);
   bool MakeChainInactive(int64 before_chain, int64 chain_end);
 
+  // Returns true if the paths starting at 'start1' and 'start2' are
+  // interchangeable (cf. 'start_empty_path_class' in the constructor), in
+  // which case moving their whole contents from one to the other leads to a
+  // symmetric neighbor.
+  bool AreInterchangeablePaths(int64 start1, int64 start2) const;
+
   // Sets the to to be the node after from
   void SetNext(int64 from, int64 to, int64 path) {
     DCHECK_LT(from, number_of_nexts_);
@@ -1316,6 +1346,12 @@ class PathOperator : public IntVarLocalSearchOperator {
   // called; this can be used to let an operator iterate more than once over
   // the paths.
   void ResetPosition() { just_started_ = true; }
+  // Returns true if the neighbors explored from given base node positions do
+  // not depend on any other state of the operator, in which case don't-look
+  // bits can be used to skip base nodes (see
+  // FLAGS_cp_local_search_dont_look_bits). Operators iterating more than once
+  // over the paths, or building random neighbors, must return false.
+  virtual bool SupportsDontLookBits() const { return true; }
 
   const int number_of_nexts_;
   const bool ignore_path_vars_;
@@ -1337,6 +1373,14 @@ class PathOperator : public IntVarLocalSearchOperator {
   bool CheckChainValidity(int64 chain_start, int64 chain_end,
                           int64 exclude) const;
   void Synchronize();
+  // Don't-look bits (see FLAGS_cp_local_search_dont_look_bits): clears the
+  // bits of the nodes touched since the last synchronization.
+  void UpdateDontLookBits();
+  // Returns true if the first base node has been combined with all the
+  // positions of the other base nodes.
+  bool FirstBaseNodeExplored();
+  // Moves the first base node past nodes with their don't-look bit set.
+  void SkipDontLookBaseNode();
 
   std::vector<int> base_nodes_;
   std::vector<int> end_nodes_;
@@ -1346,6 +1390,15 @@ class PathOperator : public IntVarLocalSearchOperator {
   bool just_started_;
   bool first_start_;
   ResultCallback1<int, int64>* start_empty_path_class_;
+  bool use_dont_look_bits_;
+  // dont_look_[i] is true if the neighborhood of node i as first base node
+  // has been explored without success since its arcs last changed.
+  std::vector<bool> dont_look_;
+  std::vector<int64> last_nexts_;
+  // Nodes skipped during the current pass, and whether the current pass only
+  // explores the nodes skipped during the previous one.
+  std::vector<int> skipped_nodes_;
+  bool final_sweep_;
 };
 
 // ----- Operator Factories ------
@@ -1370,8 +1423,62 @@ class SwapActiveOperator;
 class ExtendedSwapActiveOperator;
 class MakeActiveAndRelocate;
 
+// Returns the Lin-Kernighan operator built by Solver::MakeOperator(vars,
+// secondary_vars, evaluator, Solver::LK). If 'nearest' is not null, the
+// candidate nodes of the moves are read from the lists it returns instead of
+// being computed from 'evaluator': nearest->Run(node, path, size) must return
+// at least the 'size' nodes with the smallest arc costs from 'node' on 'path',
+// sorted by increasing cost and not containing 'node'. This lets models which
+// already maintain such lists share them with the operator.
+// Takes ownership of 'evaluator' and 'nearest'.
+LocalSearchOperator* MakeLinKernighanOperator(
+    Solver* solver, const std::vector<IntVar*>& vars,
+    const std::vector<IntVar*>& secondary_vars,
+    Solver::IndexEvaluator3* evaluator,
+    ResultCallback3<const std::vector<int>*, int64, int64, int>* nearest);
+
 // ----- Local Search Filters ------
 
+// The integer variable elements of a delta assignment, decoded into compact
+// arrays. The local search decodes each neighbor once and hands the result to
+// all its filters, instead of having each filter walk the IntVarContainer of
+// the delta.
+class LocalSearchDelta {
+ public:
+  LocalSearchDelta() : assignment_(nullptr) {}
+
+  // Decodes the integer variables of 'assignment', which must not be modified
+  // before the next call to Decode().
+  void Decode(const Assignment* const assignment);
+
+  // The assignment which was decoded.
+  const Assignment* assignment() const { return assignment_; }
+  int Size() const { return elements_.size(); }
+  IntVar* Var(int i) const { return elements_[i].var; }
+  // Same as Var(i)->index().
+  int VarIndex(int i) const { return elements_[i].var_index; }
+  bool Activated(int i) const { return elements_[i].activated; }
+  int64 Min(int i) const { return elements_[i].min; }
+  int64 Max(int i) const { return elements_[i].max; }
+  bool Bound(int i) const { return elements_[i].min == elements_[i].max; }
+  int64 Value(int i) const {
+    DCHECK(Bound(i));
+    return elements_[i].min;
+  }
+
+ private:
+  struct Element {
+    IntVar* var;
+    int var_index;
+    bool activated;
+    int64 min;
+    int64 max;
+  };
+
+  const Assignment* assignment_;
+  std::vector<Element> elements_;
+};
+
 // For fast neighbor pruning
 class LocalSearchFilter : public BaseObject {
  public:
@@ -1392,6 +1499,30 @@ class LocalSearchFilter : public BaseObject {
   virtual void Synchronize(const Assignment* assignment,
                            const Assignment* delta) = 0;
   virtual bool IsIncremental() const { return false; }
+
+  // Same as Accept(), with the deltas already decoded. This is the method
+  // called by the local search; the default implementation calls Accept() on
+  // the decoded assignments.
+  virtual bool AcceptDecoded(const LocalSearchDelta& delta,
+                             const LocalSearchDelta& deltadelta) {
+    return Accept(delta.assignment(), deltadelta.assignment());
+  }
+
+  // Returns true if the filter doesn't exchange information with the other
+  // filters (through objective callbacks for instance), in which case the
+  // local search can call it in any order. The local search calls these
+  // filters first, the ones with the highest rejection rate per unit of time
+  // first.
+  virtual bool CanBeReordered() const { return false; }
+
+ protected:
+  // Decodes the deltas and calls AcceptDecoded(). Filters which implement
+  // AcceptDecoded() can use this to implement Accept().
+  bool DecodeAndAccept(const Assignment* delta, const Assignment* deltadelta);
+
+ private:
+  LocalSearchDelta decoded_delta_;
+  LocalSearchDelta decoded_deltadelta_;
 };
 
 // ----- IntVarLocalSearchFilter -----
@@ -1406,8 +1537,13 @@ class IntVarLocalSearchFilter : public LocalSearchFilter {
                            const Assignment* delta);
 
   bool FindIndex(IntVar* const var, int64* index) const {
+    return FindIndexFromVarIndex(var->index(), index);
+  }
+
+  // Same as FindIndex(), from the index of the variable in the solver, as
+  // given by LocalSearchDelta::VarIndex().
+  bool FindIndexFromVarIndex(int var_index, int64* index) const {
     DCHECK(index != nullptr);
-    const int var_index = var->index();
     *index = (var_index < var_index_to_index_.size())
                  ? var_index_to_index_[var_index]
                  : kUnassigned;
@@ -1436,6 +1572,84 @@ class IntVarLocalSearchFilter : public LocalSearchFilter {
   static const int kUnassigned;
 };
 
+// ---------- EliteSolutionPool ----------
+
+// Solution pool keeping a bounded set of good and diverse solutions (the
+// elite), to be used for multi-start local search, path relinking or by LNS
+// operators. Solutions are stored as compact snapshots of the values of the
+// integer variables of the assignments (interval and sequence variables are
+// not recorded); the distance between two solutions is the number of these
+// variables which have different values, which for 'next' variables of a
+// routing model is the number of arcs of one solution not in the other.
+// A new solution enters the elite if it is at least min_distance away from all
+// elite solutions and better than the worst one, or if it is better than all
+// the elite solutions it is too close to, which it then replaces.
+// Solutions are ranked by objective value, ties being broken in favor of the
+// most recent solution; without objective the most recent solutions are kept.
+//
+// Snapshots do not reference any solver and all methods are thread-safe: a
+// pool created outside of a solver can be shared by local searches running in
+// parallel on identical models (the variables of the assignments must be in
+// the same order). Each local search carries on from its own current
+// solution, but moves to the best elite solution as soon as it is better than
+// its current one.
+class EliteSolutionPool : public SolutionPool {
+ public:
+  EliteSolutionPool(int max_size, int64 min_distance, bool maximize);
+  virtual ~EliteSolutionPool();
+
+  // SolutionPool interface.
+  virtual void Initialize(Assignment* const assignment);
+  virtual void RegisterNewSolution(Assignment* const assignment);
+  virtual void GetNextSolution(Assignment* const assignment);
+  virtual bool SyncNeeded(Assignment* const local_assignment);
+  virtual std::string DebugString() const;
+
+  // Offers a solution to the elite; returns true if it was inserted.
+  bool AddSolution(const Assignment* const assignment);
+  // Number of elite solutions; elite solutions are indexed from 0 (the best)
+  // to size() - 1 (the worst).
+  int size() const;
+  int64 ObjectiveValue(int index) const;
+  // Copies the values of the index-th elite solution to the integer variables
+  // of assignment, and its objective value to the objective if any.
+  void RestoreSolution(int index, Assignment* const assignment) const;
+  // Returns the distance between assignment and the index-th elite solution.
+  int64 Distance(int index, const Assignment* const assignment) const;
+
+ private:
+  struct Snapshot {
+    std::vector<int64> values;
+    int64 objective;
+    int64 stamp;
+  };
+  struct CurrentSolution;
+
+  static void TakeSnapshot(const Assignment* const assignment,
+                           Snapshot* const snapshot);
+  static void CopySnapshot(const Snapshot& snapshot,
+                           Assignment* const assignment);
+  // Returns the number of positions at which a and b differ, or some value
+  // larger than or equal to bound if this number is at least bound.
+  static int64 SnapshotDistance(const std::vector<int64>& a,
+                                const std::vector<int64>& b, int64 bound);
+  bool Better(const Snapshot& a, const Snapshot& b) const;
+  bool AddSnapshot(Snapshot* const snapshot);
+  CurrentSolution* MutableCurrentSolution(const Assignment* const assignment);
+
+  const int max_size_;
+  const int64 min_distance_;
+  const bool maximize_;
+  mutable Mutex mutex_;
+  // Sorted from best to worst.
+  std::vector<Snapshot> elite_;
+  hash_map<const Solver*, CurrentSolution*> current_solutions_;
+  int64 num_offered_;
+  int64 num_inserted_;
+
+  DISALLOW_COPY_AND_ASSIGN(EliteSolutionPool);
+};
+
 // ---------- PropagationMonitor ----------
 
 class PropagationMonitor : public SearchMonitor {
@@ -235,6 +235,35 @@ void Distribute::CardMax(int cindex) {
 
 // ----- FastDistribute -----
 
+// Counts, for each value in [0, mins->size() - 1], the number of variables
+// bound to it (mins) and the number of variables that contain it (maxes), and
+// marks the (unbound variable, value) pairs as undecided. This only visits
+// the part of the domain of each variable that lies in the range of values,
+// instead of testing all (variable, value) pairs.
+void CountValues(Solver* const s, const std::vector<IntVar*>& vars,
+                 RevBitMatrix* const undecided, std::vector<int>* const mins,
+                 std::vector<int>* const maxes) {
+  const int64 num_values = mins->size();
+  for (int var_index = 0; var_index < vars.size(); ++var_index) {
+    IntVar* const var = vars[var_index];
+    if (var->Bound()) {
+      const int64 value = var->Min();
+      if (value >= 0 && value < num_values) {
+        (*mins)[value]++;
+        (*maxes)[value]++;
+      }
+      continue;
+    }
+    const int64 vmax = std::min(var->Max(), num_values - 1);
+    for (int64 value = std::max(var->Min(), 0LL); value <= vmax; ++value) {
+      if (var->Contains(value)) {
+        (*maxes)[value]++;
+        undecided->SetToOne(s, var_index, value);
+      }
+    }
+  }
+}
+
 class FastDistribute : public Constraint {
  public:
   FastDistribute(Solver* const s, const std::vector<IntVar*>& vars,
@@ -332,35 +361,23 @@ void FastDistribute::Post() {
 
 void FastDistribute::InitialPropagate() {
   Solver* const s = solver();
+  std::vector<int> mins(card_size(), 0);
+  std::vector<int> maxes(card_size(), 0);
+  CountValues(s, vars_, &undecided_, &mins, &maxes);
   for (int card_index = 0; card_index < card_size(); ++card_index) {
-    int min = 0;
-    int max = 0;
-    for (int var_index = 0; var_index < var_size(); ++var_index) {
-      IntVar* const var = vars_[var_index];
-      if (var->Bound() && var->Min() == card_index) {
-        min++;
-        max++;
-      } else if (var->Contains(card_index)) {
-        max++;
-        undecided_.SetToOne(s, var_index, card_index);
-      }
-    }
-    min_.SetValue(s, card_index, min);
-    max_.SetValue(s, card_index, max);
+    min_.SetValue(s, card_index, mins[card_index]);
+    max_.SetValue(s, card_index, maxes[card_index]);
     CountVar(card_index);
   }
 }
 
+// Only the value the variable is bound to is processed here, the values
+// removed from its domain are processed by OneDomain().
 void FastDistribute::OneBound(int index) {
-  IntVar* const var = vars_[index];
-  for (int card_index = 0; card_index < card_size(); ++card_index) {
-    if (undecided_.IsSet(index, card_index)) {
-      if (var->Min() == card_index) {
-        SetRevDoContribute(index, card_index);
-      } else {
-        SetRevCannotContribute(index, card_index);
-      }
-    }
+  const int64 card_index = vars_[index]->Min();
+  if (card_index >= 0 && card_index < card_size() &&
+      undecided_.IsSet(index, card_index)) {
+    SetRevDoContribute(index, card_index);
   }
 }
 
@@ -743,38 +760,23 @@ void BoundedFastDistribute::InitialPropagate() {
     }
   }
 
+  std::vector<int> mins(card_size(), 0);
+  std::vector<int> maxes(card_size(), 0);
+  CountValues(s, vars_, &undecided_, &mins, &maxes);
   for (int card_index = 0; card_index < card_size(); ++card_index) {
-    int min = 0;
-    int max = 0;
-    for (int i = 0; i < var_size(); ++i) {
-      IntVar* const var = vars_[i];
-      if (var->Bound()) {
-        if (var->Min() == card_index) {
-          min++;
-          max++;
-        }
-      } else if (var->Contains(card_index)) {
-        max++;
-        undecided_.SetToOne(s, i, card_index);
-      }
-    }
-    min_.SetValue(s, card_index, min);
-    max_.SetValue(s, card_index, max);
+    min_.SetValue(s, card_index, mins[card_index]);
+    max_.SetValue(s, card_index, maxes[card_index]);
     CountVar(card_index);
   }
 }
 
+// Only the value the variable is bound to is processed here, the values
+// removed from its domain are processed by OneDomain().
 void BoundedFastDistribute::OneBound(int index) {
-  IntVar* const var = vars_[index];
-  const int64 var_min = var->Min();
-  for (int card_index = 0; card_index < card_size(); ++card_index) {
-    if (undecided_.IsSet(index, card_index)) {
-      if (var_min == card_index) {
-        SetRevDoContribute(index, card_index);
-      } else {
-        SetRevCannotContribute(index, card_index);
-      }
-    }
+  const int64 card_index = vars_[index]->Min();
+  if (card_index >= 0 && card_index < card_size() &&
+      undecided_.IsSet(index, card_index)) {
+    SetRevDoContribute(index, card_index);
   }
 }
 
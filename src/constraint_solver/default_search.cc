@@ -12,7 +12,9 @@
 // limitations under the License.
 
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdio>
 #include "base/hash.h"
 #include <limits>
 #include "base/unique_ptr.h"
@@ -21,13 +23,18 @@
 
 #include "base/callback.h"
 #include "base/commandlineflags.h"
+#include "base/file.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
 
+#include "base/split.h"
 #include "base/stl_util.h"
+#include "base/stringprintf.h"
+#include "base/threadpool.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
+#include "constraint_solver/model.pb.h"
 #include "util/cached_log.h"
 #include "util/string_array.h"
 #include "base/random.h"
@@ -38,11 +45,13 @@ namespace operations_research {
 
 // Default constants for search phase parameters.
 const int DefaultPhaseParameters::kDefaultNumberOfSplits = 100;
+const int DefaultPhaseParameters::kDefaultInitializationWorkers = 1;
 const int DefaultPhaseParameters::kDefaultHeuristicPeriod = 100;
 const int DefaultPhaseParameters::kDefaultHeuristicNumFailuresLimit = 30;
 const int DefaultPhaseParameters::kDefaultSeed = 0;
 const double DefaultPhaseParameters::kDefaultRestartLogSize = -1.0;
 const bool DefaultPhaseParameters::kDefaultUseNoGoods = true;
+const int DefaultPhaseParameters::kDefaultMaxNoGoods = 10000;
 const DefaultPhaseParameters::LnsControl
     DefaultPhaseParameters::kDefaultLnsControl = DefaultPhaseParameters::NO_LNS;
 
@@ -446,7 +455,23 @@ class ImpactRecorder : public SearchMonitor {
     init_count_++;
   }
 
-  void FirstRun(int64 splits) {
+  // Returns the impact of assigning 'value' to the variable, or
+  // kInitFailureImpact if it was not initialized.
+  double Impact(int var_index, int64 value) const {
+    const int64 value_index = value - original_min_[var_index];
+    if (value_index < 0 || value_index >= impacts_[var_index].size()) {
+      return kInitFailureImpact;
+    }
+    return impacts_[var_index][value_index];
+  }
+
+  // Initializes the impacts of all the unbound variables. They are first
+  // read from parameters.impact_file if it is set, then the domains of the
+  // remaining variables are scanned, in parallel if there is more than one
+  // initialization worker. 'search' is the decision builder of the search,
+  // it is used to export the model to the workers.
+  void FirstRun(const DefaultPhaseParameters& parameters,
+                DecisionBuilder* const search) {
     Solver* const s = solver();
     current_log_space_ = domain_watcher_->LogSearchSpaceSize();
     if (display_level_ != DefaultPhaseParameters::NONE) {
@@ -454,13 +479,58 @@ class ImpactRecorder : public SearchMonitor {
     }
     const int64 init_time = s->wall_time();
     ResetAllImpacts();
+    std::vector<bool> to_scan(size_);
+    for (int var_index = 0; var_index < size_; ++var_index) {
+      to_scan[var_index] = !vars_[var_index]->Bound();
+    }
+    impact_file_ = parameters.impact_file;
+    if (!impact_file_.empty()) {
+      const int loaded = LoadImpacts(&to_scan);
+      if (display_level_ != DefaultPhaseParameters::NONE) {
+        LOG(INFO) << "  - impacts of " << loaded << " variables read from "
+                  << impact_file_;
+      }
+    }
+    int64 removed_counter = 0;
+    if (parameters.initialization_workers > 1 &&
+        ScanImpactsInParallel(parameters, search, to_scan)) {
+      FirstRunVariableContainers* const container = s->RevAlloc(
+          new FirstRunVariableContainers(this,
+                                         parameters.initialization_splits));
+      for (int var_index = 0; var_index < size_; ++var_index) {
+        if (to_scan[var_index]) {
+          removed_counter += RemoveFailedValues(var_index, container);
+        }
+      }
+    } else {
+      removed_counter = ScanImpacts(parameters.initialization_splits, to_scan);
+    }
+    if (display_level_ != DefaultPhaseParameters::NONE) {
+      if (removed_counter) {
+        LOG(INFO) << "  - init done, time = " << s->wall_time() - init_time
+                  << " ms, " << removed_counter
+                  << " values removed, log2(SearchSpace) = "
+                  << current_log_space_;
+      } else {
+        LOG(INFO) << "  - init done, time = " << s->wall_time() - init_time
+                  << " ms";
+      }
+    }
+    s->SaveAndSetValue(&init_done_, true);
+  }
+
+  // Scans the domains of the variables marked in 'to_scan' to initialize
+  // their impacts, and removes the values whose assignment fails. Returns
+  // the number of values removed.
+  int64 ScanImpacts(int64 splits, const std::vector<bool>& to_scan) {
+    Solver* const s = solver();
     int64 removed_counter = 0;
     FirstRunVariableContainers* container =
         s->RevAlloc(new FirstRunVariableContainers(this, splits));
     // Loop on the variables, scan domains and initialize impacts.
     for (int var_index = 0; var_index < size_; ++var_index) {
       IntVar* const var = vars_[var_index];
-      if (var->Bound()) {
+      if (var->Bound() || !to_scan[var_index]) {
         continue;
       }
       IntVarIterator* const iterator = domain_iterators_[var_index];
@@ -485,35 +555,41 @@ class ImpactRecorder : public SearchMonitor {
       s->Solve(init_decision_builder);
 
       // If we have not initialized all values, then they can be removed.
-      // As the iterator is not stable w.r.t. deletion, we need to store
-      // removed values in an intermediate vector.
       if (init_count_ != var->Size()) {
-        container->ClearRemovedValues();
-        for (const int64 value : InitAndGetValues(iterator)) {
-          const int64 value_index = value - original_min_[var_index];
-          if (impacts_[var_index][value_index] == kInitFailureImpact) {
-            container->PushBackRemovedValue(value);
-          }
-        }
-        CHECK(container->HasRemovedValues()) << var->DebugString();
-        removed_counter += container->NumRemovedValues();
-        const double old_log = domain_watcher_->Log2(var->Size());
-        var->RemoveValues(container->removed_values());
-        current_log_space_ += domain_watcher_->Log2(var->Size()) - old_log;
+        const int64 removed = RemoveFailedValues(var_index, container);
+        CHECK_GT(removed, 0) << var->DebugString();
+        removed_counter += removed;
       }
     }
-    if (display_level_ != DefaultPhaseParameters::NONE) {
-      if (removed_counter) {
-        LOG(INFO) << "  - init done, time = " << s->wall_time() - init_time
-                  << " ms, " << removed_counter
-                  << " values removed, log2(SearchSpace) = "
-                  << current_log_space_;
-      } else {
-        LOG(INFO) << "  - init done, time = " << s->wall_time() - init_time
-                  << " ms";
-      }
+    return removed_counter;
+  }
+
+  // Resets all the impacts and scans the variables marked in 'to_scan'. This
+  // is used by the workers of the parallel initialization.
+  void ScanImpactsFromScratch(int64 splits, const std::vector<bool>& to_scan) {
+    current_log_space_ = domain_watcher_->LogSearchSpaceSize();
+    ResetAllImpacts();
+    ScanImpacts(splits, to_scan);
+  }
+
+  // The variables scanned by one worker of the parallel initialization.
+  struct ImpactShard {
+    ImpactShard() : to_scan(), loaded(false) {}
+    std::vector<bool> to_scan;
+    // False if the model could not be loaded in the solver of the worker.
+    bool loaded;
+  };
+
+  // Runs one worker of the parallel initialization: loads the model in a
+  // new solver, scans the variables of the shard and copies their impacts
+  // in the impacts of this recorder.
+  void ScanImpactShard(const CPModelProto* const model_proto, int64 splits,
+                       ImpactShard* const shard);
+
+  virtual void ExitSearch() {
+    if (init_done_ && !impact_file_.empty()) {
+      SaveImpacts();
     }
-    s->SaveAndSetValue(&init_done_, true);
   }
 
   // This method scans the domain of one variable and returns the sum
@@ -606,6 +682,46 @@ class ImpactRecorder : public SearchMonitor {
     InitVarImpactsWithSplits with_splits_;
   };
 
+  // Removes the values of the variable whose impact was not initialized,
+  // i.e. the values whose assignment failed. As the iterator is not stable
+  // w.r.t. deletion, the removed values are stored in an intermediate
+  // vector. Returns the number of values removed.
+  int64 RemoveFailedValues(int var_index,
+                           FirstRunVariableContainers* const container) {
+    IntVar* const var = vars_[var_index];
+    container->ClearRemovedValues();
+    for (const int64 value : InitAndGetValues(domain_iterators_[var_index])) {
+      const int64 value_index = value - original_min_[var_index];
+      if (impacts_[var_index][value_index] == kInitFailureImpact) {
+        container->PushBackRemovedValue(value);
+      }
+    }
+    if (!container->HasRemovedValues()) {
+      return 0;
+    }
+    const double old_log = domain_watcher_->Log2(var->Size());
+    var->RemoveValues(container->removed_values());
+    current_log_space_ += domain_watcher_->Log2(var->Size()) - old_log;
+    return container->NumRemovedValues();
+  }
+
+  // Copies the model into one solver per worker, and lets each worker scan
+  // a contiguous share of the variables to scan. The impacts computed by the
+  // workers are written directly in impacts_. Returns false if the model
+  // could not be copied, in which case nothing is scanned.
+  bool ScanImpactsInParallel(const DefaultPhaseParameters& parameters,
+                             DecisionBuilder* const search,
+                             const std::vector<bool>& to_scan);
+
+  // Reads the impacts of the current domains from impact_file_, and clears
+  // to_scan[i] for each variable i whose impacts were all found. Returns the
+  // number of such variables.
+  int LoadImpacts(std::vector<bool>* const to_scan);
+
+  // Writes the initialized impacts to impact_file_, one
+  // "<var index> <value> <impact>" line per value.
+  void SaveImpacts() const;
+
   DomainWatcher* const domain_watcher_;
   std::vector<IntVar*> vars_;
   const int size_;
@@ -622,6 +738,7 @@ class ImpactRecorder : public SearchMonitor {
   FindVar find_var_;
   hash_map<const IntVar*, int> var_map_;
   bool init_done_;
+  std::string impact_file_;
 
   DISALLOW_COPY_AND_ASSIGN(ImpactRecorder);
 };
@@ -632,6 +749,170 @@ const double ImpactRecorder::kFailureImpact = 1.0;
 const double ImpactRecorder::kInitFailureImpact = 2.0;
 const int ImpactRecorder::kUninitializedVarIndex = -1;
 
+// Scans the impacts of some variables in the solver of a worker of the
+// parallel initialization.
+class ImpactScanner : public DecisionBuilder {
+ public:
+  ImpactScanner(ImpactRecorder* const recorder, int64 splits,
+                const std::vector<bool>& to_scan)
+      : recorder_(recorder), splits_(splits), to_scan_(to_scan) {}
+  virtual ~ImpactScanner() {}
+
+  virtual Decision* Next(Solver* const solver) {
+    recorder_->ScanImpactsFromScratch(splits_, to_scan_);
+    return nullptr;
+  }
+
+  virtual std::string DebugString() const { return "ImpactScanner"; }
+
+ private:
+  ImpactRecorder* const recorder_;
+  const int64 splits_;
+  const std::vector<bool>& to_scan_;
+};
+
+void ImpactRecorder::ScanImpactShard(const CPModelProto* const model_proto,
+                                     int64 splits, ImpactShard* const shard) {
+  Solver solver("ImpactInitialization");
+  std::vector<std::vector<IntVar*> > variable_groups;
+  shard->loaded =
+      solver.LoadModel(*model_proto, nullptr, &variable_groups) &&
+      variable_groups.size() == 1 && variable_groups[0].size() == size_;
+  if (!shard->loaded) {
+    return;
+  }
+  DomainWatcher domain_watcher(variable_groups[0], kLogCacheSize);
+  ImpactRecorder recorder(&solver, &domain_watcher, variable_groups[0],
+                          DefaultPhaseParameters::NONE);
+  ImpactScanner scanner(&recorder, splits, shard->to_scan);
+  solver.Solve(&scanner);
+  // The shards are disjoint, so the workers write different rows of
+  // impacts_.
+  for (int var_index = 0; var_index < size_; ++var_index) {
+    if (!shard->to_scan[var_index]) continue;
+    std::vector<double>& impacts = impacts_[var_index];
+    IntVar* const var = variable_groups[0][var_index];
+    if (var->Bound()) {
+      // The variable was bound by the propagation of the worker, which is
+      // stronger than the one of this solver. The other values will be
+      // removed.
+      impacts[var->Min() - original_min_[var_index]] = kPerfectImpact;
+      continue;
+    }
+    for (int value_index = 0; value_index < impacts.size(); ++value_index) {
+      impacts[value_index] =
+          recorder.Impact(var_index, original_min_[var_index] + value_index);
+    }
+  }
+}
+
+bool ImpactRecorder::ScanImpactsInParallel(
+    const DefaultPhaseParameters& parameters, DecisionBuilder* const search,
+    const std::vector<bool>& to_scan) {
+  std::vector<int> vars_to_scan;
+  for (int var_index = 0; var_index < size_; ++var_index) {
+    if (to_scan[var_index]) {
+      vars_to_scan.push_back(var_index);
+    }
+  }
+  const int num_workers = std::min(parameters.initialization_workers,
+                                   static_cast<int>(vars_to_scan.size()));
+  if (num_workers <= 1) {
+    return false;
+  }
+  // The model is exported with the current domains of the variables.
+  CPModelProto model_proto;
+  solver()->ExportModel(std::vector<SearchMonitor*>(), &model_proto, search);
+  std::vector<ImpactShard> shards(num_workers);
+  {
+    ThreadPool pool("ImpactInitialization", num_workers);
+    for (int worker = 0; worker < num_workers; ++worker) {
+      ImpactShard* const shard = &shards[worker];
+      shard->to_scan.assign(size_, false);
+      const int begin = vars_to_scan.size() * worker / num_workers;
+      const int end = vars_to_scan.size() * (worker + 1) / num_workers;
+      for (int i = begin; i < end; ++i) {
+        shard->to_scan[vars_to_scan[i]] = true;
+      }
+      pool.Add(NewCallback(this, &ImpactRecorder::ScanImpactShard,
+                           static_cast<const CPModelProto*>(&model_proto),
+                           static_cast<int64>(parameters.initialization_splits),
+                           shard));
+    }
+    pool.StartWorkers();
+  }
+  for (const ImpactShard& shard : shards) {
+    if (!shard.loaded) {
+      LOG(WARNING) << "The model could not be copied, the impacts are "
+                   << "initialized sequentially.";
+      for (const int var_index : vars_to_scan) {
+        impacts_[var_index].assign(impacts_[var_index].size(),
+                                   kInitFailureImpact);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+int ImpactRecorder::LoadImpacts(std::vector<bool>* const to_scan) {
+  std::string contents;
+  if (!file::GetContents(impact_file_, &contents, file::Defaults()).ok()) {
+    return 0;
+  }
+  for (const std::string& line :
+       strings::Split(contents, "\n", strings::SkipEmpty())) {
+    int var_index = 0;
+    int64 value = 0;
+    double impact = 0.0;
+    if (sscanf(line.c_str(), "%d %" GG_LL_FORMAT "d %lf", &var_index, &value,
+               &impact) != 3 ||
+        var_index < 0 || var_index >= size_ || !(*to_scan)[var_index] ||
+        !vars_[var_index]->Contains(value)) {
+      continue;
+    }
+    impacts_[var_index][value - original_min_[var_index]] = impact;
+  }
+  int loaded = 0;
+  for (int var_index = 0; var_index < size_; ++var_index) {
+    if (!(*to_scan)[var_index]) continue;
+    bool complete = true;
+    for (const int64 value : InitAndGetValues(domain_iterators_[var_index])) {
+      if (Impact(var_index, value) == kInitFailureImpact) {
+        complete = false;
+        break;
+      }
+    }
+    if (complete) {
+      (*to_scan)[var_index] = false;
+      ++loaded;
+    } else {
+      // The values read are dropped, as the values not found by the scan
+      // are the ones that are removed.
+      impacts_[var_index].assign(impacts_[var_index].size(),
+                                 kInitFailureImpact);
+    }
+  }
+  return loaded;
+}
+
+void ImpactRecorder::SaveImpacts() const {
+  std::string contents;
+  for (int var_index = 0; var_index < size_; ++var_index) {
+    const std::vector<double>& impacts = impacts_[var_index];
+    for (int value_index = 0; value_index < impacts.size(); ++value_index) {
+      if (impacts[value_index] != kInitFailureImpact) {
+        StringAppendF(&contents, "%d %" GG_LL_FORMAT "d %.17g\n", var_index,
+                      original_min_[var_index] + value_index,
+                      impacts[value_index]);
+      }
+    }
+  }
+  if (!file::SetContents(impact_file_, contents, file::Defaults()).ok()) {
+    LOG(WARNING) << "Could not write the impacts to " << impact_file_;
+  }
+}
+
 // ----- Restart -----
 
 int64 ComputeBranchRestart(int64 log) {
@@ -679,7 +960,8 @@ class RestartMonitor : public SearchMonitor {
         min_log_search_space_(std::numeric_limits<double>::infinity()),
         no_good_manager_(parameters_.restart_log_size >= 0 &&
                                  parameters_.use_no_goods
-                             ? solver->MakeNoGoodManager()
+                             ? solver->MakeNoGoodManager(
+                                   parameters_.max_no_goods)
                              : nullptr),
         branches_between_restarts_(0),
         min_restart_period_(ComputeBranchRestart(parameters_.restart_log_size)),
@@ -1167,7 +1449,7 @@ class DefaultIntegerSearch : public DecisionBuilder {
                   << ", restart_log_size = " << parameters_.restart_log_size;
       }
       // Init the impacts.
-      impact_recorder_.FirstRun(parameters_.initialization_splits);
+      impact_recorder_.FirstRun(parameters_, this);
     }
     if (parameters_.persistent_impact) {
       init_done_ = true;
@@ -45,12 +45,24 @@ struct Container {
 // DemonProfiler manages the profiling of demons and allows access to gathered
 // data. Add this class as a parameter to Solver and access its information
 // after the end of a search.
+//
+// With SAMPLED_PROFILING, only one demon run out of sampling_period_ is
+// timed and recorded, the other ones only cost a counter decrement. The
+// invocations and the runtime of a demon are then estimated by multiplying
+// the recorded ones by the sampling period.
 class DemonProfiler : public PropagationMonitor {
  public:
   explicit DemonProfiler(Solver* const solver)
       : PropagationMonitor(solver),
         active_constraint_(nullptr),
         active_demon_(nullptr),
+        active_demon_sampled_(false),
+        sampling_period_(
+            solver->parameters().profile_level ==
+                    SolverParameters::SAMPLED_PROFILING
+                ? std::max(1, solver->parameters().profile_sampling_period)
+                : 1),
+        runs_until_sample_(0),
         start_time_ns_(base::GetCurrentTimeNanos()) {}
 
   virtual ~DemonProfiler() {
@@ -135,6 +147,9 @@ class DemonProfiler : public PropagationMonitor {
       DemonRuns* const demon_run = ct_run->add_demons();
       demon_run->set_demon_id(demon->DebugString());
       demon_run->set_failures(0);
+      if (sampling_period_ > 1) {
+        demon_run->set_sampling_period(sampling_period_);
+      }
       demon_map_[demon] = demon_run;
       demons_per_constraint_[active_constraint_].push_back(demon_run);
     }
@@ -147,6 +162,14 @@ class DemonProfiler : public PropagationMonitor {
     CHECK(active_demon_ == nullptr);
     CHECK(demon != nullptr);
     active_demon_ = demon;
+    // The demon is still recorded as active when it is not sampled, to count
+    // its failures.
+    active_demon_sampled_ = runs_until_sample_ == 0;
+    if (!active_demon_sampled_) {
+      --runs_until_sample_;
+      return;
+    }
+    runs_until_sample_ = sampling_period_ - 1;
     DemonRuns* const demon_run = demon_map_[active_demon_];
     if (demon_run != nullptr) {
       demon_run->add_start_time(CurrentTime());
@@ -159,9 +182,11 @@ class DemonProfiler : public PropagationMonitor {
     }
     CHECK_EQ(active_demon_, demon);
     CHECK(demon != nullptr);
-    DemonRuns* const demon_run = demon_map_[active_demon_];
-    if (demon_run != nullptr) {
-      demon_run->add_end_time(CurrentTime());
+    if (active_demon_sampled_) {
+      DemonRuns* const demon_run = demon_map_[active_demon_];
+      if (demon_run != nullptr) {
+        demon_run->add_end_time(CurrentTime());
+      }
     }
     active_demon_ = nullptr;
   }
@@ -175,7 +200,9 @@ class DemonProfiler : public PropagationMonitor {
     if (active_demon_ != nullptr) {
       DemonRuns* const demon_run = demon_map_[active_demon_];
       if (demon_run != nullptr) {
-        demon_run->add_end_time(CurrentTime());
+        if (active_demon_sampled_) {
+          demon_run->add_end_time(CurrentTime());
+        }
         demon_run->set_failures(demon_run->failures() + 1);
       }
       active_demon_ = nullptr;
@@ -198,6 +225,7 @@ class DemonProfiler : public PropagationMonitor {
     constraint_map_.clear();
     demon_map_.clear();
     demons_per_constraint_.clear();
+    runs_until_sample_ = 0;
   }
 
   // IntExpr modifiers.
@@ -261,65 +289,73 @@ class DemonProfiler : public PropagationMonitor {
         "d, failures=%" GG_LL_FORMAT "d, total runtime=%" GG_LL_FORMAT
         "d us, [average=%.2lf, median=%.2lf, stddev=%.2lf]\n";
     File* const file = File::Open(filename, "w");
-    const std::string model =
+    if (file == nullptr) return;
+    // Many short lines are written, they are batched in a large buffer.
+    BufferedFileWriter writer(file);
+    std::string model =
         StringPrintf("Model %s:\n", solver->model_name().c_str());
-    if (file) {
-      file::WriteString(file, model, file::Defaults()).IgnoreError();
-      std::vector<Container> to_sort;
-      for (hash_map<const Constraint*, ConstraintRuns*>::const_iterator it =
-               constraint_map_.begin();
-           it != constraint_map_.end(); ++it) {
-        const Constraint* const ct = it->first;
-        int64 fails = 0;
-        int64 demon_invocations = 0;
-        int64 initial_propagation_runtime = 0;
-        int64 total_demon_runtime = 0;
-        int demon_count = 0;
-        ExportInformation(ct, &fails, &initial_propagation_runtime,
-                          &demon_invocations, &total_demon_runtime,
-                          &demon_count);
-        to_sort.push_back(
-            Container(ct, total_demon_runtime + initial_propagation_runtime));
-      }
-      std::sort(to_sort.begin(), to_sort.end());
-
-      for (int i = 0; i < to_sort.size(); ++i) {
-        const Constraint* const ct = to_sort[i].ct;
+    if (sampling_period_ > 1) {
+      StringAppendF(&model,
+                    "  Sampled profile: one demon run out of %d is timed, "
+                    "demon invocations and runtimes are estimates.\n",
+                    sampling_period_);
+    }
+    writer.WriteString(model);
+    std::vector<Container> to_sort;
+    for (hash_map<const Constraint*, ConstraintRuns*>::const_iterator it =
+             constraint_map_.begin();
+         it != constraint_map_.end(); ++it) {
+      const Constraint* const ct = it->first;
+      int64 fails = 0;
+      int64 demon_invocations = 0;
+      int64 initial_propagation_runtime = 0;
+      int64 total_demon_runtime = 0;
+      int demon_count = 0;
+      ExportInformation(ct, &fails, &initial_propagation_runtime,
+                        &demon_invocations, &total_demon_runtime,
+                        &demon_count);
+      to_sort.push_back(
+          Container(ct, total_demon_runtime + initial_propagation_runtime));
+    }
+    std::sort(to_sort.begin(), to_sort.end());
+
+    for (int i = 0; i < to_sort.size(); ++i) {
+      const Constraint* const ct = to_sort[i].ct;
+      int64 fails = 0;
+      int64 demon_invocations = 0;
+      int64 initial_propagation_runtime = 0;
+      int64 total_demon_runtime = 0;
+      int demon_count = 0;
+      ExportInformation(ct, &fails, &initial_propagation_runtime,
+                        &demon_invocations, &total_demon_runtime,
+                        &demon_count);
+      const std::string constraint_message =
+          StringPrintf(kConstraintFormat, ct->DebugString().c_str(), fails,
+                       initial_propagation_runtime, demon_count,
+                       demon_invocations, total_demon_runtime);
+      writer.WriteString(constraint_message);
+      const std::vector<DemonRuns*>& demons = demons_per_constraint_[ct];
+      const int demon_size = demons.size();
+      for (int demon_index = 0; demon_index < demon_size; ++demon_index) {
+        DemonRuns* const demon_runs = demons[demon_index];
+        int64 invocations = 0;
         int64 fails = 0;
-        int64 demon_invocations = 0;
-        int64 initial_propagation_runtime = 0;
-        int64 total_demon_runtime = 0;
-        int demon_count = 0;
-        ExportInformation(ct, &fails, &initial_propagation_runtime,
-                          &demon_invocations, &total_demon_runtime,
-                          &demon_count);
-        const std::string constraint_message =
-            StringPrintf(kConstraintFormat, ct->DebugString().c_str(), fails,
-                         initial_propagation_runtime, demon_count,
-                         demon_invocations, total_demon_runtime);
-        file::WriteString(file, constraint_message, file::Defaults())
-            .IgnoreError();
-        const std::vector<DemonRuns*>& demons = demons_per_constraint_[ct];
-        const int demon_size = demons.size();
-        for (int demon_index = 0; demon_index < demon_size; ++demon_index) {
-          DemonRuns* const demon_runs = demons[demon_index];
-          int64 invocations = 0;
-          int64 fails = 0;
-          int64 runtime = 0;
-          double mean_runtime = 0;
-          double median_runtime = 0;
-          double standard_deviation = 0.0;
-          ExportInformation(demon_runs, &invocations, &fails, &runtime,
-                            &mean_runtime, &median_runtime,
-                            &standard_deviation);
-          const std::string runs = StringPrintf(
-              kDemonFormat, demon_runs->demon_id().c_str(), invocations, fails,
-              runtime, mean_runtime, median_runtime, standard_deviation);
-          file::WriteString(file, runs, file::Defaults()).IgnoreError();
-        }
+        int64 runtime = 0;
+        double mean_runtime = 0;
+        double median_runtime = 0;
+        double standard_deviation = 0.0;
+        ExportInformation(demon_runs, &invocations, &fails, &runtime,
+                          &mean_runtime, &median_runtime,
+                          &standard_deviation);
+        const std::string runs = StringPrintf(
+            kDemonFormat, demon_runs->demon_id().c_str(), invocations, fails,
+            runtime, mean_runtime, median_runtime, standard_deviation);
+        writer.WriteString(runs);
       }
     }
-    file->Close();
+    if (!writer.Close()) {
+      LOG(WARNING) << "Error while writing profile to " << filename;
+    }
   }
 
   // Export Information
@@ -347,11 +383,12 @@ class DemonProfiler : public PropagationMonitor {
       *fails += demon_runs.failures();
       CHECK_EQ(demon_runs.start_time_size(), demon_runs.end_time_size());
       const int runs = demon_runs.start_time_size();
-      *demon_invocations += runs;
+      const int64 period = demon_runs.sampling_period();
+      *demon_invocations += runs * period;
       for (int run_index = 0; run_index < runs; ++run_index) {
         const int64 demon_time =
             demon_runs.end_time(run_index) - demon_runs.start_time(run_index);
-        *total_demon_runtime += demon_time;
+        *total_demon_runtime += demon_time * period;
       }
     }
   }
@@ -365,8 +402,11 @@ class DemonProfiler : public PropagationMonitor {
     CHECK(demon_runs != nullptr);
     CHECK_EQ(demon_runs->start_time_size(), demon_runs->end_time_size());
 
+    // The mean, median and standard deviation of the runtime are computed on
+    // the recorded runs only.
     const int runs = demon_runs->start_time_size();
-    *demon_invocations = runs;
+    const int64 period = demon_runs->sampling_period();
+    *demon_invocations = runs * period;
     *fails = demon_runs->failures();
     *total_demon_runtime = 0;
     *mean_demon_runtime = 0.0;
@@ -382,6 +422,7 @@ class DemonProfiler : public PropagationMonitor {
     // Compute mean.
     if (runtimes.size()) {
       *mean_demon_runtime = (1.0L * *total_demon_runtime) / runtimes.size();
+      *total_demon_runtime *= period;
 
       // Compute median.
       std::sort(runtimes.begin(), runtimes.end());
@@ -417,6 +458,10 @@ class DemonProfiler : public PropagationMonitor {
  private:
   Constraint* active_constraint_;
   Demon* active_demon_;
+  bool active_demon_sampled_;
+  const int sampling_period_;
+  // Number of demon runs to skip before timing the next one.
+  int runs_until_sample_;
   const int64 start_time_ns_;
   hash_map<const Constraint*, ConstraintRuns*> constraint_map_;
   hash_map<const Demon*, DemonRuns*> demon_map_;
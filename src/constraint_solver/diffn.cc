@@ -32,6 +32,146 @@ namespace operations_research {
 // Diffn constraint, Non overlapping boxs.
 namespace {
 DEFINE_INT_TYPE(Box, int);
+
+// Minimum number of boxes to propagate in one call to rebuild the indices
+// below. Rebuilding them costs about as much as scanning all boxes a few times
+// to find the neighbors of a box.
+const int kMinBoxesForIndexing = 8;
+
+// Index of the projections on one axis of the regions the boxes can occupy.
+// The projection of a box is [position min, position max + size max). Boxes
+// are kept sorted by the start of their projection, together with a tree of
+// the maximum ends over this order, which lists the boxes whose projection
+// intersects a given range without scanning all the boxes.
+class ProjectionIndex {
+ public:
+  ProjectionIndex(const std::vector<IntVar*>& positions,
+                  const std::vector<IntVar*>& sizes)
+      : positions_(positions),
+        sizes_(sizes),
+        size_(positions.size()),
+        starts_(size_, 0),
+        ends_(size_, 0),
+        boxes_(size_),
+        ranks_(size_),
+        num_leaves_(1) {
+    while (num_leaves_ < size_) {
+      num_leaves_ *= 2;
+    }
+    max_ends_.assign(2 * num_leaves_, kint64min);
+    for (int box = 0; box < size_; ++box) {
+      boxes_[box] = box;
+      ranks_[box] = box;
+    }
+  }
+
+  // Recomputes the projections of all boxes. Runs in O(n log n).
+  void UpdateAll() {
+    for (int box = 0; box < size_; ++box) {
+      ReadProjection(box);
+    }
+    std::sort(boxes_.begin(), boxes_.end(),
+              [this](int box1, int box2) {
+                return starts_[box1] < starts_[box2];
+              });
+    for (int rank = 0; rank < size_; ++rank) {
+      ranks_[boxes_[rank]] = rank;
+      max_ends_[num_leaves_ + rank] = ends_[boxes_[rank]];
+    }
+    for (int node = num_leaves_ - 1; node > 0; --node) {
+      max_ends_[node] =
+          std::max(max_ends_[2 * node], max_ends_[2 * node + 1]);
+    }
+  }
+
+  // Recomputes the projections of the given boxes, all other boxes being
+  // unchanged. Projections must only have shrunk since the last update, which
+  // holds as long as the solver did not backtrack. Runs in O(log n) per box
+  // and per position it moves in the order.
+  template <class BoxContainer>
+  void Update(const BoxContainer& boxes) {
+    for (const int box : boxes) {
+      ReadProjection(box);
+      // The start can only have increased, the box moves right.
+      int rank = ranks_[box];
+      while (rank + 1 < size_ && starts_[boxes_[rank + 1]] < starts_[box]) {
+        const int next = boxes_[rank + 1];
+        boxes_[rank] = next;
+        ranks_[next] = rank;
+        UpdateLeaf(rank);
+        ++rank;
+      }
+      boxes_[rank] = box;
+      ranks_[box] = rank;
+      UpdateLeaf(rank);
+    }
+  }
+
+  // Length of the smallest range containing all projections.
+  int64 Span() const {
+    return size_ == 0 ? 0 : max_ends_[1] - starts_[boxes_[0]];
+  }
+
+  // Appends to 'boxes' all boxes whose projection intersects [start, end).
+  // As projections only shrink during propagation, boxes which did not
+  // intersect the range at the last update cannot intersect it now, hence the
+  // result is a superset of the boxes intersecting the range.
+  void FindIntersecting(int64 start, int64 end, std::vector<int>* boxes) const {
+    const int count =
+        std::lower_bound(boxes_.begin(), boxes_.end(), end,
+                         [this](int box, int64 value) {
+                           return starts_[box] < value;
+                         }) -
+        boxes_.begin();
+    Collect(1, 0, num_leaves_, count, start, boxes);
+  }
+
+ private:
+  void ReadProjection(int box) {
+    starts_[box] = positions_[box]->Min();
+    ends_[box] = positions_[box]->Max() + sizes_[box]->Max();
+  }
+
+  void UpdateLeaf(int rank) {
+    int node = num_leaves_ + rank;
+    max_ends_[node] = ends_[boxes_[rank]];
+    for (node /= 2; node > 0; node /= 2) {
+      max_ends_[node] =
+          std::max(max_ends_[2 * node], max_ends_[2 * node + 1]);
+    }
+  }
+
+  // Collects the boxes whose rank is in [begin, end) and below count, and
+  // whose projection ends after start. 'node' covers the ranks [begin, end).
+  void Collect(int node, int begin, int end, int count, int64 start,
+               std::vector<int>* boxes) const {
+    if (begin >= count || max_ends_[node] <= start) {
+      return;
+    }
+    if (node >= num_leaves_) {
+      boxes->push_back(boxes_[node - num_leaves_]);
+      return;
+    }
+    const int middle = (begin + end) / 2;
+    Collect(2 * node, begin, middle, count, start, boxes);
+    Collect(2 * node + 1, middle, end, count, start, boxes);
+  }
+
+  const std::vector<IntVar*>& positions_;
+  const std::vector<IntVar*>& sizes_;
+  const int size_;
+  // Projection of each box at the last update.
+  std::vector<int64> starts_;
+  std::vector<int64> ends_;
+  // Boxes sorted by projection start, and rank of each box in this order.
+  std::vector<int> boxes_;
+  std::vector<int> ranks_;
+  // Binary tree of maximum projection ends; node i has children 2i and
+  // 2i + 1, leaf num_leaves_ + r holds the box of rank r.
+  int num_leaves_;
+  std::vector<int64> max_ends_;
+};
+
 class Diffn : public Constraint {
  public:
   Diffn(Solver* const solver, const std::vector<IntVar*>& x_vars,
@@ -43,7 +183,11 @@ class Diffn : public Constraint {
         dx_(x_size),
         dy_(y_size),
         size_(x_vars.size()),
-        fail_stamp_(0) {
+        fail_stamp_(0),
+        x_index_(x_, dx_),
+        y_index_(y_, dy_),
+        indices_synced_(false),
+        indices_fail_stamp_(0) {
     CHECK_EQ(x_vars.size(), y_vars.size());
     CHECK_EQ(x_vars.size(), x_size.size());
     CHECK_EQ(x_vars.size(), y_size.size());
@@ -110,6 +254,7 @@ class Diffn : public Constraint {
     }
 
     // Force propagation on all boxes.
+    indices_synced_ = false;
     to_propagate_.clear();
     for (int i = 0; i < size_; i++) {
       to_propagate_.insert(i);
@@ -140,6 +285,7 @@ class Diffn : public Constraint {
 
  private:
   void PropagateAll() {
+    SyncIndices();
     for (const int box : to_propagate_) {
       FillNeighbors(box);
       FailWhenEnergyIsTooLarge(box);
@@ -178,16 +324,57 @@ class Diffn : public Constraint {
            (y_[j]->Min() >= y_[i]->Max() + dy_[i]->Max());
   }
 
-  // Fill neighbors_ with all boxes that can overlap the given box.
+  // Brings the indices up to date if it is worth it. Between two calls without
+  // backtrack, only the boxes in to_propagate_ have changed and the indices
+  // are updated incrementally. After a backtrack, the indices are only rebuilt
+  // if many boxes must be propagated, otherwise neighbors are found by
+  // scanning all boxes.
+  void SyncIndices() {
+    if (indices_synced_ && solver()->fail_stamp() == indices_fail_stamp_) {
+      x_index_.Update(to_propagate_);
+      y_index_.Update(to_propagate_);
+      return;
+    }
+    indices_synced_ = false;
+    if (to_propagate_.size() >= kMinBoxesForIndexing) {
+      x_index_.UpdateAll();
+      y_index_.UpdateAll();
+      indices_synced_ = true;
+      indices_fail_stamp_ = solver()->fail_stamp();
+    }
+  }
+
+  // Fill neighbors_ with all boxes that can overlap the given box. When the
+  // indices are synced, candidates are taken from the index of the axis on
+  // which the region of the box is the narrowest relative to the span of all
+  // boxes.
   void FillNeighbors(int box) {
-    // TODO(user): We could maintain a non reversible list of
-    // neighbors and clean it after each failure.
     neighbors_.clear();
-    for (int other = 0; other < size_; ++other) {
+    if (!indices_synced_) {
+      for (int other = 0; other < size_; ++other) {
+        if (other != box && CanBoxedOverlap(other, box)) {
+          neighbors_.push_back(other);
+        }
+      }
+      return;
+    }
+    const int64 x_start = x_[box]->Min();
+    const int64 x_end = x_[box]->Max() + dx_[box]->Max();
+    const int64 y_start = y_[box]->Min();
+    const int64 y_end = y_[box]->Max() + dy_[box]->Max();
+    if (static_cast<double>(x_end - x_start) * y_index_.Span() <=
+        static_cast<double>(y_end - y_start) * x_index_.Span()) {
+      x_index_.FindIntersecting(x_start, x_end, &neighbors_);
+    } else {
+      y_index_.FindIntersecting(y_start, y_end, &neighbors_);
+    }
+    int num_neighbors = 0;
+    for (const int other : neighbors_) {
       if (other != box && CanBoxedOverlap(other, box)) {
-        neighbors_.push_back(other);
+        neighbors_[num_neighbors++] = other;
       }
     }
+    neighbors_.resize(num_neighbors);
   }
 
   // Fails if the minimum area of the given box plus the area of its neighbors
@@ -290,6 +477,13 @@ class Diffn : public Constraint {
   hash_set<int> to_propagate_;
   std::vector<int> neighbors_;
   uint64 fail_stamp_;
+  // Indices of the regions of the boxes on each axis. They are synced if they
+  // were up to date at the start of the current propagation, with no
+  // backtrack since indices_fail_stamp_.
+  ProjectionIndex x_index_;
+  ProjectionIndex y_index_;
+  bool indices_synced_;
+  uint64 indices_fail_stamp_;
 };
 }  // namespace
 
@@ -53,13 +53,24 @@ class BaseIntExprElement : public BaseIntExpr {
 
  protected:
   virtual int64 ElementValue(int index) const = 0;
+  // Sets values[i] = ElementValue(indices[i]) for i in [0, size). This is
+  // used to compute the supports, and can be redefined to evaluate all the
+  // values in one call.
+  virtual void ElementValues(const int64* const indices, int size,
+                             int64* const values) const;
   virtual int64 ExprMin() const = 0;
   virtual int64 ExprMax() const = 0;
 
   IntVar* const expr_;
 
  private:
+  static const int kSupportBatchSize = 256;
+
   void UpdateSupports() const;
+  // Evaluates the indices stored in indices_, updates the given min and max
+  // values and supports, and clears indices_.
+  void ScanIndices(int64* const min_value, int* const min_support,
+                   int64* const max_value, int* const max_support) const;
 
   mutable int64 min_;
   mutable int min_support_;
@@ -67,6 +78,8 @@ class BaseIntExprElement : public BaseIntExpr {
   mutable int max_support_;
   mutable bool initial_update_;
   IntVarIterator* const expr_iterator_;
+  mutable std::vector<int64> indices_;
+  mutable std::vector<int64> values_buffer_;
 };
 
 BaseIntExprElement::BaseIntExprElement(Solver* const s, IntVar* const e)
@@ -140,39 +153,37 @@ void BaseIntExprElement::UpdateSupports() const {
       !expr_->Contains(max_support_)) {
     const int64 emin = ExprMin();
     const int64 emax = ExprMax();
-    int64 min_value = ElementValue(emax);
-    int64 max_value = min_value;
-    int min_support = emax;
-    int max_support = emax;
-    const int64 expr_size = expr_->Size();
-    if (expr_size > 1) {
-      if (expr_size == emax - emin + 1) {
-        // Value(emax) already stored in min_value, max_value.
-        for (int64 index = emin; index < emax; ++index) {
-          const int64 value = ElementValue(index);
-          if (value > max_value) {
-            max_value = value;
-            max_support = index;
-          } else if (value < min_value) {
-            min_value = value;
-            min_support = index;
-          }
+    int64 min_value = kint64max;
+    int64 max_value = kint64min;
+    int min_support = -1;
+    int max_support = -1;
+    // The indices are evaluated by batches of kSupportBatchSize with
+    // ElementValues().
+    indices_.clear();
+    if (expr_->Size() == emax - emin + 1) {
+      for (int64 index = emin; index <= emax; ++index) {
+        indices_.push_back(index);
+        if (indices_.size() == kSupportBatchSize) {
+          ScanIndices(&min_value, &min_support, &max_value, &max_support);
         }
-      } else {
-        for (const int64 index : InitAndGetValues(expr_iterator_)) {
-          if (index >= emin && index <= emax) {
-            const int64 value = ElementValue(index);
-            if (value > max_value) {
-              max_value = value;
-              max_support = index;
-            } else if (value < min_value) {
-              min_value = value;
-              min_support = index;
-            }
+      }
+    } else {
+      for (const int64 index : InitAndGetValues(expr_iterator_)) {
+        if (index >= emin && index <= emax) {
+          indices_.push_back(index);
+          if (indices_.size() == kSupportBatchSize) {
+            ScanIndices(&min_value, &min_support, &max_value, &max_support);
           }
         }
       }
     }
+    ScanIndices(&min_value, &min_support, &max_value, &max_support);
+    if (min_support == -1) {
+      min_value = ElementValue(emax);
+      max_value = min_value;
+      min_support = emax;
+      max_support = emax;
+    }
     Solver* s = solver();
     s->SaveAndSetValue(&min_, min_value);
     s->SaveAndSetValue(&min_support_, min_support);
@@ -182,50 +193,115 @@ void BaseIntExprElement::UpdateSupports() const {
   }
 }
 
+void BaseIntExprElement::ScanIndices(int64* const min_value,
+                                     int* const min_support,
+                                     int64* const max_value,
+                                     int* const max_support) const {
+  if (indices_.empty()) return;
+  values_buffer_.resize(indices_.size());
+  ElementValues(indices_.data(), indices_.size(), values_buffer_.data());
+  for (int i = 0; i < indices_.size(); ++i) {
+    const int64 value = values_buffer_[i];
+    if (value < *min_value || *min_support == -1) {
+      *min_value = value;
+      *min_support = indices_[i];
+    }
+    if (value > *max_value || *max_support == -1) {
+      *max_value = value;
+      *max_support = indices_[i];
+    }
+  }
+  indices_.clear();
+}
+
+void BaseIntExprElement::ElementValues(const int64* const indices, int size,
+                                       int64* const values) const {
+  for (int i = 0; i < size; ++i) {
+    values[i] = ElementValue(indices[i]);
+  }
+}
+
+// ----- Sorted value index -----
+
+// Returns the indices of 'values' sorted by increasing value, ties broken by
+// increasing index. The array is built once per value array and shared by
+// the element expression and its cast constraint.
+int* BuildSortedValueIndex(Solver* const solver,
+                           const std::vector<int64>& values) {
+  const int size = values.size();
+  int* const sorted = solver->RevAllocArray(new int[size]);
+  for (int i = 0; i < size; ++i) {
+    sorted[i] = i;
+  }
+  std::stable_sort(sorted, sorted + size, [&values](int a, int b) {
+    return values[a] < values[b];
+  });
+  return sorted;
+}
+
 // ----- IntElementConstraint -----
 
 // This constraint implements 'elem' == 'values'['index'].
-// It scans the bounds of 'elem' to propagate on the domain of 'index'.
-// It scans the domain of 'index' to compute the new bounds of 'elem'.
+// The indices are walked in the order of their values, from both ends, with
+// two reversible positions. The indices whose values are outside the bounds
+// of 'elem' are removed from 'index', and the first and last indices still
+// in the domain of 'index' give the new bounds of 'elem'. As the domains
+// only shrink along a branch, each index is skipped at most once per branch
+// and most propagations only check the two supports.
 class IntElementConstraint : public CastConstraint {
  public:
   IntElementConstraint(Solver* const s, const std::vector<int64>& values,
-                       IntVar* const index, IntVar* const elem)
+                       const int* const sorted, IntVar* const index,
+                       IntVar* const elem)
       : CastConstraint(s, elem),
         values_(values),
+        sorted_(sorted != nullptr ? sorted : BuildSortedValueIndex(s, values)),
         index_(index),
-        index_iterator_(index_->MakeDomainIterator(true)) {
+        first_(0),
+        last_(values.size() - 1) {
     CHECK(index != nullptr);
   }
 
   virtual void Post() {
-    Demon* const d =
-        solver()->MakeDelayedConstraintInitialPropagateCallback(this);
+    Demon* const d = MakeDelayedConstraintDemon0(
+        solver(), this, &IntElementConstraint::Propagate, "Propagate");
     index_->WhenDomain(d);
     target_var_->WhenRange(d);
   }
 
   virtual void InitialPropagate() {
     index_->SetRange(0, values_.size() - 1);
+    Propagate();
+  }
+
+  void Propagate() {
     const int64 target_var_min = target_var_->Min();
     const int64 target_var_max = target_var_->Max();
-    int64 new_min = target_var_max;
-    int64 new_max = target_var_min;
+    int first = first_.Value();
+    int last = last_.Value();
     to_remove_.clear();
-    for (const int64 index : InitAndGetValues(index_iterator_)) {
-      const int64 value = values_[index];
-      if (value < target_var_min || value > target_var_max) {
+    while (first <= last) {
+      const int index = sorted_[first];
+      if (index_->Contains(index)) {
+        if (values_[index] >= target_var_min) break;
         to_remove_.push_back(index);
-      } else {
-        if (value < new_min) {
-          new_min = value;
-        }
-        if (value > new_max) {
-          new_max = value;
-        }
       }
+      ++first;
     }
-    target_var_->SetRange(new_min, new_max);
+    while (last >= first) {
+      const int index = sorted_[last];
+      if (index_->Contains(index)) {
+        if (values_[index] <= target_var_max) break;
+        to_remove_.push_back(index);
+      }
+      --last;
+    }
+    if (first > last) {
+      solver()->Fail();
+    }
+    first_.SetValue(solver(), first);
+    last_.SetValue(solver(), last);
+    target_var_->SetRange(values_[sorted_[first]], values_[sorted_[last]]);
     if (!to_remove_.empty()) {
       index_->RemoveValues(to_remove_);
     }
@@ -250,8 +326,13 @@ class IntElementConstraint : public CastConstraint {
 
  private:
   const std::vector<int64> values_;
+  const int* const sorted_;
   IntVar* const index_;
-  IntVarIterator* const index_iterator_;
+  // Positions in sorted_ of the indices supporting the min and the max of
+  // 'elem'. All the indices before first_ and after last_ have been removed
+  // from 'index'.
+  Rev<int> first_;
+  Rev<int> last_;
   std::vector<int64> to_remove_;
 };
 
@@ -262,10 +343,23 @@ IntVar* BuildDomainIntVar(Solver* const solver, std::vector<int64>* values);
 class IntExprElement : public BaseIntExprElement {
  public:
   IntExprElement(Solver* const s, const std::vector<int64>& vals, IntVar* const expr)
-      : BaseIntExprElement(s, expr), values_(vals) {}
+      : BaseIntExprElement(s, expr),
+        values_(vals),
+        sorted_(BuildSortedValueIndex(s, vals)),
+        first_(0),
+        last_(vals.size() - 1) {}
 
   virtual ~IntExprElement() {}
 
+  // The min and max are read from the sorted value index instead of
+  // rescanning the domain of the index when a support is removed.
+  virtual int64 Min() const { return values_[sorted_[FirstSupport()]]; }
+  virtual int64 Max() const { return values_[sorted_[LastSupport()]]; }
+  virtual void Range(int64* mi, int64* ma) {
+    *mi = Min();
+    *ma = Max();
+  }
+
   virtual std::string name() const {
     const int size = values_.size();
     if (size > 10) {
@@ -294,7 +388,9 @@ class IntExprElement : public BaseIntExprElement {
     Solver* const s = solver();
     IntVar* const var = s->MakeIntVar(values_);
     s->AddCastConstraint(
-        s->RevAlloc(new IntElementConstraint(s, values_, expr_, var)), var,
+        s->RevAlloc(
+            new IntElementConstraint(s, values_, sorted_, expr_, var)),
+        var,
         this);
     return var;
   }
@@ -318,7 +414,45 @@ class IntExprElement : public BaseIntExprElement {
   }
 
  private:
+  bool IsSupport(int64 index) const {
+    return index >= ExprMin() && index <= ExprMax() && expr_->Contains(index);
+  }
+
+  // Returns the first position in sorted_ whose index is still in the domain
+  // of expr_. The skipped positions can't become supports again in the
+  // current branch, so the position is stored reversibly.
+  int FirstSupport() const {
+    int first = first_;
+    while (first < values_.size() && !IsSupport(sorted_[first])) {
+      ++first;
+    }
+    if (first == values_.size()) {
+      solver()->Fail();
+    }
+    if (first != first_) {
+      solver()->SaveAndSetValue(&first_, first);
+    }
+    return first;
+  }
+
+  int LastSupport() const {
+    int last = last_;
+    while (last >= 0 && !IsSupport(sorted_[last])) {
+      --last;
+    }
+    if (last < 0) {
+      solver()->Fail();
+    }
+    if (last != last_) {
+      solver()->SaveAndSetValue(&last_, last);
+    }
+    return last;
+  }
+
   const std::vector<int64> values_;
+  const int* const sorted_;
+  mutable int first_;
+  mutable int last_;
 };
 
 // ----- Increasing Element -----
@@ -569,18 +703,31 @@ class IntExprFunctionElement : public BaseIntExprElement {
 
  protected:
   virtual int64 ElementValue(int index) const { return values_->Run(index); }
+  virtual void ElementValues(const int64* const indices, int size,
+                             int64* const values) const {
+    if (batch_values_ != nullptr) {
+      batch_values_->RunBatch(indices, size, values);
+    } else {
+      BaseIntExprElement::ElementValues(indices, size, values);
+    }
+  }
   virtual int64 ExprMin() const { return expr_->Min(); }
   virtual int64 ExprMax() const { return expr_->Max(); }
 
  private:
   ResultCallback1<int64, int64>* values_;
+  // Same object as values_ if it supports batch evaluation.
+  BatchIndexEvaluator1* const batch_values_;
   const bool delete_;
 };
 
 IntExprFunctionElement::IntExprFunctionElement(
     Solver* const s, ResultCallback1<int64, int64>* values, IntVar* const e,
     bool del)
-    : BaseIntExprElement(s, e), values_(values), delete_(del) {
+    : BaseIntExprElement(s, e),
+      values_(values),
+      batch_values_(dynamic_cast<BatchIndexEvaluator1*>(values)),
+      delete_(del) {
   CHECK(values) << "null pointer";
   values->CheckIsRepeatable();
 }
@@ -776,7 +923,13 @@ class IntIntExprFunctionElement : public BaseIntExpr {
   int64 ElementValue(int index1, int index2) const {
     return values_->Run(index1, index2);
   }
+  static const int kSupportBatchSize = 256;
+
   void UpdateSupports() const;
+  // Evaluates the indices stored in indices_, updates the given min and max
+  // values and supports, and clears indices_.
+  void ScanIndices(int64* const min_value, int* const min_support,
+                   int64* const max_value, int* const max_support) const;
 
   IntVar* const expr1_;
   IntVar* const expr2_;
@@ -1073,8 +1226,12 @@ class IntExprArrayElementCt : public CastConstraint {
 
   const std::vector<IntVar*> vars_;
   IntVar* const index_;
+  // Indices of the variables supporting the min and the max of the target,
+  // -1 if the support must be recomputed, and the values they support.
   int min_support_;
   int max_support_;
+  int64 support_min_;
+  int64 support_max_;
 };
 
 IntExprArrayElementCt::IntExprArrayElementCt(Solver* const s,
@@ -1085,7 +1242,9 @@ IntExprArrayElementCt::IntExprArrayElementCt(Solver* const s,
       vars_(vars),
       index_(index),
       min_support_(-1),
-      max_support_(-1) {}
+      max_support_(-1),
+      support_min_(kint64max),
+      support_max_(kint64min) {}
 
 void IntExprArrayElementCt::Post() {
   Demon* const delayed_propagate_demon = MakeDelayedConstraintDemon0(
@@ -1099,7 +1258,7 @@ void IntExprArrayElementCt::Post() {
   index_->WhenRange(delayed_propagate_demon);
   Demon* const update_expr_demon = MakeConstraintDemon0(
       solver(), this, &IntExprArrayElementCt::UpdateExpr, "UpdateExpr");
-  index_->WhenRange(update_expr_demon);
+  index_->WhenDomain(update_expr_demon);
   Demon* const update_var_demon = MakeConstraintDemon0(
       solver(), this, &IntExprArrayElementCt::Propagate, "UpdateVar");
 
@@ -1132,37 +1291,56 @@ void IntExprArrayElementCt::Propagate() {
       vars_[nmin]->SetRange(vmin, vmax);
     }
   }
+  // The supports are only recomputed when they have been invalidated by
+  // Update() or UpdateExpr(), and each bound is recomputed separately.
   if (min_support_ == -1 || max_support_ == -1) {
-    int min_support = -1;
-    int max_support = -1;
-    int64 gmin = kint64max;
-    int64 gmax = kint64min;
-    for (int i = index_->Min(); i <= index_->Max(); ++i) {
-      const int64 vmin = vars_[i]->Min();
-      if (vmin < gmin) {
-        gmin = vmin;
+    const int64 imin = std::max(0LL, index_->Min());
+    const int64 imax = std::min(size() - 1LL, index_->Max());
+    int min_support = min_support_;
+    int max_support = max_support_;
+    int64 gmin = min_support == -1 ? kint64max : vars_[min_support]->Min();
+    int64 gmax = max_support == -1 ? kint64min : vars_[max_support]->Max();
+    for (int i = imin; i <= imax; ++i) {
+      if (!index_->Contains(i)) continue;
+      if (min_support_ == -1) {
+        const int64 vmin = vars_[i]->Min();
+        if (vmin < gmin) {
+          gmin = vmin;
+          min_support = i;
+        }
       }
-      const int64 vmax = vars_[i]->Max();
-      if (vmax > gmax) {
-        gmax = vmax;
+      if (max_support_ == -1) {
+        const int64 vmax = vars_[i]->Max();
+        if (vmax > gmax) {
+          gmax = vmax;
+          max_support = i;
+        }
       }
     }
     solver()->SaveAndSetValue(&min_support_, min_support);
     solver()->SaveAndSetValue(&max_support_, max_support);
+    solver()->SaveAndSetValue(&support_min_, gmin);
+    solver()->SaveAndSetValue(&support_max_, gmax);
     target_var_->SetRange(gmin, gmax);
   }
 }
 
+// A support is only invalidated if the bound it supports has moved: an
+// increase of the max of the min support, for instance, keeps it valid.
 void IntExprArrayElementCt::Update(int index) {
-  if (index == min_support_ || index == max_support_) {
+  if (index == min_support_ && vars_[index]->Min() != support_min_) {
     solver()->SaveAndSetValue(&min_support_, -1);
+  }
+  if (index == max_support_ && vars_[index]->Max() != support_max_) {
     solver()->SaveAndSetValue(&max_support_, -1);
   }
 }
 
 void IntExprArrayElementCt::UpdateExpr() {
-  if (!index_->Contains(min_support_) || !index_->Contains(max_support_)) {
+  if (min_support_ != -1 && !index_->Contains(min_support_)) {
     solver()->SaveAndSetValue(&min_support_, -1);
+  }
+  if (max_support_ != -1 && !index_->Contains(max_support_)) {
     solver()->SaveAndSetValue(&max_support_, -1);
   }
 }
@@ -1363,7 +1541,7 @@ Constraint* MakeElementEqualityFunc(Solver* const solver,
       return solver->MakeEquality(target, solver->MakeSum(index, vals[0]));
     } else {
       return solver->RevAlloc(
-          new IntElementConstraint(solver, vals, index, target));
+          new IntElementConstraint(solver, vals, nullptr, index, target));
     }
   }
 }
@@ -16,7 +16,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdlib>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/integral_types.h"
@@ -1990,6 +1992,147 @@ class BooleanScalProdLessConstant : public Constraint {
   Rev<int64> max_coefficient_;
 };
 
+// ----- ScalProdLessConstant -----
+
+// This constraint implements sum(vars[i] * coefs[i]) <= upper_bound for
+// integer variables and coefficients of any sign. The minimum of the scalar
+// product is maintained incrementally from the bound changes of the
+// variables, and the terms are tightened by a delayed demon, once per
+// propagation round. A term can only be tightened if its span, the product
+// of its coefficient by the width of its domain, is greater than the slack.
+// The terms are sorted by decreasing initial span, an upper bound of their
+// span, so that the scan stops at the first term that cannot be tightened.
+// The caller must ensure that the scalar product cannot overflow (see
+// ScalProdFitsInInt64()).
+class ScalProdLessConstant : public Constraint {
+ public:
+  ScalProdLessConstant(Solver* const s, const std::vector<IntVar*>& vars,
+                       const std::vector<int64>& coefs, int64 upper_bound)
+      : Constraint(s),
+        vars_(vars.size()),
+        coefs_(coefs.size()),
+        spans_(vars.size()),
+        upper_bound_(upper_bound),
+        sum_of_mins_(0),
+        push_demon_(nullptr) {
+    CHECK_EQ(vars.size(), coefs.size());
+    std::vector<std::pair<int64, int> > to_sort;
+    for (int i = 0; i < vars.size(); ++i) {
+      const int64 span =
+          std::abs(coefs[i]) * (vars[i]->Max() - vars[i]->Min());
+      to_sort.push_back(std::make_pair(-span, i));
+    }
+    std::sort(to_sort.begin(), to_sort.end());
+    for (int i = 0; i < to_sort.size(); ++i) {
+      const int index = to_sort[i].second;
+      vars_[i] = vars[index];
+      coefs_[i] = coefs[index];
+      spans_[i] = -to_sort[i].first;
+    }
+  }
+
+  virtual ~ScalProdLessConstant() {}
+
+  virtual void Post() {
+    for (int i = 0; i < vars_.size(); ++i) {
+      if (!vars_[i]->Bound()) {
+        Demon* const demon = MakeConstraintDemon1(
+            solver(), this, &ScalProdLessConstant::VarChanged, "VarChanged", i);
+        vars_[i]->WhenRange(demon);
+      }
+    }
+    push_demon_ = solver()->RegisterDemon(MakeDelayedConstraintDemon0(
+        solver(), this, &ScalProdLessConstant::Push, "Push"));
+  }
+
+  virtual void InitialPropagate() {
+    int64 sum_of_mins = 0;
+    for (int i = 0; i < vars_.size(); ++i) {
+      sum_of_mins += coefs_[i] > 0 ? coefs_[i] * vars_[i]->Min()
+                                   : coefs_[i] * vars_[i]->Max();
+    }
+    sum_of_mins_.SetValue(solver(), sum_of_mins);
+    Push();
+  }
+
+  void VarChanged(int term_index) {
+    IntVar* const var = vars_[term_index];
+    const int64 coef = coefs_[term_index];
+    // Only the minimum of the terms matters, the reduction of their maximum
+    // comes from Push().
+    const int64 delta = coef > 0 ? coef * (var->Min() - var->OldMin())
+                                 : coef * (var->Max() - var->OldMax());
+    if (delta != 0) {
+      sum_of_mins_.Add(solver(), delta);
+      if (sum_of_mins_.Value() > upper_bound_) {
+        solver()->Fail();
+      }
+      EnqueueDelayedDemon(push_demon_);
+    }
+  }
+
+  void Push() {
+    const int64 slack = CapSub(upper_bound_, sum_of_mins_.Value());
+    if (slack < 0) {
+      solver()->Fail();
+    }
+    for (int i = 0; i < vars_.size() && spans_[i] > slack; ++i) {
+      IntVar* const var = vars_[i];
+      const int64 coef = coefs_[i];
+      if (coef > 0) {
+        var->SetMax(var->Min() + slack / coef);
+      } else {
+        var->SetMin(var->Max() - slack / -coef);
+      }
+    }
+  }
+
+  virtual std::string DebugString() const {
+    return StringPrintf("ScalProd([%s], [%s]) <= %" GG_LL_FORMAT "d)",
+                        JoinDebugStringPtr(vars_, ", ").c_str(),
+                        strings::Join(coefs_, ", ").c_str(), upper_bound_);
+  }
+
+  void Accept(ModelVisitor* const visitor) const {
+    visitor->BeginVisitConstraint(ModelVisitor::kScalProdLessOrEqual, this);
+    visitor->VisitIntegerVariableArrayArgument(ModelVisitor::kVarsArgument,
+                                               vars_);
+    visitor->VisitIntegerArrayArgument(ModelVisitor::kCoefficientsArgument,
+                                       coefs_);
+    visitor->VisitIntegerArgument(ModelVisitor::kValueArgument, upper_bound_);
+    visitor->EndVisitConstraint(ModelVisitor::kScalProdLessOrEqual, this);
+  }
+
+ private:
+  std::vector<IntVar*> vars_;
+  std::vector<int64> coefs_;
+  // spans_[i] is the span of term i when the constraint was created.
+  std::vector<int64> spans_;
+  const int64 upper_bound_;
+  NumericalRev<int64> sum_of_mins_;
+  Demon* push_demon_;
+};
+
+// Returns true if no partial sum of the scalar product, nor the span of any
+// of its terms, can overflow an int64.
+bool ScalProdFitsInInt64(const std::vector<IntVar*>& vars,
+                         const std::vector<int64>& coefs) {
+  int64 bound = 0;
+  for (int i = 0; i < vars.size(); ++i) {
+    if (coefs[i] == kint64min || vars[i]->Min() == kint64min) {
+      return false;
+    }
+    const int64 abs_value =
+        std::max(std::abs(vars[i]->Min()), std::abs(vars[i]->Max()));
+    bound = CapAdd(bound, CapProd(std::abs(coefs[i]), abs_value));
+  }
+  return bound < kint64max / 2;
+}
+
+// Large scalar products are propagated by ScalProdLessConstant rather than
+// by the generic decomposition into product variables and a sum.
+const int kMinScalProdLessConstantSize = 3;
+
 // ----- PositiveBooleanScalProdEqVar -----
 
 class PositiveBooleanScalProdEqVar : public CastConstraint {
@@ -2867,6 +3010,16 @@ Constraint* MakeScalProdGreaterOrEqualFct(Solver* solver,
     }
     return solver->MakeSumGreaterOrEqual(terms, 1);
   }
+  if (size >= kMinScalProdLessConstantSize && cst != kint64min &&
+      ScalProdFitsInInt64(vars, coefs)) {
+    // sum(vars[i] * coefs[i]) >= cst <=> sum(vars[i] * -coefs[i]) <= -cst.
+    std::vector<int64> opposite_coefs(size);
+    for (int i = 0; i < size; ++i) {
+      opposite_coefs[i] = -coefs[i];
+    }
+    return solver->RevAlloc(
+        new ScalProdLessConstant(solver, vars, opposite_coefs, -cst));
+  }
   std::vector<IntVar*> terms;
   for (int i = 0; i < size; ++i) {
     terms.push_back(solver->MakeProd(vars[i], coefs[i])->Var());
@@ -2918,6 +3071,22 @@ Constraint* MakeScalProdLessOrEqualFct(Solver* solver,
       negatives++;
     }
   }
+  if (positives + negatives >= kMinScalProdLessConstantSize &&
+      ScalProdFitsInInt64(vars, coefs)) {
+    std::vector<IntVar*> terms;
+    std::vector<int64> term_coefs;
+    int64 rhs = upper_bound;
+    for (int i = 0; i < size; ++i) {
+      if (coefs[i] == 0 || vars[i]->Bound()) {
+        rhs = CapSub(rhs, coefs[i] * vars[i]->Min());
+      } else {
+        terms.push_back(vars[i]);
+        term_coefs.push_back(coefs[i]);
+      }
+    }
+    return solver->RevAlloc(
+        new ScalProdLessConstant(solver, terms, term_coefs, rhs));
+  }
   if (positives > 0 && negatives > 0) {
     std::vector<IntVar*> pos_terms;
     std::vector<IntVar*> neg_terms;
@@ -201,23 +201,40 @@ namespace {
 class DomainIntVar : public IntVar {
  public:
   // Utility classes
+
+  // Iterates in increasing order over the values of a BitSet in [min, max].
   class BitSetIterator : public BaseObject {
    public:
-    BitSetIterator(uint64* const bitset, int64 omin)
+    BitSetIterator() {}
+    virtual ~BitSetIterator() {}
+
+    virtual void Init(int64 min, int64 max) = 0;
+    virtual bool Ok() const = 0;
+    virtual int64 Value() const = 0;
+    virtual void Next() = 0;
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(BitSetIterator);
+  };
+
+  // BitSetIterator over an array of 64 bit words.
+  class BitArrayIterator : public BitSetIterator {
+   public:
+    BitArrayIterator(uint64* const bitset, int64 omin)
         : bitset_(bitset), omin_(omin), max_(kint64min), current_(kint64max) {}
 
-    virtual ~BitSetIterator() {}
+    virtual ~BitArrayIterator() {}
 
-    void Init(int64 min, int64 max) {
+    virtual void Init(int64 min, int64 max) {
       max_ = max;
       current_ = min;
     }
 
-    bool Ok() const { return current_ <= max_; }
+    virtual bool Ok() const { return current_ <= max_; }
 
-    int64 Value() const { return current_; }
+    virtual int64 Value() const { return current_; }
 
-    void Next() {
+    virtual void Next() {
       if (++current_ <= max_) {
         current_ = UnsafeLeastSignificantBitPosition64(
                        bitset_, current_ - omin_, max_ - omin_) +
@@ -225,7 +242,7 @@ class DomainIntVar : public IntVar {
       }
     }
 
-    virtual std::string DebugString() const { return "BitSetIterator"; }
+    virtual std::string DebugString() const { return "BitArrayIterator"; }
 
    private:
     uint64* const bitset_;
@@ -282,9 +299,13 @@ class DomainIntVar : public IntVar {
     explicit QueueHandler(DomainIntVar* const var) : var_(var) {}
     virtual ~QueueHandler() {}
     virtual void Run(Solver* const s) {
-      s->GetPropagationMonitor()->StartProcessingIntegerVariable(var_);
-      var_->Process();
-      s->GetPropagationMonitor()->EndProcessingIntegerVariable(var_);
+      if (s->HasPropagationMonitors()) {
+        s->GetPropagationMonitor()->StartProcessingIntegerVariable(var_);
+        var_->Process();
+        s->GetPropagationMonitor()->EndProcessingIntegerVariable(var_);
+      } else {
+        var_->Process();
+      }
     }
     virtual Solver::DemonPriority priority() const {
       return Solver::VAR_PRIORITY;
@@ -1357,6 +1378,7 @@ class DomainIntVar : public IntVar {
   }
   virtual void RemoveValue(int64 v);
   virtual void RemoveInterval(int64 l, int64 u);
+  virtual void RemoveValues(const std::vector<int64>& values);
   void CreateBits();
   virtual void WhenBound(Demon* d) {
     if (min_.Value() != max_.Value()) {
@@ -1806,7 +1828,7 @@ class SimpleBitSet : public DomainIntVar::BitSet {
   }
 
   virtual DomainIntVar::BitSetIterator* MakeIterator() {
-    return new DomainIntVar::BitSetIterator(bits_, omin_);
+    return new DomainIntVar::BitArrayIterator(bits_, omin_);
   }
 
  private:
@@ -2021,7 +2043,7 @@ class SmallBitSet : public DomainIntVar::BitSet {
   }
 
   virtual DomainIntVar::BitSetIterator* MakeIterator() {
-    return new DomainIntVar::BitSetIterator(&bits_, omin_);
+    return new DomainIntVar::BitArrayIterator(&bits_, omin_);
   }
 
  private:
@@ -2033,6 +2055,249 @@ class SmallBitSet : public DomainIntVar::BitSet {
   std::vector<int64> removed_;
 };
 
+// A domain given by a list of values uses a SparseBitSet when its range is
+// more than kSparseDomainRatio times its number of values.
+const int64 kSparseDomainRatio = 64;
+
+// This is used for large domains with few values, where a bitset would be
+// proportional to the initial range. The values are stored in a sparse set:
+// the values in the domain are the first size_ elements of values_, and
+// positions_ gives the position of each value in values_. A removal swaps the
+// value with the last one in the domain and decrements size_. As the swaps
+// are only done within the first size_ elements, the removed values are
+// restored on backtrack by restoring size_ alone.
+//
+// Contrary to the bitsets, the values outside the bounds of the variable are
+// actually removed, so that the set never contains more than the domain.
+class SparseBitSet : public DomainIntVar::BitSet {
+ public:
+  SparseBitSet(Solver* const s, const std::vector<int64>& sorted_values)
+      : BitSet(s), values_(sorted_values), size_(sorted_values.size()) {
+    for (int i = 0; i < values_.size(); ++i) {
+      positions_[values_[i]] = i;
+    }
+  }
+
+  virtual ~SparseBitSet() {}
+
+  // The new bounds are found either by probing the values one by one or by
+  // scanning the set, whichever is shorter.
+  virtual int64 ComputeNewMin(int64 nmin, int64 cmin, int64 cmax) {
+    DCHECK_GE(nmin, cmin);
+    DCHECK_LE(nmin, cmax);
+    int size = size_.Value();
+    if (ClosedIntervalNoLargerThan(cmin, nmin, size)) {
+      for (int64 v = cmin; v < nmin; ++v) {
+        RemoveIfPresent(v, &size);
+      }
+    } else {
+      for (int i = 0; i < size;) {
+        if (values_[i] < nmin) {
+          RemoveAt(i, &size);
+        } else {
+          ++i;
+        }
+      }
+    }
+    size_.SetValue(solver_, size);
+    return FindClosestValue(nmin, cmax, 1);
+  }
+
+  virtual int64 ComputeNewMax(int64 nmax, int64 cmin, int64 cmax) {
+    DCHECK_GE(nmax, cmin);
+    DCHECK_LE(nmax, cmax);
+    int size = size_.Value();
+    if (ClosedIntervalNoLargerThan(nmax, cmax, size)) {
+      for (int64 v = cmax; v > nmax; --v) {
+        RemoveIfPresent(v, &size);
+      }
+    } else {
+      for (int i = 0; i < size;) {
+        if (values_[i] > nmax) {
+          RemoveAt(i, &size);
+        } else {
+          ++i;
+        }
+      }
+    }
+    size_.SetValue(solver_, size);
+    return FindClosestValue(nmax, cmin, -1);
+  }
+
+  virtual bool SetValue(int64 val) {
+    const int pos = Position(val);
+    if (pos == -1) {
+      return false;
+    }
+    Swap(0, pos);
+    size_.SetValue(solver_, 1);
+    return true;
+  }
+
+  virtual bool Contains(int64 val) const { return Position(val) != -1; }
+
+  virtual bool RemoveValue(int64 val) {
+    const int pos = Position(val);
+    if (pos == -1) {
+      return false;
+    }
+    int size = size_.Value();
+    RemoveAt(pos, &size);
+    size_.SetValue(solver_, size);
+    // Holes.
+    InitHoles();
+    AddHole(val);
+    return true;
+  }
+
+  virtual uint64 Size() const { return size_.Value(); }
+
+  virtual std::string DebugString() const {
+    return StringPrintf("SparseBitSet(size = %d)", size_.Value());
+  }
+
+  virtual void DelayRemoveValue(int64 val) { removed_.push_back(val); }
+
+  virtual void ApplyRemovedValues(DomainIntVar* var) {
+    std::sort(removed_.begin(), removed_.end());
+    for (std::vector<int64>::iterator it = removed_.begin(); it != removed_.end();
+         ++it) {
+      var->RemoveValue(*it);
+    }
+  }
+
+  virtual void ClearRemovedValues() { removed_.clear(); }
+
+  virtual std::string pretty_DebugString(int64 min, int64 max) const {
+    std::vector<int64> values;
+    SortedValues(min, max, &values);
+    std::string out;
+    int start = 0;
+    while (start < values.size()) {
+      int end = start + 1;
+      while (end < values.size() && values[end] == values[end - 1] + 1) {
+        ++end;
+      }
+      if (!out.empty()) {
+        out += " ";
+      }
+      if (end - start > 2) {
+        StringAppendF(&out, "%" GG_LL_FORMAT "d..%" GG_LL_FORMAT "d",
+                      values[start], values[end - 1]);
+      } else if (end - start == 2) {
+        StringAppendF(&out, "%" GG_LL_FORMAT "d %" GG_LL_FORMAT "d",
+                      values[start], values[start + 1]);
+      } else {
+        StringAppendF(&out, "%" GG_LL_FORMAT "d", values[start]);
+      }
+      start = end;
+    }
+    return out;
+  }
+
+  virtual DomainIntVar::BitSetIterator* MakeIterator() {
+    return new Iterator(this);
+  }
+
+ private:
+  // Iterates over a sorted copy of the values, so that the values are
+  // returned in increasing order as with the other bitsets.
+  class Iterator : public DomainIntVar::BitSetIterator {
+   public:
+    explicit Iterator(const SparseBitSet* const bitset)
+        : bitset_(bitset), index_(0) {}
+    virtual ~Iterator() {}
+
+    virtual void Init(int64 min, int64 max) {
+      bitset_->SortedValues(min, max, &values_);
+      index_ = 0;
+    }
+
+    virtual bool Ok() const { return index_ < values_.size(); }
+
+    virtual int64 Value() const { return values_[index_]; }
+
+    virtual void Next() { ++index_; }
+
+    virtual std::string DebugString() const { return "SparseBitSetIterator"; }
+
+   private:
+    const SparseBitSet* const bitset_;
+    std::vector<int64> values_;
+    int index_;
+  };
+
+  // Returns the position of the value in values_, or -1 if it is not in the
+  // set.
+  int Position(int64 val) const {
+    const int pos = FindWithDefault(positions_, val, -1);
+    return pos < size_.Value() ? pos : -1;
+  }
+
+  void Swap(int i, int j) {
+    const int64 value_i = values_[i];
+    const int64 value_j = values_[j];
+    values_[i] = value_j;
+    values_[j] = value_i;
+    positions_[value_j] = i;
+    positions_[value_i] = j;
+  }
+
+  // Removes the value at position pos from the first *size values.
+  void RemoveAt(int pos, int* size) {
+    DCHECK_LT(pos, *size);
+    Swap(pos, *size - 1);
+    --(*size);
+  }
+
+  void RemoveIfPresent(int64 val, int* size) {
+    const int pos = FindWithDefault(positions_, val, -1);
+    if (pos != -1 && pos < *size) {
+      RemoveAt(pos, size);
+    }
+  }
+
+  // Returns the value of the set closest to 'start' in the given direction,
+  // knowing that 'limit' is in the set.
+  int64 FindClosestValue(int64 start, int64 limit, int direction) const {
+    const int size = size_.Value();
+    const int64 low = std::min(start, limit);
+    const int64 high = std::max(start, limit);
+    if (ClosedIntervalNoLargerThan(low, high, size)) {
+      for (int64 v = start; v != limit; v += direction) {
+        if (Contains(v)) {
+          return v;
+        }
+      }
+      return limit;
+    }
+    int64 best = limit;
+    for (int i = 0; i < size; ++i) {
+      const int64 v = values_[i];
+      if (direction > 0 ? (v >= start && v < best) : (v <= start && v > best)) {
+        best = v;
+      }
+    }
+    return best;
+  }
+
+  void SortedValues(int64 min, int64 max, std::vector<int64>* values) const {
+    values->clear();
+    const int size = size_.Value();
+    for (int i = 0; i < size; ++i) {
+      if (values_[i] >= min && values_[i] <= max) {
+        values->push_back(values_[i]);
+      }
+    }
+    std::sort(values->begin(), values->end());
+  }
+
+  std::vector<int64> values_;
+  hash_map<int64, int> positions_;
+  NumericalRev<int> size_;
+  std::vector<int64> removed_;
+};
+
 class EmptyIterator : public IntVarIterator {
  public:
   virtual ~EmptyIterator() {}
@@ -2252,6 +2517,9 @@ DomainIntVar::DomainIntVar(Solver* const s, const std::vector<int64>& sorted_val
     if (vmax - vmin + 1 < 65) {
       bits_ = solver()->RevAlloc(
           new SmallBitSet(solver(), sorted_values, vmin, vmax));
+    } else if (!ClosedIntervalNoLargerThan(
+                   vmin, vmax, kSparseDomainRatio * sorted_values.size())) {
+      bits_ = solver()->RevAlloc(new SparseBitSet(solver(), sorted_values));
     } else {
       bits_ = solver()->RevAlloc(
           new SimpleBitSet(solver(), sorted_values, vmin, vmax));
@@ -2400,10 +2668,58 @@ void DomainIntVar::RemoveInterval(int64 l, int64 u) {
     SetMin(u + 1);
   } else if (u >= max_.Value()) {
     SetMax(l - 1);
-  } else {
+  } else if (in_process_) {
     for (int64 v = l; v <= u; ++v) {
       RemoveValue(v);
     }
+  } else {
+    if (bits_ == nullptr) {
+      CreateBits();
+    }
+    bool removed = false;
+    for (int64 v = l; v <= u; ++v) {
+      removed |= bits_->RemoveValue(v);
+    }
+    if (removed) {
+      Push();
+    }
+  }
+}
+
+// The values strictly inside the domain are removed from the bitset first,
+// with a single Push() for all of them; the bounds are then moved once, as
+// ComputeNewMin() and ComputeNewMax() skip the values already removed.
+void DomainIntVar::RemoveValues(const std::vector<int64>& values) {
+  if (in_process_ || values.size() <= 1) {
+    IntVar::RemoveValues(values);
+    return;
+  }
+  const int64 old_min = min_.Value();
+  const int64 old_max = max_.Value();
+  bool remove_min = false;
+  bool remove_max = false;
+  bool removed = false;
+  for (const int64 v : values) {
+    if (v < old_min || v > old_max) continue;
+    if (v == old_min) {
+      remove_min = true;
+    } else if (v == old_max) {
+      remove_max = true;
+    } else {
+      if (bits_ == nullptr) {
+        CreateBits();
+      }
+      removed |= bits_->RemoveValue(v);
+    }
+  }
+  if (removed) {
+    Push();
+  }
+  if (remove_min) {
+    SetMin(old_min + 1);
+  }
+  if (remove_max) {
+    SetMax(old_max - 1);
   }
 }
 
@@ -2516,9 +2832,13 @@ class ConcreteBooleanVar : public BooleanVar {
     explicit Handler(ConcreteBooleanVar* const var) : Demon(), var_(var) {}
     virtual ~Handler() {}
     virtual void Run(Solver* const s) {
-      s->GetPropagationMonitor()->StartProcessingIntegerVariable(var_);
-      var_->Process();
-      s->GetPropagationMonitor()->EndProcessingIntegerVariable(var_);
+      if (s->HasPropagationMonitors()) {
+        s->GetPropagationMonitor()->StartProcessingIntegerVariable(var_);
+        var_->Process();
+        s->GetPropagationMonitor()->EndProcessingIntegerVariable(var_);
+      } else {
+        var_->Process();
+      }
     }
     virtual Solver::DemonPriority priority() const {
       return Solver::VAR_PRIORITY;
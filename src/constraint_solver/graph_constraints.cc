@@ -80,6 +80,8 @@ class NoCycle : public Constraint {
   std::vector<int64> starts_;
   std::vector<int64> ends_;
   bool all_nexts_bound_;
+  // All nexts before this index are bound.
+  int first_unbound_next_;
   std::vector<int64> outbound_supports_;
   std::vector<int64> support_leaves_;
   std::vector<int64> unsupported_;
@@ -100,6 +102,7 @@ NoCycle::NoCycle(Solver* const s, const std::vector<IntVar*>& nexts,
       starts_(nexts.size()),
       ends_(nexts.size()),
       all_nexts_bound_(false),
+      first_unbound_next_(0),
       outbound_supports_(nexts.size(), -1),
       sink_handler_(sink_handler),
       owner_(owner),
@@ -130,14 +133,16 @@ void NoCycle::InitialPropagate() {
       }
     }
   }
-  solver()->SaveAndSetValue(&all_nexts_bound_, true);
+  int first_unbound_next = size();
   for (int i = 0; i < size(); ++i) {
     if (nexts_[i]->Bound()) {
       NextBound(i);
     } else {
-      solver()->SaveAndSetValue(&all_nexts_bound_, false);
+      first_unbound_next = std::min(first_unbound_next, i);
     }
   }
+  solver()->SaveAndSetValue(&first_unbound_next_, first_unbound_next);
+  solver()->SaveAndSetValue(&all_nexts_bound_, first_unbound_next == size());
   ComputeSupports();
 }
 
@@ -174,14 +179,15 @@ void NoCycle::NextChange(int index) {
     NextBound(index);
   }
   if (!all_nexts_bound_) {
-    bool all_nexts_bound = true;
-    for (int i = 0; i < size(); ++i) {
-      if (!nexts_[i]->Bound()) {
-        all_nexts_bound = false;
-        break;
-      }
+    // The scan resumes where it stopped last time, so its total cost is linear
+    // along a branch of the search.
+    int first_unbound_next = first_unbound_next_;
+    while (first_unbound_next < size() &&
+           nexts_[first_unbound_next]->Bound()) {
+      ++first_unbound_next;
     }
-    solver()->SaveAndSetValue(&all_nexts_bound_, all_nexts_bound);
+    solver()->SaveAndSetValue(&first_unbound_next_, first_unbound_next);
+    solver()->SaveAndSetValue(&all_nexts_bound_, first_unbound_next == size());
   }
   if (all_nexts_bound_) {
     return;
@@ -663,6 +669,10 @@ class BasePathCumul : public Constraint {
   virtual std::string DebugString() const;
 
  protected:
+  // Returns the first value j of nexts_[index], other than 'old_support',
+  // such that AcceptLink(index, j), or -1 if there is none.
+  virtual int FindSupport(int index, int old_support) const;
+
   int64 size() const { return nexts_.size(); }
   int cumul_size() const { return cumuls_.size(); }
 
@@ -747,17 +757,60 @@ void BasePathCumul::CumulRange(int index) {
 void BasePathCumul::UpdateSupport(int index) {
   int support = supports_[index];
   if (support < 0 || !AcceptLink(index, support)) {
-    IntVar* var = nexts_[index];
-    for (int i = var->Min(); i <= var->Max(); ++i) {
-      if (i != support && AcceptLink(index, i)) {
-        supports_[index] = i;
-        return;
-      }
+    const int new_support = FindSupport(index, support);
+    if (new_support >= 0) {
+      supports_[index] = new_support;
+      return;
     }
     active_[index]->SetMax(0);
   }
 }
 
+int BasePathCumul::FindSupport(int index, int old_support) const {
+  IntVar* const var = nexts_[index];
+  for (int i = var->Min(); i <= var->Max(); ++i) {
+    if (i != old_support && AcceptLink(index, i)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Same as BasePathCumul::FindSupport(), but the transits are computed by
+// batches with 'evaluator'. The PathCumulType class must define
+// AcceptTransit(i, j, transit), which is AcceptLink(i, j) for the given
+// value of the transit from i to j.
+template <class PathCumulType>
+int FindSupportWithBatchEvaluator(const PathCumulType* const path_cumul,
+                                  BatchIndexEvaluator2* const evaluator,
+                                  IntVar* const next, int index,
+                                  int old_support,
+                                  std::vector<int64>* const candidates,
+                                  std::vector<int64>* const transits) {
+  const int kBatchSize = 64;
+  const int64 max_candidate = next->Max();
+  int64 candidate = next->Min();
+  while (candidate <= max_candidate) {
+    candidates->clear();
+    for (; candidate <= max_candidate && candidates->size() < kBatchSize;
+         ++candidate) {
+      if (candidate != old_support) {
+        candidates->push_back(candidate);
+      }
+    }
+    transits->resize(candidates->size());
+    evaluator->RunBatch(index, candidates->data(), candidates->size(),
+                        transits->data());
+    for (int i = 0; i < candidates->size(); ++i) {
+      if (path_cumul->AcceptTransit(index, (*candidates)[i],
+                                    (*transits)[i])) {
+        return (*candidates)[i];
+      }
+    }
+  }
+  return -1;
+}
+
 std::string BasePathCumul::DebugString() const {
   std::string out = "PathCumul(";
   for (int i = 0; i < size(); ++i) {
@@ -1142,6 +1195,7 @@ class ResultCallback2PathCumul : public BasePathCumul {
   virtual ~ResultCallback2PathCumul() {}
   virtual void NextBound(int index);
   virtual bool AcceptLink(int i, int j) const;
+  bool AcceptTransit(int i, int j, int64 transit) const;
 
   void Accept(ModelVisitor* const visitor) const {
     visitor->BeginVisitConstraint(ModelVisitor::kPathCumul, this);
@@ -1158,8 +1212,22 @@ class ResultCallback2PathCumul : public BasePathCumul {
     visitor->EndVisitConstraint(ModelVisitor::kPathCumul, this);
   }
 
+ protected:
+  virtual int FindSupport(int index, int old_support) const {
+    if (batch_evaluator_ == nullptr) {
+      return BasePathCumul::FindSupport(index, old_support);
+    }
+    return FindSupportWithBatchEvaluator(this, batch_evaluator_, nexts_[index],
+                                         index, old_support, &candidates_,
+                                         &transits_);
+  }
+
  private:
   std::unique_ptr<Solver::IndexEvaluator2> transits_evaluator_;
+  // Same object as transits_evaluator_ if it supports batch evaluation.
+  BatchIndexEvaluator2* const batch_evaluator_;
+  mutable std::vector<int64> candidates_;
+  mutable std::vector<int64> transits_;
 };
 
 ResultCallback2PathCumul::ResultCallback2PathCumul(
@@ -1167,7 +1235,9 @@ ResultCallback2PathCumul::ResultCallback2PathCumul(
     const std::vector<IntVar*>& active, const std::vector<IntVar*>& cumuls,
     Solver::IndexEvaluator2* transit_evaluator)
     : BasePathCumul(s, nexts, active, cumuls),
-      transits_evaluator_(transit_evaluator) {
+      transits_evaluator_(transit_evaluator),
+      batch_evaluator_(
+          dynamic_cast<BatchIndexEvaluator2*>(transit_evaluator)) {
   transits_evaluator_->CheckIsRepeatable();
 }
 
@@ -1187,9 +1257,13 @@ void ResultCallback2PathCumul::NextBound(int index) {
 }
 
 bool ResultCallback2PathCumul::AcceptLink(int i, int j) const {
+  return AcceptTransit(i, j, transits_evaluator_->Run(i, j));
+}
+
+bool ResultCallback2PathCumul::AcceptTransit(int i, int j,
+                                             int64 transit) const {
   const IntVar* const cumul_i = cumuls_[i];
   const IntVar* const cumul_j = cumuls_[j];
-  const int64 transit = transits_evaluator_->Run(i, j);
   return transit <= CapSub(cumul_j->Max(), cumul_i->Min()) &&
          CapSub(cumul_j->Min(), cumul_i->Max()) <= transit;
 }
@@ -1207,6 +1281,7 @@ class ResultCallback2SlackPathCumul : public BasePathCumul {
   virtual void Post();
   virtual void NextBound(int index);
   virtual bool AcceptLink(int i, int j) const;
+  bool AcceptTransit(int i, int j, int64 transit) const;
   void SlackRange(int index);
 
   void Accept(ModelVisitor* const visitor) const {
@@ -1224,9 +1299,23 @@ class ResultCallback2SlackPathCumul : public BasePathCumul {
     visitor->EndVisitConstraint(ModelVisitor::kPathCumul, this);
   }
 
+ protected:
+  virtual int FindSupport(int index, int old_support) const {
+    if (batch_evaluator_ == nullptr) {
+      return BasePathCumul::FindSupport(index, old_support);
+    }
+    return FindSupportWithBatchEvaluator(this, batch_evaluator_, nexts_[index],
+                                         index, old_support, &candidates_,
+                                         &transits_);
+  }
+
  private:
   const std::vector<IntVar*> slacks_;
   std::unique_ptr<Solver::IndexEvaluator2> transits_evaluator_;
+  // Same object as transits_evaluator_ if it supports batch evaluation.
+  BatchIndexEvaluator2* const batch_evaluator_;
+  mutable std::vector<int64> candidates_;
+  mutable std::vector<int64> transits_;
 };
 
 ResultCallback2SlackPathCumul::ResultCallback2SlackPathCumul(
@@ -1235,7 +1324,9 @@ ResultCallback2SlackPathCumul::ResultCallback2SlackPathCumul(
     const std::vector<IntVar*>& slacks, Solver::IndexEvaluator2* transit_evaluator)
     : BasePathCumul(s, nexts, active, cumuls),
       slacks_(slacks),
-      transits_evaluator_(transit_evaluator) {
+      transits_evaluator_(transit_evaluator),
+      batch_evaluator_(
+          dynamic_cast<BatchIndexEvaluator2*>(transit_evaluator)) {
   transits_evaluator_->CheckIsRepeatable();
 }
 
@@ -1287,10 +1378,14 @@ void ResultCallback2SlackPathCumul::NextBound(int index) {
 }
 
 bool ResultCallback2SlackPathCumul::AcceptLink(int i, int j) const {
+  return AcceptTransit(i, j, transits_evaluator_->Run(i, j));
+}
+
+bool ResultCallback2SlackPathCumul::AcceptTransit(int i, int j,
+                                                  int64 transit) const {
   const IntVar* const cumul_i = cumuls_[i];
   const IntVar* const cumul_j = cumuls_[j];
   const IntVar* const slack = slacks_[i];
-  const int64 transit = transits_evaluator_->Run(i, j);
   return CapAdd(transit, slack->Min()) <=
              CapSub(cumul_j->Max(), cumul_i->Min()) &&
          CapSub(cumul_j->Min(), cumul_i->Max()) <=
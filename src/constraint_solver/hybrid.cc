@@ -31,11 +31,16 @@ DEFINE_int32(simplex_cleanup_frequency, 0,
              "frequency to cleanup the simplex after each call, 0: no cleanup");
 DEFINE_bool(verbose_simplex_call, false,
             "Do not suppress output of the simplex");
+DEFINE_bool(simplex_reduced_cost_fixing, true,
+            "Use the reduced costs of the linear relaxation to tighten the"
+            " domains of the variables in MakeSimplexConstraint()");
 
 namespace operations_research {
 namespace {
 inline MPSolver::OptimizationProblemType LpSolverForCp() {
-  #if defined(USE_GUROBI)
+  #if defined(USE_GLOP)
+  return MPSolver::GLOP_LINEAR_PROGRAMMING;
+  #elif defined(USE_GUROBI)
   return MPSolver::GUROBI_LINEAR_PROGRAMMING;
   #elif defined(USE_CLP)
   return MPSolver::CLP_LINEAR_PROGRAMMING;
@@ -524,7 +529,15 @@ class AutomaticLinearization : public SearchMonitor {
         counter_(0),
         simplex_frequency_(frequency),
         objective_(nullptr),
-        maximize_(false) {}
+        maximize_(false) {
+    if (!FLAGS_verbose_simplex_call) {
+      mp_solver_.SuppressOutput();
+    }
+    // The model is built once per search, and only the variable bounds change
+    // from one node to the next: let the LP solver reuse its previous basis.
+    mp_parameters_.SetIntegerParam(MPSolverParameters::INCREMENTALITY,
+                                   MPSolverParameters::INCREMENTALITY_ON);
+  }
 
   virtual ~AutomaticLinearization() {}
 
@@ -550,17 +563,21 @@ class AutomaticLinearization : public SearchMonitor {
   void BuildModel() {
     Linearizer linearizer(&mp_solver_, &translation_, &objective_, &maximize_);
     solver()->Accept(&linearizer);
+    // Iterating on a vector is faster, and deterministic.
+    variables_.assign(translation_.begin(), translation_.end());
   }
 
+  // Only the bounds that changed since the last call are actually sent to the
+  // underlying LP solver (see MPVariable::SetBounds()).
   void AssignVariables() {
-    for (const auto& it : translation_) {
+    for (const auto& it : variables_) {
       it.second->SetBounds(it.first->Min(), it.first->Max());
     }
   }
 
   void SolveProblem() {
     if (objective_ != nullptr) {
-      switch (mp_solver_.Solve()) {
+      switch (mp_solver_.Solve(mp_parameters_)) {
         case MPSolver::OPTIMAL: {
           const double obj_value = mp_solver_.Objective().Value();
           if (maximize_) {
@@ -570,6 +587,9 @@ class AutomaticLinearization : public SearchMonitor {
             const int64 int_obj_value = static_cast<int64>(floor(obj_value));
             objective_->SetMin(int_obj_value);
           }
+          if (FLAGS_simplex_reduced_cost_fixing) {
+            FixVariablesWithReducedCosts(obj_value);
+          }
           break;
         }
         case MPSolver::FEASIBLE:
@@ -590,13 +610,59 @@ class AutomaticLinearization : public SearchMonitor {
     }
   }
 
+  // Reduced cost fixing: if a variable is nonbasic at one of its bounds with a
+  // reduced cost r (in the direction of the optimization), moving it by d units
+  // away from this bound degrades the LP objective by at least r * d. So, d can
+  // not exceed gap / r, where gap is the distance between the LP objective and
+  // the worst objective value still allowed in the CP model.
+  void FixVariablesWithReducedCosts(double obj_value) {
+    const double gap = maximize_ ? obj_value - objective_->Min()
+                                 : objective_->Max() - obj_value;
+    // Above this gap, no variable with a reasonable reduced cost can be fixed,
+    // and the gap may suffer from the imprecision of the large bounds.
+    const double kMaxGap = 1e12;
+    // Tolerance on the reduced costs and on the rounding of gap / r.
+    const double kTolerance = 1e-6;
+    if (gap < 0.0 || gap > kMaxGap) return;
+    for (const auto& it : variables_) {
+      const MPVariable* const mp_var = it.second;
+      const double reduced_cost =
+          maximize_ ? -mp_var->reduced_cost() : mp_var->reduced_cost();
+      IntExpr* const expr = const_cast<IntExpr*>(it.first);
+      switch (mp_var->basis_status()) {
+        case MPSolver::AT_LOWER_BOUND:
+          if (reduced_cost > kTolerance) {
+            const double new_max =
+                mp_var->lb() + floor(gap / reduced_cost + kTolerance);
+            if (new_max < expr->Max()) {
+              expr->SetMax(static_cast<int64>(new_max));
+            }
+          }
+          break;
+        case MPSolver::AT_UPPER_BOUND:
+          if (reduced_cost < -kTolerance) {
+            const double new_min =
+                mp_var->ub() - floor(gap / -reduced_cost + kTolerance);
+            if (new_min > expr->Min()) {
+              expr->SetMin(static_cast<int64>(new_min));
+            }
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
   virtual std::string DebugString() const { return "AutomaticLinearization"; }
 
  private:
   MPSolver mp_solver_;
+  MPSolverParameters mp_parameters_;
   int64 counter_;
   const int simplex_frequency_;
   ExprTranslation translation_;
+  std::vector<std::pair<const IntExpr*, MPVariable*>> variables_;
   IntVar* objective_;
   bool maximize_;
 };
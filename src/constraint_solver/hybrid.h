@@ -32,7 +32,11 @@ SearchMonitor* MakeSimplexConnection(Solver* const solver,
 // of the problem. Every 'simplex_frequency' nodes explored in the
 // search tree, this linear relaxation will be called and the
 // resulting optimal solution found by the simplex will be used to
-// prune the objective of the constraint programming model.
+// prune the objective of the constraint programming model, and its reduced
+// costs to prune the domains of the variables (see
+// --simplex_reduced_cost_fixing). The linear relaxation is built once per
+// search: at each call, only the changed variable bounds are sent to the
+// simplex, which restarts from its previous basis.
 SearchMonitor* MakeSimplexConstraint(Solver* const solver,
                                      int simplex_frequency);
 }  // namespace operations_research
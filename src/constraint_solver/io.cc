@@ -21,11 +21,13 @@
 #include <vector>
 
 #include "base/callback.h"
+#include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/map_util.h"
 #include "base/stl_util.h"
 #include "base/hash.h"
+#include "base/threadpool.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "constraint_solver/model.pb.h"
@@ -33,6 +35,10 @@
 #include "util/tuple_set.h"
 #include "util/vector_map.h"
 
+DEFINE_int32(cp_load_model_threads, 4,
+             "Number of threads used to decode the tuple sets of a model "
+             "before building its constraints in Solver::LoadModel().");
+
 namespace operations_research {
 // ---------- CPModelLoader -----------
 
@@ -92,28 +98,71 @@ class CPModelLoader {
 
   template <class P, class A>
   bool ScanArguments(const std::string& type, const P& proto, A* to_fill) {
-    const int index = tags_.Index(type);
-    for (int i = 0; i < proto.arguments_size(); ++i) {
-      if (ScanOneArgument(index, proto.arguments(i), to_fill)) {
-        return true;
-      }
-    }
-    return false;
+    return ScanArgumentsWithIndex(tags_.Index(type), proto, to_fill);
+  }
+
+  // Same as above for the ModelVisitor::k*Argument constants. The tag index is
+  // cached by address, so that the tag string is only hashed the first time.
+  template <class P, class A>
+  bool ScanArguments(const char* const type, const P& proto, A* to_fill) {
+    return ScanArgumentsWithIndex(ArgumentTagIndex(type), proto, to_fill);
   }
 
   int TagIndex(const std::string& tag) const { return tags_.Index(tag); }
 
   void AddTag(const std::string& tag) { tags_.Add(tag); }
 
+  // Finds the builders of all the tags. This must be called after the last
+  // AddTag(), it avoids a lookup by name for each built object.
+  void ResolveBuilders();
+
+  // Decodes the integer matrix arguments of the expressions and constraints
+  // of the model into tuple sets, using up to 'num_threads' threads. This only
+  // reads the model, and is the part of the loading that does not need the
+  // solver. ScanOneArgument() then returns the decoded sets.
+  void DecodeIntegerMatrices(const CPModelProto& model_proto, int num_threads);
+
   // TODO(user): Use.
   void SetSequenceVariable(int index, SequenceVar* const var) {}
 
  private:
+  template <class P, class A>
+  bool ScanArgumentsWithIndex(int index, const P& proto, A* to_fill) {
+    for (int i = 0; i < proto.arguments_size(); ++i) {
+      if (ScanOneArgument(index, proto.arguments(i), to_fill)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  int ArgumentTagIndex(const char* const type) {
+    // The key is a const void* because hash<const char*> hashes the string.
+    const void* const key = type;
+    hash_map<const void*, int>::const_iterator it =
+        argument_tag_indices_.find(key);
+    if (it != argument_tag_indices_.end()) return it->second;
+    const int index = tags_.Index(type);
+    argument_tag_indices_[key] = index;
+    return index;
+  }
+
   Solver* const solver_;
   std::vector<IntExpr*> expressions_;
   std::vector<IntervalVar*> intervals_;
   std::vector<SequenceVar*> sequences_;
   VectorMap<std::string> tags_;
+  hash_map<const void*, int> argument_tag_indices_;
+  // The tuple sets decoded by DecodeIntegerMatrices(), by argument.
+  hash_map<const CPArgumentProto*, IntTupleSet*> decoded_matrices_;
+  std::vector<std::unique_ptr<IntTupleSet> > decoded_matrix_storage_;
+
+  // The builders indexed by tag index, filled by ResolveBuilders(). They are
+  // nullptr for the tags that are not of the corresponding kind.
+  std::vector<Solver::IntegerExpressionBuilder*> expression_builders_;
+  std::vector<Solver::ConstraintBuilder*> constraint_builders_;
+  std::vector<Solver::IntervalVariableBuilder*> interval_builders_;
+  std::vector<Solver::SequenceVariableBuilder*> sequence_builders_;
 };
 
 Constraint* SetIsEqual(IntVar* const var, const std::vector<int64>& values,
@@ -984,6 +1033,9 @@ Constraint* BuildAllDifferent(CPModelLoader* const builder,
   } else {
     int64 range = 0;
     VERIFY(builder->ScanArguments(ModelVisitor::kRangeArgument, proto, &range));
+    if (range == 2) {
+      return builder->solver()->MakeDomainAllDifferent(vars);
+    }
     return builder->solver()->MakeAllDifferent(vars, range);
   }
 }
@@ -2281,13 +2333,85 @@ Constraint* BuildVarBoundWatcher(CPModelLoader* const builder,
 
 // ----- CPModelLoader -----
 
+void CPModelLoader::ResolveBuilders() {
+  const int num_tags = tags_.size();
+  expression_builders_.resize(num_tags);
+  constraint_builders_.resize(num_tags);
+  interval_builders_.resize(num_tags);
+  sequence_builders_.resize(num_tags);
+  for (int i = 0; i < num_tags; ++i) {
+    const std::string& tag = tags_.Element(i);
+    expression_builders_[i] = solver_->GetIntegerExpressionBuilder(tag);
+    constraint_builders_[i] = solver_->GetConstraintBuilder(tag);
+    interval_builders_[i] = solver_->GetIntervalVariableBuilder(tag);
+    sequence_builders_[i] = solver_->GetSequenceVariableBuilder(tag);
+  }
+}
+
+namespace {
+void DecodeIntegerMatrix(const CPIntegerMatrixProto& matrix,
+                         IntTupleSet* const tuples) {
+  const int rows = matrix.rows();
+  const int columns = matrix.columns();
+  CHECK_EQ(matrix.values_size(), rows * columns);
+  std::vector<int64> tuple(columns);
+  int counter = 0;
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < columns; ++j) {
+      tuple[j] = matrix.values(counter++);
+    }
+    tuples->Insert(tuple);
+  }
+}
+}  // namespace
+
+void CPModelLoader::DecodeIntegerMatrices(const CPModelProto& model_proto,
+                                          int num_threads) {
+  std::vector<const CPArgumentProto*> arguments;
+  for (const CPIntegerExpressionProto& proto : model_proto.expressions()) {
+    for (const CPArgumentProto& arg_proto : proto.arguments()) {
+      if (arg_proto.has_integer_matrix()) arguments.push_back(&arg_proto);
+    }
+  }
+  for (const CPConstraintProto& proto : model_proto.constraints()) {
+    for (const CPArgumentProto& arg_proto : proto.arguments()) {
+      if (arg_proto.has_integer_matrix()) arguments.push_back(&arg_proto);
+    }
+  }
+  if (arguments.empty()) return;
+  decoded_matrix_storage_.resize(arguments.size());
+  for (int i = 0; i < arguments.size(); ++i) {
+    decoded_matrix_storage_[i].reset(
+        new IntTupleSet(arguments[i]->integer_matrix().columns()));
+    decoded_matrices_[arguments[i]] = decoded_matrix_storage_[i].get();
+  }
+  // Each task fills its own tuple sets, which share no data.
+  const auto decode = [this, &arguments](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      DecodeIntegerMatrix(arguments[i]->integer_matrix(),
+                          decoded_matrix_storage_[i].get());
+    }
+  };
+  const int num_workers =
+      std::min(num_threads, static_cast<int>(arguments.size())) - 1;
+  if (num_workers <= 0) {
+    decode(0, arguments.size());
+  } else {
+    ThreadPool pool("DecodeIntegerMatrices", num_workers);
+    pool.StartWorkers();
+    pool.ParallelFor(0, arguments.size(), 1, decode);
+  }
+}
+
 bool CPModelLoader::BuildFromProto(const CPIntegerExpressionProto& proto) {
   const int index = proto.index();
   const int tag_index = proto.type_index();
+  // Element() also checks the tag index.
+  const std::string& tag = tags_.Element(tag_index);
   Solver::IntegerExpressionBuilder* const builder =
-      solver_->GetIntegerExpressionBuilder(tags_.Element(tag_index));
+      expression_builders_[tag_index];
   if (!builder) {
-    LOG(WARNING) << "Tag " << tags_.Element(tag_index) << " was not found";
+    LOG(WARNING) << "Tag " << tag << " was not found";
     return false;
   }
   IntExpr* const built = builder->Run(this, proto);
@@ -2301,10 +2425,11 @@ bool CPModelLoader::BuildFromProto(const CPIntegerExpressionProto& proto) {
 
 Constraint* CPModelLoader::BuildFromProto(const CPConstraintProto& proto) {
   const int tag_index = proto.type_index();
-  Solver::ConstraintBuilder* const builder =
-      solver_->GetConstraintBuilder(tags_.Element(tag_index));
+  // Element() also checks the tag index.
+  const std::string& tag = tags_.Element(tag_index);
+  Solver::ConstraintBuilder* const builder = constraint_builders_[tag_index];
   if (!builder) {
-    LOG(WARNING) << "Tag " << tags_.Element(tag_index) << " was not found";
+    LOG(WARNING) << "Tag " << tag << " was not found";
     return nullptr;
   }
   Constraint* const built = builder->Run(this, proto);
@@ -2314,10 +2439,12 @@ Constraint* CPModelLoader::BuildFromProto(const CPConstraintProto& proto) {
 bool CPModelLoader::BuildFromProto(const CPIntervalVariableProto& proto) {
   const int index = proto.index();
   const int tag_index = proto.type_index();
+  // Element() also checks the tag index.
+  const std::string& tag = tags_.Element(tag_index);
   Solver::IntervalVariableBuilder* const builder =
-      solver_->GetIntervalVariableBuilder(tags_.Element(tag_index));
+      interval_builders_[tag_index];
   if (!builder) {
-    LOG(WARNING) << "Tag " << tags_.Element(tag_index) << " was not found";
+    LOG(WARNING) << "Tag " << tag << " was not found";
     return false;
   }
   IntervalVar* const built = builder->Run(this, proto);
@@ -2332,10 +2459,12 @@ bool CPModelLoader::BuildFromProto(const CPIntervalVariableProto& proto) {
 bool CPModelLoader::BuildFromProto(const CPSequenceVariableProto& proto) {
   const int index = proto.index();
   const int tag_index = proto.type_index();
+  // Element() also checks the tag index.
+  const std::string& tag = tags_.Element(tag_index);
   Solver::SequenceVariableBuilder* const builder =
-      solver_->GetSequenceVariableBuilder(tags_.Element(tag_index));
+      sequence_builders_[tag_index];
   if (!builder) {
-    LOG(WARNING) << "Tag " << tags_.Element(tag_index) << " was not found";
+    LOG(WARNING) << "Tag " << tag << " was not found";
     return false;
   }
   SequenceVar* const built = builder->Run(this, proto);
@@ -2403,6 +2532,11 @@ bool CPModelLoader::ScanOneArgument(int type_index,
                                     IntTupleSet* to_fill) {
   if (arg_proto.argument_index() == type_index &&
       arg_proto.has_integer_matrix()) {
+    IntTupleSet* const decoded = FindPtrOrNull(decoded_matrices_, &arg_proto);
+    if (decoded != nullptr && decoded->Arity() == to_fill->Arity()) {
+      *to_fill = *decoded;
+      return true;
+    }
     to_fill->Clear();
     const CPIntegerMatrixProto& matrix = arg_proto.integer_matrix();
     const int rows = matrix.rows();
@@ -2528,6 +2662,12 @@ bool Solver::LoadModel(const CPModelProto& model_proto) {
 
 bool Solver::LoadModel(const CPModelProto& model_proto,
                        std::vector<SearchMonitor*>* monitors) {
+  return LoadModel(model_proto, monitors, nullptr);
+}
+
+bool Solver::LoadModel(const CPModelProto& model_proto,
+                       std::vector<SearchMonitor*>* monitors,
+                       std::vector<std::vector<IntVar*> >* variable_groups) {
   if (model_proto.version() > kModelVersion) {
     LOG(ERROR) << "Model protocol buffer version is greater than"
                << " the one compiled in the reader (" << model_proto.version()
@@ -2538,6 +2678,8 @@ bool Solver::LoadModel(const CPModelProto& model_proto,
   for (int i = 0; i < model_proto.tags_size(); ++i) {
     builder.AddTag(model_proto.tags(i));
   }
+  builder.ResolveBuilders();
+  builder.DecodeIntegerMatrices(model_proto, FLAGS_cp_load_model_threads);
   for (int i = 0; i < model_proto.intervals_size(); ++i) {
     if (!builder.BuildFromProto(model_proto.intervals(i))) {
       LOG(ERROR) << "Interval variable proto "
@@ -2588,9 +2730,34 @@ bool Solver::LoadModel(const CPModelProto& model_proto,
       monitors->push_back(objective);
     }
   }
+  if (variable_groups != nullptr) {
+    const int vars_tag_index = builder.TagIndex(ModelVisitor::kVarsArgument);
+    for (int i = 0; i < model_proto.variable_groups_size(); ++i) {
+      const CPVariableGroup& group_proto = model_proto.variable_groups(i);
+      variable_groups->push_back(std::vector<IntVar*>());
+      std::vector<IntVar*>* const group = &variable_groups->back();
+      for (const CPArgumentProto& arg_proto : group_proto.arguments()) {
+        if (arg_proto.argument_index() != vars_tag_index) continue;
+        for (const int expression_index :
+             arg_proto.integer_expression_array()) {
+          group->push_back(builder.IntegerExpression(expression_index)->Var());
+        }
+      }
+    }
+  }
   return true;
 }
 
+bool Solver::CopyModel(const std::vector<SearchMonitor*>& monitors,
+                       Solver* const target,
+                       std::vector<SearchMonitor*>* target_monitors) const {
+  CHECK(target != nullptr);
+  CHECK_NE(this, target);
+  CPModelProto model_proto;
+  ExportModel(monitors, &model_proto);
+  return target->LoadModel(model_proto, target_monitors);
+}
+
 bool Solver::UpgradeModel(CPModelProto* const proto) {
   if (proto->version() == kModelVersion) {
     LOG(INFO) << "Model already up to date with version " << kModelVersion;
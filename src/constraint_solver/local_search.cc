@@ -29,6 +29,9 @@
 #include "base/macros.h"
 #include "base/map_util.h"
 #include "base/hash.h"
+#include "base/stl_util.h"
+#include "base/stringprintf.h"
+#include "base/time_support.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "graph/hamiltonian_path.h"
@@ -47,6 +50,11 @@ DEFINE_int32(cp_local_search_tsp_lns_size, 10,
 DEFINE_bool(cp_use_empty_path_symmetry_breaker, true,
             "If true, equivalent empty paths are removed from the neighborhood "
             "of PathOperators");
+DEFINE_bool(cp_local_search_dont_look_bits, false,
+            "If true, PathOperators skip base nodes whose neighborhood was "
+            "explored without success and which have not been touched by a "
+            "move since; skipped nodes are explored again before the "
+            "neighborhood is declared exhausted.");
 
 namespace operations_research {
 
@@ -332,27 +340,95 @@ PathOperator::PathOperator(const std::vector<IntVar*>& next_vars,
       base_paths_(number_of_base_nodes),
       just_started_(false),
       first_start_(true),
-      start_empty_path_class_(start_empty_path_class) {
+      start_empty_path_class_(start_empty_path_class),
+      use_dont_look_bits_(false),
+      final_sweep_(false) {
   if (!ignore_path_vars_) {
     AddVars(path_vars);
   }
 }
 
 void PathOperator::OnStart() {
+  if (first_start_) {
+    use_dont_look_bits_ =
+        FLAGS_cp_local_search_dont_look_bits && SupportsDontLookBits();
+  }
+  if (use_dont_look_bits_) {
+    UpdateDontLookBits();
+  }
   InitializeBaseNodes();
   OnNodeInitialization();
 }
 
 bool PathOperator::MakeOneNeighbor() {
-  while (IncrementPosition()) {
-    // Need to revert changes here since MakeNeighbor might have returned false
-    // and have done changes in the previous iteration.
-    RevertChanges(true);
-    if (MakeNeighbor()) {
-      return true;
+  for (;;) {
+    while (IncrementPosition()) {
+      // Need to revert changes here since MakeNeighbor might have returned
+      // false and have done changes in the previous iteration.
+      RevertChanges(true);
+      if (MakeNeighbor()) {
+        return true;
+      }
     }
+    if (skipped_nodes_.empty() || final_sweep_) {
+      return false;
+    }
+    // Some base nodes were skipped during the last pass: explore them (and
+    // only them) before declaring the neighborhood exhausted.
+    dont_look_.assign(number_of_nexts_, true);
+    for (const int node : skipped_nodes_) {
+      dont_look_[node] = false;
+    }
+    skipped_nodes_.clear();
+    final_sweep_ = true;
+    ResetPosition();
+  }
+}
+
+void PathOperator::UpdateDontLookBits() {
+  // Nodes at the extremities of arcs which were modified since the last
+  // synchronization are explored again.
+  skipped_nodes_.clear();
+  final_sweep_ = false;
+  if (dont_look_.empty()) {
+    dont_look_.resize(number_of_nexts_, false);
+    last_nexts_.resize(number_of_nexts_);
+  } else {
+    for (int i = 0; i < number_of_nexts_; ++i) {
+      const int64 next = OldNext(i);
+      const int64 last_next = last_nexts_[i];
+      if (next != last_next) {
+        dont_look_[i] = false;
+        if (!IsPathEnd(next)) dont_look_[next] = false;
+        if (!IsPathEnd(last_next)) dont_look_[last_next] = false;
+      }
+    }
+  }
+  for (int i = 0; i < number_of_nexts_; ++i) {
+    last_nexts_[i] = OldNext(i);
+  }
+}
+
+bool PathOperator::FirstBaseNodeExplored() {
+  // The other base nodes iterate on paths in lexicographic order; the first
+  // base node has seen all its neighbors once they are on their last path.
+  const int last_path = path_starts_.size() - 1;
+  for (int i = 1; i < base_nodes_.size(); ++i) {
+    if (!OnSamePathAsPreviousBase(i) && base_paths_[i] != last_path) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PathOperator::SkipDontLookBaseNode() {
+  while (!IsPathEnd(base_nodes_[0]) && dont_look_[base_nodes_[0]] &&
+         base_nodes_[0] != end_nodes_[0]) {
+    if (!final_sweep_) {
+      skipped_nodes_.push_back(base_nodes_[0]);
+    }
+    base_nodes_[0] = OldNext(base_nodes_[0]);
   }
-  return false;
 }
 
 bool PathOperator::SkipUnchanged(int index) const {
@@ -443,6 +519,13 @@ bool PathOperator::MakeChainInactive(int64 before_chain, int64 chain_end) {
   return false;
 }
 
+bool PathOperator::AreInterchangeablePaths(int64 start1, int64 start2) const {
+  return FLAGS_cp_use_empty_path_symmetry_breaker &&
+         start_empty_path_class_ != nullptr &&
+         start_empty_path_class_->Run(start1) ==
+             start_empty_path_class_->Run(start2);
+}
+
 bool PathOperator::CheckEnds() const {
   const int base_node_size = base_nodes_.size();
   for (int i = 0; i < base_node_size; ++i) {
@@ -465,7 +548,17 @@ bool PathOperator::IncrementPosition() {
     int last_restarted = base_node_size;
     for (int i = base_node_size - 1; i >= 0; --i) {
       if (base_nodes_[i] < number_of_nexts_) {
-        base_nodes_[i] = OldNext(base_nodes_[i]);
+        if (i == 0 && use_dont_look_bits_) {
+          // Once the neighborhood of the first base node has been explored
+          // without success, it is skipped until a move modifies its arcs.
+          if (FirstBaseNodeExplored()) {
+            dont_look_[base_nodes_[0]] = true;
+          }
+          base_nodes_[0] = OldNext(base_nodes_[0]);
+          SkipDontLookBaseNode();
+        } else {
+          base_nodes_[i] = OldNext(base_nodes_[i]);
+        }
         break;
       }
       base_nodes_[i] = StartNode(i);
@@ -492,6 +585,9 @@ bool PathOperator::IncrementPosition() {
       if (next_path_index < number_of_paths) {
         base_paths_[i] = next_path_index;
         base_nodes_[i] = path_starts_[next_path_index];
+        if (i == 0 && use_dont_look_bits_) {
+          SkipDontLookBaseNode();
+        }
         if (i == 0 || !OnSamePathAsPreviousBase(i)) {
           return CheckEnds();
         }
@@ -769,6 +865,13 @@ bool Relocate::MakeNeighbor() {
     chain_end = Next(chain_end);
   }
   const int64 destination = BaseNode(1);
+  // Moving a whole path to an empty interchangeable path is symmetric.
+  if (before_chain == StartNode(0) && !IsPathEnd(chain_end) &&
+      IsPathEnd(Next(chain_end)) && destination == StartNode(1) &&
+      IsPathEnd(Next(destination)) &&
+      AreInterchangeablePaths(StartNode(0), StartNode(1))) {
+    return false;
+  }
   return MoveChain(before_chain, chain_end, destination);
 }
 
@@ -800,6 +903,13 @@ bool Exchange::MakeNeighbor() {
   const int64 prev_node1 = BaseNode(1);
   if (IsPathEnd(prev_node1)) return false;
   const int64 node1 = Next(prev_node1);
+  // Exchanging the only nodes of interchangeable paths is symmetric.
+  if (prev_node0 == StartNode(0) && !IsPathEnd(node0) &&
+      IsPathEnd(Next(node0)) && prev_node1 == StartNode(1) &&
+      !IsPathEnd(node1) && IsPathEnd(Next(node1)) &&
+      AreInterchangeablePaths(StartNode(0), StartNode(1))) {
+    return false;
+  }
   if (node0 == prev_node1) {
     return MoveChain(prev_node1, node1, prev_node0);
   } else if (node1 == prev_node0) {
@@ -842,6 +952,11 @@ bool Cross::MakeNeighbor() {
   if (start1 == start0) {
     return false;
   }
+  // Exchanging the whole contents of interchangeable paths is symmetric.
+  if (!IsPathEnd(node0) && IsPathEnd(Next(node0)) && !IsPathEnd(node1) &&
+      IsPathEnd(Next(node1)) && AreInterchangeablePaths(start0, start1)) {
+    return false;
+  }
   if (!IsPathEnd(node0) && !IsPathEnd(node1)) {
     return MoveChain(start0, node0, start1) && MoveChain(node0, node1, start0);
   } else if (!IsPathEnd(node0)) {
@@ -868,6 +983,8 @@ class BaseInactiveNodeToPathOperator : public PathOperator {
 
  protected:
   virtual bool MakeOneNeighbor();
+  // Base nodes are iterated once per inactive node.
+  virtual bool SupportsDontLookBits() const { return false; }
   int64 GetInactiveNode() const { return inactive_node_; }
 
  private:
@@ -1175,6 +1292,7 @@ class TSPLns : public PathOperator {
 
  protected:
   virtual bool MakeOneNeighbor();
+  virtual bool SupportsDontLookBits() const { return false; }
 
  private:
   std::vector<std::vector<int64> > cost_;
@@ -1295,11 +1413,15 @@ bool TSPLns::MakeNeighbor() {
 // and j is in the domain of the variable.
 // Note that the resulting pairs are sorted.
 // Works in O(size) per variable on average (same approach as qsort)
+// If 'nearest' is not null, the pairs are read from the lists it returns
+// instead of being computed from evaluator (see MakeLinKernighanOperator).
 
 class NearestNeighbors {
  public:
-  NearestNeighbors(Solver::IndexEvaluator3* evaluator,
-                   const PathOperator& path_operator, int size);
+  NearestNeighbors(
+      Solver::IndexEvaluator3* evaluator,
+      ResultCallback3<const std::vector<int>*, int64, int64, int>* nearest,
+      const PathOperator& path_operator, int size);
   virtual ~NearestNeighbors() {}
   void Initialize();
   const std::vector<int>& Neighbors(int index) const;
@@ -1313,6 +1435,7 @@ class NearestNeighbors {
 
   std::vector<std::vector<int> > neighbors_;
   Solver::IndexEvaluator3* evaluator_;
+  ResultCallback3<const std::vector<int>*, int64, int64, int>* const nearest_;
   const PathOperator& path_operator_;
   const int size_;
   bool initialized_;
@@ -1320,9 +1443,12 @@ class NearestNeighbors {
   DISALLOW_COPY_AND_ASSIGN(NearestNeighbors);
 };
 
-NearestNeighbors::NearestNeighbors(Solver::IndexEvaluator3* evaluator,
-                                   const PathOperator& path_operator, int size)
+NearestNeighbors::NearestNeighbors(
+    Solver::IndexEvaluator3* evaluator,
+    ResultCallback3<const std::vector<int>*, int64, int64, int>* nearest,
+    const PathOperator& path_operator, int size)
     : evaluator_(evaluator),
+      nearest_(nearest),
       path_operator_(path_operator),
       size_(size),
       initialized_(false) {}
@@ -1345,6 +1471,16 @@ const std::vector<int>& NearestNeighbors::Neighbors(int index) const {
 void NearestNeighbors::ComputeNearest(int row) {
   // Find size_ nearest neighbors for row of index 'row'.
   const int path = path_operator_.Path(row);
+  if (nearest_ != nullptr) {
+    // The shared lists do not contain 'row' itself, which is always among its
+    // own nearest neighbors when computed from the evaluator.
+    const std::vector<int>& nearest = *nearest_->Run(row, path, size_ - 1);
+    const int count = std::min<int>(size_ - 1, nearest.size());
+    neighbors_[row].assign(nearest.begin(), nearest.begin() + count);
+    neighbors_[row].push_back(row);
+    std::sort(neighbors_[row].begin(), neighbors_[row].end());
+    return;
+  }
   const IntVar* var = path_operator_.Var(row);
   const int64 var_min = var->Min();
   const int var_size = var->Max() - var_min + 1;
@@ -1407,7 +1543,9 @@ class LinKernighan : public PathOperator {
   LinKernighan(const std::vector<IntVar*>& vars,
                const std::vector<IntVar*>& secondary_vars,
                Solver::IndexEvaluator3* evaluator,
-               bool owner,  // Owner of callback
+               ResultCallback3<const std::vector<int>*, int64, int64, int>*
+                   nearest,
+               bool owner,  // Owner of callbacks
                bool topt);
   virtual ~LinKernighan();
   virtual bool MakeNeighbor();
@@ -1422,6 +1560,7 @@ class LinKernighan : public PathOperator {
   bool InFromOut(int64 in_i, int64 in_j, int64* out, int64* gain);
 
   Solver::IndexEvaluator3* const evaluator_;
+  ResultCallback3<const std::vector<int>*, int64, int64, int>* const nearest_;
   bool owner_;
   NearestNeighbors neighbors_;
   hash_set<int64> marked_;
@@ -1432,19 +1571,23 @@ class LinKernighan : public PathOperator {
 // followed by a series of 2opt moves. Return a neighbor for which the global
 // gain is positive.
 
-LinKernighan::LinKernighan(const std::vector<IntVar*>& vars,
-                           const std::vector<IntVar*>& secondary_vars,
-                           Solver::IndexEvaluator3* evaluator, bool owner,
-                           bool topt)
+LinKernighan::LinKernighan(
+    const std::vector<IntVar*>& vars,
+    const std::vector<IntVar*>& secondary_vars,
+    Solver::IndexEvaluator3* evaluator,
+    ResultCallback3<const std::vector<int>*, int64, int64, int>* nearest,
+    bool owner, bool topt)
     : PathOperator(vars, secondary_vars, 1, nullptr),
       evaluator_(evaluator),
+      nearest_(nearest),
       owner_(owner),
-      neighbors_(evaluator, *this, kNeighbors),
+      neighbors_(evaluator, nearest, *this, kNeighbors),
       topt_(topt) {}
 
 LinKernighan::~LinKernighan() {
   if (owner_) {
     delete evaluator_;
+    delete nearest_;
   }
 }
 
@@ -1567,6 +1710,9 @@ class PathLNS : public PathOperator {
 
   virtual std::string DebugString() const { return "PathLNS"; }
 
+ protected:
+  virtual bool SupportsDontLookBits() const { return false; }
+
  private:
   inline bool ChainsAreFullPaths() const { return chunk_size_ == 0; }
   void DeactivateChain(int64 node0);
@@ -2006,6 +2152,19 @@ LocalSearchOperator* Solver::MakeOperator(const std::vector<IntVar*>& vars,
   return result;
 }
 
+LocalSearchOperator* MakeLinKernighanOperator(
+    Solver* solver, const std::vector<IntVar*>& vars,
+    const std::vector<IntVar*>& secondary_vars,
+    Solver::IndexEvaluator3* evaluator,
+    ResultCallback3<const std::vector<int>*, int64, int64, int>* nearest) {
+  std::vector<LocalSearchOperator*> operators;
+  operators.push_back(solver->RevAlloc(new LinKernighan(
+      vars, secondary_vars, evaluator, nearest, true, false)));
+  operators.push_back(solver->RevAlloc(new LinKernighan(
+      vars, secondary_vars, evaluator, nearest, false, true)));
+  return solver->ConcatenateOperators(operators);
+}
+
 LocalSearchOperator* Solver::MakeOperator(
     const std::vector<IntVar*>& vars, Solver::IndexEvaluator3* const evaluator,
     Solver::EvaluatorLocalSearchOperators op) {
@@ -2019,12 +2178,8 @@ LocalSearchOperator* Solver::MakeOperator(
   LocalSearchOperator* result = nullptr;
   switch (op) {
     case Solver::LK: {
-      std::vector<LocalSearchOperator*> operators;
-      operators.push_back(RevAlloc(
-          new LinKernighan(vars, secondary_vars, evaluator, true, false)));
-      operators.push_back(RevAlloc(
-          new LinKernighan(vars, secondary_vars, evaluator, false, true)));
-      result = ConcatenateOperators(operators);
+      result = MakeLinKernighanOperator(this, vars, secondary_vars, evaluator,
+                                        nullptr);
       break;
     }
     case Solver::TSPOPT: {
@@ -2104,6 +2259,39 @@ class MaxOperation {
   std::set<int64> values_set_;
 };
 
+}  // namespace
+
+// ----- LocalSearchDelta -----
+
+void LocalSearchDelta::Decode(const Assignment* const assignment) {
+  assignment_ = assignment;
+  elements_.clear();
+  if (assignment == nullptr) return;
+  const Assignment::IntContainer& container = assignment->IntVarContainer();
+  const int size = container.Size();
+  elements_.resize(size);
+  for (int i = 0; i < size; ++i) {
+    const IntVarElement& element = container.Element(i);
+    Element* const decoded = &elements_[i];
+    decoded->var = element.Var();
+    decoded->var_index = element.Var()->index();
+    decoded->activated = element.Activated();
+    decoded->min = element.Min();
+    decoded->max = element.Max();
+  }
+}
+
+// ----- LocalSearchFilter -----
+
+bool LocalSearchFilter::DecodeAndAccept(const Assignment* delta,
+                                        const Assignment* deltadelta) {
+  decoded_delta_.Decode(delta);
+  decoded_deltadelta_.Decode(deltadelta);
+  return AcceptDecoded(decoded_delta_, decoded_deltadelta_);
+}
+
+namespace {
+
 // ----- Variable domain filter -----
 // Rejects assignments to values outside the domain of variables
 
@@ -2111,20 +2299,23 @@ class VariableDomainFilter : public LocalSearchFilter {
  public:
   VariableDomainFilter() {}
   virtual ~VariableDomainFilter() {}
-  virtual bool Accept(const Assignment* delta, const Assignment* deltadelta);
+  virtual bool Accept(const Assignment* delta, const Assignment* deltadelta) {
+    return DecodeAndAccept(delta, deltadelta);
+  }
+  virtual bool AcceptDecoded(const LocalSearchDelta& delta,
+                             const LocalSearchDelta& deltadelta);
   virtual void Synchronize(const Assignment* assignment,
                            const Assignment* delta) {}
+  virtual bool CanBeReordered() const { return true; }
 
   virtual std::string DebugString() const { return "VariableDomainFilter"; }
 };
 
-bool VariableDomainFilter::Accept(const Assignment* delta,
-                                  const Assignment* deltadelta) {
-  const Assignment::IntContainer& container = delta->IntVarContainer();
-  const int size = container.Size();
+bool VariableDomainFilter::AcceptDecoded(const LocalSearchDelta& delta,
+                                         const LocalSearchDelta& deltadelta) {
+  const int size = delta.Size();
   for (int i = 0; i < size; ++i) {
-    const IntVarElement& element = container.Element(i);
-    if (element.Activated() && !element.Var()->Contains(element.Value())) {
+    if (delta.Activated(i) && !delta.Var(i)->Contains(delta.Value(i))) {
       return false;
     }
   }
@@ -2234,15 +2425,24 @@ class ObjectiveFilter : public IntVarLocalSearchFilter {
     delete[] delta_cache_;
   }
   virtual bool Accept(const Assignment* delta, const Assignment* deltadelta) {
+    if (delta == nullptr) {
+      return false;
+    }
+    return DecodeAndAccept(delta, deltadelta);
+  }
+  virtual bool AcceptDecoded(const LocalSearchDelta& decoded_delta,
+                             const LocalSearchDelta& decoded_deltadelta) {
+    const Assignment* const delta = decoded_delta.assignment();
     if (delta == nullptr) {
       return false;
     }
     int64 value = 0;
-    if (!deltadelta->Empty()) {
+    if (!decoded_deltadelta.assignment()->Empty()) {
       if (!incremental_) {
-        value = Evaluate(delta, old_value_, cache_, true);
+        value = Evaluate(decoded_delta, old_value_, cache_, true);
       } else {
-        value = Evaluate(deltadelta, old_delta_value_, delta_cache_, true);
+        value = Evaluate(decoded_deltadelta, old_delta_value_, delta_cache_,
+                         true);
       }
       incremental_ = true;
     } else {
@@ -2253,7 +2453,7 @@ class ObjectiveFilter : public IntVarLocalSearchFilter {
         old_delta_value_ = old_value_;
       }
       incremental_ = false;
-      value = Evaluate(delta, old_value_, cache_, false);
+      value = Evaluate(decoded_delta, old_value_, cache_, false);
     }
     old_delta_value_ = value;
     int64 var_min = objective_->Min();
@@ -2282,9 +2482,11 @@ class ObjectiveFilter : public IntVarLocalSearchFilter {
     }
   }
   virtual int64 SynchronizedElementValue(int64 index) = 0;
-  virtual bool EvaluateElementValue(const Assignment::IntContainer& container,
-                                    int index, int* container_index,
-                                    int64* obj_value) = 0;
+  // Computes the value of the element of index 'index' in the filter from
+  // the element of index '*delta_index' in 'delta'. '*delta_index' can be
+  // advanced if the next elements of the delta are used too.
+  virtual bool EvaluateElementValue(const LocalSearchDelta& delta, int index,
+                                    int* delta_index, int64* obj_value) = 0;
   virtual bool IsIncremental() const { return true; }
 
   virtual std::string DebugString() const { return "ObjectiveFilter"; }
@@ -2317,20 +2519,18 @@ class ObjectiveFilter : public IntVarLocalSearchFilter {
     delta_objective_callback_->Run(op_.value());
   }
 }
-int64 Evaluate(const Assignment* delta, int64 current_value,
+int64 Evaluate(const LocalSearchDelta& delta, int64 current_value,
                const int64* const out_values, bool cache_delta_values) {
   if (current_value == kint64max) return current_value;
   op_.set_value(current_value);
-  const Assignment::IntContainer& container = delta->IntVarContainer();
-  const int size = container.Size();
+  const int size = delta.Size();
   for (int i = 0; i < size; ++i) {
-    const IntVarElement& new_element = container.Element(i);
-    IntVar* const var = new_element.Var();
     int64 index = -1;
-    if (FindIndex(var, &index) && index < primary_vars_size_) {
+    if (FindIndexFromVarIndex(delta.VarIndex(i), &index) &&
+        index < primary_vars_size_) {
       op_.Remove(out_values[index]);
       int64 obj_value = 0LL;
-      if (EvaluateElementValue(container, index, &i, &obj_value)) {
+      if (EvaluateElementValue(delta, index, &i, &obj_value)) {
         op_.Update(obj_value);
         if (cache_delta_values) {
           delta_cache_[index] = obj_value;
@@ -2362,15 +2562,14 @@ class BinaryObjectiveFilter : public ObjectiveFilter<Operator> {
                                        IntVarLocalSearchFilter::Value(index))
                : 0;
   }
-  virtual bool EvaluateElementValue(const Assignment::IntContainer& container,
-                                    int index, int* container_index,
-                                    int64* obj_value) {
-    const IntVarElement& element = container.Element(*container_index);
-    if (element.Activated()) {
-      *obj_value = value_evaluator_->Run(index, element.Value());
+  virtual bool EvaluateElementValue(const LocalSearchDelta& delta, int index,
+                                    int* delta_index, int64* obj_value) {
+    const int i = *delta_index;
+    if (delta.Activated(i)) {
+      *obj_value = value_evaluator_->Run(index, delta.Value(i));
       return true;
     } else {
-      const IntVar* var = element.Var();
+      const IntVar* var = delta.Var(i);
       if (var->Bound()) {
         *obj_value = value_evaluator_->Run(index, var->Min());
         return true;
@@ -2410,28 +2609,29 @@ class TernaryObjectiveFilter : public ObjectiveFilter<Operator> {
                                            index + secondary_vars_offset_))
                : 0;
   }
-  bool EvaluateElementValue(const Assignment::IntContainer& container,
-                            int index, int* container_index, int64* obj_value) {
+  bool EvaluateElementValue(const LocalSearchDelta& delta, int index,
+                            int* delta_index, int64* obj_value) {
     DCHECK_LT(index, secondary_vars_offset_);
     *obj_value = 0LL;
-    const IntVarElement& element = container.Element(*container_index);
-    const IntVar* secondary_var =
+    const int i = *delta_index;
+    IntVar* const secondary_var =
         IntVarLocalSearchFilter::Var(index + secondary_vars_offset_);
-    if (element.Activated()) {
-      const int64 value = element.Value();
-      int hint_index = *container_index + 1;
-      if (hint_index < container.Size() &&
-          secondary_var == container.Element(hint_index).Var()) {
-        *obj_value = value_evaluator_->Run(
-            index, value, container.Element(hint_index).Value());
-        *container_index = hint_index;
+    if (delta.Activated(i)) {
+      const int64 value = delta.Value(i);
+      const int hint_index = i + 1;
+      if (hint_index < delta.Size() && secondary_var == delta.Var(hint_index)) {
+        *obj_value =
+            value_evaluator_->Run(index, value, delta.Value(hint_index));
+        *delta_index = hint_index;
       } else {
         *obj_value = value_evaluator_->Run(
-            index, value, container.Element(secondary_var).Value());
+            index, value,
+            delta.assignment()->IntVarContainer().Element(secondary_var)
+                .Value());
       }
       return true;
     } else {
-      const IntVar* var = element.Var();
+      const IntVar* var = delta.Var(i);
       if (var->Bound() && secondary_var->Bound()) {
         *obj_value =
             value_evaluator_->Run(index, var->Min(), secondary_var->Min());
@@ -2532,8 +2732,140 @@ LocalSearchFilter* Solver::MakeLocalSearchObjectiveFilter(
 #undef ReturnObjectiveFilter6
 #undef ReturnObjectiveFilter5
 
+// ----- Local search filter runner -----
+
+// Calls the local search filters on the neighbors. The deltas are decoded
+// once and handed to all the filters. The filters which can be reordered are
+// called first, by decreasing rejection rate per unit of time; the time is
+// only measured on one call out of kTimingPeriod. The other filters are then
+// called in their original order. Once a filter has rejected a neighbor,
+// only the incremental filters are called.
+class LocalSearchFilterRunner {
+ public:
+  explicit LocalSearchFilterRunner(
+      const std::vector<LocalSearchFilter*>& filters);
+
+  bool Accept(const Assignment* delta, const Assignment* deltadelta);
+  void Synchronize(const Assignment* assignment);
+
+ private:
+  struct FilterStatistics {
+    explicit FilterStatistics(LocalSearchFilter* const f)
+        : filter(f), calls(0), rejections(0), timed_calls(0), nanos(0) {}
+    // Rejections per call divided by the average time of a call.
+    double Score() const {
+      if (calls == 0 || timed_calls == 0) return 0.0;
+      return static_cast<double>(rejections) * timed_calls /
+             (static_cast<double>(calls) * std::max(nanos, 1LL));
+    }
+
+    LocalSearchFilter* filter;
+    int64 calls;
+    int64 rejections;
+    int64 timed_calls;
+    int64 nanos;
+  };
+
+  static const int kTimingPeriod = 16;
+  static const int kSortingPeriod = 1024;
+
+  void SortFilters();
+
+  std::vector<FilterStatistics> reorderable_filters_;
+  std::vector<LocalSearchFilter*> fixed_filters_;
+  LocalSearchDelta decoded_delta_;
+  LocalSearchDelta decoded_deltadelta_;
+  int64 num_accept_calls_;
+};
+
+LocalSearchFilterRunner::LocalSearchFilterRunner(
+    const std::vector<LocalSearchFilter*>& filters)
+    : num_accept_calls_(0) {
+  for (LocalSearchFilter* const filter : filters) {
+    if (filter->CanBeReordered()) {
+      reorderable_filters_.push_back(FilterStatistics(filter));
+    } else {
+      fixed_filters_.push_back(filter);
+    }
+  }
+}
+
+bool LocalSearchFilterRunner::Accept(const Assignment* delta,
+                                     const Assignment* deltadelta) {
+  ++num_accept_calls_;
+  if (num_accept_calls_ % kSortingPeriod == 0) {
+    SortFilters();
+  }
+  decoded_delta_.Decode(delta);
+  decoded_deltadelta_.Decode(deltadelta);
+  const bool timed = num_accept_calls_ % kTimingPeriod == 0;
+  bool ok = true;
+  for (FilterStatistics& statistics : reorderable_filters_) {
+    LocalSearchFilter* const filter = statistics.filter;
+    if (!ok && !filter->IsIncremental()) continue;
+    const int64 start = timed ? base::GetCurrentTimeNanos() : 0;
+    const bool accept =
+        filter->AcceptDecoded(decoded_delta_, decoded_deltadelta_);
+    if (timed) {
+      statistics.nanos += base::GetCurrentTimeNanos() - start;
+      ++statistics.timed_calls;
+    }
+    ++statistics.calls;
+    if (!accept) {
+      ++statistics.rejections;
+      ok = false;
+    }
+  }
+  for (LocalSearchFilter* const filter : fixed_filters_) {
+    if (filter->IsIncremental()) {
+      ok = filter->AcceptDecoded(decoded_delta_, decoded_deltadelta_) && ok;
+    } else {
+      ok = ok && filter->AcceptDecoded(decoded_delta_, decoded_deltadelta_);
+    }
+  }
+  return ok;
+}
+
+void LocalSearchFilterRunner::Synchronize(const Assignment* assignment) {
+  for (const FilterStatistics& statistics : reorderable_filters_) {
+    statistics.filter->Synchronize(assignment, nullptr);
+  }
+  for (LocalSearchFilter* const filter : fixed_filters_) {
+    filter->Synchronize(assignment, nullptr);
+  }
+}
+
+void LocalSearchFilterRunner::SortFilters() {
+  std::stable_sort(reorderable_filters_.begin(), reorderable_filters_.end(),
+                   [](const FilterStatistics& a, const FilterStatistics& b) {
+    return a.Score() > b.Score();
+  });
+}
+
 // ----- Finds a neighbor of the assignment passed -----
 
+namespace {
+// Copies to 'target' the elements of 'source' corresponding to the variables
+// of 'keys'; other elements of 'target' are left unchanged.
+template <class V, class E>
+void CopyElements(const AssignmentContainer<V, E>& keys,
+                  const AssignmentContainer<V, E>& source,
+                  AssignmentContainer<V, E>* const target) {
+  for (const E& key : keys.elements()) {
+    const E* const element = source.ElementPtrOrNull(key.Var());
+    E* const target_element = target->MutableElementOrNull(key.Var());
+    if (element != nullptr && target_element != nullptr) {
+      target_element->Copy(*element);
+      if (element->Activated()) {
+        target_element->Activate();
+      } else {
+        target_element->Deactivate();
+      }
+    }
+  }
+}
+}  // namespace
+
 class FindOneNeighbor : public DecisionBuilder {
  public:
   FindOneNeighbor(Assignment* const assignment, SolutionPool* const pool,
@@ -2558,7 +2890,7 @@ class FindOneNeighbor : public DecisionBuilder {
   SearchLimit* limit_;
   const SearchLimit* const original_limit_;
   bool neighbor_found_;
-  std::vector<LocalSearchFilter*> filters_;
+  LocalSearchFilterRunner filters_;
 };
 
 // reference_assignment_ is used to keep track of the last assignment on which
@@ -2621,6 +2953,9 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
     }
     Assignment* delta = solver->MakeAssignment();
     Assignment* deltadelta = solver->MakeAssignment();
+    // assignment_copy only differs from reference_assignment_ on the variables
+    // of the last delta tried, unless the reference has been resynchronized.
+    bool assignment_copy_synced = true;
     while (true) {
       delta->Clear();
       deltadelta->Clear();
@@ -2630,6 +2965,7 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
         // TODO(user) : SyncNeed(assignment_) ?
         counter = 0;
         SynchronizeAll();
+        assignment_copy_synced = false;
       }
 
       if (!limit_->Check() &&
@@ -2645,7 +2981,10 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
         const bool move_filter = FilterAccept(delta, deltadelta);
         if (mh_filter && move_filter) {
           solver->filtered_neighbors_ += 1;
-          assignment_copy->Copy(reference_assignment_.get());
+          if (!assignment_copy_synced) {
+            assignment_copy->Copy(reference_assignment_.get());
+            assignment_copy_synced = true;
+          }
           assignment_copy->Copy(delta);
           if (solver->SolveAndCommit(restore)) {
             solver->accepted_neighbors_ += 1;
@@ -2653,6 +2992,17 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
             neighbor_found_ = true;
             return nullptr;
           }
+          // Reverting the delta is much cheaper than copying the whole
+          // reference assignment on large models.
+          CopyElements(delta->IntVarContainer(),
+                       reference_assignment_->IntVarContainer(),
+                       assignment_copy->MutableIntVarContainer());
+          CopyElements(delta->IntervalVarContainer(),
+                       reference_assignment_->IntervalVarContainer(),
+                       assignment_copy->MutableIntervalVarContainer());
+          CopyElements(delta->SequenceVarContainer(),
+                       reference_assignment_->SequenceVarContainer(),
+                       assignment_copy->MutableSequenceVarContainer());
         }
       } else {
         if (neighbor_found_) {
@@ -2662,6 +3012,7 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
           //          reference_assignment_->Copy(assignment_);
           pool_->RegisterNewSolution(assignment_);
           SynchronizeAll();
+          assignment_copy_synced = false;
         } else {
           break;
         }
@@ -2674,15 +3025,7 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
 
 bool FindOneNeighbor::FilterAccept(const Assignment* delta,
                                    const Assignment* deltadelta) {
-  bool ok = true;
-  for (int i = 0; i < filters_.size(); ++i) {
-    if (filters_[i]->IsIncremental()) {
-      ok = filters_[i]->Accept(delta, deltadelta) && ok;
-    } else {
-      ok = ok && filters_[i]->Accept(delta, deltadelta);
-    }
-  }
-  return ok;
+  return filters_.Accept(delta, deltadelta);
 }
 
 void FindOneNeighbor::SynchronizeAll() {
@@ -2694,9 +3037,7 @@ void FindOneNeighbor::SynchronizeAll() {
 }
 
 void FindOneNeighbor::SynchronizeFilters(const Assignment* assignment) {
-  for (int i = 0; i < filters_.size(); ++i) {
-    filters_[i]->Synchronize(assignment, nullptr);
-  }
+  filters_.Synchronize(assignment);
 }
 
 // ---------- Local Search Phase Parameters ----------
@@ -3102,6 +3443,221 @@ SolutionPool* Solver::MakeDefaultSolutionPool() {
   return RevAlloc(new DefaultSolutionPool());
 }
 
+// ----- Elite solution pool -----
+
+struct EliteSolutionPool::CurrentSolution {
+  explicit CurrentSolution(const Assignment* const assignment)
+      : assignment(new Assignment(assignment)), move_to_best(false) {}
+  std::unique_ptr<Assignment> assignment;
+  // Set when SyncNeeded() found an elite solution better than the current one.
+  bool move_to_best;
+};
+
+EliteSolutionPool::EliteSolutionPool(int max_size, int64 min_distance,
+                                     bool maximize)
+    : max_size_(max_size),
+      min_distance_(std::max<int64>(min_distance, 1)),
+      maximize_(maximize),
+      num_offered_(0),
+      num_inserted_(0) {
+  CHECK_GT(max_size, 0);
+}
+
+EliteSolutionPool::~EliteSolutionPool() {
+  STLDeleteValues(&current_solutions_);
+}
+
+void EliteSolutionPool::Initialize(Assignment* const assignment) {
+  MutexLock lock(&mutex_);
+  CurrentSolution* const current = MutableCurrentSolution(assignment);
+  // The local search can be a new one on other variables.
+  current->assignment.reset(new Assignment(assignment));
+  current->move_to_best = false;
+  Snapshot snapshot;
+  TakeSnapshot(assignment, &snapshot);
+  AddSnapshot(&snapshot);
+}
+
+void EliteSolutionPool::RegisterNewSolution(Assignment* const assignment) {
+  MutexLock lock(&mutex_);
+  MutableCurrentSolution(assignment)->assignment->Copy(assignment);
+  Snapshot snapshot;
+  TakeSnapshot(assignment, &snapshot);
+  AddSnapshot(&snapshot);
+}
+
+void EliteSolutionPool::GetNextSolution(Assignment* const assignment) {
+  MutexLock lock(&mutex_);
+  CurrentSolution* const current = MutableCurrentSolution(assignment);
+  if (current->move_to_best && !elite_.empty()) {
+    CopySnapshot(elite_[0], current->assignment.get());
+  }
+  current->move_to_best = false;
+  assignment->Copy(current->assignment.get());
+}
+
+bool EliteSolutionPool::SyncNeeded(Assignment* const local_assignment) {
+  MutexLock lock(&mutex_);
+  if (elite_.empty() || !local_assignment->HasObjective()) {
+    return false;
+  }
+  const int64 best = elite_[0].objective;
+  const int64 local = local_assignment->ObjectiveValue();
+  if (maximize_ ? best > local : best < local) {
+    MutableCurrentSolution(local_assignment)->move_to_best = true;
+    return true;
+  }
+  return false;
+}
+
+std::string EliteSolutionPool::DebugString() const {
+  MutexLock lock(&mutex_);
+  return StringPrintf("EliteSolutionPool(%d/%d solutions, %" GG_LL_FORMAT
+                      "d offered, %" GG_LL_FORMAT "d inserted)",
+                      static_cast<int>(elite_.size()), max_size_, num_offered_,
+                      num_inserted_);
+}
+
+bool EliteSolutionPool::AddSolution(const Assignment* const assignment) {
+  Snapshot snapshot;
+  TakeSnapshot(assignment, &snapshot);
+  MutexLock lock(&mutex_);
+  return AddSnapshot(&snapshot);
+}
+
+int EliteSolutionPool::size() const {
+  MutexLock lock(&mutex_);
+  return elite_.size();
+}
+
+int64 EliteSolutionPool::ObjectiveValue(int index) const {
+  MutexLock lock(&mutex_);
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, elite_.size());
+  return elite_[index].objective;
+}
+
+void EliteSolutionPool::RestoreSolution(int index,
+                                        Assignment* const assignment) const {
+  MutexLock lock(&mutex_);
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, elite_.size());
+  CopySnapshot(elite_[index], assignment);
+}
+
+int64 EliteSolutionPool::Distance(int index,
+                                  const Assignment* const assignment) const {
+  Snapshot snapshot;
+  TakeSnapshot(assignment, &snapshot);
+  MutexLock lock(&mutex_);
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, elite_.size());
+  return SnapshotDistance(elite_[index].values, snapshot.values, kint64max);
+}
+
+void EliteSolutionPool::TakeSnapshot(const Assignment* const assignment,
+                                     Snapshot* const snapshot) {
+  const Assignment::IntContainer& container = assignment->IntVarContainer();
+  snapshot->values.resize(container.Size());
+  for (int i = 0; i < container.Size(); ++i) {
+    // Min() rather than Value(): deactivated elements need not be bound.
+    snapshot->values[i] = container.Element(i).Min();
+  }
+  snapshot->objective =
+      assignment->HasObjective() ? assignment->ObjectiveValue() : 0;
+  snapshot->stamp = 0;
+}
+
+void EliteSolutionPool::CopySnapshot(const Snapshot& snapshot,
+                                     Assignment* const assignment) {
+  Assignment::IntContainer* const container =
+      assignment->MutableIntVarContainer();
+  CHECK_EQ(snapshot.values.size(), container->Size());
+  for (int i = 0; i < container->Size(); ++i) {
+    container->MutableElement(i)->SetValue(snapshot.values[i]);
+  }
+  assignment->SetObjectiveValue(snapshot.objective);
+}
+
+int64 EliteSolutionPool::SnapshotDistance(const std::vector<int64>& a,
+                                          const std::vector<int64>& b,
+                                          int64 bound) {
+  DCHECK_EQ(a.size(), b.size());
+  int64 distance = 0;
+  for (int i = 0; i < a.size() && distance < bound; ++i) {
+    if (a[i] != b[i]) {
+      ++distance;
+    }
+  }
+  return distance;
+}
+
+bool EliteSolutionPool::Better(const Snapshot& a, const Snapshot& b) const {
+  if (a.objective != b.objective) {
+    return maximize_ ? a.objective > b.objective : a.objective < b.objective;
+  }
+  return a.stamp > b.stamp;
+}
+
+bool EliteSolutionPool::AddSnapshot(Snapshot* const snapshot) {
+  ++num_offered_;
+  snapshot->stamp = num_offered_;
+  std::vector<int> too_close;
+  for (int i = 0; i < elite_.size(); ++i) {
+    if (elite_[i].values.size() != snapshot->values.size()) {
+      LOG(DFATAL) << "Solution of size " << snapshot->values.size()
+                  << " offered to an elite pool of solutions of size "
+                  << elite_[i].values.size();
+      return false;
+    }
+    if (SnapshotDistance(elite_[i].values, snapshot->values, min_distance_) <
+        min_distance_) {
+      if (!Better(*snapshot, elite_[i])) {
+        return false;
+      }
+      too_close.push_back(i);
+    }
+  }
+  if (!too_close.empty()) {
+    // Elite solutions are sorted, so too_close[0] is the best one removed.
+    for (int i = too_close.size() - 1; i > 0; --i) {
+      elite_.erase(elite_.begin() + too_close[i]);
+    }
+    elite_[too_close[0]].values.swap(snapshot->values);
+    elite_[too_close[0]].objective = snapshot->objective;
+    elite_[too_close[0]].stamp = snapshot->stamp;
+  } else if (elite_.size() < max_size_) {
+    elite_.push_back(*snapshot);
+  } else if (Better(*snapshot, elite_.back())) {
+    elite_.back().values.swap(snapshot->values);
+    elite_.back().objective = snapshot->objective;
+    elite_.back().stamp = snapshot->stamp;
+  } else {
+    return false;
+  }
+  ++num_inserted_;
+  std::sort(elite_.begin(), elite_.end(),
+            [this](const Snapshot& a, const Snapshot& b) {
+              return Better(a, b);
+            });
+  return true;
+}
+
+EliteSolutionPool::CurrentSolution* EliteSolutionPool::MutableCurrentSolution(
+    const Assignment* const assignment) {
+  CurrentSolution*& current = current_solutions_[assignment->solver()];
+  if (current == nullptr) {
+    current = new CurrentSolution(assignment);
+  }
+  return current;
+}
+
+EliteSolutionPool* Solver::MakeEliteSolutionPool(int max_size,
+                                                 int64 min_distance,
+                                                 bool maximize) {
+  return RevAlloc(new EliteSolutionPool(max_size, min_distance, maximize));
+}
+
 DecisionBuilder* Solver::MakeLocalSearchPhase(
     Assignment* assignment, LocalSearchPhaseParameters* parameters) {
   return RevAlloc(new LocalSearch(assignment, parameters->solution_pool(),
@@ -13,17 +13,22 @@
 
 
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stl_util.h"
+#include "base/stringprintf.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 
 DECLARE_int32(cache_initial_size);
 DEFINE_bool(cp_disable_cache, false, "Disable caching of model objects");
+DEFINE_bool(cp_print_cache_statistics, false,
+            "Log the hit rates of the model cache when the solver is deleted.");
 
 namespace operations_research {
 // ----- ModelCache -----
@@ -82,114 +87,146 @@ uint64 Hash4(const A1& a1, const A2& a2, const A3& a3, const A4& a4) {
   return c;
 }
 
-template <class C>
-void Double(C*** array_ptr, int* size_ptr) {
-  DCHECK(array_ptr != nullptr);
-  DCHECK(size_ptr != nullptr);
-  C** const old_cell_array = *array_ptr;
-  const int old_size = *size_ptr;
-  (*size_ptr) *= 2;
-  (*array_ptr) = new C* [(*size_ptr)];
-  memset(*array_ptr, 0, (*size_ptr) * sizeof(**array_ptr));
-  for (int i = 0; i < old_size; ++i) {
-    C* tmp = old_cell_array[i];
-    while (tmp != nullptr) {
-      C* const to_reinsert = tmp;
-      tmp = tmp->next();
-      const uint64 position = to_reinsert->Hash() % (*size_ptr);
-      to_reinsert->set_next((*array_ptr)[position]);
-      (*array_ptr)[position] = to_reinsert;
-    }
-  }
-  delete[](old_cell_array);
-}
-
-// ----- Cache objects built with 1 object -----
-
-template <class C, class A1>
-class Cache1 {
+// ----- Open addressing table -----
+
+// Flat hash table with linear probing, used by all the caches below. Each
+// slot stores the hash of its key, which is computed once per operation: the
+// keys are only compared when the hashes match, and growing the table does
+// not rehash them. This matters for the keys made of arrays, whose hash is
+// linear in their size. The table also counts lookups and hits.
+// The storage is only allocated on the first insertion, as most of the caches
+// of a solver stay empty.
+template <class C, class Key>
+class CacheTable {
  public:
-  Cache1()
-      : array_(new Cell* [FLAGS_cache_initial_size]),
-        size_(FLAGS_cache_initial_size),
-        num_items_(0) {
-    memset(array_, 0, sizeof(*array_) * size_);
-  }
-
-  ~Cache1() {
-    for (int i = 0; i < size_; ++i) {
-      Cell* tmp = array_[i];
-      while (tmp != nullptr) {
-        Cell* const to_delete = tmp;
-        tmp = tmp->next();
-        delete to_delete;
-      }
-    }
-    delete[] array_;
-  }
+  CacheTable() : num_items_(0), num_lookups_(0), num_hits_(0) {}
 
   void Clear() {
-    for (int i = 0; i < size_; ++i) {
-      Cell* tmp = array_[i];
-      while (tmp != nullptr) {
-        Cell* const to_delete = tmp;
-        tmp = tmp->next();
-        delete to_delete;
-      }
-      array_[i] = nullptr;
+    for (int i = 0; i < slots_.size(); ++i) {
+      slots_[i] = Slot();
     }
+    num_items_ = 0;
   }
 
-  C* Find(const A1& a1) const {
-    uint64 code = Hash1(a1) % size_;
-    Cell* tmp = array_[code];
-    while (tmp) {
-      C* const result = tmp->ReturnsIfEqual(a1);
-      if (result != nullptr) {
-        return result;
-      }
-      tmp = tmp->next();
+  // 'matches' is a functor returning true if a key is equal to the searched
+  // one, whose hash is 'hash'.
+  template <class Matcher>
+  C* Find(uint64 hash, const Matcher& matches) const {
+    ++num_lookups_;
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    C* const result = slots_[Lookup(hash, matches)].value;
+    if (result != nullptr) {
+      ++num_hits_;
     }
-    return nullptr;
+    return result;
   }
 
-  void UnsafeInsert(const A1& a1, C* const c) {
-    const int position = Hash1(a1) % size_;
-    Cell* const cell = new Cell(a1, c, array_[position]);
-    array_[position] = cell;
-    if (++num_items_ > 2 * size_) {
-      Double(&array_, &size_);
+  // Inserts 'value' with the given key, if the key is not already present.
+  template <class Matcher>
+  void Insert(uint64 hash, const Matcher& matches, const Key& key,
+              C* const value) {
+    DCHECK(value != nullptr);
+    if (slots_.empty()) {
+      int size = 1;
+      while (size < FLAGS_cache_initial_size) {
+        size *= 2;
+      }
+      slots_.resize(size);
+    }
+    Slot* const slot = &slots_[Lookup(hash, matches)];
+    if (slot->value == nullptr) {
+      slot->hash = hash;
+      slot->key = key;
+      slot->value = value;
+      if (++num_items_ * 2 > slots_.size()) {
+        Grow();
+      }
     }
   }
 
+  int num_items() const { return num_items_; }
+  int64 num_lookups() const { return num_lookups_; }
+  int64 num_hits() const { return num_hits_; }
+
  private:
-  class Cell {
-   public:
-    Cell(const A1& a1, C* const container, Cell* const next)
-        : a1_(a1), container_(container), next_(next) {}
-
-    C* ReturnsIfEqual(const A1& a1) const {
-      if (IsEqual(a1_, a1)) {
-        return container_;
+  struct Slot {
+    Slot() : hash(0), value(nullptr) {}
+    uint64 hash;
+    Key key;
+    C* value;  // nullptr for an empty slot.
+  };
+
+  // Returns the slot holding the searched key, or the empty slot where it
+  // should be inserted.
+  template <class Matcher>
+  int Lookup(uint64 hash, const Matcher& matches) const {
+    const uint64 mask = slots_.size() - 1;
+    uint64 index = hash & mask;
+    while (slots_[index].value != nullptr &&
+           (slots_[index].hash != hash || !matches(slots_[index].key))) {
+      index = (index + 1) & mask;
+    }
+    return index;
+  }
+
+  void Grow() {
+    std::vector<Slot> old_slots(slots_.size() * 2);
+    old_slots.swap(slots_);
+    const uint64 mask = slots_.size() - 1;
+    for (Slot& old_slot : old_slots) {
+      if (old_slot.value != nullptr) {
+        uint64 index = old_slot.hash & mask;
+        while (slots_[index].value != nullptr) {
+          index = (index + 1) & mask;
+        }
+        slots_[index].hash = old_slot.hash;
+        slots_[index].key.swap(old_slot.key);
+        slots_[index].value = old_slot.value;
       }
-      return nullptr;
     }
+  }
+
+  std::vector<Slot> slots_;
+  int num_items_;
+  mutable int64 num_lookups_;
+  mutable int64 num_hits_;
+};
 
-    uint64 Hash() const { return Hash1(a1_); }
+// Arguments are stored by value in the keys, even when the cache is declared
+// with a reference type.
+template <class A>
+struct KeyType {
+  typedef typename std::remove_const<
+      typename std::remove_reference<A>::type>::type Type;
+};
 
-    void set_next(Cell* const next) { next_ = next; }
+// ----- Cache objects built with 1 object -----
 
-    Cell* next() const { return next_; }
+template <class C, class A1>
+class Cache1 {
+ public:
+  typedef std::tuple<typename KeyType<A1>::Type> Key;
 
-   private:
-    const A1 a1_;
-    C* const container_;
-    Cell* next_;
-  };
+  void Clear() { table_.Clear(); }
 
-  Cell** array_;
-  int size_;
-  int num_items_;
+  C* Find(const A1& a1) const {
+    return table_.Find(Hash1(a1), [&a1](const Key& key) {
+      return IsEqual(std::get<0>(key), a1);
+    });
+  }
+
+  void Insert(const A1& a1, C* const c) {
+    table_.Insert(Hash1(a1), [&a1](const Key& key) {
+      return IsEqual(std::get<0>(key), a1);
+    }, Key(a1), c);
+  }
+
+  const CacheTable<C, Key>& table() const { return table_; }
+
+ private:
+  CacheTable<C, Key> table_;
 };
 
 // ----- Cache objects built with 2 objects -----
@@ -197,181 +234,74 @@ class Cache1 {
 template <class C, class A1, class A2>
 class Cache2 {
  public:
-  Cache2()
-      : array_(new Cell* [FLAGS_cache_initial_size]),
-        size_(FLAGS_cache_initial_size),
-        num_items_(0) {
-    memset(array_, 0, sizeof(*array_) * size_);
-  }
-
-  ~Cache2() {
-    for (int i = 0; i < size_; ++i) {
-      Cell* tmp = array_[i];
-      while (tmp != nullptr) {
-        Cell* const to_delete = tmp;
-        tmp = tmp->next();
-        delete to_delete;
-      }
-    }
-    delete[] array_;
-  }
+  typedef std::tuple<typename KeyType<A1>::Type, typename KeyType<A2>::Type>
+      Key;
 
-  void Clear() {
-    for (int i = 0; i < size_; ++i) {
-      Cell* tmp = array_[i];
-      while (tmp != nullptr) {
-        Cell* const to_delete = tmp;
-        tmp = tmp->next();
-        delete to_delete;
-      }
-      array_[i] = nullptr;
-    }
-  }
+  void Clear() { table_.Clear(); }
 
   C* Find(const A1& a1, const A2& a2) const {
-    uint64 code = Hash2(a1, a2) % size_;
-    Cell* tmp = array_[code];
-    while (tmp) {
-      C* const result = tmp->ReturnsIfEqual(a1, a2);
-      if (result != nullptr) {
-        return result;
-      }
-      tmp = tmp->next();
-    }
-    return nullptr;
+    return table_.Find(Hash2(a1, a2), [&a1, &a2](const Key& key) {
+      return IsEqual(std::get<0>(key), a1) && IsEqual(std::get<1>(key), a2);
+    });
   }
 
-  void UnsafeInsert(const A1& a1, const A2& a2, C* const c) {
-    const int position = Hash2(a1, a2) % size_;
-    Cell* const cell = new Cell(a1, a2, c, array_[position]);
-    array_[position] = cell;
-    if (++num_items_ > 2 * size_) {
-      Double(&array_, &size_);
-    }
+  void Insert(const A1& a1, const A2& a2, C* const c) {
+    table_.Insert(Hash2(a1, a2), [&a1, &a2](const Key& key) {
+      return IsEqual(std::get<0>(key), a1) && IsEqual(std::get<1>(key), a2);
+    }, Key(a1, a2), c);
   }
 
- private:
-  class Cell {
-   public:
-    Cell(const A1& a1, const A2& a2, C* const container, Cell* const next)
-        : a1_(a1), a2_(a2), container_(container), next_(next) {}
-
-    C* ReturnsIfEqual(const A1& a1, const A2& a2) const {
-      if (IsEqual(a1_, a1) && IsEqual(a2_, a2)) {
-        return container_;
-      }
-      return nullptr;
-    }
-
-    uint64 Hash() const { return Hash2(a1_, a2_); }
-
-    void set_next(Cell* const next) { next_ = next; }
+  const CacheTable<C, Key>& table() const { return table_; }
 
-    Cell* next() const { return next_; }
-
-   private:
-    const A1 a1_;
-    const A2 a2_;
-    C* const container_;
-    Cell* next_;
-  };
-
-  Cell** array_;
-  int size_;
-  int num_items_;
+ private:
+  CacheTable<C, Key> table_;
 };
 
-// ----- Cache objects built with 2 objects -----
+// ----- Cache objects built with 3 objects -----
 
 template <class C, class A1, class A2, class A3>
 class Cache3 {
  public:
-  Cache3()
-      : array_(new Cell* [FLAGS_cache_initial_size]),
-        size_(FLAGS_cache_initial_size),
-        num_items_(0) {
-    memset(array_, 0, sizeof(*array_) * size_);
-  }
-
-  ~Cache3() {
-    for (int i = 0; i < size_; ++i) {
-      Cell* tmp = array_[i];
-      while (tmp != nullptr) {
-        Cell* const to_delete = tmp;
-        tmp = tmp->next();
-        delete to_delete;
-      }
-    }
-    delete[] array_;
-  }
+  typedef std::tuple<typename KeyType<A1>::Type, typename KeyType<A2>::Type,
+                     typename KeyType<A3>::Type> Key;
 
-  void Clear() {
-    for (int i = 0; i < size_; ++i) {
-      Cell* tmp = array_[i];
-      while (tmp != nullptr) {
-        Cell* const to_delete = tmp;
-        tmp = tmp->next();
-        delete to_delete;
-      }
-      array_[i] = nullptr;
-    }
-  }
+  void Clear() { table_.Clear(); }
 
   C* Find(const A1& a1, const A2& a2, const A3& a3) const {
-    uint64 code = Hash3(a1, a2, a3) % size_;
-    Cell* tmp = array_[code];
-    while (tmp) {
-      C* const result = tmp->ReturnsIfEqual(a1, a2, a3);
-      if (result != nullptr) {
-        return result;
-      }
-      tmp = tmp->next();
-    }
-    return nullptr;
+    return table_.Find(Hash3(a1, a2, a3), [&a1, &a2, &a3](const Key& key) {
+      return IsEqual(std::get<0>(key), a1) && IsEqual(std::get<1>(key), a2) &&
+             IsEqual(std::get<2>(key), a3);
+    });
   }
 
-  void UnsafeInsert(const A1& a1, const A2& a2, const A3& a3, C* const c) {
-    const int position = Hash3(a1, a2, a3) % size_;
-    Cell* const cell = new Cell(a1, a2, a3, c, array_[position]);
-    array_[position] = cell;
-    if (++num_items_ > 2 * size_) {
-      Double(&array_, &size_);
-    }
+  void Insert(const A1& a1, const A2& a2, const A3& a3, C* const c) {
+    table_.Insert(Hash3(a1, a2, a3), [&a1, &a2, &a3](const Key& key) {
+      return IsEqual(std::get<0>(key), a1) && IsEqual(std::get<1>(key), a2) &&
+             IsEqual(std::get<2>(key), a3);
+    }, Key(a1, a2, a3), c);
   }
 
- private:
-  class Cell {
-   public:
-    Cell(const A1& a1, const A2& a2, const A3& a3, C* const container,
-         Cell* const next)
-        : a1_(a1), a2_(a2), a3_(a3), container_(container), next_(next) {}
-
-    C* ReturnsIfEqual(const A1& a1, const A2& a2, const A3& a3) const {
-      if (IsEqual(a1_, a1) && IsEqual(a2_, a2) && IsEqual(a3_, a3)) {
-        return container_;
-      }
-      return nullptr;
-    }
-
-    uint64 Hash() const { return Hash3(a1_, a2_, a3_); }
-
-    void set_next(Cell* const next) { next_ = next; }
-
-    Cell* next() const { return next_; }
-
-   private:
-    const A1 a1_;
-    const A2 a2_;
-    const A3 a3_;
-    C* const container_;
-    Cell* next_;
-  };
+  const CacheTable<C, Key>& table() const { return table_; }
 
-  Cell** array_;
-  int size_;
-  int num_items_;
+ private:
+  CacheTable<C, Key> table_;
 };
 
+// Logs the hit rates of a family of caches, one per type.
+template <class Cache>
+void LogCacheStatistics(const std::string& name,
+                        const std::vector<Cache*>& caches) {
+  for (int i = 0; i < caches.size(); ++i) {
+    const auto& table = caches[i]->table();
+    if (table.num_lookups() > 0) {
+      LOG(INFO) << StringPrintf(
+          "  %s[%d]: %lld lookups, %lld hits (%.1f%%), %d items",
+          name.c_str(), i, table.num_lookups(), table.num_hits(),
+          100.0 * table.num_hits() / table.num_lookups(), table.num_items());
+    }
+  }
+}
+
 // ----- Model Cache -----
 
 class NonReversibleCache : public ModelCache {
@@ -444,6 +374,27 @@ class NonReversibleCache : public ModelCache {
   }
 
   virtual ~NonReversibleCache() {
+    if (FLAGS_cp_print_cache_statistics) {
+      LOG(INFO) << "Model cache statistics:";
+      LogCacheStatistics("VarConstantConstraint", var_constant_constraints_);
+      LogCacheStatistics("ExprExprConstraint", expr_expr_constraints_);
+      LogCacheStatistics("VarConstantConstantConstraint",
+                         var_constant_constant_constraints_);
+      LogCacheStatistics("ExprExpression", expr_expressions_);
+      LogCacheStatistics("ExprConstantExpression", expr_constant_expressions_);
+      LogCacheStatistics("ExprExprExpression", expr_expr_expressions_);
+      LogCacheStatistics("VarConstantConstantExpression",
+                         var_constant_constant_expressions_);
+      LogCacheStatistics("VarConstantArrayExpression",
+                         var_constant_array_expressions_);
+      LogCacheStatistics("VarArrayExpression", var_array_expressions_);
+      LogCacheStatistics("VarArrayConstantArrayExpression",
+                         var_array_constant_array_expressions_);
+      LogCacheStatistics("VarArrayConstantExpression",
+                         var_array_constant_expressions_);
+      LogCacheStatistics("ExprExprConstantExpression",
+                         expr_expr_constant_expressions_);
+    }
     STLDeleteElements(&var_constant_constraints_);
     STLDeleteElements(&expr_expr_constraints_);
     STLDeleteElements(&var_constant_constant_constraints_);
@@ -534,9 +485,8 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, VAR_CONSTANT_CONSTRAINT_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        var_constant_constraints_[type]->Find(var, value) == nullptr) {
-      var_constant_constraints_[type]->UnsafeInsert(var, value, ct);
+        !FLAGS_cp_disable_cache) {
+      var_constant_constraints_[type]->Insert(var, value, ct);
     }
   }
 
@@ -559,11 +509,9 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, VAR_CONSTANT_CONSTANT_CONSTRAINT_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        var_constant_constant_constraints_[type]->Find(var, value1, value2) ==
-            nullptr) {
+        !FLAGS_cp_disable_cache) {
       var_constant_constant_constraints_[type]
-          ->UnsafeInsert(var, value1, value2, ct);
+          ->Insert(var, value1, value2, ct);
     }
   }
 
@@ -589,9 +537,8 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, EXPR_EXPR_CONSTRAINT_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        expr_expr_constraints_[type]->Find(var1, var2) == nullptr) {
-      expr_expr_constraints_[type]->UnsafeInsert(var1, var2, ct);
+        !FLAGS_cp_disable_cache) {
+      expr_expr_constraints_[type]->Insert(var1, var2, ct);
     }
   }
 
@@ -613,9 +560,8 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, EXPR_EXPRESSION_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        expr_expressions_[type]->Find(expr) == nullptr) {
-      expr_expressions_[type]->UnsafeInsert(expr, expression);
+        !FLAGS_cp_disable_cache) {
+      expr_expressions_[type]->Insert(expr, expression);
     }
   }
 
@@ -637,9 +583,8 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, EXPR_CONSTANT_EXPRESSION_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        expr_constant_expressions_[type]->Find(expr, value) == nullptr) {
-      expr_constant_expressions_[type]->UnsafeInsert(expr, value, expression);
+        !FLAGS_cp_disable_cache) {
+      expr_constant_expressions_[type]->Insert(expr, value, expression);
     }
   }
 
@@ -665,9 +610,8 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, EXPR_EXPR_EXPRESSION_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        expr_expr_expressions_[type]->Find(var1, var2) == nullptr) {
-      expr_expr_expressions_[type]->UnsafeInsert(var1, var2, expression);
+        !FLAGS_cp_disable_cache) {
+      expr_expr_expressions_[type]->Insert(var1, var2, expression);
     }
   }
 
@@ -692,10 +636,9 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, EXPR_EXPR_CONSTANT_EXPRESSION_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache && expr_expr_constant_expressions_[type]->Find(
-                                       var1, var2, constant) == nullptr) {
+        !FLAGS_cp_disable_cache) {
       expr_expr_constant_expressions_[type]
-          ->UnsafeInsert(var1, var2, constant, expression);
+          ->Insert(var1, var2, constant, expression);
     }
   }
 
@@ -718,11 +661,9 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, VAR_CONSTANT_CONSTANT_EXPRESSION_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        var_constant_constant_expressions_[type]->Find(var, value1, value2) ==
-            nullptr) {
+        !FLAGS_cp_disable_cache) {
       var_constant_constant_expressions_[type]
-          ->UnsafeInsert(var, value1, value2, expression);
+          ->Insert(var, value1, value2, expression);
     }
   }
 
@@ -745,10 +686,9 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, VAR_CONSTANT_ARRAY_EXPRESSION_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        var_constant_array_expressions_[type]->Find(var, values) == nullptr) {
+        !FLAGS_cp_disable_cache) {
       var_constant_array_expressions_[type]
-          ->UnsafeInsert(var, values, expression);
+          ->Insert(var, values, expression);
     }
   }
 
@@ -768,9 +708,8 @@ class NonReversibleCache : public ModelCache {
     DCHECK_GE(type, 0);
     DCHECK_LT(type, VAR_ARRAY_EXPRESSION_MAX);
     if (solver()->state() == Solver::OUTSIDE_SEARCH &&
-        !FLAGS_cp_disable_cache &&
-        var_array_expressions_[type]->Find(vars) == nullptr) {
-      var_array_expressions_[type]->UnsafeInsert(vars, expression);
+        !FLAGS_cp_disable_cache) {
+      var_array_expressions_[type]->Insert(vars, expression);
     }
   }
 
@@ -790,11 +729,9 @@ class NonReversibleCache : public ModelCache {
     DCHECK(expression != nullptr);
     DCHECK_GE(type, 0);
     DCHECK_LT(type, VAR_ARRAY_CONSTANT_ARRAY_EXPRESSION_MAX);
-    if (solver()->state() != Solver::IN_SEARCH &&
-        var_array_constant_array_expressions_[type]->Find(vars, values) ==
-            nullptr) {
+    if (solver()->state() != Solver::IN_SEARCH) {
       var_array_constant_array_expressions_[type]
-          ->UnsafeInsert(vars, values, expression);
+          ->Insert(vars, values, expression);
     }
   }
 
@@ -814,10 +751,9 @@ class NonReversibleCache : public ModelCache {
     DCHECK(expression != nullptr);
     DCHECK_GE(type, 0);
     DCHECK_LT(type, VAR_ARRAY_CONSTANT_EXPRESSION_MAX);
-    if (solver()->state() != Solver::IN_SEARCH &&
-        var_array_constant_expressions_[type]->Find(vars, value) == nullptr) {
+    if (solver()->state() != Solver::IN_SEARCH) {
       var_array_constant_expressions_[type]
-          ->UnsafeInsert(vars, value, expression);
+          ->Insert(vars, value, expression);
     }
   }
 
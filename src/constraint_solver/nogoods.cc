@@ -12,6 +12,7 @@
 // limitations under the License.
 
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -186,10 +187,166 @@ class NaiveNoGoodManager : public NoGoodManager {
 };
 }  // namespace
 
+// ----- WatchedNoGoodManager -----
+
+// This implementation only looks at two terms per nogood, the watched terms,
+// which are always the first two terms of the nogood. A nogood can only
+// propagate when at most one of its terms is not always true, so as long as
+// none of its watched terms is always true, there is nothing to do. When a
+// watched term becomes always true, it is swapped with a term that is not.
+// As in SAT solvers, the watches don't need to be restored upon backtrack:
+// backtracking never makes an undecided term decided.
+//
+// Each nogood also has an activity, bumped each time it propagates, and
+// decayed each time a nogood is added. When there are more than
+// max_no_goods nogoods, the least active half of them is deleted.
+class WatchedNoGoodManager : public NoGoodManager {
+ public:
+  WatchedNoGoodManager(Solver* const solver, int max_no_goods)
+      : NoGoodManager(solver),
+        max_no_goods_(std::max(1, max_no_goods)),
+        activity_increment_(1.0) {}
+  virtual ~WatchedNoGoodManager() { Clear(); }
+
+  virtual void Clear() {
+    for (const NoGoodWithActivity& entry : nogoods_) delete entry.nogood;
+    nogoods_.clear();
+    activity_increment_ = 1.0;
+  }
+
+  virtual void Init() {}
+
+  virtual void AddNoGood(NoGood* const nogood) {
+    activity_increment_ /= kActivityDecay;
+    if (activity_increment_ > kMaxActivity) RescaleActivities();
+    nogoods_.push_back(NoGoodWithActivity(nogood, activity_increment_));
+    if (nogoods_.size() > max_no_goods_) DeleteInactiveNoGoods();
+  }
+
+  virtual int NoGoodCount() const { return nogoods_.size(); }
+
+  virtual void Apply() {
+    for (NoGoodWithActivity& entry : nogoods_) {
+      Propagate(&entry);
+    }
+  }
+
+  std::string DebugString() const {
+    return StringPrintf("WatchedNoGoodManager(%d)", NoGoodCount());
+  }
+
+ private:
+  struct NoGoodWithActivity {
+    NoGoodWithActivity(NoGood* const n, double a) : nogood(n), activity(a) {}
+    NoGood* nogood;
+    double activity;
+  };
+
+  static const double kActivityDecay;
+  static const double kMaxActivity;
+
+  // Same semantics as NoGood::Apply().
+  void Propagate(NoGoodWithActivity* const entry) {
+    std::vector<NoGoodTerm*>& terms = entry->nogood->terms_;
+    const int size = terms.size();
+    if (size == 0) return;
+    // A missing second term behaves as an always true one.
+    NoGoodTerm::TermStatus status[2] = {terms[0]->Evaluate(),
+                                        NoGoodTerm::ALWAYS_TRUE};
+    if (size == 1) {
+      if (status[0] == NoGoodTerm::ALWAYS_FALSE) return;
+    } else {
+      // Fast path: the nogood is satisfied, or it still has two undecided
+      // terms.
+      if (status[0] == NoGoodTerm::ALWAYS_FALSE) return;
+      status[1] = terms[1]->Evaluate();
+      if (status[1] == NoGoodTerm::ALWAYS_FALSE) return;
+      if (status[0] == NoGoodTerm::UNDECIDED &&
+          status[1] == NoGoodTerm::UNDECIDED) {
+        return;
+      }
+      // Replace the always true watched terms, if possible.
+      int next = 2;
+      for (int w = 0; w < 2; ++w) {
+        if (status[w] != NoGoodTerm::ALWAYS_TRUE) continue;
+        for (; next < size; ++next) {
+          const NoGoodTerm::TermStatus next_status = terms[next]->Evaluate();
+          if (next_status == NoGoodTerm::ALWAYS_FALSE) {
+            std::swap(terms[w], terms[next]);
+            return;
+          }
+          if (next_status == NoGoodTerm::UNDECIDED) {
+            std::swap(terms[w], terms[next]);
+            status[w] = NoGoodTerm::UNDECIDED;
+            ++next;
+            break;
+          }
+        }
+      }
+      if (status[0] == NoGoodTerm::UNDECIDED &&
+          status[1] == NoGoodTerm::UNDECIDED) {
+        return;
+      }
+    }
+    // All the terms but the watched ones are always true.
+    BumpActivity(entry);
+    if (status[0] == NoGoodTerm::UNDECIDED) {
+      VLOG(2) << "No Good " << entry->nogood->DebugString() << " -> Refute "
+              << terms[0]->DebugString();
+      terms[0]->Refute();
+    } else if (status[1] == NoGoodTerm::UNDECIDED) {
+      VLOG(2) << "No Good " << entry->nogood->DebugString() << " -> Refute "
+              << terms[1]->DebugString();
+      terms[1]->Refute();
+    } else {
+      VLOG(2) << "No Good " << entry->nogood->DebugString() << " -> Fail";
+      solver()->Fail();
+    }
+  }
+
+  void BumpActivity(NoGoodWithActivity* const entry) {
+    entry->activity += activity_increment_;
+    if (entry->activity > kMaxActivity) RescaleActivities();
+  }
+
+  void RescaleActivities() {
+    const double kScale = 1.0 / kMaxActivity;
+    for (NoGoodWithActivity& entry : nogoods_) entry.activity *= kScale;
+    activity_increment_ *= kScale;
+  }
+
+  // Keeps the most active half of the nogoods. Ties are broken in favor of
+  // the most recent nogoods.
+  void DeleteInactiveNoGoods() {
+    std::stable_sort(nogoods_.begin(), nogoods_.end(),
+                     [](const NoGoodWithActivity& a,
+                        const NoGoodWithActivity& b) {
+      return a.activity > b.activity;
+    });
+    const int num_kept = (max_no_goods_ + 1) / 2;
+    for (int i = num_kept; i < nogoods_.size(); ++i) {
+      delete nogoods_[i].nogood;
+    }
+    nogoods_.erase(nogoods_.begin() + num_kept, nogoods_.end());
+    VLOG(1) << "Deleted the least active nogoods, " << num_kept << " left";
+  }
+
+  const int max_no_goods_;
+  double activity_increment_;
+  std::vector<NoGoodWithActivity> nogoods_;
+};
+
+const double WatchedNoGoodManager::kActivityDecay = 0.95;
+const double WatchedNoGoodManager::kMaxActivity = 1e100;
+
 // ----- API -----
 
 NoGoodManager* Solver::MakeNoGoodManager() {
-  return RevAlloc(new NaiveNoGoodManager(this));
+  return MakeNoGoodManager(DefaultPhaseParameters::kDefaultMaxNoGoods);
+}
+
+NoGoodManager* Solver::MakeNoGoodManager(int max_no_goods) {
+  return RevAlloc(new WatchedNoGoodManager(this, max_no_goods));
 }
 
 }  // namespace operations_research
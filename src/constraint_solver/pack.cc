@@ -21,13 +21,20 @@
 #include <utility>
 #include <vector>
 
+#include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
 #include "base/join.h"
+#include "algorithms/knapsack_solver.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 
+DEFINE_bool(cp_pack_use_knapsack_filtering, false,
+            "Restrict the load variables of the weighted sum equal var "
+            "dimensions of Pack to the loads reachable by a subset of the "
+            "undecided items of each bin, using a knapsack solver.");
+
 namespace operations_research {
 
 // ---------- Dimension ----------
@@ -94,6 +101,10 @@ class Dimension : public BaseObject {
     pack_->AssignFirstPossibleToBin(bin_index);
   }
 
+  void AppendUndecidedItems(int bin_index, std::vector<int>* items) const {
+    pack_->AppendUndecidedItems(bin_index, items);
+  }
+
   void AssignAllRemainingItems() { pack_->AssignAllRemainingItems(); }
 
   void UnassignAllRemainingItems() { pack_->UnassignAllRemainingItems(); }
@@ -140,16 +151,26 @@ void Pack::Post() {
 }
 
 void Pack::ClearAll() {
-  for (int bin_index = 0; bin_index <= bins_; ++bin_index) {
+  for (const int bin_index : touched_bins_) {
     forced_[bin_index].clear();
     removed_[bin_index].clear();
   }
+  touched_bins_.clear();
   to_set_.clear();
   to_unset_.clear();
   in_process_ = false;
   stamp_ = solver()->fail_stamp();
 }
 
+// Must be called before adding an item to forced_[bin_index] or
+// removed_[bin_index]. With thousands of bins, this keeps Propagate() and
+// ClearAll() proportional to the number of bins that actually changed.
+void Pack::TouchBin(int bin_index) {
+  if (forced_[bin_index].empty() && removed_[bin_index].empty()) {
+    touched_bins_.push_back(bin_index);
+  }
+}
+
 void Pack::PropagateDelayed() {
   for (int i = 0; i < to_set_.size(); ++i) {
     vars_[to_set_[i].first]->SetValue(to_set_[i].second);
@@ -196,6 +217,7 @@ void Pack::InitialPropagate() {
     if (var->Bound()) {
       const int64 value = var->Min();
       if (value < bins_) {
+        TouchBin(value);
         forced_[value].push_back(var_index);
         data->PushAssigned(var_index);
       } else {
@@ -275,8 +297,10 @@ void Pack::Propagate() {
   const bool need_context = solver()->InstrumentsVariables();
   in_process_ = true;
   DCHECK_EQ(stamp_, solver()->fail_stamp());
-  for (int bin_index = 0; bin_index < bins_; ++bin_index) {
-    if (!removed_[bin_index].empty() || !forced_[bin_index].empty()) {
+  // Bins are visited in increasing order, as if all of them were scanned.
+  std::sort(touched_bins_.begin(), touched_bins_.end());
+  for (const int bin_index : touched_bins_) {
+    if (bin_index < bins_) {
       if (need_context) {
         solver()->GetPropagationMonitor()->PushContext(StringPrintf(
             "Pack(bin %d, forced = [%s], removed = [%s])", bin_index,
@@ -349,6 +373,7 @@ void Pack::OneDomain(int var_index) {
        ++value) {
     if (unprocessed_->IsSet(value, var_index)) {
       unprocessed_->SetToZero(s, value, var_index);
+      TouchBin(value);
       removed_[value].push_back(var_index);
     }
   }
@@ -358,6 +383,7 @@ void Pack::OneDomain(int var_index) {
           value <= std::min(static_cast<int64>(bins_), vmax)) {
         DCHECK(unprocessed_->IsSet(value, var_index));
         unprocessed_->SetToZero(s, value, var_index);
+        TouchBin(value);
         removed_[value].push_back(var_index);
       }
     }
@@ -366,11 +392,13 @@ void Pack::OneDomain(int var_index) {
        value <= std::min(oldmax, static_cast<int64>(bins_)); ++value) {
     if (unprocessed_->IsSet(value, var_index)) {
       unprocessed_->SetToZero(s, value, var_index);
+      TouchBin(value);
       removed_[value].push_back(var_index);
     }
   }
   if (bound) {
     unprocessed_->SetToZero(s, var->Min(), var_index);
+    TouchBin(var->Min());
     forced_[var->Min()].push_back(var_index);
   }
   EnqueueDelayedDemon(demon_);
@@ -479,6 +507,16 @@ void Pack::AssignFirstPossibleToBin(int bin_index) {
   }
 }
 
+void Pack::AppendUndecidedItems(int bin_index, std::vector<int>* items) const {
+  int var_index = unprocessed_->GetFirstBit(bin_index, 0);
+  while (var_index != -1 && var_index < vars_.size()) {
+    items->push_back(var_index);
+    var_index = var_index == vars_.size() - 1
+                    ? -1
+                    : unprocessed_->GetFirstBit(bin_index, var_index + 1);
+  }
+}
+
 void Pack::AssignAllRemainingItems() {
   int var_index = unprocessed_->GetFirstBit(bins_, 0);
   while (var_index != -1 && var_index < vars_.size()) {
@@ -854,6 +892,64 @@ class DimensionLessThanConstantCallback2 : public Dimension {
   std::vector<std::vector<int>> ranked_;
 };
 
+// Knapsack-based filtering of a bin load: given the sum of the weights of
+// the items assigned to the bin and the weights of its undecided items, the
+// load can only take values reachable by adding a subset of the undecided
+// weights. The bounds of the load variable are moved to the closest such
+// values by solving two subset sum problems. The dimensions only use it on
+// bins with at most kMaxItems undecided items, which bounds its cost.
+class BinLoadKnapsackFilter {
+ public:
+  static const int kMaxItems = 64;
+
+  BinLoadKnapsackFilter()
+      : solver_(KnapsackSolver::KNAPSACK_64ITEMS_SOLVER, "PackLoadFilter"),
+        weights_(1),
+        total_weight_(0) {}
+
+  void Clear() {
+    profits_.clear();
+    weights_[0].clear();
+    total_weight_ = 0;
+  }
+
+  // Adds an undecided item to the bin.
+  void AddItem(int64 weight) {
+    if (weight > 0) {
+      profits_.push_back(weight);
+      weights_[0].push_back(weight);
+      total_weight_ += weight;
+    }
+  }
+
+  // 'sum_min' is the load of the assigned items, and 'sum_max' this load plus
+  // the weights of all undecided items. Nothing is done if the added items do
+  // not account for sum_max - sum_min, which happens when some decisions made
+  // on the bin are not yet processed by Pack.
+  void Filter(IntVar* const load, int64 sum_min, int64 sum_max) {
+    if (profits_.size() < 2 || total_weight_ != sum_max - sum_min) {
+      return;
+    }
+    load->SetMax(sum_min + MaxSubsetSum(load->Max() - sum_min));
+    load->SetMin(sum_max - MaxSubsetSum(sum_max - load->Min()));
+  }
+
+ private:
+  // Returns the largest sum of undecided weights not above 'capacity'.
+  int64 MaxSubsetSum(int64 capacity) {
+    if (capacity <= 0) return 0;
+    if (capacity >= total_weight_) return total_weight_;
+    std::vector<int64> capacities(1, capacity);
+    solver_.Init(profits_, weights_, capacities);
+    return solver_.Solve();
+  }
+
+  KnapsackSolver solver_;
+  std::vector<int64> profits_;
+  std::vector<std::vector<int64>> weights_;
+  int64 total_weight_;
+};
+
 class DimensionWeightedSumEqVar : public Dimension {
  public:
   class VarDemon : public Demon {
@@ -880,7 +976,8 @@ class DimensionWeightedSumEqVar : public Dimension {
         first_unbound_backward_vector_(bins_count_, 0),
         sum_of_bound_variables_vector_(bins_count_, 0LL),
         sum_of_all_variables_vector_(bins_count_, 0LL),
-        ranked_(vars_count_) {
+        ranked_(vars_count_),
+        num_undecided_vector_(bins_count_, 0) {
     DCHECK_GT(vars_count_, 0);
     DCHECK_GT(bins_count_, 0);
     for (int i = 0; i < vars_count_; ++i) {
@@ -924,6 +1021,18 @@ class DimensionWeightedSumEqVar : public Dimension {
       }
     }
     first_unbound_backward_vector_.SetValue(solver(), bin_index, last_unbound);
+    if (FLAGS_cp_pack_use_knapsack_filtering &&
+        num_undecided_vector_[bin_index] <= BinLoadKnapsackFilter::kMaxItems) {
+      // Items decided by the loop above are still undecided until Pack
+      // processes them: they are kept as candidates, which is sound.
+      undecided_.clear();
+      AppendUndecidedItems(bin_index, &undecided_);
+      knapsack_filter_.Clear();
+      for (const int var_index : undecided_) {
+        knapsack_filter_.AddItem(weights_[var_index]);
+      }
+      knapsack_filter_.Filter(load, sum_min, sum_max);
+    }
   }
 
   virtual void InitialPropagate(int bin_index, const std::vector<int>& forced,
@@ -939,6 +1048,7 @@ class DimensionWeightedSumEqVar : public Dimension {
     }
     sum_of_all_variables_vector_.SetValue(s, bin_index, sum);
     first_unbound_backward_vector_.SetValue(s, bin_index, ranked_.size() - 1);
+    num_undecided_vector_.SetValue(s, bin_index, undecided.size());
     PushFromTop(bin_index);
   }
 
@@ -957,6 +1067,9 @@ class DimensionWeightedSumEqVar : public Dimension {
       up -= weights_[value];
     }
     sum_of_all_variables_vector_.SetValue(s, bin_index, up);
+    num_undecided_vector_.SetValue(
+        s, bin_index,
+        num_undecided_vector_[bin_index] - forced.size() - removed.size());
     PushFromTop(bin_index);
   }
   virtual void InitialPropagateUnassigned(const std::vector<int>& assigned,
@@ -984,6 +1097,9 @@ class DimensionWeightedSumEqVar : public Dimension {
   RevArray<int64> sum_of_bound_variables_vector_;
   RevArray<int64> sum_of_all_variables_vector_;
   std::vector<int> ranked_;
+  RevArray<int> num_undecided_vector_;
+  std::vector<int> undecided_;
+  BinLoadKnapsackFilter knapsack_filter_;
 };
 
 class DimensionWeightedCallback2SumEqVar : public Dimension {
@@ -1013,7 +1129,8 @@ class DimensionWeightedCallback2SumEqVar : public Dimension {
         first_unbound_backward_vector_(bins_count_, 0),
         sum_of_bound_variables_vector_(bins_count_, 0LL),
         sum_of_all_variables_vector_(bins_count_, 0LL),
-        ranked_(bins_count_) {
+        ranked_(bins_count_),
+        num_undecided_vector_(bins_count_, 0) {
     DCHECK(weights);
     DCHECK_GT(vars_count_, 0);
     DCHECK_GT(bins_count_, 0);
@@ -1064,6 +1181,18 @@ class DimensionWeightedCallback2SumEqVar : public Dimension {
       }
     }
     first_unbound_backward_vector_.SetValue(solver(), bin_index, last_unbound);
+    if (FLAGS_cp_pack_use_knapsack_filtering &&
+        num_undecided_vector_[bin_index] <= BinLoadKnapsackFilter::kMaxItems) {
+      // Items decided by the loop above are still undecided until Pack
+      // processes them: they are kept as candidates, which is sound.
+      undecided_.clear();
+      AppendUndecidedItems(bin_index, &undecided_);
+      knapsack_filter_.Clear();
+      for (const int var_index : undecided_) {
+        knapsack_filter_.AddItem(weights_->Run(var_index, bin_index));
+      }
+      knapsack_filter_.Filter(load, sum_min, sum_max);
+    }
   }
 
   virtual void InitialPropagate(int bin_index, const std::vector<int>& forced,
@@ -1080,6 +1209,7 @@ class DimensionWeightedCallback2SumEqVar : public Dimension {
     sum_of_all_variables_vector_.SetValue(s, bin_index, sum);
     first_unbound_backward_vector_.SetValue(s, bin_index,
                                             ranked_[bin_index].size() - 1);
+    num_undecided_vector_.SetValue(s, bin_index, undecided.size());
     PushFromTop(bin_index);
   }
 
@@ -1098,6 +1228,9 @@ class DimensionWeightedCallback2SumEqVar : public Dimension {
       up -= weights_->Run(value, bin_index);
     }
     sum_of_all_variables_vector_.SetValue(s, bin_index, up);
+    num_undecided_vector_.SetValue(
+        s, bin_index,
+        num_undecided_vector_[bin_index] - forced.size() - removed.size());
     PushFromTop(bin_index);
   }
   virtual void InitialPropagateUnassigned(const std::vector<int>& assigned,
@@ -1126,6 +1259,9 @@ class DimensionWeightedCallback2SumEqVar : public Dimension {
   RevArray<int64> sum_of_bound_variables_vector_;
   RevArray<int64> sum_of_all_variables_vector_;
   std::vector<std::vector<int>> ranked_;
+  RevArray<int> num_undecided_vector_;
+  std::vector<int> undecided_;
+  BinLoadKnapsackFilter knapsack_filter_;
 };
 
 class AssignedWeightedSumDimension : public Dimension {
@@ -0,0 +1,793 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "constraint_solver/parallel_search.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/stringprintf.h"
+#include "base/threadpool.h"
+#include "base/timer.h"
+#include "constraint_solver/constraint_solveri.h"
+
+namespace operations_research {
+
+ParallelSearchModel::ParallelSearchModel()
+    : db(nullptr),
+      objective(nullptr),
+      maximize(false),
+      step(1),
+      solution_vars(),
+      monitors(),
+      limit(nullptr) {}
+
+ParallelSearchParameters::ParallelSearchParameters()
+    : num_workers(1), split_depth(8) {}
+
+ParallelPortfolioParameters::ParallelPortfolioParameters()
+    : num_workers(1), luby_restart_scale(100), random_seed(0) {}
+
+ParallelSearchResult::ParallelSearchResult()
+    : found_solution(false),
+      objective_value(0),
+      solution_values(),
+      search_completed(false),
+      num_subtrees_explored(0),
+      branches(0),
+      failures(0) {}
+
+ParallelLocalSearchModel::ParallelLocalSearchModel()
+    : vars(),
+      first_solution(nullptr),
+      ls_operator(nullptr),
+      sub_decision_builder(nullptr),
+      filters(),
+      objective(nullptr),
+      maximize(false),
+      step(1),
+      monitors() {}
+
+ParallelLocalSearchParameters::ParallelLocalSearchParameters()
+    : num_workers(1),
+      max_moves(kint64max),
+      time_limit_ms(kint64max) {}
+
+ParallelLocalSearchResult::ParallelLocalSearchResult()
+    : found_solution(false),
+      objective_value(0),
+      solution_values(),
+      local_optimum_reached(false),
+      num_moves(0),
+      neighbors(0),
+      filtered_neighbors(0),
+      accepted_neighbors(0) {}
+
+namespace {
+
+// The state shared by all the workers: the next subtree to explore, the best
+// solution found so far and the stop flag.
+class ParallelSearchState {
+ public:
+  explicit ParallelSearchState(int num_subtrees)
+      : num_subtrees_(num_subtrees),
+        next_subtree_(0),
+        stop_(false),
+        limit_reached_(false),
+        has_incumbent_(false),
+        incumbent_(0),
+        found_solution_(false),
+        objective_value_(0) {}
+
+  // Returns the index of the next subtree to explore, or -1 if there is none
+  // left or if the search must stop.
+  int NextSubtree() {
+    if (ShouldStop()) return -1;
+    const int subtree = next_subtree_.fetch_add(1);
+    return subtree < num_subtrees_ ? subtree : -1;
+  }
+
+  bool ShouldStop() const { return stop_.load(std::memory_order_relaxed); }
+  bool LimitReached() const { return limit_reached_.load(); }
+  void Stop(bool limit_reached) {
+    if (limit_reached) limit_reached_.store(true);
+    stop_.store(true);
+  }
+
+  // Returns false if no worker found a solution with an objective yet. This
+  // is called at each node, so it doesn't take the mutex.
+  bool GetIncumbent(int64* value) const {
+    if (!has_incumbent_.load(std::memory_order_acquire)) return false;
+    *value = incumbent_.load(std::memory_order_relaxed);
+    return true;
+  }
+
+  // Records the current solution of a worker if it is the first one or if it
+  // is better than the recorded one. Without objective, only the first
+  // solution is kept.
+  void RecordSolution(bool has_objective, bool maximize, int64 objective_value,
+                      const std::vector<IntVar*>& vars) {
+    MutexLock lock(&mutex_);
+    if (found_solution_) {
+      if (!has_objective) return;
+      if (maximize ? objective_value <= objective_value_
+                   : objective_value >= objective_value_) {
+        return;
+      }
+    }
+    found_solution_ = true;
+    objective_value_ = objective_value;
+    solution_values_.resize(vars.size());
+    for (int i = 0; i < vars.size(); ++i) {
+      solution_values_[i] = vars[i]->Value();
+    }
+    if (has_objective) {
+      // The incumbent is written before the flag so that a worker that sees
+      // the flag reads a valid value. The writers are serialized by the mutex.
+      incumbent_.store(objective_value, std::memory_order_relaxed);
+      has_incumbent_.store(true, std::memory_order_release);
+    }
+  }
+
+  void FillResult(ParallelSearchResult* result) {
+    MutexLock lock(&mutex_);
+    result->found_solution = found_solution_;
+    result->objective_value = objective_value_;
+    result->solution_values = solution_values_;
+  }
+
+ private:
+  const int num_subtrees_;
+  std::atomic<int> next_subtree_;
+  std::atomic<bool> stop_;
+  std::atomic<bool> limit_reached_;
+  std::atomic<bool> has_incumbent_;
+  std::atomic<int64> incumbent_;
+
+  Mutex mutex_;
+  bool found_solution_;
+  int64 objective_value_;
+  std::vector<int64> solution_values_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelSearchState);
+};
+
+// Forces one of the two branches of a decision: the other branch fails.
+class ForcedBranchDecision : public Decision {
+ public:
+  ForcedBranchDecision(Decision* const decision, bool right_branch)
+      : decision_(decision), right_branch_(right_branch) {}
+  virtual ~ForcedBranchDecision() {}
+
+  virtual void Apply(Solver* const s) {
+    if (right_branch_) {
+      decision_->Refute(s);
+    } else {
+      decision_->Apply(s);
+    }
+  }
+
+  virtual void Refute(Solver* const s) { s->Fail(); }
+
+  virtual std::string DebugString() const {
+    return StringPrintf("ForcedBranchDecision(%s, %s)",
+                        decision_->DebugString().c_str(),
+                        right_branch_ ? "right" : "left");
+  }
+
+ private:
+  Decision* const decision_;
+  const bool right_branch_;
+};
+
+// Restricts the search of a decision builder to one subtree. Bit i of the
+// subtree index gives the branch taken by the decision at depth i, for the
+// first split_depth decisions.
+class SubtreeDecisionBuilder : public DecisionBuilder {
+ public:
+  SubtreeDecisionBuilder(DecisionBuilder* const db, int split_depth)
+      : db_(db), split_depth_(split_depth), subtree_(0), depth_(0) {}
+  virtual ~SubtreeDecisionBuilder() {}
+
+  void SetSubtree(int subtree) { subtree_ = subtree; }
+
+  virtual Decision* Next(Solver* const s) {
+    Decision* const decision = db_->Next(s);
+    const int depth = depth_.Value();
+    if (depth >= split_depth_) return decision;
+    if (decision == nullptr) {
+      // The branch is shallower than the split depth. Its solution belongs to
+      // all the subtrees that only differ by the decisions below it, so it is
+      // only accepted in the one that takes all their left branches.
+      if ((subtree_ >> depth) != 0) s->Fail();
+      return nullptr;
+    }
+    depth_.SetValue(s, depth + 1);
+    return s->RevAlloc(
+        new ForcedBranchDecision(decision, (subtree_ >> depth) & 1));
+  }
+
+  virtual void AppendMonitors(Solver* const solver,
+                              std::vector<SearchMonitor*>* const extras) {
+    db_->AppendMonitors(solver, extras);
+  }
+
+  virtual void Accept(ModelVisitor* const visitor) const {
+    db_->Accept(visitor);
+  }
+
+  virtual std::string DebugString() const {
+    return StringPrintf("SubtreeDecisionBuilder(%s, subtree = %d)",
+                        db_->DebugString().c_str(), subtree_);
+  }
+
+ private:
+  DecisionBuilder* const db_;
+  const int split_depth_;
+  int subtree_;
+  Rev<int> depth_;
+};
+
+// An OptimizeVar that imports the best objective value found by the other
+// workers before applying its bound, and publishes its own solutions.
+class SharedOptimizeVar : public OptimizeVar {
+ public:
+  SharedOptimizeVar(Solver* const s, bool maximize, IntVar* const var,
+                    int64 step, const std::vector<IntVar*>& solution_vars,
+                    ParallelSearchState* state)
+      : OptimizeVar(s, maximize, var, step),
+        solution_vars_(solution_vars),
+        state_(state) {}
+  virtual ~SharedOptimizeVar() {}
+
+  virtual void EnterSearch() {
+    OptimizeVar::EnterSearch();
+    ImportIncumbent();
+  }
+
+  virtual void BeginNextDecision(DecisionBuilder* const db) {
+    ImportIncumbent();
+    ApplyBound();
+  }
+
+  virtual void RefuteDecision(Decision* const d) {
+    ImportIncumbent();
+    ApplyBound();
+  }
+
+  virtual bool AcceptSolution() {
+    ImportIncumbent();
+    return OptimizeVar::AcceptSolution();
+  }
+
+  virtual bool AtSolution() {
+    OptimizeVar::AtSolution();
+    state_->RecordSolution(true, maximize_, best_, solution_vars_);
+    return true;
+  }
+
+ private:
+  void ImportIncumbent() {
+    int64 value;
+    if (!state_->GetIncumbent(&value)) return;
+    if (!found_initial_solution_ ||
+        (maximize_ ? value > best_ : value < best_)) {
+      best_ = value;
+      found_initial_solution_ = true;
+    }
+  }
+
+  const std::vector<IntVar*> solution_vars_;
+  ParallelSearchState* const state_;
+};
+
+// Records the first solution found by a worker and stops all the workers.
+class FirstSolutionRecorder : public SearchMonitor {
+ public:
+  FirstSolutionRecorder(Solver* const s,
+                        const std::vector<IntVar*>& solution_vars,
+                        ParallelSearchState* state)
+      : SearchMonitor(s), solution_vars_(solution_vars), state_(state) {}
+  virtual ~FirstSolutionRecorder() {}
+
+  virtual bool AtSolution() {
+    state_->RecordSolution(false, false, 0, solution_vars_);
+    state_->Stop(false);
+    return false;
+  }
+
+  virtual std::string DebugString() const { return "FirstSolutionRecorder"; }
+
+ private:
+  const std::vector<IntVar*> solution_vars_;
+  ParallelSearchState* const state_;
+};
+
+struct WorkerStatistics {
+  WorkerStatistics() : num_subtrees_explored(0), branches(0), failures(0) {}
+  int num_subtrees_explored;
+  int64 branches;
+  int64 failures;
+};
+
+void RunParallelSearchWorker(int worker, int split_depth,
+                             ParallelSearchModelBuilder* builder,
+                             ParallelSearchState* state,
+                             WorkerStatistics* statistics) {
+  Solver solver(StringPrintf("ParallelSearchWorker_%d", worker));
+  ParallelSearchModel model;
+  builder->Run(&solver, &model);
+  CHECK(model.db != nullptr);
+
+  SubtreeDecisionBuilder* const db =
+      solver.RevAlloc(new SubtreeDecisionBuilder(model.db, split_depth));
+  std::vector<SearchMonitor*> monitors = model.monitors;
+  if (model.objective != nullptr) {
+    monitors.push_back(solver.RevAlloc(
+        new SharedOptimizeVar(&solver, model.maximize, model.objective,
+                              model.step, model.solution_vars, state)));
+  } else {
+    monitors.push_back(solver.RevAlloc(
+        new FirstSolutionRecorder(&solver, model.solution_vars, state)));
+  }
+  if (model.limit != nullptr) monitors.push_back(model.limit);
+  monitors.push_back(solver.MakeCustomLimit(
+      NewPermanentCallback(state, &ParallelSearchState::ShouldStop)));
+
+  for (int subtree = state->NextSubtree(); subtree >= 0;
+       subtree = state->NextSubtree()) {
+    db->SetSubtree(subtree);
+    solver.Solve(db, monitors);
+    if (model.limit != nullptr && model.limit->crossed()) {
+      state->Stop(/*limit_reached=*/true);
+    }
+    // A subtree whose search was interrupted is not counted.
+    if (state->ShouldStop()) break;
+    ++statistics->num_subtrees_explored;
+  }
+  statistics->branches = solver.branches();
+  statistics->failures = solver.failures();
+}
+
+// ----- Portfolio search -----
+
+void RunPortfolioWorker(int worker,
+                        const ParallelPortfolioParameters* parameters,
+                        ParallelPortfolioModelBuilder* builder,
+                        ParallelSearchState* state,
+                        WorkerStatistics* statistics) {
+  Solver solver(StringPrintf("ParallelPortfolioWorker_%d", worker));
+  solver.ReSeed(parameters->random_seed + worker);
+  ParallelSearchModel model;
+  builder->Run(&solver, worker, &model);
+  CHECK(model.db != nullptr);
+
+  std::vector<SearchMonitor*> monitors = model.monitors;
+  if (model.objective != nullptr) {
+    monitors.push_back(solver.RevAlloc(
+        new SharedOptimizeVar(&solver, model.maximize, model.objective,
+                              model.step, model.solution_vars, state)));
+  } else {
+    monitors.push_back(solver.RevAlloc(
+        new FirstSolutionRecorder(&solver, model.solution_vars, state)));
+  }
+  if (worker > 0 && parameters->luby_restart_scale > 0) {
+    monitors.push_back(
+        solver.MakeLubyRestart(parameters->luby_restart_scale));
+  }
+  if (model.limit != nullptr) monitors.push_back(model.limit);
+  monitors.push_back(solver.MakeCustomLimit(
+      NewPermanentCallback(state, &ParallelSearchState::ShouldStop)));
+
+  solver.Solve(model.db, monitors);
+  if (model.limit != nullptr && model.limit->crossed()) {
+    state->Stop(/*limit_reached=*/true);
+  } else {
+    // The search was either interrupted by another worker, or it completed,
+    // in which case the other workers have nothing left to find.
+    state->Stop(/*limit_reached=*/false);
+  }
+  statistics->branches = solver.branches();
+  statistics->failures = solver.failures();
+}
+
+// ----- Parallel local search -----
+
+// The state shared by the local search workers during a round.
+class ParallelLocalSearchState {
+ public:
+  explicit ParallelLocalSearchState(int64 time_limit_ms)
+      : round_done_(false), time_limit_ms_(time_limit_ms) {
+    timer_.Start();
+  }
+
+  void StartRound() { round_done_.store(false); }
+  void EndRound() { round_done_.store(true); }
+  bool ShouldStopRound() const {
+    return round_done_.load(std::memory_order_relaxed) || TimeLimitReached();
+  }
+  bool TimeLimitReached() const { return timer_.GetInMs() >= time_limit_ms_; }
+
+ private:
+  std::atomic<bool> round_done_;
+  const int64 time_limit_ms_;
+  WallTimer timer_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelLocalSearchState);
+};
+
+// Only accepts the share of the neighbors dealt to one worker. The owner of a
+// neighbor is given by a hash of the integer variable elements of its delta,
+// which doesn't depend on their order. The neighbors are not dealt by their
+// enumeration index: the operators resume their enumeration from where they
+// stopped in the previous round, which differs from one worker to the other.
+class NeighborPartitionFilter : public LocalSearchFilter {
+ public:
+  NeighborPartitionFilter(int worker, int num_workers)
+      : worker_(worker), num_workers_(num_workers) {}
+  virtual ~NeighborPartitionFilter() {}
+
+  virtual bool Accept(const Assignment* delta, const Assignment* deltadelta) {
+    return DecodeAndAccept(delta, deltadelta);
+  }
+  virtual bool AcceptDecoded(const LocalSearchDelta& delta,
+                             const LocalSearchDelta& deltadelta) {
+    uint64 hash = 0;
+    for (int i = 0; i < delta.Size(); ++i) {
+      uint64 element_hash = Hash64NumWithSeed(delta.VarIndex(i),
+                                              delta.Activated(i));
+      element_hash = Hash64NumWithSeed(delta.Min(i), element_hash);
+      element_hash = Hash64NumWithSeed(delta.Max(i), element_hash);
+      hash += element_hash;
+    }
+    return hash % num_workers_ == worker_;
+  }
+  virtual void Synchronize(const Assignment* assignment,
+                           const Assignment* delta) {}
+  virtual bool CanBeReordered() const { return true; }
+
+  virtual std::string DebugString() const {
+    return StringPrintf("NeighborPartitionFilter(%d/%d)", worker_,
+                        num_workers_);
+  }
+
+ private:
+  const int worker_;
+  const int num_workers_;
+};
+
+// The decision builder of a round: a local search phase which starts from the
+// assignment of the worker. The phase is created during the search, so that it
+// is deleted at the end of the round.
+class LocalSearchRound : public DecisionBuilder {
+ public:
+  LocalSearchRound(Assignment* const assignment,
+                   LocalSearchPhaseParameters* const parameters)
+      : assignment_(assignment), parameters_(parameters), phase_(nullptr) {}
+  virtual ~LocalSearchRound() {}
+
+  // Must be called before each round.
+  void Reset() { phase_ = nullptr; }
+
+  virtual Decision* Next(Solver* const s) {
+    if (phase_ == nullptr) {
+      phase_ = s->MakeLocalSearchPhase(assignment_, parameters_);
+    }
+    return phase_->Next(s);
+  }
+
+  virtual std::string DebugString() const { return "LocalSearchRound"; }
+
+ private:
+  Assignment* const assignment_;
+  LocalSearchPhaseParameters* const parameters_;
+  DecisionBuilder* phase_;
+};
+
+// Records the improving move of a round. The first solution of a round is the
+// assignment restored by the local search phase; the second one is an
+// improving neighbor, which ends the round for all the workers.
+class RoundSolutionRecorder : public SearchMonitor {
+ public:
+  RoundSolutionRecorder(Solver* const s, const std::vector<IntVar*>& vars,
+                        IntVar* const objective,
+                        ParallelLocalSearchState* state)
+      : SearchMonitor(s),
+        vars_(vars),
+        objective_(objective),
+        state_(state),
+        num_solutions_(0),
+        found_move_(false),
+        objective_value_(0) {}
+  virtual ~RoundSolutionRecorder() {}
+
+  virtual void EnterSearch() {
+    num_solutions_ = 0;
+    found_move_ = false;
+  }
+
+  virtual bool AtSolution() {
+    if (++num_solutions_ == 1) return true;
+    found_move_ = true;
+    objective_value_ = objective_->Value();
+    values_.resize(vars_.size());
+    for (int i = 0; i < vars_.size(); ++i) {
+      values_[i] = vars_[i]->Value();
+    }
+    state_->EndRound();
+    solver()->FinishCurrentSearch();
+    return false;
+  }
+
+  bool found_move() const { return found_move_; }
+  int64 objective_value() const { return objective_value_; }
+  const std::vector<int64>& values() const { return values_; }
+
+  virtual std::string DebugString() const { return "RoundSolutionRecorder"; }
+
+ private:
+  const std::vector<IntVar*> vars_;
+  IntVar* const objective_;
+  ParallelLocalSearchState* const state_;
+  int num_solutions_;
+  bool found_move_;
+  int64 objective_value_;
+  std::vector<int64> values_;
+};
+
+struct LocalSearchWorker {
+  LocalSearchWorker()
+      : assignment(nullptr),
+        round(nullptr),
+        recorder(nullptr),
+        limit(nullptr) {}
+  std::unique_ptr<Solver> solver;
+  ParallelLocalSearchModel model;
+  // The variables and the objective of the model, set to the current solution
+  // before each round.
+  Assignment* assignment;
+  LocalSearchRound* round;
+  RoundSolutionRecorder* recorder;
+  SearchLimit* limit;
+  std::vector<SearchMonitor*> monitors;
+};
+
+void BuildLocalSearchWorker(int worker,
+                            const ParallelLocalSearchParameters* parameters,
+                            ParallelLocalSearchModelBuilder* builder,
+                            ParallelLocalSearchState* state,
+                            LocalSearchWorker* w) {
+  Solver* const solver =
+      new Solver(StringPrintf("ParallelLocalSearchWorker_%d", worker));
+  w->solver.reset(solver);
+  ParallelLocalSearchModel* const model = &w->model;
+  builder->Run(solver, model);
+  CHECK(model->ls_operator != nullptr);
+  CHECK(model->objective != nullptr);
+
+  w->assignment = solver->MakeAssignment();
+  w->assignment->Add(model->vars);
+  w->assignment->AddObjective(model->objective);
+  std::vector<LocalSearchFilter*> filters;
+  filters.push_back(solver->RevAlloc(
+      new NeighborPartitionFilter(worker, parameters->num_workers)));
+  filters.insert(filters.end(), model->filters.begin(), model->filters.end());
+  w->round = solver->RevAlloc(new LocalSearchRound(
+      w->assignment,
+      solver->MakeLocalSearchPhaseParameters(
+          model->ls_operator, model->sub_decision_builder, nullptr, filters)));
+  w->recorder = solver->RevAlloc(
+      new RoundSolutionRecorder(solver, model->vars, model->objective, state));
+  w->limit = solver->MakeCustomLimit(
+      NewPermanentCallback(state, &ParallelLocalSearchState::ShouldStopRound));
+  w->monitors = model->monitors;
+  w->monitors.push_back(
+      solver->MakeOptimize(model->maximize, model->objective, model->step));
+  w->monitors.push_back(w->recorder);
+  w->monitors.push_back(w->limit);
+}
+
+// Runs the first solution decision builder of the model of the worker.
+bool FindFirstSolution(LocalSearchWorker* w, int64* objective_value,
+                       std::vector<int64>* values) {
+  const ParallelLocalSearchModel& model = w->model;
+  CHECK(model.first_solution != nullptr);
+  Solver* const solver = w->solver.get();
+  SolutionCollector* const collector =
+      solver->MakeFirstSolutionCollector(w->assignment);
+  if (!solver->Solve(model.first_solution, collector, w->limit)) {
+    return false;
+  }
+  const Assignment* const solution = collector->solution(0);
+  *objective_value = solution->ObjectiveValue();
+  values->resize(model.vars.size());
+  for (int i = 0; i < model.vars.size(); ++i) {
+    (*values)[i] = solution->Value(model.vars[i]);
+  }
+  return true;
+}
+
+void RunLocalSearchRound(LocalSearchWorker* w, const std::vector<int64>* values,
+                         int64 objective_value) {
+  const std::vector<IntVar*>& vars = w->model.vars;
+  for (int i = 0; i < vars.size(); ++i) {
+    w->assignment->SetValue(vars[i], (*values)[i]);
+  }
+  w->assignment->SetObjectiveValue(objective_value);
+  w->round->Reset();
+  w->solver->Solve(w->round, w->monitors);
+}
+}  // namespace
+
+bool SolveInParallel(const ParallelSearchParameters& parameters,
+                     ParallelSearchModelBuilder* builder,
+                     ParallelSearchResult* result) {
+  CHECK(builder != nullptr);
+  CHECK(result != nullptr);
+  builder->CheckIsRepeatable();
+  CHECK_GE(parameters.num_workers, 1);
+  CHECK_GE(parameters.split_depth, 0);
+  CHECK_LT(parameters.split_depth, 31);
+
+  ParallelSearchState state(1 << parameters.split_depth);
+  std::vector<WorkerStatistics> statistics(parameters.num_workers);
+  {
+    ThreadPool pool("ParallelSearch", parameters.num_workers);
+    for (int worker = 0; worker < parameters.num_workers; ++worker) {
+      pool.Add(NewCallback(&RunParallelSearchWorker, worker,
+                           parameters.split_depth, builder, &state,
+                           &statistics[worker]));
+    }
+    pool.StartWorkers();
+  }
+
+  *result = ParallelSearchResult();
+  state.FillResult(result);
+  result->search_completed = !state.LimitReached();
+  for (const WorkerStatistics& worker_statistics : statistics) {
+    result->num_subtrees_explored += worker_statistics.num_subtrees_explored;
+    result->branches += worker_statistics.branches;
+    result->failures += worker_statistics.failures;
+  }
+  return result->found_solution;
+}
+
+bool SolvePortfolioInParallel(const ParallelPortfolioParameters& parameters,
+                              ParallelPortfolioModelBuilder* builder,
+                              ParallelSearchResult* result) {
+  CHECK(builder != nullptr);
+  CHECK(result != nullptr);
+  builder->CheckIsRepeatable();
+  CHECK_GE(parameters.num_workers, 1);
+  CHECK_GE(parameters.luby_restart_scale, 0);
+
+  ParallelSearchState state(0);
+  std::vector<WorkerStatistics> statistics(parameters.num_workers);
+  {
+    ThreadPool pool("ParallelPortfolio", parameters.num_workers);
+    for (int worker = 0; worker < parameters.num_workers; ++worker) {
+      pool.Add(NewCallback(&RunPortfolioWorker, worker, &parameters, builder,
+                           &state, &statistics[worker]));
+    }
+    pool.StartWorkers();
+  }
+
+  *result = ParallelSearchResult();
+  state.FillResult(result);
+  result->search_completed = !state.LimitReached();
+  for (const WorkerStatistics& worker_statistics : statistics) {
+    result->branches += worker_statistics.branches;
+    result->failures += worker_statistics.failures;
+  }
+  return result->found_solution;
+}
+
+DecisionBuilder* MakeSchedulingPortfolioPhase(
+    Solver* const solver, const std::vector<SequenceVar*>& sequences,
+    int worker) {
+  switch (worker) {
+    case 0:
+      return solver->MakePhase(sequences,
+                               Solver::CHOOSE_MIN_SLACK_RANK_FORWARD);
+    case 1:
+      return solver->MakePhase(sequences,
+                               Solver::CHOOSE_MIN_WEIGHTED_SLACK_RANK_FORWARD);
+    case 2: {
+      std::vector<IntervalVar*> intervals;
+      for (SequenceVar* const sequence : sequences) {
+        for (int i = 0; i < sequence->size(); ++i) {
+          intervals.push_back(sequence->Interval(i));
+        }
+      }
+      return solver->MakePhase(intervals, Solver::INTERVAL_SET_TIMES_FORWARD);
+    }
+    default:
+      return solver->MakePhase(sequences, Solver::CHOOSE_RANDOM_RANK_FORWARD);
+  }
+}
+
+bool SolveLocalSearchInParallel(const ParallelLocalSearchParameters& parameters,
+                                ParallelLocalSearchModelBuilder* builder,
+                                ParallelLocalSearchResult* result) {
+  CHECK(builder != nullptr);
+  CHECK(result != nullptr);
+  builder->CheckIsRepeatable();
+  CHECK_GE(parameters.num_workers, 1);
+
+  *result = ParallelLocalSearchResult();
+  ParallelLocalSearchState state(parameters.time_limit_ms);
+  std::vector<LocalSearchWorker> workers(parameters.num_workers);
+  {
+    ThreadPool pool("ParallelLocalSearch", parameters.num_workers);
+    for (int worker = 0; worker < parameters.num_workers; ++worker) {
+      pool.Add(NewCallback(&BuildLocalSearchWorker, worker, &parameters,
+                           builder, &state, &workers[worker]));
+    }
+    pool.StartWorkers();
+  }
+
+  std::vector<int64> values;
+  int64 objective_value = 0;
+  if (FindFirstSolution(&workers[0], &objective_value, &values)) {
+    result->found_solution = true;
+    const bool maximize = workers[0].model.maximize;
+    while (result->num_moves < parameters.max_moves &&
+           !state.TimeLimitReached()) {
+      state.StartRound();
+      {
+        ThreadPool pool("ParallelLocalSearch", parameters.num_workers);
+        for (int worker = 0; worker < parameters.num_workers; ++worker) {
+          pool.Add(NewCallback(&RunLocalSearchRound, &workers[worker],
+                               &values, objective_value));
+        }
+        pool.StartWorkers();
+      }
+      // Several workers can find a move before the round ends, in which case
+      // the best one is kept. Ties are broken by worker index.
+      const RoundSolutionRecorder* best = nullptr;
+      for (const LocalSearchWorker& worker : workers) {
+        const RoundSolutionRecorder* const recorder = worker.recorder;
+        if (!recorder->found_move()) continue;
+        const int64 value = recorder->objective_value();
+        if (best == nullptr ||
+            (maximize ? value > best->objective_value()
+                      : value < best->objective_value())) {
+          best = recorder;
+        }
+      }
+      if (best == nullptr) {
+        result->local_optimum_reached = !state.TimeLimitReached();
+        break;
+      }
+      values = best->values();
+      objective_value = best->objective_value();
+      ++result->num_moves;
+    }
+    result->objective_value = objective_value;
+    result->solution_values = values;
+  }
+
+  for (const LocalSearchWorker& worker : workers) {
+    result->neighbors += worker.solver->neighbors();
+    result->filtered_neighbors += worker.solver->filtered_neighbors();
+    result->accepted_neighbors += worker.solver->accepted_neighbors();
+  }
+  return result->found_solution;
+}
+
+}  // namespace operations_research
@@ -0,0 +1,265 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Multi-threaded depth first search by subtree splitting.
+//
+// Each worker thread owns its own Solver, in which the model and the search
+// are built by a user callback. The top of the search tree is split into
+// 2^split_depth subtrees: a subtree is identified by the sequence of
+// left/right branches taken by the first split_depth decisions of the
+// decision builder. The subtrees are jobs that the idle workers take one
+// after the other from a shared counter, so that a worker that finishes a
+// small subtree quickly continues with the next one.
+//
+// When optimizing, the best objective value found by any worker is shared
+// through the OptimizeVar of each worker, so that all the subtrees are
+// pruned with the global incumbent.
+//
+// Note that the search is not deterministic: the solution returned, the
+// number of branches and, when the search is limited, the best objective
+// found depend on the thread scheduling.
+//
+// This file also defines a parallel local search, which explores the
+// neighborhood of the current solution with several workers. See
+// SolveLocalSearchInParallel() below, and a portfolio search, in which the
+// workers run different searches on the whole tree. See
+// SolvePortfolioInParallel() below.
+
+#ifndef OR_TOOLS_CONSTRAINT_SOLVER_PARALLEL_SEARCH_H_
+#define OR_TOOLS_CONSTRAINT_SOLVER_PARALLEL_SEARCH_H_
+
+#include <vector>
+
+#include "base/callback.h"
+#include "base/integral_types.h"
+#include "constraint_solver/constraint_solver.h"
+
+namespace operations_research {
+
+// The search to run in a worker, filled by the model builder callback. All
+// the objects must belong to the Solver given to the callback.
+struct ParallelSearchModel {
+  ParallelSearchModel();
+
+  // The decision builder that defines the search tree. Its first decisions
+  // are the ones used to split the tree, so they should be the most
+  // balanced ones.
+  DecisionBuilder* db;
+
+  // The objective to optimize, or nullptr to look for a single feasible
+  // solution. Note that the objective monitor is created by the parallel
+  // search, it must not be given in 'monitors'.
+  IntVar* objective;
+  bool maximize;
+  int64 step;
+
+  // The variables whose values are returned in ParallelSearchResult.
+  std::vector<IntVar*> solution_vars;
+
+  // Additional search monitors, applied to the search of each subtree.
+  std::vector<SearchMonitor*> monitors;
+
+  // An optional limit, also applied to the search of each subtree. When it
+  // is crossed in one worker, all the workers stop and the search is
+  // considered incomplete.
+  SearchLimit* limit;
+};
+
+struct ParallelSearchParameters {
+  ParallelSearchParameters();
+
+  // Number of worker threads, each with its own Solver.
+  int num_workers;
+
+  // The tree is split into 2^split_depth subtrees. There should be many more
+  // subtrees than workers for the load to be balanced.
+  int split_depth;
+};
+
+struct ParallelSearchResult {
+  ParallelSearchResult();
+
+  // True if a solution was found. Its objective value (when optimizing) and
+  // the values of the ParallelSearchModel::solution_vars are then stored.
+  bool found_solution;
+  int64 objective_value;
+  std::vector<int64> solution_values;
+
+  // True if the search was not interrupted by a limit. When optimizing, the
+  // solution found is then optimal, or the problem is infeasible if no
+  // solution was found.
+  bool search_completed;
+
+  // Statistics summed over all the workers.
+  int num_subtrees_explored;
+  int64 branches;
+  int64 failures;
+};
+
+// Callback that builds the model and the search in the given Solver. It is
+// called once per worker, concurrently from several threads, so it must be
+// a permanent callback and it must not modify any shared state.
+typedef Callback2<Solver*, ParallelSearchModel*> ParallelSearchModelBuilder;
+
+// Runs the parallel search described above and returns
+// result->found_solution. The builder is not owned.
+bool SolveInParallel(const ParallelSearchParameters& parameters,
+                     ParallelSearchModelBuilder* builder,
+                     ParallelSearchResult* result);
+
+// ----- Parallel local search -----
+
+// The local search to run in a worker, filled by the model builder callback.
+// All the objects must belong to the Solver given to the callback, and the
+// workers must get the same model, with the variables created in the same
+// order. The operators must enumerate the same neighbors from a given
+// solution in all the workers, so random operators must use the same seed.
+struct ParallelLocalSearchModel {
+  ParallelLocalSearchModel();
+
+  // The variables of the solution, which are modified by the local search
+  // operator. Their values are returned in ParallelLocalSearchResult.
+  std::vector<IntVar*> vars;
+
+  // Builds the initial solution. It is only run in the first worker, and must
+  // bind all the variables of 'vars'.
+  DecisionBuilder* first_solution;
+
+  // The arguments of Solver::MakeLocalSearchPhaseParameters(). The
+  // sub-decision builder can be nullptr.
+  LocalSearchOperator* ls_operator;
+  DecisionBuilder* sub_decision_builder;
+  std::vector<LocalSearchFilter*> filters;
+
+  // The objective to optimize. The objective monitor is created by the
+  // parallel local search.
+  IntVar* objective;
+  bool maximize;
+  int64 step;
+
+  // Additional search monitors, applied to the search of each round.
+  std::vector<SearchMonitor*> monitors;
+};
+
+struct ParallelLocalSearchParameters {
+  ParallelLocalSearchParameters();
+
+  // Number of worker threads, each with its own Solver.
+  int num_workers;
+
+  // The search stops after this many improving moves, or after this time.
+  int64 max_moves;
+  int64 time_limit_ms;
+};
+
+struct ParallelLocalSearchResult {
+  ParallelLocalSearchResult();
+
+  // True if the first solution was found. The best solution found is then
+  // stored.
+  bool found_solution;
+  int64 objective_value;
+  std::vector<int64> solution_values;
+
+  // True if the search stopped because no neighbor of the last solution
+  // improved it, rather than because of a limit.
+  bool local_optimum_reached;
+
+  // Number of improving moves committed.
+  int64 num_moves;
+
+  // Statistics summed over all the workers.
+  int64 neighbors;
+  int64 filtered_neighbors;
+  int64 accepted_neighbors;
+};
+
+// Callback that builds the model of the local search in the given Solver,
+// with the same constraints as ParallelSearchModelBuilder.
+typedef Callback2<Solver*, ParallelLocalSearchModel*>
+    ParallelLocalSearchModelBuilder;
+
+// Runs a local search whose neighborhoods are explored by several workers,
+// and returns result->found_solution. The builder is not owned.
+//
+// The search proceeds by rounds. In each round, all the workers start from
+// the current solution and enumerate its neighbors, but each worker only
+// filters and checks its share of the neighbors, in its own Solver and with
+// its own filters. A neighbor is dealt to a worker from a hash of its integer
+// variable values, so that the workers agree on it even when their operators
+// enumerate the neighbors in a different order. The round ends as soon as a
+// worker finds an improving neighbor. The best of the neighbors found by the
+// workers in the round then becomes the current solution of the next round.
+// The search stops when no worker finds an improving neighbor.
+//
+// Note that the move committed is not necessarily the first improving
+// neighbor in the enumeration order, so the trajectory of the search can
+// differ from the one of the sequential local search.
+bool SolveLocalSearchInParallel(const ParallelLocalSearchParameters& parameters,
+                                ParallelLocalSearchModelBuilder* builder,
+                                ParallelLocalSearchResult* result);
+
+// ----- Portfolio search -----
+
+struct ParallelPortfolioParameters {
+  ParallelPortfolioParameters();
+
+  // Number of worker threads, each with its own Solver.
+  int num_workers;
+
+  // The search of each worker but the first one is restarted with
+  // Solver::MakeLubyRestart() with this scale factor. 0 means no restart.
+  // Worker 0 is never restarted: restarting a deterministic search only
+  // repeats its first branches, so it would never complete.
+  int luby_restart_scale;
+
+  // The Solver of worker i is seeded with random_seed + i, so that the
+  // randomized searches differ from one worker to the other.
+  int32 random_seed;
+};
+
+// Callback that builds the model and the search of a worker, given the Solver
+// and the index of the worker, with the same constraints as
+// ParallelSearchModelBuilder. The index lets the workers choose different
+// search strategies.
+typedef Callback3<Solver*, int, ParallelSearchModel*>
+    ParallelPortfolioModelBuilder;
+
+// Runs a different search in each worker, each one on the whole search tree,
+// and returns result->found_solution. The builder is not owned.
+//
+// The best objective value found by any worker is shared as in
+// SolveInParallel(), so that a worker which finds a good solution early
+// speeds up the others. The search stops as soon as one worker completes its
+// search, in which case the solution found is optimal, or when the limit of
+// one worker is crossed. ParallelSearchResult::num_subtrees_explored is not
+// used.
+bool SolvePortfolioInParallel(const ParallelPortfolioParameters& parameters,
+                              ParallelPortfolioModelBuilder* builder,
+                              ParallelSearchResult* result);
+
+// Returns the phase of the given worker of a scheduling portfolio, which
+// schedules the intervals of the sequences with one of the strategies of
+// Solver::MakePhase(): worker 0 ranks with CHOOSE_MIN_SLACK_RANK_FORWARD,
+// worker 1 with CHOOSE_MIN_WEIGHTED_SLACK_RANK_FORWARD, worker 2 sets the
+// start times of the intervals with INTERVAL_SET_TIMES_FORWARD,
+// and the other workers rank with CHOOSE_RANDOM_RANK_FORWARD. As in
+// sequential search, the ranking phases do not fix the start times, so the
+// phase must be followed by a phase on the objective in most models.
+DecisionBuilder* MakeSchedulingPortfolioPhase(
+    Solver* const solver, const std::vector<SequenceVar*>& sequences,
+    int worker);
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_CONSTRAINT_SOLVER_PARALLEL_SEARCH_H_
@@ -377,6 +377,11 @@ class DisjunctiveLambdaThetaTree : public MonoidOperationTree<LambdaThetaNode> {
     Set(task.index, LambdaThetaNode(task.interval));
   }
 
+  // Same as Insert(), but UpdateAll() must be called before querying the tree.
+  void InsertWithoutUpdate(const DisjunctiveTask& task) {
+    SetWithoutUpdate(task.index, LambdaThetaNode(task.interval));
+  }
+
   void Grey(const DisjunctiveTask& task) {
     const int index = task.index;
     Set(index, LambdaThetaNode(task.interval, index));
@@ -673,9 +678,10 @@ bool EdgeFinderAndDetectablePrecedences::EdgeFinder() {
             EndMaxLessThan<DisjunctiveTask>);
   lt_tree_.Clear();
   for (int i = 0; i < size(); ++i) {
-    lt_tree_.Insert(*by_start_min_[i]);
+    lt_tree_.InsertWithoutUpdate(*by_start_min_[i]);
     DCHECK_EQ(i, by_start_min_[i]->index);
   }
+  lt_tree_.UpdateAll();
   for (int j = size() - 2; j >= 0; --j) {
     lt_tree_.Grey(*by_end_max_[j + 1]);
     DisjunctiveTask* const twj = by_end_max_[j];
@@ -1644,27 +1650,42 @@ bool TimeLessThan(const ProfileDelta& delta1, const ProfileDelta& delta2) {
 
 // Cumulative time-table.
 //
-// This class implements a propagator for the CumulativeConstraint which is not
-// incremental, and where a call to InitialPropagate() takes time which is
-// O(n^2) and Omega(n log n) with n the number of cumulative tasks.
+// This class implements a propagator for the CumulativeConstraint where a call
+// to InitialPropagate() takes time which is O(n^2) and Omega(n) with n the
+// number of cumulative tasks.
 //
 // Despite the high complexity, this propagator is needed, because of those
 // implemented, it is the only one that satisfy that if all instantiated, no
 // contradiction will be detected if and only if the constraint is satisfied.
 //
-// The implementation is quite naive, and could certainly be improved, for
-// example by maintaining the profile incrementally.
+// The profile is maintained incrementally: the compulsory part of each task
+// seen at the last propagation is cached, and only the events of the tasks
+// whose compulsory part changed since are removed from and merged back into
+// the sorted list of events. As the cache is compared to the current bounds of
+// the tasks, it stays valid across backtracks.
 template <class Task>
 class CumulativeTimeTable : public Constraint {
  public:
   CumulativeTimeTable(Solver* const solver, const std::vector<Task*>& tasks,
                       IntVar* const capacity)
-      : Constraint(solver), by_start_min_(tasks), capacity_(capacity) {
+      : Constraint(solver),
+        tasks_(tasks),
+        by_start_min_(tasks),
+        capacity_(capacity),
+        part_start_(tasks.size(), 0),
+        part_end_(tasks.size(), 0),
+        part_demand_(tasks.size(), 0),
+        changed_(tasks.size(), false),
+        max_usage_(0) {
     // There may be up to 2 delta's per interval (one on each side),
     // plus two sentinels
     const int profile_max_size = 2 * by_start_min_.size() + 2;
-    profile_non_unique_time_.reserve(profile_max_size);
+    events_.reserve(profile_max_size);
+    new_events_.reserve(profile_max_size);
     profile_unique_time_.reserve(profile_max_size);
+    // Empty profile, with its two sentinels.
+    profile_unique_time_.emplace_back(kint64min, 0);
+    profile_unique_time_.emplace_back(kint64max, 0);
   }
 
   virtual ~CumulativeTimeTable() { STLDeleteElements(&by_start_min_); }
@@ -1693,34 +1714,95 @@ class CumulativeTimeTable : public Constraint {
   virtual std::string DebugString() const { return "CumulativeTimeTable"; }
 
  private:
-  // Build the usage profile. Runs in O(n log n).
-  void BuildProfile() {
-    // Build profile with non unique time
-    profile_non_unique_time_.clear();
-    for (const Task* const task : by_start_min_) {
+  // A profile delta tagged with the index in tasks_ of the task it comes from.
+  struct TaskEvent {
+    TaskEvent(int64 _time, int64 _delta, int _task)
+        : time(_time), delta(_delta), task(_task) {}
+    int64 time;
+    int64 delta;
+    int task;
+  };
+
+  static bool EventTimeLessThan(const TaskEvent& event1,
+                                const TaskEvent& event2) {
+    return event1.time < event2.time;
+  }
+
+  // Updates the cached compulsory parts and the sorted list of events. Runs in
+  // O(n + k log k) with k the number of tasks whose compulsory part changed,
+  // and returns false if no compulsory part changed.
+  bool UpdateEvents() {
+    int num_changed = 0;
+    for (int i = 0; i < tasks_.size(); ++i) {
+      const Task* const task = tasks_[i];
       const IntervalVar* const interval = task->interval;
-      const int64 start_max = interval->StartMax();
-      const int64 end_min = interval->EndMin();
-      if (interval->MustBePerformed() && start_max < end_min) {
-        const int64 demand_min = task->DemandMin();
-        if (demand_min > 0) {
-          profile_non_unique_time_.emplace_back(start_max, +demand_min);
-          profile_non_unique_time_.emplace_back(end_min, -demand_min);
+      int64 start_max = 0;
+      int64 end_min = 0;
+      int64 demand_min = 0;
+      if (interval->MustBePerformed()) {
+        start_max = interval->StartMax();
+        end_min = interval->EndMin();
+        if (start_max < end_min) {
+          demand_min = std::max(int64{0}, task->DemandMin());
+        }
+      }
+      if (demand_min == 0) {
+        start_max = 0;
+        end_min = 0;
+      }
+      if (start_max != part_start_[i] || end_min != part_end_[i] ||
+          demand_min != part_demand_[i]) {
+        part_start_[i] = start_max;
+        part_end_[i] = end_min;
+        part_demand_[i] = demand_min;
+        changed_[i] = true;
+        ++num_changed;
+      }
+    }
+    if (num_changed == 0) {
+      return false;
+    }
+    // Remove the events of the changed tasks, and collect their new events.
+    new_events_.clear();
+    int kept = 0;
+    for (const TaskEvent& event : events_) {
+      if (!changed_[event.task]) {
+        events_[kept++] = event;
+      }
+    }
+    events_.erase(events_.begin() + kept, events_.end());
+    for (int i = 0; i < tasks_.size(); ++i) {
+      if (changed_[i]) {
+        changed_[i] = false;
+        if (part_demand_[i] > 0) {
+          new_events_.emplace_back(part_start_[i], +part_demand_[i], i);
+          new_events_.emplace_back(part_end_[i], -part_demand_[i], i);
         }
       }
     }
-    // Sort
-    std::sort(profile_non_unique_time_.begin(), profile_non_unique_time_.end(),
-              TimeLessThan);
+    // Merge them back.
+    std::sort(new_events_.begin(), new_events_.end(), EventTimeLessThan);
+    events_.insert(events_.end(), new_events_.begin(), new_events_.end());
+    std::inplace_merge(events_.begin(), events_.begin() + kept, events_.end(),
+                       EventTimeLessThan);
+    return true;
+  }
+
+  // Build the usage profile. Runs in O(n + k log k), see UpdateEvents().
+  void BuildProfile() {
+    if (!UpdateEvents()) {
+      capacity_->SetMin(max_usage_);
+      return;
+    }
     // Build profile with unique times
     profile_unique_time_.clear();
     profile_unique_time_.emplace_back(kint64min, 0);
     int64 usage = 0;
-    for (const ProfileDelta& step : profile_non_unique_time_) {
+    for (const TaskEvent& step : events_) {
       if (step.time == profile_unique_time_.back().time) {
         profile_unique_time_.back().delta += step.delta;
       } else {
-        profile_unique_time_.push_back(step);
+        profile_unique_time_.emplace_back(step.time, step.delta);
       }
       // Update usage.
       usage += step.delta;
@@ -1728,23 +1810,43 @@ class CumulativeTimeTable : public Constraint {
     // Check final usage to be 0.
     DCHECK_EQ(0, usage);
     // Scan to find max usage.
-    int64 max_usage = 0;
+    max_usage_ = 0;
     for (const ProfileDelta& step : profile_unique_time_) {
       usage += step.delta;
-      if (usage > max_usage) {
-        max_usage = usage;
+      if (usage > max_usage_) {
+        max_usage_ = usage;
       }
     }
     DCHECK_EQ(0, usage);
-    capacity_->SetMin(max_usage);
     // Add a sentinel.
     profile_unique_time_.emplace_back(kint64max, 0);
+    capacity_->SetMin(max_usage_);
   }
 
   // Update the start min for all tasks. Runs in O(n^2) and Omega(n).
   void PushTasks() {
-    std::sort(by_start_min_.begin(), by_start_min_.end(),
-              StartMinLessThan<Task>);
+    // A task can only be pushed if the profile exceeds the residual capacity
+    // somewhere, which cannot happen if the peak of the profile fits.
+    const int64 capacity_max = capacity_->Max();
+    bool may_push = false;
+    for (const Task* const task : by_start_min_) {
+      const IntervalVar* const interval = task->interval;
+      const int64 demand_min = task->DemandMin();
+      if (demand_min > 0 && max_usage_ > capacity_max - demand_min &&
+          (interval->StartMin() != interval->StartMax() ||
+           interval->EndMin() != interval->EndMax())) {
+        may_push = true;
+        break;
+      }
+    }
+    if (!may_push) {
+      return;
+    }
+    if (!std::is_sorted(by_start_min_.begin(), by_start_min_.end(),
+                        StartMinLessThan<Task>)) {
+      std::sort(by_start_min_.begin(), by_start_min_.end(),
+                StartMinLessThan<Task>);
+    }
     int64 usage = 0;
     int profile_index = 0;
     for (const Task* const task : by_start_min_) {
@@ -1830,9 +1932,22 @@ class CumulativeTimeTable : public Constraint {
   typedef std::vector<ProfileDelta> Profile;
 
   Profile profile_unique_time_;
-  Profile profile_non_unique_time_;
+  // Events of the compulsory parts, sorted by time.
+  std::vector<TaskEvent> events_;
+  std::vector<TaskEvent> new_events_;
+  // Tasks in their original order, used to index the cached compulsory parts.
+  const std::vector<Task*> tasks_;
   std::vector<Task*> by_start_min_;
   IntVar* const capacity_;
+  // Compulsory part [part_start_[i], part_end_[i]) of tasks_[i] with demand
+  // part_demand_[i] as of the last call to BuildProfile(). part_demand_[i] is
+  // 0 if the task had no compulsory part.
+  std::vector<int64> part_start_;
+  std::vector<int64> part_end_;
+  std::vector<int64> part_demand_;
+  std::vector<bool> changed_;
+  // Peak of the profile.
+  int64 max_usage_;
 
   DISALLOW_COPY_AND_ASSIGN(CumulativeTimeTable);
 };
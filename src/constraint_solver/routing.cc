@@ -15,9 +15,12 @@
 #include "constraint_solver/routing.h"
 
 #include <algorithm>
+#include <climits>
 #include <cmath>
 #include <cstddef>
 #include <cstring>
+#include <functional>
+#include <limits>
 #include "base/hash.h"
 #include <map>
 #include "base/unique_ptr.h"
@@ -28,10 +31,12 @@
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/map_util.h"
+#include "base/mutex.h"
 #include "base/stl_util.h"
 #include "base/fingerprint2011.h"
 #include "base/hash.h"
-#include "graph/linear_assignment.h"
+#include "base/threadpool.h"
+#include "util/piecewise_linear_function.h"
 #include "util/saturated_arithmetic.h"
 
 namespace operations_research {
@@ -68,6 +73,11 @@ DEFINE_bool(routing_use_chain_make_inactive, false,
             "Routing: use chain version of MakeInactive neighborhood.");
 DEFINE_bool(routing_use_extended_swap_active, false,
             "Routing: use extended version of SwapActive neighborhood.");
+DEFINE_bool(routing_no_ruin_recreate, true,
+            "Routing: forbids use of RuinAndRecreate neighborhood.");
+DEFINE_int32(routing_ruin_recreate_size, 10,
+             "Routing: number of nodes removed by the RuinAndRecreate "
+             "neighborhood.");
 
 // Search limits
 DEFINE_int64(routing_solution_limit, kint64max,
@@ -121,6 +131,16 @@ DEFINE_int64(savings_filter_radius, 0,
              "Use filter which filters the pair of orders considered in "
              "Savings first solution heuristic by limiting the distance "
              "up to which a neighbor is considered for each node.");
+DEFINE_int64(savings_threads, 1,
+             "Number of threads computing and sorting the pairs of orders "
+             "considered in Savings first solution heuristic. Arc cost "
+             "callbacks must be thread-safe when greater than 1 and "
+             "routing_cache_callbacks is not set.");
+DEFINE_int64(routing_nearest_neighbors_threads, 1,
+             "Number of threads computing the nearest neighbor lists of nodes "
+             "shared by Lin-Kernighan and the Savings heuristic. Arc cost and "
+             "transit callbacks must be thread-safe when greater than 1 and "
+             "routing_cache_callbacks is not set.");
 DEFINE_int64(sweep_sectors, 1,
              "The number of sectors the space is divided before it is sweeped "
              "by the ray.");
@@ -128,11 +148,20 @@ DEFINE_int64(sweep_sectors, 1,
 // Propagation control
 DEFINE_bool(routing_use_light_propagation, false,
             "Use constraints with light propagation in routing model.");
+DEFINE_int64(routing_max_successors, 0,
+             "If positive, restricts the successors of each node which is not "
+             "a vehicle start to its routing_max_successors nearest neighbors "
+             "for each cost class, vehicle ends and the node itself. Shrinks "
+             "the search space of very large instances at the expense of "
+             "solution quality.");
 
 // Misc
 DEFINE_bool(routing_cache_callbacks, false, "Cache callback calls.");
 DEFINE_int64(routing_max_cache_size, 1000,
              "Maximum cache size when callback caching is on.");
+DEFINE_int64(routing_cache_threads, 1,
+             "Number of threads filling callback caches when the model is "
+             "closed. Callbacks must be thread-safe when greater than 1.");
 DEFINE_bool(routing_trace, false, "Routing: trace search.");
 DEFINE_bool(routing_search_trace, false,
             "Routing: use SearchTrace for monitoring search.");
@@ -457,6 +486,8 @@ class MakePairActiveOperator : public PathOperator {
   // Required to ensure that after synchronization the operator is in a state
   // compatible with GetBaseNodeRestartPosition.
   virtual bool RestartAtPathStartOnSynchronize() { return true; }
+  // Base nodes are iterated once per inactive pair.
+  virtual bool SupportsDontLookBits() const { return false; }
 
  private:
   virtual void OnNodeInitialization();
@@ -611,8 +642,422 @@ LocalSearchOperator* MakePairRelocate(
       vars, secondary_vars, start_empty_path_class, pairs));
 }
 
+// Operator which exchanges the positions of two pairs of nodes: the first
+// node of each pair takes the position of the first node of the other pair,
+// and likewise for second nodes.
+// Possible neighbor for the paths 1 -> A -> B -> 2 and 3 -> C -> D -> 4
+// (where (1, 2) and (3, 4) are first and last nodes of the paths and can
+// therefore not be moved, and (A, B) and (C, D) are pairs of nodes):
+//   1 -> [C] -> [D] -> 2 and 3 -> [A] -> [B] -> 4
+class PairExchangeOperator : public PathOperator {
+ public:
+  PairExchangeOperator(const std::vector<IntVar*>& vars,
+                       const std::vector<IntVar*>& secondary_vars,
+                       ResultCallback1<int, int64>* start_empty_path_class,
+                       const RoutingModel::NodePairs& node_pairs)
+      : PathOperator(vars, secondary_vars, 2, start_empty_path_class) {
+    int64 index_max = 0;
+    for (const IntVar* const var : vars) {
+      index_max = std::max(index_max, var->Max());
+    }
+    prevs_.resize(index_max + 1, -1);
+    seconds_.resize(index_max + 1, -1);
+    for (const std::pair<int64, int64> node_pair : node_pairs) {
+      seconds_[node_pair.first] = node_pair.second;
+    }
+  }
+  virtual ~PairExchangeOperator() {}
+  virtual bool MakeNeighbor();
+  virtual std::string DebugString() const { return "PairExchangeOperator"; }
+
+ private:
+  virtual void OnNodeInitialization();
+  virtual bool RestartAtPathStartOnSynchronize() { return true; }
+
+  std::vector<int> prevs_;
+  // Second node of the pair of each first node, -1 for other nodes.
+  std::vector<int> seconds_;
+};
+
+bool PairExchangeOperator::MakeNeighbor() {
+  const int64 first0 = BaseNode(0);
+  const int64 first1 = BaseNode(1);
+  // Both orders of the base nodes lead to the same neighbor.
+  if (first0 >= first1 || IsPathEnd(first1) || seconds_[first0] < 0 ||
+      seconds_[first1] < 0) {
+    return false;
+  }
+  const int64 second0 = seconds_[first0];
+  const int64 second1 = seconds_[first1];
+  if (IsInactive(second0) || IsInactive(second1)) {
+    return false;
+  }
+  // Node i of 'nodes' takes the position of node i of 'swapped'; all changes
+  // are computed from the current solution so that pairs can be interleaved.
+  const int64 nodes[] = {first0, second0, first1, second1};
+  const int64 swapped[] = {first1, second1, first0, second0};
+  auto exchanged = [&nodes, &swapped](int64 node) {
+    for (int i = 0; i < 4; ++i) {
+      if (nodes[i] == node) return swapped[i];
+    }
+    return node;
+  };
+  for (int i = 0; i < 4; ++i) {
+    const int64 prev = prevs_[nodes[i]];
+    if (exchanged(prev) == prev) {
+      SetNext(prev, swapped[i], OldPath(prev));
+    }
+    SetNext(swapped[i], exchanged(OldNext(nodes[i])), OldPath(nodes[i]));
+  }
+  return true;
+}
+
+void PairExchangeOperator::OnNodeInitialization() {
+  for (int i = 0; i < number_of_nexts(); ++i) {
+    prevs_[Next(i)] = i;
+  }
+}
+
+LocalSearchOperator* MakePairExchange(
+    Solver* const solver, const std::vector<IntVar*>& vars,
+    const std::vector<IntVar*>& secondary_vars,
+    ResultCallback1<int, int64>* start_empty_path_class,
+    const RoutingModel::NodePairs& pairs) {
+  return solver->RevAlloc(new PairExchangeOperator(
+      vars, secondary_vars, start_empty_path_class, pairs));
+}
+
+// Ruin and recreate operator: removes a set of nodes from the current solution
+// and greedily reinserts them, without resorting to a nested search as the LNS
+// operators do. Nodes are removed using one of the following strategies,
+// picked at random for each neighbor:
+// - random removal: the base node and random active nodes,
+// - radial removal: the base node and its nearest neighbors,
+// - string removal: consecutive nodes of a route starting at the base node.
+// Removed nodes are then reinserted one at a time, the node with the cheapest
+// insertion first, at the cheapest position accepted by the feasibility
+// filters (synchronized with the current solution). Insertion costs of removed
+// nodes are cached and only recomputed on the route modified by the last
+// insertion. Nodes which cannot be reinserted are left inactive; the resulting
+// neighbor is filtered by the local search filters as any other neighbor.
+class RuinAndRecreateOperator : public PathOperator {
+ public:
+  RuinAndRecreateOperator(
+      const RoutingModel& model, const std::vector<IntVar*>& vars,
+      const std::vector<IntVar*>& secondary_vars,
+      ResultCallback1<int, int64>* start_empty_path_class,
+      Solver::IndexEvaluator3* arc_evaluator,
+      ResultCallback3<const std::vector<int>*, int64, int64, int>* nearest,
+      const std::vector<LocalSearchFilter*>& filters, int ruin_size)
+      : PathOperator(vars, secondary_vars, 1, start_empty_path_class),
+        model_(model),
+        arc_evaluator_(arc_evaluator),
+        nearest_(nearest),
+        filters_(filters),
+        ruin_size_(std::max(1, ruin_size)),
+        rand_(ACMRandom::DeterministicSeed()),
+        assignment_(new Assignment(model.solver())),
+        delta_(new Assignment(model.solver())),
+        empty_(new Assignment(model.solver())) {
+    int64 max_next = -1;
+    for (const IntVar* const var : vars) {
+      max_next = std::max(max_next, var->Max());
+    }
+    prevs_.resize(max_next + 1, -1);
+    vehicles_.resize(max_next + 1, -1);
+    assignment_->MutableIntVarContainer()->Resize(number_of_nexts());
+    is_removed_.resize(number_of_nexts(), false);
+    in_delta_.resize(number_of_nexts(), false);
+  }
+  virtual ~RuinAndRecreateOperator() {}
+  virtual bool MakeNeighbor();
+  virtual std::string DebugString() const { return "RuinAndRecreate"; }
+
+ private:
+  struct Insertion {
+    int64 cost;
+    int64 prev;
+    int vehicle;
+    bool operator<(const Insertion& other) const {
+      return cost < other.cost || (cost == other.cost && prev < other.prev);
+    }
+  };
+
+  virtual void OnNodeInitialization();
+  bool IsRemovable(int64 node) const {
+    return !IsPathEnd(node) && !model_.IsStart(node) && !IsInactive(node) &&
+           !is_removed_[node];
+  }
+  void AddRemoved(int64 node) {
+    removed_.push_back(node);
+    is_removed_[node] = true;
+  }
+  void Ruin(int64 seed);
+  bool Recreate();
+  // Appends to 'insertions' the positions where 'node' can be inserted on the
+  // route of 'vehicle', with their cost.
+  void AppendInsertions(int64 node, int vehicle,
+                        std::vector<Insertion>* insertions);
+  // Returns true if the feasibility filters accept the insertion of 'node'
+  // after 'prev' on top of the changes already made to the current neighbor.
+  bool FilterAcceptInsertion(int64 node, int64 prev);
+  void AddToDelta(int64 node, int64 next);
+  void SetPrev(int64 node, int64 prev) {
+    prev_changes_.push_back(std::make_pair(node, prevs_[node]));
+    prevs_[node] = prev;
+  }
+  void RevertPrevs();
+
+  const RoutingModel& model_;
+  std::unique_ptr<Solver::IndexEvaluator3> arc_evaluator_;
+  std::unique_ptr<ResultCallback3<const std::vector<int>*, int64, int64, int>>
+      nearest_;
+  const std::vector<LocalSearchFilter*> filters_;
+  const int ruin_size_;
+  ACMRandom rand_;
+  std::unique_ptr<Assignment> assignment_;
+  std::unique_ptr<Assignment> delta_;
+  std::unique_ptr<Assignment> empty_;
+  // Predecessors of nodes in the current neighbor; changes made while
+  // building a neighbor are logged in prev_changes_ and reverted before
+  // building the next one.
+  std::vector<int64> prevs_;
+  std::vector<std::pair<int64, int64>> prev_changes_;
+  // Vehicles of nodes in the current solution (-1 for inactive nodes).
+  std::vector<int> vehicles_;
+  std::vector<int64> removed_;
+  std::vector<bool> is_removed_;
+  // Nodes whose next has been modified in the current neighbor.
+  std::vector<int64> touched_;
+  std::vector<int64> delta_nodes_;
+  std::vector<bool> in_delta_;
+  std::vector<std::vector<Insertion>> insertions_;
+};
+
+void RuinAndRecreateOperator::OnNodeInitialization() {
+  prev_changes_.clear();
+  vehicles_.assign(vehicles_.size(), -1);
+  for (int vehicle = 0; vehicle < model_.vehicles(); ++vehicle) {
+    int64 node = model_.Start(vehicle);
+    while (!IsPathEnd(node)) {
+      const int64 next = Next(node);
+      prevs_[next] = node;
+      vehicles_[node] = vehicle;
+      node = next;
+    }
+  }
+  Assignment::IntContainer* const container =
+      assignment_->MutableIntVarContainer();
+  for (int64 i = 0; i < number_of_nexts(); ++i) {
+    container->AddAtPosition(Var(i), i)->SetValue(Next(i));
+  }
+  for (LocalSearchFilter* const filter : filters_) {
+    filter->Synchronize(assignment_.get(), nullptr);
+  }
+}
+
+void RuinAndRecreateOperator::RevertPrevs() {
+  for (int i = prev_changes_.size() - 1; i >= 0; --i) {
+    prevs_[prev_changes_[i].first] = prev_changes_[i].second;
+  }
+  prev_changes_.clear();
+}
+
+bool RuinAndRecreateOperator::MakeNeighbor() {
+  RevertPrevs();
+  for (const int64 node : removed_) {
+    is_removed_[node] = false;
+  }
+  removed_.clear();
+  touched_.clear();
+  const int64 seed = BaseNode(0);
+  if (!IsRemovable(seed)) {
+    return false;
+  }
+  Ruin(seed);
+  for (const int64 node : removed_) {
+    const int64 prev = prevs_[node];
+    const int64 next = Next(node);
+    if (!MakeChainInactive(prev, node)) {
+      return false;
+    }
+    SetPrev(next, prev);
+    touched_.push_back(prev);
+  }
+  return Recreate();
+}
+
+void RuinAndRecreateOperator::Ruin(int64 seed) {
+  AddRemoved(seed);
+  switch (rand_.Uniform(3)) {
+    case 0: {
+      for (int attempts = 0;
+           attempts < 4 * ruin_size_ && removed_.size() < ruin_size_;
+           ++attempts) {
+        const int64 node = rand_.Uniform(number_of_nexts());
+        if (IsRemovable(node)) {
+          AddRemoved(node);
+        }
+      }
+      break;
+    }
+    case 1: {
+      const std::vector<int>& neighbors =
+          *nearest_->Run(seed, vehicles_[seed], ruin_size_);
+      for (const int neighbor : neighbors) {
+        if (removed_.size() >= ruin_size_) break;
+        if (IsRemovable(neighbor)) {
+          AddRemoved(neighbor);
+        }
+      }
+      break;
+    }
+    default: {
+      int64 node = Next(seed);
+      while (removed_.size() < ruin_size_ && IsRemovable(node)) {
+        AddRemoved(node);
+        node = Next(node);
+      }
+      break;
+    }
+  }
+}
+
+bool RuinAndRecreateOperator::Recreate() {
+  const int num_removed = removed_.size();
+  insertions_.resize(num_removed);
+  for (int i = 0; i < num_removed; ++i) {
+    insertions_[i].clear();
+    for (int vehicle = 0; vehicle < model_.vehicles(); ++vehicle) {
+      AppendInsertions(removed_[i], vehicle, &insertions_[i]);
+    }
+  }
+  std::vector<bool> pending(num_removed, true);
+  for (int remaining = num_removed; remaining > 0; --remaining) {
+    int best = -1;
+    int64 best_cost = kint64max;
+    for (int i = 0; i < num_removed; ++i) {
+      if (!pending[i]) continue;
+      for (const Insertion& insertion : insertions_[i]) {
+        if (best == -1 || insertion.cost < best_cost) {
+          best = i;
+          best_cost = insertion.cost;
+        }
+      }
+    }
+    if (best == -1) break;
+    pending[best] = false;
+    const int64 node = removed_[best];
+    std::vector<Insertion>& insertions = insertions_[best];
+    std::sort(insertions.begin(), insertions.end());
+    int vehicle = -1;
+    for (const Insertion& insertion : insertions) {
+      if (FilterAcceptInsertion(node, insertion.prev)) {
+        const int64 next = Next(insertion.prev);
+        MakeActive(node, insertion.prev);
+        SetPrev(node, insertion.prev);
+        SetPrev(next, node);
+        is_removed_[node] = false;
+        touched_.push_back(node);
+        vehicle = insertion.vehicle;
+        break;
+      }
+    }
+    if (vehicle == -1) {
+      // Inactive nodes must be allowed by the domain of their next variable.
+      if (!Var(node)->Contains(node)) return false;
+      continue;
+    }
+    for (int i = 0; i < num_removed; ++i) {
+      if (!pending[i]) continue;
+      std::vector<Insertion>& node_insertions = insertions_[i];
+      node_insertions.erase(
+          std::remove_if(node_insertions.begin(), node_insertions.end(),
+                         [vehicle](const Insertion& insertion) {
+                           return insertion.vehicle == vehicle;
+                         }),
+          node_insertions.end());
+      AppendInsertions(removed_[i], vehicle, &node_insertions);
+    }
+  }
+  // Nodes which could not be inserted at all are left inactive.
+  for (const int64 node : removed_) {
+    if (is_removed_[node] && !Var(node)->Contains(node)) return false;
+  }
+  return true;
+}
+
+void RuinAndRecreateOperator::AppendInsertions(
+    int64 node, int vehicle, std::vector<Insertion>* insertions) {
+  const IntVar* const node_var = Var(node);
+  int64 prev = model_.Start(vehicle);
+  while (!IsPathEnd(prev)) {
+    const int64 next = Next(prev);
+    if (Var(prev)->Contains(node) && node_var->Contains(next)) {
+      const int64 cost =
+          CapSub(CapAdd(arc_evaluator_->Run(prev, node, vehicle),
+                        arc_evaluator_->Run(node, next, vehicle)),
+                 arc_evaluator_->Run(prev, next, vehicle));
+      insertions->push_back({cost, prev, vehicle});
+    }
+    prev = next;
+  }
+}
+
+void RuinAndRecreateOperator::AddToDelta(int64 node, int64 next) {
+  if (!in_delta_[node]) {
+    in_delta_[node] = true;
+    delta_nodes_.push_back(node);
+    delta_->FastAdd(Var(node))->SetValue(next);
+  }
+}
+
+bool RuinAndRecreateOperator::FilterAcceptInsertion(int64 node, int64 prev) {
+  delta_->Clear();
+  // Removed nodes which are still pending are kept out of the delta; they are
+  // not reachable from path starts anymore.
+  AddToDelta(prev, node);
+  AddToDelta(node, Next(prev));
+  for (const int64 touched : touched_) {
+    if (!is_removed_[touched]) {
+      AddToDelta(touched, Next(touched));
+    }
+  }
+  // All incremental filters must be called.
+  bool ok = true;
+  for (LocalSearchFilter* const filter : filters_) {
+    if (filter->IsIncremental() || ok) {
+      ok = filter->Accept(delta_.get(), empty_.get()) && ok;
+    }
+  }
+  for (const int64 delta_node : delta_nodes_) {
+    in_delta_[delta_node] = false;
+  }
+  delta_nodes_.clear();
+  return ok;
+}
+
+LocalSearchOperator* MakeRuinAndRecreate(
+    Solver* solver, const RoutingModel& model, const std::vector<IntVar*>& vars,
+    const std::vector<IntVar*>& secondary_vars,
+    ResultCallback1<int, int64>* start_empty_path_class,
+    Solver::IndexEvaluator3* arc_evaluator,
+    ResultCallback3<const std::vector<int>*, int64, int64, int>* nearest,
+    const std::vector<LocalSearchFilter*>& filters, int ruin_size) {
+  return solver->RevAlloc(new RuinAndRecreateOperator(
+      model, vars, secondary_vars, start_empty_path_class, arc_evaluator,
+      nearest, filters, ruin_size));
+}
+
+}  // namespace
+
 // Cached callbacks
 
+// Dense cache of a node evaluator, storing all its values in a flat row-major
+// matrix. Values are stored on 32 bits when they all fit, which halves the
+// memory used by the cache in most practical cases. Identical matrices are
+// shared between all caches of the process, including caches of different
+// routing models.
 class RoutingCache : public RoutingModel::NodeEvaluator2 {
  public:
   // Creates a new cached callback based on 'callback'. The cache object does
@@ -623,38 +1068,151 @@ class RoutingCache : public RoutingModel::NodeEvaluator2 {
   // directly, but through RoutingModel::NewCachedCallback that ensures that the
   // base callback is deleted properly.
   RoutingCache(RoutingModel::NodeEvaluator2* callback, int size)
-      : cached_(size), cache_(size), callback_(callback) {
-    for (RoutingModel::NodeIndex i(0); i < RoutingModel::NodeIndex(size); ++i) {
-      cached_[i].resize(size, false);
-      cache_[i].resize(size, 0);
-    }
+      : size_(size), callback_(callback) {
     callback->CheckIsRepeatable();
   }
   virtual bool IsRepeatable() const { return true; }
+  // Calls are forwarded to the underlying callback until Precompute() is
+  // called; the cache is read-only and therefore MT-safe after that.
   virtual int64 Run(RoutingModel::NodeIndex i, RoutingModel::NodeIndex j) {
-    // This method does lazy caching of results of callbacks: first
-    // checks if it has been run with these parameters before, and
-    // returns previous result if so, or runs underlaying callback and
-    // stores its result.
-    // Not MT-safe.
-    if (cached_[i][j]) {
-      return cache_[i][j];
-    } else {
-      const int64 cached_value = callback_->Run(i, j);
-      cached_[i][j] = true;
-      cache_[i][j] = cached_value;
-      return cached_value;
+    if (matrix_ == nullptr) return callback_->Run(i, j);
+    const int64 index = static_cast<int64>(i.value()) * size_ + j.value();
+    return matrix_->values32.empty() ? matrix_->values64[index]
+                                     : matrix_->values32[index];
+  }
+  // Evaluates the underlying callback on all pairs of nodes, splitting rows
+  // among 'num_threads' threads; the callback must be thread-safe if
+  // 'num_threads' is greater than 1.
+  void Precompute(int num_threads) {
+    if (matrix_ != nullptr) return;
+    std::unique_ptr<Matrix> matrix(new Matrix);
+    if (!ComputeValues(num_threads, &matrix->values32)) {
+      matrix->values32.clear();
+      matrix->values32.shrink_to_fit();
+      CHECK(ComputeValues(num_threads, &matrix->values64));
     }
+    matrix_ = ShareMatrix(matrix.release());
   }
 
  private:
-  ITIVector<RoutingModel::NodeIndex, ITIVector<RoutingModel::NodeIndex, bool>>
-      cached_;
-  ITIVector<RoutingModel::NodeIndex, ITIVector<RoutingModel::NodeIndex, int64>>
-      cache_;
+  struct Matrix {
+    // Only one of the vectors is non-empty.
+    std::vector<int32> values32;
+    std::vector<int64> values64;
+    bool operator==(const Matrix& other) const {
+      return values32 == other.values32 && values64 == other.values64;
+    }
+  };
+
+  // Fills 'values', returns false if a value does not fit in T.
+  template <class T>
+  bool ComputeValues(int num_threads, std::vector<T>* values) {
+    values->resize(static_cast<int64>(size_) * size_);
+    if (num_threads == 1) {
+      bool valid = true;
+      ComputeRows(0, size_, values, &valid);
+      return valid;
+    }
+    const int rows_per_thread = (size_ + num_threads - 1) / num_threads;
+    std::unique_ptr<bool[]> valid(new bool[num_threads]);
+    int num_tasks = 0;
+    {
+      ThreadPool pool("RoutingCache", num_threads);
+      for (int begin = 0; begin < size_; begin += rows_per_thread) {
+        pool.Add(NewCallback(this, &RoutingCache::ComputeRows<T>, begin,
+                             std::min(begin + rows_per_thread, size_), values,
+                             &valid[num_tasks]));
+        ++num_tasks;
+      }
+      pool.StartWorkers();
+    }
+    for (int i = 0; i < num_tasks; ++i) {
+      if (!valid[i]) return false;
+    }
+    return true;
+  }
+
+  template <class T>
+  void ComputeRows(int begin, int end, std::vector<T>* values, bool* valid) {
+    *valid = true;
+    for (int i = begin; i < end; ++i) {
+      for (int j = 0; j < size_; ++j) {
+        const int64 value = callback_->Run(RoutingModel::NodeIndex(i),
+                                           RoutingModel::NodeIndex(j));
+        if (value < std::numeric_limits<T>::min() ||
+            value > std::numeric_limits<T>::max()) {
+          *valid = false;
+          return;
+        }
+        (*values)[static_cast<int64>(i) * size_ + j] = value;
+      }
+    }
+  }
+
+  // Returns a matrix equal to 'matrix' which is shared with other caches if
+  // one already exists, otherwise registers 'matrix'. Takes ownership of
+  // 'matrix'.
+  static std::shared_ptr<const Matrix> ShareMatrix(Matrix* matrix) {
+    std::shared_ptr<const Matrix> shared(matrix);
+    const uint64 fprint =
+        matrix->values32.empty()
+            ? Fingerprint2011(
+                  reinterpret_cast<const char*>(matrix->values64.data()),
+                  matrix->values64.size() * sizeof(int64))
+            : Fingerprint2011(
+                  reinterpret_cast<const char*>(matrix->values32.data()),
+                  matrix->values32.size() * sizeof(int32));
+    static Mutex registry_mutex;
+    static std::multimap<uint64, std::weak_ptr<const Matrix>>* const registry =
+        new std::multimap<uint64, std::weak_ptr<const Matrix>>;
+    MutexLock lock(&registry_mutex);
+    auto it = registry->lower_bound(fprint);
+    while (it != registry->end() && it->first == fprint) {
+      std::shared_ptr<const Matrix> registered = it->second.lock();
+      if (registered == nullptr) {
+        it = registry->erase(it);
+      } else if (*registered == *matrix) {
+        return registered;
+      } else {
+        ++it;
+      }
+    }
+    registry->insert(std::make_pair(fprint, shared));
+    return shared;
+  }
+
+  const int size_;
   RoutingModel::NodeEvaluator2* const callback_;
+  std::shared_ptr<const Matrix> matrix_;
 };
 
+void RoutingModel::PrecomputeCachedCallbacks() {
+  const int num_threads =
+      std::max<int64>(1, std::min<int64>(FLAGS_routing_cache_threads,
+                                         node_to_index_.size()));
+  for (const auto& cached_callback : cached_node_callbacks_) {
+    cached_callback.second->Precompute(num_threads);
+  }
+}
+
+namespace {
+
+// Calls function(begin, end) on consecutive chunks of [0, size), with up to
+// FLAGS_routing_cache_threads threads including the calling one. Used when
+// closing the model, with the thread-safety requirements of callback caches.
+void RunOnRoutingCacheThreads(int size,
+                              const std::function<void(int, int)>& function) {
+  const int num_workers =
+      std::min<int64>(FLAGS_routing_cache_threads, size) - 1;
+  if (num_workers <= 0) {
+    function(0, size);
+    return;
+  }
+  ThreadPool pool("RoutingCloseModel", num_workers);
+  pool.StartWorkers();
+  pool.ParallelFor(0, size, 1, function);
+}
+
 // Evaluators
 
 class MatrixEvaluator : public BaseObject {
@@ -683,6 +1241,24 @@ class MatrixEvaluator : public BaseObject {
   RoutingModel* const model_;
 };
 
+// Evaluator owning a copy of a dense row-major matrix; unlike MatrixEvaluator,
+// it is a permanent callback which does not depend on a model.
+class DenseMatrixEvaluator : public RoutingModel::NodeEvaluator2 {
+ public:
+  DenseMatrixEvaluator(const int64* values, int size)
+      : values_(values, values + static_cast<int64>(size) * size),
+        size_(size) {}
+  virtual ~DenseMatrixEvaluator() {}
+  virtual bool IsRepeatable() const { return true; }
+  virtual int64 Run(RoutingModel::NodeIndex i, RoutingModel::NodeIndex j) {
+    return values_[static_cast<int64>(i.value()) * size_ + j.value()];
+  }
+
+ private:
+  const std::vector<int64> values_;
+  const int size_;
+};
+
 class VectorEvaluator : public BaseObject {
  public:
   VectorEvaluator(const int64* values, int64 nodes, RoutingModel* model)
@@ -768,6 +1344,7 @@ RoutingModel::RoutingModel(int nodes, int vehicles)
       restore_assignment_(nullptr),
       assignment_(nullptr),
       preassignment_(nullptr),
+      reoptimization_start_(nullptr),
       time_limit_ms_(FLAGS_routing_time_limit),
       lns_time_limit_ms_(FLAGS_routing_lns_time_limit),
       limit_(nullptr),
@@ -804,6 +1381,7 @@ RoutingModel::RoutingModel(int nodes, int vehicles,
       restore_assignment_(nullptr),
       assignment_(nullptr),
       preassignment_(nullptr),
+      reoptimization_start_(nullptr),
       time_limit_ms_(FLAGS_routing_time_limit),
       lns_time_limit_ms_(FLAGS_routing_lns_time_limit),
       limit_(nullptr),
@@ -849,6 +1427,7 @@ RoutingModel::RoutingModel(int nodes, int vehicles,
       restore_assignment_(nullptr),
       assignment_(nullptr),
       preassignment_(nullptr),
+      reoptimization_start_(nullptr),
       time_limit_ms_(FLAGS_routing_time_limit),
       lns_time_limit_ms_(FLAGS_routing_lns_time_limit),
       limit_(nullptr),
@@ -1004,6 +1583,193 @@ bool RoutingModel::AddVectorDimension(const int64* values, int64 capacity,
                       0, capacity, fix_start_cumul_to_zero, dimension_name);
 }
 
+RoutingModel::NodeEvaluator2* RoutingModel::NewMatrixEvaluator(
+    const int64* values, int size) {
+  CHECK(values != nullptr || size == 0) << "null pointer";
+  CHECK_GE(size, 0);
+  return new DenseMatrixEvaluator(values, size);
+}
+
+namespace {
+// Travel time profile of an arc of a time dependent dimension. It is
+// evaluated with a cursor on the segment of the last evaluation, successive
+// evaluations at close times being usual during the search.
+class ArcTravelTimeProfile {
+ public:
+  explicit ArcTravelTimeProfile(const PiecewiseLinearFunction* function)
+      : function_(function),
+        min_travel_time_(function->GetMinimum()),
+        cursor_(function) {
+    const std::vector<PiecewiseSegment>& segments = function->segments();
+    // Checks the FIFO property: the arrival time t + f(t) is non-decreasing.
+    for (int i = 0; i < segments.size(); ++i) {
+      CHECK_GE(segments[i].slope(), -1) << "Travel time profile is not FIFO";
+      CHECK(i == 0 ||
+            segments[i].start_x() + segments[i].start_y() >=
+                segments[i - 1].end_x() + segments[i - 1].end_y())
+          << "Travel time profile is not FIFO";
+    }
+  }
+
+  int64 min_travel_time() const { return min_travel_time_; }
+
+  int64 Value(int64 departure) const { return cursor_.Value(departure); }
+
+  int64 Minimum(int64 start, int64 end) const {
+    return function_->GetMinimum(start, end);
+  }
+  int64 Maximum(int64 start, int64 end) const {
+    return function_->GetMaximum(start, end);
+  }
+
+ private:
+  const PiecewiseLinearFunction* const function_;
+  const int64 min_travel_time_;
+  mutable PiecewiseLinearFunction::Cursor cursor_;
+};
+
+// Profiles of the arcs of a time dependent dimension, built on demand.
+class TimeDependentTransits : public BaseObject {
+ public:
+  TimeDependentTransits(RoutingModel* const model,
+                        RoutingModel::TravelTimeProfileEvaluator* profiles)
+      : model_(model), profiles_(profiles) {
+    profiles_->CheckIsRepeatable();
+  }
+  virtual ~TimeDependentTransits() { STLDeleteValues(&arc_profiles_); }
+
+  const ArcTravelTimeProfile& Profile(RoutingModel::NodeIndex from,
+                                      RoutingModel::NodeIndex to) {
+    const int64 arc = static_cast<int64>(from.value()) * model_->nodes() +
+                      to.value();
+    ArcTravelTimeProfile*& profile = arc_profiles_[arc];
+    if (profile == nullptr) {
+      const PiecewiseLinearFunction* const function = profiles_->Run(from, to);
+      CHECK(function != nullptr) << "No travel time profile for arc " << from
+                                 << " -> " << to;
+      profile = new ArcTravelTimeProfile(function);
+    }
+    return *profile;
+  }
+
+  int64 MinTravelTime(RoutingModel::NodeIndex from,
+                      RoutingModel::NodeIndex to) {
+    return Profile(from, to).min_travel_time();
+  }
+
+ private:
+  RoutingModel* const model_;
+  std::unique_ptr<RoutingModel::TravelTimeProfileEvaluator> profiles_;
+  hash_map<int64, ArcTravelTimeProfile*> arc_profiles_;
+};
+
+// Links the slacks of a time dependent dimension to the departure times:
+// slack(i) = travel_time(i, next(i), cumul(i)) - min_travel_time(i, next(i))
+// + waiting time, with 0 <= waiting time <= slack_max. Since profiles are FIFO,
+// cumul(next(i)) >= arrival(cumul(i)) >= arrival(min cumul(i)), and the latest
+// departure from i is bounded by the max cumul of next(i).
+class TimeDependentTransitConstraint : public Constraint {
+ public:
+  TimeDependentTransitConstraint(RoutingModel* const model,
+                                 const RoutingDimension* dimension,
+                                 TimeDependentTransits* transits,
+                                 int64 slack_max)
+      : Constraint(model->solver()),
+        model_(model),
+        dimension_(dimension),
+        transits_(transits),
+        slack_max_(slack_max) {}
+  virtual ~TimeDependentTransitConstraint() {}
+
+  virtual void Post() {
+    for (int i = 0; i < model_->Size(); ++i) {
+      Demon* const demon = MakeConstraintDemon1(
+          solver(), this, &TimeDependentTransitConstraint::PropagateNode,
+          "PropagateNode", i);
+      model_->NextVar(i)->WhenBound(demon);
+      dimension_->CumulVar(i)->WhenRange(demon);
+    }
+  }
+
+  virtual void InitialPropagate() {
+    for (int i = 0; i < model_->Size(); ++i) {
+      PropagateNode(i);
+    }
+  }
+
+  virtual std::string DebugString() const {
+    return "TimeDependentTransitConstraint(" + dimension_->name() + ")";
+  }
+
+ private:
+  void PropagateNode(int index) {
+    IntVar* const next_var = model_->NextVar(index);
+    if (!next_var->Bound() || next_var->Value() == index) return;
+    const int64 next = next_var->Value();
+    const ArcTravelTimeProfile& profile = transits_->Profile(
+        model_->IndexToNode(index), model_->IndexToNode(next));
+    IntVar* const cumul = dimension_->CumulVar(index);
+    IntVar* const next_cumul = dimension_->CumulVar(next);
+    const int64 min_departure = cumul->Min();
+    const int64 max_departure = cumul->Max();
+    const int64 min_travel_time = profile.min_travel_time();
+    if (min_departure == max_departure) {
+      const int64 delay = CapSub(profile.Value(min_departure), min_travel_time);
+      dimension_->SlackVar(index)->SetRange(delay, CapAdd(delay, slack_max_));
+    } else {
+      dimension_->SlackVar(index)->SetRange(
+          CapSub(profile.Minimum(min_departure, max_departure),
+                 min_travel_time),
+          CapAdd(CapSub(profile.Maximum(min_departure, max_departure),
+                        min_travel_time),
+                 slack_max_));
+    }
+    next_cumul->SetMin(CapAdd(min_departure, profile.Value(min_departure)));
+    // Latest departure t such that t + travel_time(t) <= max cumul of next,
+    // found by binary search since the arrival time is non-decreasing.
+    const int64 max_arrival = next_cumul->Max();
+    if (CapAdd(max_departure, profile.Value(max_departure)) > max_arrival) {
+      int64 feasible = min_departure;
+      int64 infeasible = max_departure;
+      while (infeasible - feasible > 1) {
+        const int64 middle = feasible + (infeasible - feasible) / 2;
+        if (CapAdd(middle, profile.Value(middle)) <= max_arrival) {
+          feasible = middle;
+        } else {
+          infeasible = middle;
+        }
+      }
+      cumul->SetMax(feasible);
+    }
+  }
+
+  RoutingModel* const model_;
+  const RoutingDimension* const dimension_;
+  TimeDependentTransits* const transits_;
+  const int64 slack_max_;
+};
+}  // namespace
+
+bool RoutingModel::AddTimeDependentDimension(
+    TravelTimeProfileEvaluator* profiles, int64 slack_max, int64 capacity,
+    bool fix_start_cumul_to_zero, const std::string& name) {
+  CHECK(profiles != nullptr);
+  TimeDependentTransits* const transits =
+      solver_->RevAlloc(new TimeDependentTransits(this, profiles));
+  // The slacks hold the time dependent part of the travel times, which is
+  // at most 'capacity' on feasible routes, and the waiting times.
+  if (!AddDimension(NewPermanentCallback(
+                        transits, &TimeDependentTransits::MinTravelTime),
+                    CapAdd(slack_max, capacity), capacity,
+                    fix_start_cumul_to_zero, name)) {
+    return false;
+  }
+  solver_->AddConstraint(
+      solver_->RevAlloc(new TimeDependentTransitConstraint(
+          this, &GetDimensionOrDie(name), transits, slack_max)));
+  return true;
+}
+
 bool RoutingModel::AddMatrixDimension(const int64* const* values,
                                       int64 capacity,
                                       bool fix_start_cumul_to_zero,
@@ -1195,6 +1961,43 @@ void RoutingModel::ComputeCostClasses() {
             cost_classes_[kCostClassIndexOfZeroCost].arc_cost_evaluator);
   cost_class_map[zero_cost_class] = kCostClassIndexOfZeroCost;
 
+  // Fingerprint the distinct evaluators, in parallel across evaluators. When
+  // callbacks are cached, the caches are filled first and fingerprinted
+  // instead of the evaluators, so that each evaluator is only run once on all
+  // pairs of nodes; caches of evaluators with identical matrices share their
+  // memory.
+  if (!all_evaluators_equal) {
+    std::vector<NodeEvaluator2*> evaluators;
+    for (NodeEvaluator2* const evaluator : transit_cost_of_vehicle_) {
+      if (!ContainsKey(evaluator_to_fprint, evaluator)) {
+        evaluator_to_fprint[evaluator] = kNullEvaluatorFprint;
+        evaluators.push_back(evaluator);
+      }
+    }
+    std::vector<NodeEvaluator2*> fingerprinted_evaluators = evaluators;
+    std::vector<RoutingCache*> caches(evaluators.size(), nullptr);
+    if (FLAGS_routing_fingerprint_arc_cost_evaluators) {
+      for (int i = 0; i < evaluators.size(); ++i) {
+        fingerprinted_evaluators[i] = NewCachedCallback(evaluators[i]);
+        FindCopy(cached_node_callbacks_, evaluators[i], &caches[i]);
+      }
+    }
+    const int num_threads_per_evaluator = std::max<int64>(
+        1, FLAGS_routing_cache_threads / std::max<int>(1, evaluators.size()));
+    std::vector<uint64> fprints(evaluators.size());
+    RunOnRoutingCacheThreads(evaluators.size(), [&](int begin, int end) {
+      for (int i = begin; i < end; ++i) {
+        if (caches[i] != nullptr) {
+          caches[i]->Precompute(num_threads_per_evaluator);
+        }
+        fprints[i] = GetFingerprintOfEvaluator(fingerprinted_evaluators[i]);
+      }
+    });
+    for (int i = 0; i < evaluators.size(); ++i) {
+      evaluator_to_fprint[evaluators[i]] = fprints[i];
+    }
+  }
+
   // Determine the canonicalized cost class for each vehicle, and insert it as
   // a new cost class if it doesn't exist already. Building cached evaluators on
   // the way.
@@ -1301,9 +2104,29 @@ void RoutingModel::ComputeVehicleClasses() {
   vehicle_class_index_of_vehicle_.assign(vehicles_, VehicleClassIndex(-1));
   std::map<VehicleClass, VehicleClassIndex, VehicleClassComparator>
       vehicle_class_map;
+  // The fingerprints of the nodes each vehicle cannot visit take
+  // O(vehicles * nodes) time and are computed in parallel across vehicles;
+  // the domains of the vehicle variables are only read.
   const int nodes_unvisitability_num_bytes = (vehicle_vars_.size() + 7) / 8;
-  std::unique_ptr<char[]> nodes_unvisitability_bitmask(
-      new char[nodes_unvisitability_num_bytes]);
+  std::vector<uint64> unvisitable_nodes_fprints(vehicles_);
+  RunOnRoutingCacheThreads(vehicles_, [&](int begin, int end) {
+    std::unique_ptr<char[]> nodes_unvisitability_bitmask(
+        new char[nodes_unvisitability_num_bytes]);
+    for (int vehicle = begin; vehicle < end; ++vehicle) {
+      memset(nodes_unvisitability_bitmask.get(), 0,
+             nodes_unvisitability_num_bytes);
+      for (int index = 0; index < vehicle_vars_.size(); ++index) {
+        IntVar* const vehicle_var = vehicle_vars_[index];
+        if (!IsStart(index) && !IsEnd(index) &&
+            !vehicle_var->Contains(vehicle)) {
+          nodes_unvisitability_bitmask[index / CHAR_BIT] |=
+              1U << (index % CHAR_BIT);
+        }
+      }
+      unvisitable_nodes_fprints[vehicle] = Fingerprint2011(
+          nodes_unvisitability_bitmask.get(), nodes_unvisitability_num_bytes);
+    }
+  });
   for (int vehicle = 0; vehicle < transit_cost_of_vehicle_.size(); ++vehicle) {
     VehicleClass vehicle_class;
     vehicle_class.cost_class_index = cost_class_index_of_vehicle_[vehicle];
@@ -1326,17 +2149,7 @@ void RoutingModel::ComputeVehicleClasses() {
       vehicle_class.dimension_evaluators.push_back(
           dimension->transit_evaluator(vehicle));
     }
-    memset(nodes_unvisitability_bitmask.get(), 0,
-           nodes_unvisitability_num_bytes);
-    for (int index = 0; index < vehicle_vars_.size(); ++index) {
-      IntVar* const vehicle_var = vehicle_vars_[index];
-      if (!IsStart(index) && !IsEnd(index) && !vehicle_var->Contains(vehicle)) {
-        nodes_unvisitability_bitmask[index / CHAR_BIT] |= 1U
-                                                          << (index % CHAR_BIT);
-      }
-    }
-    vehicle_class.unvisitable_nodes_fprint = Fingerprint2011(
-        nodes_unvisitability_bitmask.get(), nodes_unvisitability_num_bytes);
+    vehicle_class.unvisitable_nodes_fprint = unvisitable_nodes_fprints[vehicle];
     const VehicleClassIndex num_vehicle_classes(vehicle_classes_.size());
     const VehicleClassIndex vehicle_class_index =
         LookupOrInsert(&vehicle_class_map, vehicle_class, num_vehicle_classes);
@@ -1559,6 +2372,13 @@ void RoutingModel::CloseModel() {
 
   ComputeCostClasses();
   ComputeVehicleClasses();
+  PrecomputeCachedCallbacks();
+  nearest_neighbors_.clear();
+  nearest_neighbors_.resize(cost_classes_.size());
+  if (FLAGS_routing_max_successors > 0) {
+    RestrictSuccessorsToNearestNeighbors(
+        std::min<int64>(FLAGS_routing_max_successors, kint32max));
+  }
   vehicle_start_class_callback_.reset(
       NewPermanentCallback(this, &RoutingModel::GetVehicleStartClass));
 
@@ -2613,7 +3433,12 @@ void RoutingModel::AddSearchMonitor(SearchMonitor* const monitor) {
 }
 
 const Assignment* RoutingModel::SolveWithParameters(
-    const RoutingSearchParameters& p, const Assignment* assignment) {
+    const RoutingSearchParameters& parameters, const Assignment* assignment) {
+  SetSearchParameters(parameters);
+  return Solve(assignment);
+}
+
+void RoutingModel::SetSearchParameters(const RoutingSearchParameters& p) {
   FLAGS_routing_no_lns = p.no_lns;
   FLAGS_routing_no_fullpathlns = p.no_fullpathlns;
   FLAGS_routing_no_relocate = p.no_relocate;
@@ -2628,6 +3453,8 @@ const Assignment* RoutingModel::SolveWithParameters(
   FLAGS_routing_no_tsplns = p.no_tsplns;
   FLAGS_routing_use_chain_make_inactive = p.use_chain_make_inactive;
   FLAGS_routing_use_extended_swap_active = p.use_extended_swap_active;
+  FLAGS_routing_no_ruin_recreate = p.no_ruin_recreate;
+  FLAGS_routing_ruin_recreate_size = p.ruin_recreate_size;
   FLAGS_routing_solution_limit = p.solution_limit;
   FLAGS_routing_time_limit = p.time_limit;
   time_limit_ms_ = p.time_limit;
@@ -2643,8 +3470,468 @@ const Assignment* RoutingModel::SolveWithParameters(
   FLAGS_routing_use_first_solution_dive = p.use_first_solution_dive;
   FLAGS_routing_optimization_step = p.optimization_step;
   FLAGS_routing_trace = p.trace;
+}
 
-  return Solve(assignment);
+namespace {
+// Runs one round of a worker of RoutingModel::SolveInParallel().
+void SolveRoutingModelRound(RoutingModel* model, const Assignment* assignment,
+                            const Assignment** solution) {
+  *solution = model->Solve(assignment);
+}
+}  // namespace
+
+const Assignment* RoutingModel::SolveInParallel(
+    const RoutingParallelSearchParameters& parameters,
+    ResultCallback<RoutingModel*>* model_builder) {
+  const int num_workers = parameters.workers.size();
+  CHECK_GT(num_workers, 0);
+  CHECK(!closed_) << "The model must not be closed";
+  // Search parameters are passed through flags which are read when models are
+  // closed, so all models are built and closed before the workers start.
+  std::vector<RoutingModel*> models(1, this);
+  std::vector<std::unique_ptr<RoutingModel>> owned_models;
+  for (int worker = 1; worker < num_workers; ++worker) {
+    owned_models.emplace_back(model_builder->Run());
+    models.push_back(owned_models.back().get());
+    CHECK(!models.back()->closed_) << "The model must not be closed";
+    CHECK_EQ(Size(), models.back()->Size());
+    CHECK_EQ(vehicles_, models.back()->vehicles());
+  }
+  for (int worker = 0; worker < num_workers; ++worker) {
+    models[worker]->SetSearchParameters(parameters.workers[worker]);
+    models[worker]->CloseModel();
+  }
+  const int64 start_time_ms = solver_->wall_time();
+  std::vector<const Assignment*> solutions(num_workers, nullptr);
+  std::vector<const Assignment*> starts(num_workers, nullptr);
+  std::vector<std::vector<NodeIndex>> best_routes;
+  std::vector<std::vector<NodeIndex>> polished_routes;
+  int64 best_cost = kint64max;
+  bool found_solution = false;
+  // Copy of the best solution when it was found by this model.
+  Assignment* best_solution = nullptr;
+  while (true) {
+    const int64 remaining_time_ms =
+        parameters.time_limit - (solver_->wall_time() - start_time_ms);
+    if (remaining_time_ms <= 0) break;
+    const int64 round_time_ms =
+        std::min(parameters.exchange_period, remaining_time_ms);
+    const int64 round_start_time_ms = solver_->wall_time();
+    {
+      ThreadPool pool("RoutingParallelSearch", num_workers);
+      for (int worker = 0; worker < num_workers; ++worker) {
+        models[worker]->UpdateTimeLimit(round_time_ms);
+        pool.Add(NewCallback(&SolveRoutingModelRound, models[worker],
+                             starts[worker], &solutions[worker]));
+      }
+      pool.StartWorkers();
+    }
+    const bool round_ended_early =
+        solver_->wall_time() - round_start_time_ms < round_time_ms;
+    bool improved = false;
+    for (int worker = 0; worker < num_workers; ++worker) {
+      const Assignment* const solution = solutions[worker];
+      if (solution != nullptr && solution->ObjectiveValue() < best_cost) {
+        best_cost = solution->ObjectiveValue();
+        models[worker]->AssignmentToRoutes(*solution, &best_routes);
+        best_solution =
+            worker == 0 ? solver_->MakeAssignment(solution) : nullptr;
+        found_solution = true;
+        improved = true;
+      }
+    }
+    if (!found_solution || (round_ended_early && !improved)) break;
+    if (improved && parameters.polish_routes) {
+      // Only routes which changed since they were last polished are polished.
+      std::vector<bool> modified(vehicles_, true);
+      for (int vehicle = 0; vehicle < polished_routes.size(); ++vehicle) {
+        modified[vehicle] = best_routes[vehicle] != polished_routes[vehicle];
+      }
+      const Assignment* const polished =
+          PolishModifiedRoutes(modified, best_cost, num_workers, &best_routes);
+      if (polished != nullptr) {
+        best_cost = polished->ObjectiveValue();
+        best_solution = solver_->MakeAssignment(polished);
+      }
+      polished_routes = best_routes;
+    }
+    // Workers which found the best solution continue from their own solution,
+    // the others restart from the best one.
+    for (int worker = 0; worker < num_workers; ++worker) {
+      const Assignment* const solution = solutions[worker];
+      if (solution != nullptr && solution->ObjectiveValue() == best_cost) {
+        starts[worker] = solution;
+      } else {
+        Assignment* const start = models[worker]->solver()->MakeAssignment();
+        if (!models[worker]->RoutesToAssignment(best_routes, false, true,
+                                                start)) {
+          LOG(DFATAL) << "Cannot share solution with worker " << worker;
+        }
+        starts[worker] = start;
+      }
+    }
+  }
+  if (!found_solution) {
+    status_ = solver_->wall_time() - start_time_ms >= parameters.time_limit
+                  ? ROUTING_FAIL_TIMEOUT
+                  : ROUTING_FAIL;
+    return nullptr;
+  }
+  status_ = ROUTING_SUCCESS;
+  if (best_solution != nullptr) return best_solution;
+  return ReadAssignmentFromRoutes(best_routes, false);
+}
+
+namespace {
+// Splits 'nodes' into at most 'num_clusters' non-empty clusters by angle
+// around 'center', each cluster holding the same number of nodes. The sweep
+// starts after the largest angular gap between two consecutive nodes.
+void SweepClusters(
+    const ITIVector<RoutingModel::NodeIndex, std::pair<int64, int64> >& points,
+    const std::pair<double, double>& center,
+    const std::vector<RoutingModel::NodeIndex>& nodes, int num_clusters,
+    std::vector<std::vector<RoutingModel::NodeIndex> >* clusters) {
+  std::vector<std::pair<double, RoutingModel::NodeIndex> > angles;
+  for (const RoutingModel::NodeIndex node : nodes) {
+    angles.push_back(
+        std::make_pair(atan2(points[node].second - center.second,
+                             points[node].first - center.first),
+                       node));
+  }
+  std::sort(angles.begin(), angles.end());
+  const int size = angles.size();
+  int first = 0;
+  double largest_gap = -1;
+  for (int i = 0; i < size; ++i) {
+    const double next_angle =
+        i + 1 < size ? angles[i + 1].first : angles[0].first + 2 * M_PI;
+    if (next_angle - angles[i].first > largest_gap) {
+      largest_gap = next_angle - angles[i].first;
+      first = (i + 1) % size;
+    }
+  }
+  clusters->assign(num_clusters, std::vector<RoutingModel::NodeIndex>());
+  for (int i = 0; i < size; ++i) {
+    (*clusters)[static_cast<int64>(i) * num_clusters / size].push_back(
+        angles[(first + i) % size].second);
+  }
+}
+
+// Refines 'clusters' with Lloyd's k-means algorithm, for at most
+// 'max_iterations' iterations. Empty clusters are removed.
+void KMeansClusters(
+    const ITIVector<RoutingModel::NodeIndex, std::pair<int64, int64> >& points,
+    int max_iterations,
+    std::vector<std::vector<RoutingModel::NodeIndex> >* clusters) {
+  for (int iteration = 0; iteration < max_iterations; ++iteration) {
+    std::vector<std::pair<double, double> > centroids;
+    for (const std::vector<RoutingModel::NodeIndex>& cluster : *clusters) {
+      if (cluster.empty()) continue;
+      double x = 0;
+      double y = 0;
+      for (const RoutingModel::NodeIndex node : cluster) {
+        x += points[node].first;
+        y += points[node].second;
+      }
+      centroids.push_back(std::make_pair(x / cluster.size(),
+                                         y / cluster.size()));
+    }
+    std::vector<std::vector<RoutingModel::NodeIndex> > new_clusters(
+        centroids.size());
+    bool changed = centroids.size() != clusters->size();
+    for (int cluster = 0; cluster < clusters->size(); ++cluster) {
+      for (const RoutingModel::NodeIndex node : (*clusters)[cluster]) {
+        int best_centroid = 0;
+        double best_distance = std::numeric_limits<double>::infinity();
+        for (int centroid = 0; centroid < centroids.size(); ++centroid) {
+          const double dx = points[node].first - centroids[centroid].first;
+          const double dy = points[node].second - centroids[centroid].second;
+          if (dx * dx + dy * dy < best_distance) {
+            best_distance = dx * dx + dy * dy;
+            best_centroid = centroid;
+          }
+        }
+        changed |= best_centroid != cluster;
+        new_clusters[best_centroid].push_back(node);
+      }
+    }
+    clusters->swap(new_clusters);
+    if (!changed) break;
+  }
+  clusters->erase(
+      std::remove_if(clusters->begin(), clusters->end(),
+                     [](const std::vector<RoutingModel::NodeIndex>& cluster) {
+                       return cluster.empty();
+                     }),
+      clusters->end());
+}
+}  // namespace
+
+const Assignment* RoutingModel::SolveWithDecomposition(
+    const RoutingDecompositionParameters& parameters,
+    const ITIVector<NodeIndex, std::pair<int64, int64> >& points,
+    ResultCallback2<RoutingModel*, const std::vector<NodeIndex>&,
+                    const std::vector<int>&>* submodel_builder) {
+  CHECK(!closed_) << "The model must not be closed";
+  CHECK_EQ(nodes_, points.size());
+  CHECK(submodel_builder != nullptr);
+  // Nodes to cluster, and center of the sweep.
+  std::vector<bool> is_depot(nodes_, false);
+  std::pair<double, double> center(0, 0);
+  for (int vehicle = 0; vehicle < vehicles_; ++vehicle) {
+    const NodeIndex start = IndexToNode(Start(vehicle));
+    is_depot[start.value()] = true;
+    is_depot[IndexToNode(End(vehicle)).value()] = true;
+    center.first += static_cast<double>(points[start].first) / vehicles_;
+    center.second += static_cast<double>(points[start].second) / vehicles_;
+  }
+  std::vector<NodeIndex> customers;
+  for (NodeIndex node(0); node < nodes_; ++node) {
+    if (!is_depot[node.value()]) customers.push_back(node);
+  }
+  std::vector<std::vector<NodeIndex> > clusters;
+  const int num_clusters =
+      std::min(std::min(parameters.num_clusters, vehicles_),
+               static_cast<int>(customers.size()));
+  if (num_clusters > 0) {
+    SweepClusters(points, center, customers, num_clusters, &clusters);
+    if (parameters.clustering == RoutingDecompositionParameters::KMEANS) {
+      KMeansClusters(points, parameters.kmeans_iterations, &clusters);
+    }
+  }
+
+  // Vehicles: one per cluster, the others in proportion to the cluster sizes
+  // (largest remainder method).
+  const int num_extra_vehicles = vehicles_ - clusters.size();
+  std::vector<int> num_vehicles(clusters.size(), 1);
+  std::vector<std::pair<int64, int> > remainders;
+  int num_assigned_vehicles = clusters.size();
+  for (int cluster = 0; cluster < clusters.size(); ++cluster) {
+    const int64 share =
+        static_cast<int64>(num_extra_vehicles) * clusters[cluster].size();
+    num_vehicles[cluster] += share / customers.size();
+    num_assigned_vehicles += share / customers.size();
+    remainders.push_back(
+        std::make_pair(-(share % static_cast<int64>(customers.size())),
+                       cluster));
+  }
+  std::sort(remainders.begin(), remainders.end());
+  for (int i = 0; i < remainders.size() && num_assigned_vehicles < vehicles_;
+       ++i) {
+    ++num_vehicles[remainders[i].second];
+    ++num_assigned_vehicles;
+  }
+
+  // Models of the clusters; search parameters are passed through flags which
+  // are read when models are closed, so all models are closed before solving.
+  std::vector<std::unique_ptr<RoutingModel> > models;
+  std::vector<std::vector<NodeIndex> > model_nodes(clusters.size());
+  std::vector<std::vector<int> > model_vehicles(clusters.size());
+  int next_vehicle = 0;
+  for (int cluster = 0; cluster < clusters.size(); ++cluster) {
+    std::vector<NodeIndex>* const nodes = &model_nodes[cluster];
+    for (int i = 0; i < num_vehicles[cluster]; ++i) {
+      const int vehicle = next_vehicle++;
+      model_vehicles[cluster].push_back(vehicle);
+      for (const NodeIndex depot :
+           {IndexToNode(Start(vehicle)), IndexToNode(End(vehicle))}) {
+        if (std::find(nodes->begin(), nodes->end(), depot) == nodes->end()) {
+          nodes->push_back(depot);
+        }
+      }
+    }
+    nodes->insert(nodes->end(), clusters[cluster].begin(),
+                  clusters[cluster].end());
+    models.emplace_back(
+        submodel_builder->Run(*nodes, model_vehicles[cluster]));
+    RoutingModel* const model = models.back().get();
+    CHECK(!model->closed_) << "The model must not be closed";
+    CHECK_EQ(nodes->size(), model->nodes());
+    CHECK_EQ(model_vehicles[cluster].size(), model->vehicles());
+    model->SetSearchParameters(parameters.cluster_search);
+    model->CloseModel();
+  }
+  std::vector<const Assignment*> solutions(clusters.size(), nullptr);
+  {
+    ThreadPool pool("RoutingDecomposition",
+                    std::max(1, std::min(parameters.num_threads,
+                                         static_cast<int>(clusters.size()))));
+    for (int cluster = 0; cluster < clusters.size(); ++cluster) {
+      pool.Add(NewCallback(&SolveRoutingModelRound, models[cluster].get(),
+                           static_cast<const Assignment*>(nullptr),
+                           &solutions[cluster]));
+    }
+    pool.StartWorkers();
+  }
+
+  // Stitches the routes of the clusters.
+  std::vector<std::vector<NodeIndex> > routes(vehicles_);
+  bool stitched = true;
+  for (int cluster = 0; cluster < clusters.size(); ++cluster) {
+    if (solutions[cluster] == nullptr) {
+      VLOG(1) << "No solution for cluster " << cluster;
+      stitched = false;
+      break;
+    }
+    std::vector<std::vector<NodeIndex> > cluster_routes;
+    models[cluster]->AssignmentToRoutes(*solutions[cluster], &cluster_routes);
+    for (int vehicle = 0; vehicle < cluster_routes.size(); ++vehicle) {
+      std::vector<NodeIndex>* const route =
+          &routes[model_vehicles[cluster][vehicle]];
+      for (const NodeIndex node : cluster_routes[vehicle]) {
+        route->push_back(model_nodes[cluster][node.value()]);
+      }
+    }
+  }
+  SetSearchParameters(parameters.search);
+  CloseModel();
+  const Assignment* const first_solution =
+      stitched ? ReadAssignmentFromRoutes(routes, true) : nullptr;
+  return Solve(first_solution);
+}
+
+const Assignment* RoutingModel::PolishRoutes(const Assignment& assignment,
+                                             int num_threads) {
+  std::vector<std::vector<NodeIndex>> routes;
+  AssignmentToRoutes(assignment, &routes);
+  const std::vector<bool> modified(vehicles_, true);
+  return PolishModifiedRoutes(
+      modified, assignment.HasObjective() ? assignment.ObjectiveValue()
+                                          : kint64max,
+      num_threads, &routes);
+}
+
+const Assignment* RoutingModel::PolishModifiedRoutes(
+    const std::vector<bool>& modified, int64 cost, int num_threads,
+    std::vector<std::vector<NodeIndex>>* routes) {
+  // Routes have disjoint sets of nodes and arc costs are cached by arc tail,
+  // so routes can be polished concurrently.
+  std::vector<std::vector<NodeIndex>> polished_routes = *routes;
+  std::unique_ptr<bool[]> changed(new bool[vehicles_]);
+  std::vector<Closure*> closures;
+  for (int vehicle = 0; vehicle < vehicles_; ++vehicle) {
+    changed[vehicle] = false;
+    if (modified[vehicle] && polished_routes[vehicle].size() > 1) {
+      closures.push_back(NewCallback(this, &RoutingModel::PolishRoute, vehicle,
+                                     &polished_routes[vehicle],
+                                     &changed[vehicle]));
+    }
+  }
+  if (num_threads > 1 && closures.size() > 1) {
+    ThreadPool pool("RoutingPolishRoutes",
+                    std::min<int>(num_threads, closures.size()));
+    for (Closure* const closure : closures) {
+      pool.Add(closure);
+    }
+    pool.StartWorkers();
+  } else {
+    for (Closure* const closure : closures) {
+      closure->Run();
+    }
+  }
+  std::vector<int> changed_vehicles;
+  for (int vehicle = 0; vehicle < vehicles_; ++vehicle) {
+    if (changed[vehicle]) changed_vehicles.push_back(vehicle);
+  }
+  if (changed_vehicles.empty()) return nullptr;
+  // Polished routes are only checked against arc costs; the solver checks the
+  // other constraints and costs when restoring them. If all of them cannot be
+  // kept, they are tried one by one.
+  const Assignment* solution = ReadAssignmentFromRoutes(polished_routes, false);
+  if (solution != nullptr && solution->ObjectiveValue() < cost) {
+    routes->swap(polished_routes);
+    return solution;
+  }
+  if (changed_vehicles.size() == 1) return nullptr;
+  bool improved = false;
+  for (const int vehicle : changed_vehicles) {
+    std::vector<NodeIndex> route = polished_routes[vehicle];
+    (*routes)[vehicle].swap(route);
+    solution = ReadAssignmentFromRoutes(*routes, false);
+    if (solution != nullptr && solution->ObjectiveValue() < cost) {
+      cost = solution->ObjectiveValue();
+      improved = true;
+    } else {
+      (*routes)[vehicle].swap(route);
+    }
+  }
+  return improved ? ReadAssignmentFromRoutes(*routes, false) : nullptr;
+}
+
+void RoutingModel::PolishRoute(int vehicle, std::vector<NodeIndex>* route,
+                               bool* changed) {
+  std::vector<int64> path(1, Start(vehicle));
+  for (const NodeIndex node : *route) {
+    path.push_back(NodeToIndex(node));
+  }
+  path.push_back(End(vehicle));
+  const int size = path.size();
+  // Costs of the path prefixes, in the path direction and in the reverse
+  // direction.
+  std::vector<int64> forward_costs(size, 0);
+  std::vector<int64> backward_costs(size, 0);
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    for (int i = 1; i < size; ++i) {
+      forward_costs[i] = forward_costs[i - 1] +
+                         GetArcCostForVehicle(path[i - 1], path[i], vehicle);
+      backward_costs[i] = backward_costs[i - 1] +
+                          GetArcCostForVehicle(path[i], path[i - 1], vehicle);
+    }
+    // 2-opt: reverses the subpath from 'first' to 'last'.
+    for (int first = 1; first < size - 2 && !improved; ++first) {
+      for (int last = first + 1; last < size - 1; ++last) {
+        const int64 old_cost =
+            forward_costs[last + 1] - forward_costs[first - 1];
+        const int64 new_cost =
+            GetArcCostForVehicle(path[first - 1], path[last], vehicle) +
+            backward_costs[last] - backward_costs[first] +
+            GetArcCostForVehicle(path[first], path[last + 1], vehicle);
+        if (new_cost < old_cost) {
+          std::reverse(path.begin() + first, path.begin() + last + 1);
+          improved = true;
+          break;
+        }
+      }
+    }
+    // Or-opt: moves the subpath from 'first' to 'last' of up to 3 nodes after
+    // another node.
+    for (int length = 1; length <= 3 && !improved; ++length) {
+      for (int first = 1; first + length < size && !improved; ++first) {
+        const int last = first + length - 1;
+        const int64 removal_gain =
+            GetArcCostForVehicle(path[first - 1], path[first], vehicle) +
+            GetArcCostForVehicle(path[last], path[last + 1], vehicle) -
+            GetArcCostForVehicle(path[first - 1], path[last + 1], vehicle);
+        for (int position = 0; position < size - 1; ++position) {
+          if (position >= first - 1 && position <= last) continue;
+          const int64 insertion_cost =
+              GetArcCostForVehicle(path[position], path[first], vehicle) +
+              GetArcCostForVehicle(path[last], path[position + 1], vehicle) -
+              GetArcCostForVehicle(path[position], path[position + 1],
+                                   vehicle);
+          if (insertion_cost < removal_gain) {
+            const std::vector<int64> subpath(path.begin() + first,
+                                             path.begin() + last + 1);
+            path.erase(path.begin() + first, path.begin() + last + 1);
+            const int insert_before =
+                position < first ? position + 1 : position + 1 - length;
+            path.insert(path.begin() + insert_before, subpath.begin(),
+                        subpath.end());
+            improved = true;
+            break;
+          }
+        }
+      }
+    }
+    *changed |= improved;
+  }
+  if (*changed) {
+    for (int i = 1; i < size - 1; ++i) {
+      (*route)[i - 1] = IndexToNode(path[i]);
+    }
+  }
 }
 
 const Assignment* RoutingModel::Solve(const Assignment* assignment) {
@@ -2670,64 +3957,329 @@ const Assignment* RoutingModel::Solve(const Assignment* assignment) {
   }
 }
 
-// Computing a lower bound to the cost of a vehicle routing problem solving a
-// a linear assignment problem (minimum-cost perfect bipartite matching).
-// A bipartite graph is created with left nodes representing the nodes of the
-// routing problem and right nodes representing possible node successors; an
-// arc between a left node l and a right node r is created if r can be the
-// node folowing l in a route (Next(l) = r); the cost of the arc is the transit
-// cost between l and r in the routing problem.
-// This is a lower bound given the solution to assignment problem does not
-// necessarily produce a (set of) closed route(s) from a starting node to an
-// ending node.
-int64 RoutingModel::ComputeLowerBound() {
-  if (!closed_) {
-    LOG(WARNING) << "Non-closed model not supported.";
-    return 0;
+namespace {
+// Computes a Held-Karp lower bound of the cost of a closed routing model.
+// Vehicle starts and ends are merged into a single depot, and arcs are relaxed
+// to undirected edges costing the minimum of both directions over all vehicle
+// cost classes. A solution with k non-empty routes is then a forest of k paths
+// covering active nodes, each linked to the depot by two edges. Nodes which
+// may be inactive are linked to the depot by two "inactive" edges, which cost
+// the penalty of the disjunction if it contains only the node and 0 otherwise.
+// Removing one depot edge per route and one inactive edge per inactive node
+// leaves a spanning tree; removed depot edges cost at least the cheapest depot
+// edge. Node degrees, which are 2 in any solution, and the number of routes,
+// which is at most the number of vehicles, are relaxed with Lagrangian
+// multipliers optimized by subgradient ascent on a sparse graph of nearest
+// neighbor edges; the bound is then computed on the complete graph with the
+// best multipliers found.
+// Costs are scaled to allow fractional multipliers.
+const int64 kHeldKarpPrecision = 100;
+const int kHeldKarpNeighbors = 10;
+const int kHeldKarpMinAscentPeriod = 100;
+
+class HeldKarpBound {
+ public:
+  explicit HeldKarpBound(RoutingModel* model) : model_(model) {}
+  int64 Compute();
+
+ private:
+  struct Edge {
+    int tail;
+    int head;
+    int64 cost;
+  };
+
+  // Returns the scaled cost of the edge between two nodes.
+  int64 EdgeCost(int tail, int head) const;
+  // Returns the Lagrangian bound of the current multipliers, computing a
+  // minimum spanning tree either on sparse edges or on the complete graph.
+  // Updates node degrees and the number of routes of the relaxed solution.
+  int64 ComputeTreeBound(bool complete_graph);
+  int FindRoot(int node);
+
+  RoutingModel* const model_;
+  std::vector<int64> cost_classes_;
+  // Indices of the nodes which are neither vehicle starts nor ends.
+  std::vector<int64> indices_;
+  // Scaled cost of the cheapest edge between each node and the depot.
+  std::vector<int64> depot_costs_;
+  // Scaled cost of the two inactive edges of each node, -1 if the node must
+  // be active.
+  std::vector<int64> inactive_costs_;
+  std::vector<Edge> edges_;
+  std::vector<int64> multipliers_;
+  int64 route_multiplier_;
+  std::vector<int> degrees_;
+  int num_routes_;
+  std::vector<int> roots_;
+};
+
+int64 HeldKarpBound::Compute() {
+  std::vector<bool> class_covered(model_->GetCostClassesCount(), false);
+  for (int vehicle = 0; vehicle < model_->vehicles(); ++vehicle) {
+    const int64 cost_class =
+        model_->GetCostClassIndexOfVehicle(vehicle).value();
+    if (!class_covered[cost_class]) {
+      class_covered[cost_class] = true;
+      cost_classes_.push_back(cost_class);
+    }
   }
-  if (!CostsAreHomogeneousAcrossVehicles()) {
-    LOG(WARNING) << "Non-homogeneous vehicle costs not supported";
-    return 0;
+  std::vector<int> nodes_of_indices(model_->Size(), -1);
+  for (int64 index = 0; index < model_->Size(); ++index) {
+    if (model_->IsStart(index)) continue;
+    const int node = indices_.size();
+    nodes_of_indices[index] = node;
+    indices_.push_back(index);
+    int64 depot_cost = kint64max;
+    for (int vehicle = 0; vehicle < model_->vehicles(); ++vehicle) {
+      depot_cost = std::min(
+          depot_cost,
+          std::min(model_->GetArcCostForVehicle(model_->Start(vehicle), index,
+                                                vehicle),
+                   model_->GetArcCostForVehicle(index, model_->End(vehicle),
+                                                vehicle)));
+    }
+    depot_costs_.push_back(CapProd(depot_cost, kHeldKarpPrecision));
+    // Nodes are mandatory if they are constrained to be active or if they are
+    // alone in a disjunction without penalty. Otherwise, only nodes alone in a
+    // disjunction are sure to pay a penalty when inactive.
+    int64 inactive_cost = model_->ActiveVar(index)->Min() == 1 ? -1 : 0;
+    RoutingModel::DisjunctionIndex disjunction;
+    if (inactive_cost == 0 &&
+        model_->GetDisjunctionIndexFromVariableIndex(index, &disjunction) &&
+        model_->GetDisjunctionIndices(disjunction).size() == 1) {
+      const int64 penalty = model_->GetDisjunctionPenalty(disjunction);
+      inactive_cost =
+          penalty < 0 ? -1 : CapProd(penalty, kHeldKarpPrecision);
+    }
+    inactive_costs_.push_back(inactive_cost);
+  }
+  const int num_nodes = indices_.size();
+  if (num_nodes == 0) return 0;
+  for (int tail = 0; tail < num_nodes; ++tail) {
+    for (const int64 cost_class : cost_classes_) {
+      for (const int neighbor : model_->GetNearestNeighbors(
+               indices_[tail], cost_class,
+               kHeldKarpNeighbors + model_->vehicles())) {
+        const int head =
+            neighbor < model_->Size() ? nodes_of_indices[neighbor] : -1;
+        if (head != -1) {
+          edges_.push_back({tail, head, EdgeCost(tail, head)});
+        }
+      }
+    }
   }
-  if (disjunctions_.size() > 0) {
-    LOG(WARNING)
-        << "Node disjunction constraints or optional nodes not supported.";
-    return 0;
+  // Subgradient ascent, with the step size and period schedule of LKH.
+  multipliers_.assign(num_nodes, 0);
+  route_multiplier_ = 0;
+  int64 best_bound = ComputeTreeBound(false);
+  std::vector<int64> best_multipliers = multipliers_;
+  int64 best_route_multiplier = route_multiplier_;
+  std::vector<int> last_gradients(num_nodes, 0);
+  int last_route_gradient = 0;
+  const int initial_period = std::max(num_nodes / 2, kHeldKarpMinAscentPeriod);
+  bool initial_phase = true;
+  int64 step = kHeldKarpPrecision;
+  for (int period = initial_period; period > 0 && step > 0;
+       period /= 2, step /= 2) {
+    for (int iteration = 1; step > 0 && iteration <= period; ++iteration) {
+      bool optimal = num_routes_ <= model_->vehicles();
+      for (int node = 0; node < num_nodes; ++node) {
+        const int gradient = degrees_[node] - 2;
+        if (gradient != 0) {
+          optimal = false;
+          multipliers_[node] +=
+              step * (7 * gradient + 3 * last_gradients[node]) / 10;
+        }
+        last_gradients[node] = gradient;
+      }
+      if (optimal) break;
+      const int route_gradient = num_routes_ - model_->vehicles();
+      route_multiplier_ = std::max<int64>(
+          0, route_multiplier_ +
+                 step * (7 * route_gradient + 3 * last_route_gradient) / 10);
+      last_route_gradient = route_gradient;
+      const int64 bound = ComputeTreeBound(false);
+      if (bound > best_bound) {
+        best_bound = bound;
+        best_multipliers = multipliers_;
+        best_route_multiplier = route_multiplier_;
+        if (initial_phase) step *= 2;
+        if (iteration == period) {
+          period = std::min(2 * period, initial_period);
+        }
+      } else if (initial_phase && iteration > period / 2) {
+        initial_phase = false;
+        iteration = 0;
+        step = 3 * step / 4;
+      }
+    }
   }
-  const int num_nodes = Size() + vehicles_;
-  ForwardStarGraph graph(2 * num_nodes, num_nodes * num_nodes);
-  LinearSumAssignment<ForwardStarGraph> linear_sum_assignment(graph, num_nodes);
-  // Adding arcs for non-end nodes, based on possible values of next variables.
-  // Left nodes in the bipartite are indexed from 0 to num_nodes - 1; right
-  // nodes are indexed from num_nodes to 2 * num_nodes - 1.
-  for (int tail = 0; tail < Size(); ++tail) {
-    std::unique_ptr<IntVarIterator> iterator(
-        nexts_[tail]->MakeDomainIterator(false));
-    for (const int64 head : InitAndGetValues(iterator.get())) {
-      // Given there are no disjunction constraints, a node cannot point to
-      // itself. Doing this explicitely given that outside the search,
-      // propagation hasn't removed this value from next variables yet.
-      if (head == tail) {
-        continue;
+  multipliers_.swap(best_multipliers);
+  route_multiplier_ = best_route_multiplier;
+  const int64 bound = ComputeTreeBound(true);
+  // Costs being integral, the bound can be rounded up.
+  return bound <= 0 ? 0
+                    : CapAdd(bound, kHeldKarpPrecision - 1) /
+                          kHeldKarpPrecision;
+}
+
+int64 HeldKarpBound::EdgeCost(int tail, int head) const {
+  int64 cost = kint64max;
+  for (const int64 cost_class : cost_classes_) {
+    cost = std::min(
+        cost, std::min(model_->GetArcCostForClass(indices_[tail],
+                                                  indices_[head], cost_class),
+                       model_->GetArcCostForClass(indices_[head],
+                                                  indices_[tail], cost_class)));
+  }
+  return CapProd(cost, kHeldKarpPrecision);
+}
+
+int64 HeldKarpBound::ComputeTreeBound(bool complete_graph) {
+  const int num_nodes = indices_.size();
+  // Removed depot edges are bounded by the cheapest depot edge.
+  int cheapest_depot_node = 0;
+  int64 cheapest_depot_cost = kint64max;
+  for (int node = 0; node < num_nodes; ++node) {
+    const int64 cost = CapAdd(depot_costs_[node], multipliers_[node]);
+    if (cost < cheapest_depot_cost) {
+      cheapest_depot_cost = cost;
+      cheapest_depot_node = node;
+    }
+  }
+  // Cost of linking each node to the depot in the tree, including the cost of
+  // the corresponding removed edge.
+  std::vector<int64> depot_link_costs(num_nodes);
+  std::vector<bool> inactive_links(num_nodes);
+  for (int node = 0; node < num_nodes; ++node) {
+    depot_link_costs[node] =
+        CapAdd(CapAdd(depot_costs_[node], multipliers_[node]),
+               CapAdd(cheapest_depot_cost, route_multiplier_));
+    inactive_links[node] = false;
+    if (inactive_costs_[node] >= 0) {
+      const int64 inactive_cost =
+          CapAdd(inactive_costs_[node], 2 * multipliers_[node]);
+      if (inactive_cost < depot_link_costs[node]) {
+        depot_link_costs[node] = inactive_cost;
+        inactive_links[node] = true;
       }
-      // The index of a right node in the bipartite graph is the index
-      // of the successor offset by the number of nodes.
-      const ArcIndex arc = graph.AddArc(tail, num_nodes + head);
-      const CostValue cost = GetHomogeneousCost(tail, head);
-      linear_sum_assignment.SetArcCost(arc, cost);
     }
   }
-  // The linear assignment library requires having as many left and right nodes.
-  // Therefore we are creating fake assignments for end nodes, forced to point
-  // to the equivalent start node with a cost of 0.
-  for (int tail = Size(); tail < num_nodes; ++tail) {
-    const ArcIndex arc = graph.AddArc(tail, num_nodes + starts_[tail - Size()]);
-    linear_sum_assignment.SetArcCost(arc, 0);
+  degrees_.assign(num_nodes, 0);
+  num_routes_ = 0;
+  int64 tree_cost = 0;
+  // Node num_nodes is the depot.
+  const int depot = num_nodes;
+  auto add_edge = [this, depot, cheapest_depot_node, &inactive_links](
+      int tail, int head) {
+    if (head == depot) std::swap(tail, head);
+    if (tail == depot) {
+      degrees_[head] += 2;
+      if (!inactive_links[head]) {
+        --degrees_[head];
+        ++degrees_[cheapest_depot_node];
+        ++num_routes_;
+      }
+    } else {
+      ++degrees_[tail];
+      ++degrees_[head];
+    }
+  };
+  if (complete_graph) {
+    // Prim's algorithm on the complete graph.
+    std::vector<int64> link_costs = depot_link_costs;
+    std::vector<int> parents(num_nodes, depot);
+    std::vector<bool> in_tree(num_nodes, false);
+    for (int i = 0; i < num_nodes; ++i) {
+      int next = -1;
+      for (int node = 0; node < num_nodes; ++node) {
+        if (!in_tree[node] &&
+            (next == -1 || link_costs[node] < link_costs[next])) {
+          next = node;
+        }
+      }
+      in_tree[next] = true;
+      tree_cost = CapAdd(tree_cost, link_costs[next]);
+      add_edge(parents[next], next);
+      for (int node = 0; node < num_nodes; ++node) {
+        if (!in_tree[node]) {
+          const int64 cost =
+              CapAdd(EdgeCost(next, node),
+                     CapAdd(multipliers_[next], multipliers_[node]));
+          if (cost < link_costs[node]) {
+            link_costs[node] = cost;
+            parents[node] = next;
+          }
+        }
+      }
+    }
+  } else {
+    // Kruskal's algorithm on nearest neighbor and depot edges.
+    std::vector<std::pair<int64, int>> costed_edges;
+    costed_edges.reserve(edges_.size() + num_nodes);
+    for (int i = 0; i < edges_.size(); ++i) {
+      const Edge& edge = edges_[i];
+      costed_edges.push_back(std::make_pair(
+          CapAdd(edge.cost, CapAdd(multipliers_[edge.tail],
+                                   multipliers_[edge.head])),
+          i));
+    }
+    for (int node = 0; node < num_nodes; ++node) {
+      costed_edges.push_back(
+          std::make_pair(depot_link_costs[node], edges_.size() + node));
+    }
+    std::sort(costed_edges.begin(), costed_edges.end());
+    roots_.resize(num_nodes + 1);
+    for (int node = 0; node <= num_nodes; ++node) {
+      roots_[node] = node;
+    }
+    int num_tree_edges = 0;
+    for (const std::pair<int64, int>& costed_edge : costed_edges) {
+      const int edge_index = costed_edge.second;
+      int tail = depot;
+      int head = edge_index - static_cast<int>(edges_.size());
+      if (edge_index < edges_.size()) {
+        tail = edges_[edge_index].tail;
+        head = edges_[edge_index].head;
+      }
+      const int tail_root = FindRoot(tail);
+      const int head_root = FindRoot(head);
+      if (tail_root != head_root) {
+        roots_[tail_root] = head_root;
+        tree_cost = CapAdd(tree_cost, costed_edge.first);
+        add_edge(tail, head);
+        if (++num_tree_edges == num_nodes) break;
+      }
+    }
   }
-  if (linear_sum_assignment.ComputeAssignment()) {
-    return linear_sum_assignment.GetCost();
+  int64 bound = CapSub(tree_cost,
+                       CapProd(route_multiplier_, model_->vehicles()));
+  for (int node = 0; node < num_nodes; ++node) {
+    bound = CapSub(bound, 2 * multipliers_[node]);
   }
-  return 0;
+  return bound;
+}
+
+int HeldKarpBound::FindRoot(int node) {
+  while (roots_[node] != node) {
+    roots_[node] = roots_[roots_[node]];
+    node = roots_[node];
+  }
+  return node;
+}
+}  // namespace
+
+// Computing a lower bound to the cost of a vehicle routing problem as a
+// Held-Karp bound (cf. HeldKarpBound above). Memory is linear in the number
+// of nodes and a number of nearest neighbors per node.
+int64 RoutingModel::ComputeLowerBound() {
+  if (!closed_) {
+    LOG(WARNING) << "Non-closed model not supported.";
+    return 0;
+  }
+  HeldKarpBound bound(this);
+  return bound.Compute();
 }
 
 bool RoutingModel::RouteCanBeUsedByVehicle(const Assignment& assignment,
@@ -2931,6 +4483,117 @@ bool RoutingModel::ApplyLocksToAllVehicles(
   return RoutesToAssignment(locks, true, close_routes, preassignment_);
 }
 
+namespace {
+// Enforces the node availabilities and the frozen route prefixes of the
+// dynamic re-optimization. The data is read when the constraint is posted,
+// i.e. at the start of each search, so it can change between searches.
+class DynamicReoptimizationConstraint : public Constraint {
+ public:
+  DynamicReoptimizationConstraint(RoutingModel* const model,
+                                  const std::vector<bool>* unavailable_indices,
+                                  const std::vector<int64>* frozen_nexts)
+      : Constraint(model->solver()),
+        model_(model),
+        unavailable_indices_(unavailable_indices),
+        frozen_nexts_(frozen_nexts) {}
+  virtual ~DynamicReoptimizationConstraint() {}
+  virtual void Post() {}
+  virtual void InitialPropagate() {
+    for (int index = 0; index < model_->Size(); ++index) {
+      if ((*unavailable_indices_)[index]) {
+        model_->ActiveVar(index)->SetValue(0);
+      }
+      if ((*frozen_nexts_)[index] >= 0) {
+        model_->NextVar(index)->SetValue((*frozen_nexts_)[index]);
+      }
+    }
+  }
+  virtual std::string DebugString() const {
+    return "DynamicReoptimizationConstraint";
+  }
+
+ private:
+  RoutingModel* const model_;
+  const std::vector<bool>* const unavailable_indices_;
+  const std::vector<int64>* const frozen_nexts_;
+};
+}  // namespace
+
+void RoutingModel::InitializeDynamicReoptimization() {
+  if (!frozen_nexts_.empty()) return;
+  CHECK_EQ(Solver::OUTSIDE_SEARCH, solver_->state());
+  unavailable_indices_.assign(Size(), false);
+  frozen_nexts_.assign(Size(), -1);
+  frozen_route_prefixes_.resize(vehicles_);
+  solver_->AddConstraint(solver_->RevAlloc(new DynamicReoptimizationConstraint(
+      this, &unavailable_indices_, &frozen_nexts_)));
+}
+
+void RoutingModel::SetNodeAvailable(NodeIndex node, bool available) {
+  InitializeDynamicReoptimization();
+  const int64 index = NodeToIndex(node);
+  DisjunctionIndex disjunction = kNoDisjunction;
+  CHECK(GetDisjunctionIndexFromVariableIndex(index, &disjunction))
+      << "Node " << node << " is not optional";
+  unavailable_indices_[index] = !available;
+}
+
+void RoutingModel::SetFrozenRoutePrefix(int vehicle,
+                                        const std::vector<NodeIndex>& prefix) {
+  InitializeDynamicReoptimization();
+  CHECK_GE(vehicle, 0);
+  CHECK_LT(vehicle, vehicles_);
+  frozen_nexts_[Start(vehicle)] = -1;
+  for (const NodeIndex node : frozen_route_prefixes_[vehicle]) {
+    frozen_nexts_[NodeToIndex(node)] = -1;
+  }
+  int64 previous = Start(vehicle);
+  for (const NodeIndex node : prefix) {
+    const int64 index = NodeToIndex(node);
+    CHECK(index >= 0 && !IsStart(index)) << "Invalid prefix node " << node;
+    frozen_nexts_[previous] = index;
+    previous = index;
+  }
+  frozen_route_prefixes_[vehicle] = prefix;
+}
+
+const Assignment* RoutingModel::Reoptimize(const Assignment* previous) {
+  QuietCloseModel();
+  if (previous == nullptr) return Solve(nullptr);
+  std::vector<std::vector<NodeIndex> > routes;
+  AssignmentToRoutes(*previous, &routes);
+  if (!frozen_nexts_.empty()) {
+    std::vector<bool> is_frozen(Size(), false);
+    for (const std::vector<NodeIndex>& prefix : frozen_route_prefixes_) {
+      for (const NodeIndex node : prefix) {
+        is_frozen[NodeToIndex(node)] = true;
+      }
+    }
+    for (int vehicle = 0; vehicle < vehicles_; ++vehicle) {
+      std::vector<NodeIndex> route = frozen_route_prefixes_[vehicle];
+      for (const NodeIndex node : routes[vehicle]) {
+        const int64 index = NodeToIndex(node);
+        if (!is_frozen[index] && !unavailable_indices_[index]) {
+          route.push_back(node);
+        }
+      }
+      routes[vehicle].swap(route);
+    }
+  }
+  if (reoptimization_start_ == nullptr) {
+    reoptimization_start_ = solver_->MakeAssignment();
+  }
+  reoptimization_start_->Clear();
+  if (RoutesToAssignment(routes, true, true, reoptimization_start_)) {
+    const Assignment* const solution = Solve(reoptimization_start_);
+    if (solution != nullptr || status_ == ROUTING_FAIL_TIMEOUT) {
+      return solution;
+    }
+  }
+  VLOG(1) << "Cannot repair the previous solution, solving from scratch";
+  return Solve(nullptr);
+}
+
 void RoutingModel::UpdateTimeLimit(int64 limit_ms) {
   time_limit_ms_ = limit_ms;
   if (limit_ != nullptr) {
@@ -3342,6 +5005,112 @@ int64 RoutingModel::GetArcCostForClass(
   }
 }
 
+const std::vector<int>& RoutingModel::GetNearestNeighbors(
+    int64 from_index, int64 /*CostClassIndex*/ cost_class_index,
+    int num_neighbors) {
+  DCHECK(closed_);
+  DCHECK_GE(from_index, 0);
+  DCHECK_LT(from_index, Size());
+  const CostClassIndex cost_class(cost_class_index);
+  if (nearest_neighbors_[cost_class].num_neighbors < num_neighbors) {
+    ComputeNearestNeighbors(cost_class, num_neighbors);
+  }
+  return nearest_neighbors_[cost_class].neighbors[from_index];
+}
+
+const std::vector<int>* RoutingModel::GetNearestNeighborsOfVehicle(
+    int64 from_index, int64 vehicle, int num_neighbors) {
+  const CostClassIndex cost_class =
+      GetCostClassIndexOfVehicle(std::max<int64>(vehicle, 0));
+  return &GetNearestNeighbors(from_index, cost_class.value(), num_neighbors);
+}
+
+void RoutingModel::RestrictSuccessorsToNearestNeighbors(int num_successors) {
+  std::vector<CostClassIndex> cost_classes;
+  for (int vehicle = 0; vehicle < vehicles_; ++vehicle) {
+    const CostClassIndex cost_class = GetCostClassIndexOfVehicle(vehicle);
+    if (cost_class != kCostClassIndexOfZeroCost) {
+      cost_classes.push_back(cost_class);
+    }
+  }
+  // Without arc costs there is no meaningful notion of neighborhood.
+  if (cost_classes.empty()) return;
+  STLSortAndRemoveDuplicates(&cost_classes);
+  std::vector<std::vector<int64> > partners(Size());
+  for (const NodePair& pair : pickup_delivery_pairs_) {
+    partners[pair.first].push_back(pair.second);
+    partners[pair.second].push_back(pair.first);
+  }
+  std::vector<int64> successors;
+  for (int64 index = 0; index < Size(); ++index) {
+    if (IsStart(index)) continue;
+    // Vehicle ends and the node itself (for inactive nodes) are always kept to
+    // make sure the restricted model remains feasible.
+    successors.assign(ends_.begin(), ends_.end());
+    successors.push_back(index);
+    successors.insert(successors.end(), partners[index].begin(),
+                      partners[index].end());
+    for (const CostClassIndex cost_class : cost_classes) {
+      const std::vector<int>& neighbors =
+          GetNearestNeighbors(index, cost_class.value(), num_successors);
+      const int num_neighbors =
+          std::min<int>(num_successors, neighbors.size());
+      successors.insert(successors.end(), neighbors.begin(),
+                        neighbors.begin() + num_neighbors);
+    }
+    nexts_[index]->SetValues(successors);
+  }
+}
+
+void RoutingModel::ComputeNearestNeighbors(CostClassIndex cost_class_index,
+                                           int num_neighbors) {
+  NearestNeighborLists* const lists = &nearest_neighbors_[cost_class_index];
+  lists->num_neighbors = num_neighbors;
+  lists->neighbors.assign(Size(), std::vector<int>());
+  const int64 size = Size();
+  const int64 max_threads =
+      std::min<int64>(FLAGS_routing_nearest_neighbors_threads, size);
+  const int num_threads = std::max<int64>(1, max_threads);
+  if (num_threads == 1) {
+    ComputeNearestNeighborsOfIndices(cost_class_index, num_neighbors, 0, size);
+    return;
+  }
+  // Rows are independent and the arc cost cache is indexed by source index,
+  // so threads working on disjoint ranges of rows do not share any state;
+  // callback caches are read-only once the model is closed.
+  const int64 rows_per_thread = (size + num_threads - 1) / num_threads;
+  ThreadPool pool("RoutingNearestNeighbors", num_threads);
+  for (int64 begin = 0; begin < size; begin += rows_per_thread) {
+    pool.Add(NewCallback(this, &RoutingModel::ComputeNearestNeighborsOfIndices,
+                         cost_class_index, num_neighbors, begin,
+                         std::min(begin + rows_per_thread, size)));
+  }
+  pool.StartWorkers();
+}
+
+void RoutingModel::ComputeNearestNeighborsOfIndices(
+    CostClassIndex cost_class_index, int num_neighbors, int64 begin,
+    int64 end) {
+  std::vector<std::pair<int64, int> > costs;
+  for (int64 from = begin; from < end; ++from) {
+    costs.clear();
+    for (int to = 0; to < Size() + vehicles_; ++to) {
+      if (to != from && !IsStart(to)) {
+        costs.push_back(std::make_pair(
+            GetArcCostForClassInternal(from, to, cost_class_index), to));
+      }
+    }
+    const int count = std::min<int>(num_neighbors, costs.size());
+    std::partial_sort(costs.begin(), costs.begin() + count, costs.end());
+    std::vector<int>& neighbors =
+        nearest_neighbors_[cost_class_index].neighbors[from];
+    neighbors.reserve(count);
+    for (int i = 0; i < count; ++i) {
+      neighbors.push_back(costs[i].second);
+    }
+  }
+}
+
 int64 RoutingModel::GetArcCostForFirstSolution(int64 i, int64 j) {
   // Return high cost if connecting to an end (or bound-to-end) node;
   // this is used in the cost-based first solution strategies to avoid closing
@@ -3651,6 +5420,10 @@ void RoutingModel::CreateNeighborhoodOperators() {
       solver_.get(), nexts_,
       CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
       vehicle_start_class_callback_.get(), pickup_delivery_pairs_);
+  local_search_operators_[ROUTING_PAIR_EXCHANGE] = MakePairExchange(
+      solver_.get(), nexts_,
+      CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
+      vehicle_start_class_callback_.get(), pickup_delivery_pairs_);
   local_search_operators_[ROUTING_RELOCATE_NEIGHBORS] = MakeRelocateNeighbors(
       solver_.get(), nexts_,
       CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
@@ -3660,7 +5433,13 @@ void RoutingModel::CreateNeighborhoodOperators() {
   CP_ROUTING_ADD_OPERATOR2(ROUTING_CROSS, Cross);
   CP_ROUTING_ADD_OPERATOR2(ROUTING_TWO_OPT, TwoOpt);
   CP_ROUTING_ADD_OPERATOR(ROUTING_OR_OPT, Solver::OROPT);
-  CP_ROUTING_ADD_CALLBACK_OPERATOR(ROUTING_LKH, Solver::LK);
+  // Lin-Kernighan reads its candidate nodes from the shared nearest neighbor
+  // lists rather than computing its own.
+  local_search_operators_[ROUTING_LKH] = MakeLinKernighanOperator(
+      solver_.get(), nexts_,
+      CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
+      NewPermanentCallback(this, &RoutingModel::GetArcCostForVehicle),
+      NewPermanentCallback(this, &RoutingModel::GetNearestNeighborsOfVehicle));
   local_search_operators_[ROUTING_MAKE_ACTIVE] = CreateInsertionOperator();
   CP_ROUTING_ADD_OPERATOR2(ROUTING_MAKE_INACTIVE, MakeInactiveOperator);
   CP_ROUTING_ADD_OPERATOR2(ROUTING_MAKE_CHAIN_INACTIVE,
@@ -3673,6 +5452,13 @@ void RoutingModel::CreateNeighborhoodOperators() {
   CP_ROUTING_ADD_OPERATOR(ROUTING_PATH_LNS, Solver::PATHLNS);
   CP_ROUTING_ADD_OPERATOR(ROUTING_FULL_PATH_LNS, Solver::FULLPATHLNS);
   CP_ROUTING_ADD_OPERATOR(ROUTING_INACTIVE_LNS, Solver::UNACTIVELNS);
+  local_search_operators_[ROUTING_RUIN_RECREATE] = MakeRuinAndRecreate(
+      solver_.get(), *this, nexts_,
+      CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
+      vehicle_start_class_callback_.get(),
+      NewPermanentCallback(this, &RoutingModel::GetArcCostForVehicle),
+      NewPermanentCallback(this, &RoutingModel::GetNearestNeighborsOfVehicle),
+      CreateFeasibilityFilters(), FLAGS_routing_ruin_recreate_size);
 }
 
 #undef CP_ROUTING_ADD_CALLBACK_OPERATOR
@@ -3682,6 +5468,7 @@ LocalSearchOperator* RoutingModel::GetNeighborhoodOperators() const {
   std::vector<LocalSearchOperator*> operators = extra_operators_;
   if (pickup_delivery_pairs_.size() > 0) {
     operators.push_back(local_search_operators_[ROUTING_PAIR_RELOCATE]);
+    operators.push_back(local_search_operators_[ROUTING_PAIR_EXCHANGE]);
   }
   if (vehicles_ > 1) {
     if (!FLAGS_routing_no_relocate) {
@@ -3736,6 +5523,11 @@ LocalSearchOperator* RoutingModel::GetNeighborhoodOperators() const {
       !FLAGS_routing_simulated_annealing) {
     operators.push_back(local_search_operators_[ROUTING_TSP_LNS]);
   }
+  // Removed nodes are reinserted one by one, which would break pickup and
+  // delivery pairs.
+  if (!FLAGS_routing_no_ruin_recreate && pickup_delivery_pairs_.empty()) {
+    operators.push_back(local_search_operators_[ROUTING_RUIN_RECREATE]);
+  }
   if (!FLAGS_routing_no_fullpathlns) {
     operators.push_back(local_search_operators_[ROUTING_FULL_PATH_LNS]);
   }
@@ -3843,30 +5635,33 @@ RoutingModel::GetOrCreateLocalSearchFilters() {
 const std::vector<LocalSearchFilter*>&
 RoutingModel::GetOrCreateFeasibilityFilters() {
   if (feasibility_filters_.empty()) {
-    if (FLAGS_routing_use_path_cumul_filter) {
-      for (const RoutingDimension* const dimension : dimensions_) {
-        feasibility_filters_.push_back(
-            MakePathCumulFilter(*this, *dimension, nullptr));
-      }
-    }
-    if (FLAGS_routing_use_disjunction_filter && !disjunctions_.empty()) {
-      feasibility_filters_.push_back(MakeNodeDisjunctionFilter(*this, nullptr));
-    }
-    feasibility_filters_.push_back(solver_->MakeVariableDomainFilter());
-    if (FLAGS_routing_use_pickup_and_delivery_filter &&
-        pickup_delivery_pairs_.size() > 0) {
-      feasibility_filters_.push_back(
-          MakeNodePrecedenceFilter(*this, pickup_delivery_pairs_));
-    }
-    if (FLAGS_routing_use_vehicle_var_filter) {
-      feasibility_filters_.push_back(MakeVehicleVarFilter(*this));
-    }
-    feasibility_filters_.insert(feasibility_filters_.end(),
-                                extra_filters_.begin(), extra_filters_.end());
+    feasibility_filters_ = CreateFeasibilityFilters();
   }
   return feasibility_filters_;
 }
 
+std::vector<LocalSearchFilter*> RoutingModel::CreateFeasibilityFilters() {
+  std::vector<LocalSearchFilter*> filters;
+  if (FLAGS_routing_use_path_cumul_filter) {
+    for (const RoutingDimension* const dimension : dimensions_) {
+      filters.push_back(MakePathCumulFilter(*this, *dimension, nullptr));
+    }
+  }
+  if (FLAGS_routing_use_disjunction_filter && !disjunctions_.empty()) {
+    filters.push_back(MakeNodeDisjunctionFilter(*this, nullptr));
+  }
+  filters.push_back(solver_->MakeVariableDomainFilter());
+  if (FLAGS_routing_use_pickup_and_delivery_filter &&
+      pickup_delivery_pairs_.size() > 0) {
+    filters.push_back(MakeNodePrecedenceFilter(*this, pickup_delivery_pairs_));
+  }
+  if (FLAGS_routing_use_vehicle_var_filter) {
+    filters.push_back(MakeVehicleVarFilter(*this));
+  }
+  filters.insert(filters.end(), extra_filters_.begin(), extra_filters_.end());
+  return filters;
+}
+
 DecisionBuilder* RoutingModel::CreateSolutionFinalizer() {
   std::vector<DecisionBuilder*> decision_builders;
   decision_builders.push_back(solver_->MakePhase(
@@ -4010,6 +5805,7 @@ void RoutingModel::CreateFirstSolutionDecisionBuilders() {
     first_solution_filtered_decision_builders_[ROUTING_SAVINGS] =
         solver_->RevAlloc(new SavingsFilteredDecisionBuilder(
             this, FLAGS_savings_filter_neighbors,
+            std::max<int64>(1, FLAGS_savings_threads),
             GetOrCreateFeasibilityFilters()));
     first_solution_decision_builders_[ROUTING_SAVINGS] = solver_->Try(
         first_solution_filtered_decision_builders_[ROUTING_SAVINGS],
@@ -4201,7 +5997,7 @@ RoutingModel::NodeEvaluator2* RoutingModel::NewCachedCallback(
     NodeEvaluator2* callback) {
   const int size = node_to_index_.size();
   if (FLAGS_routing_cache_callbacks && size <= FLAGS_routing_max_cache_size) {
-    NodeEvaluator2* cached_evaluator = nullptr;
+    RoutingCache* cached_evaluator = nullptr;
     if (!FindCopy(cached_node_callbacks_, callback, &cached_evaluator)) {
       cached_evaluator = new RoutingCache(callback, size);
       cached_node_callbacks_[callback] = cached_evaluator;
@@ -179,6 +179,8 @@ namespace operations_research {
 
 class IntVarFilteredDecisionBuilder;
 class LocalSearchOperator;
+class PiecewiseLinearFunction;
+class RoutingCache;
 class RoutingDimension;
 #ifndef SWIG
 class SweepArranger;
@@ -227,6 +229,8 @@ struct RoutingSearchParameters {
     no_tsplns = true;
     use_chain_make_inactive = false;
     use_extended_swap_active = false;
+    no_ruin_recreate = true;
+    ruin_recreate_size = 10;
     solution_limit = kint64max;
     time_limit = kint64max;
     lns_time_limit = 100;
@@ -271,6 +275,10 @@ struct RoutingSearchParameters {
   bool use_chain_make_inactive;
   // Routing: use extended version of SwapActive neighborhood.
   bool use_extended_swap_active;
+  // Routing: forbids use of RuinAndRecreate neighborhood.
+  bool no_ruin_recreate;
+  // Routing: number of nodes removed by the RuinAndRecreate neighborhood.
+  int ruin_recreate_size;
 
   // ----- Search limits -----
 
@@ -307,6 +315,63 @@ struct RoutingSearchParameters {
   bool trace;
 };
 
+#ifndef SWIG
+// This class stores the parameters of RoutingModel::SolveInParallel().
+struct RoutingParallelSearchParameters {
+  RoutingParallelSearchParameters() {
+    time_limit = kint64max;
+    exchange_period = 1000;
+    polish_routes = false;
+  }
+
+  // Search parameters of each worker, the first one being used by the model
+  // on which SolveInParallel() is called. Workers typically differ by their
+  // first solution heuristic and metaheuristic. The time limits of these
+  // parameters are ignored.
+  std::vector<RoutingSearchParameters> workers;
+  // Time limit in ms of the whole search.
+  int64 time_limit;
+  // Time in ms between two exchanges of the best solution between workers.
+  int64 exchange_period;
+  // If true, the routes of the best solution which changed during a round are
+  // re-optimized with RoutingModel::PolishRoutes() before being exchanged,
+  // using one thread per worker.
+  bool polish_routes;
+};
+
+// This class stores the parameters of RoutingModel::SolveWithDecomposition().
+struct RoutingDecompositionParameters {
+  enum ClusteringMethod {
+    // Angular sectors around the vehicle starts, holding the same number of
+    // nodes each.
+    SWEEP_SECTORS,
+    // K-means on the node coordinates, starting from the sweep sectors.
+    KMEANS
+  };
+
+  RoutingDecompositionParameters() {
+    clustering = SWEEP_SECTORS;
+    num_clusters = 8;
+    kmeans_iterations = 20;
+    num_threads = 1;
+  }
+
+  ClusteringMethod clustering;
+  // Number of clusters, capped to the number of vehicles and of nodes.
+  int num_clusters;
+  // Maximum number of iterations of the k-means clustering.
+  int kmeans_iterations;
+  // Number of threads solving the clusters.
+  int num_threads;
+  // Search parameters of the models of the clusters, including their time
+  // limit.
+  RoutingSearchParameters cluster_search;
+  // Search parameters of the final search on the whole model, starting from
+  // the solutions of the clusters.
+  RoutingSearchParameters search;
+};
+#endif  // SWIG
+
 class RoutingModel {
  public:
   // First solution strategies, used as starting point of local search.
@@ -403,6 +468,8 @@ class RoutingModel {
   typedef _RoutingModel_VehicleClassIndex VehicleClassIndex;
   typedef ResultCallback1<int64, int64> VehicleEvaluator;
   typedef ResultCallback2<int64, NodeIndex, NodeIndex> NodeEvaluator2;
+  typedef ResultCallback2<const PiecewiseLinearFunction*, NodeIndex, NodeIndex>
+      TravelTimeProfileEvaluator;
   typedef std::pair<int, int> NodePair;
   typedef std::vector<NodePair> NodePairs;
 
@@ -574,6 +641,31 @@ class RoutingModel {
   // (and doesn't create the new dimension).
   bool AddMatrixDimension(const int64* const* values, int64 capacity,
                           bool fix_start_cumul_to_zero, const std::string& name);
+  // Returns a permanent evaluator such that evaluator(i, j) is
+  // 'values[i * size + j]', where 'values' is a row-major 'size' x 'size'
+  // matrix which is copied. The caller takes ownership of the evaluator, which
+  // is usually passed to SetArcCostEvaluatorOfAllVehicles() or AddDimension().
+  // This is mostly meant for the wrappers in other languages, for which it
+  // avoids a call to the interpreter for each evaluation.
+  static NodeEvaluator2* NewMatrixEvaluator(const int64* values, int size);
+  // Creates a time dependent dimension, where the transit of the arc from
+  // node i to node j depends on the time of departure from i, i.e. on the
+  // cumul of i: profiles(i, j)->Value(cumul(i)) is the travel time of the arc.
+  // The profiles are not owned and must be defined on [0, capacity]; they
+  // must be FIFO (leaving later never means arriving earlier), i.e. t + travel
+  // time must be non-decreasing. 'slack_max' bounds the waiting time at each
+  // node. Takes ownership of 'profiles', which must be a repeatable callback.
+  // The dimension is modeled as a static dimension on the minimum travel times
+  // of the arcs, whose slacks hold the waiting times plus the time dependent
+  // part of the travel times; the latter is enforced by a constraint. Local
+  // search filters only see the minimum travel times, the exact travel times
+  // are checked by the solver.
+  // Returns false if a dimension with the same name has already been created
+  // (and doesn't create the new dimension).
+  bool AddTimeDependentDimension(TravelTimeProfileEvaluator* profiles,
+                                 int64 slack_max, int64 capacity,
+                                 bool fix_start_cumul_to_zero,
+                                 const std::string& name);
   // Outputs the names of all dimensions added to the routing engine.
   // TODO(user): rename.
   void GetAllDimensions(std::vector<std::string>* dimension_names) const;
@@ -767,12 +859,59 @@ class RoutingModel {
   const Assignment* SolveWithParameters(
       const RoutingSearchParameters& parameters,
       const Assignment* assignment);
-  // Computes a lower bound to the routing problem solving a linear assignment
-  // problem. The routing model must be closed before calling this method.
-  // Note that problems with node disjunction constraints (including optional
-  // nodes) and non-homogenous costs are not supported (the method returns 0 in
-  // these cases).
-  // TODO(user): Add support for non-homogeneous costs and disjunctions.
+#ifndef SWIG
+  // Solves the current routing model with several workers running
+  // concurrently, each with its own copy of the model and its own search
+  // parameters. The search proceeds by rounds of parameters.exchange_period
+  // ms; at the end of each round, the best solution found by the workers is
+  // shared, and the workers which lag behind restart from it. The search
+  // stops at the time limit, or when a round ends early (all workers reached a
+  // local optimum) without improving the best solution.
+  // This model is used by the first worker and must not be closed; the models
+  // of the other workers are built by 'model_builder' (not owned), which must
+  // return a new, non-closed, model identical to this one each time it is
+  // called. The builder is called from the calling thread but callbacks of
+  // the models are then called concurrently, and must be thread-safe.
+  // Returns the best solution found, as a solution of this model.
+  const Assignment* SolveInParallel(
+      const RoutingParallelSearchParameters& parameters,
+      ResultCallback<RoutingModel*>* model_builder);
+  // Solves very large instances by decomposition. The nodes which are not
+  // vehicle starts or ends are split into clusters using their coordinates
+  // 'points' (indexed by node), and the vehicles are distributed among the
+  // clusters in proportion to their sizes. The model of each cluster is built
+  // by 'submodel_builder' (not owned), and the models are solved concurrently
+  // by parameters.num_threads threads. Their routes are then stitched into a
+  // first solution of this model, which is improved by a search with
+  // parameters.search: its local search repairs the routes along the cluster
+  // boundaries. If a cluster has no solution, the whole model is solved from
+  // scratch instead.
+  // submodel_builder->Run(nodes, vehicles) must return a new, non-closed model
+  // with nodes.size() nodes and vehicles.size() vehicles, in which node i
+  // stands for node nodes[i] of this model and vehicle v for vehicle
+  // vehicles[v], starting and ending at the nodes standing for its start and
+  // end in this model (which are listed first in 'nodes'). Callbacks of the
+  // models of the clusters are called concurrently and must be thread-safe.
+  // Vehicles are assumed interchangeable and are assigned to clusters in
+  // order. This model must not be closed; it is closed by this method.
+  const Assignment* SolveWithDecomposition(
+      const RoutingDecompositionParameters& parameters,
+      const ITIVector<NodeIndex, std::pair<int64, int64> >& points,
+      ResultCallback2<RoutingModel*, const std::vector<NodeIndex>&,
+                      const std::vector<int>&>* submodel_builder);
+#endif  // SWIG
+  // Re-optimizes the order of the nodes of each route of 'assignment' with
+  // 2-opt and Or-opt moves evaluated on arc costs, outside of the solver.
+  // Routes are processed concurrently by 'num_threads' threads, in which case
+  // arc cost callbacks must be thread-safe. Reordered routes making the
+  // solution infeasible are discarded. Returns the polished solution if it is
+  // cheaper than 'assignment', nullptr otherwise. The model must be closed.
+  const Assignment* PolishRoutes(const Assignment& assignment, int num_threads);
+  // Computes a lower bound to the arc and disjunction penalty costs of the
+  // routing problem using a Held-Karp (1-tree) relaxation where vehicle starts
+  // and ends are merged into a single depot and arc costs are relaxed to the
+  // minimum of both directions over all vehicles. The routing model must be
+  // closed before calling this method (the method returns 0 otherwise).
   int64 ComputeLowerBound();
   // Returns the current status of the routing model.
   Status status() const { return status_; }
@@ -799,6 +938,26 @@ class RoutingModel {
   // can be used in the context of locking the parts of the routes which have
   // already been driven in online routing problems.
   const Assignment* const PreAssignment() const { return preassignment_; }
+  // Dynamic re-optimization: the following methods let a model be
+  // re-optimized as orders arrive and vehicles drive, without rebuilding and
+  // re-closing it (cost caches and neighbor lists are kept). Orders must be
+  // declared upfront as optional nodes, i.e. nodes in a disjunction; they can
+  // then be made available or not between two searches, unavailable nodes
+  // being forced to be inactive. All nodes are initially available.
+  void SetNodeAvailable(NodeIndex node, bool available);
+  // Forces the route of 'vehicle' to start with the nodes of 'prefix' (start
+  // node excluded), in this order, typically the part of the route which has
+  // been driven. This replaces the previous prefix of the vehicle and holds
+  // for the next searches. Unlike ApplyLocksToAllVehicles(), the prefix is
+  // also enforced during the local search.
+  void SetFrozenRoutePrefix(int vehicle, const std::vector<NodeIndex>& prefix);
+  // Re-optimizes the model from 'previous', a solution of an earlier search:
+  // its routes are made to start with the frozen prefixes and unavailable
+  // nodes are removed from them, then the search improves this solution.
+  // Falls back to a search from scratch if 'previous' is nullptr or cannot be
+  // repaired into a solution. Use UpdateTimeLimit() to bound the response
+  // time. Closes the model.
+  const Assignment* Reoptimize(const Assignment* previous);
   // Writes the current solution to a file containing an AssignmentProto.
   // Returns false if the file cannot be opened or if there is no current
   // solution.
@@ -948,6 +1107,18 @@ class RoutingModel {
   }
   // Returns the number of different cost classes in the model.
   int GetCostClassesCount() const { return cost_classes_.size(); }
+  // Returns the indices with the smallest arc costs from 'from_index' for the
+  // given cost class, sorted by increasing cost (ties are broken by index);
+  // vehicle starts and 'from_index' itself are never part of the list.
+  // The list contains at least the 'num_neighbors' nearest indices (all of
+  // them if there are fewer) but can be longer: the lists of a cost class are
+  // built for all indices on the first call, with the largest number of
+  // neighbors requested so far, and are shared by all the local search
+  // operators and first solution heuristics working on nearest neighbors.
+  // Rows are computed by FLAGS_routing_nearest_neighbors_threads threads.
+  const std::vector<int>& GetNearestNeighbors(
+      int64 from_index, int64 /*CostClassIndex*/ cost_class_index,
+      int num_neighbors);
   // Ditto, minus the 'always zero', built-in cost class.
   int GetNonZeroCostClassesCount() const {
     return std::max(0, GetCostClassesCount() - 1);
@@ -1083,6 +1254,7 @@ class RoutingModel {
   enum RoutingLocalSearchOperator {
     ROUTING_RELOCATE = 0,
     ROUTING_PAIR_RELOCATE,
+    ROUTING_PAIR_EXCHANGE,
     ROUTING_RELOCATE_NEIGHBORS,
     ROUTING_EXCHANGE,
     ROUTING_CROSS,
@@ -1094,6 +1266,7 @@ class RoutingModel {
     ROUTING_PATH_LNS,
     ROUTING_FULL_PATH_LNS,
     ROUTING_INACTIVE_LNS,
+    ROUTING_RUIN_RECREATE,
     ROUTING_MAKE_ACTIVE,
     ROUTING_MAKE_INACTIVE,
     ROUTING_MAKE_CHAIN_INACTIVE,
@@ -1121,6 +1294,14 @@ class RoutingModel {
     int64 cost;
   };
 
+  // Nearest neighbor lists of all indices for a cost class, built with
+  // 'num_neighbors' neighbors per index (see GetNearestNeighbors()).
+  struct NearestNeighborLists {
+    NearestNeighborLists() : num_neighbors(0) {}
+    int num_neighbors;
+    std::vector<std::vector<int> > neighbors;
+  };
+
   // Internal methods.
   void Initialize();
   void SetStartEnd(const std::vector<std::pair<NodeIndex, NodeIndex> >& start_end);
@@ -1134,6 +1315,21 @@ class RoutingModel {
   uint64 GetFingerprintOfEvaluator(NodeEvaluator2* evaluator) const;
   void ComputeCostClasses();
   void ComputeVehicleClasses();
+  // Restricts the domains of next variables of nodes other than vehicle starts
+  // to the 'num_successors' nearest neighbors of the nodes, vehicle ends, the
+  // nodes themselves and their pickup and delivery partners.
+  void RestrictSuccessorsToNearestNeighbors(int num_successors);
+  void ComputeNearestNeighbors(CostClassIndex cost_class_index,
+                               int num_neighbors);
+  void ComputeNearestNeighborsOfIndices(CostClassIndex cost_class_index,
+                                        int num_neighbors, int64 begin,
+                                        int64 end);
+  // Version of GetNearestNeighbors() for the cost class of a vehicle, used by
+  // the Lin-Kernighan operator; inactive nodes (vehicle < 0) use the cost
+  // class of the first vehicle.
+  const std::vector<int>* GetNearestNeighborsOfVehicle(int64 from_index,
+                                                      int64 vehicle,
+                                                      int num_neighbors);
   int64 GetArcCostForClassInternal(int64 from_index, int64 to_index,
                                    CostClassIndex cost_class_index);
   void AppendHomogeneousArcCosts(int node_index,
@@ -1168,7 +1364,24 @@ class RoutingModel {
                             Assignment* compact_assignment) const;
 
   NodeEvaluator2* NewCachedCallback(NodeEvaluator2* callback);
+  // Sets the search parameters of the model through the corresponding flags;
+  // they are used when the model is closed.
+  void SetSearchParameters(const RoutingSearchParameters& parameters);
+  // Fills the caches of callbacks when callback caching is on.
+  void PrecomputeCachedCallbacks();
+  // Polishes the routes for which 'modified' is true (cf. PolishRoutes()) and
+  // updates 'routes' accordingly. Returns the solution corresponding to the
+  // polished routes if it is cheaper than 'cost', nullptr otherwise.
+  const Assignment* PolishModifiedRoutes(
+      const std::vector<bool>& modified, int64 cost, int num_threads,
+      std::vector<std::vector<NodeIndex>>* routes);
+  // Applies 2-opt and Or-opt moves to the route of a vehicle as long as they
+  // decrease its arc cost; sets 'changed' to true if the route was modified.
+  void PolishRoute(int vehicle, std::vector<NodeIndex>* route, bool* changed);
   void CheckDepot();
+  // Initializes the data of the dynamic re-optimization and adds the
+  // constraint enforcing it.
+  void InitializeDynamicReoptimization();
   void QuietCloseModel() {
     if (!closed_) {
       CloseModel();
@@ -1187,6 +1400,10 @@ class RoutingModel {
   LocalSearchOperator* GetNeighborhoodOperators() const;
   const std::vector<LocalSearchFilter*>& GetOrCreateLocalSearchFilters();
   const std::vector<LocalSearchFilter*>& GetOrCreateFeasibilityFilters();
+  // Creates a new set of filters checking the feasibility of routes, not
+  // shared with the filters returned by GetOrCreateFeasibilityFilters() except
+  // for extra filters.
+  std::vector<LocalSearchFilter*> CreateFeasibilityFilters();
   DecisionBuilder* CreateSolutionFinalizer();
   void CreateFirstSolutionDecisionBuilders();
   DecisionBuilder* GetFirstSolutionDecisionBuilder() const;
@@ -1232,13 +1449,16 @@ class RoutingModel {
 #endif  // SWIG
   bool costs_are_homogeneous_across_vehicles_;
   std::vector<CostCacheElement> cost_cache_;  // Index by source index.
+#ifndef SWIG
+  ITIVector<CostClassIndex, NearestNeighborLists> nearest_neighbors_;
+#endif  // SWIG
   std::vector<VehicleClassIndex> vehicle_class_index_of_vehicle_;
 #ifndef SWIG
   ITIVector<VehicleClassIndex, VehicleClass> vehicle_classes_;
 #endif  // SWIG
   std::unique_ptr<ResultCallback1<int, int64> > vehicle_start_class_callback_;
   // Cached callbacks
-  hash_map<const NodeEvaluator2*, NodeEvaluator2*> cached_node_callbacks_;
+  hash_map<const NodeEvaluator2*, RoutingCache*> cached_node_callbacks_;
   // Disjunctions
   ITIVector<DisjunctionIndex, Disjunction> disjunctions_;
   std::vector<DisjunctionIndex> node_to_disjunction_;
@@ -1271,6 +1491,12 @@ class RoutingModel {
   DecisionBuilder* restore_assignment_;
   Assignment* assignment_;
   Assignment* preassignment_;
+  // Data of the dynamic re-optimization, indexed by variable index (see
+  // SetNodeAvailable()); empty until it is used.
+  std::vector<bool> unavailable_indices_;
+  std::vector<int64> frozen_nexts_;
+  std::vector<std::vector<NodeIndex> > frozen_route_prefixes_;
+  Assignment* reoptimization_start_;
   std::vector<IntVar*> extra_vars_;
   std::vector<IntervalVar*> extra_intervals_;
   std::vector<LocalSearchOperator*> extra_operators_;
@@ -1910,9 +2136,11 @@ class ComparatorCheapestAdditionFilteredDecisionBuilder
 class SavingsFilteredDecisionBuilder : public RoutingFilteredDecisionBuilder {
  public:
   // If savings_neighbors > 0 then for each node only its 'saving_neighbors'
-  // neighbors leading to the smallest arc costs are considered.
+  // neighbors leading to the smallest arc costs are considered. Savings are
+  // computed and sorted using 'num_threads' threads; arc cost callbacks must
+  // be thread-safe when it is greater than 1.
   SavingsFilteredDecisionBuilder(
-      RoutingModel* model, int64 saving_neighbors,
+      RoutingModel* model, int64 saving_neighbors, int num_threads,
       const std::vector<LocalSearchFilter*>& filters);
   virtual ~SavingsFilteredDecisionBuilder() {}
   virtual bool BuildSolution();
@@ -1925,6 +2153,14 @@ class SavingsFilteredDecisionBuilder : public RoutingFilteredDecisionBuilder {
   // store and recover the node pair to which the value is linked (cf. the
   // index conversion methods below).
   std::vector<Saving> ComputeSavings() const;
+  // Appends to 'savings' the savings of the arcs leaving the nodes in
+  // [begin, end) for the cost class of 'vehicle'. 'start_costs' contains the
+  // costs of the arcs from the start of the vehicle to each node. Only arc
+  // costs from nodes in [begin, end) are queried from the model, which makes
+  // calls on disjoint ranges safe to run concurrently.
+  void ComputeSavingsOfNodes(int vehicle, int num_nearest,
+                             const std::vector<int64>* start_costs, int begin,
+                             int end, std::vector<Saving>* savings) const;
   // Builds a saving from a saving value, a cost class and two nodes.
   Saving BuildSaving(int64 saving, int cost_class, int before_node,
                      int after_node) const {
@@ -1947,6 +2183,7 @@ class SavingsFilteredDecisionBuilder : public RoutingFilteredDecisionBuilder {
   int64 GetSavingValue(const Saving& saving) const { return saving.first; }
 
   const int64 saving_neighbors_;
+  const int num_threads_;
   int64 size_squared_;
 };
 
@@ -1979,6 +2216,8 @@ class BasePathFilter : public RoutingLocalSearchFilter {
                  Callback1<int64>* objective_callback);
   virtual ~BasePathFilter() {}
   virtual bool Accept(const Assignment* delta, const Assignment* deltadelta);
+  virtual bool AcceptDecoded(const LocalSearchDelta& delta,
+                             const LocalSearchDelta& deltadelta);
   virtual void OnSynchronize(const Assignment* delta);
 
  protected:
@@ -1992,6 +2231,15 @@ class BasePathFilter : public RoutingLocalSearchFilter {
   int NumPaths() const { return starts_.size(); }
   int64 Start(int i) const { return starts_[i]; }
   int GetPath(int64 node) const { return paths_[node]; }
+  // Returns the start of the path of 'node' in the current solution, or
+  // kUnassigned if the node is inactive, and its rank on that path.
+  int64 GetPathStart(int64 node) const { return node_path_starts_[node]; }
+  int GetRank(int64 node) const { return ranks_[node]; }
+  // Returns the furthest node of the current path of 'node', not after
+  // 'limit' if 'limit' is on the same path, such that the nexts of the nodes
+  // from 'node' up to it (excluded) are not changed by the delta being
+  // accepted. Returns 'node' if it is inactive.
+  int64 GetUnchangedSubpathEnd(int64 node, int64 limit) const;
 
  private:
   virtual void OnBeforeSynchronizePaths() {}
@@ -22,7 +22,9 @@
 #include <set>
 #include "base/small_map.h"
 #include "base/small_ordered_set.h"
+#include "base/threadpool.h"
 #include "util/bitset.h"
+#include "util/saturated_arithmetic.h"
 
 namespace operations_research {
 
@@ -60,24 +62,26 @@ class NodeDisjunctionFilter : public RoutingLocalSearchFilter {
         penalty_value_(0) {}
 
   virtual bool Accept(const Assignment* delta, const Assignment* deltadelta) {
+    return DecodeAndAccept(delta, deltadelta);
+  }
+  virtual bool AcceptDecoded(const LocalSearchDelta& delta,
+                             const LocalSearchDelta& deltadelta) {
     const int64 kUnassigned = -1;
-    const Assignment::IntContainer& container = delta->IntVarContainer();
-    const int delta_size = container.Size();
+    const int delta_size = delta.Size();
     small_map<std::map<RoutingModel::DisjunctionIndex, int>>
         disjunction_active_deltas;
     bool lns_detected = false;
     for (int i = 0; i < delta_size; ++i) {
-      const IntVarElement& new_element = container.Element(i);
-      IntVar* const var = new_element.Var();
       int64 index = kUnassigned;
-      if (FindIndex(var, &index) && IsVarSynced(index)) {
+      if (FindIndexFromVarIndex(delta.VarIndex(i), &index) &&
+          IsVarSynced(index)) {
         RoutingModel::DisjunctionIndex disjunction_index(kUnassigned);
         if (routing_model_.GetDisjunctionIndexFromVariableIndex(
                 index, &disjunction_index)) {
           const bool was_inactive = (Value(index) == index);
           const bool is_inactive =
-              (new_element.Min() <= index && new_element.Max() >= index);
-          if (new_element.Min() != new_element.Max()) {
+              (delta.Min(i) <= index && delta.Max(i) >= index);
+          if (!delta.Bound(i)) {
             lns_detected = true;
           }
           if (was_inactive && !is_inactive) {
@@ -175,13 +179,17 @@ BasePathFilter::BasePathFilter(const std::vector<IntVar*>& nexts,
 
 bool BasePathFilter::Accept(const Assignment* delta,
                             const Assignment* deltadelta) {
+  return DecodeAndAccept(delta, deltadelta);
+}
+
+bool BasePathFilter::AcceptDecoded(const LocalSearchDelta& delta,
+                                   const LocalSearchDelta& deltadelta) {
   PropagateObjectiveValue(injected_objective_value_);
   for (const int touched : delta_touched_) {
     new_nexts_[touched] = kUnassigned;
   }
   delta_touched_.clear();
-  const Assignment::IntContainer& container = delta->IntVarContainer();
-  const int delta_size = container.Size();
+  const int delta_size = delta.Size();
   delta_touched_.reserve(delta_size);
   // Determining touched paths and touched nodes (a node is touched if it
   // corresponds to an element of delta or that an element of delta points to
@@ -189,15 +197,13 @@ bool BasePathFilter::Accept(const Assignment* delta,
   touched_paths_.SparseClearAll();
   touched_path_nodes_.SparseClearAll();
   for (int i = 0; i < delta_size; ++i) {
-    const IntVarElement& new_element = container.Element(i);
-    IntVar* const var = new_element.Var();
     int64 index = kUnassigned;
-    if (FindIndex(var, &index)) {
-      if (!new_element.Bound()) {
+    if (FindIndexFromVarIndex(delta.VarIndex(i), &index)) {
+      if (!delta.Bound(i)) {
         // LNS detected
         return true;
       }
-      new_nexts_[index] = new_element.Value();
+      new_nexts_[index] = delta.Value(i);
       delta_touched_.push_back(index);
       const int64 start = node_path_starts_[index];
       touched_path_nodes_.Set(index);
@@ -245,6 +251,29 @@ bool BasePathFilter::Accept(const Assignment* delta,
   return FinalizeAcceptPath() && accept;
 }
 
+int64 BasePathFilter::GetUnchangedSubpathEnd(int64 node, int64 limit) const {
+  const int64 start = node_path_starts_[node];
+  if (start == kUnassigned) return node;
+  const int rank = ranks_[node];
+  int64 end = kUnassigned;
+  int end_rank = kint32max;
+  if (node_path_starts_[limit] == start && ranks_[limit] >= rank) {
+    end = limit;
+    end_rank = ranks_[limit];
+  }
+  // Linear search on delta nodes is ok since there shouldn't be many of them.
+  for (const int delta_node : delta_touched_) {
+    if (node_path_starts_[delta_node] == start) {
+      const int delta_rank = ranks_[delta_node];
+      if (delta_rank >= rank && delta_rank < end_rank) {
+        end = delta_node;
+        end_rank = delta_rank;
+      }
+    }
+  }
+  return end == kUnassigned ? node : end;
+}
+
 void BasePathFilter::ComputePathStarts(std::vector<int64>* path_starts,
                                        std::vector<int>* index_to_path) {
   path_starts->clear();
@@ -377,10 +406,51 @@ void BasePathFilter::UpdatePathRanksFromStart(int start) {
 
 namespace {
 
+// Segment tree on the arcs of a path, storing summaries of type Segment of
+// the effect of subpaths on cumul values. Segment() must be the summary of an
+// empty subpath, and Segment::Concatenate(first, second) the summary of the
+// subpath 'first' followed by the subpath 'second'.
+template <class Segment>
+class PathSegmentTree {
+ public:
+  void Clear() { segments_.clear(); }
+  // Arcs must be added in the order of the path, then the tree must be built
+  // before being queried.
+  void AddArc(const Segment& arc) { segments_.push_back(arc); }
+  void Build() {
+    // Leaves are stored after the inner nodes of the tree.
+    const int num_arcs = segments_.size();
+    segments_.insert(segments_.begin(), num_arcs, Segment());
+    for (int i = num_arcs - 1; i > 0; --i) {
+      segments_[i] =
+          Segment::Concatenate(segments_[2 * i], segments_[2 * i + 1]);
+    }
+  }
+  // Returns the summary of the subpath going from the node of rank
+  // 'begin_rank' to the node of rank 'end_rank'.
+  Segment Get(int begin_rank, int end_rank) const {
+    const int num_arcs = segments_.size() / 2;
+    // Bottom-up query, keeping the order of the arcs.
+    Segment first;
+    Segment last;
+    for (int begin = begin_rank + num_arcs, end = end_rank + num_arcs;
+         begin < end; begin /= 2, end /= 2) {
+      if (begin & 1) first = Segment::Concatenate(first, segments_[begin++]);
+      if (end & 1) last = Segment::Concatenate(segments_[--end], last);
+    }
+    return Segment::Concatenate(first, last);
+  }
+
+ private:
+  std::vector<Segment> segments_;
+};
+
 // ChainCumul filter. Version of dimension path filter which is O(delta) rather
 // than O(length of touched paths). Currently only supports dimensions without
 // costs (global and local span cost, soft bounds) and with unconstrained
 // cumul variables except overall capacity and cumul variables of path ends.
+// Parts of paths which are not modified by a delta are checked in
+// O(log(path length)) using range queries on the current paths.
 
 class ChainCumulFilter : public BasePathFilter {
  public:
@@ -393,6 +463,30 @@ class ChainCumulFilter : public BasePathFilter {
   }
 
  private:
+  // Effect of a sequence of arcs of a path on cumul values: if the cumul of
+  // the first node is c, the cumul of the last node is max(c + transit,
+  // min_cumul) and the largest cumul of the nodes after the first one is
+  // max(c + max_transit, max_min_cumul). Segments can be concatenated, which
+  // lets segment trees answer queries on any subpath.
+  struct PathSegment {
+    PathSegment()
+        : transit(0),
+          min_cumul(kint64min),
+          max_transit(kint64min),
+          max_min_cumul(kint64min) {}
+    PathSegment(int64 arc_transit, int64 next_cumul_min)
+        : transit(arc_transit),
+          min_cumul(next_cumul_min),
+          max_transit(arc_transit),
+          max_min_cumul(next_cumul_min) {}
+    static PathSegment Concatenate(const PathSegment& first,
+                                   const PathSegment& second);
+    int64 transit;
+    int64 min_cumul;
+    int64 max_transit;
+    int64 max_min_cumul;
+  };
+
   virtual void OnSynchronizePathFromStart(int64 start);
   virtual bool AcceptPath(int64 path_start, int64 chain_start, int64 chain_end);
 
@@ -402,7 +496,8 @@ class ChainCumulFilter : public BasePathFilter {
   std::vector<Solver::IndexEvaluator2*> evaluators_;
   RoutingModel::VehicleEvaluator* const capacity_evaluator_;
   std::vector<int64> current_path_cumul_mins_;
-  std::vector<int64> current_max_of_path_end_cumul_mins_;
+  // Segment trees on the arcs of current paths, indexed by path start.
+  std::vector<PathSegmentTree<PathSegment>> current_path_segments_;
   std::vector<int64> old_nexts_;
   std::vector<int> old_vehicles_;
   std::vector<int64> current_transits_;
@@ -418,7 +513,7 @@ ChainCumulFilter::ChainCumulFilter(const RoutingModel& routing_model,
       evaluators_(routing_model.vehicles(), nullptr),
       capacity_evaluator_(dimension.capacity_evaluator()),
       current_path_cumul_mins_(dimension.cumuls().size(), 0),
-      current_max_of_path_end_cumul_mins_(dimension.cumuls().size(), 0),
+      current_path_segments_(routing_model.Size()),
       old_nexts_(routing_model.Size(), kUnassigned),
       old_vehicles_(routing_model.Size(), kUnassigned),
       current_transits_(routing_model.Size(), 0),
@@ -432,17 +527,16 @@ ChainCumulFilter::ChainCumulFilter(const RoutingModel& routing_model,
   }
 }
 
-// On synchronization, maintain "propagated" cumul mins and max level of cumul
-// from each node to the end of the path; to be used by AcceptPath to
-// incrementally check feasibility.
+// On synchronization, maintain "propagated" cumul mins and the segment tree of
+// each path; to be used by AcceptPath to incrementally check feasibility.
 void ChainCumulFilter::OnSynchronizePathFromStart(int64 start) {
   const int vehicle = start_to_vehicle_[start];
   Solver::IndexEvaluator2* const evaluator = evaluators_[vehicle];
-  std::vector<int64> path_nodes;
+  PathSegmentTree<PathSegment>& segments = current_path_segments_[start];
+  segments.Clear();
   int64 node = start;
   int64 cumul = cumuls_[node]->Min();
   while (node < Size()) {
-    path_nodes.push_back(node);
     current_path_cumul_mins_[node] = cumul;
     const int64 next = Value(node);
     if (next != old_nexts_[node] || vehicle != old_vehicles_[node]) {
@@ -450,21 +544,32 @@ void ChainCumulFilter::OnSynchronizePathFromStart(int64 start) {
       old_vehicles_[node] = vehicle;
       current_transits_[node] = evaluator->Run(node, next);
     }
+    segments.AddArc(PathSegment(current_transits_[node], cumuls_[next]->Min()));
     cumul += current_transits_[node];
     cumul = std::max(cumuls_[next]->Min(), cumul);
     node = next;
   }
-  path_nodes.push_back(node);
   current_path_cumul_mins_[node] = cumul;
-  int64 max_cumuls = cumul;
-  for (int i = path_nodes.size() - 1; i >= 0; --i) {
-    const int64 node = path_nodes[i];
-    max_cumuls = std::max(max_cumuls, current_path_cumul_mins_[node]);
-    current_max_of_path_end_cumul_mins_[node] = max_cumuls;
-  }
-}
-
-// The complexity of the method is O(size of chain (chain_start...chain_end).
+  segments.Build();
+}
+
+// static
+ChainCumulFilter::PathSegment ChainCumulFilter::PathSegment::Concatenate(
+    const PathSegment& first, const PathSegment& second) {
+  PathSegment segment;
+  segment.transit = CapAdd(first.transit, second.transit);
+  segment.min_cumul =
+      std::max(CapAdd(first.min_cumul, second.transit), second.min_cumul);
+  segment.max_transit = std::max(first.max_transit,
+                                 CapAdd(first.transit, second.max_transit));
+  segment.max_min_cumul =
+      std::max(std::max(first.max_min_cumul, second.max_min_cumul),
+               CapAdd(first.min_cumul, second.max_transit));
+  return segment;
+}
+
+// The complexity of the method is O(number of delta nodes *
+// (number of delta nodes + log(length of touched paths))).
 bool ChainCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
                                   int64 chain_end) {
   const int vehicle = start_to_vehicle_[path_start];
@@ -475,6 +580,21 @@ bool ChainCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
   int64 node = chain_start;
   int64 cumul = current_path_cumul_mins_[node];
   while (node != chain_end) {
+    // Unchanged subpaths of the current solution are skipped in one step.
+    const int64 subpath_end = GetPathStart(node) == path_start
+                                  ? GetUnchangedSubpathEnd(node, chain_end)
+                                  : node;
+    if (subpath_end != node) {
+      const PathSegment segment = current_path_segments_[path_start].Get(
+          GetRank(node), GetRank(subpath_end));
+      if (std::max(CapAdd(cumul, segment.max_transit),
+                   segment.max_min_cumul) > capacity) {
+        return false;
+      }
+      cumul = std::max(CapAdd(cumul, segment.transit), segment.min_cumul);
+      node = subpath_end;
+      continue;
+    }
     const int64 next = GetNext(node);
     if (IsVarSynced(node) && next == Value(node) &&
         vehicle == old_vehicles_[node]) {
@@ -486,14 +606,14 @@ bool ChainCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
     if (cumul > capacity) return false;
     node = next;
   }
+  // The path after the chain is unchanged.
   const int64 end = start_to_end_[path_start];
-  const int64 end_cumul_delta =
-      current_path_cumul_mins_[end] - current_path_cumul_mins_[node];
-  const int64 after_chain_cumul_delta =
-      current_max_of_path_end_cumul_mins_[node] -
-      current_path_cumul_mins_[node];
-  return cumul + after_chain_cumul_delta <= capacity &&
-         cumul + end_cumul_delta <= cumuls_[end]->Max();
+  const PathSegment segment =
+      current_path_segments_[path_start].Get(GetRank(node), GetRank(end));
+  return std::max(CapAdd(cumul, segment.max_transit),
+                  segment.max_min_cumul) <= capacity &&
+         std::max(CapAdd(cumul, segment.transit), segment.min_cumul) <=
+             cumuls_[end]->Max();
 }
 
 // PathCumul filter.
@@ -524,6 +644,30 @@ class PathCumulFilter : public BasePathFilter {
     int64 coefficient;
   };
 
+  // Effect of a sequence of arcs of a path on cumul values: if the cumul of
+  // the first node is c, the cumuls of the subpath are within their bounds
+  // iff 'feasible' is true and c <= max_start, and the cumul of the last node
+  // is then max(c + transit, min_cumul). Transits include slack mins.
+  struct CumulBoundsSegment {
+    CumulBoundsSegment()
+        : transit(0),
+          min_cumul(kint64min),
+          max_start(kint64max),
+          feasible(true) {}
+    CumulBoundsSegment(int64 arc_transit, int64 next_cumul_min,
+                       int64 next_cumul_max)
+        : transit(arc_transit),
+          min_cumul(next_cumul_min),
+          max_start(CapSub(next_cumul_max, arc_transit)),
+          feasible(true) {}
+    static CumulBoundsSegment Concatenate(const CumulBoundsSegment& first,
+                                          const CumulBoundsSegment& second);
+    int64 transit;
+    int64 min_cumul;
+    int64 max_start;
+    bool feasible;
+  };
+
   // This class caches transit values between nodes of paths. Transit and path
   // nodes are to be added in the order in which they appear on a path.
   class PathTransits {
@@ -573,6 +717,16 @@ class PathCumulFilter : public BasePathFilter {
   virtual bool AcceptPath(int64 path_start, int64 chain_start, int64 chain_end);
   virtual bool FinalizeAcceptPath();
   virtual void OnBeforeSynchronizePaths();
+  virtual void OnSynchronizePathFromStart(int64 start);
+  // Checks the cumul bounds of a path when no cost has to be computed, in
+  // O(number of delta nodes * (number of delta nodes + log(path length))),
+  // skipping subpaths unchanged by the delta with the segment trees.
+  bool AcceptPathBounds(int64 path_start);
+
+  bool FilterCosts() const {
+    return FilterSpanCost() || FilterCumulSoftBounds() || FilterSlackCost() ||
+           FilterCumulSoftLowerBounds();
+  }
 
   bool FilterSpanCost() const { return global_span_cost_coefficient_ != 0; }
 
@@ -605,6 +759,7 @@ class PathCumulFilter : public BasePathFilter {
   const std::vector<IntVar*> cumuls_;
   const std::vector<IntVar*> slacks_;
   std::vector<int64> start_to_vehicle_;
+  std::vector<int64> start_to_end_;
   std::vector<Solver::IndexEvaluator2*> evaluators_;
   std::vector<int64> vehicle_span_upper_bounds_;
   bool has_vehicle_span_upper_bounds_;
@@ -625,6 +780,9 @@ class PathCumulFilter : public BasePathFilter {
   SupportedPathCumul current_min_start_;
   SupportedPathCumul current_max_end_;
   PathTransits current_path_transits_;
+  // Segment trees on the arcs of current paths, indexed by path start; only
+  // maintained when no cost has to be computed.
+  std::vector<PathSegmentTree<CumulBoundsSegment>> current_path_segments_;
   // Data reflecting information on paths and cumul variables for the "delta"
   // solution (aka neighbor solution) being examined.
   PathTransits delta_path_transits_;
@@ -655,6 +813,7 @@ PathCumulFilter::PathCumulFilter(const RoutingModel& routing_model,
       has_nonzero_vehicle_span_cost_coefficients_(false),
       cost_var_(routing_model.CostVar()),
       capacity_evaluator_(dimension.capacity_evaluator()),
+      current_path_segments_(routing_model.Size()),
       delta_max_end_cumul_(kint64min),
       name_(dimension.name()),
       lns_detected_(false) {
@@ -716,12 +875,29 @@ PathCumulFilter::PathCumulFilter(const RoutingModel& routing_model,
     has_nonzero_vehicle_span_cost_coefficients_ = false;
   }
   start_to_vehicle_.resize(Size(), -1);
+  start_to_end_.resize(Size(), -1);
   for (int i = 0; i < routing_model.vehicles(); ++i) {
     start_to_vehicle_[routing_model.Start(i)] = i;
+    start_to_end_[routing_model.Start(i)] = routing_model.End(i);
     evaluators_[i] = dimension.transit_evaluator(i);
   }
 }
 
+// static
+PathCumulFilter::CumulBoundsSegment
+PathCumulFilter::CumulBoundsSegment::Concatenate(
+    const CumulBoundsSegment& first, const CumulBoundsSegment& second) {
+  CumulBoundsSegment segment;
+  segment.transit = CapAdd(first.transit, second.transit);
+  segment.min_cumul =
+      std::max(CapAdd(first.min_cumul, second.transit), second.min_cumul);
+  segment.max_start =
+      std::min(first.max_start, CapSub(second.max_start, first.transit));
+  segment.feasible = first.feasible && second.feasible &&
+                     first.min_cumul <= second.max_start;
+  return segment;
+}
+
 int64 PathCumulFilter::GetCumulSoftCost(int64 node, int64 cumul_value) const {
   if (node < cumul_soft_bounds_.size()) {
     const int64 bound = cumul_soft_bounds_[node].bound;
@@ -840,8 +1016,68 @@ void PathCumulFilter::OnBeforeSynchronizePaths() {
   }
 }
 
+void PathCumulFilter::OnSynchronizePathFromStart(int64 start) {
+  if (FilterCosts()) return;
+  const int vehicle = start_to_vehicle_[start];
+  const int64 capacity = capacity_evaluator_ == nullptr
+                             ? kint64max
+                             : capacity_evaluator_->Run(vehicle);
+  Solver::IndexEvaluator2* const evaluator = evaluators_[vehicle];
+  PathSegmentTree<CumulBoundsSegment>& segments =
+      current_path_segments_[start];
+  segments.Clear();
+  int64 node = start;
+  while (node < Size()) {
+    const int64 next = Value(node);
+    segments.AddArc(CumulBoundsSegment(
+        evaluator->Run(node, next) + slacks_[node]->Min(),
+        cumuls_[next]->Min(), std::min(capacity, cumuls_[next]->Max())));
+    node = next;
+  }
+  segments.Build();
+}
+
+bool PathCumulFilter::AcceptPathBounds(int64 path_start) {
+  const int vehicle = start_to_vehicle_[path_start];
+  const int64 capacity = capacity_evaluator_ == nullptr
+                             ? kint64max
+                             : capacity_evaluator_->Run(vehicle);
+  Solver::IndexEvaluator2* const evaluator = evaluators_[vehicle];
+  const int64 path_end = start_to_end_[path_start];
+  int64 node = path_start;
+  int64 cumul = cumuls_[node]->Min();
+  while (node < Size()) {
+    // Unchanged subpaths of the current solution are checked in one step.
+    const int64 subpath_end = GetPathStart(node) == path_start
+                                  ? GetUnchangedSubpathEnd(node, path_end)
+                                  : node;
+    if (subpath_end != node) {
+      const CumulBoundsSegment segment = current_path_segments_[path_start].Get(
+          GetRank(node), GetRank(subpath_end));
+      if (!segment.feasible || cumul > segment.max_start) return false;
+      cumul = std::max(CapAdd(cumul, segment.transit), segment.min_cumul);
+      node = subpath_end;
+      continue;
+    }
+    const int64 next = GetNext(node);
+    if (next == kUnassigned) {
+      // LNS detected, return true since other paths were ok up to now.
+      lns_detected_ = true;
+      return true;
+    }
+    cumul += evaluator->Run(node, next) + slacks_[node]->Min();
+    if (cumul > std::min(capacity, cumuls_[next]->Max())) {
+      return false;
+    }
+    cumul = std::max(cumuls_[next]->Min(), cumul);
+    node = next;
+  }
+  return true;
+}
+
 bool PathCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
                                  int64 chain_end) {
+  if (!FilterCosts()) return AcceptPathBounds(path_start);
   int64 node = path_start;
   int64 cumul = cumuls_[node]->Min();
   cumul_cost_delta_ += GetCumulSoftCost(node, cumul);
@@ -1061,12 +1297,24 @@ class NodePrecedenceFilter : public BasePathFilter {
                        const RoutingModel::NodePairs& pairs);
   virtual ~NodePrecedenceFilter() {}
   virtual bool AcceptPath(int64 path_start, int64 chain_start, int64 chain_end);
+  virtual bool CanBeReordered() const { return true; }
   virtual std::string DebugString() const { return "NodePrecedenceFilter"; }
 
  private:
+  bool IsBeforeChain(int64 node, int64 path_start, int64 chain_start) const {
+    return GetPathStart(node) == path_start &&
+           GetRank(node) < GetRank(chain_start);
+  }
+  bool IsAfterChain(int64 node, int64 path_start, int64 chain_end) const {
+    return GetPathStart(node) == path_start &&
+           GetRank(node) > GetRank(chain_end);
+  }
+
   std::vector<int> pair_firsts_;
   std::vector<int> pair_seconds_;
   SparseBitset<> visited_;
+  // Position of visited nodes in the new chain.
+  std::vector<int> positions_;
 };
 
 NodePrecedenceFilter::NodePrecedenceFilter(const std::vector<IntVar*>& nexts,
@@ -1075,43 +1323,71 @@ NodePrecedenceFilter::NodePrecedenceFilter(const std::vector<IntVar*>& nexts,
     : BasePathFilter(nexts, next_domain_size, nullptr),
       pair_firsts_(next_domain_size, kUnassigned),
       pair_seconds_(next_domain_size, kUnassigned),
-      visited_(Size()) {
+      visited_(Size()),
+      positions_(Size(), 0) {
   for (const std::pair<int64, int64> node_pair : pairs) {
     pair_firsts_[node_pair.first] = node_pair.second;
     pair_seconds_[node_pair.second] = node_pair.first;
   }
 }
 
+// Only the chain of touched nodes needs to be checked: nodes before and after
+// it have kept their order, so the position of a pair node outside the chain
+// is given by its rank in the current solution.
 bool NodePrecedenceFilter::AcceptPath(int64 path_start, int64 chain_start,
                                       int64 chain_end) {
-  visited_.ClearAll();
-  int64 node = path_start;
-  int64 path_length = 1;
-  while (node < Size()) {
-    // Detect sub-cycles (path is longer than longest possible path).
-    if (path_length > Size()) {
+  visited_.SparseClearAll();
+  int64 node = chain_start;
+  int position = 0;
+  while (true) {
+    // Detect sub-cycles (chain is longer than longest possible path).
+    if (position > Size()) {
       return false;
     }
-    if (pair_firsts_[node] != kUnassigned && visited_[pair_firsts_[node]]) {
-      return false;
+    if (node < Size()) {
+      visited_.Set(node);
+      positions_[node] = position;
     }
-    if (pair_seconds_[node] != kUnassigned && !visited_[pair_seconds_[node]]) {
+    if (node == chain_end) break;
+    if (node >= Size()) {
       return false;
     }
-    visited_.Set(node);
     const int64 next = GetNext(node);
     if (next == kUnassigned) {
       // LNS detected, return true since path was ok up to now.
       return true;
     }
     node = next;
-    ++path_length;
+    ++position;
   }
   for (const int64 node : visited_.PositionsSetAtLeastOnce()) {
-    if (pair_firsts_[node] != kUnassigned && !visited_[pair_firsts_[node]]) {
+    const int64 second = pair_firsts_[node];
+    if (second != kUnassigned &&
+        (visited_[second] ? positions_[second] < positions_[node]
+                          : !IsAfterChain(second, path_start, chain_end))) {
+      return false;
+    }
+    const int64 first = pair_seconds_[node];
+    if (first != kUnassigned &&
+        (visited_[first] ? positions_[first] > positions_[node]
+                         : !IsBeforeChain(first, path_start, chain_start))) {
       return false;
     }
   }
+  // Nodes which were removed from the chain must not leave their sibling
+  // alone on the path.
+  for (node = chain_start; node != chain_end; node = Value(node)) {
+    if (!visited_[node]) {
+      const int64 sibling = pair_firsts_[node] != kUnassigned
+                                ? pair_firsts_[node]
+                                : pair_seconds_[node];
+      if (sibling != kUnassigned &&
+          (IsBeforeChain(sibling, path_start, chain_start) ||
+           IsAfterChain(sibling, path_start, chain_end))) {
+        return false;
+      }
+    }
+  }
   return true;
 }
 
@@ -1131,9 +1407,10 @@ class VehicleVarFilter : public BasePathFilter {
  public:
   explicit VehicleVarFilter(const RoutingModel& routing_model);
   ~VehicleVarFilter() {}
-  virtual bool Accept(const Assignment* delta,
-                      const Assignment* deltadelta);
+  virtual bool AcceptDecoded(const LocalSearchDelta& delta,
+                             const LocalSearchDelta& deltadelta);
   virtual bool AcceptPath(int64 path_start, int64 chain_start, int64 chain_end);
+  virtual bool CanBeReordered() const { return true; }
   virtual std::string DebugString() const { return "VehicleVariableFilter"; }
 
  private:
@@ -1155,14 +1432,13 @@ VehicleVarFilter::VehicleVarFilter(const RoutingModel& routing_model)
 }
 
 // Avoid filtering if variable domains are unconstrained.
-bool VehicleVarFilter::Accept(const Assignment* delta,
-                              const Assignment* deltadelta) {
-  const Assignment::IntContainer& container = delta->IntVarContainer();
-  const int size = container.Size();
+bool VehicleVarFilter::AcceptDecoded(const LocalSearchDelta& delta,
+                                     const LocalSearchDelta& deltadelta) {
+  const int size = delta.Size();
   bool all_unconstrained = true;
   for (int i = 0; i < size; ++i) {
     int64 index = -1;
-    if (FindIndex(container.Element(i).Var(), &index)) {
+    if (FindIndexFromVarIndex(delta.VarIndex(i), &index)) {
       const IntVar* const vehicle_var = vehicle_vars_[index];
       // If vehicle variable contains -1 (optional node), then we need to
       // add it to the "unconstrained" domain. Impact we don't filter mandatory
@@ -1179,20 +1455,29 @@ bool VehicleVarFilter::Accept(const Assignment* delta,
     }
   }
   if (all_unconstrained) return true;
-  return BasePathFilter::Accept(delta, deltadelta);
+  return BasePathFilter::AcceptDecoded(delta, deltadelta);
 }
 
+// Nodes which were already on the path in the current solution, that is nodes
+// outside of the chain and unchanged subpaths of the chain, are skipped.
 bool VehicleVarFilter::AcceptPath(int64 path_start, int64 chain_start,
                                   int64 chain_end) {
   const int64 vehicle = start_to_vehicle_[path_start];
-  int64 node = path_start;
-  while (node < Size()) {
+  int64 node = chain_start;
+  while (node != chain_end) {
+    const int64 subpath_end = GetPathStart(node) == path_start
+                                  ? GetUnchangedSubpathEnd(node, chain_end)
+                                  : node;
+    if (subpath_end != node) {
+      node = subpath_end;
+      continue;
+    }
     if (!vehicle_vars_[node]->Contains(vehicle)) {
       return false;
     }
     node = GetNext(node);
   }
-  return true;
+  return node >= Size() || vehicle_vars_[node]->Contains(vehicle);
 }
 
 }  // namespace
@@ -1459,6 +1744,7 @@ class GlobalCheapestInsertionFilteredDecisionBuilder::PairEntry {
             int delivery_to_insert, int delivery_insert_after, int vehicle)
       : heap_index_(-1),
         value_(kint64max),
+        pending_value_(kint64max),
         pickup_to_insert_(pickup_to_insert),
         pickup_insert_after_(pickup_insert_after),
         delivery_to_insert_(delivery_to_insert),
@@ -1484,7 +1770,29 @@ class GlobalCheapestInsertionFilteredDecisionBuilder::PairEntry {
   void SetHeapIndex(int h) { heap_index_ = h; }
   int GetHeapIndex() const { return heap_index_; }
   int64 value() const { return value_; }
-  void set_value(int64 value) { value_ = value; }
+  void set_value(int64 value) { value_ = pending_value_ = value; }
+  // Updates the value of an entry which is already in the priority queue.
+  // Returns true if the value decreased, in which case the entry must be moved
+  // up in the queue right away. Increases are only recorded and applied by
+  // ApplyPendingValue() once the entry reaches the top of the queue: the value
+  // the entry is ordered with remains a lower bound of its actual value, which
+  // is enough to get the same insertion order while saving most of the queue
+  // updates.
+  bool UpdateValue(int64 value) {
+    pending_value_ = value;
+    if (value < value_) {
+      value_ = value;
+      return true;
+    }
+    return false;
+  }
+  // Applies the last value recorded by UpdateValue(); returns true if the
+  // value changed, in which case the entry must be moved in the queue.
+  bool ApplyPendingValue() {
+    if (pending_value_ == value_) return false;
+    value_ = pending_value_;
+    return true;
+  }
   int pickup_to_insert() const { return pickup_to_insert_; }
   int pickup_insert_after() const { return pickup_insert_after_; }
   int delivery_to_insert() const { return delivery_to_insert_; }
@@ -1494,6 +1802,7 @@ class GlobalCheapestInsertionFilteredDecisionBuilder::PairEntry {
  private:
   int heap_index_;
   int64 value_;
+  int64 pending_value_;
   const int pickup_to_insert_;
   const int pickup_insert_after_;
   const int delivery_to_insert_;
@@ -1507,6 +1816,7 @@ class GlobalCheapestInsertionFilteredDecisionBuilder::NodeEntry {
   NodeEntry(int node_to_insert, int insert_after, int vehicle)
       : heap_index_(-1),
         value_(kint64max),
+        pending_value_(kint64max),
         node_to_insert_(node_to_insert),
         insert_after_(insert_after),
         vehicle_(vehicle) {}
@@ -1524,7 +1834,29 @@ class GlobalCheapestInsertionFilteredDecisionBuilder::NodeEntry {
   void SetHeapIndex(int h) { heap_index_ = h; }
   int GetHeapIndex() const { return heap_index_; }
   int64 value() const { return value_; }
-  void set_value(int64 value) { value_ = value; }
+  void set_value(int64 value) { value_ = pending_value_ = value; }
+  // Updates the value of an entry which is already in the priority queue.
+  // Returns true if the value decreased, in which case the entry must be moved
+  // up in the queue right away. Increases are only recorded and applied by
+  // ApplyPendingValue() once the entry reaches the top of the queue: the value
+  // the entry is ordered with remains a lower bound of its actual value, which
+  // is enough to get the same insertion order while saving most of the queue
+  // updates.
+  bool UpdateValue(int64 value) {
+    pending_value_ = value;
+    if (value < value_) {
+      value_ = value;
+      return true;
+    }
+    return false;
+  }
+  // Applies the last value recorded by UpdateValue(); returns true if the
+  // value changed, in which case the entry must be moved in the queue.
+  bool ApplyPendingValue() {
+    if (pending_value_ == value_) return false;
+    value_ = pending_value_;
+    return true;
+  }
   int node_to_insert() const { return node_to_insert_; }
   int insert_after() const { return insert_after_; }
   int vehicle() const { return vehicle_; }
@@ -1532,6 +1864,7 @@ class GlobalCheapestInsertionFilteredDecisionBuilder::NodeEntry {
  private:
   int heap_index_;
   int64 value_;
+  int64 pending_value_;
   const int node_to_insert_;
   const int insert_after_;
   const int vehicle_;
@@ -1570,6 +1903,8 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InsertPairs() {
         Contains(entry->delivery_to_insert())) {
       DeletePairEntry(entry, &priority_queue, &pickup_to_entries,
                       &delivery_to_entries);
+    } else if (entry->ApplyPendingValue()) {
+      priority_queue.NoteChangedPriority(entry);
     } else {
       if (entry->vehicle() == -1) {
         // Pair is unperformed.
@@ -1625,6 +1960,8 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InsertNodes() {
     NodeEntry* const node_entry = priority_queue.Top();
     if (Contains(node_entry->node_to_insert())) {
       DeleteNodeEntry(node_entry, &priority_queue, &position_to_node_entries);
+    } else if (node_entry->ApplyPendingValue()) {
+      priority_queue.NoteChangedPriority(node_entry);
     } else {
       InsertBetween(node_entry->node_to_insert(), node_entry->insert_after(),
                     Value(node_entry->insert_after()));
@@ -1799,10 +2136,12 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::UpdatePickupPositions(
         evaluator_->Run(pair_entry->delivery_to_insert(),
                         delivery_insert_before, vehicle) -
         evaluator_->Run(delivery_insert_after, delivery_insert_before, vehicle);
-    pair_entry->set_value(pickup_value + delivery_value);
     if (priority_queue->Contains(pair_entry)) {
-      priority_queue->NoteChangedPriority(pair_entry);
+      if (pair_entry->UpdateValue(pickup_value + delivery_value)) {
+        priority_queue->NoteChangedPriority(pair_entry);
+      }
     } else {
+      pair_entry->set_value(pickup_value + delivery_value);
       priority_queue->Add(pair_entry);
     }
   }
@@ -1889,10 +2228,12 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::UpdateDeliveryPositions(
         evaluator_->Run(pair_entry->delivery_to_insert(),
                         delivery_insert_before, vehicle) -
         old_delivery_value;
-    pair_entry->set_value(pickup_value + delivery_value);
     if (priority_queue->Contains(pair_entry)) {
-      priority_queue->NoteChangedPriority(pair_entry);
+      if (pair_entry->UpdateValue(pickup_value + delivery_value)) {
+        priority_queue->NoteChangedPriority(pair_entry);
+      }
     } else {
+      pair_entry->set_value(pickup_value + delivery_value);
       priority_queue->Add(pair_entry);
     }
   }
@@ -1991,10 +2332,12 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::UpdatePositions(
         evaluator_->Run(insert_after, node_entry->node_to_insert(), vehicle) +
         evaluator_->Run(node_entry->node_to_insert(), insert_before, vehicle) -
         old_value;
-    node_entry->set_value(value);
     if (update) {
-      priority_queue->NoteChangedPriority(node_entry);
+      if (node_entry->UpdateValue(value)) {
+        priority_queue->NoteChangedPriority(node_entry);
+      }
     } else {
+      node_entry->set_value(value);
       priority_queue->Add(node_entry);
     }
   }
@@ -2288,13 +2631,106 @@ void ComparatorCheapestAdditionFilteredDecisionBuilder::SortPossibleNexts(
   }
 }
 
+namespace {
+// Runs closures using up to 'num_threads' threads.
+void RunClosures(int num_threads, const std::vector<Closure*>& closures) {
+  if (num_threads <= 1 || closures.size() <= 1) {
+    for (Closure* const closure : closures) {
+      closure->Run();
+    }
+    return;
+  }
+  ThreadPool pool("Savings",
+                  std::min<int>(num_threads, closures.size()));
+  for (Closure* const closure : closures) {
+    pool.Add(closure);
+  }
+  pool.StartWorkers();
+}
+
+// Least significant digit radix sort of 64-bit keys. Each pass counts the
+// digits of contiguous chunks of keys, then moves the keys of each chunk to
+// their position in the sorted order; chunks are processed in parallel.
+const int kRadixDigitBits = 11;
+const int kRadixBuckets = 1 << kRadixDigitBits;
+
+void CountRadixDigits(const std::vector<uint64>* keys, int64 begin, int64 end,
+                      int shift, int64* counts) {
+  for (int64 i = begin; i < end; ++i) {
+    ++counts[((*keys)[i] >> shift) & (kRadixBuckets - 1)];
+  }
+}
+
+void MoveRadixKeys(const std::vector<uint64>* keys, int64 begin, int64 end,
+                   int shift, int64* offsets, std::vector<uint64>* moved) {
+  for (int64 i = begin; i < end; ++i) {
+    const uint64 key = (*keys)[i];
+    (*moved)[offsets[(key >> shift) & (kRadixBuckets - 1)]++] = key;
+  }
+}
+
+// Sorts keys which fit on their 'num_bits' least significant bits.
+void RadixSort(int num_bits, int num_threads, std::vector<uint64>* keys) {
+  const int64 num_keys = keys->size();
+  if (num_keys <= 1) return;
+  const int64 chunk_size = (num_keys + num_threads - 1) / num_threads;
+  const int num_chunks = (num_keys + chunk_size - 1) / chunk_size;
+  std::vector<uint64> moved(num_keys);
+  std::vector<int64> counts(num_chunks * kRadixBuckets);
+  for (int shift = 0; shift < num_bits; shift += kRadixDigitBits) {
+    counts.assign(counts.size(), 0);
+    std::vector<Closure*> closures;
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+      closures.push_back(NewCallback(
+          &CountRadixDigits, static_cast<const std::vector<uint64>*>(keys),
+          chunk * chunk_size, std::min(num_keys, (chunk + 1) * chunk_size),
+          shift, &counts[chunk * kRadixBuckets]));
+    }
+    RunClosures(num_threads, closures);
+    // Turn counts into offsets, digit by digit then chunk by chunk, which
+    // keeps the sort stable. Passes on digits shared by all keys are skipped.
+    bool single_digit = false;
+    int64 offset = 0;
+    for (int digit = 0; digit < kRadixBuckets; ++digit) {
+      const int64 digit_offset = offset;
+      for (int chunk = 0; chunk < num_chunks; ++chunk) {
+        int64* const count = &counts[chunk * kRadixBuckets + digit];
+        const int64 digit_count = *count;
+        *count = offset;
+        offset += digit_count;
+      }
+      if (offset - digit_offset == num_keys) {
+        single_digit = true;
+        break;
+      }
+    }
+    if (single_digit) continue;
+    closures.clear();
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+      closures.push_back(NewCallback(
+          &MoveRadixKeys, static_cast<const std::vector<uint64>*>(keys),
+          chunk * chunk_size, std::min(num_keys, (chunk + 1) * chunk_size),
+          shift, &counts[chunk * kRadixBuckets], &moved));
+    }
+    RunClosures(num_threads, closures);
+    keys->swap(moved);
+  }
+}
+
+// Returns the number of bits needed to represent a value.
+int NumBits(uint64 value) {
+  return value == 0 ? 0 : MostSignificantBitPosition64(value) + 1;
+}
+}  // namespace
+
 // SavingsFilteredDecisionBuilder
 
 SavingsFilteredDecisionBuilder::SavingsFilteredDecisionBuilder(
-    RoutingModel* model, int64 saving_neighbors,
+    RoutingModel* model, int64 saving_neighbors, int num_threads,
     const std::vector<LocalSearchFilter*>& filters)
     : RoutingFilteredDecisionBuilder(model, filters),
       saving_neighbors_(saving_neighbors),
+      num_threads_(num_threads),
       size_squared_(0) {}
 
 bool SavingsFilteredDecisionBuilder::BuildSolution() {
@@ -2396,51 +2832,157 @@ SavingsFilteredDecisionBuilder::ComputeSavings() const {
   const int64 saving_neighbors =
       saving_neighbors_ <= 0 ? size : saving_neighbors_;
   const int num_cost_classes = model()->GetCostClassesCount();
-  std::vector<Saving> savings;
-  savings.reserve(num_cost_classes * size * saving_neighbors);
+  // When neighbors are filtered, they are read from the nearest neighbor lists
+  // shared with the local search operators; the lists are asked for enough
+  // neighbors to still contain 'saving_neighbors' candidates once the nodes
+  // already in the solution and the vehicle ends have been skipped.
+  int num_nearest = 0;
+  if (saving_neighbors < size) {
+    num_nearest = saving_neighbors + model()->vehicles();
+    for (int node = 0; node < size; ++node) {
+      if (Contains(node)) ++num_nearest;
+    }
+  }
+  // Savings are computed by ranges of nodes for each cost class, each range
+  // filling its own buffer. Arc costs from vehicle starts and nearest neighbor
+  // lists are computed beforehand as they are shared by all ranges.
+  std::vector<int64> cost_class_vehicles;
   std::vector<bool> class_covered(num_cost_classes, false);
   for (int vehicle = 0; vehicle < model()->vehicles(); ++vehicle) {
     const int64 cost_class =
         model()->GetCostClassIndexOfVehicle(vehicle).value();
     if (!class_covered[cost_class]) {
       class_covered[cost_class] = true;
-      const int64 start = model()->Start(vehicle);
-      const int64 end = model()->End(vehicle);
-      for (int before_node = 0; before_node < size; ++before_node) {
-        if (!Contains(before_node) && !model()->IsEnd(before_node) &&
-            !model()->IsStart(before_node)) {
-          const int64 in_saving =
-              model()->GetArcCostForClass(before_node, end, cost_class);
-          std::vector<std::pair</*cost*/ int64, /*node*/ int64>> costed_after_nodes;
-          costed_after_nodes.reserve(size);
-          for (int after_node = 0; after_node < size; ++after_node) {
-            if (after_node != before_node && !Contains(after_node) &&
-                !model()->IsEnd(after_node) && !model()->IsStart(after_node)) {
-              costed_after_nodes.push_back(
-                  std::make_pair(model()->GetArcCostForClass(
-                                     before_node, after_node, cost_class),
-                                 after_node));
-            }
-          }
-          if (saving_neighbors < size) {
-            std::nth_element(costed_after_nodes.begin(),
-                             costed_after_nodes.begin() + saving_neighbors,
-                             costed_after_nodes.end());
-            costed_after_nodes.resize(saving_neighbors);
-          }
-          for (const auto& after_node : costed_after_nodes) {
-            const int64 saving = in_saving +
-                                 model()->GetArcCostForClass(
-                                     start, after_node.second, cost_class) -
-                                 after_node.first;
-            savings.push_back(BuildSaving(-saving, cost_class, before_node,
-                                          after_node.second));
-          }
+      cost_class_vehicles.push_back(vehicle);
+    }
+  }
+  const int nodes_per_range = (size + num_threads_ - 1) / num_threads_;
+  const int num_ranges = (size + nodes_per_range - 1) / nodes_per_range;
+  std::vector<std::vector<int64>> start_costs(num_cost_classes);
+  std::vector<std::vector<Saving>> range_savings(cost_class_vehicles.size() *
+                                                 num_ranges);
+  std::vector<Closure*> closures;
+  for (int i = 0; i < cost_class_vehicles.size(); ++i) {
+    const int vehicle = cost_class_vehicles[i];
+    const int64 cost_class =
+        model()->GetCostClassIndexOfVehicle(vehicle).value();
+    const int64 start = model()->Start(vehicle);
+    std::vector<int64>& class_start_costs = start_costs[cost_class];
+    class_start_costs.assign(size, 0);
+    for (int node = 0; node < size; ++node) {
+      if (!Contains(node) && !model()->IsEnd(node)) {
+        class_start_costs[node] =
+            model()->GetArcCostForClass(start, node, cost_class);
+      }
+    }
+    if (num_nearest > 0) {
+      model()->GetNearestNeighbors(0, cost_class, num_nearest);
+    }
+    for (int range = 0; range < num_ranges; ++range) {
+      closures.push_back(NewCallback(
+          this, &SavingsFilteredDecisionBuilder::ComputeSavingsOfNodes,
+          vehicle, num_nearest,
+          static_cast<const std::vector<int64>*>(&class_start_costs),
+          range * nodes_per_range,
+          std::min(size, (range + 1) * nodes_per_range),
+          &range_savings[i * num_ranges + range]));
+    }
+  }
+  RunClosures(num_threads_, closures);
+  // Sort savings by value then by index. When both fit in 64 bits, savings
+  // are packed into integer keys which are radix sorted.
+  int64 num_savings = 0;
+  int64 min_value = kint64max;
+  int64 max_value = kint64min;
+  for (const std::vector<Saving>& savings : range_savings) {
+    num_savings += savings.size();
+    for (const Saving& saving : savings) {
+      min_value = std::min(min_value, GetSavingValue(saving));
+      max_value = std::max(max_value, GetSavingValue(saving));
+    }
+  }
+  std::vector<Saving> sorted_savings;
+  if (num_savings == 0) return sorted_savings;
+  const int index_bits = NumBits(num_cost_classes * size_squared_ - 1);
+  const int value_bits = NumBits(static_cast<uint64>(max_value) -
+                                 static_cast<uint64>(min_value));
+  if (index_bits + value_bits > 64) {
+    sorted_savings.reserve(num_savings);
+    for (const std::vector<Saving>& savings : range_savings) {
+      sorted_savings.insert(sorted_savings.end(), savings.begin(),
+                            savings.end());
+    }
+    std::sort(sorted_savings.begin(), sorted_savings.end());
+    return sorted_savings;
+  }
+  std::vector<uint64> keys;
+  keys.reserve(num_savings);
+  for (std::vector<Saving>& savings : range_savings) {
+    for (const Saving& saving : savings) {
+      const uint64 value = static_cast<uint64>(GetSavingValue(saving)) -
+                           static_cast<uint64>(min_value);
+      keys.push_back((value << index_bits) | saving.second);
+    }
+    std::vector<Saving>().swap(savings);
+  }
+  RadixSort(index_bits + value_bits, num_threads_, &keys);
+  sorted_savings.reserve(num_savings);
+  const uint64 index_mask = (GG_ULONGLONG(1) << index_bits) - 1;
+  for (const uint64 key : keys) {
+    sorted_savings.push_back(
+        std::make_pair(static_cast<int64>(static_cast<uint64>(min_value) +
+                                          (key >> index_bits)),
+                       static_cast<int64>(key & index_mask)));
+  }
+  return sorted_savings;
+}
+
+void SavingsFilteredDecisionBuilder::ComputeSavingsOfNodes(
+    int vehicle, int num_nearest, const std::vector<int64>* start_costs,
+    int begin, int end, std::vector<Saving>* savings) const {
+  const int size = model()->Size();
+  const int64 saving_neighbors =
+      saving_neighbors_ <= 0 ? size : saving_neighbors_;
+  const int64 cost_class = model()->GetCostClassIndexOfVehicle(vehicle).value();
+  const int64 vehicle_end = model()->End(vehicle);
+  std::vector<std::pair</*cost*/ int64, /*node*/ int64>> costed_after_nodes;
+  for (int before_node = begin; before_node < end; ++before_node) {
+    if (Contains(before_node) || model()->IsEnd(before_node) ||
+        model()->IsStart(before_node)) {
+      continue;
+    }
+    const int64 in_saving =
+        model()->GetArcCostForClass(before_node, vehicle_end, cost_class);
+    costed_after_nodes.clear();
+    if (saving_neighbors < size) {
+      for (const int after_node : model()->GetNearestNeighbors(
+               before_node, cost_class, num_nearest)) {
+        if (costed_after_nodes.size() == saving_neighbors) {
+          break;
+        }
+        if (after_node < size && !Contains(after_node) &&
+            !model()->IsEnd(after_node)) {
+          costed_after_nodes.push_back(std::make_pair(
+              model()->GetArcCostForClass(before_node, after_node, cost_class),
+              after_node));
         }
       }
+    } else {
+      for (int after_node = 0; after_node < size; ++after_node) {
+        if (after_node != before_node && !Contains(after_node) &&
+            !model()->IsEnd(after_node) && !model()->IsStart(after_node)) {
+          costed_after_nodes.push_back(std::make_pair(
+              model()->GetArcCostForClass(before_node, after_node, cost_class),
+              after_node));
+        }
+      }
+    }
+    for (const auto& after_node : costed_after_nodes) {
+      const int64 saving = in_saving + (*start_costs)[after_node.second] -
+                           after_node.first;
+      savings->push_back(
+          BuildSaving(-saving, cost_class, before_node, after_node.second));
     }
   }
-  std::sort(savings.begin(), savings.end());
-  return savings;
 }
 }  // namespace operations_research
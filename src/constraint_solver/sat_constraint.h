@@ -172,7 +172,7 @@ class SatConstraint : public Constraint {
     while (propagated_trail_index_ < trail.Index()) {
       const sat::Literal literal = trail[propagated_trail_index_];
       const sat::VariableIndex var = literal.Variable();
-      if (trail.Info(var).type != sat::AssignmentInfo::SEARCH_DECISION) {
+      if (trail.ReasonInfo(var).type != sat::AssignmentReason::SEARCH_DECISION) {
         std::pair<IntVar*, int64> p = variable_manager_.BooleanVariableMeaning(var);
         IntVar* int_var = p.first;
         const int64 value = p.second;
@@ -12,12 +12,15 @@
 // limitations under the License.
 
 
+#include <cmath>
 #include <cstring>
+#include "base/hash.h"
 #include <string>
 #include <vector>
 
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/map_util.h"
 #include "base/stringprintf.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
@@ -564,12 +567,21 @@ class SetTimesBackward : public DecisionBuilder {
 class RankFirst : public Decision {
  public:
   RankFirst(SequenceVar* const seq, int index)
-      : sequence_(seq), index_(index) {}
+      : sequence_(seq), index_(index), failures_(nullptr) {}
+  // The counter pointed to by 'failures' is incremented each time the decision
+  // is refuted, that is each time ranking the interval first has failed.
+  RankFirst(SequenceVar* const seq, int index, int64* const failures)
+      : sequence_(seq), index_(index), failures_(failures) {}
   virtual ~RankFirst() {}
 
   virtual void Apply(Solver* const s) { sequence_->RankFirst(index_); }
 
-  virtual void Refute(Solver* const s) { sequence_->RankNotFirst(index_); }
+  virtual void Refute(Solver* const s) {
+    if (failures_ != nullptr) {
+      ++*failures_;
+    }
+    sequence_->RankNotFirst(index_);
+  }
 
   void Accept(DecisionVisitor* const visitor) const {
     CHECK(visitor != nullptr);
@@ -584,6 +596,7 @@ class RankFirst : public Decision {
  private:
   SequenceVar* const sequence_;
   const int index_;
+  int64* const failures_;
 };
 
 class RankLast : public Decision {
@@ -614,7 +627,11 @@ class RankFirstIntervalVars : public DecisionBuilder {
  public:
   RankFirstIntervalVars(const std::vector<SequenceVar*>& sequences,
                         Solver::SequenceStrategy str)
-      : sequences_(sequences), strategy_(str) {}
+      : sequences_(sequences), strategy_(str), failures_(sequences.size(), 0) {
+    for (int i = 0; i < sequences_.size(); ++i) {
+      sequence_indices_[sequences_[i]] = i;
+    }
+  }
 
   virtual ~RankFirstIntervalVars() {}
 
@@ -636,7 +653,10 @@ class RankFirstIntervalVars : public DecisionBuilder {
           s->Fail();
         }
         CHECK_NE(-1, best_interval);
-        return s->RevAlloc(new RankFirst(best_sequence, best_interval));
+        return s->RevAlloc(
+            new RankFirst(best_sequence, best_interval,
+                          &failures_[FindOrDie(sequence_indices_,
+                                               best_sequence)]));
       } else {
         return nullptr;
       }
@@ -688,6 +708,7 @@ class RankFirstIntervalVars : public DecisionBuilder {
       case Solver::SEQUENCE_DEFAULT:
       case Solver::SEQUENCE_SIMPLE:
       case Solver::CHOOSE_MIN_SLACK_RANK_FORWARD:
+      case Solver::CHOOSE_MIN_WEIGHTED_SLACK_RANK_FORWARD:
         return FindIntervalVarOnStartMin(s, best_sequence, best_interval_index);
       case Solver::CHOOSE_RANDOM_RANK_FORWARD:
         return FindIntervalVarRandomly(s, best_sequence, best_interval_index);
@@ -697,10 +718,12 @@ class RankFirstIntervalVars : public DecisionBuilder {
     }
   }
 
-  // Selects the sequence var to start ranking.
-  bool FindSequenceVarOnSlack(Solver* const s,
+  // Selects the sequence var to start ranking. If 'weighted' is true, the
+  // slack of a sequence is divided by 1 + log(1 + number of failed rankings on
+  // it), to focus the search on the sequences where failures happen.
+  bool FindSequenceVarOnSlack(Solver* const s, bool weighted,
                               SequenceVar** const best_sequence) {
-    int64 best_slack = kint64max;
+    double best_slack = kint64max;
     int64 best_ahmin = kint64max;
     *best_sequence = nullptr;
     best_possible_firsts_.clear();
@@ -734,7 +757,10 @@ class RankFirstIntervalVars : public DecisionBuilder {
         candidate_sequence->DurationRange(&dmin, &dmax);
         int64 ahmin, ahmax;
         candidate_sequence->ActiveHorizonRange(&ahmin, &ahmax);
-        const int64 current_slack = (hmax - hmin - dmax);
+        double current_slack = (hmax - hmin - dmax);
+        if (weighted) {
+          current_slack /= 1.0 + log(1.0 + failures_[i]);
+        }
         if (current_slack < best_slack ||
             (current_slack == best_slack && ahmin < best_ahmin)) {
           best_slack = current_slack;
@@ -793,7 +819,9 @@ class RankFirstIntervalVars : public DecisionBuilder {
       case Solver::SEQUENCE_DEFAULT:
       case Solver::SEQUENCE_SIMPLE:
       case Solver::CHOOSE_MIN_SLACK_RANK_FORWARD:
-        return FindSequenceVarOnSlack(s, best_sequence);
+        return FindSequenceVarOnSlack(s, false, best_sequence);
+      case Solver::CHOOSE_MIN_WEIGHTED_SLACK_RANK_FORWARD:
+        return FindSequenceVarOnSlack(s, true, best_sequence);
       case Solver::CHOOSE_RANDOM_RANK_FORWARD:
         return FindSequenceVarRandomly(s, best_sequence);
       default:
@@ -803,6 +831,10 @@ class RankFirstIntervalVars : public DecisionBuilder {
 
   const std::vector<SequenceVar*> sequences_;
   const Solver::SequenceStrategy strategy_;
+  hash_map<const SequenceVar*, int> sequence_indices_;
+  // Number of failed rankings on each sequence since the creation of the
+  // decision builder. This is learned, and thus not reversible.
+  std::vector<int64> failures_;
   std::vector<int> best_possible_firsts_;
   std::vector<int> candidate_possible_firsts_;
   std::vector<int> candidate_possible_lasts_;
@@ -1042,16 +1042,27 @@ class CheapestVarSelector : public VariableSelector {
  public:
   CheapestVarSelector(const std::vector<IntVar*>& vars,
                       ResultCallback1<int64, int64>* var_eval)
-      : VariableSelector(vars), var_evaluator_(var_eval) {}
+      : VariableSelector(vars),
+        var_evaluator_(var_eval),
+        batch_evaluator_(dynamic_cast<BatchIndexEvaluator1*>(var_eval)) {}
   virtual ~CheapestVarSelector() {}
   virtual IntVar* Select(Solver* const s, int64* id);
   virtual std::string DebugString() const { return "CheapestVarSelector"; }
 
  private:
+  IntVar* SelectWithBatch(int64* id);
+
   std::unique_ptr<ResultCallback1<int64, int64> > var_evaluator_;
+  // Same object as var_evaluator_ if it supports batch evaluation.
+  BatchIndexEvaluator1* const batch_evaluator_;
+  std::vector<int64> indices_;
+  std::vector<int64> evaluations_;
 };
 
 IntVar* CheapestVarSelector::Select(Solver* const s, int64* id) {
+  if (batch_evaluator_ != nullptr) {
+    return SelectWithBatch(id);
+  }
   IntVar* result = nullptr;
   int64 best_eval = kint64max;
   int index = -1;
@@ -1075,6 +1086,33 @@ IntVar* CheapestVarSelector::Select(Solver* const s, int64* id) {
   }
 }
 
+IntVar* CheapestVarSelector::SelectWithBatch(int64* id) {
+  indices_.clear();
+  for (int i = 0; i < vars_.size(); ++i) {
+    if (!vars_[i]->Bound()) {
+      indices_.push_back(i);
+    }
+  }
+  evaluations_.resize(indices_.size());
+  batch_evaluator_->RunBatch(indices_.data(), indices_.size(),
+                             evaluations_.data());
+  int64 best_eval = kint64max;
+  int best = -1;
+  for (int i = 0; i < indices_.size(); ++i) {
+    if (evaluations_[i] < best_eval) {
+      best_eval = evaluations_[i];
+      best = i;
+    }
+  }
+  if (best == -1) {
+    *id = vars_.size();
+    return nullptr;
+  } else {
+    *id = indices_[best];
+    return vars_[indices_[best]];
+  }
+}
+
 // ----- Path selector -----
 // Follow path, where var[i] is represents the next of i
 
@@ -1306,29 +1344,55 @@ class CheapestValueSelector : public ValueSelector {
  public:
   CheapestValueSelector(ResultCallback2<int64, int64, int64>* eval,
                         ResultCallback1<int64, int64>* tie_breaker)
-      : eval_(eval), tie_breaker_(tie_breaker) {}
+      : eval_(eval),
+        batch_eval_(dynamic_cast<BatchIndexEvaluator2*>(eval)),
+        tie_breaker_(tie_breaker) {}
   virtual ~CheapestValueSelector() {}
   virtual int64 Select(const IntVar* const v, int64 id);
   std::string DebugString() const { return "CheapestValue"; }
 
  private:
   std::unique_ptr<ResultCallback2<int64, int64, int64> > eval_;
+  // Same object as eval_ if it supports batch evaluation.
+  BatchIndexEvaluator2* const batch_eval_;
   std::unique_ptr<ResultCallback1<int64, int64> > tie_breaker_;
   std::vector<int64> cache_;
+  std::vector<int64> values_;
+  std::vector<int64> evaluations_;
 };
 
 int64 CheapestValueSelector::Select(const IntVar* const v, int64 id) {
   cache_.clear();
   int64 best = kint64max;
   std::unique_ptr<IntVarIterator> it(v->MakeDomainIterator(false));
-  for (const int64 i : InitAndGetValues(it.get())) {
-    int64 eval = eval_->Run(id, i);
-    if (eval < best) {
-      best = eval;
-      cache_.clear();
-      cache_.push_back(i);
-    } else if (eval == best) {
-      cache_.push_back(i);
+  if (batch_eval_ != nullptr) {
+    values_.clear();
+    for (const int64 i : InitAndGetValues(it.get())) {
+      values_.push_back(i);
+    }
+    evaluations_.resize(values_.size());
+    batch_eval_->RunBatch(id, values_.data(), values_.size(),
+                          evaluations_.data());
+    for (int i = 0; i < values_.size(); ++i) {
+      const int64 eval = evaluations_[i];
+      if (eval < best) {
+        best = eval;
+        cache_.clear();
+        cache_.push_back(values_[i]);
+      } else if (eval == best) {
+        cache_.push_back(values_[i]);
+      }
+    }
+  } else {
+    for (const int64 i : InitAndGetValues(it.get())) {
+      int64 eval = eval_->Run(id, i);
+      if (eval < best) {
+        best = eval;
+        cache_.clear();
+        cache_.push_back(i);
+      } else if (eval == best) {
+        cache_.push_back(i);
+      }
     }
   }
   DCHECK_GT(cache_.size(), 0);
@@ -3104,6 +3168,52 @@ class GuidedLocalSearchPenalties {
   virtual void Reset() = 0;
 };
 
+// Maximum number of cells of the matrix used by
+// GuidedLocalSearchPenaltiesMatrix.
+const int64 kMaxGuidedLocalSearchMatrixSize = 1 << 22;
+
+// Dense GLS penalties implementation using a flat matrix to store penalties,
+// indexed by variable and value; used when all values are non-negative and
+// the matrix is small enough. Penalized cells are recorded so that resetting
+// penalties does not require a full pass on the matrix.
+class GuidedLocalSearchPenaltiesMatrix : public GuidedLocalSearchPenalties {
+ public:
+  GuidedLocalSearchPenaltiesMatrix(int size, int64 num_values);
+  virtual ~GuidedLocalSearchPenaltiesMatrix() {}
+  virtual bool HasValues() const { return !penalized_cells_.empty(); }
+  virtual void Increment(const Arc& arc);
+  virtual int64 Value(const Arc& arc) const {
+    const uint64 second = arc.second;
+    return second < num_values_ ? penalties_[arc.first * num_values_ + second]
+                                : 0LL;
+  }
+  virtual void Reset();
+
+ private:
+  const uint64 num_values_;
+  std::vector<int64> penalties_;
+  std::vector<int64> penalized_cells_;
+};
+
+GuidedLocalSearchPenaltiesMatrix::GuidedLocalSearchPenaltiesMatrix(
+    int size, int64 num_values)
+    : num_values_(num_values), penalties_(size * num_values, 0LL) {}
+
+void GuidedLocalSearchPenaltiesMatrix::Increment(const Arc& arc) {
+  DCHECK_LT(arc.second, num_values_);
+  const int64 cell = arc.first * num_values_ + arc.second;
+  if (penalties_[cell]++ == 0) {
+    penalized_cells_.push_back(cell);
+  }
+}
+
+void GuidedLocalSearchPenaltiesMatrix::Reset() {
+  for (const int64 cell : penalized_cells_) {
+    penalties_[cell] = 0;
+  }
+  penalized_cells_.clear();
+}
+
 // Dense GLS penalties implementation using a matrix to store penalties.
 class GuidedLocalSearchPenaltiesTable : public GuidedLocalSearchPenalties {
  public:
@@ -3225,7 +3335,9 @@ class GuidedLocalSearch : public Metaheuristic {
   int64 assignment_penalized_value_;
   int64 old_penalized_value_;
   const std::vector<IntVar*> vars_;
-  hash_map<const IntVar*, int64> indices_;
+  // Indices of variables in vars_, indexed by IntVar::index(); -1 for
+  // variables which are not in vars_.
+  std::vector<int> indices_;
   const double penalty_factor_;
   std::unique_ptr<GuidedLocalSearchPenalties> penalties_;
   std::unique_ptr<int64[]> current_penalized_values_;
@@ -3253,11 +3365,24 @@ GuidedLocalSearch::GuidedLocalSearch(Solver* const s, IntVar* objective,
     memset(current_penalized_values_.get(), 0,
            vars_.size() * sizeof(*current_penalized_values_.get()));
   }
+  int64 min_value = 0;
+  int64 max_value = -1;
   for (int i = 0; i < vars_.size(); ++i) {
-    indices_[vars_[i]] = i;
+    const int var_index = vars_[i]->index();
+    if (var_index >= indices_.size()) {
+      indices_.resize(var_index + 1, -1);
+    }
+    indices_[var_index] = i;
+    min_value = std::min(min_value, vars_[i]->Min());
+    max_value = std::max(max_value, vars_[i]->Max());
   }
   if (FLAGS_cp_use_sparse_gls_penalties) {
     penalties_.reset(new GuidedLocalSearchPenaltiesMap(vars_.size()));
+  } else if (min_value >= 0 &&
+             max_value < kMaxGuidedLocalSearchMatrixSize /
+                             std::max<int64>(1, vars_.size())) {
+    penalties_.reset(
+        new GuidedLocalSearchPenaltiesMatrix(vars_.size(), max_value + 1));
   } else {
     penalties_.reset(new GuidedLocalSearchPenaltiesTable(vars_.size()));
   }
@@ -3386,9 +3511,9 @@ int64 GuidedLocalSearch::Evaluate(const Assignment* delta,
   const int size = container.Size();
   for (int i = 0; i < size; ++i) {
     const IntVarElement& new_element = container.Element(i);
-    IntVar* var = new_element.Var();
-    int64 index = -1;
-    if (FindCopy(indices_, var, &index)) {
+    const int var_index = new_element.Var()->index();
+    const int64 index = var_index < indices_.size() ? indices_[var_index] : -1;
+    if (index >= 0) {
       penalty -= out_values[index];
       int64 new_penalty = 0;
       if (EvaluateElementValue(container, index, &i, &new_penalty)) {
@@ -15,6 +15,9 @@
 // This file implements the table constraints.
 
 #include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
 #include "base/hash.h"
 #include "base/unique_ptr.h"
 #include <string>
@@ -26,6 +29,8 @@
 #include "base/stringprintf.h"
 #include "base/join.h"
 #include "base/map_util.h"
+#include "base/mutex.h"
+#include "base/fingerprint2011.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "util/bitset.h"
@@ -42,6 +47,10 @@ DEFINE_int32(cp_ac4r_table_threshold, 2048,
              "Above this size, allowed assignment constraints will use the "
              "revised AC-4 implementation of the table constraint.");
 DEFINE_bool(cp_use_mdd_table, false, "Use mdd table");
+DEFINE_bool(cp_use_regular_propagator, true,
+            "Propagate transition constraints directly on the layered graph "
+            "of the automaton instead of decomposing them into table "
+            "constraints over hidden state variables.");
 
 namespace operations_research {
 // External table code.
@@ -443,8 +452,8 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
         demon_(nullptr),
         touched_var_(-1),
         var_sizes_(arity_, 0),
-        first_active_(0),
-        last_active_(-1) {}
+        active_words_(nullptr),
+        num_active_words_(0) {}
 
   virtual ~CompactPositiveTableConstraint() {}
 
@@ -473,7 +482,9 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
   // ----- Propagation -----
 
   void Propagate() {
-    UpdateFirstAndLast();
+    if (num_active_words_.Value() == 0) {
+      solver()->Fail();
+    }
     // Reset touch_var_ if in mode (more than 1 variable was modified).
     if (touched_var_ == -2) {
       touched_var_ = -1;
@@ -583,7 +594,6 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
     if (vars_[var_index]->Size() == var_sizes_.Value(var_index)) {
       return;
     }
-    UpdateFirstAndLast();
     // This method will update the set of active tuples by masking out all
     // tuples attached to values of the variables that have been removed.
 
@@ -652,21 +662,16 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
     }
     // And check active_tuples_ is still not empty, we fail otherwise.
     if (changed) {
-      const int first = first_active_.Value();
-      const int last = last_active_.Value();
-      for (int offset = first; offset <= last; ++offset) {
-        if (active_tuples_[offset]) {
-          // We push the propagate method only if something has changed.
-          if (touched_var_ == -1 || touched_var_ == var_index) {
-            touched_var_ = var_index;
-          } else {
-            touched_var_ = -2;  // more than one var.
-          }
-          EnqueueDelayedDemon(demon_);
-          return;
-        }
+      if (num_active_words_.Value() == 0) {
+        solver()->Fail();
       }
-      solver()->Fail();
+      // We push the propagate method only if something has changed.
+      if (touched_var_ == -1 || touched_var_ == var_index) {
+        touched_var_ = var_index;
+      } else {
+        touched_var_ = -2;  // more than one var.
+      }
+      EnqueueDelayedDemon(demon_);
     }
   }
 
@@ -718,11 +723,14 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
   void FillMasks() {
     active_tuples_.reset(new uint64[length_]);
     stamps_.reset(new uint64[length_]);
+    active_words_.reset(new int[length_]);
     for (int i = 0; i < length_; ++i) {
       stamps_[i] = 0;
       active_tuples_[i] = 0;
+      active_words_[i] = i;
     }
-    last_active_.SetValue(solver(), length_ - 1);
+    // All the words contain at least one valid tuple.
+    num_active_words_.SetValue(solver(), length_);
 
     for (int valid_index = 0; valid_index < valid_tuples_.size();
          ++valid_index) {
@@ -791,51 +799,60 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
     }
   }
 
-  void UpdateFirstAndLast() {
-    int first = first_active_.Value();
-    int last = last_active_.Value();
-    while (first <= last && active_tuples_[first] == 0) {
-      first++;
-    }
-    Solver* const s = solver();
-    if (first > last) {  // If we fail, this will be detected by now.
-      s->Fail();
-    }
-    while (last > first && active_tuples_[last] == 0) {
-      last--;
-    }
-    first_active_.SetValue(s, first);
-    last_active_.SetValue(s, last);
-  }
-
   // Helpers during propagation.
 
+  // Removes the word at the given position of active_words_ from the first
+  // *num_words ones. This is only called when the word becomes zero, and as
+  // the active tuples only decrease in a branch of the search tree, the word
+  // stays zero until we backtrack. Restoring num_active_words_ is then enough
+  // to restore the set of active words.
+  void DeactivateWord(int position, int* num_words) {
+    --(*num_words);
+    std::swap(active_words_[position], active_words_[*num_words]);
+  }
+
   bool AndTempMaskWithActive() {
-    const int first = first_active_.Value();
-    const int last = last_active_.Value();
+    int num_words = num_active_words_.Value();
     bool changed = false;
-    for (int offset = first; offset <= last; ++offset) {
+    for (int i = 0; i < num_words;) {
+      const int offset = active_words_[i];
       if ((~temp_mask_[offset] & active_tuples_[offset]) != 0) {
         AndActiveTuples(offset, temp_mask_[offset]);
         changed = true;
+        if (active_tuples_[offset] == 0) {
+          DeactivateWord(i, &num_words);
+          continue;
+        }
       }
+      ++i;
     }
+    num_active_words_.SetValue(solver(), num_words);
     return changed;
   }
 
   bool SubstractTempMaskFromActive() {
-    const int first = first_active_.Value();
-    const int last = last_active_.Value();
+    int num_words = num_active_words_.Value();
     bool changed = false;
-    for (int offset = first; offset <= last; ++offset) {
+    for (int i = 0; i < num_words;) {
+      const int offset = active_words_[i];
       if ((temp_mask_[offset] & active_tuples_[offset]) != 0) {
         AndActiveTuples(offset, ~temp_mask_[offset]);
         changed = true;
+        if (active_tuples_[offset] == 0) {
+          DeactivateWord(i, &num_words);
+          continue;
+        }
       }
+      ++i;
     }
+    num_active_words_.SetValue(solver(), num_words);
     return changed;
   }
 
+  // The residue supports_[var_index][value_index] is the last word where a
+  // support was found. It is checked first, then the words where the mask
+  // can be non zero are scanned, either through the range of the mask or
+  // through the active words, whichever is shorter.
   bool Supported(int var_index, int64 value_index) {
     DCHECK_GE(var_index, 0);
     DCHECK_LT(var_index, arity_);
@@ -846,44 +863,62 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
     if ((mask[support] & active_tuples_[support]) != 0) {
       return true;
     }
-    const int loop_start =
-        std::max(first_active_.Value(), starts_[var_index][value_index]);
-    const int loop_end =
-        std::min(last_active_.Value(), ends_[var_index][value_index]);
-    for (int offset = support + 1; offset <= loop_end; ++offset) {
-      if ((mask[offset] & active_tuples_[offset]) != 0) {
-        supports_[var_index][value_index] = offset;
-        return true;
+    const int start = starts_[var_index][value_index];
+    const int end = ends_[var_index][value_index];
+    const int num_words = num_active_words_.Value();
+    if (end - start < num_words) {
+      for (int offset = start; offset <= end; ++offset) {
+        if ((mask[offset] & active_tuples_[offset]) != 0) {
+          supports_[var_index][value_index] = offset;
+          return true;
+        }
       }
-    }
-    for (int offset = loop_start; offset < support; ++offset) {
-      if ((mask[offset] & active_tuples_[offset]) != 0) {
-        supports_[var_index][value_index] = offset;
-        return true;
+    } else {
+      for (int i = 0; i < num_words; ++i) {
+        const int offset = active_words_[i];
+        if ((mask[offset] & active_tuples_[offset]) != 0) {
+          supports_[var_index][value_index] = offset;
+          return true;
+        }
       }
     }
     return false;
   }
 
+  // Only the active words of temp_mask_ are used, so only those are updated.
   void OrTempMask(int var_index, int64 value_index) {
     const uint64* const mask = masks_[var_index][value_index];
     if (mask) {
-      const int start =
-          std::max(first_active_.Value(), starts_[var_index][value_index]);
-      const int end = std::min(ends_[var_index][value_index], last_active_.Value());
-      for (int offset = start; offset <= end; ++offset) {
-        temp_mask_[offset] |= mask[offset];
+      const int start = starts_[var_index][value_index];
+      const int end = ends_[var_index][value_index];
+      const int num_words = num_active_words_.Value();
+      if (end - start < num_words) {
+        for (int offset = start; offset <= end; ++offset) {
+          temp_mask_[offset] |= mask[offset];
+        }
+      } else {
+        for (int i = 0; i < num_words; ++i) {
+          const int offset = active_words_[i];
+          temp_mask_[offset] |= mask[offset];
+        }
       }
     }
   }
 
   void SetTempMask(int var_index, int64 value_index) {
-    memcpy(temp_mask_.get(), masks_[var_index][value_index],
-           length_ * sizeof(*temp_mask_.get()));
+    const uint64* const mask = masks_[var_index][value_index];
+    const int num_words = num_active_words_.Value();
+    for (int i = 0; i < num_words; ++i) {
+      const int offset = active_words_[i];
+      temp_mask_[offset] = mask[offset];
+    }
   }
 
   void ClearTempMask() {
-    memset(temp_mask_.get(), 0, length_ * sizeof(*temp_mask_.get()));
+    const int num_words = num_active_words_.Value();
+    for (int i = 0; i < num_words; ++i) {
+      temp_mask_[active_words_[i]] = 0;
+    }
   }
 
   void AndActiveTuples(int offset, uint64 mask) {
@@ -916,8 +951,10 @@ class CompactPositiveTableConstraint : public BasePositiveTableConstraint {
   Demon* demon_;
   int touched_var_;
   RevArray<int64> var_sizes_;
-  Rev<int> first_active_;
-  Rev<int> last_active_;
+  // The indices of the non zero words of active_tuples_ are the first
+  // num_active_words_ elements of active_words_.
+  std::unique_ptr<int[]> active_words_;
+  Rev<int> num_active_words_;
   std::vector<int> valid_tuples_;
 };
 
@@ -1297,19 +1334,6 @@ class TransitionConstraint : public Constraint {
         initial_state_(initial_state),
         final_states_(final_states) {}
 
-  TransitionConstraint(Solver* const s, const std::vector<IntVar*>& vars,
-                       const IntTupleSet& transition_table, int64 initial_state,
-                       const std::vector<int>& final_states)
-      : Constraint(s),
-        vars_(vars),
-        transition_table_(transition_table),
-        initial_state_(initial_state),
-        final_states_(final_states.size()) {
-    for (int i = 0; i < final_states.size(); ++i) {
-      final_states_[i] = final_states[i];
-    }
-  }
-
   virtual ~TransitionConstraint() {}
 
   virtual void Post() {
@@ -1396,6 +1420,382 @@ class TransitionConstraint : public Constraint {
 const int TransitionConstraint::kStatePosition = 0;
 const int TransitionConstraint::kNextStatePosition = 2;
 const int TransitionConstraint::kTransitionTupleSize = 3;
+
+// ---------- Regular constraint on a layered graph ----------
+
+// Immutable, compact form of the automaton described by a transition table:
+// states and values are renumbered densely, and the transitions are stored in
+// flat arrays, sorted by value, with the lists of transitions entering and
+// leaving each state. Compiled automata are shared by all the constraints,
+// in all the solvers, built on equal transition tables.
+class CompiledAutomaton {
+ public:
+  explicit CompiledAutomaton(const IntTupleSet& transitions)
+      : transitions_(transitions) {
+    const int num_transitions = transitions.NumTuples();
+    for (int t = 0; t < num_transitions; ++t) {
+      states_.push_back(transitions.Value(t, 0));
+      states_.push_back(transitions.Value(t, 2));
+      values_.push_back(transitions.Value(t, 1));
+    }
+    std::sort(states_.begin(), states_.end());
+    states_.erase(std::unique(states_.begin(), states_.end()), states_.end());
+    std::sort(values_.begin(), values_.end());
+    values_.erase(std::unique(values_.begin(), values_.end()), values_.end());
+
+    // Sort the transitions by value index, with a counting sort.
+    value_start_.assign(values_.size() + 1, 0);
+    for (int t = 0; t < num_transitions; ++t) {
+      ++value_start_[ValueIndex(transitions.Value(t, 1)) + 1];
+    }
+    for (int k = 0; k < values_.size(); ++k) {
+      value_start_[k + 1] += value_start_[k];
+    }
+    std::vector<int> next = value_start_;
+    tail_.resize(num_transitions);
+    head_.resize(num_transitions);
+    value_index_.resize(num_transitions);
+    for (int t = 0; t < num_transitions; ++t) {
+      const int k = ValueIndex(transitions.Value(t, 1));
+      const int sorted = next[k]++;
+      tail_[sorted] = StateIndex(transitions.Value(t, 0));
+      head_[sorted] = StateIndex(transitions.Value(t, 2));
+      value_index_[sorted] = k;
+    }
+    outgoing_.resize(states_.size());
+    incoming_.resize(states_.size());
+    for (int t = 0; t < num_transitions; ++t) {
+      outgoing_[tail_[t]].push_back(t);
+      incoming_[head_[t]].push_back(t);
+    }
+  }
+
+  // Returns the compiled automaton of 'transitions', compiling it only if no
+  // automaton built on an equal transition table is still in use.
+  static std::shared_ptr<const CompiledAutomaton> Get(
+      const IntTupleSet& transitions) {
+    const int64* const data = transitions.RawData();
+    const uint64 fprint = Fingerprint2011(
+        reinterpret_cast<const char*>(data),
+        static_cast<size_t>(transitions.NumTuples()) * transitions.Arity() *
+            sizeof(*data));
+    static Mutex registry_mutex;
+    static std::multimap<uint64, std::weak_ptr<const CompiledAutomaton>>* const
+        registry =
+            new std::multimap<uint64, std::weak_ptr<const CompiledAutomaton>>;
+    MutexLock lock(&registry_mutex);
+    auto it = registry->lower_bound(fprint);
+    while (it != registry->end() && it->first == fprint) {
+      std::shared_ptr<const CompiledAutomaton> registered = it->second.lock();
+      if (registered == nullptr) {
+        it = registry->erase(it);
+      } else if (registered->CompiledFrom(transitions)) {
+        return registered;
+      } else {
+        ++it;
+      }
+    }
+    std::shared_ptr<const CompiledAutomaton> compiled(
+        new CompiledAutomaton(transitions));
+    registry->insert(std::make_pair(fprint, compiled));
+    return compiled;
+  }
+
+  int NumStates() const { return states_.size(); }
+  int NumValues() const { return values_.size(); }
+  int NumTransitions() const { return tail_.size(); }
+
+  // Returns the index of the given state or value, or -1 if it does not
+  // appear in the transitions.
+  int StateIndex(int64 state) const { return IndexOf(states_, state); }
+  int ValueIndex(int64 value) const { return IndexOf(values_, value); }
+  int64 Value(int value_index) const { return values_[value_index]; }
+
+  int Tail(int t) const { return tail_[t]; }
+  int Head(int t) const { return head_[t]; }
+  int TransitionValueIndex(int t) const { return value_index_[t]; }
+
+  // The transitions labeled with the given value index are the ones in
+  // [ValueStart(k), ValueStart(k + 1)).
+  int ValueStart(int value_index) const { return value_start_[value_index]; }
+  const std::vector<int>& Outgoing(int state) const { return outgoing_[state]; }
+  const std::vector<int>& Incoming(int state) const { return incoming_[state]; }
+
+ private:
+  static int IndexOf(const std::vector<int64>& sorted, int64 x) {
+    const auto it = std::lower_bound(sorted.begin(), sorted.end(), x);
+    return it != sorted.end() && *it == x ? it - sorted.begin() : -1;
+  }
+
+  bool CompiledFrom(const IntTupleSet& transitions) const {
+    if (transitions.Arity() != transitions_.Arity() ||
+        transitions.NumTuples() != transitions_.NumTuples()) {
+      return false;
+    }
+    return transitions.RawData() == transitions_.RawData() ||
+           memcmp(transitions.RawData(), transitions_.RawData(),
+                  static_cast<size_t>(transitions.NumTuples()) *
+                      transitions.Arity() * sizeof(int64)) == 0;
+  }
+
+  // Shares the data of the source tuple set, to check equality.
+  const IntTupleSet transitions_;
+  std::vector<int64> states_;
+  std::vector<int64> values_;
+  std::vector<int> value_start_;
+  std::vector<int> tail_;
+  std::vector<int> head_;
+  std::vector<int> value_index_;
+  std::vector<std::vector<int>> outgoing_;
+  std::vector<std::vector<int>> incoming_;
+};
+
+// Same semantics as the TransitionConstraint above, but propagated directly on
+// the layered graph of the automaton unrolled over the variables, as described
+// in: Gilles Pesant, "A Regular Language Membership Constraint for Finite
+// Sequences of Variables", CP 2004.
+//
+// Layer i contains the states the automaton can be in before reading vars_[i],
+// and an edge (i, t) is a copy of transition t between layers i and i + 1.
+// An edge is alive while its value is in the domain of vars_[i] and both its
+// ends are alive; a node is alive while it has an alive edge on both sides
+// (the initial and final states aside). The constraint maintains
+// incrementally the number of alive edges of each node and of each
+// (variable, value) pair: a value is removed when its count reaches zero, and
+// a node dies when one of its counts does, which in turn kills its other
+// edges. This achieves domain consistency without any hidden variables.
+class RegularConstraint : public Constraint {
+ public:
+  RegularConstraint(Solver* const s, const std::vector<IntVar*>& vars,
+                    const IntTupleSet& transition_table, int64 initial_state,
+                    const std::vector<int64>& final_states)
+      : Constraint(s),
+        vars_(vars),
+        transition_table_(transition_table),
+        initial_state_(initial_state),
+        final_states_(final_states),
+        automaton_(CompiledAutomaton::Get(transition_table)),
+        num_layers_(vars.size()),
+        num_states_(automaton_->NumStates()),
+        num_values_(automaton_->NumValues()),
+        num_transitions_(automaton_->NumTransitions()),
+        alive_edges_(static_cast<int64>(num_layers_) * num_transitions_),
+        out_degree_(num_layers_ * num_states_, 0),
+        in_degree_(num_layers_ * num_states_, 0),
+        supports_(num_layers_ * num_values_, 0),
+        holes_(num_layers_) {
+    for (int i = 0; i < num_layers_; ++i) {
+      holes_[i] = vars_[i]->MakeHoleIterator(true);
+    }
+  }
+
+  virtual ~RegularConstraint() {}
+
+  virtual void Post() {
+    for (int i = 0; i < num_layers_; ++i) {
+      Demon* const d = MakeConstraintDemon1(
+          solver(), this, &RegularConstraint::Update, "Update", i);
+      vars_[i]->WhenDomain(d);
+    }
+  }
+
+  virtual void InitialPropagate() {
+    const int initial = automaton_->StateIndex(initial_state_);
+    std::vector<bool> final_state(num_states_, false);
+    bool initial_is_final = false;
+    for (const int64 state : final_states_) {
+      const int index = automaton_->StateIndex(state);
+      if (index >= 0) final_state[index] = true;
+      initial_is_final |= state == initial_state_;
+    }
+    if (num_layers_ == 0) {
+      if (!initial_is_final) solver()->Fail();
+      return;
+    }
+    if (initial < 0) solver()->Fail();
+
+    // Forward pass: reachable[i * num_states_ + s] is true if state s can be
+    // reached before reading vars_[i]; the last layer is only filled with the
+    // final states.
+    std::vector<bool> reachable((num_layers_ + 1) * num_states_, false);
+    reachable[initial] = true;
+    for (int i = 0; i < num_layers_; ++i) {
+      for (int t = 0; t < num_transitions_; ++t) {
+        if (reachable[i * num_states_ + automaton_->Tail(t)] &&
+            vars_[i]->Contains(automaton_->Value(
+                automaton_->TransitionValueIndex(t)))) {
+          reachable[(i + 1) * num_states_ + automaton_->Head(t)] = true;
+        }
+      }
+    }
+    for (int s = 0; s < num_states_; ++s) {
+      if (!final_state[s]) reachable[num_layers_ * num_states_ + s] = false;
+    }
+
+    // Backward pass: the alive edges are the reachable ones that lead to a
+    // node from which a final state can be reached.
+    Solver* const s = solver();
+    for (int i = num_layers_ - 1; i >= 0; --i) {
+      for (int t = 0; t < num_transitions_; ++t) {
+        const int tail = i * num_states_ + automaton_->Tail(t);
+        const int head = (i + 1) * num_states_ + automaton_->Head(t);
+        const int k = automaton_->TransitionValueIndex(t);
+        if (!reachable[tail] || !reachable[head] ||
+            !vars_[i]->Contains(automaton_->Value(k))) {
+          continue;
+        }
+        alive_edges_.SetToOne(s, static_cast<int64>(i) * num_transitions_ + t);
+        out_degree_.Incr(s, tail);
+        in_degree_.Incr(s, head - num_states_);
+        supports_.Incr(s, i * num_values_ + k);
+      }
+      for (int state = 0; state < num_states_; ++state) {
+        if (out_degree_[i * num_states_ + state] == 0) {
+          reachable[i * num_states_ + state] = false;
+        }
+      }
+    }
+
+    // Remove the unsupported values.
+    for (int i = 0; i < num_layers_; ++i) {
+      IntVar* const var = vars_[i];
+      to_remove_.clear();
+      std::unique_ptr<IntVarIterator> it(var->MakeDomainIterator(false));
+      for (const int64 value : InitAndGetValues(it.get())) {
+        const int k = automaton_->ValueIndex(value);
+        if (k < 0 || supports_[i * num_values_ + k] == 0) {
+          to_remove_.push_back(value);
+        }
+      }
+      var->RemoveValues(to_remove_);
+    }
+  }
+
+  // Kills the edges of the values removed from vars_[layer].
+  void Update(int layer) {
+    IntVar* const var = vars_[layer];
+    removed_.clear();
+    const int64 old_max = var->OldMax();
+    const int64 vmin = var->Min();
+    const int64 vmax = var->Max();
+    for (int64 value = var->OldMin(); value < vmin; ++value) {
+      AddRemovedValue(layer, value);
+    }
+    for (const int64 value : InitAndGetValues(holes_[layer])) {
+      AddRemovedValue(layer, value);
+    }
+    for (int64 value = vmax + 1; value <= old_max; ++value) {
+      AddRemovedValue(layer, value);
+    }
+    to_kill_.clear();
+    for (const int k : removed_) {
+      const int64 offset = static_cast<int64>(layer) * num_transitions_;
+      for (int t = automaton_->ValueStart(k); t < automaton_->ValueStart(k + 1);
+           ++t) {
+        if (alive_edges_.IsSet(offset + t)) to_kill_.push_back(offset + t);
+      }
+    }
+    KillEdges();
+  }
+
+  virtual void Accept(ModelVisitor* const visitor) const {
+    visitor->BeginVisitConstraint(ModelVisitor::kTransition, this);
+    visitor->VisitIntegerVariableArrayArgument(ModelVisitor::kVarsArgument,
+                                               vars_);
+    visitor->VisitIntegerArgument(ModelVisitor::kInitialState, initial_state_);
+    visitor->VisitIntegerArrayArgument(ModelVisitor::kFinalStatesArgument,
+                                       final_states_);
+    visitor->VisitIntegerMatrixArgument(ModelVisitor::kTuplesArgument,
+                                        transition_table_);
+    visitor->EndVisitConstraint(ModelVisitor::kTransition, this);
+  }
+
+  virtual std::string DebugString() const {
+    return StringPrintf(
+        "RegularConstraint([%s], %d transitions, initial = %" GG_LL_FORMAT
+        "d, final = [%s])",
+        JoinDebugStringPtr(vars_, ", ").c_str(), transition_table_.NumTuples(),
+        initial_state_, strings::Join(final_states_, ", ").c_str());
+  }
+
+ private:
+  void AddRemovedValue(int layer, int64 value) {
+    const int k = automaton_->ValueIndex(value);
+    if (k >= 0 && supports_[layer * num_values_ + k] > 0) removed_.push_back(k);
+  }
+
+  // Kills all the edges in to_kill_, and all the edges that become useless as
+  // a consequence, then removes the values that lost their last edge. We use
+  // an explicit stack as the deaths can cascade through all the layers.
+  void KillEdges() {
+    Solver* const s = solver();
+    while (!to_kill_.empty()) {
+      const int64 edge = to_kill_.back();
+      to_kill_.pop_back();
+      if (!alive_edges_.IsSet(edge)) continue;
+      alive_edges_.SetToZero(s, edge);
+      const int layer = edge / num_transitions_;
+      const int t = edge % num_transitions_;
+      const int tail = layer * num_states_ + automaton_->Tail(t);
+      const int head = layer * num_states_ + automaton_->Head(t);
+      const int k = automaton_->TransitionValueIndex(t);
+      const int support = layer * num_values_ + k;
+
+      supports_.Decr(s, support);
+      if (supports_[support] == 0) {
+        vars_[layer]->RemoveValue(automaton_->Value(k));
+      }
+      out_degree_.Decr(s, tail);
+      if (out_degree_[tail] == 0 && layer > 0) {
+        // The tail node is dead: kill the edges entering it.
+        const int64 offset = static_cast<int64>(layer - 1) * num_transitions_;
+        for (const int other : automaton_->Incoming(automaton_->Tail(t))) {
+          if (alive_edges_.IsSet(offset + other)) {
+            to_kill_.push_back(offset + other);
+          }
+        }
+      }
+      in_degree_.Decr(s, head);
+      if (in_degree_[head] == 0 && layer + 1 < num_layers_) {
+        // The head node is dead: kill the edges leaving it.
+        const int64 offset = static_cast<int64>(layer + 1) * num_transitions_;
+        for (const int other : automaton_->Outgoing(automaton_->Head(t))) {
+          if (alive_edges_.IsSet(offset + other)) {
+            to_kill_.push_back(offset + other);
+          }
+        }
+      }
+    }
+  }
+
+  // Variable representing transitions between states. See header file.
+  const std::vector<IntVar*> vars_;
+  // The transition as tuples (state, value, next_state).
+  const IntTupleSet transition_table_;
+  // The initial state before the first transition.
+  const int64 initial_state_;
+  // Vector of final state after the last transision.
+  const std::vector<int64> final_states_;
+  const std::shared_ptr<const CompiledAutomaton> automaton_;
+  const int num_layers_;
+  const int num_states_;
+  const int num_values_;
+  const int num_transitions_;
+  // Edge (i, t) is at position i * num_transitions_ + t.
+  RevBitSet alive_edges_;
+  // Number of alive edges leaving the node of state s in layer i, at position
+  // i * num_states_ + s, and entering the node of state s in layer i + 1, at
+  // the same position.
+  NumericalRevArray<int> out_degree_;
+  NumericalRevArray<int> in_degree_;
+  // Number of alive edges of each value index k of vars_[i], at position
+  // i * num_values_ + k.
+  NumericalRevArray<int> supports_;
+  std::vector<IntVarIterator*> holes_;
+  std::vector<int64> to_remove_;
+  std::vector<int> removed_;
+  std::vector<int64> to_kill_;
+};
 }  // namespace
 
 // --------- API ----------
@@ -1427,6 +1827,10 @@ Constraint* Solver::MakeAllowedAssignments(const std::vector<IntVar*>& vars,
 Constraint* Solver::MakeTransitionConstraint(
     const std::vector<IntVar*>& vars, const IntTupleSet& transition_table,
     int64 initial_state, const std::vector<int64>& final_states) {
+  if (FLAGS_cp_use_regular_propagator) {
+    return RevAlloc(new RegularConstraint(this, vars, transition_table,
+                                          initial_state, final_states));
+  }
   return RevAlloc(new TransitionConstraint(this, vars, transition_table,
                                            initial_state, final_states));
 }
@@ -1434,8 +1838,9 @@ Constraint* Solver::MakeTransitionConstraint(
 Constraint* Solver::MakeTransitionConstraint(
     const std::vector<IntVar*>& vars, const IntTupleSet& transition_table,
     int64 initial_state, const std::vector<int>& final_states) {
-  return RevAlloc(new TransitionConstraint(this, vars, transition_table,
-                                           initial_state, final_states));
+  return MakeTransitionConstraint(
+      vars, transition_table, initial_state,
+      std::vector<int64>(final_states.begin(), final_states.end()));
 }
 
 }  // namespace operations_research
@@ -18,21 +18,27 @@
 #include <signal.h>
 #endif  // __GNUC__
 
+#include <algorithm>
 #include <iostream>  // NOLINT
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "base/commandlineflags.h"
+#include "base/file.h"
 #include "base/stringprintf.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/threadpool.h"
 #include "base/timer.h"
 #include "flatzinc/model.h"
+#include "flatzinc/parallel_parameters.pb.h"
 #include "flatzinc/parser.h"
 #include "flatzinc/presolve.h"
 #include "flatzinc/search.h"
 #include "flatzinc/solver.h"
+#include "google/protobuf/text_format.h"
 
 DEFINE_int32(log_period, 10000000, "Search log period");
 DEFINE_bool(all, false, "Search for all solutions");
@@ -46,7 +52,21 @@ DEFINE_int32(luby_restart, -1, "Luby restart factor, <= 0 = no luby");
 DEFINE_int32(heuristic_period, 100, "Period to call heuristics in free search");
 DEFINE_bool(verbose_impact, false, "Verbose impact");
 DEFINE_bool(verbose_mt, false, "Verbose Multi-Thread");
+DEFINE_bool(fz_pin_workers, false,
+            "Pin each parallel worker to its own CPU, see "
+            "ThreadPool::set_pin_workers().");
 DEFINE_bool(presolve, true, "Use presolve.");
+DEFINE_bool(auto_sat, true,
+            "Choose whether to use the sat propagator from the statistics of "
+            "the model. --use_sat=false disables it in all cases.");
+DEFINE_string(parallel_parameters, "",
+              "Diversification of the parallel workers, as a text "
+              "FzParallelParameters proto (see "
+              "flatzinc/parallel_parameters.proto). It replaces the default "
+              "strategies if it lists workers.");
+DEFINE_string(csv_output, "",
+              "If not empty, append the statistics of the run, as a line of "
+              "comma-separated values, to this file.");
 
 DECLARE_bool(fz_logging);
 DECLARE_bool(log_prefix);
@@ -63,8 +83,9 @@ void Solve(const FzModel* const model, const FzSolverParameters& parameters,
   solver.Solve(parameters, parallel_support);
 }
 
-void SequentialRun(const FzModel* model) {
-  FzSolverParameters parameters;
+void SequentialRun(const FzModel* model,
+                   const FzSolverParameters& common_parameters) {
+  FzSolverParameters parameters = common_parameters;
   parameters.all_solutions = FLAGS_all;
   parameters.free_search = FLAGS_free;
   parameters.heuristic_period = FLAGS_heuristic_period;
@@ -82,72 +103,123 @@ void SequentialRun(const FzModel* model) {
       FLAGS_use_impact ? FzSolverParameters::IBS : FzSolverParameters::DEFAULT;
 
   std::unique_ptr<FzParallelSupportInterface> parallel_support(
-      MakeSequentialSupport(FLAGS_all, FLAGS_num_solutions));
+      MakeSequentialSupport(*model, FLAGS_all, FLAGS_num_solutions));
   Solve(model, parameters, parallel_support.get());
 }
 
-void ParallelRun(const FzModel* const model, int worker_id,
+// The default diversification of the parallel workers.
+FzParallelParameters DefaultParallelParameters() {
+  FzParallelParameters parameters;
+  // Worker 0 follows the search annotations.
+  parameters.add_workers()->set_free_search(false);
+  parameters.add_workers()->set_search_type(FzWorkerParameters::MIN_SIZE);
+  FzWorkerParameters* const impact = parameters.add_workers();
+  impact->set_search_type(FzWorkerParameters::IBS);
+  impact->set_restart_log_size(FLAGS_restart_log_size);
+  FzWorkerParameters* const first_unbound = parameters.add_workers();
+  first_unbound->set_search_type(FzWorkerParameters::FIRST_UNBOUND);
+  first_unbound->set_heuristic_period(10000000);
+  FzWorkerParameters* const heuristics = parameters.add_workers();
+  heuristics->set_heuristic_period(30);
+  heuristics->set_run_all_heuristics(true);
+  // The other workers alternate random searches with restarts.
+  FzWorkerParameters* const random_min = parameters.add_extra_workers();
+  random_min->set_search_type(FzWorkerParameters::RANDOM_MIN);
+  random_min->set_luby_restart(250);
+  FzWorkerParameters* const random_max = parameters.add_extra_workers();
+  random_max->set_search_type(FzWorkerParameters::RANDOM_MAX);
+  random_max->set_luby_restart(250);
+  return parameters;
+}
+
+// The current strategy of each worker, which changes when the worker is
+// reassigned.
+class FzWorkerStrategies {
+ public:
+  FzWorkerStrategies(const FzParallelParameters& parameters, int num_workers)
+      : num_reassignments_(num_workers, 0) {
+    CHECK_GT(parameters.workers_size(), 0);
+    for (int w = 0; w < num_workers; ++w) {
+      if (w < parameters.workers_size()) {
+        strategies_.push_back(parameters.workers(w));
+      } else if (parameters.extra_workers_size() > 0) {
+        strategies_.push_back(
+            parameters.extra_workers(w % parameters.extra_workers_size()));
+      } else {
+        strategies_.push_back(
+            parameters.workers(parameters.workers_size() - 1));
+      }
+    }
+  }
+
+  FzWorkerParameters Get(int worker_id) {
+    MutexLock lock(&mutex_);
+    return strategies_[worker_id];
+  }
+
+  // Replaces the strategy of 'worker_id' by a variant of the strategy of
+  // 'model_worker': a free search with restarts and a new random seed.
+  FzWorkerParameters Reassign(int worker_id, int model_worker) {
+    const int kLubyRestart = 250;
+    MutexLock lock(&mutex_);
+    FzWorkerParameters variant = strategies_[model_worker];
+    variant.set_free_search(true);
+    if (variant.luby_restart() <= 0) {
+      variant.set_luby_restart(kLubyRestart);
+    }
+    variant.set_random_seed(worker_id * 10 + ++num_reassignments_[worker_id]);
+    strategies_[worker_id] = variant;
+    return variant;
+  }
+
+ private:
+  Mutex mutex_;
+  std::vector<FzWorkerParameters> strategies_;
+  std::vector<int> num_reassignments_;
+};
+
+void ParallelRun(const FzModel* const model,
+                 const FzSolverParameters* common_parameters,
+                 FzWorkerStrategies* strategies, int worker_id,
                  FzParallelSupportInterface* parallel_support) {
-  FzSolverParameters parameters;
+  FzSolverParameters parameters = *common_parameters;
   parameters.all_solutions = FLAGS_all;
-  parameters.heuristic_period = FLAGS_heuristic_period;
   parameters.ignore_unknown = false;
   parameters.log_period = 0;
-  parameters.luby_restart = -1;
   parameters.num_solutions = FLAGS_num_solutions;
-  parameters.random_seed = worker_id * 10;
   parameters.threads = FLAGS_workers;
-  parameters.time_limit_in_ms = FLAGS_time_limit;
   parameters.use_log = false;
   parameters.verbose_impact = false;
   parameters.worker_id = worker_id;
-  switch (worker_id) {
-    case 0: {
-      parameters.free_search = false;
-      parameters.search_type = operations_research::FzSolverParameters::DEFAULT;
-      parameters.restart_log_size = -1.0;
-      break;
-    }
-    case 1: {
-      parameters.free_search = true;
-      parameters.search_type =
-          operations_research::FzSolverParameters::MIN_SIZE;
-      parameters.restart_log_size = -1.0;
-      break;
-    }
-    case 2: {
-      parameters.free_search = true;
-      parameters.search_type = operations_research::FzSolverParameters::IBS;
-      parameters.restart_log_size = FLAGS_restart_log_size;
-      break;
-    }
-    case 3: {
-      parameters.free_search = true;
-      parameters.search_type =
-          operations_research::FzSolverParameters::FIRST_UNBOUND;
-      parameters.restart_log_size = -1.0;
-      parameters.heuristic_period = 10000000;
-      break;
-    }
-    case 4: {
-      parameters.free_search = true;
-      parameters.search_type = operations_research::FzSolverParameters::DEFAULT;
-      parameters.restart_log_size = -1.0;
-      parameters.heuristic_period = 30;
-      parameters.run_all_heuristics = true;
+  WallTimer timer;
+  timer.Start();
+  FzWorkerParameters strategy = strategies->Get(worker_id);
+  for (;;) {
+    parameters.free_search = strategy.free_search();
+    // Both enums have the same values.
+    parameters.search_type =
+        static_cast<FzSolverParameters::SearchType>(strategy.search_type());
+    parameters.luby_restart = strategy.luby_restart();
+    parameters.restart_log_size = strategy.restart_log_size();
+    parameters.heuristic_period = strategy.has_heuristic_period()
+                                      ? strategy.heuristic_period()
+                                      : FLAGS_heuristic_period;
+    parameters.run_all_heuristics = strategy.run_all_heuristics();
+    parameters.random_seed = strategy.has_random_seed()
+                                 ? strategy.random_seed()
+                                 : worker_id * 10;
+    // A reassigned worker only gets the remaining time.
+    parameters.time_limit_in_ms =
+        FLAGS_time_limit > 0
+            ? std::max<int64>(1, FLAGS_time_limit - timer.GetInMs())
+            : 0;
+    Solve(model, parameters, parallel_support);
+    const int model_worker = parallel_support->ReassignedTo(worker_id);
+    if (model_worker < 0 || parallel_support->ShouldFinish()) {
       break;
     }
-    default: {
-      parameters.free_search = true;
-      parameters.search_type =
-          worker_id % 2 == 0
-              ? operations_research::FzSolverParameters::RANDOM_MIN
-              : operations_research::FzSolverParameters::RANDOM_MAX;
-      parameters.restart_log_size = -1.0;
-      parameters.luby_restart = 250;
-    }
+    strategy = strategies->Reassign(worker_id, model_worker);
   }
-  Solve(model, parameters, parallel_support);
 }
 
 void FixAndParseParameters(int* argc, char*** argv) {
@@ -200,8 +272,22 @@ void ParseAndRun(const std::string& filename, int num_workers) {
   }
   FzModel model(problem_name);
   CHECK(ParseFlatzincFile(filename, &model));
-  FZLOG << "File " << filename << " parsed in " << timer.GetInMs() << " ms"
-        << FZENDL;
+  const int64 parse_time_ms = timer.GetInMs();
+  std::unique_ptr<File> file(File::Open(filename, "r"));
+  const double file_size_mb = file->Size() / (1024.0 * 1024.0);
+  file->Close();
+  const double throughput =
+      file_size_mb * 1000.0 / std::max<int64>(1, parse_time_ms);
+  FZLOG << "File " << filename << " parsed in " << parse_time_ms << " ms ("
+        << StringPrintf("%.1f", throughput) << " MB/s)" << FZENDL;
+  if (FLAGS_use_sat && FLAGS_auto_sat) {
+    FzModelStatistics sat_stats(model);
+    sat_stats.BuildStatistics();
+    FLAGS_use_sat = sat_stats.ShouldUseSat();
+  }
+  FzSolverParameters common_parameters;
+  common_parameters.parse_time_in_ms = parse_time_ms;
+  common_parameters.csv_output = FLAGS_csv_output;
   FzPresolver presolve;
   presolve.CleanUpModelForTheCpSolver(&model, FLAGS_use_sat);
   if (FLAGS_presolve) {
@@ -209,7 +295,9 @@ void ParseAndRun(const std::string& filename, int num_workers) {
     timer.Reset();
     timer.Start();
     presolve.Run(&model);
-    FZLOG << "  - done in " << timer.GetInMs() << " ms" << FZENDL;
+    common_parameters.presolve_time_in_ms = timer.GetInMs();
+    FZLOG << "  - done in " << common_parameters.presolve_time_in_ms << " ms"
+          << FZENDL;
   }
   FzModelStatistics stats(model);
   stats.PrintStatistics();
@@ -219,15 +307,34 @@ void ParseAndRun(const std::string& filename, int num_workers) {
 #endif
 
   if (num_workers == 0) {
-    operations_research::SequentialRun(&model);
+    operations_research::SequentialRun(&model, common_parameters);
   } else {
+    // The workers extract the model concurrently, so it must be read-only.
+    FzSolver::PrepareModelForExtraction(&model);
+    FzParallelParameters parallel_parameters = DefaultParallelParameters();
+    if (!FLAGS_parallel_parameters.empty()) {
+      FzParallelParameters flag_parameters;
+      CHECK(google::protobuf::TextFormat::ParseFromString(
+          FLAGS_parallel_parameters, &flag_parameters));
+      if (flag_parameters.workers_size() == 0) {
+        flag_parameters.mutable_workers()->CopyFrom(
+            parallel_parameters.workers());
+        flag_parameters.mutable_extra_workers()->CopyFrom(
+            parallel_parameters.extra_workers());
+      }
+      parallel_parameters.Swap(&flag_parameters);
+    }
+    FzWorkerStrategies strategies(parallel_parameters, num_workers);
     std::unique_ptr<operations_research::FzParallelSupportInterface>
         parallel_support(operations_research::MakeMtSupport(
-            FLAGS_all, FLAGS_num_solutions, FLAGS_verbose_mt));
+            model, FLAGS_all, FLAGS_num_solutions, FLAGS_verbose_mt,
+            num_workers, parallel_parameters.reassignment_period_in_ms()));
     {
       ThreadPool pool("Parallel FlatZinc", num_workers);
+      pool.set_pin_workers(FLAGS_fz_pin_workers);
       for (int w = 0; w < num_workers; ++w) {
-        pool.Add(NewCallback(ParallelRun, &model, w, parallel_support.get()));
+        pool.Add(NewCallback(ParallelRun, &model, &common_parameters,
+                             &strategies, w, parallel_support.get()));
       }
       pool.StartWorkers();
     }
@@ -0,0 +1,209 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "flatzinc/lexer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "base/strtoint.h"
+
+namespace operations_research {
+namespace {
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+bool IsLetter(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+bool IsIdentifierChar(char c) { return IsLetter(c) || IsDigit(c) || c == '_'; }
+
+int HexDigitValue(char c) {
+  if (IsDigit(c)) return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+struct Keyword {
+  const char* text;
+  int token;
+};
+
+// The keywords of the format. "true" and "false" are integer values.
+const Keyword kKeywords[] = {{"array", ARRAY},
+                             {"bool", BOOL},
+                             {"constraint", CONSTRAINT},
+                             {"float", FLOAT},
+                             {"int", INT},
+                             {"maximize", MAXIMIZE},
+                             {"minimize", MINIMIZE},
+                             {"of", OF},
+                             {"predicate", PREDICATE},
+                             {"satisfy", SATISFY},
+                             {"set", SET},
+                             {"solve", SOLVE},
+                             {"var", VAR}};
+}  // namespace
+
+FzLexer::FzLexer(const char* begin, const char* end)
+    : current_(begin), end_(end), line_number_(1) {}
+
+int FzLexer::Next(LexerInfo* info) {
+  while (current_ < end_) {
+    const char c = *current_;
+    const char next = current_ + 1 < end_ ? current_[1] : '\0';
+    if (c == '\n') {
+      ++line_number_;
+      ++current_;
+    } else if (c == ' ' || c == '\t' || c == '\r') {
+      ++current_;
+    } else if (c == '%') {
+      // A comment, up to the end of the line.
+      const char* const eol = static_cast<const char*>(
+          memchr(current_, '\n', end_ - current_));
+      current_ = eol == nullptr ? end_ : eol;
+    } else if (IsDigit(c) || (c == '-' && IsDigit(next))) {
+      return LexNumber(info);
+    } else if (IsLetter(c)) {
+      return LexIdentifierOrKeyword(current_, info);
+    } else if (c == '_') {
+      // Identifiers may start with underscores, followed by a letter.
+      const char* p = current_;
+      while (p < end_ && *p == '_') ++p;
+      if (p < end_ && IsLetter(*p)) {
+        return LexIdentifierOrKeyword(current_, info);
+      }
+      ++current_;
+      return c;
+    } else if (c == '.' && next == '.') {
+      current_ += 2;
+      return DOTDOT;
+    } else if (c == ':' && next == ':') {
+      current_ += 2;
+      return COLONCOLON;
+    } else if (c == '"') {
+      // A string, which cannot span several lines. Its value keeps the
+      // quotes.
+      const char* p = current_ + 1;
+      while (p < end_ && *p != '"' && *p != '\n') ++p;
+      if (p < end_ && *p == '"') {
+        info->string_value.assign(current_, p + 1 - current_);
+        current_ = p + 1;
+        return SVALUE;
+      }
+      ++current_;
+      return c;
+    } else {
+      ++current_;
+      return static_cast<unsigned char>(c);
+    }
+  }
+  return 0;
+}
+
+// Lexes -?[0-9]+ (decimal), -?0x[0-9A-Fa-f]+ (hexadecimal), -?0o[0-7]+
+// (octal) integers, and -?[0-9]+(\.[0-9]+)?([Ee][+-]?[0-9]+)? floats, where
+// the float must have a fractional part or an exponent.
+int FzLexer::LexNumber(LexerInfo* info) {
+  const char* const start = current_;
+  const char* p = start;
+  const bool negative = *p == '-';
+  if (negative) ++p;
+  if (*p == '0' && p + 2 < end_ && (p[1] == 'x' || p[1] == 'o')) {
+    const int base = p[1] == 'x' ? 16 : 8;
+    const char* q = p + 2;
+    int64 value = 0;
+    for (; q < end_; ++q) {
+      const int digit = HexDigitValue(*q);
+      if (digit < 0 || digit >= base) break;
+      value = value * base + digit;
+    }
+    if (q > p + 2) {
+      current_ = q;
+      info->integer_value = negative ? -value : value;
+      return IVALUE;
+    }
+  }
+  while (p < end_ && IsDigit(*p)) ++p;
+  const char* const integer_end = p;
+  bool is_float = false;
+  if (p + 1 < end_ && *p == '.' && IsDigit(p[1])) {
+    is_float = true;
+    p += 2;
+    while (p < end_ && IsDigit(*p)) ++p;
+  }
+  if (p < end_ && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    if (q < end_ && (*q == '+' || *q == '-')) ++q;
+    if (q < end_ && IsDigit(*q)) {
+      is_float = true;
+      while (q < end_ && IsDigit(*q)) ++q;
+      p = q;
+    }
+  }
+  current_ = p;
+  if (is_float) {
+    // The buffer is not null-terminated, so strtod() works on a copy.
+    const std::string text(start, p - start);
+    info->double_value = strtod(text.c_str(), nullptr);
+    return DVALUE;
+  }
+  const int kMaxSafeDigits = 18;
+  const int num_digits = integer_end - start - (negative ? 1 : 0);
+  if (num_digits > kMaxSafeDigits) {
+    // May overflow: let atoi64() saturate the value.
+    info->integer_value = atoi64(std::string(start, integer_end - start));
+    return IVALUE;
+  }
+  int64 value = 0;
+  for (const char* q = start + (negative ? 1 : 0); q < integer_end; ++q) {
+    value = value * 10 + (*q - '0');
+  }
+  info->integer_value = negative ? -value : value;
+  return IVALUE;
+}
+
+int FzLexer::LexIdentifierOrKeyword(const char* start, LexerInfo* info) {
+  const char* p = start;
+  while (p < end_ && IsIdentifierChar(*p)) ++p;
+  const int length = p - start;
+  current_ = p;
+  if (IsLetter(*start)) {
+    for (const Keyword& keyword : kKeywords) {
+      if (keyword.text[0] == *start && strlen(keyword.text) == length &&
+          memcmp(keyword.text, start, length) == 0) {
+        return keyword.token;
+      }
+    }
+    if (length == 4 && memcmp(start, "true", 4) == 0) {
+      info->integer_value = 1;
+      return IVALUE;
+    }
+    if (length == 5 && memcmp(start, "false", 5) == 0) {
+      info->integer_value = 0;
+      return IVALUE;
+    }
+  }
+  info->string_value.assign(start, length);
+  return IDENTIFIER;
+}
+}  // namespace operations_research
+
+// Entry points of the lexer, called by the bison parser.
+int orfz_lex(YYSTYPE* lvalp, void* scanner) {
+  return static_cast<operations_research::FzLexer*>(scanner)->Next(lvalp);
+}
+
+int orfz_get_lineno(void* scanner) {
+  return static_cast<operations_research::FzLexer*>(scanner)->line_number();
+}
@@ -0,0 +1,54 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_FLATZINC_LEXER_H_
+#define OR_TOOLS_FLATZINC_LEXER_H_
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "flatzinc/parser.tab.hh"
+
+namespace operations_research {
+// Hand-written lexer of the flatzinc format. It converts the characters of
+// the input into the YACC tokens declared in ./parser.yy, and stores their
+// value, if any, in a LexerInfo. It works on a buffer that holds the whole
+// input (typically a memory-mapped file), which it never copies: only the
+// text of identifiers and strings is copied into the LexerInfo.
+//
+// The bison parser calls it through orfz_lex(), with the lexer passed as
+// the 'scanner' parameter.
+class FzLexer {
+ public:
+  // The buffer [begin, end) must outlive the lexer.
+  FzLexer(const char* begin, const char* end);
+
+  // Returns the next token and stores its value in *info, or returns 0 at the
+  // end of the input. Characters that don't start a token are returned as
+  // single-character tokens (e.g. ';'), as the parser expects.
+  int Next(LexerInfo* info);
+
+  // The line of the last token returned, starting at 1.
+  int line_number() const { return line_number_; }
+
+ private:
+  int LexNumber(LexerInfo* info);
+  int LexIdentifierOrKeyword(const char* start, LexerInfo* info);
+
+  const char* current_;
+  const char* const end_;
+  int line_number_;
+
+  DISALLOW_COPY_AND_ASSIGN(FzLexer);
+};
+}  // namespace operations_research
+#endif  // OR_TOOLS_FLATZINC_LEXER_H_
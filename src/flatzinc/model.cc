@@ -693,6 +693,67 @@ void FzModelStatistics::PrintStatistics() {
   }
 }
 
+namespace {
+bool IsZeroOne(const FzIntegerVariable* const var) {
+  return var->domain.is_boolean ||
+         (var->domain.values.size() == 2 && var->domain.values[0] == 0 &&
+          var->domain.values[1] == 1);
+}
+
+// Constraints on boolean variables that the extraction passes to the sat
+// propagator when it is enabled.
+bool IsSatConstraintType(const std::string& type) {
+  return type == "array_bool_and" || type == "array_bool_or" ||
+         type == "array_bool_xor" || type == "bool_and" ||
+         type == "bool_clause" || type == "bool_eq" || type == "bool_eq_reif" ||
+         type == "bool_le" || type == "bool_le_reif" || type == "bool_ne" ||
+         type == "bool_ne_reif" || type == "bool_not" || type == "bool_or" ||
+         type == "bool_xor" || type == "bool_lin_eq" || type == "bool_lin_le";
+}
+
+// Linear constraints are pseudo-boolean sums if all their variables are
+// 0-1 and all their coefficients are 1.
+bool IsPseudoBooleanSum(const FzConstraint* const ct) {
+  if (ct->type != "int_lin_eq" && ct->type != "int_lin_le" &&
+      ct->type != "int_lin_ge") {
+    return false;
+  }
+  for (const int64 coeff : ct->Arg(0).values) {
+    if (coeff != 1) return false;
+  }
+  for (const FzIntegerVariable* const var : ct->Arg(1).variables) {
+    if (!IsZeroOne(var)) return false;
+  }
+  return true;
+}
+}  // namespace
+
+bool FzModelStatistics::ShouldUseSat() const {
+  // Below this ratio, the sat propagator mostly duplicates the CP propagation
+  // of the few clauses, and adds a demon per boolean variable it sees.
+  const double kMinSatRatio = 0.1;
+  int num_constraints = 0;
+  int num_sat_constraints = 0;
+  for (const auto& it : constraints_per_type_) {
+    num_constraints += it.second.size();
+    if (IsSatConstraintType(it.first)) {
+      num_sat_constraints += it.second.size();
+    } else {
+      for (const FzConstraint* const ct : it.second) {
+        if (IsPseudoBooleanSum(ct)) ++num_sat_constraints;
+      }
+    }
+  }
+  const bool use_sat =
+      num_sat_constraints > 0 &&
+      num_sat_constraints >= kMinSatRatio * num_constraints;
+  FZLOG << "  - " << num_sat_constraints << " of " << num_constraints
+        << " constraints are boolean clauses or sums, "
+        << (use_sat ? "using" : "not using") << " the sat propagator"
+        << FZENDL;
+  return use_sat;
+}
+
 void FzModelStatistics::BuildStatistics() {
   constraints_per_type_.clear();
   constraints_per_variables_.clear();
@@ -373,6 +373,11 @@ class FzModelStatistics {
   }
   void BuildStatistics();
   void PrintStatistics();
+  // Returns true if enough of the active constraints are boolean clauses or
+  // pseudo-boolean sums to make the sat propagator worth its overhead. The
+  // other constraints stay in the CP solver in all cases. BuildStatistics()
+  // must have been called before.
+  bool ShouldUseSat() const;
 
  private:
   const FzModel& model_;
@@ -10,12 +10,16 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <atomic>
 #include <iostream>  // NOLINT
+#include <memory>
 #include <string>
+#include <vector>
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/stringprintf.h"
+#include "base/timer.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "flatzinc/model.h"
@@ -63,11 +67,11 @@ class MtCustomLimit : public SearchLimit {
   virtual void Init() {}
 
   virtual bool Check() {
-    const bool result = support_->ShouldFinish();
-    if (result) {
+    if (support_->ShouldFinish()) {
       support_->Log(worker_id_, "terminating");
+      return true;
     }
-    return result;
+    return support_->ShouldReassign(worker_id_);
   }
 
   virtual void Copy(const SearchLimit* limit) {}
@@ -79,17 +83,128 @@ class MtCustomLimit : public SearchLimit {
   const int worker_id_;
 };
 
+// Bounds of the decision variables at the root of the search, shared by
+// all the workers. They only ever shrink.
+class SharedRootBounds {
+ public:
+  explicit SharedRootBounds(int size)
+      : size_(size),
+        mins_(new std::atomic<int64>[size]),
+        maxs_(new std::atomic<int64>[size]) {
+    for (int i = 0; i < size; ++i) {
+      mins_[i] = kint64min;
+      maxs_[i] = kint64max;
+    }
+  }
+
+  int size() const { return size_; }
+  int64 Min(int index) const { return mins_[index].load(); }
+  int64 Max(int index) const { return maxs_[index].load(); }
+
+  // Tightens the bounds of the variable 'index' with [min, max].
+  void Tighten(int index, int64 min, int64 max) {
+    int64 current = mins_[index].load();
+    while (min > current &&
+           !mins_[index].compare_exchange_weak(current, min)) {
+    }
+    current = maxs_[index].load();
+    while (max < current &&
+           !maxs_[index].compare_exchange_weak(current, max)) {
+    }
+  }
+
+ private:
+  const int size_;
+  std::unique_ptr<std::atomic<int64>[]> mins_;
+  std::unique_ptr<std::atomic<int64>[]> maxs_;
+};
+
+// Each time the search of a worker enters its root node (at the start and
+// after each restart), this monitor imports the root bounds found by the
+// other workers, and exports its own. This is done before the first
+// decision, as decision builders may fix variables without opening a choice
+// point. Root bounds are valid for all workers: the ones found under an
+// objective bound only prune solutions that are not better than the shared
+// incumbent.
+class MtRootBoundSharing : public SearchMonitor {
+ public:
+  MtRootBoundSharing(Solver* s, const std::vector<IntVar*>& vars,
+                     SharedRootBounds* shared,
+                     FzParallelSupportInterface* support, int worker_id)
+      : SearchMonitor(s),
+        vars_(vars),
+        shared_(shared),
+        support_(support),
+        worker_id_(worker_id),
+        at_root_(false) {}
+
+  virtual ~MtRootBoundSharing() {}
+
+  virtual void EnterSearch() { at_root_ = true; }
+
+  virtual void RestartSearch() { at_root_ = true; }
+
+  virtual void BeginNextDecision(DecisionBuilder* const b) {
+    if (!at_root_) {
+      return;
+    }
+    // Cleared first, as SetRange() may fail.
+    at_root_ = false;
+    int num_imported = 0;
+    for (int i = 0; i < vars_.size(); ++i) {
+      IntVar* const var = vars_[i];
+      const int64 shared_min = shared_->Min(i);
+      const int64 shared_max = shared_->Max(i);
+      if (shared_min > var->Min() || shared_max < var->Max()) {
+        ++num_imported;
+        var->SetRange(shared_min, shared_max);
+      }
+    }
+    if (num_imported > 0) {
+      support_->Log(worker_id_,
+                    StringPrintf("imported %d root bounds", num_imported));
+    }
+    for (int i = 0; i < vars_.size(); ++i) {
+      shared_->Tighten(i, vars_[i]->Min(), vars_[i]->Max());
+    }
+  }
+
+  virtual std::string DebugString() const { return "MtRootBoundSharing"; }
+
+ private:
+  const std::vector<IntVar*> vars_;
+  SharedRootBounds* const shared_;
+  FzParallelSupportInterface* const support_;
+  const int worker_id_;
+  bool at_root_;
+};
+
 class MtSupportInterface : public FzParallelSupportInterface {
  public:
-  MtSupportInterface(bool print_all, int num_solutions, bool verbose)
-      : print_all_(print_all),
+  MtSupportInterface(const FzModel& model, bool print_all, int num_solutions,
+                     bool verbose, int num_workers,
+                     int64 reassignment_period_in_ms)
+      : model_(model),
+        print_all_(print_all),
         num_solutions_(num_solutions),
         verbose_(verbose),
+        reassignment_period_in_ms_(reassignment_period_in_ms),
         type_(UNDEF),
+        has_last_solution_(false),
         last_worker_(-1),
         best_solution_(0),
+        published_solution_(0),
         should_finish_(false),
-        interrupted_(false) {}
+        interrupted_(false),
+        best_worker_(-1),
+        last_improvement_times_(new std::atomic<int64>[num_workers]),
+        reassigned_to_(new std::atomic<int>[num_workers]) {
+    for (int w = 0; w < num_workers; ++w) {
+      last_improvement_times_[w] = 0;
+      reassigned_to_[w] = -1;
+    }
+    reassignment_timer_.Start();
+  }
 
   virtual ~MtSupportInterface() {}
 
@@ -103,68 +218,59 @@ class MtSupportInterface : public FzParallelSupportInterface {
 
   virtual void StartSearch(int worker_id, Type type) {
     MutexLock lock(&mutex_);
+    reassigned_to_[worker_id] = -1;
+    last_improvement_times_[worker_id] = reassignment_timer_.GetInMs();
     if (type_ == UNDEF) {
       type_ = type;
       if (type == MAXIMIZE) {
         best_solution_ = kint64min;
+        published_solution_ = kint64min;
       } else if (type_ == MINIMIZE) {
         best_solution_ = kint64max;
+        published_solution_ = kint64max;
       }
     }
   }
 
-  virtual void SatSolution(int worker_id, const std::string& solution_string) {
+  virtual void SatSolution(int worker_id,
+                           const std::vector<int64>& solution_values) {
     MutexLock lock(&mutex_);
     if (NumSolutions() < num_solutions_ || print_all_) {
       LogNoLock(worker_id, "solution found");
-      std::cout << solution_string << std::endl;
+      PrintSolutionNoLock(solution_values);
       should_finish_ = true;
     }
     IncrementSolutions();
   }
 
   virtual void OptimizeSolution(int worker_id, int64 value,
-                                const std::string& solution_string) {
+                                const std::vector<int64>& solution_values) {
+    if (should_finish_.load(std::memory_order_relaxed) ||
+        !ImproveBestSolution(value)) {
+      return;
+    }
+    best_worker_ = worker_id;
+    last_improvement_times_[worker_id] = reassignment_timer_.GetInMs();
+    // Only the worker that improved the incumbent gets here. Another worker
+    // may have found an even better solution in the meantime, and have
+    // published it first: published_solution_ keeps the output monotonic.
     MutexLock lock(&mutex_);
-    if (!should_finish_) {
-      switch (type_) {
-        case MINIMIZE: {
-          if (value < best_solution_) {
-            best_solution_ = value;
-            IncrementSolutions();
-            LogNoLock(
-                worker_id,
-                StringPrintf("solution found with value %" GG_LL_FORMAT "d",
-                             value));
-            if (print_all_ || num_solutions_ > 1) {
-              std::cout << solution_string << std::endl;
-            } else {
-              last_solution_ = solution_string + "\n";
-              last_worker_ = worker_id;
-            }
-          }
-          break;
-        }
-        case MAXIMIZE: {
-          if (value > best_solution_) {
-            best_solution_ = value;
-            IncrementSolutions();
-            LogNoLock(
-                worker_id,
-                StringPrintf("solution found with value %" GG_LL_FORMAT "d",
-                             value));
-            if (print_all_ || num_solutions_ > 1) {
-              std::cout << solution_string << std::endl;
-            } else {
-              last_solution_ = solution_string + "\n";
-              last_worker_ = worker_id;
-            }
-          }
-          break;
-        }
-        default:
-          LOG(ERROR) << "Should not be here";
-      }
+    if (should_finish_ || !IsBetter(value, published_solution_)) {
+      return;
+    }
+    published_solution_ = value;
+    IncrementSolutions();
+    LogNoLock(worker_id,
+              StringPrintf("solution found with value %" GG_LL_FORMAT "d",
+                           value));
+    if (print_all_ || num_solutions_ > 1) {
+      PrintSolutionNoLock(solution_values);
+    } else {
+      // Only the last solution is printed: keep its values, and format it
+      // at the end of the search.
+      last_solution_values_ = solution_values;
+      has_last_solution_ = true;
+      last_worker_ = worker_id;
     }
   }
 
@@ -173,17 +279,19 @@ class MtSupportInterface : public FzParallelSupportInterface {
     std::cout << final_output << std::endl;
   }
 
-  virtual bool ShouldFinish() const { return should_finish_; }
+  virtual bool ShouldFinish() const {
+    return should_finish_.load(std::memory_order_relaxed);
+  }
 
   virtual void EndSearch(int worker_id, bool interrupted) {
     MutexLock lock(&mutex_);
     LogNoLock(worker_id, "exiting");
-    if (!last_solution_.empty()) {
+    if (has_last_solution_) {
       LogNoLock(last_worker_,
                 StringPrintf("solution found with value %" GG_LL_FORMAT "d",
-                             best_solution_));
-      std::cout << last_solution_;
-      last_solution_.clear();
+                             published_solution_));
+      PrintSolutionNoLock(last_solution_values_);
+      has_last_solution_ = false;
     }
     should_finish_ = true;
     if (interrupted) {
@@ -191,7 +299,9 @@ class MtSupportInterface : public FzParallelSupportInterface {
     }
   }
 
-  virtual int64 BestSolution() const { return best_solution_; }
+  virtual int64 BestSolution() const {
+    return best_solution_.load(std::memory_order_relaxed);
+  }
 
   virtual OptimizeVar* Objective(Solver* s, bool maximize, IntVar* var,
                                  int64 step, int w) {
@@ -202,6 +312,20 @@ class MtSupportInterface : public FzParallelSupportInterface {
     return s->RevAlloc(new MtCustomLimit(s, this, worker_id));
   }
 
+  virtual SearchMonitor* RootBoundSharing(Solver* s,
+                                          const std::vector<IntVar*>& vars,
+                                          int worker_id) {
+    MutexLock lock(&mutex_);
+    if (root_bounds_ == nullptr) {
+      root_bounds_.reset(new SharedRootBounds(vars.size()));
+    } else if (root_bounds_->size() != vars.size()) {
+      LogNoLock(worker_id, "cannot share root bounds");
+      return nullptr;
+    }
+    return s->RevAlloc(
+        new MtRootBoundSharing(s, vars, root_bounds_.get(), this, worker_id));
+  }
+
   virtual void Log(int worker_id, const std::string& message) {
     if (verbose_) {
       MutexLock lock(&mutex_);
@@ -211,6 +335,68 @@ class MtSupportInterface : public FzParallelSupportInterface {
 
   virtual bool Interrupted() const { return interrupted_; }
 
+  // Worker 0 is never reassigned, and no worker is in a satisfaction
+  // problem, as nobody improves the objective.
+  virtual bool ShouldReassign(int worker_id) {
+    if (reassignment_period_in_ms_ <= 0 || worker_id <= 0) {
+      return false;
+    }
+    if (reassigned_to_[worker_id].load(std::memory_order_relaxed) >= 0) {
+      return true;
+    }
+    const int best_worker = best_worker_.load(std::memory_order_relaxed);
+    if (best_worker < 0 || best_worker == worker_id ||
+        reassignment_timer_.GetInMs() -
+                last_improvement_times_[worker_id].load(
+                    std::memory_order_relaxed) <
+            reassignment_period_in_ms_) {
+      return false;
+    }
+    reassigned_to_[worker_id] = best_worker;
+    Log(worker_id,
+        StringPrintf("switching to the strategy of worker %d", best_worker));
+    return true;
+  }
+
+  virtual int ReassignedTo(int worker_id) const {
+    return worker_id < 0 ? -1 : reassigned_to_[worker_id].load();
+  }
+
+  // Returns true if 'value' is strictly better than 'reference'.
+  bool IsBetter(int64 value, int64 reference) const {
+    switch (type_) {
+      case MINIMIZE:
+        return value < reference;
+      case MAXIMIZE:
+        return value > reference;
+      default:
+        LOG(ERROR) << "Should not be here";
+        return false;
+    }
+  }
+
+  // Atomically replaces the best known objective by 'value' if it is
+  // better, and returns true if it did. The type of the problem is set by
+  // StartSearch() under the mutex, before any solution is found.
+  bool ImproveBestSolution(int64 value) {
+    int64 best = best_solution_.load(std::memory_order_relaxed);
+    while (IsBetter(value, best)) {
+      if (best_solution_.compare_exchange_weak(best, value)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Formats the solution into a reused buffer, and writes it at once.
+  void PrintSolutionNoLock(const std::vector<int64>& solution_values) {
+    output_buffer_.clear();
+    AppendFzSolution(model_, solution_values, &output_buffer_);
+    output_buffer_.push_back('\n');
+    std::cout.write(output_buffer_.data(), output_buffer_.size());
+    std::cout.flush();
+  }
+
   void LogNoLock(int worker_id, const std::string& message) {
     if (verbose_) {
       std::cout << "%%  worker " << worker_id << ": " << message << std::endl;
@@ -218,21 +404,40 @@ class MtSupportInterface : public FzParallelSupportInterface {
   }
 
  private:
+  const FzModel& model_;
   const bool print_all_;
   const int num_solutions_;
   const bool verbose_;
+  const int64 reassignment_period_in_ms_;
+  // Protects the output, and the solution state below.
   Mutex mutex_;
   Type type_;
-  std::string last_solution_;
+  std::vector<int64> last_solution_values_;
+  bool has_last_solution_;
   int last_worker_;
-  int64 best_solution_;
-  bool should_finish_;
-  bool interrupted_;
+  std::string output_buffer_;
+  // The best objective value found, polled by all the workers without
+  // locking, and the best objective value written to the output.
+  std::atomic<int64> best_solution_;
+  int64 published_solution_;
+  std::atomic<bool> should_finish_;
+  std::atomic<bool> interrupted_;
+  std::unique_ptr<SharedRootBounds> root_bounds_;
+  // The worker that found the best objective value, and, per worker, the
+  // time of its last improvement and the worker whose strategy it should
+  // adopt (-1 if it keeps its own).
+  std::atomic<int> best_worker_;
+  WallTimer reassignment_timer_;
+  std::unique_ptr<std::atomic<int64>[]> last_improvement_times_;
+  std::unique_ptr<std::atomic<int>[]> reassigned_to_;
 };
 }  // namespace
 
-FzParallelSupportInterface* MakeMtSupport(bool print_all, int num_solutions,
-                                          bool verbose) {
-  return new MtSupportInterface(print_all, num_solutions, verbose);
+FzParallelSupportInterface* MakeMtSupport(const FzModel& model, bool print_all,
+                                          int num_solutions, bool verbose,
+                                          int num_workers,
+                                          int64 reassignment_period_in_ms) {
+  return new MtSupportInterface(model, print_all, num_solutions, verbose,
+                                num_workers, reassignment_period_in_ms);
 }
 }  // namespace operations_research
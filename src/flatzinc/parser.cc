@@ -12,65 +12,40 @@
 // limitations under the License.
 #include <cstdio>
 #include "base/file.h"
+#include "base/unique_ptr.h"
+#include "flatzinc/lexer.h"
 #include "flatzinc/parser.h"
 #include "flatzinc/parser.tab.hh"
 
-// Declare external functions in the flatzinc.tab.cc generated file.
+// Declare the parser function of the parser.tab.cc generated file.
 extern int orfz_parse(operations_research::FzParserContext* parser,
                       operations_research::FzModel* model, bool* ok,
                       void* scanner);
-extern int orfz_lex_init(void** scanner);
-extern int orfz_lex_destroy(void* scanner);
-extern void orfz_set_in(FILE* in_str, void* yyscanner);
-// Declare external functions and structures in the flatzinc.yy.cc
-// generated file.
-struct yy_buffer_state;
-extern yy_buffer_state* orfz__scan_bytes(const char* input, size_t size,
-                                         void* scanner);
-extern void orfz__delete_buffer(yy_buffer_state* b, void* scanner);
 
 namespace operations_research {
+namespace {
+bool ParseBuffer(const char* begin, const char* end, FzModel* const model) {
+  FzParserContext context;
+  FzLexer lexer(begin, end);
+  bool ok = true;
+  orfz_parse(&context, model, &ok, &lexer);
+  return ok;
+}
+}  // namespace
+
 // ----- public parsing API -----
 
 bool ParseFlatzincFile(const std::string& filename, FzModel* const model) {
-  // Init.
-  FILE* const input = fopen(filename.c_str(), "r");
-  if (input == nullptr) {
+  // The lexer works directly on the (memory-mapped) file content.
+  std::unique_ptr<MappedFile> file(MappedFile::Open(filename));
+  if (file == nullptr) {
     LOG(INFO) << "Could not open file '" << filename << "'";
     return false;
   }
-  FzParserContext context;
-  bool ok = true;
-  void* scanner = nullptr;
-  orfz_lex_init(&scanner);
-  orfz_set_in(input, scanner);
-  // Parse.
-  orfz_parse(&context, model, &ok, scanner);
-  // Clean up.
-  if (scanner != nullptr) {
-    orfz_lex_destroy(scanner);
-  }
-  fclose(input);
-  return ok;
+  return ParseBuffer(file->data(), file->data() + file->size(), model);
 }
 
 bool ParseFlatzincString(const std::string& input, FzModel* const model) {
-  // Init.
-  FzParserContext context;
-  bool ok = true;
-  void* scanner = nullptr;
-  orfz_lex_init(&scanner);
-  yy_buffer_state* const string_buffer =
-      orfz__scan_bytes(input.data(), input.size(), scanner);
-  // Parse.
-  orfz_parse(&context, model, &ok, scanner);
-  // Clean up.
-  if (string_buffer != nullptr) {
-    orfz__delete_buffer(string_buffer, scanner);
-  }
-  if (scanner != nullptr) {
-    orfz_lex_destroy(scanner);
-  }
-  return ok;
+  return ParseBuffer(input.data(), input.data() + input.size(), model);
 }
 }  // namespace operations_research
@@ -449,10 +449,12 @@ var_or_value:
 | IDENTIFIER {
   // A reference to an existing integer constant or variable.
   const std::string& id = $1;
-  if (ContainsKey(context->integer_map, id)) {
-    $$ = VariableRefOrValue::Value(FindOrDie(context->integer_map, id));
-  } else if (ContainsKey(context->variable_map, id)) {
-    $$ = VariableRefOrValue::VariableRef(FindOrDie(context->variable_map, id));
+  const int64* value = nullptr;
+  FzIntegerVariable* const* var = nullptr;
+  if ((value = FindOrNull(context->integer_map, id)) != nullptr) {
+    $$ = VariableRefOrValue::Value(*value);
+  } else if ((var = FindOrNull(context->variable_map, id)) != nullptr) {
+    $$ = VariableRefOrValue::VariableRef(*var);
   } else {
     LOG(ERROR) << "Unknown symbol " << id;
     $$ = VariableRefOrValue::Undefined();
@@ -463,12 +465,12 @@ var_or_value:
   // A given element of an existing constant array or variable array.
   const std::string& id = $1;
   const int64 value = $3;
-  if (ContainsKey(context->integer_array_map, id)) {
-    $$ = VariableRefOrValue::Value(
-        FzLookup(FindOrDie(context->integer_array_map, id), value));
-  } else if (ContainsKey(context->variable_array_map, id)) {
-    $$ = VariableRefOrValue::VariableRef(
-        FzLookup(FindOrDie(context->variable_array_map, id), value));
+  const std::vector<int64>* values = nullptr;
+  const std::vector<FzIntegerVariable*>* vars = nullptr;
+  if ((values = FindOrNull(context->integer_array_map, id)) != nullptr) {
+    $$ = VariableRefOrValue::Value(FzLookup(*values, value));
+  } else if ((vars = FindOrNull(context->variable_array_map, id)) != nullptr) {
+    $$ = VariableRefOrValue::VariableRef(FzLookup(*vars, value));
   } else {
     LOG(ERROR) << "Unknown symbol " << id;
     $$ = VariableRefOrValue::Undefined();
@@ -590,14 +592,18 @@ argument:
 }
 | IDENTIFIER {
   const std::string& id = $1;
-  if (ContainsKey(context->integer_map, id)) {
-    $$ = FzArgument::IntegerValue(FindOrDie(context->integer_map, id));
-  } else if (ContainsKey(context->integer_array_map, id)) {
-    $$ = FzArgument::IntegerList(FindOrDie(context->integer_array_map, id));
-  } else if (ContainsKey(context->variable_map, id)) {
-    $$ = FzArgument::IntVarRef(FindOrDie(context->variable_map, id));
-  } else if (ContainsKey(context->variable_array_map, id)) {
-    $$ = FzArgument::IntVarRefArray(FindOrDie(context->variable_array_map, id));
+  const int64* value = nullptr;
+  const std::vector<int64>* values = nullptr;
+  FzIntegerVariable* const* var = nullptr;
+  const std::vector<FzIntegerVariable*>* vars = nullptr;
+  if ((value = FindOrNull(context->integer_map, id)) != nullptr) {
+    $$ = FzArgument::IntegerValue(*value);
+  } else if ((values = FindOrNull(context->integer_array_map, id)) != nullptr) {
+    $$ = FzArgument::IntegerList(*values);
+  } else if ((var = FindOrNull(context->variable_map, id)) != nullptr) {
+    $$ = FzArgument::IntVarRef(*var);
+  } else if ((vars = FindOrNull(context->variable_array_map, id)) != nullptr) {
+    $$ = FzArgument::IntVarRefArray(*vars);
   } else {
     CHECK(ContainsKey(context->domain_map, id)) << "Unknown identifier: " << id;
     const FzDomain& d = FindOrDie(context->domain_map, id);
@@ -607,12 +613,12 @@ argument:
 | IDENTIFIER '[' IVALUE ']' {
   const std::string& id = $1;
   const int64 index = $3;
-  if (ContainsKey(context->integer_array_map, id)) {
-    $$ = FzArgument::IntegerValue(
-        FzLookup(FindOrDie(context->integer_array_map, id), index));
-  } else if (ContainsKey(context->variable_array_map, id)) {
-    $$ = FzArgument::IntVarRef(
-        FzLookup(FindOrDie(context->variable_array_map, id), index));
+  const std::vector<int64>* values = nullptr;
+  const std::vector<FzIntegerVariable*>* vars = nullptr;
+  if ((values = FindOrNull(context->integer_array_map, id)) != nullptr) {
+    $$ = FzArgument::IntegerValue(FzLookup(*values, index));
+  } else if ((vars = FindOrNull(context->variable_array_map, id)) != nullptr) {
+    $$ = FzArgument::IntVarRef(FzLookup(*vars, index));
   } else {
     CHECK(ContainsKey(context->domain_array_map, id))
         << "Unknown identifier: " << id;
@@ -645,6 +651,7 @@ argument:
   } else {
     $$ = FzArgument::IntegerList(arguments->values);
   }
+  delete arguments;
 }
 
 //---------------------------------------------------------------------------
@@ -668,10 +675,12 @@ annotation:
 | SVALUE { $$ = FzAnnotation::String($1); }
 | IDENTIFIER {
   const std::string& id = $1;
-  if (ContainsKey(context->variable_map, id)) {
-    $$ = FzAnnotation::Variable(FindOrDie(context->variable_map, id));
-  } else if (ContainsKey(context->variable_array_map, id)) {
-    $$ = FzAnnotation::VariableList(FindOrDie(context->variable_array_map, id));
+  FzIntegerVariable* const* var = nullptr;
+  const std::vector<FzIntegerVariable*>* vars = nullptr;
+  if ((var = FindOrNull(context->variable_map, id)) != nullptr) {
+    $$ = FzAnnotation::Variable(*var);
+  } else if ((vars = FindOrNull(context->variable_array_map, id)) != nullptr) {
+    $$ = FzAnnotation::VariableList(*vars);
   } else {
     $$ = FzAnnotation::Identifier(id);
   }
@@ -1660,6 +1660,11 @@ bool FzPresolver::Run(FzModel* model) {
 
   MergeIntEqNe(model);
 
+  var_to_constraints_.clear();
+  for (FzConstraint* const ct : model->constraints()) {
+    AddToVarToConstraints(ct);
+  }
+
   bool changed_since_start = false;
   // Let's presolve the bool2int predicates first.
   for (FzConstraint* const ct : model->constraints()) {
@@ -1673,31 +1678,86 @@ bool FzPresolver::Run(FzModel* model) {
     var_representative_map_.clear();
   }
 
-  // Apply the rest of the presolve rules.
-  for (;;) {
-    bool changed = false;
-    var_representative_map_.clear();
-    for (FzConstraint* const ct : model->constraints()) {
-      if (ct->active) {
-        changed |= PresolveOneConstraint(ct);
-      }
+  // Apply the rest of the presolve rules. All the constraints are presolved
+  // once, then only the ones marked by MarkNeighborsToPresolve(), until
+  // exhaustion. The constraints are always scanned in the model order.
+  const std::vector<FzConstraint*>& constraints = model->constraints();
+  constraint_index_.clear();
+  for (int i = 0; i < constraints.size(); ++i) {
+    constraint_index_[constraints[i]] = i;
+  }
+  to_presolve_.assign(constraints.size(), true);
+  num_to_presolve_ = constraints.size();
+  while (num_to_presolve_ > 0) {
+    for (int i = 0; i < constraints.size(); ++i) {
+      if (!to_presolve_[i]) continue;
+      to_presolve_[i] = false;
+      --num_to_presolve_;
+      FzConstraint* const ct = constraints[i];
+      if (!ct->active || !PresolveOneConstraint(ct)) continue;
+      changed_since_start = true;
+      // The rule may have introduced new variables in the constraint.
+      AddToVarToConstraints(ct);
+      MarkNeighborsToPresolve(ct);
       if (!var_representative_map_.empty()) {
-        break;
+        // Some new substitutions were introduced. Let's process them.
+        SubstituteEverywhere(model);
+        for (const auto& p : var_representative_map_) {
+          MarkConstraintsOfVarToPresolve(p.second);
+        }
+        var_representative_map_.clear();
       }
     }
-    if (!var_representative_map_.empty()) {
-      // Some new substitutions were introduced. Let's process them.
-      DCHECK(changed);
-      changed = true;  // To be safe in opt mode.
-      SubstituteEverywhere(model);
-      var_representative_map_.clear();
-    }
-    changed_since_start |= changed;
-    if (!changed) break;
   }
   return changed_since_start;
 }
 
+// ----- Worklist support -----
+
+void FzPresolver::AddToVarToConstraints(FzConstraint* ct) {
+  for (const FzArgument& arg : ct->arguments) {
+    for (FzIntegerVariable* const var : arg.variables) {
+      var_to_constraints_[var].insert(ct);
+    }
+  }
+  if (ct->target_variable != nullptr) {
+    var_to_constraints_[ct->target_variable].insert(ct);
+  }
+}
+
+void FzPresolver::MarkToPresolve(FzConstraint* ct) {
+  const int index = FindWithDefault(constraint_index_, ct, -1);
+  if (index != -1 && !to_presolve_[index]) {
+    to_presolve_[index] = true;
+    ++num_to_presolve_;
+  }
+}
+
+// The presolve rules only modify the variables of the constraint they are
+// applied to, and the information they store (abs_map_, affine_map_...) is
+// indexed by these variables. So when a constraint is modified, only the
+// constraints sharing a variable with it can be presolved further.
+void FzPresolver::MarkNeighborsToPresolve(FzConstraint* ct) {
+  MarkToPresolve(ct);
+  for (const FzArgument& arg : ct->arguments) {
+    for (FzIntegerVariable* const var : arg.variables) {
+      MarkConstraintsOfVarToPresolve(var);
+    }
+  }
+  if (ct->target_variable != nullptr) {
+    MarkConstraintsOfVarToPresolve(ct->target_variable);
+  }
+}
+
+void FzPresolver::MarkConstraintsOfVarToPresolve(const FzIntegerVariable* var) {
+  const hash_set<FzConstraint*>* const constraints =
+      FindOrNull(var_to_constraints_, var);
+  if (constraints == nullptr) return;
+  for (FzConstraint* const ct : *constraints) {
+    MarkToPresolve(ct);
+  }
+}
+
 // ----- Substitution support -----
 
 void FzPresolver::MarkVariablesAsEquivalent(FzIntegerVariable* from,
@@ -14,6 +14,7 @@
 #define OR_TOOLS_FLATZINC_PRESOLVE_H_
 
 #include <string>
+#include <vector>
 #include "base/hash.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
@@ -98,6 +99,13 @@ class FzPresolver {
   // Returns true iff the model was modified.
   bool PresolveOneConstraint(FzConstraint* ct);
 
+  // Worklist support. A constraint must be presolved again when a constraint
+  // sharing a variable with it has been modified.
+  void AddToVarToConstraints(FzConstraint* ct);
+  void MarkToPresolve(FzConstraint* ct);
+  void MarkNeighborsToPresolve(FzConstraint* ct);
+  void MarkConstraintsOfVarToPresolve(const FzIntegerVariable* var);
+
   // Substitution support.
   void SubstituteEverywhere(FzModel* model);
   void SubstituteAnnotation(FzAnnotation* ann);
@@ -165,6 +173,12 @@ class FzPresolver {
   // Stores all constraints containing a variable.
   hash_map<const FzIntegerVariable*,
            hash_set<FzConstraint*>> var_to_constraints_;
+
+  // The index of each constraint in the model, and the constraints that must
+  // be presolved again, by index.
+  hash_map<const FzConstraint*, int> constraint_index_;
+  std::vector<bool> to_presolve_;
+  int num_to_presolve_;
 };
 }  // namespace operations_research
 
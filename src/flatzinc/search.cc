@@ -14,7 +14,9 @@
 #include <signal.h>
 #endif  // __GNUC__
 #include <iostream>  // NOLINT
+#include <memory>
 #include <string>
+#include "base/file.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
@@ -140,8 +142,65 @@ std::string FzMemoryUsage() {
   }
 }
 
+// Appends 'line' to the csv file of the parameters, and writes the header
+// of the columns first if the file is new.
+void AppendCsvStatistics(const FzSolverParameters& p, const std::string& line) {
+  const bool is_new = !File::Exists(p.csv_output.c_str());
+  std::unique_ptr<File> file(File::Open(p.csv_output, "a"));
+  if (file == nullptr) {
+    LOG(ERROR) << "Cannot open " << p.csv_output;
+    return;
+  }
+  if (is_new) {
+    file->WriteLine(
+        "name,status,obj,solutions,workers,parse_ms,presolve_ms,build_ms,"
+        "solve_ms,first_solution_ms,last_solution_ms,branches,failures,"
+        "search");
+  }
+  file->WriteLine(line);
+  file->Close();
+}
 }  // namespace
 
+void AppendFzSolution(const FzModel& model, const std::vector<int64>& values,
+                      std::string* output) {
+  int index = 0;
+  for (const FzOnSolutionOutput& output_spec : model.output()) {
+    output->append(output_spec.name);
+    if (output_spec.variable != nullptr) {
+      const int64 value = values[index++];
+      if (output_spec.is_boolean) {
+        output->append(value == 1 ? " = true;\n" : " = false;\n");
+      } else {
+        StringAppendF(output, " = %" GG_LL_FORMAT "d;\n", value);
+      }
+    } else {
+      const int bound_size = output_spec.bounds.size();
+      StringAppendF(output, " = array%dd(", bound_size);
+      for (const FzOnSolutionOutput::Bounds& bounds : output_spec.bounds) {
+        StringAppendF(output, "%" GG_LL_FORMAT "d..%" GG_LL_FORMAT "d, ",
+                      bounds.min_value, bounds.max_value);
+      }
+      output->append("[");
+      const int size = output_spec.flat_variables.size();
+      for (int i = 0; i < size; ++i) {
+        const int64 value = values[index++];
+        if (output_spec.is_boolean) {
+          output->append(value ? "true" : "false");
+        } else {
+          StringAppendF(output, "%" GG_LL_FORMAT "d", value);
+        }
+        if (i != size - 1) {
+          output->append(", ");
+        }
+      }
+      output->append("]);\n");
+    }
+  }
+  DCHECK_EQ(values.size(), index);
+  output->append("----------");
+}
+
 FzSolverParameters::FzSolverParameters()
     : all_solutions(false),
       free_search(false),
@@ -157,7 +216,9 @@ FzSolverParameters::FzSolverParameters()
       threads(1),
       worker_id(-1),
       time_limit_in_ms(0),
-      search_type(MIN_SIZE) {}
+      search_type(MIN_SIZE),
+      parse_time_in_ms(0),
+      presolve_time_in_ms(0) {}
 
 void MarkComputedVariables(FzConstraint* ct,
                            hash_set<FzIntegerVariable*>* marked) {
@@ -567,6 +628,15 @@ void FzSolver::SyncWithModel() {
     extracted_occurrences_[var] = statistics_.VariableOccurrences(fz_var);
     if (!fz_var->temporary) active_variables_.push_back(var);
   }
+  output_expressions_.clear();
+  for (const FzOnSolutionOutput& output : model_.output()) {
+    if (output.variable != nullptr) {
+      output_expressions_.push_back(OutputExpression(output.variable));
+    }
+    for (FzIntegerVariable* const var : output.flat_variables) {
+      output_expressions_.push_back(OutputExpression(var));
+    }
+  }
   if (model_.objective() != nullptr) {
     objective_var_ = Extract(model_.objective())->Var();
   }
@@ -607,6 +677,9 @@ void FzSolver::Solve(FzSolverParameters p,
   }
   // Custom limit in case of parallelism.
   monitors.push_back(parallel_support->Limit(solver(), p.worker_id));
+  // Root bounds exchange in case of parallelism.
+  monitors.push_back(parallel_support->RootBoundSharing(
+      solver(), active_variables_, p.worker_id));
 
   if (limit != nullptr) {
     FZLOG << "  - adding a time limit of " << p.time_limit_in_ms << " ms"
@@ -631,22 +704,15 @@ void FzSolver::Solve(FzSolverParameters p,
   }
 
   bool breaked = false;
-  std::string solution_string;
+  std::vector<int64> solution_values;
   const int64 build_time = solver()->wall_time();
   solver()->NewSearch(db, monitors);
   while (solver()->NextSolution()) {
     if (!parallel_support->ShouldFinish()) {
-      solution_string.clear();
-      if (!model_.output().empty()) {
-        for (const FzOnSolutionOutput& output : model_.output()) {
-          solution_string.append(SolutionString(output));
-          solution_string.append("\n");
-        }
-      }
-      solution_string.append("----------");
+      CollectSolutionValues(&solution_values);
       if (model_.objective() != nullptr) {
         const int64 best = objective_monitor_->best();
-        parallel_support->OptimizeSolution(p.worker_id, best, solution_string);
+        parallel_support->OptimizeSolution(p.worker_id, best, solution_values);
         if ((p.num_solutions != 1 &&
              parallel_support->NumSolutions() >= p.num_solutions) ||
             (p.all_solutions && p.num_solutions == 1 &&
@@ -654,7 +720,7 @@ void FzSolver::Solve(FzSolverParameters p,
           break;
         }
       } else {
-        parallel_support->SatSolution(p.worker_id, solution_string);
+        parallel_support->SatSolution(p.worker_id, solution_values);
         if (parallel_support->NumSolutions() >= p.num_solutions) {
           break;
         }
@@ -662,6 +728,10 @@ void FzSolver::Solve(FzSolverParameters p,
     }
   }
   solver()->EndSearch();
+  if (parallel_support->ReassignedTo(p.worker_id) >= 0) {
+    // The worker starts a new search with another strategy.
+    return;
+  }
   parallel_support->EndSearch(p.worker_id,
                               limit != nullptr ? limit->crossed() : false);
   const int64 solve_time = solver()->wall_time() - build_time;
@@ -715,6 +785,14 @@ void FzSolver::Solve(FzSolverParameters p,
                      solver()->failures()));
     final_output.append(StringPrintf("%%%%  memory:               %s\n",
                                      FzMemoryUsage().c_str()));
+    if (num_solutions > 0) {
+      final_output.append(
+          StringPrintf("%%%%  first solution:       %" GG_LL_FORMAT "d ms\n",
+                       parallel_support->FirstSolutionTime()));
+      final_output.append(
+          StringPrintf("%%%%  last solution:        %" GG_LL_FORMAT "d ms\n",
+                       parallel_support->LastSolutionTime()));
+    }
     const int64 best = parallel_support->BestSolution();
     if (model_.objective() != nullptr) {
       if (!model_.maximize() && num_solutions > 0) {
@@ -750,6 +828,20 @@ void FzSolver::Solve(FzSolverParameters p,
         solver()->demon_runs(Solver::DELAYED_PRIORITY), FzMemoryUsage().c_str(),
         search_name_.c_str()));
     parallel_support->FinalOutput(p.worker_id, final_output);
+    if (!p.csv_output.empty()) {
+      AppendCsvStatistics(
+          p, StringPrintf(
+                 "%s,%s,%s,%d,%d,%" GG_LL_FORMAT "d,%" GG_LL_FORMAT
+                 "d,%" GG_LL_FORMAT "d,%" GG_LL_FORMAT "d,%" GG_LL_FORMAT
+                 "d,%" GG_LL_FORMAT "d,%" GG_LL_FORMAT "d,%" GG_LL_FORMAT
+                 "d,%s",
+                 model_.name().c_str(), status_string.c_str(),
+                 obj_string.c_str(), num_solutions, p.threads,
+                 p.parse_time_in_ms, p.presolve_time_in_ms, build_time,
+                 solve_time, parallel_support->FirstSolutionTime(),
+                 parallel_support->LastSolutionTime(), solver()->branches(),
+                 solver()->failures(), search_name_.c_str()));
+    }
   }
 }
 }  // namespace operations_research
@@ -13,6 +13,7 @@
 #ifndef OR_TOOLS_FLATZINC_SEARCH_H_
 #define OR_TOOLS_FLATZINC_SEARCH_H_
 
+#include "base/timer.h"
 #include "constraint_solver/constraint_solver.h"
 #include "flatzinc/model.h"
 
@@ -46,13 +47,21 @@ struct FzSolverParameters {
   int worker_id;
   int64 time_limit_in_ms;
   SearchType search_type;
+  // Time spent before the solver, reported in the final statistics.
+  int64 parse_time_in_ms;
+  int64 presolve_time_in_ms;
+  // If not empty, the final statistics are also appended, as a line of
+  // comma-separated values, to this file.
+  std::string csv_output;
 };
 
 // This class is used to abstract the interface to parallelism from
 // the search code. It offers two sets of API:
-//    - Create specific search objects (Objective(), Limit(), Log()).
+//    - Create specific search objects (Objective(), Limit(),
+//                                      RootBoundSharing(), Log()).
 //    - Report solution (SatSolution(), OptimizeSolution(), FinalOutput(),
 //                       EndSearch(), BestSolution(), Interrupted()).
+//    - Reassign stalled workers (ShouldReassign(), ReassignedTo()).
 class FzParallelSupportInterface {
  public:
   enum Type {
@@ -62,7 +71,12 @@ class FzParallelSupportInterface {
     MAXIMIZE,
   };
 
-  FzParallelSupportInterface() : num_solutions_(0) {}
+  FzParallelSupportInterface()
+      : num_solutions_(0),
+        first_solution_time_in_ms_(-1),
+        last_solution_time_in_ms_(-1) {
+    timer_.Start();
+  }
   virtual ~FzParallelSupportInterface() {}
   // Initialize the interface for a given worker id.
   // In sequential mode, the worker id is always -1.
@@ -71,13 +85,15 @@ class FzParallelSupportInterface {
   // Callback on the start search event.
   virtual void StartSearch(int worker_id, Type type) = 0;
   // Worker 'worker_id' notifies a new solution in a satisfaction
-  // problem. 'solution_string' is the solution to display if needed.
+  // problem. 'solution_values' are the values of the output variables, as
+  // collected by FzSolver::CollectSolutionValues(); they are formatted with
+  // AppendFzSolution() only if the solution is displayed.
   virtual void SatSolution(int worker_id,
-                           const std::string& solution_string) = 0;
+                           const std::vector<int64>& solution_values) = 0;
   // Worker 'worker_id' notifies a new solution in an optimization
-  // problem. 'solution_string' is the solution to display if needed.
+  // problem. 'solution_values' are as in SatSolution().
   virtual void OptimizeSolution(int worker_id, int64 value,
-                                const std::string& solution_string) = 0;
+                                const std::vector<int64>& solution_values) = 0;
   // Worker 'worker_id' sends its final output (mostly search
   // statistics) to display.
   virtual void FinalOutput(int worker_id, const std::string& final_output) = 0;
@@ -93,27 +109,69 @@ class FzParallelSupportInterface {
                                  int64 step, int worker_id) = 0;
   // Creates a dedicated search limit.
   virtual SearchLimit* Limit(Solver* s, int worker_id) = 0;
+  // Creates a dedicated search monitor that shares the root bounds of
+  // 'vars' with the other workers, which must pass the same variables in
+  // the same order. Returns nullptr if there is nobody to share with.
+  virtual SearchMonitor* RootBoundSharing(Solver* s,
+                                          const std::vector<IntVar*>& vars,
+                                          int worker_id) = 0;
   // Creates a dedicated search log.
   virtual void Log(int worker_id, const std::string& message) = 0;
   // Returns if the search was interrupted, usually by a time or
   // solution limit.
   virtual bool Interrupted() const = 0;
+  // Returns true if the search of 'worker_id' should stop, as it has not
+  // improved the objective for a while when another worker did. Once it
+  // returns true, it does so until the next StartSearch() of the worker.
+  virtual bool ShouldReassign(int worker_id) = 0;
+  // Returns the worker whose strategy 'worker_id' should adopt if its search
+  // was stopped by ShouldReassign(), or -1. Such a search ends without
+  // calling EndSearch(), as the worker starts a new one.
+  virtual int ReassignedTo(int worker_id) const = 0;
 
   // Increments the number of solutions found.
-  void IncrementSolutions() { num_solutions_++; }
+  void IncrementSolutions() {
+    const int64 time_in_ms = timer_.GetInMs();
+    if (num_solutions_ == 0) {
+      first_solution_time_in_ms_ = time_in_ms;
+    }
+    last_solution_time_in_ms_ = time_in_ms;
+    num_solutions_++;
+  }
   // Returns the number of solutions found.
   int NumSolutions() const { return num_solutions_; }
+  // Returns the wall time at which the first (resp. last) solution was
+  // found, in ms since the creation of the interface, which happens just
+  // before the extraction of the model. Returns -1 if there is none.
+  int64 FirstSolutionTime() const { return first_solution_time_in_ms_; }
+  int64 LastSolutionTime() const { return last_solution_time_in_ms_; }
 
  private:
   int num_solutions_;
+  WallTimer timer_;
+  int64 first_solution_time_in_ms_;
+  int64 last_solution_time_in_ms_;
 };
 
-// Create an interface suitable for a sequential search.
-FzParallelSupportInterface* MakeSequentialSupport(bool print_all,
+// Appends to *output the text of a solution of 'model': one line per output
+// annotation, followed by the "----------" separator. 'values' are the values
+// of the output variables, as collected by FzSolver::CollectSolutionValues().
+void AppendFzSolution(const FzModel& model, const std::vector<int64>& values,
+                      std::string* output);
+
+// Create an interface suitable for a sequential search. The interface
+// formats the solutions of 'model', which must outlive it.
+FzParallelSupportInterface* MakeSequentialSupport(const FzModel& model,
+                                                  bool print_all,
                                                   int num_solutions);
-// Creates an interface suitable for a multi-threaded search.
-FzParallelSupportInterface* MakeMtSupport(bool print_all, int num_solutions,
-                                          bool verbose);
+// Creates an interface suitable for a multi-threaded search with
+// 'num_workers' workers. If 'reassignment_period_in_ms' is positive, workers
+// other than worker 0 that have not improved the objective for that long are
+// reassigned (see ShouldReassign()).
+FzParallelSupportInterface* MakeMtSupport(const FzModel& model, bool print_all,
+                                          int num_solutions, bool verbose,
+                                          int num_workers,
+                                          int64 reassignment_period_in_ms);
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_FLATZINC_SEARCH_H_
@@ -12,6 +12,7 @@
 // limitations under the License.
 #include <iostream>  // NOLINT
 #include <string>
+#include <vector>
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
@@ -26,10 +27,13 @@ namespace operations_research {
 namespace {
 class SequentialSupportInterface : public FzParallelSupportInterface {
  public:
-  SequentialSupportInterface(bool print_all, int num_solutions)
-      : print_all_(print_all),
+  SequentialSupportInterface(const FzModel& model, bool print_all,
+                             int num_solutions)
+      : model_(model),
+        print_all_(print_all),
         num_solutions_(num_solutions),
         type_(UNDEF),
+        has_last_solution_(false),
         best_solution_(0),
         interrupted_(false) {}
 
@@ -48,20 +52,24 @@ class SequentialSupportInterface : public FzParallelSupportInterface {
     }
   }
 
-  virtual void SatSolution(int worker_id, const std::string& solution_string) {
+  virtual void SatSolution(int worker_id,
+                           const std::vector<int64>& solution_values) {
     if (NumSolutions() < num_solutions_ || print_all_) {
-      std::cout << solution_string << std::endl;
+      PrintSolution(solution_values);
     }
     IncrementSolutions();
   }
 
   virtual void OptimizeSolution(int worker_id, int64 value,
-                                const std::string& solution_string) {
+                                const std::vector<int64>& solution_values) {
     best_solution_ = value;
     if (print_all_ || num_solutions_ > 1) {
-      std::cout << solution_string << std::endl;
+      PrintSolution(solution_values);
     } else {
-      last_solution_ = solution_string + "\n";
+      // Only the last solution is printed: keep its values, and format it
+      // at the end of the search.
+      last_solution_values_ = solution_values;
+      has_last_solution_ = true;
     }
     IncrementSolutions();
   }
@@ -73,8 +81,9 @@ class SequentialSupportInterface : public FzParallelSupportInterface {
   virtual bool ShouldFinish() const { return false; }
 
   virtual void EndSearch(int worker_id, bool interrupted) {
-    if (!last_solution_.empty()) {
-      std::cout << last_solution_;
+    if (has_last_solution_) {
+      PrintSolution(last_solution_values_);
+      has_last_solution_ = false;
     }
     interrupted_ = interrupted;
   }
@@ -88,24 +97,47 @@ class SequentialSupportInterface : public FzParallelSupportInterface {
 
   virtual SearchLimit* Limit(Solver* s, int worker_id) { return nullptr; }
 
+  virtual SearchMonitor* RootBoundSharing(Solver* s,
+                                          const std::vector<IntVar*>& vars,
+                                          int worker_id) {
+    return nullptr;
+  }
+
   virtual void Log(int worker_id, const std::string& message) {
     std::cout << "%%  worker " << worker_id << ": " << message << std::endl;
   }
 
   virtual bool Interrupted() const { return interrupted_; }
 
+  virtual bool ShouldReassign(int worker_id) { return false; }
+
+  virtual int ReassignedTo(int worker_id) const { return -1; }
+
  private:
+  // Formats the solution into a reused buffer, and writes it at once.
+  void PrintSolution(const std::vector<int64>& solution_values) {
+    output_buffer_.clear();
+    AppendFzSolution(model_, solution_values, &output_buffer_);
+    output_buffer_.push_back('\n');
+    std::cout.write(output_buffer_.data(), output_buffer_.size());
+    std::cout.flush();
+  }
+
+  const FzModel& model_;
   const bool print_all_;
   const int num_solutions_;
   Type type_;
-  std::string last_solution_;
+  std::vector<int64> last_solution_values_;
+  bool has_last_solution_;
+  std::string output_buffer_;
   int64 best_solution_;
   bool interrupted_;
 };
 }  // namespace
 
-FzParallelSupportInterface* MakeSequentialSupport(bool print_all,
+FzParallelSupportInterface* MakeSequentialSupport(const FzModel& model,
+                                                  bool print_all,
                                                   int num_solutions) {
-  return new SequentialSupportInterface(print_all, num_solutions);
+  return new SequentialSupportInterface(model, print_all, num_solutions);
 }
 }  // namespace operations_research
@@ -108,41 +108,30 @@ int64 FzSolver::SolutionValue(FzIntegerVariable* var) {
 }
 
 // The format is fixed in the flatzinc specification.
-std::string FzSolver::SolutionString(const FzOnSolutionOutput& output) {
-  if (output.variable != nullptr) {
-    const int64 value = SolutionValue(output.variable);
-    if (output.is_boolean) {
-      return StringPrintf("%s = %s;", output.name.c_str(),
-                          value == 1 ? "true" : "false");
+IntExpr* FzSolver::OutputExpression(FzIntegerVariable* var) {
+  IntExpr* const result = FindPtrOrNull(extrated_map_, var);
+  if (result != nullptr) {
+    return result;
+  }
+  CHECK(var->domain.IsSingleton());
+  return solver_.MakeIntConst(var->domain.values[0]);
+}
+
+void FzSolver::CollectSolutionValues(std::vector<int64>* values) const {
+  values->resize(output_expressions_.size());
+  for (int i = 0; i < output_expressions_.size(); ++i) {
+    IntExpr* const expr = output_expressions_[i];
+    if (expr->IsVar()) {
+      (*values)[i] = expr->Var()->Value();
     } else {
-      return StringPrintf("%s = %" GG_LL_FORMAT "d;", output.name.c_str(),
-                          value);
-    }
-  } else {
-    const int bound_size = output.bounds.size();
-    std::string result =
-        StringPrintf("%s = array%dd(", output.name.c_str(), bound_size);
-    for (int i = 0; i < bound_size; ++i) {
-      result.append(
-          StringPrintf("%" GG_LL_FORMAT "d..%" GG_LL_FORMAT "d, ",
-                       output.bounds[i].min_value, output.bounds[i].max_value));
-    }
-    result.append("[");
-    for (int i = 0; i < output.flat_variables.size(); ++i) {
-      const int64 value = SolutionValue(output.flat_variables[i]);
-      if (output.is_boolean) {
-        result.append(StringPrintf(value ? "true" : "false"));
-      } else {
-        result.append(StringPrintf("%" GG_LL_FORMAT "d", value));
-      }
-      if (i != output.flat_variables.size() - 1) {
-        result.append(", ");
-      }
+      int64 emin = 0;
+      int64 emax = 0;
+      expr->Range(&emin, &emax);
+      CHECK_EQ(emin, emax) << "Expression " << expr->DebugString()
+                           << " is not fixed to a single value at a solution";
+      (*values)[i] = emin;
     }
-    result.append("]);");
-    return result;
   }
-  return "";
 }
 
 namespace {
@@ -195,55 +184,24 @@ struct ConstraintWithIoComparator {
     return false;
   }
 };
-}  // namespace
 
-bool FzSolver::Extract() {
-  // Create the sat solver.
-  if (FLAGS_use_sat) {
-    FZLOG << "  - Use sat" << FZENDL;
-    sat_ = MakeSatPropagator(&solver_);
-    solver_.AddConstraint(reinterpret_cast<Constraint*>(sat_));
-  } else {
-    sat_ = nullptr;
-  }
-  // Build statistics.
-  statistics_.BuildStatistics();
-  // Extract variables.
-  FZLOG << "Extract variables" << FZENDL;
-  int extracted_variables = 0;
-  int skipped_variables = 0;
+// Sorts the active constraints such that defined variables are created before
+// the extraction of the constraints that use them. When a cycle of defined
+// variables prevents it, the cycle is broken by removing the definition of
+// one of its variables, which modifies the model.
+void SortConstraintsForExtraction(const FzModel& model,
+                                  std::vector<FzConstraint*>* sorted) {
   hash_set<FzIntegerVariable*> defined_variables;
-  for (FzIntegerVariable* const var : model_.variables()) {
-    if (var->defining_constraint == nullptr && var->active) {
-      Extract(var);
-      extracted_variables++;
-    } else {
-      FZVLOG << "Skip " << var->DebugString() << FZENDL;
-      if (var->defining_constraint != nullptr) {
-        FZVLOG << "  - defined by " << var->defining_constraint->DebugString()
-               << FZENDL;
-      }
+  for (FzIntegerVariable* const var : model.variables()) {
+    if (var->defining_constraint != nullptr || !var->active) {
       defined_variables.insert(var);
-      skipped_variables++;
-    }
-  }
-  FZLOG << "  - " << extracted_variables << " variables created" << FZENDL;
-  FZLOG << "  - " << skipped_variables << " variables skipped" << FZENDL;
-  // Parse model to store info.
-  FZLOG << "Extract constraints" << FZENDL;
-  for (FzConstraint* const ct : model_.constraints()) {
-    if (ct->type == "all_different_int") {
-      StoreAllDifferent(ct->Arg(0).variables);
     }
   }
-  // Sort constraints such that defined variables are created before the
-  // extraction of the constraints that use them.
   int index = 0;
   std::vector<ConstraintWithIo*> to_sort;
-  std::vector<FzConstraint*> sorted;
   hash_map<const FzIntegerVariable*, std::vector<ConstraintWithIo*>>
       dependencies;
-  for (FzConstraint* ct : model_.constraints()) {
+  for (FzConstraint* ct : model.constraints()) {
     if (ct != nullptr && ct->active) {
       ConstraintWithIo* const ctio =
           new ConstraintWithIo(ct, index++, defined_variables);
@@ -289,7 +247,7 @@ bool FzSolver::Extract() {
     FZDLOG << "Pop " << ctio->ct->DebugString() << FZENDL;
     CHECK(ctio->required.empty());
     // TODO(user): Implement recovery mode.
-    sorted.push_back(ctio->ct);
+    sorted->push_back(ctio->ct);
     FzIntegerVariable* const var = ctio->ct->target_variable;
     if (var != nullptr && ContainsKey(dependencies, var)) {
       FZDLOG << "  - clean " << var->DebugString() << FZENDL;
@@ -299,6 +257,65 @@ bool FzSolver::Extract() {
     }
     delete ctio;
   }
+}
+
+// Canonicalizes the {0, 1} domains of the defined variables into [0 .. 1].
+void CanonicalizeDefinedDomains(const FzModel& model) {
+  for (FzIntegerVariable* const var : model.variables()) {
+    if (var->defining_constraint != nullptr && var->active &&
+        !var->domain.is_interval && var->domain.values.size() == 2 &&
+        var->domain.values[0] == 0 && var->domain.values[1] == 1) {
+      var->domain.is_interval = true;
+    }
+  }
+}
+}  // namespace
+
+void FzSolver::PrepareModelForExtraction(FzModel* model) {
+  std::vector<FzConstraint*> sorted;
+  SortConstraintsForExtraction(*model, &sorted);
+  CanonicalizeDefinedDomains(*model);
+}
+
+bool FzSolver::Extract() {
+  // Create the sat solver.
+  if (FLAGS_use_sat) {
+    FZLOG << "  - Use sat" << FZENDL;
+    sat_ = MakeSatPropagator(&solver_);
+    solver_.AddConstraint(reinterpret_cast<Constraint*>(sat_));
+  } else {
+    sat_ = nullptr;
+  }
+  // Build statistics.
+  statistics_.BuildStatistics();
+  // Extract variables.
+  FZLOG << "Extract variables" << FZENDL;
+  int extracted_variables = 0;
+  int skipped_variables = 0;
+  for (FzIntegerVariable* const var : model_.variables()) {
+    if (var->defining_constraint == nullptr && var->active) {
+      Extract(var);
+      extracted_variables++;
+    } else {
+      FZVLOG << "Skip " << var->DebugString() << FZENDL;
+      if (var->defining_constraint != nullptr) {
+        FZVLOG << "  - defined by " << var->defining_constraint->DebugString()
+               << FZENDL;
+      }
+      skipped_variables++;
+    }
+  }
+  FZLOG << "  - " << extracted_variables << " variables created" << FZENDL;
+  FZLOG << "  - " << skipped_variables << " variables skipped" << FZENDL;
+  // Parse model to store info.
+  FZLOG << "Extract constraints" << FZENDL;
+  for (FzConstraint* const ct : model_.constraints()) {
+    if (ct->type == "all_different_int") {
+      StoreAllDifferent(ct->Arg(0).variables);
+    }
+  }
+  std::vector<FzConstraint*> sorted;
+  SortConstraintsForExtraction(model_, &sorted);
   for (FzConstraint* const ct : sorted) {
     ExtractConstraint(ct);
   }
@@ -318,15 +335,11 @@ bool FzSolver::Extract() {
   }
 
   // Add domain constraints to created expressions.
+  CanonicalizeDefinedDomains(model_);
   int domain_constraints = 0;
   for (FzIntegerVariable* const var : model_.variables()) {
     if (var->defining_constraint != nullptr && var->active) {
       const FzDomain& domain = var->domain;
-      if (!domain.is_interval && domain.values.size() == 2 &&
-          domain.values[0] == 0 && domain.values[1] == 1) {
-        // Canonicalize domains: {0, 1} -> [0 ,, 1]
-        var->domain.is_interval = true;
-      }
       IntExpr* const expr = Extract(var);
       if (expr->IsVar() && domain.is_interval && !domain.values.empty() &&
           (expr->Min() < domain.values[0] || expr->Max() > domain.values[1])) {
@@ -41,6 +41,11 @@ class FzSolver {
              FzParallelSupportInterface* parallel_support);
 
   // Extraction support.
+  // Extract() breaks the cycles of defined variables of the model and
+  // normalizes some domains, which modifies the model. Once this method has
+  // been called on the model, Extract() no longer modifies it, and several
+  // FzSolvers can extract it concurrently.
+  static void PrepareModelForExtraction(FzModel* model);
   bool Extract();
   IntExpr* GetExpression(const FzArgument& argument);
   std::vector<IntVar*> GetVariableArray(const FzArgument& argument);
@@ -49,7 +54,10 @@ class FzSolver {
   bool IsAllDifferent(const std::vector<FzIntegerVariable*>& diffs) const;
 
   // Output support.
-  std::string SolutionString(const FzOnSolutionOutput& output);
+  // Stores in *values the values of all the output variables at the current
+  // solution, in the order of the output annotations of the model. The
+  // solution is formatted later, and only if needed, by AppendFzSolution().
+  void CollectSolutionValues(std::vector<int64>* values) const;
 
   int64 SolutionValue(FzIntegerVariable* var);
 
@@ -75,6 +83,9 @@ class FzSolver {
   DecisionBuilder* CreateDecisionBuilders(const FzSolverParameters& p,
                                           SearchLimit* limit);
   void CollectOutputVariables(std::vector<IntVar*>* output_variables);
+  // Returns the expression of an output variable, which is a constant if
+  // the variable was not extracted.
+  IntExpr* OutputExpression(FzIntegerVariable* var);
   void SyncWithModel();
 
   const FzModel& model_;
@@ -87,6 +98,9 @@ class FzSolver {
   std::string search_name_;
   IntVar* objective_var_;
   OptimizeVar* objective_monitor_;
+  // The expressions of the output variables, flattened in the order of the
+  // output annotations.
+  std::vector<IntExpr*> output_expressions_;
   // Alldiff info before extraction
   void StoreAllDifferent(const std::vector<FzIntegerVariable*>& diffs);
   hash_map<const FzIntegerVariable*,
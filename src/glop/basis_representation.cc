@@ -212,6 +212,13 @@ Status BasisFactorization::Initialize() {
   return lu_factorization_.ComputeFactorization(basis_matrix);
 }
 
+Status BasisFactorization::InitializeForNewColumns() {
+  if (!IsRefactorized()) return ForceRefactorization();
+  left_pool_mapping_.assign(matrix_.num_cols(), kInvalidCol);
+  right_pool_mapping_.assign(matrix_.num_cols(), kInvalidCol);
+  return Status::OK;
+}
+
 bool BasisFactorization::IsRefactorized() const { return num_updates_ == 0; }
 
 Status BasisFactorization::Refactorize() {
@@ -363,6 +370,92 @@ void BasisFactorization::RightSolveWithNonZeros(
   }
 }
 
+void BasisFactorization::RightSolveMultiple(
+    const std::vector<DenseColumn*>& d) const {
+  SCOPED_TIME_STAT(&stats_);
+  const int num_rhs = d.size();
+  for (int i = 0; i < num_rhs; ++i) {
+    BumpDeterministicTimeForSolve(matrix_.num_rows().value());
+  }
+  if (use_middle_product_form_update_) {
+    lu_factorization_.RightSolveLMultiple(d);
+    RightSolveUpdatesMultiple(d);
+    lu_factorization_.RightSolveUMultiple(d);
+  } else {
+    lu_factorization_.RightSolveMultiple(d);
+    RightSolveUpdatesMultiple(d);
+  }
+}
+
+void BasisFactorization::LeftSolveMultiple(
+    const std::vector<DenseRow*>& y) const {
+  SCOPED_TIME_STAT(&stats_);
+  const int num_rhs = y.size();
+  for (int i = 0; i < num_rhs; ++i) {
+    BumpDeterministicTimeForSolve(matrix_.num_rows().value());
+  }
+  if (use_middle_product_form_update_) {
+    lu_factorization_.LeftSolveUMultiple(y);
+    LeftSolveUpdatesMultiple(y);
+    lu_factorization_.LeftSolveLMultiple(y);
+  } else {
+    LeftSolveUpdatesMultiple(y);
+    lu_factorization_.LeftSolveMultiple(y);
+  }
+}
+
+void BasisFactorization::RightSolveForProblemColumns(
+    const std::vector<ColIndex>& cols,
+    const std::vector<DenseColumn*>& d) const {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK_EQ(cols.size(), d.size());
+  problem_columns_.clear();
+  for (const ColIndex col : cols) {
+    problem_columns_.push_back(&matrix_.column(col));
+    BumpDeterministicTimeForSolve(matrix_.column(col).num_entries().value());
+  }
+  if (use_middle_product_form_update_) {
+    lu_factorization_.RightSolveLForSparseColumns(problem_columns_,
+                                                  matrix_.num_rows(), d);
+    RightSolveUpdatesMultiple(d);
+    lu_factorization_.RightSolveUMultiple(d);
+  } else {
+    lu_factorization_.SparseRightSolveMultiple(problem_columns_,
+                                               matrix_.num_rows(), d);
+    RightSolveUpdatesMultiple(d);
+  }
+}
+
+void BasisFactorization::RightSolveUpdatesMultiple(
+    const std::vector<DenseColumn*>& d) const {
+  const int num_rhs = d.size();
+#ifdef OMP
+#pragma omp parallel for num_threads(parameters_.num_omp_threads())
+#endif
+  for (int i = 0; i < num_rhs; ++i) {
+    if (use_middle_product_form_update_) {
+      rank_one_factorization_.RightSolve(d[i]);
+    } else {
+      eta_factorization_.RightSolve(d[i]);
+    }
+  }
+}
+
+void BasisFactorization::LeftSolveUpdatesMultiple(
+    const std::vector<DenseRow*>& y) const {
+  const int num_rhs = y.size();
+#ifdef OMP
+#pragma omp parallel for num_threads(parameters_.num_omp_threads())
+#endif
+  for (int i = 0; i < num_rhs; ++i) {
+    if (use_middle_product_form_update_) {
+      rank_one_factorization_.LeftSolve(y[i]);
+    } else {
+      eta_factorization_.LeftSolve(y[i]);
+    }
+  }
+}
+
 DenseColumn* BasisFactorization::RightSolveForTau(ScatteredColumnReference a)
     const {
   SCOPED_TIME_STAT(&stats_);
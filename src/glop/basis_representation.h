@@ -184,6 +184,12 @@ class BasisFactorization {
   // could not be factorized.
   Status Initialize() MUST_USE_RESULT;
 
+  // To be called when new columns were added to matrix_ and basis_ was
+  // remapped accordingly, but the basis matrix itself is the same. If the
+  // factorization was just recomputed, it is kept as is and only the internal
+  // data indexed by columns is resized. Otherwise, this refactorizes the basis.
+  Status InitializeForNewColumns() MUST_USE_RESULT;
+
   // Return the number of rows in the basis.
   RowIndex GetNumberOfRows() const { return matrix_.num_rows(); }
 
@@ -226,6 +232,17 @@ class BasisFactorization {
   void RightSolveWithNonZeros(DenseColumn* d,
                               std::vector<RowIndex>* non_zeros) const;
 
+  // Solves the same systems as RightSolve(), LeftSolve() and
+  // RightSolveForProblemColumn() for many right-hand sides at once, see
+  // LuFactorization::RightSolveMultiple(). This is faster than doing the
+  // solves one by one when many of them are needed with the same basis, for
+  // instance for strong branching or sensitivity analysis. When compiled with
+  // OMP, the work is split among parameters_.num_omp_threads() threads.
+  void RightSolveMultiple(const std::vector<DenseColumn*>& d) const;
+  void LeftSolveMultiple(const std::vector<DenseRow*>& y) const;
+  void RightSolveForProblemColumns(const std::vector<ColIndex>& cols,
+                                   const std::vector<DenseColumn*>& d) const;
+
   // Specialized version for ComputeTau() in DualEdgeNorms. This reuses an
   // intermediate result of the last LeftSolveForUnitRow() in order to save a
   // permutation. Note that the input 'a' should actually be equal to the last
@@ -292,6 +309,12 @@ class BasisFactorization {
   Status MiddleProductFormUpdate(ColIndex entering_col,
                                  RowIndex leaving_variable_row) MUST_USE_RESULT;
 
+  // Applies the updates since the last refactorization to each of the given
+  // rhs. This is the part of RightSolveMultiple() and LeftSolveMultiple() that
+  // is done one rhs at a time.
+  void RightSolveUpdatesMultiple(const std::vector<DenseColumn*>& d) const;
+  void LeftSolveUpdatesMultiple(const std::vector<DenseRow*>& y) const;
+
   // Increases the deterministic time for a solve operation with a vector having
   // this number of non-zero entries (it can be an approximation).
   void BumpDeterministicTimeForSolve(int num_entries) const;
@@ -319,6 +342,9 @@ class BasisFactorization {
   mutable DenseColumn scratchpad_;
   mutable std::vector<RowIndex> scratchpad_non_zeros_;
 
+  // Used by RightSolveForProblemColumns() to store the columns to solve.
+  mutable std::vector<const SparseColumn*> problem_columns_;
+
   // This is used by RightSolveForTau(). It holds an intermediate result from
   // the last LeftSolveForUnitRow() and also the final result of
   // RightSolveForTau().
@@ -0,0 +1,78 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "glop/crossover.h"
+
+#include "base/logging.h"
+
+namespace operations_research {
+namespace glop {
+
+BasisState ComputeCrossoverBasis(const SparseMatrix& matrix,
+                                 const VariableStatusRow& statuses,
+                                 const std::vector<ColIndex>& candidates,
+                                 Markowitz* markowitz) {
+  const RowIndex num_rows = matrix.num_rows();
+  const ColIndex num_structural_cols = matrix.num_cols();
+  DCHECK_EQ(statuses.size(), num_structural_cols + RowToColIndex(num_rows));
+  BasisState state;
+  state.num_rows = num_rows;
+  state.num_cols = num_structural_cols;
+  state.statuses = statuses;
+
+  SparseMatrix identity_matrix;
+  identity_matrix.PopulateFromIdentity(RowToColIndex(num_rows));
+  MatrixView matrix_with_slack;
+  matrix_with_slack.PopulateFromMatrixPair(matrix, identity_matrix);
+  // A basis has num_rows columns, and the Markowitz algorithm needs a matrix
+  // with at most as many columns as rows, so only the num_rows candidates of
+  // highest priority are considered.
+  RowToColMapping candidate_columns;
+  for (const ColIndex col : candidates) {
+    if (candidate_columns.size() == num_rows) break;
+    candidate_columns.push_back(col);
+  }
+  MatrixView candidate_matrix;
+  candidate_matrix.PopulateFromBasis(matrix_with_slack, candidate_columns);
+
+  // Note that an error just means that the candidates are not linearly
+  // independent, in which case the permutations still describe a maximal set
+  // of independent candidates.
+  RowPermutation row_perm;
+  ColumnPermutation col_perm;
+  const Status status = markowitz->ComputeRowAndColumnPermutation(
+      candidate_matrix, &row_perm, &col_perm);
+  if (!status.ok()) {
+    VLOG(1) << "The crossover candidates are not linearly independent.";
+  }
+  int num_basic_candidates = 0;
+  for (RowIndex i(0); i < candidate_columns.size(); ++i) {
+    if (col_perm[RowToColIndex(i)] != kInvalidCol) {
+      state.statuses[candidate_columns[i]] = VariableStatus::BASIC;
+      ++num_basic_candidates;
+    }
+  }
+  for (RowIndex row(0); row < num_rows; ++row) {
+    if (row_perm[row] == kInvalidRow) {
+      state.statuses[num_structural_cols + RowToColIndex(row)] =
+          VariableStatus::BASIC;
+    }
+  }
+  VLOG(1) << "Crossover basis: " << num_basic_candidates << " of the "
+          << candidates.size() << " candidates are basic.";
+  return state;
+}
+
+}  // namespace glop
+}  // namespace operations_research
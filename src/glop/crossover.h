@@ -0,0 +1,48 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Derives a simplex basis from a solution that is not basic, like the ones of
+// the interior point and first-order methods, so that RevisedSimplex can
+// "cross over" from it to an optimal basic solution.
+
+#ifndef OR_TOOLS_GLOP_CROSSOVER_H_
+#define OR_TOOLS_GLOP_CROSSOVER_H_
+
+#include <vector>
+
+#include "glop/markowitz.h"
+#include "glop/revised_simplex.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/sparse.h"
+
+namespace operations_research {
+namespace glop {
+
+// Returns a basis in the format used by RevisedSimplex for a problem with the
+// given constraint matrix A, whose variables are the columns of [A | I] (the
+// slack variables come last). The status of each non-basic variable is the
+// one given in 'statuses' (FIXED_VALUE, AT_LOWER_BOUND, AT_UPPER_BOUND or
+// FREE). The 'candidates' are the variables that should be basic, by
+// decreasing priority: a maximal set of linearly independent candidates among
+// the first num_rows ones is chosen with the Markowitz algorithm, and the
+// basis is completed with slack columns.
+BasisState ComputeCrossoverBasis(const SparseMatrix& matrix,
+                                 const VariableStatusRow& statuses,
+                                 const std::vector<ColIndex>& candidates,
+                                 Markowitz* markowitz);
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_CROSSOVER_H_
@@ -14,6 +14,8 @@
 
 #include "glop/entering_variable.h"
 
+#include <algorithm>
+#include <functional>
 #include <queue>
 
 #include "base/timer.h"
@@ -32,7 +34,8 @@ EnteringVariable::EnteringVariable(const VariablesInfo& variables_info,
       primal_edge_norms_(primal_edge_norms),
       parameters_(),
       rule_(GlopParameters::DANTZIG),
-      unused_columns_() {}
+      unused_columns_(),
+      num_iterations_since_refresh_(0) {}
 
 Status EnteringVariable::PrimalChooseEnteringColumn(ColIndex* entering_col) {
   SCOPED_TIME_STAT(&stats_);
@@ -43,6 +46,38 @@ Status EnteringVariable::PrimalChooseEnteringColumn(ColIndex* entering_col) {
   const bool kNested = true;
   const bool kSteepest = true;
 
+  if (parameters_.pricing_candidate_list_size() > 0) {
+    const DenseRow& reduced_costs = reduced_costs_->GetReducedCosts();
+    switch (rule_) {
+      case GlopParameters::DANTZIG:
+        if (parameters_.normalize_using_column_norm()) {
+          const DenseRow& norms = primal_edge_norms_->GetMatrixColumnNorms();
+          PartialPricingChooseEnteringColumn([&](ColIndex col) {
+            return fabs(reduced_costs[col]) / norms[col];
+          }, entering_col);
+        } else {
+          PartialPricingChooseEnteringColumn([&](ColIndex col) {
+            return fabs(reduced_costs[col]);
+          }, entering_col);
+        }
+        return Status::OK;
+      case GlopParameters::STEEPEST_EDGE: {
+        const DenseRow& weights = primal_edge_norms_->GetEdgeSquaredNorms();
+        PartialPricingChooseEnteringColumn([&](ColIndex col) {
+          return Square(reduced_costs[col]) / weights[col];
+        }, entering_col);
+        return Status::OK;
+      }
+      case GlopParameters::DEVEX: {
+        const DenseRow& weights = primal_edge_norms_->GetDevexWeights();
+        PartialPricingChooseEnteringColumn([&](ColIndex col) {
+          return fabs(reduced_costs[col]) / weights[col];
+        }, entering_col);
+        return Status::OK;
+      }
+    }
+  }
+
   switch (rule_) {
     case GlopParameters::DANTZIG:
       if (parameters_.use_nested_pricing()) {
@@ -110,34 +145,29 @@ struct ColWithRatio {
   Fractional coeff_magnitude;
 };
 
-}  // namespace
-
-Status EnteringVariable::DualChooseEnteringColumn(
-    const UpdateRow& update_row, Fractional cost_variation,
-    std::vector<ColIndex>* bound_flip_candidates, ColIndex* entering_col,
-    Fractional* pivot, Fractional* step) {
-  RETURN_ERROR_IF_NULL(entering_col);
-  RETURN_ERROR_IF_NULL(pivot);
-  const DenseRow& update_coefficient = update_row.GetCoefficients();
-  const DenseRow& reduced_costs = reduced_costs_->GetReducedCosts();
-  SCOPED_TIME_STAT(&stats_);
-
-  std::vector<ColWithRatio> breakpoints;
-  breakpoints.reserve(update_row.GetNonZeroPositions().size());
-  const Fractional threshold = parameters_.ratio_test_zero_threshold();
-  const DenseBitRow& can_decrease = variables_info_.GetCanDecreaseBitRow();
-  const DenseBitRow& can_increase = variables_info_.GetCanIncreaseBitRow();
-
-  // Harris ratio test. See below for more explanation. Here this is used to
-  // prune the first pass by not enqueueing ColWithRatio for columns that have
-  // a ratio greater than the current harris_ratio.
-  const VariableTypeRow& variable_type = variables_info_.GetTypeRow();
-  const Fractional harris_tolerance =
-      parameters_.harris_tolerance_ratio() *
-      reduced_costs_->GetDualFeasibilityTolerance();
+// Appends to breakpoints the columns in [begin, end) whose reduced cost changes
+// sign for a step in the direction given by cost_variation. This is the first
+// pass of DualChooseEnteringColumn(), and the Harris ratio is used to prune
+// the columns that will never be considered afterwards. Note that using a
+// larger Harris ratio (for instance by splitting the columns in chunks) only
+// adds breakpoints that will never be processed, so the final result does
+// not depend on how the columns are split.
+void AppendDualBreakpoints(ColIndexVector::const_iterator begin,
+                           ColIndexVector::const_iterator end,
+                           Fractional cost_variation,
+                           const DenseRow& update_coefficient,
+                           const DenseRow& reduced_costs,
+                           const VariablesInfo& variables_info,
+                           Fractional threshold, Fractional harris_tolerance,
+                           bool use_bound_flipping,
+                           std::vector<ColWithRatio>* breakpoints) {
+  const DenseBitRow& can_decrease = variables_info.GetCanDecreaseBitRow();
+  const DenseBitRow& can_increase = variables_info.GetCanIncreaseBitRow();
+  const VariableTypeRow& variable_type = variables_info.GetTypeRow();
   Fractional harris_ratio = std::numeric_limits<Fractional>::max();
+  for (ColIndexVector::const_iterator it = begin; it != end; ++it) {
+    const ColIndex col = *it;
 
-  for (const ColIndex col : update_row.GetNonZeroPositions()) {
     // We will add ratio * coeff to this column with a ratio positive or zero.
     // cost_variation makes sure the leaving variable will be dual-feasible
     // (its update coeff is sign(cost_variation) * 1.0).
@@ -147,29 +177,92 @@ Status EnteringVariable::DualChooseEnteringColumn(
     // In this case, at some point the reduced cost will be positive if not
     // already, and the column will be dual-infeasible.
     if (can_decrease.IsSet(col) && coeff > threshold) {
-      if (variable_type[col] != VariableType::UPPER_AND_LOWER_BOUNDED) {
+      if (!use_bound_flipping ||
+          variable_type[col] != VariableType::UPPER_AND_LOWER_BOUNDED) {
         if (-reduced_costs[col] > harris_ratio * coeff) continue;
         harris_ratio =
             std::min(harris_ratio, (-reduced_costs[col] + harris_tolerance) / coeff);
         harris_ratio = std::max(0.0, harris_ratio);
       }
-      breakpoints.push_back(ColWithRatio(col, -reduced_costs[col], coeff));
+      breakpoints->push_back(ColWithRatio(col, -reduced_costs[col], coeff));
       continue;
     }
 
     // In this case, at some point the reduced cost will be negative if not
     // already, and the column will be dual-infeasible.
     if (can_increase.IsSet(col) && coeff < -threshold) {
-      if (variable_type[col] != VariableType::UPPER_AND_LOWER_BOUNDED) {
+      if (!use_bound_flipping ||
+          variable_type[col] != VariableType::UPPER_AND_LOWER_BOUNDED) {
         if (reduced_costs[col] > harris_ratio * -coeff) continue;
         harris_ratio =
             std::min(harris_ratio, (reduced_costs[col] + harris_tolerance) / -coeff);
         harris_ratio = std::max(0.0, harris_ratio);
       }
-      breakpoints.push_back(ColWithRatio(col, reduced_costs[col], -coeff));
+      breakpoints->push_back(ColWithRatio(col, reduced_costs[col], -coeff));
       continue;
     }
   }
+}
+
+}  // namespace
+
+Status EnteringVariable::DualChooseEnteringColumn(
+    const UpdateRow& update_row, Fractional cost_variation,
+    std::vector<ColIndex>* bound_flip_candidates, ColIndex* entering_col,
+    Fractional* pivot, Fractional* step) {
+  RETURN_ERROR_IF_NULL(entering_col);
+  RETURN_ERROR_IF_NULL(pivot);
+  const DenseRow& update_coefficient = update_row.GetCoefficients();
+  const DenseRow& reduced_costs = reduced_costs_->GetReducedCosts();
+  SCOPED_TIME_STAT(&stats_);
+
+  std::vector<ColWithRatio> breakpoints;
+  breakpoints.reserve(update_row.GetNonZeroPositions().size());
+  const Fractional threshold = parameters_.ratio_test_zero_threshold();
+
+  // Harris ratio test. See below for more explanation. Here this is used to
+  // prune the first pass by not enqueueing ColWithRatio for columns that have
+  // a ratio greater than the current harris_ratio.
+  const VariableTypeRow& variable_type = variables_info_.GetTypeRow();
+  const Fractional harris_tolerance =
+      parameters_.harris_tolerance_ratio() *
+      reduced_costs_->GetDualFeasibilityTolerance();
+  const bool use_bound_flipping =
+      parameters_.use_dual_bound_flipping_ratio_test();
+
+#ifdef OMP
+  const int num_omp_threads = parameters_.num_omp_threads();
+#else
+  const int num_omp_threads = 1;
+#endif
+  const ColIndexVector& non_zeros = update_row.GetNonZeroPositions();
+  if (num_omp_threads == 1) {
+    AppendDualBreakpoints(non_zeros.begin(), non_zeros.end(), cost_variation,
+                          update_coefficient, reduced_costs, variables_info_,
+                          threshold, harris_tolerance, use_bound_flipping,
+                          &breakpoints);
+  } else {
+#ifdef OMP
+    // In the multi-threaded case, each thread collects the breakpoints of a
+    // chunk of the update row and they are concatenated afterwards.
+    const int size = non_zeros.size();
+    std::vector<std::vector<ColWithRatio>> thread_breakpoints(num_omp_threads);
+#pragma omp parallel for num_threads(num_omp_threads)
+    for (int i = 0; i < num_omp_threads; i++) {
+      const int begin = i * size / num_omp_threads;
+      const int end = (i + 1) * size / num_omp_threads;
+      AppendDualBreakpoints(non_zeros.begin() + begin, non_zeros.begin() + end,
+                            cost_variation, update_coefficient, reduced_costs,
+                            variables_info_, threshold, harris_tolerance,
+                            use_bound_flipping, &thread_breakpoints[i]);
+    }
+    // end of omp parallel for
+    for (int i = 0; i < num_omp_threads; i++) {
+      breakpoints.insert(breakpoints.end(), thread_breakpoints[i].begin(),
+                         thread_breakpoints[i].end());
+    }
+#endif  // OMP
+  }
 
   // Process the breakpoints in priority order as suggested by Maros in
   // I. Maros, "A generalized dual phase-2 simplex algorithm", European Journal
@@ -187,7 +280,7 @@ Status EnteringVariable::DualChooseEnteringColumn(
   //   will not contribute to the minimum Harris ratio.
   // - We thus have the actual harris_ratio.
   // - We have processed all breakpoints with a ratio smaller than it.
-  harris_ratio = std::numeric_limits<Fractional>::max();
+  Fractional harris_ratio = std::numeric_limits<Fractional>::max();
 
   *entering_col = kInvalidCol;
   bound_flip_candidates->clear();
@@ -210,7 +303,8 @@ Status EnteringVariable::DualChooseEnteringColumn(
     // Note that the actual flipping will be done afterwards by
     // MakeBoxedVariableDualFeasible() in revised_simplex.cc.
     bool variable_can_flip = false;
-    if (variable_type[top.col] == VariableType::UPPER_AND_LOWER_BOUNDED) {
+    if (use_bound_flipping &&
+        variable_type[top.col] == VariableType::UPPER_AND_LOWER_BOUNDED) {
       variation_magnitude -=
           variables_info_.GetBoundDifference(top.col) * top.coeff_magnitude;
       if (variation_magnitude > threshold) {
@@ -396,10 +490,12 @@ Status EnteringVariable::DualPhaseIChooseEnteringColumn(
 
 void EnteringVariable::SetParameters(const GlopParameters& parameters) {
   parameters_ = parameters;
+  pricing_candidates_.clear();
 }
 
 void EnteringVariable::SetPricingRule(GlopParameters::PricingRule rule) {
   rule_ = rule;
+  pricing_candidates_.clear();
 }
 
 DenseBitRow* EnteringVariable::ResetUnusedColumns() {
@@ -502,5 +598,93 @@ void EnteringVariable::NormalizedChooseEnteringColumn(ColIndex* entering_col) {
   }
 }
 
+namespace {
+
+typedef std::pair<Fractional, ColIndex> PricedColumn;
+
+// Keeps only the num_best columns with the highest prices.
+void KeepBestCandidates(int num_best, std::vector<PricedColumn>* candidates) {
+  if (candidates->size() > num_best) {
+    std::nth_element(candidates->begin(), candidates->begin() + num_best,
+                     candidates->end(), std::greater<PricedColumn>());
+    candidates->resize(num_best);
+  }
+}
+
+}  // namespace
+
+template <typename PriceFunction>
+void EnteringVariable::PartialPricingChooseEnteringColumn(
+    const PriceFunction& price, ColIndex* entering_col) {
+  SCOPED_TIME_STAT(&stats_);
+  const DenseBitRow& is_dual_infeasible =
+      reduced_costs_->GetDualInfeasiblePositions();
+  const ColIndex num_cols = is_dual_infeasible.size();
+  Fractional best_price(0.0);
+  *entering_col = kInvalidCol;
+  if (num_iterations_since_refresh_ <
+      parameters_.pricing_candidate_list_refresh_period()) {
+    for (const ColIndex col : pricing_candidates_) {
+      if (col >= num_cols || !is_dual_infeasible.IsSet(col)) continue;
+      const Fractional col_price = price(col);
+      if (col_price > best_price) {
+        best_price = col_price;
+        *entering_col = col;
+      }
+    }
+    if (*entering_col != kInvalidCol) {
+      ++num_iterations_since_refresh_;
+      return;
+    }
+  }
+
+  // Full pricing pass that refreshes the candidate list.
+  const int list_size = parameters_.pricing_candidate_list_size();
+  std::vector<PricedColumn> candidates;
+#ifdef OMP
+  const int num_omp_threads = parameters_.num_omp_threads();
+#else
+  const int num_omp_threads = 1;
+#endif
+  if (num_omp_threads == 1) {
+    for (const ColIndex col : is_dual_infeasible) {
+      candidates.push_back(PricedColumn(price(col), col));
+    }
+  } else {
+#ifdef OMP
+    // Each thread prices a section of the columns and keeps its best
+    // candidates, the best candidates overall are among them.
+    const int size = num_cols.value();
+    std::vector<std::vector<PricedColumn>> thread_candidates(num_omp_threads);
+#pragma omp parallel for num_threads(num_omp_threads)
+    for (int i = 0; i < num_omp_threads; i++) {
+      const ColIndex end(static_cast<int64>(i + 1) * size / num_omp_threads);
+      for (ColIndex col(static_cast<int64>(i) * size / num_omp_threads);
+           col < end; ++col) {
+        if (is_dual_infeasible.IsSet(col)) {
+          thread_candidates[i].push_back(PricedColumn(price(col), col));
+        }
+      }
+      KeepBestCandidates(list_size, &thread_candidates[i]);
+    }
+    // end of omp parallel for
+    for (int i = 0; i < num_omp_threads; i++) {
+      candidates.insert(candidates.end(), thread_candidates[i].begin(),
+                        thread_candidates[i].end());
+    }
+#endif  // OMP
+  }
+  KeepBestCandidates(list_size, &candidates);
+  pricing_candidates_.clear();
+  for (const PricedColumn& candidate : candidates) {
+    pricing_candidates_.push_back(candidate.second);
+    if (candidate.first > best_price) {
+      best_price = candidate.first;
+      *entering_col = candidate.second;
+    }
+  }
+  num_iterations_since_refresh_ = 1;
+}
+
 }  // namespace glop
 }  // namespace operations_research
@@ -111,6 +111,14 @@ class EnteringVariable {
   template <bool use_steepest_edge>
   void NormalizedChooseEnteringColumn(ColIndex* entering_col);
 
+  // Multiple pricing (see pricing_candidate_list_size in parameters.proto):
+  // chooses the candidate column with the best price(col), and only prices all
+  // the dual infeasible columns when the candidate list needs to be refreshed.
+  // price(col) must be positive for a dual infeasible column.
+  template <typename PriceFunction>
+  void PartialPricingChooseEnteringColumn(const PriceFunction& price,
+                                          ColIndex* entering_col);
+
   // Problem data that should be updated from outside.
   const VariablesInfo& variables_info_;
 
@@ -142,6 +150,11 @@ class EnteringVariable {
   // anyway.
   std::vector<ColIndex> equivalent_entering_choices_;
 
+  // The candidate list of the multiple pricing, and the number of iterations
+  // since it was last refreshed.
+  std::vector<ColIndex> pricing_candidates_;
+  int num_iterations_since_refresh_;
+
   DISALLOW_COPY_AND_ASSIGN(EnteringVariable);
 };
 
@@ -0,0 +1,400 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "glop/first_order.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "glop/crossover.h"
+#include "lp_data/lp_utils.h"
+#include "util/time_limit.h"
+
+namespace operations_research {
+namespace glop {
+
+namespace {
+
+// Number of iterations between two computations of the KKT error, which cost
+// as much as two iterations.
+const int kKktErrorPeriod = 64;
+
+// The restart criteria of PDLP: a restart happens if the KKT error of the
+// candidate decreased by kSufficientDecay since the last restart, or by
+// kNecessaryDecay and it increased since the last check, or if the iterations
+// since the last restart are more than kArtificialRestartFraction of all the
+// iterations.
+const Fractional kSufficientDecay = 0.2;
+const Fractional kNecessaryDecay = 0.8;
+const Fractional kArtificialRestartFraction = 0.36;
+
+// The step size is this fraction of the inverse of the estimated ||K||_2,
+// which is a lower bound of the actual norm.
+const Fractional kStepSizeFactor = 0.9;
+const int kNumPowerIterations = 30;
+
+// Above this KKT error, the problem is likely infeasible or unbounded and the
+// algorithm stops.
+const Fractional kDivergenceThreshold = 1e30;
+
+Fractional Project(Fractional value, Fractional lb, Fractional ub) {
+  return std::min(ub, std::max(lb, value));
+}
+
+}  // namespace
+
+FirstOrderSolver::FirstOrderSolver()
+    : lp_(nullptr),
+      num_rows_(0),
+      num_structural_cols_(0),
+      num_cols_(0),
+      num_col_chunks_(1),
+      num_row_chunks_(1),
+      step_size_(0.0),
+      primal_weight_(1.0),
+      problem_status_(ProblemStatus::INIT),
+      num_iterations_(0),
+      num_restarts_(0),
+      kkt_error_(kInfinity) {}
+
+void FirstOrderSolver::SetParameters(const GlopParameters& parameters) {
+  parameters_ = parameters;
+  markowitz_.SetParameters(parameters);
+}
+
+void FirstOrderSolver::Initialize(const LinearProgram& lp) {
+  lp_ = &lp;
+  num_rows_ = lp.num_constraints();
+  num_structural_cols_ = lp.num_variables();
+  num_cols_ = num_structural_cols_ + RowToColIndex(num_rows_);
+  const int num_threads = parameters_.num_omp_threads();
+  matrix_.PopulateFromMatrixView(MatrixView(lp.GetSparseMatrix()));
+  transpose_.PopulateFromTranspose(matrix_, num_threads);
+  num_col_chunks_ = ComputeNumColumnChunks(num_cols_, num_threads);
+  num_row_chunks_ = ComputeNumColumnChunks(RowToColIndex(num_rows_),
+                                           num_threads);
+
+  cost_.assign(num_cols_, 0.0);
+  lower_bound_.resize(num_cols_, 0.0);
+  upper_bound_.resize(num_cols_, 0.0);
+  for (ColIndex col(0); col < num_structural_cols_; ++col) {
+    cost_[col] = lp.GetObjectiveCoefficientForMinimizationVersion(col);
+    lower_bound_[col] = lp.variable_lower_bounds()[col];
+    upper_bound_[col] = lp.variable_upper_bounds()[col];
+  }
+  Fractional squared_bound_norm = 0.0;
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    const ColIndex col = num_structural_cols_ + RowToColIndex(row);
+    lower_bound_[col] = -lp.constraint_upper_bounds()[row];
+    upper_bound_[col] = -lp.constraint_lower_bounds()[row];
+    for (const Fractional bound : {lower_bound_[col], upper_bound_[col]}) {
+      if (IsFinite(bound)) squared_bound_norm += bound * bound;
+    }
+  }
+
+  // The starting point is the projection of zero on the bounds.
+  x_.assign(num_cols_, 0.0);
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    x_[col] = Project(0.0, lower_bound_[col], upper_bound_[col]);
+  }
+  y_.assign(num_rows_, 0.0);
+  average_x_ = x_;
+  average_y_ = y_;
+  restart_x_ = x_;
+  restart_y_ = y_;
+  next_x_.assign(num_cols_, 0.0);
+  reduced_costs_.assign(num_cols_, 0.0);
+  activities_.assign(num_rows_, 0.0);
+
+  // As in PDLP, the initial primal weight is the ratio of the norms of the
+  // objective and of the right-hand sides.
+  Fractional squared_cost_norm = 0.0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    squared_cost_norm += cost_[col] * cost_[col];
+  }
+  primal_weight_ = squared_cost_norm > 0.0 && squared_bound_norm > 0.0
+                       ? sqrt(squared_cost_norm / squared_bound_norm)
+                       : 1.0;
+  step_size_ = kStepSizeFactor / EstimateMatrixNorm();
+}
+
+void FirstOrderSolver::ComputeReducedCosts(const DenseColumn& y,
+                                           DenseRow* reduced_costs) const {
+  ForEachColumnChunk(
+      num_cols_, num_col_chunks_,
+      [this, &y, reduced_costs](int chunk, ColIndex begin, ColIndex end) {
+        for (ColIndex col = begin; col < end; ++col) {
+          Fractional value = cost_[col];
+          if (col >= num_structural_cols_) {
+            value -= y[ColToRowIndex(col - num_structural_cols_)];
+          } else {
+            for (const EntryIndex i : matrix_.Column(col)) {
+              value -= matrix_.EntryCoefficient(i) * y[matrix_.EntryRow(i)];
+            }
+          }
+          (*reduced_costs)[col] = value;
+        }
+      });
+}
+
+void FirstOrderSolver::ComputeActivities(const DenseRow& x,
+                                         DenseColumn* activities) const {
+  // The column of the transpose of index row is the row of A.
+  ForEachColumnChunk(
+      RowToColIndex(num_rows_), num_row_chunks_,
+      [this, &x, activities](int chunk, ColIndex begin, ColIndex end) {
+        for (ColIndex transposed_col = begin; transposed_col < end;
+             ++transposed_col) {
+          const RowIndex row = ColToRowIndex(transposed_col);
+          Fractional value = x[num_structural_cols_ + transposed_col];
+          for (const EntryIndex i : transpose_.Column(transposed_col)) {
+            value += transpose_.EntryCoefficient(i) *
+                     x[RowToColIndex(transpose_.EntryRow(i))];
+          }
+          (*activities)[row] = value;
+        }
+      });
+}
+
+Fractional FirstOrderSolver::EstimateMatrixNorm() {
+  // The power method on K^T.K, with -K^T.y computed as (c - K^T.y) - c.
+  DenseRow v(num_cols_, 1.0 / sqrt(num_cols_.value()));
+  Fractional norm = 1.0;
+  for (int i = 0; i < kNumPowerIterations; ++i) {
+    ComputeActivities(v, &activities_);
+    ComputeReducedCosts(activities_, &reduced_costs_);
+    Fractional squared_norm = 0.0;
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      v[col] = cost_[col] - reduced_costs_[col];
+      squared_norm += v[col] * v[col];
+    }
+    // ||K^T.K.v|| tends to ||K||_2^2 for a unit vector v.
+    const Fractional new_norm = sqrt(sqrt(squared_norm));
+    if (new_norm == 0.0) break;
+    norm = new_norm;
+    const Fractional inverse_norm = 1.0 / sqrt(squared_norm);
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      v[col] *= inverse_norm;
+    }
+  }
+  VLOG(1) << "PDHG: estimated ||K||_2 = " << norm;
+  return norm;
+}
+
+Fractional FirstOrderSolver::ComputeKktError(const DenseRow& x,
+                                             const DenseColumn& y) {
+  ComputeActivities(x, &activities_);
+  ComputeReducedCosts(y, &reduced_costs_);
+  Fractional max_primal_value = 0.0;
+  Fractional max_cost = 0.0;
+  Fractional dual_residual = 0.0;
+  Fractional primal_objective = 0.0;
+  Fractional dual_objective = 0.0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    max_primal_value = std::max(max_primal_value, fabs(x[col]));
+    max_cost = std::max(max_cost, fabs(cost_[col]));
+    primal_objective += cost_[col] * x[col];
+
+    // A positive (resp. negative) reduced cost must be "supported" by a finite
+    // lower (resp. upper) bound, whose contribution to the dual objective it
+    // gives. Otherwise it is a dual infeasibility.
+    const Fractional reduced_cost = reduced_costs_[col];
+    const Fractional bound =
+        reduced_cost > 0.0 ? lower_bound_[col] : upper_bound_[col];
+    if (IsFinite(bound)) {
+      dual_objective += bound * reduced_cost;
+    } else {
+      dual_residual = std::max(dual_residual, fabs(reduced_cost));
+    }
+  }
+  const Fractional primal_error =
+      InfinityNorm(activities_) / (1.0 + max_primal_value);
+  const Fractional dual_error = dual_residual / (1.0 + max_cost);
+  const Fractional gap_error =
+      fabs(primal_objective - dual_objective) /
+      (1.0 + fabs(primal_objective) + fabs(dual_objective));
+  return std::max(primal_error, std::max(dual_error, gap_error));
+}
+
+Status FirstOrderSolver::Solve(const LinearProgram& lp) {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK(lp.IsCleanedUp());
+  TimeLimit time_limit(parameters_.max_time_in_seconds());
+  problem_status_ = ProblemStatus::INIT;
+  num_iterations_ = 0;
+  num_restarts_ = 0;
+  Initialize(lp);
+
+  const Fractional tolerance = parameters_.pdhg_tolerance();
+  const int max_iterations = parameters_.max_number_of_pdhg_iterations();
+  Fractional restart_error = ComputeKktError(x_, y_);
+  Fractional last_candidate_error = kInfinity;
+  int num_iterations_since_restart = 0;
+  kkt_error_ = restart_error;
+  while (kkt_error_ > tolerance) {
+    const Fractional tau = step_size_ / primal_weight_;
+    const Fractional sigma = step_size_ * primal_weight_;
+
+    // x' = projection of x - tau.(c - K^T.y), and x is replaced by the
+    // extrapolation 2.x' - x for the dual step.
+    ComputeReducedCosts(y_, &reduced_costs_);
+    ForEachColumnChunk(
+        num_cols_, num_col_chunks_,
+        [this, tau](int chunk, ColIndex begin, ColIndex end) {
+          for (ColIndex col = begin; col < end; ++col) {
+            next_x_[col] = Project(x_[col] - tau * reduced_costs_[col],
+                                   lower_bound_[col], upper_bound_[col]);
+            x_[col] = 2.0 * next_x_[col] - x_[col];
+          }
+        });
+    ComputeActivities(x_, &activities_);
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      y_[row] -= sigma * activities_[row];
+    }
+    x_.swap(next_x_);
+
+    ++num_iterations_;
+    ++num_iterations_since_restart;
+    const Fractional weight = 1.0 / num_iterations_since_restart;
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      average_x_[col] += weight * (x_[col] - average_x_[col]);
+    }
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      average_y_[row] += weight * (y_[row] - average_y_[row]);
+    }
+
+    const bool at_limit =
+        num_iterations_ >= max_iterations || time_limit.LimitReached();
+    if (num_iterations_since_restart % kKktErrorPeriod != 0 && !at_limit) {
+      continue;
+    }
+
+    // The restart candidate is the best of the current and average points.
+    const Fractional current_error = ComputeKktError(x_, y_);
+    const Fractional average_error = ComputeKktError(average_x_, average_y_);
+    const bool use_average = average_error < current_error;
+    const Fractional candidate_error =
+        use_average ? average_error : current_error;
+    VLOG(2) << "PDHG iteration " << num_iterations_
+            << ": KKT error = " << candidate_error
+            << (use_average ? " (average)" : " (current)");
+    if (!(candidate_error < kDivergenceThreshold)) {
+      VLOG(1) << "PDHG diverges, the problem is likely infeasible or "
+              << "unbounded.";
+      break;
+    }
+    const bool restart =
+        candidate_error <= tolerance || at_limit ||
+        candidate_error <= kSufficientDecay * restart_error ||
+        (candidate_error <= kNecessaryDecay * restart_error &&
+         candidate_error > last_candidate_error) ||
+        num_iterations_since_restart >=
+            kArtificialRestartFraction * num_iterations_;
+    if (!restart) {
+      last_candidate_error = candidate_error;
+      continue;
+    }
+    if (use_average) {
+      x_ = average_x_;
+      y_ = average_y_;
+    }
+    kkt_error_ = candidate_error;
+    if (candidate_error <= tolerance || at_limit) break;
+
+    // The new primal weight is a smoothed ratio of the distances traveled in
+    // the dual and primal spaces since the last restart.
+    Fractional primal_distance = 0.0;
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      primal_distance += Square(x_[col] - restart_x_[col]);
+    }
+    Fractional dual_distance = 0.0;
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      dual_distance += Square(y_[row] - restart_y_[row]);
+    }
+    if (primal_distance > 0.0 && dual_distance > 0.0) {
+      primal_weight_ = sqrt(primal_weight_ *
+                            sqrt(dual_distance / primal_distance));
+    }
+    stats_.restart_length.Add(num_iterations_since_restart);
+    stats_.primal_weight.Add(primal_weight_);
+    ++num_restarts_;
+    num_iterations_since_restart = 0;
+    restart_error = candidate_error;
+    last_candidate_error = kInfinity;
+    restart_x_ = x_;
+    restart_y_ = y_;
+    average_x_ = x_;
+    average_y_ = y_;
+  }
+  if (kkt_error_ <= tolerance) problem_status_ = ProblemStatus::OPTIMAL;
+  VLOG(1) << "PDHG: " << num_iterations_ << " iterations, " << num_restarts_
+          << " restarts, KKT error = " << kkt_error_;
+  return Status::OK;
+}
+
+Fractional FirstOrderSolver::GetObjectiveValue() const {
+  Fractional objective = 0.0;
+  for (ColIndex col(0); col < num_structural_cols_; ++col) {
+    objective += cost_[col] * x_[col];
+  }
+  return lp_->IsMaximizationProblem() ? -objective : objective;
+}
+
+BasisState FirstOrderSolver::ComputeCrossoverBasis() {
+  SCOPED_TIME_STAT(&stats_);
+  ComputeReducedCosts(y_, &reduced_costs_);
+  VariableStatusRow statuses(num_cols_, VariableStatus::FREE);
+
+  // As for the interior point method, the candidates are sorted by decreasing
+  // ratio between their distance to their closest bound and their reduced
+  // cost, the free variables first. The projection puts the variables that
+  // are likely non-basic exactly at one of their bounds.
+  std::vector<std::pair<Fractional, ColIndex>> candidates;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    const Fractional lb = lower_bound_[col];
+    const Fractional ub = upper_bound_[col];
+    if (lb == ub) {
+      statuses[col] = VariableStatus::FIXED_VALUE;
+      continue;
+    }
+    const Fractional lower_gap = x_[col] - lb;
+    const Fractional upper_gap = ub - x_[col];
+    const bool at_lower = IsFinite(lb) && lower_gap <= upper_gap;
+    const bool at_upper = !at_lower && IsFinite(ub);
+    if (!at_lower && !at_upper) {
+      candidates.push_back(std::make_pair(-kInfinity, col));
+      continue;
+    }
+    statuses[col] = at_lower ? VariableStatus::AT_LOWER_BOUND
+                             : VariableStatus::AT_UPPER_BOUND;
+    const Fractional gap = at_lower ? lower_gap : upper_gap;
+    const Fractional dual = fabs(reduced_costs_[col]);
+    if (gap > dual) {
+      candidates.push_back(std::make_pair(-gap / dual, col));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  std::vector<ColIndex> candidate_columns;
+  for (const std::pair<Fractional, ColIndex>& candidate : candidates) {
+    candidate_columns.push_back(candidate.second);
+  }
+  return glop::ComputeCrossoverBasis(lp_->GetSparseMatrix(), statuses,
+                                     candidate_columns, &markowitz_);
+}
+
+}  // namespace glop
+}  // namespace operations_research
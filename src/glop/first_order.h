@@ -0,0 +1,176 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Solves a linear program approximately with the primal-dual hybrid gradient
+// method (PDHG), a first-order method whose iterations only need two products
+// with the constraint matrix: there is nothing to factorize, so it scales to
+// problems on which a simplex iteration or an interior point factorization is
+// too expensive, but it only converges to a moderate precision. LPSolver uses
+// its solution to compute a starting basis for RevisedSimplex (see
+// crossover.h), which then finishes the job.
+//
+// Like InteriorPointSolver, this works on the form used by glop:
+//   min c.x  s.t.  K.x = 0,  l <= x <= u
+// where K = [A | I] and the last variables are the slacks of the constraints.
+// The method looks for a saddle point of the Lagrangian c.x - y.K.x with the
+// iterations:
+//   x' = projection on [l, u] of x - tau.(c - K^T.y)
+//   y' = y - sigma.K.(2.x' - x)
+// with tau = eta / omega and sigma = eta.omega, where the step size eta is
+// below 1 / ||K||_2 and the primal weight omega balances the primal and dual
+// progress. As in PDLP, the average of the iterates since the last restart is
+// maintained, and the method restarts from the better of the current and of
+// the average point (for the relative KKT error, i.e. the largest of the
+// relative primal residual, dual residual and duality gap) when this error
+// decreased enough since the last restart. The primal weight is updated at
+// each restart from the distances traveled in the primal and dual spaces.
+//
+// The two matrix products of an iteration, K^T.y and K.x (done on the
+// transpose of A), are split into chunks of columns processed with up to
+// num_omp_threads threads when the code is compiled with OMP.
+//
+// References:
+// - A. Chambolle, T. Pock, "A first-order primal-dual algorithm for convex
+//   problems with applications to imaging", Journal of Mathematical Imaging
+//   and Vision, 40(1):120-145, 2011.
+// - D. Applegate et al., "Practical large-scale linear programming using
+//   primal-dual hybrid gradient", NeurIPS 2021.
+
+#ifndef OR_TOOLS_GLOP_FIRST_ORDER_H_
+#define OR_TOOLS_GLOP_FIRST_ORDER_H_
+
+#include "base/macros.h"
+#include "glop/markowitz.h"
+#include "glop/parameters.pb.h"
+#include "glop/revised_simplex.h"
+#include "glop/status.h"
+#include "lp_data/lp_data.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/sparse.h"
+#include "util/stats.h"
+
+namespace operations_research {
+namespace glop {
+
+class FirstOrderSolver {
+ public:
+  FirstOrderSolver();
+
+  // Sets the algorithm parameters to be used on the next Solve().
+  void SetParameters(const GlopParameters& parameters);
+
+  // Solves the given linear program. The linear program must outlive this
+  // class or at least the call to ComputeCrossoverBasis(). The returned status
+  // is an error only if the algorithm couldn't run, not if it didn't
+  // converge: GetProblemStatus() is OPTIMAL if the relative KKT error of the
+  // solution is below pdhg_tolerance() and INIT otherwise.
+  Status Solve(const LinearProgram& lp) MUST_USE_RESULT;
+
+  // Getters for the last Solve(). The values are the ones of the best point
+  // found, they only satisfy the constraints up to the tolerance.
+  ProblemStatus GetProblemStatus() const { return problem_status_; }
+  int GetNumberOfIterations() const { return num_iterations_; }
+  int GetNumberOfRestarts() const { return num_restarts_; }
+  Fractional GetKktError() const { return kkt_error_; }
+  Fractional GetObjectiveValue() const;
+  Fractional GetVariableValue(ColIndex col) const { return x_[col]; }
+  Fractional GetDualValue(RowIndex row) const { return y_[row]; }
+
+  // Computes a basis in the format used by RevisedSimplex from the last
+  // solution. The variables far from their bounds compared to their reduced
+  // cost are the candidates to enter the basis, see crossover.h. The other
+  // variables are at their closest bound.
+  BasisState ComputeCrossoverBasis();
+
+  // Returns a std::string containing the statistics for this class.
+  std::string StatString() const { return stats_.StatString(); }
+
+ private:
+  // Initializes the problem data, the step size and the primal weight.
+  void Initialize(const LinearProgram& lp);
+
+  // Computes c - K^T.y.
+  void ComputeReducedCosts(const DenseColumn& y,
+                           DenseRow* reduced_costs) const;
+
+  // Computes K.x.
+  void ComputeActivities(const DenseRow& x, DenseColumn* activities) const;
+
+  // Returns the relative KKT error of the given point.
+  Fractional ComputeKktError(const DenseRow& x, const DenseColumn& y);
+
+  // Returns an estimation of ||K||_2 computed with the power method.
+  Fractional EstimateMatrixNorm();
+
+  // The problem data. The constraint matrix A and its transpose are used for
+  // the products with K = [A | I].
+  const LinearProgram* lp_;
+  RowIndex num_rows_;
+  ColIndex num_structural_cols_;
+  ColIndex num_cols_;
+  CompactSparseMatrix matrix_;
+  CompactSparseMatrix transpose_;
+  DenseRow cost_;
+  DenseRow lower_bound_;
+  DenseRow upper_bound_;
+
+  // The number of chunks for the products over the columns and the rows.
+  int num_col_chunks_;
+  int num_row_chunks_;
+
+  // The current point, the average of the points since the last restart, and
+  // the point of the last restart.
+  DenseRow x_;
+  DenseColumn y_;
+  DenseRow average_x_;
+  DenseColumn average_y_;
+  DenseRow restart_x_;
+  DenseColumn restart_y_;
+
+  // Scratch vectors.
+  DenseRow next_x_;
+  DenseRow reduced_costs_;
+  DenseColumn activities_;
+
+  Fractional step_size_;
+  Fractional primal_weight_;
+
+  ProblemStatus problem_status_;
+  int num_iterations_;
+  int num_restarts_;
+  Fractional kkt_error_;
+
+  // Used by ComputeCrossoverBasis().
+  Markowitz markowitz_;
+
+  // Stats about this class.
+  struct Stats : public StatsGroup {
+    Stats()
+        : StatsGroup("FirstOrderSolver"),
+          restart_length("restart_length", this),
+          primal_weight("primal_weight", this) {}
+    IntegerDistribution restart_length;
+    DoubleDistribution primal_weight;
+  };
+  Stats stats_;
+
+  GlopParameters parameters_;
+
+  DISALLOW_COPY_AND_ASSIGN(FirstOrderSolver);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_FIRST_ORDER_H_
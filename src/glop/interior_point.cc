@@ -0,0 +1,465 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "glop/interior_point.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "glop/crossover.h"
+#include "lp_data/lp_utils.h"
+#include "util/time_limit.h"
+
+namespace operations_research {
+namespace glop {
+
+namespace {
+
+// Regularization added to the diagonal D of all the variables. This is needed
+// for the free variables and improves the numerical stability in general.
+const Fractional kPrimalRegularization = 1e-8;
+
+// Fraction of the maximum step to the boundary that is actually taken.
+const Fractional kStepFactor = 0.9995;
+
+// Above this value of mu or of the primal values, the problem is likely
+// infeasible or unbounded and the algorithm stops.
+const Fractional kDivergenceThreshold = 1e30;
+
+}  // namespace
+
+InteriorPointSolver::InteriorPointSolver()
+    : lp_(nullptr),
+      num_rows_(0),
+      num_structural_cols_(0),
+      num_cols_(0),
+      num_complementarity_pairs_(0),
+      mu_(0.0),
+      max_primal_value_(0.0),
+      primal_infeasibility_(0.0),
+      dual_infeasibility_(0.0),
+      relative_gap_(0.0),
+      problem_status_(ProblemStatus::INIT),
+      num_iterations_(0) {}
+
+void InteriorPointSolver::SetParameters(const GlopParameters& parameters) {
+  parameters_ = parameters;
+  cholesky_.SetParameters(parameters);
+  markowitz_.SetParameters(parameters);
+}
+
+void InteriorPointSolver::Initialize(const LinearProgram& lp) {
+  lp_ = &lp;
+  num_rows_ = lp.num_constraints();
+  num_structural_cols_ = lp.num_variables();
+  num_cols_ = num_structural_cols_ + RowToColIndex(num_rows_);
+
+  cost_.assign(num_cols_, 0.0);
+  lower_bound_.resize(num_cols_, 0.0);
+  upper_bound_.resize(num_cols_, 0.0);
+  for (ColIndex col(0); col < num_structural_cols_; ++col) {
+    cost_[col] = lp.GetObjectiveCoefficientForMinimizationVersion(col);
+    lower_bound_[col] = lp.variable_lower_bounds()[col];
+    upper_bound_[col] = lp.variable_upper_bounds()[col];
+  }
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    const ColIndex col = num_structural_cols_ + RowToColIndex(row);
+    lower_bound_[col] = -lp.constraint_upper_bounds()[row];
+    upper_bound_[col] = -lp.constraint_lower_bounds()[row];
+  }
+
+  // The starting point is at a distance of at most 1.0 of the finite bounds,
+  // with all the duals of the bounds equal to 1.0. It does not satisfy the
+  // constraints since the method does not need a feasible point.
+  has_lower_bound_.assign(num_cols_, false);
+  has_upper_bound_.assign(num_cols_, false);
+  is_fixed_.assign(num_cols_, false);
+  x_.assign(num_cols_, 0.0);
+  w_lower_.assign(num_cols_, 0.0);
+  w_upper_.assign(num_cols_, 0.0);
+  z_lower_.assign(num_cols_, 0.0);
+  z_upper_.assign(num_cols_, 0.0);
+  num_complementarity_pairs_ = 0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    const Fractional lb = lower_bound_[col];
+    const Fractional ub = upper_bound_[col];
+    if (lb == ub) {
+      is_fixed_[col] = true;
+      x_[col] = lb;
+      continue;
+    }
+    has_lower_bound_[col] = lb != -kInfinity;
+    has_upper_bound_[col] = ub != kInfinity;
+    if (has_lower_bound_[col] && has_upper_bound_[col]) {
+      x_[col] = lb + std::min(1.0, 0.5 * (ub - lb));
+    } else if (has_lower_bound_[col]) {
+      x_[col] = lb + 1.0;
+    } else if (has_upper_bound_[col]) {
+      x_[col] = ub - 1.0;
+    }
+    if (has_lower_bound_[col]) {
+      w_lower_[col] = x_[col] - lb;
+      z_lower_[col] = 1.0;
+      ++num_complementarity_pairs_;
+    }
+    if (has_upper_bound_[col]) {
+      w_upper_[col] = ub - x_[col];
+      z_upper_[col] = 1.0;
+      ++num_complementarity_pairs_;
+    }
+  }
+  y_.assign(num_rows_, 0.0);
+
+  primal_residual_.assign(num_rows_, 0.0);
+  dual_residual_.assign(num_cols_, 0.0);
+  inverse_d_.assign(num_structural_cols_, 0.0);
+  slack_inverse_d_.assign(num_rows_, 0.0);
+  dx_.assign(num_cols_, 0.0);
+  dy_.assign(num_rows_, 0.0);
+  dz_lower_.assign(num_cols_, 0.0);
+  dz_upper_.assign(num_cols_, 0.0);
+  reduced_rhs_.assign(num_cols_, 0.0);
+
+  cholesky_.ComputeSymbolicFactorization(lp.GetSparseMatrix());
+  VLOG(1) << "Interior point: the factor L of the normal equations has "
+          << cholesky_.NumberOfEntries() << " entries.";
+}
+
+void InteriorPointSolver::ComputeResiduals() {
+  // Primal residual: -(A.x + s).
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    primal_residual_[row] = -x_[num_structural_cols_ + RowToColIndex(row)];
+  }
+  for (ColIndex col(0); col < num_structural_cols_; ++col) {
+    const Fractional value = x_[col];
+    if (value == 0.0) continue;
+    for (const SparseColumn::Entry e : lp_->GetSparseColumn(col)) {
+      primal_residual_[e.row()] -= e.coefficient() * value;
+    }
+  }
+
+  // Dual residual: c - A^T.y - z_lower + z_upper. Note that the residual of the
+  // fixed variables is their reduced cost and does not need to be zero.
+  Fractional primal_objective = 0.0;
+  Fractional dual_objective = 0.0;
+  Fractional complementarity = 0.0;
+  Fractional max_cost = 0.0;
+  dual_infeasibility_ = 0.0;
+  max_primal_value_ = 0.0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    primal_objective += cost_[col] * x_[col];
+    max_cost = std::max(max_cost, fabs(cost_[col]));
+    max_primal_value_ = std::max(max_primal_value_, fabs(x_[col]));
+    const Fractional reduced_cost = GetReducedCost(col);
+    if (is_fixed_[col]) {
+      dual_residual_[col] = 0.0;
+      dual_objective += lower_bound_[col] * reduced_cost;
+      continue;
+    }
+    dual_residual_[col] = reduced_cost - z_lower_[col] + z_upper_[col];
+    dual_infeasibility_ =
+        std::max(dual_infeasibility_, fabs(dual_residual_[col]));
+    if (has_lower_bound_[col]) {
+      dual_objective += lower_bound_[col] * z_lower_[col];
+      complementarity += w_lower_[col] * z_lower_[col];
+    }
+    if (has_upper_bound_[col]) {
+      dual_objective -= upper_bound_[col] * z_upper_[col];
+      complementarity += w_upper_[col] * z_upper_[col];
+    }
+  }
+  mu_ = num_complementarity_pairs_ == 0
+            ? 0.0
+            : complementarity / num_complementarity_pairs_;
+  primal_infeasibility_ =
+      InfinityNorm(primal_residual_) / (1.0 + max_primal_value_);
+  dual_infeasibility_ /= 1.0 + max_cost;
+  relative_gap_ =
+      fabs(primal_objective - dual_objective) / (1.0 + fabs(primal_objective));
+}
+
+void InteriorPointSolver::ComputeDirection(
+    const DenseRow& lower_complementarity,
+    const DenseRow& upper_complementarity) {
+  // Eliminating dz_lower and dz_upper from the Newton system gives
+  //   A'.dx = primal_residual
+  //   A'^T.dy - D.dx = reduced_rhs
+  // where A' = [A | I] and reduced_rhs is computed below. So dx =
+  // D^{-1}.(A'^T.dy - reduced_rhs) and dy is the solution of the normal
+  // equations A'.D^{-1}.A'^T.dy = primal_residual + A'.D^{-1}.reduced_rhs.
+  DenseColumn& rhs = dy_;
+  rhs = primal_residual_;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    if (is_fixed_[col]) continue;
+    Fractional value = dual_residual_[col];
+    if (has_lower_bound_[col]) {
+      value -= lower_complementarity[col] / w_lower_[col];
+    }
+    if (has_upper_bound_[col]) {
+      value += upper_complementarity[col] / w_upper_[col];
+    }
+    reduced_rhs_[col] = value;
+    if (IsSlack(col)) {
+      const RowIndex row = ColToRowIndex(col - num_structural_cols_);
+      rhs[row] += slack_inverse_d_[row] * value;
+    } else {
+      const Fractional multiplier = inverse_d_[col] * value;
+      if (multiplier == 0.0) continue;
+      for (const SparseColumn::Entry e : lp_->GetSparseColumn(col)) {
+        rhs[e.row()] += multiplier * e.coefficient();
+      }
+    }
+  }
+  cholesky_.Solve(&rhs);
+
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    if (is_fixed_[col]) {
+      dx_[col] = 0.0;
+      dz_lower_[col] = 0.0;
+      dz_upper_[col] = 0.0;
+      continue;
+    }
+    if (IsSlack(col)) {
+      const RowIndex row = ColToRowIndex(col - num_structural_cols_);
+      dx_[col] = slack_inverse_d_[row] * (dy_[row] - reduced_rhs_[col]);
+    } else {
+      dx_[col] = inverse_d_[col] *
+                 (ScalarProduct(dy_, lp_->GetSparseColumn(col)) -
+                  reduced_rhs_[col]);
+    }
+    dz_lower_[col] = has_lower_bound_[col]
+                         ? (lower_complementarity[col] -
+                            z_lower_[col] * dx_[col]) / w_lower_[col]
+                         : 0.0;
+    dz_upper_[col] = has_upper_bound_[col]
+                         ? (upper_complementarity[col] +
+                            z_upper_[col] * dx_[col]) / w_upper_[col]
+                         : 0.0;
+  }
+}
+
+Fractional InteriorPointSolver::ComputeMaxPrimalStep() const {
+  Fractional step = 1.0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    const Fractional dx = dx_[col];
+    if (dx < 0.0 && has_lower_bound_[col]) {
+      step = std::min(step, -w_lower_[col] / dx);
+    } else if (dx > 0.0 && has_upper_bound_[col]) {
+      step = std::min(step, w_upper_[col] / dx);
+    }
+  }
+  return step;
+}
+
+Fractional InteriorPointSolver::ComputeMaxDualStep() const {
+  Fractional step = 1.0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    if (has_lower_bound_[col] && dz_lower_[col] < 0.0) {
+      step = std::min(step, -z_lower_[col] / dz_lower_[col]);
+    }
+    if (has_upper_bound_[col] && dz_upper_[col] < 0.0) {
+      step = std::min(step, -z_upper_[col] / dz_upper_[col]);
+    }
+  }
+  return step;
+}
+
+Fractional InteriorPointSolver::ComputeComplementarity(
+    Fractional primal_step, Fractional dual_step) const {
+  if (num_complementarity_pairs_ == 0) return 0.0;
+  Fractional sum = 0.0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    if (has_lower_bound_[col]) {
+      sum += (w_lower_[col] + primal_step * dx_[col]) *
+             (z_lower_[col] + dual_step * dz_lower_[col]);
+    }
+    if (has_upper_bound_[col]) {
+      sum += (w_upper_[col] - primal_step * dx_[col]) *
+             (z_upper_[col] + dual_step * dz_upper_[col]);
+    }
+  }
+  return sum / num_complementarity_pairs_;
+}
+
+Status InteriorPointSolver::Solve(const LinearProgram& lp) {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK(lp.IsCleanedUp());
+  TimeLimit time_limit(parameters_.max_time_in_seconds());
+  problem_status_ = ProblemStatus::INIT;
+  num_iterations_ = 0;
+  Initialize(lp);
+
+  const Fractional tolerance = parameters_.interior_point_tolerance();
+  DenseRow lower_complementarity(num_cols_, 0.0);
+  DenseRow upper_complementarity(num_cols_, 0.0);
+  DenseRow affine_dx;
+  DenseRow affine_dz_lower;
+  DenseRow affine_dz_upper;
+  while (true) {
+    ComputeResiduals();
+    VLOG(1) << "Interior point iteration " << num_iterations_
+            << ": mu = " << mu_ << ", primal infeasibility = "
+            << primal_infeasibility_
+            << ", dual infeasibility = " << dual_infeasibility_
+            << ", relative gap = " << relative_gap_;
+    if (primal_infeasibility_ <= tolerance &&
+        dual_infeasibility_ <= tolerance && relative_gap_ <= tolerance) {
+      problem_status_ = ProblemStatus::OPTIMAL;
+      break;
+    }
+    if (mu_ > kDivergenceThreshold ||
+        max_primal_value_ > kDivergenceThreshold) {
+      VLOG(1) << "The interior point method diverges, the problem is likely "
+              << "infeasible or unbounded.";
+      break;
+    }
+    if (num_iterations_ >=
+            parameters_.max_number_of_interior_point_iterations() ||
+        time_limit.LimitReached()) {
+      break;
+    }
+
+    // Factorize the normal equations.
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      Fractional inverse_d = 0.0;
+      if (!is_fixed_[col]) {
+        Fractional d = kPrimalRegularization;
+        if (has_lower_bound_[col]) d += z_lower_[col] / w_lower_[col];
+        if (has_upper_bound_[col]) d += z_upper_[col] / w_upper_[col];
+        inverse_d = 1.0 / d;
+      }
+      if (IsSlack(col)) {
+        slack_inverse_d_[ColToRowIndex(col - num_structural_cols_)] = inverse_d;
+      } else {
+        inverse_d_[col] = inverse_d;
+      }
+    }
+    cholesky_.ComputeNumericFactorization(inverse_d_, slack_inverse_d_);
+
+    // Predictor (or affine scaling) direction.
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      lower_complementarity[col] = -w_lower_[col] * z_lower_[col];
+      upper_complementarity[col] = -w_upper_[col] * z_upper_[col];
+    }
+    ComputeDirection(lower_complementarity, upper_complementarity);
+    const Fractional affine_mu =
+        ComputeComplementarity(ComputeMaxPrimalStep(), ComputeMaxDualStep());
+    const Fractional ratio = mu_ == 0.0 ? 0.0 : affine_mu / mu_;
+    const Fractional sigma = std::min(1.0, ratio * ratio * ratio);
+    stats_.centering.Add(sigma);
+
+    // Corrector direction, which also takes into account the second order
+    // terms of the complementarity equations.
+    affine_dx = dx_;
+    affine_dz_lower = dz_lower_;
+    affine_dz_upper = dz_upper_;
+    const Fractional target = sigma * mu_;
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      if (has_lower_bound_[col]) {
+        lower_complementarity[col] = target - w_lower_[col] * z_lower_[col] -
+                                     affine_dx[col] * affine_dz_lower[col];
+      }
+      if (has_upper_bound_[col]) {
+        upper_complementarity[col] = target - w_upper_[col] * z_upper_[col] +
+                                     affine_dx[col] * affine_dz_upper[col];
+      }
+    }
+    ComputeDirection(lower_complementarity, upper_complementarity);
+
+    // Take the step.
+    const Fractional primal_step =
+        std::min(1.0, kStepFactor * ComputeMaxPrimalStep());
+    const Fractional dual_step =
+        std::min(1.0, kStepFactor * ComputeMaxDualStep());
+    stats_.primal_step.Add(primal_step);
+    stats_.dual_step.Add(dual_step);
+    for (ColIndex col(0); col < num_cols_; ++col) {
+      if (is_fixed_[col]) continue;
+      const Fractional dx = primal_step * dx_[col];
+      x_[col] += dx;
+      if (has_lower_bound_[col]) {
+        w_lower_[col] += dx;
+        z_lower_[col] += dual_step * dz_lower_[col];
+      }
+      if (has_upper_bound_[col]) {
+        w_upper_[col] -= dx;
+        z_upper_[col] += dual_step * dz_upper_[col];
+      }
+    }
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      y_[row] += dual_step * dy_[row];
+    }
+    ++num_iterations_;
+  }
+  VLOG(1) << "Interior point: " << GetProblemStatusString(problem_status_)
+          << " after " << num_iterations_ << " iterations.";
+  return Status::OK;
+}
+
+Fractional InteriorPointSolver::GetObjectiveValue() const {
+  Fractional objective = 0.0;
+  for (ColIndex col(0); col < num_structural_cols_; ++col) {
+    objective += cost_[col] * x_[col];
+  }
+  return lp_->IsMaximizationProblem() ? -objective : objective;
+}
+
+Fractional InteriorPointSolver::GetReducedCost(ColIndex col) const {
+  if (IsSlack(col)) {
+    return cost_[col] - y_[ColToRowIndex(col - num_structural_cols_)];
+  }
+  return cost_[col] - ScalarProduct(y_, lp_->GetSparseColumn(col));
+}
+
+BasisState InteriorPointSolver::ComputeCrossoverBasis() {
+  SCOPED_TIME_STAT(&stats_);
+  VariableStatusRow statuses(num_cols_, VariableStatus::FREE);
+
+  // The candidates are sorted by decreasing ratio between their distance to
+  // their closest bound and the dual value of this bound. The free variables
+  // come first.
+  std::vector<std::pair<Fractional, ColIndex>> candidates;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    if (is_fixed_[col]) {
+      statuses[col] = VariableStatus::FIXED_VALUE;
+      continue;
+    }
+    const bool at_lower =
+        has_lower_bound_[col] &&
+        (!has_upper_bound_[col] || w_lower_[col] <= w_upper_[col]);
+    const bool at_upper = !at_lower && has_upper_bound_[col];
+    if (!at_lower && !at_upper) {
+      candidates.push_back(std::make_pair(-kInfinity, col));
+      continue;
+    }
+    statuses[col] = at_lower ? VariableStatus::AT_LOWER_BOUND
+                             : VariableStatus::AT_UPPER_BOUND;
+    const Fractional gap = at_lower ? w_lower_[col] : w_upper_[col];
+    const Fractional dual = at_lower ? z_lower_[col] : z_upper_[col];
+    if (gap > dual) {
+      candidates.push_back(std::make_pair(-gap / dual, col));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  std::vector<ColIndex> candidate_columns;
+  for (const std::pair<Fractional, ColIndex>& candidate : candidates) {
+    candidate_columns.push_back(candidate.second);
+  }
+  return glop::ComputeCrossoverBasis(lp_->GetSparseMatrix(), statuses,
+                                     candidate_columns, &markowitz_);
+}
+
+}  // namespace glop
+}  // namespace operations_research
@@ -0,0 +1,185 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Solves a linear program with Mehrotra's predictor-corrector primal-dual
+// interior point method. Compared to the simplex, the number of iterations is
+// almost independent of the problem size and degeneracy, but each iteration
+// needs the factorization of a normal equations matrix (see sparse_cholesky.h)
+// and the returned solution is not basic.
+//
+// Like RevisedSimplex, this works on the form used by glop:
+//   min c.x  s.t.  A.x + s = 0,  l <= x <= u,  -ru <= s <= -rl
+// where s are the slack variables of the constraints rl <= A.x <= ru. Let
+// x denote all the variables (including the slacks) below. Each finite bound
+// gets a positive "gap" variable w (x - w_lower = l and x + w_upper = u) and a
+// non-negative dual variable z. The method follows a path of points where
+// w_lower.z_lower and w_upper.z_upper are all equal to a parameter mu that goes
+// to zero. Each iteration solves the Newton system of the optimality
+// conditions twice (predictor and corrector) with the same factorization of
+//   A.D^{-1}.A^T + diag(D^{-1} of the slacks)
+// where D = z_lower / w_lower + z_upper / w_upper + a small regularization.
+// The fixed variables are kept at their value.
+//
+// ComputeCrossoverBasis() derives a simplex basis from the interior solution.
+// It is used by LPSolver to "cross over" to RevisedSimplex and return a basic
+// solution.
+//
+// References:
+// - S. Mehrotra, "On the implementation of a primal-dual interior point
+//   method", SIAM Journal on Optimization, 2(4):575-601, 1992.
+// - S. J. Wright, "Primal-Dual Interior-Point Methods", SIAM, 1997.
+
+#ifndef OR_TOOLS_GLOP_INTERIOR_POINT_H_
+#define OR_TOOLS_GLOP_INTERIOR_POINT_H_
+
+#include "base/macros.h"
+#include "glop/markowitz.h"
+#include "glop/parameters.pb.h"
+#include "glop/revised_simplex.h"
+#include "glop/sparse_cholesky.h"
+#include "glop/status.h"
+#include "lp_data/lp_data.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/sparse.h"
+#include "util/stats.h"
+
+namespace operations_research {
+namespace glop {
+
+class InteriorPointSolver {
+ public:
+  InteriorPointSolver();
+
+  // Sets the algorithm parameters to be used on the next Solve().
+  void SetParameters(const GlopParameters& parameters);
+
+  // Solves the given linear program. The linear program must outlive this
+  // class or at least the call to ComputeCrossoverBasis(). The returned status
+  // is an error only if the algorithm couldn't run, not if it didn't
+  // converge: GetProblemStatus() is OPTIMAL if the solution satisfies the
+  // interior_point_tolerance() and INIT otherwise (iteration or time limit
+  // reached, or a problem that is likely infeasible or unbounded).
+  Status Solve(const LinearProgram& lp) MUST_USE_RESULT;
+
+  // Getters for the last Solve(). The values are the ones of the interior
+  // point, they only satisfy the bounds and the constraints up to the
+  // tolerance.
+  ProblemStatus GetProblemStatus() const { return problem_status_; }
+  int GetNumberOfIterations() const { return num_iterations_; }
+  Fractional GetObjectiveValue() const;
+  Fractional GetVariableValue(ColIndex col) const { return x_[col]; }
+  Fractional GetReducedCost(ColIndex col) const;
+  Fractional GetDualValue(RowIndex row) const { return y_[row]; }
+
+  // Computes a basis in the format used by RevisedSimplex from the last
+  // solution. The variables far from their bounds compared to their reduced
+  // cost are the candidates to enter the basis, see crossover.h. The other
+  // variables are at their closest bound.
+  BasisState ComputeCrossoverBasis();
+
+  // Returns a std::string containing the statistics for this class.
+  std::string StatString() const { return stats_.StatString(); }
+
+ private:
+  // Initializes the problem data and the starting point.
+  void Initialize(const LinearProgram& lp);
+
+  // Computes the residuals of the current point and the convergence measures.
+  void ComputeResiduals();
+
+  // Computes the Newton direction for the given right-hand sides of the
+  // complementarity equations, using the current factorization.
+  void ComputeDirection(const DenseRow& lower_complementarity,
+                        const DenseRow& upper_complementarity);
+
+  // Returns the largest step in [0, 1] along the current direction that keeps
+  // the primal (resp. dual) variables non-negative.
+  Fractional ComputeMaxPrimalStep() const;
+  Fractional ComputeMaxDualStep() const;
+
+  // Returns the average complementarity after the given steps along the
+  // current direction.
+  Fractional ComputeComplementarity(Fractional primal_step,
+                                    Fractional dual_step) const;
+
+  // Returns true if the given variable is a slack.
+  bool IsSlack(ColIndex col) const { return col >= num_structural_cols_; }
+
+  // The problem data. The columns of the slack variables are the identity.
+  const LinearProgram* lp_;
+  RowIndex num_rows_;
+  ColIndex num_structural_cols_;
+  ColIndex num_cols_;
+  DenseRow cost_;
+  DenseRow lower_bound_;
+  DenseRow upper_bound_;
+  DenseBooleanRow has_lower_bound_;
+  DenseBooleanRow has_upper_bound_;
+  DenseBooleanRow is_fixed_;
+  int num_complementarity_pairs_;
+
+  // The current point.
+  DenseRow x_;
+  DenseColumn y_;
+  DenseRow w_lower_;
+  DenseRow w_upper_;
+  DenseRow z_lower_;
+  DenseRow z_upper_;
+
+  // The residuals of the current point.
+  DenseColumn primal_residual_;
+  DenseRow dual_residual_;
+  Fractional mu_;
+  Fractional max_primal_value_;
+  Fractional primal_infeasibility_;
+  Fractional dual_infeasibility_;
+  Fractional relative_gap_;
+
+  // The normal equations and the current direction.
+  SparseCholesky cholesky_;
+  DenseRow inverse_d_;
+  DenseColumn slack_inverse_d_;
+  DenseRow dx_;
+  DenseColumn dy_;
+  DenseRow dz_lower_;
+  DenseRow dz_upper_;
+  DenseRow reduced_rhs_;
+
+  // Used by ComputeCrossoverBasis().
+  Markowitz markowitz_;
+
+  ProblemStatus problem_status_;
+  int num_iterations_;
+
+  // Stats about this class.
+  struct Stats : public StatsGroup {
+    Stats()
+        : StatsGroup("InteriorPointSolver"),
+          primal_step("primal_step", this),
+          dual_step("dual_step", this),
+          centering("centering", this) {}
+    RatioDistribution primal_step;
+    RatioDistribution dual_step;
+    RatioDistribution centering;
+  };
+  Stats stats_;
+
+  GlopParameters parameters_;
+
+  DISALLOW_COPY_AND_ASSIGN(InteriorPointSolver);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_INTERIOR_POINT_H_
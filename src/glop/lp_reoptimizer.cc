@@ -0,0 +1,142 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "glop/lp_reoptimizer.h"
+
+#include "base/logging.h"
+#include "lp_data/lp_utils.h"
+
+namespace operations_research {
+namespace glop {
+
+LPReoptimizer::LPReoptimizer()
+    : parameters_(),
+      is_loaded_(false),
+      scaled_lp_(),
+      scaler_(),
+      objective_offset_(0.0),
+      revised_simplex_(),
+      status_(ProblemStatus::INIT),
+      objective_value_(0.0),
+      num_iterations_(0) {}
+
+void LPReoptimizer::SetParameters(const GlopParameters& parameters) {
+  parameters_ = parameters;
+}
+
+void LPReoptimizer::Load(const LinearProgram& lp) {
+  DCHECK(lp.IsCleanedUp());
+  scaled_lp_.PopulateFromLinearProgram(lp, /*keep_names=*/false);
+  variable_lower_bounds_ = lp.variable_lower_bounds();
+  variable_upper_bounds_ = lp.variable_upper_bounds();
+  objective_coefficients_ = lp.objective_coefficients();
+  objective_offset_ = lp.objective_offset();
+
+  // Note that SparseMatrixScaler::Init() keeps the old factors of the rows and
+  // columns that already existed, so we need to clear it first.
+  scaler_.Clear();
+  if (parameters_.use_scaling()) {
+    scaler_.SetScalingAlgorithm(
+        parameters_.scaling_method() == GlopParameters::CURTIS_REID_SCALING
+            ? SparseMatrixScaler::CURTIS_REID_SCALING
+            : SparseMatrixScaler::GEOMETRIC_SCALING);
+    scaler_.SetNumThreads(parameters_.num_omp_threads());
+    scaled_lp_.Scale(&scaler_);
+  }
+  scaled_lp_.ClearTransposeMatrix();
+
+  revised_simplex_.ClearStateForNextSolve();
+  status_ = ProblemStatus::INIT;
+  primal_values_.assign(lp.num_variables(), 0.0);
+  variable_statuses_.assign(lp.num_variables(), VariableStatus::FREE);
+  objective_value_ = 0.0;
+  num_iterations_ = 0;
+  is_loaded_ = true;
+}
+
+void LPReoptimizer::SetVariableBounds(ColIndex col, Fractional lower_bound,
+                                      Fractional upper_bound) {
+  DCHECK(is_loaded_);
+  variable_lower_bounds_[col] = lower_bound;
+  variable_upper_bounds_[col] = upper_bound;
+
+  // Same as LinearProgram::Scale(). Note that col_scale() is 1.0 if the
+  // problem wasn't scaled.
+  const Fractional scale = scaler_.col_scale(col);
+  scaled_lp_.SetVariableBounds(col, lower_bound * scale, upper_bound * scale);
+}
+
+ProblemStatus LPReoptimizer::Solve() {
+  DCHECK(is_loaded_);
+
+  // The deterministic time of the RevisedSimplex is counted since its
+  // creation. Moreover, after the first solve only the bounds change, so with
+  // allow_simplex_algorithm_change() the RevisedSimplex uses the dual simplex
+  // from its last basis, and keeps its factorization and its dual edge norms.
+  GlopParameters simplex_parameters = parameters_;
+  simplex_parameters.set_max_deterministic_time(
+      revised_simplex_.DeterministicTime() +
+      parameters_.max_deterministic_time());
+  simplex_parameters.set_allow_simplex_algorithm_change(true);
+  revised_simplex_.SetParameters(simplex_parameters);
+
+  if (!revised_simplex_.Solve(scaled_lp_).ok()) {
+    VLOG(1) << "Error during the revised simplex algorithm.";
+    status_ = ProblemStatus::ABNORMAL;
+    num_iterations_ = 0;
+    return status_;
+  }
+  num_iterations_ = revised_simplex_.GetNumberOfIterations();
+  status_ = revised_simplex_.GetProblemStatus();
+  StoreSolution();
+  return status_;
+}
+
+double LPReoptimizer::DeterministicTime() const {
+  return revised_simplex_.DeterministicTime();
+}
+
+void LPReoptimizer::StoreSolution() {
+  const ColIndex num_cols = scaled_lp_.num_variables();
+  for (ColIndex col(0); col < num_cols; ++col) {
+    primal_values_[col] = revised_simplex_.GetVariableValue(col);
+    variable_statuses_[col] = revised_simplex_.GetVariableStatus(col);
+  }
+  scaler_.ScaleRowVector(false, &primal_values_);
+
+  // As in ScalingPreprocessor::StoreSolution(), the variables at their bounds
+  // are set to the exact unscaled bound. The objective is then computed from
+  // the unscaled values.
+  KahanSum objective;
+  for (ColIndex col(0); col < num_cols; ++col) {
+    switch (variable_statuses_[col]) {
+      case VariableStatus::AT_UPPER_BOUND:
+        FALLTHROUGH_INTENDED;
+      case VariableStatus::FIXED_VALUE:
+        primal_values_[col] = variable_upper_bounds_[col];
+        break;
+      case VariableStatus::AT_LOWER_BOUND:
+        primal_values_[col] = variable_lower_bounds_[col];
+        break;
+      case VariableStatus::FREE:
+        FALLTHROUGH_INTENDED;
+      case VariableStatus::BASIC:
+        break;
+    }
+    objective.Add(objective_coefficients_[col] * primal_values_[col]);
+  }
+  objective_value_ = objective.Value() + objective_offset_;
+}
+
+}  // namespace glop
+}  // namespace operations_research
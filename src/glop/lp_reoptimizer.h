@@ -0,0 +1,124 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Re-solves a linear program whose variable bounds change from one solve to
+// the next, as in a branch and bound or when variables are fixed by another
+// algorithm (e.g. the SAT solver in bop).
+//
+// Contrary to LPSolver, the problem is not copied, presolved and postsolved on
+// each solve. It is scaled once when loaded, the bound changes are applied to
+// this scaled copy, and the same RevisedSimplex instance is used for all the
+// solves. Since the matrix and the objective never change, the RevisedSimplex
+// keeps its basis factorization and its dual edge norms, and each re-solve
+// is a warm-started dual simplex that usually only needs a few pivots.
+
+#ifndef OR_TOOLS_GLOP_LP_REOPTIMIZER_H_
+#define OR_TOOLS_GLOP_LP_REOPTIMIZER_H_
+
+#include "base/macros.h"
+#include "glop/parameters.pb.h"
+#include "glop/revised_simplex.h"
+#include "lp_data/lp_data.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/matrix_scaler.h"
+
+namespace operations_research {
+namespace glop {
+
+class LPReoptimizer {
+ public:
+  LPReoptimizer();
+
+  // Sets the parameters to be used on the next Solve(). The time limits
+  // (max_time_in_seconds and max_deterministic_time) apply to each Solve()
+  // separately. Note that the scaling parameters are only used by Load().
+  void SetParameters(const GlopParameters& parameters);
+  const GlopParameters& GetParameters() const { return parameters_; }
+
+  // Loads the given linear program, which must be cleaned up (see
+  // LinearProgram::CleanUp()). Its matrix and objective are then fixed until
+  // the next Load(). This clears the state of the simplex, so the next Solve()
+  // is done from scratch.
+  void Load(const LinearProgram& lp);
+  bool IsLoaded() const { return is_loaded_; }
+
+  // Changes the bounds of a variable of the loaded linear program. This is
+  // cheap and doesn't invalidate the state of the simplex.
+  void SetVariableBounds(ColIndex col, Fractional lower_bound,
+                         Fractional upper_bound);
+  Fractional variable_lower_bound(ColIndex col) const {
+    return variable_lower_bounds_[col];
+  }
+  Fractional variable_upper_bound(ColIndex col) const {
+    return variable_upper_bounds_[col];
+  }
+
+  // Solves the loaded linear program with its current bounds. The first solve
+  // uses the algorithm given by the parameters, the next ones start from the
+  // last basis with the dual simplex.
+  //
+  // The returned status is the one of the RevisedSimplex. In particular,
+  // DUAL_UNBOUNDED means that the bound changes made the problem infeasible.
+  ProblemStatus Solve() MUST_USE_RESULT;
+
+  // Getters for the solution of the last Solve(), in the space of the loaded
+  // linear program. The objective value includes the objective offset.
+  ProblemStatus GetProblemStatus() const { return status_; }
+  Fractional GetObjectiveValue() const { return objective_value_; }
+  const DenseRow& variable_values() const { return primal_values_; }
+  const VariableStatusRow& variable_statuses() const {
+    return variable_statuses_;
+  }
+
+  // Returns the number of simplex iterations used by the last Solve().
+  int64 GetNumberOfSimplexIterations() const { return num_iterations_; }
+
+  // Returns the deterministic time spent in all the Solve() since the
+  // creation of this class.
+  double DeterministicTime() const;
+
+ private:
+  // Unscales the current solution of the simplex into primal_values_ and
+  // computes objective_value_.
+  void StoreSolution();
+
+  GlopParameters parameters_;
+  bool is_loaded_;
+
+  // The scaled copy of the loaded linear program, and the scaler used. Only
+  // the variable bounds of scaled_lp_ change after Load().
+  LinearProgram scaled_lp_;
+  SparseMatrixScaler scaler_;
+
+  // The unscaled variable bounds and objective of the loaded linear program.
+  DenseRow variable_lower_bounds_;
+  DenseRow variable_upper_bounds_;
+  DenseRow objective_coefficients_;
+  Fractional objective_offset_;
+
+  RevisedSimplex revised_simplex_;
+
+  // The solution of the last Solve().
+  ProblemStatus status_;
+  DenseRow primal_values_;
+  VariableStatusRow variable_statuses_;
+  Fractional objective_value_;
+  int64 num_iterations_;
+
+  DISALLOW_COPY_AND_ASSIGN(LPReoptimizer);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_LP_REOPTIMIZER_H_
@@ -17,15 +17,22 @@
 #include <stack>
 #include <vector>
 
+#include "base/callback.h"
+#include "base/casts.h"
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
+#include "base/threadpool.h"
 #include "base/timer.h"
 
+#include "base/fingerprint2011.h"
 #include "base/join.h"
 #include "base/strutil.h"
+#include "glop/first_order.h"
+#include "glop/interior_point.h"
 #include "glop/preprocessor.h"
 #include "glop/proto_utils.h"
 #include "glop/status.h"
+#include "lp_data/lp_decomposer.h"
 #include "lp_data/lp_types.h"
 #include "lp_data/lp_utils.h"
 #include "util/fp_utils.h"
@@ -83,13 +90,100 @@ void DumpLinearProgramIfRequiredByFlags(const LinearProgram& linear_program,
   }
 }
 
+// Returns a fingerprint of the dimensions and of the constraint matrix of the
+// given linear program. Two programs that only differ by their bounds or their
+// objective have the same fingerprint.
+uint64 ComputeMatrixFingerprint(const LinearProgram& lp) {
+  const ColIndex num_cols = lp.num_variables();
+  uint64 fingerprint =
+      FingerprintCat2011(lp.num_constraints().value(), num_cols.value());
+  for (ColIndex col(0); col < num_cols; ++col) {
+    const SparseColumn& column = lp.GetSparseColumn(col);
+    fingerprint = FingerprintCat2011(fingerprint, column.num_entries().value());
+    for (const SparseColumn::Entry e : column) {
+      fingerprint = FingerprintCat2011(fingerprint, e.row().value());
+      fingerprint = FingerprintCat2011(
+          fingerprint, bit_cast<uint64>(static_cast<double>(e.coefficient())));
+    }
+  }
+  return fingerprint;
+}
+
+// Builds and solves the problem_index-th independent problem of the given
+// decomposer with the simplex. This is called from a ThreadPool, so nothing is
+// shared with the other calls except the decomposer which is thread-safe.
+void RunOneRevisedSimplex(const GlopParameters& parameters, int problem_index,
+                          LPDecomposer* decomposer, ProblemSolution* solution,
+                          int* num_iterations, double* deterministic_time) {
+  CHECK(decomposer != nullptr);
+  CHECK(solution != nullptr);
+  CHECK(num_iterations != nullptr);
+  CHECK(deterministic_time != nullptr);
+
+  LinearProgram problem;
+  decomposer->BuildProblem(problem_index, &problem);
+  problem.CleanUp();
+
+  RevisedSimplex revised_simplex;
+  revised_simplex.SetParameters(parameters);
+  if (!revised_simplex.Solve(problem).ok()) {
+    solution->status = ProblemStatus::ABNORMAL;
+    return;
+  }
+  *num_iterations = revised_simplex.GetNumberOfIterations();
+  *deterministic_time = revised_simplex.DeterministicTime();
+  solution->status = revised_simplex.GetProblemStatus();
+
+  const ColIndex num_cols = revised_simplex.GetProblemNumCols();
+  solution->primal_values.resize(num_cols, 0.0);
+  solution->variable_statuses.resize(num_cols, VariableStatus::FREE);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    solution->primal_values[col] = revised_simplex.GetVariableValue(col);
+    solution->variable_statuses[col] = revised_simplex.GetVariableStatus(col);
+  }
+
+  const RowIndex num_rows = revised_simplex.GetProblemNumRows();
+  solution->dual_values.resize(num_rows, 0.0);
+  solution->constraint_statuses.resize(num_rows, ConstraintStatus::FREE);
+  for (RowIndex row(0); row < num_rows; ++row) {
+    solution->dual_values[row] = revised_simplex.GetDualValue(row);
+    solution->constraint_statuses[row] =
+        revised_simplex.GetConstraintStatus(row);
+  }
+}
+
+// Returns the status of the slack variable of a constraint with the given
+// status. This is the inverse of the mapping done by
+// RevisedSimplex::GetConstraintStatus().
+VariableStatus SlackVariableStatus(ConstraintStatus status) {
+  switch (status) {
+    case ConstraintStatus::BASIC:
+      return VariableStatus::BASIC;
+    case ConstraintStatus::FIXED_VALUE:
+      return VariableStatus::FIXED_VALUE;
+    case ConstraintStatus::FREE:
+      return VariableStatus::FREE;
+    case ConstraintStatus::AT_LOWER_BOUND:
+      return VariableStatus::AT_UPPER_BOUND;
+    case ConstraintStatus::AT_UPPER_BOUND:
+      return VariableStatus::AT_LOWER_BOUND;
+  }
+  return VariableStatus::FREE;
+}
+
 }  // anonymous namespace
 
 // --------------------------------------------------------
 // LPSolver
 // --------------------------------------------------------
 
-LPSolver::LPSolver() : num_solves_(0) {}
+LPSolver::LPSolver()
+    : last_matrix_fingerprint_(0),
+      has_last_matrix_fingerprint_(false),
+      interrupt_(nullptr),
+      num_revised_simplex_iterations_(0),
+      subproblems_deterministic_time_(0.0),
+      num_solves_(0) {}
 
 void LPSolver::SetParameters(const GlopParameters& parameters) {
   parameters_ = parameters;
@@ -97,6 +191,13 @@ void LPSolver::SetParameters(const GlopParameters& parameters) {
 
 const GlopParameters& LPSolver::GetParameters() const { return parameters_; }
 
+void LPSolver::SetInterruptFlag(const std::atomic<bool>* interrupt) {
+  interrupt_ = interrupt;
+  if (revised_simplex_ != nullptr) {
+    revised_simplex_->SetInterruptFlag(interrupt);
+  }
+}
+
 ProblemStatus LPSolver::Solve(const LinearProgram& lp) {
   TimeLimit time_limit(parameters_.max_time_in_seconds());
 
@@ -139,9 +240,25 @@ ProblemStatus LPSolver::Solve(const LinearProgram& lp) {
   initial_num_cols_ = lp.num_variables();
   current_linear_program_.PopulateFromLinearProgram(lp, /*keep_names=*/false);
 
+  // Detect if the matrix is the same as the one of the last Solve(). Note that
+  // the fingerprint is not needed (and not computed) if the parameter is off.
+  bool skip_presolve = false;
+  if (parameters_.skip_preprocessing_if_matrix_unchanged()) {
+    const uint64 fingerprint = ComputeMatrixFingerprint(lp);
+    skip_presolve = has_last_matrix_fingerprint_ &&
+                    fingerprint == last_matrix_fingerprint_;
+    last_matrix_fingerprint_ = fingerprint;
+    has_last_matrix_fingerprint_ = true;
+    if (skip_presolve) {
+      VLOG(1) << "Same matrix as in the last solve, skipping the presolve.";
+    }
+  } else {
+    has_last_matrix_fingerprint_ = false;
+  }
+
   // Preprocess.
   status_ = ProblemStatus::INIT;
-  RunPreprocessors(time_limit);
+  RunPreprocessors(skip_presolve, time_limit);
 
   // At this point, we need to initialize a ProblemSolution with the correct
   // size and status.
@@ -149,6 +266,7 @@ ProblemStatus LPSolver::Solve(const LinearProgram& lp) {
                            current_linear_program_.num_variables());
   solution.status = status_;
   RunRevisedSimplexIfNeeded(&solution);
+  initial_basis_ = BasisState();
   PostprocessSolution(&solution);
   return LoadAndVerifySolution(lp, solution);
 }
@@ -157,6 +275,19 @@ void LPSolver::Clear() {
   ResizeSolution(RowIndex(0), ColIndex(0));
   preprocessors_.clear();
   revised_simplex_.reset(nullptr);
+  has_last_matrix_fingerprint_ = false;
+  initial_basis_ = BasisState();
+}
+
+void LPSolver::SetInitialBasis(
+    const VariableStatusRow& variable_statuses,
+    const ConstraintStatusColumn& constraint_statuses) {
+  initial_basis_.num_cols = variable_statuses.size();
+  initial_basis_.num_rows = constraint_statuses.size();
+  initial_basis_.statuses = variable_statuses;
+  for (const ConstraintStatus status : constraint_statuses) {
+    initial_basis_.statuses.push_back(SlackVariableStatus(status));
+  }
 }
 
 ProblemStatus LPSolver::LoadAndVerifySolution(const LinearProgram& lp,
@@ -330,8 +461,14 @@ int LPSolver::GetNumberOfSimplexIterations() const {
 }
 
 double LPSolver::DeterministicTime() const {
-  return revised_simplex_ == nullptr ? 0.0
-                                     : revised_simplex_->DeterministicTime();
+  return subproblems_deterministic_time_ +
+         (revised_simplex_ == nullptr ? 0.0
+                                      : revised_simplex_->DeterministicTime());
+}
+
+std::string LPSolver::GetPrettySolverStats() const {
+  return revised_simplex_ == nullptr ? ""
+                                     : revised_simplex_->GetPrettySolverStats();
 }
 
 void LPSolver::MovePrimalValuesWithinBounds(const LinearProgram& lp) {
@@ -380,8 +517,9 @@ void LPSolver::ResizeSolution(RowIndex num_rows, ColIndex num_cols) {
   RunAndPushIfRelevant(std::unique_ptr<Preprocessor>(new name()), #name, \
                        time_limit)
 
-void LPSolver::RunPreprocessors(const TimeLimit& time_limit) {
-  if (parameters_.use_preprocessing()) {
+void LPSolver::RunPreprocessors(bool skip_presolve,
+                                const TimeLimit& time_limit) {
+  if (parameters_.use_preprocessing() && !skip_presolve) {
     RUN_PREPROCESSOR(ShiftVariableBoundsPreprocessor);
     RUN_PREPROCESSOR(RemoveNearZeroEntriesPreprocessor);
 
@@ -479,37 +617,339 @@ void LPSolver::RunAndPushIfRelevant(std::unique_ptr<Preprocessor> preprocessor,
 }
 
 void LPSolver::RunRevisedSimplexIfNeeded(ProblemSolution* solution) {
+  if (solution->status == ProblemStatus::INIT &&
+      parameters_.solve_independent_subproblems() &&
+      SolveIndependentSubproblems(solution)) {
+    current_linear_program_.ClearTransposeMatrix();
+    return;
+  }
+
   // Note that the transpose matrix is no longer needed at this point.
   // This helps reduce the peak memory usage of the solver.
   current_linear_program_.ClearTransposeMatrix();
   if (solution->status != ProblemStatus::INIT) return;
   if (revised_simplex_ == nullptr) {
     revised_simplex_.reset(new RevisedSimplex());
+    revised_simplex_->SetInterruptFlag(interrupt_);
+  }
+  if (!initial_basis_.IsEmpty() &&
+      current_linear_program_.num_variables() == initial_num_cols_ &&
+      current_linear_program_.num_constraints() == initial_num_rows_ &&
+      initial_basis_.num_cols <= initial_num_cols_ &&
+      initial_basis_.num_rows <= initial_num_rows_) {
+    // The constraints added since the basis was computed have a basic slack
+    // variable, so that the basis stays square. The new variables get their
+    // default non-basic status in the revised simplex.
+    initial_basis_.statuses.resize(
+        initial_basis_.num_cols + RowToColIndex(initial_num_rows_),
+        VariableStatus::BASIC);
+    initial_basis_.num_rows = initial_num_rows_;
+    revised_simplex_->LoadStateForNextSolve(initial_basis_);
+  }
+  GlopParameters simplex_parameters = parameters_;
+  if (parameters_.use_interior_point() &&
+      current_linear_program_.num_constraints() > 0) {
+    // The interior point solution is not basic, so we "cross over" to the
+    // primal simplex from a basis derived from it. Note that a warm-start
+    // basis given to the dual simplex would need to be dual feasible.
+    InteriorPointSolver interior_point_solver;
+    interior_point_solver.SetParameters(parameters_);
+    if (interior_point_solver.Solve(current_linear_program_).ok() &&
+        interior_point_solver.GetProblemStatus() == ProblemStatus::OPTIMAL) {
+      VLOG(1) << "Interior point method converged in "
+              << interior_point_solver.GetNumberOfIterations()
+              << " iterations, objective = "
+              << interior_point_solver.GetObjectiveValue();
+      revised_simplex_->LoadStateForNextSolve(
+          interior_point_solver.ComputeCrossoverBasis());
+      simplex_parameters.set_use_dual_simplex(false);
+    } else {
+      VLOG(1) << "The interior point method didn't converge, solving the "
+              << "problem with the simplex.";
+    }
+    VLOG(1) << interior_point_solver.StatString();
+  } else if (parameters_.use_pdhg() &&
+             current_linear_program_.num_constraints() > 0) {
+    // Same crossover as above, from the approximate solution of the
+    // first-order method.
+    FirstOrderSolver first_order_solver;
+    first_order_solver.SetParameters(parameters_);
+    if (first_order_solver.Solve(current_linear_program_).ok() &&
+        first_order_solver.GetProblemStatus() == ProblemStatus::OPTIMAL) {
+      VLOG(1) << "PDHG converged in "
+              << first_order_solver.GetNumberOfIterations()
+              << " iterations, objective = "
+              << first_order_solver.GetObjectiveValue();
+      revised_simplex_->LoadStateForNextSolve(
+          first_order_solver.ComputeCrossoverBasis());
+      simplex_parameters.set_use_dual_simplex(false);
+    } else {
+      VLOG(1) << "PDHG didn't converge, solving the problem with the simplex.";
+    }
+    VLOG(1) << first_order_solver.StatString();
+  }
+  revised_simplex_->SetParameters(simplex_parameters);
+  if (!revised_simplex_->Solve(current_linear_program_).ok()) {
+    VLOG(1) << "Error during the revised simplex algorithm.";
+    solution->status = ProblemStatus::ABNORMAL;
+    return;
+  }
+  num_revised_simplex_iterations_ += revised_simplex_->GetNumberOfIterations();
+  StoreRevisedSimplexSolution(solution);
+  if (solution->status != ProblemStatus::OPTIMAL ||
+      !parameters_.use_iterative_refinement() || RefineSolution(solution)) {
+    return;
+  }
+
+  // The refinement left some infeasibilities. The simplex restarts from its
+  // last basis with smaller tolerances, so it only does the pivots needed to
+  // fix them.
+  const Fractional kToleranceFactor = 0.1;
+  VLOG(1) << "The refined solution is not feasible, resuming the simplex.";
+  simplex_parameters.set_primal_feasibility_tolerance(
+      kToleranceFactor * parameters_.primal_feasibility_tolerance());
+  simplex_parameters.set_dual_feasibility_tolerance(
+      kToleranceFactor * parameters_.dual_feasibility_tolerance());
+  revised_simplex_->SetParameters(simplex_parameters);
+  if (!revised_simplex_->Solve(current_linear_program_).ok()) {
+    VLOG(1) << "Error during the revised simplex algorithm.";
+    solution->status = ProblemStatus::ABNORMAL;
+    return;
+  }
+  num_revised_simplex_iterations_ += revised_simplex_->GetNumberOfIterations();
+  StoreRevisedSimplexSolution(solution);
+  if (solution->status == ProblemStatus::OPTIMAL) {
+    RefineSolution(solution);
+  }
+}
+
+void LPSolver::StoreRevisedSimplexSolution(ProblemSolution* solution) {
+  solution->status = revised_simplex_->GetProblemStatus();
+
+  const ColIndex num_cols = revised_simplex_->GetProblemNumCols();
+  DCHECK_EQ(solution->primal_values.size(), num_cols);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    solution->primal_values[col] = revised_simplex_->GetVariableValue(col);
+    solution->variable_statuses[col] = revised_simplex_->GetVariableStatus(col);
   }
-  revised_simplex_->SetParameters(parameters_);
-  if (revised_simplex_->Solve(current_linear_program_).ok()) {
-    num_revised_simplex_iterations_ = revised_simplex_->GetNumberOfIterations();
-    solution->status = revised_simplex_->GetProblemStatus();
 
-    const ColIndex num_cols = revised_simplex_->GetProblemNumCols();
-    DCHECK_EQ(solution->primal_values.size(), num_cols);
+  const RowIndex num_rows = revised_simplex_->GetProblemNumRows();
+  DCHECK_EQ(solution->dual_values.size(), num_rows);
+  for (RowIndex row(0); row < num_rows; ++row) {
+    solution->dual_values[row] = revised_simplex_->GetDualValue(row);
+    solution->constraint_statuses[row] =
+        revised_simplex_->GetConstraintStatus(row);
+  }
+}
+
+// Note that the revised simplex works on A.x + s = 0 where the slack variable
+// s_i of the row i has the column first_slack_col + i of the identity matrix
+// and bounds [-ru_i, -rl_i]. The basis B is made of columns of [A | I].
+bool LPSolver::RefineSolution(ProblemSolution* solution) {
+  const LinearProgram& lp = current_linear_program_;
+  const SparseMatrix& matrix = lp.GetSparseMatrix();
+  const RowIndex num_rows = lp.num_constraints();
+  const ColIndex num_cols = lp.num_variables();
+  const BasisFactorization& factorization =
+      revised_simplex_->GetBasisFactorization();
+  const int max_num_steps = parameters_.max_number_of_refinement_steps();
+
+  // Primal refinement. Only the basic variables move: B.dx_B = -(A.x + s).
+  DenseRow& primal_values = solution->primal_values;
+  DenseColumn slack_values(num_rows, 0.0);
+  for (RowIndex row(0); row < num_rows; ++row) {
+    slack_values[row] =
+        revised_simplex_->GetVariableValue(num_cols + RowToColIndex(row));
+  }
+  std::vector<KahanSum> row_sums;
+  DenseColumn primal_residual(num_rows, 0.0);
+  Fractional last_max_primal_residual = kInfinity;
+  for (int step = 0; step < max_num_steps; ++step) {
+    row_sums.assign(num_rows.value(), KahanSum());
     for (ColIndex col(0); col < num_cols; ++col) {
-      solution->primal_values[col] = revised_simplex_->GetVariableValue(col);
-      solution->variable_statuses[col] =
-          revised_simplex_->GetVariableStatus(col);
+      const Fractional value = primal_values[col];
+      if (value == 0.0) continue;
+      for (const SparseColumn::Entry e : matrix.column(col)) {
+        row_sums[e.row().value()].Add(e.coefficient() * value);
+      }
     }
+    Fractional max_primal_residual = 0.0;
+    for (RowIndex row(0); row < num_rows; ++row) {
+      row_sums[row.value()].Add(slack_values[row]);
+      primal_residual[row] = -row_sums[row.value()].Value();
+      max_primal_residual =
+          std::max(max_primal_residual, fabs(primal_residual[row]));
+    }
+    VLOG(1) << "Primal refinement step " << step
+            << ", max residual = " << max_primal_residual;
+    if (max_primal_residual == 0.0 ||
+        max_primal_residual >= last_max_primal_residual) {
+      break;
+    }
+    last_max_primal_residual = max_primal_residual;
+    factorization.RightSolve(&primal_residual);
+    for (RowIndex row(0); row < num_rows; ++row) {
+      const ColIndex col = revised_simplex_->GetBasis(row);
+      if (col < num_cols) {
+        primal_values[col] += primal_residual[row];
+      } else {
+        slack_values[ColToRowIndex(col - num_cols)] += primal_residual[row];
+      }
+    }
+  }
 
-    const RowIndex num_rows = revised_simplex_->GetProblemNumRows();
-    DCHECK_EQ(solution->dual_values.size(), num_rows);
+  // Dual refinement on the minimization version of the problem. The dual
+  // values y must satisfy y.B = c_B: dy.B = c_B - y.B.
+  const Fractional sign = lp.IsMaximizationProblem() ? -1.0 : 1.0;
+  DenseRow dual_values(RowToColIndex(num_rows), 0.0);
+  for (RowIndex row(0); row < num_rows; ++row) {
+    dual_values[RowToColIndex(row)] = sign * solution->dual_values[row];
+  }
+  DenseRow dual_residual(RowToColIndex(num_rows), 0.0);
+  Fractional last_max_dual_residual = kInfinity;
+  for (int step = 0; step < max_num_steps; ++step) {
+    Fractional max_dual_residual = 0.0;
     for (RowIndex row(0); row < num_rows; ++row) {
-      solution->dual_values[row] = revised_simplex_->GetDualValue(row);
-      solution->constraint_statuses[row] =
-          revised_simplex_->GetConstraintStatus(row);
+      const ColIndex col = revised_simplex_->GetBasis(row);
+      const Fractional residual =
+          col < num_cols
+              ? lp.GetObjectiveCoefficientForMinimizationVersion(col) -
+                    PreciseScalarProduct(dual_values, matrix.column(col))
+              : -dual_values[col - num_cols];
+      dual_residual[RowToColIndex(row)] = residual;
+      max_dual_residual = std::max(max_dual_residual, fabs(residual));
+    }
+    VLOG(1) << "Dual refinement step " << step
+            << ", max residual = " << max_dual_residual;
+    if (max_dual_residual == 0.0 ||
+        max_dual_residual >= last_max_dual_residual) {
+      break;
+    }
+    last_max_dual_residual = max_dual_residual;
+    factorization.LeftSolve(&dual_residual);
+    for (ColIndex col(0); col < dual_values.size(); ++col) {
+      dual_values[col] += dual_residual[col];
+    }
+  }
+  for (RowIndex row(0); row < num_rows; ++row) {
+    solution->dual_values[row] = sign * dual_values[RowToColIndex(row)];
+  }
+
+  // Check the primal feasibility of the basic variables, and the sign of the
+  // reduced costs of the non-basic structural variables.
+  const Fractional primal_tolerance = parameters_.primal_feasibility_tolerance();
+  const Fractional dual_tolerance = parameters_.dual_feasibility_tolerance();
+  for (RowIndex row(0); row < num_rows; ++row) {
+    const ColIndex col = revised_simplex_->GetBasis(row);
+    Fractional value, lower_bound, upper_bound;
+    if (col < num_cols) {
+      value = primal_values[col];
+      lower_bound = lp.variable_lower_bounds()[col];
+      upper_bound = lp.variable_upper_bounds()[col];
+    } else {
+      const RowIndex slack_row = ColToRowIndex(col - num_cols);
+      value = slack_values[slack_row];
+      lower_bound = -lp.constraint_upper_bounds()[slack_row];
+      upper_bound = -lp.constraint_lower_bounds()[slack_row];
+    }
+    if (value < lower_bound - primal_tolerance ||
+        value > upper_bound + primal_tolerance) {
+      return false;
+    }
+  }
+  for (ColIndex col(0); col < num_cols; ++col) {
+    const VariableStatus status = solution->variable_statuses[col];
+    if (status == VariableStatus::BASIC ||
+        status == VariableStatus::FIXED_VALUE) {
+      continue;
+    }
+    const Fractional reduced_cost =
+        lp.GetObjectiveCoefficientForMinimizationVersion(col) -
+        PreciseScalarProduct(dual_values, matrix.column(col));
+    if ((status != VariableStatus::AT_UPPER_BOUND &&
+         reduced_cost < -dual_tolerance) ||
+        (status != VariableStatus::AT_LOWER_BOUND &&
+         reduced_cost > dual_tolerance)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LPSolver::SolveIndependentSubproblems(ProblemSolution* solution) {
+  // The empty rows and columns would give subproblems without constraints,
+  // which RevisedSimplex doesn't handle. Note that they are removed by the
+  // preprocessors when use_preprocessing() is true.
+  const LinearProgram& lp = current_linear_program_;
+  for (ColIndex col(0); col < lp.num_variables(); ++col) {
+    if (lp.GetSparseColumn(col).IsEmpty()) return false;
+  }
+  const SparseMatrix& transpose = lp.GetTransposeSparseMatrix();
+  for (ColIndex row(0); row < transpose.num_cols(); ++row) {
+    if (transpose.column(row).IsEmpty()) return false;
+  }
+
+  LPDecomposer decomposer;
+  decomposer.Decompose(&lp);
+  const int num_problems = decomposer.GetNumberOfProblems();
+  if (num_problems <= 1) return false;
+  VLOG(1) << "Solving " << num_problems << " independent subproblems.";
+
+  std::vector<ProblemSolution> solutions(
+      num_problems, ProblemSolution(RowIndex(0), ColIndex(0)));
+  std::vector<int> num_iterations(num_problems, 0);
+  std::vector<double> deterministic_times(num_problems, 0.0);
+  const int num_threads = parameters_.num_subproblem_threads();
+  if (num_threads <= 1) {
+    for (int i = 0; i < num_problems; ++i) {
+      RunOneRevisedSimplex(parameters_, i, &decomposer, &solutions[i],
+                           &num_iterations[i], &deterministic_times[i]);
     }
   } else {
-    VLOG(1) << "Error during the revised simplex algorithm.";
-    solution->status = ProblemStatus::ABNORMAL;
+    // The calling thread solves subproblems too.
+    ThreadPool pool("LPSolver", std::min(num_threads, num_problems) - 1);
+    pool.StartWorkers();
+    pool.ParallelFor(0, num_problems, 1, [&](int begin, int end) {
+      for (int i = begin; i < end; ++i) {
+        RunOneRevisedSimplex(parameters_, i, &decomposer, &solutions[i],
+                             &num_iterations[i], &deterministic_times[i]);
+      }
+    });
   }
+
+  // The time and iterations are counted even if the problem is solved again
+  // without decomposition.
+  for (int i = 0; i < num_problems; ++i) {
+    num_revised_simplex_iterations_ += num_iterations[i];
+    subproblems_deterministic_time_ += deterministic_times[i];
+  }
+  for (int i = 0; i < num_problems; ++i) {
+    if (solutions[i].status != ProblemStatus::OPTIMAL) {
+      VLOG(1) << "Subproblem " << i << " status is "
+              << GetProblemStatusString(solutions[i].status)
+              << ", solving the problem without decomposition.";
+      return false;
+    }
+  }
+
+  std::vector<DenseRow> primal_values(num_problems);
+  std::vector<DenseColumn> dual_values(num_problems);
+  std::vector<VariableStatusRow> variable_statuses(num_problems);
+  std::vector<ConstraintStatusColumn> constraint_statuses(num_problems);
+  for (int i = 0; i < num_problems; ++i) {
+    primal_values[i].swap(solutions[i].primal_values);
+    dual_values[i].swap(solutions[i].dual_values);
+    variable_statuses[i].swap(solutions[i].variable_statuses);
+    constraint_statuses[i].swap(solutions[i].constraint_statuses);
+  }
+  solution->status = ProblemStatus::OPTIMAL;
+  solution->primal_values = decomposer.AggregateAssignments(primal_values);
+  solution->dual_values = decomposer.AggregateDualValues(dual_values);
+  solution->variable_statuses =
+      decomposer.AggregateVariableStatuses(variable_statuses);
+  solution->constraint_statuses =
+      decomposer.AggregateConstraintStatuses(constraint_statuses);
+  return true;
 }
 
 void LPSolver::PostprocessSolution(ProblemSolution* solution) {
@@ -58,6 +58,23 @@ class LPSolver {
   // result, assuming that no time limit was specified.
   void Clear();
 
+  // Uses the given variable and constraint statuses, typically the ones
+  // returned by the last Solve() of a linear program that was modified in
+  // place since, as the starting basis of the next Solve(). The variables and
+  // constraints beyond the given sizes, i.e. the ones added since, start
+  // respectively at a bound and basic. This basis is only used by the primal
+  // simplex, and only if the preprocessing leaves the problem dimensions
+  // unchanged (e.g. with use_preprocessing false). It is forgotten after the
+  // next Solve().
+  void SetInitialBasis(const VariableStatusRow& variable_statuses,
+                       const ConstraintStatusColumn& constraint_statuses);
+
+  // Makes Solve() return as soon as possible once *interrupt is true, as if
+  // its time limit was reached, so that another thread can interrupt a long
+  // solve. Only the iterations of the main revised simplex are interrupted.
+  // The boolean must outlive this object; nullptr unregisters it.
+  void SetInterruptFlag(const std::atomic<bool>* interrupt);
+
   // This loads a given solution and computes related quantities so that the
   // getters below will refer to it.
   //
@@ -123,6 +140,13 @@ class LPSolver {
   // TODO(user): Improve the correlation with the running time.
   double DeterministicTime() const;
 
+  // Returns the statistics of the last revised simplex run, in particular the
+  // time and the number of iterations of each phase, in a human-readable
+  // format (see RevisedSimplex::GetPrettySolverStats()). Returns an empty
+  // std::string if the simplex was not run, e.g. if the problem was solved by
+  // the preprocessors.
+  std::string GetPrettySolverStats() const;
+
  private:
   // Resizes all the solution vectors to the given sizes.
   // This is used in case of error to make sure all the getter functions will
@@ -135,8 +159,10 @@ class LPSolver {
   void MovePrimalValuesWithinBounds(const LinearProgram& lp);
   void MoveDualValuesWithinBounds(const LinearProgram& lp);
 
-  // Runs all preprocessors in sequence.
-  void RunPreprocessors(const TimeLimit& time_limit);
+  // Runs all preprocessors in sequence. If skip_presolve is true, only the
+  // preprocessors that do not depend on the bounds and objective (i.e. the ones
+  // not controlled by the use_preprocessing() parameter) are run.
+  void RunPreprocessors(bool skip_presolve, const TimeLimit& time_limit);
 
   // Runs the given preprocessor and pushes it when relevant (i.e. when it did
   // something) on the preprocessors_ stack.
@@ -147,6 +173,21 @@ class LPSolver {
   // already solved by the preprocessors).
   void RunRevisedSimplexIfNeeded(ProblemSolution* solution);
 
+  // Copies the solution of revised_simplex_ into the given solution.
+  void StoreRevisedSimplexSolution(ProblemSolution* solution);
+
+  // Improves the accuracy of the given optimal solution of the current linear
+  // program with the final basis factorization of revised_simplex_. See
+  // use_iterative_refinement in the GlopParameters proto. Returns false if the
+  // refined solution is not primal or dual feasible within the tolerances.
+  bool RefineSolution(ProblemSolution* solution);
+
+  // Splits the current linear program into independent subproblems, solves
+  // them (in parallel if num_subproblem_threads() > 1) and aggregates their
+  // solutions. Returns false and leaves the solution untouched if the problem
+  // can't be decomposed or if one subproblem couldn't be solved to optimality.
+  bool SolveIndependentSubproblems(ProblemSolution* solution);
+
   // Postprocess the solution by calling the StoreSolution() of the
   // preprocessors in the reverse order in which their where applied.
   void PostprocessSolution(ProblemSolution* solution);
@@ -207,6 +248,12 @@ class LPSolver {
   RowIndex initial_num_rows_;
   ColIndex initial_num_cols_;
 
+  // Fingerprint of the constraint matrix of the linear program given to the
+  // last Solve(), and whether it is valid. This is used to implement the
+  // skip_preprocessing_if_matrix_unchanged parameter.
+  uint64 last_matrix_fingerprint_;
+  bool has_last_matrix_fingerprint_;
+
   // On a call to Solve(), this is initialized to an exact copy of the given
   // linear program. It is later modified by the preprocessors and then solved
   // by the revised simplex.
@@ -218,9 +265,20 @@ class LPSolver {
   // The revised simplex solver.
   std::unique_ptr<RevisedSimplex> revised_simplex_;
 
+  // The basis given by SetInitialBasis(), in the revised simplex format: the
+  // variable statuses followed by the slack variable statuses.
+  BasisState initial_basis_;
+
+  // See SetInterruptFlag(), may be nullptr.
+  const std::atomic<bool>* interrupt_;
+
   // The number of revised simplex iterations used by the last Solve().
   int num_revised_simplex_iterations_;
 
+  // The deterministic time spent in the RevisedSimplex instances used by
+  // SolveIndependentSubproblems() since the creation of the solver.
+  double subproblems_deterministic_time_;
+
   // The current ProblemSolution.
   // TODO(user): use a ProblemSolution directly?
   ProblemStatus status_;
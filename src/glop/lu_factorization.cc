@@ -261,6 +261,113 @@ void LuFactorization::LeftSolveL(DenseRow* y) const {
   ApplyInversePermutation(row_perm_, dense_column_scratchpad_, x);
 }
 
+void LuFactorization::RightSolveMultiple(
+    const std::vector<DenseColumn*>& x) const {
+  RightSolveLMultiple(x);
+  RightSolveUMultiple(x);
+}
+
+void LuFactorization::SparseRightSolveMultiple(
+    const std::vector<const SparseColumn*>& b, RowIndex num_rows,
+    const std::vector<DenseColumn*>& x) const {
+  RightSolveLForSparseColumns(b, num_rows, x);
+  RightSolveUMultiple(x);
+}
+
+void LuFactorization::LeftSolveMultiple(const std::vector<DenseRow*>& y) const {
+  LeftSolveUMultiple(y);
+  LeftSolveLMultiple(y);
+}
+
+void LuFactorization::RightSolveLMultiple(
+    const std::vector<DenseColumn*>& x) const {
+  SCOPED_TIME_STAT(&stats_);
+  if (is_identity_factorization_) return;
+  for (DenseColumn* const column : x) {
+    column->swap(dense_column_scratchpad_);
+    ApplyPermutation(row_perm_, dense_column_scratchpad_, column);
+  }
+  lower_.LowerSolveMultiple(x, parameters_.num_omp_threads());
+}
+
+void LuFactorization::RightSolveLForSparseColumns(
+    const std::vector<const SparseColumn*>& b, RowIndex num_rows,
+    const std::vector<DenseColumn*>& x) const {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK_EQ(b.size(), x.size());
+  const int num_rhs = b.size();
+  if (is_identity_factorization_) {
+    for (int i = 0; i < num_rhs; ++i) {
+      b[i]->CopyToDenseVector(num_rows, x[i]);
+    }
+    return;
+  }
+  DCHECK_EQ(num_rows, lower_.num_rows());
+  DCHECK_EQ(num_rows, row_perm_.size());
+
+  // The symbolic phase is done once for the union of the non-zeros of all
+  // the b. Note that TriangularComputeRowsToConsider() deals with duplicates.
+  non_zero_rows_.clear();
+  for (int i = 0; i < num_rhs; ++i) {
+    b[i]->PermutedCopyToDenseVector(row_perm_, num_rows, x[i]);
+    for (const SparseColumn::Entry e : *b[i]) {
+      non_zero_rows_.push_back(row_perm_[e.row()]);
+    }
+  }
+  lower_.TriangularComputeRowsToConsider(&non_zero_rows_);
+  if (non_zero_rows_.empty()) {
+    lower_.LowerSolveMultiple(x, parameters_.num_omp_threads());
+  } else {
+    lower_.SparseTriangularSolveMultiple(non_zero_rows_, x,
+                                         parameters_.num_omp_threads());
+  }
+}
+
+void LuFactorization::RightSolveUMultiple(
+    const std::vector<DenseColumn*>& x) const {
+  SCOPED_TIME_STAT(&stats_);
+  if (is_identity_factorization_) return;
+  upper_.UpperSolveMultiple(x, parameters_.num_omp_threads());
+  if (col_perm_.empty()) return;
+  for (DenseColumn* const column : x) {
+    column->swap(dense_column_scratchpad_);
+    ApplyPermutation(inverse_col_perm_, dense_column_scratchpad_, column);
+  }
+}
+
+void LuFactorization::LeftSolveUMultiple(
+    const std::vector<DenseRow*>& y) const {
+  SCOPED_TIME_STAT(&stats_);
+  if (is_identity_factorization_) return;
+  multiple_solve_columns_.clear();
+  for (DenseRow* const row : y) {
+    DenseColumn* const x = DenseRowAsColumn(row);
+    if (!col_perm_.empty()) {
+      ApplyInversePermutation(inverse_col_perm_, *x, &dense_column_scratchpad_);
+      x->swap(dense_column_scratchpad_);
+    }
+    multiple_solve_columns_.push_back(x);
+  }
+  upper_.TransposeUpperSolveMultiple(multiple_solve_columns_,
+                                     parameters_.num_omp_threads());
+}
+
+void LuFactorization::LeftSolveLMultiple(
+    const std::vector<DenseRow*>& y) const {
+  SCOPED_TIME_STAT(&stats_);
+  if (is_identity_factorization_) return;
+  multiple_solve_columns_.clear();
+  for (DenseRow* const row : y) {
+    multiple_solve_columns_.push_back(DenseRowAsColumn(row));
+  }
+  lower_.TransposeLowerSolveMultiple(multiple_solve_columns_,
+                                     parameters_.num_omp_threads());
+  for (DenseColumn* const x : multiple_solve_columns_) {
+    x->swap(dense_column_scratchpad_);
+    ApplyInversePermutation(row_perm_, dense_column_scratchpad_, x);
+  }
+}
+
 void LuFactorization::RightSolveLForSparseColumn(const SparseColumn& b,
                                                  DenseColumn* x) const {
   SCOPED_TIME_STAT(&stats_);
@@ -136,6 +136,31 @@ class LuFactorization {
   void LeftSolveLWithNonZeros(DenseRow* y, ColIndexVector* non_zeros,
                               DenseColumn* result_before_permutation) const;
 
+  // Versions of RightSolve(), SparseRightSolve() and LeftSolve() for many
+  // right-hand sides at once. The triangular solves are done in small blocks
+  // of rhs so the L and U factors are read once per block instead of once per
+  // rhs, see TriangularMatrix::LowerSolveMultiple(). When compiled with OMP,
+  // the blocks are solved in parallel using parameters_.num_omp_threads().
+  //
+  // SparseRightSolveMultiple() computes the non-zero positions of the solve
+  // by L only once, from the union of the non-zeros of all the b, and uses
+  // an hyper-sparse solve if this union is sparse enough. x[i] will contain
+  // the solution for b[i].
+  void RightSolveMultiple(const std::vector<DenseColumn*>& x) const;
+  void SparseRightSolveMultiple(const std::vector<const SparseColumn*>& b,
+                                RowIndex num_rows,
+                                const std::vector<DenseColumn*>& x) const;
+  void LeftSolveMultiple(const std::vector<DenseRow*>& y) const;
+
+  // Same as the fine-grained solve functions above, for many rhs at once.
+  void RightSolveLMultiple(const std::vector<DenseColumn*>& x) const;
+  void RightSolveLForSparseColumns(const std::vector<const SparseColumn*>& b,
+                                   RowIndex num_rows,
+                                   const std::vector<DenseColumn*>& x) const;
+  void RightSolveUMultiple(const std::vector<DenseColumn*>& x) const;
+  void LeftSolveUMultiple(const std::vector<DenseRow*>& y) const;
+  void LeftSolveLMultiple(const std::vector<DenseRow*>& y) const;
+
   // Returns the given column of U.
   // It will only be valid until the next call to GetColumnOfU().
   const SparseColumn& GetColumnOfU(ColIndex col) const;
@@ -271,6 +296,10 @@ class LuFactorization {
   // Temporary storage used by LeftSolve()/RightSolve().
   mutable DenseColumn dense_column_scratchpad_;
 
+  // Temporary storage used by the *Multiple() solves to view the given
+  // DenseRow as DenseColumn.
+  mutable std::vector<DenseColumn*> multiple_solve_columns_;
+
   // Temporary storage used by GetColumnOfU().
   mutable SparseColumn column_of_upper_;
 
@@ -13,6 +13,10 @@
 
 #include "glop/markowitz.h"
 
+#ifdef OMP
+#include <omp.h>
+#endif
+
 #include <limits>
 #include "base/stringprintf.h"
 #include "lp_data/lp_utils.h"
@@ -561,6 +565,9 @@ void MatrixNonZeroPattern::Clear() {
   deleted_columns_.clear();
   bool_scratchpad_.clear();
   num_non_deleted_columns_ = 0;
+  rows_to_merge_.clear();
+  thread_bool_scratchpads_.clear();
+  fill_ins_.clear();
 }
 
 void MatrixNonZeroPattern::Reset(RowIndex num_rows, ColIndex num_cols) {
@@ -688,6 +695,7 @@ void MatrixNonZeroPattern::Update(RowIndex pivot_row, ColIndex pivot_col,
   // from 0.0. Note that the column must contain all the symbolic non-zeros for
   // the row degree to be updated correctly. Note also that decreasing the row
   // degrees due to the deletion of pivot_col will happen outside this function.
+  rows_to_merge_.clear();
   for (const SparseColumn::Entry e : column) {
     const RowIndex row = e.row();
     if (row == pivot_row) continue;
@@ -697,7 +705,22 @@ void MatrixNonZeroPattern::Update(RowIndex pivot_row, ColIndex pivot_col,
     // the matrix become dense.
     if (e.coefficient() == 0.0 || row_degree_[row] == max_row_degree) continue;
     DCHECK_LT(row_degree_[row], max_row_degree);
+    rows_to_merge_.push_back(row);
+  }
 
+#ifdef OMP
+  // The merges of the different rows are independent. We only parallelize
+  // them if there is enough work to compensate for the threads overhead.
+  const int kMinWorkForParallelMerge = 10000;
+  if (num_threads_ > 1 &&
+      rows_to_merge_.size() * row_non_zero_[pivot_row].size() >=
+          kMinWorkForParallelMerge) {
+    ParallelMergeInto(pivot_row, rows_to_merge_);
+    return;
+  }
+#endif
+
+  for (const RowIndex row : rows_to_merge_) {
     // We only clean row_non_zero_[row] if there are more than 4 entries to
     // delete. Note(user): the 4 is somewhat arbitrary, but gives good results
     // on the Netlib (23/04/2013). Note that calling
@@ -748,6 +771,61 @@ void MatrixNonZeroPattern::MergeInto(RowIndex pivot_row, RowIndex row) {
                             col_scratchpad_.end());
 }
 
+void MatrixNonZeroPattern::ParallelMergeInto(
+    RowIndex pivot_row, const std::vector<RowIndex>& rows) {
+#ifdef OMP
+  // Each scratchpad must be false on the positions in row_non_zero_[pivot_row]
+  // like bool_scratchpad_ in MergeInto(). The other positions are never read.
+  const std::vector<ColIndex>& pivot_row_non_zero = row_non_zero_[pivot_row];
+  thread_bool_scratchpads_.resize(num_threads_);
+  for (DenseBooleanRow& scratchpad : thread_bool_scratchpads_) {
+    scratchpad.resize(bool_scratchpad_.size(), false);
+    for (const ColIndex col : pivot_row_non_zero) scratchpad[col] = false;
+  }
+
+  // Compute the fill-in of each row. Note that the cleaning of a row only
+  // touches this row, so it can also be done in parallel.
+  const int num_rows = rows.size();
+  if (fill_ins_.size() < num_rows) fill_ins_.resize(num_rows);
+  const int kDeletionThreshold = 4;
+#pragma omp parallel for num_threads(num_threads_)
+  for (int i = 0; i < num_rows; ++i) {
+    const RowIndex row = rows[i];
+    if (row_non_zero_[row].size() > row_degree_[row] + kDeletionThreshold) {
+      RemoveDeletedColumnsFromRow(row);
+    }
+    DenseBooleanRow& scratchpad =
+        thread_bool_scratchpads_[omp_get_thread_num()];
+    std::vector<ColIndex>& fill_in = fill_ins_[i];
+    fill_in.clear();
+    for (const ColIndex col : row_non_zero_[row]) {
+      scratchpad[col] = true;
+    }
+    for (const ColIndex col : pivot_row_non_zero) {
+      if (scratchpad[col]) {
+        scratchpad[col] = false;
+      } else {
+        fill_in.push_back(col);
+      }
+    }
+  }
+  // end of omp parallel for
+
+  // Add the fill-in to the pattern.
+  for (int i = 0; i < num_rows; ++i) {
+    const RowIndex row = rows[i];
+    for (const ColIndex col : fill_ins_[i]) {
+      ++col_degree_[col];
+    }
+    row_degree_[row] += fill_ins_[i].size();
+    row_non_zero_[row].insert(row_non_zero_[row].end(), fill_ins_[i].begin(),
+                              fill_ins_[i].end());
+  }
+#else   // OMP
+  for (const RowIndex row : rows) MergeInto(pivot_row, row);
+#endif  // OMP
+}
+
 namespace {
 
 // Given two sorted vectors (the second one is the initial value of out), merges
@@ -94,7 +94,11 @@ namespace glop {
 // given step will only correspond to a subset of the initial indices.
 class MatrixNonZeroPattern {
  public:
-  MatrixNonZeroPattern() {}
+  MatrixNonZeroPattern() : num_threads_(1) {}
+
+  // Sets the number of threads used by Update(). This is only used if the code
+  // is compiled with OMP, and the result does not depend on it.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
 
   // Releases the memory used by this class.
   void Clear();
@@ -173,6 +177,12 @@ class MatrixNonZeroPattern {
   // non-sorted version. Investigate more.
   void MergeIntoSorted(RowIndex pivot_row, RowIndex row);
 
+  // Same as calling MergeInto(pivot_row, row) for all the given rows, but the
+  // fill-in of the rows is computed in parallel. Each thread uses its own
+  // scratchpad and the degrees are updated afterwards in the same order as in
+  // the sequential version, so the final pattern is exactly the same.
+  void ParallelMergeInto(RowIndex pivot_row, const std::vector<RowIndex>& rows);
+
   // TODO(user): use vector32 and maybe a specialized vector for small sizes
   // like InlinedVector?
   ITIVector<RowIndex, std::vector<ColIndex>> row_non_zero_;
@@ -183,6 +193,12 @@ class MatrixNonZeroPattern {
   std::vector<ColIndex> col_scratchpad_;
   ColIndex num_non_deleted_columns_;
 
+  // Used by Update() and ParallelMergeInto().
+  int num_threads_;
+  std::vector<RowIndex> rows_to_merge_;
+  std::vector<DenseBooleanRow> thread_bool_scratchpads_;
+  std::vector<std::vector<ColIndex>> fill_ins_;
+
   DISALLOW_COPY_AND_ASSIGN(MatrixNonZeroPattern);
 };
 
@@ -258,6 +274,7 @@ class Markowitz {
   // Sets the current parameters.
   void SetParameters(const GlopParameters& parameters) {
     parameters_ = parameters;
+    residual_matrix_non_zero_.SetNumThreads(parameters.num_omp_threads());
   }
 
  private:
@@ -322,7 +322,8 @@ bool ProportionalColumnPreprocessor::Run(LinearProgram* lp) {
   RETURN_VALUE_IF_NULL(lp, false);
   const Fractional kTolerance = parameters_.preprocessor_zero_tolerance();
   ColMapping mapping =
-      FindProportionalColumns(lp->GetSparseMatrix(), kTolerance);
+      FindProportionalColumns(lp->GetSparseMatrix(), kTolerance,
+                              parameters_.num_omp_threads());
 
   // Compute some statistics and make each class representative point to itself
   // in the mapping. Also store the columns that are proportional to at least
@@ -691,7 +692,8 @@ bool ProportionalRowPreprocessor::Run(LinearProgram* lp) {
   // We need the first representative of each proportional row class to point to
   // itself for the loop below. TODO(user): Already return such a mapping from
   // FindProportionalColumns()?
-  ColMapping mapping = FindProportionalColumns(transpose, kTolerance);
+  ColMapping mapping = FindProportionalColumns(transpose, kTolerance,
+                                               parameters_.num_omp_threads());
   DenseBooleanColumn is_a_representative(num_rows, false);
   int num_proportional_rows = 0;
   for (RowIndex row(0); row < num_rows; ++row) {
@@ -940,25 +942,57 @@ bool ForcingAndImpliedFreeConstraintPreprocessor::Run(LinearProgram* lp) {
   RETURN_VALUE_IF_NULL(lp, false);
   const RowIndex num_rows = lp->num_constraints();
 
-  // Compute the implied constraint bounds from the variable bounds.
-  DenseColumn implied_lower_bounds(num_rows, 0);
-  DenseColumn implied_upper_bounds(num_rows, 0);
+  // Compute the implied constraint bounds from the variable bounds. This only
+  // reads the problem, so it is done in parallel on chunks of columns that
+  // each compute their own partial bounds. These are then added in the chunk
+  // order, so the result only depends on the number of chunks.
   const ColIndex num_cols = lp->num_variables();
-  StrictITIVector<RowIndex, int> row_degree(num_rows, 0);
-  for (ColIndex col(0); col < num_cols; ++col) {
-    const Fractional lower = lp->variable_lower_bounds()[col];
-    const Fractional upper = lp->variable_upper_bounds()[col];
-    for (const SparseColumn::Entry e : lp->GetSparseColumn(col)) {
-      const RowIndex row = e.row();
-      const Fractional coeff = e.coefficient();
-      if (coeff > 0.0) {
-        implied_lower_bounds[row] += lower * coeff;
-        implied_upper_bounds[row] += upper * coeff;
-      } else {
-        implied_lower_bounds[row] += upper * coeff;
-        implied_upper_bounds[row] += lower * coeff;
-      }
-      ++row_degree[row];
+  const int num_chunks =
+      ComputeNumColumnChunks(num_cols, parameters_.num_omp_threads());
+  std::vector<DenseColumn> chunk_implied_lower_bounds(num_chunks);
+  std::vector<DenseColumn> chunk_implied_upper_bounds(num_chunks);
+  std::vector<StrictITIVector<RowIndex, int>> chunk_row_degree(num_chunks);
+  ForEachColumnChunk(
+      num_cols, num_chunks,
+      [lp, num_rows, &chunk_implied_lower_bounds, &chunk_implied_upper_bounds,
+       &chunk_row_degree](int chunk, ColIndex begin, ColIndex end) {
+        DenseColumn* const implied_lower_bounds =
+            &chunk_implied_lower_bounds[chunk];
+        DenseColumn* const implied_upper_bounds =
+            &chunk_implied_upper_bounds[chunk];
+        StrictITIVector<RowIndex, int>* const row_degree =
+            &chunk_row_degree[chunk];
+        implied_lower_bounds->assign(num_rows, 0);
+        implied_upper_bounds->assign(num_rows, 0);
+        row_degree->assign(num_rows, 0);
+        for (ColIndex col(begin); col < end; ++col) {
+          const Fractional lower = lp->variable_lower_bounds()[col];
+          const Fractional upper = lp->variable_upper_bounds()[col];
+          for (const SparseColumn::Entry e : lp->GetSparseColumn(col)) {
+            const RowIndex row = e.row();
+            const Fractional coeff = e.coefficient();
+            if (coeff > 0.0) {
+              (*implied_lower_bounds)[row] += lower * coeff;
+              (*implied_upper_bounds)[row] += upper * coeff;
+            } else {
+              (*implied_lower_bounds)[row] += upper * coeff;
+              (*implied_upper_bounds)[row] += lower * coeff;
+            }
+            ++(*row_degree)[row];
+          }
+        }
+      });
+  DenseColumn implied_lower_bounds;
+  DenseColumn implied_upper_bounds;
+  StrictITIVector<RowIndex, int> row_degree;
+  implied_lower_bounds.swap(chunk_implied_lower_bounds[0]);
+  implied_upper_bounds.swap(chunk_implied_upper_bounds[0]);
+  row_degree.swap(chunk_row_degree[0]);
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    for (RowIndex row(0); row < num_rows; ++row) {
+      implied_lower_bounds[row] += chunk_implied_lower_bounds[chunk][row];
+      implied_upper_bounds[row] += chunk_implied_upper_bounds[chunk][row];
+      row_degree[row] += chunk_row_degree[chunk][row];
     }
   }
 
@@ -3126,6 +3160,11 @@ bool ScalingPreprocessor::Run(LinearProgram* linear_program) {
     variable_upper_bounds_[col] = linear_program->variable_upper_bounds()[col];
   }
 
+  scaler_.SetScalingAlgorithm(
+      parameters_.scaling_method() == GlopParameters::CURTIS_REID_SCALING
+          ? SparseMatrixScaler::CURTIS_REID_SCALING
+          : SparseMatrixScaler::GEOMETRIC_SCALING);
+  scaler_.SetNumThreads(parameters_.num_omp_threads());
   linear_program->Scale(&scaler_);
   return true;
 }
@@ -866,7 +866,8 @@ class ShiftVariableBoundsPreprocessor : public Preprocessor {
 // ScalingPreprocessor
 // --------------------------------------------------------
 // Scales the SparseMatrix of the linear program using a SparseMatrixScaler.
-// This is only applied if the parameter use_scaling is true.
+// This is only applied if the parameter use_scaling is true, the algorithm
+// is chosen with the parameter scaling_method.
 class ScalingPreprocessor : public Preprocessor {
  public:
   ScalingPreprocessor() {}
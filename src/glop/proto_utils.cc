@@ -63,6 +63,12 @@ void MPModelProtoToLinearProgram(const new_proto::MPModelProto& input,
     output->SetObjectiveCoefficient(col, var.objective_coefficient());
     output->SetVariableIntegrality(col, var.is_integer());
   }
+  int num_entries = 0;
+  for (int j = 0; j < input.constraint_size(); ++j) {
+    num_entries += input.constraint(j).var_index_size();
+  }
+  SparseMatrixBuilder triplets;
+  triplets.Reserve(EntryIndex(num_entries));
   for (int j = 0; j < input.constraint_size(); ++j) {
     const new_proto::MPConstraintProto& cst = input.constraint(j);
     const RowIndex row = output->CreateNewConstraint();
@@ -72,10 +78,10 @@ void MPModelProtoToLinearProgram(const new_proto::MPModelProto& input,
     // linear solver server and re-use it here.
     CHECK_EQ(cst.var_index_size(), cst.coefficient_size());
     for (int k = 0; k < cst.var_index_size(); ++k) {
-      output->SetCoefficient(row, ColIndex(cst.var_index(k)),
-                             cst.coefficient(k));
+      triplets.AddEntry(row, ColIndex(cst.var_index(k)), cst.coefficient(k));
     }
   }
+  output->PopulateMatrixFromTriplets(&triplets);
 }
 
 }  // namespace glop
@@ -33,6 +33,7 @@
 #include "lp_data/lp_utils.h"
 #include "lp_data/matrix_utils.h"
 #include "util/fp_utils.h"
+#include "util/metrics.h"
 
 DEFINE_bool(simplex_display_numbers_as_fractions, false,
             "Display numbers as fractions.");
@@ -95,6 +96,7 @@ RevisedSimplex::RevisedSimplex()
       ratio_test_stats_(),
       function_stats_("SimplexFunctionStats"),
       parameters_(),
+      interrupt_(nullptr),
       test_lu_(),
       feasibility_phase_(true),
       random_("This is a deterministic seed.") {
@@ -118,6 +120,7 @@ Status RevisedSimplex::Solve(const LinearProgram& lp) {
   SCOPED_TIME_STAT(&function_stats_);
   DCHECK(lp.IsCleanedUp());
   TimeLimit time_limit(parameters_.max_time_in_seconds());
+  time_limit.RegisterExternalBooleanAsLimit(interrupt_);
   WallTimer timer;
   timer.Start();
 
@@ -254,6 +257,13 @@ Status RevisedSimplex::Solve(const LinearProgram& lp) {
   optimization_time_ = total_time_ - feasibility_time_;
   num_optimization_iterations_ = num_iterations_ - num_feasibility_iterations_;
   DisplayAllStats();
+  MetricsRegistry* const metrics = MetricsRegistry::Global();
+  if (metrics->enabled()) {
+    metrics->IncrementCounter("glop", "solves", 1);
+    metrics->AddToHistogram("glop", "solve_time_seconds", total_time_);
+    metrics->PublishThroughput("glop", "iterations", num_iterations_,
+                               total_time_);
+  }
   return Status::OK;
 }
 
@@ -561,7 +571,8 @@ void RevisedSimplex::UseSingletonColumnInInitialBasis(RowToColMapping* basis) {
 }
 
 bool RevisedSimplex::InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
-                                                        bool* only_new_rows) {
+                                                        bool* only_new_rows,
+                                                        bool* only_new_cols) {
   SCOPED_TIME_STAT(&function_stats_);
   DCHECK_EQ(num_cols_, compact_matrix_.num_cols());
   DCHECK_EQ(num_rows_, compact_matrix_.num_rows());
@@ -578,6 +589,14 @@ bool RevisedSimplex::InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
     // TODO(user): use compact_matrix_ everywhere instead.
     matrix_with_slack_.PopulateFromMatrixPair(lp.GetSparseMatrix(),
                                               identity_matrix_);
+
+    // The transposed matrix is reused, unless it was not computed by the
+    // previous solve.
+    if (parameters_.use_transposed_matrix() &&
+        transposed_matrix_.num_cols() != RowToColIndex(num_rows_)) {
+      transposed_matrix_.PopulateFromTranspose(compact_matrix_,
+                                               parameters_.num_omp_threads());
+    }
     return true;
   }
 
@@ -589,6 +608,16 @@ bool RevisedSimplex::InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
       AreFirstColumnsAndRowsExactlyEquals(
           num_rows_, first_slack_col_, lp.GetSparseMatrix(), compact_matrix_);
 
+  // Same for new columns (i.e. new variables). Note that the slack columns are
+  // after the new columns, so their indices will be shifted.
+  *only_new_cols =
+      lp.num_constraints() == num_rows_ &&
+      lp.num_variables() > first_slack_col_ &&
+      AreFirstColumnsAndRowsExactlyEquals(
+          num_rows_, first_slack_col_, lp.GetSparseMatrix(), compact_matrix_);
+  const ColIndex num_new_cols =
+      *only_new_cols ? lp.num_variables() - first_slack_col_ : ColIndex(0);
+
   // Initialize matrix_with_slack_. Note that many of the slack variables may
   // not be useful at all, but in order not to recompute the matrix from one
   // Solve() to the next, we include all of them for a given lp matrix.
@@ -599,6 +628,14 @@ bool RevisedSimplex::InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
   matrix_with_slack_.PopulateFromMatrixPair(lp.GetSparseMatrix(),
                                             identity_matrix_);
 
+  // The basic slack columns are shifted by the new columns. The basis matrix
+  // itself is unchanged.
+  if (*only_new_cols) {
+    for (RowIndex row(0); row < basis_.size(); ++row) {
+      if (basis_[row] >= first_slack_col_) basis_[row] += num_new_cols;
+    }
+  }
+
   // Initialize the new dimensions.
   num_rows_ = lp.num_constraints();
   first_slack_col_ = lp.num_variables();
@@ -609,7 +646,11 @@ bool RevisedSimplex::InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
   // matrix_ will not change anymore.
   compact_matrix_.PopulateFromMatrixView(matrix_with_slack_);
   if (parameters_.use_transposed_matrix()) {
-    transposed_matrix_.PopulateFromTranspose(compact_matrix_);
+    transposed_matrix_.PopulateFromTranspose(compact_matrix_,
+                                             parameters_.num_omp_threads());
+  } else {
+    // So that a later solve with an unchanged matrix does not reuse it.
+    transposed_matrix_.Reset(RowIndex(0));
   }
   return false;
 }
@@ -881,8 +922,9 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
   // Note that these functions can't depend on use_dual_simplex() since we may
   // change it below.
   bool only_new_rows = false;
+  bool only_new_cols = false;
   bool is_matrix_unchanged =
-      InitializeMatrixAndTestIfUnchanged(lp, &only_new_rows);
+      InitializeMatrixAndTestIfUnchanged(lp, &only_new_rows, &only_new_cols);
   bool is_objective_unchanged = InitializeObjectiveAndTestIfUnchanged(lp);
   bool are_bounds_unchanged = InitializeBoundsAndTestIfUnchanged(lp);
 
@@ -900,6 +942,13 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
     }
   }
 
+  // The new columns of a column generation scheme usually make the current
+  // solution dual infeasible but leave it primal feasible.
+  if (only_new_cols && parameters_.allow_simplex_algorithm_change()) {
+    parameters_.set_use_dual_simplex(false);
+    PropagateParameters();
+  }
+
   InitializeObjectiveLimit(lp);
 
   // Computes the variable name as soon as possible for logging.
@@ -925,12 +974,47 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
       dual_edge_norms_.Clear();
       dual_pricing_vector_.clear();
 
-      if (is_matrix_unchanged && are_bounds_unchanged &&
-          (problem_status_ == ProblemStatus::OPTIMAL ||
-           problem_status_ == ProblemStatus::PRIMAL_UNBOUNDED ||
-           problem_status_ == ProblemStatus::PRIMAL_FEASIBLE)) {
+      if (solution_state_has_been_set_externally_) {
+        // This is used for the crossover from an interior point solution.
+        // The phase I of the primal simplex can start from any basis as long
+        // as it is refactorizable. InitializeFirstBasis() completes it with
+        // slack columns if needed.
+        InitializeVariableStatusesForWarmStart(solution_state_);
+        basis_.assign(num_rows_, kInvalidCol);
+        RowIndex row(0);
+        for (ColIndex col : variables_info_.GetIsBasicBitRow()) {
+          basis_[row] = col;
+          ++row;
+        }
+        if (InitializeFirstBasis(basis_).ok()) {
+          primal_edge_norms_.Clear();
+          reduced_costs_.ClearAndRemoveCostShifts();
+          solve_from_scratch = false;
+        }
+      } else if (is_matrix_unchanged && are_bounds_unchanged &&
+                 (problem_status_ == ProblemStatus::OPTIMAL ||
+                  problem_status_ == ProblemStatus::PRIMAL_UNBOUNDED ||
+                  problem_status_ == ProblemStatus::PRIMAL_FEASIBLE)) {
         reduced_costs_.ClearAndRemoveCostShifts();
         solve_from_scratch = false;
+      } else if (only_new_cols &&
+                 (problem_status_ == ProblemStatus::OPTIMAL ||
+                  problem_status_ == ProblemStatus::PRIMAL_UNBOUNDED ||
+                  problem_status_ == ProblemStatus::PRIMAL_FEASIBLE)) {
+        // The basis matrix is the same, so we keep its factorization. The new
+        // columns start at their default bound, so the basis is still primal
+        // feasible if none of them starts at a non-zero value and the bounds
+        // of the other variables didn't change. This is checked below.
+        InitializeVariableStatusesForWarmStart(solution_state_);
+        if (basis_factorization_.InitializeForNewColumns().ok()) {
+          variable_values_.RecomputeBasicVariableValues();
+          if (variable_values_.ComputeMaximumPrimalInfeasibility() <=
+              parameters_.primal_feasibility_tolerance()) {
+            primal_edge_norms_.Clear();
+            reduced_costs_.ClearAndRemoveCostShifts();
+            solve_from_scratch = false;
+          }
+        }
       }
     } else {
       // First, always clear the primal norms.
@@ -1630,18 +1714,79 @@ Status RevisedSimplex::DualChooseLeavingVariableRow(RowIndex* leaving_row,
   const DenseColumn& squared_infeasibilities =
       variable_values_.GetPrimalSquaredInfeasibilities();
   equivalent_leaving_choices_.clear();
-  for (const RowIndex row : variable_values_.GetPrimalInfeasiblePositions()) {
-    const Fractional scaled_best_price = best_price * squared_norm[row];
-    if (squared_infeasibilities[row] >= scaled_best_price) {
-      if (squared_infeasibilities[row] == scaled_best_price) {
-        DCHECK_NE(*leaving_row, kInvalidRow);
-        equivalent_leaving_choices_.push_back(row);
-        continue;
+#ifdef OMP
+  const int num_omp_threads = parameters_.num_omp_threads();
+#else
+  const int num_omp_threads = 1;
+#endif
+  if (num_omp_threads == 1) {
+    for (const RowIndex row : variable_values_.GetPrimalInfeasiblePositions()) {
+      const Fractional scaled_best_price = best_price * squared_norm[row];
+      if (squared_infeasibilities[row] >= scaled_best_price) {
+        if (squared_infeasibilities[row] == scaled_best_price) {
+          DCHECK_NE(*leaving_row, kInvalidRow);
+          equivalent_leaving_choices_.push_back(row);
+          continue;
+        }
+        equivalent_leaving_choices_.clear();
+        best_price = squared_infeasibilities[row] / squared_norm[row];
+        *leaving_row = row;
+      }
+    }
+  } else {
+#ifdef OMP
+    // In the multi-threaded case, each thread performs the same computation as
+    // in the single-threaded case above on a chunk of the infeasible rows.
+    // The best row of each chunk (and its ties) are then merged in order, so
+    // the result does not depend on the thread scheduling.
+    primal_infeasible_rows_.clear();
+    for (const RowIndex row : variable_values_.GetPrimalInfeasiblePositions()) {
+      primal_infeasible_rows_.push_back(row);
+    }
+    const int size = primal_infeasible_rows_.size();
+    std::vector<RowIndex> thread_leaving_row(num_omp_threads, kInvalidRow);
+    std::vector<Fractional> thread_best_price(num_omp_threads, 0.0);
+    std::vector<std::vector<RowIndex>> thread_equivalent_choices(
+        num_omp_threads);
+#pragma omp parallel for num_threads(num_omp_threads)
+    for (int i = 0; i < num_omp_threads; i++) {
+      const int end = (i + 1) * size / num_omp_threads;
+      for (int j = i * size / num_omp_threads; j < end; ++j) {
+        const RowIndex row = primal_infeasible_rows_[j];
+        const Fractional scaled_best_price =
+            thread_best_price[i] * squared_norm[row];
+        if (squared_infeasibilities[row] >= scaled_best_price) {
+          if (squared_infeasibilities[row] == scaled_best_price) {
+            thread_equivalent_choices[i].push_back(row);
+            continue;
+          }
+          thread_equivalent_choices[i].clear();
+          thread_best_price[i] =
+              squared_infeasibilities[row] / squared_norm[row];
+          thread_leaving_row[i] = row;
+        }
+      }
+    }
+    // end of omp parallel for
+    for (int i = 0; i < num_omp_threads; i++) {
+      const RowIndex row = thread_leaving_row[i];
+      if (row == kInvalidRow) continue;
+      const Fractional scaled_best_price = best_price * squared_norm[row];
+      if (squared_infeasibilities[row] >= scaled_best_price) {
+        if (squared_infeasibilities[row] == scaled_best_price) {
+          DCHECK_NE(*leaving_row, kInvalidRow);
+          equivalent_leaving_choices_.push_back(row);
+        } else {
+          equivalent_leaving_choices_.clear();
+          best_price = thread_best_price[i];
+          *leaving_row = row;
+        }
+        equivalent_leaving_choices_.insert(equivalent_leaving_choices_.end(),
+                                           thread_equivalent_choices[i].begin(),
+                                           thread_equivalent_choices[i].end());
       }
-      equivalent_leaving_choices_.clear();
-      best_price = squared_infeasibilities[row] / squared_norm[row];
-      *leaving_row = row;
     }
+#endif  // OMP
   }
 
   // Break the ties randomly.
@@ -2040,8 +2185,7 @@ Status RevisedSimplex::Minimize(TimeLimit* time_limit) {
   }
 
   while (true) {
-    IF_STATS_ENABLED(
-        ScopedTimeDistributionUpdater timer(&iteration_stats_.total));
+    ScopedTimeDistributionUpdater timer(&iteration_stats_.total);
     RETURN_IF_ERROR(RefactorizeBasisIfNeeded(&refactorize));
     if (basis_factorization_.IsRefactorized()) {
       CorrectErrorsOnVariableValues();
@@ -2293,8 +2437,7 @@ Status RevisedSimplex::DualMinimize(TimeLimit* time_limit) {
   std::vector<ColIndex> bound_flip_candidates;
   while (num_iterations_ < parameters_.max_number_of_iterations() &&
          !time_limit->LimitReached()) {
-    IF_STATS_ENABLED(
-        ScopedTimeDistributionUpdater timer(&iteration_stats_.total));
+    ScopedTimeDistributionUpdater timer(&iteration_stats_.total);
 
     // Leaving variable.
     RowIndex leaving_row;
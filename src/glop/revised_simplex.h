@@ -95,6 +95,7 @@
 #ifndef OR_TOOLS_GLOP_REVISED_SIMPLEX_H_
 #define OR_TOOLS_GLOP_REVISED_SIMPLEX_H_
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -160,6 +161,12 @@ class RevisedSimplex {
   void SetParameters(const GlopParameters& parameters);
   const GlopParameters& GetParameters() const { return parameters_; }
 
+  // Makes Solve() stop as soon as *interrupt is true, as if its time limit
+  // was reached. The boolean must outlive this object; nullptr unregisters it.
+  void SetInterruptFlag(const std::atomic<bool>* interrupt) {
+    interrupt_ = interrupt;
+  }
+
   // Solves the given linear program.
   //
   // By default, the algorithm tries to exploit the computation done during the
@@ -213,14 +220,6 @@ class RevisedSimplex {
   // Returns statistics about this class as a std::string.
   std::string StatString();
 
- private:
-  // Propagates parameters_ to all the other classes that need it.
-  //
-  // TODO(user): Maybe a better design is for them to have a reference to a
-  // unique parameters object? it will clutter a bit more these classes
-  // contructor though.
-  void PropagateParameters();
-
   // Returns a std::string containing the same information as with GetSolverStats,
   // but in a much more human-readable format. For example:
   //     Problem status                               : Optimal
@@ -235,6 +234,14 @@ class RevisedSimplex {
   //     Stop after first basis                       : 0
   std::string GetPrettySolverStats() const;
 
+ private:
+  // Propagates parameters_ to all the other classes that need it.
+  //
+  // TODO(user): Maybe a better design is for them to have a reference to a
+  // unique parameters object? it will clutter a bit more these classes
+  // contructor though.
+  void PropagateParameters();
+
   // Returns a std::string containing formatted information about the variable
   // corresponding to column col.
   std::string SimpleVariableInfo(ColIndex col) const;
@@ -300,10 +307,12 @@ class RevisedSimplex {
                    VariableStatus leaving_variable_status);
 
   // Initializes matrix-related internal data. Returns true if this data was
-  // unchanged. If not, also sets only_new_rows to true if compared to the
-  // current matrix, the only difference is that new rows have been added.
+  // unchanged. If not, also sets only_new_rows (resp. only_new_cols) to true if
+  // compared to the current matrix, the only difference is that new rows (resp.
+  // new columns) have been added.
   bool InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
-                                          bool* only_new_rows);
+                                          bool* only_new_rows,
+                                          bool* only_new_cols);
 
   // Initializes bound-related internal data. Returns true if unchanged.
   bool InitializeBoundsAndTestIfUnchanged(const LinearProgram& lp);
@@ -712,6 +721,9 @@ class RevisedSimplex {
   GlopParameters parameters_;
   GlopParameters initial_parameters_;
 
+  // See SetInterruptFlag(), may be nullptr.
+  const std::atomic<bool>* interrupt_;
+
   // LuFactorization used to test if a pivot will cause the new basis to
   // not be factorizable.
   LuFactorization test_lu_;
@@ -728,6 +740,10 @@ class RevisedSimplex {
   // anyway.
   std::vector<RowIndex> equivalent_leaving_choices_;
 
+  // Used by DualChooseLeavingVariableRow() to split the primal infeasible
+  // positions among the threads.
+  std::vector<RowIndex> primal_infeasible_rows_;
+
   // A random number generator.
   MTRandom random_;
 
@@ -0,0 +1,307 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "glop/sparse_cholesky.h"
+
+#ifdef OMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace operations_research {
+namespace glop {
+
+namespace {
+
+// A pivot smaller than this ratio times the corresponding diagonal entry of the
+// matrix is considered to be zero and is replaced by kHugePivot.
+const Fractional kSmallPivotRatio = 1e-14;
+const Fractional kHugePivot = 1e128;
+
+}  // namespace
+
+SparseCholesky::SparseCholesky()
+    : num_rows_(0), matrix_(nullptr), num_skipped_pivots_(0) {}
+
+void SparseCholesky::ComputeSymbolicFactorization(const SparseMatrix& matrix) {
+  SCOPED_TIME_STAT(&stats_);
+  matrix_ = &matrix;
+  num_rows_ = matrix.num_rows();
+  transpose_.PopulateFromTranspose(matrix);
+
+  // The graph of M has an edge between two rows of A if they share a column.
+  ITIVector<RowIndex, std::vector<RowIndex>> adjacency(num_rows_.value());
+  StrictITIVector<RowIndex, RowIndex> last_seen(num_rows_, kInvalidRow);
+  EntryIndex num_entries_in_m(0);
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    last_seen[row] = row;
+    for (const SparseColumn::Entry e : transpose_.column(RowToColIndex(row))) {
+      const ColIndex col = RowToColIndex(e.row());
+      for (const SparseColumn::Entry f : matrix.column(col)) {
+        if (last_seen[f.row()] == row) continue;
+        last_seen[f.row()] = row;
+        adjacency[row].push_back(f.row());
+      }
+    }
+    num_entries_in_m += adjacency[row].size();
+  }
+  ComputeOrderingAndPattern(&adjacency);
+  ComputeEliminationTreeLevels();
+
+  // Note that M has (num_entries_in_m / 2) strictly lower triangular entries.
+  stats_.fill_in.Add(num_entries_in_m == 0
+                         ? 1.0
+                         : 2.0 * rows_.size() / num_entries_in_m.value());
+  stats_.num_levels.Add(level_starts_.size() - 1);
+}
+
+void SparseCholesky::ComputeOrderingAndPattern(
+    ITIVector<RowIndex, std::vector<RowIndex>>* adjacency) {
+  // This is a straightforward implementation of the minimum degree heuristic
+  // on the elimination graph: eliminating a node v turns its neighbors into a
+  // clique, and these neighbors are exactly the pattern of the column of L
+  // corresponding to v. The priority queue may contain outdated degrees that
+  // are just skipped.
+  typedef std::pair<int, int> DegreeAndNode;
+  std::priority_queue<DegreeAndNode, std::vector<DegreeAndNode>,
+                      std::greater<DegreeAndNode>> queue;
+  StrictITIVector<RowIndex, int> degree(num_rows_, 0);
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    degree[row] = (*adjacency)[row].size();
+    queue.push(DegreeAndNode(degree[row], row.value()));
+  }
+
+  row_perm_.assign(num_rows_, kInvalidRow);
+  StrictITIVector<RowIndex, bool> is_eliminated(num_rows_, false);
+  StrictITIVector<RowIndex, RowIndex> marked(num_rows_, kInvalidRow);
+  ITIVector<RowIndex, std::vector<RowIndex>> pattern(num_rows_.value());
+  RowIndex num_eliminated(0);
+  while (!queue.empty()) {
+    const RowIndex node(queue.top().second);
+    const int node_degree = queue.top().first;
+    queue.pop();
+    if (is_eliminated[node] || node_degree != degree[node]) continue;
+    std::vector<RowIndex>* neighbors = &(*adjacency)[node];
+    is_eliminated[node] = true;
+    row_perm_[node] = num_eliminated;
+    for (const RowIndex neighbor : *neighbors) marked[neighbor] = node;
+    for (const RowIndex neighbor : *neighbors) {
+      std::vector<RowIndex>* list = &(*adjacency)[neighbor];
+      int new_size = 0;
+      for (const RowIndex row : *list) {
+        if (is_eliminated[row] || marked[row] == node) continue;
+        (*list)[new_size++] = row;
+      }
+      list->resize(new_size);
+      for (const RowIndex row : *neighbors) {
+        if (row != neighbor) list->push_back(row);
+      }
+      degree[neighbor] = list->size();
+      queue.push(DegreeAndNode(degree[neighbor], neighbor.value()));
+    }
+    pattern[num_eliminated].swap(*neighbors);
+    std::vector<RowIndex>().swap(*neighbors);
+    ++num_eliminated;
+  }
+  DCHECK_EQ(num_eliminated, num_rows_);
+  inverse_row_perm_.PopulateFromInverse(row_perm_);
+
+  // Convert the patterns to the permuted indices.
+  column_starts_.assign(num_rows_.value() + 1, 0);
+  rows_.clear();
+  for (RowIndex col(0); col < num_rows_; ++col) {
+    const int64 start = rows_.size();
+    for (const RowIndex row : pattern[col]) {
+      rows_.push_back(row_perm_[row]);
+    }
+    std::sort(rows_.begin() + start, rows_.end());
+    column_starts_[col.value() + 1] = rows_.size();
+    std::vector<RowIndex>().swap(pattern[col]);
+  }
+  values_.assign(rows_.size(), 0.0);
+
+  // Compute the row-wise pattern.
+  row_starts_.assign(num_rows_.value() + 1, 0);
+  for (const RowIndex row : rows_) ++row_starts_[row.value() + 1];
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    row_starts_[row.value() + 1] += row_starts_[row.value()];
+  }
+  row_columns_.resize(rows_.size());
+  row_positions_.resize(rows_.size());
+  std::vector<int64> next(row_starts_.begin(), row_starts_.end() - 1);
+  for (RowIndex col(0); col < num_rows_; ++col) {
+    for (int64 i = column_starts_[col.value()];
+         i < column_starts_[col.value() + 1]; ++i) {
+      const int64 position = next[rows_[i].value()]++;
+      row_columns_[position] = col;
+      row_positions_[position] = i;
+    }
+  }
+}
+
+void SparseCholesky::ComputeEliminationTreeLevels() {
+  // The parent of a column in the elimination tree is the first row of its
+  // pattern, which is always after the column.
+  StrictITIVector<RowIndex, int> level(num_rows_, 0);
+  int num_levels = num_rows_ > 0 ? 1 : 0;
+  for (RowIndex col(0); col < num_rows_; ++col) {
+    const int64 start = column_starts_[col.value()];
+    if (start == column_starts_[col.value() + 1]) continue;
+    const RowIndex parent = rows_[start];
+    level[parent] = std::max(level[parent], level[col] + 1);
+    num_levels = std::max(num_levels, level[parent] + 1);
+  }
+  level_starts_.assign(num_levels + 1, 0);
+  for (RowIndex col(0); col < num_rows_; ++col) ++level_starts_[level[col] + 1];
+  for (int i = 0; i < num_levels; ++i) level_starts_[i + 1] += level_starts_[i];
+  columns_by_level_.resize(num_rows_.value());
+  std::vector<int> next(level_starts_.begin(), level_starts_.end() - 1);
+  for (RowIndex col(0); col < num_rows_; ++col) {
+    columns_by_level_[next[level[col]]++] = col;
+  }
+}
+
+bool SparseCholesky::ComputeColumn(RowIndex j, const DenseRow& column_weights,
+                                   const DenseColumn& row_weights,
+                                   DenseColumn* scratchpad) {
+  DenseColumn& dense_column = *scratchpad;
+
+  // Compute the lower part of the column j of M.
+  const RowIndex row = inverse_row_perm_[j];
+  dense_column[j] = row_weights[row];
+  for (const SparseColumn::Entry e : transpose_.column(RowToColIndex(row))) {
+    const ColIndex col = RowToColIndex(e.row());
+    const Fractional multiplier = column_weights[col] * e.coefficient();
+    if (multiplier == 0.0) continue;
+    for (const SparseColumn::Entry f : matrix_->column(col)) {
+      const RowIndex permuted_row = row_perm_[f.row()];
+      if (permuted_row >= j) {
+        dense_column[permuted_row] += multiplier * f.coefficient();
+      }
+    }
+  }
+  const Fractional diagonal = dense_column[j];
+
+  // Subtract the contribution of the previous columns.
+  for (int64 i = row_starts_[j.value()]; i < row_starts_[j.value() + 1]; ++i) {
+    const RowIndex k = row_columns_[i];
+    const int64 position = row_positions_[i];
+    const Fractional multiplier = values_[position] * pivots_[k];
+    dense_column[j] -= multiplier * values_[position];
+    const int64 end = column_starts_[k.value() + 1];
+    for (int64 q = position + 1; q < end; ++q) {
+      dense_column[rows_[q]] -= multiplier * values_[q];
+    }
+  }
+
+  // Scale the column by the pivot.
+  Fractional pivot = dense_column[j];
+  dense_column[j] = 0.0;
+  bool is_skipped = false;
+  if (!(pivot > kSmallPivotRatio * diagonal) || pivot <= 0.0) {
+    pivot = kHugePivot;
+    is_skipped = true;
+  }
+  pivots_[j] = pivot;
+  const int64 end = column_starts_[j.value() + 1];
+  for (int64 q = column_starts_[j.value()]; q < end; ++q) {
+    values_[q] = dense_column[rows_[q]] / pivot;
+    dense_column[rows_[q]] = 0.0;
+  }
+  return is_skipped;
+}
+
+void SparseCholesky::ComputeNumericFactorization(
+    const DenseRow& column_weights, const DenseColumn& row_weights) {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK(matrix_ != nullptr);
+#ifdef OMP
+  const int num_omp_threads = parameters_.num_omp_threads();
+#else
+  const int num_omp_threads = 1;
+#endif
+  pivots_.assign(num_rows_, 0.0);
+  scratchpads_.resize(num_omp_threads);
+  for (DenseColumn& scratchpad : scratchpads_) {
+    scratchpad.assign(num_rows_, 0.0);
+  }
+  int num_skipped_pivots = 0;
+  const int num_levels = level_starts_.size() - 1;
+  for (int level = 0; level < num_levels; ++level) {
+    const int begin = level_starts_[level];
+    const int end = level_starts_[level + 1];
+    if (num_omp_threads == 1) {
+      for (int i = begin; i < end; ++i) {
+        if (ComputeColumn(columns_by_level_[i], column_weights, row_weights,
+                          &scratchpads_[0])) {
+          ++num_skipped_pivots;
+        }
+      }
+    } else {
+#ifdef OMP
+      // All the columns of a level are independent, and each of them is
+      // computed exactly as in the single-threaded case.
+#pragma omp parallel for num_threads(num_omp_threads) \
+    reduction(+ : num_skipped_pivots)
+      for (int i = begin; i < end; ++i) {
+        if (ComputeColumn(columns_by_level_[i], column_weights, row_weights,
+                          &scratchpads_[omp_get_thread_num()])) {
+          ++num_skipped_pivots;
+        }
+      }  // end of omp parallel for
+#endif  // OMP
+    }
+  }
+  num_skipped_pivots_ = num_skipped_pivots;
+}
+
+void SparseCholesky::Solve(DenseColumn* rhs) const {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK_EQ(rhs->size(), num_rows_);
+  DenseColumn& x = solve_scratchpad_;
+  x.resize(num_rows_, 0.0);
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    x[row_perm_[row]] = (*rhs)[row];
+  }
+
+  // Solve L.D.L^T.x = rhs.
+  for (RowIndex col(0); col < num_rows_; ++col) {
+    const Fractional value = x[col];
+    if (value == 0.0) continue;
+    const int64 end = column_starts_[col.value() + 1];
+    for (int64 i = column_starts_[col.value()]; i < end; ++i) {
+      x[rows_[i]] -= values_[i] * value;
+    }
+  }
+  for (RowIndex col(0); col < num_rows_; ++col) {
+    x[col] /= pivots_[col];
+  }
+  for (RowIndex col(num_rows_ - 1); col >= 0; --col) {
+    Fractional sum = x[col];
+    const int64 end = column_starts_[col.value() + 1];
+    for (int64 i = column_starts_[col.value()]; i < end; ++i) {
+      sum -= values_[i] * x[rows_[i]];
+    }
+    x[col] = sum;
+  }
+
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    (*rhs)[row] = x[row_perm_[row]];
+  }
+}
+
+}  // namespace glop
+}  // namespace operations_research
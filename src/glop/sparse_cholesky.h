@@ -0,0 +1,152 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_GLOP_SPARSE_CHOLESKY_H_
+#define OR_TOOLS_GLOP_SPARSE_CHOLESKY_H_
+
+#include <vector>
+
+#include "base/int_type_indexed_vector.h"
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "glop/parameters.pb.h"
+#include "glop/status.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/permutation.h"
+#include "lp_data/sparse.h"
+#include "util/stats.h"
+
+namespace operations_research {
+namespace glop {
+
+// Sparse L.D.L^T factorization of the "normal equations" matrix
+//   M = A.diag(column_weights).A^T + diag(row_weights)
+// used by the interior point method (see interior_point.h). The matrix A is
+// fixed, only the weights change from one factorization to the next, so the
+// work is split in two:
+// - A symbolic phase that only depends on the sparsity pattern of A. It
+//   computes a fill-reducing ordering of the rows of A with the minimum degree
+//   heuristic, and the exact sparsity pattern of L by simulating the
+//   elimination on the graph of M.
+// - A numeric phase, a left-looking column Cholesky. The columns of L are
+//   grouped by their depth in the elimination tree: all the columns of a
+//   group only depend on the columns of the previous groups, so they can be
+//   computed in parallel when num_omp_threads() is greater than one.
+//
+// A pivot that is too small, for instance because of linearly dependent rows
+// in A, is replaced by a huge value. This is the usual trick in interior point
+// codes: it amounts to fixing the corresponding component of the solution to
+// zero instead of failing.
+//
+// Reference: T. A. Davis, "Direct Methods for Sparse Linear Systems", SIAM,
+// 2006.
+class SparseCholesky {
+ public:
+  SparseCholesky();
+
+  // Sets the algorithm parameters.
+  void SetParameters(const GlopParameters& parameters) {
+    parameters_ = parameters;
+  }
+
+  // Computes the ordering and the pattern of L for the given matrix A. The
+  // matrix must outlive this class, or at least the following calls to
+  // ComputeNumericFactorization().
+  void ComputeSymbolicFactorization(const SparseMatrix& matrix);
+
+  // Computes the factorization of A.diag(column_weights).A^T +
+  // diag(row_weights). The weights must be finite and non-negative.
+  void ComputeNumericFactorization(const DenseRow& column_weights,
+                                   const DenseColumn& row_weights);
+
+  // Solves M.x = rhs in place.
+  void Solve(DenseColumn* rhs) const;
+
+  // Returns the number of entries in L (without the diagonal).
+  EntryIndex NumberOfEntries() const { return EntryIndex(rows_.size()); }
+
+  // Returns the number of pivots that were too small during the last numeric
+  // factorization.
+  int NumberOfSkippedPivots() const { return num_skipped_pivots_; }
+
+  // Returns a std::string containing the statistics for this class.
+  std::string StatString() const { return stats_.StatString(); }
+
+ private:
+  // Computes the minimum degree ordering and the sparsity pattern of L from the
+  // adjacency lists of the graph of M. The lists are modified by the
+  // simulated elimination.
+  void ComputeOrderingAndPattern(
+      ITIVector<RowIndex, std::vector<RowIndex>>* adjacency);
+
+  // Groups the columns of L by their depth in the elimination tree.
+  void ComputeEliminationTreeLevels();
+
+  // Computes the column j of L and the pivot d_j using the given dense
+  // scratchpad which must be all zero and is left all zero. Returns true if the
+  // pivot was too small and was replaced by a huge value.
+  bool ComputeColumn(RowIndex j, const DenseRow& column_weights,
+                     const DenseColumn& row_weights, DenseColumn* scratchpad);
+
+  // The matrix A, its transpose and the fill-reducing ordering of its rows:
+  // row_perm_[row] is the position of the given row of A in L.
+  RowIndex num_rows_;
+  const SparseMatrix* matrix_;
+  SparseMatrix transpose_;
+  RowPermutation row_perm_;
+  RowPermutation inverse_row_perm_;
+
+  // The strictly lower triangular part of L, in the permuted order. The rows
+  // of each column are sorted.
+  std::vector<int64> column_starts_;
+  std::vector<RowIndex> rows_;
+  std::vector<Fractional> values_;
+  DenseColumn pivots_;
+
+  // The row-wise pattern of L: the columns k < j with L(j, k) != 0 and the
+  // position of this entry in rows_ and values_.
+  std::vector<int64> row_starts_;
+  std::vector<RowIndex> row_columns_;
+  std::vector<int64> row_positions_;
+
+  // The columns of L ordered by their depth in the elimination tree, the
+  // columns of level i are in [level_starts_[i], level_starts_[i + 1]).
+  std::vector<RowIndex> columns_by_level_;
+  std::vector<int> level_starts_;
+
+  // One dense scratchpad per thread.
+  std::vector<DenseColumn> scratchpads_;
+  mutable DenseColumn solve_scratchpad_;
+
+  int num_skipped_pivots_;
+
+  // Stats about this class.
+  struct Stats : public StatsGroup {
+    Stats()
+        : StatsGroup("SparseCholesky"),
+          fill_in("fill_in", this),
+          num_levels("num_levels", this) {}
+    RatioDistribution fill_in;
+    IntegerDistribution num_levels;
+  };
+  mutable Stats stats_;
+
+  GlopParameters parameters_;
+
+  DISALLOW_COPY_AND_ASSIGN(SparseCholesky);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_SPARSE_CHOLESKY_H_
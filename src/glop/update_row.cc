@@ -150,13 +150,57 @@ void UpdateRow::SetParameters(const GlopParameters& parameters) {
 void UpdateRow::ComputeUpdatesRowWise() {
   SCOPED_TIME_STAT(&stats_);
   const ColIndex num_cols = matrix_.num_cols();
-  coefficient_.AssignToZero(num_cols);
-  for (ColIndex col : unit_row_left_inverse_non_zeros_) {
-    const Fractional multiplier = unit_row_left_inverse_[col];
-    for (const EntryIndex i : transposed_matrix_.Column(col)) {
-      const ColIndex pos = RowToColIndex(transposed_matrix_.EntryRow(i));
-      coefficient_[pos] += multiplier * transposed_matrix_.EntryCoefficient(i);
+#ifdef OMP
+  const int num_omp_threads = parameters_.num_omp_threads();
+#else
+  const int num_omp_threads = 1;
+#endif
+  if (num_omp_threads == 1) {
+    coefficient_.AssignToZero(num_cols);
+    for (ColIndex col : unit_row_left_inverse_non_zeros_) {
+      const Fractional multiplier = unit_row_left_inverse_[col];
+      for (const EntryIndex i : transposed_matrix_.Column(col)) {
+        const ColIndex pos = RowToColIndex(transposed_matrix_.EntryRow(i));
+        coefficient_[pos] +=
+            multiplier * transposed_matrix_.EntryCoefficient(i);
+      }
+    }
+  } else {
+#ifdef OMP
+    // In the multi-threaded case, each thread accumulates the contribution of
+    // a chunk of the rows of the transposed matrix in its own dense row, and
+    // these rows are then summed in a fixed order.
+    coefficient_.resize(num_cols, 0.0);
+    thread_coefficients_.resize(num_omp_threads);
+    const int size = unit_row_left_inverse_non_zeros_.size();
+#pragma omp parallel for num_threads(num_omp_threads)
+    for (int t = 0; t < num_omp_threads; t++) {
+      DenseRow* const coefficients = &thread_coefficients_[t];
+      coefficients->AssignToZero(num_cols);
+      const int end = (t + 1) * size / num_omp_threads;
+      for (int k = t * size / num_omp_threads; k < end; ++k) {
+        const ColIndex col = unit_row_left_inverse_non_zeros_[k];
+        const Fractional multiplier = unit_row_left_inverse_[col];
+        for (const EntryIndex i : transposed_matrix_.Column(col)) {
+          const ColIndex pos = RowToColIndex(transposed_matrix_.EntryRow(i));
+          (*coefficients)[pos] +=
+              multiplier * transposed_matrix_.EntryCoefficient(i);
+        }
+      }
+    }
+    // end of omp parallel for
+    const int parallel_loop_size = num_cols.value();
+#pragma omp parallel for num_threads(num_omp_threads)
+    for (int i = 0; i < parallel_loop_size; i++) {
+      const ColIndex col(i);
+      Fractional sum = 0.0;
+      for (int t = 0; t < num_omp_threads; t++) {
+        sum += thread_coefficients_[t][col];
+      }
+      coefficient_[col] = sum;
     }
+    // end of omp parallel for
+#endif  // OMP
   }
 
   non_zero_position_list_.clear();
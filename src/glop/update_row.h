@@ -117,6 +117,10 @@ class UpdateRow {
   DenseBitRow non_zero_position_set_;
   DenseRow coefficient_;
 
+  // Per-thread partial sums used by ComputeUpdatesRowWise() when it runs with
+  // more than one thread.
+  std::vector<DenseRow> thread_coefficients_;
+
   // Boolean used to avoid recomputing many times the same thing.
   bool compute_unit_row_left_inverse_;
   bool compute_update_row_;
@@ -13,8 +13,15 @@
 
 #include "graph/assignment.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "base/callback.h"
 #include "base/commandlineflags.h"
+#include "base/threadpool.h"
 #include "graph/ebert_graph.h"
+#include "graph/graph.h"
 #include "graph/linear_assignment.h"
 
 namespace operations_research {
@@ -62,12 +69,24 @@ SimpleLinearSumAssignment::Status SimpleLinearSumAssignment::Solve() {
     if (unscaled_arc_cost > max_supported_arc_cost) return POSSIBLE_OVERFLOW;
   }
 
+  // A StaticGraph uses about half the memory per arc of a ForwardStarGraph and
+  // stores the outgoing arcs of each node contiguously. Its Build() may permute
+  // the arcs, so we keep the mapping to translate back the assignment arcs.
   const ArcIndex num_arcs = arc_cost_.size();
-  ForwardStarGraph graph(2 * num_nodes_, num_arcs);
-  LinearSumAssignment<ForwardStarGraph> assignment(graph, num_nodes_);
+  StaticGraph<> graph(2 * num_nodes_, num_arcs);
   for (ArcIndex arc = 0; arc < num_arcs; ++arc) {
     graph.AddArc(arc_tail_[arc], num_nodes_ + arc_head_[arc]);
-    assignment.SetArcCost(arc, arc_cost_[arc]);
+  }
+  std::vector<ArcIndex> arc_permutation;
+  graph.Build(&arc_permutation);
+  std::vector<ArcIndex> original_arc(arc_permutation.size());
+  for (ArcIndex arc = 0; arc < arc_permutation.size(); ++arc) {
+    original_arc[arc_permutation[arc]] = arc;
+  }
+  LinearSumAssignment<StaticGraph<> > assignment(graph, num_nodes_);
+  for (ArcIndex arc = 0; arc < num_arcs; ++arc) {
+    assignment.SetArcCost(
+        arc_permutation.empty() ? arc : arc_permutation[arc], arc_cost_[arc]);
   }
   // TODO(user): Improve the LinearSumAssignment api to clearly define
   // the error cases.
@@ -75,9 +94,157 @@ SimpleLinearSumAssignment::Status SimpleLinearSumAssignment::Solve() {
   if (!assignment.ComputeAssignment()) return INFEASIBLE;
   optimal_cost_ = assignment.GetCost();
   for (NodeIndex node = 0; node < num_nodes_; ++node) {
-    assignment_arcs_.push_back(assignment.GetAssignmentArc(node));
+    const ArcIndex arc = assignment.GetAssignmentArc(node);
+    assignment_arcs_.push_back(original_arc.empty() ? arc : original_arc[arc]);
+  }
+  return OPTIMAL;
+}
+
+DenseLinearSumAssignment::DenseLinearSumAssignment(NodeIndex num_nodes)
+    : num_nodes_(num_nodes),
+      cost_(static_cast<int64>(num_nodes) * num_nodes, 0),
+      num_threads_(1),
+      epsilon_(0),
+      optimal_cost_(0) {
+  CHECK_GE(num_nodes, 0);
+}
+
+void DenseLinearSumAssignment::SetNumThreads(int num_threads) {
+  CHECK_GE(num_threads, 1);
+  num_threads_ = num_threads;
+}
+
+DenseLinearSumAssignment::Status DenseLinearSumAssignment::Solve() {
+  optimal_cost_ = 0;
+  right_mate_.assign(num_nodes_, -1);
+  if (num_nodes_ == 0) return OPTIMAL;
+  CostValue largest_cost_magnitude = 0;
+  for (const CostValue cost : cost_) {
+    largest_cost_magnitude = std::max(largest_cost_magnitude, std::abs(cost));
+  }
+  // The prices can decrease by about twice the largest scaled cost in each
+  // scaling iteration, and there are at most 64 of them.
+  const double largest_scaled_cost =
+      static_cast<double>(largest_cost_magnitude) * (num_nodes_ + 1);
+  if (largest_scaled_cost * 256 >=
+      static_cast<double>(std::numeric_limits<CostValue>::max())) {
+    return POSSIBLE_OVERFLOW;
+  }
+
+  const CostValue alpha = std::max<int64>(2, FLAGS_assignment_alpha);
+  price_.assign(num_nodes_, 0);
+  epsilon_ = std::max<CostValue>(largest_cost_magnitude * (num_nodes_ + 1), 2);
+  do {
+    epsilon_ = std::max<CostValue>(epsilon_ / alpha, 1);
+    Refine();
+  } while (epsilon_ > 1);
+
+  for (NodeIndex left_node = 0; left_node < num_nodes_; ++left_node) {
+    optimal_cost_ += AssignmentCost(left_node);
   }
   return OPTIMAL;
 }
 
+void DenseLinearSumAssignment::Refine() {
+  right_mate_.assign(num_nodes_, -1);
+  left_mate_.assign(num_nodes_, -1);
+  unassigned_.clear();
+  for (NodeIndex left_node = num_nodes_ - 1; left_node >= 0; --left_node) {
+    unassigned_.push_back(left_node);
+  }
+  // Same threshold as for LinearSumAssignment::SetNumThreads().
+  const int64 kMinArcsPerThread = 1 << 14;
+  bool use_parallel_rounds = num_threads_ > 1;
+  while (!unassigned_.empty()) {
+    const NodeIndex num_bidders = unassigned_.size();
+    if (use_parallel_rounds && static_cast<int64>(num_bidders) * num_nodes_ >=
+                                   kMinArcsPerThread * num_threads_) {
+      // A round scans all the rows of the bidders, but only the winners
+      // make progress: when they are too few, the sequential bids are
+      // faster.
+      const NodeIndex num_won_bids = ParallelBidRound();
+      use_parallel_rounds = num_won_bids * num_threads_ >= num_bidders;
+      continue;
+    }
+    const NodeIndex left_node = unassigned_.back();
+    unassigned_.pop_back();
+    const std::pair<NodeIndex, CostValue> bid = Bid(left_node);
+    Assign(left_node, bid.first, bid.second);
+  }
+}
+
+std::pair<NodeIndex, CostValue> DenseLinearSumAssignment::Bid(
+    NodeIndex left_node) const {
+  const CostValue scale = num_nodes_ + 1;
+  const CostValue* const costs = &cost_[Index(left_node, 0)];
+  NodeIndex best_node = 0;
+  CostValue min_reduced_cost = costs[0] * scale - price_[0];
+  CostValue second_min_reduced_cost = std::numeric_limits<CostValue>::max();
+  for (NodeIndex right_node = 1; right_node < num_nodes_; ++right_node) {
+    const CostValue reduced_cost =
+        costs[right_node] * scale - price_[right_node];
+    if (reduced_cost < second_min_reduced_cost) {
+      if (reduced_cost < min_reduced_cost) {
+        best_node = right_node;
+        second_min_reduced_cost = min_reduced_cost;
+        min_reduced_cost = reduced_cost;
+      } else {
+        second_min_reduced_cost = reduced_cost;
+      }
+    }
+  }
+  const CostValue gap =
+      num_nodes_ == 1 ? 0 : second_min_reduced_cost - min_reduced_cost;
+  return std::make_pair(best_node, price_[best_node] - gap - epsilon_);
+}
+
+void DenseLinearSumAssignment::Assign(NodeIndex left_node,
+                                      NodeIndex right_node, CostValue price) {
+  const NodeIndex previous_mate = left_mate_[right_node];
+  if (previous_mate >= 0) {
+    right_mate_[previous_mate] = -1;
+    unassigned_.push_back(previous_mate);
+  }
+  left_mate_[right_node] = left_node;
+  right_mate_[left_node] = right_node;
+  price_[right_node] = price;
+}
+
+NodeIndex DenseLinearSumAssignment::ParallelBidRound() {
+  bids_.resize(unassigned_.size());
+  {
+    ThreadPool pool("DenseLinearSumAssignment", num_threads_);
+    for (int chunk = 0; chunk < num_threads_; ++chunk) {
+      pool.Add(
+          NewCallback(this, &DenseLinearSumAssignment::ComputeBids, chunk));
+    }
+    pool.StartWorkers();
+  }
+  // As in LinearSumAssignment::ParallelBidRound(), the lowest price offered
+  // for a right node wins it.
+  std::vector<NodeIndex> bidders;
+  bidders.swap(unassigned_);
+  NodeIndex num_won_bids = 0;
+  for (int i = 0; i < bidders.size(); ++i) {
+    const NodeIndex right_node = bids_[i].first;
+    const CostValue price = bids_[i].second;
+    if (price < price_[right_node]) {
+      Assign(bidders[i], right_node, price);
+      ++num_won_bids;
+    } else {
+      unassigned_.push_back(bidders[i]);
+    }
+  }
+  return num_won_bids;
+}
+
+void DenseLinearSumAssignment::ComputeBids(int chunk) {
+  const int num_bidders = unassigned_.size();
+  const int begin = static_cast<int64>(num_bidders) * chunk / num_threads_;
+  const int end = static_cast<int64>(num_bidders) * (chunk + 1) / num_threads_;
+  for (int i = begin; i < end; ++i) {
+    bids_[i] = Bid(unassigned_[i]);
+  }
+}
+
 }  // namespace operations_research
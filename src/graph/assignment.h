@@ -48,8 +48,12 @@
 #ifndef OR_TOOLS_GRAPH_ASSIGNMENT_H_
 #define OR_TOOLS_GRAPH_ASSIGNMENT_H_
 
+#include <utility>
 #include <vector>
 
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/macros.h"
 #include "graph/ebert_graph.h"
 
 namespace operations_research {
@@ -125,6 +129,108 @@ class SimpleLinearSumAssignment {
   DISALLOW_COPY_AND_ASSIGN(SimpleLinearSumAssignment);
 };
 
+// Solves the assignment problem on a complete bipartite graph, given by its
+// num_nodes x num_nodes cost matrix. This is much faster than
+// SimpleLinearSumAssignment on such problems: no graph is built, and the
+// costs of a left node are read contiguously.
+//
+// The algorithm is the auction algorithm with epsilon scaling, which is the
+// same as the one of ./linear_assignment.h seen from the left-side nodes:
+// each unassigned left node bids for its best right node, whose price
+// decreases by the difference with the second best plus epsilon. With more
+// than one thread, see SetNumThreads(), the bids are computed in parallel
+// synchronous rounds as long as there are enough unassigned nodes.
+//
+// Example usage:
+//
+// DenseLinearSumAssignment assignment(num_nodes);
+// for (int left = 0; left < num_nodes; ++left) {
+//   for (int right = 0; right < num_nodes; ++right) {
+//     assignment.SetCost(left, right, cost(left, right));
+//   }
+// }
+// assignment.SetNumThreads(8);
+// if (assignment.Solve() == DenseLinearSumAssignment::OPTIMAL) {
+//   ... = assignment.OptimalCost();
+//   ... = assignment.RightMate(left);
+// }
+class DenseLinearSumAssignment {
+ public:
+  // All the costs are initially 0. This allocates the num_nodes^2 costs.
+  explicit DenseLinearSumAssignment(NodeIndex num_nodes);
+
+  NodeIndex NumNodes() const { return num_nodes_; }
+
+  void SetCost(NodeIndex left_node, NodeIndex right_node, CostValue cost) {
+    cost_[Index(left_node, right_node)] = cost;
+  }
+  CostValue Cost(NodeIndex left_node, NodeIndex right_node) const {
+    return cost_[Index(left_node, right_node)];
+  }
+
+  // Sets the number of threads used by Solve(), 1 by default.
+  void SetNumThreads(int num_threads);
+
+  // Solves the problem. As the graph is complete, there is always a perfect
+  // matching.
+  enum Status {
+    OPTIMAL,            // The algorithm found a minimum-cost perfect matching.
+    POSSIBLE_OVERFLOW,  // Some cost magnitude is too large.
+  };
+  Status Solve();
+
+  // The result of the last Solve(), if it returned OPTIMAL.
+  CostValue OptimalCost() const { return optimal_cost_; }
+  NodeIndex RightMate(NodeIndex left_node) const {
+    return right_mate_[left_node];
+  }
+  CostValue AssignmentCost(NodeIndex left_node) const {
+    return Cost(left_node, RightMate(left_node));
+  }
+
+ private:
+  int64 Index(NodeIndex left_node, NodeIndex right_node) const {
+    DCHECK_LE(0, left_node);
+    DCHECK_LT(left_node, num_nodes_);
+    DCHECK_LE(0, right_node);
+    DCHECK_LT(right_node, num_nodes_);
+    return static_cast<int64>(left_node) * num_nodes_ + right_node;
+  }
+
+  // Finds an epsilon-optimal perfect matching for the current epsilon_,
+  // starting from the current prices.
+  void Refine();
+
+  // Returns the bid of the left node: its best right node, and the price
+  // it offers for it.
+  std::pair<NodeIndex, CostValue> Bid(NodeIndex left_node) const;
+
+  // Assigns the left node to the right node at the given price, and puts
+  // the previous mate of the right node, if any, back in unassigned_.
+  void Assign(NodeIndex left_node, NodeIndex right_node, CostValue price);
+
+  // Does one synchronous round of bids from all the unassigned nodes, and
+  // returns the number of bids that won their right node.
+  NodeIndex ParallelBidRound();
+  void ComputeBids(int chunk);
+
+  const NodeIndex num_nodes_;
+  std::vector<CostValue> cost_;
+  int num_threads_;
+
+  // The state of the algorithm. The costs are scaled by num_nodes_ + 1, so
+  // that an epsilon-optimal assignment for epsilon_ == 1 is optimal.
+  CostValue epsilon_;
+  std::vector<CostValue> price_;
+  std::vector<NodeIndex> right_mate_;
+  std::vector<NodeIndex> left_mate_;
+  std::vector<NodeIndex> unassigned_;
+  std::vector<std::pair<NodeIndex, CostValue>> bids_;
+
+  CostValue optimal_cost_;
+  DISALLOW_COPY_AND_ASSIGN(DenseLinearSumAssignment);
+};
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_GRAPH_ASSIGNMENT_H_
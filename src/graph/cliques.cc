@@ -15,13 +15,17 @@
 #include "graph/cliques.h"
 
 #include <algorithm>
+#include <atomic>
 #include "base/hash.h"
+#include <mutex>  // NOLINT
 #include "base/unique_ptr.h"
 #include <utility>
 #include <vector>
 
 #include "base/callback.h"
 #include "base/hash.h"
+#include "base/threadpool.h"
+#include "util/bitset.h"
 
 namespace operations_research {
 
@@ -176,6 +180,223 @@ class FindAndEliminate {
   hash_set<std::pair<int, int> > visited_;
 #endif
 };
+
+// Bron-Kerbosch with pivoting on a dense adjacency bit matrix. The matrix is
+// copied into a single array of words, one row of num_words_ words per node,
+// and all the set operations of the search work directly on these words.
+class BitMatrixCliqueFinder {
+ public:
+  BitMatrixCliqueFinder(
+      const std::vector<Bitset64<int64> >& graph,
+      ResultCallback1<bool, const std::vector<int>&>* const callback)
+      : node_count_(graph.size()),
+        num_words_(BitLength64(graph.size())),
+        adjacency_(node_count_ * num_words_, 0),
+        callback_(callback),
+        next_node_(0),
+        stop_(false) {
+    for (int i = 0; i < node_count_; ++i) {
+      DCHECK_EQ(node_count_, graph[i].size());
+      uint64* const row = Row(i);
+      for (const int64 j : graph[i]) {
+        if (j != i) row[BitOffset64(j)] |= OneBit64(BitPos64(j));
+      }
+    }
+    ComputeDegeneracyOrder();
+  }
+
+  void Run(int num_threads) {
+    if (num_threads <= 1 || node_count_ <= 1) {
+      Explore();
+      return;
+    }
+    ThreadPool pool("FindCliques", num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      pool.Add(NewCallback(this, &BitMatrixCliqueFinder::Explore));
+    }
+    pool.StartWorkers();
+  }
+
+ private:
+  // The state of one worker. Level d of each buffer holds the candidate set,
+  // the "not" set and the nodes left to branch on at recursion depth d.
+  struct Workspace {
+    std::vector<uint64, AlignedAllocator<uint64> > candidates;
+    std::vector<uint64, AlignedAllocator<uint64> > excluded;
+    std::vector<uint64, AlignedAllocator<uint64> > to_branch_on;
+    std::vector<int> clique;
+  };
+
+  uint64* Row(int node) { return adjacency_.data() + node * num_words_; }
+  const uint64* Row(int node) const {
+    return adjacency_.data() + node * num_words_;
+  }
+
+  // Computes a degeneracy order of the nodes with the bucket algorithm of
+  // V. Batagelj and M. Zaversnik, "An O(m) algorithm for cores decomposition
+  // of networks", 2003: repeatedly removes a node of minimum degree.
+  void ComputeDegeneracyOrder() {
+    std::vector<int> degree(node_count_);
+    int max_degree = 0;
+    for (int i = 0; i < node_count_; ++i) {
+      const uint64* const row = Row(i);
+      degree[i] = BitCountWords64(row, num_words_);
+      max_degree = std::max(max_degree, degree[i]);
+    }
+    // bucket_start[d] is the position in order_ of the first node of
+    // current degree d, and position[i] the position of node i in order_.
+    std::vector<int> bucket_start(max_degree + 1, 0);
+    for (int i = 0; i < node_count_; ++i) ++bucket_start[degree[i]];
+    int start = 0;
+    for (int d = 0; d <= max_degree; ++d) {
+      const int size = bucket_start[d];
+      bucket_start[d] = start;
+      start += size;
+    }
+    order_.resize(node_count_);
+    position_.resize(node_count_);
+    for (int i = 0; i < node_count_; ++i) {
+      position_[i] = bucket_start[degree[i]]++;
+      order_[position_[i]] = i;
+    }
+    for (int d = max_degree; d > 0; --d) bucket_start[d] = bucket_start[d - 1];
+    bucket_start[0] = 0;
+
+    degeneracy_ = 0;
+    for (int p = 0; p < node_count_; ++p) {
+      const int node = order_[p];
+      degeneracy_ = std::max(degeneracy_, degree[node]);
+      const uint64* const row = Row(node);
+      for (int w = 0; w < num_words_; ++w) {
+        for (uint64 word = row[w]; word != 0; word &= word - 1) {
+          const int neighbor =
+              BitShift64(w) + LeastSignificantBitPosition64(word);
+          if (degree[neighbor] <= degree[node]) continue;
+          // Moves the neighbor to the front of its bucket, then to the end
+          // of the bucket below.
+          const int d = degree[neighbor];
+          const int front_position = bucket_start[d];
+          const int front_node = order_[front_position];
+          if (front_node != neighbor) {
+            order_[position_[neighbor]] = front_node;
+            position_[front_node] = position_[neighbor];
+            order_[front_position] = neighbor;
+            position_[neighbor] = front_position;
+          }
+          ++bucket_start[d];
+          --degree[neighbor];
+        }
+      }
+    }
+  }
+
+  // Branches on the nodes in degeneracy order. The candidates of a node are
+  // its neighbors that come after it, and its "not" set its neighbors that
+  // come before it, so there are at most degeneracy_ candidates.
+  void Explore() {
+    Workspace workspace;
+    const int levels = degeneracy_ + 2;
+    workspace.candidates.resize(levels * num_words_);
+    workspace.excluded.resize(levels * num_words_);
+    workspace.to_branch_on.resize(levels * num_words_);
+    workspace.clique.reserve(levels);
+    while (!stop_) {
+      const int p = next_node_++;
+      if (p >= node_count_) return;
+      const int node = order_[p];
+      uint64* const candidates = workspace.candidates.data();
+      uint64* const excluded = workspace.excluded.data();
+      std::fill(candidates, candidates + num_words_, 0);
+      std::fill(excluded, excluded + num_words_, 0);
+      const uint64* const row = Row(node);
+      for (int w = 0; w < num_words_; ++w) {
+        for (uint64 word = row[w]; word != 0; word &= word - 1) {
+          const int neighbor =
+              BitShift64(w) + LeastSignificantBitPosition64(word);
+          uint64* const set =
+              position_[neighbor] > p ? candidates : excluded;
+          set[w] |= OneBit64(BitPos64(neighbor));
+        }
+      }
+      workspace.clique.push_back(node);
+      Search(0, &workspace);
+      workspace.clique.pop_back();
+    }
+  }
+
+  void Search(int depth, Workspace* const workspace) {
+    uint64* const candidates =
+        workspace->candidates.data() + depth * num_words_;
+    uint64* const excluded = workspace->excluded.data() + depth * num_words_;
+    uint64* const to_branch_on =
+        workspace->to_branch_on.data() + depth * num_words_;
+
+    // Chooses the pivot among the candidates and the "not" set as the node
+    // with the most neighbors in the candidates. Only the candidates that are
+    // not adjacent to the pivot need to be branched on.
+    int pivot = -1;
+    int best_count = -1;
+    for (int w = 0; w < num_words_; ++w) {
+      for (uint64 word = candidates[w] | excluded[w]; word != 0;
+           word &= word - 1) {
+        const int node = BitShift64(w) + LeastSignificantBitPosition64(word);
+        const int count =
+            IntersectionBitCountWords64(candidates, Row(node), num_words_);
+        if (count > best_count) {
+          best_count = count;
+          pivot = node;
+        }
+      }
+    }
+    if (pivot == -1) {
+      // Both sets are empty: the current clique is maximal.
+      ReportClique(workspace->clique);
+      return;
+    }
+    const uint64* const pivot_row = Row(pivot);
+    AndNotWords64(candidates, pivot_row, num_words_, to_branch_on);
+
+    uint64* const next_candidates = candidates + num_words_;
+    uint64* const next_excluded = excluded + num_words_;
+    for (int w = 0; w < num_words_; ++w) {
+      for (uint64 word = to_branch_on[w]; word != 0; word &= word - 1) {
+        const int node = BitShift64(w) + LeastSignificantBitPosition64(word);
+        const uint64* const row = Row(node);
+        AndWords64(candidates, row, num_words_, next_candidates);
+        AndWords64(excluded, row, num_words_, next_excluded);
+        workspace->clique.push_back(node);
+        Search(depth + 1, workspace);
+        workspace->clique.pop_back();
+        if (stop_) return;
+        // Move node from the candidates to the "not" set.
+        const uint64 bit = OneBit64(BitPos64(node));
+        candidates[w] &= ~bit;
+        excluded[w] |= bit;
+      }
+    }
+  }
+
+  void ReportClique(const std::vector<int>& clique) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    if (stop_) return;
+    if (callback_->Run(clique)) stop_ = true;
+  }
+
+  const int node_count_;
+  const int num_words_;
+  std::vector<uint64, AlignedAllocator<uint64> > adjacency_;
+  ResultCallback1<bool, const std::vector<int>&>* const callback_;
+
+  // The nodes in degeneracy order, and the position of each node in it.
+  std::vector<int> order_;
+  std::vector<int> position_;
+  int degeneracy_;
+
+  // Position in order_ of the next top-level node to branch on.
+  std::atomic<int> next_node_;
+  std::atomic<bool> stop_;
+  std::mutex callback_mutex_;
+};
 }  // namespace
 
 // This method implements the 'version2' of the Bron-Kerbosch
@@ -200,6 +421,15 @@ void FindCliques(ResultCallback2<bool, int, int>* const graph, int node_count,
          &stop);
 }
 
+void FindCliques(const std::vector<Bitset64<int64> >& graph, int num_threads,
+                 ResultCallback1<bool, const std::vector<int>&>* const callback) {
+  callback->CheckIsRepeatable();
+  std::unique_ptr<ResultCallback1<bool, const std::vector<int>&> > callback_deleter(
+      callback);
+  BitMatrixCliqueFinder finder(graph, callback);
+  finder.Run(num_threads);
+}
+
 void CoverArcsByCliques(
     ResultCallback2<bool, int, int>* const graph, int node_count,
     ResultCallback1<bool, const std::vector<int>&>* const callback) {
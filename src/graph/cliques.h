@@ -27,6 +27,8 @@
 #include <vector>
 
 #include "base/callback.h"
+#include "base/integral_types.h"
+#include "util/bitset.h"
 
 namespace operations_research {
 
@@ -38,6 +40,24 @@ namespace operations_research {
 void FindCliques(ResultCallback2<bool, int, int>* const graph, int node_count,
                  ResultCallback1<bool, const std::vector<int>&>* const callback);
 
+// Same as FindCliques() above, but the graph is given as an adjacency bit
+// matrix: graph[i].IsSet(j) indicates if there is an arc between i and j.
+// The matrix must be symmetric, and its diagonal is ignored.
+//
+// Nodes are branched on in degeneracy order at the top level, which bounds
+// the candidate sets by the degeneracy of the graph (see D. Eppstein,
+// M. Loffler and D. Strash, "Listing all maximal cliques in sparse graphs in
+// near-optimal time", ISAAC 2010). Below that, the candidate and "not" sets
+// are bitsets, so that intersections and pivot selection (as in E. Tomita,
+// A. Tanaka and H. Takahashi, TCS 363 (1), 2006) work 64 nodes at a time.
+//
+// If num_threads > 1, the top-level branches are explored in parallel. The
+// callback is never run concurrently, and once it returns true it is not run
+// again, but the order in which the cliques are reported is not specified.
+// This function takes ownership of 'callback' and deletes it after it has run.
+void FindCliques(const std::vector<Bitset64<int64> >& graph, int num_threads,
+                 ResultCallback1<bool, const std::vector<int>&>* const callback);
+
 // Covers the maximum number of arcs of the graph with cliques. The graph
 // is described by the graph callback. graph->Run(i, j) indicates if
 // there is an arc between i and j.
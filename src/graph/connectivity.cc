@@ -17,7 +17,9 @@
 #include <algorithm>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/logging.h"
+#include "base/threadpool.h"
 
 namespace operations_research {
 
@@ -108,4 +110,115 @@ void ConnectedComponents::MergeClasses(NodeIndex node1, NodeIndex node2) {
   class_size_.Set(node1, class_size_[node1] + class_size_[node2]);
 }
 
+NodeIndex ConnectedComponents::GetComponentIds(
+    std::vector<NodeIndex>* component_ids) {
+  component_ids->assign(max_index_ + 1, -1);
+  // Maps each representative to the id of its component.
+  std::vector<NodeIndex> representative_id(max_index_ + 1, -1);
+  NodeIndex num_components = 0;
+  for (NodeIndex node = min_index_; node <= max_index_; ++node) {
+    const NodeIndex representative = GetClassRepresentative(node);
+    if (representative_id[representative] == -1) {
+      representative_id[representative] = num_components++;
+    }
+    (*component_ids)[node] = representative_id[representative];
+  }
+  return num_components;
+}
+
+void ConcurrentConnectedComponents::Init(NodeIndex num_nodes) {
+  CHECK_LE(0, num_nodes);
+  num_nodes_ = num_nodes;
+  parent_.reset(new std::atomic<NodeIndex>[num_nodes]);
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    parent_[node].store(node, std::memory_order_relaxed);
+  }
+}
+
+NodeIndex ConcurrentConnectedComponents::GetClassRepresentative(
+    NodeIndex node) {
+  DCHECK_LE(0, node);
+  DCHECK_GT(num_nodes_, node);
+  for (;;) {
+    const NodeIndex parent = parent_[node].load(std::memory_order_relaxed);
+    if (parent == node) return node;
+    // Path halving: makes node point to its grandparent, unless another
+    // thread changed its parent in the meantime, and goes on from there.
+    const NodeIndex grandparent =
+        parent_[parent].load(std::memory_order_relaxed);
+    if (grandparent != parent) {
+      NodeIndex expected = parent;
+      parent_[node].compare_exchange_weak(expected, grandparent,
+                                          std::memory_order_relaxed);
+    }
+    node = grandparent;
+  }
+}
+
+void ConcurrentConnectedComponents::AddArc(NodeIndex tail, NodeIndex head) {
+  for (;;) {
+    NodeIndex tail_class = GetClassRepresentative(tail);
+    NodeIndex head_class = GetClassRepresentative(head);
+    if (tail_class == head_class) return;
+    if (tail_class < head_class) std::swap(tail_class, head_class);
+    // Links the larger root below the smaller one, if it is still a root.
+    NodeIndex expected = tail_class;
+    if (parent_[tail_class].compare_exchange_strong(expected, head_class)) {
+      return;
+    }
+    tail = tail_class;
+    head = head_class;
+  }
+}
+
+void ConcurrentConnectedComponents::AddArcRange(
+    const std::vector<NodeIndex>* tails, const std::vector<NodeIndex>* heads,
+    int begin, int end) {
+  for (int arc = begin; arc < end; ++arc) {
+    AddArc((*tails)[arc], (*heads)[arc]);
+  }
+}
+
+void ConcurrentConnectedComponents::AddArcs(
+    const std::vector<NodeIndex>& tails, const std::vector<NodeIndex>& heads,
+    int num_threads) {
+  CHECK_EQ(tails.size(), heads.size());
+  const int num_arcs = tails.size();
+  if (num_threads <= 1) {
+    AddArcRange(&tails, &heads, 0, num_arcs);
+    return;
+  }
+  ThreadPool pool("ConcurrentConnectedComponents", num_threads);
+  for (int chunk = 0; chunk < num_threads; ++chunk) {
+    const int begin = static_cast<int64>(num_arcs) * chunk / num_threads;
+    const int end = static_cast<int64>(num_arcs) * (chunk + 1) / num_threads;
+    pool.Add(NewCallback(this, &ConcurrentConnectedComponents::AddArcRange,
+                         &tails, &heads, begin, end));
+  }
+  pool.StartWorkers();
+}
+
+NodeIndex ConcurrentConnectedComponents::GetNumberOfConnectedComponents() {
+  NodeIndex number = 0;
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    if (parent_[node].load(std::memory_order_relaxed) == node) ++number;
+  }
+  return number;
+}
+
+NodeIndex ConcurrentConnectedComponents::GetComponentIds(
+    std::vector<NodeIndex>* component_ids) {
+  component_ids->resize(num_nodes_);
+  // The representative of a class is its smallest node, so it is the first
+  // node of the class to be numbered.
+  NodeIndex num_components = 0;
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    const NodeIndex representative = GetClassRepresentative(node);
+    (*component_ids)[node] = representative == node
+                                 ? num_components++
+                                 : (*component_ids)[representative];
+  }
+  return num_components;
+}
+
 }  // namespace operations_research
@@ -21,9 +21,13 @@
 #ifndef OR_TOOLS_GRAPH_CONNECTIVITY_H_
 #define OR_TOOLS_GRAPH_CONNECTIVITY_H_
 
+#include <atomic>
+#include <vector>
+
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/unique_ptr.h"
 #include "graph/ebert_graph.h"
 
 namespace operations_research {
@@ -101,6 +105,13 @@ class ConnectedComponents {
   // Merges the equivalence classes of node1 and node2.
   void MergeClasses(NodeIndex node1, NodeIndex node2);
 
+  // Numbers the connected components from 0 in the order of their smallest
+  // node, and sets (*component_ids)[node] to the number of the component of
+  // each node from 0 to the max_index passed to Init. Returns the number of
+  // components. These ids do not depend on the order in which the arcs were
+  // added, and are the ones ConcurrentConnectedComponents returns.
+  NodeIndex GetComponentIds(std::vector<NodeIndex>* component_ids);
+
  private:
   // Initializes the object and allocates memory.
   void Init(NodeIndex min_index, NodeIndex max_index);
@@ -125,6 +136,69 @@ class ConnectedComponents {
   DISALLOW_COPY_AND_ASSIGN(ConnectedComponents);
 };
 
+// Concurrent version of ConnectedComponents, where AddArc() can be called
+// from several threads at the same time. Each node points to its parent in
+// an array of atomics. Two classes are merged by a compare-and-swap of the
+// parent of the larger of their two roots, which fails and is retried if
+// another thread changed that root in the meantime. Finds compress the paths
+// by path halving, also with compare-and-swap, so a thread never undoes the
+// work of another one. See R. J. Anderson and H. Woll, "Wait-free parallel
+// algorithms for the union-find problem", STOC 1991.
+//
+// Since a root is always linked below a smaller root, the representative of
+// a class is its smallest node, whatever the order of the arcs.
+//
+// Usage example:
+// ConcurrentConnectedComponents components;
+// components.Init(num_nodes);
+// components.AddArcs(tails, heads, num_threads);
+// std::vector<NodeIndex> component_ids;
+// const NodeIndex num_components = components.GetComponentIds(&component_ids);
+class ConcurrentConnectedComponents {
+ public:
+  ConcurrentConnectedComponents() : num_nodes_(0), parent_() {}
+
+  ~ConcurrentConnectedComponents() {}
+
+  // Reserves memory for num_nodes and resets the data structures.
+  void Init(NodeIndex num_nodes);
+
+  // Adds the information that NodeIndex tail and NodeIndex head are connected.
+  // Can be called concurrently with AddArc() and GetClassRepresentative().
+  void AddArc(NodeIndex tail, NodeIndex head);
+
+  // Adds the arcs (tails[i], heads[i]), splitting them in num_threads
+  // contiguous ranges added in parallel.
+  void AddArcs(const std::vector<NodeIndex>& tails,
+               const std::vector<NodeIndex>& heads, int num_threads);
+
+  // Returns the equivalence class representative for node. Can be called
+  // concurrently with AddArc(), but the result is then only the current
+  // representative. Once all the arcs are added, it is the smallest node of
+  // the class.
+  NodeIndex GetClassRepresentative(NodeIndex node);
+
+  // Returns the number of connected components, counting isolated nodes.
+  NodeIndex GetNumberOfConnectedComponents();
+
+  // Same as ConnectedComponents::GetComponentIds(), for nodes from 0 to
+  // num_nodes - 1. Must not be called concurrently with AddArc().
+  NodeIndex GetComponentIds(std::vector<NodeIndex>* component_ids);
+
+ private:
+  // Adds the arcs of index in [begin, end).
+  void AddArcRange(const std::vector<NodeIndex>* tails,
+                   const std::vector<NodeIndex>* heads, int begin, int end);
+
+  NodeIndex num_nodes_;
+
+  // The parent of each node. Roots are their own parent, and the parent of
+  // a node is never larger than the node.
+  std::unique_ptr<std::atomic<NodeIndex>[]> parent_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentConnectedComponents);
+};
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_GRAPH_CONNECTIVITY_H_
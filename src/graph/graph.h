@@ -44,6 +44,8 @@
 // Utility classes & functions:
 //   - Permute() to permute an array according to a given permutation.
 //   - SVector<> vector with index range [-size(), size()) for ReverseArcGraph.
+//   - ./graph_file.h to save the static graphs in files that can be
+//     memory-mapped and used as their storage.
 //
 // Basic usage:
 //   typedef ListGraph<> Graph;  // Choose a graph implementation.
@@ -103,6 +105,12 @@
 //   Permute(permutation, &weights);  // Build() may permute the arc index.
 //   ...
 //
+// Building a large static graph at once, from arrays of tails and heads (e.g.
+// memory-mapped ones), with the arcs sorted on several threads:
+//   Graph graph;
+//   graph.BuildFromArcs(num_nodes, num_arcs, tails, heads, num_threads,
+//                       &permutation);
+//
 // Encoding an undirected graph:
 //   typedef ReverseArc... Graph;
 //   Graph graph;
@@ -144,9 +152,11 @@
 #include <new>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/threadpool.h"
 #include "util/iterators.h"
 
 
@@ -374,9 +384,18 @@ class StaticGraph : public BaseGraph<NodeIndexType, ArcIndexType, false> {
 
  public:
   using Base::IsArcValid;
-  StaticGraph() : is_built_(false), arc_in_order_(true), last_tail_seen_(0) {}
+  StaticGraph()
+      : is_built_(false),
+        arc_in_order_(true),
+        last_tail_seen_(0),
+        start_data_(NULL),
+        head_data_(NULL) {}
   StaticGraph(NodeIndexType num_nodes, ArcIndexType arc_capacity)
-      : is_built_(false), arc_in_order_(true), last_tail_seen_(0) {
+      : is_built_(false),
+        arc_in_order_(true),
+        last_tail_seen_(0),
+        start_data_(NULL),
+        head_data_(NULL) {
     this->Reserve(num_nodes, arc_capacity);
     this->FreezeCapacities();
     this->AddNode(num_nodes - 1);
@@ -403,12 +422,29 @@ class StaticGraph : public BaseGraph<NodeIndexType, ArcIndexType, false> {
   void BuildTailArray();
   void FreeTailArray();
 
+  // Builds the graph at once from the arcs (tails[i], heads[i]) for i in
+  // [0, num_arcs), without copying the given arrays first: they can be
+  // memory-mapped. This gives the same graph and permutation as calling
+  // AddArc() for each arc and then Build(permutation), but the arcs are
+  // sorted on num_threads threads. The graph must be empty.
+  void BuildFromArcs(NodeIndexType num_nodes, ArcIndexType num_arcs,
+                     const NodeIndexType* tails, const NodeIndexType* heads,
+                     int num_threads, std::vector<ArcIndexType>* permutation);
+
+  // Makes the graph use the given arrays as its storage, without copying
+  // them: start[node] is the index of the first arc leaving node, and
+  // head[arc] is the head of arc. The arrays, for instance the memory-mapped
+  // ones of graph/graph_file.h, must outlive the graph. The graph must be
+  // empty, and is built by this call.
+  void BuildFromStorage(NodeIndexType num_nodes, ArcIndexType num_arcs,
+                        const ArcIndexType* start, const NodeIndexType* head);
+
   // Deprecated.
   class OutgoingArcIterator;
 
  private:
   ArcIndexType DirectArcLimit(NodeIndexType node) const {
-    return node + 1 < num_nodes_ ? start_[node + 1] : num_arcs_;
+    return node + 1 < num_nodes_ ? start_data_[node + 1] : num_arcs_;
   }
 
   // Internal method, used either:
@@ -425,6 +461,12 @@ class StaticGraph : public BaseGraph<NodeIndexType, ArcIndexType, false> {
   std::vector<ArcIndexType> start_;
   std::vector<NodeIndexType> head_;
   mutable std::vector<NodeIndexType> tail_;
+
+  // The arrays read by the accessors: they point to the data of start_ and
+  // head_, or to the storage given to BuildFromStorage(). start_data_ is only
+  // set once the graph is built.
+  const ArcIndexType* start_data_;
+  const NodeIndexType* head_data_;
   DISALLOW_COPY_AND_ASSIGN(StaticGraph);
 };
 
@@ -532,9 +574,18 @@ class ReverseArcStaticGraph
 
  public:
   using Base::IsArcValid;
-  ReverseArcStaticGraph() : is_built_(false) {}
+  ReverseArcStaticGraph()
+      : is_built_(false),
+        start_data_(NULL),
+        reverse_start_data_(NULL),
+        head_data_(NULL),
+        opposite_data_(NULL) {}
   ReverseArcStaticGraph(NodeIndexType num_nodes, ArcIndexType arc_capacity)
-      : is_built_(false) {
+      : is_built_(false),
+        start_data_(NULL),
+        reverse_start_data_(NULL),
+        head_data_(NULL),
+        opposite_data_(NULL) {
     this->Reserve(num_nodes, arc_capacity);
     this->FreezeCapacities();
     this->AddNode(num_nodes - 1);
@@ -572,14 +623,38 @@ class ReverseArcStaticGraph
   void Build() { Build(NULL); }
   void Build(std::vector<ArcIndexType>* permutation);
   void BuildTailArray() {}
+
+  // Same as StaticGraph::BuildFromArcs(), the reverse arcs are also sorted on
+  // num_threads threads.
+  void BuildFromArcs(NodeIndexType num_nodes, ArcIndexType num_arcs,
+                     const NodeIndexType* tails, const NodeIndexType* heads,
+                     int num_threads, std::vector<ArcIndexType>* permutation);
   void FreeTailArray() {}
 
+  // Same as StaticGraph::BuildFromStorage(), with reverse_start[node] the
+  // index of the first reverse arc leaving node. head and opposite are indexed
+  // by all the arcs: they have 2 * num_arcs elements, the first one being the
+  // one of the arc -num_arcs.
+  void BuildFromStorage(NodeIndexType num_nodes, ArcIndexType num_arcs,
+                        const ArcIndexType* start,
+                        const ArcIndexType* reverse_start,
+                        const NodeIndexType* head,
+                        const ArcIndexType* opposite);
+
  private:
   ArcIndexType DirectArcLimit(NodeIndexType node) const {
-    return node + 1 < num_nodes_ ? start_[node + 1] : num_arcs_;
+    return node + 1 < num_nodes_ ? start_data_[node + 1] : num_arcs_;
   }
   ArcIndexType ReverseArcLimit(NodeIndexType node) const {
-    return node + 1 < num_nodes_ ? reverse_start_[node + 1] : 0;
+    return node + 1 < num_nodes_ ? reverse_start_data_[node + 1] : 0;
+  }
+
+  // Points the accessors to the data of the vectors below.
+  void SetDataFromVectors() {
+    start_data_ = start_.data();
+    reverse_start_data_ = reverse_start_.data();
+    head_data_ = head_.data();
+    opposite_data_ = opposite_.data();
   }
 
   bool is_built_;
@@ -587,6 +662,15 @@ class ReverseArcStaticGraph
   std::vector<ArcIndexType> reverse_start_;
   SVector<NodeIndexType> head_;
   SVector<ArcIndexType> opposite_;
+
+  // The arrays read by the accessors, once the graph is built: they point to
+  // the data of the vectors above, or to the storage given to
+  // BuildFromStorage(). head_data_ and opposite_data_ point to the element of
+  // index 0.
+  const ArcIndexType* start_data_;
+  const ArcIndexType* reverse_start_data_;
+  const NodeIndexType* head_data_;
+  const ArcIndexType* opposite_data_;
   DISALLOW_COPY_AND_ASSIGN(ReverseArcStaticGraph);
 };
 
@@ -980,6 +1064,184 @@ void BaseGraph<NodeIndexType, ArcIndexType, HasReverseArcs>::
   }
 }
 
+// Stable counting sort of the elements [0, num_elements) by their key
+// keys[i] in [0, num_keys), used by the BuildFromArcs() of the static graphs.
+// Sets (*start)[key] to the position of the first element with a key >= key,
+// and calls placer(element, position) once for each element, from any of the
+// threads. Returns true if the elements were already sorted, in which case
+// each element is placed at its own index.
+template <typename KeyType, typename IndexType, typename Placer>
+bool ParallelCountingSort(KeyType num_keys, IndexType num_elements,
+                          const KeyType* keys, int num_threads,
+                          std::vector<IndexType>* start, const Placer& placer);
+
+// The implementation of ParallelCountingSort().
+//
+// The work is split on num_threads threads, in three passes:
+// - Each thread counts the elements of its chunk of [0, num_elements) in each
+//   range of keys (there are a few ranges per thread).
+// - Each thread then writes the index of the elements of its chunk in order_,
+//   grouped by range of keys, keeping the original order in each range.
+// - Each range of keys is then sorted in one thread, with a usual counting
+//   sort of the elements in its group. As the keys of each group fall in a
+//   small part of start and of the output, this is also more cache-friendly
+//   than a counting sort of all the elements at once.
+// When the elements are already sorted, or with only one thread, order_ is
+// not needed: the groups are the ranges of consecutive elements.
+template <typename KeyType, typename IndexType, typename Placer>
+class ParallelCountingSorter {
+ public:
+  ParallelCountingSorter(KeyType num_keys, IndexType num_elements,
+                       const KeyType* keys, int num_threads,
+                       std::vector<IndexType>* start, const Placer& placer)
+      : num_keys_(num_keys),
+        num_elements_(num_elements),
+        keys_(keys),
+        num_chunks_(std::max(1, num_threads)),
+        num_groups_(num_chunks_ == 1 ? 1 : 4 * num_chunks_),
+        start_(start),
+        placer_(placer) {}
+
+  bool Run() {
+    start_->assign(num_keys_, 0);
+    counts_.assign(num_chunks_ * num_groups_, 0);
+    chunk_is_sorted_.assign(num_chunks_, true);
+    RunTasks(num_chunks_, &ParallelCountingSorter::CountChunk);
+    sorted_ = std::count(chunk_is_sorted_.begin(), chunk_is_sorted_.end(),
+                         0) == 0;
+
+    // Turns the counts into offsets, group by group.
+    group_begin_.assign(num_groups_ + 1, 0);
+    IndexType sum = 0;
+    for (int group = 0; group < num_groups_; ++group) {
+      group_begin_[group] = sum;
+      for (int chunk = 0; chunk < num_chunks_; ++chunk) {
+        const IndexType count = counts_[chunk * num_groups_ + group];
+        counts_[chunk * num_groups_ + group] = sum;
+        sum += count;
+      }
+    }
+    group_begin_[num_groups_] = sum;
+    DCHECK_EQ(num_elements_, sum);
+
+    if (!sorted_ && num_groups_ > 1) {
+      order_.resize(num_elements_);
+      RunTasks(num_chunks_, &ParallelCountingSorter::ScatterChunk);
+    }
+    RunTasks(num_groups_, &ParallelCountingSorter::SortGroup);
+    std::vector<IndexType>().swap(order_);
+    return sorted_;
+  }
+
+ private:
+  IndexType ChunkBegin(int chunk) const {
+    return static_cast<int64>(num_elements_) * chunk / num_chunks_;
+  }
+  KeyType GroupKeyBegin(int group) const {
+    return static_cast<int64>(num_keys_) * group / num_groups_;
+  }
+  int Group(KeyType key) const {
+    // The largest group whose first key is <= key.
+    int group = static_cast<int64>(key) * num_groups_ / num_keys_;
+    while (GroupKeyBegin(group + 1) <= key) ++group;
+    while (GroupKeyBegin(group) > key) --group;
+    return group;
+  }
+
+  // Runs (this->*task)(i) for i in [0, num_tasks).
+  void RunTasks(int num_tasks, void (ParallelCountingSorter::*task)(int)) {
+    if (num_chunks_ == 1) {
+      for (int i = 0; i < num_tasks; ++i) (this->*task)(i);
+      return;
+    }
+    ThreadPool pool("ParallelCountingSort", num_chunks_);
+    for (int i = 0; i < num_tasks; ++i) {
+      pool.Add(NewCallback(this, task, i));
+    }
+    pool.StartWorkers();
+  }
+
+  void CountChunk(int chunk) {
+    IndexType* const counts = &counts_[chunk * num_groups_];
+    const IndexType end = ChunkBegin(chunk + 1);
+    IndexType i = ChunkBegin(chunk);
+    KeyType last_key = i > 0 && i < end ? keys_[i - 1] : 0;
+    bool is_sorted = true;
+    for (; i < end; ++i) {
+      const KeyType key = keys_[i];
+      DCHECK_GE(key, 0);
+      DCHECK_LT(key, num_keys_);
+      is_sorted &= key >= last_key;
+      last_key = key;
+      ++counts[Group(key)];
+    }
+    chunk_is_sorted_[chunk] = is_sorted;
+  }
+
+  void ScatterChunk(int chunk) {
+    IndexType* const offsets = &counts_[chunk * num_groups_];
+    const IndexType end = ChunkBegin(chunk + 1);
+    for (IndexType i = ChunkBegin(chunk); i < end; ++i) {
+      order_[offsets[Group(keys_[i])]++] = i;
+    }
+  }
+
+  void SortGroup(int group) {
+    const KeyType key_begin = GroupKeyBegin(group);
+    const KeyType key_end = GroupKeyBegin(group + 1);
+    const IndexType begin = group_begin_[group];
+    const IndexType end = group_begin_[group + 1];
+    const bool use_order = !order_.empty();
+    IndexType* const start = start_->data();
+    for (IndexType j = begin; j < end; ++j) {
+      ++start[keys_[use_order ? order_[j] : j]];
+    }
+    IndexType sum = begin;
+    for (KeyType key = key_begin; key < key_end; ++key) {
+      const IndexType count = start[key];
+      start[key] = sum;
+      sum += count;
+    }
+    if (sorted_) {
+      for (IndexType i = begin; i < end; ++i) placer_(i, i);
+      return;
+    }
+    std::vector<IndexType> next(start + key_begin, start + key_end);
+    for (IndexType j = begin; j < end; ++j) {
+      const IndexType i = use_order ? order_[j] : j;
+      placer_(i, next[keys_[i] - key_begin]++);
+    }
+  }
+
+  const KeyType num_keys_;
+  const IndexType num_elements_;
+  const KeyType* const keys_;
+  const int num_chunks_;
+  const int num_groups_;
+  std::vector<IndexType>* const start_;
+  const Placer& placer_;
+
+  // counts_[chunk * num_groups_ + group] is the number of elements of the
+  // chunk in the group, and then the position of the next one in order_.
+  std::vector<IndexType> counts_;
+  // Not a std::vector<bool>, as the chunks are counted in parallel.
+  std::vector<char> chunk_is_sorted_;
+  bool sorted_;
+  std::vector<IndexType> group_begin_;
+  std::vector<IndexType> order_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelCountingSorter);
+};
+
+template <typename KeyType, typename IndexType, typename Placer>
+bool ParallelCountingSort(KeyType num_keys, IndexType num_elements,
+                          const KeyType* keys, int num_threads,
+                          std::vector<IndexType>* start, const Placer& placer) {
+  ParallelCountingSorter<KeyType, IndexType, Placer> sorter(
+      num_keys, num_elements, keys, num_threads, start, placer);
+  return sorter.Run();
+}
+
 // ---------------------------------------------------------------------------
 // Macros to wrap old style iteration into the new range-based for loop style.
 // ---------------------------------------------------------------------------
@@ -1168,14 +1430,14 @@ class ListGraph<NodeIndexType, ArcIndexType>::OutgoingHeadIterator {
 template <typename NodeIndexType, typename ArcIndexType>
 IntegerRange<ArcIndexType> StaticGraph<
     NodeIndexType, ArcIndexType>::OutgoingArcs(NodeIndexType node) const {
-  return IntegerRange<ArcIndexType>(start_[node], DirectArcLimit(node));
+  return IntegerRange<ArcIndexType>(start_data_[node], DirectArcLimit(node));
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
 BeginEndWrapper<NodeIndexType const*> StaticGraph<NodeIndexType, ArcIndexType>::
 operator[](NodeIndexType node) const {
   return BeginEndWrapper<NodeIndexType const*>(
-      head_.data() + start_[node], head_.data() + DirectArcLimit(node));
+      head_data_ + start_data_[node], head_data_ + DirectArcLimit(node));
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
@@ -1202,6 +1464,7 @@ void StaticGraph<NodeIndexType, ArcIndexType>::ReserveArcs(ArcIndexType bound) {
   if (bound <= num_arcs_) return;
   arc_capacity_ = bound;
   head_.reserve(bound);
+  head_data_ = head_.data();
   if (!arc_in_order_) {
     tail_.reserve(bound);
   }
@@ -1233,6 +1496,7 @@ ArcIndexType StaticGraph<NodeIndexType, ArcIndexType>::AddArc(
     tail_.push_back(tail);
   }
   head_.push_back(head);
+  head_data_ = head_.data();
   DCHECK(!const_capacities_ || num_arcs_ < arc_capacity_);
   return num_arcs_++;
 }
@@ -1269,7 +1533,7 @@ template <typename NodeIndexType, typename ArcIndexType>
 NodeIndexType StaticGraph<NodeIndexType, ArcIndexType>::Head(
     ArcIndexType arc) const {
   DCHECK(IsArcValid(arc));
-  return head_[arc];
+  return head_data_[arc];
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
@@ -1302,7 +1566,7 @@ NodeIndexType StaticGraph<NodeIndexType, ArcIndexType>::Tail(
     const int last_tail_recorded = tail_.empty() ? 0 : tail_.back();
     const int last_node_index = num_nodes_ - 1;
     for (int i = last_tail_recorded; i < last_node_index; ++i) {
-      tail_.resize(start_[i + 1], i);
+      tail_.resize(start_data_[i + 1], i);
     }
     tail_.resize(num_arcs_, last_node_index);
     return tail_[arc];
@@ -1340,6 +1604,7 @@ void StaticGraph<NodeIndexType, ArcIndexType>::Build(
       permutation->clear();
     }
     this->ComputeCumulativeSum(&start_);
+    start_data_ = start_.data();
     return;
   }
 
@@ -1373,6 +1638,61 @@ void StaticGraph<NodeIndexType, ArcIndexType>::Build(
     start_[i] = start_[i - 1];
   }
   start_[0] = 0;
+  start_data_ = start_.data();
+  head_data_ = head_.data();
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+void StaticGraph<NodeIndexType, ArcIndexType>::BuildFromArcs(
+    NodeIndexType num_nodes, ArcIndexType num_arcs, const NodeIndexType* tails,
+    const NodeIndexType* heads, int num_threads,
+    std::vector<ArcIndexType>* permutation) {
+  DCHECK(!is_built_);
+  DCHECK_EQ(0, num_nodes_);
+  DCHECK_EQ(0, num_arcs_);
+  if (is_built_) return;
+  is_built_ = true;
+  num_nodes_ = num_nodes;
+  num_arcs_ = num_arcs;
+  node_capacity_ = num_nodes_;
+  arc_capacity_ = num_arcs_;
+  this->FreezeCapacities();
+
+  // Sorts the arcs by tail, and puts the head of each arc at its new index.
+  head_.resize(num_arcs_);
+  std::vector<ArcIndexType> perm(permutation == NULL ? 0 : num_arcs_);
+  NodeIndexType* const new_heads = head_.data();
+  ArcIndexType* const new_indices = perm.empty() ? NULL : perm.data();
+  arc_in_order_ = ParallelCountingSort(
+      num_nodes_, num_arcs_, tails, num_threads, &start_,
+      [new_heads, new_indices, heads](ArcIndexType arc, ArcIndexType index) {
+        new_heads[index] = heads[arc];
+        if (new_indices != NULL) new_indices[arc] = index;
+      });
+  if (permutation != NULL) {
+    if (arc_in_order_) perm.clear();
+    permutation->swap(perm);
+  }
+  start_data_ = start_.data();
+  head_data_ = head_.data();
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+void StaticGraph<NodeIndexType, ArcIndexType>::BuildFromStorage(
+    NodeIndexType num_nodes, ArcIndexType num_arcs, const ArcIndexType* start,
+    const NodeIndexType* head) {
+  DCHECK(!is_built_);
+  DCHECK_EQ(0, num_nodes_);
+  DCHECK_EQ(0, num_arcs_);
+  if (is_built_) return;
+  is_built_ = true;
+  num_nodes_ = num_nodes;
+  num_arcs_ = num_arcs;
+  node_capacity_ = num_nodes_;
+  arc_capacity_ = num_arcs_;
+  this->FreezeCapacities();
+  start_data_ = start;
+  head_data_ = head;
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
@@ -1393,7 +1713,7 @@ class StaticGraph<NodeIndexType, ArcIndexType>::OutgoingArcIterator
     : public Base::BaseStaticArcIterator {
  public:
   OutgoingArcIterator(const StaticGraph& graph, NodeIndexType node)
-      : Base::BaseStaticArcIterator(graph.start_[node],
+      : Base::BaseStaticArcIterator(graph.start_data_[node],
                                     graph.DirectArcLimit(node)) {
     DCHECK(graph.is_built_);
     DCHECK(graph.IsNodeValid(node));
@@ -1403,7 +1723,7 @@ class StaticGraph<NodeIndexType, ArcIndexType>::OutgoingArcIterator
       : Base::BaseStaticArcIterator(arc, graph.DirectArcLimit(node)) {
     DCHECK(graph.is_built_);
     DCHECK(graph.IsNodeValid(node));
-    DCHECK_GE(arc, graph.start_[node]);
+    DCHECK_GE(arc, graph.start_data_[node]);
   }
 };
 
@@ -1621,7 +1941,7 @@ class ReverseArcListGraph<NodeIndexType, ArcIndexType>::OutgoingHeadIterator {
 template <typename NodeIndexType, typename ArcIndexType>
 IntegerRange<ArcIndexType> ReverseArcStaticGraph<
     NodeIndexType, ArcIndexType>::OutgoingArcs(NodeIndexType node) const {
-  return IntegerRange<ArcIndexType>(start_[node], DirectArcLimit(node));
+  return IntegerRange<ArcIndexType>(start_data_[node], DirectArcLimit(node));
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
@@ -1629,7 +1949,7 @@ BeginEndWrapper<NodeIndexType const*>
 ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::operator[](
     NodeIndexType node) const {
   return BeginEndWrapper<NodeIndexType const*>(
-      head_.data() + start_[node], head_.data() + DirectArcLimit(node));
+      head_data_ + start_data_[node], head_data_ + DirectArcLimit(node));
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
@@ -1642,7 +1962,7 @@ ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::OutgoingArcsStartingFrom(
 template <typename NodeIndexType, typename ArcIndexType>
 IntegerRange<ArcIndexType> ReverseArcStaticGraph<
     NodeIndexType, ArcIndexType>::IncomingArcs(NodeIndexType node) const {
-  return IntegerRange<ArcIndexType>(reverse_start_[node],
+  return IntegerRange<ArcIndexType>(reverse_start_data_[node],
                                     ReverseArcLimit(node));
 }
 
@@ -1660,7 +1980,7 @@ ArcIndexType ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::OppositeArc(
     ArcIndexType arc) const {
   DCHECK(is_built_);
   DCHECK(IsArcValid(arc));
-  return opposite_[arc];
+  return opposite_data_[arc];
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
@@ -1668,14 +1988,14 @@ NodeIndexType ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::Head(
     ArcIndexType arc) const {
   DCHECK(is_built_);
   DCHECK(IsArcValid(arc));
-  return head_[arc];
+  return head_data_[arc];
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
 NodeIndexType ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::Tail(
     ArcIndexType arc) const {
   DCHECK(is_built_);
-  return head_[OppositeArc(arc)];
+  return head_data_[OppositeArc(arc)];
 }
 
 template <typename NodeIndexType, typename ArcIndexType>
@@ -1755,6 +2075,62 @@ void ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::Build(
   for (int i = 0; i < num_arcs_; ++i) {
     opposite_[opposite_[i]] = i;
   }
+  SetDataFromVectors();
+  for (const NodeIndexType node : Base::AllNodes()) {
+    for (const ArcIndexType arc : OutgoingArcs(node)) {
+      head_[opposite_[arc]] = node;
+    }
+  }
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+void ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::BuildFromArcs(
+    NodeIndexType num_nodes, ArcIndexType num_arcs, const NodeIndexType* tails,
+    const NodeIndexType* heads, int num_threads,
+    std::vector<ArcIndexType>* permutation) {
+  DCHECK(!is_built_);
+  DCHECK_EQ(0, num_nodes_);
+  DCHECK_EQ(0, num_arcs_);
+  if (is_built_) return;
+  is_built_ = true;
+  num_nodes_ = num_nodes;
+  num_arcs_ = num_arcs;
+  node_capacity_ = num_nodes_;
+  arc_capacity_ = num_arcs_;
+  this->FreezeCapacities();
+
+  // Sorts the forward arcs by tail, as in StaticGraph::BuildFromArcs().
+  head_.resize(num_arcs_);
+  std::vector<ArcIndexType> perm(permutation == NULL ? 0 : num_arcs_);
+  NodeIndexType* const new_heads = head_.data();
+  ArcIndexType* const new_indices = perm.empty() ? NULL : perm.data();
+  const bool arcs_in_order = ParallelCountingSort(
+      num_nodes_, num_arcs_, tails, num_threads, &start_,
+      [new_heads, new_indices, heads](ArcIndexType arc, ArcIndexType index) {
+        new_heads[index] = heads[arc];
+        if (new_indices != NULL) new_indices[arc] = index;
+      });
+  if (permutation != NULL) {
+    if (arcs_in_order) perm.clear();
+    permutation->swap(perm);
+  }
+
+  // Sorts the forward arcs by head: as in Build(), the reverse arc of the
+  // forward arc of rank r in this order is r - num_arcs_.
+  opposite_.resize(num_arcs_);
+  ArcIndexType* const opposite = opposite_.data();
+  const ArcIndexType total_num_arcs = num_arcs_;
+  ParallelCountingSort(
+      num_nodes_, num_arcs_, static_cast<const NodeIndexType*>(new_heads),
+      num_threads, &reverse_start_,
+      [opposite, total_num_arcs](ArcIndexType arc, ArcIndexType rank) {
+        opposite[arc] = rank - total_num_arcs;
+        opposite[rank - total_num_arcs] = arc;
+      });
+  for (const NodeIndexType node : Base::AllNodes()) {
+    reverse_start_[node] -= num_arcs_;
+  }
+  SetDataFromVectors();
   for (const NodeIndexType node : Base::AllNodes()) {
     for (const ArcIndexType arc : OutgoingArcs(node)) {
       head_[opposite_[arc]] = node;
@@ -1762,12 +2138,33 @@ void ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::Build(
   }
 }
 
+template <typename NodeIndexType, typename ArcIndexType>
+void ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::BuildFromStorage(
+    NodeIndexType num_nodes, ArcIndexType num_arcs, const ArcIndexType* start,
+    const ArcIndexType* reverse_start, const NodeIndexType* head,
+    const ArcIndexType* opposite) {
+  DCHECK(!is_built_);
+  DCHECK_EQ(0, num_nodes_);
+  DCHECK_EQ(0, num_arcs_);
+  if (is_built_) return;
+  is_built_ = true;
+  num_nodes_ = num_nodes;
+  num_arcs_ = num_arcs;
+  node_capacity_ = num_nodes_;
+  arc_capacity_ = num_arcs_;
+  this->FreezeCapacities();
+  start_data_ = start;
+  reverse_start_data_ = reverse_start;
+  head_data_ = head + num_arcs;
+  opposite_data_ = opposite + num_arcs;
+}
+
 template <typename NodeIndexType, typename ArcIndexType>
 class ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::OutgoingArcIterator
     : public Base::BaseStaticArcIterator {
  public:
   OutgoingArcIterator(const ReverseArcStaticGraph& graph, NodeIndexType node)
-      : Base::BaseStaticArcIterator(graph.start_[node],
+      : Base::BaseStaticArcIterator(graph.start_data_[node],
                                     graph.DirectArcLimit(node)) {
     DCHECK(graph.is_built_);
     DCHECK(graph.IsNodeValid(node));
@@ -1777,7 +2174,7 @@ class ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::OutgoingArcIterator
       : Base::BaseStaticArcIterator(arc, graph.DirectArcLimit(node)) {
     DCHECK(graph.is_built_);
     DCHECK(graph.IsNodeValid(node));
-    DCHECK_GE(arc, graph.start_[node]);
+    DCHECK_GE(arc, graph.start_data_[node]);
   }
 };
 
@@ -1786,7 +2183,7 @@ class ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::IncomingArcIterator
     : public Base::BaseStaticArcIterator {
  public:
   IncomingArcIterator(const ReverseArcStaticGraph& graph, NodeIndexType node)
-      : Base::BaseStaticArcIterator(graph.reverse_start_[node],
+      : Base::BaseStaticArcIterator(graph.reverse_start_data_[node],
                                     graph.ReverseArcLimit(node)) {
     DCHECK(graph.is_built_);
     DCHECK(graph.IsNodeValid(node));
@@ -1796,7 +2193,7 @@ class ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::IncomingArcIterator
       : Base::BaseStaticArcIterator(arc, graph.ReverseArcLimit(node)) {
     DCHECK(graph.is_built_);
     DCHECK(graph.IsNodeValid(node));
-    DCHECK_GE(arc, graph.reverse_start_[node]);
+    DCHECK_GE(arc, graph.reverse_start_data_[node]);
   }
 };
 
@@ -1808,22 +2205,24 @@ class ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::IncidentArcIterator
 
  public:
   IncidentArcIterator(const ReverseArcStaticGraph& graph, NodeIndexType node)
-      : Base::BaseStaticArcIterator(graph.reverse_start_[node],
+      : Base::BaseStaticArcIterator(graph.reverse_start_data_[node],
                                     graph.DirectArcLimit(node)),
-        next_start_(graph.start_[node]),
+        next_start_(graph.start_data_[node]),
         first_limit_(graph.ReverseArcLimit(node)) {
     if (index_ == first_limit_) index_ = next_start_;
     DCHECK(graph.IsNodeValid(node));
-    DCHECK((index_ >= graph.reverse_start_[node] && index_ < first_limit_) ||
+    DCHECK((index_ >= graph.reverse_start_data_[node] &&
+            index_ < first_limit_) ||
            (index_ >= next_start_));
   }
   IncidentArcIterator(const ReverseArcStaticGraph& graph, NodeIndexType node,
                       ArcIndexType arc)
       : Base::BaseStaticArcIterator(arc, graph.DirectArcLimit(node)),
-        next_start_(graph.start_[node]),
+        next_start_(graph.start_data_[node]),
         first_limit_(graph.ReverseArcLimit(node)) {
     DCHECK(graph.IsNodeValid(node));
-    DCHECK((index_ >= graph.reverse_start_[node] && index_ < first_limit_) ||
+    DCHECK((index_ >= graph.reverse_start_data_[node] &&
+            index_ < first_limit_) ||
            (index_ >= next_start_));
   }
   void Next() {
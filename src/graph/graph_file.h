@@ -0,0 +1,327 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A binary file format for the built StaticGraph<> and ReverseArcStaticGraph<>
+// of ./graph.h. The file holds the internal arrays of the graph, so it can be
+// memory-mapped and used directly as the storage of the graph: opening a file
+// takes the same time whatever its size, its pages are only read when they
+// are accessed, and they are shared by all the processes that map the file.
+//
+// The file can also hold int64 arc annotations (capacities, costs, ...),
+// indexed by the forward arcs of the graph. Everything is written in the
+// native byte order, so a file must be read on the architecture it was
+// written on. The file is not checked beyond its header: only open files
+// written by WriteGraphToBinaryFile().
+//
+// Example:
+//   typedef ReverseArcStaticGraph<> Graph;
+//   Graph graph;
+//   std::vector<int64> capacities;
+//   ...
+//   CHECK_OK(WriteGraphToBinaryFile(graph, {&capacities}, "graph.bin"));
+//
+//   MappedGraphFile<Graph> file;
+//   CHECK_OK(file.Open("graph.bin"));
+//   const Graph& mapped_graph = file.graph();
+//   const int64* const mapped_capacities = file.arc_annotation(0);
+
+#ifndef OR_TOOLS_GRAPH_GRAPH_FILE_H_
+#define OR_TOOLS_GRAPH_GRAPH_FILE_H_
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include "base/unique_ptr.h"
+#include <string>
+#include <vector>
+
+#include "base/file.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/status.h"
+#include "graph/graph.h"
+
+namespace operations_research {
+
+// Writes the graph, which must be built, and the given arc annotations, each
+// with one value per forward arc, to a file that MappedGraphFile can open.
+template <class Graph>
+util::Status WriteGraphToBinaryFile(
+    const Graph& graph,
+    const std::vector<const std::vector<int64>*>& arc_annotations,
+    const std::string& filename);
+
+// Memory-maps a file written by WriteGraphToBinaryFile() and exposes its graph
+// and arc annotations, which are valid as long as this object lives. Graph
+// must be the type of the written graph.
+template <class Graph>
+class MappedGraphFile {
+ public:
+  MappedGraphFile() {}
+
+  // Maps the file. This can only be called once.
+  util::Status Open(const std::string& filename);
+
+  const Graph& graph() const { return graph_; }
+  int num_arc_annotations() const { return arc_annotations_.size(); }
+  const int64* arc_annotation(int index) const {
+    return arc_annotations_[index];
+  }
+
+ private:
+  Graph graph_;
+  std::vector<const int64*> arc_annotations_;
+  std::unique_ptr<MappedFile> file_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedGraphFile);
+};
+
+// Implementation details --------------------------------------------------
+
+namespace graph_file_internal {
+const char kMagic[8] = {'O', 'R', 'G', 'R', 'A', 'P', 'H', '1'};
+
+struct Header {
+  char magic[8];
+  int32 has_reverse_arcs;
+  int32 node_index_size;
+  int32 arc_index_size;
+  int32 num_arc_annotations;
+  int64 num_nodes;
+  int64 num_arcs;
+};
+
+// Every array of the file starts at a multiple of 8 bytes.
+inline int64 PaddedSize(int64 size) { return (size + 7) & ~int64(7); }
+
+// Writes the values value_of(i) for i in [begin, end), and the padding after
+// them. The values are written by chunks, through a buffer.
+template <typename T, typename ValueOf>
+bool WriteArray(int64 begin, int64 end, const ValueOf& value_of, FILE* file) {
+  const int64 kChunkSize = 1 << 16;
+  std::vector<T> buffer;
+  buffer.reserve(std::min(kChunkSize, end - begin));
+  for (int64 chunk_begin = begin; chunk_begin < end;
+       chunk_begin += kChunkSize) {
+    const int64 chunk_end = std::min(end, chunk_begin + kChunkSize);
+    buffer.clear();
+    for (int64 i = chunk_begin; i < chunk_end; ++i) {
+      buffer.push_back(value_of(i));
+    }
+    if (fwrite(buffer.data(), sizeof(T), buffer.size(), file) !=
+        buffer.size()) {
+      return false;
+    }
+  }
+  const int64 size = (end - begin) * sizeof(T);
+  const char kZeros[8] = {0};
+  const size_t padding = PaddedSize(size) - size;
+  return fwrite(kZeros, 1, padding, file) == padding;
+}
+
+// Returns the T* at *offset in data, and moves *offset after its num_elements
+// elements.
+template <typename T>
+const T* NextArray(const char* data, int64 num_elements, int64* offset) {
+  const T* const array = reinterpret_cast<const T*>(data + *offset);
+  *offset += PaddedSize(num_elements * sizeof(T));
+  return array;
+}
+
+// The graph specific parts of the format: whether the graph has reverse arcs,
+// how to write its arrays, their total size in the file, and how to build the
+// graph from the mapped arrays.
+template <typename NodeIndexType, typename ArcIndexType>
+bool HasReverseArcs(const StaticGraph<NodeIndexType, ArcIndexType>& graph) {
+  return false;
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool HasReverseArcs(
+    const ReverseArcStaticGraph<NodeIndexType, ArcIndexType>& graph) {
+  return true;
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteArrays(const StaticGraph<NodeIndexType, ArcIndexType>& graph,
+                 FILE* file) {
+  return WriteArray<ArcIndexType>(
+             0, graph.num_nodes(),
+             [&graph](int64 node) { return *graph.OutgoingArcs(node).begin(); },
+             file) &&
+         WriteArray<NodeIndexType>(
+             0, graph.num_arcs(),
+             [&graph](int64 arc) { return graph.Head(arc); }, file);
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteArrays(
+    const ReverseArcStaticGraph<NodeIndexType, ArcIndexType>& graph,
+    FILE* file) {
+  const int64 num_arcs = graph.num_arcs();
+  return WriteArray<ArcIndexType>(
+             0, graph.num_nodes(),
+             [&graph](int64 node) { return *graph.OutgoingArcs(node).begin(); },
+             file) &&
+         WriteArray<ArcIndexType>(
+             0, graph.num_nodes(),
+             [&graph](int64 node) { return *graph.IncomingArcs(node).begin(); },
+             file) &&
+         WriteArray<NodeIndexType>(
+             -num_arcs, num_arcs,
+             [&graph](int64 arc) { return graph.Head(arc); }, file) &&
+         WriteArray<ArcIndexType>(
+             -num_arcs, num_arcs,
+             [&graph](int64 arc) { return graph.OppositeArc(arc); }, file);
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+int64 ArraysSize(const StaticGraph<NodeIndexType, ArcIndexType>& graph,
+                 int64 num_nodes, int64 num_arcs) {
+  return PaddedSize(num_nodes * sizeof(ArcIndexType)) +
+         PaddedSize(num_arcs * sizeof(NodeIndexType));
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+int64 ArraysSize(
+    const ReverseArcStaticGraph<NodeIndexType, ArcIndexType>& graph,
+    int64 num_nodes, int64 num_arcs) {
+  return 2 * PaddedSize(num_nodes * sizeof(ArcIndexType)) +
+         PaddedSize(2 * num_arcs * sizeof(NodeIndexType)) +
+         PaddedSize(2 * num_arcs * sizeof(ArcIndexType));
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+void BuildFromArrays(const char* data, int64 num_nodes, int64 num_arcs,
+                     int64* offset,
+                     StaticGraph<NodeIndexType, ArcIndexType>* graph) {
+  const ArcIndexType* const start =
+      NextArray<ArcIndexType>(data, num_nodes, offset);
+  const NodeIndexType* const head =
+      NextArray<NodeIndexType>(data, num_arcs, offset);
+  graph->BuildFromStorage(num_nodes, num_arcs, start, head);
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+void BuildFromArrays(
+    const char* data, int64 num_nodes, int64 num_arcs, int64* offset,
+    ReverseArcStaticGraph<NodeIndexType, ArcIndexType>* graph) {
+  const ArcIndexType* const start =
+      NextArray<ArcIndexType>(data, num_nodes, offset);
+  const ArcIndexType* const reverse_start =
+      NextArray<ArcIndexType>(data, num_nodes, offset);
+  const NodeIndexType* const head =
+      NextArray<NodeIndexType>(data, 2 * num_arcs, offset);
+  const ArcIndexType* const opposite =
+      NextArray<ArcIndexType>(data, 2 * num_arcs, offset);
+  graph->BuildFromStorage(num_nodes, num_arcs, start, reverse_start, head,
+                          opposite);
+}
+}  // namespace graph_file_internal
+
+template <class Graph>
+util::Status WriteGraphToBinaryFile(
+    const Graph& graph,
+    const std::vector<const std::vector<int64>*>& arc_annotations,
+    const std::string& filename) {
+  for (const std::vector<int64>* const annotation : arc_annotations) {
+    if (annotation->size() != graph.num_arcs()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "An arc annotation does not have one value per arc");
+    }
+  }
+  FILE* const file = fopen(filename.c_str(), "wb");
+  if (file == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Could not open file: '" + filename + "'");
+  }
+  graph_file_internal::Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, graph_file_internal::kMagic, sizeof(header.magic));
+  header.has_reverse_arcs = graph_file_internal::HasReverseArcs(graph);
+  header.node_index_size = sizeof(typename Graph::NodeIndex);
+  header.arc_index_size = sizeof(typename Graph::ArcIndex);
+  header.num_arc_annotations = arc_annotations.size();
+  header.num_nodes = graph.num_nodes();
+  header.num_arcs = graph.num_arcs();
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            graph_file_internal::WriteArrays(graph, file);
+  for (const std::vector<int64>* const annotation : arc_annotations) {
+    ok = ok && graph_file_internal::WriteArray<int64>(
+                   0, header.num_arcs,
+                   [annotation](int64 arc) { return (*annotation)[arc]; },
+                   file);
+  }
+  ok = fclose(file) == 0 && ok;
+  if (!ok) {
+    return util::Status(util::error::INTERNAL,
+                        "Could not write file: '" + filename + "'");
+  }
+  return util::Status();
+}
+
+template <class Graph>
+util::Status MappedGraphFile<Graph>::Open(const std::string& filename) {
+  CHECK(file_ == nullptr) << "MappedGraphFile::Open() can only be called once";
+  // The arrays are accessed in no particular order.
+  file_.reset(MappedFile::Open(filename, /*sequential_access=*/false));
+  if (file_ == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Could not open file: '" + filename + "'");
+  }
+  const char* const data = file_->data();
+  const size_t size = file_->size();
+
+  graph_file_internal::Header header;
+  bool valid = size >= sizeof(header);
+  if (valid) {
+    memcpy(&header, data, sizeof(header));
+    valid =
+        memcmp(header.magic, graph_file_internal::kMagic,
+               sizeof(header.magic)) == 0 &&
+        header.has_reverse_arcs ==
+            graph_file_internal::HasReverseArcs(graph_) &&
+        header.node_index_size == sizeof(typename Graph::NodeIndex) &&
+        header.arc_index_size == sizeof(typename Graph::ArcIndex) &&
+        header.num_arc_annotations >= 0 && header.num_nodes >= 0 &&
+        header.num_arcs >= 0 &&
+        header.num_nodes <=
+            std::numeric_limits<typename Graph::NodeIndex>::max() &&
+        header.num_arcs <=
+            std::numeric_limits<typename Graph::ArcIndex>::max() &&
+        size == sizeof(header) +
+                     graph_file_internal::ArraysSize(graph_, header.num_nodes,
+                                                     header.num_arcs) +
+                     header.num_arc_annotations * header.num_arcs *
+                         sizeof(int64);
+  }
+  if (!valid) {
+    file_.reset();
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Not a graph file of this graph type: '" + filename +
+                            "'");
+  }
+  int64 offset = sizeof(header);
+  graph_file_internal::BuildFromArrays(data, header.num_nodes,
+                                       header.num_arcs, &offset, &graph_);
+  for (int i = 0; i < header.num_arc_annotations; ++i) {
+    arc_annotations_.push_back(graph_file_internal::NextArray<int64>(
+        data, header.num_arcs, &offset));
+  }
+  return util::Status();
+}
+
+}  // namespace operations_research
+#endif  // OR_TOOLS_GRAPH_GRAPH_FILE_H_
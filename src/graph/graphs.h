@@ -74,6 +74,41 @@ struct Graphs<operations_research::StarGraph> {
   }
 };
 
+// The forward-only graphs of ebert_graph.h have no opposite arcs, and are
+// either built incrementally or at construction, so only the subset of the
+// interface used by LinearSumAssignment is provided.
+template <>
+struct Graphs<operations_research::ForwardStarGraph> {
+  typedef operations_research::ForwardStarGraph Graph;
+  typedef Graph::ArcIndex ArcIndex;
+  typedef Graph::NodeIndex NodeIndex;
+  static bool IsArcValid(const Graph& graph, ArcIndex arc) {
+    return graph.CheckArcValidity(arc);
+  }
+  static NodeIndex NodeReservation(const Graph& graph) {
+    return graph.max_num_nodes();
+  }
+  static ArcIndex ArcReservation(const Graph& graph) {
+    return graph.max_num_arcs();
+  }
+};
+
+template <>
+struct Graphs<operations_research::ForwardStarStaticGraph> {
+  typedef operations_research::ForwardStarStaticGraph Graph;
+  typedef Graph::ArcIndex ArcIndex;
+  typedef Graph::NodeIndex NodeIndex;
+  static bool IsArcValid(const Graph& graph, ArcIndex arc) {
+    return graph.CheckArcValidity(arc);
+  }
+  static NodeIndex NodeReservation(const Graph& graph) {
+    return graph.max_num_nodes();
+  }
+  static ArcIndex ArcReservation(const Graph& graph) {
+    return graph.max_num_arcs();
+  }
+};
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_GRAPH_GRAPHS_H_
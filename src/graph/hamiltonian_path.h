@@ -88,8 +88,10 @@
 #include <utility>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/threadpool.h"
 #include "util/bitset.h"
 #include "util/saturated_arithmetic.h"
 
@@ -306,6 +308,17 @@ template <typename Set, typename CostType> class LatticeMemoryManager {
          binomial_coefficients_[removed_node][rank]);  // for removed_node.
   }
 
+  // Returns (n choose k), for n <= max_card and k <= n + 1.
+  uint64 BinomialCoefficient(int n, int k) const {
+    return binomial_coefficients_[n][k];
+  }
+
+  // Returns the set of cardinality 'card' that comes at position 'rank' in
+  // the iteration of SetRangeWithCardinality, i.e. the set whose base offset
+  // is base_offset_[card] + card * rank. This makes it possible to split the
+  // sets of a given cardinality in ranges iterated independently.
+  Set SetWithRank(int card, uint64 rank) const;
+
   // Memorizes the value = f(s, node) at the correct offset.
   // This is favored in all other uses than the Dynamic Programming iterations.
   void SetValue(Set s, int node, CostType value);
@@ -421,6 +434,26 @@ uint64 LatticeMemoryManager<Set, CostType>::BaseOffset(int card,
   return base_offset_[card] + card * local_offset;
 }
 
+template <typename Set, typename CostType>
+Set LatticeMemoryManager<Set, CostType>::SetWithRank(int card,
+                                                     uint64 rank) const {
+  DCHECK_LT(0, card);
+  DCHECK_GE(max_card_, card);
+  // This inverts the computation of local_offset in BaseOffset(): the element
+  // of rank k - 1 is the largest node such that (node choose k) <= rank.
+  // Since (k - 1 choose k) == 0, node never goes below k - 1.
+  typename Set::IntegerType value = 0;
+  int node = max_card_ - 1;
+  for (int k = card; k > 0; --k) {
+    while (binomial_coefficients_[node][k] > rank) --node;
+    rank -= binomial_coefficients_[node][k];
+    value |= Set::One << node;
+    --node;
+  }
+  DCHECK_EQ(0, rank);
+  return Set(value);
+}
+
 template <typename Set, typename CostType>
 uint64 LatticeMemoryManager<Set, CostType>::Offset(Set set, int node) const {
   DCHECK(set.Contains(node));
@@ -469,6 +502,15 @@ template <typename CostType> class HamiltonianPathSolver {
 
   explicit HamiltonianPathSolver(const std::vector<std::vector<CostType>>& cost);
 
+  // Sets the number of threads used by the dynamic programming iterations.
+  // The sets of a given cardinality only depend on the sets of the preceding
+  // cardinality, so each layer of the lattice is split in num_threads ranges
+  // of sets computed in parallel. Small layers are computed sequentially.
+  void SetNumThreads(int num_threads) {
+    CHECK_LE(1, num_threads);
+    num_threads_ = num_threads;
+  }
+
   // Replaces the cost matrix while avoiding re-allocating memory.
   void ChangeCostMatrix(const std::vector<std::vector<CostType>>& cost_matrix);
 
@@ -511,6 +553,10 @@ template <typename CostType> class HamiltonianPathSolver {
   // Does all the Dynamic Progamming iterations.
   void Solve();
 
+  // Computes f(set, dest) for all the sets with cardinality card whose rank
+  // in SetRangeWithCardinality is in [begin_rank, end_rank).
+  void ComputeLayer(int card, uint64 begin_rank, uint64 end_rank);
+
   // Computes a path by looking at the information in mem_.
   std::vector<int> ComputePath(CostType cost, NodeSet set, int end);
 
@@ -522,6 +568,12 @@ template <typename CostType> class HamiltonianPathSolver {
   // ChangeCostMatrix();
   std::vector<std::vector<CostType>> cost_matrix_;
 
+  // The transpose of cost_matrix_, stored row by row:
+  // incoming_costs_[dest * num_nodes_ + src] == cost_matrix_[src][dest].
+  // This keeps the costs of the arcs entering a node contiguous for the
+  // inner loop of the Dynamic Programming iterations.
+  std::vector<CostType> incoming_costs_;
+
   // Returns the saturated addition of a and b. By default for floating-point
   // types it is a + b. It is specialized below for int32 and int64.
   CostType SaturatedAdd(CostType a, CostType b) {
@@ -531,6 +583,9 @@ template <typename CostType> class HamiltonianPathSolver {
   // The number of nodes in the problem.
   int num_nodes_;
 
+  // The number of threads used by Solve().
+  int num_threads_;
+
   // The cost of the computed TSP path.
   CostType tsp_cost_;
 
@@ -561,6 +616,7 @@ HamiltonianPathSolver<CostType>::HamiltonianPathSolver(
     const std::vector<std::vector<CostType>>& cost_matrix)
     : cost_matrix_(cost_matrix),
       num_nodes_(cost_matrix_.size()),
+      num_threads_(1),
       tsp_cost_(0),
       hamiltonian_costs_(0),
       robust_(true),
@@ -591,9 +647,11 @@ bool HamiltonianPathSolver<CostType>::CheckCostMatrix() {
   return true;
 }
 
+// CapAddGeneric is used instead of CapAdd, whose inline assembly would
+// prevent the compiler from vectorizing the loops of ComputeLayer().
 template <>
 int64 HamiltonianPathSolver<int64>::SaturatedAdd(int64 a, int64 b) {
-  return CapAdd(a, b);
+  return CapAddGeneric(a, b);
 }
 
 // TODO(user): implement this natively in saturated_arithmetic.h
@@ -629,40 +687,30 @@ template <typename CostType> void HamiltonianPathSolver<CostType>::Solve() {
     mem_.SetValueAtOffset(dest, cost_matrix_[0][dest]);
   }
 
+  incoming_costs_.resize(num_nodes_ * num_nodes_);
+  for (int src = 0; src < num_nodes_; ++src) {
+    for (int dest = 0; dest < num_nodes_; ++dest) {
+      incoming_costs_[dest * num_nodes_ + src] = cost_matrix_[src][dest];
+    }
+  }
+
   // Populate the dynamic programming lattice layer by layer, by iterating
   // on cardinality.
+  // Below this number of values to compute, a layer is computed sequentially.
+  const uint64 kMinParallelLayerSize = 1 << 14;
   for (int card = 2; card <= num_nodes_; ++card) {
-    // Iterate on sets of same cardinality.
-    for (NodeSet set : SetRangeWithCardinality<Set<uint32>>(card, num_nodes_)) {
-      // Using BaseOffset and maintaining the node ranks, to reduce the
-      // computational effort for accessing the data.
-      const uint64 set_offset = mem_.BaseOffset(card, set);
-      // The first subset on which we'll iterate is set.RemoveSmallestElement().
-      // Compute its offset. It will be updated incrementaly. This saves about
-      // 30-35% of computation time.
-      uint64 subset_offset = mem_.BaseOffset(card - 1,
-                                             set.RemoveSmallestElement());
-      int prev_dest = set.SmallestElement();
-      int dest_rank = 0;
-      for (int dest : set) {
-        CostType min_cost = std::numeric_limits<CostType>::max();
-        const NodeSet subset = set.RemoveElement(dest);
-        // We compute the offset for subset from the preceding iteration
-        // by taking into account that prev_dest is now in subset, and
-        // that dest is now removed from subset.
-        subset_offset += mem_.OffsetDelta(card - 1, prev_dest, dest, dest_rank);
-        int src_rank = 0;
-        for (int src : subset) {
-          min_cost = std::min(min_cost,
-                              SaturatedAdd(cost_matrix_[src][dest],
-                              mem_.ValueAtOffset(subset_offset + src_rank)));
-          ++src_rank;
-        }
-        prev_dest = dest;
-        mem_.SetValueAtOffset(set_offset + dest_rank, min_cost);
-        ++dest_rank;
-      }
+    const uint64 num_sets = mem_.BinomialCoefficient(num_nodes_, card);
+    if (num_threads_ == 1 || num_sets * card < kMinParallelLayerSize) {
+      ComputeLayer(card, 0, num_sets);
+      continue;
+    }
+    ThreadPool pool("HamiltonianPathSolver", num_threads_);
+    for (int chunk = 0; chunk < num_threads_; ++chunk) {
+      pool.Add(NewCallback(this, &HamiltonianPathSolver::ComputeLayer, card,
+                           num_sets * chunk / num_threads_,
+                           num_sets * (chunk + 1) / num_threads_));
     }
+    pool.StartWorkers();
   }
 
   const NodeSet full_set = NodeSet::FullSet(num_nodes_);
@@ -695,6 +743,56 @@ template <typename CostType> void HamiltonianPathSolver<CostType>::Solve() {
   solved_ = true;
 }
 
+template <typename CostType>
+void HamiltonianPathSolver<CostType>::ComputeLayer(int card,
+                                                   uint64 begin_rank,
+                                                   uint64 end_rank) {
+  if (begin_rank == end_rank) return;
+  int nodes[NodeSet::MaxCardinality];
+  SetRangeIterator<SetRangeWithCardinality<NodeSet>> set_it(
+      mem_.SetWithRank(card, begin_rank));
+  // The sets are stored in the order of their ranks, so their offsets are
+  // consecutive multiples of card.
+  uint64 set_offset = mem_.BaseOffset(card, *set_it);
+  for (uint64 rank = begin_rank; rank < end_rank;
+       ++rank, ++set_it, set_offset += card) {
+    const NodeSet set = *set_it;
+    DCHECK_EQ(set_offset, mem_.BaseOffset(card, set));
+    // The first subset on which we'll iterate is set.RemoveSmallestElement().
+    // Compute its offset. It will be updated incrementaly. This saves about
+    // 30-35% of computation time.
+    uint64 subset_offset = mem_.BaseOffset(card - 1,
+                                           set.RemoveSmallestElement());
+    int num_set_nodes = 0;
+    for (int node : set) nodes[num_set_nodes++] = node;
+    int prev_dest = nodes[0];
+    for (int dest_rank = 0; dest_rank < card; ++dest_rank) {
+      const int dest = nodes[dest_rank];
+      // We compute the offset for subset from the preceding iteration
+      // by taking into account that prev_dest is now in subset, and
+      // that dest is now removed from subset.
+      subset_offset += mem_.OffsetDelta(card - 1, prev_dest, dest, dest_rank);
+      // The sources are the nodes of set but dest. The ones before dest keep
+      // their rank in subset, the ones after it lose one rank. Splitting the
+      // loop in two keeps both branch-free, so that they can be vectorized.
+      const CostType* const incoming = &incoming_costs_[dest * num_nodes_];
+      CostType min_cost = std::numeric_limits<CostType>::max();
+      for (int src_rank = 0; src_rank < dest_rank; ++src_rank) {
+        const CostType value = mem_.ValueAtOffset(subset_offset + src_rank);
+        min_cost = std::min(min_cost,
+                            SaturatedAdd(incoming[nodes[src_rank]], value));
+      }
+      for (int src_rank = dest_rank; src_rank < card - 1; ++src_rank) {
+        const CostType value = mem_.ValueAtOffset(subset_offset + src_rank);
+        min_cost = std::min(min_cost,
+                            SaturatedAdd(incoming[nodes[src_rank + 1]], value));
+      }
+      prev_dest = dest;
+      mem_.SetValueAtOffset(set_offset + dest_rank, min_cost);
+    }
+  }
+}
+
 template <typename CostType>
 std::vector<int> HamiltonianPathSolver<CostType>::ComputePath(
     CostType cost, NodeSet set, int end_node) {
@@ -58,6 +58,12 @@
 //    ...
 //  }
 //
+// The static graphs from graph.h can also be used, e.g. StaticGraph<> or
+// ReverseArcStaticGraph<> with int32 indices. They are built once all the arcs
+// are added, and since Build() may permute the arcs, the costs must be set
+// afterwards on the permuted arc indices. Their per-arc memory is about half
+// the one of ForwardStarGraph, and the outgoing arcs of a node are contiguous.
+//
 // In the following, we consider a bipartite graph
 //   G = (V = X union Y, E subset XxY),
 // where V denodes the set of nodes (vertices) in the graph, E denotes
@@ -166,6 +172,10 @@
 // Theory, Algorithms, and Applications," Prentice Hall, 1993,
 // ISBN: 978-0136175490, http://www.amazon.com/dp/013617549X
 //
+// [ Bertsekas and Castanon ] D. P. Bertsekas, D. A. Castanon, "Parallel
+// Synchronous and Asynchronous Implementations of the Auction Algorithm,"
+// Parallel Computing, Vol. 17, pages 707-732, 1991.
+//
 // Keywords: linear sum assignment problem, Hungarian method, Goldberg, Kennedy.
 
 #ifndef OR_TOOLS_GRAPH_LINEAR_ASSIGNMENT_H_
@@ -180,12 +190,16 @@
 #include <utility>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/stringprintf.h"
+#include "base/threadpool.h"
 #include "graph/ebert_graph.h"
+#include "graph/graph.h"
+#include "graph/graphs.h"
 #include "util/permutation.h"
 
 #ifndef SWIG
@@ -225,6 +239,20 @@ class LinearSumAssignment {
   // divide the scaling parameter on each iteration.
   void SetCostScalingDivisor(CostValue factor) { alpha_ = factor; }
 
+  // Sets the number of threads used by ComputeAssignment(), 1 by
+  // default. With more than one thread, each scaling iteration starts
+  // with synchronous (Jacobi) auction rounds [ Bertsekas and Castanon ]:
+  // all the active left-side nodes compute their best arc in parallel
+  // against the same prices, then the bids are resolved, the lowest
+  // price winning each right-side node. When there are too few active
+  // nodes for this to pay off, the iteration ends with the usual
+  // sequential (Gauss-Seidel) double pushes. The resulting assignment is
+  // optimal but may differ from the single-threaded one.
+  void SetNumThreads(int num_threads) {
+    CHECK_GE(num_threads, 1);
+    num_threads_ = num_threads;
+  }
+
   // Returns a permutation cycle handler that can be passed to the
   // TransformToForwardStaticGraph method so that arc costs get
   // permuted along with arcs themselves.
@@ -331,23 +359,25 @@ class LinearSumAssignment {
   class BipartiteLeftNodeIterator {
    public:
     BipartiteLeftNodeIterator(const GraphType& graph, NodeIndex num_left_nodes)
-        : num_left_nodes_(num_left_nodes), node_iterator_(graph) {}
+        : end_(std::min<NodeIndex>(graph.num_nodes(), num_left_nodes)),
+          node_(0) {}
 
     explicit BipartiteLeftNodeIterator(const LinearSumAssignment& assignment)
-        : num_left_nodes_(assignment.NumLeftNodes()),
-          node_iterator_(assignment.Graph()) {}
+        : end_(std::min<NodeIndex>(assignment.Graph().num_nodes(),
+                                   assignment.NumLeftNodes())),
+          node_(0) {}
 
-    NodeIndex Index() const { return node_iterator_.Index(); }
+    NodeIndex Index() const { return node_; }
 
-    bool Ok() const {
-      return node_iterator_.Ok() && (node_iterator_.Index() < num_left_nodes_);
-    }
+    bool Ok() const { return node_ < end_; }
 
-    void Next() { node_iterator_.Next(); }
+    void Next() { ++node_; }
 
    private:
-    const NodeIndex num_left_nodes_;
-    typename GraphType::NodeIterator node_iterator_;
+    // Both the StarGraph family and the graph.h graphs number their nodes
+    // from 0 to num_nodes() - 1, the left nodes coming first.
+    const NodeIndex end_;
+    NodeIndex node_;
   };
 
  private:
@@ -495,6 +525,15 @@ class LinearSumAssignment {
   // deficit is cancelled with the first push.
   bool DoublePush(NodeIndex source);
 
+  // Does one synchronous auction round with all the active nodes, see
+  // SetNumThreads(), and sets *num_won_bids to the number of bids that won
+  // their right-side node. Returns false if infeasibility is detected.
+  bool ParallelBidRound(NodeIndex* num_won_bids);
+
+  // Computes the bids of the given chunk of bidders_, for
+  // ParallelBidRound().
+  void ComputeBids(int chunk);
+
   // Returns the partial reduced cost of the given arc.
   inline CostValue PartialReducedCost(ArcIndex arc) const {
     return scaled_arc_cost_[arc] - price_[Head(arc)];
@@ -917,6 +956,13 @@ class LinearSumAssignment {
   // for experimentation.
   std::unique_ptr<ActiveNodeContainerInterface> active_nodes_;
 
+  // The number of threads, and for ParallelBidRound() the active nodes
+  // bidding in the current round and their bids, as pairs (best arc,
+  // price offered for its head).
+  int num_threads_;
+  std::vector<NodeIndex> bidders_;
+  std::vector<ImplicitPriceSummary> bids_;
+
   // Statistics giving the overall numbers of various operations the
   // algorithm performs.
   Stats total_stats_;
@@ -947,15 +993,16 @@ LinearSumAssignment<GraphType>::LinearSumAssignment(
       slack_relabeling_price_(0),
       largest_scaled_cost_magnitude_(0),
       total_excess_(0),
-      price_(num_left_nodes + GraphType::kFirstNode, 2 * num_left_nodes - 1),
-      matched_arc_(GraphType::kFirstNode, num_left_nodes - 1),
+      price_(num_left_nodes, 2 * num_left_nodes - 1),
+      matched_arc_(0, num_left_nodes - 1),
       matched_node_(num_left_nodes, 2 * num_left_nodes - 1),
-      scaled_arc_cost_(GraphType::kFirstArc, graph.max_end_arc_index() - 1),
+      scaled_arc_cost_(0, Graphs<GraphType>::ArcReservation(graph) - 1),
       active_nodes_(FLAGS_assignment_stack_order
                         ? static_cast<ActiveNodeContainerInterface*>(
                               new ActiveNodeStack())
                         : static_cast<ActiveNodeContainerInterface*>(
-                              new ActiveNodeQueue())) {}
+                              new ActiveNodeQueue())),
+      num_threads_(1) {}
 
 template <typename GraphType>
 LinearSumAssignment<GraphType>::LinearSumAssignment(
@@ -970,21 +1017,20 @@ LinearSumAssignment<GraphType>::LinearSumAssignment(
       slack_relabeling_price_(0),
       largest_scaled_cost_magnitude_(0),
       total_excess_(0),
-      price_(num_left_nodes + GraphType::kFirstNode, 2 * num_left_nodes - 1),
-      matched_arc_(GraphType::kFirstNode,
-                   GraphType::kFirstNode + num_left_nodes - 1),
+      price_(num_left_nodes, 2 * num_left_nodes - 1),
+      matched_arc_(0, num_left_nodes - 1),
       matched_node_(num_left_nodes, 2 * num_left_nodes - 1),
-      scaled_arc_cost_(GraphType::kFirstArc,
-                       GraphType::kFirstArc + num_arcs - 1),
+      scaled_arc_cost_(0, num_arcs - 1),
       active_nodes_(FLAGS_assignment_stack_order
                         ? static_cast<ActiveNodeContainerInterface*>(
                               new ActiveNodeStack())
                         : static_cast<ActiveNodeContainerInterface*>(
-                              new ActiveNodeQueue())) {}
+                              new ActiveNodeQueue())),
+      num_threads_(1) {}
 
 template <typename GraphType>
 void LinearSumAssignment<GraphType>::SetArcCost(ArcIndex arc, CostValue cost) {
-  DCHECK(graph_ == NULL || graph_->CheckArcValidity(arc));
+  DCHECK(graph_ == NULL || Graphs<GraphType>::IsArcValid(*graph_, arc));
   if (graph_ != NULL) {
     NodeIndex head = Head(arc);
     DCHECK_LE(num_left_nodes_, head);
@@ -1200,7 +1246,24 @@ template <typename GraphType>
 bool LinearSumAssignment<GraphType>::Refine() {
   SaturateNegativeArcs();
   InitializeActiveNodeContainer();
+  // A synchronous round is worth it when each thread has enough arcs to
+  // scan, the number of arcs of the active nodes being estimated from the
+  // average degree.
+  const int64 kMinArcsPerThread = 1 << 14;
+  const int64 average_degree =
+      std::max<int64>(1, graph_->num_arcs() / std::max(1, num_left_nodes_));
+  bool use_parallel_rounds = num_threads_ > 1;
   while (total_excess_ > 0) {
+    if (use_parallel_rounds &&
+        total_excess_ * average_degree >= kMinArcsPerThread * num_threads_) {
+      // Only the winners of a round make progress: when they are too few,
+      // the sequential double pushes are faster.
+      const NodeIndex num_bidders = total_excess_;
+      NodeIndex num_won_bids = 0;
+      if (!ParallelBidRound(&num_won_bids)) return false;
+      use_parallel_rounds = num_won_bids * num_threads_ >= num_bidders;
+      continue;
+    }
     // Get an active node (i.e., one with excess == 1) and discharge
     // it using DoublePush.
     const NodeIndex node = active_nodes_->Get();
@@ -1214,6 +1277,68 @@ bool LinearSumAssignment<GraphType>::Refine() {
   return true;
 }
 
+template <typename GraphType>
+bool LinearSumAssignment<GraphType>::ParallelBidRound(
+    NodeIndex* num_won_bids) {
+  bidders_.clear();
+  while (!active_nodes_->Empty()) bidders_.push_back(active_nodes_->Get());
+  bids_.resize(bidders_.size());
+  {
+    ThreadPool pool("LinearSumAssignment", num_threads_);
+    for (int chunk = 0; chunk < num_threads_; ++chunk) {
+      pool.Add(NewCallback(this, &LinearSumAssignment::ComputeBids, chunk));
+    }
+    pool.StartWorkers();
+  }
+  // The bids were computed against the prices of the beginning of the
+  // round, so each right-side node goes to its lowest bid, and the
+  // winner still satisfies epsilon-optimality: the other prices could
+  // only decrease meanwhile, which makes the other arcs less attractive.
+  for (int i = 0; i < bidders_.size(); ++i) {
+    const NodeIndex bidder = bidders_[i];
+    const ArcIndex best_arc = bids_[i].first;
+    const CostValue new_price = bids_[i].second;
+    if (best_arc == GraphType::kNilArc) return false;
+    const NodeIndex new_mate = Head(best_arc);
+    if (new_price >= price_[new_mate]) {
+      // Outbid by an earlier bidder of this round.
+      active_nodes_->Add(bidder);
+      continue;
+    }
+    const NodeIndex to_unmatch = matched_node_[new_mate];
+    if (to_unmatch != GraphType::kNilNode) {
+      matched_arc_.Set(to_unmatch, GraphType::kNilArc);
+      active_nodes_->Add(to_unmatch);
+      iteration_stats_.double_pushes_ += 1;
+    } else {
+      total_excess_ -= 1;
+      iteration_stats_.pushes_ += 1;
+    }
+    matched_arc_.Set(bidder, best_arc);
+    matched_node_.Set(new_mate, bidder);
+    iteration_stats_.relabelings_ += 1;
+    price_.Set(new_mate, new_price);
+    ++*num_won_bids;
+    if (new_price < price_lower_bound_) return false;
+  }
+  return true;
+}
+
+template <typename GraphType>
+void LinearSumAssignment<GraphType>::ComputeBids(int chunk) {
+  const int num_bidders = bidders_.size();
+  const int begin = static_cast<int64>(num_bidders) * chunk / num_threads_;
+  const int end = static_cast<int64>(num_bidders) * (chunk + 1) / num_threads_;
+  for (int i = begin; i < end; ++i) {
+    const ImplicitPriceSummary summary = BestArcAndGap(bidders_[i]);
+    const ArcIndex best_arc = summary.first;
+    bids_[i].first = best_arc;
+    if (best_arc != GraphType::kNilArc) {
+      bids_[i].second = price_[Head(best_arc)] - summary.second - epsilon_;
+    }
+  }
+}
+
 // Computes best_arc, the minimum reduced-cost arc incident to
 // left_node and admissibility_gap, the amount by which the reduced
 // cost of best_arc must be increased to make it equal in reduced cost
@@ -1305,9 +1430,9 @@ inline CostValue LinearSumAssignment<GraphType>::ImplicitPrice(
 // Only for debugging.
 template <typename GraphType>
 bool LinearSumAssignment<GraphType>::AllMatched() const {
-  for (typename GraphType::NodeIterator node_it(*graph_); node_it.Ok();
-       node_it.Next()) {
-    if (IsActiveForDebugging(node_it.Index())) {
+  const NodeIndex num_nodes = graph_->num_nodes();
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    if (IsActiveForDebugging(node)) {
       return false;
     }
   }
@@ -1361,9 +1486,9 @@ bool LinearSumAssignment<GraphType>::FinalizeSetup() {
           << largest_scaled_cost_magnitude_ / cost_scaling_factor_;
   // Initialize left-side node-indexed arrays and check incidence
   // precondition.
-  typename GraphType::NodeIterator node_it(*graph_);
-  for (; node_it.Ok(); node_it.Next()) {
-    const NodeIndex node = node_it.Index();
+  const NodeIndex num_nodes = graph_->num_nodes();
+  NodeIndex node = 0;
+  for (; node < num_nodes; ++node) {
     if (node >= num_left_nodes_) {
       break;
     }
@@ -1375,8 +1500,7 @@ bool LinearSumAssignment<GraphType>::FinalizeSetup() {
   }
   // Initialize right-side node-indexed arrays. Example: prices are
   // stored only for right-side nodes.
-  for (; node_it.Ok(); node_it.Next()) {
-    const NodeIndex node = node_it.Index();
+  for (; node < num_nodes; ++node) {
     price_.Set(node, 0);
     matched_node_.Set(node, GraphType::kNilNode);
   }
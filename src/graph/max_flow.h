@@ -131,8 +131,10 @@
 namespace operations_research {
 
 // Forward declaration.
-template <typename Graph>
+template <typename Graph, typename ArcFlowType = FlowQuantity>
 class GenericMaxFlow;
+template <typename Graph, typename ArcFlowType>
+class ParallelPushRelabel;
 
 // A simple and efficient max-cost flow interface. This is as fast as
 // GenericMaxFlow<ReverseArcStaticGraph>, which is the fastest, but uses
@@ -297,7 +299,13 @@ class MaxFlowStatusClass {
 // Generic MaxFlow (there is a default MaxFlow specialization defined below)
 // that works with StarGraph and all the reverse arc graphs from graph.h, see
 // the end of max_flow.cc for the exact types this class is compiled for.
-template <typename Graph>
+//
+// As for GenericMinCostFlow, memory usage can be greatly decreased on large
+// networks by using small integer types: the NodeIndexType and ArcIndexType of
+// the graph.h graphs, and ArcFlowType for the *per-arc* residual capacities. It
+// must be signed and large enough to hold the maximum arc capacity. Excesses
+// and the optimal flow value are aggregated values and always use FlowQuantity.
+template <typename Graph, typename ArcFlowType>
 class GenericMaxFlow : public MaxFlowStatusClass {
  public:
   typedef typename Graph::NodeIndex NodeIndex;
@@ -342,6 +350,21 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   // Returns true if a maximum flow was solved.
   bool Solve();
 
+  // Same as Solve(), but starts from the maximum flow of the last successful
+  // Solve() or Resolve() instead of the zero flow, so that solving a sequence
+  // of related problems costs close to one Solve() instead of one per problem.
+  //
+  // This is only possible if the SetArcCapacity() calls made since then kept
+  // this flow a valid preflow: any capacity can be increased, and the arcs
+  // entering the sink can be decreased below their current flow (the excess
+  // is then put back on their tail). The other decreases are fine as long as
+  // they don't go below the current flow of the arc. This covers the
+  // parametric setting of Gallo, Grigoriadis and Tarjan, where the capacities
+  // of the arcs leaving the source are non-decreasing and the ones of the arcs
+  // entering the sink are non-increasing. Otherwise, or after SetArcFlow(),
+  // this is the same as Solve().
+  bool Resolve();
+
   // Returns the total flow found by the algorithm.
   FlowQuantity GetOptimalFlow() const { return node_excess_[sink_]; }
 
@@ -407,6 +430,16 @@ class GenericMaxFlow : public MaxFlowStatusClass {
     process_node_by_height_ = value && use_global_update_;
   }
 
+  // Sets the number of threads used by Solve(), 1 by default. With more than
+  // one thread, the maximum preflow is computed by a lock-free parallel
+  // version of the algorithm, see ParallelRefine(), and the other options
+  // above are ignored: it always uses global updates and the two-phase
+  // algorithm.
+  void SetNumThreads(int num_threads) {
+    CHECK_GE(num_threads, 1);
+    num_threads_ = num_threads;
+  }
+
   // Returns the protocol buffer representation of the current problem.
   FlowModel CreateFlowModel();
 
@@ -471,6 +504,15 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   void Refine();
   void RefineWithGlobalUpdate();
 
+  // Parallel version of RefineWithGlobalUpdate(), used when num_threads_ > 1.
+  // The threads concurrently discharge the active nodes as in:
+  // B. Hong, "A lock-free multi-threaded algorithm for the maximum flow
+  // problem", IEEE IPDPS (MTAAP workshop), 2008.
+  // with atomic updates of the excesses and of the residual capacities. The
+  // global updates are done by a parallel level-synchronous BFS. See
+  // ParallelPushRelabel in max_flow.cc.
+  void ParallelRefine();
+
   // Discharges an active node node by saturating its admissible adjacent arcs,
   // if any, and by relabelling it when it becomes inactive.
   void Discharge(NodeIndex node);
@@ -478,6 +520,13 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   // Initializes the preflow to a state that enables to run Refine.
   void InitializePreflow();
 
+  // Resets the node heights and admissible arcs as InitializePreflow() does,
+  // but keeps the current preflow.
+  void InitializeNodePotentials();
+
+  // The common code of Solve() and Resolve().
+  bool SolveInternal(bool keep_current_flow);
+
   // Clears the flow excess at each node by pushing the flow back to the source:
   // - Do a depth-first search from the source in the direct graph to cancel
   //   flow cycles.
@@ -563,7 +612,7 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   // Using these facts enables one to only maintain residual_arc_capacity_,
   // instead of both capacity and flow, for each direct and indirect arc. This
   // reduces the amount of memory for this information by a factor 2.
-  QuantityArray residual_arc_capacity_;
+  ZVector<ArcFlowType> residual_arc_capacity_;
 
   // An array representing the first admissible arc for each node in graph_.
   ArcIndexArray first_admissible_arc_;
@@ -590,6 +639,14 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   // The status of the problem.
   Status status_;
 
+  // Whether the current arc flows and node excesses form a valid preflow that
+  // Resolve() can start from.
+  bool is_preflow_valid_;
+
+  // Whether some nodes other than the source and sink may have a positive
+  // excess before the next refinement, see SaturateOutgoingArcsFromSource().
+  bool has_initial_excess_;
+
   // BFS queue used by the GlobalUpdate() function. We do not use a C++ queue
   // because we need access to the vector for different optimizations.
   std::vector<bool> node_in_bfs_queue_;
@@ -622,10 +679,15 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   // TODO(user): Make the check more exhaustive by checking the optimality?
   bool check_result_;
 
+  // The number of threads used by Solve(), see SetNumThreads().
+  int num_threads_;
+
   // Statistics about this class.
   mutable StatsGroup stats_;
 
  private:
+  friend class ParallelPushRelabel<Graph, ArcFlowType>;
+
   DISALLOW_COPY_AND_ASSIGN(GenericMaxFlow);
 };
 
@@ -16,13 +16,18 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
 
 #include "base/commandlineflags.h"
 #include "base/stringprintf.h"
 #include "base/mathutil.h"
 #include "graph/graphs.h"
 #include "graph/max_flow.h"
+#include "graph/network_simplex.h"
 
 // TODO(user): Remove these flags and expose the parameters in the API.
 // New clients, please do not use these flags!
@@ -63,7 +68,8 @@ GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::GenericMinCostFlow(
       stats_("MinCostFlow"),
       feasibility_checked_(false),
       use_price_update_(false),
-      check_feasibility_(FLAGS_min_cost_flow_check_feasibility) {
+      check_feasibility_(FLAGS_min_cost_flow_check_feasibility),
+      can_warm_start_(false) {
   const NodeIndex max_num_nodes = Graphs<Graph>::NodeReservation(*graph_);
   if (max_num_nodes > 0) {
     node_excess_.Reserve(0, max_num_nodes - 1);
@@ -90,7 +96,8 @@ template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
 void GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::SetNodeSupply(
     NodeIndex node, FlowQuantity supply) {
   DCHECK(graph_->IsNodeValid(node));
-  node_excess_.Set(node, supply);
+  node_excess_.Set(node,
+                   node_excess_[node] + supply - initial_node_excess_[node]);
   initial_node_excess_.Set(node, supply);
   status_ = NOT_SOLVED;
   feasibility_checked_ = false;
@@ -485,7 +492,20 @@ GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::GetFirstIncidentArc(
 
 template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
 bool GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::Solve() {
+  return SolveInternal(/*warm_start=*/false);
+}
+
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+bool GenericMinCostFlow<Graph, ArcFlowType,
+                        ArcScaledCostType>::IncrementalSolve() {
+  return SolveInternal(/*warm_start=*/can_warm_start_);
+}
+
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+bool GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::SolveInternal(
+    bool warm_start) {
   status_ = NOT_SOLVED;
+  can_warm_start_ = false;
   if (FLAGS_min_cost_flow_check_balance && !CheckInputConsistency()) {
     status_ = UNBALANCED;
     return false;
@@ -498,10 +518,15 @@ bool GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::Solve() {
     status_ = INFEASIBLE;
     return false;
   }
-  node_potential_.SetAll(0);
+  if (!warm_start) node_potential_.SetAll(0);
   ResetFirstAdmissibleArcs();
   ScaleCosts();
-  Optimize();
+  if (warm_start) {
+    epsilon_ = 1;
+    RepairFlow();
+  } else {
+    Optimize();
+  }
   if (FLAGS_min_cost_flow_check_result && !CheckResult()) {
     status_ = BAD_RESULT;
     UnscaleCosts();
@@ -519,6 +544,7 @@ bool GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::Solve() {
     total_flow_cost_ += scaled_arc_unit_cost_[arc] * flow_on_arc;
   }
   status_ = OPTIMAL;
+  can_warm_start_ = true;
   IF_STATS_ENABLED(VLOG(1) << stats_.StatString());
   return true;
 }
@@ -574,6 +600,116 @@ void GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::Optimize() {
   }
 }
 
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+void GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::RepairFlow() {
+  SCOPED_TIME_STAT(&stats_);
+  const NodeIndex num_nodes = graph_->num_nodes();
+  std::vector<NodeIndex> sources;
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    for (IncidentArcIterator it(*graph_, node); it.Ok(); it.Next()) {
+      const ArcIndex arc = it.Index();
+      if (residual_arc_capacity_[arc] > 0 && ReducedCost(arc) < -epsilon_) {
+        PushFlow(residual_arc_capacity_[arc], arc);
+      }
+    }
+  }
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    if (node_excess_[node] > 0) sources.push_back(node);
+  }
+
+  // The Dijkstra data. Only the entries of the settled or reached nodes are
+  // reset after each search.
+  const CostValue kInfiniteDistance = std::numeric_limits<CostValue>::max();
+  std::vector<CostValue> distance(num_nodes, kInfiniteDistance);
+  std::vector<ArcIndex> parent_arc(num_nodes, Graph::kNilArc);
+  std::vector<bool> settled(num_nodes, false);
+  std::vector<NodeIndex> settled_nodes;
+  std::vector<NodeIndex> reached_nodes;
+  typedef std::pair<CostValue, NodeIndex> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry>> queue;
+  while (true) {
+    int num_sources = 0;
+    for (const NodeIndex source : sources) {
+      if (node_excess_[source] == 0) continue;
+      sources[num_sources++] = source;
+      distance[source] = 0;
+      reached_nodes.push_back(source);
+      queue.push(QueueEntry(0, source));
+    }
+    sources.resize(num_sources);
+    if (sources.empty()) break;
+
+    NodeIndex target = Graph::kNilNode;
+    while (!queue.empty()) {
+      const NodeIndex node = queue.top().second;
+      queue.pop();
+      if (settled[node]) continue;
+      settled[node] = true;
+      settled_nodes.push_back(node);
+      if (node_excess_[node] < 0) {
+        target = node;
+        break;
+      }
+      const CostValue node_distance = distance[node];
+      const CostValue tail_potential = node_potential_[node];
+      for (IncidentArcIterator it(*graph_, node); it.Ok(); it.Next()) {
+        const ArcIndex arc = it.Index();
+        if (residual_arc_capacity_[arc] == 0) continue;
+        const NodeIndex head = Head(arc);
+        const CostValue length =
+            FastReducedCost(arc, tail_potential) + epsilon_;
+        DCHECK_GE(length, 0);
+        if (node_distance + length < distance[head]) {
+          if (distance[head] == kInfiniteDistance) {
+            reached_nodes.push_back(head);
+          }
+          distance[head] = node_distance + length;
+          parent_arc[head] = arc;
+          queue.push(QueueEntry(distance[head], head));
+        }
+      }
+    }
+    if (target == Graph::kNilNode) {
+      status_ = INFEASIBLE;
+      return;
+    }
+
+    // Lowering the potential of each settled node by the distance of the
+    // target minus its own distance keeps ReducedCost(arc) >= -epsilon_ on
+    // all the arcs of the residual graph, with an equality on the path.
+    const CostValue target_distance = distance[target];
+    for (const NodeIndex node : settled_nodes) {
+      node_potential_[node] += distance[node] - target_distance;
+    }
+    FlowQuantity flow = -node_excess_[target];
+    NodeIndex node = target;
+    for (; parent_arc[node] != Graph::kNilArc; node = Tail(parent_arc[node])) {
+      flow = std::min(
+          flow,
+          static_cast<FlowQuantity>(residual_arc_capacity_[parent_arc[node]]));
+    }
+    flow = std::min(flow, node_excess_[node]);
+    for (node = target; parent_arc[node] != Graph::kNilArc;
+         node = Tail(parent_arc[node])) {
+      PushFlow(flow, parent_arc[node]);
+    }
+
+    for (const NodeIndex node : reached_nodes) {
+      distance[node] = kInfiniteDistance;
+      parent_arc[node] = Graph::kNilArc;
+      settled[node] = false;
+    }
+    reached_nodes.clear();
+    settled_nodes.clear();
+    queue = std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                                std::greater<QueueEntry>>();
+  }
+  if (status_ == NOT_SOLVED) {
+    status_ = OPTIMAL;
+  }
+}
+
 template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
 void GenericMinCostFlow<Graph, ArcFlowType,
                         ArcScaledCostType>::SaturateAdmissibleArcs() {
@@ -975,8 +1111,11 @@ template class GenericMinCostFlow<ReverseArcStaticGraph<uint16, int32> >;
 template class GenericMinCostFlow<ReverseArcStaticGraph<uint16, int32>,
                                   /*ArcFlowType=*/int16,
                                   /*ArcScaledCostType=*/int32>;
+template class GenericMinCostFlow<ReverseArcStaticGraph<int32, int32>,
+                                  /*ArcFlowType=*/int32,
+                                  /*ArcScaledCostType=*/int64>;
 
-SimpleMinCostFlow::SimpleMinCostFlow() {}
+SimpleMinCostFlow::SimpleMinCostFlow() : algorithm_(COST_SCALING) {}
 
 void SimpleMinCostFlow::SetNodeSupply(NodeIndex node, FlowQuantity supply) {
   ResizeNodeVectors(node);
@@ -1089,6 +1228,36 @@ SimpleMinCostFlow::Status SimpleMinCostFlow::SolveWithPossibleAdjustment(
     return INFEASIBLE;
   }
 
+  if (algorithm_ == NETWORK_SIMPLEX) {
+    // The network simplex works on the original arc indices, with the arcs
+    // from the source and to the sink added after them.
+    NetworkSimplexMinCostFlow network_simplex;
+    for (ArcIndex arc = 0; arc < num_arcs; ++arc) {
+      network_simplex.AddArcWithCapacityAndUnitCost(
+          arc_tail_[arc], arc_head_[arc], arc_capacity_[arc], arc_cost_[arc]);
+    }
+    for (NodeIndex node = 0; node < num_nodes; ++node) {
+      if (node_supply_[node] > 0) {
+        network_simplex.AddArcWithCapacityAndUnitCost(source, node,
+                                                      node_supply_[node], 0);
+      } else if (node_supply_[node] < 0) {
+        network_simplex.AddArcWithCapacityAndUnitCost(node, sink,
+                                                      -node_supply_[node], 0);
+      }
+    }
+    network_simplex.SetNodeSupply(source, maximum_flow_);
+    network_simplex.SetNodeSupply(sink, -maximum_flow_);
+    const Status status = network_simplex.Solve();
+    if (status == OPTIMAL) {
+      optimal_cost_ = network_simplex.OptimalCost();
+      arc_flow_.resize(num_arcs);
+      for (ArcIndex arc = 0; arc < num_arcs; ++arc) {
+        arc_flow_[arc] = network_simplex.Flow(arc);
+      }
+    }
+    return status;
+  }
+
   GenericMinCostFlow<Graph> min_cost_flow(&graph);
   ArcIndex arc;
   for (arc = 0; arc < num_arcs; ++arc) {
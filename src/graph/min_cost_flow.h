@@ -210,7 +210,7 @@ class MinCostFlowBase {
 //
 // TODO(user): If the need arises, extend this interface to support warm start
 // and incrementality between solves. Note that this is already supported by the
-// GenericMinCostFlow<> interface.
+// GenericMinCostFlow<> interface, see GenericMinCostFlow::IncrementalSolve().
 class SimpleMinCostFlow : public MinCostFlowBase {
  public:
   // The constructor takes no size. New node indices will be created lazily by
@@ -233,6 +233,18 @@ class SimpleMinCostFlow : public MinCostFlowBase {
   // is modeled as a negative supply.
   void SetNodeSupply(NodeIndex node, FlowQuantity supply);
 
+  // The algorithm used by Solve() and SolveMaxFlowWithMinCost() once the
+  // feasibility is checked: the cost-scaling push-relabel algorithm of
+  // GenericMinCostFlow (the default), or the network simplex algorithm of
+  // NetworkSimplexMinCostFlow, see ./network_simplex.h. Both give an optimal
+  // flow of the same cost, but which one is faster depends on the problem:
+  // the network simplex is often faster on sparse problems with small costs.
+  enum Algorithm {
+    COST_SCALING,
+    NETWORK_SIMPLEX
+  };
+  void SetAlgorithm(Algorithm algorithm) { algorithm_ = algorithm; }
+
   // Solves the problem, and returns the problem status. This function
   // requires that the sum of all node supply minus node demand is zero and
   // that the graph has enough capacity to send all supplies and serve all
@@ -299,6 +311,7 @@ class SimpleMinCostFlow : public MinCostFlowBase {
   std::vector<FlowQuantity> arc_flow_;
   CostValue optimal_cost_;
   FlowQuantity maximum_flow_;
+  Algorithm algorithm_;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleMinCostFlow);
 };
@@ -345,7 +358,8 @@ class GenericMinCostFlow : public MinCostFlowBase {
   Status status() const { return status_; }
 
   // Sets the supply corresponding to node. A demand is modeled as a negative
-  // supply.
+  // supply. The current flow is kept: the excess of node changes by the
+  // difference between the new and the old supply.
   void SetNodeSupply(NodeIndex node, FlowQuantity supply);
 
   // Sets the unit cost for the given arc.
@@ -361,6 +375,17 @@ class GenericMinCostFlow : public MinCostFlowBase {
   // Solves the problem, returning true if a min-cost flow could be found.
   bool Solve();
 
+  // Same as Solve(), but warm-starts from the flow and the node potentials
+  // left by the last successful Solve() or IncrementalSolve(). After a few
+  // calls to SetNodeSupply(), SetArcCapacity() or SetArcUnitCost(), the last
+  // flow is only wrong around the modified nodes and arcs, so instead of the
+  // whole cost scaling, the flow is repaired locally by RepairFlow(). This is
+  // usually orders of magnitude faster than Solve() on large problems, as long
+  // as SetCheckFeasibility(false) is used: the feasibility check solves a
+  // max-flow on the whole graph. The graph must not have changed. Without a
+  // previous successful solve, this is the same as Solve().
+  bool IncrementalSolve();
+
   // Checks for feasibility, i.e., that all the supplies and demands can be
   // matched without exceeding bottlenecks in the network.
   // If infeasible_supply_node (resp. infeasible_demand_node) are not NULL,
@@ -417,6 +442,9 @@ class GenericMinCostFlow : public MinCostFlowBase {
   void SetCheckFeasibility(bool value) { check_feasibility_ = value; }
 
  private:
+  // Implementation of Solve() and IncrementalSolve().
+  bool SolveInternal(bool warm_start);
+
   // Returns true if the given arc is admissible i.e. if its residual capacity
   // is strictly positive, and its reduced cost strictly negative, i.e., pushing
   // more flow into it will result in a reduction of the total cost.
@@ -470,6 +498,19 @@ class GenericMinCostFlow : public MinCostFlowBase {
   // Optimizes the cost by dividing epsilon_ by alpha_ and calling Refine().
   void Optimize();
 
+  // Used by IncrementalSolve() instead of Optimize(), with epsilon_ = 1 and
+  // the potentials of the last solve, for which the flow was epsilon-optimal
+  // before the problem was modified. Saturates the arcs that are no longer
+  // epsilon-optimal, then sends the excesses to the nodes with a negative
+  // excess along shortest paths in the residual graph, for the arc lengths
+  // ReducedCost(arc) + epsilon_ >= 0. Each path is found by a Dijkstra from
+  // all the nodes with a positive excess, which stops at the first node with
+  // a negative excess and only updates the potentials of the nodes it
+  // settled, so that the flow stays epsilon-optimal. The costs being scaled
+  // by more than the number of arcs on a path, these paths have a minimum
+  // unscaled cost.
+  void RepairFlow();
+
   // Saturates the admissible arcs, i.e., push as much flow as possible.
   void SaturateAdmissibleArcs();
 
@@ -602,6 +643,10 @@ class GenericMinCostFlow : public MinCostFlowBase {
   // Whether to check the problem feasibility with a max-flow.
   bool check_feasibility_;
 
+  // Whether the flow and the node potentials are the ones of a successful
+  // solve, from which IncrementalSolve() can start.
+  bool can_warm_start_;
+
   DISALLOW_COPY_AND_ASSIGN(GenericMinCostFlow);
 };
 
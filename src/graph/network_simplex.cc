@@ -0,0 +1,347 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "graph/network_simplex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "base/logging.h"
+
+namespace operations_research {
+
+NetworkSimplexMinCostFlow::NetworkSimplexMinCostFlow()
+    : num_arcs_(0),
+      block_size_(0),
+      next_arc_(0),
+      has_basis_(false),
+      num_pivots_(0),
+      optimal_cost_(0) {}
+
+ArcIndex NetworkSimplexMinCostFlow::AddArcWithCapacityAndUnitCost(
+    NodeIndex tail, NodeIndex head, FlowQuantity capacity,
+    CostValue unit_cost) {
+  CHECK_GE(tail, 0);
+  CHECK_GE(head, 0);
+  CHECK_GE(capacity, 0);
+  const NodeIndex largest_node = std::max(tail, head);
+  if (largest_node >= NumNodes()) supply_.resize(largest_node + 1, 0);
+  // Drops the artificial arcs of the previous Solve(), if any.
+  tail_.resize(num_arcs_);
+  head_.resize(num_arcs_);
+  capacity_.resize(num_arcs_);
+  cost_.resize(num_arcs_);
+  tail_.push_back(tail);
+  head_.push_back(head);
+  capacity_.push_back(capacity);
+  cost_.push_back(unit_cost);
+  has_basis_ = false;
+  return num_arcs_++;
+}
+
+void NetworkSimplexMinCostFlow::SetNodeSupply(NodeIndex node,
+                                              FlowQuantity supply) {
+  CHECK_GE(node, 0);
+  if (node >= NumNodes()) supply_.resize(node + 1, 0);
+  if (supply_[node] != supply) has_basis_ = false;
+  supply_[node] = supply;
+}
+
+void NetworkSimplexMinCostFlow::SetArcUnitCost(ArcIndex arc,
+                                               CostValue unit_cost) {
+  DCHECK_GE(arc, 0);
+  DCHECK_LT(arc, num_arcs_);
+  cost_[arc] = unit_cost;
+}
+
+NetworkSimplexMinCostFlow::Status NetworkSimplexMinCostFlow::Solve() {
+  optimal_cost_ = 0;
+  num_pivots_ = 0;
+  const NodeIndex num_nodes = NumNodes();
+  FlowQuantity total_supply = 0;
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    total_supply += supply_[node];
+  }
+  if (total_supply != 0) {
+    has_basis_ = false;
+    return UNBALANCED;
+  }
+
+  // The cost of the artificial arcs must be larger than the cost of any path
+  // made of user arcs, so that no optimal basis uses them if the problem is
+  // feasible. The reduced costs are then bounded by a few times this cost.
+  CostValue max_cost = 0;
+  for (ArcIndex arc = 0; arc < num_arcs_; ++arc) {
+    max_cost = std::max(max_cost, std::abs(cost_[arc]));
+  }
+  const CostValue kMaxCost = std::numeric_limits<CostValue>::max() / 4;
+  if (max_cost >= kMaxCost / (num_nodes + 1) - 1) {
+    LOG(ERROR) << "Maximum cost magnitude " << max_cost << " is too high for "
+               << "the number of nodes. Try changing the data.";
+    has_basis_ = false;
+    return BAD_COST_RANGE;
+  }
+  const CostValue artificial_cost = (max_cost + 1) * (num_nodes + 1);
+
+  if (has_basis_) {
+    for (NodeIndex node = 0; node < num_nodes; ++node) {
+      cost_[num_arcs_ + node] = artificial_cost;
+    }
+    ComputePotentials();
+  } else {
+    InitializeBasis();
+    for (NodeIndex node = 0; node < num_nodes; ++node) {
+      cost_[num_arcs_ + node] = artificial_cost;
+      potential_[node] =
+          tail_[num_arcs_ + node] == node ? -artificial_cost : artificial_cost;
+    }
+    has_basis_ = true;
+  }
+
+  for (;;) {
+    const ArcIndex entering_arc = FindEnteringArc();
+    if (entering_arc < 0) break;
+    Pivot(entering_arc);
+    ++num_pivots_;
+  }
+  VLOG(1) << "Network simplex: " << num_pivots_ << " pivots.";
+
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    if (flow_[num_arcs_ + node] > 0) return INFEASIBLE;
+  }
+  for (ArcIndex arc = 0; arc < num_arcs_; ++arc) {
+    optimal_cost_ += cost_[arc] * flow_[arc];
+  }
+  return OPTIMAL;
+}
+
+void NetworkSimplexMinCostFlow::InitializeBasis() {
+  const NodeIndex num_nodes = NumNodes();
+  const NodeIndex root = num_nodes;
+  const ArcIndex total_num_arcs = num_arcs_ + num_nodes;
+  tail_.resize(num_arcs_);
+  head_.resize(num_arcs_);
+  capacity_.resize(num_arcs_);
+  cost_.resize(total_num_arcs, 0);
+  flow_.assign(total_num_arcs, 0);
+  state_.assign(total_num_arcs, STATE_LOWER);
+
+  parent_.assign(num_nodes + 1, root);
+  parent_arc_.assign(num_nodes + 1, -1);
+  depth_.assign(num_nodes + 1, 1);
+  first_child_.assign(num_nodes + 1, -1);
+  next_sibling_.assign(num_nodes + 1, -1);
+  previous_sibling_.assign(num_nodes + 1, -1);
+  potential_.assign(num_nodes + 1, 0);
+  depth_[root] = 0;
+
+  // Each node is linked to the root by an artificial arc carrying its supply.
+  // The arcs with no flow are oriented away from the root, which makes the
+  // basis strongly feasible.
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    const ArcIndex arc = num_arcs_ + node;
+    if (supply_[node] > 0) {
+      tail_.push_back(node);
+      head_.push_back(root);
+    } else {
+      tail_.push_back(root);
+      head_.push_back(node);
+    }
+    capacity_.push_back(std::numeric_limits<FlowQuantity>::max());
+    flow_[arc] = std::abs(supply_[node]);
+    state_[arc] = STATE_TREE;
+    parent_arc_[node] = arc;
+    AddChild(root, node);
+  }
+
+  block_size_ = std::max<ArcIndex>(
+      10, static_cast<ArcIndex>(std::sqrt(static_cast<double>(num_arcs_))));
+  next_arc_ = 0;
+}
+
+ArcIndex NetworkSimplexMinCostFlow::FindEnteringArc() {
+  // Only the user arcs are considered: an artificial arc that leaves the basis
+  // has no flow, and never needs to enter it again.
+  CostValue best_violation = 0;
+  ArcIndex best_arc = -1;
+  ArcIndex arc = next_arc_;
+  ArcIndex num_scanned_in_block = 0;
+  for (ArcIndex num_scanned = 0; num_scanned < num_arcs_; ++num_scanned) {
+    const CostValue violation = -state_[arc] * ReducedCost(arc);
+    if (violation > best_violation) {
+      best_violation = violation;
+      best_arc = arc;
+    }
+    if (++arc == num_arcs_) arc = 0;
+    if (++num_scanned_in_block == block_size_) {
+      if (best_arc >= 0) break;
+      num_scanned_in_block = 0;
+    }
+  }
+  next_arc_ = arc;
+  return best_arc;
+}
+
+void NetworkSimplexMinCostFlow::Pivot(ArcIndex entering_arc) {
+  // The flow goes around the cycle from 'first' to 'second' through the
+  // entering arc, then from 'second' up to the join node of the tree, then
+  // down to 'first'.
+  const bool increase = state_[entering_arc] == STATE_LOWER;
+  const NodeIndex first = increase ? tail_[entering_arc] : head_[entering_arc];
+  const NodeIndex second = increase ? head_[entering_arc] : tail_[entering_arc];
+  NodeIndex join_first = first;
+  NodeIndex join_second = second;
+  while (join_first != join_second) {
+    if (depth_[join_first] >= depth_[join_second]) {
+      join_first = parent_[join_first];
+    } else {
+      join_second = parent_[join_second];
+    }
+  }
+  const NodeIndex join = join_first;
+
+  // Finds the leaving arc with Cunningham's rule: the last arc with the
+  // smallest residual capacity when going around the cycle in the direction
+  // of the flow, starting from the join node. This keeps the tree strongly
+  // feasible. The leaving arc is identified by its child node in the tree,
+  // or by -1 for the entering arc.
+  FlowQuantity delta = increase
+                           ? capacity_[entering_arc] - flow_[entering_arc]
+                           : flow_[entering_arc];
+  NodeIndex leaving_node = -1;
+  bool leaving_on_first_side = false;
+  for (NodeIndex node = first; node != join; node = parent_[node]) {
+    const ArcIndex arc = parent_arc_[node];
+    const FlowQuantity residual =
+        tail_[arc] == node ? flow_[arc] : capacity_[arc] - flow_[arc];
+    if (residual < delta) {
+      delta = residual;
+      leaving_node = node;
+      leaving_on_first_side = true;
+    }
+  }
+  for (NodeIndex node = second; node != join; node = parent_[node]) {
+    const ArcIndex arc = parent_arc_[node];
+    const FlowQuantity residual =
+        tail_[arc] == node ? capacity_[arc] - flow_[arc] : flow_[arc];
+    if (residual <= delta) {
+      delta = residual;
+      leaving_node = node;
+      leaving_on_first_side = false;
+    }
+  }
+
+  if (delta > 0) {
+    flow_[entering_arc] += increase ? delta : -delta;
+    for (NodeIndex node = first; node != join; node = parent_[node]) {
+      const ArcIndex arc = parent_arc_[node];
+      flow_[arc] += tail_[arc] == node ? -delta : delta;
+    }
+    for (NodeIndex node = second; node != join; node = parent_[node]) {
+      const ArcIndex arc = parent_arc_[node];
+      flow_[arc] += tail_[arc] == node ? delta : -delta;
+    }
+  }
+
+  if (leaving_node < 0) {
+    state_[entering_arc] = -state_[entering_arc];
+    return;
+  }
+
+  // The subtree rooted at leaving_node is detached from the tree, and hung
+  // again below the other end of the entering arc. The path from the end of
+  // the entering arc in the subtree up to leaving_node is reversed.
+  const ArcIndex leaving_arc = parent_arc_[leaving_node];
+  const NodeIndex in_subtree = leaving_on_first_side ? first : second;
+  const NodeIndex out_of_subtree = leaving_on_first_side ? second : first;
+  const CostValue reduced_cost = ReducedCost(entering_arc);
+  const CostValue potential_change =
+      tail_[entering_arc] == in_subtree ? -reduced_cost : reduced_cost;
+
+  RemoveChild(parent_[leaving_node], leaving_node);
+  NodeIndex new_parent = out_of_subtree;
+  ArcIndex new_parent_arc = entering_arc;
+  NodeIndex node = in_subtree;
+  for (;;) {
+    const NodeIndex old_parent = parent_[node];
+    const ArcIndex old_parent_arc = parent_arc_[node];
+    if (node != leaving_node) RemoveChild(old_parent, node);
+    parent_[node] = new_parent;
+    parent_arc_[node] = new_parent_arc;
+    AddChild(new_parent, node);
+    if (node == leaving_node) break;
+    new_parent = node;
+    new_parent_arc = old_parent_arc;
+    node = old_parent;
+  }
+  UpdateSubtree(in_subtree, potential_change);
+
+  state_[entering_arc] = STATE_TREE;
+  state_[leaving_arc] = flow_[leaving_arc] == 0 ? STATE_LOWER : STATE_UPPER;
+}
+
+void NetworkSimplexMinCostFlow::ComputePotentials() {
+  const NodeIndex root = NumNodes();
+  potential_[root] = 0;
+  dfs_stack_.assign(1, root);
+  while (!dfs_stack_.empty()) {
+    const NodeIndex node = dfs_stack_.back();
+    dfs_stack_.pop_back();
+    for (NodeIndex child = first_child_[node]; child >= 0;
+         child = next_sibling_[child]) {
+      const ArcIndex arc = parent_arc_[child];
+      potential_[child] = tail_[arc] == child ? potential_[node] - cost_[arc]
+                                              : potential_[node] + cost_[arc];
+      dfs_stack_.push_back(child);
+    }
+  }
+}
+
+void NetworkSimplexMinCostFlow::UpdateSubtree(NodeIndex subtree_root,
+                                              CostValue potential_change) {
+  dfs_stack_.assign(1, subtree_root);
+  while (!dfs_stack_.empty()) {
+    const NodeIndex node = dfs_stack_.back();
+    dfs_stack_.pop_back();
+    potential_[node] += potential_change;
+    depth_[node] = depth_[parent_[node]] + 1;
+    for (NodeIndex child = first_child_[node]; child >= 0;
+         child = next_sibling_[child]) {
+      dfs_stack_.push_back(child);
+    }
+  }
+}
+
+void NetworkSimplexMinCostFlow::AddChild(NodeIndex parent, NodeIndex child) {
+  const NodeIndex old_first_child = first_child_[parent];
+  next_sibling_[child] = old_first_child;
+  previous_sibling_[child] = -1;
+  if (old_first_child >= 0) previous_sibling_[old_first_child] = child;
+  first_child_[parent] = child;
+}
+
+void NetworkSimplexMinCostFlow::RemoveChild(NodeIndex parent,
+                                            NodeIndex child) {
+  const NodeIndex next = next_sibling_[child];
+  const NodeIndex previous = previous_sibling_[child];
+  if (previous >= 0) {
+    next_sibling_[previous] = next;
+  } else {
+    first_child_[parent] = next;
+  }
+  if (next >= 0) previous_sibling_[next] = previous;
+}
+
+}  // namespace operations_research
@@ -0,0 +1,174 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A primal network simplex algorithm for the min-cost flow problem, see
+// ./min_cost_flow.h for the definition of the problem.
+//
+// The cost-scaling push-relabel algorithm of GenericMinCostFlow is the most
+// robust one, but on sparse networks with small costs (transportation
+// problems for instance) the network simplex is often several times faster.
+// SimpleMinCostFlow can use either, see SimpleMinCostFlow::SetAlgorithm().
+//
+// The algorithm maintains a spanning tree basis rooted at an artificial node
+// connected to every node by an artificial arc of very high cost (the "big M"
+// method), and:
+// - uses a strongly feasible basis (Cunningham's rule for the leaving arc),
+//   which prevents cycling on degenerate pivots,
+// - uses block search pricing: the arcs are scanned cyclically by blocks of
+//   about sqrt(num_arcs) arcs, and the entering arc is the one with the most
+//   negative reduced cost in the first block that contains an eligible arc.
+//
+// References:
+// - R.K. Ahuja, T.L. Magnanti, J.B. Orlin, "Network Flows: Theory, Algorithms,
+//   and Applications", Prentice Hall, 1993, chapter 11.
+// - W.H. Cunningham, "A network simplex method", Mathematical Programming,
+//   11:105-116, 1976.
+// - P. Kovacs, "Minimum-cost flow algorithms: an experimental evaluation",
+//   Optimization Methods and Software, 30:94-127, 2015.
+//
+// Example:
+//   NetworkSimplexMinCostFlow network_simplex;
+//   network_simplex.AddArcWithCapacityAndUnitCost(0, 1, 10, 3);
+//   network_simplex.SetNodeSupply(0, 5);
+//   network_simplex.SetNodeSupply(1, -5);
+//   if (network_simplex.Solve() == NetworkSimplexMinCostFlow::OPTIMAL) {
+//     ... = network_simplex.OptimalCost();  // 15.
+//   }
+
+#ifndef OR_TOOLS_GRAPH_NETWORK_SIMPLEX_H_
+#define OR_TOOLS_GRAPH_NETWORK_SIMPLEX_H_
+
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "graph/ebert_graph.h"
+#include "graph/min_cost_flow.h"
+
+namespace operations_research {
+
+class NetworkSimplexMinCostFlow : public MinCostFlowBase {
+ public:
+  // As for SimpleMinCostFlow, the nodes are created lazily by
+  // AddArcWithCapacityAndUnitCost() and SetNodeSupply().
+  NetworkSimplexMinCostFlow();
+
+  // Adds an arc with the given non-negative capacity and any unit cost, and
+  // returns its index. Self-loops and duplicate arcs are supported.
+  ArcIndex AddArcWithCapacityAndUnitCost(NodeIndex tail, NodeIndex head,
+                                         FlowQuantity capacity,
+                                         CostValue unit_cost);
+
+  // Sets the supply of the node, a demand being a negative supply.
+  void SetNodeSupply(NodeIndex node, FlowQuantity supply);
+
+  // Changes the unit cost of an arc. The basis of the last Solve() stays
+  // primal feasible, so the next Solve() warm-starts from it.
+  void SetArcUnitCost(ArcIndex arc, CostValue unit_cost);
+
+  // Solves the problem and returns OPTIMAL, UNBALANCED if the sum of the
+  // supplies is not zero, or INFEASIBLE if the supplies cannot be sent to the
+  // demands. The first call, and the calls after an arc was added or a supply
+  // changed, start from the artificial basis; the others start from the basis
+  // of the previous call.
+  Status Solve();
+
+  // The result of the last Solve(), when it returned OPTIMAL.
+  CostValue OptimalCost() const { return optimal_cost_; }
+  FlowQuantity Flow(ArcIndex arc) const { return flow_[arc]; }
+
+  // The number of pivots done by the last Solve().
+  int64 num_pivots() const { return num_pivots_; }
+
+  NodeIndex NumNodes() const { return supply_.size(); }
+  ArcIndex NumArcs() const { return num_arcs_; }
+
+ private:
+  // The state of an arc: in the tree, or out of it at one of its bounds. The
+  // values are chosen so that an arc is eligible to enter the tree if and only
+  // if state * reduced_cost < 0.
+  enum ArcState {
+    STATE_UPPER = -1,
+    STATE_TREE = 0,
+    STATE_LOWER = 1
+  };
+
+  // Builds the initial basis from the artificial arcs.
+  void InitializeBasis();
+
+  // Returns an arc eligible to enter the basis, or -1 if there is none, in
+  // which case the basis is optimal.
+  ArcIndex FindEnteringArc();
+
+  // Sends as much flow as possible around the cycle that entering_arc closes
+  // in the tree, and updates the tree.
+  void Pivot(ArcIndex entering_arc);
+
+  // Recomputes the potentials of all the nodes from the tree.
+  void ComputePotentials();
+
+  // Adds the potential change to the nodes of the subtree rooted at the given
+  // node, and recomputes their depths.
+  void UpdateSubtree(NodeIndex subtree_root, CostValue potential_change);
+
+  // Tree manipulation, with the children of a node kept in a doubly linked
+  // list.
+  void AddChild(NodeIndex parent, NodeIndex child);
+  void RemoveChild(NodeIndex parent, NodeIndex child);
+
+  CostValue ReducedCost(ArcIndex arc) const {
+    return cost_[arc] + potential_[tail_[arc]] - potential_[head_[arc]];
+  }
+
+  // The user problem.
+  ArcIndex num_arcs_;
+  std::vector<FlowQuantity> supply_;
+
+  // The arcs: the num_arcs_ user arcs, followed during Solve() by one
+  // artificial arc per node, between the node and the root.
+  std::vector<NodeIndex> tail_;
+  std::vector<NodeIndex> head_;
+  std::vector<FlowQuantity> capacity_;
+  std::vector<CostValue> cost_;
+  std::vector<FlowQuantity> flow_;
+  std::vector<int8> state_;
+
+  // The spanning tree, rooted at the artificial node NumNodes(). The arc
+  // linking a node to its parent is parent_arc_[node].
+  std::vector<NodeIndex> parent_;
+  std::vector<ArcIndex> parent_arc_;
+  std::vector<NodeIndex> depth_;
+  std::vector<NodeIndex> first_child_;
+  std::vector<NodeIndex> next_sibling_;
+  std::vector<NodeIndex> previous_sibling_;
+  std::vector<CostValue> potential_;
+
+  // The block search pricing: the number of arcs scanned at once, and the arc
+  // where the next search starts.
+  ArcIndex block_size_;
+  ArcIndex next_arc_;
+
+  // Whether the current tree is a valid basis for the problem.
+  bool has_basis_;
+
+  int64 num_pivots_;
+  CostValue optimal_cost_;
+
+  // Used by UpdateSubtree().
+  std::vector<NodeIndex> dfs_stack_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetworkSimplexMinCostFlow);
+};
+
+}  // namespace operations_research
+#endif  // OR_TOOLS_GRAPH_NETWORK_SIMPLEX_H_
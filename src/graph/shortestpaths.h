@@ -19,13 +19,19 @@
 #ifndef OR_TOOLS_GRAPH_SHORTESTPATHS_H_
 #define OR_TOOLS_GRAPH_SHORTESTPATHS_H_
 
+#include <algorithm>
+#include <limits>
 #include "base/unique_ptr.h"
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/callback.h"
 #include "base/integral_types.h"
+#include "base/logging.h"
 #include "base/macros.h"
+#include "graph/graph.h"
+#include "util/bitset.h"
 
 namespace operations_research {
 
@@ -50,6 +56,501 @@ bool DijkstraShortestPath(int node_count, int start_node, int end_node,
 bool BellmanFordShortestPath(int node_count, int start_node, int end_node,
                              ResultCallback2<int64, int, int>* const graph,
                              int64 disconnected_distance, std::vector<int>* nodes);
+
+// A monotone priority queue with uint64 keys, for Dijkstra-like algorithms: a
+// pushed key must not be smaller than the last popped key. The elements are
+// kept in 65 arrays, by the highest bit in which their key differs from the
+// last popped key, so that Push() is O(1) and Pop() is amortized O(64). The
+// arrays keep their memory across Clear().
+template <typename Value>
+class RadixHeap {
+ public:
+  RadixHeap() : buckets_(65), size_(0), last_key_(0) {}
+
+  bool IsEmpty() const { return size_ == 0; }
+
+  void Clear() {
+    for (std::vector<std::pair<uint64, Value> >& bucket : buckets_) {
+      bucket.clear();
+    }
+    size_ = 0;
+    last_key_ = 0;
+  }
+
+  void Push(uint64 key, Value value) {
+    DCHECK_GE(key, last_key_);
+    buckets_[BucketIndex(key)].push_back(std::make_pair(key, value));
+    ++size_;
+  }
+
+  // Returns the smallest key. The heap must not be empty.
+  uint64 TopKey() {
+    Refill();
+    return last_key_;
+  }
+
+  // Removes and returns a value with the smallest key. The heap must not be
+  // empty.
+  Value Pop() {
+    Refill();
+    const Value value = buckets_[0].back().second;
+    buckets_[0].pop_back();
+    --size_;
+    return value;
+  }
+
+ private:
+  int BucketIndex(uint64 key) const {
+    return key == last_key_ ? 0
+                            : MostSignificantBitPosition64(key ^ last_key_) + 1;
+  }
+
+  // Makes sure that buckets_[0], which holds the elements whose key is
+  // last_key_, is not empty: the smallest key of the first non-empty bucket
+  // becomes last_key_, and the elements of this bucket all move to lower ones.
+  void Refill() {
+    DCHECK(!IsEmpty());
+    if (!buckets_[0].empty()) return;
+    int index = 1;
+    while (buckets_[index].empty()) ++index;
+    std::vector<std::pair<uint64, Value> >& bucket = buckets_[index];
+    last_key_ = bucket[0].first;
+    for (const std::pair<uint64, Value>& element : bucket) {
+      last_key_ = std::min(last_key_, element.first);
+    }
+    for (const std::pair<uint64, Value>& element : bucket) {
+      buckets_[BucketIndex(element.first)].push_back(element);
+    }
+    bucket.clear();
+  }
+
+  std::vector<std::vector<std::pair<uint64, Value> > > buckets_;
+  int64 size_;
+  uint64 last_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(RadixHeap);
+};
+
+// Answers many shortest path queries on a graph of graph.h with non-negative
+// arc lengths, reusing its memory from one query to the next: after the
+// first query, the cost of a query only depends on the number of nodes it
+// visits, and not on the size of the graph.
+//
+// Point-to-point queries run a bidirectional Dijkstra. Once
+// ComputeLandmarks() has been called, they are goal-directed with the ALT
+// lower bounds (A*, Landmarks and the Triangle inequality, see Goldberg and
+// Harrelson, "Computing the shortest path: A* search meets graph theory",
+// SODA 2005), which usually visits far fewer nodes on road-like graphs.
+//
+// Graph must have reverse arcs (e.g. ReverseArcStaticGraph<>), which are
+// followed by the backward search. This class is not thread-safe: use one
+// object per thread.
+//
+// Example:
+//   PointToPointShortestPaths<Graph> paths(graph, arc_lengths.data());
+//   paths.ComputeLandmarks(16);
+//   std::vector<Graph::NodeIndex> path;
+//   for (...) {
+//     const int64 length = paths.FindShortestPath(source, target, &path);
+//   }
+template <class Graph>
+class PointToPointShortestPaths {
+ public:
+  typedef typename Graph::NodeIndex NodeIndex;
+  typedef typename Graph::ArcIndex ArcIndex;
+
+  // The length of the paths between disconnected nodes.
+  static const int64 kUnreachable;
+
+  // arc_lengths[arc] is the length of the forward arc 'arc' of the graph,
+  // which must be built. Both must outlive this object.
+  PointToPointShortestPaths(const Graph& graph, const int64* arc_lengths);
+
+  // Chooses up to num_landmarks landmarks, each one the farthest node from
+  // the previous ones, and stores the distances from and to each of them: this
+  // runs 2 * num_landmarks full Dijkstra and takes 2 * num_landmarks int64
+  // per node. The following FindShortestPath() use them.
+  void ComputeLandmarks(int num_landmarks);
+  const std::vector<NodeIndex>& landmarks() const { return landmarks_; }
+
+  // Returns the length of a shortest path from source to target, or
+  // kUnreachable. If path is not NULL, it is filled with the nodes of such a
+  // path, source and target included (or cleared if there is none).
+  int64 FindShortestPath(NodeIndex source, NodeIndex target,
+                         std::vector<NodeIndex>* path);
+
+  // Fills (*distances)[i][j] with the length of a shortest path from
+  // sources[i] to targets[j], or kUnreachable. This runs one Dijkstra per
+  // source (or per target, if there are fewer targets), each one stopping
+  // as soon as all the targets (or sources) are reached. It can for instance
+  // feed the arc cost evaluator of a RoutingModel.
+  void ComputeDistanceMatrix(const std::vector<NodeIndex>& sources,
+                             const std::vector<NodeIndex>& targets,
+                             std::vector<std::vector<int64> >* distances);
+
+  // The number of nodes settled by the last query, to measure the effect of
+  // the landmarks.
+  int64 num_settled_nodes() const { return num_settled_nodes_; }
+
+ private:
+  enum Direction {
+    FORWARD = 0,
+    BACKWARD = 1
+  };
+
+  // The state of a search in one direction. distance[node] is kUnreachable
+  // for the nodes that are not in touched.
+  struct Search {
+    std::vector<int64> distance;
+    // The arc by which the node was reached: for the backward search, this is
+    // the forward arc leaving the node.
+    std::vector<ArcIndex> parent_arc;
+    std::vector<NodeIndex> touched;
+    RadixHeap<NodeIndex> heap;
+    // The key of the root of the search, which is subtracted from all the
+    // keys pushed in the heap.
+    int64 key_offset;
+  };
+
+  // Returned by Potential() for the nodes that cannot be on a path from the
+  // source to the target, according to the landmarks.
+  static const int64 kPruned;
+  static const int64 kUnknownPotential;
+
+  // Returns the potential of the forward search, see FindShortestPath(), or
+  // kPruned. The potential of the backward search is its opposite.
+  int64 Potential(NodeIndex node);
+  int64 ComputePotential(NodeIndex node) const;
+
+  int64 Key(Direction direction, NodeIndex node) {
+    const int64 potential = Potential(node);
+    return 2 * searches_[direction].distance[node] +
+           (direction == FORWARD ? potential : -potential);
+  }
+
+  // Sets the distance of node in the given search, if it is smaller, and
+  // updates the best path found so far.
+  void Relax(Direction direction, NodeIndex node, int64 distance,
+             ArcIndex parent_arc);
+
+  // Removes the node with the smallest key from the heap of the search and
+  // relaxes its arcs. Returns this node, or Graph::kNilNode if it was already
+  // settled.
+  NodeIndex SettleNext(Direction direction);
+
+  // Runs a Dijkstra from root in the given direction, without potentials,
+  // until all the nodes in 'stop_nodes' are settled (or all the reachable
+  // nodes, if stop_nodes is NULL).
+  void RunDijkstra(Direction direction, NodeIndex root,
+                   const std::vector<NodeIndex>* stop_nodes);
+
+  // Resets the searches, in O(number of touched nodes).
+  void Reset();
+
+  const Graph& graph_;
+  const int64* const arc_lengths_;
+  Search searches_[2];
+
+  // The node potentials, kUnknownPotential for the nodes not in
+  // potential_touched_.
+  bool use_potentials_;
+  std::vector<int64> potential_;
+  std::vector<NodeIndex> potential_touched_;
+  NodeIndex source_;
+  NodeIndex target_;
+
+  std::vector<NodeIndex> landmarks_;
+  std::vector<std::vector<int64> > distance_from_landmark_;
+  std::vector<std::vector<int64> > distance_to_landmark_;
+
+  // The best path found so far by the current query.
+  int64 best_distance_;
+  NodeIndex meeting_node_;
+
+  std::vector<char> is_stop_node_;
+  int64 num_settled_nodes_;
+
+  DISALLOW_COPY_AND_ASSIGN(PointToPointShortestPaths);
+};
+
+template <class Graph>
+const int64 PointToPointShortestPaths<Graph>::kUnreachable =
+    std::numeric_limits<int64>::max();
+
+template <class Graph>
+const int64 PointToPointShortestPaths<Graph>::kPruned =
+    std::numeric_limits<int64>::max();
+
+template <class Graph>
+const int64 PointToPointShortestPaths<Graph>::kUnknownPotential =
+    std::numeric_limits<int64>::min();
+
+template <class Graph>
+PointToPointShortestPaths<Graph>::PointToPointShortestPaths(
+    const Graph& graph, const int64* arc_lengths)
+    : graph_(graph),
+      arc_lengths_(arc_lengths),
+      use_potentials_(false),
+      potential_(graph.num_nodes(), kUnknownPotential),
+      source_(0),
+      target_(0),
+      best_distance_(kUnreachable),
+      meeting_node_(0),
+      num_settled_nodes_(0) {
+  for (Search& search : searches_) {
+    search.distance.assign(graph.num_nodes(), kUnreachable);
+    search.parent_arc.assign(graph.num_nodes(), Graph::kNilArc);
+    search.key_offset = 0;
+  }
+}
+
+template <class Graph>
+void PointToPointShortestPaths<Graph>::ComputeLandmarks(int num_landmarks) {
+  landmarks_.clear();
+  distance_from_landmark_.clear();
+  distance_to_landmark_.clear();
+  const NodeIndex num_nodes = graph_.num_nodes();
+  if (num_nodes == 0) return;
+  // min_distance[node] is the smallest distance from a landmark to node, the
+  // first landmark being the farthest node from node 0. The unreachable nodes
+  // are the farthest ones.
+  RunDijkstra(FORWARD, 0, NULL);
+  std::vector<int64> min_distance = searches_[FORWARD].distance;
+  Reset();
+  while (landmarks_.size() < num_landmarks) {
+    const NodeIndex landmark =
+        std::max_element(min_distance.begin(), min_distance.end()) -
+        min_distance.begin();
+    if (min_distance[landmark] == 0) break;
+    landmarks_.push_back(landmark);
+    RunDijkstra(FORWARD, landmark, NULL);
+    distance_from_landmark_.push_back(searches_[FORWARD].distance);
+    Reset();
+    RunDijkstra(BACKWARD, landmark, NULL);
+    distance_to_landmark_.push_back(searches_[BACKWARD].distance);
+    Reset();
+    const std::vector<int64>& from_landmark = distance_from_landmark_.back();
+    for (NodeIndex node = 0; node < num_nodes; ++node) {
+      min_distance[node] = std::min(min_distance[node], from_landmark[node]);
+    }
+  }
+}
+
+template <class Graph>
+int64 PointToPointShortestPaths<Graph>::ComputePotential(
+    NodeIndex node) const {
+  // forward_bound is a lower bound of the distance from node to the target,
+  // and backward_bound of the distance from the source to node. An infinite
+  // distance from a landmark proves that a node cannot be on a path from the
+  // source to the target when the landmark can reach the other end.
+  int64 forward_bound = 0;
+  int64 backward_bound = 0;
+  for (int i = 0; i < landmarks_.size(); ++i) {
+    const std::vector<int64>& from = distance_from_landmark_[i];
+    const std::vector<int64>& to = distance_to_landmark_[i];
+    if (from[node] != kUnreachable) {
+      if (from[target_] == kUnreachable) return kPruned;
+      forward_bound = std::max(forward_bound, from[target_] - from[node]);
+      if (from[source_] != kUnreachable) {
+        backward_bound = std::max(backward_bound, from[node] - from[source_]);
+      }
+    } else if (from[source_] != kUnreachable) {
+      return kPruned;
+    }
+    if (to[node] != kUnreachable) {
+      if (to[source_] == kUnreachable) return kPruned;
+      backward_bound = std::max(backward_bound, to[source_] - to[node]);
+      if (to[target_] != kUnreachable) {
+        forward_bound = std::max(forward_bound, to[node] - to[target_]);
+      }
+    } else if (to[target_] != kUnreachable) {
+      return kPruned;
+    }
+  }
+  return forward_bound - backward_bound;
+}
+
+template <class Graph>
+int64 PointToPointShortestPaths<Graph>::Potential(NodeIndex node) {
+  if (!use_potentials_) return 0;
+  if (potential_[node] == kUnknownPotential) {
+    potential_[node] = ComputePotential(node);
+    potential_touched_.push_back(node);
+  }
+  return potential_[node];
+}
+
+template <class Graph>
+void PointToPointShortestPaths<Graph>::Relax(Direction direction,
+                                             NodeIndex node, int64 distance,
+                                             ArcIndex parent_arc) {
+  Search& search = searches_[direction];
+  if (distance >= search.distance[node]) return;
+  if (Potential(node) == kPruned) return;
+  if (search.distance[node] == kUnreachable) search.touched.push_back(node);
+  search.distance[node] = distance;
+  search.parent_arc[node] = parent_arc;
+  search.heap.Push(Key(direction, node) - search.key_offset, node);
+  const int64 other_distance = searches_[1 - direction].distance[node];
+  if (other_distance != kUnreachable &&
+      distance + other_distance < best_distance_) {
+    best_distance_ = distance + other_distance;
+    meeting_node_ = node;
+  }
+}
+
+template <class Graph>
+typename Graph::NodeIndex PointToPointShortestPaths<Graph>::SettleNext(
+    Direction direction) {
+  Search& search = searches_[direction];
+  const uint64 key = search.heap.TopKey();
+  const NodeIndex node = search.heap.Pop();
+  // The heap may hold several keys for a node: only the last one counts.
+  if (key != Key(direction, node) - search.key_offset) return Graph::kNilNode;
+  ++num_settled_nodes_;
+  const int64 distance = search.distance[node];
+  if (direction == FORWARD) {
+    for (const ArcIndex arc : graph_.OutgoingArcs(node)) {
+      Relax(FORWARD, graph_.Head(arc), distance + arc_lengths_[arc], arc);
+    }
+  } else {
+    for (const ArcIndex arc : graph_.IncomingArcs(node)) {
+      const ArcIndex forward_arc = graph_.OppositeArc(arc);
+      Relax(BACKWARD, graph_.Head(arc), distance + arc_lengths_[forward_arc],
+            forward_arc);
+    }
+  }
+  return node;
+}
+
+template <class Graph>
+int64 PointToPointShortestPaths<Graph>::FindShortestPath(
+    NodeIndex source, NodeIndex target, std::vector<NodeIndex>* path) {
+  DCHECK(graph_.IsNodeValid(source));
+  DCHECK(graph_.IsNodeValid(target));
+  source_ = source;
+  target_ = target;
+  use_potentials_ = !landmarks_.empty();
+  best_distance_ = kUnreachable;
+  num_settled_nodes_ = 0;
+  // The keys are 2 * distance + potential, with the (integer) potential
+  // Potential() of the forward search, equal to the lower bound of the
+  // distance to the target minus the lower bound of the distance from the
+  // source, and its opposite for the backward search. The reduced arc
+  // lengths are non-negative for both searches, and the sum of the keys of a
+  // node is twice the length of the best path through it.
+  const int64 source_potential = Potential(source);
+  if (source_potential != kPruned) {
+    searches_[FORWARD].key_offset = source_potential;
+    searches_[BACKWARD].key_offset = -Potential(target);
+    Relax(FORWARD, source, 0, Graph::kNilArc);
+    Relax(BACKWARD, target, 0, Graph::kNilArc);
+  }
+  Search& forward = searches_[FORWARD];
+  Search& backward = searches_[BACKWARD];
+  while (!forward.heap.IsEmpty() && !backward.heap.IsEmpty()) {
+    const int64 forward_key = forward.heap.TopKey() + forward.key_offset;
+    const int64 backward_key = backward.heap.TopKey() + backward.key_offset;
+    if (best_distance_ != kUnreachable &&
+        forward_key + backward_key >= 2 * best_distance_) {
+      break;
+    }
+    SettleNext(forward_key <= backward_key ? FORWARD : BACKWARD);
+  }
+
+  if (path != NULL) {
+    path->clear();
+    if (best_distance_ != kUnreachable) {
+      for (NodeIndex node = meeting_node_; node != source;
+           node = graph_.Tail(forward.parent_arc[node])) {
+        path->push_back(node);
+      }
+      path->push_back(source);
+      std::reverse(path->begin(), path->end());
+      for (NodeIndex node = meeting_node_; node != target;) {
+        node = graph_.Head(backward.parent_arc[node]);
+        path->push_back(node);
+      }
+    }
+  }
+  Reset();
+  return best_distance_;
+}
+
+template <class Graph>
+void PointToPointShortestPaths<Graph>::RunDijkstra(
+    Direction direction, NodeIndex root,
+    const std::vector<NodeIndex>* stop_nodes) {
+  use_potentials_ = false;
+  best_distance_ = kUnreachable;
+  num_settled_nodes_ = 0;
+  int num_stop_nodes_left = 0;
+  if (stop_nodes != NULL) {
+    is_stop_node_.resize(graph_.num_nodes(), false);
+    for (const NodeIndex node : *stop_nodes) {
+      if (!is_stop_node_[node]) {
+        is_stop_node_[node] = true;
+        ++num_stop_nodes_left;
+      }
+    }
+  }
+  Search& search = searches_[direction];
+  search.key_offset = 0;
+  Relax(direction, root, 0, Graph::kNilArc);
+  if (stop_nodes != NULL && num_stop_nodes_left == 0) return;
+  while (!search.heap.IsEmpty()) {
+    const NodeIndex node = SettleNext(direction);
+    if (node != Graph::kNilNode && stop_nodes != NULL && is_stop_node_[node]) {
+      if (--num_stop_nodes_left == 0) break;
+    }
+  }
+  if (stop_nodes != NULL) {
+    for (const NodeIndex node : *stop_nodes) is_stop_node_[node] = false;
+  }
+}
+
+template <class Graph>
+void PointToPointShortestPaths<Graph>::ComputeDistanceMatrix(
+    const std::vector<NodeIndex>& sources,
+    const std::vector<NodeIndex>& targets,
+    std::vector<std::vector<int64> >* distances) {
+  distances->assign(sources.size(),
+                    std::vector<int64>(targets.size(), kUnreachable));
+  const bool forward = sources.size() <= targets.size();
+  const std::vector<NodeIndex>& roots = forward ? sources : targets;
+  const std::vector<NodeIndex>& others = forward ? targets : sources;
+  const Direction direction = forward ? FORWARD : BACKWARD;
+  int64 num_settled_nodes = 0;
+  for (int i = 0; i < roots.size(); ++i) {
+    RunDijkstra(direction, roots[i], &others);
+    num_settled_nodes += num_settled_nodes_;
+    const std::vector<int64>& distance = searches_[direction].distance;
+    for (int j = 0; j < others.size(); ++j) {
+      if (forward) {
+        (*distances)[i][j] = distance[others[j]];
+      } else {
+        (*distances)[j][i] = distance[others[j]];
+      }
+    }
+    Reset();
+  }
+  num_settled_nodes_ = num_settled_nodes;
+}
+
+template <class Graph>
+void PointToPointShortestPaths<Graph>::Reset() {
+  for (Search& search : searches_) {
+    for (const NodeIndex node : search.touched) {
+      search.distance[node] = kUnreachable;
+    }
+    search.touched.clear();
+    search.heap.Clear();
+  }
+  for (const NodeIndex node : potential_touched_) {
+    potential_[node] = kUnknownPotential;
+  }
+  potential_touched_.clear();
+}
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_GRAPH_SHORTESTPATHS_H_
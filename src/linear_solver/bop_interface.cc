@@ -143,7 +143,26 @@ MPSolver::ResultStatus BopInterface::Solve(const MPSolverParameters& param) {
   solver_->SetSolverSpecificParametersAsString(
       solver_->solver_specific_parameter_string_);
   bop_solver_.SetParameters(parameters_);
-  const bop::BopSolveStatus status = bop_solver_.Solve(linear_program_);
+
+  // The solution hint is only used when it gives a value to all variables.
+  glop::DenseRow initial_solution;
+  if (!solver_->solution_hint_.empty()) {
+    initial_solution.resize(glop::ColIndex(solver_->variables_.size()),
+                            glop::kInfinity);
+    for (const std::pair<MPVariable*, double>& hint :
+         solver_->solution_hint_) {
+      initial_solution[glop::ColIndex(hint.first->index())] = hint.second;
+    }
+    for (const glop::Fractional value : initial_solution) {
+      if (value == glop::kInfinity) {
+        VLOG(1) << "The solution hint is partial, ignoring it.";
+        initial_solution.clear();
+        break;
+      }
+    }
+  }
+  const bop::BopSolveStatus status =
+      bop_solver_.SolveWithInitialSolution(linear_program_, initial_solution);
 
   // The solution must be marked as synchronized even when no solution exists.
   sync_status_ = SOLUTION_SYNCHRONIZED;
@@ -269,9 +288,10 @@ void BopInterface::ExtractNewVariables() {
   const glop::ColIndex num_cols(solver_->variables_.size());
   for (glop::ColIndex col(last_variable_index_); col < num_cols; ++col) {
     MPVariable* const var = solver_->variables_[col.value()];
-    const glop::ColIndex new_col =
-        linear_program_.FindOrCreateVariable(var->name());
+    const glop::ColIndex new_col = linear_program_.CreateNewVariable();
     DCHECK_EQ(new_col, col);
+    // Unnamed variables of solvers with lazy names keep the default glop name.
+    if (!var->name_.empty()) linear_program_.SetVariableName(col, var->name_);
     var->set_index(col.value());
     linear_program_.SetVariableBounds(col, var->lb(), var->ub());
     linear_program_.SetVariableIntegrality(col, var->integer());
@@ -289,9 +309,9 @@ void BopInterface::ExtractNewConstraints() {
 
     const double lb = ct->lb();
     const double ub = ct->ub();
-    const glop::RowIndex new_row =
-        linear_program_.FindOrCreateConstraint(ct->name());
+    const glop::RowIndex new_row = linear_program_.CreateNewConstraint();
     DCHECK_EQ(new_row, row);
+    if (!ct->name_.empty()) linear_program_.SetConstraintName(row, ct->name_);
     linear_program_.SetConstraintBounds(row, lb, ub);
 
     for (CoeffEntry entry : ct->coefficients_) {
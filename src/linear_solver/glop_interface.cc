@@ -13,6 +13,8 @@
 
 
 #include "base/hash.h"
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -23,6 +25,7 @@
 #include "base/logging.h"
 #include "base/stringprintf.h"
 #include "base/file.h"
+#include "base/threadpool.h"
 #include "google/protobuf/text_format.h"
 #include "base/hash.h"
 #include "glop/lp_solver.h"
@@ -101,6 +104,114 @@ MPSolver::BasisStatus TranslateConstraintStatus(glop::ConstraintStatus status) {
   LOG(DFATAL) << "Unknown constraint status: " << status;
   return MPSolver::FREE;
 }
+
+glop::VariableStatus GlopVariableStatus(MPSolver::BasisStatus status) {
+  switch (status) {
+    case MPSolver::FREE:
+      return glop::VariableStatus::FREE;
+    case MPSolver::AT_LOWER_BOUND:
+      return glop::VariableStatus::AT_LOWER_BOUND;
+    case MPSolver::AT_UPPER_BOUND:
+      return glop::VariableStatus::AT_UPPER_BOUND;
+    case MPSolver::FIXED_VALUE:
+      return glop::VariableStatus::FIXED_VALUE;
+    case MPSolver::BASIC:
+      return glop::VariableStatus::BASIC;
+  }
+  LOG(DFATAL) << "Unknown basis status: " << status;
+  return glop::VariableStatus::FREE;
+}
+
+glop::ConstraintStatus GlopConstraintStatus(MPSolver::BasisStatus status) {
+  switch (status) {
+    case MPSolver::FREE:
+      return glop::ConstraintStatus::FREE;
+    case MPSolver::AT_LOWER_BOUND:
+      return glop::ConstraintStatus::AT_LOWER_BOUND;
+    case MPSolver::AT_UPPER_BOUND:
+      return glop::ConstraintStatus::AT_UPPER_BOUND;
+    case MPSolver::FIXED_VALUE:
+      return glop::ConstraintStatus::FIXED_VALUE;
+    case MPSolver::BASIC:
+      return glop::ConstraintStatus::BASIC;
+  }
+  LOG(DFATAL) << "Unknown basis status: " << status;
+  return glop::ConstraintStatus::FREE;
+}
+
+// What the threads of a concurrent GLOPInterface::Solve() share.
+struct GlopRace {
+  const glop::LinearProgram* model;
+  glop::LPSolver* lp_solvers[2];
+  glop::ProblemStatus statuses[2];
+  // The index of the first solver to finish, or -1.
+  std::atomic<int> winner;
+  // Set by the first solver to finish, to interrupt the other one.
+  std::atomic<bool>* interrupt;
+};
+
+void RunGlopRacer(GlopRace* race, int index) {
+  race->statuses[index] = race->lp_solvers[index]->Solve(*race->model);
+  int no_winner = -1;
+  if (race->winner.compare_exchange_strong(no_winner, index)) {
+    *race->interrupt = true;
+  }
+}
+
+// What the threads of GLOPInterface::SolveVariants() share.
+struct GlopVariants {
+  const glop::LinearProgram* model;
+  glop::GlopParameters parameters;
+  // The basis to start each variant from; empty if there is none.
+  const glop::VariableStatusRow* variable_statuses;
+  const glop::ConstraintStatusColumn* constraint_statuses;
+  const std::atomic<bool>* interrupt;
+  const std::vector<MPModelVariant>* variants;
+  std::vector<MPModelVariantSolution>* solutions;
+};
+
+// Solves the variants first, first + step, first + 2 * step, ... on a copy
+// of the model, modified in place from one variant to the next.
+void SolveGlopVariants(const GlopVariants* data, int first, int step) {
+  const glop::LinearProgram& model = *data->model;
+  glop::LinearProgram lp;
+  lp.PopulateFromLinearProgram(model, false);
+  glop::LPSolver lp_solver;
+  lp_solver.SetParameters(data->parameters);
+  lp_solver.SetInterruptFlag(data->interrupt);
+  const glop::ColIndex num_cols = model.num_variables();
+  for (int v = first; v < data->variants->size(); v += step) {
+    const MPModelVariant& variant = (*data->variants)[v];
+    const std::vector<double>& coefficients = variant.objective_coefficients;
+    const std::vector<double>& lbs = variant.variable_lower_bounds;
+    const std::vector<double>& ubs = variant.variable_upper_bounds;
+    for (glop::ColIndex col(0); col < num_cols; ++col) {
+      const int i = col.value();
+      lp.SetObjectiveCoefficient(col,
+                                 coefficients.empty()
+                                     ? model.objective_coefficients()[col]
+                                     : coefficients[i]);
+      lp.SetVariableBounds(
+          col, lbs.empty() ? model.variable_lower_bounds()[col] : lbs[i],
+          ubs.empty() ? model.variable_upper_bounds()[col] : ubs[i]);
+    }
+    if (!data->variable_statuses->empty()) {
+      lp_solver.SetInitialBasis(*data->variable_statuses,
+                                *data->constraint_statuses);
+    }
+    MPModelVariantSolution* const solution = &(*data->solutions)[v];
+    solution->status = TranslateProblemStatus(lp_solver.Solve(lp));
+    if (solution->status == MPSolver::OPTIMAL ||
+        solution->status == MPSolver::FEASIBLE) {
+      solution->objective_value = lp_solver.GetObjectiveValue();
+      solution->variable_values.resize(num_cols.value());
+      for (glop::ColIndex col(0); col < num_cols; ++col) {
+        solution->variable_values[col.value()] =
+            lp_solver.variable_values()[col];
+      }
+    }
+  }
+}
 }  // Anonymous namespace
 
 class GLOPInterface : public MPSolverInterface {
@@ -156,29 +267,63 @@ class GLOPInterface : public MPSolverInterface {
   virtual void SetLpAlgorithm(int value);
   virtual bool ReadParameterFile(const std::string& filename);
 
- private:
-  void NonIncrementalChange();
+  virtual bool InterruptSolve();
+  virtual bool SolveVariants(const MPSolverParameters& param,
+                             const std::vector<MPModelVariant>& variants,
+                             int num_threads,
+                             std::vector<MPModelVariantSolution>* solutions);
 
+ private:
+  // The model is kept in linear_program_ between two solves, and modified in
+  // place. lp_solver_ is also kept, and each Solve() starts from the basis of
+  // the previous one, stored in variable_statuses_ and constraint_statuses_
+  // (they are empty if there is no such basis).
   glop::LinearProgram linear_program_;
   glop::LPSolver lp_solver_;
+
+  // With the CONCURRENT LP algorithm, lp_solver_ runs the primal simplex while
+  // concurrent_lp_solver_ runs the dual simplex on another thread, and the
+  // first one to finish gives the solution. solved_lp_solver_ points to the
+  // solver of the last solve.
+  bool concurrent_;
+  glop::LPSolver concurrent_lp_solver_;
+  glop::LPSolver* solved_lp_solver_;
+
   std::vector<MPSolver::BasisStatus> column_status_;
   std::vector<MPSolver::BasisStatus> row_status_;
+  glop::VariableStatusRow variable_statuses_;
+  glop::ConstraintStatusColumn constraint_statuses_;
   glop::GlopParameters parameters_;
+
+  // Set by InterruptSolve(), possibly from another thread, and cleared once
+  // the interrupted Solve() returns, or by Reset().
+  std::atomic<bool> interrupt_solver_;
 };
 
 GLOPInterface::GLOPInterface(MPSolver* const solver)
     : MPSolverInterface(solver),
       linear_program_(),
       lp_solver_(),
+      concurrent_(false),
+      concurrent_lp_solver_(),
+      solved_lp_solver_(&lp_solver_),
       column_status_(),
       row_status_(),
-      parameters_() {}
+      variable_statuses_(),
+      constraint_statuses_(),
+      parameters_(),
+      interrupt_solver_(false) {
+  lp_solver_.SetInterruptFlag(&interrupt_solver_);
+  concurrent_lp_solver_.SetInterruptFlag(&interrupt_solver_);
+}
 
 GLOPInterface::~GLOPInterface() {}
 
 MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
-  // Reset extraction as Glop is not incremental yet.
-  Reset();
+  if (param.GetIntegerParam(MPSolverParameters::INCREMENTALITY) ==
+      MPSolverParameters::INCREMENTALITY_OFF) {
+    Reset();
+  }
   ExtractModel();
   SetParameters(param);
 
@@ -192,15 +337,76 @@ MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
         static_cast<double>(solver_->time_limit()) / 1000.0);
   }
 
+  // A basis given to MPSolver::SetStartingBasis() replaces the one of the
+  // last solve.
+  if (!solver_->starting_variable_statuses_.empty() ||
+      !solver_->starting_constraint_statuses_.empty()) {
+    variable_statuses_.clear();
+    for (const MPSolver::BasisStatus status :
+         solver_->starting_variable_statuses_) {
+      variable_statuses_.push_back(GlopVariableStatus(status));
+    }
+    constraint_statuses_.clear();
+    for (const MPSolver::BasisStatus status :
+         solver_->starting_constraint_statuses_) {
+      constraint_statuses_.push_back(GlopConstraintStatus(status));
+    }
+  }
+
+  // Warm-start from the basis of the last solve. The presolve would change the
+  // problem dimensions and prevent this, so it only runs on the first solve.
+  if (!variable_statuses_.empty() || !constraint_statuses_.empty()) {
+    parameters_.set_use_preprocessing(false);
+    lp_solver_.SetInitialBasis(variable_statuses_, constraint_statuses_);
+  }
+
   solver_->SetSolverSpecificParametersAsString(
       solver_->solver_specific_parameter_string_);
-  lp_solver_.SetParameters(parameters_);
-  const glop::ProblemStatus status = lp_solver_.Solve(linear_program_);
+  glop::ProblemStatus status;
+  if (concurrent_) {
+    // Both solvers only read linear_program_, which is already cleaned up.
+    GlopRace race;
+    race.model = &linear_program_;
+    race.lp_solvers[0] = &lp_solver_;
+    race.lp_solvers[1] = &concurrent_lp_solver_;
+    race.winner = -1;
+    race.interrupt = &interrupt_solver_;
+    glop::GlopParameters parameters = parameters_;
+    parameters.set_use_dual_simplex(false);
+    lp_solver_.SetParameters(parameters);
+    parameters.set_use_dual_simplex(true);
+    concurrent_lp_solver_.SetParameters(parameters);
+    {
+      ThreadPool pool("GlopRace", 2);
+      for (int i = 0; i < 2; ++i) {
+        pool.Add(NewCallback(&RunGlopRacer, &race, i));
+      }
+      pool.StartWorkers();
+    }
+    VLOG(1) << "The " << (race.winner == 0 ? "primal" : "dual")
+            << " simplex finished first.";
+    solved_lp_solver_ = race.lp_solvers[race.winner];
+    status = race.statuses[race.winner];
+  } else {
+    lp_solver_.SetParameters(parameters_);
+    solved_lp_solver_ = &lp_solver_;
+    status = lp_solver_.Solve(linear_program_);
+  }
+  interrupt_solver_ = false;
+  const glop::LPSolver& lp_solver = *solved_lp_solver_;
 
   // The solution must be marked as synchronized even when no solution exists.
   sync_status_ = SOLUTION_SYNCHRONIZED;
   result_status_ = TranslateProblemStatus(status);
-  objective_value_ = lp_solver_.GetObjectiveValue();
+  objective_value_ = lp_solver.GetObjectiveValue();
+  if (result_status_ == MPSolver::OPTIMAL ||
+      result_status_ == MPSolver::FEASIBLE) {
+    variable_statuses_ = lp_solver.variable_statuses();
+    constraint_statuses_ = lp_solver.constraint_statuses();
+  } else {
+    variable_statuses_.clear();
+    constraint_statuses_.clear();
+  }
 
   const size_t num_vars = solver_->variables_.size();
   column_status_.resize(num_vars, MPSolver::FREE);
@@ -209,15 +415,15 @@ MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
     const glop::ColIndex lp_solver_var_id(var->index());
 
     const glop::Fractional solution_value =
-        lp_solver_.variable_values()[lp_solver_var_id];
+        lp_solver.variable_values()[lp_solver_var_id];
     var->set_solution_value(static_cast<double>(solution_value));
 
     const glop::Fractional reduced_cost =
-        lp_solver_.reduced_costs()[lp_solver_var_id];
+        lp_solver.reduced_costs()[lp_solver_var_id];
     var->set_reduced_cost(static_cast<double>(reduced_cost));
 
     const glop::VariableStatus variable_status =
-        lp_solver_.variable_statuses()[lp_solver_var_id];
+        lp_solver.variable_statuses()[lp_solver_var_id];
     column_status_.at(var_id) = TranslateVariableStatus(variable_status);
   }
 
@@ -228,15 +434,15 @@ MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
     const glop::RowIndex lp_solver_ct_id(ct->index());
 
     const glop::Fractional dual_value =
-        lp_solver_.dual_values()[lp_solver_ct_id];
+        lp_solver.dual_values()[lp_solver_ct_id];
     ct->set_dual_value(static_cast<double>(dual_value));
 
     const glop::Fractional row_activity =
-        lp_solver_.constraint_activities()[lp_solver_ct_id];
+        lp_solver.constraint_activities()[lp_solver_ct_id];
     ct->set_activity(static_cast<double>(row_activity));
 
     const glop::ConstraintStatus constraint_status =
-        lp_solver_.constraint_statuses()[lp_solver_ct_id];
+        lp_solver.constraint_statuses()[lp_solver_ct_id];
     row_status_.at(ct_id) = TranslateConstraintStatus(constraint_status);
   }
 
@@ -246,14 +452,27 @@ MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
 void GLOPInterface::Reset() {
   ResetExtractionInformation();
   linear_program_.Clear();
+  lp_solver_.Clear();
+  concurrent_lp_solver_.Clear();
+  solved_lp_solver_ = &lp_solver_;
+  variable_statuses_.clear();
+  constraint_statuses_.clear();
+  interrupt_solver_ = false;
 }
 
 void GLOPInterface::SetOptimizationDirection(bool maximize) {
-  NonIncrementalChange();
+  // The direction is given to linear_program_ by Solve().
+  InvalidateSolutionSynchronization();
 }
 
 void GLOPInterface::SetVariableBounds(int index, double lb, double ub) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (index != kNoIndex) {
+    DCHECK_LT(index, last_variable_index_);
+    linear_program_.SetVariableBounds(glop::ColIndex(index), lb, ub);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 void GLOPInterface::SetVariableInteger(int index, bool integer) {
@@ -261,38 +480,83 @@ void GLOPInterface::SetVariableInteger(int index, bool integer) {
 }
 
 void GLOPInterface::SetConstraintBounds(int index, double lb, double ub) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (index != kNoIndex) {
+    DCHECK_LT(index, last_constraint_index_);
+    linear_program_.SetConstraintBounds(glop::RowIndex(index), lb, ub);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 void GLOPInterface::AddRowConstraint(MPConstraint* const ct) {
-  NonIncrementalChange();
+  sync_status_ = MUST_RELOAD;
 }
 
 void GLOPInterface::AddVariable(MPVariable* const var) {
-  NonIncrementalChange();
+  sync_status_ = MUST_RELOAD;
 }
 
 void GLOPInterface::SetCoefficient(MPConstraint* const constraint,
                                    const MPVariable* const variable,
                                    double new_value, double old_value) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  const int constraint_index = constraint->index();
+  const int variable_index = variable->index();
+  if (constraint_index != kNoIndex && variable_index != kNoIndex) {
+    // Setting a zero coefficient removes the entry on the next CleanUp().
+    linear_program_.SetCoefficient(glop::RowIndex(constraint_index),
+                                   glop::ColIndex(variable_index), new_value);
+  } else {
+    // The coefficient is extracted with the new constraint or variable.
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 void GLOPInterface::ClearConstraint(MPConstraint* const constraint) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  const int constraint_index = constraint->index();
+  // The constraint may not have been extracted yet.
+  if (constraint_index == kNoIndex) return;
+  for (CoeffEntry entry : constraint->coefficients_) {
+    const int var_index = entry.first->index();
+    if (var_index != kNoIndex) {
+      linear_program_.SetCoefficient(glop::RowIndex(constraint_index),
+                                     glop::ColIndex(var_index), 0.0);
+    }
+  }
 }
 
 void GLOPInterface::SetObjectiveCoefficient(const MPVariable* const variable,
                                             double coefficient) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (variable->index() != kNoIndex) {
+    linear_program_.SetObjectiveCoefficient(glop::ColIndex(variable->index()),
+                                            coefficient);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
-void GLOPInterface::SetObjectiveOffset(double value) { NonIncrementalChange(); }
+void GLOPInterface::SetObjectiveOffset(double value) {
+  InvalidateSolutionSynchronization();
+  linear_program_.SetObjectiveOffset(value);
+}
 
-void GLOPInterface::ClearObjective() { NonIncrementalChange(); }
+void GLOPInterface::ClearObjective() {
+  InvalidateSolutionSynchronization();
+  for (CoeffEntry entry : solver_->objective_->coefficients_) {
+    const int var_index = entry.first->index();
+    // The variable may not have been extracted yet.
+    if (var_index != kNoIndex) {
+      linear_program_.SetObjectiveCoefficient(glop::ColIndex(var_index), 0.0);
+    }
+  }
+  linear_program_.SetObjectiveOffset(0.0);
+}
 
 int64 GLOPInterface::iterations() const {
-  return lp_solver_.GetNumberOfSimplexIterations();
+  return solved_lp_solver_->GetNumberOfSimplexIterations();
 }
 
 int64 GLOPInterface::nodes() const {
@@ -324,36 +588,50 @@ std::string GLOPInterface::SolverVersion() const {
   return "Glop-0.0";
 }
 
-void* GLOPInterface::underlying_solver() { return &lp_solver_; }
+void* GLOPInterface::underlying_solver() { return solved_lp_solver_; }
 
 void GLOPInterface::ExtractNewVariables() {
-  DCHECK_EQ(0, last_variable_index_);
-  DCHECK_EQ(0, last_constraint_index_);
-
   const glop::ColIndex num_cols(solver_->variables_.size());
   for (glop::ColIndex col(last_variable_index_); col < num_cols; ++col) {
     MPVariable* const var = solver_->variables_[col.value()];
-    const glop::ColIndex new_col =
-        linear_program_.FindOrCreateVariable(var->name());
+    const glop::ColIndex new_col = linear_program_.CreateNewVariable();
     DCHECK_EQ(new_col, col);
+    // Unnamed variables of solvers with lazy names keep the default glop name.
+    if (!var->name_.empty()) linear_program_.SetVariableName(col, var->name_);
     var->set_index(col.value());
     linear_program_.SetVariableBounds(col, var->lb(), var->ub());
   }
+
+  // Adds the new variables to the already extracted constraints.
+  if (num_cols > last_variable_index_) {
+    for (int i = 0; i < last_constraint_index_; ++i) {
+      MPConstraint* const ct = solver_->constraints_[i];
+      for (CoeffEntry entry : ct->coefficients_) {
+        const int var_index = entry.first->index();
+        DCHECK_NE(kNoIndex, var_index);
+        if (var_index >= last_variable_index_) {
+          linear_program_.SetCoefficient(glop::RowIndex(ct->index()),
+                                         glop::ColIndex(var_index),
+                                         entry.second);
+        }
+      }
+    }
+  }
 }
 
 void GLOPInterface::ExtractNewConstraints() {
-  DCHECK_EQ(0, last_constraint_index_);
-
   const glop::RowIndex num_rows(solver_->constraints_.size());
-  for (glop::RowIndex row(0); row < num_rows; ++row) {
+  // When nothing was extracted yet, the whole matrix is built at once.
+  glop::SparseMatrixBuilder triplets;
+  for (glop::RowIndex row(last_constraint_index_); row < num_rows; ++row) {
     MPConstraint* const ct = solver_->constraints_[row.value()];
     ct->set_index(row.value());
 
     const double lb = ct->lb();
     const double ub = ct->ub();
-    const glop::RowIndex new_row =
-        linear_program_.FindOrCreateConstraint(ct->name());
+    const glop::RowIndex new_row = linear_program_.CreateNewConstraint();
     DCHECK_EQ(new_row, row);
+    if (!ct->name_.empty()) linear_program_.SetConstraintName(row, ct->name_);
     linear_program_.SetConstraintBounds(row, lb, ub);
 
     for (CoeffEntry entry : ct->coefficients_) {
@@ -361,9 +639,16 @@ void GLOPInterface::ExtractNewConstraints() {
       DCHECK_NE(kNoIndex, var_index);
       const glop::ColIndex col(var_index);
       const double coeff = entry.second;
-      linear_program_.SetCoefficient(row, col, coeff);
+      if (last_constraint_index_ == 0) {
+        triplets.AddEntry(row, col, coeff);
+      } else {
+        linear_program_.SetCoefficient(row, col, coeff);
+      }
     }
   }
+  if (last_constraint_index_ == 0) {
+    linear_program_.PopulateMatrixFromTriplets(&triplets);
+  }
 }
 
 void GLOPInterface::ExtractObjective() {
@@ -441,7 +726,11 @@ void GLOPInterface::SetScalingMode(int value) {
 }
 
 void GLOPInterface::SetLpAlgorithm(int value) {
+  concurrent_ = false;
   switch (value) {
+    case MPSolverParameters::CONCURRENT:
+      concurrent_ = true;
+      break;
     case MPSolverParameters::DUAL:
       parameters_.set_use_dual_simplex(true);
       break;
@@ -466,9 +755,44 @@ bool GLOPInterface::ReadParameterFile(const std::string& filename) {
   return ok;
 }
 
-void GLOPInterface::NonIncrementalChange() {
-  // The current implementation is not incremental.
-  sync_status_ = MUST_RELOAD;
+bool GLOPInterface::InterruptSolve() {
+  interrupt_solver_ = true;
+  return true;
+}
+
+bool GLOPInterface::SolveVariants(
+    const MPSolverParameters& param,
+    const std::vector<MPModelVariant>& variants, int num_threads,
+    std::vector<MPModelVariantSolution>* solutions) {
+  // Solve() left the model in linear_program_, its basis in
+  // variable_statuses_ and constraint_statuses_, and its parameters in
+  // parameters_.
+  GlopVariants data;
+  data.model = &linear_program_;
+  data.parameters = parameters_;
+  if (!variable_statuses_.empty()) {
+    data.parameters.set_use_preprocessing(false);
+  }
+  data.variable_statuses = &variable_statuses_;
+  data.constraint_statuses = &constraint_statuses_;
+  data.interrupt = &interrupt_solver_;
+  data.variants = &variants;
+  data.solutions = solutions;
+  const int num_workers =
+      std::max(1, std::min(num_threads, static_cast<int>(variants.size())));
+  if (num_workers == 1) {
+    SolveGlopVariants(&data, 0, 1);
+  } else {
+    ThreadPool pool("GlopVariants", num_workers);
+    for (int w = 0; w < num_workers; ++w) {
+      pool.Add(NewCallback(&SolveGlopVariants,
+                           static_cast<const GlopVariants*>(&data), w,
+                           num_workers));
+    }
+    pool.StartWorkers();
+  }
+  interrupt_solver_ = false;
+  return true;
 }
 
 // Register GLOP in the global linear solver factory.
@@ -565,7 +565,7 @@ void GurobiInterface::SetScalingMode(int value) {
   }
 }
 
-// Sets the LP algorithm : primal, dual or barrier. Note that GRB
+// Sets the LP algorithm : primal, dual, barrier or concurrent. Note that GRB
 // offers automatic selection
 void GurobiInterface::SetLpAlgorithm(int value) {
   switch (value) {
@@ -581,6 +581,10 @@ void GurobiInterface::SetLpAlgorithm(int value) {
       CHECKED_GUROBI_CALL(GRBsetintparam(GRBgetenv(model_), GRB_INT_PAR_METHOD,
                                          GRB_METHOD_BARRIER));
       break;
+    case MPSolverParameters::CONCURRENT:
+      CHECKED_GUROBI_CALL(GRBsetintparam(GRBgetenv(model_), GRB_INT_PAR_METHOD,
+                                         GRB_METHOD_CONCURRENT));
+      break;
     default:
       SetIntegerParamToUnsupportedValue(MPSolverParameters::LP_ALGORITHM,
                                         value);
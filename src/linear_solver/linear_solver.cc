@@ -20,6 +20,7 @@
 #endif
 
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <utility>
@@ -32,6 +33,7 @@
 #include "base/file.h"
 #include "base/map_util.h"
 #include "base/stl_util.h"
+#include "base/threadpool.h"
 #include "base/hash.h"
 #include "base/accurate_sum.h"
 #include "linear_solver/linear_solver2.pb.h"
@@ -47,6 +49,9 @@ DEFINE_bool(verify_solution, false,
 DEFINE_bool(log_verification_errors, true,
             "If --verify_solution is set: LOG(ERROR) all errors detected"
             " during the verification of the solution.");
+DEFINE_int32(linear_solver_max_loading_threads, 8,
+             "Maximum number of threads used to validate large models in "
+             "MPSolver::LoadModelFromProto().");
 DEFINE_bool(linear_solver_enable_verbose_output, false,
             "If set, enables verbose output for the solver. Setting this flag"
             " is the same as calling MPSolver::EnableOutput().");
@@ -63,17 +68,65 @@ using new_proto::MPModelProto;
 using new_proto::MPModelRequest;
 using new_proto::MPSolutionResponse;
 
+// ----- CoeffMap -----
+
+int CoeffMap::FindIndex(const MPVariable* const var) const {
+  if (index_ == nullptr) {
+    if (entries_.size() <= kMaxSizeWithoutIndex) {
+      for (int i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].first == var) return i;
+      }
+      return -1;
+    }
+    index_.reset(new hash_map<const MPVariable*, int>(entries_.size()));
+    for (int i = 0; i < entries_.size(); ++i) {
+      (*index_)[entries_[i].first] = i;
+    }
+  }
+  return FindWithDefault(*index_, var, -1);
+}
+
+double* CoeffMap::FindOrNull(const MPVariable* const var) {
+  const int index = FindIndex(var);
+  return index == -1 ? NULL : &entries_[index].second;
+}
+
+const double* CoeffMap::FindOrNull(const MPVariable* const var) const {
+  const int index = FindIndex(var);
+  return index == -1 ? NULL : &entries_[index].second;
+}
+
+void CoeffMap::Add(const MPVariable* const var, double coeff) {
+  if (index_ != nullptr) {
+    (*index_)[var] = entries_.size();
+  }
+  entries_.push_back(std::make_pair(var, coeff));
+}
+
+void CoeffMap::clear() {
+  entries_.clear();
+  index_.reset();
+}
+
+// ----- MPConstraint -----
+
+const std::string& MPConstraint::name() const {
+  if (name_.empty()) name_ = StringPrintf("auto_c_%09d", solver_position_);
+  return name_;
+}
+
 double MPConstraint::GetCoefficient(const MPVariable* const var) const {
   DLOG_IF(DFATAL, !interface_->solver_->OwnsVariable(var)) << var;
   if (var == NULL) return 0.0;
-  return FindWithDefault(coefficients_, var, 0.0);
+  const double* const coeff = coefficients_.FindOrNull(var);
+  return coeff == NULL ? 0.0 : *coeff;
 }
 
 void MPConstraint::SetCoefficient(const MPVariable* const var, double coeff) {
   DLOG_IF(DFATAL, !interface_->solver_->OwnsVariable(var)) << var;
   if (var == NULL) return;
+  double* const current = coefficients_.FindOrNull(var);
   if (coeff == 0.0) {
-    CoeffMap::iterator it = coefficients_.find(var);
     // If setting a coefficient to 0 when this coefficient did not
     // exist or was already 0, do nothing: skip
     // interface_->SetCoefficient() and do not store a coefficient in
@@ -81,18 +134,20 @@ void MPConstraint::SetCoefficient(const MPVariable* const var, double coeff) {
     // and was not 0, we do have to keep a 0 in the coefficients_ map,
     // because the extraction of the constraint might rely on it,
     // depending on the underlying solver.
-    if (it != coefficients_.end() && it->second != 0.0) {
-      const double old_value = it->second;
-      it->second = 0.0;
+    if (current != NULL && *current != 0.0) {
+      const double old_value = *current;
+      *current = 0.0;
       interface_->SetCoefficient(this, var, 0.0, old_value);
     }
     return;
   }
-  std::pair<CoeffMap::iterator, bool> insertion_result =
-      coefficients_.insert(std::make_pair(var, coeff));
-  const double old_value =
-      insertion_result.second ? 0.0 : insertion_result.first->second;
-  insertion_result.first->second = coeff;
+  double old_value = 0.0;
+  if (current == NULL) {
+    coefficients_.Add(var, coeff);
+  } else {
+    old_value = *current;
+    *current = coeff;
+  }
   interface_->SetCoefficient(this, var, coeff, old_value);
 }
 
@@ -153,20 +208,23 @@ bool MPConstraint::ContainsNewVariables() {
 double MPObjective::GetCoefficient(const MPVariable* const var) const {
   DLOG_IF(DFATAL, !interface_->solver_->OwnsVariable(var)) << var;
   if (var == NULL) return 0.0;
-  return FindWithDefault(coefficients_, var, 0.0);
+  const double* const coeff = coefficients_.FindOrNull(var);
+  return coeff == NULL ? 0.0 : *coeff;
 }
 
 void MPObjective::SetCoefficient(const MPVariable* const var, double coeff) {
   DLOG_IF(DFATAL, !interface_->solver_->OwnsVariable(var)) << var;
   if (var == NULL) return;
+  double* const current = coefficients_.FindOrNull(var);
   if (coeff == 0.0) {
-    CoeffMap::iterator it = coefficients_.find(var);
     // See the discussion on MPConstraint::SetCoefficient() for 0 coefficients,
     // the same reasoning applies here.
-    if (it == coefficients_.end() || it->second == 0.0) return;
-    it->second = 0.0;
+    if (current == NULL || *current == 0.0) return;
+    *current = 0.0;
+  } else if (current == NULL) {
+    coefficients_.Add(var, coeff);
   } else {
-    coefficients_[var] = coeff;
+    *current = coeff;
   }
   interface_->SetObjectiveCoefficient(var, coeff);
 }
@@ -213,6 +271,11 @@ double MPObjective::BestBound() const {
 
 // ----- MPVariable -----
 
+const std::string& MPVariable::name() const {
+  if (name_.empty()) name_ = StringPrintf("auto_v_%09d", solver_position_);
+  return name_;
+}
+
 double MPVariable::solution_value() const {
   if (!interface_->CheckSolutionIsSynchronizedAndExists()) return 0.0;
   return integer_ ? round(solution_value_) : solution_value_;
@@ -421,10 +484,9 @@ int NumDigits(int n) {
 MPSolver::MPSolver(const std::string& name, OptimizationProblemType problem_type)
     : name_(name),
       problem_type_(problem_type),
-#if !defined(_MSC_VER)
-      variable_name_to_index_(1),
-      constraint_name_to_index_(1),
-#endif
+      variable_name_to_index_(new hash_map<std::string, int>()),
+      constraint_name_to_index_(new hash_map<std::string, int>()),
+      lazy_names_(false),
       time_limit_(0.0),
       var_and_constraint_names_allow_export_(true) {
   timer_.Restart();
@@ -469,25 +531,146 @@ bool MPSolver::SupportsProblemType(OptimizationProblemType problem_type) {
     return false;
 }
 
+namespace {
+// Returns a map from the names of the given variables or constraints to
+// their index in 'objects'.
+template <class T>
+hash_map<std::string, int>* BuildNameIndex(const std::vector<T*>& objects) {
+  hash_map<std::string, int>* const name_to_index =
+      new hash_map<std::string, int>();
+  for (int i = 0; i < objects.size(); ++i) {
+    InsertOrDie(name_to_index, objects[i]->name(), i);
+  }
+  return name_to_index;
+}
+}  // namespace
+
 MPVariable* MPSolver::LookupVariableOrNull(const std::string& var_name) const {
+  if (variable_name_to_index_ == nullptr) {
+    variable_name_to_index_.reset(BuildNameIndex(variables_));
+  }
   hash_map<std::string, int>::const_iterator it =
-      variable_name_to_index_.find(var_name);
-  if (it == variable_name_to_index_.end()) return NULL;
+      variable_name_to_index_->find(var_name);
+  if (it == variable_name_to_index_->end()) return NULL;
   return variables_[it->second];
 }
 
 MPConstraint* MPSolver::LookupConstraintOrNull(const std::string& constraint_name)
     const {
+  if (constraint_name_to_index_ == nullptr) {
+    constraint_name_to_index_.reset(BuildNameIndex(constraints_));
+  }
   hash_map<std::string, int>::const_iterator it =
-      constraint_name_to_index_.find(constraint_name);
-  if (it == constraint_name_to_index_.end()) return NULL;
+      constraint_name_to_index_->find(constraint_name);
+  if (it == constraint_name_to_index_->end()) return NULL;
   return constraints_[it->second];
 }
 
+void MPSolver::EnableLazyNames() {
+  CHECK(variables_.empty() && constraints_.empty())
+      << "EnableLazyNames() must be called on an empty model.";
+  lazy_names_ = true;
+  variable_name_to_index_.reset();
+  constraint_name_to_index_.reset();
+}
+
 // ----- Methods using protocol buffers -----
 
+namespace {
+// Validates the constraints [begin, end) of 'model', whose variables are
+// numbered from 0 to num_variables - 1. Sets *first_invalid to the first
+// constraint whose var_index and coefficient sizes differ, or which refers to
+// an unknown variable, or to -1 if there is none. Sets has_duplicates[i] to
+// true iff the constraint i refers to the same variable several times.
+// Called in parallel on large models by MPSolver::LoadModelFromProto().
+void ValidateConstraintProtos(const MPModelProto* model, int num_variables,
+                              int begin, int end, bool* has_duplicates,
+                              int* first_invalid) {
+  *first_invalid = -1;
+  // last_seen[v] is the last constraint that referred to the variable v.
+  std::vector<int> last_seen(num_variables, -1);
+  for (int i = begin; i < end; ++i) {
+    const new_proto::MPConstraintProto& ct_proto = model->constraint(i);
+    if (ct_proto.var_index_size() != ct_proto.coefficient_size()) {
+      *first_invalid = i;
+      return;
+    }
+    has_duplicates[i] = false;
+    for (int j = 0; j < ct_proto.var_index_size(); ++j) {
+      const int var_index = ct_proto.var_index(j);
+      if (var_index < 0 || var_index >= num_variables) {
+        *first_invalid = i;
+        return;
+      }
+      if (last_seen[var_index] == i) {
+        has_duplicates[i] = true;
+      }
+      last_seen[var_index] = i;
+    }
+  }
+}
+}  // namespace
+
 MPSolver::LoadStatus MPSolver::LoadModelFromProto(
     const new_proto::MPModelProto& input_model) {
+  // The constraints are validated first, in parallel on large models, so
+  // that nothing is loaded from an invalid model.
+  const int kMinTermsPerThread = 500000;
+  const int num_variables = variables_.size() + input_model.variable_size();
+  const int num_constraints = input_model.constraint_size();
+  int64 num_terms = 0;
+  for (int i = 0; i < num_constraints; ++i) {
+    num_terms += input_model.constraint(i).var_index_size();
+  }
+  const int num_threads = std::max<int64>(
+      1, std::min<int64>(FLAGS_linear_solver_max_loading_threads,
+                         num_terms / kMinTermsPerThread));
+  std::unique_ptr<bool[]> has_duplicates(new bool[num_constraints]);
+  int first_invalid = -1;
+  if (num_threads == 1) {
+    ValidateConstraintProtos(&input_model, num_variables, 0, num_constraints,
+                             has_duplicates.get(), &first_invalid);
+  } else {
+    const int constraints_per_thread =
+        (num_constraints + num_threads - 1) / num_threads;
+    std::vector<int> first_invalid_per_task(num_threads, -1);
+    {
+      ThreadPool pool("MPModelValidation", num_threads);
+      int task = 0;
+      for (int begin = 0; begin < num_constraints;
+           begin += constraints_per_thread) {
+        pool.Add(NewCallback(
+            &ValidateConstraintProtos, &input_model, num_variables, begin,
+            std::min(begin + constraints_per_thread, num_constraints),
+            has_duplicates.get(), &first_invalid_per_task[task]));
+        ++task;
+      }
+      pool.StartWorkers();
+    }
+    for (const int task_first_invalid : first_invalid_per_task) {
+      if (task_first_invalid != -1) {
+        first_invalid = task_first_invalid;
+        break;
+      }
+    }
+  }
+  if (first_invalid != -1) {
+    const new_proto::MPConstraintProto& ct_proto =
+        input_model.constraint(first_invalid);
+    if (ct_proto.var_index_size() != ct_proto.coefficient_size()) {
+      LOG(ERROR) << "In constraint #" << first_invalid << " (name: '"
+                 << ct_proto.name() << "'):"
+                 << " var_index_size() != coefficient_size()"
+                 << ct_proto.DebugString();
+    } else {
+      LOG(ERROR) << "Variable index out of bound in constraint named "
+                 << ct_proto.name() << ".";
+    }
+    // TODO(user): add new error type to MPSolver and return it for the size
+    // mismatch.
+    return MPSolver::UNKNOWN_VARIABLE_ID;
+  }
+
   MPObjective* const objective = MutableObjective();
   for (int i = 0; i < input_model.variable_size(); ++i) {
     const new_proto::MPVariableProto& var_proto = input_model.variable(i);
@@ -502,32 +685,36 @@ MPSolver::LoadStatus MPSolver::LoadModelFromProto(
     MPVariable* variable = MakeNumVar(var_proto.lower_bound(),
                                       var_proto.upper_bound(), /*name=*/"");
     variable->SetInteger(var_proto.is_integer());
-    objective->SetCoefficient(variable, var_proto.objective_coefficient());
+    // The variable is new: its term is added without looking it up.
+    const double coeff = var_proto.objective_coefficient();
+    if (coeff != 0.0) {
+      objective->coefficients_.Add(variable, coeff);
+      interface_->SetObjectiveCoefficient(variable, coeff);
+    }
   }
 
-  for (int i = 0; i < input_model.constraint_size(); ++i) {
+  for (int i = 0; i < num_constraints; ++i) {
     const new_proto::MPConstraintProto& ct_proto = input_model.constraint(i);
     MPConstraint* const ct = MakeRowConstraint(
         ct_proto.lower_bound(), ct_proto.upper_bound(), ct_proto.name());
     ct->set_is_lazy(ct_proto.is_lazy());
-    if (ct_proto.var_index_size() != ct_proto.coefficient_size()) {
-      LOG(ERROR) << "In constraint #" << i << " (name: '" << ct_proto.name()
-                 << "'):"
-                 << " var_index_size() != coefficient_size()"
-                 << ct_proto.DebugString();
-      // TODO(user): add new error type to MPSolver and return it here.
-      // TODO(user): add unit test of this error.
-      return MPSolver::UNKNOWN_VARIABLE_ID;
+    if (has_duplicates[i]) {
+      // SetCoefficient() keeps the last coefficient of each variable.
+      for (int j = 0; j < ct_proto.var_index_size(); ++j) {
+        ct->SetCoefficient(variables_[ct_proto.var_index(j)],
+                           ct_proto.coefficient(j));
+      }
+      continue;
     }
+    // The terms are appended as they are, without building the index of the
+    // variables of the constraint.
+    ct->coefficients_.reserve(ct_proto.var_index_size());
     for (int j = 0; j < ct_proto.var_index_size(); ++j) {
-      if (ct_proto.var_index(j) >= variables_.size() ||
-          ct_proto.var_index(j) < 0) {
-        LOG(ERROR) << "Variable index out of bound in constraint named "
-                   << ct_proto.name() << ".";
-        return MPSolver::UNKNOWN_VARIABLE_ID;
-      }
-      ct->SetCoefficient(variables_[ct_proto.var_index(j)],
-                         ct_proto.coefficient(j));
+      const double coeff = ct_proto.coefficient(j);
+      if (coeff == 0.0) continue;
+      const MPVariable* const variable = variables_[ct_proto.var_index(j)];
+      ct->coefficients_.Add(variable, coeff);
+      interface_->SetCoefficient(ct, variable, coeff, 0.0);
     }
   }
   objective->SetOptimizationDirection(input_model.maximize());
@@ -726,9 +913,15 @@ void MPSolver::Clear() {
   STLDeleteElements(&variables_);
   STLDeleteElements(&constraints_);
   variables_.clear();
-  variable_name_to_index_.clear();
   constraints_.clear();
-  constraint_name_to_index_.clear();
+  if (lazy_names_) {
+    variable_name_to_index_.reset();
+    constraint_name_to_index_.reset();
+  } else {
+    variable_name_to_index_->clear();
+    constraint_name_to_index_->clear();
+  }
+  ClearSolveStartingPoint();
   interface_->Reset();
 }
 
@@ -740,17 +933,43 @@ void MPSolver::SuppressOutput() { interface_->set_quiet(true); }
 
 bool MPSolver::InterruptSolve() { return interface_->InterruptSolve(); }
 
+void MPSolver::SetHint(
+    const std::vector<std::pair<MPVariable*, double> >& hint) {
+  for (const std::pair<MPVariable*, double>& var_value : hint) {
+    CHECK(OwnsVariable(var_value.first));
+  }
+  solution_hint_ = hint;
+}
+
+void MPSolver::SetStartingBasis(
+    const std::vector<BasisStatus>& variable_statuses,
+    const std::vector<BasisStatus>& constraint_statuses) {
+  starting_variable_statuses_ = variable_statuses;
+  starting_constraint_statuses_ = constraint_statuses;
+}
+
+void MPSolver::ClearSolveStartingPoint() {
+  solution_hint_.clear();
+  starting_variable_statuses_.clear();
+  starting_constraint_statuses_.clear();
+}
+
 MPVariable* MPSolver::MakeVar(double lb, double ub, bool integer,
                               const std::string& name) {
   const int var_index = NumVariables();
+  // With lazy names, unnamed variables get their default name from name().
   const std::string fixed_name =
-      name.empty() ? StringPrintf("auto_v_%09d", var_index) : name;
-  if (var_and_constraint_names_allow_export_) {
+      name.empty() && !lazy_names_ ? StringPrintf("auto_v_%09d", var_index)
+                                   : name;
+  if (var_and_constraint_names_allow_export_ && !fixed_name.empty()) {
     var_and_constraint_names_allow_export_ &=
         MPModelProtoExporter::CheckNameValidity(fixed_name);
   }
-  InsertOrDie(&variable_name_to_index_, fixed_name, var_index);
-  MPVariable* v = new MPVariable(lb, ub, integer, fixed_name, interface_.get());
+  MPVariable* v =
+      new MPVariable(var_index, lb, ub, integer, fixed_name, interface_.get());
+  if (variable_name_to_index_ != nullptr) {
+    InsertOrDie(variable_name_to_index_.get(), v->name(), var_index);
+  }
   variables_.push_back(v);
   interface_->AddVariable(v);
   return v;
@@ -809,15 +1028,21 @@ MPConstraint* MPSolver::MakeRowConstraint() {
 MPConstraint* MPSolver::MakeRowConstraint(double lb, double ub,
                                           const std::string& name) {
   const int constraint_index = NumConstraints();
+  // With lazy names, unnamed constraints get their default name from name().
   const std::string fixed_name =
-      name.empty() ? StringPrintf("auto_c_%09d", constraint_index) : name;
-  if (var_and_constraint_names_allow_export_) {
+      name.empty() && !lazy_names_
+          ? StringPrintf("auto_c_%09d", constraint_index)
+          : name;
+  if (var_and_constraint_names_allow_export_ && !fixed_name.empty()) {
     var_and_constraint_names_allow_export_ &=
         MPModelProtoExporter::CheckNameValidity(fixed_name);
   }
-  InsertOrDie(&constraint_name_to_index_, fixed_name, constraint_index);
-  MPConstraint* const constraint =
-      new MPConstraint(lb, ub, fixed_name, interface_.get());
+  MPConstraint* const constraint = new MPConstraint(
+      constraint_index, lb, ub, fixed_name, interface_.get());
+  if (constraint_name_to_index_ != nullptr) {
+    InsertOrDie(constraint_name_to_index_.get(), constraint->name(),
+                constraint_index);
+  }
   constraints_.push_back(constraint);
   interface_->AddRowConstraint(constraint);
   return constraint;
@@ -865,11 +1090,12 @@ MPSolver::ResultStatus MPSolver::Solve(const MPSolverParameters& param) {
   // the same behavior.
   if (HasInfeasibleConstraints()) {
     interface_->result_status_ = MPSolver::INFEASIBLE;
+    ClearSolveStartingPoint();
     return interface_->result_status_;
   }
 
-
   MPSolver::ResultStatus status = interface_->Solve(param);
+  ClearSolveStartingPoint();
   if (FLAGS_verify_solution) {
     if (status != MPSolver::OPTIMAL) {
       VLOG(1) << "--verify_solution enabled, but the solver did not find an"
@@ -885,6 +1111,89 @@ MPSolver::ResultStatus MPSolver::Solve(const MPSolverParameters& param) {
   return status;
 }
 
+namespace {
+// Sets the objective coefficients and the variable bounds of 'solver' to the
+// ones of 'variant', or to the given ones where the variant keeps the model
+// values. Only the values that change are given to the underlying solver.
+void ApplyVariant(const MPModelVariant& variant,
+                  const std::vector<double>& objective_coefficients,
+                  const std::vector<double>& lower_bounds,
+                  const std::vector<double>& upper_bounds, MPSolver* solver) {
+  const std::vector<double>& coefficients =
+      variant.objective_coefficients.empty() ? objective_coefficients
+                                             : variant.objective_coefficients;
+  const std::vector<double>& lbs = variant.variable_lower_bounds.empty()
+                                       ? lower_bounds
+                                       : variant.variable_lower_bounds;
+  const std::vector<double>& ubs = variant.variable_upper_bounds.empty()
+                                       ? upper_bounds
+                                       : variant.variable_upper_bounds;
+  MPObjective* const objective = solver->MutableObjective();
+  for (int i = 0; i < solver->NumVariables(); ++i) {
+    MPVariable* const var = solver->variables()[i];
+    if (objective->GetCoefficient(var) != coefficients[i]) {
+      objective->SetCoefficient(var, coefficients[i]);
+    }
+    var->SetBounds(lbs[i], ubs[i]);
+  }
+}
+}  // namespace
+
+void MPSolver::SolveVariants(const std::vector<MPModelVariant>& variants,
+                             const MPSolverParameters& param, int num_threads,
+                             std::vector<MPModelVariantSolution>* solutions) {
+  CHECK(solutions != nullptr);
+  const int num_variables = NumVariables();
+  for (const MPModelVariant& variant : variants) {
+    CHECK(variant.objective_coefficients.empty() ||
+          variant.objective_coefficients.size() == num_variables);
+    CHECK(variant.variable_lower_bounds.empty() ||
+          variant.variable_lower_bounds.size() == num_variables);
+    CHECK(variant.variable_upper_bounds.empty() ||
+          variant.variable_upper_bounds.size() == num_variables);
+  }
+  solutions->assign(variants.size(), MPModelVariantSolution());
+  Solve(param);
+  if (HasInfeasibleConstraints()) {
+    // The constraints are the same in all the variants.
+    for (MPModelVariantSolution& solution : *solutions) {
+      solution.status = MPSolver::INFEASIBLE;
+    }
+    return;
+  }
+  if (interface_->SolveVariants(param, variants, num_threads, solutions)) {
+    return;
+  }
+
+  std::vector<double> objective_coefficients(num_variables);
+  std::vector<double> lower_bounds(num_variables);
+  std::vector<double> upper_bounds(num_variables);
+  for (int i = 0; i < num_variables; ++i) {
+    objective_coefficients[i] = objective_->GetCoefficient(variables_[i]);
+    lower_bounds[i] = variables_[i]->lb();
+    upper_bounds[i] = variables_[i]->ub();
+  }
+  for (int v = 0; v < variants.size(); ++v) {
+    ApplyVariant(variants[v], objective_coefficients, lower_bounds,
+                 upper_bounds, this);
+    MPModelVariantSolution* const solution = &(*solutions)[v];
+    solution->status = Solve(param);
+    if (solution->status == MPSolver::OPTIMAL ||
+        solution->status == MPSolver::FEASIBLE) {
+      solution->objective_value = objective_->Value();
+      solution->variable_values.resize(num_variables);
+      for (int i = 0; i < num_variables; ++i) {
+        solution->variable_values[i] = variables_[i]->solution_value();
+      }
+    }
+  }
+  if (!variants.empty()) {
+    ApplyVariant(MPModelVariant(), objective_coefficients, lower_bounds,
+                 upper_bounds, this);
+    Solve(param);
+  }
+}
+
 namespace {
 std::string PrettyPrintVar(const MPVariable& var) {
   const std::string prefix = "Variable '" + var.name() + "': domain = ";
@@ -1091,13 +1400,9 @@ double MPSolver::ComputeExactConditionNumber() const {
 
 bool MPSolver::OwnsVariable(const MPVariable* var) const {
   if (var == NULL) return false;
-  // First, verify that a variable with the same name exists, and look up
-  // its index (names are unique, so there can be only one).
-  const int var_index =
-      FindWithDefault(variable_name_to_index_, var->name(), -1);
-  if (var_index == -1) return false;
-  // Then, verify that the variable with this index has the same address.
-  return variables_[var_index] == var;
+  // The variable at the position of 'var' must have the same address.
+  const int var_index = var->solver_position_;
+  return var_index < variables_.size() && variables_[var_index] == var;
 }
 
 bool MPSolver::ExportModelAsLpFormat(bool obfuscate, std::string* output) {
@@ -1364,7 +1669,8 @@ void MPSolverParameters::SetIntegerParam(MPSolverParameters::IntegerParam param,
       break;
     }
     case LP_ALGORITHM: {
-      if (value != DUAL && value != PRIMAL && value != BARRIER) {
+      if (value != DUAL && value != PRIMAL && value != BARRIER &&
+          value != CONCURRENT) {
         LOG(ERROR) << "Trying to set a supported parameter: " << param
                    << " to an unknown value: " << value;
       }
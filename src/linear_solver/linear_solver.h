@@ -152,6 +152,8 @@ class MPObjective;
 class MPSolverInterface;
 class MPSolverParameters;
 class MPVariable;
+struct MPModelVariant;
+struct MPModelVariantSolution;
 
 // The new MP protocol buffer format. New clients that want to work with
 // protocol buffers should use this.
@@ -338,6 +340,23 @@ class MPSolver {
   // using this method directly.
   bool VerifySolution(double tolerance, bool log_errors) const;
 
+#if !defined(SWIG)
+  // Advanced usage: solves variants of the model that only differ by their
+  // objective coefficients or variable bounds, e.g. for a sensitivity or
+  // scenario analysis, and stores the solution of variants[i] in
+  // (*solutions)[i]. The model itself is solved first, and the variants are
+  // warm-started from its solution, without rebuilding the model:
+  // - With GLOP, each variant starts from the basis of the model, and the
+  //   variants are solved in parallel on up to num_threads threads.
+  // - With the other solvers, the variants are solved one after the other,
+  //   each one starting from the solution of the previous one, and
+  //   num_threads is ignored.
+  // Afterwards, the model is unchanged and holds its own solution.
+  void SolveVariants(const std::vector<MPModelVariant>& variants,
+                     const MPSolverParameters& param, int num_threads,
+                     std::vector<MPModelVariantSolution>* solutions);
+#endif  // SWIG
+
   // Advanced usage: resets extracted model to solve from scratch. This won't
   // reset the parameters that were set with
   // SetSolverSpecificParametersAsString() or set_time_limit() or even clear the
@@ -375,7 +394,9 @@ class MPSolver {
   // Note(user): This creates a temporary MPSolver and destroys it at the
   // end. If you want to keep the MPSolver alive (for debugging, or for
   // incremental solving), you should write another version of this function
-  // that creates the MPSolver object on the heap and returns it.
+  // that creates the MPSolver object on the heap and returns it. To solve many
+  // requests, see MPSolveService in ./solve_service.h, which reuses its
+  // solvers and solves the requests asynchronously.
   static void SolveWithProto(const new_proto::MPModelRequest& model_request,
                              new_proto::MPSolutionResponse* response);
 
@@ -444,6 +465,25 @@ class MPSolver {
     BASIC
   };
 
+#if !defined(SWIG)
+  // Advanced usage: gives a solution for the next Solve() to start from, as
+  // (variable, value) pairs. It is only used by BOP for now, which starts its
+  // search from it when it gives a value to every variable and is feasible.
+  // The hint is only used by the next Solve(), and is dropped by Clear().
+  void SetHint(const std::vector<std::pair<MPVariable*, double> >& hint);
+
+  // Advanced usage: gives the basis for the next Solve() to start from, with
+  // the status of the variables and of the constraints, e.g. the values of
+  // column_status() and row_status() after solving a similar model. Variables
+  // and constraints without a status start at one of their bounds and basic,
+  // respectively. It is only used by GLOP for now, for which it replaces the
+  // basis of the previous solve; as presolve would change the problem to
+  // which the basis applies, it is disabled for that solve. The basis is only
+  // used by the next Solve(), and is dropped by Clear().
+  void SetStartingBasis(const std::vector<BasisStatus>& variable_statuses,
+                        const std::vector<BasisStatus>& constraint_statuses);
+#endif  // SWIG
+
   // Infinity. You can use -MPSolver::infinity() for negative infinity.
   static double infinity() { return std::numeric_limits<double>::infinity(); }
 
@@ -488,6 +528,15 @@ class MPSolver {
     return var_and_constraint_names_allow_export_;
   }
 
+  // Advanced usage, for very large models: the variables and constraints
+  // created without a name only get their default name when name() is first
+  // called, and the names are only indexed (see LookupVariableOrNull()) on the
+  // first lookup by name. This saves the memory used by the default names and
+  // by the index as long as they are not needed. Duplicate names are then only
+  // detected when the index is built. Must be called before any variable or
+  // constraint is created.
+  void EnableLazyNames();
+
   // Returns a std::string describing the underlying solver and its version.
   std::string SolverVersion() const;
 
@@ -548,6 +597,9 @@ class MPSolver {
   int ComputeMaxConstraintSize(int min_constraint_index,
                                int max_constraint_index) const;
 
+  // Drops the hint and the basis given to SetHint() and SetStartingBasis().
+  void ClearSolveStartingPoint();
+
   // Returns true if the model has constraints with lower bound > upper bound.
   bool HasInfeasibleConstraints() const;
 
@@ -562,13 +614,19 @@ class MPSolver {
 
   // The vector of variables in the problem.
   std::vector<MPVariable*> variables_;
-  // A map from a variable's name to its index in variables_.
-  hash_map<std::string, int> variable_name_to_index_;
+  // A map from a variable's name to its index in variables_. With lazy names,
+  // it is NULL until the first lookup by name.
+  mutable std::unique_ptr<hash_map<std::string, int> > variable_name_to_index_;
 
   // The vector of constraints in the problem.
   std::vector<MPConstraint*> constraints_;
-  // A map from a constraint's name to its index in constraints_.
-  hash_map<std::string, int> constraint_name_to_index_;
+  // A map from a constraint's name to its index in constraints_. With lazy
+  // names, it is NULL until the first lookup by name.
+  mutable std::unique_ptr<hash_map<std::string, int> >
+      constraint_name_to_index_;
+
+  // See EnableLazyNames().
+  bool lazy_names_;
 
   // The linear objective function.
   std::unique_ptr<MPObjective> objective_;
@@ -584,27 +642,86 @@ class MPSolver {
   // Permanent storage for SetSolverSpecificParametersAsString().
   std::string solver_specific_parameter_string_;
 
+  // See SetHint() and SetStartingBasis().
+  std::vector<std::pair<MPVariable*, double> > solution_hint_;
+  std::vector<BasisStatus> starting_variable_statuses_;
+  std::vector<BasisStatus> starting_constraint_statuses_;
+
 
   DISALLOW_COPY_AND_ASSIGN(MPSolver);
 };
 
+#if !defined(SWIG)
+// A variant of the model of an MPSolver, see MPSolver::SolveVariants(). Each
+// vector is either empty, to keep the values of the model, or holds one value
+// per variable, in the order of MPSolver::variables().
+struct MPModelVariant {
+  std::vector<double> objective_coefficients;
+  std::vector<double> variable_lower_bounds;
+  std::vector<double> variable_upper_bounds;
+};
+
+// The solution of an MPModelVariant. The objective and variable values are
+// only set if the status is OPTIMAL or FEASIBLE.
+struct MPModelVariantSolution {
+  MPModelVariantSolution()
+      : status(MPSolver::NOT_SOLVED), objective_value(0.0) {}
+
+  MPSolver::ResultStatus status;
+  double objective_value;
+  std::vector<double> variable_values;
+};
+#endif  // SWIG
+
+typedef std::pair<const MPVariable*, double> CoeffEntry;
+
 #if !defined(SWIG)
 // The data structure used to store the coefficients of the contraints and of
-// the objective. Also define a type to facilitate iteration over them with:
+// the objective: the terms are kept in a vector, in insertion order, so that
+// a model loaded in bulk (see MPSolver::LoadModelFromProto()) is stored as
+// compactly as a row of a sparse matrix. The index from the variables to
+// their term is only built on the first lookup in a large map, e.g. when a
+// coefficient is set on a constraint loaded from a proto. Iteration goes
+// over CoeffEntry's, with:
 //  for (CoeffEntry entry : coefficients_) { ... }
-class CoeffMap : public hash_map<const MPVariable*, double> {
+class CoeffMap {
  public:
-  explicit CoeffMap(int num_buckets)
-#if !defined(_MSC_VER)  // Visual C++ doesn't support this constructor
-      : hash_map<const MPVariable*, double>(num_buckets)
-#endif  // _MSC_VER
-  {
-  }
+  typedef std::vector<CoeffEntry>::iterator iterator;
+  typedef std::vector<CoeffEntry>::const_iterator const_iterator;
+
+  CoeffMap() {}
+
+  int size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+
+  // Returns the coefficient of 'var', or NULL if 'var' has no term.
+  double* FindOrNull(const MPVariable* const var);
+  const double* FindOrNull(const MPVariable* const var) const;
+
+  // Adds a term for 'var', which must not have one already.
+  void Add(const MPVariable* const var, double coeff);
+
+  void reserve(int size) { entries_.reserve(size); }
+  void clear();
+
+ private:
+  // Maps with at most this many terms are searched linearly, without index.
+  static const int kMaxSizeWithoutIndex = 16;
+
+  int FindIndex(const MPVariable* const var) const;
+
+  std::vector<CoeffEntry> entries_;
+  // Position of the term of each variable in entries_, built lazily.
+  mutable std::unique_ptr<hash_map<const MPVariable*, int> > index_;
+
+  DISALLOW_COPY_AND_ASSIGN(CoeffMap);
 };
 #endif  // SWIG
 
-typedef std::pair<const MPVariable*, double> CoeffEntry;
-
 // A class to express a linear objective.
 class MPObjective {
  public:
@@ -675,7 +792,7 @@ class MPObjective {
   // At construction, an MPObjective has no terms (which is equivalent
   // on having a coefficient of 0 for all variables), and an offset of 0.
   explicit MPObjective(MPSolverInterface* const interface)
-      : interface_(interface), coefficients_(1), offset_(0.0) {}
+      : interface_(interface), offset_(0.0) {}
 
   MPSolverInterface* const interface_;
 
@@ -691,7 +808,7 @@ class MPObjective {
 class MPVariable {
  public:
   // Returns the name of the variable.
-  const std::string& name() const { return name_; }
+  const std::string& name() const;
 
   // Sets the integrality requirement of the variable.
   void SetInteger(bool integer);
@@ -746,11 +863,14 @@ class MPVariable {
   // Constructor. A variable points to a single MPSolverInterface that
   // is specified in the constructor. A variable cannot belong to
   // several models.
-  MPVariable(double lb, double ub, bool integer, const std::string& name,
-             MPSolverInterface* const interface)
+  // The position of the variable in MPSolver::variables_ is given by
+  // solver_position.
+  MPVariable(int solver_position, double lb, double ub, bool integer,
+             const std::string& name, MPSolverInterface* const interface)
       : lb_(lb),
         ub_(ub),
         integer_(integer),
+        solver_position_(solver_position),
         name_(name),
         index_(-1),
         solution_value_(0.0),
@@ -765,7 +885,10 @@ class MPVariable {
   double lb_;
   double ub_;
   bool integer_;
-  const std::string name_;
+  const int solver_position_;
+  // Empty until name() is called for unnamed variables of solvers with lazy
+  // names.
+  mutable std::string name_;
   int index_;
   double solution_value_;
   double reduced_cost_;
@@ -778,7 +901,7 @@ class MPVariable {
 class MPConstraint {
  public:
   // Returns the name of the constraint.
-  const std::string& name() const { return name_; }
+  const std::string& name() const;
 
   // Clears all variables and coefficients. Does not clear the bounds.
   void Clear();
@@ -847,11 +970,13 @@ class MPConstraint {
   // Constructor. A constraint points to a single MPSolverInterface
   // that is specified in the constructor. A constraint cannot belong
   // to several models.
-  MPConstraint(double lb, double ub, const std::string& name,
-               MPSolverInterface* const interface)
-      : coefficients_(1),
-        lb_(lb),
+  // The position of the constraint in MPSolver::constraints_ is given by
+  // solver_position.
+  MPConstraint(int solver_position, double lb, double ub,
+               const std::string& name, MPSolverInterface* const interface)
+      : lb_(lb),
         ub_(ub),
+        solver_position_(solver_position),
         name_(name),
         is_lazy_(false),
         index_(-1),
@@ -877,8 +1002,12 @@ class MPConstraint {
   // The upper bound for the linear constraint.
   double ub_;
 
-  // Name.
-  const std::string name_;
+  // The position of the constraint in MPSolver::constraints_.
+  const int solver_position_;
+
+  // Name. Empty until name() is called for unnamed constraints of solvers
+  // with lazy names.
+  mutable std::string name_;
 
   // True if the constraint is "lazy", i.e. the constraint is added to the
   // underlying Linear Programming solver only if it is violated.
@@ -949,9 +1078,11 @@ class MPSolverParameters {
   };
 
   enum LpAlgorithmValues {
-    DUAL = 10,    // Dual simplex.
-    PRIMAL = 11,  // Primal simplex.
-    BARRIER = 12  // Barrier algorithm.
+    DUAL = 10,       // Dual simplex.
+    PRIMAL = 11,     // Primal simplex.
+    BARRIER = 12,    // Barrier algorithm.
+    CONCURRENT = 13  // Several algorithms in parallel, the first one to
+                     // finish gives the solution.
   };
 
   enum IncrementalityValues {
@@ -1199,6 +1330,19 @@ class MPSolverInterface {
 
   virtual bool InterruptSolve() { return false; }
 
+#if !defined(SWIG)
+  // Solves the variants for MPSolver::SolveVariants(), which solved the model
+  // itself with the same parameters just before. Returns false if the
+  // interface doesn't implement this, in which case MPSolver solves the
+  // variants one by one, by modifying the model in place.
+  virtual bool SolveVariants(const MPSolverParameters& param,
+                             const std::vector<MPModelVariant>& variants,
+                             int num_threads,
+                             std::vector<MPModelVariantSolution>* solutions) {
+    return false;
+  }
+#endif  // SWIG
+
   friend class MPSolver;
 
   // To access the maximize_ bool and the MPSolver.
@@ -0,0 +1,186 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linear_solver/model_cache.h"
+
+#include <utility>
+
+#include "base/fingerprint2011.h"
+#include "base/logging.h"
+
+namespace operations_research {
+namespace {
+// Also checks that each constraint of b has as many coefficients as variables,
+// which LoadModelFromProto() checked for a.
+bool HaveSameStructure(const new_proto::MPModelProto& a,
+                       const new_proto::MPModelProto& b) {
+  if (a.variable_size() != b.variable_size() ||
+      a.constraint_size() != b.constraint_size()) {
+    return false;
+  }
+  for (int i = 0; i < a.variable_size(); ++i) {
+    if (a.variable(i).is_integer() != b.variable(i).is_integer()) return false;
+  }
+  for (int i = 0; i < a.constraint_size(); ++i) {
+    const new_proto::MPConstraintProto& ct_a = a.constraint(i);
+    const new_proto::MPConstraintProto& ct_b = b.constraint(i);
+    if (ct_a.is_lazy() != ct_b.is_lazy() ||
+        ct_a.var_index_size() != ct_b.var_index_size() ||
+        ct_b.coefficient_size() != ct_b.var_index_size()) {
+      return false;
+    }
+    for (int j = 0; j < ct_a.var_index_size(); ++j) {
+      if (ct_a.var_index(j) != ct_b.var_index(j)) return false;
+    }
+  }
+  return true;
+}
+
+// Gives to the solver, which has old_model loaded, the values of new_model
+// that differ. Both models must have the same structure.
+void UpdateModel(const new_proto::MPModelProto& old_model,
+                 const new_proto::MPModelProto& new_model, MPSolver* solver) {
+  MPObjective* const objective = solver->MutableObjective();
+  for (int i = 0; i < new_model.variable_size(); ++i) {
+    const new_proto::MPVariableProto& old_var = old_model.variable(i);
+    const new_proto::MPVariableProto& var_proto = new_model.variable(i);
+    MPVariable* const variable = solver->variables()[i];
+    if (var_proto.lower_bound() != old_var.lower_bound() ||
+        var_proto.upper_bound() != old_var.upper_bound()) {
+      variable->SetBounds(var_proto.lower_bound(), var_proto.upper_bound());
+    }
+    if (var_proto.objective_coefficient() != old_var.objective_coefficient()) {
+      objective->SetCoefficient(variable, var_proto.objective_coefficient());
+    }
+  }
+  for (int i = 0; i < new_model.constraint_size(); ++i) {
+    const new_proto::MPConstraintProto& old_ct = old_model.constraint(i);
+    const new_proto::MPConstraintProto& ct_proto = new_model.constraint(i);
+    MPConstraint* const ct = solver->constraints()[i];
+    if (ct_proto.lower_bound() != old_ct.lower_bound() ||
+        ct_proto.upper_bound() != old_ct.upper_bound()) {
+      ct->SetBounds(ct_proto.lower_bound(), ct_proto.upper_bound());
+    }
+    int j = 0;
+    while (j < ct_proto.coefficient_size() &&
+           ct_proto.coefficient(j) == old_ct.coefficient(j)) {
+      ++j;
+    }
+    if (j == ct_proto.coefficient_size()) continue;
+    // All the terms are set again, in order, so that the last coefficient of
+    // a variable that appears several times wins, as in LoadModelFromProto().
+    for (j = 0; j < ct_proto.var_index_size(); ++j) {
+      ct->SetCoefficient(solver->variables()[ct_proto.var_index(j)],
+                         ct_proto.coefficient(j));
+    }
+  }
+  if (new_model.maximize() != old_model.maximize()) {
+    objective->SetOptimizationDirection(new_model.maximize());
+  }
+  if (new_model.objective_offset() != old_model.objective_offset()) {
+    objective->SetOffset(new_model.objective_offset());
+  }
+}
+}  // namespace
+
+uint64 MPModelProtoStructureFingerprint(const new_proto::MPModelProto& model) {
+  uint64 fp =
+      FingerprintCat2011(model.variable_size(), model.constraint_size());
+  for (const new_proto::MPVariableProto& var_proto : model.variable()) {
+    fp = FingerprintCat2011(fp, var_proto.is_integer());
+  }
+  for (const new_proto::MPConstraintProto& ct_proto : model.constraint()) {
+    fp = FingerprintCat2011(fp, ct_proto.is_lazy());
+    fp = FingerprintCat2011(
+        fp, Fingerprint2011(
+                reinterpret_cast<const char*>(ct_proto.var_index().data()),
+                ct_proto.var_index_size() * sizeof(ct_proto.var_index(0))));
+  }
+  return fp;
+}
+
+MPModelCache::MPModelCache(int max_entries)
+    : max_entries_(max_entries), entries_(), num_hits_(0) {
+  CHECK_GT(max_entries, 0);
+}
+
+MPModelCache::~MPModelCache() {}
+
+MPSolver* MPModelCache::LoadModel(const new_proto::MPModelRequest& request,
+                                  MPSolver::LoadStatus* load_status) {
+  CHECK_NOTNULL(load_status);
+  const new_proto::MPModelProto& model = request.model();
+  const int solver_type = request.solver_type();
+  const uint64 fingerprint = MPModelProtoStructureFingerprint(model);
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->solver_type != solver_type || it->fingerprint != fingerprint ||
+        !HaveSameStructure(it->model, model)) {
+      continue;
+    }
+    UpdateModel(it->model, model, it->solver.get());
+    it->model = model;
+    entries_.splice(entries_.begin(), entries_, it);
+    ++num_hits_;
+    *load_status = MPSolver::NO_ERROR;
+    return entries_.front().solver.get();
+  }
+
+  // The solver of the evicted entry is reused if it has the right type.
+  std::unique_ptr<MPSolver> solver;
+  if (entries_.size() >= max_entries_) {
+    if (entries_.back().solver_type == solver_type) {
+      solver = std::move(entries_.back().solver);
+      solver->Clear();
+    }
+    entries_.pop_back();
+  }
+  if (solver == nullptr) {
+    solver.reset(new MPSolver(
+        "MPModelCache",
+        static_cast<MPSolver::OptimizationProblemType>(solver_type)));
+  }
+  *load_status = solver->LoadModelFromProto(model);
+  if (*load_status != MPSolver::NO_ERROR) return nullptr;
+  entries_.emplace_front();
+  Entry& entry = entries_.front();
+  entry.solver_type = solver_type;
+  entry.fingerprint = fingerprint;
+  entry.model = model;
+  entry.solver = std::move(solver);
+  return entry.solver.get();
+}
+
+void MPModelCache::Solve(const new_proto::MPModelRequest& request,
+                         new_proto::MPSolutionResponse* response) {
+  CHECK_NOTNULL(response);
+  MPSolver::LoadStatus load_status;
+  MPSolver* const solver = LoadModel(request, &load_status);
+  if (solver == nullptr) {
+    LOG(WARNING) << "Loading model from protocol buffer failed, "
+                 << "load status = "
+                 << new_proto::Error::Code_Name(
+                        static_cast<new_proto::Error::Code>(load_status))
+                 << " (" << load_status << ")";
+    response->Clear();
+    response->set_status(new_proto::MPSolutionResponse::ABNORMAL);
+    return;
+  }
+  // A cached solver keeps the time limit of its last request.
+  solver->set_time_limit(
+      request.has_solver_time_limit_seconds()
+          ? static_cast<int64>(request.solver_time_limit_seconds()) * 1000
+          : 0);
+  solver->Solve();
+  solver->FillSolutionResponseProto(response);
+}
+}  // namespace operations_research
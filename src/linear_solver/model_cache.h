@@ -0,0 +1,86 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_LINEAR_SOLVER_MODEL_CACHE_H_
+#define OR_TOOLS_LINEAR_SOLVER_MODEL_CACHE_H_
+
+#include <list>
+#include "base/unique_ptr.h"
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "linear_solver/linear_solver.h"
+#include "linear_solver/linear_solver2.pb.h"
+
+namespace operations_research {
+// Returns a fingerprint of the structure of the model: the number of
+// variables and their integrality, and the variables of each constraint and
+// whether it is lazy. Models that only differ by their bounds, coefficients,
+// objective, optimization direction and names have the same fingerprint.
+uint64 MPModelProtoStructureFingerprint(const new_proto::MPModelProto& model);
+
+// Keeps the MPSolvers of the last models solved, to solve repeated requests
+// on models with the same structure faster.
+//
+// When a request has the same solver type and the same structure as a cached
+// model (see MPModelProtoStructureFingerprint(), the structures are also
+// compared exactly), the model is not loaded again: only the bounds and
+// coefficients that changed are given to the cached MPSolver. The underlying
+// solver then reuses what it kept from its last solve. For glop, this is the
+// extracted glop::LinearProgram and the last optimal basis, from which the
+// next solve is warm-started.
+//
+// The names of the variables and constraints of a cached model are the ones
+// of the first request it was loaded from.
+//
+// This class is not thread-safe: each thread should have its own cache.
+class MPModelCache {
+ public:
+  // Keeps at most max_entries models, the least recently used ones are
+  // evicted first.
+  explicit MPModelCache(int max_entries);
+  ~MPModelCache();
+
+  // Returns an MPSolver of the solver type of the request with the model of
+  // the request loaded, or NULL if the model is invalid, in which case
+  // *load_status is set to the error. The returned solver is owned by the
+  // cache, and is valid until the next call.
+  MPSolver* LoadModel(const new_proto::MPModelRequest& request,
+                      MPSolver::LoadStatus* load_status);
+
+  // Same as MPSolver::SolveWithProto(), on the solver returned by
+  // LoadModel().
+  void Solve(const new_proto::MPModelRequest& request,
+             new_proto::MPSolutionResponse* response);
+
+  // The number of LoadModel() calls that reused a cached model.
+  int64 num_hits() const { return num_hits_; }
+
+ private:
+  struct Entry {
+    int solver_type;
+    uint64 fingerprint;
+    // The model loaded in the solver.
+    new_proto::MPModelProto model;
+    std::unique_ptr<MPSolver> solver;
+  };
+
+  const int max_entries_;
+  // The most recently used entry first.
+  std::list<Entry> entries_;
+  int64 num_hits_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPModelCache);
+};
+}  // namespace operations_research
+#endif  // OR_TOOLS_LINEAR_SOLVER_MODEL_CACHE_H_
@@ -13,16 +13,21 @@
 
 #include "linear_solver/model_exporter.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <limits>
 
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
+#include "base/file.h"
 #include "base/join.h"
 #include "base/strutil.h"
 #include "base/map_util.h"
+#include "base/threadpool.h"
+#include "base/unique_ptr.h"
 #include "linear_solver/linear_solver2.pb.h"
 #include "util/fp_utils.h"
 
@@ -37,12 +42,206 @@ DEFINE_int32(lp_max_line_length, 10000,
 DEFINE_bool(lp_log_invalid_name, false,
             "Whether to log invalid variable and contraint names.");
 
+DEFINE_int32(model_exporter_max_threads, 8,
+             "Maximum number of threads used to format the constraints of "
+             "large models exported in the lp format, and their columns in "
+             "the mps format.");
+
 namespace operations_research {
 
 using new_proto::MPConstraintProto;
 using new_proto::MPModelProto;
 using new_proto::MPVariableProto;
 
+namespace {
+// Largest numbers of characters written by FormatDouble().
+const int kDoubleBufferSize = 32;
+
+const double kPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                               1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                               1e12, 1e13, 1e14, 1e15, 1e16};
+
+// Writes value to buffer like snprintf() with the "%.<precision>G" format, or
+// "%+.<precision>G" if plus_sign is true, and returns the number of characters
+// written. The precision must be in [1, 16]. Integer values, by far the most
+// common in models, are formatted directly: "%G" prints them as integers as
+// long as they have at most 'precision' digits.
+int FormatDouble(double value, int precision, bool plus_sign, char* buffer) {
+  DCHECK_GE(precision, 1);
+  DCHECK_LE(precision, 16);
+  if (value == std::floor(value) &&
+      std::fabs(value) < kPowersOfTen[precision] &&
+      (value != 0.0 || !std::signbit(value))) {
+    int64 integer = static_cast<int64>(value);
+    char* p = buffer;
+    if (integer < 0) {
+      *p++ = '-';
+      integer = -integer;
+    } else if (plus_sign) {
+      *p++ = '+';
+    }
+    char digits[kFastToBufferSize];
+    int num_digits = 0;
+    do {
+      digits[num_digits++] = '0' + integer % 10;
+      integer /= 10;
+    } while (integer > 0);
+    while (num_digits > 0) *p++ = digits[--num_digits];
+    *p = '\0';
+    return p - buffer;
+  }
+  return snprintf(buffer, kDoubleBufferSize, plus_sign ? "%+.*G" : "%.*G",
+                  precision, value);
+}
+
+// Appends value to output, formatted with "%.16G" or "%+.16G".
+void AppendDouble(double value, bool plus_sign, std::string* output) {
+  char buffer[kDoubleBufferSize];
+  output->append(buffer, FormatDouble(value, 16, plus_sign, buffer));
+}
+
+// Appends an integral value to output, formatted with "%.0f".
+void AppendIntegralDouble(double value, std::string* output) {
+  if (std::fabs(value) < kPowersOfTen[16]) {
+    AppendDouble(value, /*plus_sign=*/false, output);
+  } else {
+    StringAppendF(output, "%.0f", value);
+  }
+}
+
+// Appends text to output, padded with spaces up to width characters, on the
+// right like "%-*s" if left_justify is true, and on the left otherwise.
+void AppendPadded(const char* text, int size, int width, bool left_justify,
+                  std::string* output) {
+  if (!left_justify && size < width) output->append(width - size, ' ');
+  output->append(text, size);
+  if (left_justify && size < width) output->append(width - size, ' ');
+}
+
+void AppendPadded(const std::string& text, int width, bool left_justify,
+                  std::string* output) {
+  AppendPadded(text.data(), text.size(), width, left_justify, output);
+}
+
+// Appends a name of the form "V00123" to output, where the number has
+// num_digits digits.
+void AppendNumberedName(char prefix, int index, int num_digits,
+                        std::string* output) {
+  char buffer[kFastToBufferSize];
+  output->push_back(prefix);
+  output->append(buffer,
+                 snprintf(buffer, kFastToBufferSize, "%0*d", num_digits,
+                          index));
+}
+
+// Accumulates the exported text in *text. If there is a sink, the text is
+// passed to it by pieces of about kFlushSize bytes, so that *text stays
+// small. The header of an optional section is only written if the section
+// is not empty.
+class ExportBuffer {
+ public:
+  ExportBuffer(MPModelProtoExporter::OutputSink* sink, std::string* text)
+      : sink_(sink), text_(text), ok_(true), header_(), section_start_(0) {
+    text_->clear();
+  }
+
+  std::string* text() { return text_; }
+
+  // Passes the text to the sink if it holds at least kFlushSize bytes, or if
+  // force is true. Returns false if the sink failed, now or before.
+  bool Flush(bool force) {
+    if (sink_ == nullptr || !ok_) return ok_;
+    if (!force && text_->size() < kFlushSize) return true;
+    WriteSectionHeaderIfNeeded();
+    ok_ = sink_->Run(text_->data(), text_->size());
+    text_->clear();
+    section_start_ = 0;
+    return ok_;
+  }
+
+  // The header is written before the text appended until EndSection(), if
+  // there is any.
+  void StartSection(const std::string& header) {
+    header_ = header;
+    section_start_ = text_->size();
+  }
+  void EndSection() {
+    WriteSectionHeaderIfNeeded();
+    header_.clear();
+  }
+
+ private:
+  static const size_t kFlushSize = 1 << 20;
+
+  void WriteSectionHeaderIfNeeded() {
+    if (!header_.empty() && text_->size() > section_start_) {
+      text_->insert(section_start_, header_);
+      header_.clear();
+    }
+  }
+
+  MPModelProtoExporter::OutputSink* const sink_;
+  std::string* const text_;
+  bool ok_;
+  std::string header_;
+  size_t section_start_;
+};
+
+// Returns the number of threads used to format a section with the given
+// number of non-zeros.
+int NumFormattingThreads(int64 num_entries) {
+  const int64 kMinEntriesPerThread = 200000;
+  return std::max<int64>(
+      1, std::min<int64>(FLAGS_model_exporter_max_threads,
+                         num_entries / kMinEntriesPerThread));
+}
+
+// Calls append_range on consecutive ranges of [0, num_items) that hold about
+// the same number of non-zeros in total, and passes their text to buffer in
+// order. With more than one thread, up to num_threads ranges are formatted in
+// parallel, each in its own string. Returns false if the sink failed.
+bool AppendRanges(int num_items, int64 num_entries, int num_threads,
+                  Callback3<int, int, std::string*>* append_range,
+                  ExportBuffer* buffer) {
+  const int64 kEntriesPerRange = 100000;
+  const int items_per_range = std::max<int64>(
+      1, num_items * kEntriesPerRange / std::max<int64>(1, num_entries));
+  if (num_threads <= 1) {
+    for (int begin = 0; begin < num_items; begin += items_per_range) {
+      append_range->Run(begin, std::min(begin + items_per_range, num_items),
+                        buffer->text());
+      if (!buffer->Flush(false)) return false;
+    }
+    return true;
+  }
+  std::vector<std::string> ranges(num_threads);
+  for (int first = 0; first < num_items;
+       first += num_threads * items_per_range) {
+    {
+      ThreadPool pool("MPModelExport", num_threads);
+      for (int i = 0; i < num_threads; ++i) {
+        const int begin = std::min(first + i * items_per_range, num_items);
+        const int end = std::min(begin + items_per_range, num_items);
+        ranges[i].clear();
+        pool.Add(NewCallback(append_range,
+                             &Callback3<int, int, std::string*>::Run, begin,
+                             end, &ranges[i]));
+      }
+      pool.StartWorkers();
+    }
+    for (const std::string& range : ranges) {
+      buffer->text()->append(range);
+      if (!buffer->Flush(false)) return false;
+    }
+  }
+  return true;
+}
+
+bool WriteToFile(File* file, const char* data, size_t size) {
+  return file->Write(data, size) == size;
+}
+}  // namespace
+
 MPModelProtoExporter::MPModelProtoExporter(const MPModelProto& proto)
     : proto_(proto),
       var_id_to_index_map_(),
@@ -51,7 +250,6 @@ MPModelProtoExporter::MPModelProtoExporter(const MPModelProto& proto)
       num_continuous_variables_(0),
       num_digits_for_variables_(0),
       num_digits_for_constraints_(0),
-      current_mps_column_(0),
       use_fixed_mps_format_(false),
       use_obfuscated_names_(false),
       setup_done_(false) {}
@@ -91,20 +289,34 @@ bool MPModelProtoExporter::CheckNameValidity(const std::string& name) {
 }
 
 std::string MPModelProtoExporter::GetVariableName(int var_index) const {
+  std::string name;
+  AppendVariableName(var_index, &name);
+  return name;
+}
+
+std::string MPModelProtoExporter::GetConstraintName(int cst_index) const {
+  std::string name;
+  AppendConstraintName(cst_index, &name);
+  return name;
+}
+
+void MPModelProtoExporter::AppendVariableName(int var_index,
+                                              std::string* output) const {
   const new_proto::MPVariableProto& var_proto = proto_.variable(var_index);
   if (use_obfuscated_names_ || !var_proto.has_name()) {
-    return StringPrintf("V%0*d", num_digits_for_variables_, var_index);
+    AppendNumberedName('V', var_index, num_digits_for_variables_, output);
   } else {
-    return var_proto.name();
+    output->append(var_proto.name());
   }
 }
 
-std::string MPModelProtoExporter::GetConstraintName(int cst_index) const {
+void MPModelProtoExporter::AppendConstraintName(int cst_index,
+                                                std::string* output) const {
   const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
   if (use_obfuscated_names_ || !ct_proto.has_name()) {
-    return StringPrintf("C%0*d", num_digits_for_constraints_, cst_index);
+    AppendNumberedName('C', cst_index, num_digits_for_constraints_, output);
   } else {
-    return ct_proto.name();
+    output->append(ct_proto.name());
   }
 }
 
@@ -132,10 +344,11 @@ void MPModelProtoExporter::AppendComments(const std::string& separator,
 }
 
 namespace {
+// Appends text to *output, with line breaks.
 class LineBreaker {
  public:
-  explicit LineBreaker(int max_line_size) :
-      max_line_size_(max_line_size), line_size_(0), output_() {}
+  LineBreaker(int max_line_size, std::string* output) :
+      max_line_size_(max_line_size), line_size_(0), output_(output) {}
   // Lines are broken in such a way that:
   // - Strings that are given to Append() are never split.
   // - Lines are split so that their length doesn't exceed the max length;
@@ -153,37 +366,32 @@ class LineBreaker {
   // lines.
   void Consume(int size) { line_size_ += size; }
 
-  std::string GetOutput() const { return output_; }
-
  private:
   int max_line_size_;
   int line_size_;
-  std::string output_;
+  std::string* const output_;
 };
 
 void LineBreaker::Append(const std::string& s) {
   line_size_ += s.size();
   if (line_size_ > max_line_size_) {
     line_size_ = s.size();
-    StrAppend(&output_, "\n ");
+    output_->append("\n ");
   }
-  StrAppend(&output_, s);
+  output_->append(s);
 }
 
 }  // namespace
 
-bool MPModelProtoExporter::WriteLpTerm(int var_index, double coefficient,
+void MPModelProtoExporter::WriteLpTerm(int var_index, double coefficient,
                                       std::string* output) const {
   output->clear();
-  if (var_index < 0 || var_index >= proto_.variable_size()) {
-    LOG(DFATAL) << "Reference to out-of-bounds variable index # " << var_index;
-    return false;
-  }
   if (coefficient != 0.0) {
-    *output = StringPrintf("%+.16G %-s ", coefficient,
-                           GetVariableName(var_index).c_str());
+    AppendDouble(coefficient, /*plus_sign=*/true, output);
+    output->push_back(' ');
+    AppendVariableName(var_index, output);
+    output->push_back(' ');
   }
-  return true;
 }
 
 namespace {
@@ -226,6 +434,80 @@ bool MPModelProtoExporter::CheckAllNamesValidity() const {
 
 bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
                                                  std::string* output) {
+  return WriteModelAsLpFormat(obfuscated, nullptr, output);
+}
+
+bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
+                                                 OutputSink* sink) {
+  std::string buffer;
+  return WriteModelAsLpFormat(obfuscated, sink, &buffer);
+}
+
+bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
+                                                 File* file) {
+  std::unique_ptr<OutputSink> sink(NewPermanentCallback(&WriteToFile, file));
+  return ExportModelAsLpFormat(obfuscated, sink.get());
+}
+
+void MPModelProtoExporter::AppendLpConstraints(int begin, int end,
+                                               std::string* output) const {
+  std::string line;
+  std::string term;
+  for (int cst_index = begin; cst_index < end; ++cst_index) {
+    const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
+    const std::string name = GetConstraintName(cst_index);
+    line.clear();
+    LineBreaker line_breaker(FLAGS_lp_max_line_length, &line);
+    const int kNumFormattingChars = 10;  // Overevaluated.
+    // Account for the size of the constraint name + possibly "_rhs" +
+    // the formatting characters here.
+    line_breaker.Consume(kNumFormattingChars + name.size());
+    for (int i = 0; i < ct_proto.var_index_size(); ++i) {
+      WriteLpTerm(ct_proto.var_index(i), ct_proto.coefficient(i), &term);
+      line_breaker.Append(term);
+    }
+    const double lb = ct_proto.lower_bound();
+    const double ub = ct_proto.upper_bound();
+    if (lb == ub) {
+      term = " = ";
+      AppendDouble(ub, /*plus_sign=*/false, &term);
+      term += "\n";
+      line_breaker.Append(term);
+      StrAppend(output, " ", name, ": ", line);
+    } else {
+      if (ub != +std::numeric_limits<double>::infinity()) {
+        StrAppend(output, " ", name);
+        if (lb != -std::numeric_limits<double>::infinity()) {
+          *output += "_rhs";
+        }
+        StrAppend(output, ": ", line);
+        std::string relation = " <= ";
+        AppendDouble(ub, /*plus_sign=*/false, &relation);
+        relation += "\n";
+        // Here we have to make sure we do not add the relation to the contents
+        // of line_breaker, which may be used in the subsequent clause.
+        if (!line_breaker.WillFit(relation)) *output += "\n ";
+        *output += relation;
+      }
+      if (lb != -std::numeric_limits<double>::infinity()) {
+        StrAppend(output, " ", name);
+        if (ub != +std::numeric_limits<double>::infinity()) {
+          *output += "_lhs";
+        }
+        StrAppend(output, ": ", line);
+        std::string relation = " >= ";
+        AppendDouble(lb, /*plus_sign=*/false, &relation);
+        relation += "\n";
+        if (!line_breaker.WillFit(relation)) *output += "\n ";
+        *output += relation;
+      }
+    }
+  }
+}
+
+bool MPModelProtoExporter::WriteModelAsLpFormat(bool obfuscated,
+                                                OutputSink* sink,
+                                                std::string* output) {
   // TODO(user):
   // - Sort constraints by category (implication, knapsack, logical or, etc...).
 
@@ -239,86 +521,67 @@ bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
   }
   setup_done_ = true;
   use_obfuscated_names_ = obfuscated;
-  output->clear();
+  ExportBuffer buffer(sink, output);
+  std::string* const text = buffer.text();
 
-  // Comments section.
-  AppendComments("\\", output);
-
-  // Objective
-  StrAppend(output, proto_.maximize() ? "Maximize\n" : "Minimize\n");
-  LineBreaker obj_line_breaker(FLAGS_lp_max_line_length);
-  obj_line_breaker.Append(" Obj: ");
-  if (proto_.objective_offset() != 0.0) {
-    obj_line_breaker.Append(StringPrintf("%-+.16G Constant ",
-                                         proto_.objective_offset()));
-  }
+  // Computes which variables are shown, and checks the variable indices, so
+  // that the constraints can then be formatted independently.
   std::vector<bool> show_variable(proto_.variable_size(),
                              FLAGS_lp_shows_unused_variables);
   for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
     const double coeff = proto_.variable(var_index).objective_coefficient();
-    std::string term;
-    if (!WriteLpTerm(var_index, coeff, &term)) {
-      return false;
-    }
-    obj_line_breaker.Append(term);
     show_variable[var_index] = coeff != 0.0 || FLAGS_lp_shows_unused_variables;
   }
-  // Constraints
-  StrAppend(output, obj_line_breaker.GetOutput(), "\nSubject to\n");
-  for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
-    const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
-    std::string name = GetConstraintName(cst_index);
-    LineBreaker line_breaker(FLAGS_lp_max_line_length);
-    const int kNumFormattingChars = 10;  // Overevaluated.
-    // Account for the size of the constraint name + possibly "_rhs" +
-    // the formatting characters here.
-    line_breaker.Consume(kNumFormattingChars + name.size());
+  int64 num_entries = 0;
+  for (const MPConstraintProto& ct_proto : proto_.constraint()) {
     for (int i = 0; i < ct_proto.var_index_size(); ++i) {
       const int var_index = ct_proto.var_index(i);
-      const double coeff = ct_proto.coefficient(i);
-      std::string term;
-      if (!WriteLpTerm(var_index, coeff, &term)) {
+      if (var_index < 0 || var_index >= proto_.variable_size()) {
+        LOG(DFATAL) << "Reference to out-of-bounds variable index # "
+                    << var_index;
         return false;
       }
-      line_breaker.Append(term);
       show_variable[var_index] =
-          coeff != 0.0 || FLAGS_lp_shows_unused_variables;
+          ct_proto.coefficient(i) != 0.0 || FLAGS_lp_shows_unused_variables;
     }
-    const double lb = ct_proto.lower_bound();
-    const double ub = ct_proto.upper_bound();
-    if (lb == ub) {
-      line_breaker.Append(StringPrintf(" = %-.16G\n", ub));
-      StrAppend(output, " ", name, ": ", line_breaker.GetOutput());
-    } else {
-      if (ub != +std::numeric_limits<double>::infinity()) {
-        std::string rhs_name = name;
-        if (lb != -std::numeric_limits<double>::infinity()) {
-          rhs_name += "_rhs";
-        }
-        StrAppend(output, " ", rhs_name, ": ", line_breaker.GetOutput());
-        const std::string relation = StringPrintf(" <= %-.16G\n", ub);
-        // Here we have to make sure we do not add the relation to the contents
-        // of line_breaker, which may be used in the subsequent clause.
-        if (!line_breaker.WillFit(relation)) StrAppend(output, "\n ");
-        StrAppend(output, relation);
-      }
-      if (lb != -std::numeric_limits<double>::infinity()) {
-        std::string lhs_name = name;
-        if (ub != +std::numeric_limits<double>::infinity()) {
-          lhs_name += "_lhs";
-        }
-        StrAppend(output, " ", lhs_name, ": ", line_breaker.GetOutput());
-        const std::string relation = StringPrintf(" >= %-.16G\n", lb);
-        if (!line_breaker.WillFit(relation)) StrAppend(output, "\n ");
-        StrAppend(output, relation);
-      }
+    num_entries += ct_proto.var_index_size();
+  }
+
+  // Comments section.
+  AppendComments("\\", text);
+
+  // Objective
+  *text += proto_.maximize() ? "Maximize\n" : "Minimize\n";
+  {
+    LineBreaker obj_line_breaker(FLAGS_lp_max_line_length, text);
+    obj_line_breaker.Append(" Obj: ");
+    std::string term;
+    if (proto_.objective_offset() != 0.0) {
+      AppendDouble(proto_.objective_offset(), /*plus_sign=*/true, &term);
+      term += " Constant ";
+      obj_line_breaker.Append(term);
     }
+    for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
+      const double coeff = proto_.variable(var_index).objective_coefficient();
+      WriteLpTerm(var_index, coeff, &term);
+      obj_line_breaker.Append(term);
+      if (!buffer.Flush(false)) return false;
+    }
+  }
+  // Constraints
+  *text += "\nSubject to\n";
+  std::unique_ptr<Callback3<int, int, std::string*>> append_constraints(
+      NewPermanentCallback(this, &MPModelProtoExporter::AppendLpConstraints));
+  if (!AppendRanges(proto_.constraint_size(), num_entries,
+                    NumFormattingThreads(num_entries),
+                    append_constraints.get(), &buffer)) {
+    return false;
   }
 
   // Bounds
-  StringAppendF(output, "Bounds\n");
+  *text += "Bounds\n";
   if (proto_.objective_offset() != 0.0) {
-    StringAppendF(output, " 1 <= Constant <= 1\n");
+    *text += " 1 <= Constant <= 1\n";
   }
   for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
     if (!show_variable[var_index]) continue;
@@ -326,70 +589,96 @@ bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
     const double lb = var_proto.lower_bound();
     const double ub = var_proto.upper_bound();
     if (var_proto.is_integer() && lb == round(lb) && ub == round(ub)) {
-      StringAppendF(output, " %.0f <= %s <= %.0f\n", lb,
-                    GetVariableName(var_index).c_str(), ub);
+      *text += " ";
+      AppendIntegralDouble(lb, text);
+      *text += " <= ";
+      AppendVariableName(var_index, text);
+      *text += " <= ";
+      AppendIntegralDouble(ub, text);
+      *text += "\n";
     } else {
       if (lb != -std::numeric_limits<double>::infinity()) {
-        StringAppendF(output, " %-.16G <= ", lb);
+        *text += " ";
+        AppendDouble(lb, /*plus_sign=*/false, text);
+        *text += " <= ";
       }
-      StringAppendF(output, "%s", GetVariableName(var_index).c_str());
+      AppendVariableName(var_index, text);
       if (ub != std::numeric_limits<double>::infinity()) {
-        StringAppendF(output, " <= %-.16G", ub);
+        *text += " <= ";
+        AppendDouble(ub, /*plus_sign=*/false, text);
       }
-      StringAppendF(output, "\n");
+      *text += "\n";
     }
+    if (!buffer.Flush(false)) return false;
   }
 
   // Binaries
   if (num_binary_variables_ > 0) {
-    StringAppendF(output, "Binaries\n");
+    *text += "Binaries\n";
     for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
       if (!show_variable[var_index]) continue;
       const MPVariableProto& var_proto = proto_.variable(var_index);
       if (IsBoolean(var_proto)) {
-        StringAppendF(output, " %s\n", GetVariableName(var_index).c_str());
+        *text += " ";
+        AppendVariableName(var_index, text);
+        *text += "\n";
+        if (!buffer.Flush(false)) return false;
       }
     }
   }
 
   // Generals
   if (num_integer_variables_ > 0) {
-    StringAppendF(output, "Generals\n");
+    *text += "Generals\n";
     for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
       if (!show_variable[var_index]) continue;
       const MPVariableProto& var_proto = proto_.variable(var_index);
       if (var_proto.is_integer() && !IsBoolean(var_proto)) {
-        StringAppendF(output, " %s\n", GetVariableName(var_index).c_str());
+        *text += " ";
+        AppendVariableName(var_index, text);
+        *text += "\n";
+        if (!buffer.Flush(false)) return false;
       }
     }
   }
-  StringAppendF(output, "End\n");
-  return true;
+  *text += "End\n";
+  return buffer.Flush(true);
 }
 
 void MPModelProtoExporter::AppendMpsPair(const std::string& name, double value,
                                          std::string* output) const {
   const int kFixedMpsDoubleWidth = 12;
+  char value_str[kDoubleBufferSize];
+  *output += "  ";
   if (use_fixed_mps_format_) {
     int precision = kFixedMpsDoubleWidth;
-    std::string value_str = StringPrintf("%.*G", precision, value);
+    int size = FormatDouble(value, precision, /*plus_sign=*/false, value_str);
     // Use the largest precision that can fit into the field witdh.
-    while (value_str.size() > kFixedMpsDoubleWidth) {
+    while (size > kFixedMpsDoubleWidth) {
       --precision;
-      value_str = StringPrintf("%.*G", precision, value);
+      size = FormatDouble(value, precision, /*plus_sign=*/false, value_str);
     }
-    StringAppendF(output, "  %-8s  %*s ", name.c_str(), kFixedMpsDoubleWidth,
-                  value_str.c_str());
+    AppendPadded(name, 8, /*left_justify=*/true, output);
+    *output += "  ";
+    AppendPadded(value_str, size, kFixedMpsDoubleWidth,
+                 /*left_justify=*/false, output);
   } else {
-    StringAppendF(output, "  %-16s  %21.16G ", name.c_str(), value);
+    const int size = FormatDouble(value, 16, /*plus_sign=*/false, value_str);
+    AppendPadded(name, 16, /*left_justify=*/true, output);
+    *output += "  ";
+    AppendPadded(value_str, size, 21, /*left_justify=*/false, output);
   }
+  *output += " ";
 }
 
 void MPModelProtoExporter::AppendMpsLineHeader(const std::string& id,
                                                const std::string& name,
                                                std::string* output) const {
-  StringAppendF(output, use_fixed_mps_format_ ? " %-2s %-8s" : " %-2s  %-16s",
-                id.c_str(), name.c_str());
+  *output += " ";
+  AppendPadded(id, 2, /*left_justify=*/true, output);
+  *output += use_fixed_mps_format_ ? " " : "  ";
+  AppendPadded(name, use_fixed_mps_format_ ? 8 : 16, /*left_justify=*/true,
+               output);
 }
 
 void MPModelProtoExporter::AppendMpsLineHeaderWithNewLine(
@@ -398,15 +687,14 @@ void MPModelProtoExporter::AppendMpsLineHeaderWithNewLine(
   *output += "\n";
 }
 
-void MPModelProtoExporter::AppendMpsTermWithContext(const std::string& head_name,
-                                                    const std::string& name,
-                                                    double value,
-                                                    std::string* output) {
-  if (current_mps_column_ == 0) {
+void MPModelProtoExporter::AppendMpsTermWithContext(
+    const std::string& head_name, const std::string& name, double value,
+    int* mps_column, std::string* output) const {
+  if (*mps_column == 0) {
     AppendMpsLineHeader("", head_name, output);
   }
   AppendMpsPair(name, value, output);
-  AppendNewLineIfTwoColumns(output);
+  AppendNewLineIfTwoColumns(mps_column, output);
 }
 
 void MPModelProtoExporter::AppendMpsBound(const std::string& bound_type,
@@ -417,11 +705,12 @@ void MPModelProtoExporter::AppendMpsBound(const std::string& bound_type,
   *output += "\n";
 }
 
-void MPModelProtoExporter::AppendNewLineIfTwoColumns(std::string* output) {
-  ++current_mps_column_;
-  if (current_mps_column_ == 2) {
+void MPModelProtoExporter::AppendNewLineIfTwoColumns(
+    int* mps_column, std::string* output) const {
+  ++*mps_column;
+  if (*mps_column == 2) {
     *output += "\n";
-    current_mps_column_ = 0;
+    *mps_column = 0;
   }
 }
 
@@ -442,30 +731,70 @@ bool MPModelProtoExporter::CanUseFixedMpsFormat() const {
 }
 
 void MPModelProtoExporter::AppendMpsColumns(bool integrality,
-    const std::vector<std::vector<std::pair<int, double>>>& transpose, std::string* output) {
-  current_mps_column_ = 0;
-  for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
+                                            const Transpose* transpose,
+                                            int begin, int end,
+                                            std::string* output) const {
+  std::string cst_name;
+  for (int var_index = begin; var_index < end; ++var_index) {
     const MPVariableProto& var_proto = proto_.variable(var_index);
     if (var_proto.is_integer() != integrality) continue;
     const std::string var_name = GetVariableName(var_index);
-    current_mps_column_ = 0;
+    int mps_column = 0;
     if (var_proto.objective_coefficient() != 0.0) {
       AppendMpsTermWithContext(var_name, "COST",
-                               var_proto.objective_coefficient(),
+                               var_proto.objective_coefficient(), &mps_column,
                                output);
     }
-    for (const std::pair<int, double> cst_index_and_coeff : transpose[var_index]) {
-      const std::string cst_name = GetConstraintName(cst_index_and_coeff.first);
+    for (int64 k = transpose->starts[var_index];
+         k < transpose->starts[var_index + 1]; ++k) {
+      const std::pair<int, double>& cst_index_and_coeff =
+          transpose->entries[k];
+      cst_name.clear();
+      AppendConstraintName(cst_index_and_coeff.first, &cst_name);
       AppendMpsTermWithContext(var_name, cst_name, cst_index_and_coeff.second,
-                               output);
+                               &mps_column, output);
+    }
+    AppendNewLineIfTwoColumns(&mps_column, output);
+  }
+}
+
+bool MPModelProtoExporter::HasMpsColumns(bool integrality,
+                                         const Transpose& transpose) const {
+  for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
+    const MPVariableProto& var_proto = proto_.variable(var_index);
+    if (var_proto.is_integer() != integrality) continue;
+    if (var_proto.objective_coefficient() != 0.0 ||
+        transpose.starts[var_index + 1] > transpose.starts[var_index]) {
+      return true;
     }
-    AppendNewLineIfTwoColumns(output);
   }
+  return false;
 }
 
 bool MPModelProtoExporter::ExportModelAsMpsFormat(bool fixed_format,
                                                   bool obfuscated,
                                                   std::string* output) {
+  return WriteModelAsMpsFormat(fixed_format, obfuscated, nullptr, output);
+}
+
+bool MPModelProtoExporter::ExportModelAsMpsFormat(bool fixed_format,
+                                                  bool obfuscated,
+                                                  OutputSink* sink) {
+  std::string buffer;
+  return WriteModelAsMpsFormat(fixed_format, obfuscated, sink, &buffer);
+}
+
+bool MPModelProtoExporter::ExportModelAsMpsFormat(bool fixed_format,
+                                                  bool obfuscated,
+                                                  File* file) {
+  std::unique_ptr<OutputSink> sink(NewPermanentCallback(&WriteToFile, file));
+  return ExportModelAsMpsFormat(fixed_format, obfuscated, sink.get());
+}
+
+bool MPModelProtoExporter::WriteModelAsMpsFormat(bool fixed_format,
+                                                 bool obfuscated,
+                                                 OutputSink* sink,
+                                                 std::string* output) {
   if (!obfuscated && !CheckAllNamesValidity()) {
     return false;
   }
@@ -481,153 +810,177 @@ bool MPModelProtoExporter::ExportModelAsMpsFormat(bool fixed_format,
     LOG(WARNING) << "Cannot use fixed format. Falling back to free format";
     use_fixed_mps_format_ = false;
   }
-  output->clear();
+
+  // As the information regarding a column needs to be contiguous, we build
+  // the transpose of the constraint matrix, without its zeros.
+  const int num_vars = proto_.variable_size();
+  Transpose transpose;
+  transpose.starts.assign(num_vars + 1, 0);
+  for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
+    const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
+    for (int k = 0; k < ct_proto.var_index_size(); ++k) {
+      const int var_index = ct_proto.var_index(k);
+      if (var_index < 0 || var_index >= num_vars) {
+        LOG(DFATAL) << "In constraint #" << cst_index << ", var_index #" << k
+                    << " is " << var_index << ", which is out of bounds.";
+        return false;
+      }
+      if (ct_proto.coefficient(k) != 0.0) ++transpose.starts[var_index + 1];
+    }
+  }
+  for (int var_index = 0; var_index < num_vars; ++var_index) {
+    transpose.starts[var_index + 1] += transpose.starts[var_index];
+  }
+  transpose.entries.resize(transpose.starts[num_vars]);
+  {
+    std::vector<int64> next(transpose.starts.begin(),
+                            transpose.starts.end() - 1);
+    for (int cst_index = 0; cst_index < proto_.constraint_size();
+         ++cst_index) {
+      const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
+      for (int k = 0; k < ct_proto.var_index_size(); ++k) {
+        const double coeff = ct_proto.coefficient(k);
+        if (coeff != 0.0) {
+          transpose.entries[next[ct_proto.var_index(k)]++] =
+              std::pair<int, double>(cst_index, coeff);
+        }
+      }
+    }
+  }
+
+  ExportBuffer buffer(sink, output);
+  std::string* const text = buffer.text();
 
   // Comments.
-  AppendComments("*", output);
+  AppendComments("*", text);
 
   // NAME section.
-  StringAppendF(output, "%-14s%s\n", "NAME", proto_.name().c_str());
+  StringAppendF(text, "%-14s%s\n", "NAME", proto_.name().c_str());
 
   // ROWS section.
-  current_mps_column_ = 0;
-  std::string rows_section;
-  AppendMpsLineHeaderWithNewLine("N", "COST", &rows_section);
+  *text += "ROWS\n";
+  AppendMpsLineHeaderWithNewLine("N", "COST", text);
+  std::string cst_name;
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
     const double lb = ct_proto.lower_bound();
     const double ub = ct_proto.upper_bound();
-    const std::string cst_name = GetConstraintName(cst_index);
+    cst_name.clear();
+    AppendConstraintName(cst_index, &cst_name);
     if (lb == ub) {
-      AppendMpsLineHeaderWithNewLine("E", cst_name, &rows_section);
+      AppendMpsLineHeaderWithNewLine("E", cst_name, text);
     } else if (lb == -std::numeric_limits<double>::infinity()) {
       DCHECK_NE(std::numeric_limits<double>::infinity(), ub);
-      AppendMpsLineHeaderWithNewLine("L", cst_name, &rows_section);
+      AppendMpsLineHeaderWithNewLine("L", cst_name, text);
     } else {
       DCHECK_NE(-std::numeric_limits<double>::infinity(), lb);
-      AppendMpsLineHeaderWithNewLine("G", cst_name, &rows_section);
-    }
-  }
-  if (!rows_section.empty()) {
-    *output += "ROWS\n" + rows_section;
-  }
-
-  // As the information regarding a column needs to be contiguous, we create
-  // a map associating a variable to a vector containing the indices of the
-  // constraints where this variable appears.
-  std::vector<std::vector<std::pair<int, double>>> transpose(proto_.variable_size());
-  for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
-    const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
-    for (int k = 0; k < ct_proto.var_index_size(); ++k) {
-      const int var_index = ct_proto.var_index(k);
-      if (var_index < 0 || var_index >= proto_.variable_size()) {
-        LOG(DFATAL) << "In constraint #" << cst_index << ", var_index #" << k
-                    << " is " << var_index << ", which is out of bounds.";
-        return false;
-      }
-      const double coeff = ct_proto.coefficient(k);
-      if (coeff != 0.0) {
-        transpose[var_index].push_back(std::pair<int, double>(cst_index, coeff));
-      }
+      AppendMpsLineHeaderWithNewLine("G", cst_name, text);
     }
+    if (!buffer.Flush(false)) return false;
   }
 
   // COLUMNS section.
-  std::string columns_section;
-  AppendMpsColumns(/*integrality=*/true, transpose, &columns_section);
-  if (!columns_section.empty()) {
+  const int num_threads = NumFormattingThreads(transpose.entries.size());
+  buffer.StartSection("COLUMNS\n");
+  for (const bool integrality : {true, false}) {
+    const bool has_int_markers = integrality && HasMpsColumns(true, transpose);
     const char* const kIntMarkerFormat = "  %-10s%-36s%-10s\n";
-    columns_section = StringPrintf(kIntMarkerFormat, "INTSTART",
-                                   "'MARKER'", "'INTORG'") + columns_section;
-    StringAppendF(&columns_section, kIntMarkerFormat,
-                  "INTEND", "'MARKER'", "'INTEND'");
-  }
-  AppendMpsColumns(/*integrality=*/false, transpose, &columns_section);
-  if (!columns_section.empty()) {
-    *output += "COLUMNS\n" + columns_section;
+    if (has_int_markers) {
+      StringAppendF(text, kIntMarkerFormat, "INTSTART", "'MARKER'",
+                    "'INTORG'");
+    }
+    std::unique_ptr<Callback3<int, int, std::string*>> append_columns(
+        NewPermanentCallback(this, &MPModelProtoExporter::AppendMpsColumns,
+                             integrality, &transpose));
+    if (!AppendRanges(num_vars, transpose.entries.size(), num_threads,
+                      append_columns.get(), &buffer)) {
+      return false;
+    }
+    if (has_int_markers) {
+      StringAppendF(text, kIntMarkerFormat, "INTEND", "'MARKER'", "'INTEND'");
+    }
   }
+  buffer.EndSection();
 
   // RHS (right-hand-side) section.
-  current_mps_column_ = 0;
-  std::string rhs_section;
+  int mps_column = 0;
+  buffer.StartSection("RHS\n");
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
     const double lb = ct_proto.lower_bound();
     const double ub = ct_proto.upper_bound();
-    const std::string cst_name = GetConstraintName(cst_index);
+    cst_name.clear();
+    AppendConstraintName(cst_index, &cst_name);
     if (lb != -std::numeric_limits<double>::infinity()) {
-      AppendMpsTermWithContext("RHS", cst_name, lb, &rhs_section);
+      AppendMpsTermWithContext("RHS", cst_name, lb, &mps_column, text);
     } else if (ub != +std::numeric_limits<double>::infinity()) {
-      AppendMpsTermWithContext("RHS", cst_name, ub, &rhs_section);
+      AppendMpsTermWithContext("RHS", cst_name, ub, &mps_column, text);
     }
+    if (!buffer.Flush(false)) return false;
   }
-  AppendNewLineIfTwoColumns(&rhs_section);
-  if (!rhs_section.empty()) {
-    *output += "RHS\n" + rhs_section;
-  }
+  AppendNewLineIfTwoColumns(&mps_column, text);
+  buffer.EndSection();
 
   // RANGES section.
-  current_mps_column_ = 0;
-  std::string ranges_section;
+  mps_column = 0;
+  buffer.StartSection("RANGES\n");
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
     const double range = fabs(ct_proto.upper_bound() - ct_proto.lower_bound());
     if (range != 0.0 && range != +std::numeric_limits<double>::infinity()) {
-      const std::string cst_name = GetConstraintName(cst_index);
-      AppendMpsTermWithContext("RANGE", cst_name, range, &ranges_section);
+      cst_name.clear();
+      AppendConstraintName(cst_index, &cst_name);
+      AppendMpsTermWithContext("RANGE", cst_name, range, &mps_column, text);
+      if (!buffer.Flush(false)) return false;
     }
   }
-  AppendNewLineIfTwoColumns(&ranges_section);
-  if (!ranges_section.empty()) {
-    *output += "RANGES\n" + ranges_section;
-  }
+  AppendNewLineIfTwoColumns(&mps_column, text);
+  buffer.EndSection();
 
   // BOUNDS section.
-  current_mps_column_ = 0;
-  std::string bounds_section;
-  for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
+  buffer.StartSection("BOUNDS\n");
+  for (int var_index = 0; var_index < num_vars; ++var_index) {
     const MPVariableProto& var_proto = proto_.variable(var_index);
     const double lb = var_proto.lower_bound();
     const double ub = var_proto.upper_bound();
     const std::string var_name = GetVariableName(var_index);
     if (var_proto.is_integer()) {
       if (IsBoolean(var_proto)) {
-        AppendMpsLineHeader("BV", "BOUND", &bounds_section);
-        StringAppendF(&bounds_section, "  %s\n", var_name.c_str());
+        AppendMpsLineHeader("BV", "BOUND", text);
+        StrAppend(text, "  ", var_name, "\n");
       } else {
         if (lb != 0.0) {
-          AppendMpsBound("LI", var_name, lb, &bounds_section);
+          AppendMpsBound("LI", var_name, lb, text);
         }
         if (ub != +std::numeric_limits<double>::infinity()) {
-          AppendMpsBound("UI", var_name, ub, &bounds_section);
+          AppendMpsBound("UI", var_name, ub, text);
         }
       }
     } else {
       if (lb == -std::numeric_limits<double>::infinity() &&
           ub == +std::numeric_limits<double>::infinity()) {
-        AppendMpsLineHeader("FR", "BOUND", &bounds_section);
-        StringAppendF(&bounds_section, "  %s\n", var_name.c_str());
+        AppendMpsLineHeader("FR", "BOUND", text);
+        StrAppend(text, "  ", var_name, "\n");
       } else if (lb == ub) {
-        AppendMpsBound("FX", var_name, lb, &bounds_section);
+        AppendMpsBound("FX", var_name, lb, text);
       } else {
         if (lb != 0.0) {
-          AppendMpsBound("LO", var_name, lb, &bounds_section);
+          AppendMpsBound("LO", var_name, lb, text);
         } else if (ub == +std::numeric_limits<double>::infinity()) {
-          AppendMpsLineHeader("PL", "BOUND", &bounds_section);
-          StringAppendF(&bounds_section, "  %s\n", var_name.c_str());
+          AppendMpsLineHeader("PL", "BOUND", text);
+          StrAppend(text, "  ", var_name, "\n");
         }
         if (ub != +std::numeric_limits<double>::infinity()) {
-          AppendMpsBound("UP", var_name, ub, &bounds_section);
+          AppendMpsBound("UP", var_name, ub, text);
         }
       }
     }
+    if (!buffer.Flush(false)) return false;
   }
-  if (!bounds_section.empty()) {
-    *output += "BOUNDS\n" + bounds_section;
-  }
+  buffer.EndSection();
 
-  *output += "ENDATA\n";
-  return true;
+  *text += "ENDATA\n";
+  return buffer.Flush(true);
 }
 
 }  // namespace operations_research
@@ -16,11 +16,16 @@
 
 #include "base/hash.h"
 #include <string>
+#include <utility>
+#include <vector>
+#include "base/callback.h"
+#include "base/integral_types.h"
 #include "base/macros.h"
 #include "base/hash.h"
 
 namespace operations_research {
 
+class File;
 class MPConstraint;
 class MPObjective;
 class MPVariable;
@@ -31,6 +36,10 @@ class MPModelProto;
 
 class MPModelProtoExporter {
  public:
+  // Receives the text of an exported model by consecutive pieces. Returns
+  // false on error, which aborts the export.
+  typedef ResultCallback2<bool, const char*, size_t> OutputSink;
+
   // The argument must live as long as this class is active.
   explicit MPModelProtoExporter(const new_proto::MPModelProto& proto);
 
@@ -73,6 +82,20 @@ class MPModelProtoExporter {
   bool ExportModelAsMpsFormat(bool fixed_format, bool obfuscated,
                               std::string* model_str);
 
+  // Same as the two methods above, but the text is passed to 'sink' by pieces
+  // of bounded size as it is produced, instead of being built as a whole in
+  // memory. This is the way to export very large models. The sink is not
+  // owned. The sections that are proportional to the number of non-zeros are
+  // formatted in parallel for large models, see the
+  // model_exporter_max_threads flag; the output does not depend on it.
+  bool ExportModelAsLpFormat(bool obfuscated, OutputSink* sink);
+  bool ExportModelAsMpsFormat(bool fixed_format, bool obfuscated,
+                              OutputSink* sink);
+
+  // Same as above, writing to an already opened file.
+  bool ExportModelAsLpFormat(bool obfuscated, File* file);
+  bool ExportModelAsMpsFormat(bool fixed_format, bool obfuscated, File* file);
+
   // Checks the validity of a variable or constraint name.
   // Used by MPSolver::CheckAllNamesValidity and
   // MPModelProtoExporter::CheckAllNamesValidity.
@@ -86,6 +109,22 @@ class MPModelProtoExporter {
   static bool CheckNameValidity(const std::string& name);
 
  private:
+  // The non-zeros of the constraint matrix of proto_, by column: the pairs
+  // (constraint index, coefficient) of the variable #i are the entries in
+  // [starts[i], starts[i + 1]).
+  struct Transpose {
+    std::vector<int64> starts;
+    std::vector<std::pair<int, double>> entries;
+  };
+
+  // Implementations of the public Export methods: if sink is nullptr, the
+  // whole text is stored in *output, otherwise *output is only used as a
+  // buffer and the text is passed to sink.
+  bool WriteModelAsLpFormat(bool obfuscated, OutputSink* sink,
+                            std::string* output);
+  bool WriteModelAsMpsFormat(bool fixed_format, bool obfuscated,
+                             OutputSink* sink, std::string* output);
+
   // This scans the Model proto and sets up all the internal data structures
   // used for lookups.
   // Return false if the Model proto is inconsistent (duplicate names for
@@ -109,6 +148,11 @@ class MPModelProtoExporter {
   // width of the number depends on the number of constraints in the model.
   std::string GetConstraintName(int cst_index) const;
 
+  // Same as GetVariableName() and GetConstraintName(), but appends the name to
+  // "output".
+  void AppendVariableName(int var_index, std::string* output) const;
+  void AppendConstraintName(int cst_index, std::string* output) const;
+
   // Returns true when the fixed MPS format can be used.
   // The fixed format is used when the variable and constraint names do not
   // exceed 8 characters. In the case of an obfuscated file, this means that
@@ -124,9 +168,14 @@ class MPModelProtoExporter {
   // term >= lhs and term <= rhs.
   void AppendComments(const std::string& separator, std::string* output) const;
 
-  // Clears "output" and writes a term to it, in "Lp" format. Returns false on
-  // error (for example, var_index is out of range).
-  bool WriteLpTerm(int var_index, double coefficient, std::string* output) const;
+  // Clears "output" and writes a term to it, in "Lp" format. The variable
+  // index must be valid.
+  void WriteLpTerm(int var_index, double coefficient,
+                   std::string* output) const;
+
+  // Appends the lines of the constraints in [begin, end) to "output", in "Lp"
+  // format.
+  void AppendLpConstraints(int begin, int end, std::string* output) const;
 
   // Appends a pair name, value to "output", formatted to comply with the MPS
   // standard.
@@ -143,21 +192,23 @@ class MPModelProtoExporter {
 
   // Appends an MPS term in various contexts. The term consists of a head name,
   // a name, and a value. If the line is not empty, then only the pair
-  // (name, value) is appended. The number of columns, limited to 2 by the MPS
-  // format is also taken care of.
-  void AppendMpsTermWithContext(const std::string& head_name, const std::string& name,
-                                double value, std::string* output);
+  // (name, value) is appended. The number of columns already on the line,
+  // limited to 2 by the MPS format, is kept in *mps_column.
+  void AppendMpsTermWithContext(const std::string& head_name,
+                                const std::string& name, double value,
+                                int* mps_column, std::string* output) const;
 
   // Appends a new-line if two columns are already present on the MPS line.
   // Used by and in complement to AppendMpsTermWithContext.
-  void AppendNewLineIfTwoColumns(std::string* output);
+  void AppendNewLineIfTwoColumns(int* mps_column, std::string* output) const;
 
-  // When 'integrality' is true, appends columns corresponding to integer
-  // variables. Appends the columns for non-integer variables otherwise.
-  // The sparse matrix must be passed as a vector of columns ('transpose').
-  void AppendMpsColumns(bool integrality,
-                        const std::vector<std::vector<std::pair<int, double>>>& transpose,
-                        std::string* output);
+  // When 'integrality' is true, appends the columns of the integer variables
+  // in [begin, end). Appends the columns of the non-integer ones otherwise.
+  void AppendMpsColumns(bool integrality, const Transpose* transpose,
+                        int begin, int end, std::string* output) const;
+
+  // Returns true if AppendMpsColumns() appends something for some variable.
+  bool HasMpsColumns(bool integrality, const Transpose& transpose) const;
 
   // Appends a line describing the bound of a variablenew-line if two columns
   // are already present on the MPS line.
@@ -185,9 +236,6 @@ class MPModelProtoExporter {
   // Number of decimal digits needed to print the largest constraint number.
   int num_digits_for_constraints_;
 
-  // Current MPS file column number.
-  int current_mps_column_;
-
   // True is the fixed MPS format shall be used.
   bool use_fixed_mps_format_;
 
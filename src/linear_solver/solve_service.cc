@@ -0,0 +1,232 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linear_solver/solve_service.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "base/commandlineflags.h"
+#include "base/logging.h"
+#include "base/time_support.h"
+
+DEFINE_int32(solve_service_model_cache_size, 4,
+             "Number of models kept by each worker of an MPSolveService, to "
+             "solve requests on models with the same structure faster.");
+
+namespace operations_research {
+namespace {
+void SetPromise(std::promise<new_proto::MPSolutionResponse>* promise,
+                const new_proto::MPSolutionResponse& response) {
+  promise->set_value(response);
+  delete promise;
+}
+
+// Converts a duration in seconds to nanoseconds, saturating at kint64max.
+int64 SecondsToNanos(double seconds) {
+  return seconds >= 1e-9 * kint64max ? kint64max
+                                     : static_cast<int64>(seconds * 1e9);
+}
+}  // namespace
+
+MPSolveService::Worker::Worker(int model_cache_size)
+    : models(model_cache_size),
+      request_id(-1),
+      solver(nullptr),
+      cancelled(false) {}
+
+MPSolveService::MPSolveService(int num_workers, int max_queued_requests)
+    : max_queued_requests_(max_queued_requests),
+      next_request_id_(0),
+      shutting_down_(false) {
+  CHECK_GT(num_workers, 0);
+  CHECK_GT(max_queued_requests, 0);
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(
+        new Worker(FLAGS_solve_service_model_cache_size));
+  }
+  for (int i = 0; i < num_workers; ++i) {
+    threads_.emplace_back(&MPSolveService::RunWorker, this, workers_[i].get());
+  }
+}
+
+MPSolveService::~MPSolveService() {
+  std::deque<std::unique_ptr<Request>> cancelled_requests;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+    cancelled_requests.swap(queue_);
+    for (const std::unique_ptr<Worker>& worker : workers_) {
+      if (worker->request_id >= 0) {
+        worker->cancelled = true;
+        if (worker->solver != nullptr) worker->solver->InterruptSolve();
+      }
+    }
+    request_added_.notify_all();
+    request_removed_.notify_all();
+  }
+  for (const std::unique_ptr<Request>& request : cancelled_requests) {
+    AnswerUnsolved(*request, new_proto::MPSolutionResponse::UNKNOWN);
+  }
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+int64 MPSolveService::SolveAsync(
+    const new_proto::MPModelRequest& request, double deadline_in_seconds,
+    Callback1<const new_proto::MPSolutionResponse&>* done) {
+  CHECK(done != nullptr);
+  std::unique_ptr<Request> queued(new Request());
+  queued->model_request = request;
+  const int64 now = base::GetCurrentTimeNanos();
+  const int64 deadline = SecondsToNanos(deadline_in_seconds);
+  queued->deadline_ns = deadline >= kint64max - now ? kint64max
+                                                    : now + deadline;
+  queued->done = done;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (queue_.size() >= max_queued_requests_ && !shutting_down_) {
+    request_removed_.wait(lock);
+  }
+  CHECK(!shutting_down_) << "SolveAsync() called on a deleted MPSolveService";
+  const int64 request_id = next_request_id_++;
+  queued->id = request_id;
+  queue_.push_back(std::move(queued));
+  request_added_.notify_one();
+  return request_id;
+}
+
+int64 MPSolveService::SolveAsync(
+    const new_proto::MPModelRequest& request, double deadline_in_seconds,
+    std::future<new_proto::MPSolutionResponse>* response) {
+  CHECK(response != nullptr);
+  std::promise<new_proto::MPSolutionResponse>* const promise =
+      new std::promise<new_proto::MPSolutionResponse>();
+  *response = promise->get_future();
+  // Qualified, as protobuf also has a NewCallback().
+  return SolveAsync(request, deadline_in_seconds,
+                    ::NewCallback(&SetPromise, promise));
+}
+
+bool MPSolveService::Cancel(int64 request_id) {
+  std::unique_ptr<Request> cancelled_request;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+      if ((*it)->id == request_id) {
+        cancelled_request = std::move(*it);
+        queue_.erase(it);
+        request_removed_.notify_one();
+        break;
+      }
+    }
+    if (cancelled_request == nullptr) {
+      for (const std::unique_ptr<Worker>& worker : workers_) {
+        if (worker->request_id == request_id) {
+          worker->cancelled = true;
+          if (worker->solver != nullptr) worker->solver->InterruptSolve();
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+  AnswerUnsolved(*cancelled_request, new_proto::MPSolutionResponse::UNKNOWN);
+  return true;
+}
+
+void MPSolveService::RunWorker(Worker* worker) {
+  for (;;) {
+    std::unique_ptr<Request> request;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (queue_.empty() && !shutting_down_) {
+        request_added_.wait(lock);
+      }
+      if (queue_.empty()) return;
+      request = std::move(queue_.front());
+      queue_.pop_front();
+      request_removed_.notify_one();
+      worker->request_id = request->id;
+      worker->solver = nullptr;
+      worker->cancelled = false;
+    }
+    new_proto::MPSolutionResponse response;
+    Solve(*request, worker, &response);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      worker->request_id = -1;
+      worker->solver = nullptr;
+    }
+    request->done->Run(response);
+  }
+}
+
+void MPSolveService::Solve(const Request& request, Worker* worker,
+                           new_proto::MPSolutionResponse* response) {
+  const new_proto::MPModelRequest& model_request = request.model_request;
+  const double time_left =
+      request.deadline_ns == kint64max
+          ? std::numeric_limits<double>::infinity()
+          : 1e-9 * (request.deadline_ns - base::GetCurrentTimeNanos());
+  if (time_left <= 0.0 ||
+      (model_request.has_solver_time_limit_seconds() &&
+       time_left < model_request.solver_time_limit_seconds())) {
+    VLOG(1) << "Request " << request.id << " waited too long, giving up.";
+    response->set_status(new_proto::MPSolutionResponse::ABNORMAL);
+    return;
+  }
+
+  MPSolver::LoadStatus load_status;
+  MPSolver* const solver =
+      worker->models.LoadModel(model_request, &load_status);
+  if (solver == nullptr) {
+    LOG(WARNING) << "Loading model from protocol buffer failed, "
+                 << "load status = "
+                 << new_proto::Error::Code_Name(
+                        static_cast<new_proto::Error::Code>(load_status))
+                 << " (" << load_status << ")";
+    response->set_status(new_proto::MPSolutionResponse::ABNORMAL);
+    return;
+  }
+  // MPSolver time limits are in milliseconds, 0 meaning no limit.
+  const double time_limit = model_request.has_solver_time_limit_seconds()
+                                ? model_request.solver_time_limit_seconds()
+                                : time_left;
+  solver->set_time_limit(
+      std::isinf(time_limit)
+          ? 0
+          : std::max<int64>(1, static_cast<int64>(time_limit * 1000)));
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (worker->cancelled) {
+      response->set_status(new_proto::MPSolutionResponse::UNKNOWN);
+      return;
+    }
+    worker->solver = solver;
+  }
+  solver->Solve();
+  solver->FillSolutionResponseProto(response);
+}
+
+// static
+void MPSolveService::AnswerUnsolved(
+    const Request& request, new_proto::MPSolutionResponse::Status status) {
+  new_proto::MPSolutionResponse response;
+  response.set_status(status);
+  request.done->Run(response);
+}
+}  // namespace operations_research
@@ -0,0 +1,139 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_LINEAR_SOLVER_SOLVE_SERVICE_H_
+#define OR_TOOLS_LINEAR_SOLVER_SOLVE_SERVICE_H_
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <future>  // NOLINT
+#include "base/unique_ptr.h"
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/callback.h"
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "linear_solver/linear_solver.h"
+#include "linear_solver/linear_solver2.pb.h"
+#include "linear_solver/model_cache.h"
+
+namespace operations_research {
+// Solves MPModelRequests asynchronously, on a fixed number of worker threads.
+//
+// Unlike MPSolver::SolveWithProto(), which builds a new MPSolver (and thus a
+// new underlying solver) for each request, each worker keeps the MPSolvers of
+// its last requests in an MPModelCache, of --solve_service_model_cache_size
+// entries. This saves the creation of the solvers when many small models are
+// solved, and a request on a model with the same structure as a cached one
+// only updates its values, see MPModelCache.
+//
+// The number of requests waiting for a worker is bounded: SolveAsync() blocks
+// while the queue is full. The response of each request is given exactly
+// once, to a callback run by a worker thread, or through a future.
+//
+// Example:
+//   MPSolveService service(4, 100);
+//   std::future<new_proto::MPSolutionResponse> response;
+//   service.SolveAsync(request, std::numeric_limits<double>::infinity(),
+//                      &response);
+//   ... = response.get();
+//
+// This class is thread-safe.
+class MPSolveService {
+ public:
+  // Creates the service and starts its num_workers worker threads. At most
+  // max_queued_requests requests can wait for a worker.
+  MPSolveService(int num_workers, int max_queued_requests);
+
+  // Cancels all the requests that are not answered yet, see Cancel(), and
+  // waits for the workers to finish.
+  ~MPSolveService();
+
+  // Queues the request, and returns an id that can be given to Cancel().
+  // 'done' is run with the response once the request is answered; it must
+  // not call back into the service.
+  //
+  // The request may wait for a worker for up to deadline_in_seconds (use
+  // infinity if there is no such deadline). If a worker picks it up after
+  // that, or with less time left than its solver_time_limit_seconds, the
+  // request is answered with the ABNORMAL status without being solved.
+  // Otherwise the solver time limit is the solver_time_limit_seconds of the
+  // request if it has one, or the time left before the deadline.
+  int64 SolveAsync(const new_proto::MPModelRequest& request,
+                   double deadline_in_seconds,
+                   Callback1<const new_proto::MPSolutionResponse&>* done);
+
+  // Same as above, with the response given through *response.
+  int64 SolveAsync(const new_proto::MPModelRequest& request,
+                   double deadline_in_seconds,
+                   std::future<new_proto::MPSolutionResponse>* response);
+
+  // Cancels the given request. If it is still waiting for a worker, it is
+  // answered at once (from this thread) with the UNKNOWN status. If it is
+  // being solved, the solve is interrupted with MPSolver::InterruptSolve(),
+  // which only stops the solvers that support it early: the response is
+  // then the one of the interrupted solve. Returns false if the request was
+  // already answered.
+  bool Cancel(int64 request_id);
+
+ private:
+  struct Request {
+    int64 id;
+    new_proto::MPModelRequest model_request;
+    // In base::GetCurrentTimeNanos() time.
+    int64 deadline_ns;
+    Callback1<const new_proto::MPSolutionResponse&>* done;
+  };
+
+  struct Worker {
+    explicit Worker(int model_cache_size);
+
+    // The models last solved by this worker.
+    MPModelCache models;
+
+    // The request being processed, or -1, and its solver once the model is
+    // loaded. Both are guarded by mutex_.
+    int64 request_id;
+    MPSolver* solver;
+    bool cancelled;
+  };
+
+  void RunWorker(Worker* worker);
+
+  // Solves the request on a solver of the worker, and fills the response.
+  void Solve(const Request& request, Worker* worker,
+             new_proto::MPSolutionResponse* response);
+
+  // Answers a request that was not solved with the given status.
+  static void AnswerUnsolved(
+      const Request& request,
+      new_proto::MPSolutionResponse::Status status);
+
+  const int max_queued_requests_;
+
+  std::mutex mutex_;
+  std::condition_variable request_added_;
+  std::condition_variable request_removed_;
+  std::deque<std::unique_ptr<Request>> queue_;
+  int64 next_request_id_;
+  bool shutting_down_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPSolveService);
+};
+}  // namespace operations_research
+#endif  // OR_TOOLS_LINEAR_SOLVER_SOLVE_SERVICE_H_
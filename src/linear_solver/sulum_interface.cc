@@ -533,7 +533,7 @@ void SLMInterface::ExtractNewConstraints() {
 void SLMInterface::ExtractObjective() {
   // Linear objective: set objective coefficients for all variables
   // (some might have been modified).
-  for (hash_map<const MPVariable*, double>::const_iterator it =
+  for (CoeffMap::const_iterator it =
            solver_->objective_->coefficients_.begin();
        it != solver_->objective_->coefficients_.end();
        ++it) {
@@ -280,6 +280,13 @@ void LinearProgram::SetCoefficient(RowIndex row, ColIndex col,
   matrix_.mutable_column(col)->SetCoefficient(row, value);
 }
 
+void LinearProgram::PopulateMatrixFromTriplets(SparseMatrixBuilder* triplets) {
+  DCHECK(triplets != nullptr);
+  triplets->Build(num_constraints(), num_variables(), &matrix_);
+  columns_are_known_to_be_clean_ = true;
+  transpose_matrix_is_consistent_ = false;
+}
+
 void LinearProgram::SetObjectiveCoefficient(ColIndex col, Fractional value) {
   DCHECK(IsFinite(value));
   objective_coefficients_[col] = value;
@@ -107,6 +107,12 @@ class LinearProgram {
   // Defines the coefficient for col / row.
   void SetCoefficient(RowIndex row, ColIndex col, Fractional value);
 
+  // Replaces the whole constraint matrix by the one given by the triplets of
+  // the builder (see SparseMatrixBuilder). All the variables and constraints
+  // must have been created before. The matrix is cleaned up. For large
+  // problems, this is a lot faster than calling SetCoefficient() on each entry.
+  void PopulateMatrixFromTriplets(SparseMatrixBuilder* triplets);
+
   // Defines the objective coefficient of column col.
   // It is set to 0.0 by default.
   void SetObjectiveCoefficient(ColIndex col, Fractional value);
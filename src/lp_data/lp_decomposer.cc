@@ -22,6 +22,29 @@
 namespace operations_research {
 namespace glop {
 
+namespace {
+
+// Scatters the values of the independent problems into a vector of the given
+// size using the local to global index mappings.
+template <typename Index, typename Vector>
+Vector AggregateVectors(const std::vector<Vector>& local_vectors,
+                        const std::vector<StrictITIVector<Index, Index>>& maps,
+                        Index size, typename Vector::value_type default_value) {
+  CHECK_EQ(local_vectors.size(), maps.size());
+  Vector values(size, default_value);
+  for (int problem = 0; problem < local_vectors.size(); ++problem) {
+    const Vector& local_values = local_vectors[problem];
+    const StrictITIVector<Index, Index>& local_to_global = maps[problem];
+    DCHECK_LE(local_values.size(), local_to_global.size());
+    for (Index local(0); local < local_values.size(); ++local) {
+      values[local_to_global[local]] = local_values[local];
+    }
+  }
+  return values;
+}
+
+}  // namespace
+
 //------------------------------------------------------------------------------
 // LPDecomposer
 //------------------------------------------------------------------------------
@@ -29,6 +52,7 @@ LPDecomposer::LPDecomposer()
     : original_problem_(nullptr),
       clusters_(),
       local_to_global_vars_(),
+      local_to_global_constraints_(),
       mutex_() {}
 
 void LPDecomposer::Decompose(const LinearProgram* linear_problem) {
@@ -36,6 +60,7 @@ void LPDecomposer::Decompose(const LinearProgram* linear_problem) {
   original_problem_ = linear_problem;
   clusters_.clear();
   local_to_global_vars_.clear();
+  local_to_global_constraints_.clear();
 
   const SparseMatrix& transposed_matrix =
       original_problem_->GetTransposeSparseMatrix();
@@ -65,6 +90,7 @@ void LPDecomposer::Decompose(const LinearProgram* linear_problem) {
     std::sort(clusters_[i].begin(), clusters_[i].end());
   }
   local_to_global_vars_.resize(clusters_.size());
+  local_to_global_constraints_.resize(clusters_.size());
 }
 
 int LPDecomposer::GetNumberOfProblems() const {
@@ -91,6 +117,7 @@ void LPDecomposer::BuildProblem(int problem_index, LinearProgram* lp) {
       original_problem_->num_constraints());
   StrictITIVector<ColIndex, ColIndex> local_to_global(ColIndex(cluster.size()),
                                                       kInvalidCol);
+  StrictITIVector<RowIndex, RowIndex> local_to_global_constraints;
   lp->SetMaximizationProblem(original_problem_->IsMaximizationProblem());
 
   // Create variables and get all constraints of the cluster.
@@ -125,6 +152,7 @@ void LPDecomposer::BuildProblem(int problem_index, LinearProgram* lp) {
   for (const RowIndex global_row :
        constraints_to_use.PositionsSetAtLeastOnce()) {
     const RowIndex local_row = lp->CreateNewConstraint();
+    local_to_global_constraints.push_back(global_row);
     lp->SetConstraintName(local_row,
                           original_problem_->GetConstraintName(global_row));
     lp->SetConstraintBounds(
@@ -141,25 +169,38 @@ void LPDecomposer::BuildProblem(int problem_index, LinearProgram* lp) {
 
   MutexLock mutex_lock(&mutex_);
   local_to_global_vars_[problem_index] = local_to_global;
+  local_to_global_constraints_[problem_index] = local_to_global_constraints;
 }
 
 DenseRow LPDecomposer::AggregateAssignments(
     const std::vector<DenseRow>& assignments) const {
-  CHECK_EQ(assignments.size(), local_to_global_vars_.size());
+  MutexLock mutex_lock(&mutex_);
+  return AggregateVectors(assignments, local_to_global_vars_,
+                          original_problem_->num_variables(), Fractional(0.0));
+}
 
+DenseColumn LPDecomposer::AggregateDualValues(
+    const std::vector<DenseColumn>& dual_values) const {
   MutexLock mutex_lock(&mutex_);
-  DenseRow values(original_problem_->num_variables(), Fractional(0.0));
-  for (int problem = 0; problem < assignments.size(); ++problem) {
-    const DenseRow& assignment = assignments[problem];
-    const StrictITIVector<ColIndex, ColIndex>& local_to_global =
-        local_to_global_vars_[problem];
-    for (ColIndex local_col(0); local_col < assignment.size(); ++local_col) {
-      const ColIndex global_col = local_to_global[local_col];
-      const Fractional value = assignment[local_col];
-      values[global_col] = value;
-    }
-  }
-  return values;
+  return AggregateVectors(dual_values, local_to_global_constraints_,
+                          original_problem_->num_constraints(),
+                          Fractional(0.0));
+}
+
+VariableStatusRow LPDecomposer::AggregateVariableStatuses(
+    const std::vector<VariableStatusRow>& statuses) const {
+  MutexLock mutex_lock(&mutex_);
+  return AggregateVectors(statuses, local_to_global_vars_,
+                          original_problem_->num_variables(),
+                          VariableStatus::FREE);
+}
+
+ConstraintStatusColumn LPDecomposer::AggregateConstraintStatuses(
+    const std::vector<ConstraintStatusColumn>& statuses) const {
+  MutexLock mutex_lock(&mutex_);
+  return AggregateVectors(statuses, local_to_global_constraints_,
+                          original_problem_->num_constraints(),
+                          ConstraintStatus::BASIC);
 }
 
 }  // namespace glop
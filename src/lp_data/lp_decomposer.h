@@ -73,10 +73,27 @@ class LPDecomposer {
   DenseRow AggregateAssignments(const std::vector<DenseRow>& assignments) const
       LOCKS_EXCLUDED(mutex_);
 
+  // Same as AggregateAssignments() for the other parts of a solution of the
+  // independent problems. This makes it possible to aggregate the optimal
+  // bases of the independent problems into an optimal basis of the original
+  // problem. The constraints that appear in no independent problem (i.e. the
+  // empty ones) get a zero dual value and a BASIC status.
+  //
+  // Note that all the problems must have been built with BuildProblem().
+  DenseColumn AggregateDualValues(
+      const std::vector<DenseColumn>& dual_values) const LOCKS_EXCLUDED(mutex_);
+  VariableStatusRow AggregateVariableStatuses(
+      const std::vector<VariableStatusRow>& statuses) const
+      LOCKS_EXCLUDED(mutex_);
+  ConstraintStatusColumn AggregateConstraintStatuses(
+      const std::vector<ConstraintStatusColumn>& statuses) const
+      LOCKS_EXCLUDED(mutex_);
+
  private:
   const LinearProgram* original_problem_;
   std::vector<std::vector<ColIndex>> clusters_;
   std::vector<StrictITIVector<ColIndex, ColIndex>> local_to_global_vars_;
+  std::vector<StrictITIVector<RowIndex, RowIndex>> local_to_global_constraints_;
 
   mutable Mutex mutex_;
 
@@ -0,0 +1,370 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lp_data/lp_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include "base/unique_ptr.h"
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/file.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/sparse_column.h"
+
+namespace operations_research {
+namespace glop {
+
+namespace {
+
+// The first 8 bytes of a snapshot file.
+const char kSnapshotMagic[8] = {'G', 'L', 'O', 'P', 'S', 'N', 'A', 'P'};
+
+// The version of the format. It must be increased each time the format
+// changes.
+const uint32 kSnapshotVersion = 1;
+
+// Written as is after the version, this identifies the byte order of the
+// machine that wrote the file.
+const uint32 kByteOrderMark = 0x01020304;
+
+// The bits of the flags field of the header.
+const int64 kMaximizationFlag = 1;
+
+// The header of a snapshot. All the fields are 8-byte aligned.
+struct SnapshotHeader {
+  char magic[8];
+  uint32 version;
+  uint32 byte_order_mark;
+  int64 num_rows;
+  int64 num_cols;
+  int64 num_entries;
+  int64 flags;
+  double objective_offset;
+};
+
+// Appends raw values to a buffer, padding each array to a multiple of 8 bytes.
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(std::string* buffer) : buffer_(buffer) {}
+
+  template <typename T>
+  void Append(const T& value) {
+    AppendBytes(&value, sizeof(value));
+  }
+
+  template <typename T>
+  void AppendArray(const T* values, int64 size) {
+    AppendBytes(values, size * sizeof(T));
+    buffer_->resize((buffer_->size() + 7) & ~7, '\0');
+  }
+
+ private:
+  void AppendBytes(const void* data, size_t size) {
+    buffer_->append(static_cast<const char*>(data), size);
+  }
+
+  std::string* buffer_;
+};
+
+// Reads the values written by SnapshotWriter with bounds checking. Once a read
+// failed, all the following ones fail too.
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(const std::string& buffer)
+      : buffer_(buffer), position_(0), ok_(true) {}
+
+  template <typename T>
+  bool Read(T* value) {
+    return ReadBytes(value, sizeof(*value));
+  }
+
+  // Returns a pointer to the next size values in the buffer, or nullptr if the
+  // buffer is too short. The pointer is suitably aligned since the arrays start
+  // at a multiple of 8 bytes and the buffer is allocated on the heap.
+  template <typename T>
+  const T* ReadArray(int64 size) {
+    if (!ok_ || size < 0 ||
+        static_cast<uint64>(size) > (buffer_.size() - position_) / sizeof(T)) {
+      ok_ = false;
+      return nullptr;
+    }
+    const T* const values =
+        reinterpret_cast<const T*>(buffer_.data() + position_);
+    const size_t end = position_ + size * sizeof(T);
+    position_ = std::min<size_t>(buffer_.size(), (end + 7) & ~7);
+    return values;
+  }
+
+  bool ok() const { return ok_; }
+
+ private:
+  bool ReadBytes(void* data, size_t size) {
+    if (!ok_ || size > buffer_.size() - position_) {
+      ok_ = false;
+      return false;
+    }
+    memcpy(data, buffer_.data() + position_, size);
+    position_ += size;
+    return true;
+  }
+
+  const std::string& buffer_;
+  size_t position_;
+  bool ok_;
+};
+
+// Fills linear_program from the content of a snapshot file. Returns false if
+// the content is not a valid snapshot.
+bool PopulateFromSnapshot(const std::string& content,
+                          LinearProgram* linear_program) {
+  SnapshotReader reader(content);
+  SnapshotHeader header;
+  if (!reader.Read(&header) ||
+      memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+    LOG(ERROR) << "Not a LinearProgram snapshot.";
+    return false;
+  }
+  if (header.byte_order_mark != kByteOrderMark) {
+    LOG(ERROR) << "The snapshot was written on a machine with another byte "
+               << "order.";
+    return false;
+  }
+  if (header.version != kSnapshotVersion) {
+    LOG(ERROR) << "Unsupported snapshot version " << header.version
+               << ", expected " << kSnapshotVersion << ".";
+    return false;
+  }
+  const int64 num_rows = header.num_rows;
+  const int64 num_cols = header.num_cols;
+  const int64 num_entries = header.num_entries;
+  if (num_rows < 0 || num_cols < 0 || num_entries < 0 ||
+      num_rows > kint32max || num_cols > kint32max) {
+    LOG(ERROR) << "Invalid snapshot dimensions.";
+    return false;
+  }
+
+  const int64* const column_starts = reader.ReadArray<int64>(num_cols + 1);
+  const int32* const rows = reader.ReadArray<int32>(num_entries);
+  const double* const coefficients = reader.ReadArray<double>(num_entries);
+  const double* const objective = reader.ReadArray<double>(num_cols);
+  const double* const variable_lower_bounds =
+      reader.ReadArray<double>(num_cols);
+  const double* const variable_upper_bounds =
+      reader.ReadArray<double>(num_cols);
+  const char* const is_integer = reader.ReadArray<char>(num_cols);
+  const double* const constraint_lower_bounds =
+      reader.ReadArray<double>(num_rows);
+  const double* const constraint_upper_bounds =
+      reader.ReadArray<double>(num_rows);
+
+  // The names: the problem name, then the variable names and the constraint
+  // names. Name i is [name_starts[i], name_starts[i + 1]) in name_data.
+  const int64 num_names = 1 + num_cols + num_rows;
+  const int64* const name_starts = reader.ReadArray<int64>(num_names + 1);
+  if (!reader.ok() || column_starts[0] != 0 ||
+      column_starts[num_cols] != num_entries || name_starts[0] != 0) {
+    LOG(ERROR) << "Truncated or corrupted snapshot.";
+    return false;
+  }
+  const char* const name_data = reader.ReadArray<char>(name_starts[num_names]);
+  if (!reader.ok()) {
+    LOG(ERROR) << "Truncated or corrupted snapshot.";
+    return false;
+  }
+  for (int64 i = 0; i < num_cols; ++i) {
+    if (column_starts[i] > column_starts[i + 1]) return false;
+  }
+  for (int64 i = 0; i < num_names; ++i) {
+    if (name_starts[i] > name_starts[i + 1]) return false;
+  }
+  for (int64 i = 0; i < num_entries; ++i) {
+    if (rows[i] < 0 || rows[i] >= num_rows) return false;
+  }
+
+  int64 name_index = 0;
+  const auto next_name = [name_data, name_starts, &name_index]() {
+    const int64 start = name_starts[name_index];
+    ++name_index;
+    return std::string(name_data + start, name_starts[name_index] - start);
+  };
+  linear_program->SetName(next_name());
+  linear_program->SetMaximizationProblem((header.flags & kMaximizationFlag) !=
+                                         0);
+  linear_program->SetObjectiveOffset(header.objective_offset);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    linear_program->CreateNewVariable();
+    linear_program->SetVariableName(col, next_name());
+    linear_program->SetVariableBounds(col, variable_lower_bounds[col.value()],
+                                      variable_upper_bounds[col.value()]);
+    linear_program->SetObjectiveCoefficient(col, objective[col.value()]);
+    if (is_integer[col.value()]) {
+      linear_program->SetVariableIntegrality(col, true);
+    }
+  }
+  for (RowIndex row(0); row < num_rows; ++row) {
+    linear_program->CreateNewConstraint();
+    linear_program->SetConstraintName(row, next_name());
+    linear_program->SetConstraintBounds(row,
+                                        constraint_lower_bounds[row.value()],
+                                        constraint_upper_bounds[row.value()]);
+  }
+  for (ColIndex col(0); col < num_cols; ++col) {
+    const int64 start = column_starts[col.value()];
+    const int64 end = column_starts[col.value() + 1];
+    SparseColumn* const column = linear_program->GetMutableSparseColumn(col);
+    column->Reserve(EntryIndex(end - start));
+    for (int64 i = start; i < end; ++i) {
+      column->SetCoefficient(RowIndex(rows[i]), coefficients[i]);
+    }
+  }
+  linear_program->CleanUp();
+  return true;
+}
+
+}  // namespace
+
+bool WriteLinearProgramSnapshot(const LinearProgram& linear_program,
+                                const std::string& file_name) {
+  const int64 num_rows = linear_program.num_constraints().value();
+  const int64 num_cols = linear_program.num_variables().value();
+  const int64 num_entries = linear_program.num_entries().value();
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+  header.version = kSnapshotVersion;
+  header.byte_order_mark = kByteOrderMark;
+  header.num_rows = num_rows;
+  header.num_cols = num_cols;
+  header.num_entries = num_entries;
+  header.flags =
+      linear_program.IsMaximizationProblem() ? kMaximizationFlag : 0;
+  header.objective_offset = linear_program.objective_offset();
+
+  // The matrix, in the column-major order. Note that the columns may not be
+  // sorted if the program is not cleaned up, this is handled by the reader.
+  std::vector<int64> column_starts(num_cols + 1, 0);
+  std::vector<int32> rows;
+  std::vector<double> coefficients;
+  rows.reserve(num_entries);
+  coefficients.reserve(num_entries);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    for (const SparseColumn::Entry e : linear_program.GetSparseColumn(col)) {
+      rows.push_back(e.row().value());
+      coefficients.push_back(e.coefficient());
+    }
+    column_starts[col.value() + 1] = rows.size();
+  }
+
+  // The variables and the constraints. Note that the DenseRow and DenseColumn
+  // can't be written directly since Fractional may not be a double.
+  std::vector<double> objective(num_cols);
+  std::vector<double> variable_lower_bounds(num_cols);
+  std::vector<double> variable_upper_bounds(num_cols);
+  std::vector<char> is_integer(num_cols);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    objective[col.value()] = linear_program.objective_coefficients()[col];
+    variable_lower_bounds[col.value()] =
+        linear_program.variable_lower_bounds()[col];
+    variable_upper_bounds[col.value()] =
+        linear_program.variable_upper_bounds()[col];
+    is_integer[col.value()] = linear_program.is_variable_integer()[col];
+  }
+  std::vector<double> constraint_lower_bounds(num_rows);
+  std::vector<double> constraint_upper_bounds(num_rows);
+  for (RowIndex row(0); row < num_rows; ++row) {
+    constraint_lower_bounds[row.value()] =
+        linear_program.constraint_lower_bounds()[row];
+    constraint_upper_bounds[row.value()] =
+        linear_program.constraint_upper_bounds()[row];
+  }
+
+  // The string table. Note that GetVariableName() and GetConstraintName()
+  // return a default name for the unnamed variables and constraints, so the
+  // names are always set after a reload.
+  std::vector<int64> name_starts(1, 0);
+  std::string name_data = linear_program.name();
+  name_starts.push_back(name_data.size());
+  for (ColIndex col(0); col < num_cols; ++col) {
+    name_data += linear_program.GetVariableName(col);
+    name_starts.push_back(name_data.size());
+  }
+  for (RowIndex row(0); row < num_rows; ++row) {
+    name_data += linear_program.GetConstraintName(row);
+    name_starts.push_back(name_data.size());
+  }
+
+  std::string buffer;
+  SnapshotWriter writer(&buffer);
+  writer.Append(header);
+  writer.AppendArray(column_starts.data(), column_starts.size());
+  writer.AppendArray(rows.data(), rows.size());
+  writer.AppendArray(coefficients.data(), coefficients.size());
+  writer.AppendArray(objective.data(), objective.size());
+  writer.AppendArray(variable_lower_bounds.data(),
+                     variable_lower_bounds.size());
+  writer.AppendArray(variable_upper_bounds.data(),
+                     variable_upper_bounds.size());
+  writer.AppendArray(is_integer.data(), is_integer.size());
+  writer.AppendArray(constraint_lower_bounds.data(),
+                     constraint_lower_bounds.size());
+  writer.AppendArray(constraint_upper_bounds.data(),
+                     constraint_upper_bounds.size());
+  writer.AppendArray(name_starts.data(), name_starts.size());
+  writer.AppendArray(name_data.data(), name_data.size());
+
+  std::unique_ptr<File> file(File::Open(file_name, "w"));
+  if (file == nullptr) {
+    LOG(ERROR) << "Could not open " << file_name;
+    return false;
+  }
+  const bool written = file->Write(buffer.data(), buffer.size()) ==
+                       buffer.size();
+  if (!file->Close() || !written) {
+    LOG(ERROR) << "Could not write " << file_name;
+    return false;
+  }
+  return true;
+}
+
+bool ReadLinearProgramSnapshot(const std::string& file_name,
+                               LinearProgram* linear_program) {
+  CHECK(linear_program != nullptr);
+  linear_program->Clear();
+  std::unique_ptr<File> file(File::Open(file_name, "r"));
+  if (file == nullptr) {
+    LOG(ERROR) << "Could not open " << file_name;
+    return false;
+  }
+
+  // The whole file is read at once, the arrays are then used in place.
+  std::string content(file->Size(), '\0');
+  const bool read = file->Read(&content[0], content.size()) == content.size();
+  if (!file->Close() || !read) {
+    LOG(ERROR) << "Could not read " << file_name;
+    return false;
+  }
+  if (!PopulateFromSnapshot(content, linear_program)) {
+    LOG(ERROR) << "Invalid snapshot file " << file_name;
+    linear_program->Clear();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace glop
+}  // namespace operations_research
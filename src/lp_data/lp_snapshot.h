@@ -0,0 +1,55 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A compact binary file format for LinearProgram, meant to reload a large
+// problem without any parsing, for instance when the same problem is solved
+// many times while tuning the solver.
+//
+// A snapshot is a fixed-size header followed by the raw arrays of the
+// problem, each starting at a multiple of 8 bytes:
+//   - the column-major constraint matrix (column starts, rows, coefficients),
+//   - the objective coefficients and the variable bounds and integrality,
+//   - the constraint bounds,
+//   - a string table with the problem, variable and constraint names.
+// The numbers are stored in the byte order of the machine that wrote the
+// file, which is recorded in the header together with a format version. A
+// snapshot written on a machine with a different byte order, or with another
+// version of the format, is rejected. A snapshot is not meant to be archived:
+// use an MPModelProto for this.
+
+#ifndef OR_TOOLS_LP_DATA_LP_SNAPSHOT_H_
+#define OR_TOOLS_LP_DATA_LP_SNAPSHOT_H_
+
+#include <string>
+
+#include "lp_data/lp_data.h"
+
+namespace operations_research {
+namespace glop {
+
+// Writes the given linear program to the given file. Returns false if the file
+// couldn't be written. The columns of the program don't need to be cleaned up.
+bool WriteLinearProgramSnapshot(const LinearProgram& linear_program,
+                                const std::string& file_name);
+
+// Replaces the content of linear_program with the one of the given snapshot
+// file. Returns false and leaves linear_program empty if the file can't be
+// read or is not a valid snapshot for this version of the format and this
+// machine.
+bool ReadLinearProgramSnapshot(const std::string& file_name,
+                               LinearProgram* linear_program);
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_LP_DATA_LP_SNAPSHOT_H_
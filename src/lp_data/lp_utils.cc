@@ -14,6 +14,8 @@
 
 #include "lp_data/lp_utils.h"
 
+#include <algorithm>
+
 namespace operations_research {
 namespace glop {
 
@@ -134,5 +136,17 @@ bool IsDominated(const SparseColumn& column, const DenseColumn& radius) {
   return true;
 }
 
+int ComputeNumColumnChunks(ColIndex num_cols, int num_threads) {
+#ifdef OMP
+  // The passes over the columns are not worth a thread for fewer columns.
+  const int kMinNumColumnsPerChunk = 1000;
+  const int max_num_chunks =
+      std::max(1, num_cols.value() / kMinNumColumnsPerChunk);
+  return std::max(1, std::min(num_threads, max_num_chunks));
+#else
+  return 1;
+#endif
+}
+
 }  // namespace glop
 }  // namespace operations_research
@@ -261,6 +261,31 @@ inline void ChangeSign(StrictITIVector<IndexType, Fractional>* data) {
   }
 }
 
+// Returns the number of chunks that ForEachColumnChunk() should use to process
+// num_cols columns with at most num_threads threads. This is 1 if the code is
+// not compiled with OMP or if there are too few columns to be worth a thread.
+int ComputeNumColumnChunks(ColIndex num_cols, int num_threads);
+
+// Calls process_chunk(chunk, begin, end) for each of the num_chunks contiguous
+// ranges [begin, end) of columns that partition [0, num_cols). The chunks are
+// processed in parallel when the code is compiled with OMP. The ranges only
+// depend on num_chunks, so the results combined in the chunk order are
+// deterministic for a given number of chunks.
+template <typename ChunkProcessor>
+void ForEachColumnChunk(ColIndex num_cols, int num_chunks,
+                        const ChunkProcessor& process_chunk) {
+#ifdef OMP
+#pragma omp parallel for num_threads(num_chunks)
+#endif
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    const ColIndex begin(num_cols.value() * static_cast<int64>(chunk) /
+                         num_chunks);
+    const ColIndex end(num_cols.value() * static_cast<int64>(chunk + 1) /
+                       num_chunks);
+    process_chunk(chunk, begin, end);
+  }
+}
+
 // Given N Fractional elements, this class maintains their sum and can
 // provide, for each element X, the sum of all elements except X.
 // The subtelty is that it works well with infinities: for example, if there is
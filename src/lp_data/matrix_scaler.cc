@@ -11,7 +11,6 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-
 #include "lp_data/matrix_scaler.h"
 
 #include <algorithm>
@@ -27,7 +26,11 @@ namespace operations_research {
 namespace glop {
 
 SparseMatrixScaler::SparseMatrixScaler()
-    : matrix_(nullptr), row_scale_(), col_scale_() {}
+    : matrix_(nullptr),
+      row_scale_(),
+      col_scale_(),
+      scaling_algorithm_(GEOMETRIC_SCALING),
+      num_threads_(1) {}
 
 void SparseMatrixScaler::Init(SparseMatrix* matrix) {
   DCHECK(matrix != nullptr);
@@ -40,6 +43,8 @@ void SparseMatrixScaler::Clear() {
   matrix_ = nullptr;
   row_scale_.clear();
   col_scale_.clear();
+  scaling_algorithm_ = GEOMETRIC_SCALING;
+  num_threads_ = 1;
 }
 
 Fractional SparseMatrixScaler::row_scale(RowIndex row) const {
@@ -93,24 +98,31 @@ void SparseMatrixScaler::Scale() {
     return;  // Null matrix: nothing to do.
   }
   VLOG(1) << "Before scaling:\n" << DebugInformationString();
-  // TODO(user): Decide precisely for which value of dynamic range we should cut
-  // off geometric scaling.
-  const Fractional dynamic_range = max_magnitude / min_magnitude;
-  const Fractional kMaxDynamicRangeForGeometricScaling = 1e20;
-  if (dynamic_range < kMaxDynamicRangeForGeometricScaling) {
-    const int kScalingIterations = 4;
-    const Fractional kVarianceThreshold(10.0);
-    for (int iteration = 0; iteration < kScalingIterations; ++iteration) {
-      const RowIndex num_rows_scaled = ScaleRowsGeometrically();
-      const ColIndex num_cols_scaled = ScaleColumnsGeometrically();
-      const Fractional variance = VarianceOfAbsoluteValueOfNonZeros();
-      VLOG(1) << "Geometric scaling iteration " << iteration
-              << ". Rows scaled = " << num_rows_scaled
-              << ", columns scaled = " << num_cols_scaled << "\n";
-      VLOG(1) << DebugInformationString();
-      if (variance < kVarianceThreshold ||
-          (num_cols_scaled == 0 && num_rows_scaled == 0)) {
-        break;
+  if (scaling_algorithm_ == CURTIS_REID_SCALING) {
+    const int num_iterations = ScaleWithCurtisReid();
+    VLOG(1) << "Curtis-Reid scaling: " << num_iterations
+            << " conjugate gradient iterations.\n";
+    VLOG(1) << DebugInformationString();
+  } else {
+    // TODO(user): Decide precisely for which value of dynamic range we should
+    // cut off geometric scaling.
+    const Fractional dynamic_range = max_magnitude / min_magnitude;
+    const Fractional kMaxDynamicRangeForGeometricScaling = 1e20;
+    if (dynamic_range < kMaxDynamicRangeForGeometricScaling) {
+      const int kScalingIterations = 4;
+      const Fractional kVarianceThreshold(10.0);
+      for (int iteration = 0; iteration < kScalingIterations; ++iteration) {
+        const RowIndex num_rows_scaled = ScaleRowsGeometrically();
+        const ColIndex num_cols_scaled = ScaleColumnsGeometrically();
+        const Fractional variance = VarianceOfAbsoluteValueOfNonZeros();
+        VLOG(1) << "Geometric scaling iteration " << iteration
+                << ". Rows scaled = " << num_rows_scaled
+                << ", columns scaled = " << num_cols_scaled << "\n";
+        VLOG(1) << DebugInformationString();
+        if (variance < kVarianceThreshold ||
+            (num_cols_scaled == 0 && num_rows_scaled == 0)) {
+          break;
+        }
       }
     }
   }
@@ -151,21 +163,46 @@ void SparseMatrixScaler::ScaleColumnVector(bool up,
   ScaleVector(row_scale_, up, column_vector);
 }
 
+int SparseMatrixScaler::NumColumnChunks() const {
+  return ComputeNumColumnChunks(matrix_->num_cols(), num_threads_);
+}
+
 Fractional SparseMatrixScaler::VarianceOfAbsoluteValueOfNonZeros() const {
   DCHECK(matrix_ != nullptr);
+  // The partial sums of each chunk are added in a fixed order so that the
+  // result doesn't depend on the scheduling of the threads.
+  const int num_chunks = NumColumnChunks();
+  std::vector<Fractional> chunk_sigma_square(num_chunks, 0.0);
+  std::vector<Fractional> chunk_sigma_abs(num_chunks, 0.0);
+  std::vector<double> chunk_n(num_chunks, 0.0);
+  ForEachColumnChunk(
+      matrix_->num_cols(), num_chunks,
+      [this, &chunk_sigma_square, &chunk_sigma_abs, &chunk_n](
+          int chunk, ColIndex begin, ColIndex end) {
+        Fractional sigma_square(0.0);
+        Fractional sigma_abs(0.0);
+        double n = 0.0;
+        for (ColIndex col(begin); col < end; ++col) {
+          for (const SparseColumn::Entry e : matrix_->column(col)) {
+            const Fractional magnitude = fabs(e.coefficient());
+            if (magnitude != 0.0) {
+              sigma_square += magnitude * magnitude;
+              sigma_abs += magnitude;
+              ++n;
+            }
+          }
+        }
+        chunk_sigma_square[chunk] = sigma_square;
+        chunk_sigma_abs[chunk] = sigma_abs;
+        chunk_n[chunk] = n;
+      });
   Fractional sigma_square(0.0);
   Fractional sigma_abs(0.0);
   double n = 0.0;  // n is used in a calculation involving doubles.
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      if (magnitude != 0.0) {
-        sigma_square += magnitude * magnitude;
-        sigma_abs += magnitude;
-        ++n;
-      }
-    }
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    sigma_square += chunk_sigma_square[chunk];
+    sigma_abs += chunk_sigma_abs[chunk];
+    n += chunk_n[chunk];
   }
   if (n == 0.0) return 0.0;
   // Since we know all the population (the non-zeros) and we are not using a
@@ -176,6 +213,46 @@ Fractional SparseMatrixScaler::VarianceOfAbsoluteValueOfNonZeros() const {
   return (sigma_square - sigma_abs * sigma_abs / n) / n;
 }
 
+void SparseMatrixScaler::ComputeRowMinAndMaxMagnitudes(
+    DenseColumn* min_in_row, DenseColumn* max_in_row) const {
+  DCHECK(matrix_ != nullptr);
+  // Each chunk of columns computes its own bounds, they are then merged. The
+  // min and max don't depend on the order of the merge.
+  const RowIndex num_rows = matrix_->num_rows();
+  const int num_chunks = NumColumnChunks();
+  std::vector<DenseColumn> chunk_min(num_chunks);
+  std::vector<DenseColumn> chunk_max(num_chunks);
+  ForEachColumnChunk(
+      matrix_->num_cols(), num_chunks,
+      [this, num_rows, &chunk_min, &chunk_max](int chunk, ColIndex begin,
+                                               ColIndex end) {
+        DenseColumn* const min_magnitude = &chunk_min[chunk];
+        DenseColumn* const max_magnitude = &chunk_max[chunk];
+        min_magnitude->assign(num_rows, kInfinity);
+        max_magnitude->assign(num_rows, 0.0);
+        for (ColIndex col(begin); col < end; ++col) {
+          for (const SparseColumn::Entry e : matrix_->column(col)) {
+            const Fractional magnitude = fabs(e.coefficient());
+            const RowIndex row = e.row();
+            if (magnitude != 0.0) {
+              (*max_magnitude)[row] =
+                  std::max((*max_magnitude)[row], magnitude);
+              (*min_magnitude)[row] =
+                  std::min((*min_magnitude)[row], magnitude);
+            }
+          }
+        }
+      });
+  min_in_row->swap(chunk_min[0]);
+  max_in_row->swap(chunk_max[0]);
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    for (RowIndex row(0); row < num_rows; ++row) {
+      (*min_in_row)[row] = std::min((*min_in_row)[row], chunk_min[chunk][row]);
+      (*max_in_row)[row] = std::max((*max_in_row)[row], chunk_max[chunk][row]);
+    }
+  }
+}
+
 // For geometric scaling, we compute the maximum and minimum magnitudes
 // of non-zeros in a row (resp. column). Let us denote these numbers as
 // max and min. We then scale the row (resp. column) by dividing the
@@ -183,19 +260,9 @@ Fractional SparseMatrixScaler::VarianceOfAbsoluteValueOfNonZeros() const {
 
 RowIndex SparseMatrixScaler::ScaleRowsGeometrically() {
   DCHECK(matrix_ != nullptr);
-  DenseColumn max_in_row(matrix_->num_rows(), 0.0);
-  DenseColumn min_in_row(matrix_->num_rows(), kInfinity);
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      const RowIndex row = e.row();
-      if (magnitude != 0.0) {
-        max_in_row[row] = std::max(max_in_row[row], magnitude);
-        min_in_row[row] = std::min(min_in_row[row], magnitude);
-      }
-    }
-  }
+  DenseColumn max_in_row;
+  DenseColumn min_in_row;
+  ComputeRowMinAndMaxMagnitudes(&min_in_row, &max_in_row);
   const RowIndex num_rows = matrix_->num_rows();
   DenseColumn scaling_factor(num_rows, 0.0);
   for (RowIndex row(0); row < num_rows; ++row) {
@@ -211,23 +278,33 @@ RowIndex SparseMatrixScaler::ScaleRowsGeometrically() {
 
 ColIndex SparseMatrixScaler::ScaleColumnsGeometrically() {
   DCHECK(matrix_ != nullptr);
+  const int num_chunks = NumColumnChunks();
+  std::vector<ColIndex> chunk_num_cols_scaled(num_chunks, ColIndex(0));
+  ForEachColumnChunk(
+      matrix_->num_cols(), num_chunks,
+      [this, &chunk_num_cols_scaled](int chunk, ColIndex begin, ColIndex end) {
+        ColIndex num_cols_scaled(0);
+        for (ColIndex col(begin); col < end; ++col) {
+          Fractional max_in_col(0.0);
+          Fractional min_in_col(kInfinity);
+          for (const SparseColumn::Entry e : matrix_->column(col)) {
+            const Fractional magnitude = fabs(e.coefficient());
+            if (magnitude != 0.0) {
+              max_in_col = std::max(max_in_col, magnitude);
+              min_in_col = std::min(min_in_col, magnitude);
+            }
+          }
+          if (max_in_col != 0.0) {
+            const Fractional factor(sqrt(ToDouble(max_in_col * min_in_col)));
+            ScaleMatrixColumn(col, factor);
+            num_cols_scaled++;
+          }
+        }
+        chunk_num_cols_scaled[chunk] = num_cols_scaled;
+      });
   ColIndex num_cols_scaled(0);
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    Fractional max_in_col(0.0);
-    Fractional min_in_col(kInfinity);
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      if (magnitude != 0.0) {
-        max_in_col = std::max(max_in_col, magnitude);
-        min_in_col = std::min(min_in_col, magnitude);
-      }
-    }
-    if (max_in_col != 0.0) {
-      const Fractional factor(sqrt(ToDouble(max_in_col * min_in_col)));
-      ScaleMatrixColumn(col, factor);
-      num_cols_scaled++;
-    }
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    num_cols_scaled += chunk_num_cols_scaled[chunk];
   }
   return num_cols_scaled;
 }
@@ -240,17 +317,9 @@ ColIndex SparseMatrixScaler::ScaleColumnsGeometrically() {
 RowIndex SparseMatrixScaler::EquilibrateRows() {
   DCHECK(matrix_ != nullptr);
   const RowIndex num_rows = matrix_->num_rows();
-  DenseColumn max_magnitude(num_rows, 0.0);
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      if (magnitude != 0.0) {
-        const RowIndex row = e.row();
-        max_magnitude[row] = std::max(max_magnitude[row], magnitude);
-      }
-    }
-  }
+  DenseColumn max_magnitude;
+  DenseColumn min_magnitude;
+  ComputeRowMinAndMaxMagnitudes(&min_magnitude, &max_magnitude);
   for (RowIndex row(0); row < num_rows; ++row) {
     if (max_magnitude[row] == 0.0) {
       max_magnitude[row] = 1.0;
@@ -261,16 +330,163 @@ RowIndex SparseMatrixScaler::EquilibrateRows() {
 
 ColIndex SparseMatrixScaler::EquilibrateColumns() {
   DCHECK(matrix_ != nullptr);
+  const int num_chunks = NumColumnChunks();
+  std::vector<ColIndex> chunk_num_cols_scaled(num_chunks, ColIndex(0));
+  ForEachColumnChunk(
+      matrix_->num_cols(), num_chunks,
+      [this, &chunk_num_cols_scaled](int chunk, ColIndex begin, ColIndex end) {
+        ColIndex num_cols_scaled(0);
+        for (ColIndex col(begin); col < end; ++col) {
+          const Fractional max_magnitude = InfinityNorm(matrix_->column(col));
+          if (max_magnitude != 0.0) {
+            ScaleMatrixColumn(col, max_magnitude);
+            num_cols_scaled++;
+          }
+        }
+        chunk_num_cols_scaled[chunk] = num_cols_scaled;
+      });
   ColIndex num_cols_scaled(0);
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    num_cols_scaled += chunk_num_cols_scaled[chunk];
+  }
+  return num_cols_scaled;
+}
+
+// The Curtis-Reid scaling computes the base 2 logarithms rho of the row scaling
+// factors and gamma of the column scaling factors that minimize
+//   sum over the non-zeros a_ij of (log2|a_ij| - rho_i - gamma_j)^2.
+// The optimality conditions of this least-squares problem are
+//   M.rho   + E.gamma = sigma
+//   E^T.rho + N.gamma = tau
+// where E is the 0/1 matrix with the non-zero pattern of the matrix, M and N
+// are the diagonal matrices of the number of non-zeros of each row and column,
+// and sigma and tau are the sums of the log2|a_ij| of each row and column.
+// This system is singular (one can add a constant to rho and subtract it from
+// gamma) but consistent, so the conjugate gradient method preconditioned by
+// diag(M, N) converges to one of its solutions. Only an approximate solution
+// is needed since the rows and columns are equilibrated afterwards.
+
+int SparseMatrixScaler::ScaleWithCurtisReid() {
+  DCHECK(matrix_ != nullptr);
+  const RowIndex num_rows = matrix_->num_rows();
   const ColIndex num_cols = matrix_->num_cols();
+  const int num_chunks = NumColumnChunks();
+
+  // The unknowns are stored in a single vector: first rho, then gamma. The
+  // column col corresponds to the index num_rows + col.
+  const int num_row_unknowns = num_rows.value();
+  const int size = num_row_unknowns + num_cols.value();
+  std::vector<Fractional> rhs(size, 0.0);
+  std::vector<Fractional> diagonal(size, 0.0);
   for (ColIndex col(0); col < num_cols; ++col) {
-    const Fractional max_magnitude = InfinityNorm(matrix_->column(col));
-    if (max_magnitude != 0.0) {
-      ScaleMatrixColumn(col, max_magnitude);
-      num_cols_scaled++;
+    const int col_index = num_row_unknowns + col.value();
+    for (const SparseColumn::Entry e : matrix_->column(col)) {
+      const Fractional magnitude = fabs(e.coefficient());
+      if (magnitude != 0.0) {
+        const Fractional log_magnitude = log2(magnitude);
+        rhs[e.row().value()] += log_magnitude;
+        rhs[col_index] += log_magnitude;
+        ++diagonal[e.row().value()];
+        ++diagonal[col_index];
+      }
     }
   }
-  return num_cols_scaled;
+  std::vector<Fractional> inverse_diagonal(size, 0.0);
+  for (int i = 0; i < size; ++i) {
+    if (diagonal[i] != 0.0) inverse_diagonal[i] = 1.0 / diagonal[i];
+  }
+
+  // Computes product = K.vector where K is the matrix of the system above. As
+  // for the row bounds, each chunk accumulates its own row part.
+  std::vector<std::vector<Fractional>> chunk_row_product(num_chunks);
+  const auto multiply = [this, num_row_unknowns, num_chunks, &diagonal,
+                         &chunk_row_product](
+      const std::vector<Fractional>& vector,
+      std::vector<Fractional>* product) {
+    ForEachColumnChunk(
+        matrix_->num_cols(), num_chunks,
+        [this, num_row_unknowns, &vector, product, &diagonal,
+         &chunk_row_product](int chunk, ColIndex begin, ColIndex end) {
+          std::vector<Fractional>* const row_product =
+              &chunk_row_product[chunk];
+          row_product->assign(num_row_unknowns, 0.0);
+          for (ColIndex col(begin); col < end; ++col) {
+            const int col_index = num_row_unknowns + col.value();
+            const Fractional col_value = vector[col_index];
+            Fractional sum = diagonal[col_index] * col_value;
+            for (const SparseColumn::Entry e : matrix_->column(col)) {
+              if (e.coefficient() != 0.0) {
+                const int row_index = e.row().value();
+                sum += vector[row_index];
+                (*row_product)[row_index] += col_value;
+              }
+            }
+            (*product)[col_index] = sum;
+          }
+        });
+    for (int row_index = 0; row_index < num_row_unknowns; ++row_index) {
+      Fractional sum = diagonal[row_index] * vector[row_index];
+      for (int chunk = 0; chunk < num_chunks; ++chunk) {
+        sum += chunk_row_product[chunk][row_index];
+      }
+      (*product)[row_index] = sum;
+    }
+  };
+
+  // Preconditioned conjugate gradient, starting from zero.
+  const int kMaxNumIterations = 50;
+  const Fractional kRelativeTolerance = 1e-6;
+  std::vector<Fractional> solution(size, 0.0);
+  std::vector<Fractional> residual = rhs;
+  std::vector<Fractional> preconditioned(size, 0.0);
+  std::vector<Fractional> direction(size, 0.0);
+  std::vector<Fractional> product(size, 0.0);
+  Fractional residual_dot = 0.0;
+  for (int i = 0; i < size; ++i) {
+    preconditioned[i] = inverse_diagonal[i] * residual[i];
+    direction[i] = preconditioned[i];
+    residual_dot += residual[i] * preconditioned[i];
+  }
+  const Fractional initial_residual_dot = residual_dot;
+  int num_iterations = 0;
+  while (num_iterations < kMaxNumIterations &&
+         residual_dot > kRelativeTolerance * initial_residual_dot) {
+    ++num_iterations;
+    multiply(direction, &product);
+    Fractional curvature = 0.0;
+    for (int i = 0; i < size; ++i) curvature += direction[i] * product[i];
+    if (curvature <= 0.0) break;
+    const Fractional step = residual_dot / curvature;
+    Fractional new_residual_dot = 0.0;
+    for (int i = 0; i < size; ++i) {
+      solution[i] += step * direction[i];
+      residual[i] -= step * product[i];
+      preconditioned[i] = inverse_diagonal[i] * residual[i];
+      new_residual_dot += residual[i] * preconditioned[i];
+    }
+    const Fractional beta = new_residual_dot / residual_dot;
+    for (int i = 0; i < size; ++i) {
+      direction[i] = preconditioned[i] + beta * direction[i];
+    }
+    residual_dot = new_residual_dot;
+  }
+
+  // Note that the unknowns of the empty rows and columns stay at zero, so their
+  // factors are 1.0.
+  DenseColumn row_factors(num_rows, 1.0);
+  for (RowIndex row(0); row < num_rows; ++row) {
+    row_factors[row] = exp2(solution[row.value()]);
+  }
+  ScaleMatrixRows(row_factors);
+  ForEachColumnChunk(num_cols, num_chunks, [this, num_row_unknowns, &solution](
+                                               int chunk, ColIndex begin,
+                                               ColIndex end) {
+    for (ColIndex col(begin); col < end; ++col) {
+      const Fractional log_factor = solution[num_row_unknowns + col.value()];
+      if (log_factor != 0.0) ScaleMatrixColumn(col, exp2(log_factor));
+    }
+  });
+  return num_iterations;
 }
 
 RowIndex SparseMatrixScaler::ScaleMatrixRows(const DenseColumn& factors) {
@@ -288,13 +504,16 @@ RowIndex SparseMatrixScaler::ScaleMatrixRows(const DenseColumn& factors) {
     }
   }
 
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    SparseColumn* const column = matrix_->mutable_column(col);
-    if (column != nullptr) {
-      column->ComponentWiseDivide(factors);
-    }
-  }
+  ForEachColumnChunk(matrix_->num_cols(), NumColumnChunks(),
+                     [this, &factors](int chunk, ColIndex begin, ColIndex end) {
+                       for (ColIndex col(begin); col < end; ++col) {
+                         SparseColumn* const column =
+                             matrix_->mutable_column(col);
+                         if (column != nullptr) {
+                           column->ComponentWiseDivide(factors);
+                         }
+                       }
+                     });
 
   return num_rows_scaled;
 }
@@ -314,17 +533,20 @@ void SparseMatrixScaler::ScaleMatrixColumn(ColIndex col, Fractional factor) {
 void SparseMatrixScaler::Unscale() {
   // Unscaling is easier than scaling since all scaling factors are stored.
   DCHECK(matrix_ != nullptr);
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    const Fractional column_scale = col_scale_[col];
-    DCHECK_NE(0.0, column_scale);
+  ForEachColumnChunk(
+      matrix_->num_cols(), NumColumnChunks(),
+      [this](int chunk, ColIndex begin, ColIndex end) {
+        for (ColIndex col(begin); col < end; ++col) {
+          const Fractional column_scale = col_scale_[col];
+          DCHECK_NE(0.0, column_scale);
 
-    SparseColumn* const column = matrix_->mutable_column(col);
-    if (column != nullptr) {
-      column->MultiplyByConstant(column_scale);
-      column->ComponentWiseMultiply(row_scale_);
-    }
-  }
+          SparseColumn* const column = matrix_->mutable_column(col);
+          if (column != nullptr) {
+            column->MultiplyByConstant(column_scale);
+            column->ComponentWiseMultiply(row_scale_);
+          }
+        }
+      });
 }
 
 }  // namespace glop
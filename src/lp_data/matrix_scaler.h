@@ -75,6 +75,10 @@ class SparseMatrix;
 
 class SparseMatrixScaler {
  public:
+  // The algorithms that Scale() can use before the final equilibration step.
+  // See GlopParameters::ScalingAlgorithm.
+  enum ScalingAlgorithm { GEOMETRIC_SCALING, CURTIS_REID_SCALING };
+
   SparseMatrixScaler();
 
   // Initializes the object with the SparseMatrix passed as argument.
@@ -86,6 +90,18 @@ class SparseMatrixScaler {
   // constructed.
   void Clear();
 
+  // Sets the algorithm used by Scale(). The default is GEOMETRIC_SCALING.
+  void SetScalingAlgorithm(ScalingAlgorithm algorithm) {
+    scaling_algorithm_ = algorithm;
+  }
+
+  // Sets the maximum number of threads used by the passes over the columns of
+  // the matrix. The columns are split into contiguous ranges that only depend
+  // on this number, so the result is deterministic for a given number of
+  // threads. This is only used when the code is compiled with OMP. The default
+  // is 1.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
   // Returns the scaling factor of the given row/col. If the given row/col is
   // outside the range of the matrix used in Init(), returns 1.0. This is to
   // simplify the use of the scaler if the matrix was extended afterwards.
@@ -130,7 +146,19 @@ class SparseMatrixScaler {
   // scaled. Helper function to Scale().
   ColIndex EquilibrateColumns();
 
+  // Scales the rows and the columns with the Curtis-Reid algorithm. Returns the
+  // number of conjugate gradient iterations. Helper function to Scale().
+  int ScaleWithCurtisReid();
+
  private:
+  // Returns the number of ranges of columns processed in parallel.
+  int NumColumnChunks() const;
+
+  // Computes the minimum and maximum magnitudes of the non-zeros of each row.
+  // The minimum is kInfinity and the maximum 0.0 for the empty rows.
+  void ComputeRowMinAndMaxMagnitudes(DenseColumn* min_in_row,
+                                     DenseColumn* max_in_row) const;
+
   // Scales the row indexed by row by 1/factor.
   // Used by ScaleMatrixRowsGeometrically and EquilibrateRows.
   RowIndex ScaleMatrixRows(const DenseColumn& factors);
@@ -153,6 +181,9 @@ class SparseMatrixScaler {
   // Array of scaling factors for each column. Indexed by column number.
   DenseRow col_scale_;
 
+  ScalingAlgorithm scaling_algorithm_;
+  int num_threads_;
+
   DISALLOW_COPY_AND_ASSIGN(SparseMatrixScaler);
 };
 
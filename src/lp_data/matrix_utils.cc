@@ -14,6 +14,7 @@
 #include "lp_data/matrix_utils.h"
 #include <algorithm>
 #include "base/hash.h"
+#include "lp_data/lp_utils.h"
 
 namespace operations_research {
 namespace glop {
@@ -110,16 +111,29 @@ ColumnFingerprint ComputeFingerprint(ColIndex col, const SparseColumn& column) {
 }  // namespace
 
 ColMapping FindProportionalColumns(const SparseMatrix& matrix,
-                                   Fractional tolerance) {
+                                   Fractional tolerance, int num_threads) {
   const ColIndex num_cols = matrix.num_cols();
   ColMapping mapping(num_cols, kInvalidCol);
 
-  // Compute the fingerprint of each columns and sort them.
+  // Compute the fingerprint of each columns and sort them. The columns are
+  // independent, so the fingerprints are computed by chunks of columns and
+  // the ones of the non-empty columns are then gathered in the column order.
+  std::vector<ColumnFingerprint> column_fingerprints(
+      num_cols.value(), ColumnFingerprint(kInvalidCol, 0, 0.0));
+  ForEachColumnChunk(
+      num_cols, ComputeNumColumnChunks(num_cols, num_threads),
+      [&matrix, &column_fingerprints](int chunk, ColIndex begin,
+                                      ColIndex end) {
+        for (ColIndex col(begin); col < end; ++col) {
+          if (!matrix.column(col).IsEmpty()) {
+            column_fingerprints[col.value()] =
+                ComputeFingerprint(col, matrix.column(col));
+          }
+        }
+      });
   std::vector<ColumnFingerprint> fingerprints;
-  for (ColIndex col(0); col < num_cols; ++col) {
-    if (!matrix.column(col).IsEmpty()) {
-      fingerprints.push_back(ComputeFingerprint(col, matrix.column(col)));
-    }
+  for (const ColumnFingerprint& fingerprint : column_fingerprints) {
+    if (fingerprint.col != kInvalidCol) fingerprints.push_back(fingerprint);
   }
   std::sort(fingerprints.begin(), fingerprints.end());
 
@@ -18,20 +18,17 @@
 #include <algorithm>
 #include "base/unique_ptr.h"
 #include <utility>
-#include <fstream>
+#include <cstring>
 
-#include "base/callback.h"
 #include "base/commandlineflags.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
-#include "base/file.h"
-#include "base/filelinereader.h"
 #include "base/map_util.h"  // for FindOrNull, FindWithDefault
 #include "base/numbers.h"    // for safe_strtod
-#include "base/split.h"
 #include "base/strutil.h"
 #include "lp_data/lp_print_utils.h"
 #include "base/status.h"
+#include "zlib.h"
 
 DEFINE_bool(mps_free_form, false, "Read MPS files in free form.");
 DEFINE_bool(mps_stop_after_first_error, true, "Stop after the first error.");
@@ -56,6 +53,8 @@ MPSReader::MPSReader()
       integer_type_names_set_(),
       line_num_(0),
       line_(),
+      last_column_name_(),
+      last_column_(kInvalidCol),
       has_lazy_constraints_(false),
       in_integer_section_(false),
       num_unconstrained_rows_(0) {
@@ -95,6 +94,9 @@ void MPSReader::Reset() {
   in_integer_section_ = false;
   num_unconstrained_rows_ = 0;
   objective_name_.clear();
+  last_column_name_.clear();
+  last_column_ = kInvalidCol;
+  matrix_triplets_.Clear();
 }
 
 void MPSReader::DisplaySummary() {
@@ -105,18 +107,32 @@ void MPSReader::DisplaySummary() {
   }
 }
 
+// Note that the fields are assigned in place so that their memory is reused
+// from one line to the next.
 void MPSReader::SplitLineIntoFields() {
   if (free_form_) {
-    fields_ = strings::Split(line_, " ", strings::SkipEmpty());
-    CHECK_GE(kNumFields, fields_.size());
+    int num_fields = 0;
+    const char* current = line_.c_str();
+    for (;;) {
+      while (*current == ' ') ++current;
+      if (*current == '\0') break;
+      const char* const field_start = current;
+      while (*current != ' ' && *current != '\0') ++current;
+      CHECK_GT(kNumFields, num_fields);
+      if (num_fields == fields_.size()) fields_.push_back(std::string());
+      fields_[num_fields].assign(field_start, current - field_start);
+      ++num_fields;
+    }
+    fields_.resize(num_fields);
   } else {
+    fields_.resize(kNumFields);
     int length = line_.length();
     for (int i = 0; i < kNumFields; ++i) {
       if (kFieldStartPos[i] < length) {
-        fields_[i] = line_.substr(kFieldStartPos[i], kFieldLength[i]);
+        fields_[i].assign(line_, kFieldStartPos[i], kFieldLength[i]);
         fields_[i].erase(fields_[i].find_last_not_of(" ") + 1);
       } else {
-        fields_[i] = "";
+        fields_[i].clear();
       }
     }
   }
@@ -140,21 +156,38 @@ bool MPSReader::LoadFile(const std::string& file_name, LinearProgram* data) {
   Reset();
   data_ = data;
   data_->Clear();
-  std::ifstream tmp_file(file_name.c_str());
-        const bool file_exists = tmp_file.good();
-        tmp_file.close();
-        if (file_exists) {
-          FileLineReader reader(file_name.c_str());
-          reader.set_line_callback(
-              NewPermanentCallback(this, &MPSReader::ProcessLine));
-          reader.Reload();
-    data->CleanUp();
-    DisplaySummary();
-    return reader.loaded_successfully() && parse_success_;
-  } else {
+
+  // Note that zlib reads the files that are not compressed as they are, so
+  // this handles both the .mps and the .mps.gz files.
+  gzFile file = gzopen(file_name.c_str(), "rb");
+  if (file == nullptr) {
     LOG(DFATAL) << "File not found: " << file_name;
     return false;
   }
+  const int kReadBufferSize = 1 << 20;
+  gzbuffer(file, kReadBufferSize);
+  const int kMaxLineLength = 60 * 1024;
+  std::unique_ptr<char[]> line(new char[kMaxLineLength]);
+  while (gzgets(file, line.get(), kMaxLineLength) != nullptr) {
+    // Chop the last linefeed and carriage return if present.
+    int length = strlen(line.get());
+    if (length > 0 && line[length - 1] == '\n') line[--length] = '\0';
+    if (length > 0 && line[length - 1] == '\r') line[--length] = '\0';
+    ProcessLine(line.get());
+
+    // There is no need to read the rest of a file that can't be parsed.
+    if (!parse_success_ && FLAGS_mps_stop_after_first_error) break;
+  }
+  int error_code = Z_OK;
+  const char* const error_message = gzerror(file, &error_code);
+  const bool loaded_successfully = error_code == Z_OK;
+  if (!loaded_successfully) {
+    LOG(ERROR) << "Error while reading " << file_name << ": " << error_message;
+  }
+  gzclose(file);
+  data->PopulateMatrixFromTriplets(&matrix_triplets_);
+  DisplaySummary();
+  return loaded_successfully && parse_success_;
 }
 
 // TODO(user): Ideally have a method to compare instances of LinearProgram
@@ -345,7 +378,14 @@ void MPSReader::ProcessColumnsSection() {
   const std::string& column_name = GetField(start_index, 0);
   const std::string& row1_name = GetField(start_index, 1);
   const std::string& row1_value = GetField(start_index, 2);
-  const ColIndex col = data_->FindOrCreateVariable(column_name);
+
+  // The entries of a column are usually given on consecutive lines, so we
+  // avoid the name lookup in this case.
+  if (last_column_ == kInvalidCol || column_name != last_column_name_) {
+    last_column_ = data_->FindOrCreateVariable(column_name);
+    last_column_name_ = column_name;
+  }
+  const ColIndex col = last_column_;
   is_binary_by_default_.resize(col + 1, false);
   if (in_integer_section_) {
     data_->SetVariableIntegrality(col, true);
@@ -420,7 +460,7 @@ void MPSReader::StoreCoefficient(ColIndex col, const std::string& row_name,
     data_->SetObjectiveCoefficient(col, value);
   } else {
     const RowIndex row = data_->FindOrCreateConstraint(row_name);
-    data_->SetCoefficient(row, col, value);
+    matrix_triplets_.AddEntry(row, col, value);
   }
 }
 
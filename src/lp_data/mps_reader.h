@@ -60,7 +60,7 @@ class MPSReader {
  public:
   MPSReader();
 
-  // Loads instance from a file.
+  // Loads instance from a file. The file can be compressed with gzip.
   bool LoadFile(const std::string& file_name, LinearProgram* data);
 
   // Loads instance from a file, specifying if free or fixed format is used.
@@ -172,6 +172,10 @@ class MPSReader {
 
   LinearProgram* data_;
 
+  // The coefficients of the constraint matrix read in the COLUMNS section.
+  // They are given to data_ at the end of the parsing.
+  SparseMatrixBuilder matrix_triplets_;
+
   // The name of the problem as defined on the NAME line in the MPS file.
   std::string problem_name_;
 
@@ -220,6 +224,10 @@ class MPSReader {
   // The current line in the file being parsed.
   std::string line_;
 
+  // The name and index of the column of the last line of the COLUMNS section.
+  std::string last_column_name_;
+  ColIndex last_column_;
+
   // A row of Booleans. is_binary_by_default_[col] is true if col
   // appeared within a scope started by INTORG and ended with INTEND markers.
   DenseBooleanRow is_binary_by_default_;
@@ -13,10 +13,12 @@
 
 
 #include <algorithm>
+#include <utility>
 
 #include "base/stringprintf.h"
 #include "base/join.h"
 #include "lp_data/lp_data.h"
+#include "lp_data/lp_utils.h"
 #include "lp_data/sparse.h"
 #include "util/return_macros.h"
 
@@ -477,6 +479,65 @@ void CompactSparseMatrix::PopulateFromTranspose(
   starts_[ColIndex(0)] = 0;
 }
 
+void CompactSparseMatrix::PopulateFromTranspose(
+    const CompactSparseMatrix& input, int num_threads) {
+  const int num_chunks = ComputeNumColumnChunks(input.num_cols(), num_threads);
+  if (num_chunks == 1) {
+    PopulateFromTranspose(input);
+    return;
+  }
+  num_cols_ = RowToColIndex(input.num_rows());
+  num_rows_ = ColToRowIndex(input.num_cols());
+
+  // Each chunk of input columns counts its entries in each transposed column.
+  std::vector<StrictITIVector<ColIndex, EntryIndex>> positions(num_chunks);
+  ForEachColumnChunk(
+      input.num_cols(), num_chunks,
+      [&input, &positions, this](int chunk, ColIndex begin, ColIndex end) {
+        StrictITIVector<ColIndex, EntryIndex>& counts = positions[chunk];
+        counts.assign(num_cols_, EntryIndex(0));
+        for (ColIndex col = begin; col < end; ++col) {
+          for (const EntryIndex i : input.Column(col)) {
+            ++counts[RowToColIndex(input.EntryRow(i))];
+          }
+        }
+      });
+
+  // Turns the counts into the position of the first entry of each chunk in
+  // each transposed column. The chunks are ordered like the input columns, so
+  // the entries end up in the same order as with a single thread.
+  starts_.resize(num_cols_ + 1, EntryIndex(0));
+  EntryIndex num_entries(0);
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    starts_[col] = num_entries;
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+      const EntryIndex count = positions[chunk][col];
+      positions[chunk][col] = num_entries;
+      num_entries += count;
+    }
+  }
+  starts_[num_cols_] = num_entries;
+  coefficients_.resize(num_entries, 0.0);
+  rows_.resize(num_entries, kInvalidRow);
+
+  // Each chunk scatters its entries, at disjoint positions.
+  ForEachColumnChunk(
+      input.num_cols(), num_chunks,
+      [&input, &positions, this](int chunk, ColIndex begin, ColIndex end) {
+        StrictITIVector<ColIndex, EntryIndex>& next = positions[chunk];
+        for (ColIndex col = begin; col < end; ++col) {
+          const RowIndex transposed_row = ColToRowIndex(col);
+          for (const EntryIndex i : input.Column(col)) {
+            const ColIndex transposed_col = RowToColIndex(input.EntryRow(i));
+            const EntryIndex index = next[transposed_col];
+            ++next[transposed_col];
+            coefficients_[index] = input.EntryCoefficient(i);
+            rows_[index] = transposed_row;
+          }
+        }
+      });
+}
+
 void TriangularMatrix::PopulateFromTranspose(const TriangularMatrix& input) {
   CompactSparseMatrix::PopulateFromTranspose(input);
 
@@ -572,6 +633,87 @@ void CompactSparseMatrix::Swap(CompactSparseMatrix* other) {
   starts_.swap(other->starts_);
 }
 
+// --------------------------------------------------------
+// SparseMatrixBuilder
+// --------------------------------------------------------
+void SparseMatrixBuilder::Clear() {
+  rows_.clear();
+  cols_.clear();
+  coefficients_.clear();
+}
+
+void SparseMatrixBuilder::Reserve(EntryIndex num_entries) {
+  rows_.reserve(num_entries.value());
+  cols_.reserve(num_entries.value());
+  coefficients_.reserve(num_entries.value());
+}
+
+void SparseMatrixBuilder::Build(RowIndex num_rows, ColIndex num_cols,
+                                SparseMatrix* output) {
+  RETURN_IF_NULL(output);
+  const EntryIndex num_entries(rows_.size());
+
+  // Counting sort of the triplets by column, as in
+  // CompactSparseMatrix::PopulateFromTranspose(). It is stable, so the
+  // triplets of a column stay in the order in which they were added.
+  starts_.assign(num_cols + 1, EntryIndex(0));
+  for (const ColIndex col : cols_) {
+    DCHECK_LT(col, num_cols);
+    ++starts_[col + 1];
+  }
+  for (ColIndex col(1); col < starts_.size(); ++col) {
+    starts_[col] += starts_[col - 1];
+  }
+  sorted_rows_.resize(num_entries, kInvalidRow);
+  sorted_coefficients_.resize(num_entries, 0.0);
+  for (EntryIndex i(0); i < num_entries; ++i) {
+    const ColIndex col = cols_[i.value()];
+    const EntryIndex index = starts_[col];
+    ++starts_[col];
+    DCHECK_LT(rows_[i.value()], num_rows);
+    sorted_rows_[index] = rows_[i.value()];
+    sorted_coefficients_[index] = coefficients_[i.value()];
+  }
+  for (ColIndex col(starts_.size() - 1); col > 0; --col) {
+    starts_[col] = starts_[col - 1];
+  }
+  starts_[ColIndex(0)] = EntryIndex(0);
+
+  // Sort each column by row and fill the output. The columns are independent,
+  // so this is done in parallel on chunks of columns.
+  output->PopulateFromZero(num_rows, num_cols);
+  const int num_chunks = ComputeNumColumnChunks(num_cols, num_threads_);
+  ForEachColumnChunk(num_cols, num_chunks, [this, output](int chunk,
+                                                         ColIndex begin,
+                                                         ColIndex end) {
+    std::vector<std::pair<RowIndex, Fractional>> entries;
+    for (ColIndex col = begin; col < end; ++col) {
+      entries.clear();
+      for (EntryIndex i = starts_[col]; i < starts_[col + 1]; ++i) {
+        entries.push_back(std::make_pair(sorted_rows_[i],
+                                         sorted_coefficients_[i]));
+      }
+
+      // A stable sort keeps the duplicates in the order in which they were
+      // added, so the last one of each run of equal rows is the one to keep.
+      std::stable_sort(entries.begin(), entries.end(),
+                       [](const std::pair<RowIndex, Fractional>& a,
+                          const std::pair<RowIndex, Fractional>& b) {
+                         return a.first < b.first;
+                       });
+      SparseColumn* const column = output->mutable_column(col);
+      column->Reserve(EntryIndex(entries.size()));
+      const int size = entries.size();
+      for (int i = 0; i < size; ++i) {
+        if (i + 1 < size && entries[i + 1].first == entries[i].first) continue;
+        if (entries[i].second != 0.0) {
+          column->SetCoefficient(entries[i].first, entries[i].second);
+        }
+      }
+    }
+  });
+}
+
 void TriangularMatrix::Swap(TriangularMatrix* other) {
   CompactSparseMatrix::Swap(other);
   diagonal_coefficients_.swap(other->diagonal_coefficients_);
@@ -893,6 +1035,191 @@ void TriangularMatrix::TransposeSparseTriangularSolve(
   }
 }
 
+template <typename BlockSolver>
+void TriangularMatrix::ForEachBlockOfRhs(const std::vector<DenseColumn*>& rhs,
+                                         int num_threads,
+                                         const BlockSolver& solve_block) const {
+  const int num_rhs = rhs.size();
+  const int block_size = kMultipleSolveBlockSize;
+  const int num_blocks = (num_rhs + block_size - 1) / block_size;
+#ifdef OMP
+  const int num_omp_threads = std::max(1, std::min(num_threads, num_blocks));
+#pragma omp parallel for num_threads(num_omp_threads)
+#endif
+  for (int block = 0; block < num_blocks; ++block) {
+    const int begin = block * block_size;
+    solve_block(rhs.data() + begin, std::min(block_size, num_rhs - begin));
+  }
+}
+
+template <bool diagonal_of_ones>
+void TriangularMatrix::EliminateColumnForMultipleRhs(ColIndex col,
+                                                     DenseColumn* const* rhs,
+                                                     int num_rhs) const {
+  // We only keep the rhs with a non-zero at the pivot position, this is what
+  // the single rhs solves do and it exploits the sparsity of each rhs.
+  Fractional coeffs[kMultipleSolveBlockSize];
+  DenseColumn* active_rhs[kMultipleSolveBlockSize];
+  int num_active = 0;
+  const RowIndex pivot_row = ColToRowIndex(col);
+  for (int j = 0; j < num_rhs; ++j) {
+    const Fractional value = (*rhs[j])[pivot_row];
+    if (value == 0.0) continue;
+    const Fractional coeff =
+        diagonal_of_ones ? value : value / diagonal_coefficients_[col];
+    if (!diagonal_of_ones) {
+      (*rhs[j])[pivot_row] = coeff;
+    }
+    coeffs[num_active] = coeff;
+    active_rhs[num_active] = rhs[j];
+    ++num_active;
+  }
+  if (num_active == 0) return;
+  for (const EntryIndex i : Column(col)) {
+    const RowIndex row = EntryRow(i);
+    const Fractional coefficient = EntryCoefficient(i);
+    for (int j = 0; j < num_active; ++j) {
+      (*active_rhs[j])[row] -= coeffs[j] * coefficient;
+    }
+  }
+}
+
+template <bool diagonal_of_ones>
+void TriangularMatrix::LowerSolveBlock(DenseColumn* const* rhs,
+                                       int num_rhs) const {
+  const ColIndex end = diagonal_coefficients_.size();
+  for (ColIndex col(first_non_identity_column_); col < end; ++col) {
+    EliminateColumnForMultipleRhs<diagonal_of_ones>(col, rhs, num_rhs);
+  }
+}
+
+template <bool diagonal_of_ones>
+void TriangularMatrix::UpperSolveBlock(DenseColumn* const* rhs,
+                                       int num_rhs) const {
+  const ColIndex end = first_non_identity_column_;
+  for (ColIndex col(diagonal_coefficients_.size() - 1); col >= end; --col) {
+    EliminateColumnForMultipleRhs<diagonal_of_ones>(col, rhs, num_rhs);
+  }
+}
+
+template <bool diagonal_of_ones>
+void TriangularMatrix::TransposeUpperSolveBlock(DenseColumn* const* rhs,
+                                                int num_rhs) const {
+  Fractional sums[kMultipleSolveBlockSize];
+  const ColIndex end = num_cols_;
+  EntryIndex i = starts_[first_non_identity_column_];
+  for (ColIndex col(first_non_identity_column_); col < end; ++col) {
+    const RowIndex pivot_row = ColToRowIndex(col);
+    for (int j = 0; j < num_rhs; ++j) sums[j] = (*rhs[j])[pivot_row];
+    const EntryIndex i_end = starts_[col + 1];
+    for (; i < i_end; ++i) {
+      const RowIndex row = EntryRow(i);
+      const Fractional coefficient = EntryCoefficient(i);
+      for (int j = 0; j < num_rhs; ++j) {
+        sums[j] -= coefficient * (*rhs[j])[row];
+      }
+    }
+    for (int j = 0; j < num_rhs; ++j) {
+      (*rhs[j])[pivot_row] =
+          diagonal_of_ones ? sums[j] : sums[j] / diagonal_coefficients_[col];
+    }
+  }
+}
+
+template <bool diagonal_of_ones>
+void TriangularMatrix::TransposeLowerSolveBlock(DenseColumn* const* rhs,
+                                                int num_rhs) const {
+  Fractional sums[kMultipleSolveBlockSize];
+  const ColIndex end = first_non_identity_column_;
+
+  // Like in TransposeLowerSolveInternal(), we skip the last positions where
+  // all the rhs are zero.
+  ColIndex col = num_cols_ - 1;
+  for (; col >= end; --col) {
+    int j = 0;
+    while (j < num_rhs && (*rhs[j])[ColToRowIndex(col)] == 0.0) ++j;
+    if (j < num_rhs) break;
+  }
+
+  EntryIndex i = starts_[col + 1] - 1;
+  for (; col >= end; --col) {
+    const RowIndex pivot_row = ColToRowIndex(col);
+    for (int j = 0; j < num_rhs; ++j) sums[j] = (*rhs[j])[pivot_row];
+    const EntryIndex i_end = starts_[col];
+    for (; i >= i_end; --i) {
+      const RowIndex row = EntryRow(i);
+      const Fractional coefficient = EntryCoefficient(i);
+      for (int j = 0; j < num_rhs; ++j) {
+        sums[j] -= coefficient * (*rhs[j])[row];
+      }
+    }
+    for (int j = 0; j < num_rhs; ++j) {
+      (*rhs[j])[pivot_row] =
+          diagonal_of_ones ? sums[j] : sums[j] / diagonal_coefficients_[col];
+    }
+  }
+}
+
+void TriangularMatrix::LowerSolveMultiple(const std::vector<DenseColumn*>& rhs,
+                                          int num_threads) const {
+  ForEachBlockOfRhs(rhs, num_threads,
+                    [this](DenseColumn* const* block, int num_rhs) {
+    if (all_diagonal_coefficients_are_one_) {
+      LowerSolveBlock<true>(block, num_rhs);
+    } else {
+      LowerSolveBlock<false>(block, num_rhs);
+    }
+  });
+}
+
+void TriangularMatrix::UpperSolveMultiple(const std::vector<DenseColumn*>& rhs,
+                                          int num_threads) const {
+  ForEachBlockOfRhs(rhs, num_threads,
+                    [this](DenseColumn* const* block, int num_rhs) {
+    if (all_diagonal_coefficients_are_one_) {
+      UpperSolveBlock<true>(block, num_rhs);
+    } else {
+      UpperSolveBlock<false>(block, num_rhs);
+    }
+  });
+}
+
+void TriangularMatrix::TransposeUpperSolveMultiple(
+    const std::vector<DenseColumn*>& rhs, int num_threads) const {
+  ForEachBlockOfRhs(rhs, num_threads,
+                    [this](DenseColumn* const* block, int num_rhs) {
+    if (all_diagonal_coefficients_are_one_) {
+      TransposeUpperSolveBlock<true>(block, num_rhs);
+    } else {
+      TransposeUpperSolveBlock<false>(block, num_rhs);
+    }
+  });
+}
+
+void TriangularMatrix::TransposeLowerSolveMultiple(
+    const std::vector<DenseColumn*>& rhs, int num_threads) const {
+  ForEachBlockOfRhs(rhs, num_threads,
+                    [this](DenseColumn* const* block, int num_rhs) {
+    if (all_diagonal_coefficients_are_one_) {
+      TransposeLowerSolveBlock<true>(block, num_rhs);
+    } else {
+      TransposeLowerSolveBlock<false>(block, num_rhs);
+    }
+  });
+}
+
+void TriangularMatrix::SparseTriangularSolveMultiple(
+    const RowIndexVector& non_zero_rows, const std::vector<DenseColumn*>& rhs,
+    int num_threads) const {
+  ForEachBlockOfRhs(rhs, num_threads,
+                    [this, &non_zero_rows](DenseColumn* const* block,
+                                           int num_rhs) {
+    for (const RowIndex row : Reverse(non_zero_rows)) {
+      EliminateColumnForMultipleRhs<false>(RowToColIndex(row), block, num_rhs);
+    }
+  });
+}
+
 void TriangularMatrix::PermutedLowerSolve(
     const SparseColumn& rhs, const RowPermutation& row_perm,
     const RowMapping& partial_inverse_row_perm, SparseColumn* lower,
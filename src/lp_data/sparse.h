@@ -28,6 +28,7 @@
 #define OR_TOOLS_LP_DATA_SPARSE_H_
 
 #include <string>
+#include <vector>
 
 #include "base/integral_types.h"
 #include "lp_data/lp_types.h"
@@ -283,6 +284,12 @@ class CompactSparseMatrix {
   // by row indices.
   void PopulateFromTranspose(const CompactSparseMatrix& input);
 
+  // Same as above, but the counting and the scattering of the entries are done
+  // on chunks of the input columns with up to num_threads threads when the
+  // code is compiled with OMP. The result does not depend on num_threads.
+  void PopulateFromTranspose(const CompactSparseMatrix& input,
+                             int num_threads);
+
   // Clears the matrix and sets its number of rows. If none of the Populate()
   // function has been called, Reset() must be called before calling any of the
   // Add*() functions below.
@@ -434,6 +441,67 @@ class CompactSparseMatrix {
   DISALLOW_COPY_AND_ASSIGN(CompactSparseMatrix);
 };
 
+// Builds a SparseMatrix from (row, col, coefficient) triplets given in any
+// order. The triplets are stored in three flat arrays, and Build() converts
+// them to the compressed-column form (the starts/rows/coefficients arrays of a
+// CompactSparseMatrix) with a counting sort on the columns. The entries of each
+// column are then sorted by row, in parallel on chunks of columns, and each
+// column of the output is allocated once with its exact size.
+//
+// For large matrices, this is a lot faster than calling SetCoefficient() on the
+// SparseColumn of each entry and then CleanUp() on the SparseMatrix, which
+// reallocates the columns as they grow.
+class SparseMatrixBuilder {
+ public:
+  SparseMatrixBuilder() : num_threads_(1) {}
+
+  // Removes all the triplets.
+  void Clear();
+
+  // Reserves the storage for the given number of triplets.
+  void Reserve(EntryIndex num_entries);
+
+  // Sets the maximum number of threads used by Build() to sort the columns.
+  // This is only used when the code is compiled with OMP.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
+  // Adds the triplet (row, col, coefficient).
+  void AddEntry(RowIndex row, ColIndex col, Fractional coefficient) {
+    DCHECK_GE(row, 0);
+    DCHECK_GE(col, 0);
+    rows_.push_back(row);
+    cols_.push_back(col);
+    coefficients_.push_back(coefficient);
+  }
+
+  // Returns the number of triplets added since the last Clear().
+  EntryIndex num_entries() const { return EntryIndex(rows_.size()); }
+
+  // Populates output with the num_rows x num_cols matrix given by the
+  // triplets, which must all be inside these dimensions. The result is the
+  // same as calling SetCoefficient() with each triplet in the order in which
+  // they were added and then CleanUp(): the entries of each column are sorted
+  // by row, the last triplet added wins for duplicates, and the zero
+  // coefficients are removed.
+  void Build(RowIndex num_rows, ColIndex num_cols, SparseMatrix* output);
+
+ private:
+  // The triplets, in the order in which they were added.
+  std::vector<RowIndex> rows_;
+  std::vector<ColIndex> cols_;
+  std::vector<Fractional> coefficients_;
+
+  // The triplets in compressed-column form, computed by Build(). The entries
+  // of column col are in [starts_[col], starts_[col + 1]).
+  StrictITIVector<ColIndex, EntryIndex> starts_;
+  StrictITIVector<EntryIndex, RowIndex> sorted_rows_;
+  StrictITIVector<EntryIndex, Fractional> sorted_coefficients_;
+
+  int num_threads_;
+
+  DISALLOW_COPY_AND_ASSIGN(SparseMatrixBuilder);
+};
+
 // Specialization of a CompactSparseMatrix used for triangular matrices.
 // To be able to solve triangular systems as efficiently as possible, the
 // diagonal entries are stored in a separate vector and not in the underlying
@@ -562,6 +630,27 @@ class TriangularMatrix : private CompactSparseMatrix {
   // aborts early and non_zero_rows is cleared.
   void TriangularComputeRowsToConsider(RowIndexVector* non_zero_rows) const;
 
+  // Versions of the solve functions above for many right-hand sides at once.
+  // The result is the same as calling the single right-hand side version on
+  // each of the given rhs, but the matrix entries are only read once for each
+  // small block of rhs, which is a lot more cache friendly. When compiled with
+  // OMP and num_threads > 1, the different blocks are solved in parallel.
+  void LowerSolveMultiple(const std::vector<DenseColumn*>& rhs,
+                          int num_threads) const;
+  void UpperSolveMultiple(const std::vector<DenseColumn*>& rhs,
+                          int num_threads) const;
+  void TransposeUpperSolveMultiple(const std::vector<DenseColumn*>& rhs,
+                                   int num_threads) const;
+  void TransposeLowerSolveMultiple(const std::vector<DenseColumn*>& rhs,
+                                   int num_threads) const;
+
+  // Hyper-sparse version for many right-hand sides. The non_zero_rows must be
+  // computed by TriangularComputeRowsToConsider() from the union of the
+  // non-zero positions of all the rhs, so the symbolic phase is shared.
+  void SparseTriangularSolveMultiple(const RowIndexVector& non_zero_rows,
+                                     const std::vector<DenseColumn*>& rhs,
+                                     int num_threads) const;
+
   // This is currently only used for testing. It achieves the same result as
   // PermutedLowerSparseSolve() below, but the latter exploits the sparsity of
   // rhs and is thus faster for our use case.
@@ -643,6 +732,29 @@ class TriangularMatrix : private CompactSparseMatrix {
   template <bool diagonal_of_ones>
   void TransposeUpperSolveInternal(DenseColumn* rhs) const;
 
+  // Maximum number of right-hand sides solved together by the *Multiple()
+  // functions. It is small so the rhs entries stay in cache.
+  static const int kMultipleSolveBlockSize = 8;
+
+  // Internal functions for the *Multiple() solves. Each of them solves a block
+  // of num_rhs <= kMultipleSolveBlockSize right-hand sides given by rhs[0],
+  // ..., rhs[num_rhs - 1]. ForEachBlockOfRhs() splits the given rhs in such
+  // blocks and calls solve_block() on each of them.
+  template <typename BlockSolver>
+  void ForEachBlockOfRhs(const std::vector<DenseColumn*>& rhs, int num_threads,
+                         const BlockSolver& solve_block) const;
+  template <bool diagonal_of_ones>
+  void EliminateColumnForMultipleRhs(ColIndex col, DenseColumn* const* rhs,
+                                     int num_rhs) const;
+  template <bool diagonal_of_ones>
+  void LowerSolveBlock(DenseColumn* const* rhs, int num_rhs) const;
+  template <bool diagonal_of_ones>
+  void UpperSolveBlock(DenseColumn* const* rhs, int num_rhs) const;
+  template <bool diagonal_of_ones>
+  void TransposeUpperSolveBlock(DenseColumn* const* rhs, int num_rhs) const;
+  template <bool diagonal_of_ones>
+  void TransposeLowerSolveBlock(DenseColumn* const* rhs, int num_rhs) const;
+
   // Internal function used by the Add*() functions to finish adding
   // a new column to a triangular matrix.
   void CloseCurrentColumn(Fractional diagonal_value);
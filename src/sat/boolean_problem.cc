@@ -134,6 +134,22 @@ void ChangeOptimizationDirection(LinearBooleanProblem* problem) {
   }
 }
 
+namespace {
+
+// Finds the symmetries of the problem within the deterministic time limit of
+// the solver parameters and adds them to the solver.
+void AddBooleanProblemSymmetries(const LinearBooleanProblem& problem,
+                                 SatSolver* solver) {
+  if (solver->IsModelUnsat()) return;
+  std::vector<std::unique_ptr<SparsePermutation>> generators;
+  const double time_limit =
+      solver->parameters().symmetry_detection_deterministic_time_limit();
+  FindLinearBooleanProblemSymmetries(problem, time_limit, &generators);
+  solver->AddSymmetries(&generators);
+}
+
+}  // namespace
+
 bool LoadBooleanProblem(const LinearBooleanProblem& problem,
                         SatSolver* solver) {
   // TODO(user): Currently, the sat solver can load without any issue
@@ -171,6 +187,9 @@ bool LoadBooleanProblem(const LinearBooleanProblem& problem,
   if (solver->parameters().log_search_progress()) {
     LOG(INFO) << "The problem contains " << num_terms << " terms.";
   }
+  if (solver->parameters().use_symmetry_detection()) {
+    AddBooleanProblemSymmetries(problem, solver);
+  }
   return true;
 }
 
@@ -187,6 +206,11 @@ bool LoadAndConsumeBooleanProblem(LinearBooleanProblem* problem,
               << problem->constraints_size() << " constraints.";
   }
   solver->SetNumVariables(problem->num_variables());
+
+  // The symmetries must be computed before the problem is consumed.
+  if (solver->parameters().use_symmetry_detection()) {
+    AddBooleanProblemSymmetries(*problem, solver);
+  }
   std::vector<LiteralWithCoeff> cst;
   int64 num_terms = 0;
   int num_constraints = 0;
@@ -586,6 +610,13 @@ void MakeAllLiteralsPositive(LinearBooleanProblem* problem) {
 void FindLinearBooleanProblemSymmetries(
     const LinearBooleanProblem& problem,
     std::vector<std::unique_ptr<SparsePermutation>>* generators) {
+  FindLinearBooleanProblemSymmetries(
+      problem, std::numeric_limits<double>::infinity(), generators);
+}
+
+void FindLinearBooleanProblemSymmetries(
+    const LinearBooleanProblem& problem, double deterministic_time_limit,
+    std::vector<std::unique_ptr<SparsePermutation>>* generators) {
   typedef GraphSymmetryFinder::Graph Graph;
   std::vector<int> equivalence_classes;
   std::unique_ptr<Graph> graph(
@@ -618,10 +649,15 @@ void FindLinearBooleanProblemSymmetries(
   GraphSymmetryFinder symmetry_finder(*graph.get(),
                                       /*graph_is_undirected=*/true);
   std::vector<int> factorized_automorphism_group_size;
-  // TODO(user): inject the appropriate time limit here.
-  CHECK_OK(symmetry_finder.FindSymmetries(
+  const util::Status status = symmetry_finder.FindSymmetries(
       /*time_limit_seconds=*/std::numeric_limits<double>::infinity(),
-      &equivalence_classes, generators, &factorized_automorphism_group_size));
+      deterministic_time_limit, &equivalence_classes, generators,
+      &factorized_automorphism_group_size);
+  if (status.error_code() == util::error::DEADLINE_EXCEEDED) {
+    LOG(INFO) << "Symmetry search stopped early: " << status.error_message();
+  } else {
+    CHECK_OK(status);
+  }
 
   // Remove from the permutations the part not concerning the literals.
   // Note that some permutation may becomes empty, which means that we had
@@ -108,6 +108,12 @@ void FindLinearBooleanProblemSymmetries(
     const LinearBooleanProblem& problem,
     std::vector<std::unique_ptr<SparsePermutation>>* generators);
 
+// Same as above, but the symmetry search stops after the given deterministic
+// time. The generators found so far are still valid symmetries.
+void FindLinearBooleanProblemSymmetries(
+    const LinearBooleanProblem& problem, double deterministic_time_limit,
+    std::vector<std::unique_ptr<SparsePermutation>>* generators);
+
 // Maps all the literals of the problem. Note that this converts the cost of a
 // variable correctly, that is if a variable with cost is mapped to another, the
 // cost of the later is updated.
@@ -14,6 +14,7 @@
 #include "sat/clause.h"
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
 #include "base/unique_ptr.h"
 #include <string>
@@ -81,6 +82,18 @@ void LiteralWatchers::AttachOnFalse(Literal a, Literal b, SatClause* clause) {
   SCOPED_TIME_STAT(&stats_);
   DCHECK(is_clean_);
   DCHECK(!WatcherListContains(watchers_on_false_[a.Index()], *clause));
+
+  // For a ternary clause, the watcher also stores its third literal so that
+  // PropagateOnFalse() can skip it without looking at the clause memory as
+  // soon as any of the two other literals is true.
+  if (clause->Size() == 3) {
+    for (const Literal literal : *clause) {
+      if (literal != a && literal != b) {
+        watchers_on_false_[a.Index()].push_back(Watcher(clause, b, literal));
+        return;
+      }
+    }
+  }
   watchers_on_false_[a.Index()].push_back(Watcher(clause, b));
 }
 
@@ -97,7 +110,9 @@ bool LiteralWatchers::PropagateOnFalse(Literal false_literal, Trail* trail) {
   for (std::vector<Watcher>::iterator it = watchers.begin(); it != watchers.end();
        ++it) {
     // Don't even look at the clause memory if the blocking literal is true.
-    if (assignment.IsLiteralTrue(it->blocking_literal)) {
+    // Note that for a ternary clause, the two other literals are blocking.
+    if (assignment.IsLiteralTrue(it->blocking_literal) ||
+        assignment.IsLiteralTrue(it->ternary_literal)) {
       *new_it++ = *it;
       continue;
     }
@@ -196,6 +211,16 @@ void LiteralWatchers::CleanUpWatchers() {
   is_clean_ = true;
 }
 
+void LiteralWatchers::ForwardClausePointers() {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK(is_clean_);
+  for (std::vector<Watcher>& watchers : watchers_on_false_) {
+    for (Watcher& watcher : watchers) {
+      watcher.clause = ClauseArena::Forward(watcher.clause);
+    }
+  }
+}
+
 void LiteralWatchers::UpdateStatistics(const SatClause& clause, bool added) {
   SCOPED_TIME_STAT(&stats_);
   for (const Literal literal : clause) {
@@ -519,22 +544,287 @@ void BinaryImplicationGraph::RemoveFixedVariables(
   }
 }
 
+bool BinaryImplicationGraph::DetectEquivalences(
+    const Trail& trail, ITIVector<LiteralIndex, LiteralIndex>* representative) {
+  SCOPED_TIME_STAT(&stats_);
+  const LiteralIndex size(implications_.size());
+  representative->resize(size.value());
+  for (LiteralIndex i(0); i < size; ++i) (*representative)[i] = i;
+
+  // Iterative version of the Tarjan strongly connected components algorithm.
+  // dfs_index[l] is the order in which l was first visited (or -1), and
+  // low_link[l] the smallest dfs_index of a literal on the component stack
+  // reachable from l. The dfs stack contains the visited literals with the
+  // position of the next implication to explore.
+  const int kNotVisited = -1;
+  std::vector<int> dfs_index(size.value(), kNotVisited);
+  std::vector<int> low_link(size.value(), 0);
+  std::vector<bool> on_stack(size.value(), false);
+  std::vector<LiteralIndex> component_stack;
+  std::vector<std::pair<LiteralIndex, int>> dfs;
+  int num_visited = 0;
+  for (LiteralIndex root(0); root < size; ++root) {
+    if (dfs_index[root.value()] != kNotVisited ||
+        trail.Assignment().IsVariableAssigned(Literal(root).Variable())) {
+      continue;
+    }
+    dfs_index[root.value()] = low_link[root.value()] = num_visited++;
+    component_stack.push_back(root);
+    on_stack[root.value()] = true;
+    dfs.push_back(std::make_pair(root, 0));
+    while (!dfs.empty()) {
+      const LiteralIndex node = dfs.back().first;
+      const std::vector<Literal>& implied = implications_[node];
+      if (dfs.back().second < implied.size()) {
+        const int child = implied[dfs.back().second++].Index().value();
+        if (dfs_index[child] == kNotVisited) {
+          dfs_index[child] = low_link[child] = num_visited++;
+          component_stack.push_back(LiteralIndex(child));
+          on_stack[child] = true;
+          dfs.push_back(std::make_pair(LiteralIndex(child), 0));
+        } else if (on_stack[child]) {
+          low_link[node.value()] =
+              std::min(low_link[node.value()], dfs_index[child]);
+        }
+        continue;
+      }
+      dfs.pop_back();
+      if (!dfs.empty()) {
+        const int parent = dfs.back().first.value();
+        low_link[parent] = std::min(low_link[parent], low_link[node.value()]);
+      }
+      if (low_link[node.value()] != dfs_index[node.value()]) continue;
+
+      // node is the root of a component, which is at the top of the stack.
+      int start = component_stack.size() - 1;
+      while (component_stack[start] != node) --start;
+      LiteralIndex smallest = node;
+      for (int i = start; i < component_stack.size(); ++i) {
+        smallest = std::min(smallest, component_stack[i]);
+      }
+      for (int i = start; i < component_stack.size(); ++i) {
+        on_stack[component_stack[i].value()] = false;
+        (*representative)[component_stack[i]] = smallest;
+      }
+      component_stack.resize(start);
+    }
+  }
+
+  // Because the graph between the negated literals is the reverse graph, the
+  // component of not(l) contains the negation of the component of l. The two
+  // components are the same iff a literal is equivalent to its negation.
+  bool has_equivalences = false;
+  for (LiteralIndex i(0); i < size; ++i) {
+    const LiteralIndex rep = (*representative)[i];
+    if (rep == (*representative)[Literal(i).NegatedIndex()]) return false;
+    DCHECK_EQ((*representative)[Literal(i).NegatedIndex()],
+              Literal(rep).NegatedIndex());
+    if (rep != i) has_equivalences = true;
+  }
+  if (!has_equivalences) return true;
+
+  // Moves the implications of each literal to its representative, and only
+  // keeps the literal => representative implication.
+  for (LiteralIndex i(0); i < size; ++i) {
+    const LiteralIndex rep = (*representative)[i];
+    if (rep == i) continue;
+    std::vector<Literal>& rep_implications = implications_[rep];
+    rep_implications.insert(rep_implications.end(), implications_[i].begin(),
+                            implications_[i].end());
+    implications_[i].assign(1, Literal(rep));
+  }
+
+  // Rewrites the implications of the representatives, removing the
+  // duplicates and the implications inside a component.
+  for (LiteralIndex i(0); i < size; ++i) {
+    if ((*representative)[i] != i) continue;
+    std::vector<Literal>& implied = implications_[i];
+    int new_size = 0;
+    for (const Literal literal : implied) {
+      const Literal rep((*representative)[literal.Index()]);
+      if (rep.Index() != i) implied[new_size++] = rep;
+    }
+    implied.resize(new_size);
+    std::sort(implied.begin(), implied.end());
+    implied.erase(std::unique(implied.begin(), implied.end()), implied.end());
+  }
+
+  // Adds back the representative => literal implications.
+  int64 num_arcs = 0;
+  for (LiteralIndex i(0); i < size; ++i) {
+    const LiteralIndex rep = (*representative)[i];
+    if (rep != i) implications_[rep].push_back(Literal(i));
+  }
+  for (LiteralIndex i(0); i < size; ++i) num_arcs += implications_[i].size();
+  DCHECK_EQ(num_arcs % 2, 0);
+  num_implications_ = num_arcs / 2;
+  return true;
+}
+
+void BinaryImplicationGraph::RemoveTransitiveImplications(
+    const ITIVector<LiteralIndex, LiteralIndex>& representative,
+    int64 work_limit) {
+  SCOPED_TIME_STAT(&stats_);
+  const LiteralIndex size(implications_.size());
+  CHECK_EQ(representative.size(), size.value());
+
+  // For each representative a, we mark all the literals reachable from the
+  // literals directly implied by a. Any direct implication of a that is marked
+  // is implied by another one and can be removed. Note that the DFS does not
+  // go through the literals that are not representatives: their only
+  // implication is their representative, which is also the literal that
+  // implies them. Stopping the DFS early is fine since the marked literals are
+  // still implied by a path of length at least two.
+  int64 work = 0;
+  std::vector<std::pair<LiteralIndex, Literal>> removed;
+  for (LiteralIndex a(0); a < size && work < work_limit; ++a) {
+    if (representative[a] != a) continue;
+    std::vector<Literal>& direct_implications = implications_[a];
+    if (direct_implications.size() < 2) continue;
+    is_marked_.ClearAndResize(size);
+    dfs_stack_.clear();
+    for (const Literal b : direct_implications) {
+      for (const Literal c : implications_[b.Index()]) dfs_stack_.push_back(c);
+    }
+    while (!dfs_stack_.empty() && work < work_limit) {
+      const LiteralIndex index = dfs_stack_.back().Index();
+      dfs_stack_.pop_back();
+      if (is_marked_[index] || representative[index] != index) continue;
+      is_marked_.Set(index);
+      work += implications_[index].size();
+      for (const Literal implied : implications_[index]) {
+        if (!is_marked_[implied.Index()]) dfs_stack_.push_back(implied);
+      }
+    }
+    int new_size = 0;
+    for (const Literal b : direct_implications) {
+      if (is_marked_[b.Index()]) {
+        removed.push_back(
+            std::make_pair(b.NegatedIndex(), Literal(a).Negated()));
+      } else {
+        direct_implications[new_size++] = b;
+      }
+    }
+    direct_implications.resize(new_size);
+  }
+
+  // Removes the other implication of each removed binary clause. Note that
+  // it may have been removed already.
+  std::sort(removed.begin(), removed.end());
+  for (int i = 0; i < removed.size();) {
+    const LiteralIndex source = removed[i].first;
+    is_marked_.ClearAndResize(size);
+    for (; i < removed.size() && removed[i].first == source; ++i) {
+      is_marked_.Set(removed[i].second.Index());
+    }
+    std::vector<Literal>& implied = implications_[source];
+    int new_size = 0;
+    for (const Literal literal : implied) {
+      if (!is_marked_[literal.Index()]) implied[new_size++] = literal;
+    }
+    implied.resize(new_size);
+  }
+
+  int64 num_arcs = 0;
+  for (LiteralIndex i(0); i < size; ++i) num_arcs += implications_[i].size();
+  DCHECK_EQ(num_arcs % 2, 0);
+  num_redundant_implications_ += num_implications_ - num_arcs / 2;
+  num_implications_ = num_arcs / 2;
+}
+
+// ----- ClauseArena -----
+
+namespace {
+
+// All the clauses are aligned on 8 bytes because of the activity_ field.
+int AlignedNumBytes(int num_bytes) { return (num_bytes + 7) & ~7; }
+
+}  // namespace
+
+ClauseArena::ClauseArena()
+    : current_(nullptr),
+      current_end_(nullptr),
+      num_reserved_bytes_(0),
+      num_allocated_bytes_(0),
+      num_freed_bytes_(0) {}
+
+ClauseArena::~ClauseArena() {
+  ReleaseOldBlocks();
+  for (char* block : blocks_) delete[] block;
+}
+
+void ClauseArena::NewBlock(int num_bytes) {
+  const int block_size = num_bytes > kBlockSize ? num_bytes : kBlockSize;
+  current_ = new char[block_size];
+  current_end_ = current_ + block_size;
+  blocks_.push_back(current_);
+  num_reserved_bytes_ += block_size;
+}
+
+void* ClauseArena::Allocate(int num_bytes) {
+  num_bytes = AlignedNumBytes(num_bytes);
+  if (current_end_ - current_ < num_bytes) NewBlock(num_bytes);
+  void* result = current_;
+  current_ += num_bytes;
+  num_allocated_bytes_ += num_bytes;
+  return result;
+}
+
+void ClauseArena::Free(SatClause* clause) {
+  // Note that the size of a clause may have decreased since its creation (see
+  // RemoveFixedLiteralsAndTestIfTrue()), so this slightly under-estimates the
+  // wasted memory.
+  num_freed_bytes_ += AlignedNumBytes(SatClause::NumBytes(clause->Size()));
+}
+
+bool ClauseArena::ShouldCompact() const {
+  return num_reserved_bytes_ > kBlockSize &&
+         num_freed_bytes_ > num_allocated_bytes_ / 2;
+}
+
+void ClauseArena::Compact(std::vector<SatClause*>* clauses) {
+  DCHECK(old_blocks_.empty());
+  old_blocks_.swap(blocks_);
+  current_ = nullptr;
+  current_end_ = nullptr;
+  num_reserved_bytes_ = 0;
+  num_allocated_bytes_ = 0;
+  num_freed_bytes_ = 0;
+  for (SatClause*& clause : *clauses) {
+    const int num_bytes = SatClause::NumBytes(clause->Size());
+    SatClause* new_clause = reinterpret_cast<SatClause*>(Allocate(num_bytes));
+    memcpy(new_clause, clause, num_bytes);
+
+    // Leave a forwarding pointer at the old address, see Forward().
+    *reinterpret_cast<SatClause**>(clause) = new_clause;
+    clause = new_clause;
+  }
+}
+
+void ClauseArena::ReleaseOldBlocks() {
+  for (char* block : old_blocks_) delete[] block;
+  old_blocks_.clear();
+}
+
 // ----- SatClause -----
 
 // static
 SatClause* SatClause::Create(const std::vector<Literal>& literals, bool is_redundant,
-                             ResolutionNode* node) {
+                             ResolutionNode* node, ClauseArena* arena) {
   CHECK_GE(literals.size(), 2);
   SatClause* clause = reinterpret_cast<SatClause*>(
-      ::operator new(sizeof(SatClause) + literals.size() * sizeof(Literal)));
+      arena->Allocate(NumBytes(literals.size())));
   clause->size_ = literals.size();
   for (int i = 0; i < literals.size(); ++i) {
     clause->literals_[i] = literals[i];
   }
   clause->is_redundant_ = is_redundant;
   clause->is_attached_ = false;
+  clause->is_vivified_ = false;
+  clause->is_subsumption_checked_ = false;
   clause->activity_ = 0.0;
   clause->lbd_ = 0;
+  clause->usage_ = 0;
 #ifdef SAT_ENABLE_RESOLUTION
   clause->resolution_node_ = node;
 #endif  // SAT_ENABLE_RESOLUTION
@@ -552,10 +842,15 @@ bool SatClause::RemoveFixedLiteralsAndTestIfTrue(
     DCHECK(IsSatisfied(assignment));
     return true;
   }
+
+  // We test if the clause is true first so that we never modify the literals
+  // of a clause that is about to be deleted (it may be written to a proof).
+  for (int i = 2; i < size_; ++i) {
+    if (assignment.IsLiteralTrue(literals_[i])) return true;
+  }
   int j = 2;
   for (int i = 2; i < size_; ++i) {
     if (assignment.IsVariableAssigned(literals_[i].Variable())) {
-      if (assignment.IsLiteralTrue(literals_[i])) return true;
       removed_literals->push_back(literals_[i]);
     } else {
       literals_[j] = literals_[i];
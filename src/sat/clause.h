@@ -17,6 +17,7 @@
 #ifndef OR_TOOLS_SAT_CLAUSE_H_
 #define OR_TOOLS_SAT_CLAUSE_H_
 
+#include <algorithm>
 #include "base/hash.h"
 #include "base/unique_ptr.h"
 #include <queue>
@@ -41,6 +42,7 @@ namespace sat {
 
 // Forward declarations.
 // TODO(user): This cyclic dependency can be relatively easily removed.
+class ClauseArena;
 class LiteralWatchers;
 
 // Variable information. This is updated each time we attach/detach a clause.
@@ -64,9 +66,15 @@ class SatClause {
  public:
   // Creates a sat clause. There must be at least 2 literals. Smaller clause are
   // treated separatly and never constructed. A redundant clause can be removed
-  // without changing the problem.
+  // without changing the problem. The memory is owned by the given arena, and
+  // the clause must be deleted with ClauseArena::Free().
   static SatClause* Create(const std::vector<Literal>& literals, bool is_redundant,
-                           ResolutionNode* node);
+                           ResolutionNode* node, ClauseArena* arena);
+
+  // Returns the number of bytes used by a clause with the given size.
+  static int NumBytes(int size) {
+    return sizeof(SatClause) + size * sizeof(Literal);
+  }
 
   // Number of literals in the clause.
   int Size() const { return size_; }
@@ -104,6 +112,10 @@ class SatClause {
   // the original clauses are enough to define the problem.
   bool IsRedundant() const { return is_redundant_; }
 
+  // A redundant clause that subsumes a problem clause must become a problem
+  // clause when the later is deleted.
+  void MarkAsNotRedundant() { is_redundant_ = false; }
+
   // Returns true if the clause is satisfied for the given assignment. Note that
   // the assignment may be partial, so false does not mean that the clause can't
   // be satisfied by completing the assignment.
@@ -128,13 +140,30 @@ class SatClause {
   double Activity() const { return activity_; }
 
   // Set and get the clause LBD (Literal Blocks Distance). The LBD is not
-  // computed here. See ComputeClauseLbd() in SatSolver.
-  void SetLbd(int value) { lbd_ = value; }
+  // computed here. See ComputeClauseLbd() in SatSolver. Values larger than
+  // kMaxLbd are stored as kMaxLbd.
+  void SetLbd(int value) { lbd_ = std::min(value, kMaxLbd); }
   int Lbd() const { return lbd_; }
 
+  // Usage counter of a learned clause: it is set to kMaxUsage when the clause
+  // is involved in a conflict analysis, and decreased by each clause database
+  // cleanup. See SatParameters::clause_cleanup_tier2_lbd_bound.
+  void MarkAsUsed() { usage_ = kMaxUsage; }
+  void DecreaseUsage() {
+    if (usage_ > 0) --usage_;
+  }
+  bool IsUsed() const { return usage_ > 0; }
+
   // Returns true if the clause is attached to a LiteralWatchers.
   bool IsAttached() const { return is_attached_; }
 
+  // Flags used by the inprocessing of the SatSolver so that a clause is only
+  // vivified once, and only used once to look for the clauses it subsumes.
+  bool IsVivified() const { return is_vivified_; }
+  void MarkAsVivified() { is_vivified_ = true; }
+  bool IsSubsumptionChecked() const { return is_subsumption_checked_; }
+  void MarkAsSubsumptionChecked() { is_subsumption_checked_ = true; }
+
   // Marks the clause so that the next call to CleanUpWatchers() can identify it
   // and actually detach it.
   void LazyDetach() { is_attached_ = false; }
@@ -152,13 +181,19 @@ class SatClause {
   std::string DebugString() const;
 
  private:
+  static const int kMaxLbd = (1 << 24) - 1;
+  static const int kMaxUsage = 2;
+
   // The data is packed so that only 16 bytes are used for these fields.
   // Note that the max lbd is the maximum depth of the search tree (decision
-  // levels), so it should fit easily in 30 bits. Note that we can also upper
+  // levels), so it should fit easily in 25 bits. Note that we can also upper
   // bound it without hurting too much the clause cleaning heuristic.
   bool is_redundant_ : 1;
   bool is_attached_ : 1;
-  int lbd_ : 30;
+  bool is_vivified_ : 1;
+  bool is_subsumption_checked_ : 1;
+  int lbd_ : 25;
+  int usage_ : 3;
   int size_ : 32;
   double activity_;
 
@@ -178,6 +213,64 @@ class SatClause {
   DISALLOW_COPY_AND_ASSIGN(SatClause);
 };
 
+// Stores the SatClause contiguously in big blocks of memory instead of
+// allocating each of them separately on the heap. This improves the memory
+// locality of the propagation, reduces the memory overhead per clause and
+// avoids fragmenting the heap when learned clauses are deleted.
+//
+// The memory of a freed clause is only reclaimed by Compact() which moves all
+// the live clauses into new blocks. Since clauses are referenced by pointer in
+// many places (watchers, reasons on the trail), the client must then update
+// all these pointers using Forward() before calling ReleaseOldBlocks().
+class ClauseArena {
+ public:
+  ClauseArena();
+  ~ClauseArena();
+
+  // Returns uninitialized memory for a clause of the given number of bytes.
+  void* Allocate(int num_bytes);
+
+  // Indicates that the memory of the given clause is not used anymore.
+  void Free(SatClause* clause);
+
+  // Returns true if enough memory is wasted by the freed clauses to make a call
+  // to Compact() worthwhile.
+  bool ShouldCompact() const;
+
+  // Moves the given clauses, which must be all the live clauses of this arena,
+  // into new contiguous blocks (in the given order) and updates the pointers in
+  // the vector. The old blocks are kept until ReleaseOldBlocks() so that
+  // Forward() can be used to update the other references to the clauses.
+  void Compact(std::vector<SatClause*>* clauses);
+  static SatClause* Forward(SatClause* old_clause) {
+    return *reinterpret_cast<SatClause**>(old_clause);
+  }
+  void ReleaseOldBlocks();
+
+  // Number of bytes allocated from the system by this arena.
+  int64 MemoryUsage() const { return num_reserved_bytes_; }
+
+ private:
+  // Size of the blocks used for the clauses allocation. A larger clause gets
+  // a block of its own.
+  static const int kBlockSize = 1 << 20;
+
+  // Allocates a new block of at least num_bytes bytes and makes it current.
+  void NewBlock(int num_bytes);
+
+  std::vector<char*> blocks_;
+  std::vector<char*> old_blocks_;
+  char* current_;
+  char* current_end_;
+
+  // Statistics used by ShouldCompact(). They are reset by Compact().
+  int64 num_reserved_bytes_;
+  int64 num_allocated_bytes_;
+  int64 num_freed_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClauseArena);
+};
+
 // Stores the 2-watched literals data structure.  See
 // http://www.cs.berkeley.edu/~necula/autded/lecture24-sat.pdf for
 // detail.
@@ -205,6 +298,10 @@ class LiteralWatchers {
   void LazyDetach(SatClause* clause);
   void CleanUpWatchers();
 
+  // Updates all the watchers after a ClauseArena::Compact(). The watchers must
+  // be clean, i.e. they must only reference live clauses.
+  void ForwardClausePointers();
+
   // Launches all propagation when the given literal becomes false.
   // Returns false if a contradiction was encountered.
   bool PropagateOnFalse(Literal false_literal, Trail* trail);
@@ -236,11 +333,20 @@ class LiteralWatchers {
 
   // Contains, for each literal, the list of clauses that need to be inspected
   // when the corresponding literal becomes false.
+  //
+  // For a ternary clause, ternary_literal is the literal of the clause that is
+  // neither the watched one nor the blocking one. Otherwise, it is just a copy
+  // of the blocking literal. Note that this uses the padding of the struct so
+  // it doesn't increase the memory usage on 64 bits architectures.
   struct Watcher {
     Watcher() {}
-    Watcher(SatClause* c, Literal b) : clause(c), blocking_literal(b) {}
+    Watcher(SatClause* c, Literal b)
+        : clause(c), blocking_literal(b), ternary_literal(b) {}
+    Watcher(SatClause* c, Literal b, Literal t)
+        : clause(c), blocking_literal(b), ternary_literal(t) {}
     SatClause* clause;
     Literal blocking_literal;
+    Literal ternary_literal;
   };
   ITIVector<LiteralIndex, std::vector<Watcher> > watchers_on_false_;
 
@@ -389,6 +495,33 @@ class BinaryImplicationGraph {
   void RemoveFixedVariables(int first_unprocessed_trail_index,
                             const Trail& trail);
 
+  // Finds the equivalent literals by computing the strongly connected
+  // components of the implication graph. Returns false if a literal is
+  // equivalent to its negation, that is if the problem is UNSAT. Otherwise,
+  // (*representative)[l] is the literal of the component of l with the smallest
+  // index (possibly l itself), and we always have representative[not(l)] =
+  // not(representative[l]).
+  //
+  // The implications are then rewritten so that they only involve the
+  // representatives, except for the implications l => r and r => l between a
+  // literal l and its representative r, which are kept so that l and r are
+  // always assigned the same value. The clauses containing l can thus be
+  // rewritten with r instead.
+  //
+  // This must only be called at decision level 0 after RemoveFixedVariables().
+  bool DetectEquivalences(
+      const Trail& trail, ITIVector<LiteralIndex, LiteralIndex>* representative);
+
+  // Removes the implications a => b between two representatives such that b is
+  // also implied by another direct implication of a. The implication
+  // not(b) => not(a) of the same binary clause is removed too. This must be
+  // called just after DetectEquivalences() so that the implication graph
+  // between the representatives is acyclic. Stops after inspecting about
+  // work_limit implications.
+  void RemoveTransitiveImplications(
+      const ITIVector<LiteralIndex, LiteralIndex>& representative,
+      int64 work_limit);
+
   // Number of literal propagated by this class (including conflicts).
   int64 num_propagations() const { return num_propagations_; }
 
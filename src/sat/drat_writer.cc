@@ -0,0 +1,96 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sat/drat_writer.h"
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+
+namespace operations_research {
+namespace sat {
+
+namespace {
+
+// The buffer is written to the output once it grows past this size.
+const int kMaxBufferedBytes = 1 << 16;
+
+// Appends the decimal representation of value to output. This is a lot faster
+// than going through StringAppendF() and matters for large proofs.
+void AppendSignedInteger(int value, std::string* output) {
+  char digits[16];
+  int num_digits = 0;
+  uint32 magnitude = value < 0 ? -static_cast<int64>(value) : value;
+  do {
+    digits[num_digits++] = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0) output->push_back('-');
+  while (num_digits > 0) output->push_back(digits[--num_digits]);
+}
+
+}  // namespace
+
+DratWriter::DratWriter(bool in_binary_format, File* output)
+    : in_binary_format_(in_binary_format), output_(output) {
+  CHECK(output != nullptr);
+  buffer_.reserve(kMaxBufferedBytes + 1024);
+}
+
+DratWriter::~DratWriter() { Flush(); }
+
+void DratWriter::AddClause(ClauseRef clause) {
+  if (in_binary_format_) buffer_.push_back('a');
+  WriteClause(clause);
+}
+
+void DratWriter::DeleteClause(ClauseRef clause) {
+  buffer_.append(in_binary_format_ ? "d" : "d ");
+  WriteClause(clause);
+}
+
+void DratWriter::WriteClause(ClauseRef clause) {
+  for (const Literal literal : clause) {
+    if (in_binary_format_) {
+      uint32 value = 2 * (literal.Variable().value() + 1) +
+                     (literal.IsPositive() ? 0 : 1);
+      while (value > 127) {
+        buffer_.push_back(static_cast<char>((value & 127) | 128));
+        value >>= 7;
+      }
+      buffer_.push_back(static_cast<char>(value));
+    } else {
+      AppendSignedInteger(literal.SignedValue(), &buffer_);
+      buffer_.push_back(' ');
+    }
+  }
+  if (in_binary_format_) {
+    buffer_.push_back(0);
+  } else {
+    buffer_.append("0\n");
+  }
+  if (buffer_.size() > kMaxBufferedBytes) {
+    output_->WriteOrDie(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+}
+
+void DratWriter::Flush() {
+  if (!buffer_.empty()) {
+    output_->WriteOrDie(buffer_.data(), buffer_.size());
+    buffer_.clear();
+  }
+  output_->Flush();
+}
+
+}  // namespace sat
+}  // namespace operations_research
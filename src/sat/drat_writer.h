@@ -0,0 +1,67 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Streaming writer of DRAT unsatisfiability proofs. Contrary to the in-memory
+// resolution graph of unsat_proof.h, the added and deleted clauses are written
+// as they are generated, so the memory overhead is just a small buffer. The
+// resulting file can be checked with the standard DRAT checkers, for instance
+// drat-trim: https://www.cs.utexas.edu/~marijn/drat-trim/
+//
+// Both the textual format and the more compact binary format are supported:
+// - Textual: "1 -2 3 0\n" adds a clause, "d 1 -2 3 0\n" deletes it.
+// - Binary: 'a' or 'd' followed by each literal l encoded as the unsigned
+//   integer 2 * (|l| + 1) + (l < 0) in a little-endian base 128 varint, and a
+//   terminating zero byte.
+
+#ifndef OR_TOOLS_SAT_DRAT_WRITER_H_
+#define OR_TOOLS_SAT_DRAT_WRITER_H_
+
+#include <string>
+
+#include "base/file.h"
+#include "base/macros.h"
+#include "sat/sat_base.h"
+
+namespace operations_research {
+namespace sat {
+
+class DratWriter {
+ public:
+  // The output is not owned and must outlive this class. It is not closed by
+  // the destructor, but all the buffered data is flushed to it.
+  DratWriter(bool in_binary_format, File* output);
+  ~DratWriter();
+
+  // Writes the addition (resp. deletion) of the given clause to the proof. An
+  // added clause must be a RUP (or RAT) consequence of the clauses currently in
+  // the proof. The empty clause ends a proof of unsatisfiability.
+  void AddClause(ClauseRef clause);
+  void DeleteClause(ClauseRef clause);
+
+  // Writes the buffered data to the output and flushes it.
+  void Flush();
+
+ private:
+  void WriteClause(ClauseRef clause);
+
+  const bool in_binary_format_;
+  File* output_;
+  std::string buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(DratWriter);
+};
+
+}  // namespace sat
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_SAT_DRAT_WRITER_H_
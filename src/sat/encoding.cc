@@ -293,6 +293,74 @@ EncodingNode* LazyMergeAllNodeWithPQ(const std::vector<EncodingNode*>& nodes,
   return pq.top();
 }
 
+void EncodingNodeMerges::Add(EncodingNode* node) {
+  CHECK(node->child_a() != nullptr);
+  CHECK(node->child_b() != nullptr);
+  parents_[node->child_a()].push_back(node);
+  if (node->child_b() != node->child_a()) {
+    parents_[node->child_b()].push_back(node);
+  }
+}
+
+const std::vector<EncodingNode*>& EncodingNodeMerges::Parents(
+    EncodingNode* node) const {
+  const auto it = parents_.find(node);
+  return it == parents_.end() ? no_parents_ : it->second;
+}
+
+EncodingNode* LazyMergeAllNodesWithSharing(
+    const std::vector<EncodingNode*>& nodes, SatSolver* solver,
+    std::deque<EncodingNode>* repository, EncodingNodeMerges* merges) {
+  // Replaces two nodes by their recorded sum as long as possible, but keeps at
+  // least two nodes: the returned node gets a weight of its own, so it must
+  // not be an existing node.
+  hash_set<EncodingNode*> present(nodes.begin(), nodes.end());
+  CHECK_EQ(present.size(), nodes.size());
+  std::vector<EncodingNode*> reused;
+  std::vector<EncodingNode*> to_process(nodes.rbegin(), nodes.rend());
+  while (!to_process.empty() && present.size() > 2) {
+    EncodingNode* const node = to_process.back();
+    to_process.pop_back();
+    if (present.count(node) == 0) continue;
+    for (EncodingNode* const parent : merges->Parents(node)) {
+      EncodingNode* const other = parent->child_a() == node
+                                      ? parent->child_b()
+                                      : parent->child_a();
+      if (other == node || parent->size() == 0) continue;
+      if (present.count(other) == 0 || present.count(parent) > 0) continue;
+      present.erase(node);
+      present.erase(other);
+      present.insert(parent);
+      reused.push_back(parent);
+      to_process.push_back(parent);
+      break;
+    }
+  }
+
+  // Keeps the order of the given nodes, for determinism.
+  std::vector<EncodingNode*> to_merge;
+  for (EncodingNode* const node : nodes) {
+    if (present.count(node) > 0) to_merge.push_back(node);
+  }
+  for (EncodingNode* const node : reused) {
+    if (present.count(node) > 0) to_merge.push_back(node);
+  }
+
+  std::priority_queue<EncodingNode*, std::vector<EncodingNode*>,
+                      SortEncodingNodePointers>
+      pq(to_merge.begin(), to_merge.end());
+  while (pq.size() > 1) {
+    EncodingNode* a = pq.top();
+    pq.pop();
+    EncodingNode* b = pq.top();
+    pq.pop();
+    repository->push_back(LazyMerge(a, b, solver));
+    merges->Add(&repository->back());
+    pq.push(&repository->back());
+  }
+  return pq.top();
+}
+
 std::vector<EncodingNode*> CreateInitialEncodingNodes(
     const LinearObjective& objective_proto, Coefficient* offset,
     std::deque<EncodingNode>* repository) {
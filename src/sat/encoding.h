@@ -18,6 +18,10 @@
 #ifndef OR_TOOLS_SAT_ENCODING_H_
 #define OR_TOOLS_SAT_ENCODING_H_
 
+#include <deque>
+#include <vector>
+
+#include "base/hash.h"
 #include "sat/boolean_problem.pb.h"
 #include "sat/sat_solver.h"
 
@@ -152,6 +156,33 @@ EncodingNode* LazyMergeAllNodeWithPQ(const std::vector<EncodingNode*>& nodes,
                                      SatSolver* solver,
                                      std::deque<EncodingNode>* repository);
 
+// Records the nodes created by lazily merging two nodes, so that the sum of two
+// given nodes can be encoded only once even when they appear together in
+// several cores.
+class EncodingNodeMerges {
+ public:
+  EncodingNodeMerges() {}
+
+  // Records that node is the sum of its two children.
+  void Add(EncodingNode* node);
+
+  // Returns the recorded nodes having the given node as a child.
+  const std::vector<EncodingNode*>& Parents(EncodingNode* node) const;
+
+ private:
+  hash_map<EncodingNode*, std::vector<EncodingNode*> > parents_;
+  const std::vector<EncodingNode*> no_parents_;
+
+  DISALLOW_COPY_AND_ASSIGN(EncodingNodeMerges);
+};
+
+// Same as LazyMergeAllNodeWithPQ(), but reuses the nodes recorded in merges
+// which sum two of the nodes to merge (and so on recursively), and records the
+// new nodes in merges. The returned node is always a new node.
+EncodingNode* LazyMergeAllNodesWithSharing(
+    const std::vector<EncodingNode*>& nodes, SatSolver* solver,
+    std::deque<EncodingNode>* repository, EncodingNodeMerges* merges);
+
 // Returns a vector with one new EncodingNode by variable in the given
 // objective.
 // All the variables must have the same cost (modulo the sign), this is CHECHed.
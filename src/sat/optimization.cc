@@ -932,6 +932,90 @@ bool EncodingNodeByDepth(const EncodingNode* a, const EncodingNode* b) {
 
 bool EmptyEncodingNode(const EncodingNode* a) { return a->size() == 0; }
 
+// Updates the nodes given a core of their assumptions, which must appear in
+// the same order as the nodes. If the core has a single literal, its node just
+// gets larger. Otherwise, the core nodes are merged in a new node appended at
+// the back of nodes, with a weight equal to the minimum weight of the core
+// which is returned. The sums of two nodes already encoded for a previous core
+// are reused (see LazyMergeAllNodesWithSharing()). Note that this backtracks
+// the solver to level zero.
+Coefficient ProcessCore(const std::vector<Literal>& core, SatSolver* solver,
+                        std::deque<EncodingNode>* repository,
+                        EncodingNodeMerges* merges,
+                        std::vector<EncodingNode*>* nodes, int* max_depth) {
+  // Compute the min weight of all the nodes in the core.
+  // The lower bound will be increased by that much.
+  Coefficient min_weight = kCoefficientMax;
+  {
+    int index = 0;
+    for (int i = 0; i < core.size(); ++i) {
+      for (; index < nodes->size() &&
+                 (*nodes)[index]->literal(0).Negated() != core[i];
+           ++index) {
+      }
+      CHECK_LT(index, nodes->size());
+      min_weight = std::min(min_weight, (*nodes)[index]->weight());
+    }
+  }
+
+  // Backtrack to be able to add new constraints.
+  solver->Backtrack(0);
+
+  int new_node_index = 0;
+  if (core.size() == 1) {
+    // The core will be reduced at the beginning of the next loop.
+    // Find the associated node, and call IncreaseNodeSize() on it.
+    CHECK(solver->Assignment().IsLiteralFalse(core[0]));
+    for (EncodingNode* n : *nodes) {
+      if (n->literal(0).Negated() == core[0]) {
+        IncreaseNodeSize(n, solver);
+        break;
+      }
+    }
+  } else {
+    // Remove from nodes the EncodingNode in the core, merge them, and add the
+    // resulting EncodingNode at the back.
+    int index = 0;
+    std::vector<EncodingNode*> to_merge;
+    for (int i = 0; i < core.size(); ++i) {
+      // Since the nodes appear in order in the core, we can find the
+      // relevant "objective" variable efficiently with a simple linear scan
+      // in the nodes vector (done with index).
+      for (; (*nodes)[index]->literal(0).Negated() != core[i]; ++index) {
+        CHECK_LT(index, nodes->size());
+        (*nodes)[new_node_index] = (*nodes)[index];
+        ++new_node_index;
+      }
+      CHECK_LT(index, nodes->size());
+      to_merge.push_back((*nodes)[index]);
+
+      // Special case if the weight > min_weight. we keep it, but reduce its
+      // cost. This is the same "trick" as in WPM1 used to deal with weight.
+      // We basically split a clause with a larger weight in two identical
+      // clauses, one with weight min_weight that will be merged and one with
+      // the remaining weight.
+      if ((*nodes)[index]->weight() > min_weight) {
+        (*nodes)[index]->set_weight((*nodes)[index]->weight() - min_weight);
+        (*nodes)[new_node_index] = (*nodes)[index];
+        ++new_node_index;
+      }
+      ++index;
+    }
+    for (; index < nodes->size(); ++index) {
+      (*nodes)[new_node_index] = (*nodes)[index];
+      ++new_node_index;
+    }
+    nodes->resize(new_node_index);
+    nodes->push_back(
+        LazyMergeAllNodesWithSharing(to_merge, solver, repository, merges));
+    IncreaseNodeSize(nodes->back(), solver);
+    *max_depth = std::max(*max_depth, nodes->back()->depth());
+    nodes->back()->set_weight(min_weight);
+    CHECK(solver->AddUnitClause(nodes->back()->literal(0)));
+  }
+  return min_weight;
+}
+
 }  // namespace
 
 SatSolver::Status SolveWithCardinalityEncodingAndCore(
@@ -940,6 +1024,7 @@ SatSolver::Status SolveWithCardinalityEncodingAndCore(
   Logger logger(log);
   SatParameters parameters = solver->parameters();
   std::deque<EncodingNode> repository;
+  EncodingNodeMerges merges;
 
   // Create one initial nodes per variables with cost.
   Coefficient offset(0);
@@ -1064,86 +1149,62 @@ SatSolver::Status SolveWithCardinalityEncodingAndCore(
     if (result != SatSolver::ASSUMPTIONS_UNSAT) return result;
 
     // We have a new core.
-    std::vector<Literal> core = solver->GetLastIncompatibleDecisions();
-    if (parameters.minimize_core()) MinimizeCore(solver, &core);
-
-    // Compute the min weight of all the nodes in the core.
-    // The lower bound will be increased by that much.
-    Coefficient min_weight = kCoefficientMax;
-    {
-      int index = 0;
-      for (int i = 0; i < core.size(); ++i) {
-        for (; index < nodes.size() &&
-                   nodes[index]->literal(0).Negated() != core[i];
-             ++index) {
-        }
-        CHECK_LT(index, nodes.size());
-        min_weight = std::min(min_weight, nodes[index]->weight());
-      }
-    }
-    previous_core_info =
-        StringPrintf("core:%zu mw:%lld", core.size(), min_weight.value());
-
-    // Increase stratified_lower_bound according to the parameters.
-    if (stratified_lower_bound < min_weight &&
-        parameters.max_sat_stratification() ==
-            SatParameters::STRATIFICATION_ASCENT) {
-      stratified_lower_bound = min_weight;
-    }
-
-    // Backtrack to be able to add new constraints.
-    solver->Backtrack(0);
-
-    int new_node_index = 0;
-    if (core.size() == 1) {
-      // The core will be reduced at the beginning of the next loop.
-      // Find the associated node, and call IncreaseNodeSize() on it.
-      CHECK(solver->Assignment().IsLiteralFalse(core[0]));
-      for (EncodingNode* n : nodes) {
-        if (n->literal(0).Negated() == core[0]) {
-          IncreaseNodeSize(n, solver);
-          break;
+    std::vector<std::vector<Literal>> cores;
+    cores.push_back(solver->GetLastIncompatibleDecisions());
+    if (parameters.minimize_core()) MinimizeCore(solver, &cores.back());
+
+    // Look for more cores disjoint from the ones found so far by removing
+    // their literals from the assumptions. Note that this keeps the order of
+    // the assumptions, so each core is still ordered like the nodes.
+    if (parameters.max_sat_find_disjoint_cores()) {
+      std::vector<bool> in_core(2 * solver->NumVariables(), false);
+      std::vector<Literal> remaining_assumptions;
+      while (true) {
+        for (const Literal literal : cores.back()) {
+          in_core[literal.Index().value()] = true;
         }
-      }
-    } else {
-      // Remove from nodes the EncodingNode in the core, merge them, and add the
-      // resulting EncodingNode at the back.
-      int index = 0;
-      std::vector<EncodingNode*> to_merge;
-      for (int i = 0; i < core.size(); ++i) {
-        // Since the nodes appear in order in the core, we can find the
-        // relevant "objective" variable efficiently with a simple linear scan
-        // in the nodes vector (done with index).
-        for (; nodes[index]->literal(0).Negated() != core[i]; ++index) {
-          CHECK_LT(index, nodes.size());
-          nodes[new_node_index] = nodes[index];
-          ++new_node_index;
+        remaining_assumptions.clear();
+        for (const Literal literal : assumptions) {
+          if (!in_core[literal.Index().value()]) {
+            remaining_assumptions.push_back(literal);
+          }
         }
-        CHECK_LT(index, nodes.size());
-        to_merge.push_back(nodes[index]);
-
-        // Special case if the weight > min_weight. we keep it, but reduce its
-        // cost. This is the same "trick" as in WPM1 used to deal with weight.
-        // We basically split a clause with a larger weight in two identical
-        // clauses, one with weight min_weight that will be merged and one with
-        // the remaining weight.
-        if (nodes[index]->weight() > min_weight) {
-          nodes[index]->set_weight(nodes[index]->weight() - min_weight);
-          nodes[new_node_index] = nodes[index];
-          ++new_node_index;
+        if (remaining_assumptions.empty()) break;
+        const SatSolver::Status status =
+            solver->ResetAndSolveWithGivenAssumptions(remaining_assumptions);
+        if (status == SatSolver::MODEL_UNSAT) return status;
+        if (status == SatSolver::MODEL_SAT) {
+          // This may still improve the best known solution.
+          std::vector<bool> temp_solution;
+          ExtractAssignment(problem, *solver, &temp_solution);
+          CHECK(IsAssignmentValid(problem, temp_solution));
+          const Coefficient obj = ComputeObjectiveValue(problem, temp_solution);
+          if (obj + offset < upper_bound) {
+            *solution = temp_solution;
+            logger.Log(CnfObjectiveLine(problem, obj));
+            upper_bound = obj + offset;
+          }
         }
-        ++index;
+        if (status != SatSolver::ASSUMPTIONS_UNSAT) break;
+        cores.push_back(solver->GetLastIncompatibleDecisions());
+        if (parameters.minimize_core()) MinimizeCore(solver, &cores.back());
       }
-      for (; index < nodes.size(); ++index) {
-        nodes[new_node_index] = nodes[index];
-        ++new_node_index;
+    }
+
+    previous_core_info = "";
+    for (const std::vector<Literal>& core : cores) {
+      const Coefficient min_weight =
+          ProcessCore(core, solver, &repository, &merges, &nodes, &max_depth);
+      if (!previous_core_info.empty()) previous_core_info += " ";
+      previous_core_info +=
+          StringPrintf("core:%zu mw:%lld", core.size(), min_weight.value());
+
+      // Increase stratified_lower_bound according to the parameters.
+      if (stratified_lower_bound < min_weight &&
+          parameters.max_sat_stratification() ==
+              SatParameters::STRATIFICATION_ASCENT) {
+        stratified_lower_bound = min_weight;
       }
-      nodes.resize(new_node_index);
-      nodes.push_back(LazyMergeAllNodeWithPQ(to_merge, solver, &repository));
-      IncreaseNodeSize(nodes.back(), solver);
-      max_depth = std::max(max_depth, nodes.back()->depth());
-      nodes.back()->set_weight(min_weight);
-      CHECK(solver->AddUnitClause(nodes.back()->literal(0)));
     }
   }
 }
@@ -13,6 +13,8 @@
 
 #include "sat/pb_constraint.h"
 
+#include <algorithm>
+
 #include "base/fingerprint2011.h"
 #include "util/saturated_arithmetic.h"
 
@@ -516,13 +518,20 @@ bool UpperBoundedLinearConstraint::Propagate(int trail_index,
   DCHECK_LT(*threshold, 0);
   const Coefficient slack = GetSlackFromThreshold(*threshold);
   DCHECK_GE(slack, 0) << "The constraint is already a conflict!";
-  while (index_ >= 0 && coeffs_[index_] > slack) --index_;
+
+  // Note that the slack can decrease by a lot at once, so we use a binary
+  // search since a constraint can have thousands of distinct coefficients.
+  if (index_ >= 0 && coeffs_[index_] > slack) {
+    index_ = std::upper_bound(coeffs_.begin(), coeffs_.begin() + index_, slack) -
+             coeffs_.begin() - 1;
+  }
 
   // Check propagation.
+  const VariablesAssignment& assignment = trail->Assignment();
   VariableIndex first_propagated_variable(-1);
   for (int i = starts_[index_ + 1]; i < already_propagated_end_; ++i) {
-    if (trail->Assignment().IsLiteralFalse(literals_[i])) continue;
-    if (trail->Assignment().IsLiteralTrue(literals_[i])) {
+    if (assignment.IsLiteralFalse(literals_[i])) continue;
+    if (assignment.IsLiteralTrue(literals_[i])) {
       if (trail->Info(literals_[i].Variable()).trail_index > trail_index) {
         // Conflict.
         FillReason(*trail, trail_index, literals_[i].Variable(), conflict);
@@ -795,7 +804,11 @@ void UpperBoundedLinearConstraint::ResolvePBConflict(
 void UpperBoundedLinearConstraint::Untrail(Coefficient* threshold,
                                            int trail_index) {
   const Coefficient slack = GetSlackFromThreshold(*threshold);
-  while (index_ + 1 < coeffs_.size() && coeffs_[index_ + 1] <= slack) ++index_;
+  if (index_ + 1 < coeffs_.size() && coeffs_[index_ + 1] <= slack) {
+    index_ = std::upper_bound(coeffs_.begin() + index_ + 1, coeffs_.end(),
+                              slack) -
+             coeffs_.begin() - 1;
+  }
   Update(slack, threshold);
   if (first_reason_trail_index_ >= trail_index) {
     first_reason_trail_index_ = -1;
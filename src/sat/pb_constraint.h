@@ -553,9 +553,9 @@ class PbConstraints {
   // Note that this should only be called if the reason type is PB_PROPAGATION.
   void ReasonFor(VariableIndex var, std::vector<Literal>* reason) const {
     SCOPED_TIME_STAT(&stats_);
-    const AssignmentInfo& info = trail_->Info(var);
+    const AssignmentReason& info = trail_->ReasonInfo(var);
     DCHECK_EQ(trail_->InitialAssignmentType(var),
-              AssignmentInfo::PB_PROPAGATION);
+              AssignmentReason::PB_PROPAGATION);
     info.pb_constraint->FillReason(*trail_, info.source_trail_index, var,
                                    reason);
   }
@@ -590,6 +590,15 @@ class PbConstraints {
   }
   int64 num_threshold_updates() const { return num_threshold_updates_; }
 
+  // Estimate of the work done by the propagation of the pseudo-Boolean
+  // constraints in the same unit as SatSolver::deterministic_time(). There is a
+  // factor 2 on the lookups and updates because of the untrail.
+  double deterministic_time() const {
+    return 1e-8 * (20.0 * num_constraint_lookups_ +
+                   2.0 * num_threshold_updates_ +
+                   1.0 * num_inspected_constraint_literals_);
+  }
+
  private:
   // Same function as the clause related one is SatSolver().
   // TODO(user): Remove duplication.
@@ -691,8 +700,10 @@ class VariableWithSameReasonIdentifier {
   // had the same reason, then var is returned.
   VariableIndex FirstVariableWithSameReason(VariableIndex var) {
     if (seen_[var]) return first_variable_[var];
-    if (trail_.Info(var).type != AssignmentInfo::SAME_REASON_AS) return var;
-    const VariableIndex reference_var = trail_.Info(var).reference_var;
+    if (trail_.ReasonInfo(var).type != AssignmentReason::SAME_REASON_AS) {
+      return var;
+    }
+    const VariableIndex reference_var = trail_.ReasonInfo(var).reference_var;
     if (seen_[reference_var]) return first_variable_[reference_var];
     seen_.Set(reference_var);
     first_variable_[reference_var] = var;
@@ -185,16 +185,35 @@ class ResolutionNode;
 class SatClause;
 class UpperBoundedLinearConstraint;
 
-// Information about a variable assignment.
+// Information about a variable assignment that is read very often during
+// conflict analysis (to compute the backtrack level, minimize the learned
+// conflict or compute its LBD). It is stored in its own dense vector, separated
+// from the much less used AssignmentReason below, so that these loops only
+// bring 8 bytes per variable in the cache.
 struct AssignmentInfo {
   AssignmentInfo() {}
 
+  // The decision level at which this assignment was made. This starts at 0 and
+  // increases each time the solver takes a SEARCH_DECISION.
+  int level;
+
+  // The index of this assignment in the trail.
+  int trail_index;
+};
+COMPILE_ASSERT(sizeof(AssignmentInfo) == 8,
+               ERROR_AssignmentInfo_is_not_well_compacted);
+
+// The reason of a variable assignment. This is only needed when the reason
+// clause is actually computed.
+struct AssignmentReason {
+  AssignmentReason() {}
+
   // The type of assignment (this impact the reason for this assignment).
   //
   // Note(user): Another design for lazily evaluating the reason behind an
   // assignement could rely on virtual functions. Each constraint class can
   // subclass an HasReason class and implements a ComputeReason() virtual
-  // function. This AssignmentInfo can then hold a pointer to an HasReason
+  // function. This AssignmentReason can then hold a pointer to an HasReason
   // class. Currently, this is not done this way for efficiency.
   enum Type {
     UNIT_REASON,
@@ -208,17 +227,11 @@ struct AssignmentInfo {
   };
   Type type;
 
-  // The decision level at which this assignment was made. This starts at 0 and
-  // increases each time the solver takes a SEARCH_DECISION.
-  int level;
-
-  // The index of this assignment in the trail.
-  int trail_index;
-
-  // The rest of this struct contains data about this assignment used to compute
-  // the reason clause when it becomes needed. Note that depending on the type,
-  // some fields will not be used and left uninitialized. We use unions to gain
-  // a bit of memory.
+  // The rest of this struct contains the data used to compute the reason clause
+  // when it becomes needed. Note that depending on the type, some fields will
+  // not be used and left uninitialized. We use unions to gain a bit of memory.
+  // The ResolutionNode of an UNIT_REASON is stored apart by the Trail since it
+  // is only needed when computing unsat proofs.
 
 // Visual C++ has a problem with a Literal inside an union.
 #if defined(_MSC_VER)
@@ -232,17 +245,16 @@ struct AssignmentInfo {
 
   union {
     SatClause* sat_clause;
-    ResolutionNode* resolution_node;
     UpperBoundedLinearConstraint* pb_constraint;
     int symmetry_index;
-    };
-    VariableIndex reference_var;
+  };
+  VariableIndex reference_var;
 };
 
 // Note that we use <= because on 32 bits architecture, the size will actually
 // be smaller than 24 bytes.
-COMPILE_ASSERT(sizeof(AssignmentInfo) <= 24,
-               ERROR_AssignmentInfo_is_not_well_compacted);
+COMPILE_ASSERT(sizeof(AssignmentReason) <= 24,
+               ERROR_AssignmentReason_is_not_well_compacted);
 
 // The solver trail stores the assignement made by the solver in order.
 // This class is responsible for maintaining the assignment of each variable
@@ -256,18 +268,22 @@ class Trail {
   void Resize(int num_variables) {
     assignment_.Resize(num_variables);
     info_.resize(num_variables);
+    reasons_.resize(num_variables);
+    if (need_level_zero_) resolution_nodes_.resize(num_variables);
     trail_.resize(num_variables);
   }
 
   // Enqueues the assignment that make the given literal true on the trail. This
   // should only be called on unassigned variable. Extra information about this
   // assignment is controled by the Set*() functions below.
-  void Enqueue(Literal true_literal, AssignmentInfo::Type type) {
+  void Enqueue(Literal true_literal, AssignmentReason::Type type) {
     DCHECK(!assignment_.IsVariableAssigned(true_literal.Variable()));
+    const VariableIndex var = true_literal.Variable();
     trail_[trail_index_] = true_literal;
     current_info_.trail_index = trail_index_;
-    current_info_.type = type;
-    info_[true_literal.Variable()] = current_info_;
+    current_reason_.type = type;
+    info_[var] = current_info_;
+    reasons_[var] = current_reason_;
     assignment_.AssignFromTrueLiteral(true_literal);
     ++num_enqueues_;
     ++trail_index_;
@@ -275,28 +291,32 @@ class Trail {
 
   // Specific Enqueue() version for our different constraint types.
   void EnqueueWithUnitReason(Literal true_literal, ResolutionNode* node) {
-    current_info_.resolution_node = node;
-    Enqueue(true_literal, AssignmentInfo::UNIT_REASON);
+    if (need_level_zero_) {
+      resolution_nodes_[true_literal.Variable()] = node;
+    } else {
+      DCHECK(node == nullptr);
+    }
+    Enqueue(true_literal, AssignmentReason::UNIT_REASON);
   }
   void EnqueueWithBinaryReason(Literal true_literal, Literal reason) {
-    current_info_.literal = reason;
-    Enqueue(true_literal, AssignmentInfo::BINARY_PROPAGATION);
+    current_reason_.literal = reason;
+    Enqueue(true_literal, AssignmentReason::BINARY_PROPAGATION);
   }
   void EnqueueWithSatClauseReason(Literal true_literal, SatClause* clause) {
-    current_info_.sat_clause = clause;
-    Enqueue(true_literal, AssignmentInfo::CLAUSE_PROPAGATION);
+    current_reason_.sat_clause = clause;
+    Enqueue(true_literal, AssignmentReason::CLAUSE_PROPAGATION);
   }
   void EnqueueWithPbReason(Literal true_literal, int source_trail_index,
                            UpperBoundedLinearConstraint* cst) {
-    current_info_.source_trail_index = source_trail_index;
-    current_info_.pb_constraint = cst;
-    Enqueue(true_literal, AssignmentInfo::PB_PROPAGATION);
+    current_reason_.source_trail_index = source_trail_index;
+    current_reason_.pb_constraint = cst;
+    Enqueue(true_literal, AssignmentReason::PB_PROPAGATION);
   }
   void EnqueueWithSymmetricReason(Literal true_literal, int source_trail_index,
                                   int symmetry_index) {
-    current_info_.source_trail_index = source_trail_index;
-    current_info_.symmetry_index = symmetry_index;
-    Enqueue(true_literal, AssignmentInfo::SYMMETRY_PROPAGATION);
+    current_reason_.source_trail_index = source_trail_index;
+    current_reason_.symmetry_index = symmetry_index;
+    Enqueue(true_literal, AssignmentReason::SYMMETRY_PROPAGATION);
   }
 
   // Some constraints propagate a lot of literals at once. In these cases, it is
@@ -304,8 +324,8 @@ class Trail {
   // refering to the reason of the first of them.
   void EnqueueWithSameReasonAs(Literal true_literal,
                                VariableIndex reference_var) {
-    current_info_.reference_var = reference_var;
-    Enqueue(true_literal, AssignmentInfo::SAME_REASON_AS);
+    current_reason_.reference_var = reference_var;
+    Enqueue(true_literal, AssignmentReason::SAME_REASON_AS);
   }
 
   // Changes the type of the variable assignment to CACHED_REASON so that we
@@ -327,23 +347,23 @@ class Trail {
       cached_reasons_.resize(NumVariables());
       old_type_.resize(NumVariables());
     }
-    old_type_[var] = info_[var].type;
-    info_[var].type = AssignmentInfo::CACHED_REASON;
+    old_type_[var] = reasons_[var].type;
+    reasons_[var].type = AssignmentReason::CACHED_REASON;
     return &(cached_reasons_[var]);
   }
 
   // Returns the reason for an assignment whose reason was cached.
   ClauseRef CachedReason(VariableIndex var) const {
-    DCHECK_EQ(info_[var].type, AssignmentInfo::CACHED_REASON);
+    DCHECK_EQ(reasons_[var].type, AssignmentReason::CACHED_REASON);
     return ClauseRef(cached_reasons_[var]);
   }
 
   // Returns the initial type of an assignment. This is basically the type
   // except for an assignment whose reason has now marked as cached where the
   // old type is returned.
-  AssignmentInfo::Type InitialAssignmentType(VariableIndex var) const {
-    const AssignmentInfo::Type type = info_[var].type;
-    return type != AssignmentInfo::CACHED_REASON ? type : old_type_[var];
+  AssignmentReason::Type InitialAssignmentType(VariableIndex var) const {
+    const AssignmentReason::Type type = reasons_[var].type;
+    return type != AssignmentReason::CACHED_REASON ? type : old_type_[var];
   }
 
   // Dequeues the last assigned literal and returns it.
@@ -378,7 +398,10 @@ class Trail {
   // literals is one assigned at level zero. The option is here so every code
   // that needs it can easily access it.
   bool NeedFixedLiteralsInReason() const { return need_level_zero_; }
-  void SetNeedFixedLiteralsInReason(bool value) { need_level_zero_ = value; }
+  void SetNeedFixedLiteralsInReason(bool value) {
+    need_level_zero_ = value;
+    if (value) resolution_nodes_.resize(NumVariables(), nullptr);
+  }
 
   // Getters.
   int NumVariables() const { return trail_.size(); }
@@ -391,12 +414,34 @@ class Trail {
     DCHECK_LT(var, info_.size());
     return info_[var];
   }
+  const AssignmentReason& ReasonInfo(VariableIndex var) const {
+    DCHECK_GE(var, 0);
+    DCHECK_LT(var, reasons_.size());
+    return reasons_[var];
+  }
+
+  // Returns the ResolutionNode of a variable assigned with an UNIT_REASON. This
+  // is only available if NeedFixedLiteralsInReason() is true, which is the case
+  // when computing unsat proofs.
+  ResolutionNode* UnitResolutionNode(VariableIndex var) const {
+    DCHECK(need_level_zero_);
+    DCHECK_EQ(reasons_[var].type, AssignmentReason::UNIT_REASON);
+    return resolution_nodes_[var];
+  }
+
+  // Changes the clause used as a reason for the assignment of the given
+  // variable. This is needed when the clauses are moved in memory.
+  void ChangeSatClauseReason(VariableIndex var, SatClause* clause) {
+    DCHECK_EQ(InitialAssignmentType(var), AssignmentReason::CLAUSE_PROPAGATION);
+    reasons_[var].sat_clause = clause;
+  }
 
   // Sets the new resolution node for a variable that is fixed.
   void SetFixedVariableInfo(VariableIndex var, ResolutionNode* node) {
     CHECK_EQ(info_[var].level, 0);
-    info_[var].type = AssignmentInfo::UNIT_REASON;
-    info_[var].resolution_node = node;
+    CHECK(need_level_zero_);
+    reasons_[var].type = AssignmentReason::UNIT_REASON;
+    resolution_nodes_[var] = node;
   }
 
   // Print the current literals on the trail.
@@ -413,9 +458,15 @@ class Trail {
   int64 num_enqueues_;
   int trail_index_;
   AssignmentInfo current_info_;
+  AssignmentReason current_reason_;
   VariablesAssignment assignment_;
   std::vector<Literal> trail_;
+
+  // Per variable assignment data. The hot part is in info_, the reasons are
+  // apart, and the resolution nodes are only allocated for unsat proofs.
   ITIVector<VariableIndex, AssignmentInfo> info_;
+  ITIVector<VariableIndex, AssignmentReason> reasons_;
+  ITIVector<VariableIndex, ResolutionNode*> resolution_nodes_;
   ClauseRef failing_clause_;
   SatClause* failing_sat_clause_;
   ResolutionNode* failing_node_;
@@ -423,7 +474,7 @@ class Trail {
 
   // Reason cache.
   ITIVector<VariableIndex, std::vector<Literal>> cached_reasons_;
-  ITIVector<VariableIndex, AssignmentInfo::Type> old_type_;
+  ITIVector<VariableIndex, AssignmentReason::Type> old_type_;
 
   DISALLOW_COPY_AND_ASSIGN(Trail);
 };
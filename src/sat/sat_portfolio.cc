@@ -0,0 +1,238 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sat/sat_portfolio.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "base/callback.h"
+#include "base/logging.h"
+#include "base/threadpool.h"
+
+namespace operations_research {
+namespace sat {
+
+SharedClauseExchange::SharedClauseExchange(int num_workers, int capacity)
+    : capacity_(capacity),
+      slots_(new Slot[capacity]),
+      next_ticket_(0),
+      cursors_(num_workers, 0) {
+  CHECK_GT(capacity, 0);
+  for (int i = 0; i < capacity_; ++i) {
+    slots_[i].sequence.store(0, std::memory_order_relaxed);
+  }
+}
+
+void SharedClauseExchange::Publish(int worker_id,
+                                   const std::vector<Literal>& clause) {
+  if (clause.empty() || clause.size() > kMaxClauseSize) return;
+  const int64 ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[ticket % capacity_];
+
+  // Claims the slot. We drop the clause if the slot is being written, or if
+  // it was already reused by a more recent ticket.
+  const int64 busy = 2 * ticket + 1;
+  int64 sequence = slot.sequence.load(std::memory_order_relaxed);
+  if ((sequence & 1) || sequence >= busy ||
+      !slot.sequence.compare_exchange_strong(sequence, busy,
+                                             std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot.worker_id.store(worker_id, std::memory_order_relaxed);
+  slot.size.store(clause.size(), std::memory_order_relaxed);
+  for (int i = 0; i < clause.size(); ++i) {
+    slot.literals[i].store(clause[i].SignedValue(), std::memory_order_relaxed);
+  }
+  slot.sequence.store(busy + 1, std::memory_order_release);
+}
+
+void SharedClauseExchange::Fetch(int worker_id,
+                                 std::vector<std::vector<Literal>>* clauses) {
+  int64& cursor = cursors_[worker_id];
+  const int64 end = next_ticket_.load(std::memory_order_acquire);
+
+  // If we are lagging too much behind, the oldest slots were overwritten.
+  cursor = std::max(cursor, end - capacity_);
+
+  std::vector<Literal> clause;
+  for (; cursor < end; ++cursor) {
+    const Slot& slot = slots_[cursor % capacity_];
+    const int64 expected = 2 * cursor + 2;
+
+    // Skip the slot if its clause is not written yet (or was dropped), or if
+    // it was already overwritten by a more recent one.
+    if (slot.sequence.load(std::memory_order_acquire) != expected) continue;
+    if (slot.worker_id.load(std::memory_order_relaxed) == worker_id) continue;
+    const int size = slot.size.load(std::memory_order_relaxed);
+    if (size <= 0 || size > kMaxClauseSize) continue;
+    clause.clear();
+    for (int i = 0; i < size; ++i) {
+      clause.push_back(
+          Literal(slot.literals[i].load(std::memory_order_relaxed)));
+    }
+
+    // Make sure the slot wasn't modified while we were reading it.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != expected) continue;
+    clauses->push_back(clause);
+  }
+}
+
+SatPortfolioSolver::SatPortfolioSolver(const SatParameters& parameters)
+    : parameters_(parameters), stop_(false), winner_(0),
+      status_(SatSolver::LIMIT_REACHED) {
+  const int num_workers = std::max(1, parameters.num_search_workers());
+  for (int i = 0; i < num_workers; ++i) {
+    workers_.emplace_back(new SatSolver());
+    workers_.back()->SetParameters(WorkerParameters(parameters, i));
+  }
+  if (num_workers > 1) {
+    const int max_size = std::min<int>(parameters.share_max_clause_size(),
+                                       SharedClauseExchange::kMaxClauseSize);
+    for (int i = 0; i < num_workers; ++i) {
+      workers_[i]->SetLearnedClauseExportLimits(max_size,
+                                                parameters.share_max_lbd());
+    }
+
+    // We size the buffer so that each worker can export a reasonable number of
+    // clauses between two exchanges.
+    const int kSlotsPerWorker = 1 << 12;
+    exchange_.reset(
+        new SharedClauseExchange(num_workers, num_workers * kSlotsPerWorker));
+  }
+}
+
+SatParameters SatPortfolioSolver::WorkerParameters(
+    const SatParameters& parameters, int worker_id) {
+  SatParameters result = parameters;
+  if (worker_id == 0) return result;
+  static const SatParameters::RestartAlgorithm kRestarts[] = {
+      SatParameters::LUBY_RESTART, SatParameters::LBD_MOVING_AVERAGE_RESTART,
+      SatParameters::DL_MOVING_AVERAGE_RESTART};
+  static const SatParameters::Polarity kPolarities[] = {
+      SatParameters::POLARITY_TRUE, SatParameters::POLARITY_FALSE,
+      SatParameters::POLARITY_RANDOM};
+  result.set_random_seed(parameters.random_seed() + worker_id);
+  result.set_restart_algorithm(kRestarts[worker_id % 3]);
+  result.set_initial_polarity(kPolarities[(worker_id / 3) % 3]);
+  if (worker_id >= 9) result.set_random_branches_ratio(0.01);
+  result.set_log_search_progress(false);
+  return result;
+}
+
+SatSolver::Status SatPortfolioSolver::Solve() {
+  winner_ = 0;
+  if (NumWorkers() == 1) {
+    status_ = workers_[0]->Solve();
+    return status_;
+  }
+
+  stop_ = false;
+  winner_ = -1;
+  status_ = SatSolver::LIMIT_REACHED;
+  {
+    ThreadPool pool("SatPortfolio", NumWorkers());
+    for (int i = 0; i < NumWorkers(); ++i) {
+      pool.Add(NewCallback(this, &SatPortfolioSolver::RunWorker, i));
+    }
+    pool.StartWorkers();
+  }
+  if (winner_ == -1) winner_ = 0;
+  return status_;
+}
+
+void SatPortfolioSolver::RunWorker(int worker_id) {
+  SatSolver* solver = workers_[worker_id].get();
+  const int64 max_conflicts = solver->parameters().max_number_of_conflicts();
+  const int64 conflict_limit =
+      max_conflicts == std::numeric_limits<int64>::max()
+          ? max_conflicts
+          : solver->num_failures() + max_conflicts;
+  const int64 period =
+      std::max(1, parameters_.share_period_in_conflicts());
+
+  // The literals fixed at level 0 before this index were already exported.
+  solver->Backtrack(0);
+  int num_exported_units = solver->LiteralTrail().Index();
+
+  std::vector<std::vector<Literal>> imported;
+  std::vector<Literal> unit(1);
+  SatSolver::Status status = SatSolver::LIMIT_REACHED;
+  while (!stop_.load(std::memory_order_relaxed)) {
+    const int64 num_conflicts_before = solver->num_failures();
+    const int64 slice = std::min(period, conflict_limit - num_conflicts_before);
+    if (slice <= 0) break;
+    status = solver->SolveWithConflictLimit(slice);
+    if (status != SatSolver::LIMIT_REACHED) break;
+
+    // Another limit (time, memory) was reached.
+    if (solver->num_failures() < num_conflicts_before + slice) break;
+
+    // Exchange clauses at level 0.
+    solver->Backtrack(0);
+    for (const std::vector<Literal>& clause :
+         solver->NewlyLearnedClausesToExport()) {
+      exchange_->Publish(worker_id, clause);
+    }
+    solver->ClearNewlyLearnedClausesToExport();
+    const Trail& trail = solver->LiteralTrail();
+    for (; num_exported_units < trail.Index(); ++num_exported_units) {
+      unit[0] = trail[num_exported_units];
+      exchange_->Publish(worker_id, unit);
+    }
+
+    imported.clear();
+    exchange_->Fetch(worker_id, &imported);
+    for (const std::vector<Literal>& clause : imported) {
+      if (!solver->AddLearnedClauseFromOtherSolver(clause)) {
+        status = SatSolver::MODEL_UNSAT;
+        break;
+      }
+    }
+    if (status == SatSolver::MODEL_UNSAT) break;
+
+    // There is no need to send back the units we just imported.
+    num_exported_units = trail.Index();
+  }
+
+  if (status == SatSolver::MODEL_SAT || status == SatSolver::MODEL_UNSAT) {
+    MutexLock mutex_lock(&mutex_);
+    if (winner_ == -1) {
+      winner_ = worker_id;
+      status_ = status;
+    }
+    stop_ = true;
+  }
+}
+
+int64 SatPortfolioSolver::num_failures() const {
+  int64 result = 0;
+  for (const std::unique_ptr<SatSolver>& worker : workers_) {
+    result += worker->num_failures();
+  }
+  return result;
+}
+
+double SatPortfolioSolver::deterministic_time() const {
+  double result = 0.0;
+  for (const std::unique_ptr<SatSolver>& worker : workers_) {
+    result = std::max(result, worker->deterministic_time());
+  }
+  return result;
+}
+
+}  // namespace sat
+}  // namespace operations_research
@@ -0,0 +1,148 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A parallel portfolio of SatSolver. Each worker runs the same problem with
+// different parameters in its own thread, and the workers periodically
+// exchange their short learned clauses (and their newly fixed literals)
+// through a lock-free buffer. The first worker to find an answer stops the
+// others.
+
+#ifndef OR_TOOLS_SAT_SAT_PORTFOLIO_H_
+#define OR_TOOLS_SAT_SAT_PORTFOLIO_H_
+
+#include <atomic>
+#include "base/unique_ptr.h"
+#include <utility>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "sat/sat_base.h"
+#include "sat/sat_parameters.pb.h"
+#include "sat/sat_solver.h"
+
+namespace operations_research {
+namespace sat {
+
+// A bounded multi-producer multi-consumer buffer of clauses. The buffer is a
+// ring of fixed-size slots, each protected by a sequence number (a "seqlock"),
+// so neither the writers nor the readers ever block. The exchange is best
+// effort: a clause can be dropped if it is too large, if its slot is being
+// written concurrently, or if a reader is lagging more than the buffer
+// capacity behind the writers. This is fine since the exchanged clauses are
+// only redundant information.
+class SharedClauseExchange {
+ public:
+  // The maximum size of a clause that can be exchanged.
+  static const int kMaxClauseSize = 16;
+
+  SharedClauseExchange(int num_workers, int capacity);
+
+  // Publishes the given clause to all the other workers.
+  void Publish(int worker_id, const std::vector<Literal>& clause);
+
+  // Appends to clauses all the clauses published by the other workers since
+  // the last call to this function with the same worker_id. Only the thread
+  // running the given worker should call this.
+  void Fetch(int worker_id, std::vector<std::vector<Literal>>* clauses);
+
+ private:
+  // A slot holds the clause of the ticket t once its sequence is 2 * t + 2. An
+  // odd sequence means that a writer is currently filling the slot.
+  struct Slot {
+    std::atomic<int64> sequence;
+    std::atomic<int32> worker_id;
+    std::atomic<int32> size;
+    std::atomic<int32> literals[kMaxClauseSize];
+  };
+
+  const int capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<int64> next_ticket_;
+
+  // The next ticket to read for each worker.
+  std::vector<int64> cursors_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedClauseExchange);
+};
+
+// Runs parameters.num_search_workers() SatSolver in parallel on the same
+// problem. Usage:
+//   SatPortfolioSolver portfolio(parameters);
+//   for (int i = 0; i < portfolio.NumWorkers(); ++i) {
+//     LoadProblem(problem, portfolio.MutableWorker(i));
+//   }
+//   const SatSolver::Status status = portfolio.Solve();
+//   ... portfolio.Winner().Assignment() ...
+//
+// With only one worker, Solve() just calls the Solve() of this worker, so the
+// search is exactly the same as the one of a single SatSolver.
+class SatPortfolioSolver {
+ public:
+  explicit SatPortfolioSolver(const SatParameters& parameters);
+
+  int NumWorkers() const { return workers_.size(); }
+
+  // The workers. They are already configured with their own parameters, and
+  // the client must load the same problem in all of them before calling
+  // Solve(). Note that the problem can't be solved under assumptions.
+  SatSolver* MutableWorker(int i) { return workers_[i].get(); }
+
+  // Returns MODEL_SAT or MODEL_UNSAT as soon as one worker found the answer,
+  // or LIMIT_REACHED if all the workers reached their limits.
+  SatSolver::Status Solve();
+
+  // The worker that returned the status of the last Solve(). If it was
+  // MODEL_SAT, its assignment is a solution of the problem.
+  const SatSolver& Winner() const { return *workers_[winner_]; }
+
+  // Transfers the ownership of the winner to the caller. Note that the
+  // portfolio can't be used after this.
+  std::unique_ptr<SatSolver> ReleaseWinner() {
+    return std::move(workers_[winner_]);
+  }
+
+  // Aggregated statistics over all the workers. The deterministic time is the
+  // one of the slowest worker since they all run in parallel.
+  int64 num_failures() const;
+  double deterministic_time() const;
+
+ private:
+  // Returns the parameters of the given worker. The worker 0 uses the given
+  // parameters, the other ones are diversified and don't log their search.
+  static SatParameters WorkerParameters(const SatParameters& parameters,
+                                        int worker_id);
+
+  // Runs the search of the given worker by slices of
+  // share_period_in_conflicts() conflicts, exchanging clauses in between.
+  void RunWorker(int worker_id);
+
+  const SatParameters parameters_;
+  std::vector<std::unique_ptr<SatSolver>> workers_;
+  std::unique_ptr<SharedClauseExchange> exchange_;
+
+  // Set to true by the first worker that finds an answer.
+  std::atomic<bool> stop_;
+
+  Mutex mutex_;
+  int winner_;
+  SatSolver::Status status_;
+
+  DISALLOW_COPY_AND_ASSIGN(SatPortfolioSolver);
+};
+
+}  // namespace sat
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_SAT_SAT_PORTFOLIO_H_
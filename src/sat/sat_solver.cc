@@ -22,18 +22,29 @@
 #include "base/logging.h"
 #include "base/sysinfo.h"
 #include "base/join.h"
+#include "util/metrics.h"
 #include "util/saturated_arithmetic.h"
 #include "base/stl_util.h"
 
 namespace operations_research {
 namespace sat {
 
+namespace {
+// Marks the two ends of the VMTF queue.
+const VariableIndex kNoVmtfVariable(-1);
+}  // namespace
+
 SatSolver::SatSolver()
     : num_variables_(0),
       num_constraints_(0),
       pb_constraints_(&trail_),
       symmetry_propagator_(&trail_),
       track_binary_clauses_(false),
+      export_max_clause_size_(0),
+      export_max_lbd_(0),
+      next_inprocessing_num_failures_(0),
+      num_enqueues_at_last_inprocessing_(0),
+      next_rephasing_num_failures_(0),
       current_decision_level_(0),
       last_decision_or_backtrack_trail_index_(0),
       assumption_level_(0),
@@ -41,8 +52,15 @@ SatSolver::SatSolver()
       binary_propagation_trail_index_(0),
       num_processed_fixed_variables_(0),
       counters_(),
+      counters_at_solve_start_(),
+      num_propagations_at_solve_start_(0),
       is_model_unsat_(false),
       is_var_ordering_initialized_(false),
+      use_vmtf_(false),
+      vmtf_first_(kNoVmtfVariable),
+      vmtf_last_(kNoVmtfVariable),
+      vmtf_search_(kNoVmtfVariable),
+      vmtf_next_stamp_(0),
       variable_activity_increment_(1.0),
       clause_activity_increment_(1.0),
       is_decision_heuristic_initialized_(false),
@@ -51,6 +69,7 @@ SatSolver::SatSolver()
       conflicts_until_next_restart_(0),
       restart_count_(0),
       same_reason_identifier_(trail_),
+      drat_writer_(nullptr),
       is_relevant_for_core_computation_(true),
       time_limit_(new TimeLimit(std::numeric_limits<double>::infinity(),
                                 std::numeric_limits<double>::infinity())),
@@ -69,9 +88,9 @@ SatSolver::~SatSolver() {
     // We also have to free the ResolutionNode of the variable assigned at
     // level 0.
     for (int i = 0; i < trail_.Index(); ++i) {
-      const AssignmentInfo& info = trail_.Info(trail_[i].Variable());
-      if (info.type == AssignmentInfo::UNIT_REASON) {
-        ResolutionNode* node = info.resolution_node;
+      const VariableIndex var = trail_[i].Variable();
+      if (trail_.ReasonInfo(var).type == AssignmentReason::UNIT_REASON) {
+        ResolutionNode* node = trail_.UnitResolutionNode(var);
         unsat_proof_.UnlockNode(node);
       }
     }
@@ -80,7 +99,7 @@ SatSolver::~SatSolver() {
       unsat_proof_.UnlockNode(node);
     }
   }
-  STLDeleteElements(&clauses_);
+  // Note that the clauses memory is owned by clause_arena_.
 }
 
 void SatSolver::SetNumVariables(int num_variables) {
@@ -100,6 +119,9 @@ void SatSolver::SetNumVariables(int num_variables) {
   pq_need_update_for_var_at_trail_index_.Resize(num_variables);
   weighted_sign_.resize(num_variables, 0.0);
   queue_elements_.resize(num_variables);
+  vmtf_prev_.resize(num_variables, kNoVmtfVariable);
+  vmtf_next_.resize(num_variables, kNoVmtfVariable);
+  vmtf_stamps_.resize(num_variables, 0);
 
   // Only reset the polarity of the new variables.
   ResetPolarity(VariableIndex(polarity_.size()));
@@ -129,12 +151,22 @@ double SatSolver::deterministic_time() const {
   return 1e-8 * (8.0 * trail_.NumberOfEnqueues() +
                  1.0 * binary_implication_graph_.num_inspections() +
                  4.0 * watched_clauses_.num_inspected_clauses() +
-                 1.0 * watched_clauses_.num_inspected_clause_literals() +
-
-                 // Here there is a factor 2 because of the untrail.
-                 20.0 * pb_constraints_.num_constraint_lookups() +
-                 2.0 * pb_constraints_.num_threshold_updates() +
-                 1.0 * pb_constraints_.num_inspected_constraint_literals());
+                 1.0 * watched_clauses_.num_inspected_clause_literals()) +
+         pb_constraints_.deterministic_time();
+}
+
+SatSolver::WorkBreakdown SatSolver::work_breakdown() const {
+  // The weights are an estimate of the cost of each basic operation, in the
+  // same spirit as the ones of deterministic_time(). The clause cleanup cost
+  // accounts for the sort of the learned clause database.
+  WorkBreakdown result;
+  result.propagation = deterministic_time();
+  result.conflict_analysis =
+      1e-8 * 2.0 * counters_.num_conflict_analysis_literals;
+  result.minimization = 1e-8 * 2.0 * counters_.num_minimization_literals;
+  result.clause_cleanup = 1e-8 * 10.0 * counters_.num_clause_cleanup_clauses;
+  result.restarts = 1e-8 * 4.0 * counters_.num_restart_untrailed_literals;
+  return result;
 }
 
 const SatParameters& SatSolver::parameters() const {
@@ -156,6 +188,19 @@ void SatSolver::SetParameters(const SatParameters& parameters) {
   lbd_running_average_.Reset(parameters_.restart_running_window_size());
   trail_size_running_average_.Reset(parameters_.blocking_restart_window_size());
   deterministic_time_at_last_advanced_time_limit_ = deterministic_time();
+  next_inprocessing_num_failures_ =
+      counters_.num_failures + parameters_.inprocessing_period_in_conflicts();
+  next_rephasing_num_failures_ =
+      counters_.num_failures +
+      parameters_.local_search_rephasing_period_in_conflicts();
+
+  // The variable ordering will be lazily rebuilt if its type changed.
+  const bool use_vmtf =
+      parameters_.variable_ordering_algorithm() == SatParameters::VMTF;
+  if (use_vmtf != use_vmtf_) {
+    use_vmtf_ = use_vmtf;
+    is_var_ordering_initialized_ = false;
+  }
 }
 
 std::string SatSolver::Indent() const {
@@ -175,6 +220,10 @@ bool SatSolver::IsMemoryLimitReached() const {
 }
 
 bool SatSolver::SetModelUnsat() {
+  if (drat_writer_ != nullptr && !is_model_unsat_) {
+    drat_writer_->AddClause(ClauseRef());
+    drat_writer_->Flush();
+  }
   is_model_unsat_ = true;
   return false;
 }
@@ -251,18 +300,19 @@ bool SatSolver::AddProblemClauseInternal(const std::vector<Literal>& literals,
     trail_.EnqueueWithUnitReason(literals[0], node);  // Not assigned.
     return true;
   }
-  // Create a new clause.
-  std::unique_ptr<SatClause> clause(
-      SatClause::Create(literals, /*is_redundant=*/false, node));
+  if (parameters_.treat_binary_clauses_separately() && literals.size() == 2) {
+    AddBinaryClauseInternal(literals[0], literals[1]);
+    return true;
+  }
 
-  if (parameters_.treat_binary_clauses_separately() && clause->Size() == 2) {
-    AddBinaryClauseInternal(clause->FirstLiteral(), clause->SecondLiteral());
-  } else {
-    if (!watched_clauses_.AttachAndPropagate(clause.get(), &trail_)) {
-      return SetModelUnsat();
-    }
-    clauses_.push_back(clause.release());
+  // Create a new clause.
+  SatClause* clause =
+      SatClause::Create(literals, /*is_redundant=*/false, node, &clause_arena_);
+  if (!watched_clauses_.AttachAndPropagate(clause, &trail_)) {
+    clause_arena_.Free(clause);
+    return SetModelUnsat();
   }
+  clauses_.push_back(clause);
   return true;
 }
 
@@ -372,6 +422,7 @@ bool SatSolver::AddLinearConstraint(bool use_lower_bound,
 void SatSolver::AddLearnedClauseAndEnqueueUnitPropagation(
     const std::vector<Literal>& literals, bool is_redundant, ResolutionNode* node) {
   SCOPED_TIME_STAT(&stats_);
+  if (drat_writer_ != nullptr) drat_writer_->AddClause(ClauseRef(literals));
   if (literals.size() == 1) {
     // A length 1 clause fix a literal for all the search.
     // ComputeBacktrackLevel() should have returned 0.
@@ -383,12 +434,16 @@ void SatSolver::AddLearnedClauseAndEnqueueUnitPropagation(
     if (track_binary_clauses_) {
       CHECK(binary_clauses_.Add(BinaryClause(literals[0], literals[1])));
     }
+    if (export_max_clause_size_ >= 2 && export_max_lbd_ >= 2) {
+      learned_clauses_to_export_.push_back(literals);
+    }
     binary_implication_graph_.AddBinaryConflict(literals[0], literals[1],
                                                 &trail_);
     lbd_running_average_.Add(2);
   } else {
     CleanClauseDatabaseIfNeeded();
-    SatClause* clause = SatClause::Create(literals, is_redundant, node);
+    SatClause* clause =
+        SatClause::Create(literals, is_redundant, node, &clause_arena_);
     clauses_.emplace_back(clause);
     BumpClauseActivity(clause);
 
@@ -401,25 +456,83 @@ void SatSolver::AddLearnedClauseAndEnqueueUnitPropagation(
 
     // Maintain the lbd average for the restart policy.
     lbd_running_average_.Add(clause->Lbd());
+    if (literals.size() <= export_max_clause_size_ &&
+        clause->Lbd() <= export_max_lbd_) {
+      learned_clauses_to_export_.push_back(literals);
+    }
 
     CHECK(watched_clauses_.AttachAndPropagate(clause, &trail_));
   }
 }
 
+void SatSolver::SetLearnedClauseExportLimits(int max_size, int max_lbd) {
+  export_max_clause_size_ = max_size;
+  export_max_lbd_ = max_lbd;
+}
+
+bool SatSolver::AddLearnedClauseFromOtherSolver(
+    const std::vector<Literal>& literals) {
+  SCOPED_TIME_STAT(&stats_);
+  CHECK_EQ(CurrentDecisionLevel(), 0);
+  CHECK(!parameters_.unsat_proof());
+  if (is_model_unsat_) return false;
+
+  // Remove the literals fixed at level zero.
+  literals_scratchpad_.clear();
+  for (const Literal literal : literals) {
+    if (trail_.Assignment().IsLiteralTrue(literal)) return true;
+    if (trail_.Assignment().IsLiteralFalse(literal)) continue;
+    literals_scratchpad_.push_back(literal);
+  }
+
+  // The LBD of the clause in this solver is unknown, so we use its size which
+  // is an upper bound.
+  CleanClauseDatabaseIfNeeded();
+  return AddClauseAtLevelZero(literals_scratchpad_, /*is_redundant=*/true,
+                              literals_scratchpad_.size());
+}
+
+bool SatSolver::AddClauseAtLevelZero(const std::vector<Literal>& literals,
+                                     bool is_redundant, int lbd) {
+  DCHECK_EQ(CurrentDecisionLevel(), 0);
+  if (literals.empty()) return SetModelUnsat();
+  if (drat_writer_ != nullptr) drat_writer_->AddClause(ClauseRef(literals));
+  if (literals.size() == 1) {
+    trail_.EnqueueWithUnitReason(literals[0], nullptr);
+  } else if (literals.size() == 2 &&
+             parameters_.treat_binary_clauses_separately()) {
+    AddBinaryClauseInternal(literals[0], literals[1]);
+  } else {
+    SatClause* clause =
+        SatClause::Create(literals, is_redundant, nullptr, &clause_arena_);
+    clauses_.emplace_back(clause);
+    BumpClauseActivity(clause);
+    clause->SetLbd(lbd);
+    if (!ClauseShouldBeKept(clause)) {
+      --num_learned_clause_before_cleanup_;
+    }
+    if (!watched_clauses_.AttachAndPropagate(clause, &trail_)) {
+      return SetModelUnsat();
+    }
+  }
+  if (!Propagate()) return SetModelUnsat();
+  return true;
+}
+
 namespace {
 
 // Returns the UpperBoundedLinearConstraint used as a reason if var was
 // propagated by such constraint, or nullptr otherwise.
 UpperBoundedLinearConstraint* PBReasonOrNull(VariableIndex var,
                                              const Trail& trail) {
-  const AssignmentInfo& info = trail.Info(var);
-  if (trail.InitialAssignmentType(var) == AssignmentInfo::PB_PROPAGATION) {
+  const AssignmentReason& info = trail.ReasonInfo(var);
+  if (trail.InitialAssignmentType(var) == AssignmentReason::PB_PROPAGATION) {
     return info.pb_constraint;
   }
-  if (trail.InitialAssignmentType(var) == AssignmentInfo::SAME_REASON_AS &&
+  if (trail.InitialAssignmentType(var) == AssignmentReason::SAME_REASON_AS &&
       trail.InitialAssignmentType(info.reference_var) ==
-          AssignmentInfo::PB_PROPAGATION) {
-    const AssignmentInfo& ref_info = trail.Info(info.reference_var);
+          AssignmentReason::PB_PROPAGATION) {
+    const AssignmentReason& ref_info = trail.ReasonInfo(info.reference_var);
     return ref_info.pb_constraint;
   }
   return nullptr;
@@ -569,6 +682,15 @@ bool SatSolver::PropagateAndStopAfterOneConflictResolution() {
         parameters_.glucose_decay_increment());
   }
 
+  // Alternate between the VMTF and VSIDS orderings if requested. The new one is
+  // lazily rebuilt from the variable activities.
+  const int switch_period = parameters_.variable_ordering_switch_period();
+  if (switch_period > 0 && counters_.num_failures % switch_period == 0) {
+    ++counters_.num_variable_ordering_switches;
+    use_vmtf_ = !use_vmtf_;
+    is_var_ordering_initialized_ = false;
+  }
+
   // PB resolution.
   // There is no point using this if the conflict and all the reasons involved
   // in its resolution where clauses.
@@ -725,7 +847,7 @@ bool SatSolver::PropagateAndStopAfterOneConflictResolution() {
 
   // Backtrack and add the reason to the set of learned clause.
   counters_.num_literals_learned += learned_conflict_.size();
-  Backtrack(ComputeBacktrackLevel(learned_conflict_));
+  Backtrack(ComputeConflictBacktrackLevel(learned_conflict_));
   DCHECK(ClauseIsValidUnderDebugAssignement(learned_conflict_));
 
   // Detach any subsumed clause. They will actually be deleted on the next
@@ -890,12 +1012,54 @@ SatSolver::Status SatSolver::ResetAndSolveWithGivenAssumptions(
   SCOPED_TIME_STAT(&stats_);
   DCHECK(!is_model_unsat_);
   CHECK_LE(assumptions.size(), num_variables_);
-  Backtrack(0);
-  for (int i = 0; i < assumptions.size(); ++i) {
+
+  // We only backtrack over the decisions that differ from the new assumptions.
+  // The common prefix is still valid and doesn't need to be propagated again.
+  const int max_common_level =
+      std::min<int>(CurrentDecisionLevel(), assumptions.size());
+  int common_level = 0;
+  while (common_level < max_common_level &&
+         decisions_[common_level].literal == assumptions[common_level]) {
+    ++common_level;
+  }
+  Backtrack(common_level);
+  for (int i = common_level; i < assumptions.size(); ++i) {
     decisions_[i].literal = assumptions[i];
   }
   assumption_level_ = assumptions.size();
-  return SolveInternal(time_limit_.get());
+  return SolveInternal(time_limit_.get(),
+                       parameters_.max_number_of_conflicts());
+}
+
+Literal SatSolver::NewClauseGroup() {
+  SCOPED_TIME_STAT(&stats_);
+  const VariableIndex var(NumVariables());
+  SetNumVariables(NumVariables() + 1);
+  return Literal(var, true);
+}
+
+bool SatSolver::AddClauseToGroup(Literal activation_literal,
+                                 const std::vector<Literal>& literals) {
+  SCOPED_TIME_STAT(&stats_);
+  Backtrack(0);
+  std::vector<Literal> clause = literals;
+  clause.push_back(activation_literal.Negated());
+  return AddProblemClause(clause);
+}
+
+bool SatSolver::DisableClauseGroup(Literal activation_literal) {
+  SCOPED_TIME_STAT(&stats_);
+  Backtrack(0);
+  if (!AddUnitClause(activation_literal.Negated())) return false;
+
+  // Deletes the now satisfied clauses of the group right away, we don't want
+  // to wait for the next decision at level zero which may never happen if the
+  // solver is always used with assumptions.
+  if (num_processed_fixed_variables_ < trail_.Index()) {
+    ProcessNewlyFixedVariableResolutionNodes();
+    ProcessNewlyFixedVariables();
+  }
+  return true;
 }
 
 SatSolver::Status SatSolver::StatusWithLog(Status status) {
@@ -903,6 +1067,23 @@ SatSolver::Status SatSolver::StatusWithLog(Status status) {
     LOG(INFO) << RunningStatisticsString();
     LOG(INFO) << StatusString(status);
   }
+  MetricsRegistry* const metrics = MetricsRegistry::Global();
+  if (metrics->enabled()) {
+    const double elapsed_time = timer_.Get();
+    metrics->IncrementCounter("sat", "solves", 1);
+    metrics->AddToHistogram("sat", "solve_time_seconds", elapsed_time);
+    metrics->PublishThroughput(
+        "sat", "conflicts",
+        counters_.num_failures - counters_at_solve_start_.num_failures,
+        elapsed_time);
+    metrics->PublishThroughput(
+        "sat", "branches",
+        counters_.num_branches - counters_at_solve_start_.num_branches,
+        elapsed_time);
+    metrics->PublishThroughput(
+        "sat", "propagations",
+        num_propagations() - num_propagations_at_solve_start_, elapsed_time);
+  }
   return status;
 }
 
@@ -914,13 +1095,24 @@ void SatSolver::SetAssumptionLevel(int assumption_level) {
 }
 
 SatSolver::Status SatSolver::Solve() {
-  return SolveInternal(time_limit_.get());
+  return SolveInternal(time_limit_.get(),
+                       parameters_.max_number_of_conflicts());
+}
+
+SatSolver::Status SatSolver::SolveWithConflictLimit(
+    int64 max_number_of_conflicts) {
+  return SolveInternal(time_limit_.get(),
+                       std::min<int64>(max_number_of_conflicts,
+                                       parameters_.max_number_of_conflicts()));
 }
 
-SatSolver::Status SatSolver::SolveInternal(TimeLimit* time_limit) {
+SatSolver::Status SatSolver::SolveInternal(TimeLimit* time_limit,
+                                           int64 max_number_of_conflicts) {
   SCOPED_TIME_STAT(&stats_);
   if (is_model_unsat_) return MODEL_UNSAT;
   timer_.Restart();
+  counters_at_solve_start_ = counters_;
+  num_propagations_at_solve_start_ = num_propagations();
 
   // This is done this way, so heuristics like the weighted_sign_ one can
   // wait for all the constraint to be added before beeing initialized.
@@ -953,9 +1145,9 @@ SatSolver::Status SatSolver::SolveInternal(TimeLimit* time_limit) {
   // The max_number_of_conflicts is per solve but the counter is for the whole
   // solver.
   const int64 kFailureLimit =
-      parameters_.max_number_of_conflicts() == std::numeric_limits<int64>::max()
+      max_number_of_conflicts == std::numeric_limits<int64>::max()
           ? std::numeric_limits<int64>::max()
-          : counters_.num_failures + parameters_.max_number_of_conflicts();
+          : counters_.num_failures + max_number_of_conflicts;
 
   // Starts search.
   for (;;) {
@@ -1054,7 +1246,31 @@ SatSolver::Status SatSolver::SolveInternal(TimeLimit* time_limit) {
       }
       if (restart) {
         restart_count_++;
+        const int old_trail_index = trail_.Index();
         Backtrack(assumption_level_);
+        counters_.num_restart_untrailed_literals +=
+            old_trail_index - trail_.Index();
+
+        // Simplify the clause database from time to time. Since this may fix
+        // some variables, we go back to the start of the loop afterwards.
+        if (parameters_.inprocessing_period_in_conflicts() > 0 &&
+            assumption_level_ == 0 && !parameters_.unsat_proof() &&
+            counters_.num_failures >= next_inprocessing_num_failures_) {
+          next_inprocessing_num_failures_ =
+              counters_.num_failures +
+              parameters_.inprocessing_period_in_conflicts();
+          if (!Inprocess()) return StatusWithLog(MODEL_UNSAT);
+          continue;
+        }
+
+        // Look for better polarities from time to time.
+        if (parameters_.local_search_rephasing_period_in_conflicts() > 0 &&
+            counters_.num_failures >= next_rephasing_num_failures_) {
+          next_rephasing_num_failures_ =
+              counters_.num_failures +
+              parameters_.local_search_rephasing_period_in_conflicts();
+          RephaseWithLocalSearch();
+        }
       }
 
       DCHECK_GE(CurrentDecisionLevel(), assumption_level_);
@@ -1065,7 +1281,7 @@ SatSolver::Status SatSolver::SolveInternal(TimeLimit* time_limit) {
 
 SatSolver::Status SatSolver::SolveWithTimeLimit(TimeLimit* time_limit) {
   deterministic_time_at_last_advanced_time_limit_ = deterministic_time();
-  return SolveInternal(time_limit);
+  return SolveInternal(time_limit, parameters_.max_number_of_conflicts());
 }
 
 std::vector<Literal> SatSolver::GetLastIncompatibleDecisions() {
@@ -1094,7 +1310,7 @@ std::vector<Literal> SatSolver::GetLastIncompatibleDecisions() {
     --trail_index;
 
     if (trail_.InitialAssignmentType(marked_literal.Variable()) ==
-        AssignmentInfo::SEARCH_DECISION) {
+        AssignmentReason::SEARCH_DECISION) {
       unsat_assumptions.push_back(marked_literal);
     } else {
       // Marks all the literals of its reason.
@@ -1116,22 +1332,28 @@ void SatSolver::BumpVariableActivities(const std::vector<Literal>& literals,
                                        int bump_again_lbd_limit) {
   SCOPED_TIME_STAT(&stats_);
   const double max_activity_value = parameters_.max_variable_activity_value();
+  const bool bump_vmtf = use_vmtf_ && is_var_ordering_initialized_;
   for (const Literal literal : literals) {
     const VariableIndex var = literal.Variable();
     const int level = DecisionLevel(var);
     if (level == 0) continue;
     if (level == CurrentDecisionLevel() &&
-        trail_.Info(var).type == AssignmentInfo::CLAUSE_PROPAGATION &&
-        trail_.Info(var).sat_clause->IsRedundant() &&
-        trail_.Info(var).sat_clause->Lbd() < bump_again_lbd_limit) {
+        trail_.ReasonInfo(var).type == AssignmentReason::CLAUSE_PROPAGATION &&
+        trail_.ReasonInfo(var).sat_clause->IsRedundant() &&
+        trail_.ReasonInfo(var).sat_clause->Lbd() < bump_again_lbd_limit) {
       activities_[var] += variable_activity_increment_;
     }
     activities_[var] += variable_activity_increment_;
-    pq_need_update_for_var_at_trail_index_.Set(trail_.Info(var).trail_index);
+    if (bump_vmtf) {
+      vmtf_bumped_variables_.push_back(var);
+    } else {
+      pq_need_update_for_var_at_trail_index_.Set(trail_.Info(var).trail_index);
+    }
     if (activities_[var] > max_activity_value) {
       RescaleVariableActivities(1.0 / max_activity_value);
     }
   }
+  if (bump_vmtf) BumpVmtfVariables(&vmtf_bumped_variables_);
 }
 
 void SatSolver::BumpReasonActivities(const std::vector<Literal>& literals) {
@@ -1139,13 +1361,13 @@ void SatSolver::BumpReasonActivities(const std::vector<Literal>& literals) {
   for (const Literal literal : literals) {
     const VariableIndex var = literal.Variable();
     if (DecisionLevel(var) > 0) {
-      if (trail_.Info(var).type == AssignmentInfo::CLAUSE_PROPAGATION) {
-        BumpClauseActivity(trail_.Info(var).sat_clause);
+      if (trail_.ReasonInfo(var).type == AssignmentReason::CLAUSE_PROPAGATION) {
+        BumpClauseActivity(trail_.ReasonInfo(var).sat_clause);
       } else if (trail_.InitialAssignmentType(var) ==
-                 AssignmentInfo::PB_PROPAGATION) {
+                 AssignmentReason::PB_PROPAGATION) {
         // TODO(user): Because one pb constraint may propagate many literals,
         // this may bias the constraint activity... investigate other policy.
-        pb_constraints_.BumpActivity(trail_.Info(var).pb_constraint);
+        pb_constraints_.BumpActivity(trail_.ReasonInfo(var).pb_constraint);
       }
     }
   }
@@ -1153,6 +1375,7 @@ void SatSolver::BumpReasonActivities(const std::vector<Literal>& literals) {
 
 void SatSolver::BumpClauseActivity(SatClause* clause) {
   if (!clause->IsRedundant()) return;
+  clause->MarkAsUsed();
   clause->IncreaseActivity(clause_activity_increment_);
   if (clause->Activity() > parameters_.max_clause_activity_value()) {
     RescaleClauseActivities(1.0 / parameters_.max_clause_activity_value());
@@ -1176,8 +1399,9 @@ void SatSolver::RescaleVariableActivities(double scaling_factor) {
   // preserve the order. This is because the activity of two entries may go to
   // zero and the tie-breaking ordering may change their relative order.
   //
-  // InitializeVariableOrdering() will be called lazily only if needed.
-  is_var_ordering_initialized_ = false;
+  // InitializeVariableOrdering() will be called lazily only if needed. The
+  // VMTF queue doesn't depend on the activity values and is left untouched.
+  if (!use_vmtf_) is_var_ordering_initialized_ = false;
 }
 
 void SatSolver::RescaleClauseActivities(double scaling_factor) {
@@ -1233,6 +1457,23 @@ int SatSolver::ComputeBacktrackLevel(const std::vector<Literal>& literals) {
   return backtrack_level;
 }
 
+int SatSolver::ComputeConflictBacktrackLevel(
+    const std::vector<Literal>& literals) {
+  const int backjump_level = ComputeBacktrackLevel(literals);
+
+  // A learned unit clause must be added at level 0.
+  if (!parameters_.use_chronological_backtracking() || literals.size() == 1) {
+    return backjump_level;
+  }
+  const int chronological_level = DecisionLevel(literals[0].Variable()) - 1;
+  if (chronological_level - backjump_level <=
+      parameters_.chronological_backtracking_threshold()) {
+    return backjump_level;
+  }
+  ++counters_.num_chronological_backtracks;
+  return chronological_level;
+}
+
 template <typename LiteralList>
 int SatSolver::ComputeLbd(const LiteralList& conflict) {
   SCOPED_TIME_STAT(&stats_);
@@ -1303,6 +1544,19 @@ std::string SatSolver::StatusString(Status status) const {
                           counters_.num_failures) +
          StringPrintf("  num subsumed clauses: %lld\n",
                       counters_.num_subsumed_clauses) +
+         StringPrintf("  num inprocessings: %lld\n",
+                      counters_.num_inprocessings) +
+         StringPrintf("  num vivified clauses: %lld"
+                      "  (literals removed: %lld)\n",
+                      counters_.num_vivified_clauses,
+                      counters_.num_vivified_literals_removed) +
+         StringPrintf("  num equivalent variables: %lld"
+                      "  (substituted clauses: %lld)\n",
+                      counters_.num_equivalent_variables,
+                      counters_.num_substituted_clauses) +
+         StringPrintf("  num rephasings: %lld  (local search flips: %lld)\n",
+                      counters_.num_rephasings,
+                      counters_.num_local_search_flips) +
          StringPrintf("  num restarts: %d\n", restart_count_) +
          StringPrintf("  pb num threshold updates: %lld\n",
                       pb_constraints_.num_threshold_updates()) +
@@ -1310,13 +1564,28 @@ std::string SatSolver::StatusString(Status status) const {
                       pb_constraints_.num_constraint_lookups()) +
          StringPrintf("  pb num inspected constraint literals: %lld\n",
                       pb_constraints_.num_inspected_constraint_literals()) +
+         StringPrintf("  pb deterministic time: %f\n",
+                      pb_constraints_.deterministic_time()) +
          StringPrintf("  conflict decision level avg: %f\n",
                       dl_running_average_.GlobalAverage()) +
          StringPrintf("  conflict lbd avg: %f\n",
                       lbd_running_average_.GlobalAverage()) +
          StringPrintf("  conflict trail size avg: %f\n",
                       trail_size_running_average_.GlobalAverage()) +
-         StringPrintf("  deterministic time: %f\n", deterministic_time());
+         StringPrintf("  num clause cleanups: %lld\n",
+                      counters_.num_clause_cleanups) +
+         StringPrintf("  num chronological backtracks: %lld\n",
+                      counters_.num_chronological_backtracks) +
+         StringPrintf("  num variable ordering switches: %lld\n",
+                      counters_.num_variable_ordering_switches) +
+         StringPrintf("  deterministic time: %f\n", deterministic_time()) +
+         StringPrintf("  work in conflict analysis: %f\n",
+                      work_breakdown().conflict_analysis) +
+         StringPrintf("  work in minimization: %f\n",
+                      work_breakdown().minimization) +
+         StringPrintf("  work in clause cleanup: %f\n",
+                      work_breakdown().clause_cleanup) +
+         StringPrintf("  work in restarts: %f\n", work_breakdown().restarts);
 }
 
 std::string SatSolver::RunningStatisticsString() const {
@@ -1333,10 +1602,10 @@ void SatSolver::ProcessNewlyFixedVariableResolutionNodes() {
   if (!parameters_.unsat_proof()) return;
   CHECK_GE(num_processed_fixed_variables_, 0);
   for (int i = num_processed_fixed_variables_; i < trail_.Index(); ++i) {
-    const AssignmentInfo& info = trail_.Info(trail_[i].Variable());
-    if (info.type == AssignmentInfo::UNIT_REASON) continue;
-    CHECK_NE(info.type, AssignmentInfo::SEARCH_DECISION);
-    CHECK_NE(info.type, AssignmentInfo::BINARY_PROPAGATION);
+    const AssignmentReason& info = trail_.ReasonInfo(trail_[i].Variable());
+    if (info.type == AssignmentReason::UNIT_REASON) continue;
+    CHECK_NE(info.type, AssignmentReason::SEARCH_DECISION);
+    CHECK_NE(info.type, AssignmentReason::BINARY_PROPAGATION);
 
     // DCHECK that the reason doesn't contain the propagated literal (it used
     // to, so this check that it is properly removed).
@@ -1349,7 +1618,7 @@ void SatSolver::ProcessNewlyFixedVariableResolutionNodes() {
     // Note that this works because level 0 literals are part of the reason
     // at this point.
     ResolutionNode* new_node =
-        CreateResolutionNode(info.type == AssignmentInfo::CLAUSE_PROPAGATION
+        CreateResolutionNode(info.type == AssignmentReason::CLAUSE_PROPAGATION
                                  ? info.sat_clause->ResolutionNodePointer()
                                  : info.pb_constraint->ResolutionNodePointer(),
                              Reason(trail_[i].Variable()));
@@ -1365,10 +1634,20 @@ void SatSolver::ProcessNewlyFixedVariables() {
   SCOPED_TIME_STAT(&stats_);
   DCHECK_EQ(CurrentDecisionLevel(), 0);
   std::vector<Literal> removed_literals;
+  std::vector<Literal> old_literals;
   std::vector<ResolutionNode*> resolution_nodes;
   int num_detached_clauses = 0;
   int num_binary = 0;
 
+  // The clauses deleted below may be the reasons of the fixed literals, so we
+  // first write these literals as unit clauses in the proof.
+  if (drat_writer_ != nullptr) {
+    for (int i = num_processed_fixed_variables_; i < trail_.Index(); ++i) {
+      const Literal unit = trail_[i];
+      drat_writer_->AddClause(ClauseRef(&unit, &unit + 1));
+    }
+  }
+
   // We remove the clauses that are always true and the fixed literals from the
   // others.
   for (SatClause* clause : clauses_) {
@@ -1381,6 +1660,14 @@ void SatSolver::ProcessNewlyFixedVariables() {
         watched_clauses_.LazyDetach(clause);
         ++num_detached_clauses;
       } else if (!removed_literals.empty()) {
+        if (drat_writer_ != nullptr) {
+          // The shorter clause replaces the old one in the proof.
+          drat_writer_->AddClause(ClauseRef(clause->begin(), clause->end()));
+          old_literals.assign(clause->begin(), clause->end());
+          old_literals.insert(old_literals.end(), removed_literals.begin(),
+                              removed_literals.end());
+          drat_writer_->DeleteClause(ClauseRef(old_literals));
+        }
         if (clause->Size() == 2 &&
             parameters_.treat_binary_clauses_separately()) {
           // The clause is now a binary clause, treat it separately. Note that
@@ -1430,10 +1717,408 @@ void SatSolver::DeleteDetachedClauses() {
       unsat_proof_.UnlockNode((*it)->ResolutionNodePointer());
     }
   }
-  STLDeleteContainerPointers(iter, clauses_.end());
+  for (std::vector<SatClause*>::iterator it = iter; it != clauses_.end(); ++it) {
+    // Note that the clauses of size 2 were converted to binary clauses by
+    // ProcessNewlyFixedVariables() and must stay in the proof.
+    if (drat_writer_ != nullptr &&
+        !((*it)->Size() == 2 && parameters_.treat_binary_clauses_separately())) {
+      drat_writer_->DeleteClause(ClauseRef((*it)->begin(), (*it)->end()));
+    }
+    clause_arena_.Free(*it);
+  }
   clauses_.erase(iter, clauses_.end());
 }
 
+void SatSolver::CompactClauseArenaIfNeeded() {
+  if (!clause_arena_.ShouldCompact()) return;
+  SCOPED_TIME_STAT(&stats_);
+  clause_arena_.Compact(&clauses_);
+  watched_clauses_.ForwardClausePointers();
+
+  // Update the clauses used as reason on the trail. Note that the type of an
+  // assignment may have been changed to CACHED_REASON, but its sat_clause is
+  // still used by ReasonClauseOrNull(). The reasons of the assignments at level
+  // zero are skipped: they are never used and the clauses satisfied at level
+  // zero may already have been deleted by ProcessNewlyFixedVariables().
+  for (int i = 0; i < trail_.Index(); ++i) {
+    const VariableIndex var = trail_[i].Variable();
+    if (trail_.Info(var).level == 0) continue;
+    if (trail_.InitialAssignmentType(var) ==
+        AssignmentReason::CLAUSE_PROPAGATION) {
+      trail_.ChangeSatClauseReason(
+          var, ClauseArena::Forward(trail_.ReasonInfo(var).sat_clause));
+    }
+  }
+  clause_arena_.ReleaseOldBlocks();
+}
+
+bool SatSolver::Inprocess() {
+  SCOPED_TIME_STAT(&stats_);
+  CHECK_EQ(CurrentDecisionLevel(), 0);
+  ++counters_.num_inprocessings;
+  if (num_processed_fixed_variables_ < trail_.Index()) {
+    ProcessNewlyFixedVariableResolutionNodes();
+    ProcessNewlyFixedVariables();
+  }
+  if (parameters_.use_equivalent_literal_detection() &&
+      parameters_.treat_binary_clauses_separately() &&
+      !SubstituteEquivalentLiterals()) {
+    return false;
+  }
+  if (parameters_.use_backward_subsumption()) BackwardSubsumption();
+  if (parameters_.use_vivification() && !VivifyLearnedClauses()) return false;
+  DeleteDetachedClauses();
+  num_enqueues_at_last_inprocessing_ = trail_.NumberOfEnqueues();
+  return !is_model_unsat_;
+}
+
+namespace {
+// The clauses used by SatSolver::RephaseWithLocalSearch(), without the literals
+// fixed by the given assignment. The clauses satisfied by it are skipped.
+class LocalSearchClauses {
+ public:
+  explicit LocalSearchClauses(const VariablesAssignment& assignment)
+      : assignment_(assignment), starts_(1, 0) {}
+
+  int NumClauses() const { return starts_.size() - 1; }
+  int Start(int c) const { return starts_[c]; }
+  int End(int c) const { return starts_[c + 1]; }
+  Literal literal(int i) const { return literals_[i]; }
+
+  void AddBinaryClause(Literal a, Literal b) {
+    const Literal clause[2] = {a, b};
+    AddClause(clause, clause + 2);
+  }
+  void AddClause(const Literal* begin, const Literal* end) {
+    for (const Literal* it = begin; it != end; ++it) {
+      if (assignment_.IsLiteralTrue(*it)) {
+        literals_.resize(starts_.back());
+        return;
+      }
+      if (!assignment_.IsLiteralFalse(*it)) literals_.push_back(*it);
+    }
+    if (literals_.size() > starts_.back()) starts_.push_back(literals_.size());
+  }
+
+ private:
+  const VariablesAssignment& assignment_;
+  std::vector<Literal> literals_;
+  std::vector<int> starts_;
+};
+}  // namespace
+
+void SatSolver::RephaseWithLocalSearch() {
+  SCOPED_TIME_STAT(&stats_);
+  ++counters_.num_rephasings;
+  const VariablesAssignment& fixed = trail_.Assignment();
+  LocalSearchClauses clauses(fixed);
+  binary_implication_graph_.ExtractAllBinaryClauses(&clauses);
+  for (SatClause* clause : clauses_) {
+    if (clause->IsAttached() && !clause->IsRedundant()) {
+      clauses.AddClause(clause->begin(), clause->end());
+    }
+  }
+  const int num_clauses = clauses.NumClauses();
+  if (num_clauses == 0) return;
+
+  // The clauses in which each literal appears.
+  ITIVector<LiteralIndex, std::vector<int>> occurrences(
+      2 * num_variables_.value());
+  for (int c = 0; c < num_clauses; ++c) {
+    for (int i = clauses.Start(c); i < clauses.End(c); ++i) {
+      occurrences[clauses.literal(i).Index()].push_back(c);
+    }
+  }
+
+  // Initializes the assignment from the polarities, and the set of unsatisfied
+  // clauses (with the position of each clause in it).
+  ITIVector<VariableIndex, bool> value(num_variables_.value());
+  for (VariableIndex var(0); var < num_variables_; ++var) {
+    value[var] = fixed.IsVariableAssigned(var)
+                     ? fixed.IsLiteralTrue(Literal(var, true))
+                     : polarity_[var].value;
+  }
+  std::vector<int> num_true(num_clauses, 0);
+  std::vector<int> unsat;
+  std::vector<int> unsat_position(num_clauses, -1);
+  for (int c = 0; c < num_clauses; ++c) {
+    for (int i = clauses.Start(c); i < clauses.End(c); ++i) {
+      const Literal literal = clauses.literal(i);
+      if (value[literal.Variable()] == literal.IsPositive()) ++num_true[c];
+    }
+    if (num_true[c] == 0) {
+      unsat_position[c] = unsat.size();
+      unsat.push_back(c);
+    }
+  }
+
+  // Only the variables flipped since the best assignment was last updated need
+  // to be copied when a better one is found.
+  ITIVector<VariableIndex, bool> best_value = value;
+  int best_num_unsat = unsat.size();
+  std::vector<VariableIndex> flipped_since_best;
+  const int64 max_flips = parameters_.local_search_rephasing_max_flips();
+  const double noise = parameters_.local_search_rephasing_noise();
+  int64 num_flips = 0;
+  while (!unsat.empty() && num_flips < max_flips) {
+    // Picks the literal of a random unsatisfied clause to make true.
+    const int c = unsat[random_.Uniform(unsat.size())];
+    const int size = clauses.End(c) - clauses.Start(c);
+    Literal flip = clauses.literal(clauses.Start(c));
+    if (random_.RandDouble() < noise) {
+      flip = clauses.literal(clauses.Start(c) + random_.Uniform(size));
+    } else {
+      // The flip breaks the clauses whose only true literal is its negation.
+      int best_num_breaks = kint32max;
+      for (int i = clauses.Start(c); i < clauses.End(c); ++i) {
+        const Literal literal = clauses.literal(i);
+        int num_breaks = 0;
+        for (const int other : occurrences[literal.NegatedIndex()]) {
+          if (num_true[other] == 1) ++num_breaks;
+        }
+        if (num_breaks < best_num_breaks) {
+          best_num_breaks = num_breaks;
+          flip = literal;
+        }
+      }
+    }
+
+    ++num_flips;
+    value[flip.Variable()] = flip.IsPositive();
+    flipped_since_best.push_back(flip.Variable());
+    for (const int other : occurrences[flip.Index()]) {
+      if (num_true[other]++ > 0) continue;
+      const int position = unsat_position[other];
+      unsat_position[unsat.back()] = position;
+      unsat[position] = unsat.back();
+      unsat.pop_back();
+      unsat_position[other] = -1;
+    }
+    for (const int other : occurrences[flip.NegatedIndex()]) {
+      if (--num_true[other] > 0) continue;
+      unsat_position[other] = unsat.size();
+      unsat.push_back(other);
+    }
+    if (unsat.size() < best_num_unsat) {
+      best_num_unsat = unsat.size();
+      for (const VariableIndex var : flipped_since_best) {
+        best_value[var] = value[var];
+      }
+      flipped_since_best.clear();
+    }
+  }
+  counters_.num_local_search_flips += num_flips;
+  VLOG(1) << "Rephasing: " << num_flips << " flips, " << best_num_unsat << "/"
+          << num_clauses << " unsatisfied clauses.";
+
+  for (VariableIndex var(0); var < num_variables_; ++var) {
+    if (!fixed.IsVariableAssigned(var)) polarity_[var].value = best_value[var];
+  }
+}
+
+bool SatSolver::SubstituteEquivalentLiterals() {
+  SCOPED_TIME_STAT(&stats_);
+  ITIVector<LiteralIndex, LiteralIndex> representative;
+  if (!binary_implication_graph_.DetectEquivalences(trail_, &representative)) {
+    return SetModelUnsat();
+  }
+  if (parameters_.use_transitive_reduction()) {
+    binary_implication_graph_.RemoveTransitiveImplications(
+        representative, parameters_.transitive_reduction_work_limit());
+  }
+  int num_equivalent_literals = 0;
+  for (LiteralIndex i(0); i < representative.size(); ++i) {
+    if (representative[i] != i) ++num_equivalent_literals;
+  }
+  counters_.num_equivalent_variables = num_equivalent_literals / 2;
+  if (num_equivalent_literals == 0) return true;
+
+  // Rewrites the clauses with a non-representative literal. The new clauses
+  // are appended to clauses_ and are not processed again. Note that a new
+  // clause can be unit if all its literals are in the same class, so the
+  // literals fixed by the previous rewrites must be taken into account.
+  const int num_clauses = clauses_.size();
+  std::vector<Literal> new_literals;
+  for (int i = 0; i < num_clauses; ++i) {
+    SatClause* clause = clauses_[i];
+    if (!clause->IsAttached()) continue;
+    bool is_changed = false;
+    for (const Literal literal : *clause) {
+      if (representative[literal.Index()] != literal.Index()) {
+        is_changed = true;
+        break;
+      }
+    }
+    if (!is_changed) continue;
+
+    // A literal and its negation are consecutive after the sort.
+    new_literals.clear();
+    for (const Literal literal : *clause) {
+      new_literals.push_back(Literal(representative[literal.Index()]));
+    }
+    std::sort(new_literals.begin(), new_literals.end());
+    new_literals.erase(std::unique(new_literals.begin(), new_literals.end()),
+                       new_literals.end());
+    bool is_satisfied = false;
+    int new_size = 0;
+    for (int j = 0; j < new_literals.size(); ++j) {
+      const Literal literal = new_literals[j];
+      if (j + 1 < new_literals.size() &&
+          new_literals[j + 1] == literal.Negated()) {
+        is_satisfied = true;
+        break;
+      }
+      if (trail_.Assignment().IsLiteralTrue(literal)) {
+        is_satisfied = true;
+        break;
+      }
+      if (!trail_.Assignment().IsLiteralFalse(literal)) {
+        new_literals[new_size++] = literal;
+      }
+    }
+    new_literals.resize(new_size);
+
+    ++counters_.num_substituted_clauses;
+    const int lbd = std::min<int>(clause->Lbd(), new_literals.size());
+    const bool is_redundant = clause->IsRedundant();
+    watched_clauses_.LazyDetach(clause);
+    watched_clauses_.CleanUpWatchers();
+    if (is_satisfied) continue;
+    if (!AddClauseAtLevelZero(new_literals, is_redundant, lbd)) return false;
+  }
+  return true;
+}
+
+void SatSolver::BackwardSubsumption() {
+  SCOPED_TIME_STAT(&stats_);
+
+  // Computes the occurrence lists of all the attached clauses.
+  ITIVector<LiteralIndex, std::vector<int>> occurrences(2 *
+                                                        num_variables_.value());
+  for (int i = 0; i < clauses_.size(); ++i) {
+    if (!clauses_[i]->IsAttached()) continue;
+    for (const Literal literal : *clauses_[i]) {
+      occurrences[literal.Index()].push_back(i);
+    }
+  }
+
+  // A clause c subsumes a clause d if all the literals of c appear in d. So
+  // we only need to look at the clauses containing the literal of c with the
+  // fewest occurrences.
+  std::vector<bool> is_marked(2 * num_variables_.value(), false);
+  int num_subsumed = 0;
+  for (SatClause* clause : clauses_) {
+    if (clause->IsSubsumptionChecked()) continue;
+    clause->MarkAsSubsumptionChecked();
+    if (!clause->IsAttached()) continue;
+    LiteralIndex best = clause->FirstLiteral().Index();
+    for (const Literal literal : *clause) {
+      is_marked[literal.Index().value()] = true;
+      if (occurrences[literal.Index()].size() < occurrences[best].size()) {
+        best = literal.Index();
+      }
+    }
+    for (const int index : occurrences[best]) {
+      SatClause* other = clauses_[index];
+      if (other == clause || !other->IsAttached() ||
+          other->Size() < clause->Size() || IsClauseUsedAsReason(other)) {
+        continue;
+      }
+      int num_common = 0;
+      for (const Literal literal : *other) {
+        if (is_marked[literal.Index().value()]) ++num_common;
+      }
+      if (num_common == clause->Size()) {
+        if (!other->IsRedundant()) clause->MarkAsNotRedundant();
+        watched_clauses_.LazyDetach(other);
+        ++num_subsumed;
+      }
+    }
+    for (const Literal literal : *clause) {
+      is_marked[literal.Index().value()] = false;
+    }
+  }
+  watched_clauses_.CleanUpWatchers();
+  counters_.num_subsumed_clauses += num_subsumed;
+}
+
+bool SatSolver::VivifyLearnedClauses() {
+  SCOPED_TIME_STAT(&stats_);
+  const int64 max_num_enqueues =
+      trail_.NumberOfEnqueues() +
+      static_cast<int64>(parameters_.vivification_effort() *
+                         (trail_.NumberOfEnqueues() -
+                          num_enqueues_at_last_inprocessing_));
+  std::vector<Literal> old_literals;
+  std::vector<Literal> new_literals;
+  for (int i = 0; i < clauses_.size(); ++i) {
+    if (trail_.NumberOfEnqueues() > max_num_enqueues) break;
+
+    // A decision at level 0 would call ProcessNewlyFixedVariables() which may
+    // reorder clauses_. We do it here and restart the scan. This is fine since
+    // the vivified clauses are marked.
+    if (num_processed_fixed_variables_ < trail_.Index()) {
+      ProcessNewlyFixedVariableResolutionNodes();
+      ProcessNewlyFixedVariables();
+      i = -1;
+      continue;
+    }
+
+    SatClause* clause = clauses_[i];
+    if (!clause->IsRedundant() || !clause->IsAttached() ||
+        clause->IsVivified()) {
+      continue;
+    }
+    clause->MarkAsVivified();
+
+    // Note that a clause with a literal fixed at level zero can only be a
+    // learned clause that was just added. We just skip it.
+    bool skip = false;
+    for (const Literal literal : *clause) {
+      if (trail_.Assignment().IsVariableAssigned(literal.Variable())) {
+        skip = true;
+        break;
+      }
+    }
+    if (skip) continue;
+
+    // Enqueue the negation of the literals one by one. If one literal becomes
+    // true, the literals after it can be removed. If one becomes false, it can
+    // be removed. If there is a conflict, the remaining literals can be
+    // removed. Note that we need a copy of the literals since the propagation
+    // may reorder them.
+    old_literals.assign(clause->begin(), clause->end());
+    new_literals.clear();
+    for (const Literal literal : old_literals) {
+      if (trail_.Assignment().IsLiteralTrue(literal)) {
+        new_literals.push_back(literal);
+        break;
+      }
+      if (trail_.Assignment().IsLiteralFalse(literal)) continue;
+      new_literals.push_back(literal);
+      if (!EnqueueDecisionIfNotConflicting(literal.Negated())) break;
+    }
+    Backtrack(0);
+    if (new_literals.size() == old_literals.size()) continue;
+
+    // Replace the clause by the shorter one.
+    ++counters_.num_vivified_clauses;
+    counters_.num_vivified_literals_removed +=
+        clause->Size() - new_literals.size();
+    const int lbd = std::min<int>(clause->Lbd(), new_literals.size());
+    watched_clauses_.LazyDetach(clause);
+    watched_clauses_.CleanUpWatchers();
+    if (!AddClauseAtLevelZero(new_literals, /*is_redundant=*/true, lbd)) {
+      return false;
+    }
+    if (new_literals.size() > 2 ||
+        !parameters_.treat_binary_clauses_separately()) {
+      clauses_.back()->MarkAsVivified();
+    }
+  }
+  return true;
+}
+
 bool SatSolver::Propagate() {
   SCOPED_TIME_STAT(&stats_);
 
@@ -1499,21 +2184,21 @@ bool SatSolver::Propagate() {
 
 ClauseRef SatSolver::Reason(VariableIndex var) {
   DCHECK(trail_.Assignment().IsVariableAssigned(var));
-  const AssignmentInfo& info = trail_.Info(var);
+  const AssignmentReason& info = trail_.ReasonInfo(var);
   switch (info.type) {
-    case AssignmentInfo::SEARCH_DECISION:
-    case AssignmentInfo::UNIT_REASON:
+    case AssignmentReason::SEARCH_DECISION:
+    case AssignmentReason::UNIT_REASON:
       return ClauseRef();
-    case AssignmentInfo::CLAUSE_PROPAGATION:
+    case AssignmentReason::CLAUSE_PROPAGATION:
       return info.sat_clause->PropagationReason();
-    case AssignmentInfo::BINARY_PROPAGATION: {
+    case AssignmentReason::BINARY_PROPAGATION: {
       const Literal* literal = &info.literal;
       return ClauseRef(literal, literal + 1);
     }
-    case AssignmentInfo::PB_PROPAGATION:
+    case AssignmentReason::PB_PROPAGATION:
       pb_constraints_.ReasonFor(var, trail_.CacheReasonAtReturnedAddress(var));
       return trail_.CachedReason(var);
-    case AssignmentInfo::SYMMETRY_PROPAGATION: {
+    case AssignmentReason::SYMMETRY_PROPAGATION: {
       // TODO(user): Switch to iterative code to avoid possible issue with the
       // depth of the recursion.
       const Literal source = trail_[info.source_trail_index];
@@ -1522,18 +2207,18 @@ ClauseRef SatSolver::Reason(VariableIndex var) {
                                    trail_.CacheReasonAtReturnedAddress(var));
       return trail_.CachedReason(var);
     }
-    case AssignmentInfo::SAME_REASON_AS:
+    case AssignmentReason::SAME_REASON_AS:
       // Note that this should recurse only once.
       return Reason(info.reference_var);
-    case AssignmentInfo::CACHED_REASON:
+    case AssignmentReason::CACHED_REASON:
       return trail_.CachedReason(var);
   }
 }
 
 SatClause* SatSolver::ReasonClauseOrNull(VariableIndex var) const {
   DCHECK(trail_.Assignment().IsVariableAssigned(var));
-  const AssignmentInfo& info = trail_.Info(var);
-  if (info.type == AssignmentInfo::CLAUSE_PROPAGATION) return info.sat_clause;
+  const AssignmentReason& info = trail_.ReasonInfo(var);
+  if (info.type == AssignmentReason::CLAUSE_PROPAGATION) return info.sat_clause;
   return nullptr;
 }
 
@@ -1615,15 +2300,19 @@ void SatSolver::EnqueueNewDecision(Literal literal) {
   decisions_[current_decision_level_] = Decision(trail_.Index(), literal);
   ++current_decision_level_;
   trail_.SetDecisionLevel(current_decision_level_);
-  trail_.Enqueue(literal, AssignmentInfo::SEARCH_DECISION);
+  trail_.Enqueue(literal, AssignmentReason::SEARCH_DECISION);
 }
 
 Literal SatSolver::NextBranch() {
   SCOPED_TIME_STAT(&stats_);
 
-  // Lazily initialize var_ordering_ if needed.
+  // Lazily initialize var_ordering_ (or the VMTF queue) if needed.
   if (!is_var_ordering_initialized_) {
-    InitializeVariableOrdering();
+    if (use_vmtf_) {
+      InitializeVmtfQueue();
+    } else {
+      InitializeVariableOrdering();
+    }
   }
 
   // Choose the variable.
@@ -1631,15 +2320,31 @@ Literal SatSolver::NextBranch() {
   const double ratio = parameters_.random_branches_ratio();
   if (ratio != 0.0 && random_.RandDouble() < ratio) {
     ++counters_.num_random_branches;
-    while (true) {
-      // TODO(user): This may not be super efficient if almost all the
-      // variables are assigned.
-      var = (*var_ordering_.Raw())[random_.Uniform(var_ordering_.Raw()->size())]
-                ->variable;
-      if (!trail_.Assignment().IsVariableAssigned(var)) break;
-      pq_need_update_for_var_at_trail_index_.Set(trail_.Info(var).trail_index);
-      var_ordering_.Remove(&queue_elements_[var]);
+    if (use_vmtf_) {
+      // The VMTF queue contains all the variables, assigned or not.
+      do {
+        var = VariableIndex(random_.Uniform(num_variables_.value()));
+      } while (trail_.Assignment().IsVariableAssigned(var));
+    } else {
+      while (true) {
+        // TODO(user): This may not be super efficient if almost all the
+        // variables are assigned.
+        var = (*var_ordering_.Raw())[random_.Uniform(
+                  var_ordering_.Raw()->size())]->variable;
+        if (!trail_.Assignment().IsVariableAssigned(var)) break;
+        pq_need_update_for_var_at_trail_index_.Set(
+            trail_.Info(var).trail_index);
+        var_ordering_.Remove(&queue_elements_[var]);
+      }
     }
+  } else if (use_vmtf_) {
+    // All the variables after vmtf_search_ are assigned, see its comment.
+    var = vmtf_search_;
+    while (trail_.Assignment().IsVariableAssigned(var)) {
+      var = vmtf_prev_[var];
+      DCHECK_NE(var, kNoVmtfVariable);
+    }
+    vmtf_search_ = var;
   } else {
     // The loop is done this way in order to leave the final choice in the heap.
     DCHECK(!var_ordering_.IsEmpty());
@@ -1738,6 +2443,85 @@ void SatSolver::InitializeVariableOrdering() {
   is_var_ordering_initialized_ = true;
 }
 
+void SatSolver::InitializeVmtfQueue() {
+  SCOPED_TIME_STAT(&stats_);
+  std::vector<VariableIndex> variables;
+  variables.reserve(num_variables_.value());
+  for (VariableIndex var(0); var < num_variables_; ++var) {
+    variables.push_back(var);
+  }
+  switch (parameters_.preferred_variable_order()) {
+    case SatParameters::IN_ORDER:
+      break;
+    case SatParameters::IN_REVERSE_ORDER:
+      std::reverse(variables.begin(), variables.end());
+      break;
+    case SatParameters::IN_RANDOM_ORDER:
+      std::random_shuffle(variables.begin(), variables.end(), random_);
+      break;
+  }
+
+  // Sort by decreasing priority, the preferred order breaking the ties.
+  std::stable_sort(variables.begin(), variables.end(),
+                   [this](VariableIndex a, VariableIndex b) {
+                     if (activities_[a] != activities_[b]) {
+                       return activities_[a] > activities_[b];
+                     }
+                     return queue_elements_[a].tie_breaker >
+                            queue_elements_[b].tie_breaker;
+                   });
+
+  // The first variable to branch on must be at the end of the list.
+  vmtf_first_ = kNoVmtfVariable;
+  vmtf_last_ = kNoVmtfVariable;
+  for (int i = variables.size() - 1; i >= 0; --i) {
+    const VariableIndex var = variables[i];
+    vmtf_prev_[var] = vmtf_last_;
+    vmtf_next_[var] = kNoVmtfVariable;
+    if (vmtf_last_ == kNoVmtfVariable) {
+      vmtf_first_ = var;
+    } else {
+      vmtf_next_[vmtf_last_] = var;
+    }
+    vmtf_last_ = var;
+    vmtf_stamps_[var] = vmtf_next_stamp_++;
+  }
+  vmtf_search_ = vmtf_last_;
+  is_var_ordering_initialized_ = true;
+}
+
+void SatSolver::BumpVmtfVariables(std::vector<VariableIndex>* variables) {
+  SCOPED_TIME_STAT(&stats_);
+  std::sort(variables->begin(), variables->end(),
+            [this](VariableIndex a, VariableIndex b) {
+              return vmtf_stamps_[a] < vmtf_stamps_[b];
+            });
+  for (const VariableIndex var : *variables) {
+    if (var == vmtf_last_) continue;
+
+    // Unlink var. Note that it has a successor since it is not the last one,
+    // and that all the variables after this successor are still assigned.
+    const VariableIndex prev = vmtf_prev_[var];
+    const VariableIndex next = vmtf_next_[var];
+    if (prev == kNoVmtfVariable) {
+      vmtf_first_ = next;
+    } else {
+      vmtf_next_[prev] = next;
+    }
+    vmtf_prev_[next] = prev;
+    if (vmtf_search_ == var) vmtf_search_ = next;
+
+    // Move it to the front.
+    vmtf_prev_[var] = vmtf_last_;
+    vmtf_next_[var] = kNoVmtfVariable;
+    vmtf_next_[vmtf_last_] = var;
+    vmtf_last_ = var;
+    vmtf_stamps_[var] = vmtf_next_stamp_++;
+    if (!trail_.Assignment().IsVariableAssigned(var)) vmtf_search_ = var;
+  }
+  variables->clear();
+}
+
 void SatSolver::ResetDecisionHeuristic() {
   DCHECK(!is_model_unsat_);
 
@@ -1769,8 +2553,11 @@ void SatSolver::UntrailWithoutPQUpdate(int target_trail_index) {
     const VariableIndex var = literal.Variable();
     polarity_[var].SetLastAssignmentValue(literal.IsPositive());
 
-    // We check that the priority queue doesn't need to be updated.
-    if (DEBUG_MODE && is_var_ordering_initialized_) {
+    // The VMTF queue must always be updated. Otherwise, we check that the
+    // priority queue doesn't need to be updated.
+    if (use_vmtf_ && is_var_ordering_initialized_) {
+      UpdateVmtfSearchOnUnassign(var);
+    } else if (DEBUG_MODE && is_var_ordering_initialized_) {
       DCHECK(var_ordering_.Contains(&(queue_elements_[var])));
       DCHECK_EQ(activities_[var], queue_elements_[var].weight);
     }
@@ -1788,6 +2575,10 @@ void SatSolver::Untrail(int target_trail_index) {
     const Literal literal = trail_.Dequeue();
     const VariableIndex var = literal.Variable();
     polarity_[var].SetLastAssignmentValue(literal.IsPositive());
+    if (use_vmtf_) {
+      UpdateVmtfSearchOnUnassign(var);
+      continue;
+    }
 
     // Update the priority queue if needed.
     // Note that the first test is just here for optimization, and that the
@@ -1857,27 +2648,27 @@ ResolutionNode* SatSolver::CreateRootResolutionNode() {
 ResolutionNode* SatSolver::ResolutionNodeForAssignment(
     VariableIndex var) const {
   ResolutionNode* node = nullptr;
-  const AssignmentInfo& info = trail_.Info(var);
+  const AssignmentReason& info = trail_.ReasonInfo(var);
   switch (trail_.InitialAssignmentType(var)) {
-    case AssignmentInfo::CLAUSE_PROPAGATION:
+    case AssignmentReason::CLAUSE_PROPAGATION:
       CHECK(info.sat_clause != nullptr);
       node = info.sat_clause->ResolutionNodePointer();
       break;
-    case AssignmentInfo::UNIT_REASON:
-      node = info.resolution_node;
+    case AssignmentReason::UNIT_REASON:
+      node = trail_.UnitResolutionNode(var);
       break;
-    case AssignmentInfo::PB_PROPAGATION:
+    case AssignmentReason::PB_PROPAGATION:
       CHECK(info.pb_constraint != nullptr);
       node = info.pb_constraint->ResolutionNodePointer();
       break;
-    case AssignmentInfo::SAME_REASON_AS:
+    case AssignmentReason::SAME_REASON_AS:
       // There should be only one recursion level.
       return ResolutionNodeForAssignment(info.reference_var);
       break;
-    case AssignmentInfo::CACHED_REASON:
-    case AssignmentInfo::SEARCH_DECISION:
-    case AssignmentInfo::BINARY_PROPAGATION:
-    case AssignmentInfo::SYMMETRY_PROPAGATION:
+    case AssignmentReason::CACHED_REASON:
+    case AssignmentReason::SEARCH_DECISION:
+    case AssignmentReason::BINARY_PROPAGATION:
+    case AssignmentReason::SYMMETRY_PROPAGATION:
       LOG(FATAL) << "This shouldn't happen";
       break;
   }
@@ -1961,6 +2752,7 @@ void SatSolver::ComputeFirstUIPConflict(
   int num_literal_at_highest_level_that_needs_to_be_processed = 0;
   while (true) {
     int num_new_vars = 0;
+    counters_.num_conflict_analysis_literals += clause_to_expand.size();
     for (const Literal literal : clause_to_expand) {
       const VariableIndex var = literal.Variable();
       if (!is_marked_[var]) {
@@ -2096,7 +2888,7 @@ void SatSolver::ComputePBConflict(int max_trail_index,
       }
 
       // We can't abort, So resolve the current variable.
-      DCHECK_NE(trail_.Info(var).type, AssignmentInfo::SEARCH_DECISION);
+      DCHECK_NE(trail_.ReasonInfo(var).type, AssignmentReason::SEARCH_DECISION);
       const bool clause_used = ResolvePBConflict(var, conflict, &slack);
 
       // At this point, we have a negative slack. Note that ReduceCoefficients()
@@ -2259,6 +3051,7 @@ void SatSolver::MinimizeConflictSimple(std::vector<Literal>* conflict) {
     if (DecisionLevel(var) != current_level) {
       // It is important not to call Reason(var) when it can be avoided.
       const ClauseRef reason = Reason(var);
+      counters_.num_minimization_literals += reason.size();
       if (!reason.IsEmpty()) {
         can_be_removed = true;
         for (Literal literal : reason) {
@@ -2379,6 +3172,7 @@ bool SatSolver::CanBeInferedFromConflictVariables(VariableIndex variable) {
 
   // First we expand the reason for the given variable.
   DCHECK(!Reason(variable).IsEmpty());
+  counters_.num_minimization_literals += Reason(variable).size();
   for (Literal literal : Reason(variable)) {
     const VariableIndex var = literal.Variable();
     DCHECK_NE(var, variable);
@@ -2440,6 +3234,7 @@ bool SatSolver::CanBeInferedFromConflictVariables(VariableIndex variable) {
     dfs_stack_.push_back(current_var);
     bool abort_early = false;
     DCHECK(!Reason(current_var).IsEmpty());
+    counters_.num_minimization_literals += Reason(current_var).size();
     for (Literal literal : Reason(current_var)) {
       const VariableIndex var = literal.Variable();
       DCHECK_NE(var, current_var);
@@ -2605,6 +3400,8 @@ void SatSolver::CleanClauseDatabaseIfNeeded() {
 
   // Start by removing all the detached clauses (if any).
   DeleteDetachedClauses();
+  ++counters_.num_clause_cleanups;
+  counters_.num_clause_cleanup_clauses += clauses_.size();
 
   // Move the clause that should be kept at the beginning and sort the other
   // using the specified clause ordering.
@@ -2630,10 +3427,23 @@ void SatSolver::CleanClauseDatabaseIfNeeded() {
       }
     }
     watched_clauses_.CleanUpWatchers();
-    STLDeleteContainerPointers(first_clause_to_delete, clauses_.end());
+    for (auto iter = first_clause_to_delete; iter < clauses_.end(); ++iter) {
+      if (drat_writer_ != nullptr) {
+        drat_writer_->DeleteClause(ClauseRef((*iter)->begin(), (*iter)->end()));
+      }
+      clause_arena_.Free(*iter);
+    }
     clauses_.erase(first_clause_to_delete, clauses_.end());
   }
+
+  // The tier2 clauses not used until one of the next cleanups will become
+  // deletable.
+  if (parameters_.clause_cleanup_tier2_lbd_bound() >
+      parameters_.clause_cleanup_lbd_bound()) {
+    for (SatClause* clause : clauses_) clause->DecreaseUsage();
+  }
   InitLearnedClauseLimit(clauses_.end() - clause_to_keep_end);
+  CompactClauseArenaIfNeeded();
 }
 
 void SatSolver::InitRestart() {
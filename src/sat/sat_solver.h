@@ -33,6 +33,7 @@
 #include "base/random.h"
 #include "sat/pb_constraint.h"
 #include "sat/clause.h"
+#include "sat/drat_writer.h"
 #include "sat/sat_base.h"
 #include "sat/sat_parameters.pb.h"
 #include "sat/symmetry.h"
@@ -127,6 +128,14 @@ class SatSolver {
     }
   }
 
+  // Makes the solver write a DRAT proof of all the learned and deleted clauses
+  // to the given writer (not owned). This should be called before any clause is
+  // added, and the proof is only valid for a pure CNF problem (no linear
+  // constraints, no symmetries, no clauses imported with
+  // AddLearnedClauseFromOtherSolver()). Contrary to the unsat_proof()
+  // parameter, this has almost no memory overhead but can't compute cores.
+  void SetDratWriter(DratWriter* drat_writer) { drat_writer_ = drat_writer; }
+
   // Advanced usage. This is only relevant when trying to compute an unsat core.
   // All the constraints added by one of the Add*() function above when this was
   // set to true will be considered for the core. All the others will just be
@@ -189,15 +198,25 @@ class SatSolver {
   // specific api.
   Status SolveWithTimeLimit(TimeLimit* time_limit);
 
+  // Same as Solve(), but the search also stops with a LIMIT_REACHED status
+  // after the given number of new conflicts. Compared to changing
+  // max_number_of_conflicts() with SetParameters(), this doesn't reset the
+  // search heuristics, so it can be used to interleave the search with some
+  // other work (like exchanging learned clauses with other solvers).
+  Status SolveWithConflictLimit(int64 max_number_of_conflicts);
+
   // Simple interface to solve a problem under the given assumptions. This
   // simply ask the solver to solve a problem given a set of variables fixed to
   // a given value (the assumptions). Compared to simply calling AddUnitClause()
   // and fixing the variables once and for all, this allow to backtrack over the
   // assumptions and thus exploit the incrementally between subsequent solves.
   //
-  // This function backtrack over all the current decision, tries to enqueue the
-  // given assumptions, sets the assumption level accordingly and finally calls
-  // Solve().
+  // This function backtrack over all the current decisions that are not a
+  // prefix of the given assumptions, tries to enqueue the remaining ones, sets
+  // the assumption level accordingly and finally calls Solve(). Keeping the
+  // common prefix avoids propagating it again, which matters when this is
+  // called many times with similar assumptions (like in the core-based
+  // optimization algorithms).
   //
   // If, given these assumptions, the model is UNSAT, this returns the
   // ASSUMPTIONS_UNSAT status. MODEL_UNSAT is reserved for the case where the
@@ -207,6 +226,22 @@ class SatSolver {
   // assumptions by calling GetLastIncompatibleDecisions().
   Status ResetAndSolveWithGivenAssumptions(const std::vector<Literal>& assumptions);
 
+  // Clause groups. A group is identified by a fresh "activation" literal a, and
+  // each clause c added to the group is stored as (c or not(a)). The clauses of
+  // a group are thus only enforced when a is among the assumptions given to
+  // ResetAndSolveWithGivenAssumptions() (or if the solver chooses to set it to
+  // true). Note that the learned clauses derived from a group will also contain
+  // not(a).
+  //
+  // DisableClauseGroup() permanently fixes a to false. The clauses of the group
+  // and the learned clauses depending on it are then all satisfied at level
+  // zero and are deleted right away. Like the other Add*() functions, these
+  // backtrack to level zero and return false if the model is UNSAT.
+  Literal NewClauseGroup();
+  bool AddClauseToGroup(Literal activation_literal,
+                        const std::vector<Literal>& literals);
+  bool DisableClauseGroup(Literal activation_literal);
+
   // Changes the assumption level. All the decisions below this level will be
   // treated as assumptions by the next Solve(). Note that this may impact some
   // heuristics, like the LBD value of a clause.
@@ -310,6 +345,23 @@ class SatSolver {
   const std::vector<BinaryClause>& NewlyAddedBinaryClauses();
   void ClearNewlyAddedBinaryClauses();
 
+  // Functions to export the learned clauses to another solver of a portfolio.
+  // Only the clauses of size at least 2 learned after a call to
+  // SetLearnedClauseExportLimits() with a size <= max_size and a LBD <= max_lbd
+  // are exported. A max_size of 0 disables the export (this is the default).
+  void SetLearnedClauseExportLimits(int max_size, int max_lbd);
+  const std::vector<std::vector<Literal>>& NewlyLearnedClausesToExport() const {
+    return learned_clauses_to_export_;
+  }
+  void ClearNewlyLearnedClausesToExport() { learned_clauses_to_export_.clear(); }
+
+  // Adds a clause learned by another solver working on the same problem. The
+  // clause is added as a redundant one, so it can be deleted during a clause
+  // cleanup, and it doesn't count as a constraint of the problem. This must be
+  // called at decision level 0 and is not compatible with the unsat_proof
+  // parameter. Returns false if the problem is detected to be UNSAT.
+  bool AddLearnedClauseFromOtherSolver(const std::vector<Literal>& literals);
+
   // Various getters of the current solver state.
   struct Decision {
     Decision() : trail_index(-1) {}
@@ -332,6 +384,21 @@ class SatSolver {
   // in seconds.
   double deterministic_time() const;
 
+  // A breakdown of the work done by the solver per phase of the search, in the
+  // same unit as deterministic_time(). The underlying counters are always
+  // maintained since they are just a few additions per conflict, so this can
+  // be used to tune the clause cleanup and restart parameters of a workload.
+  // Note that only the propagation part is used by the deterministic time
+  // limit.
+  struct WorkBreakdown {
+    double propagation;
+    double conflict_analysis;
+    double minimization;
+    double clause_cleanup;
+    double restarts;
+  };
+  WorkBreakdown work_breakdown() const;
+
   // Only used for debugging. Save the current assignment in debug_assignment_.
   // The idea is that if we know that a given assignment is satisfiable, then
   // all the learned clauses or PB constraints must be satisfiable by it. In
@@ -345,8 +412,9 @@ class SatSolver {
   // conflict and returns false.
   bool PropagateAndStopAfterOneConflictResolution();
 
-  // All Solve() functions end up calling this one.
-  Status SolveInternal(TimeLimit* time_limit);
+  // All Solve() functions end up calling this one. The given conflict limit
+  // is relative to the number of conflicts at the beginning of this call.
+  Status SolveInternal(TimeLimit* time_limit, int64 max_number_of_conflicts);
 
   // Adds a binary clause to the BinaryImplicationGraph and to the
   // BinaryClauseManager when track_binary_clauses_ is true.
@@ -433,15 +501,20 @@ class SatSolver {
   // happen just after a restart, the logic will not change.
   bool IsClauseUsedAsReason(SatClause* clause) const {
     const VariableIndex var = clause->PropagatedLiteral().Variable();
-    return trail_.Info(var).type == AssignmentInfo::CLAUSE_PROPAGATION &&
-           trail_.Info(var).sat_clause == clause;
+    return trail_.ReasonInfo(var).type ==
+               AssignmentReason::CLAUSE_PROPAGATION &&
+           trail_.ReasonInfo(var).sat_clause == clause;
   }
 
-  // Predicate used by CleanClauseDatabaseIfNeeded().
+  // Predicate used by CleanClauseDatabaseIfNeeded(). The kept redundant
+  // clauses are the "core" ones (small LBD), which are kept forever, and the
+  // "tier2" ones (medium LBD), which are kept as long as they are used.
   bool ClauseShouldBeKept(SatClause* clause) const {
     return !clause->IsRedundant() ||
            clause->Lbd() <= parameters_.clause_cleanup_lbd_bound() ||
-           clause->Size() <= 2 || IsClauseUsedAsReason(clause);
+           clause->Size() <= 2 || IsClauseUsedAsReason(clause) ||
+           (clause->Lbd() <= parameters_.clause_cleanup_tier2_lbd_bound() &&
+            clause->IsUsed());
   }
 
   // Add a problem clause. Not that the clause is assumed to be "cleaned", that
@@ -486,12 +559,58 @@ class SatSolver {
   // Deletes all the clauses that are detached.
   void DeleteDetachedClauses();
 
+  // Simplifies the clause database at level 0, see the inprocessing
+  // parameters. Returns false if the problem is proved to be UNSAT.
+  bool Inprocess();
+
+  // Runs a bounded local search on the problem clauses, seeded by the current
+  // polarities, and uses the best assignment found as the new polarities of
+  // the unassigned variables. See local_search_rephasing_period_in_conflicts.
+  void RephaseWithLocalSearch();
+
+  // Detects the equivalent literals with the binary implication graph and
+  // replaces each literal by its representative in all the clauses. Returns
+  // false if the problem is proved to be UNSAT.
+  bool SubstituteEquivalentLiterals();
+
+  // Uses the clauses not already processed to delete the clauses they subsume.
+  void BackwardSubsumption();
+
+  // Tries to shorten the learned clauses not already vivified. Returns false if
+  // the problem is proved to be UNSAT.
+  bool VivifyLearnedClauses();
+
+  // Adds a clause, implied by the current ones, at level 0. None of its
+  // literals must be assigned. This also propagates the new clause and returns
+  // false if the problem is proved to be UNSAT.
+  bool AddClauseAtLevelZero(const std::vector<Literal>& literals, bool is_redundant,
+                            int lbd);
+
+  // Moves all the clauses contiguously in memory if enough of the clause_arena_
+  // memory is wasted by deleted clauses, and updates all the references to
+  // them. This must be called when the watchers are clean.
+  void CompactClauseArenaIfNeeded();
+
   // Simplifies the problem when new variables are assigned at level 0.
   void ProcessNewlyFixedVariables();
 
   // Compute an initial variable ordering.
   void InitializeVariableOrdering();
 
+  // Same as InitializeVariableOrdering() for the VMTF queue. The variables are
+  // linked by decreasing activity so that the queue starts in the order the
+  // priority queue would have used.
+  void InitializeVmtfQueue();
+
+  // Moves the given variables to the front of the VMTF queue, preserving their
+  // relative order.
+  void BumpVmtfVariables(std::vector<VariableIndex>* variables);
+
+  // Updates the VMTF search cursor when a variable is unassigned.
+  void UpdateVmtfSearchOnUnassign(VariableIndex var) {
+    if (vmtf_stamps_[var] > vmtf_stamps_[vmtf_search_]) vmtf_search_ = var;
+  }
+
   // Returns the maximum trail_index of the literals in the given clause.
   // All the literals must be assigned. Returns -1 if the clause is empty.
   int ComputeMaxTrailIndex(ClauseRef clause) const;
@@ -573,6 +692,15 @@ class SatSolver {
   // backtrack level to call Backtrack() with.
   int ComputeBacktrackLevel(const std::vector<Literal>& literals);
 
+  // Returns the level to backtrack to before adding the given learned clause.
+  // This is ComputeBacktrackLevel(), unless chronological backtracking is
+  // enabled and the jump is longer than the threshold, in which case we only
+  // backtrack below the level of the first literal. The learned clause is
+  // unit at any level in between, so the trail and the watchers invariants
+  // hold as usual; the propagated literal just gets a higher level than the
+  // smallest possible one.
+  int ComputeConflictBacktrackLevel(const std::vector<Literal>& literals);
+
   // The LBD (Literal Blocks Distance) is the number of different decision
   // levels at which the literals of the clause were assigned. This can only be
   // computed if all the literals of the clause are assigned. Note that we
@@ -632,14 +760,14 @@ class SatSolver {
   // The number of constraints of the initial problem that where added.
   int num_constraints_;
 
-  // All the clauses managed by the solver (initial and learned). This vector
-  // has ownership of the pointers. We currently do not use
-  // std::unique_ptr<SatClause> because it can't be used with some STL
-  // algorithms like std::partition.
+  // All the clauses managed by the solver (initial and learned). Their memory
+  // is owned by clause_arena_, so a clause removed from this vector must be
+  // freed with clause_arena_.Free().
   //
   // Note that the unit clauses are not kept here and if the parameter
   // treat_binary_clauses_separately is true, the binary clause are not kept
   // here either.
+  ClauseArena clause_arena_;
   std::vector<SatClause*> clauses_;
 
   // Observers of literals.
@@ -652,6 +780,19 @@ class SatSolver {
   bool track_binary_clauses_;
   BinaryClauseManager binary_clauses_;
 
+  // The number of conflicts at which the next inprocessing can happen, and the
+  // number of enqueues on the trail at the end of the last one.
+  int64 next_inprocessing_num_failures_;
+  int64 num_enqueues_at_last_inprocessing_;
+
+  // The number of conflicts at which the next rephasing can happen.
+  int64 next_rephasing_num_failures_;
+
+  // The learned clauses to export, see SetLearnedClauseExportLimits().
+  int export_max_clause_size_;
+  int export_max_lbd_;
+  std::vector<std::vector<Literal>> learned_clauses_to_export_;
+
   // The solver trail.
   Trail trail_;
 
@@ -700,6 +841,26 @@ class SatSolver {
     int64 num_literals_learned;
     int64 num_literals_forgotten;
     int64 num_subsumed_clauses;
+    int64 num_chronological_backtracks;
+    int64 num_variable_ordering_switches;
+
+    // Inprocessing stats.
+    int64 num_inprocessings;
+    int64 num_vivified_clauses;
+    int64 num_vivified_literals_removed;
+    int64 num_equivalent_variables;  // At the last inprocessing.
+    int64 num_substituted_clauses;
+
+    // Local search rephasing stats.
+    int64 num_rephasings;
+    int64 num_local_search_flips;
+
+    // Work done by each phase of the search, see work_breakdown().
+    int64 num_conflict_analysis_literals;
+    int64 num_minimization_literals;
+    int64 num_clause_cleanups;
+    int64 num_clause_cleanup_clauses;
+    int64 num_restart_untrailed_literals;
 
     Counters()
         : num_branches(0),
@@ -710,10 +871,29 @@ class SatSolver {
           num_learned_pb_literals_(0),
           num_literals_learned(0),
           num_literals_forgotten(0),
-          num_subsumed_clauses(0) {}
+          num_subsumed_clauses(0),
+          num_chronological_backtracks(0),
+          num_variable_ordering_switches(0),
+          num_inprocessings(0),
+          num_vivified_clauses(0),
+          num_vivified_literals_removed(0),
+          num_equivalent_variables(0),
+          num_substituted_clauses(0),
+          num_rephasings(0),
+          num_local_search_flips(0),
+          num_conflict_analysis_literals(0),
+          num_minimization_literals(0),
+          num_clause_cleanups(0),
+          num_clause_cleanup_clauses(0),
+          num_restart_untrailed_literals(0) {}
   };
   Counters counters_;
 
+  // The counters at the start of the current solve, to publish the metrics of
+  // this solve. See util/metrics.h.
+  Counters counters_at_solve_start_;
+  int64 num_propagations_at_solve_start_;
+
   // Solver information.
   WallTimer timer_;
 
@@ -782,6 +962,25 @@ class SatSolver {
   // or we need to notify that its priority has changed.
   Bitset64<int64> pq_need_update_for_var_at_trail_index_;
 
+  // The VMTF alternative to var_ordering_, used when use_vmtf_ is true (see
+  // SatParameters::VMTF). In this case is_var_ordering_initialized_ refers to
+  // this queue instead of the priority queue.
+  //
+  // The variables form a doubly linked list sorted by increasing stamp, the
+  // time at which they were last moved to the front. vmtf_last_ is the most
+  // recently bumped variable. All the variables after vmtf_search_ in the list
+  // are assigned, so NextBranch() only has to walk backward from it, and an
+  // unassigned variable just needs to be compared with it.
+  bool use_vmtf_;
+  ITIVector<VariableIndex, VariableIndex> vmtf_prev_;
+  ITIVector<VariableIndex, VariableIndex> vmtf_next_;
+  ITIVector<VariableIndex, int64> vmtf_stamps_;
+  VariableIndex vmtf_first_;
+  VariableIndex vmtf_last_;
+  VariableIndex vmtf_search_;
+  int64 vmtf_next_stamp_;
+  std::vector<VariableIndex> vmtf_bumped_variables_;
+
   // Increment used to bump the variable activities.
   double variable_activity_increment_;
   double clause_activity_increment_;
@@ -844,6 +1043,9 @@ class SatSolver {
   // This is only used is parameters_.unsat_proof() is true.
   UnsatProof unsat_proof_;
 
+  // If not null, all the clause additions and deletions are written there.
+  DratWriter* drat_writer_;
+
   // A random number generator.
   mutable MTRandom random_;
 
@@ -13,6 +13,11 @@
 
 #include "sat/simplification.h"
 
+#include <algorithm>
+#include <memory>
+
+#include "base/callback.h"
+#include "base/threadpool.h"
 #include "base/timer.h"
 #include "algorithms/dynamic_partition.h"
 
@@ -653,15 +658,288 @@ class PropagationGraph {
   DISALLOW_COPY_AND_ASSIGN(PropagationGraph);
 };
 
+namespace {
+// Copies the clauses extracted from a SatSolver (see
+// SatSolver::ExtractClauses()).
+class ClauseCollector {
+ public:
+  void AddBinaryClause(Literal a, Literal b) {
+    clauses_.push_back({a, b});
+  }
+  void AddClause(ClauseRef clause) {
+    clauses_.push_back(std::vector<Literal>(clause.begin(), clause.end()));
+  }
+  const std::vector<std::vector<Literal>>& clauses() const { return clauses_; }
+
+ private:
+  std::vector<std::vector<Literal>> clauses_;
+};
+
+// Failed-literal probing of a subset of the variables. Each worker probes the
+// variables v with v % num_workers == worker_id on its own solver, which is a
+// copy of the clauses and fixed literals of the probed solver (or the probed
+// solver itself if there is only one worker).
+//
+// Both polarities of each variable x are probed: a literal that leads to a
+// conflict is fixed to false (through the conflict analysis), a literal
+// propagated by both x and not(x) is fixed to true, and x is equivalent to
+// not(m) if x propagates not(m) and not(x) propagates m.
+class ProbingWorker {
+ public:
+  ProbingWorker(int worker_id, int num_workers, double deterministic_time_limit,
+                SatSolver* solver)
+      : worker_id_(worker_id),
+        num_workers_(num_workers),
+        deterministic_time_limit_(deterministic_time_limit),
+        solver_(solver),
+        unsat_(false) {}
+
+  // Only needed when the worker doesn't probe the original solver.
+  void SetProblem(int num_variables, const SatParameters& parameters,
+                  const std::vector<Literal>* fixed_literals,
+                  const std::vector<std::vector<Literal>>* clauses) {
+    owned_solver_.reset(new SatSolver());
+    solver_ = owned_solver_.get();
+    num_variables_ = num_variables;
+    parameters_ = parameters;
+    fixed_literals_ = fixed_literals;
+    clauses_ = clauses;
+  }
+
+  void Run() {
+    if (owned_solver_ != nullptr && !LoadProblem()) {
+      unsat_ = true;
+      return;
+    }
+    const double limit =
+        solver_->deterministic_time() + deterministic_time_limit_;
+    const int num_variables = solver_->NumVariables();
+    propagated_.assign(2 * num_variables, false);
+    for (VariableIndex var(worker_id_); var < num_variables;
+         var += num_workers_) {
+      if (solver_->deterministic_time() > limit) break;
+      if (!ProbeVariable(var)) {
+        unsat_ = true;
+        return;
+      }
+    }
+    solver_->Backtrack(0);
+  }
+
+  bool unsat() const { return unsat_; }
+  const SatSolver& solver() const { return *solver_; }
+  // Pairs of equivalent literals.
+  const std::vector<std::pair<Literal, Literal>>& equivalences() const {
+    return equivalences_;
+  }
+
+ private:
+  bool LoadProblem() {
+    solver_->SetParameters(parameters_);
+    solver_->SetNumVariables(num_variables_);
+    for (const Literal l : *fixed_literals_) {
+      if (!solver_->AddUnitClause(l)) return false;
+    }
+    for (const std::vector<Literal>& clause : *clauses_) {
+      if (!solver_->AddProblemClause(clause)) return false;
+    }
+    return true;
+  }
+
+  // Enqueues l and returns the literals it propagates in propagated_list_,
+  // marked in propagated_. Returns false if l is now fixed at level 0.
+  bool Propagate(Literal l) {
+    solver_->Backtrack(0);
+    if (solver_->Assignment().IsLiteralAssigned(l)) return false;
+    const int trail_index = solver_->LiteralTrail().Index();
+    solver_->EnqueueDecisionAndBackjumpOnConflict(l);
+    if (solver_->CurrentDecisionLevel() == 0) return false;
+    // Note that the +1 is to skip l itself.
+    for (int i = trail_index + 1; i < solver_->LiteralTrail().Index(); ++i) {
+      const Literal m = solver_->LiteralTrail()[i];
+      propagated_[m.Index()] = true;
+      propagated_list_.push_back(m);
+    }
+    return true;
+  }
+
+  // Returns false if the problem is UNSAT.
+  bool ProbeVariable(VariableIndex var) {
+    const Literal x(var, true);
+    for (const Literal m : propagated_list_) propagated_[m.Index()] = false;
+    propagated_list_.clear();
+    if (!Propagate(x)) return !solver_->IsModelUnsat();
+
+    // The literals propagated by not(x) are not marked, the ones of x are.
+    solver_->Backtrack(0);
+    const int trail_index = solver_->LiteralTrail().Index();
+    if (solver_->Assignment().IsLiteralAssigned(x)) return true;
+    solver_->EnqueueDecisionAndBackjumpOnConflict(x.Negated());
+    if (solver_->CurrentDecisionLevel() == 0) return !solver_->IsModelUnsat();
+    units_.clear();
+    for (int i = trail_index + 1; i < solver_->LiteralTrail().Index(); ++i) {
+      const Literal m = solver_->LiteralTrail()[i];
+      if (propagated_[m.Index()]) {
+        units_.push_back(m);
+      } else if (propagated_[m.NegatedIndex()]) {
+        equivalences_.push_back(std::make_pair(x, m.Negated()));
+      }
+    }
+    solver_->Backtrack(0);
+    for (const Literal m : units_) {
+      if (!solver_->AddUnitClause(m)) return false;
+    }
+    return true;
+  }
+
+  const int worker_id_;
+  const int num_workers_;
+  const double deterministic_time_limit_;
+  SatSolver* solver_;
+  std::unique_ptr<SatSolver> owned_solver_;
+  int num_variables_;
+  SatParameters parameters_;
+  const std::vector<Literal>* fixed_literals_;
+  const std::vector<std::vector<Literal>>* clauses_;
+  bool unsat_;
+
+  ITIVector<LiteralIndex, bool> propagated_;
+  std::vector<Literal> propagated_list_;
+  std::vector<Literal> units_;
+  std::vector<std::pair<Literal, Literal>> equivalences_;
+
+  DISALLOW_COPY_AND_ASSIGN(ProbingWorker);
+};
+
+// Makes solver UNSAT, which must have at least one variable.
+void MakeUnsat(SatSolver* solver) {
+  const Literal l(VariableIndex(0), true);
+  if (solver->AddUnitClause(l)) solver->AddUnitClause(l.Negated());
+}
+
+LiteralIndex FindRepresentative(LiteralIndex index,
+                                ITIVector<LiteralIndex, LiteralIndex>* parent) {
+  LiteralIndex root = index;
+  while ((*parent)[root] != root) root = (*parent)[root];
+  while ((*parent)[index] != root) {
+    const LiteralIndex next = (*parent)[index];
+    (*parent)[index] = root;
+    index = next;
+  }
+  return root;
+}
+
+// Merges the classes of a and b, the representative of a class being its
+// smallest literal index. Since a and b are always merged together with
+// not(a) and not(b), the representative of not(l) is not(representative(l)).
+void MergeLiterals(LiteralIndex a, LiteralIndex b,
+                   ITIVector<LiteralIndex, LiteralIndex>* parent) {
+  const LiteralIndex root_a = FindRepresentative(a, parent);
+  const LiteralIndex root_b = FindRepresentative(b, parent);
+  if (root_a < root_b) {
+    (*parent)[root_b] = root_a;
+  } else if (root_b < root_a) {
+    (*parent)[root_a] = root_b;
+  }
+}
+}  // namespace
+
 void ProbeAndFindEquivalentLiteral(
     SatSolver* solver, SatPostsolver* postsolver,
     ITIVector<LiteralIndex, LiteralIndex>* mapping) {
   solver->Backtrack(0);
   mapping->clear();
-  const int num_already_fixed_vars = solver->LiteralTrail().Index();
+  const int num_variables = solver->NumVariables();
+  const int num_workers =
+      std::max(1, std::min(solver->parameters().presolve_probing_num_threads(),
+                           num_variables));
+  const double time_limit_per_worker =
+      solver->parameters().presolve_probing_deterministic_time_limit() /
+      num_workers;
+
+  // With more than one worker, each one probes its own copy of the clauses.
+  // Note that only the clauses are copied, so the workers may derive less on
+  // problems with other constraints, but what they derive is always valid.
+  std::vector<Literal> fixed_literals;
+  ClauseCollector collector;
+  if (num_workers > 1) {
+    solver->ExtractClauses(&collector);
+    for (int i = 0; i < solver->LiteralTrail().Index(); ++i) {
+      fixed_literals.push_back(solver->LiteralTrail()[i]);
+    }
+  }
+  std::vector<std::unique_ptr<ProbingWorker>> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(
+        new ProbingWorker(i, num_workers, time_limit_per_worker, solver));
+    if (num_workers > 1) {
+      workers.back()->SetProblem(num_variables, solver->parameters(),
+                                 &fixed_literals, &collector.clauses());
+    }
+  }
+  if (num_workers == 1) {
+    workers[0]->Run();
+  } else {
+    ThreadPool pool("SatProbing", num_workers);
+    for (int i = 0; i < num_workers; ++i) {
+      pool.Add(NewCallback(workers[i].get(), &ProbingWorker::Run));
+    }
+    pool.StartWorkers();
+  }
+
+  // Merges the fixed literals.
+  for (const std::unique_ptr<ProbingWorker>& worker : workers) {
+    if (worker->unsat()) {
+      MakeUnsat(solver);
+      return;
+    }
+    if (worker->solver().NumVariables() != num_variables) continue;
+    const Trail& trail = worker->solver().LiteralTrail();
+    for (int i = 0; i < trail.Index(); ++i) {
+      if (solver->Assignment().IsLiteralAssigned(trail[i])) continue;
+      if (!solver->AddUnitClause(trail[i])) return;
+    }
+  }
+  // Merges the equivalences between literals that are still not fixed.
+  ITIVector<LiteralIndex, LiteralIndex> parent;
+  for (LiteralIndex index(0); index < 2 * num_variables; ++index) {
+    parent.push_back(index);
+  }
+  bool has_equivalence = false;
+  for (const std::unique_ptr<ProbingWorker>& worker : workers) {
+    for (const std::pair<Literal, Literal>& p : worker->equivalences()) {
+      if (solver->Assignment().IsVariableAssigned(p.first.Variable())) continue;
+      if (solver->Assignment().IsVariableAssigned(p.second.Variable())) {
+        continue;
+      }
+      MergeLiterals(p.first.Index(), p.second.Index(), &parent);
+      MergeLiterals(p.first.NegatedIndex(), p.second.NegatedIndex(), &parent);
+      has_equivalence = true;
+    }
+  }
+  if (!has_equivalence) return;
 
-  // Currently, this is not supported in the open-source version because we
-  // need to open source the strongly connected component algo first.
+  for (LiteralIndex index(0); index < 2 * num_variables; ++index) {
+    mapping->push_back(FindRepresentative(index, &parent));
+  }
+  for (VariableIndex var(0); var < num_variables; ++var) {
+    const Literal l(var, true);
+    const Literal representative((*mapping)[l.Index()]);
+    if (representative.Variable() == var) {
+      if (representative != l) {
+        // l is equivalent to not(l).
+        MakeUnsat(solver);
+        mapping->clear();
+        return;
+      }
+      continue;
+    }
+    // During postsolve, l takes the value of its representative.
+    std::vector<Literal> clause = {l, representative.Negated()};
+    postsolver->Add(l, &clause);
+    clause = {l.Negated(), representative};
+    postsolver->Add(l.Negated(), &clause);
+  }
 }
 
 }  // namespace sat
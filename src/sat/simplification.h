@@ -268,9 +268,13 @@ bool SimplifyClause(const std::vector<Literal>& a, std::vector<Literal>* b,
 bool ComputeResolvant(Literal x, const std::vector<Literal>& a,
                       const std::vector<Literal>& b, std::vector<Literal>* out);
 
-// Presolver that does literals probing and finds equivalent literals by
-// computing the strongly connected components of the graph:
-//   literal l -> literals propagated by l.
+// Presolver that does failed-literal probing: the two polarities of each
+// variable x are probed, which fixes the literals leading to a conflict and
+// the ones propagated by both x and not(x), and finds the literals equivalent
+// to x (x is equivalent to not(m) if x propagates not(m) and not(x) propagates
+// m). The variables are split among presolve_probing_num_threads threads, each
+// working on its own copy of the clauses of the solver; the fixed literals are
+// added to the solver, and the equivalences merged, at the end.
 //
 // Clears the mapping if there are no equivalent literals. Otherwise, mapping[l]
 // is the representative of the equivalent class of l. Note that mapping[l] may
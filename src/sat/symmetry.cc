@@ -81,9 +81,10 @@ bool SymmetryPropagator::PropagateNext() {
 
       // If the first non-symmetric literal is a decision, then we can't deduce
       // anything. Otherwise, it is either a conflict or a propagation.
-      const AssignmentInfo& assignment_info =
-          trail_->Info(non_symmetric.literal.Variable());
-      if (assignment_info.type == AssignmentInfo::SEARCH_DECISION) continue;
+      const VariableIndex var = non_symmetric.literal.Variable();
+      if (trail_->ReasonInfo(var).type == AssignmentReason::SEARCH_DECISION) {
+        continue;
+      }
       if (trail_->Assignment().IsLiteralFalse(non_symmetric.image)) {
         // Conflict.
         conflict_permutation_index_ = p_index;
@@ -99,7 +100,7 @@ bool SymmetryPropagator::PropagateNext() {
       } else {
         // Propagation.
         trail_->EnqueueWithSymmetricReason(
-            non_symmetric.image, assignment_info.trail_index, p_index);
+            non_symmetric.image, trail_->Info(var).trail_index, p_index);
         ++num_propagations_;
       }
     }
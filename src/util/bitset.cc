@@ -14,6 +14,10 @@
 
 #include "util/bitset.h"
 
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
 #include "base/commandlineflags.h"
 #include "base/logging.h"
 
@@ -22,6 +26,165 @@ DEFINE_int32(bitset_small_bitset_count, 8,
 
 namespace operations_research {
 
+// ---------- Bulk Word Operations ----------
+
+namespace {
+#if defined(__AVX2__)
+inline __m256i Load256(const uint64* const words) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words));
+}
+
+inline void Store256(__m256i value, uint64* const words) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(words), value);
+}
+
+// Returns the number of bits set in each of the 4 words of v. This is the
+// nibble lookup table method of W. Mula, N. Kurz and D. Lemire, "Faster
+// population counts using AVX2 instructions", 2016.
+inline __m256i PopCount256(__m256i v) {
+  const __m256i lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                       2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  const __m256i low = _mm256_and_si256(v, low_mask);
+  const __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+  const __m256i byte_counts =
+      _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                      _mm256_shuffle_epi8(lookup, high));
+  return _mm256_sad_epu8(byte_counts, _mm256_setzero_si256());
+}
+
+inline uint64 HorizontalSum256(__m256i v) {
+  return static_cast<uint64>(_mm256_extract_epi64(v, 0)) +
+         static_cast<uint64>(_mm256_extract_epi64(v, 1)) +
+         static_cast<uint64>(_mm256_extract_epi64(v, 2)) +
+         static_cast<uint64>(_mm256_extract_epi64(v, 3));
+}
+#endif  // defined(__AVX2__)
+
+// 32-bit counterparts of the bulk operations, used by the range functions
+// below. There is no vectorized version of those.
+inline uint32 BitCountWords32(const uint32* const bits, int64 num_words) {
+  uint32 count = 0;
+  for (int64 i = 0; i < num_words; ++i) count += BitCount32(bits[i]);
+  return count;
+}
+
+inline int64 FirstNonZeroWord32(const uint32* const bits, int64 begin,
+                                int64 end) {
+  while (begin < end && bits[begin] == 0) ++begin;
+  return begin;
+}
+}  // namespace
+
+uint64 BitCountWords64(const uint64* const bits, int64 num_words) {
+  int64 i = 0;
+  uint64 count = 0;
+#if defined(__AVX512VPOPCNTDQ__)
+  __m512i sum = _mm512_setzero_si512();
+  for (; i + 8 <= num_words; i += 8) {
+    sum = _mm512_add_epi64(sum,
+                           _mm512_popcnt_epi64(_mm512_loadu_si512(bits + i)));
+  }
+  count += _mm512_reduce_add_epi64(sum);
+#elif defined(__AVX2__)
+  __m256i sum = _mm256_setzero_si256();
+  for (; i + 4 <= num_words; i += 4) {
+    sum = _mm256_add_epi64(sum, PopCount256(Load256(bits + i)));
+  }
+  count += HorizontalSum256(sum);
+#endif
+  for (; i < num_words; ++i) count += BitCount64(bits[i]);
+  return count;
+}
+
+uint64 IntersectionBitCountWords64(const uint64* const a,
+                                   const uint64* const b, int64 num_words) {
+  int64 i = 0;
+  uint64 count = 0;
+#if defined(__AVX512VPOPCNTDQ__)
+  __m512i sum = _mm512_setzero_si512();
+  for (; i + 8 <= num_words; i += 8) {
+    const __m512i both =
+        _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+    sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(both));
+  }
+  count += _mm512_reduce_add_epi64(sum);
+#elif defined(__AVX2__)
+  __m256i sum = _mm256_setzero_si256();
+  for (; i + 4 <= num_words; i += 4) {
+    const __m256i both = _mm256_and_si256(Load256(a + i), Load256(b + i));
+    sum = _mm256_add_epi64(sum, PopCount256(both));
+  }
+  count += HorizontalSum256(sum);
+#endif
+  for (; i < num_words; ++i) count += BitCount64(a[i] & b[i]);
+  return count;
+}
+
+// Defines name(a, b, num_words, dst), which sets dst[i] to op(a[i], b[i]) for
+// all i with the widest vector instructions available and a word loop for the
+// remaining tail.
+#if defined(__AVX512F__)
+#define BULK_WORD_OPERATION(name, scalar_op, avx2_op, avx512_op)             \
+  void name(const uint64* const a, const uint64* const b, int64 num_words,  \
+            uint64* const dst) {                                             \
+    int64 i = 0;                                                             \
+    for (; i + 8 <= num_words; i += 8) {                                     \
+      const __m512i x = _mm512_loadu_si512(a + i);                           \
+      const __m512i y = _mm512_loadu_si512(b + i);                           \
+      _mm512_storeu_si512(dst + i, avx512_op(x, y));                         \
+    }                                                                        \
+    for (; i < num_words; ++i) dst[i] = scalar_op(a[i], b[i]);               \
+  }
+#elif defined(__AVX2__)
+#define BULK_WORD_OPERATION(name, scalar_op, avx2_op, avx512_op)            \
+  void name(const uint64* const a, const uint64* const b, int64 num_words, \
+            uint64* const dst) {                                            \
+    int64 i = 0;                                                            \
+    for (; i + 4 <= num_words; i += 4) {                                    \
+      Store256(avx2_op(Load256(a + i), Load256(b + i)), dst + i);           \
+    }                                                                       \
+    for (; i < num_words; ++i) dst[i] = scalar_op(a[i], b[i]);              \
+  }
+#else
+#define BULK_WORD_OPERATION(name, scalar_op, avx2_op, avx512_op)            \
+  void name(const uint64* const a, const uint64* const b, int64 num_words, \
+            uint64* const dst) {                                            \
+    for (int64 i = 0; i < num_words; ++i) dst[i] = scalar_op(a[i], b[i]);  \
+  }
+#endif
+
+#define SCALAR_AND(x, y) ((x) & (y))
+#define SCALAR_AND_NOT(x, y) ((x) & ~(y))
+#define SCALAR_OR(x, y) ((x) | (y))
+// Note the reversed arguments: the intrinsics compute ~first & second.
+#define AVX2_AND_NOT(x, y) _mm256_andnot_si256(y, x)
+#define AVX512_AND_NOT(x, y) _mm512_andnot_si512(y, x)
+
+BULK_WORD_OPERATION(AndWords64, SCALAR_AND, _mm256_and_si256, _mm512_and_si512)
+BULK_WORD_OPERATION(AndNotWords64, SCALAR_AND_NOT, AVX2_AND_NOT,
+                    AVX512_AND_NOT)
+BULK_WORD_OPERATION(OrWords64, SCALAR_OR, _mm256_or_si256, _mm512_or_si512)
+
+#undef AVX512_AND_NOT
+#undef AVX2_AND_NOT
+#undef SCALAR_OR
+#undef SCALAR_AND_NOT
+#undef SCALAR_AND
+#undef BULK_WORD_OPERATION
+
+int64 FirstNonZeroWord64(const uint64* const bits, int64 begin, int64 end) {
+#if defined(__AVX2__)
+  for (; begin + 4 <= end; begin += 4) {
+    const __m256i words = Load256(bits + begin);
+    if (!_mm256_testz_si256(words, words)) break;
+  }
+#endif
+  while (begin < end && bits[begin] == 0) ++begin;
+  return begin;
+}
+
 // ---------- Bit Operations ----------
 
 #define BIT_COUNT_RANGE(size, zero)                                           \
@@ -39,9 +202,8 @@ namespace operations_research {
         uint##size bit_count = zero;                                          \
         bit_count +=                                                          \
             BitCount##size(bits[offset_start] & IntervalUp##size(pos_start)); \
-        for (int offset = offset_start + 1; offset < offset_end; ++offset) {  \
-          bit_count += BitCount##size(bits[offset]);                          \
-        }                                                                     \
+        bit_count += BitCountWords##size(bits + offset_start + 1,             \
+                                         offset_end - offset_start - 1);      \
         bit_count +=                                                          \
             BitCount##size(bits[offset_end] & IntervalDown##size(pos_end));   \
         return bit_count;                                                     \
@@ -75,10 +237,9 @@ BIT_COUNT_RANGE(32, 0U)
       if (bits[offset_start] & IntervalUp##size(pos_start)) {              \
         return false;                                                      \
       }                                                                    \
-      for (int offset = offset_start + 1; offset < offset_end; ++offset) { \
-        if (bits[offset]) {                                                \
-          return false;                                                    \
-        }                                                                  \
+      if (FirstNonZeroWord##size(bits, offset_start + 1, offset_end) !=    \
+          offset_end) {                                                    \
+        return false;                                                      \
       }                                                                    \
       if (bits[offset_end] & IntervalDown##size(pos_end)) {                \
         return false;                                                      \
@@ -118,11 +279,11 @@ IS_EMPTY_RANGE(32)
         return BitShift##size(offset_start) +                                \
                LeastSignificantBitPosition##size(start_mask);                \
       } else {                                                               \
-        for (int offset = offset_start + 1; offset < offset_end; ++offset) { \
-          if (bits[offset]) {                                                \
-            return BitShift##size(offset) +                                  \
-                   LeastSignificantBitPosition##size(bits[offset]);          \
-          }                                                                  \
+        const int offset =                                                   \
+            FirstNonZeroWord##size(bits, offset_start + 1, offset_end);      \
+        if (offset != offset_end) {                                          \
+          return BitShift##size(offset) +                                    \
+                 LeastSignificantBitPosition##size(bits[offset]);            \
         }                                                                    \
         const int pos_end = BitPos##size(end);                               \
         const uint##size active_range =                                      \
@@ -210,11 +371,11 @@ MOST_SIGNIFICANT_BIT_POSITION(32)
       return BitShift##size(offset_start) +                               \
              LeastSignificantBitPosition##size(start_mask);               \
     }                                                                     \
-    for (int offset = offset_start + 1; offset <= offset_end; ++offset) { \
-      if (bits[offset]) {                                                 \
-        return BitShift##size(offset) +                                   \
-               LeastSignificantBitPosition##size(bits[offset]);           \
-      }                                                                   \
+    const int offset =                                                    \
+        FirstNonZeroWord##size(bits, offset_start + 1, offset_end + 1);   \
+    if (offset != offset_end + 1) {                                       \
+      return BitShift##size(offset) +                                     \
+             LeastSignificantBitPosition##size(bits[offset]);             \
     }                                                                     \
     return -1;                                                            \
   }
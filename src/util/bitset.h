@@ -17,8 +17,10 @@
 #ifndef OR_TOOLS_UTIL_BITSET_H_
 #define OR_TOOLS_UTIL_BITSET_H_
 
+#include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <new>
 #include <vector>
 
 #include "base/basictypes.h"
@@ -39,6 +41,11 @@ inline uint64 OneBit64(int pos) { return GG_ULONGLONG(1) << pos; }
 inline uint32 OneBit32(int pos) { return 1U << pos; }
 
 // Returns the number of bits set in n.
+#if defined(__GNUC__) && defined(__POPCNT__)
+// The builtins compile to a single popcnt instruction when it is available.
+inline uint64 BitCount64(uint64 n) { return __builtin_popcountll(n); }
+inline uint32 BitCount32(uint32 n) { return __builtin_popcount(n); }
+#else
 inline uint64 BitCount64(uint64 n) {
   const uint64 m1 = GG_ULONGLONG(0x5555555555555555);
   const uint64 m2 = GG_ULONGLONG(0x3333333333333333);
@@ -58,6 +65,7 @@ inline uint32 BitCount32(uint32 n) {
   n = n + (n >> 16);
   return n & 0x0000003FUL;
 }
+#endif  // defined(__GNUC__) && defined(__POPCNT__)
 
 // Returns a word with only the least significant bit of n set.
 inline uint64 LeastSignificantBitWord64(uint64 n) { return n & ~(n - 1); }
@@ -401,6 +409,91 @@ int64 UnsafeMostSignificantBitPosition64(const uint64* const bitset,
 int32 UnsafeMostSignificantBitPosition32(const uint32* const bitset,
                                          uint32 start, uint32 end);
 
+// Bulk operations on arrays of num_words 64-bit words. They process several
+// words per instruction with AVX2 or AVX-512 when the code is compiled with
+// support for them (e.g. -mavx2) and use portable word loops otherwise. The
+// destination may alias any of the sources.
+
+// Returns the number of bits set in bits[0, num_words).
+uint64 BitCountWords64(const uint64* const bits, int64 num_words);
+
+// Returns the number of bits set in both a and b.
+uint64 IntersectionBitCountWords64(const uint64* const a,
+                                   const uint64* const b, int64 num_words);
+
+// Sets dst to a & b, a & ~b and a | b respectively.
+void AndWords64(const uint64* const a, const uint64* const b, int64 num_words,
+                uint64* const dst);
+void AndNotWords64(const uint64* const a, const uint64* const b,
+                   int64 num_words, uint64* const dst);
+void OrWords64(const uint64* const a, const uint64* const b, int64 num_words,
+               uint64* const dst);
+
+// Returns the index of the first non-zero word in bits[begin, end), or end if
+// they are all zero.
+int64 FirstNonZeroWord64(const uint64* const bits, int64 begin, int64 end);
+
+// STL allocator returning memory aligned on kAlignment bytes (which must be a
+// power of two, multiple of sizeof(void*)). Storing the words of a bitset on
+// cache line boundaries avoids split loads in the bulk operations above, e.g.
+//   std::vector<uint64, AlignedAllocator<uint64> > words;
+template <typename T, size_t kAlignment = 64>
+class AlignedAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  template <typename U>
+  struct rebind {
+    typedef AlignedAllocator<U, kAlignment> other;
+  };
+
+  AlignedAllocator() {}
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, kAlignment>& other) {}
+
+  T* allocate(size_t n) {
+    if (n == 0) return nullptr;
+    void* ptr = nullptr;
+#if defined(_MSC_VER)
+    ptr = _aligned_malloc(n * sizeof(T), kAlignment);
+#else
+    if (posix_memalign(&ptr, kAlignment, n * sizeof(T)) != 0) ptr = nullptr;
+#endif
+    if (ptr == nullptr) throw std::bad_alloc();
+    return static_cast<T*>(ptr);
+  }
+  void deallocate(T* ptr, size_t n) {
+#if defined(_MSC_VER)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+  size_t max_size() const { return static_cast<size_t>(-1) / sizeof(T); }
+  template <typename U, typename... Args>
+  void construct(U* ptr, Args&&... args) {
+    new (ptr) U(std::forward<Args>(args)...);
+  }
+  template <typename U>
+  void destroy(U* ptr) {
+    ptr->~U();
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U, kAlignment>& other) const {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U, kAlignment>& other) const {
+    return false;
+  }
+};
+
 // Returns a mask with the bits pos % 64 and (pos ^ 1) % 64 sets.
 inline uint64 TwoBitsFromPos64(uint64 pos) {
   return GG_ULONGLONG(3) << (pos & 62);
@@ -544,14 +637,44 @@ class Bitset64 {
   // the higher order bits are assumed to be 0.
   void Intersection(const Bitset64<IndexType>& other) {
     const int min_size = std::min(data_.size(), other.data_.size());
-    for (int i = 0; i < min_size; ++i) {
-      data_[i] &= other.data_[i];
+    AndWords64(data_.data(), other.data_.data(), min_size, data_.data());
+    if (min_size < data_.size()) {
+      memset(data_.data() + min_size, 0,
+             (data_.size() - min_size) * sizeof(uint64));
     }
-    for (int i = min_size; i < data_.size(); ++i) {
-      data_[i] = 0;
+  }
+
+  // Sets "this" to be the union of "this" and "other". The bitsets do not have
+  // to be the same size. If "other" is larger, its high order bits are
+  // ignored.
+  void Union(const Bitset64<IndexType>& other) {
+    const int min_size = std::min(data_.size(), other.data_.size());
+    if (min_size == 0) return;
+    OrWords64(data_.data(), other.data_.data(), min_size, data_.data());
+    if (other.size() > size()) {
+      data_[min_size - 1] &= IntervalDown64(BitPos64(Value(size_) - 1));
     }
   }
 
+  // Clears in "this" all the bits set in "other". The bitsets do not have to
+  // be the same size.
+  void Difference(const Bitset64<IndexType>& other) {
+    const int min_size = std::min(data_.size(), other.data_.size());
+    AndNotWords64(data_.data(), other.data_.data(), min_size, data_.data());
+  }
+
+  // Returns the number of positions set in both "this" and "other".
+  int64 IntersectionCount(const Bitset64<IndexType>& other) const {
+    const int min_size = std::min(data_.size(), other.data_.size());
+    return IntersectionBitCountWords64(data_.data(), other.data_.data(),
+                                       min_size);
+  }
+
+  // Returns the number of positions set to 1.
+  int64 NumberOfSetBits() const {
+    return BitCountWords64(data_.data(), data_.size());
+  }
+
   // Class to iterate over the bit positions at 1 of a Bitset64.
   //
   // IMPORTANT: Because the iterator "caches" the current uint64 bucket, this
@@ -663,7 +786,7 @@ class Bitset64 {
   int64 Value(IndexType input) const;
 
   IndexType size_;
-  std::vector<uint64> data_;
+  std::vector<uint64, AlignedAllocator<uint64> > data_;
 
   // It is faster to store the end() Iterator than to recompute it every time.
   // Note that we cannot do the same for begin().
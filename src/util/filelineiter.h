@@ -22,78 +22,70 @@
 #ifndef OR_TOOLS_UTIL_FILELINEITER_H_
 #define OR_TOOLS_UTIL_FILELINEITER_H_
 
+#include <string.h>
+#include <string>
+
 #include "base/logging.h"
 #include "base/file.h"
 #include "base/strutil.h"
+#include "base/unique_ptr.h"
 
 namespace operations_research {
 
 // Implements the minimum interface for a range-based for loop iterator.
 class FileLineIterator {
  public:
-  explicit FileLineIterator(File* file)
-      : next_position_after_eol_(0), buffer_size_(0), file_(file) {
+  // Iterates over the lines of file, which may be nullptr for the end
+  // iterator.
+  explicit FileLineIterator(const MappedFile* file)
+      : next_(file == nullptr ? nullptr : file->data()),
+        end_(file == nullptr ? nullptr : file->data() + file->size()),
+        at_end_(file == nullptr) {
     ReadNextLine();
   }
   const std::string& operator*() const { return line_; }
   bool operator!=(const FileLineIterator& other) const {
-    return file_ != other.file_;
+    return at_end_ != other.at_end_;
   }
   void operator++() { ReadNextLine(); }
 
  private:
   void ReadNextLine() {
     line_.clear();
-    if (file_ == nullptr) return;
-    while (true) {
-      int i = next_position_after_eol_;
-      for (; i < buffer_size_; ++i) {
-        if (buffer_[i] == '\n') break;
-      }
-      line_.append(&buffer_[next_position_after_eol_],
-                   i - next_position_after_eol_);
-      if (i == buffer_size_) {
-        buffer_size_ = file_->Read(&buffer_, kBufferSize);
-        if (buffer_size_ < 0) {
-          LOG(WARNING) << "Error while reading file.";
-          file_ = nullptr;
-          break;
-        }
-        next_position_after_eol_ = 0;
-        if (buffer_size_ == 0) {
-          if (line_.empty()) {
-            file_ = nullptr;
-          }
-          break;
-        }
-      } else {
-        next_position_after_eol_ = i + 1;
-        break;
-      }
+    if (at_end_) return;
+    if (next_ == end_) {
+      at_end_ = true;
+      return;
+    }
+    const char* const eol =
+        static_cast<const char*>(memchr(next_, '\n', end_ - next_));
+    if (eol == nullptr) {
+      line_.assign(next_, end_ - next_);
+      next_ = end_;
+    } else {
+      line_.assign(next_, eol - next_);
+      next_ = eol + 1;
     }
   }
 
-  static const int kBufferSize = 5 * 1024;
-  char buffer_[kBufferSize];
-  int next_position_after_eol_;
-  int buffer_size_;
-  File* file_;
+  // The remaining part of the file content.
+  const char* next_;
+  const char* end_;
+  bool at_end_;
   std::string line_;
 };
 
+// The file is memory-mapped (see MappedFile), so that iterating over its lines
+// only costs a scan for '\n' and a copy of each line.
 class FileLines {
  public:
-  explicit FileLines(const std::string& filename) {
-    file_ = File::Open(filename, "r");
-  }
-  ~FileLines() {
-    if (file_ != nullptr) file_->Close();
-  }
-  FileLineIterator begin() { return FileLineIterator(file_); }
+  explicit FileLines(const std::string& filename)
+      : file_(MappedFile::Open(filename)) {}
+  FileLineIterator begin() { return FileLineIterator(file_.get()); }
   FileLineIterator end() const { return FileLineIterator(nullptr); }
 
  private:
-  File* file_;
+  std::unique_ptr<MappedFile> file_;
   DISALLOW_COPY_AND_ASSIGN(FileLines);
 };
 
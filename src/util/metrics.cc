@@ -0,0 +1,253 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/metrics.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+
+#include "base/file.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+
+DEFINE_string(solver_metrics_file, "",
+              "If not empty, the solvers publish their metrics to this file, "
+              "in JSON. See util/metrics.h.");
+DEFINE_double(solver_metrics_export_period, 1.0,
+              "Period, in seconds, of the export of the metrics to "
+              "--solver_metrics_file.");
+
+namespace operations_research {
+namespace {
+// Appends 'value' as a JSON string.
+void AppendJsonString(const std::string& value, std::string* json) {
+  json->push_back('"');
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      json->push_back('\\');
+      json->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      StringAppendF(json, "\\u%04x", c);
+    } else {
+      json->push_back(c);
+    }
+  }
+  json->push_back('"');
+}
+
+// Appends 'value' as a JSON number, or null if it is not finite.
+void AppendJsonDouble(double value, std::string* json) {
+  if (std::isfinite(value)) {
+    StringAppendF(json, "%.17g", value);
+  } else {
+    json->append("null");
+  }
+}
+
+// Appends '"key": ' preceded by a comma if it is not the first key.
+void AppendJsonKey(const std::string& key, bool first, std::string* json) {
+  if (!first) json->append(", ");
+  AppendJsonString(key, json);
+  json->append(": ");
+}
+}  // namespace
+
+JsonFileMetricsExporter::JsonFileMetricsExporter(const std::string& filename)
+    : filename_(filename) {}
+
+void JsonFileMetricsExporter::Export(const std::string& json) {
+  if (!file::SetContents(filename_, json, file::Defaults()).ok()) {
+    LOG(WARNING) << "Could not export the metrics to " << filename_;
+  }
+}
+
+CallbackMetricsExporter::CallbackMetricsExporter(
+    Callback1<const std::string&>* callback)
+    : callback_(callback) {
+  callback_->CheckIsRepeatable();
+}
+
+void CallbackMetricsExporter::Export(const std::string& json) {
+  callback_->Run(json);
+}
+
+MetricsRegistry::MetricsRegistry()
+    : enabled_(false), stop_periodic_export_(false) {}
+
+MetricsRegistry::~MetricsRegistry() { StopPeriodicExport(); }
+
+MetricsRegistry* MetricsRegistry::Global() {
+  static MetricsRegistry* const registry = []() {
+    MetricsRegistry* const result = new MetricsRegistry();
+    if (!FLAGS_solver_metrics_file.empty()) {
+      result->AddExporter(
+          new JsonFileMetricsExporter(FLAGS_solver_metrics_file));
+      result->StartPeriodicExport(FLAGS_solver_metrics_export_period);
+    }
+    return result;
+  }();
+  return registry;
+}
+
+void MetricsRegistry::IncrementCounter(const std::string& subsystem,
+                                       const std::string& name, int64 delta) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  subsystems_[subsystem].counters[name] += delta;
+}
+
+void MetricsRegistry::SetGauge(const std::string& subsystem,
+                               const std::string& name, double value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  subsystems_[subsystem].gauges[name] = value;
+}
+
+void MetricsRegistry::AddToHistogram(const std::string& subsystem,
+                                     const std::string& name, double value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Histogram* const histogram = &subsystems_[subsystem].histograms[name];
+  if (histogram->count == 0) {
+    histogram->min = value;
+    histogram->max = value;
+  } else {
+    histogram->min = std::min(histogram->min, value);
+    histogram->max = std::max(histogram->max, value);
+  }
+  ++histogram->count;
+  histogram->sum += value;
+}
+
+void MetricsRegistry::PublishThroughput(const std::string& subsystem,
+                                        const std::string& name, int64 count,
+                                        double seconds) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Subsystem* const metrics = &subsystems_[subsystem];
+  metrics->counters[name] += count;
+  if (seconds > 0.0) metrics->gauges[name + "_per_second"] = count / seconds;
+}
+
+int64 MetricsRegistry::GetCounter(const std::string& subsystem,
+                                  const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto metrics = subsystems_.find(subsystem);
+  if (metrics == subsystems_.end()) return 0;
+  const auto it = metrics->second.counters.find(name);
+  return it == metrics->second.counters.end() ? 0 : it->second;
+}
+
+double MetricsRegistry::GetGauge(const std::string& subsystem,
+                                 const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto metrics = subsystems_.find(subsystem);
+  if (metrics == subsystems_.end()) return 0.0;
+  const auto it = metrics->second.gauges.find(name);
+  return it == metrics->second.gauges.end() ? 0.0 : it->second;
+}
+
+std::string MetricsRegistry::ToJson() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string json = "{";
+  bool first_subsystem = true;
+  for (const auto& subsystem : subsystems_) {
+    AppendJsonKey(subsystem.first, first_subsystem, &json);
+    first_subsystem = false;
+    const Subsystem& metrics = subsystem.second;
+    json.append("{\"counters\": {");
+    bool first = true;
+    for (const auto& counter : metrics.counters) {
+      AppendJsonKey(counter.first, first, &json);
+      first = false;
+      StringAppendF(&json, "%lld", static_cast<long long>(counter.second));
+    }
+    json.append("}, \"gauges\": {");
+    first = true;
+    for (const auto& gauge : metrics.gauges) {
+      AppendJsonKey(gauge.first, first, &json);
+      first = false;
+      AppendJsonDouble(gauge.second, &json);
+    }
+    json.append("}, \"histograms\": {");
+    first = true;
+    for (const auto& entry : metrics.histograms) {
+      AppendJsonKey(entry.first, first, &json);
+      first = false;
+      const Histogram& histogram = entry.second;
+      StringAppendF(&json, "{\"count\": %lld, \"sum\": ",
+                    static_cast<long long>(histogram.count));
+      AppendJsonDouble(histogram.sum, &json);
+      json.append(", \"min\": ");
+      AppendJsonDouble(histogram.min, &json);
+      json.append(", \"max\": ");
+      AppendJsonDouble(histogram.max, &json);
+      json.append("}");
+    }
+    json.append("}}");
+  }
+  json.append("}\n");
+  return json;
+}
+
+void MetricsRegistry::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  subsystems_.clear();
+}
+
+void MetricsRegistry::AddExporter(MetricsExporter* exporter) {
+  std::lock_guard<std::mutex> lock(export_mutex_);
+  exporters_.emplace_back(exporter);
+  enabled_ = true;
+}
+
+void MetricsRegistry::Export() {
+  const std::string json = ToJson();
+  std::lock_guard<std::mutex> lock(export_mutex_);
+  for (const std::unique_ptr<MetricsExporter>& exporter : exporters_) {
+    exporter->Export(json);
+  }
+}
+
+void MetricsRegistry::StartPeriodicExport(double period_in_seconds) {
+  CHECK_LT(0.0, period_in_seconds);
+  std::lock_guard<std::mutex> lock(periodic_export_mutex_);
+  CHECK(periodic_export_thread_ == nullptr) << "Already started.";
+  stop_periodic_export_ = false;
+  periodic_export_thread_.reset(new std::thread(
+      &MetricsRegistry::RunPeriodicExport, this, period_in_seconds));
+}
+
+void MetricsRegistry::StopPeriodicExport() {
+  std::unique_ptr<std::thread> thread;
+  {
+    std::lock_guard<std::mutex> lock(periodic_export_mutex_);
+    if (periodic_export_thread_ == nullptr) return;
+    stop_periodic_export_ = true;
+    thread = std::move(periodic_export_thread_);
+  }
+  periodic_export_condition_.notify_all();
+  thread->join();
+  Export();
+}
+
+void MetricsRegistry::RunPeriodicExport(double period_in_seconds) {
+  const std::chrono::duration<double> period(period_in_seconds);
+  std::unique_lock<std::mutex> lock(periodic_export_mutex_);
+  while (!stop_periodic_export_) {
+    periodic_export_condition_.wait_for(lock, period);
+    if (stop_periodic_export_) break;
+    lock.unlock();
+    Export();
+    lock.lock();
+  }
+}
+
+}  // namespace operations_research
@@ -0,0 +1,179 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A common surface for the metrics of the solvers, for monitoring.
+//
+// The solvers publish their counters (e.g. the number of conflicts), gauges
+// (e.g. the number of conflicts per second of the last solve) and histograms
+// (e.g. the solve times) to the global MetricsRegistry, keyed by subsystem:
+//   - "sat": SatSolver.
+//   - "glop": glop::RevisedSimplex.
+//   - "bop": bop::BopSolver.
+//   - "cp": the top-level searches of the constraint Solver.
+//
+// The metrics are given as JSON to pluggable exporters:
+//
+//   MetricsRegistry* const metrics = MetricsRegistry::Global();
+//   metrics->AddExporter(new JsonFileMetricsExporter("/tmp/metrics.json"));
+//   metrics->StartPeriodicExport(10.0);
+//   ... solve ...
+//   metrics->StopPeriodicExport();
+//
+// The JSON looks like:
+//   {"sat": {"counters": {"conflicts": 1234, ...},
+//            "gauges": {"conflicts_per_second": 56789.0, ...},
+//            "histograms": {"solve_time_seconds": {"count": 3, "sum": 1.5,
+//                                                  "min": 0.1, "max": 1.2}}},
+//    "glop": {...}}
+//
+// The solvers only publish to an enabled registry, so that the metrics cost
+// nothing by default. Adding an exporter enables the registry. Setting
+// --solver_metrics_file makes the global registry export to this file every
+// --solver_metrics_export_period seconds.
+
+#ifndef OR_TOOLS_UTIL_METRICS_H_
+#define OR_TOOLS_UTIL_METRICS_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/callback.h"
+#include "base/commandlineflags.h"
+#include "base/integral_types.h"
+#include "base/macros.h"
+
+DECLARE_string(solver_metrics_file);
+DECLARE_double(solver_metrics_export_period);
+
+namespace operations_research {
+
+// Receives the metrics of a MetricsRegistry, as JSON, on each export.
+class MetricsExporter {
+ public:
+  virtual ~MetricsExporter() {}
+  virtual void Export(const std::string& json) = 0;
+};
+
+// Writes the metrics to a file, which is replaced on each export.
+class JsonFileMetricsExporter : public MetricsExporter {
+ public:
+  explicit JsonFileMetricsExporter(const std::string& filename);
+  virtual void Export(const std::string& json);
+
+ private:
+  const std::string filename_;
+  DISALLOW_COPY_AND_ASSIGN(JsonFileMetricsExporter);
+};
+
+// Calls a callback with the metrics on each export.
+class CallbackMetricsExporter : public MetricsExporter {
+ public:
+  // Takes ownership of the callback, which must be permanent.
+  explicit CallbackMetricsExporter(Callback1<const std::string&>* callback);
+  virtual void Export(const std::string& json);
+
+ private:
+  std::unique_ptr<Callback1<const std::string&> > callback_;
+  DISALLOW_COPY_AND_ASSIGN(CallbackMetricsExporter);
+};
+
+// A set of metrics keyed by subsystem and name. All the methods are
+// thread-safe.
+class MetricsRegistry {
+ public:
+  MetricsRegistry();
+  ~MetricsRegistry();
+
+  // The registry the solvers publish to.
+  static MetricsRegistry* Global();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  void set_enabled(bool enabled) { enabled_ = enabled; }
+
+  // Adds delta to a counter.
+  void IncrementCounter(const std::string& subsystem, const std::string& name,
+                        int64 delta);
+  // Sets the value of a gauge.
+  void SetGauge(const std::string& subsystem, const std::string& name,
+                double value);
+  // Adds a value to a histogram, which keeps the count, the sum, the min and
+  // the max of its values.
+  void AddToHistogram(const std::string& subsystem, const std::string& name,
+                      double value);
+  // Adds 'count' to the counter 'name', and sets the gauge 'name_per_second'
+  // to count / seconds if seconds is positive.
+  void PublishThroughput(const std::string& subsystem, const std::string& name,
+                         int64 count, double seconds);
+
+  // Returns the value of a counter or a gauge, or 0 if it doesn't exist.
+  int64 GetCounter(const std::string& subsystem, const std::string& name) const;
+  double GetGauge(const std::string& subsystem, const std::string& name) const;
+
+  // Returns all the metrics in JSON, see the top of the file.
+  std::string ToJson() const;
+
+  // Removes all the metrics.
+  void Clear();
+
+  // Adds an exporter, and enables the registry. Takes ownership.
+  void AddExporter(MetricsExporter* exporter);
+
+  // Gives the current metrics to all the exporters.
+  void Export();
+
+  // Calls Export() every period_in_seconds from a background thread, until
+  // StopPeriodicExport() is called or the registry is destroyed.
+  void StartPeriodicExport(double period_in_seconds);
+  // Stops the periodic export if it was started, then calls Export().
+  void StopPeriodicExport();
+
+ private:
+  struct Histogram {
+    Histogram() : count(0), sum(0.0), min(0.0), max(0.0) {}
+    int64 count;
+    double sum;
+    double min;
+    double max;
+  };
+  struct Subsystem {
+    std::map<std::string, int64> counters;
+    std::map<std::string, double> gauges;
+    std::map<std::string, Histogram> histograms;
+  };
+
+  void RunPeriodicExport(double period_in_seconds);
+
+  std::atomic<bool> enabled_;
+  mutable std::mutex mutex_;
+  std::map<std::string, Subsystem> subsystems_;
+
+  // Export() and the periodic export thread.
+  std::mutex export_mutex_;
+  std::vector<std::unique_ptr<MetricsExporter> > exporters_;
+  std::mutex periodic_export_mutex_;
+  std::condition_variable periodic_export_condition_;
+  bool stop_periodic_export_;
+  std::unique_ptr<std::thread> periodic_export_thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(MetricsRegistry);
+};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_UTIL_METRICS_H_
@@ -37,6 +37,8 @@ namespace operations_research {
 // - Setting the k-th operand to a given value in O(log n) calls to the *
 // operation
 // - Querying the result in O(1)
+// - Setting many operands at once in O(n) calls to the * operation, with
+//   SetWithoutUpdate() followed by UpdateAll().
 //
 // Note that the monoid is not required to be commutative.
 //
@@ -71,6 +73,16 @@ class MonoidOperationTree {
   // Resets all arguments.
   void Clear();
 
+  // Sets the argument of given index, but leaves the rest of the tree (and
+  // thus result()) stale until the next call to UpdateAll(). Setting k
+  // arguments this way costs O(k + n) calls to the * operation instead of
+  // O(k log n) with Set(), which pays off when filling most of the tree, e.g.
+  // right after Clear().
+  void SetWithoutUpdate(int argument_index, const T& argument);
+
+  // Recomputes all the non-leaf nodes from the leaves, in O(n).
+  void UpdateAll();
+
   // Returns the leaf node corresponding to the given argument index.
   const T& GetOperand(int argument_index) const {
     return nodes_[PositionOfLeaf(argument_index)];
@@ -187,14 +199,30 @@ void MonoidOperationTree<T>::Set(int argument_index, const T& argument) {
   ComputeAbove(position);
 }
 
+template <class T>
+void MonoidOperationTree<T>::SetWithoutUpdate(int argument_index,
+                                              const T& argument) {
+  CHECK_LT(argument_index, size_);
+  nodes_[leaf_offset_ + argument_index] = argument;
+}
+
+template <class T>
+void MonoidOperationTree<T>::UpdateAll() {
+  // In the implicit layout, all the children of a node come after it: going
+  // backwards from the last non-leaf node computes each node after its
+  // children, and accesses the nodes sequentially.
+  for (int pos = leaf_offset_ - 1; pos >= 0; --pos) {
+    Compute(pos);
+  }
+}
+
 template <class T>
 void MonoidOperationTree<T>::ComputeAbove(int position) {
-  int pos = father(position);
+  int pos = position;
   while (pos > 0) {
-    Compute(pos);
     pos = father(pos);
+    Compute(pos);
   }
-  Compute(0);
 }
 
 template <class T>
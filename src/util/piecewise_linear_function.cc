@@ -14,6 +14,7 @@
 #include "util/piecewise_linear_function.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <set>
 #include <string>
 #include <vector>
@@ -287,6 +288,7 @@ PiecewiseLinearFunction::PiecewiseLinearFunction(
   for (int i = 0; i < segments->size(); ++i) {
     InsertSegment(segments->at(i));
   }
+  UpdateFlatSegments();
 }
 
 PiecewiseLinearFunction* PiecewiseLinearFunction::CreatePiecewiseLinearFunction(
@@ -430,12 +432,75 @@ bool PiecewiseLinearFunction::IsConvex() const {
 }
 
 int64 PiecewiseLinearFunction::Value(int64 x) const {
-  if (!InDomain(x)) {
+  if (segment_start_x_.empty() || segment_start_x_.front() > x) {
     // TODO(user): Allow the user to specify the
     // undefined value and use kint64max as the default.
     return kint64max;
   }
-  const int index = FindSegmentIndex(segments_, x);
+  // Same search as FindSegmentIndex(), on the flat start points.
+  const int index =
+      x == kint64min ? 0 : std::upper_bound(segment_start_x_.begin(),
+                                            segment_start_x_.end(), x) -
+                               segment_start_x_.begin() - 1;
+  return SegmentValue(index, x);
+}
+
+void PiecewiseLinearFunction::Values(const std::vector<int64>& x,
+                                     std::vector<int64>* values) const {
+  CHECK_NOTNULL(values);
+  values->resize(x.size());
+  Cursor cursor(this);
+  for (int i = 0; i < x.size(); ++i) {
+    (*values)[i] = cursor.Value(x[i]);
+  }
+}
+
+int64 PiecewiseLinearFunction::Cursor::Value(int64 x) {
+  const int index = function_->FindSegmentIndexFrom(segment_, x);
+  if (index != kNotFound) segment_ = index;
+  return function_->SegmentValue(index, x);
+}
+
+int PiecewiseLinearFunction::FindSegmentIndexFrom(int hint, int64 x) const {
+  if (segment_start_x_.empty() || segment_start_x_.front() > x) {
+    return kNotFound;
+  }
+  if (x == kint64min) return 0;
+  // Finds low and high such that start[low] <= x < start[high], with
+  // start[num_segments] = +infinity, by doubling the step from the hint.
+  const int num_segments = segment_start_x_.size();
+  int low = hint;
+  int high = hint;
+  int step = 1;
+  if (segment_start_x_[hint] <= x) {
+    high = std::min(num_segments, low + step);
+    while (high < num_segments && segment_start_x_[high] <= x) {
+      low = high;
+      step *= 2;
+      high = std::min(num_segments, low + step);
+    }
+  } else {
+    // start[0] <= x, so this stops at 0 at the latest.
+    low = std::max(0, high - step);
+    while (segment_start_x_[low] > x) {
+      high = low;
+      step *= 2;
+      low = std::max(0, high - step);
+    }
+  }
+  return std::upper_bound(segment_start_x_.begin() + low + 1,
+                          segment_start_x_.begin() + high, x) -
+         segment_start_x_.begin() - 1;
+}
+
+int64 PiecewiseLinearFunction::SegmentValue(int index, int64 x) const {
+  if (index == kNotFound || x > segment_end_x_[index]) {
+    return kint64max;
+  }
+  if (segment_is_exact_[index]) {
+    return segment_reference_y_[index] +
+           segment_slope_[index] * (x - segment_reference_x_[index]);
+  }
   return segments_[index].Value(x);
 }
 
@@ -523,12 +588,14 @@ void PiecewiseLinearFunction::AddConstantToX(int64 constant) {
   for (int i = 0; i < segments_.size(); ++i) {
     segments_[i].AddConstantToX(constant);
   }
+  UpdateFlatSegments();
 }
 
 void PiecewiseLinearFunction::AddConstantToY(int64 constant) {
   for (int i = 0; i < segments_.size(); ++i) {
     segments_[i].AddConstantToY(constant);
   }
+  UpdateFlatSegments();
 }
 
 void PiecewiseLinearFunction::Add(const PiecewiseLinearFunction& other) {
@@ -655,6 +722,38 @@ void PiecewiseLinearFunction::Operation(
       InsertSegment(PiecewiseSegment(point_x, point_y, slope, other_point_x));
     }
   }
+  UpdateFlatSegments();
+}
+
+void PiecewiseLinearFunction::UpdateFlatSegments() {
+  const int num_segments = segments_.size();
+  segment_start_x_.resize(num_segments);
+  segment_end_x_.resize(num_segments);
+  segment_slope_.resize(num_segments);
+  segment_reference_x_.resize(num_segments);
+  segment_reference_y_.resize(num_segments);
+  segment_is_exact_.resize(num_segments);
+  for (int i = 0; i < num_segments; ++i) {
+    const PiecewiseSegment& segment = segments_[i];
+    const int64 start_x = segment.start_x();
+    const int64 end_x = segment.end_x();
+    const int64 slope = segment.slope();
+    const int64 reference_x = segment.reference_x();
+    const int64 reference_y = segment.reference_y();
+    segment_start_x_[i] = start_x;
+    segment_end_x_[i] = end_x;
+    segment_slope_[i] = slope;
+    segment_reference_x_[i] = reference_x;
+    segment_reference_y_[i] = reference_y;
+    // The largest |x - reference_x| on the domain, saturated.
+    const int64 span = std::max(
+        std::max(CapSub(end_x, reference_x), CapSub(reference_x, end_x)),
+        std::max(CapSub(start_x, reference_x), CapSub(reference_x, start_x)));
+    segment_is_exact_[i] =
+        !IsAtBounds(span) && slope != kint64min && reference_y != kint64min &&
+        !IsAtBounds(CapAdd(std::abs(reference_y),
+                           CapProd(std::abs(slope), span)));
+  }
 }
 
 }  // namespace operations_research
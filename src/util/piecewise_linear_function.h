@@ -54,6 +54,10 @@ class PiecewiseSegment {
   int64 slope() const { return slope_; }
   // Returns the intersection of the segment's extension with the y axis.
   int64 intersection_y() const { return intersection_y_; }
+  // Returns the x coordinate of the segment's finite reference point.
+  int64 reference_x() const { return reference_x_; }
+  // Returns the y coordinate of the segment's finite reference point.
+  int64 reference_y() const { return reference_y_; }
 
   // Comparison method useful to sort a sequence of segments.
   static bool SortComparator(const PiecewiseSegment& segment1,
@@ -186,6 +190,11 @@ class PiecewiseLinearFunction {
   bool IsConvex() const;
   // Returns the value of the piecewise linear function for x.
   int64 Value(int64 x) const;
+  // Sets (*values)[i] to Value(x[i]) for all i. The segment of each point is
+  // searched from the segment of the previous one, as with a Cursor, so this
+  // is faster than calling Value() on each point when the points are sorted
+  // or close to each other.
+  void Values(const std::vector<int64>& x, std::vector<int64>* values) const;
   // Returns the maximum value of all the segments in the function.
   int64 GetMaximum() const;
   // Returns the minimum value of all the segments in the function.
@@ -223,6 +232,26 @@ class PiecewiseLinearFunction {
 
   std::string DebugString() const;
 
+  // Evaluates a function on a sequence of points, searching the segment of
+  // each point from the segment of the previous one with an exponential
+  // search. This takes O(1) when successive points are in the same or in
+  // neighbouring segments, as in a time-ordered scan, and O(log(d)) when they
+  // are d segments apart, instead of the O(log(n)) binary search of Value().
+  // A cursor is invalidated by any change of its function.
+  class Cursor {
+   public:
+    explicit Cursor(const PiecewiseLinearFunction* function)
+        : function_(function), segment_(0) {}
+
+    // Same as function->Value(x).
+    int64 Value(int64 x);
+
+   private:
+    const PiecewiseLinearFunction* const function_;
+    // The segment of the last point.
+    int segment_;
+  };
+
  private:
   // Takes the sequence of segments, sorts them on increasing start and inserts
   // them in the piecewise linear function.
@@ -233,10 +262,32 @@ class PiecewiseLinearFunction {
   // final domain is the intersection between the two domains.
   void Operation(const PiecewiseLinearFunction& other,
                  ResultCallback2<int64, int64, int64>* operation);
+  // Copies segments_ to the segment_* vectors below. Must be called after any
+  // change of segments_.
+  void UpdateFlatSegments();
+  // Returns the index of the segment x belongs to, or of the previous segment
+  // if x is not in the domain, as FindSegmentIndex() in the .cc, or kNotFound
+  // if x is before the first segment. The search starts at the segment
+  // 'hint', which must be a valid index.
+  int FindSegmentIndexFrom(int hint, int64 x) const;
+  // Returns the value at x of the segment 'index' found by
+  // FindSegmentIndexFrom() for x, or kint64max if x is not in the domain.
+  int64 SegmentValue(int index, int64 x) const;
 
   // The vector of segments in the function, sorted in ascending order of start
   // points.
   std::vector<PiecewiseSegment> segments_;
+  // The fields of segments_, one vector per field, so that the searches and
+  // evaluations only read contiguous int64s. A segment is exact when
+  // reference_y + slope * (x - reference_x) can't overflow on its domain, in
+  // which case its values are computed directly instead of with the
+  // saturated arithmetic of PiecewiseSegment::Value().
+  std::vector<int64> segment_start_x_;
+  std::vector<int64> segment_end_x_;
+  std::vector<int64> segment_slope_;
+  std::vector<int64> segment_reference_x_;
+  std::vector<int64> segment_reference_y_;
+  std::vector<bool> segment_is_exact_;
 };
 }  // namespace operations_research
 #endif  // OR_TOOLS_UTIL_PIECEWISE_LINEAR_FUNCTION_H_
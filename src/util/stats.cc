@@ -22,6 +22,12 @@
 
 namespace operations_research {
 
+namespace internal {
+std::atomic<bool> stats_enabled(true);
+}  // namespace internal
+
+void EnableStats(bool enable) { internal::stats_enabled = enable; }
+
 std::string MemoryUsage() {
   static const int64 kDisplayThreshold = 2;
     static const int64 kKiloByte = 1024;
@@ -98,6 +104,7 @@ std::string StatsGroup::StatString() const {
 }
 
 TimeDistribution* StatsGroup::LookupOrCreateTimeDistribution(std::string name) {
+  std::lock_guard<std::mutex> lock(mutex_);
   TimeDistribution*& ref = time_distributions_[name];
   if (ref == NULL) {
     ref = new TimeDistribution(name);
@@ -106,56 +113,106 @@ TimeDistribution* StatsGroup::LookupOrCreateTimeDistribution(std::string name) {
   return ref;
 }
 
+TimeDistribution* StatsGroup::LookupOrCreateTimeDistribution(
+    const char* name) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = time_distributions_by_address_.find(name);
+    if (it != time_distributions_by_address_.end()) return it->second;
+  }
+  TimeDistribution* const result = LookupOrCreateTimeDistribution(
+      std::string(name));
+  std::lock_guard<std::mutex> lock(mutex_);
+  time_distributions_by_address_[name] = result;
+  return result;
+}
+
+DistributionStat::Shard::Shard()
+    : sum(0.0),
+      average(0.0),
+      sum_squares_from_average(0.0),
+      min(0.0),
+      max(0.0),
+      num(0) {}
+
+void DistributionStat::Shard::Add(double value) {
+  if (num == 0) {
+    min = value;
+    max = value;
+    sum = value;
+    average = value;
+    num = 1;
+    return;
+  }
+  min = std::min(min, value);
+  max = std::max(max, value);
+  sum += value;
+  ++num;
+  const double delta = value - average;
+  average = sum / num;
+  sum_squares_from_average += delta * (value - average);
+}
+
+// Uses the pairwise update of the sum of squares of Chan et al., see
+// http://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
+void DistributionStat::Shard::Merge(const Shard& other) {
+  if (other.num == 0) return;
+  if (num == 0) {
+    *this = other;
+    return;
+  }
+  const double delta = other.average - average;
+  const double total = static_cast<double>(num + other.num);
+  sum_squares_from_average += other.sum_squares_from_average +
+                              delta * delta * num * other.num / total;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  sum += other.sum;
+  num += other.num;
+  average = sum / num;
+}
+
 DistributionStat::DistributionStat(const std::string& name)
-    : Stat(name),
-      sum_(0.0),
-      average_(0.0),
-      sum_squares_from_average_(0.0),
-      min_(0.0),
-      max_(0.0),
-      num_(0) {}
+    : Stat(name), shard_(), owner_(std::thread::id()), other_shards_() {}
 
 DistributionStat::DistributionStat(const std::string& name, StatsGroup* group)
-    : Stat(name, group),
-      sum_(0.0),
-      average_(0.0),
-      sum_squares_from_average_(0.0),
-      min_(0.0),
-      max_(0.0),
-      num_(0) {}
+    : Stat(name, group), shard_(), owner_(std::thread::id()), other_shards_() {}
 
 void DistributionStat::Reset() {
-  sum_ = 0.0;
-  average_ = 0.0;
-  sum_squares_from_average_ = 0.0;
-  min_ = 0.0;
-  max_ = 0.0;
-  num_ = 0;
-}
-
-void DistributionStat::AddToDistribution(double value) {
-  if (num_ == 0) {
-    min_ = value;
-    max_ = value;
-    sum_ = value;
-    average_ = value;
-    num_ = 1;
+  std::lock_guard<std::mutex> lock(mutex_);
+  shard_ = Shard();
+  owner_ = std::thread::id();
+  other_shards_.clear();
+}
+
+void DistributionStat::AddToDistributionFromOtherThread(double value) {
+  const std::thread::id thread_id = std::this_thread::get_id();
+  std::thread::id no_owner;
+  if (owner_.compare_exchange_strong(no_owner, thread_id)) {
+    shard_.Add(value);
     return;
   }
-  min_ = std::min(min_, value);
-  max_ = std::max(max_, value);
-  sum_ += value;
-  ++num_;
-  const double delta = value - average_;
-  average_ = sum_ / num_;
-  sum_squares_from_average_ += delta * (value - average_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  other_shards_[thread_id].Add(value);
 }
 
-double DistributionStat::Average() const { return average_; }
+DistributionStat::Shard DistributionStat::Merged() const {
+  Shard result = shard_;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : other_shards_) {
+    result.Merge(entry.second);
+  }
+  return result;
+}
+
+bool DistributionStat::WorthPrinting() const { return Num() != 0; }
+
+double DistributionStat::Average() const { return Merged().average; }
 
 double DistributionStat::StdDeviation() const {
-  if (num_ == 0) return 0.0;
-  return sqrt(sum_squares_from_average_ / num_);
+  const Shard merged = Merged();
+  if (merged.num == 0) return 0.0;
+  return sqrt(merged.sum_squares_from_average / merged.num);
 }
 
 double TimeDistribution::CyclesToSeconds(double cycles) {
@@ -188,11 +245,14 @@ void TimeDistribution::AddTimeInCycles(double cycles) {
 }
 
 std::string TimeDistribution::ValueAsString() const {
+  const Shard merged = Merged();
   return StringPrintf(
-      "%8llu [%8s, %8s] %8s %8s %8s\n", num_, PrintCyclesAsTime(min_).c_str(),
-      PrintCyclesAsTime(max_).c_str(), PrintCyclesAsTime(Average()).c_str(),
+      "%8llu [%8s, %8s] %8s %8s %8s\n", merged.num,
+      PrintCyclesAsTime(merged.min).c_str(),
+      PrintCyclesAsTime(merged.max).c_str(),
+      PrintCyclesAsTime(merged.average).c_str(),
       PrintCyclesAsTime(StdDeviation()).c_str(),
-      PrintCyclesAsTime(sum_).c_str());
+      PrintCyclesAsTime(merged.sum).c_str());
 }
 
 void RatioDistribution::Add(double value) {
@@ -201,16 +261,18 @@ void RatioDistribution::Add(double value) {
 }
 
 std::string RatioDistribution::ValueAsString() const {
-  return StringPrintf("%8llu [%7.2lf%%, %7.2lf%%] %7.2lf%% %7.2lf%%\n", num_,
-                      100.0 * min_, 100.0 * max_, 100.0 * Average(),
-                      100.0 * StdDeviation());
+  const Shard merged = Merged();
+  return StringPrintf("%8llu [%7.2lf%%, %7.2lf%%] %7.2lf%% %7.2lf%%\n",
+                      merged.num, 100.0 * merged.min, 100.0 * merged.max,
+                      100.0 * merged.average, 100.0 * StdDeviation());
 }
 
 void DoubleDistribution::Add(double value) { AddToDistribution(value); }
 
 std::string DoubleDistribution::ValueAsString() const {
-  return StringPrintf("%8llu [%8.1e, %8.1e] %8.1e %8.1e\n", num_, min_, max_,
-                      Average(), StdDeviation());
+  const Shard merged = Merged();
+  return StringPrintf("%8llu [%8.1e, %8.1e] %8.1e %8.1e\n", merged.num,
+                      merged.min, merged.max, merged.average, StdDeviation());
 }
 
 void IntegerDistribution::Add(int64 value) {
@@ -218,8 +280,10 @@ void IntegerDistribution::Add(int64 value) {
 }
 
 std::string IntegerDistribution::ValueAsString() const {
-  return StringPrintf("%8llu [%8.lf, %8.lf] %8.2lf %8.2lf %8.lf\n", num_, min_,
-                      max_, Average(), StdDeviation(), sum_);
+  const Shard merged = Merged();
+  return StringPrintf("%8llu [%8.lf, %8.lf] %8.2lf %8.2lf %8.lf\n", merged.num,
+                      merged.min, merged.max, merged.average, StdDeviation(),
+                      merged.sum);
 }
 
 }  // namespace operations_research
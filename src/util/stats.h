@@ -64,12 +64,27 @@
 // The idea is that by default the instrumentation is off. You can also use the
 // macro IF_STATS_ENABLED() that does nothing if OR_STATS is not defined or just
 // translates to its argument otherwise.
+//
+// When OR_STATS is defined, the instrumentation can also be switched on and off
+// at runtime with EnableStats(); it then costs a single test when it is off.
+//
+// The statistics can be updated by several threads: the first thread to add a
+// value to a distribution owns it and updates it without synchronization, the
+// other threads update their own shard of the distribution, and the shards are
+// merged when the distribution is read. Note that a distribution should not be
+// read while values are added to it.
 
 #ifndef OR_TOOLS_UTIL_STATS_H_
 #define OR_TOOLS_UTIL_STATS_H_
 
+#include <algorithm>
+#include <atomic>
 #include <map>
+#include <mutex>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
 
 #include "base/timer.h"
 
@@ -78,6 +93,12 @@ namespace operations_research {
 // Returns the current thread's total memory usage in an human-readable std::string.
 std::string MemoryUsage();
 
+// Switches on or off the statistics collected through the IF_STATS_ENABLED()
+// and SCOPED_TIME_STAT() macros. They are on by default, and always off if
+// OR_STATS is not defined.
+void EnableStats(bool enable);
+inline bool StatsEnabled();
+
 // Forward declaration.
 class StatsGroup;
 class TimeDistribution;
@@ -128,16 +149,23 @@ class StatsGroup {
 
   // Returns and if needed creates and registers a TimeDistribution with the
   // given name. Note that this involve a map lookup and his thus slower than
-  // directly accessing a TimeDistribution variable.
+  // directly accessing a TimeDistribution variable. This is thread-safe.
   TimeDistribution* LookupOrCreateTimeDistribution(std::string name);
 
+  // Same as above, but the lookup is done by the address of the name, which
+  // must be a static string like __FUNCTION__. This is faster.
+  TimeDistribution* LookupOrCreateTimeDistribution(const char* name);
+
   // Calls Reset() on all the statistics registered with this group.
   void Reset();
 
  private:
   std::string name_;
   std::vector<Stat*> stats_;
+  std::mutex mutex_;
   std::map<std::string, TimeDistribution*> time_distributions_;
+  std::unordered_map<const char*, TimeDistribution*>
+      time_distributions_by_address_;
 
   DISALLOW_COPY_AND_ASSIGN(StatsGroup);
 };
@@ -151,16 +179,16 @@ class DistributionStat : public Stat {
   DistributionStat(const std::string& name, StatsGroup* group);
   virtual ~DistributionStat() {}
   virtual void Reset();
-  virtual bool WorthPrinting() const { return num_ != 0; }
+  virtual bool WorthPrinting() const;
 
   // Implemented by the subclasses.
   virtual std::string ValueAsString() const = 0;
 
   // Trivial statistics on all the values added so far.
-  double Sum() const { return sum_; }
-  double Max() const { return max_; }
-  double Min() const { return min_; }
-  int64 Num() const { return num_; }
+  double Sum() const { return Merged().sum; }
+  double Max() const { return Merged().max; }
+  double Min() const { return Merged().min; }
+  int64 Num() const { return Merged().num; }
 
   // Get the average of the distribution or 0.0 if empty.
   double Average() const;
@@ -173,14 +201,40 @@ class DistributionStat : public Stat {
   double StdDeviation() const;
 
  protected:
+  // The statistics on the values added by one thread.
+  struct Shard {
+    Shard();
+    void Add(double value);
+    void Merge(const Shard& other);
+    double sum;
+    double average;
+    double sum_squares_from_average;
+    double min;
+    double max;
+    int64 num;
+  };
+
   // Adds a value to this sequence and updates the stats.
-  void AddToDistribution(double value);
-  double sum_;
-  double average_;
-  double sum_squares_from_average_;
-  double min_;
-  double max_;
-  int64 num_;
+  void AddToDistribution(double value) {
+    if (owner_.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+      shard_.Add(value);
+    } else {
+      AddToDistributionFromOtherThread(value);
+    }
+  }
+
+  // Returns the statistics on the values added by all the threads.
+  Shard Merged() const;
+
+ private:
+  // Takes the ownership of the distribution if it has no owner yet, or adds
+  // the value to the shard of the current thread.
+  void AddToDistributionFromOtherThread(double value);
+
+  Shard shard_;
+  std::atomic<std::thread::id> owner_;
+  mutable std::mutex mutex_;
+  std::map<std::thread::id, Shard> other_shards_;
 };
 
 // Statistic on the distribution of a sequence of running times.
@@ -257,20 +311,36 @@ class IntegerDistribution : public DistributionStat {
   void Add(int64 value);
 };
 
+namespace internal {
+extern std::atomic<bool> stats_enabled;
+}  // namespace internal
+
+inline bool StatsEnabled() {
+#ifdef OR_STATS
+  return internal::stats_enabled.load(std::memory_order_relaxed);
+#else
+  return false;
+#endif  // OR_STATS
+}
+
 #ifdef OR_STATS
 
 // Helper class to time a block of code and add the result to a
-// TimeDistribution. Calls StartTimer() on creation and
-// StopTimerAndAddElapsedTime() on destruction.
+// TimeDistribution. The time is measured with its own cycle counter reads, so
+// a TimeDistribution can be updated concurrently by several threads. Does
+// nothing if the given stat is NULL or if the stats are disabled.
 class ScopedTimeDistributionUpdater {
  public:
   // Note that this does not take ownership of the given stat.
   explicit ScopedTimeDistributionUpdater(TimeDistribution* stat)
-      : stat_(stat), also_update_(NULL) {
-    stat->StartTimer();
-  }
+      : stat_(StatsEnabled() ? stat : NULL),
+        also_update_(NULL),
+        start_cycles_(stat_ == NULL ? 0 : CycleClock::Now()) {}
   ~ScopedTimeDistributionUpdater() {
-    const double cycles = stat_->StopTimerAndAddElapsedTime();
+    if (stat_ == NULL) return;
+    const double cycles =
+        std::max<int64>(0, CycleClock::Now() - start_cycles_);
+    stat_->AddTimeInCycles(cycles);
     if (also_update_ != NULL) {
       also_update_->AddTimeInCycles(cycles);
     }
@@ -290,23 +360,30 @@ class ScopedTimeDistributionUpdater {
  private:
   TimeDistribution* stat_;
   TimeDistribution* also_update_;
+  const int64 start_cycles_;
   DISALLOW_COPY_AND_ASSIGN(ScopedTimeDistributionUpdater);
 };
 
 // Simple macro to be used by a client that want to execute costly operations
-// only if OR_STATS is defined.
-#define IF_STATS_ENABLED(instructions) instructions
+// only if OR_STATS is defined and the stats are enabled. The empty branch
+// avoids a dangling else when the macro is the body of an if.
+#define IF_STATS_ENABLED(instructions)      \
+  if (!operations_research::StatsEnabled()) { \
+  } else                                      \
+    instructions
 
 // Measures the time from this macro line to the end of the scope and adds it
 // to the distribution (from the given StatsGroup) with the same name as the
 // enclosing function.
 //
 // Note(user): This adds more extra overhead around the measured code compared
-// to defining your own TimeDistribution stat in your StatsGroup. About 80ns
-// per measurement compared to about 20ns (as of 2012-06, on my workstation).
+// to defining your own TimeDistribution stat in your StatsGroup, because of
+// the lookup of the distribution by the address of the function name.
 #define SCOPED_TIME_STAT(stats)                                        \
   operations_research::ScopedTimeDistributionUpdater scoped_time_stat( \
-      (stats)->LookupOrCreateTimeDistribution(__FUNCTION__))
+      operations_research::StatsEnabled()                              \
+          ? (stats)->LookupOrCreateTimeDistribution(__FUNCTION__)      \
+          : NULL)
 
 #else  // OR_STATS
 // If OR_STATS is not defined, we remove some instructions that may be time
@@ -15,6 +15,7 @@
 #define OR_TOOLS_UTIL_TIME_LIMIT_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <limits>
 #include <vector>
@@ -22,6 +23,7 @@
 #include "base/commandlineflags.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/mutex.h"
 #include "base/port.h"
 #include "base/timer.h"
 #include "base/time_support.h"
@@ -42,7 +44,8 @@ namespace operations_research {
 // the deterministic time has to be advanced manually using the method
 // AdvanceDeterministicTime().
 //
-// The call itself is as fast as CycleClock::Now() + a few trivial instructions.
+// The call itself is as fast as CycleClock::Now() + a few trivial instructions,
+// and it doesn't read the clock at all when there is no elapsed time limit.
 //
 // The limit is very conservative: it returns true (i.e. the limit is reached)
 // when current_time + std::max(T, ε) >= limit_time, where ε is a small constant (see
@@ -112,6 +115,25 @@ class TimeLimit {
     return elapsed_deterministic_time_;
   }
 
+  // Makes LimitReached() return true as soon as *external_boolean_as_limit
+  // is true, e.g. when another thread wants to interrupt the computation.
+  // The boolean must outlive this object; nullptr unregisters it.
+  void RegisterExternalBooleanAsLimit(
+      const std::atomic<bool>* external_boolean_as_limit) {
+    external_boolean_as_limit_ = external_boolean_as_limit;
+  }
+
+  // Returns the registered external boolean, or nullptr.
+  const std::atomic<bool>* ExternalBooleanAsLimit() const {
+    return external_boolean_as_limit_;
+  }
+
+  // Lowers the limits of this object to the time left and the deterministic
+  // time left of 'other', and registers the external boolean of 'other' if it
+  // has one. This is used to give the limits of a parent computation to a
+  // sub-computation which has its own TimeLimit.
+  void MergeWithGlobalTimeLimit(const TimeLimit& other);
+
  private:
   const int64 start_ns_;
   int64 last_ns_;
@@ -126,9 +148,66 @@ class TimeLimit {
   double deterministic_limit_;
   double elapsed_deterministic_time_;
 
+  const std::atomic<bool>* external_boolean_as_limit_;
+
   DISALLOW_COPY_AND_ASSIGN(TimeLimit);
 };
 
+// Wraps a TimeLimit so that it can be shared by the threads of a parallel
+// computation. Each thread should keep its own TimeLimit, for fast
+// LimitReached() calls, and give it the shared limits with UpdateLocalLimit():
+//
+//   TimeLimit global_limit(max_time_in_seconds, max_deterministic_time);
+//   SharedTimeLimit shared_limit(&global_limit);
+//   ... in each worker:
+//     TimeLimit local_limit(worker_time_in_seconds);
+//     shared_limit.UpdateLocalLimit(&local_limit);
+//     while (!local_limit.LimitReached()) { ... }
+//     shared_limit.AdvanceDeterministicTime(
+//         local_limit.GetElapsedDeterministicTime());
+//   ... in the worker that finds the answer:
+//     shared_limit.Stop();
+//
+// Stop(), or the wrapped limit being reached in SharedTimeLimit::LimitReached(),
+// sets an atomic boolean registered as external limit in all the local limits,
+// so that all the workers stop at their next LimitReached() check. All the
+// methods are thread-safe.
+class SharedTimeLimit {
+ public:
+  // The wrapped limit is not owned, and must outlive this object. It must not
+  // be used directly while this object exists.
+  explicit SharedTimeLimit(TimeLimit* time_limit);
+  ~SharedTimeLimit();
+
+  // Returns true if Stop() was called or if the wrapped limit is reached.
+  bool LimitReached();
+
+  // Makes all the limits sharing this one reached.
+  void Stop() { stopped_ = true; }
+
+  // Lowers the limits of 'local_limit' to the ones of the wrapped limit, and
+  // makes 'local_limit' reached when Stop() is called.
+  void UpdateLocalLimit(TimeLimit* local_limit);
+
+  // Adds the deterministic time spent by a worker to the wrapped limit, so
+  // that the deterministic time of all the workers is aggregated.
+  void AdvanceDeterministicTime(double deterministic_duration);
+
+  double GetTimeLeft() const;
+  double GetDeterministicTimeLeft() const;
+  double GetElapsedDeterministicTime() const;
+
+ private:
+  mutable Mutex mutex_;
+  TimeLimit* const time_limit_;
+  std::atomic<bool> stopped_;
+  // The external boolean registered in time_limit_ before this object was
+  // created. It is registered back by the destructor.
+  const std::atomic<bool>* const previous_external_boolean_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedTimeLimit);
+};
+
 // ################## Implementations below #####################
 
 inline TimeLimit::TimeLimit(double limit_in_seconds, double deterministic_limit)
@@ -140,7 +219,8 @@ inline TimeLimit::TimeLimit(double limit_in_seconds, double deterministic_limit)
       safety_buffer_ns_(static_cast<int64>(kSafetyBufferSeconds * 1e9)),
       running_max_(kHistorySize),
       deterministic_limit_(deterministic_limit),
-      elapsed_deterministic_time_(0.0) {
+      elapsed_deterministic_time_(0.0),
+      external_boolean_as_limit_(nullptr) {
   if (FLAGS_time_limit_use_usertime) {
     user_timer_.Start();
     limit_in_seconds_ = limit_in_seconds;
@@ -148,9 +228,15 @@ inline TimeLimit::TimeLimit(double limit_in_seconds, double deterministic_limit)
 }
 
 inline bool TimeLimit::LimitReached() {
+  if (external_boolean_as_limit_ != nullptr &&
+      external_boolean_as_limit_->load()) {
+    return true;
+  }
   if (GetDeterministicTimeLeft() <= 0.0) {
     return true;
   }
+  // There is no point in reading the clock without an elapsed time limit.
+  if (limit_ns_ == kint64max) return false;
 
   const int64 current_ns = base::GetCurrentTimeNanos();
   running_max_.Add(std::max(safety_buffer_ns_, current_ns - last_ns_));
@@ -185,6 +271,76 @@ inline double TimeLimit::GetTimeLeft() const {
   }
 }
 
+inline void TimeLimit::MergeWithGlobalTimeLimit(const TimeLimit& other) {
+  const double other_time_left = other.GetTimeLeft();
+  if (other_time_left < GetTimeLeft()) {
+    const int64 current_ns = base::GetCurrentTimeNanos();
+    limit_ns_ = current_ns + static_cast<int64>(other_time_left * 1e9);
+    // The clock may not have been read since the construction.
+    last_ns_ = current_ns;
+    if (FLAGS_time_limit_use_usertime) {
+      limit_in_seconds_ = user_timer_.Get() + other_time_left;
+    }
+  }
+  const double other_deterministic_time_left =
+      other.GetDeterministicTimeLeft();
+  if (other_deterministic_time_left < GetDeterministicTimeLeft()) {
+    deterministic_limit_ =
+        elapsed_deterministic_time_ + other_deterministic_time_left;
+  }
+  if (other.ExternalBooleanAsLimit() != nullptr) {
+    RegisterExternalBooleanAsLimit(other.ExternalBooleanAsLimit());
+  }
+}
+
+inline SharedTimeLimit::SharedTimeLimit(TimeLimit* time_limit)
+    : time_limit_(time_limit),
+      stopped_(false),
+      previous_external_boolean_(time_limit->ExternalBooleanAsLimit()) {
+  time_limit_->RegisterExternalBooleanAsLimit(&stopped_);
+}
+
+inline SharedTimeLimit::~SharedTimeLimit() {
+  time_limit_->RegisterExternalBooleanAsLimit(previous_external_boolean_);
+}
+
+inline bool SharedTimeLimit::LimitReached() {
+  if (stopped_) return true;
+  MutexLock mutex_lock(&mutex_);
+  if ((previous_external_boolean_ != nullptr &&
+       previous_external_boolean_->load()) ||
+      time_limit_->LimitReached()) {
+    stopped_ = true;
+  }
+  return stopped_;
+}
+
+inline void SharedTimeLimit::UpdateLocalLimit(TimeLimit* local_limit) {
+  MutexLock mutex_lock(&mutex_);
+  local_limit->MergeWithGlobalTimeLimit(*time_limit_);
+}
+
+inline void SharedTimeLimit::AdvanceDeterministicTime(
+    double deterministic_duration) {
+  MutexLock mutex_lock(&mutex_);
+  time_limit_->AdvanceDeterministicTime(deterministic_duration);
+}
+
+inline double SharedTimeLimit::GetTimeLeft() const {
+  MutexLock mutex_lock(&mutex_);
+  return stopped_ ? 0.0 : time_limit_->GetTimeLeft();
+}
+
+inline double SharedTimeLimit::GetDeterministicTimeLeft() const {
+  MutexLock mutex_lock(&mutex_);
+  return stopped_ ? 0.0 : time_limit_->GetDeterministicTimeLeft();
+}
+
+inline double SharedTimeLimit::GetElapsedDeterministicTime() const {
+  MutexLock mutex_lock(&mutex_);
+  return time_limit_->GetElapsedDeterministicTime();
+}
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_UTIL_TIME_LIMIT_H_
@@ -28,32 +28,67 @@
 // Therefore, you don't need to use const IntTupleSet& in methods. Just do:
 // void MyMethod(IntTupleSet tuple_set) { ... }
 //
-// This class is thread hostile as the copy and reference counter are
-// not protected by a mutex.
+// The reference counter is atomic, so the copies of a set can be given to
+// several threads (e.g. to the Solver of each worker of a parallel search)
+// without copying the tuples. The copies can then be read concurrently, but
+// a given IntTupleSet instance must not be modified while another thread
+// uses it.
+//
+// The set also maintains, on demand, an index of the tuples by value for each
+// column (see GetColumnIndex()). It is built once and shared by all the copies
+// of the set, so that the table constraints created from the same set in
+// different solvers don't have to scan the tuples again.
 
 #ifndef OR_TOOLS_UTIL_TUPLE_SET_H_
 #define OR_TOOLS_UTIL_TUPLE_SET_H_
 
 #include <algorithm>
+#include <atomic>
 #include "base/hash.h"
 #include "base/hash.h"
+#include "base/unique_ptr.h"
 #include <vector>
 
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/map_util.h"
+#include "base/mutex.h"
 #include "base/hash.h"
 
 namespace operations_research {
 // ----- Main IntTupleSet class -----
 class IntTupleSet {
  public:
+#if !defined(SWIG)
+  // The tuples of the set grouped by their value in one column. The values
+  // that appear in the column are sorted, and the tuples containing
+  // values[i] are tuple_indices[starts[i]] to tuple_indices[starts[i + 1] - 1],
+  // in increasing order.
+  struct ColumnIndex {
+    std::vector<int64> values;
+    std::vector<int> starts;
+    std::vector<int> tuple_indices;
+
+    int NumValues() const { return values.size(); }
+
+    // Returns the index of the value in 'values', or -1 if the value doesn't
+    // appear in the column.
+    int ValueIndex(int64 value) const {
+      const std::vector<int64>::const_iterator it =
+          std::lower_bound(values.begin(), values.end(), value);
+      return it != values.end() && *it == value ? it - values.begin() : -1;
+    }
+  };
+#endif  // !defined(SWIG)
+
   // Creates an empty tuple set with a fixed length for all tuples.
   explicit IntTupleSet(int arity);
   // Copy constructor (it actually does a lazy copy, see toplevel comment).
   IntTupleSet(const IntTupleSet& set);  // NOLINT
   ~IntTupleSet();
+  // Assignment operator (it also does a lazy copy).
+  IntTupleSet& operator=(const IntTupleSet& set);
 
   // Clears data.
   void Clear();
@@ -88,6 +123,13 @@ class IntTupleSet {
   const int64* RawData() const;
   // Returns the number of different values in the given column.
   int NumDifferentValuesInColumn(int col) const;
+#if !defined(SWIG)
+  // Returns the index of the given column. It is built on the first call and
+  // then shared by all the copies of the set, until the set is modified. The
+  // reference is valid as long as the set is neither modified nor destroyed.
+  // This can be called concurrently on copies of the same set.
+  const ColumnIndex& GetColumnIndex(int col) const;
+#endif  // !defined(SWIG)
   // Return a copy of the set, sorted by the "col"-th value of each
   // tuples. The sort is stable.
   IntTupleSet SortedByColumn(int col) const;
@@ -116,16 +158,23 @@ class IntTupleSet {
     int Arity() const;
     const int64* RawData() const;
     void Clear();
+    const ColumnIndex& GetColumnIndex(int col);
 
    private:
     const int arity_;
-    int num_owners_;
+    std::atomic<int> num_owners_;
     // Concatenation of all tuples ever added.
     std::vector<int64> flat_tuples_;
     // Maps a tuple's fingerprint to the list of tuples with this
     // fingerprint, represented by their start index in the
     // flat_tuples_ vector.
     hash_map<int64, std::vector<int> > tuple_fprint_to_index_;
+    // The column indices built so far, guarded by column_index_mutex_ as
+    // they may be built by several threads sharing this data. They are
+    // cleared when the data is modified, which only happens when it is not
+    // shared.
+    Mutex column_index_mutex_;
+    std::vector<std::unique_ptr<ColumnIndex> > column_indices_;
   };
 
   // Used to represent a light representation of a tuple.
@@ -166,7 +215,10 @@ inline bool IntTupleSet::Data::RemovedSharedOwner() {
 inline IntTupleSet::Data* IntTupleSet::Data::CopyIfShared() {
   if (num_owners_ > 1) {  // Copy on write.
     Data* const new_data = new Data(*this);
-    RemovedSharedOwner();
+    // The other owners may have released this data in the meantime.
+    if (RemovedSharedOwner()) {
+      delete this;
+    }
     new_data->AddSharedOwner();
     return new_data;
   }
@@ -188,6 +240,7 @@ int IntTupleSet::Data::Insert(const std::vector<T>& tuple) {
     }
     const int64 fingerprint = Fingerprint(tuple);
     tuple_fprint_to_index_[fingerprint].push_back(index);
+    column_indices_.clear();
     return index;
   } else {
     return -1;
@@ -263,6 +316,45 @@ inline const int64* IntTupleSet::Data::RawData() const {
 inline void IntTupleSet::Data::Clear() {
   flat_tuples_.clear();
   tuple_fprint_to_index_.clear();
+  column_indices_.clear();
+}
+
+inline const IntTupleSet::ColumnIndex& IntTupleSet::Data::GetColumnIndex(
+    int col) {
+  DCHECK_GE(col, 0);
+  DCHECK_LT(col, arity_);
+  MutexLock lock(&column_index_mutex_);
+  if (column_indices_.empty()) {
+    column_indices_.resize(arity_);
+  }
+  if (column_indices_[col] == nullptr) {
+    ColumnIndex* const index = new ColumnIndex();
+    const int num_tuples = NumTuples();
+    for (int i = 0; i < num_tuples; ++i) {
+      index->values.push_back(Value(i, col));
+    }
+    std::sort(index->values.begin(), index->values.end());
+    index->values.erase(std::unique(index->values.begin(), index->values.end()),
+                        index->values.end());
+
+    // Counting sort of the tuples by value index.
+    std::vector<int> value_indices(num_tuples);
+    index->starts.assign(index->values.size() + 1, 0);
+    for (int i = 0; i < num_tuples; ++i) {
+      value_indices[i] = index->ValueIndex(Value(i, col));
+      ++index->starts[value_indices[i] + 1];
+    }
+    for (int v = 0; v < index->values.size(); ++v) {
+      index->starts[v + 1] += index->starts[v];
+    }
+    index->tuple_indices.resize(num_tuples);
+    std::vector<int> positions(index->starts.begin(), index->starts.end() - 1);
+    for (int i = 0; i < num_tuples; ++i) {
+      index->tuple_indices[positions[value_indices[i]]++] = i;
+    }
+    column_indices_[col].reset(index);
+  }
+  return *column_indices_[col];
 }
 
 inline IntTupleSet::IntTupleSet(int arity) : data_(new Data(arity)) {
@@ -281,6 +373,17 @@ inline IntTupleSet::~IntTupleSet() {
   }
 }
 
+inline IntTupleSet& IntTupleSet::operator=(const IntTupleSet& set) {
+  if (data_ != set.data_) {
+    set.data_->AddSharedOwner();
+    if (data_->RemovedSharedOwner()) {
+      delete data_;
+    }
+    data_ = set.data_;
+  }
+  return *this;
+}
+
 inline void IntTupleSet::Clear() {
   data_ = data_->CopyIfShared();
   data_->Clear();
@@ -356,11 +459,14 @@ inline int IntTupleSet::NumDifferentValuesInColumn(int col) const {
   if (col < 0 || col >= data_->Arity()) {
     return 0;
   }
-  hash_set<int64> values;
-  for (int i = 0; i < data_->NumTuples(); ++i) {
-    values.insert(data_->Value(i, col));
-  }
-  return values.size();
+  return data_->GetColumnIndex(col).NumValues();
+}
+
+inline const IntTupleSet::ColumnIndex& IntTupleSet::GetColumnIndex(
+    int col) const {
+  CHECK_GE(col, 0);
+  CHECK_LT(col, data_->Arity());
+  return data_->GetColumnIndex(col);
 }
 
 inline bool IntTupleSet::IndexValue::Compare(const IndexValue& a,